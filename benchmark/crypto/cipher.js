@@ -0,0 +1,39 @@
+// Encryption throughput of the common bulk ciphers. The AES modes depend
+// on AES-NI, PCLMULQDQ and, on newer CPUs, VAES; see the cryptoAcceleration
+// section of a diagnostic report for what OpenSSL detected.
+'use strict';
+
+const common = require('../common.js');
+const crypto = require('crypto');
+
+const bench = common.createBenchmark(main, {
+  cipher: [
+    'aes-128-gcm',
+    'aes-256-gcm',
+    'aes-128-cbc',
+    'aes-256-ctr',
+    'chacha20-poly1305',
+  ],
+  len: [64, 1024, 16384, 1048576],
+  n: [1e4],
+});
+
+function main({ cipher, len, n }) {
+  const { keyLength, ivLength, mode } = crypto.getCipherInfo(cipher);
+  const key = crypto.randomBytes(keyLength);
+  const iv = crypto.randomBytes(ivLength);
+  const aead = mode === 'gcm' || cipher === 'chacha20-poly1305';
+  const options = aead ? { authTagLength: 16 } : undefined;
+  const data = Buffer.alloc(len, 'a');
+  n = Math.max(1, Math.floor(n * 1024 / len));
+
+  bench.start();
+  for (let i = 0; i < n; i++) {
+    const c = crypto.createCipheriv(cipher, key, iv, options);
+    c.update(data);
+    c.final();
+    if (aead)
+      c.getAuthTag();
+  }
+  bench.end(n * len / (1024 * 1024));
+}
@@ -0,0 +1,24 @@
+// Throughput of one-shot digests over buffers of various sizes.
+// Run with OPENSSL_ia32cap set to compare against OpenSSL's generic code
+// paths, e.g. OPENSSL_ia32cap='~0x200000200000000' to disable AES-NI and
+// PCLMULQDQ.
+'use strict';
+
+const common = require('../common.js');
+const crypto = require('crypto');
+
+const bench = common.createBenchmark(main, {
+  algo: ['sha1', 'sha256', 'sha512', 'sha3-256', 'blake2b512'],
+  len: [64, 1024, 16384, 1048576],
+  n: [1e4],
+});
+
+function main({ algo, len, n }) {
+  const data = Buffer.alloc(len, 'a');
+  n = Math.max(1, Math.floor(n * 1024 / len));
+
+  bench.start();
+  for (let i = 0; i < n; i++)
+    crypto.createHash(algo).update(data).digest();
+  bench.end(n * len / (1024 * 1024));
+}
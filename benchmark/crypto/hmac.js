@@ -0,0 +1,22 @@
+// Throughput of one-shot HMACs over buffers of various sizes.
+'use strict';
+
+const common = require('../common.js');
+const crypto = require('crypto');
+
+const bench = common.createBenchmark(main, {
+  algo: ['sha1', 'sha256', 'sha512'],
+  len: [64, 1024, 16384, 1048576],
+  n: [1e4],
+});
+
+function main({ algo, len, n }) {
+  const key = crypto.createSecretKey(crypto.randomBytes(32));
+  const data = Buffer.alloc(len, 'a');
+  n = Math.max(1, Math.floor(n * 1024 / len));
+
+  bench.start();
+  for (let i = 0; i < n; i++)
+    crypto.createHmac(algo, key).update(data).digest();
+  bench.end(n * len / (1024 * 1024));
+}
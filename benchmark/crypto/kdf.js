@@ -0,0 +1,39 @@
+// Derivations per second for the key derivation functions, run on the
+// libuv threadpool the way applications normally use them.
+'use strict';
+
+const common = require('../common.js');
+const crypto = require('crypto');
+
+const bench = common.createBenchmark(main, {
+  kdf: ['pbkdf2', 'scrypt', 'hkdf'],
+  n: [100],
+});
+
+const derive = {
+  pbkdf2(password, salt, callback) {
+    crypto.pbkdf2(password, salt, 10000, 32, 'sha256', callback);
+  },
+  scrypt(password, salt, callback) {
+    crypto.scrypt(password, salt, 32, { N: 16384, r: 8, p: 1 }, callback);
+  },
+  hkdf(password, salt, callback) {
+    crypto.hkdf('sha256', password, salt, 'info', 32, callback);
+  },
+};
+
+function main({ kdf, n }) {
+  const password = crypto.randomBytes(32);
+  const salt = crypto.randomBytes(16);
+  let remaining = n;
+
+  bench.start();
+  for (let i = 0; i < n; i++) {
+    derive[kdf](password, salt, (err) => {
+      if (err)
+        throw err;
+      if (--remaining === 0)
+        bench.end(n);
+    });
+  }
+}
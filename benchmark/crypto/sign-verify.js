@@ -0,0 +1,38 @@
+// Signatures and verifications per second for the common key types.
+'use strict';
+
+const common = require('../common.js');
+const crypto = require('crypto');
+
+const keyTypes = {
+  'rsa-2048': ['rsa', { modulusLength: 2048 }, 'sha256'],
+  'rsa-pss-2048': ['rsa-pss', { modulusLength: 2048 }, 'sha256'],
+  'ec-p256': ['ec', { namedCurve: 'P-256' }, 'sha256'],
+  'ec-p384': ['ec', { namedCurve: 'P-384' }, 'sha384'],
+  'ed25519': ['ed25519', {}, null],
+};
+
+const bench = common.createBenchmark(main, {
+  keyType: Object.keys(keyTypes),
+  mode: ['sign', 'verify'],
+  n: [1e3],
+});
+
+function main({ keyType, mode, n }) {
+  const [type, options, digest] = keyTypes[keyType];
+  const { privateKey, publicKey } = crypto.generateKeyPairSync(type, options);
+  const data = Buffer.alloc(256, 'a');
+  const signature = crypto.sign(digest, data, privateKey);
+
+  if (mode === 'sign') {
+    bench.start();
+    for (let i = 0; i < n; i++)
+      crypto.sign(digest, data, privateKey);
+    bench.end(n);
+  } else {
+    bench.start();
+    for (let i = 0; i < n; i++)
+      crypto.verify(digest, data, publicKey, signature);
+    bench.end(n);
+  }
+}
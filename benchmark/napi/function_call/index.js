@@ -28,6 +28,7 @@ try {
   process.exit(0);
 }
 const napi = napi_binding.hello;
+const napi_fast = napi_binding.helloFast;
 
 let c = 0;
 function js() {
@@ -37,12 +38,12 @@ function js() {
 assert(js() === cxx());
 
 const bench = common.createBenchmark(main, {
-  type: ['js', 'cxx', 'napi'],
+  type: ['js', 'cxx', 'napi', 'napi_fast'],
   n: [1e6, 1e7, 5e7]
-});
+}, { flags: ['--turbo-fast-api-calls'] });
 
 function main({ n, type }) {
-  const fn = type === 'cxx' ? cxx : type === 'napi' ? napi : js;
+  const fn = { js, cxx, napi, napi_fast }[type];
   bench.start();
   for (let i = 0; i < n; i++) {
     fn();
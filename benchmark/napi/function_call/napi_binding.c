@@ -1,3 +1,4 @@
+#define NAPI_EXPERIMENTAL
 #include <assert.h>
 #include <node_api.h>
 
@@ -10,6 +11,11 @@ static napi_value Hello(napi_env env, napi_callback_info info) {
   return result;
 }
 
+static int32_t FastHello(napi_value receiver,
+                         node_api_fast_callback_options* options) {
+  return increment++;
+}
+
 NAPI_MODULE_INIT() {
   napi_value hello;
   napi_status status =
@@ -22,5 +28,21 @@ NAPI_MODULE_INIT() {
   assert(status == napi_ok);
   status = napi_set_named_property(env, exports, "hello", hello);
   assert(status == napi_ok);
+
+  node_api_fast_signature signature = {
+    (node_api_fast_callback)FastHello, node_api_fast_int32, NULL, 0
+  };
+  napi_value hello_fast;
+  status =
+      node_api_create_function_with_fast_path(env,
+                                              "helloFast",
+                                              NAPI_AUTO_LENGTH,
+                                              Hello,
+                                              NULL,
+                                              &signature,
+                                              &hello_fast);
+  assert(status == napi_ok);
+  status = napi_set_named_property(env, exports, "helloFast", hello_fast);
+  assert(status == napi_ok);
   return exports;
 }
@@ -57,6 +57,32 @@ NewWeak(napi_env env, napi_callback_info info) {
   return result;
 }
 
+static void
+FreeWrapped(napi_env env, void* data, void* hint) {
+  size_t* count = hint;
+  free(data);
+  (*count) = (*count) + 1;
+}
+
+// Like NewWeak(), but the way object-wrapping addons create their objects,
+// with a native allocation that the finalizer frees.
+static napi_value
+NewWrapped(napi_env env, napi_callback_info info) {
+  napi_value result;
+  void* instance_data;
+
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_get_instance_data(env, &instance_data));
+  NAPI_CALL(env, napi_wrap(env,
+                           result,
+                           malloc(64),
+                           FreeWrapped,
+                           instance_data,
+                           NULL));
+
+  return result;
+}
+
 static void
 FreeCount(napi_env env, void* data, void* hint) {
   free(data);
@@ -66,7 +92,8 @@ FreeCount(napi_env env, void* data, void* hint) {
 NAPI_MODULE_INIT(/* napi_env env, napi_value exports */) {
   napi_property_descriptor props[] = {
     { "count", NULL, NULL, GetCount, SetCount, NULL, napi_enumerable, NULL },
-    { "newWeak", NULL, NewWeak, NULL, NULL, NULL, napi_enumerable, NULL }
+    { "newWeak", NULL, NewWeak, NULL, NULL, NULL, napi_enumerable, NULL },
+    { "newWrapped", NULL, NewWrapped, NULL, NULL, NULL, napi_enumerable, NULL }
   };
 
   size_t* count = malloc(sizeof(*count));
@@ -1,18 +1,21 @@
 'use strict';
 const common = require('../../common');
 const addon = require(`./build/${common.buildType}/addon`);
-const bench = common.createBenchmark(main, { n: [1e7] });
+const bench = common.createBenchmark(main, {
+  type: ['finalizer', 'wrap'],
+  batch: [1, 1e4],
+  n: [1e7],
+});
 
-function callNewWeak() {
-  addon.newWeak();
-}
-
-function main({ n }) {
+function main({ n, type, batch }) {
+  // With larger batches, GC collects many objects at once, and all of their
+  // finalizers become pending together.
+  const create = type === 'wrap' ? addon.newWrapped : addon.newWeak;
   addon.count = 0;
   bench.start();
   new Promise((resolve) => {
     (function oneIteration() {
-      callNewWeak();
+      for (let i = 0; i < batch; i++) create();
       setImmediate(() => ((addon.count < n) ? oneIteration() : resolve()));
     })();
   }).then(() => bench.end(n));
@@ -0,0 +1,53 @@
+#include "base64-inl.h"
+#include "native_benchmark.h"
+
+#include <string>
+
+using node::bench::DoNotOptimize;
+using node::bench::State;
+
+static std::string Input(size_t size) {
+  std::string input(size, '\0');
+  for (size_t i = 0; i < size; i++) input[i] = static_cast<char>(i * 31);
+  return input;
+}
+
+static void BM_Base64Encode(State& state) {
+  std::string input = Input(state.range());
+  std::string output(node::base64_encoded_size(input.size()), '\0');
+  for (auto _ : state) {
+    DoNotOptimize(node::base64_encode(
+        input.data(), input.size(), &output[0], output.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+NODE_BENCHMARK(BM_Base64Encode)->Range(16, 1 << 20, 64);
+
+static void BM_Base64Decode(State& state) {
+  std::string input = Input(state.range());
+  std::string encoded(node::base64_encoded_size(input.size()), '\0');
+  node::base64_encode(input.data(), input.size(), &encoded[0], encoded.size());
+  std::string output(input.size(), '\0');
+  for (auto _ : state) {
+    DoNotOptimize(node::base64_decode(
+        &output[0], output.size(), encoded.data(), encoded.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+NODE_BENCHMARK(BM_Base64Decode)->Range(16, 1 << 20, 64);
+
+// Line breaks, as in PEM data, which the vectorized kernels hand back to
+// the scalar code.
+static void BM_Base64DecodeWithLineBreaks(State& state) {
+  std::string input = Input(state.range());
+  std::string encoded(node::base64_encoded_size(input.size()), '\0');
+  node::base64_encode(input.data(), input.size(), &encoded[0], encoded.size());
+  for (size_t i = 64; i < encoded.size(); i += 65) encoded.insert(i, "\n");
+  std::string output(input.size(), '\0');
+  for (auto _ : state) {
+    DoNotOptimize(node::base64_decode(
+        &output[0], output.size(), encoded.data(), encoded.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+NODE_BENCHMARK(BM_Base64DecodeWithLineBreaks)->Arg(64 * 1024);
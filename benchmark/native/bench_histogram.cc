@@ -0,0 +1,56 @@
+#include "histogram-inl.h"
+#include "native_benchmark.h"
+
+#include <vector>
+
+using node::Histogram;
+using node::bench::DoNotOptimize;
+using node::bench::State;
+
+namespace {
+
+// Pseudo-random latencies between 1us and 10ms, in nanoseconds.
+std::vector<int64_t> Values() {
+  std::vector<int64_t> values(4096);
+  uint64_t x = 88172645463325252ull;
+  for (int64_t& value : values) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    value = 1000 + static_cast<int64_t>(x % 10000000);
+  }
+  return values;
+}
+
+void Record(State& state, bool concurrent) {
+  Histogram::Options options;
+  options.concurrent = concurrent;
+  Histogram histogram(options);
+  std::vector<int64_t> values = Values();
+  size_t i = 0;
+  for (auto _ : state) {
+    histogram.Record(values[i++ & (values.size() - 1)]);
+  }
+  DoNotOptimize(histogram.Count());
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // anonymous namespace
+
+static void BM_HistogramRecord(State& state) {
+  Record(state, false);
+}
+NODE_BENCHMARK(BM_HistogramRecord);
+
+static void BM_HistogramRecordConcurrent(State& state) {
+  Record(state, true);
+}
+NODE_BENCHMARK(BM_HistogramRecordConcurrent);
+
+static void BM_HistogramPercentile(State& state) {
+  Histogram histogram(Histogram::Options {});
+  for (int64_t value : Values()) histogram.Record(value);
+  for (auto _ : state) DoNotOptimize(histogram.Percentile(99));
+  state.SetItemsProcessed(state.iterations());
+}
+NODE_BENCHMARK(BM_HistogramPercentile);
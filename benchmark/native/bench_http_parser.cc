@@ -0,0 +1,89 @@
+#include "llhttp.h"
+#include "native_benchmark.h"
+
+#include <string>
+
+using node::bench::DoNotOptimize;
+using node::bench::State;
+
+namespace {
+
+// Counts what Parser in node_http_parser.cc gets called back for, with
+// callbacks that do about as little.
+struct Counts {
+  size_t headers = 0;
+  size_t body = 0;
+  size_t messages = 0;
+};
+
+void Execute(State& state, llhttp_type_t type, const std::string& message) {
+  llhttp_settings_t settings;
+  llhttp_settings_init(&settings);
+  settings.on_header_field = [](llhttp_t* parser, const char*, size_t) {
+    static_cast<Counts*>(parser->data)->headers++;
+    return 0;
+  };
+  settings.on_body = [](llhttp_t* parser, const char*, size_t length) {
+    static_cast<Counts*>(parser->data)->body += length;
+    return 0;
+  };
+  settings.on_message_complete = [](llhttp_t* parser) {
+    static_cast<Counts*>(parser->data)->messages++;
+    return 0;
+  };
+
+  // Parsed as one stream of keep-alive messages, as on a busy connection.
+  llhttp_t parser;
+  llhttp_init(&parser, type, &settings);
+  Counts counts;
+  parser.data = &counts;
+  for (auto _ : state) {
+    if (llhttp_execute(&parser, message.data(), message.size()) !=
+        HPE_OK) {
+      return state.SkipWithError(llhttp_get_error_reason(&parser));
+    }
+  }
+  DoNotOptimize(counts);
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+
+}  // anonymous namespace
+
+static void BM_HttpParseRequest(State& state) {
+  Execute(state, HTTP_REQUEST,
+          "GET /api/v1/items?id=42 HTTP/1.1\r\n"
+          "Host: example.org\r\n"
+          "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+          "Accept: text/html,application/xhtml+xml,application/xml\r\n"
+          "Accept-Encoding: gzip, deflate, br\r\n"
+          "Accept-Language: en-US,en;q=0.9\r\n"
+          "Cookie: session=0123456789abcdef; theme=dark\r\n"
+          "Connection: keep-alive\r\n"
+          "\r\n");
+}
+NODE_BENCHMARK(BM_HttpParseRequest);
+
+static void BM_HttpParseResponse(State& state) {
+  std::string body(state.range(), 'x');
+  Execute(state, HTTP_RESPONSE,
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Type: application/json\r\n"
+          "Content-Length: " + std::to_string(body.size()) + "\r\n"
+          "Cache-Control: no-cache\r\n"
+          "Date: Wed, 14 Oct 2026 10:00:00 GMT\r\n"
+          "\r\n" + body);
+}
+NODE_BENCHMARK(BM_HttpParseResponse)->Range(16, 64 * 1024, 64);
+
+static void BM_HttpParseChunked(State& state) {
+  std::string message =
+      "HTTP/1.1 200 OK\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n";
+  for (int i = 0; i < 16; i++) message += "100\r\n" + std::string(256, 'x') +
+                                          "\r\n";
+  message += "0\r\n\r\n";
+  Execute(state, HTTP_RESPONSE, message);
+}
+NODE_BENCHMARK(BM_HttpParseChunked);
@@ -0,0 +1,60 @@
+#include "native_benchmark.h"
+#include "node_sockaddr-inl.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using node::SocketAddress;
+using node::SocketAddressBlockList;
+using node::bench::DoNotOptimize;
+using node::bench::State;
+
+namespace {
+
+std::shared_ptr<SocketAddress> Address(int family, const std::string& host) {
+  sockaddr_storage storage;
+  CHECK(SocketAddress::ToSockAddr(family, host.c_str(), 0, &storage));
+  return std::make_shared<SocketAddress>(
+      reinterpret_cast<const sockaddr*>(&storage));
+}
+
+// A block list of state.range() rules, /24 subnets, single addresses and
+// ranges in turn, none of which match the address that is checked, so that
+// every rule is tried.
+void Apply(State& state, int family, const std::string& checked) {
+  SocketAddressBlockList block_list;
+  for (int64_t i = 0; i < state.range(); i++) {
+    std::string prefix = family == AF_INET
+        ? "10." + std::to_string(i / 256) + "." + std::to_string(i % 256) + "."
+        : "fd00::" + std::to_string(i % 10000) + ":";
+    switch (i % 3) {
+      case 0:
+        block_list.AddSocketAddressMask(Address(family, prefix + "0"),
+                                        family == AF_INET ? 24 : 112);
+        break;
+      case 1:
+        block_list.AddSocketAddress(Address(family, prefix + "1"));
+        break;
+      case 2:
+        block_list.AddSocketAddressRange(Address(family, prefix + "1"),
+                                         Address(family, prefix + "9"));
+        break;
+    }
+  }
+  std::shared_ptr<SocketAddress> address = Address(family, checked);
+  for (auto _ : state) DoNotOptimize(block_list.Apply(address));
+  state.SetItemsProcessed(state.iterations() * state.range());
+}
+
+}  // anonymous namespace
+
+static void BM_BlockListApplyIPv4(State& state) {
+  Apply(state, AF_INET, "192.168.0.1");
+}
+NODE_BENCHMARK(BM_BlockListApplyIPv4)->Range(1, 1024, 32);
+
+static void BM_BlockListApplyIPv6(State& state) {
+  Apply(state, AF_INET6, "2001:db8::1");
+}
+NODE_BENCHMARK(BM_BlockListApplyIPv6)->Range(1, 1024, 32);
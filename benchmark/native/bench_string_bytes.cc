@@ -0,0 +1,89 @@
+#include "native_benchmark.h"
+#include "string_bytes.h"
+#include "util-inl.h"
+
+#include <string>
+
+using node::StringBytes;
+using node::bench::DoNotOptimize;
+using node::bench::GetIsolate;
+using node::bench::State;
+using v8::Context;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::String;
+using v8::Value;
+
+namespace {
+
+// Encodes state.range() bytes of `fill` as `encoding`.
+void Encode(State& state, char fill, node::encoding encoding) {
+  Isolate* isolate = GetIsolate();
+  HandleScope handle_scope(isolate);
+  Local<Context> context = Context::New(isolate);
+  Context::Scope context_scope(context);
+  std::string input(state.range(), fill);
+  for (auto _ : state) {
+    HandleScope iteration_scope(isolate);
+    Local<Value> error;
+    Local<Value> value;
+    if (!StringBytes::Encode(
+            isolate, input.data(), input.size(), encoding, &error)
+            .ToLocal(&value)) {
+      return state.SkipWithError("StringBytes::Encode() failed");
+    }
+    DoNotOptimize(value);
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+// Writes a string of state.range() characters of `fill` as `encoding`.
+void Write(State& state, char fill, node::encoding encoding) {
+  Isolate* isolate = GetIsolate();
+  HandleScope handle_scope(isolate);
+  Local<Context> context = Context::New(isolate);
+  Context::Scope context_scope(context);
+  std::string input(state.range(), fill);
+  Local<String> string =
+      String::NewFromUtf8(isolate, input.data(), v8::NewStringType::kNormal,
+                          input.size()).ToLocalChecked();
+  std::string output(input.size() * 3, '\0');
+  for (auto _ : state) {
+    DoNotOptimize(StringBytes::Write(
+        isolate, &output[0], output.size(), string, encoding));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+}  // anonymous namespace
+
+static void BM_StringBytesEncodeUtf8(State& state) {
+  Encode(state, 'a', node::UTF8);
+}
+NODE_BENCHMARK(BM_StringBytesEncodeUtf8)->Range(16, 1 << 20, 64);
+
+static void BM_StringBytesEncodeLatin1(State& state) {
+  Encode(state, '\xe9', node::LATIN1);
+}
+NODE_BENCHMARK(BM_StringBytesEncodeLatin1)->Range(16, 1 << 20, 64);
+
+static void BM_StringBytesEncodeHex(State& state) {
+  Encode(state, 'a', node::HEX);
+}
+NODE_BENCHMARK(BM_StringBytesEncodeHex)->Range(16, 1 << 20, 64);
+
+static void BM_StringBytesEncodeBase64(State& state) {
+  Encode(state, 'a', node::BASE64);
+}
+NODE_BENCHMARK(BM_StringBytesEncodeBase64)->Range(16, 1 << 20, 64);
+
+static void BM_StringBytesWriteUtf8(State& state) {
+  Write(state, 'a', node::UTF8);
+}
+NODE_BENCHMARK(BM_StringBytesWriteUtf8)->Range(16, 1 << 20, 64);
+
+static void BM_StringBytesWriteUcs2(State& state) {
+  Write(state, 'a', node::UCS2);
+}
+NODE_BENCHMARK(BM_StringBytesWriteUcs2)->Range(16, 1 << 20, 64);
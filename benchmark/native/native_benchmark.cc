@@ -0,0 +1,371 @@
+#include "native_benchmark.h"
+#include "json_utils.h"
+#include "node.h"
+#include "node_version.h"
+#include "util-inl.h"
+#include "uv.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <regex>
+#include <sstream>
+
+namespace node {
+namespace bench {
+
+using v8::Isolate;
+using v8::V8;
+
+namespace {
+
+std::vector<std::unique_ptr<Benchmark>>* benchmarks() {
+  static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+  return &benchmarks;
+}
+
+uint64_t CpuTimeNs() {
+  uv_rusage_t usage;
+  if (uv_getrusage(&usage) != 0) return 0;
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ull +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ull;
+}
+
+struct Options {
+  std::string filter = ".";
+  double min_time = 0.5;  // Seconds per repetition.
+  int repetitions = 3;
+  bool json = false;
+};
+
+struct Run {
+  std::string name;
+  uint64_t iterations;
+  double real_time;  // Nanoseconds per iteration.
+  double cpu_time;
+  double bytes_per_second;
+  double items_per_second;
+  std::string error;
+};
+
+State RunOnce(const Benchmark& benchmark, int64_t arg, uint64_t iterations) {
+  State state(iterations, arg);
+  benchmark.function()(state);
+  return state;
+}
+
+Run ToRun(const std::string& name, const State& state) {
+  Run run;
+  run.name = name;
+  run.iterations = state.iterations();
+  run.real_time = static_cast<double>(state.real_time_ns()) /
+                  state.iterations();
+  run.cpu_time = static_cast<double>(state.cpu_time_ns()) /
+                 state.iterations();
+  double seconds = std::max(state.real_time_ns(), uint64_t{1}) / 1e9;
+  run.bytes_per_second = state.bytes_processed() / seconds;
+  run.items_per_second = state.items_processed() / seconds;
+  run.error = state.error();
+  return run;
+}
+
+// Finds the number of iterations that takes about `min_time`, like Google
+// Benchmark does, so that the repetitions all run the same number of them.
+uint64_t Calibrate(const Benchmark& benchmark,
+                   int64_t arg,
+                   double min_time,
+                   std::string* error) {
+  uint64_t iterations = 1;
+  static constexpr uint64_t kMaxIterations = 1000000000;
+  while (true) {
+    State state = RunOnce(benchmark, arg, iterations);
+    if (!state.error().empty()) {
+      *error = state.error();
+      return 0;
+    }
+    double seconds = state.real_time_ns() / 1e9;
+    if (seconds >= min_time || iterations >= kMaxIterations)
+      return iterations;
+    double multiplier = seconds <= 0 ? 10 : min_time * 1.4 / seconds;
+    multiplier = std::min(10.0, std::max(2.0, multiplier));
+    if (seconds / min_time > 0.1) {
+      // Close enough to estimate the number directly.
+      return std::min(kMaxIterations,
+                      static_cast<uint64_t>(iterations * min_time / seconds));
+    }
+    iterations = std::min(kMaxIterations,
+                          static_cast<uint64_t>(iterations * multiplier));
+  }
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  if (values.size() % 2 == 1) return values[middle];
+  return (values[middle - 1] + values[middle]) / 2;
+}
+
+void WriteRun(JSONWriter* writer,
+              const Run& run,
+              const char* run_type,
+              int repetitions,
+              int repetition_index,
+              const char* aggregate_name) {
+  writer->json_start();
+  writer->json_keyvalue("name", aggregate_name == nullptr
+                                    ? run.name
+                                    : run.name + "_" + aggregate_name);
+  writer->json_keyvalue("run_name", run.name);
+  writer->json_keyvalue("run_type", run_type);
+  writer->json_keyvalue("repetitions", repetitions);
+  if (aggregate_name == nullptr)
+    writer->json_keyvalue("repetition_index", repetition_index);
+  else
+    writer->json_keyvalue("aggregate_name", aggregate_name);
+  if (!run.error.empty()) {
+    writer->json_keyvalue("error_occurred", true);
+    writer->json_keyvalue("error_message", run.error);
+  }
+  writer->json_keyvalue("iterations", run.iterations);
+  writer->json_keyvalue("real_time", run.real_time);
+  writer->json_keyvalue("cpu_time", run.cpu_time);
+  writer->json_keyvalue("time_unit", "ns");
+  if (run.bytes_per_second > 0)
+    writer->json_keyvalue("bytes_per_second", run.bytes_per_second);
+  if (run.items_per_second > 0)
+    writer->json_keyvalue("items_per_second", run.items_per_second);
+  writer->json_end();
+}
+
+void PrintRun(const Run& run, const char* aggregate_name) {
+  std::string name = run.name;
+  if (aggregate_name != nullptr) name += std::string("_") + aggregate_name;
+  if (!run.error.empty()) {
+    fprintf(stderr, "%-48s ERROR: %s\n", name.c_str(), run.error.c_str());
+    return;
+  }
+  fprintf(stdout, "%-48s %14.1f ns %14.1f ns %12" PRIu64,
+          name.c_str(), run.real_time, run.cpu_time, run.iterations);
+  if (run.bytes_per_second > 0)
+    fprintf(stdout, " %10.1f MiB/s", run.bytes_per_second / (1 << 20));
+  if (run.items_per_second > 0)
+    fprintf(stdout, " %10.1f k/s", run.items_per_second / 1000);
+  fprintf(stdout, "\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    auto value = [&](const char* name) -> const char* {
+      size_t length = strlen(name);
+      if (arg.compare(0, length, name) == 0 && arg[length] == '=')
+        return argv[i] + length + 1;
+      return nullptr;
+    };
+    if (const char* filter = value("--filter")) {
+      options->filter = filter;
+    } else if (const char* min_time = value("--min-time")) {
+      options->min_time = atof(min_time);
+    } else if (const char* repetitions = value("--repetitions")) {
+      options->repetitions = std::max(1, atoi(repetitions));
+    } else if (const char* format = value("--format")) {
+      options->json = strcmp(format, "json") == 0;
+      if (!options->json && strcmp(format, "console") != 0) return false;
+    } else {
+      return false;
+    }
+  }
+  return options->min_time > 0;
+}
+
+}  // anonymous namespace
+
+void State::StartTimer() {
+  if (running_) return;
+  running_ = true;
+  cpu_start_ns_ = CpuTimeNs();
+  real_start_ns_ = uv_hrtime();
+}
+
+void State::StopTimer() {
+  if (!running_) return;
+  real_time_ns_ += uv_hrtime() - real_start_ns_;
+  cpu_time_ns_ += CpuTimeNs() - cpu_start_ns_;
+  running_ = false;
+}
+
+Benchmark* Benchmark::Range(int64_t start, int64_t limit, int multiplier) {
+  CHECK_GT(start, 0);
+  CHECK_GT(multiplier, 1);
+  for (int64_t arg = start; arg < limit; arg *= multiplier) Arg(arg);
+  return Arg(limit);
+}
+
+Benchmark* Register(const char* name, Benchmark::Function function) {
+  benchmarks()->emplace_back(new Benchmark(name, function));
+  return benchmarks()->back().get();
+}
+
+#if !defined(__GNUC__)
+void UseCharPointer(const volatile char* pointer) {}
+#endif
+
+Isolate* GetIsolate() {
+  static Isolate* isolate = nullptr;
+  if (isolate != nullptr) return isolate;
+  static std::unique_ptr<MultiIsolatePlatform> platform =
+      MultiIsolatePlatform::Create(2);
+  static uv_loop_t loop;
+  V8::InitializePlatform(platform.get());
+  V8::Initialize();
+  CHECK_EQ(uv_loop_init(&loop), 0);
+  isolate = NewIsolate(ArrayBufferAllocator::Create(), &loop, platform.get());
+  CHECK_NOT_NULL(isolate);
+  isolate->Enter();
+  return isolate;
+}
+
+int Main(int argc, char** argv) {
+  argv = uv_setup_args(argc, argv);
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    fprintf(stderr,
+            "Usage: %s [--filter=<regex>] [--min-time=<seconds>] "
+            "[--repetitions=<n>] [--format=console|json]\n",
+            argv[0]);
+    return 1;
+  }
+
+  // For the ICU data, and everything else the URL parser and the other
+  // kernels expect to be set up.
+  std::vector<std::string> node_argv { argv[0] };
+  std::vector<std::string> exec_argv;
+  std::vector<std::string> errors;
+  int exit_code = InitializeNodeWithArgs(&node_argv, &exec_argv, &errors);
+  for (const std::string& error : errors)
+    fprintf(stderr, "%s: %s\n", argv[0], error.c_str());
+  if (exit_code != 0) return exit_code;
+
+  std::regex filter(options.filter);
+  std::ostringstream json_out;
+  json_out << std::setprecision(std::numeric_limits<double>::digits10);
+  JSONWriter writer(json_out, false);
+  writer.json_start();
+  writer.json_objectstart("context");
+  char date[64];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+  writer.json_keyvalue("date", date);
+  char host_name[256];
+  size_t host_name_size = sizeof(host_name);
+  if (uv_os_gethostname(host_name, &host_name_size) == 0)
+    writer.json_keyvalue("host_name", host_name);
+  writer.json_keyvalue("executable", argv[0]);
+  uv_cpu_info_t* cpu_infos;
+  int cpu_count;
+  if (uv_cpu_info(&cpu_infos, &cpu_count) == 0) {
+    writer.json_keyvalue("num_cpus", cpu_count);
+    if (cpu_count > 0) writer.json_keyvalue("mhz_per_cpu", cpu_infos[0].speed);
+    uv_free_cpu_info(cpu_infos, cpu_count);
+  }
+#ifdef DEBUG
+  writer.json_keyvalue("library_build_type", "debug");
+#else
+  writer.json_keyvalue("library_build_type", "release");
+#endif
+  writer.json_keyvalue("node_version", NODE_VERSION);
+  writer.json_objectend();
+  writer.json_arraystart("benchmarks");
+
+  if (!options.json) {
+    fprintf(stdout, "%-48s %17s %17s %12s\n",
+            "Benchmark", "Time", "CPU", "Iterations");
+  }
+
+  bool failed = false;
+  for (const std::unique_ptr<Benchmark>& benchmark : *benchmarks()) {
+    std::vector<int64_t> args = benchmark->args();
+    if (args.empty()) args.push_back(0);
+    for (int64_t arg : args) {
+      std::string name = benchmark->name();
+      if (!benchmark->args().empty()) name += "/" + std::to_string(arg);
+      if (!std::regex_search(name, filter)) continue;
+
+      std::string error;
+      uint64_t iterations =
+          Calibrate(*benchmark, arg, options.min_time, &error);
+      std::vector<Run> runs;
+      if (iterations == 0) {
+        Run run {name, 0, 0, 0, 0, 0, error};
+        runs.push_back(run);
+      } else {
+        for (int i = 0; i < options.repetitions; i++)
+          runs.push_back(ToRun(name, RunOnce(*benchmark, arg, iterations)));
+      }
+
+      const int repetitions = static_cast<int>(runs.size());
+      for (int i = 0; i < repetitions; i++) {
+        failed = failed || !runs[i].error.empty();
+        if (options.json)
+          WriteRun(&writer, runs[i], "iteration", repetitions, i, nullptr);
+        else
+          PrintRun(runs[i], nullptr);
+      }
+      if (repetitions < 2) continue;
+
+      // The median is the most stable one to track over time.
+      auto aggregate = [&](const char* aggregate_name, auto function) {
+        Run result = runs[0];
+        auto values = [&](double Run::*field) {
+          std::vector<double> out;
+          for (const Run& run : runs) out.push_back(run.*field);
+          return out;
+        };
+        result.real_time = function(values(&Run::real_time));
+        result.cpu_time = function(values(&Run::cpu_time));
+        result.bytes_per_second = function(values(&Run::bytes_per_second));
+        result.items_per_second = function(values(&Run::items_per_second));
+        if (options.json) {
+          WriteRun(&writer, result, "aggregate", repetitions, 0,
+                   aggregate_name);
+        } else {
+          PrintRun(result, aggregate_name);
+        }
+      };
+      aggregate("mean", [](const std::vector<double>& values) {
+        double sum = 0;
+        for (double value : values) sum += value;
+        return sum / values.size();
+      });
+      aggregate("median", Median);
+      aggregate("stddev", [](const std::vector<double>& values) {
+        double sum = 0;
+        for (double value : values) sum += value;
+        double mean = sum / values.size();
+        double squares = 0;
+        for (double value : values) squares += (value - mean) * (value - mean);
+        return std::sqrt(squares / (values.size() - 1));
+      });
+    }
+  }
+
+  writer.json_arrayend();
+  writer.json_end();
+  if (options.json) std::cout << json_out.str() << std::endl;
+  return failed ? 1 : 0;
+}
+
+}  // namespace bench
+}  // namespace node
+
+int main(int argc, char** argv) {
+  return node::bench::Main(argc, argv);
+}
@@ -0,0 +1,162 @@
+#ifndef BENCHMARK_NATIVE_NATIVE_BENCHMARK_H_
+#define BENCHMARK_NATIVE_NATIVE_BENCHMARK_H_
+
+#include "v8.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small microbenchmark harness for the C++ internals, modelled on Google
+// Benchmark, which is not in deps/, so that it can be swapped in later with
+// few changes to the benchmarks themselves. Each benchmark runs its loop
+// body for as many iterations as fit into --min-time, and reports the time
+// per iteration:
+//
+//   static void BM_Base64Encode(node::bench::State& state) {
+//     std::string input(state.range(), 'a');
+//     std::string output(node::base64_encoded_size(input.size()), '\0');
+//     for (auto _ : state) {
+//       node::bench::DoNotOptimize(
+//           node::base64_encode(input.data(), input.size(),
+//                               &output[0], output.size()));
+//     }
+//     state.SetBytesProcessed(state.iterations() * input.size());
+//   }
+//   NODE_BENCHMARK(BM_Base64Encode)->Arg(64)->Arg(64 * 1024);
+//
+// `out/Release/native_benchmark --format=json` writes the results in the
+// JSON format of Google Benchmark, which its tools/compare.py reads.
+
+namespace node {
+namespace bench {
+
+class State {
+ public:
+  class Iterator {
+   public:
+    // Unused by design, as the `_` of `for (auto _ : state)`.
+#if defined(__GNUC__)
+    struct __attribute__((unused)) Value {};
+#else
+    struct Value {};
+#endif
+
+    Value operator*() const { return Value(); }
+    Iterator& operator++() {
+      remaining_--;
+      return *this;
+    }
+    bool operator!=(const Iterator&) {
+      if (remaining_ != 0) return true;
+      state_->StopTimer();
+      return false;
+    }
+
+   private:
+    friend class State;
+    Iterator(State* state, uint64_t remaining)
+        : state_(state), remaining_(remaining) {}
+
+    State* state_;
+    uint64_t remaining_;
+  };
+
+  State(uint64_t iterations, int64_t range)
+      : iterations_(iterations), range_(range) {}
+
+  // The timer only runs while the loop does.
+  Iterator begin() {
+    StartTimer();
+    return Iterator(this, iterations_);
+  }
+  Iterator end() { return Iterator(this, 0); }
+
+  // For setup within the loop that should not count.
+  void PauseTiming() { StopTimer(); }
+  void ResumeTiming() { StartTimer(); }
+
+  int64_t range() const { return range_; }
+  uint64_t iterations() const { return iterations_; }
+
+  void SetBytesProcessed(uint64_t bytes) { bytes_processed_ = bytes; }
+  void SetItemsProcessed(uint64_t items) { items_processed_ = items; }
+  // Marks the run as failed, e.g. when its setup does not work.
+  void SkipWithError(const char* error) { error_ = error; }
+
+  uint64_t real_time_ns() const { return real_time_ns_; }
+  uint64_t cpu_time_ns() const { return cpu_time_ns_; }
+  uint64_t bytes_processed() const { return bytes_processed_; }
+  uint64_t items_processed() const { return items_processed_; }
+  const std::string& error() const { return error_; }
+
+ private:
+  void StartTimer();
+  void StopTimer();
+
+  const uint64_t iterations_;
+  const int64_t range_;
+  uint64_t real_time_ns_ = 0;
+  uint64_t cpu_time_ns_ = 0;
+  uint64_t real_start_ns_ = 0;
+  uint64_t cpu_start_ns_ = 0;
+  bool running_ = false;
+  uint64_t bytes_processed_ = 0;
+  uint64_t items_processed_ = 0;
+  std::string error_;
+};
+
+class Benchmark {
+ public:
+  using Function = void (*)(State& state);
+
+  Benchmark(const char* name, Function function)
+      : name_(name), function_(function) {}
+
+  // Runs the benchmark once for each argument, as state.range().
+  Benchmark* Arg(int64_t arg) {
+    args_.push_back(arg);
+    return this;
+  }
+  // Arguments from `start` to `limit`, multiplying by `multiplier`.
+  Benchmark* Range(int64_t start, int64_t limit, int multiplier = 8);
+
+  const std::string& name() const { return name_; }
+  Function function() const { return function_; }
+  const std::vector<int64_t>& args() const { return args_; }
+
+ private:
+  std::string name_;
+  Function function_;
+  std::vector<int64_t> args_;
+};
+
+Benchmark* Register(const char* name, Benchmark::Function function);
+
+#define NODE_BENCHMARK(function)                                              \
+  static node::bench::Benchmark* const function##_benchmark_ =                \
+      node::bench::Register(#function, function)
+
+#if !defined(__GNUC__)
+void UseCharPointer(const volatile char* pointer);
+#endif
+
+// Keeps the compiler from optimizing away the computation of `value`.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  UseCharPointer(&reinterpret_cast<const volatile char&>(value));
+#endif
+}
+
+// An isolate for the benchmarks that need one, e.g. to create strings. It
+// is created on first use and entered for the rest of the process.
+v8::Isolate* GetIsolate();
+
+}  // namespace bench
+}  // namespace node
+
+#endif  // BENCHMARK_NATIVE_NATIVE_BENCHMARK_H_
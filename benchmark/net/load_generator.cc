@@ -0,0 +1,736 @@
+// A load generator for the network benchmarks in this directory, written
+// against libuv so that its own overhead stays small and constant across
+// Node.js versions, unlike that of tools that run on Node.js themselves.
+//
+//   out/Release/load_generator --mode=http1 --port=8000 --connections=50
+//       --pipelining=10 --duration=10 --warmup=2
+//
+// Modes:
+//   http1     GET requests over keep-alive connections, with up to
+//             --pipelining requests in flight on each.
+//   http2     GET requests over cleartext HTTP/2 (prior knowledge), with up
+//             to --pipelining concurrent streams on each connection.
+//   tls       Full TLS handshakes, one connection after the other on each of
+//             --connections slots. A handshake counts as a request, from the
+//             TCP connect to its completion. Sessions are not resumed.
+//   tcp-echo  Messages of --size bytes, with up to --pipelining in flight on
+//             each connection, each complete once as many bytes came back.
+//
+// Nothing is measured during --warmup. Then, for --duration seconds, the
+// latency of each request is recorded in an HdrHistogram, in microseconds.
+// The result is written to stdout as a single JSON object. --host must be a
+// numeric IPv4 or IPv6 address.
+
+#include "hdr_histogram.h"
+#include "llhttp.h"
+#include "nghttp2/nghttp2.h"
+#include "uv.h"
+
+#if HAVE_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+enum class Mode { kHttp1, kHttp2, kTls, kTcpEcho };
+
+struct Options {
+  Mode mode = Mode::kHttp1;
+  std::string mode_name = "http1";
+  std::string host = "127.0.0.1";
+  int port = 0;
+  size_t connections = 10;
+  size_t pipelining = 1;
+  double duration = 10;
+  double warmup = 1;
+  std::string path = "/";
+  size_t size = 64;
+  std::string servername;
+};
+
+class Connection;
+
+// The state of a run, shared by all connections.
+class LoadGenerator {
+ public:
+  LoadGenerator(uv_loop_t* loop, const Options& options);
+  ~LoadGenerator();
+
+  bool Init();
+  void Start();
+  void PrintResult() const;
+
+  // Records a request that was sent at `start` and has just completed.
+  void Record(uint64_t start) {
+    if (!measuring_) return;
+    requests_++;
+    hdr_record_value(latency_, (uv_hrtime() - start) / 1000);
+  }
+  void CountError() {
+    if (measuring_) errors_++;
+  }
+  void CountNon2xx() {
+    if (measuring_) non2xx_++;
+  }
+  void CountRead(size_t bytes) {
+    if (measuring_) bytes_read_ += bytes;
+  }
+  void CountWritten(size_t bytes) {
+    if (measuring_) bytes_written_ += bytes;
+  }
+
+  void OnConnectionClosed(Connection* connection);
+
+  bool running() const { return running_; }
+  uv_loop_t* loop() const { return loop_; }
+  const Options& options() const { return options_; }
+  const std::string& http1_request() const { return http1_request_; }
+  const std::string& echo_message() const { return echo_message_; }
+  const nghttp2_session_callbacks* http2_callbacks() const {
+    return http2_callbacks_;
+  }
+#if HAVE_OPENSSL
+  SSL_CTX* tls_context() const { return tls_context_; }
+#endif
+
+ private:
+  void Connect();
+  void OnTimer();
+
+  uv_loop_t* const loop_;
+  const Options options_;
+  sockaddr_storage address_;
+  uv_timer_t timer_;
+  std::unordered_set<Connection*> connections_;
+  bool running_ = false;
+  bool measuring_ = false;
+
+  std::string http1_request_;
+  std::string echo_message_;
+  nghttp2_session_callbacks* http2_callbacks_ = nullptr;
+#if HAVE_OPENSSL
+  SSL_CTX* tls_context_ = nullptr;
+#endif
+
+  hdr_histogram* latency_ = nullptr;
+  uint64_t measure_start_ = 0;
+  uint64_t measure_end_ = 0;
+  uint64_t requests_ = 0;
+  uint64_t errors_ = 0;
+  uint64_t non2xx_ = 0;
+  uint64_t connects_ = 0;
+  uint64_t bytes_read_ = 0;
+  uint64_t bytes_written_ = 0;
+};
+
+// A TCP connection that deletes itself once it is closed, after which the
+// LoadGenerator opens another one while the run is going on.
+class Connection {
+ public:
+  explicit Connection(LoadGenerator* generator) : generator_(generator) {
+    handle_.data = this;
+  }
+  virtual ~Connection() = default;
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  int Connect(const sockaddr* address);
+  void Close();
+  // Ends the connection cleanly once pending writes are done.
+  void Shutdown();
+
+ protected:
+  virtual void OnConnect() = 0;
+  virtual void OnRead(const char* data, size_t length) = 0;
+
+  void Write(const char* data, size_t length);
+  void Fail() {
+    generator_->CountError();
+    Close();
+  }
+  bool closing() const { return closing_; }
+
+  LoadGenerator* const generator_;
+
+ private:
+  struct WriteReq {
+    uv_write_t req;
+    std::string data;
+  };
+
+  uv_tcp_t handle_;
+  uv_connect_t connect_req_;
+  uv_shutdown_t shutdown_req_;
+  bool closing_ = false;
+  char buffer_[64 * 1024];
+};
+
+int Connection::Connect(const sockaddr* address) {
+  int err = uv_tcp_init(generator_->loop(), &handle_);
+  if (err != 0) return err;
+  uv_tcp_nodelay(&handle_, 1);
+  err = uv_tcp_connect(&connect_req_, &handle_, address,
+                       [](uv_connect_t* req, int status) {
+    Connection* connection = static_cast<Connection*>(req->handle->data);
+    if (status == UV_ECANCELED) return;
+    if (status != 0) return connection->Fail();
+
+    auto on_alloc = [](uv_handle_t* handle, size_t, uv_buf_t* buf) {
+      Connection* connection = static_cast<Connection*>(handle->data);
+      *buf = uv_buf_init(connection->buffer_, sizeof(connection->buffer_));
+    };
+    auto on_read = [](uv_stream_t* stream,
+                      ssize_t nread,
+                      const uv_buf_t* buf) {
+      Connection* connection = static_cast<Connection*>(stream->data);
+      if (nread == UV_EOF) return connection->Close();
+      if (nread < 0) return connection->Fail();
+      connection->generator_->CountRead(nread);
+      connection->OnRead(buf->base, nread);
+    };
+    if (uv_read_start(req->handle, on_alloc, on_read) != 0)
+      return connection->Fail();
+    connection->OnConnect();
+  });
+  // The handle is initialized, so it has to be closed rather than deleted.
+  if (err != 0) Fail();
+  return 0;
+}
+
+void Connection::Close() {
+  if (closing_) return;
+  closing_ = true;
+  uv_close(reinterpret_cast<uv_handle_t*>(&handle_), [](uv_handle_t* handle) {
+    Connection* connection = static_cast<Connection*>(handle->data);
+    connection->generator_->OnConnectionClosed(connection);
+  });
+}
+
+void Connection::Shutdown() {
+  if (closing_) return;
+  int err = uv_shutdown(&shutdown_req_,
+                        reinterpret_cast<uv_stream_t*>(&handle_),
+                        [](uv_shutdown_t* req, int status) {
+    static_cast<Connection*>(req->handle->data)->Close();
+  });
+  if (err != 0) Close();
+}
+
+void Connection::Write(const char* data, size_t length) {
+  if (closing_ || length == 0) return;
+  generator_->CountWritten(length);
+  WriteReq* write = new WriteReq();
+  write->req.data = write;
+  write->data.assign(data, length);
+  uv_buf_t buf = uv_buf_init(&write->data[0], length);
+  int err = uv_write(&write->req,
+                     reinterpret_cast<uv_stream_t*>(&handle_),
+                     &buf,
+                     1,
+                     [](uv_write_t* req, int status) {
+    Connection* connection = static_cast<Connection*>(req->handle->data);
+    delete static_cast<WriteReq*>(req->data);
+    if (status != 0 && status != UV_ECANCELED) connection->Fail();
+  });
+  if (err != 0) {
+    delete write;
+    Fail();
+  }
+}
+
+class Http1Connection final : public Connection {
+ public:
+  explicit Http1Connection(LoadGenerator* generator)
+      : Connection(generator) {
+    static llhttp_settings_t settings = [] {
+      llhttp_settings_t settings;
+      llhttp_settings_init(&settings);
+      settings.on_headers_complete = [](llhttp_t* parser) {
+        if (parser->status_code < 200 || parser->status_code > 299)
+          static_cast<Http1Connection*>(parser->data)->generator_->
+              CountNon2xx();
+        return 0;
+      };
+      settings.on_message_complete = [](llhttp_t* parser) {
+        return static_cast<Http1Connection*>(parser->data)->OnResponse();
+      };
+      return settings;
+    }();
+    llhttp_init(&parser_, HTTP_RESPONSE, &settings);
+    parser_.data = this;
+  }
+
+ protected:
+  void OnConnect() override {
+    for (size_t i = 0; i < generator_->options().pipelining; i++) Send();
+  }
+
+  void OnRead(const char* data, size_t length) override {
+    if (llhttp_execute(&parser_, data, length) != HPE_OK) return Fail();
+    // The server is done with this connection, so open another one.
+    if (!keep_alive_) Close();
+  }
+
+ private:
+  void Send() {
+    sent_.push_back(uv_hrtime());
+    const std::string& request = generator_->http1_request();
+    Write(request.data(), request.size());
+  }
+
+  int OnResponse() {
+    // A response to nothing must be a confused peer.
+    if (sent_.empty()) return -1;
+    generator_->Record(sent_.front());
+    sent_.pop_front();
+    keep_alive_ = llhttp_should_keep_alive(&parser_);
+    if (keep_alive_ && generator_->running()) Send();
+    return 0;
+  }
+
+  llhttp_t parser_;
+  std::deque<uint64_t> sent_;  // When the pending requests were sent.
+  bool keep_alive_ = true;
+};
+
+class Http2Connection final : public Connection {
+ public:
+  using Connection::Connection;
+
+  ~Http2Connection() override {
+    if (session_ != nullptr) nghttp2_session_del(session_);
+  }
+
+  static nghttp2_session_callbacks* CreateCallbacks() {
+    nghttp2_session_callbacks* callbacks;
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) return nullptr;
+    nghttp2_session_callbacks_set_on_header_callback(
+        callbacks,
+        [](nghttp2_session*, const nghttp2_frame*,
+           const uint8_t* name, size_t name_length,
+           const uint8_t* value, size_t value_length,
+           uint8_t, void* user_data) {
+          if (name_length == 7 && memcmp(name, ":status", 7) == 0 &&
+              (value_length != 3 || value[0] != '2')) {
+            static_cast<Http2Connection*>(user_data)->generator_->
+                CountNon2xx();
+          }
+          return 0;
+        });
+    nghttp2_session_callbacks_set_on_stream_close_callback(
+        callbacks,
+        [](nghttp2_session*, int32_t id, uint32_t error_code,
+           void* user_data) {
+          static_cast<Http2Connection*>(user_data)->OnStreamClose(
+              id, error_code);
+          return 0;
+        });
+    return callbacks;
+  }
+
+ protected:
+  void OnConnect() override {
+    if (nghttp2_session_client_new(
+            &session_, generator_->http2_callbacks(), this) != 0) {
+      return Fail();
+    }
+    nghttp2_settings_entry settings[] = {
+      { NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, 1 << 20 }
+    };
+    nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings, 1);
+    for (size_t i = 0; i < generator_->options().pipelining; i++) Submit();
+    Flush();
+  }
+
+  void OnRead(const char* data, size_t length) override {
+    if (nghttp2_session_mem_recv(
+            session_, reinterpret_cast<const uint8_t*>(data), length) < 0) {
+      return Fail();
+    }
+    Flush();
+    // E.g. after a GOAWAY.
+    if (!nghttp2_session_want_read(session_) &&
+        !nghttp2_session_want_write(session_)) {
+      Close();
+    }
+  }
+
+ private:
+  void Submit() {
+    const Options& options = generator_->options();
+    const std::string authority =
+        options.host + ":" + std::to_string(options.port);
+    auto header = [](const char* name, const std::string& value) {
+      return nghttp2_nv {
+        reinterpret_cast<uint8_t*>(const_cast<char*>(name)),
+        reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())),
+        strlen(name),
+        value.size(),
+        NGHTTP2_NV_FLAG_NONE
+      };
+    };
+    static const std::string method = "GET";
+    static const std::string scheme = "http";
+    nghttp2_nv headers[] = {
+      header(":method", method),
+      header(":scheme", scheme),
+      header(":authority", authority),
+      header(":path", options.path)
+    };
+    int32_t id = nghttp2_submit_request(
+        session_, nullptr, headers, 4, nullptr, nullptr);
+    if (id < 0) return Fail();
+    streams_[id] = uv_hrtime();
+  }
+
+  void OnStreamClose(int32_t id, uint32_t error_code) {
+    auto it = streams_.find(id);
+    if (it == streams_.end()) return;
+    if (error_code == NGHTTP2_NO_ERROR)
+      generator_->Record(it->second);
+    else
+      generator_->CountError();
+    streams_.erase(it);
+    if (generator_->running() && !closing()) Submit();
+  }
+
+  // Writes out what the session has to send.
+  void Flush() {
+    std::string out;
+    const uint8_t* data;
+    ssize_t length;
+    while ((length = nghttp2_session_mem_send(session_, &data)) > 0)
+      out.append(reinterpret_cast<const char*>(data), length);
+    if (length < 0) return Fail();
+    Write(out.data(), out.size());
+  }
+
+  nghttp2_session* session_ = nullptr;
+  std::unordered_map<int32_t, uint64_t> streams_;  // When each was opened.
+};
+
+#if HAVE_OPENSSL
+class TlsConnection final : public Connection {
+ public:
+  explicit TlsConnection(LoadGenerator* generator)
+      : Connection(generator), start_(uv_hrtime()) {}
+
+  ~TlsConnection() override {
+    if (ssl_ != nullptr) SSL_free(ssl_);
+  }
+
+ protected:
+  void OnConnect() override {
+    ssl_ = SSL_new(generator_->tls_context());
+    if (ssl_ == nullptr) return Fail();
+    SSL_set_bio(ssl_, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+    SSL_set_connect_state(ssl_);
+    const std::string& servername = generator_->options().servername;
+    if (!servername.empty())
+      SSL_set_tlsext_host_name(ssl_, servername.c_str());
+    Handshake();
+  }
+
+  void OnRead(const char* data, size_t length) override {
+    if (ssl_ == nullptr || done_) return;
+    BIO_write(SSL_get_rbio(ssl_), data, length);
+    Handshake();
+  }
+
+ private:
+  void Handshake() {
+    const int ret = SSL_do_handshake(ssl_);
+    if (ret == 1) {
+      done_ = true;
+      generator_->Record(start_);
+      SSL_shutdown(ssl_);
+      Flush();
+      return Shutdown();
+    }
+    Flush();
+    if (SSL_get_error(ssl_, ret) != SSL_ERROR_WANT_READ) {
+      ERR_clear_error();
+      Fail();
+    }
+  }
+
+  // Writes out what TLS has to send.
+  void Flush() {
+    char data[16 * 1024];
+    int length;
+    while ((length = BIO_read(SSL_get_wbio(ssl_), data, sizeof(data))) > 0)
+      Write(data, length);
+  }
+
+  const uint64_t start_;
+  SSL* ssl_ = nullptr;
+  bool done_ = false;
+};
+#endif  // HAVE_OPENSSL
+
+class EchoConnection final : public Connection {
+ public:
+  using Connection::Connection;
+
+ protected:
+  void OnConnect() override {
+    for (size_t i = 0; i < generator_->options().pipelining; i++) Send();
+  }
+
+  void OnRead(const char* data, size_t length) override {
+    const size_t size = generator_->echo_message().size();
+    received_ += length;
+    while (received_ >= size && !sent_.empty()) {
+      received_ -= size;
+      generator_->Record(sent_.front());
+      sent_.pop_front();
+      if (generator_->running()) Send();
+    }
+  }
+
+ private:
+  void Send() {
+    sent_.push_back(uv_hrtime());
+    const std::string& message = generator_->echo_message();
+    Write(message.data(), message.size());
+  }
+
+  std::deque<uint64_t> sent_;  // When the pending messages were sent.
+  size_t received_ = 0;  // Of the message that comes back next.
+};
+
+LoadGenerator::LoadGenerator(uv_loop_t* loop, const Options& options)
+    : loop_(loop), options_(options) {
+  timer_.data = this;
+}
+
+LoadGenerator::~LoadGenerator() {
+  if (latency_ != nullptr) hdr_close(latency_);
+  if (http2_callbacks_ != nullptr)
+    nghttp2_session_callbacks_del(http2_callbacks_);
+#if HAVE_OPENSSL
+  if (tls_context_ != nullptr) SSL_CTX_free(tls_context_);
+#endif
+}
+
+bool LoadGenerator::Init() {
+  sockaddr_in* ipv4 = reinterpret_cast<sockaddr_in*>(&address_);
+  sockaddr_in6* ipv6 = reinterpret_cast<sockaddr_in6*>(&address_);
+  if (uv_ip4_addr(options_.host.c_str(), options_.port, ipv4) != 0 &&
+      uv_ip6_addr(options_.host.c_str(), options_.port, ipv6) != 0) {
+    fprintf(stderr, "Invalid address: %s\n", options_.host.c_str());
+    return false;
+  }
+  // From 1us to 60s, with 3 significant digits.
+  if (hdr_init(1, 60 * 1000 * 1000, 3, &latency_) != 0) return false;
+
+  switch (options_.mode) {
+    case Mode::kHttp1:
+      http1_request_ = "GET " + options_.path + " HTTP/1.1\r\nHost: " +
+                       options_.host + ":" + std::to_string(options_.port) +
+                       "\r\n\r\n";
+      break;
+    case Mode::kHttp2:
+      http2_callbacks_ = Http2Connection::CreateCallbacks();
+      if (http2_callbacks_ == nullptr) return false;
+      break;
+    case Mode::kTls:
+#if HAVE_OPENSSL
+      tls_context_ = SSL_CTX_new(TLS_client_method());
+      if (tls_context_ == nullptr) return false;
+      // The benchmark is about the handshake, not about trusting the peer.
+      SSL_CTX_set_verify(tls_context_, SSL_VERIFY_NONE, nullptr);
+      SSL_CTX_set_session_cache_mode(tls_context_, SSL_SESS_CACHE_OFF);
+      break;
+#else
+      fprintf(stderr, "There is no TLS support in this build\n");
+      return false;
+#endif
+    case Mode::kTcpEcho:
+      echo_message_.assign(options_.size, 'x');
+      break;
+  }
+
+  uv_timer_init(loop_, &timer_);
+  return true;
+}
+
+void LoadGenerator::Start() {
+  running_ = true;
+  measuring_ = options_.warmup == 0;
+  measure_start_ = uv_hrtime();
+  for (size_t i = 0; i < options_.connections; i++) Connect();
+  const double first =
+      options_.warmup > 0 ? options_.warmup : options_.duration;
+  uv_timer_start(&timer_, [](uv_timer_t* timer) {
+    static_cast<LoadGenerator*>(timer->data)->OnTimer();
+  }, static_cast<uint64_t>(first * 1000), 0);
+}
+
+void LoadGenerator::OnTimer() {
+  if (!measuring_) {
+    measuring_ = true;
+    measure_start_ = uv_hrtime();
+    uv_timer_start(&timer_, [](uv_timer_t* timer) {
+      static_cast<LoadGenerator*>(timer->data)->OnTimer();
+    }, static_cast<uint64_t>(options_.duration * 1000), 0);
+    return;
+  }
+
+  measuring_ = false;
+  running_ = false;
+  measure_end_ = uv_hrtime();
+  uv_close(reinterpret_cast<uv_handle_t*>(&timer_), nullptr);
+  // Closing a connection takes it out of connections_.
+  std::unordered_set<Connection*> connections = connections_;
+  for (Connection* connection : connections) connection->Close();
+}
+
+void LoadGenerator::Connect() {
+  Connection* connection = nullptr;
+  switch (options_.mode) {
+    case Mode::kHttp1: connection = new Http1Connection(this); break;
+    case Mode::kHttp2: connection = new Http2Connection(this); break;
+#if HAVE_OPENSSL
+    case Mode::kTls: connection = new TlsConnection(this); break;
+#else
+    case Mode::kTls: abort();
+#endif
+    case Mode::kTcpEcho: connection = new EchoConnection(this); break;
+  }
+  if (connection->Connect(reinterpret_cast<sockaddr*>(&address_)) != 0) {
+    // Without a handle, there is nothing that would try again later.
+    delete connection;
+    CountError();
+    return;
+  }
+  connections_.insert(connection);
+  if (measuring_) connects_++;
+}
+
+void LoadGenerator::OnConnectionClosed(Connection* connection) {
+  connections_.erase(connection);
+  delete connection;
+  if (running_) Connect();
+}
+
+void LoadGenerator::PrintResult() const {
+  const double seconds = (measure_end_ - measure_start_) / 1e9;
+  printf("{\"mode\":\"%s\",\"connections\":%zu,\"pipelining\":%zu,"
+         "\"duration\":%.3f,\"requests\":%" PRIu64 ","
+         "\"requestsPerSecond\":%.1f,\"errors\":%" PRIu64 ","
+         "\"non2xx\":%" PRIu64 ",\"connects\":%" PRIu64 ","
+         "\"bytesRead\":%" PRIu64 ",\"bytesWritten\":%" PRIu64 ","
+         "\"latency\":{\"unit\":\"us\",\"min\":%" PRId64 ",\"mean\":%.1f,"
+         "\"stddev\":%.1f,\"p50\":%" PRId64 ",\"p90\":%" PRId64 ","
+         "\"p99\":%" PRId64 ",\"p999\":%" PRId64 ",\"max\":%" PRId64 "}}\n",
+         options_.mode_name.c_str(),
+         options_.connections,
+         options_.pipelining,
+         seconds,
+         requests_,
+         seconds > 0 ? requests_ / seconds : 0,
+         errors_,
+         non2xx_,
+         connects_,
+         bytes_read_,
+         bytes_written_,
+         requests_ > 0 ? hdr_min(latency_) : 0,
+         requests_ > 0 ? hdr_mean(latency_) : 0,
+         requests_ > 0 ? hdr_stddev(latency_) : 0,
+         hdr_value_at_percentile(latency_, 50),
+         hdr_value_at_percentile(latency_, 90),
+         hdr_value_at_percentile(latency_, 99),
+         hdr_value_at_percentile(latency_, 99.9),
+         hdr_max(latency_));
+}
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s --port=<port> [--mode=http1|http2|tls|tcp-echo]\n"
+          "    [--host=127.0.0.1] [--connections=10] [--pipelining=1]\n"
+          "    [--duration=10] [--warmup=1] [--path=/] [--size=64]\n"
+          "    [--servername=<name>]\n",
+          program);
+}
+
+// Parses `--name=value` arguments into `options`.
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* equals = strchr(arg, '=');
+    if (strncmp(arg, "--", 2) != 0 || equals == nullptr) return false;
+    const std::string name(arg + 2, equals - arg - 2);
+    const char* value = equals + 1;
+    if (name == "mode") {
+      options->mode_name = value;
+      if (options->mode_name == "http1") {
+        options->mode = Mode::kHttp1;
+      } else if (options->mode_name == "http2") {
+        options->mode = Mode::kHttp2;
+      } else if (options->mode_name == "tls") {
+        options->mode = Mode::kTls;
+      } else if (options->mode_name == "tcp-echo") {
+        options->mode = Mode::kTcpEcho;
+      } else {
+        return false;
+      }
+    } else if (name == "host") {
+      options->host = value;
+    } else if (name == "port") {
+      options->port = atoi(value);
+    } else if (name == "connections") {
+      options->connections = strtoul(value, nullptr, 10);
+    } else if (name == "pipelining") {
+      options->pipelining = strtoul(value, nullptr, 10);
+    } else if (name == "duration") {
+      options->duration = atof(value);
+    } else if (name == "warmup") {
+      options->warmup = atof(value);
+    } else if (name == "path") {
+      options->path = value;
+    } else if (name == "size") {
+      options->size = strtoul(value, nullptr, 10);
+    } else if (name == "servername") {
+      options->servername = value;
+    } else {
+      return false;
+    }
+  }
+  return options->port > 0 && options->port < 65536 &&
+         options->connections > 0 && options->pipelining > 0 &&
+         options->duration > 0 && options->warmup >= 0 &&
+         options->size > 0;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  uv_loop_t* loop = uv_default_loop();
+  {
+    LoadGenerator generator(loop, options);
+    if (!generator.Init()) return 1;
+    generator.Start();
+    uv_run(loop, UV_RUN_DEFAULT);
+    generator.PrintResult();
+  }
+  uv_loop_close(loop);
+  return 0;
+}
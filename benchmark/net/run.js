@@ -0,0 +1,169 @@
+// Runs the end-to-end network benchmarks: a server in this process, and
+// load_generator, which `make` builds next to the node binary, as a
+// separate process that drives it. Writes one JSON object with the results
+// of all scenarios to stdout, for example to keep as a baseline:
+//
+//   $ node benchmark/net/run.js > baseline.json
+//   $ out/Release/node benchmark/net/run.js --baseline=baseline.json
+//
+// With --baseline, it exits with 1 if a scenario has errors, or has fallen
+// more than --tolerance (by default 0.05, that is 5%) below the throughput,
+// or above the p99 latency, of the baseline.
+//
+// Options, as --name=value: duration and warmup in seconds, filter to only
+// run the scenarios whose name contains it, generator for the path of
+// load_generator, and key and cert for the PEM files of the TLS server,
+// which are generated by `make -C test/fixtures/keys` by default.
+'use strict';
+
+const { execFile } = require('child_process');
+const fs = require('fs');
+const http = require('http');
+const http2 = require('http2');
+const net = require('net');
+const os = require('os');
+const path = require('path');
+
+const root = path.resolve(__dirname, '..', '..');
+const options = {
+  duration: 10,
+  warmup: 2,
+  filter: '',
+  generator: path.join(path.dirname(process.execPath),
+                       `load_generator${process.platform === 'win32' ?
+                         '.exe' : ''}`),
+  key: path.join(root, 'test/fixtures/keys/agent1-key.pem'),
+  cert: path.join(root, 'test/fixtures/keys/agent1-cert.pem'),
+  baseline: '',
+  tolerance: 0.05,
+};
+
+for (const arg of process.argv.slice(2)) {
+  const match = /^--([^=]+)=(.*)$/.exec(arg);
+  if (!match || !(match[1] in options)) {
+    console.error(`Unknown option: ${arg}`);
+    process.exit(2);
+  }
+  options[match[1]] = typeof options[match[1]] === 'number' ?
+    Number(match[2]) : match[2];
+}
+
+const body = Buffer.from('hello world');
+
+// Each scenario starts a server, and passes these to load_generator.
+const scenarios = {
+  'http1-keepalive': {
+    server: () => http.createServer((req, res) => {
+      res.setHeader('content-type', 'text/plain');
+      res.end(body);
+    }),
+    args: { mode: 'http1', connections: 50, pipelining: 10 },
+  },
+  'http2-multiplex': {
+    server: () => http2.createServer().on('stream', (stream) => {
+      stream.respond({ ':status': 200, 'content-type': 'text/plain' });
+      stream.end(body);
+    }),
+    args: { mode: 'http2', connections: 10, pipelining: 50 },
+  },
+  'tls-handshake': {
+    server: () => require('tls').createServer({
+      key: fs.readFileSync(options.key),
+      cert: fs.readFileSync(options.cert),
+    }, (socket) => {
+      socket.on('error', () => {});
+      socket.resume();
+    }).on('tlsClientError', () => {}),
+    args: { mode: 'tls', connections: 10, servername: 'agent1' },
+  },
+  'tcp-echo': {
+    server: () => net.createServer((socket) => {
+      socket.on('error', () => {});
+      socket.pipe(socket);
+    }),
+    args: { mode: 'tcp-echo', connections: 50, pipelining: 10, size: 64 },
+  },
+};
+
+function runGenerator(port, args) {
+  const argv = Object.entries({
+    ...args,
+    port,
+    duration: options.duration,
+    warmup: options.warmup,
+  }).map(([name, value]) => `--${name}=${value}`);
+  return new Promise((resolve, reject) => {
+    execFile(options.generator, argv, (err, stdout, stderr) => {
+      if (err) {
+        err.message += `\n${stderr}`;
+        return reject(err);
+      }
+      resolve(JSON.parse(stdout));
+    });
+  });
+}
+
+async function runScenario({ server: createServer, args }) {
+  const server = createServer();
+  await new Promise((resolve) => server.listen(0, '127.0.0.1', resolve));
+  try {
+    return await runGenerator(server.address().port, args);
+  } finally {
+    server.close();
+    // Keep-alive connections would hold up close() until they time out.
+    server.closeAllConnections?.();
+  }
+}
+
+// Returns what is worse in `result` than in `baseline`.
+function compare(name, result, baseline) {
+  const failures = [];
+  const tolerance = options.tolerance;
+  if (result.errors > 0)
+    failures.push(`${name}: ${result.errors} errors`);
+  if (baseline === undefined) return failures;
+  const minRate = baseline.requestsPerSecond * (1 - tolerance);
+  if (result.requestsPerSecond < minRate) {
+    failures.push(`${name}: ${result.requestsPerSecond} requests/s, ` +
+                  `baseline ${baseline.requestsPerSecond}`);
+  }
+  const maxP99 = baseline.latency.p99 * (1 + tolerance);
+  if (result.latency.p99 > maxP99) {
+    failures.push(`${name}: p99 ${result.latency.p99}us, ` +
+                  `baseline ${baseline.latency.p99}us`);
+  }
+  return failures;
+}
+
+async function main() {
+  const output = {
+    node: process.version,
+    v8: process.versions.v8,
+    platform: process.platform,
+    arch: process.arch,
+    cpus: os.cpus().length,
+    cpu: os.cpus()[0]?.model,
+    duration: options.duration,
+    warmup: options.warmup,
+    results: {},
+  };
+  for (const [name, scenario] of Object.entries(scenarios)) {
+    if (!name.includes(options.filter)) continue;
+    output.results[name] = await runScenario(scenario);
+  }
+  console.log(JSON.stringify(output, null, 2));
+
+  if (!options.baseline) return;
+  const baseline = JSON.parse(fs.readFileSync(options.baseline, 'utf8'));
+  const failures = [];
+  for (const [name, result] of Object.entries(output.results))
+    failures.push(...compare(name, result, baseline.results[name]));
+  for (const failure of failures)
+    console.error(failure);
+  if (failures.length > 0) process.exitCode = 1;
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exitCode = 1;
+});
@@ -0,0 +1,51 @@
+// Full TLS handshakes per second over a local connection. Pre-shared keys
+// keep the benchmark free of certificate fixtures; certificate signature
+// costs are covered by benchmark/crypto/sign-verify.js.
+'use strict';
+
+const common = require('../common.js');
+const tls = require('tls');
+
+const bench = common.createBenchmark(main, {
+  ciphers: [
+    'ECDHE-PSK-AES128-CBC-SHA256',
+    'ECDHE-PSK-CHACHA20-POLY1305',
+    'PSK-AES128-GCM-SHA256',
+  ],
+  n: [500],
+});
+
+function main({ ciphers, n }) {
+  const psk = Buffer.alloc(32, 'k');
+  const server = tls.createServer({
+    ciphers,
+    maxVersion: 'TLSv1.2',
+    pskCallback: () => psk,
+  }, (socket) => socket.end());
+
+  server.listen(0, () => {
+    const { port } = server.address();
+    let done = 0;
+
+    function connect() {
+      const socket = tls.connect({
+        port,
+        ciphers,
+        maxVersion: 'TLSv1.2',
+        checkServerIdentity: () => {},
+        pskCallback: () => ({ psk, identity: 'bench' }),
+      }, () => socket.end());
+      socket.on('close', () => {
+        if (++done === n) {
+          bench.end(n);
+          server.close();
+        } else {
+          connect();
+        }
+      });
+    }
+
+    bench.start();
+    connect();
+  });
+}
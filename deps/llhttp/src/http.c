@@ -147,3 +147,146 @@ int llhttp_should_keep_alive(const llhttp_t* parser) {
 
   return !llhttp_message_needs_eof(parser);
 }
+
+
+/* SIMD scanning of header and URL character runs, used by llhttp.c when it
+ * is not compiled with SSE4.2 enabled. The implementation is picked for the
+ * CPU that the parser runs on.
+ *
+ * `ranges` holds `ranges_len / 2` inclusive byte ranges as pairs of bounds,
+ * padded to 16 bytes, in the format used by `_mm_cmpestri()`. The returned
+ * length is that of the run of bytes at `p` that all fall within one of the
+ * ranges. Only whole 16-byte blocks are looked at, the bytes after the last
+ * one are left to the caller.
+ *
+ * SSE4.2 is used on x86-64 and NEON on arm64. AVX2 is not used: it has to
+ * test each range separately, which is slower for the range sets of llhttp
+ * than one `pcmpestri` per 16-byte block. */
+
+#if !defined(LLHTTP_NO_RUNTIME_SIMD) &&                                       \
+    (defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__))
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  define LLHTTP__TARGET(features)
+# else  /* !_MSC_VER */
+#  include <x86intrin.h>
+#  define LLHTTP__TARGET(features) __attribute__((target(features)))
+# endif  /* _MSC_VER */
+#else  /* __aarch64__ */
+# include <arm_neon.h>
+#endif
+
+typedef size_t (*llhttp__span_ranges_fn)(const unsigned char* p,
+                                         const unsigned char* endp,
+                                         const unsigned char* ranges,
+                                         int ranges_len);
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+LLHTTP__TARGET("sse4.2")
+static size_t llhttp__span_ranges_sse42(const unsigned char* p,
+                                        const unsigned char* endp,
+                                        const unsigned char* ranges,
+                                        int ranges_len) {
+  const unsigned char* start = p;
+  __m128i r = _mm_loadu_si128((__m128i const*) ranges);
+
+  while (endp - p >= 16) {
+    __m128i input = _mm_loadu_si128((__m128i const*) p);
+    int match_len = _mm_cmpestri(r, ranges_len, input, 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                                   _SIDD_NEGATIVE_POLARITY);
+    p += match_len;
+    if (match_len != 16)
+      break;
+  }
+
+  return p - start;
+}
+
+static size_t llhttp__span_ranges_none(const unsigned char* p,
+                                       const unsigned char* endp,
+                                       const unsigned char* ranges,
+                                       int ranges_len) {
+  (void) p;
+  (void) endp;
+  (void) ranges;
+  (void) ranges_len;
+  return 0;
+}
+
+static llhttp__span_ranges_fn llhttp__select_span_ranges(void) {
+  int has_sse42;
+#ifdef _MSC_VER
+  int info[4];
+
+  __cpuid(info, 1);
+  has_sse42 = (info[2] >> 20) & 1;
+#else  /* !_MSC_VER */
+  __builtin_cpu_init();
+  has_sse42 = __builtin_cpu_supports("sse4.2");
+#endif  /* _MSC_VER */
+
+  return has_sse42 ? llhttp__span_ranges_sse42 : llhttp__span_ranges_none;
+}
+
+#else  /* __aarch64__ */
+
+/* A byte `c` is within [lo, hi] if `c - lo <= hi - lo` as unsigned bytes. */
+static size_t llhttp__span_ranges_neon(const unsigned char* p,
+                                       const unsigned char* endp,
+                                       const unsigned char* ranges,
+                                       int ranges_len) {
+  const unsigned char* start = p;
+  uint8x16_t lo[8];
+  uint8x16_t width[8];
+  int count = ranges_len / 2;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    lo[i] = vdupq_n_u8(ranges[i * 2]);
+    width[i] = vdupq_n_u8((uint8_t) (ranges[i * 2 + 1] - ranges[i * 2]));
+  }
+
+  while (endp - p >= 16) {
+    uint8x16_t input = vld1q_u8(p);
+    uint8x16_t match = vdupq_n_u8(0);
+    uint64_t mask;
+
+    for (i = 0; i < count; i++)
+      match = vorrq_u8(match, vcleq_u8(vsubq_u8(input, lo[i]), width[i]));
+
+    /* Narrow the 0x00/0xff bytes to one nibble each. */
+    mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+    if (mask != UINT64_MAX)
+      return (p - start) + __builtin_ctzll(~mask) / 4;
+    p += 16;
+  }
+
+  return p - start;
+}
+
+static llhttp__span_ranges_fn llhttp__select_span_ranges(void) {
+  return llhttp__span_ranges_neon;
+}
+
+#endif  /* __x86_64__ || _M_X64 */
+
+size_t llhttp__span_ranges(const unsigned char* p, const unsigned char* endp,
+                           const unsigned char* ranges, int ranges_len) {
+  /* Every thread that gets here first stores the same value. */
+  static llhttp__span_ranges_fn span_ranges;
+
+  if (span_ranges == NULL)
+    span_ranges = llhttp__select_span_ranges();
+
+  return span_ranges(p, endp, ranges, ranges_len);
+}
+
+#endif  /* !LLHTTP_NO_RUNTIME_SIMD && (__x86_64__ || _M_X64 || __aarch64__) */
@@ -12,6 +12,14 @@
  #endif  /* _MSC_VER */
 #endif  /* __SSE4_2__ */
 
+/* Without SSE4.2 enabled at compile time, the scans below go through
+ * llhttp__span_ranges() in http.c, which picks a SIMD implementation for
+ * the CPU at runtime. */
+#if !defined(__SSE4_2__) && !defined(LLHTTP_NO_RUNTIME_SIMD) && \
+    (defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__))
+ #define LLHTTP_RUNTIME_SIMD
+#endif  /* !__SSE4_2__ && !LLHTTP_NO_RUNTIME_SIMD */
+
 #ifdef _MSC_VER
  #define ALIGN(n) _declspec(align(n))
 #else  /* !_MSC_VER */
@@ -23,6 +31,11 @@
 typedef int (*llhttp__internal__span_cb)(
              llhttp__internal_t*, const char*, const char*);
 
+#ifdef LLHTTP_RUNTIME_SIMD
+size_t llhttp__span_ranges(const unsigned char* p, const unsigned char* endp,
+                           const unsigned char* ranges, int ranges_len);
+#endif  /* LLHTTP_RUNTIME_SIMD */
+
 static const unsigned char llparse_blob0[] = {
   0xd, 0xa
 };
@@ -44,24 +57,24 @@ static const unsigned char llparse_blob5[] = {
 static const unsigned char llparse_blob6[] = {
   'c', 'h', 'u', 'n', 'k', 'e', 'd'
 };
-#ifdef __SSE4_2__
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob7[] = {
   0x9, 0x9, ' ', '~', 0x80, 0xff, 0x0, 0x0, 0x0, 0x0, 0x0,
   0x0, 0x0, 0x0, 0x0, 0x0
 };
-#endif  /* __SSE4_2__ */
-#ifdef __SSE4_2__
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob8[] = {
   '!', '!', '#', '\'', '*', '+', '-', '.', '0', '9', 'A',
   'Z', '^', 'z', '|', '|'
 };
-#endif  /* __SSE4_2__ */
-#ifdef __SSE4_2__
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob9[] = {
   '~', '~', 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
   0x0, 0x0, 0x0, 0x0, 0x0
 };
-#endif  /* __SSE4_2__ */
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
 static const unsigned char llparse_blob10[] = {
   'e', 'n', 't', '-', 'l', 'e', 'n', 'g', 't', 'h'
 };
@@ -2091,6 +2104,16 @@ static llparse_state_t llhttp__internal__run(
         }
         goto s_n_llhttp__internal__n_header_value_otherwise;
       }
+      #elif defined(LLHTTP_RUNTIME_SIMD)
+      if (endp - p >= 16) {
+        size_t match_len;
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob7, 6);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_header_value;
+        }
+      }
       #endif  /* __SSE4_2__ */
       switch (lookup_table[(uint8_t) *p]) {
         case 1: {
@@ -2290,6 +2313,22 @@ static llparse_state_t llhttp__internal__run(
         }
         goto s_n_llhttp__internal__n_header_field_general_otherwise;
       }
+      #elif defined(LLHTTP_RUNTIME_SIMD)
+      if (endp - p >= 16) {
+        size_t match_len;
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob8, 16);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_header_field_general;
+        }
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob9, 2);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_header_field_general;
+        }
+      }
       #endif  /* __SSE4_2__ */
       switch (lookup_table[(uint8_t) *p]) {
         case 1: {
@@ -7686,6 +7725,14 @@ int llhttp__internal_execute(llhttp__internal_t* state, const char* p, const cha
  #endif  /* _MSC_VER */
 #endif  /* __SSE4_2__ */
 
+/* Without SSE4.2 enabled at compile time, the scans below go through
+ * llhttp__span_ranges() in http.c, which picks a SIMD implementation for
+ * the CPU at runtime. */
+#if !defined(__SSE4_2__) && !defined(LLHTTP_NO_RUNTIME_SIMD) && \
+    (defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__))
+ #define LLHTTP_RUNTIME_SIMD
+#endif  /* !__SSE4_2__ && !LLHTTP_NO_RUNTIME_SIMD */
+
 #ifdef _MSC_VER
  #define ALIGN(n) _declspec(align(n))
 #else  /* !_MSC_VER */
@@ -7697,12 +7744,17 @@ int llhttp__internal_execute(llhttp__internal_t* state, const char* p, const cha
 typedef int (*llhttp__internal__span_cb)(
              llhttp__internal_t*, const char*, const char*);
 
-#ifdef __SSE4_2__
+#ifdef LLHTTP_RUNTIME_SIMD
+size_t llhttp__span_ranges(const unsigned char* p, const unsigned char* endp,
+                           const unsigned char* ranges, int ranges_len);
+#endif  /* LLHTTP_RUNTIME_SIMD */
+
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob0[] = {
   0x9, 0x9, 0xc, 0xc, '!', '"', '$', '>', '@', '~', 0x80,
   0xff, 0x0, 0x0, 0x0, 0x0
 };
-#endif  /* __SSE4_2__ */
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
 static const unsigned char llparse_blob1[] = {
   'o', 'n'
 };
@@ -7721,24 +7773,24 @@ static const unsigned char llparse_blob5[] = {
 static const unsigned char llparse_blob6[] = {
   'c', 'h', 'u', 'n', 'k', 'e', 'd'
 };
-#ifdef __SSE4_2__
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob7[] = {
   0x9, 0x9, ' ', '~', 0x80, 0xff, 0x0, 0x0, 0x0, 0x0, 0x0,
   0x0, 0x0, 0x0, 0x0, 0x0
 };
-#endif  /* __SSE4_2__ */
-#ifdef __SSE4_2__
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob8[] = {
   ' ', '!', '#', '\'', '*', '+', '-', '.', '0', '9', 'A',
   'Z', '^', 'z', '|', '|'
 };
-#endif  /* __SSE4_2__ */
-#ifdef __SSE4_2__
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
+#if defined(__SSE4_2__) || defined(LLHTTP_RUNTIME_SIMD)
 static const unsigned char ALIGN(16) llparse_blob9[] = {
   '~', '~', 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
   0x0, 0x0, 0x0, 0x0, 0x0
 };
-#endif  /* __SSE4_2__ */
+#endif  /* __SSE4_2__ || LLHTTP_RUNTIME_SIMD */
 static const unsigned char llparse_blob10[] = {
   'e', 'n', 't', '-', 'l', 'e', 'n', 'g', 't', 'h'
 };
@@ -9730,6 +9782,16 @@ static llparse_state_t llhttp__internal__run(
         }
         goto s_n_llhttp__internal__n_header_value_otherwise;
       }
+      #elif defined(LLHTTP_RUNTIME_SIMD)
+      if (endp - p >= 16) {
+        size_t match_len;
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob7, 6);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_header_value;
+        }
+      }
       #endif  /* __SSE4_2__ */
       switch (lookup_table[(uint8_t) *p]) {
         case 1: {
@@ -9929,6 +9991,22 @@ static llparse_state_t llhttp__internal__run(
         }
         goto s_n_llhttp__internal__n_header_field_general_otherwise;
       }
+      #elif defined(LLHTTP_RUNTIME_SIMD)
+      if (endp - p >= 16) {
+        size_t match_len;
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob8, 16);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_header_field_general;
+        }
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob9, 2);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_header_field_general;
+        }
+      }
       #endif  /* __SSE4_2__ */
       switch (lookup_table[(uint8_t) *p]) {
         case 1: {
@@ -10718,6 +10796,16 @@ static llparse_state_t llhttp__internal__run(
         }
         goto s_n_llhttp__internal__n_url_query_or_fragment;
       }
+      #elif defined(LLHTTP_RUNTIME_SIMD)
+      if (endp - p >= 16) {
+        size_t match_len;
+
+        match_len = llhttp__span_ranges(p, endp, llparse_blob0, 12);
+        if (match_len != 0) {
+          p += match_len;
+          goto s_n_llhttp__internal__n_url_path;
+        }
+      }
       #endif  /* __SSE4_2__ */
       switch (lookup_table[(uint8_t) *p]) {
         case 1: {
@@ -248,11 +248,15 @@ typedef struct uv_interface_address_s uv_interface_address_t;
 typedef struct uv_dirent_s uv_dirent_t;
 typedef struct uv_passwd_s uv_passwd_t;
 typedef struct uv_utsname_s uv_utsname_t;
+typedef struct uv_metrics_s uv_metrics_t;
 typedef struct uv_statfs_s uv_statfs_t;
 
 typedef enum {
   UV_LOOP_BLOCK_SIGNAL = 0,
-  UV_METRICS_IDLE_TIME
+  UV_METRICS_IDLE_TIME,
+  UV_LOOP_USE_TIMER_WHEEL,
+  UV_LOOP_BUSY_POLL,
+  UV_LOOP_EPOLL_EXCLUSIVE
 } uv_loop_option;
 
 typedef enum {
@@ -575,7 +579,18 @@ UV_EXTERN int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable);
 
 enum uv_tcp_flags {
   /* Used with uv_tcp_bind, when an IPv6 address is used. */
-  UV_TCP_IPV6ONLY = 1
+  UV_TCP_IPV6ONLY = 1,
+
+  /* Enable SO_REUSEPORT socket option when binding the handle.
+   * This allows completely duplicate bindings by multiple processes
+   * or threads if they all set SO_REUSEPORT before binding the port.
+   * Incoming connections are distributed across the participating
+   * listening sockets by the kernel.
+   *
+   * This is only supported on Linux 3.9+, DragonFlyBSD 3.6+ and
+   * FreeBSD 12.0+ for now; uv_tcp_bind() fails with UV_ENOTSUP elsewhere.
+   */
+  UV_TCP_REUSEPORT = 2
 };
 
 UV_EXTERN int uv_tcp_bind(uv_tcp_t* handle,
@@ -1242,6 +1257,7 @@ UV_EXTERN uv_pid_t uv_os_getppid(void);
 UV_EXTERN int uv_os_getpriority(uv_pid_t pid, int* priority);
 UV_EXTERN int uv_os_setpriority(uv_pid_t pid, int priority);
 
+UV_EXTERN unsigned int uv_available_parallelism(void);
 UV_EXTERN int uv_cpu_info(uv_cpu_info_t** cpu_infos, int* count);
 UV_EXTERN void uv_free_cpu_info(uv_cpu_info_t* cpu_infos, int count);
 
@@ -1278,6 +1294,21 @@ UV_EXTERN int uv_os_uname(uv_utsname_t* buffer);
 
 UV_EXTERN uint64_t uv_metrics_idle_time(uv_loop_t* loop);
 
+struct uv_metrics_s {
+  uint64_t loop_count;  /* Loop iterations. */
+  uint64_t events;  /* Events dispatched by the I/O poller. */
+  uint64_t poll_count;  /* Times the I/O poller returned. */
+  /* Nanoseconds spent waiting in and running callbacks from the I/O poller.
+   * Both stay zero unless the loop is configured with UV_METRICS_IDLE_TIME.
+   */
+  uint64_t idle_time;
+  uint64_t poll_callback_time;
+  uint64_t threadpool_pending;  /* Work requests submitted but not done. */
+  uint64_t active_handles[UV_HANDLE_TYPE_MAX];  /* Indexed by handle type. */
+};
+
+UV_EXTERN int uv_metrics_info(uv_loop_t* loop, uv_metrics_t* metrics);
+
 typedef enum {
   UV_FS_UNKNOWN = -1,
   UV_FS_CUSTOM,
@@ -1790,6 +1821,16 @@ UV_EXTERN uv_thread_t uv_thread_self(void);
 UV_EXTERN int uv_thread_join(uv_thread_t *tid);
 UV_EXTERN int uv_thread_equal(const uv_thread_t* t1, const uv_thread_t* t2);
 
+UV_EXTERN int uv_cpumask_size(void);
+UV_EXTERN int uv_thread_setaffinity(uv_thread_t* tid,
+                                    char* cpumask,
+                                    char* oldmask,
+                                    size_t mask_size);
+UV_EXTERN int uv_thread_getaffinity(uv_thread_t* tid,
+                                    char* cpumask,
+                                    size_t mask_size);
+UV_EXTERN int uv_thread_getcpu(void);
+
 /* The presence of these unions force similar struct layout. */
 #define XX(_, name) uv_ ## name ## _t name;
 union uv_any_handle {
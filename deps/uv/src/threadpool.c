@@ -26,100 +26,461 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #define MAX_THREADPOOL_SIZE 1024
+#define UV__WORK_KINDS 3
+
+/* How long the pool has to stay saturated before it starts another thread,
+ * and how long an extra thread waits for work before it exits again.
+ */
+#define THREADPOOL_GROW_DELAY_NS   ((uint64_t) 10 * 1000 * 1000)
+#define THREADPOOL_IDLE_TIMEOUT_NS ((uint64_t) 5 * 1000 * 1000 * 1000)
+
+/* Every worker owns a set of queues, one per enum uv__work_kind. Submitters
+ * spread requests over the workers; a worker that runs out of work steals
+ * from the others before going to sleep. Fast I/O always goes first, CPU-bound
+ * and slow I/O work each have a cap on the number of threads they can occupy
+ * so neither can starve the file system.
+ *
+ * When UV_THREADPOOL_MAX_SIZE is larger than UV_THREADPOOL_SIZE the pool is
+ * elastic: extra threads are started one at a time while all threads stay
+ * busy for longer than THREADPOOL_GROW_DELAY_NS and exit again after sitting
+ * idle for THREADPOOL_IDLE_TIMEOUT_NS. Extra threads don't own queues, they
+ * only ever steal from the regular workers, so submitters and uv_cancel()
+ * never have to deal with a changing set of queues.
+ */
+struct uv__worker {
+  uv_thread_t thread;
+  uv_sem_t* started;
+  uv_mutex_t mutex;  /* Protects |wq| and |wakeup|. */
+  uv_cond_t cond;
+  QUEUE wq[UV__WORK_KINDS];
+  int wakeup;
+  QUEUE idle_queue;  /* Protected by the global |mutex|. */
+  int extra;
+  int running;  /* Extra threads only, protected by the global |mutex|. */
+  int joinable;  /* Extra threads only, owned by whoever starts the thread. */
+};
 
 static uv_once_t once = UV_ONCE_INIT;
-static uv_cond_t cond;
 static uv_mutex_t mutex;
-static unsigned int idle_threads;
+static QUEUE idle_workers;
+static unsigned int nidle;
+static unsigned int cpu_work_running;
 static unsigned int slow_io_work_running;
+static unsigned int nactive;  /* Regular plus active extra threads. */
+static int probing;
+static int exiting;
 static unsigned int nthreads;
-static uv_thread_t* threads;
-static uv_thread_t default_threads[4];
-static QUEUE exit_message;
-static QUEUE wq;
-static QUEUE run_slow_work_message;
-static QUEUE slow_io_pending_wq;
+static unsigned int max_threads;
+static struct uv__worker* workers;
+static struct uv__worker default_workers[4];
+static char* affinity;  /* UV_THREADPOOL_AFFINITY, see pin_worker(). */
 
 static unsigned int slow_work_thread_threshold(void) {
-  return (nthreads + 1) / 2;
+  return (nactive + 1) / 2;
+}
+
+/* Keep one in eight threads free for fast I/O. Small pools can't spare a
+ * thread, they keep the old behavior of letting CPU-bound work use them all.
+ */
+static unsigned int cpu_work_thread_threshold(void) {
+  return nactive - nactive / 8;
 }
 
+static void worker(void* arg);
+static void maybe_grow(void);
+
 static void uv__cancelled(struct uv__work* w) {
   abort();
 }
 
 
-/* To avoid deadlock with uv_cancel() it's crucial that the worker
- * never holds the global mutex and the loop-local mutex at the same time.
- */
-static void worker(void* arg) {
+/* Claims a thread for a capped kind of work. */
+static int reserve_slot(enum uv__work_kind kind) {
+  int reserved;
+
+  if (kind == UV__WORK_FAST_IO)
+    return 1;
+
+  uv_mutex_lock(&mutex);
+  if (kind == UV__WORK_CPU) {
+    reserved = cpu_work_running < cpu_work_thread_threshold();
+    cpu_work_running += reserved;
+  } else {
+    reserved = slow_io_work_running < slow_work_thread_threshold();
+    slow_io_work_running += reserved;
+  }
+  uv_mutex_unlock(&mutex);
+
+  return reserved;
+}
+
+
+static void release_slot(enum uv__work_kind kind) {
+  if (kind == UV__WORK_FAST_IO)
+    return;
+
+  uv_mutex_lock(&mutex);
+  if (kind == UV__WORK_CPU)
+    cpu_work_running--;
+  else
+    slow_io_work_running--;
+  uv_mutex_unlock(&mutex);
+}
+
+
+/* Dequeues the next runnable work item from |wk|, if any. */
+static struct uv__work* take_work(struct uv__worker* wk,
+                                  enum uv__work_kind* kind) {
+  static const enum uv__work_kind order[] = {
+    UV__WORK_FAST_IO,
+    UV__WORK_CPU,
+    UV__WORK_SLOW_IO
+  };
+  QUEUE* q;
+  unsigned int i;
+
+  q = NULL;
+  uv_mutex_lock(&wk->mutex);
+
+  for (i = 0; i < ARRAY_SIZE(order); i++) {
+    if (QUEUE_EMPTY(&wk->wq[order[i]]))
+      continue;
+
+    if (!reserve_slot(order[i]))
+      continue;
+
+    q = QUEUE_HEAD(&wk->wq[order[i]]);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+    *kind = order[i];
+    break;
+  }
+
+  uv_mutex_unlock(&wk->mutex);
+
+  if (q == NULL)
+    return NULL;
+
+  return QUEUE_DATA(q, struct uv__work, wq);
+}
+
+
+/* Looks at our own queues first, then tries to steal from the other workers. */
+static struct uv__work* find_work(struct uv__worker* self,
+                                  enum uv__work_kind* kind) {
   struct uv__work* w;
+  unsigned int base;
+  unsigned int i;
+
+  base = (self - workers) % nthreads;
+  w = NULL;
+
+  for (i = 0; w == NULL && i < nthreads; i++)
+    w = take_work(workers + (base + i) % nthreads, kind);
+
+  return w;
+}
+
+
+/* Returns zero when the thread pool is shutting down. */
+static int become_idle(struct uv__worker* self) {
+  uv_mutex_lock(&mutex);
+
+  if (exiting) {
+    uv_mutex_unlock(&mutex);
+    return 0;
+  }
+
+  QUEUE_INSERT_TAIL(&idle_workers, &self->idle_queue);
+  uv__store_relaxed(&nidle, nidle + 1);
+  uv_mutex_unlock(&mutex);
+
+  return 1;
+}
+
+
+static void leave_idle(struct uv__worker* self) {
+  uv_mutex_lock(&mutex);
+
+  /* Already gone if a submitter picked us to wake up. */
+  if (!QUEUE_EMPTY(&self->idle_queue)) {
+    QUEUE_REMOVE(&self->idle_queue);
+    QUEUE_INIT(&self->idle_queue);
+    uv__store_relaxed(&nidle, nidle - 1);
+  }
+
+  uv_mutex_unlock(&mutex);
+}
+
+
+static void wake_worker(struct uv__worker* wk) {
+  uv_mutex_lock(&wk->mutex);
+  wk->wakeup = 1;
+  uv_cond_signal(&wk->cond);
+  uv_mutex_unlock(&wk->mutex);
+}
+
+
+/* Wakes up |target| if it's idle, otherwise any other idle worker. */
+static void wake_idle_worker(struct uv__worker* target) {
   QUEUE* q;
-  int is_slow_work;
 
-  uv_sem_post((uv_sem_t*) arg);
-  arg = NULL;
+  uv_mutex_lock(&mutex);
+
+  if (QUEUE_EMPTY(&idle_workers)) {
+    uv_mutex_unlock(&mutex);
+    return;
+  }
+
+  q = &target->idle_queue;
+  if (QUEUE_EMPTY(q))
+    q = QUEUE_HEAD(&idle_workers);
+
+  QUEUE_REMOVE(q);
+  QUEUE_INIT(q);
+  uv__store_relaxed(&nidle, nidle - 1);
+  uv_mutex_unlock(&mutex);
+
+  wake_worker(QUEUE_DATA(q, struct uv__worker, idle_queue));
+}
+
+
+/* Waits for a wakeup, or for |timeout| nanoseconds if it's nonzero. Returns
+ * zero when the wait timed out.
+ */
+static int wait_for_wakeup(struct uv__worker* self, uint64_t timeout) {
+  int woken;
+
+  uv_mutex_lock(&self->mutex);
+
+  while (!self->wakeup) {
+    if (timeout == 0)
+      uv_cond_wait(&self->cond, &self->mutex);
+    else if (uv_cond_timedwait(&self->cond, &self->mutex, timeout))
+      break;
+  }
+
+  woken = self->wakeup;
+  self->wakeup = 0;
+  uv_mutex_unlock(&self->mutex);
+
+  return woken;
+}
+
+
+/* Makes an extra thread give up its slot. Fails when a submitter picked it
+ * to wake up in the meantime.
+ */
+static int retire(struct uv__worker* self) {
+  int retired;
 
   uv_mutex_lock(&mutex);
-  for (;;) {
-    /* `mutex` should always be locked at this point. */
-
-    /* Keep waiting while either no work is present or only slow I/O
-       and we're at the threshold for that. */
-    while (QUEUE_EMPTY(&wq) ||
-           (QUEUE_HEAD(&wq) == &run_slow_work_message &&
-            QUEUE_NEXT(&run_slow_work_message) == &wq &&
-            slow_io_work_running >= slow_work_thread_threshold())) {
-      idle_threads += 1;
-      uv_cond_wait(&cond, &mutex);
-      idle_threads -= 1;
-    }
 
-    q = QUEUE_HEAD(&wq);
-    if (q == &exit_message) {
-      uv_cond_signal(&cond);
-      uv_mutex_unlock(&mutex);
+  retired = !QUEUE_EMPTY(&self->idle_queue);
+  if (retired) {
+    QUEUE_REMOVE(&self->idle_queue);
+    QUEUE_INIT(&self->idle_queue);
+    uv__store_relaxed(&nidle, nidle - 1);
+    nactive--;
+    self->running = 0;
+  }
+
+  uv_mutex_unlock(&mutex);
+
+  return retired;
+}
+
+
+static int has_backlog(void) {
+  unsigned int i;
+  unsigned int k;
+  int found;
+
+  found = 0;
+
+  for (i = 0; !found && i < nthreads; i++) {
+    uv_mutex_lock(&workers[i].mutex);
+    for (k = 0; k < UV__WORK_KINDS; k++)
+      found |= !QUEUE_EMPTY(&workers[i].wq[k]);
+    uv_mutex_unlock(&workers[i].mutex);
+  }
+
+  return found;
+}
+
+
+/* A new extra thread only joins the pool if work is still waiting and no
+ * thread is idle after THREADPOOL_GROW_DELAY_NS, otherwise the backlog was
+ * only a blip. Once it's in, it gives the next thread a chance to start so
+ * that the pool keeps growing for as long as the backlog persists.
+ */
+static int activate(struct uv__worker* self) {
+  int active;
+
+  wait_for_wakeup(self, THREADPOOL_GROW_DELAY_NS);
+  active = has_backlog();
+
+  uv_mutex_lock(&mutex);
+  probing = 0;
+  active = active && !exiting && QUEUE_EMPTY(&idle_workers);
+  if (active)
+    nactive++;
+  else
+    self->running = 0;
+  uv_mutex_unlock(&mutex);
+
+  if (active)
+    maybe_grow();
+
+  return active;
+}
+
+
+/* Starts an extra thread if the pool is allowed to grow and isn't already
+ * trying to. This runs under the global mutex so that it can't race with
+ * uv__threadpool_cleanup(); threads that gave up their slot don't touch the
+ * mutex anymore, joining them here is safe.
+ */
+static void maybe_grow(void) {
+  struct uv__worker* wk;
+  unsigned int i;
+
+  uv_mutex_lock(&mutex);
+
+  if (exiting || probing || nactive >= max_threads) {
+    uv_mutex_unlock(&mutex);
+    return;
+  }
+
+  for (i = nthreads; i < max_threads; i++) {
+    wk = workers + i;
+
+    if (wk->running)
+      continue;
+
+    if (wk->joinable && uv_thread_join(&wk->thread))
+      abort();
+
+    wk->wakeup = 0;
+    wk->joinable = uv_thread_create(&wk->thread, worker, wk) == 0;
+    wk->running = wk->joinable;
+    probing = wk->joinable;
+    break;
+  }
+
+  uv_mutex_unlock(&mutex);
+}
+
+
+/* UV_THREADPOOL_AFFINITY is a list of CPU groups separated by ';', each
+ * group being a list of CPUs and CPU ranges, e.g. "0-7,16-23;8-15,24-31".
+ * Worker N is pinned to group N modulo the number of groups. Pinning is best
+ * effort; malformed groups and unsupported platforms leave threads as they
+ * are.
+ */
+static void pin_worker(unsigned int index) {
+  const char* group;
+  const char* p;
+  char* end;
+  char* mask;
+  unsigned int ngroups;
+  unsigned int i;
+  long first;
+  long last;
+  int size;
+  uv_thread_t self;
+
+  size = uv_cpumask_size();
+  if (size <= 0)
+    return;
+
+  ngroups = 1;
+  for (p = affinity; *p != '\0'; p++)
+    if (*p == ';')
+      ngroups++;
+
+  group = affinity;
+  for (i = index % ngroups; i > 0; i--)
+    group = strchr(group, ';') + 1;
+
+  mask = uv__calloc(size, 1);
+  if (mask == NULL)
+    return;
+
+  for (p = group; *p != '\0' && *p != ';'; p = end) {
+    first = strtol(p, &end, 10);
+    if (end == p)
       break;
+    last = first;
+    if (*end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+      if (end == p)
+        break;
     }
+    for (; first <= last && first < size; first++)
+      if (first >= 0)
+        mask[first] = 1;
+    if (*end == ',')
+      end++;
+  }
 
-    QUEUE_REMOVE(q);
-    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+  self = uv_thread_self();
+  uv_thread_setaffinity(&self, mask, NULL, size);
+  uv__free(mask);
+}
 
-    is_slow_work = 0;
-    if (q == &run_slow_work_message) {
-      /* If we're at the slow I/O threshold, re-schedule until after all
-         other work in the queue is done. */
-      if (slow_io_work_running >= slow_work_thread_threshold()) {
-        QUEUE_INSERT_TAIL(&wq, q);
-        continue;
-      }
 
-      /* If we encountered a request to run slow I/O work but there is none
-         to run, that means it's cancelled => Start over. */
-      if (QUEUE_EMPTY(&slow_io_pending_wq))
-        continue;
+/* To avoid deadlock with uv_cancel() it's crucial that the worker never
+ * holds a worker mutex and the loop-local mutex at the same time. Locks are
+ * only ever nested as worker mutex -> global mutex.
+ */
+static void worker(void* arg) {
+  struct uv__worker* self;
+  enum uv__work_kind kind;
+  struct uv__work* w;
+  uint64_t timeout;
 
-      is_slow_work = 1;
-      slow_io_work_running++;
+  self = arg;
+  if (affinity != NULL)
+    pin_worker(self - workers);
+  if (self->started != NULL)
+    uv_sem_post(self->started);
+  arg = NULL;
 
-      q = QUEUE_HEAD(&slow_io_pending_wq);
-      QUEUE_REMOVE(q);
-      QUEUE_INIT(q);
+  if (self->extra && !activate(self))
+    return;
 
-      /* If there is more slow I/O work, schedule it to be run as well. */
-      if (!QUEUE_EMPTY(&slow_io_pending_wq)) {
-        QUEUE_INSERT_TAIL(&wq, &run_slow_work_message);
-        if (idle_threads > 0)
-          uv_cond_signal(&cond);
+  for (;;) {
+    w = find_work(self, &kind);
+
+    if (w == NULL) {
+      if (!become_idle(self))
+        break;
+
+      /* Look again now that submitters can see that we're idle, otherwise
+       * work that was queued in between could sit there until its owner
+       * gets around to it.
+       */
+      w = find_work(self, &kind);
+
+      if (w == NULL) {
+        timeout = self->extra ? THREADPOOL_IDLE_TIMEOUT_NS : 0;
+        if (!wait_for_wakeup(self, timeout) && retire(self))
+          break;
       }
-    }
 
-    uv_mutex_unlock(&mutex);
+      leave_idle(self);
+
+      if (w == NULL)
+        continue;
+    }
 
-    w = QUEUE_DATA(q, struct uv__work, wq);
     w->work(w);
+    release_slot(kind);
 
     uv_mutex_lock(&w->loop->wq_mutex);
     w->work = NULL;  /* Signal uv_cancel() that the work req is done
@@ -127,36 +488,22 @@ static void worker(void* arg) {
     QUEUE_INSERT_TAIL(&w->loop->wq, &w->wq);
     uv_async_send(&w->loop->wq_async);
     uv_mutex_unlock(&w->loop->wq_mutex);
-
-    /* Lock `mutex` since that is expected at the start of the next
-     * iteration. */
-    uv_mutex_lock(&mutex);
-    if (is_slow_work) {
-      /* `slow_io_work_running` is protected by `mutex`. */
-      slow_io_work_running--;
-    }
   }
 }
 
 
-static void post(QUEUE* q, enum uv__work_kind kind) {
-  uv_mutex_lock(&mutex);
-  if (kind == UV__WORK_SLOW_IO) {
-    /* Insert into a separate queue. */
-    QUEUE_INSERT_TAIL(&slow_io_pending_wq, q);
-    if (!QUEUE_EMPTY(&run_slow_work_message)) {
-      /* Running slow I/O tasks is already scheduled => Nothing to do here.
-         The worker that runs said other task will schedule this one as well. */
-      uv_mutex_unlock(&mutex);
-      return;
-    }
-    q = &run_slow_work_message;
-  }
+static void post(struct uv__worker* wk, QUEUE* q, enum uv__work_kind kind) {
+  uv_mutex_lock(&wk->mutex);
+  QUEUE_INSERT_TAIL(&wk->wq[kind], q);
+  uv_mutex_unlock(&wk->mutex);
 
-  QUEUE_INSERT_TAIL(&wq, q);
-  if (idle_threads > 0)
-    uv_cond_signal(&cond);
-  uv_mutex_unlock(&mutex);
+  /* Idle workers register themselves before they take a last look at the
+   * queues, so either they see this request or we see them.
+   */
+  if (uv__load_relaxed(&nidle) > 0)
+    wake_idle_worker(wk);
+  else if (max_threads > nthreads)
+    maybe_grow();
 }
 
 
@@ -172,30 +519,46 @@ void uv__threadpool_cleanup(void) {
 
 #ifndef __MVS__
   /* TODO(gabylb) - zos: revisit when Woz compiler is available. */
-  post(&exit_message, UV__WORK_CPU);
+  uv_mutex_lock(&mutex);
+  exiting = 1;
+  uv_mutex_unlock(&mutex);
+
+  for (i = 0; i < max_threads; i++)
+    wake_worker(workers + i);
 #endif
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_join(threads + i))
-      abort();
+  for (i = 0; i < max_threads; i++)
+    if (i < nthreads || workers[i].joinable)
+      if (uv_thread_join(&workers[i].thread))
+        abort();
+
+  for (i = 0; i < max_threads; i++) {
+    uv_mutex_destroy(&workers[i].mutex);
+    uv_cond_destroy(&workers[i].cond);
+  }
+
+  if (workers != default_workers)
+    uv__free(workers);
 
-  if (threads != default_threads)
-    uv__free(threads);
+  uv__free(affinity);
+  affinity = NULL;
 
   uv_mutex_destroy(&mutex);
-  uv_cond_destroy(&cond);
 
-  threads = NULL;
+  workers = NULL;
   nthreads = 0;
+  max_threads = 0;
 }
 
 
 static void init_threads(void) {
+  struct uv__worker* wk;
   unsigned int i;
+  unsigned int k;
   const char* val;
   uv_sem_t sem;
 
-  nthreads = ARRAY_SIZE(default_threads);
+  nthreads = ARRAY_SIZE(default_workers);
   val = getenv("UV_THREADPOOL_SIZE");
   if (val != NULL)
     nthreads = atoi(val);
@@ -204,30 +567,67 @@ static void init_threads(void) {
   if (nthreads > MAX_THREADPOOL_SIZE)
     nthreads = MAX_THREADPOOL_SIZE;
 
-  threads = default_threads;
-  if (nthreads > ARRAY_SIZE(default_threads)) {
-    threads = uv__malloc(nthreads * sizeof(threads[0]));
-    if (threads == NULL) {
-      nthreads = ARRAY_SIZE(default_threads);
-      threads = default_threads;
+  max_threads = nthreads;
+  val = getenv("UV_THREADPOOL_MAX_SIZE");
+  if (val != NULL)
+    max_threads = atoi(val);
+  if (max_threads < nthreads)
+    max_threads = nthreads;
+  if (max_threads > MAX_THREADPOOL_SIZE)
+    max_threads = MAX_THREADPOOL_SIZE;
+
+  affinity = NULL;
+  val = getenv("UV_THREADPOOL_AFFINITY");
+  if (val != NULL && *val != '\0')
+    affinity = uv__strdup(val);
+
+  workers = default_workers;
+  if (max_threads > ARRAY_SIZE(default_workers)) {
+    workers = uv__malloc(max_threads * sizeof(workers[0]));
+    if (workers == NULL) {
+      if (nthreads > ARRAY_SIZE(default_workers))
+        nthreads = ARRAY_SIZE(default_workers);
+      max_threads = ARRAY_SIZE(default_workers);
+      workers = default_workers;
     }
   }
 
-  if (uv_cond_init(&cond))
-    abort();
-
   if (uv_mutex_init(&mutex))
     abort();
 
-  QUEUE_INIT(&wq);
-  QUEUE_INIT(&slow_io_pending_wq);
-  QUEUE_INIT(&run_slow_work_message);
+  QUEUE_INIT(&idle_workers);
+  nidle = 0;
+  cpu_work_running = 0;
+  slow_io_work_running = 0;
+  nactive = nthreads;
+  probing = 0;
+  exiting = 0;
 
   if (uv_sem_init(&sem, 0))
     abort();
 
+  for (i = 0; i < max_threads; i++) {
+    wk = workers + i;
+
+    if (uv_mutex_init(&wk->mutex))
+      abort();
+
+    if (uv_cond_init(&wk->cond))
+      abort();
+
+    for (k = 0; k < UV__WORK_KINDS; k++)
+      QUEUE_INIT(&wk->wq[k]);
+
+    QUEUE_INIT(&wk->idle_queue);
+    wk->wakeup = 0;
+    wk->extra = i >= nthreads;
+    wk->running = !wk->extra;
+    wk->joinable = 0;
+    wk->started = wk->extra ? NULL : &sem;
+  }
+
   for (i = 0; i < nthreads; i++)
-    if (uv_thread_create(threads + i, worker, &sem))
+    if (uv_thread_create(&workers[i].thread, worker, workers + i))
       abort();
 
   for (i = 0; i < nthreads; i++)
@@ -248,8 +648,7 @@ static void reset_once(void) {
 static void init_once(void) {
 #ifndef _WIN32
   /* Re-initialize the threadpool after fork.
-   * Note that this discards the global mutex and condition as well
-   * as the work queue.
+   * Note that this discards the global mutex as well as the work queues.
    */
   if (pthread_atfork(NULL, NULL, &reset_once))
     abort();
@@ -263,18 +662,33 @@ void uv__work_submit(uv_loop_t* loop,
                      enum uv__work_kind kind,
                      void (*work)(struct uv__work* w),
                      void (*done)(struct uv__work* w, int status)) {
+  uv__loop_internal_fields_t* lfields;
+  unsigned int n;
+
   uv_once(&once, init_once);
   w->loop = loop;
   w->work = work;
   w->done = done;
-  post(&w->wq, kind);
+
+  /* Requests are only ever submitted from the loop thread. */
+  lfields = uv__get_internal_fields(loop);
+  n = lfields->threadpool_cursor++ % nthreads;
+  lfields->threadpool_pending++;
+
+  post(workers + n, &w->wq, kind);
 }
 
 
 static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
+  unsigned int i;
   int cancelled;
 
-  uv_mutex_lock(&mutex);
+  /* The request can be in any of the workers' queues. Cancellation is rare
+   * enough that simply locking all of them is fine.
+   */
+  for (i = 0; i < nthreads; i++)
+    uv_mutex_lock(&workers[i].mutex);
+
   uv_mutex_lock(&w->loop->wq_mutex);
 
   cancelled = !QUEUE_EMPTY(&w->wq) && w->work != NULL;
@@ -282,7 +696,9 @@ static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
     QUEUE_REMOVE(&w->wq);
 
   uv_mutex_unlock(&w->loop->wq_mutex);
-  uv_mutex_unlock(&mutex);
+
+  for (i = nthreads; i > 0; i--)
+    uv_mutex_unlock(&workers[i - 1].mutex);
 
   if (!cancelled)
     return UV_EBUSY;
@@ -298,6 +714,7 @@ static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
 
 
 void uv__work_done(uv_async_t* handle) {
+  uv__loop_internal_fields_t* lfields;
   struct uv__work* w;
   uv_loop_t* loop;
   QUEUE* q;
@@ -305,6 +722,7 @@ void uv__work_done(uv_async_t* handle) {
   int err;
 
   loop = container_of(handle, uv_loop_t, wq_async);
+  lfields = uv__get_internal_fields(loop);
   uv_mutex_lock(&loop->wq_mutex);
   QUEUE_MOVE(&loop->wq, &wq);
   uv_mutex_unlock(&loop->wq_mutex);
@@ -315,6 +733,7 @@ void uv__work_done(uv_async_t* handle) {
 
     w = container_of(q, struct uv__work, wq);
     err = (w->work == uv__cancelled) ? UV_ECANCELED : 0;
+    lfields->threadpool_pending--;
     w->done(w, err);
   }
 }
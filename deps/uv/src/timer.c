@@ -24,6 +24,31 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
+
+/* Loops configured with UV_LOOP_USE_TIMER_WHEEL keep their timers in a
+ * hierarchical timer wheel instead of the heap. Starting and stopping a
+ * timer is O(1) but timeouts are rounded up to a whole number of ticks, and
+ * timers that expire in the same tick run in the order they were started.
+ *
+ * Level 0 has one slot per tick, every next level has slots that are
+ * UV__WHEEL_SLOTS times wider. Timers move down a level ("cascade") when
+ * the slot they're in comes up. While a timer is in the wheel, its heap_node
+ * is used as a QUEUE plus the index of the slot.
+ */
+#define UV__WHEEL_BITS 6
+#define UV__WHEEL_SLOTS (1 << UV__WHEEL_BITS)
+#define UV__WHEEL_LEVELS 8
+#define UV__WHEEL_MAX_DELTA                                                   \
+  (((uint64_t) 1 << (UV__WHEEL_BITS * UV__WHEEL_LEVELS)) - 1)
+
+struct uv__timer_wheel {
+  uint64_t granularity;  /* Milliseconds per tick. */
+  uint64_t tick;  /* The next tick to expire. */
+  unsigned int nelts;
+  uint64_t bitmap[UV__WHEEL_LEVELS];  /* Non-empty slots. */
+  QUEUE slots[UV__WHEEL_LEVELS][UV__WHEEL_SLOTS];
+};
 
 
 static struct heap *timer_heap(const uv_loop_t* loop) {
@@ -35,6 +60,206 @@ static struct heap *timer_heap(const uv_loop_t* loop) {
 }
 
 
+static struct uv__timer_wheel* timer_wheel(const uv_loop_t* loop) {
+  return uv__get_internal_fields(loop)->timer_wheel;
+}
+
+
+static QUEUE* timer_queue(uv_timer_t* handle) {
+  return (QUEUE*) &handle->heap_node;
+}
+
+
+static void wheel_insert(struct uv__timer_wheel* wheel, uv_timer_t* handle) {
+  uint64_t expires;
+  uint64_t delta;
+  unsigned int level;
+  unsigned int slot;
+
+  expires = handle->timeout / wheel->granularity;
+  if (handle->timeout % wheel->granularity != 0)
+    expires++;
+  if (expires < wheel->tick)
+    expires = wheel->tick;
+
+  delta = expires - wheel->tick;
+  for (level = 0; level < UV__WHEEL_LEVELS - 1; level++)
+    if (delta >> (UV__WHEEL_BITS * (level + 1)) == 0)
+      break;
+
+  /* Beyond the range of the wheel, park it in the farthest slot. */
+  if (delta > UV__WHEEL_MAX_DELTA)
+    expires = wheel->tick + UV__WHEEL_MAX_DELTA;
+
+  slot = (expires >> (UV__WHEEL_BITS * level)) & (UV__WHEEL_SLOTS - 1);
+  QUEUE_INSERT_TAIL(&wheel->slots[level][slot], timer_queue(handle));
+  handle->heap_node[2] = (void*) (uintptr_t) (level * UV__WHEEL_SLOTS + slot);
+  wheel->bitmap[level] |= (uint64_t) 1 << slot;
+  wheel->nelts++;
+}
+
+
+static void wheel_remove(struct uv__timer_wheel* wheel, uv_timer_t* handle) {
+  unsigned int level;
+  unsigned int slot;
+
+  level = (uintptr_t) handle->heap_node[2] / UV__WHEEL_SLOTS;
+  slot = (uintptr_t) handle->heap_node[2] % UV__WHEEL_SLOTS;
+
+  QUEUE_REMOVE(timer_queue(handle));
+  if (QUEUE_EMPTY(&wheel->slots[level][slot]))
+    wheel->bitmap[level] &= ~((uint64_t) 1 << slot);
+  wheel->nelts--;
+}
+
+
+/* Returns the distance from |from| to the next set bit, wrapping around. */
+static unsigned int wheel_next_slot(uint64_t bitmap, unsigned int from) {
+  unsigned int n;
+
+  if (from != 0)
+    bitmap = (bitmap >> from) | (bitmap << (UV__WHEEL_SLOTS - from));
+
+  for (n = 0; (bitmap & 1) == 0; n++)
+    bitmap >>= 1;
+
+  return n;
+}
+
+
+/* Returns the next tick at which a timer expires or has to cascade. */
+static uint64_t wheel_next_tick(const struct uv__timer_wheel* wheel) {
+  uint64_t next;
+  uint64_t base;
+  uint64_t tick;
+  unsigned int level;
+  unsigned int shift;
+  unsigned int n;
+
+  next = UINT64_MAX;
+  if (wheel->nelts == 0)
+    return next;
+
+  for (level = 0; level < UV__WHEEL_LEVELS; level++) {
+    if (wheel->bitmap[level] == 0)
+      continue;
+
+    shift = UV__WHEEL_BITS * level;
+    base = wheel->tick >> shift;
+    n = wheel_next_slot(wheel->bitmap[level], base & (UV__WHEEL_SLOTS - 1));
+    tick = (base + n) << shift;
+
+    /* The current slot of a higher level holds timers for its next round. */
+    if (tick < wheel->tick)
+      tick = (base + UV__WHEEL_SLOTS) << shift;
+
+    if (tick < next)
+      next = tick;
+  }
+
+  return next;
+}
+
+
+static void wheel_cascade(struct uv__timer_wheel* wheel,
+                          unsigned int level,
+                          unsigned int slot) {
+  QUEUE* q;
+  QUEUE timers;
+
+  QUEUE_MOVE(&wheel->slots[level][slot], &timers);
+  wheel->bitmap[level] &= ~((uint64_t) 1 << slot);
+
+  while (!QUEUE_EMPTY(&timers)) {
+    q = QUEUE_HEAD(&timers);
+    QUEUE_REMOVE(q);
+    wheel->nelts--;
+    wheel_insert(wheel, container_of((void**) q, uv_timer_t, heap_node[0]));
+  }
+}
+
+
+static void wheel_run_timers(uv_loop_t* loop, struct uv__timer_wheel* wheel) {
+  uv_timer_t* handle;
+  uint64_t now;
+  uint64_t tick;
+  unsigned int level;
+  unsigned int shift;
+  QUEUE* q;
+  QUEUE ready;
+
+  now = loop->time / wheel->granularity;
+
+  while ((tick = wheel_next_tick(wheel)) <= now) {
+    wheel->tick = tick;
+
+    for (level = 1; level < UV__WHEEL_LEVELS; level++) {
+      shift = UV__WHEEL_BITS * level;
+      if (tick & (((uint64_t) 1 << shift) - 1))
+        break;
+      wheel_cascade(wheel, level, (tick >> shift) & (UV__WHEEL_SLOTS - 1));
+    }
+
+    /* Timers started from the callbacks go into the next tick. */
+    QUEUE_MOVE(&wheel->slots[0][tick & (UV__WHEEL_SLOTS - 1)], &ready);
+    wheel->bitmap[0] &= ~((uint64_t) 1 << (tick & (UV__WHEEL_SLOTS - 1)));
+    wheel->tick = tick + 1;
+
+    while (!QUEUE_EMPTY(&ready)) {
+      q = QUEUE_HEAD(&ready);
+      handle = container_of((void**) q, uv_timer_t, heap_node[0]);
+      uv_timer_stop(handle);
+      uv_timer_again(handle);
+      handle->timer_cb(handle);
+    }
+  }
+
+  if (wheel->tick <= now)
+    wheel->tick = now + 1;
+}
+
+
+int uv__timer_wheel_configure(uv_loop_t* loop, unsigned int granularity) {
+  struct uv__timer_wheel* wheel;
+  unsigned int level;
+  unsigned int slot;
+
+  if (granularity == 0)
+    return UV_EINVAL;
+
+  wheel = timer_wheel(loop);
+
+  /* Timers can't be moved between the heap and the wheel. */
+  if (timer_heap(loop)->nelts != 0 || (wheel != NULL && wheel->nelts != 0))
+    return UV_EBUSY;
+
+  if (wheel == NULL) {
+    wheel = uv__malloc(sizeof(*wheel));
+    if (wheel == NULL)
+      return UV_ENOMEM;
+  }
+
+  for (level = 0; level < UV__WHEEL_LEVELS; level++) {
+    wheel->bitmap[level] = 0;
+    for (slot = 0; slot < UV__WHEEL_SLOTS; slot++)
+      QUEUE_INIT(&wheel->slots[level][slot]);
+  }
+
+  wheel->granularity = granularity;
+  wheel->tick = loop->time / granularity;
+  wheel->nelts = 0;
+  uv__get_internal_fields(loop)->timer_wheel = wheel;
+
+  return 0;
+}
+
+
+void uv__timer_wheel_delete(uv_loop_t* loop) {
+  uv__free(timer_wheel(loop));
+  uv__get_internal_fields(loop)->timer_wheel = NULL;
+}
+
+
 static int timer_less_than(const struct heap_node* ha,
                            const struct heap_node* hb) {
   const uv_timer_t* a;
@@ -86,9 +311,12 @@ int uv_timer_start(uv_timer_t* handle,
   /* start_id is the second index to be compared in timer_less_than() */
   handle->start_id = handle->loop->timer_counter++;
 
-  heap_insert(timer_heap(handle->loop),
-              (struct heap_node*) &handle->heap_node,
-              timer_less_than);
+  if (timer_wheel(handle->loop) != NULL)
+    wheel_insert(timer_wheel(handle->loop), handle);
+  else
+    heap_insert(timer_heap(handle->loop),
+                (struct heap_node*) &handle->heap_node,
+                timer_less_than);
   uv__handle_start(handle);
 
   return 0;
@@ -99,9 +327,12 @@ int uv_timer_stop(uv_timer_t* handle) {
   if (!uv__is_active(handle))
     return 0;
 
-  heap_remove(timer_heap(handle->loop),
-              (struct heap_node*) &handle->heap_node,
-              timer_less_than);
+  if (timer_wheel(handle->loop) != NULL)
+    wheel_remove(timer_wheel(handle->loop), handle);
+  else
+    heap_remove(timer_heap(handle->loop),
+                (struct heap_node*) &handle->heap_node,
+                timer_less_than);
   uv__handle_stop(handle);
 
   return 0;
@@ -143,6 +374,26 @@ int uv__next_timeout(const uv_loop_t* loop) {
   const struct heap_node* heap_node;
   const uv_timer_t* handle;
   uint64_t diff;
+  uint64_t tick;
+
+  if (timer_wheel(loop) != NULL) {
+    tick = wheel_next_tick(timer_wheel(loop));
+    if (tick == UINT64_MAX)
+      return -1; /* block indefinitely */
+
+    if (tick > UINT64_MAX / timer_wheel(loop)->granularity)
+      return INT_MAX;
+
+    tick *= timer_wheel(loop)->granularity;
+    if (tick <= loop->time)
+      return 0;
+
+    diff = tick - loop->time;
+    if (diff > INT_MAX)
+      diff = INT_MAX;
+
+    return (int) diff;
+  }
 
   heap_node = heap_min(timer_heap(loop));
   if (heap_node == NULL)
@@ -164,6 +415,11 @@ void uv__run_timers(uv_loop_t* loop) {
   struct heap_node* heap_node;
   uv_timer_t* handle;
 
+  if (timer_wheel(loop) != NULL) {
+    wheel_run_timers(loop, timer_wheel(loop));
+    return;
+  }
+
   for (;;) {
     heap_node = heap_min(timer_heap(loop));
     if (heap_node == NULL)
@@ -120,6 +120,7 @@ void uv__async_close(uv_async_t* handle) {
 
 
 static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  uv__loop_internal_fields_t* lfields;
   char buf[1024];
   ssize_t r;
   QUEUE queue;
@@ -127,6 +128,7 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   uv_async_t* h;
 
   assert(w == &loop->async_io_watcher);
+  lfields = uv__get_internal_fields(loop);
 
   for (;;) {
     r = read(w->fd, buf, sizeof(buf));
@@ -146,6 +148,12 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
     abort();
   }
 
+  /* From here on senders have to wake us up again. Clearing the flag before
+   * looking at the handles means a sender that skipped the write because the
+   * flag was still set has already marked its handle as pending.
+   */
+  cmpxchgi(&lfields->async_wakeup_pending, 1, 0);
+
   QUEUE_MOVE(&loop->async_handles, &queue);
   while (!QUEUE_EMPTY(&queue)) {
     q = QUEUE_HEAD(&queue);
@@ -165,12 +173,24 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 }
 
 
+/* All async handles of a loop share one eventfd or pipe, and uv__async_io()
+ * looks at every handle once it runs. So one write per wakeup is enough, no
+ * matter how many handles are sent to before the loop thread gets to them.
+ */
 static void uv__async_send(uv_loop_t* loop) {
+  uv__loop_internal_fields_t* lfields;
   const void* buf;
   ssize_t len;
   int fd;
   int r;
 
+  lfields = uv__get_internal_fields(loop);
+  if (ACCESS_ONCE(int, lfields->async_wakeup_pending) != 0)
+    return;
+
+  if (cmpxchgi(&lfields->async_wakeup_pending, 0, 1) != 0)
+    return;
+
   buf = "";
   len = 1;
   fd = loop->async_wfd;
@@ -222,6 +242,7 @@ static int uv__async_start(uv_loop_t* loop) {
   uv__io_init(&loop->async_io_watcher, uv__async_io, pipefd[0]);
   uv__io_start(loop, &loop->async_io_watcher, POLLIN);
   loop->async_wfd = pipefd[1];
+  uv__get_internal_fields(loop)->async_wakeup_pending = 0;
 
   return 0;
 }
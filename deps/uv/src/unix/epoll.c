@@ -23,6 +23,11 @@
 #include "internal.h"
 #include <errno.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+
+#ifndef EPOLLEXCLUSIVE
+# define EPOLLEXCLUSIVE (1u << 28)
+#endif
 
 int uv__epoll_init(uv_loop_t* loop) {
   int fd;
@@ -100,6 +105,41 @@ int uv__io_check_fd(uv_loop_t* loop, int fd) {
 }
 
 
+/* Only one of the loops that share a listening socket needs to wake up
+ * for a new connection. Everything else, and listening sockets that are
+ * also watched for writability, can't use EPOLLEXCLUSIVE because it doesn't
+ * support EPOLL_CTL_MOD.
+ */
+static int uv__epoll_exclusive(uv_loop_t* loop, uv__io_t* w) {
+  socklen_t len;
+  int val;
+
+  if (!uv__get_internal_fields(loop)->epoll_exclusive)
+    return 0;
+
+  if (w->pevents != POLLIN)
+    return 0;
+
+  len = sizeof(val);
+  if (getsockopt(w->fd, SOL_SOCKET, SO_ACCEPTCONN, &val, &len))
+    return 0;
+
+  return val != 0;
+}
+
+
+/* EPOLLEXCLUSIVE can't be combined with EPOLL_CTL_MOD, the registration has
+ * to be removed and added again instead.
+ */
+static void uv__epoll_ctl_readd(int epfd, int fd, struct epoll_event* e) {
+  if (epoll_ctl(epfd, EPOLL_CTL_DEL, fd, e))
+    abort();
+
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, e))
+    abort();
+}
+
+
 void uv__io_poll(uv_loop_t* loop, int timeout) {
   /* A bug in kernels < 2.6.37 makes timeouts larger than ~30 minutes
    * effectively infinite on 32 bits architectures.  To avoid blocking
@@ -117,6 +157,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   struct epoll_event events[1024];
   struct epoll_event* pe;
   struct epoll_event e;
+  struct uv__iou* iou;
   int real_timeout;
   QUEUE* q;
   uv__io_t* w;
@@ -132,8 +173,19 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   int i;
   int user_timeout;
   int reset_timeout;
+  int poll_timeout;
+  uint64_t busy_until;
+  uint64_t cb_start;
+
+  iou = &uv__get_internal_fields(loop)->iou;
 
-  if (loop->nfds == 0) {
+  /* Hand queued io_uring requests to the kernel before going to sleep.
+   * Don't block if the kernel couldn't take all of them right now.
+   */
+  if (uv__iou_flush(iou))
+    timeout = 0;
+
+  if (loop->nfds == 0 && iou->in_flight == 0) {
     assert(QUEUE_EMPTY(&loop->watcher_queue));
     return;
   }
@@ -158,18 +210,28 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     else
       op = EPOLL_CTL_MOD;
 
+    if (op == EPOLL_CTL_ADD && uv__epoll_exclusive(loop, w))
+      e.events |= EPOLLEXCLUSIVE;
+
     /* XXX Future optimization: do EPOLL_CTL_MOD lazily if we stop watching
      * events, skip the syscall and squelch the events after epoll_wait().
      */
     if (epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
-      if (errno != EEXIST)
-        abort();
-
-      assert(op == EPOLL_CTL_ADD);
-
-      /* We've reactivated a file descriptor that's been watched before. */
-      if (epoll_ctl(loop->backend_fd, EPOLL_CTL_MOD, w->fd, &e))
-        abort();
+      if (op == EPOLL_CTL_MOD && errno == EINVAL) {
+        /* The file descriptor was added with EPOLLEXCLUSIVE. */
+        uv__epoll_ctl_readd(loop->backend_fd, w->fd, &e);
+      } else {
+        if (errno != EEXIST)
+          abort();
+
+        assert(op == EPOLL_CTL_ADD);
+
+        /* We've reactivated a file descriptor that's been watched before. */
+        if (e.events & EPOLLEXCLUSIVE)
+          uv__epoll_ctl_readd(loop->backend_fd, w->fd, &e);
+        else if (epoll_ctl(loop->backend_fd, EPOLL_CTL_MOD, w->fd, &e))
+          uv__epoll_ctl_readd(loop->backend_fd, w->fd, &e);
+      }
     }
 
     w->events = w->pevents;
@@ -205,6 +267,14 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   no_epoll_pwait = uv__load_relaxed(&no_epoll_pwait_cached);
   no_epoll_wait = uv__load_relaxed(&no_epoll_wait_cached);
 
+  /* With UV_LOOP_BUSY_POLL, spin on non-blocking polls for a while before
+   * going to sleep. Trades CPU time for lower wakeup latency.
+   */
+  busy_until = 0;
+  if (uv__get_internal_fields(loop)->busy_poll != 0)
+    busy_until = uv__hrtime(UV_CLOCK_PRECISE) +
+                 uv__get_internal_fields(loop)->busy_poll * (uint64_t) 1000;
+
   for (;;) {
     /* Only need to set the provider_entry_time if timeout != 0. The function
      * will return early if the loop isn't configured with UV_METRICS_IDLE_TIME.
@@ -218,6 +288,23 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     if (sizeof(int32_t) == sizeof(long) && timeout >= max_safe_timeout)
       timeout = max_safe_timeout;
 
+    poll_timeout = timeout;
+    if (busy_until != 0 && timeout != 0) {
+      if (uv__hrtime(UV_CLOCK_PRECISE) < busy_until) {
+        poll_timeout = 0;
+      } else {
+        busy_until = 0;
+
+        /* Don't sleep for longer than asked because of the spinning. */
+        if (timeout > 0) {
+          if (real_timeout <= (int) (loop->time - base))
+            return;
+          timeout = real_timeout - (int) (loop->time - base);
+          poll_timeout = timeout;
+        }
+      }
+    }
+
     if (sigmask != 0 && no_epoll_pwait != 0)
       if (pthread_sigmask(SIG_BLOCK, &sigset, NULL))
         abort();
@@ -226,7 +313,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       nfds = epoll_pwait(loop->backend_fd,
                          events,
                          ARRAY_SIZE(events),
-                         timeout,
+                         poll_timeout,
                          &sigset);
       if (nfds == -1 && errno == ENOSYS) {
         uv__store_relaxed(&no_epoll_pwait_cached, 1);
@@ -236,7 +323,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       nfds = epoll_wait(loop->backend_fd,
                         events,
                         ARRAY_SIZE(events),
-                        timeout);
+                        poll_timeout);
       if (nfds == -1 && errno == ENOSYS) {
         uv__store_relaxed(&no_epoll_wait_cached, 1);
         no_epoll_wait = 1;
@@ -253,8 +340,16 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      */
     SAVE_ERRNO(uv__update_time(loop));
 
+    /* Spins of the busy poll loop don't count as separate polls. */
+    if (nfds != 0 || poll_timeout == timeout)
+      uv__metrics_inc_poll_count(loop);
+
     if (nfds == 0) {
-      assert(timeout != -1);
+      assert(poll_timeout != -1);
+
+      /* Still busy polling. */
+      if (poll_timeout != timeout)
+        continue;
 
       if (reset_timeout != 0) {
         timeout = user_timeout;
@@ -300,6 +395,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
     have_signals = 0;
     nevents = 0;
+    cb_start = uv__metrics_callbacks_start(loop);
 
     {
       /* Squelch a -Waddress-of-packed-member warning with gcc >= 9. */
@@ -322,6 +418,12 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       if (fd == -1)
         continue;
 
+      if (fd == iou->ringfd) {
+        uv__poll_io_uring(loop, iou);
+        nevents++;
+        continue;
+      }
+
       assert(fd >= 0);
       assert((unsigned) fd < loop->nwatchers);
 
@@ -388,6 +490,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       loop->signal_io_watcher.cb(loop, &loop->signal_io_watcher, POLLIN);
     }
 
+    uv__metrics_callbacks_end(loop, cb_start, nevents);
+
     loop->watchers[loop->nwatchers] = NULL;
     loop->watchers[loop->nwatchers + 1] = NULL;
 
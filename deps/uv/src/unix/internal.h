@@ -325,8 +325,36 @@ UV_UNUSED(static char* uv__basename_r(const char* path)) {
 
 #if defined(__linux__)
 int uv__inotify_fork(uv_loop_t* loop, void* old_watchers);
+unsigned uv__kernel_version(void);
+unsigned int uv__cgroup_cpu_limit(void);
+
+/* io_uring */
+void uv__iou_init(struct uv__iou* iou);
+void uv__iou_delete(struct uv__iou* iou);
+int uv__iou_flush(struct uv__iou* iou);
+void uv__poll_io_uring(uv_loop_t* loop, struct uv__iou* iou);
+int uv__iou_fs_close(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_fsync_or_fdatasync(uv_loop_t* loop,
+                                  uv_fs_t* req,
+                                  uint32_t fsync_flags);
+int uv__iou_fs_open(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_read_or_write(uv_loop_t* loop, uv_fs_t* req, int is_read);
+int uv__iou_fs_statx(uv_loop_t* loop,
+                     uv_fs_t* req,
+                     int is_fstat,
+                     int is_lstat);
+void uv__statx_to_stat(const struct uv__statx* statxbuf, uv_stat_t* buf);
+#else
+#define uv__iou_fs_close(loop, req) 0
+#define uv__iou_fs_fsync_or_fdatasync(loop, req, fsync_flags) 0
+#define uv__iou_fs_open(loop, req) 0
+#define uv__iou_fs_read_or_write(loop, req, is_read) 0
+#define uv__iou_fs_statx(loop, req, is_fstat, is_lstat) 0
 #endif
 
+/* fs */
+void uv__fs_post(uv_loop_t* loop, uv_fs_t* req);
+
 typedef int (*uv__peersockfunc)(int, struct sockaddr*, socklen_t*);
 
 int uv__getsockpeername(const uv_handle_t* handle,
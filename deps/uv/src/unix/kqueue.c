@@ -121,6 +121,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   sigset_t set;
   uint64_t base;
   uint64_t diff;
+  uint64_t cb_start;
   int have_signals;
   int filter;
   int fflags;
@@ -242,6 +243,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * operating system didn't reschedule our process while in the syscall.
      */
     SAVE_ERRNO(uv__update_time(loop));
+    uv__metrics_inc_poll_count(loop);
 
     if (nfds == 0) {
       if (reset_timeout != 0) {
@@ -278,6 +280,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
     have_signals = 0;
     nevents = 0;
+    cb_start = uv__metrics_callbacks_start(loop);
 
     assert(loop->watchers != NULL);
     loop->watchers[loop->nwatchers] = (void*) events;
@@ -387,6 +390,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       loop->signal_io_watcher.cb(loop, &loop->signal_io_watcher, POLLIN);
     }
 
+    uv__metrics_callbacks_end(loop, cb_start, nevents);
+
     loop->watchers[loop->nwatchers] = NULL;
     loop->watchers[loop->nwatchers + 1] = NULL;
 
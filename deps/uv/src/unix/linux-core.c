@@ -27,6 +27,7 @@
 #include "internal.h"
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -87,6 +88,8 @@ int uv__platform_loop_init(uv_loop_t* loop) {
   loop->inotify_fd = -1;
   loop->inotify_watchers = NULL;
 
+  uv__iou_init(&uv__get_internal_fields(loop)->iou);
+
   return uv__epoll_init(loop);
 }
 
@@ -110,6 +113,8 @@ int uv__io_fork(uv_loop_t* loop) {
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__iou_delete(&uv__get_internal_fields(loop)->iou);
+
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
   uv__close(loop->inotify_fd);
@@ -816,27 +821,154 @@ uint64_t uv_get_total_memory(void) {
 }
 
 
-static uint64_t uv__read_cgroups_uint64(const char* cgroup, const char* param) {
-  char filename[256];
-  char buf[32];  /* Large enough to hold an encoded uint64_t. */
-  uint64_t rc;
+/* Finds the cgroup of the process in /proc/self/cgroup: the cgroup v1 one
+ * whose controllers include `controller`, or the cgroup v2 one when
+ * `controller` is NULL.
+ */
+static int uv__cgroup_path(const char* controller, char* path, size_t size) {
+  char buf[4096];
+  char* line;
+  char* next;
+  char* controllers;
+  char* cgroup;
+  char* name;
+  size_t len;
+
+  if (uv__slurp("/proc/self/cgroup", buf, sizeof(buf)))
+    return UV_ENOENT;
+
+  for (line = buf; *line != '\0'; line = next) {
+    next = strchr(line, '\n');
+    if (next != NULL)
+      *next++ = '\0';
+    else
+      next = line + strlen(line);
+
+    /* hierarchy-ID:controller-list:cgroup-path */
+    controllers = strchr(line, ':');
+    if (controllers == NULL)
+      continue;
+    controllers++;
+    cgroup = strchr(controllers, ':');
+    if (cgroup == NULL)
+      continue;
+    *cgroup++ = '\0';
 
-  rc = 0;
-  snprintf(filename, sizeof(filename), "/sys/fs/cgroup/%s/%s", cgroup, param);
-  if (0 == uv__slurp(filename, buf, sizeof(buf)))
-    sscanf(buf, "%" PRIu64, &rc);
+    if (controller == NULL) {
+      if (*controllers != '\0')
+        continue;
+    } else {
+      len = strlen(controller);
+      for (name = controllers; name != NULL; name = strchr(name, ',')) {
+        if (*name == ',')
+          name++;
+        if (strncmp(name, controller, len) == 0 &&
+            (name[len] == ',' || name[len] == '\0')) {
+          break;
+        }
+      }
+      if (name == NULL)
+        continue;
+    }
 
-  return rc;
+    if ((size_t) snprintf(path, size, "%s", cgroup) >= size)
+      return UV_ENAMETOOLONG;
+    return 0;
+  }
+
+  return UV_ENOENT;
+}
+
+
+/* Reads `file` of the cgroup of the process under the hierarchy mounted at
+ * `mount`. Containers usually have their own cgroup mounted at the root of
+ * the hierarchy, which /proc/self/cgroup does not always reflect, so the
+ * root is tried when the cgroup of the process is not there.
+ */
+static int uv__cgroup_read(const char* mount,
+                           const char* controller,
+                           const char* file,
+                           char* buf,
+                           size_t len) {
+  char cgroup[1024];
+  char filename[2048];
+
+  if (0 == uv__cgroup_path(controller, cgroup, sizeof(cgroup)) &&
+      strcmp(cgroup, "/") != 0) {
+    snprintf(filename, sizeof(filename), "%s%s/%s", mount, cgroup, file);
+    if (0 == uv__slurp(filename, buf, len))
+      return 0;
+  }
+
+  snprintf(filename, sizeof(filename), "%s/%s", mount, file);
+  return uv__slurp(filename, buf, len);
+}
+
+
+static int uv__cgroup2(void) {
+  return 0 == access("/sys/fs/cgroup/cgroup.controllers", F_OK);
 }
 
 
 uint64_t uv_get_constrained_memory(void) {
+  char buf[32];  /* Large enough to hold an encoded uint64_t. */
+  uint64_t rc;
+
   /*
    * This might return 0 if there was a problem getting the memory limit from
    * cgroups. This is OK because a return value of 0 signifies that the memory
    * limit is unknown.
    */
-  return uv__read_cgroups_uint64("memory", "memory.limit_in_bytes");
+  rc = 0;
+  if (uv__cgroup2()) {
+    /* "max" when there is no limit. */
+    if (0 == uv__cgroup_read("/sys/fs/cgroup", NULL, "memory.max",
+                             buf, sizeof(buf)))
+      sscanf(buf, "%" PRIu64, &rc);
+  } else {
+    if (0 == uv__cgroup_read("/sys/fs/cgroup/memory", "memory",
+                             "memory.limit_in_bytes", buf, sizeof(buf)))
+      sscanf(buf, "%" PRIu64, &rc);
+    /* The kernel reports the lack of a limit as LONG_MAX rounded down to a
+     * multiple of the page size. */
+    if (rc >= (UINT64_C(1) << 62))
+      rc = 0;
+  }
+
+  return rc;
+}
+
+
+/* Returns the number of CPUs that the CPU quota of the cgroup of the process
+ * amounts to, rounded up, or 0 if there is no quota.
+ */
+unsigned int uv__cgroup_cpu_limit(void) {
+  char buf[64];
+  long long quota;
+  long long period;
+
+  quota = -1;
+  period = 0;
+  if (uv__cgroup2()) {
+    /* "$MAX $PERIOD", with $MAX being "max" when there is no quota. */
+    if (0 == uv__cgroup_read("/sys/fs/cgroup", NULL, "cpu.max",
+                             buf, sizeof(buf)))
+      if (2 != sscanf(buf, "%lld %lld", &quota, &period))
+        quota = -1;
+  } else {
+    if (0 == uv__cgroup_read("/sys/fs/cgroup/cpu", "cpu",
+                             "cpu.cfs_quota_us", buf, sizeof(buf)))
+      sscanf(buf, "%lld", &quota);
+    if (0 == uv__cgroup_read("/sys/fs/cgroup/cpu", "cpu",
+                             "cpu.cfs_period_us", buf, sizeof(buf)))
+      sscanf(buf, "%lld", &period);
+  }
+
+  if (quota <= 0 || period <= 0)
+    return 0;
+  if (quota / period >= UINT_MAX)
+    return UINT_MAX;
+  return (unsigned int) ((quota + period - 1) / period);
 }
 
 
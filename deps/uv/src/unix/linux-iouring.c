@@ -0,0 +1,529 @@
+/* Copyright libuv contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* io_uring support for uv_fs_t requests.
+ *
+ * Eligible requests are turned into submission queue entries instead of
+ * being posted to the threadpool. Entries are batched and handed to the
+ * kernel with a single io_uring_enter() call right before the event loop
+ * blocks in epoll_wait(). The ring file descriptor is registered with the
+ * epoll set so completions wake up the loop; uv__io_poll() hands them to
+ * uv__poll_io_uring(). Anything the ring can't take (old kernel, full ring,
+ * unsupported operation) falls back to the threadpool transparently.
+ *
+ * Set UV_USE_IO_URING=0 in the environment to disable the ring altogether.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef AT_EMPTY_PATH
+# define AT_EMPTY_PATH 0x1000
+#endif
+
+/* Number of submission queue entries. The kernel sizes the completion queue
+ * at twice that.
+ */
+#define UV__IOU_ENTRIES 64
+
+STATIC_ASSERT(64 == sizeof(struct uv__io_uring_sqe));
+STATIC_ASSERT(16 == sizeof(struct uv__io_uring_cqe));
+STATIC_ASSERT(40 == sizeof(struct uv__io_sqring_offsets));
+STATIC_ASSERT(40 == sizeof(struct uv__io_cqring_offsets));
+STATIC_ASSERT(120 == sizeof(struct uv__io_uring_params));
+
+static int no_iou_statx;
+
+
+static int uv__use_io_uring(void) {
+  static int use_io_uring;  /* 0 = undecided, 1 = yes, -1 = no. */
+  const char* val;
+  int use;
+
+  use = uv__load_relaxed(&use_io_uring);
+  if (use == 0) {
+    /* Kernels older than 5.10 (the first longterm release with a mature
+     * io_uring) are too buggy to be worth the trouble.
+     */
+    use = uv__kernel_version() >= /* 5.10.0 */ 0x050A00 ? 1 : -1;
+
+    val = getenv("UV_USE_IO_URING");
+    if (val != NULL)
+      use = atoi(val) ? use : -1;
+
+    uv__store_relaxed(&use_io_uring, use);
+  }
+
+  return use > 0;
+}
+
+
+void uv__iou_init(struct uv__iou* iou) {
+  memset(iou, 0, sizeof(*iou));
+  iou->ringfd = -2;  /* Set up lazily, on first use. */
+}
+
+
+static void uv__iou_setup(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_params params;
+  struct epoll_event e;
+  size_t cqlen;
+  size_t sqlen;
+  size_t maxlen;
+  size_t sqelen;
+  uint32_t i;
+  char* sq;
+  char* sqe;
+  int ringfd;
+
+  iou->ringfd = -1;  /* Assume failure, don't retry. */
+
+  if (!uv__use_io_uring())
+    return;
+
+  memset(&params, 0, sizeof(params));
+  ringfd = uv__io_uring_setup(UV__IOU_ENTRIES, &params);
+  if (ringfd == -1)
+    return;
+
+  sq = MAP_FAILED;
+  sqe = MAP_FAILED;
+
+  /* IORING_FEAT_RW_CUR_POS was added in 5.6, the same release that added
+   * IORING_OP_OPENAT, IORING_OP_CLOSE and IORING_OP_STATX. IORING_FEAT_NODROP
+   * guarantees completions are never lost when the completion queue is full.
+   */
+  if (!(params.features & UV__IORING_FEAT_SINGLE_MMAP))
+    goto fail;
+
+  if (!(params.features & UV__IORING_FEAT_NODROP))
+    goto fail;
+
+  if (!(params.features & UV__IORING_FEAT_RW_CUR_POS))
+    goto fail;
+
+  sqlen = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqlen =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct uv__io_uring_cqe);
+  maxlen = sqlen < cqlen ? cqlen : sqlen;
+  sqelen = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+
+  sq = mmap(0,
+            maxlen,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ringfd,
+            UV__IORING_OFF_SQ_RING);
+
+  sqe = mmap(0,
+             sqelen,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             ringfd,
+             UV__IORING_OFF_SQES);
+
+  if (sq == MAP_FAILED || sqe == MAP_FAILED)
+    goto fail;
+
+  memset(&e, 0, sizeof(e));
+  e.events = POLLIN;
+  e.data.fd = ringfd;
+
+  if (epoll_ctl(loop->backend_fd, EPOLL_CTL_ADD, ringfd, &e))
+    goto fail;
+
+  iou->sqhead = (uint32_t*) (sq + params.sq_off.head);
+  iou->sqtail = (uint32_t*) (sq + params.sq_off.tail);
+  iou->sqmask = *(uint32_t*) (sq + params.sq_off.ring_mask);
+  iou->sqarray = (uint32_t*) (sq + params.sq_off.array);
+  iou->cqhead = (uint32_t*) (sq + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (sq + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (sq + params.cq_off.ring_mask);
+  iou->cqentries = *(uint32_t*) (sq + params.cq_off.ring_entries);
+  iou->sq = sq;
+  iou->cqe = sq + params.cq_off.cqes;
+  iou->sqe = sqe;
+  iou->maxlen = maxlen;
+  iou->sqelen = sqelen;
+  iou->ringfd = ringfd;
+  iou->in_flight = 0;
+
+  /* Submission queue slots map one-to-one to submission queue entries. */
+  for (i = 0; i <= iou->sqmask; i++)
+    iou->sqarray[i] = i;
+
+  return;
+
+fail:
+  if (sq != MAP_FAILED)
+    munmap(sq, maxlen);
+
+  if (sqe != MAP_FAILED)
+    munmap(sqe, sqelen);
+
+  uv__close(ringfd);
+}
+
+
+void uv__iou_delete(struct uv__iou* iou) {
+  if (iou->ringfd >= 0) {
+    munmap(iou->sq, iou->maxlen);
+    munmap(iou->sqe, iou->sqelen);
+    uv__close(iou->ringfd);
+  }
+
+  iou->ringfd = -1;
+}
+
+
+/* Returns non-zero when entries are still waiting to be submitted, i.e. when
+ * the kernel temporarily refused to take them.
+ */
+int uv__iou_flush(struct uv__iou* iou) {
+  uint32_t head;
+  uint32_t tail;
+  int rc;
+
+  if (iou->ringfd < 0)
+    return 0;
+
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+  tail = *iou->sqtail;
+
+  if (head == tail)
+    return 0;
+
+  do
+    rc = uv__io_uring_enter(iou->ringfd, tail - head, 0, 0);
+  while (rc == -1 && errno == EINTR);
+
+  if (rc == -1) {
+    /* Out of memory or too many pending completions. The entries stay in
+     * the submission queue and are retried on the next flush.
+     */
+    if (errno != EAGAIN && errno != EBUSY)
+      abort();
+
+    return 1;
+  }
+
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+  return head != tail;
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(struct uv__iou* iou,
+                                                uv_loop_t* loop,
+                                                uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  uint32_t head;
+  uint32_t tail;
+
+  if (iou->ringfd == -2)
+    uv__iou_setup(loop, iou);
+
+  if (iou->ringfd == -1)
+    return NULL;
+
+  /* Don't overcommit the completion queue, the kernel would have to buffer
+   * the excess completions and io_uring_enter() would start failing.
+   */
+  if (iou->in_flight >= iou->cqentries)
+    return NULL;
+
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+  tail = *iou->sqtail;
+
+  if (tail - head > iou->sqmask) {
+    /* Submission queue is full. Push out what we have and try again. */
+    uv__iou_flush(iou);
+    head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+    if (tail - head > iou->sqmask)
+      return NULL;
+  }
+
+  sqe = iou->sqe;
+  sqe = &sqe[tail & iou->sqmask];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uintptr_t) req;
+
+  /* Make uv_cancel() report UV_EBUSY, the request is owned by the kernel. */
+  req->work_req.loop = loop;
+  req->work_req.work = NULL;
+  req->work_req.done = NULL;
+  QUEUE_INIT(&req->work_req.wq);
+
+  uv__req_register(loop, req);
+  iou->in_flight++;
+
+  return sqe;
+}
+
+
+static void uv__iou_submit(struct uv__iou* iou) {
+  /* The kernel picks up the entry on the next uv__iou_flush(). */
+  __atomic_store_n(iou->sqtail, *iou->sqtail + 1, __ATOMIC_RELEASE);
+}
+
+
+int uv__iou_fs_close(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  /* Kernels before 6.1 defer the final fput() of an IORING_OP_CLOSE to a
+   * task work item. Writing a file and then trying to execve() it can then
+   * fail with ETXTBSY because the file is still open for writing.
+   */
+  if (uv__kernel_version() < /* 6.1.0 */ 0x060100)
+    return 0;
+
+  iou = &uv__get_internal_fields(loop)->iou;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->fd = req->file;
+  sqe->opcode = UV__IORING_OP_CLOSE;
+
+  uv__iou_submit(iou);
+
+  return 1;
+}
+
+
+int uv__iou_fs_fsync_or_fdatasync(uv_loop_t* loop,
+                                  uv_fs_t* req,
+                                  uint32_t fsync_flags) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = &uv__get_internal_fields(loop)->iou;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->fd = req->file;
+  sqe->fsync_flags = fsync_flags;
+  sqe->opcode = UV__IORING_OP_FSYNC;
+
+  uv__iou_submit(iou);
+
+  return 1;
+}
+
+
+int uv__iou_fs_open(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = &uv__get_internal_fields(loop)->iou;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->addr = (uintptr_t) req->path;
+  sqe->fd = AT_FDCWD;
+  sqe->len = req->mode;
+  sqe->opcode = UV__IORING_OP_OPENAT;
+  sqe->open_flags = req->flags | O_CLOEXEC;
+
+  uv__iou_submit(iou);
+
+  return 1;
+}
+
+
+int uv__iou_fs_read_or_write(uv_loop_t* loop, uv_fs_t* req, int is_read) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  /* The threadpool splits up requests that exceed IOV_MAX, the kernel would
+   * reject them with EINVAL.
+   */
+  if (req->nbufs > (unsigned int) uv__getiovmax())
+    return 0;
+
+  iou = &uv__get_internal_fields(loop)->iou;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  /* uv_buf_t is layout-compatible with struct iovec on Linux and an offset
+   * of -1 means "use and update the file position" (IORING_FEAT_RW_CUR_POS).
+   */
+  sqe->addr = (uintptr_t) req->bufs;
+  sqe->fd = req->file;
+  sqe->len = req->nbufs;
+  sqe->off = req->off < 0 ? -1 : req->off;
+  sqe->opcode = is_read ? UV__IORING_OP_READV : UV__IORING_OP_WRITEV;
+
+  uv__iou_submit(iou);
+
+  return 1;
+}
+
+
+int uv__iou_fs_statx(uv_loop_t* loop,
+                     uv_fs_t* req,
+                     int is_fstat,
+                     int is_lstat) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__statx* statxbuf;
+  struct uv__iou* iou;
+
+  if (uv__load_relaxed(&no_iou_statx))
+    return 0;
+
+  statxbuf = uv__malloc(sizeof(*statxbuf));
+  if (statxbuf == NULL)
+    return 0;
+
+  iou = &uv__get_internal_fields(loop)->iou;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL) {
+    uv__free(statxbuf);
+    return 0;
+  }
+
+  req->ptr = statxbuf;
+
+  sqe->addr = (uintptr_t) (is_fstat ? "" : req->path);
+  sqe->addr2 = (uintptr_t) statxbuf;
+  sqe->fd = is_fstat ? req->file : AT_FDCWD;
+  sqe->len = 0xFFF; /* STATX_BASIC_STATS + STATX_BTIME */
+  sqe->opcode = UV__IORING_OP_STATX;
+
+  if (is_fstat)
+    sqe->statx_flags |= AT_EMPTY_PATH;
+
+  if (is_lstat)
+    sqe->statx_flags |= AT_SYMLINK_NOFOLLOW;
+
+  uv__iou_submit(iou);
+
+  return 1;
+}
+
+
+/* Returns non-zero when the request has been handed over to the threadpool
+ * and its callback must not run yet.
+ */
+static int uv__iou_fs_complete(uv_loop_t* loop, uv_fs_t* req, int32_t res) {
+  struct uv__statx* statxbuf;
+
+  req->result = res;
+
+  switch (req->fs_type) {
+    case UV_FS_READ:
+    case UV_FS_WRITE:
+      if (req->bufs != req->bufsml)
+        uv__free(req->bufs);
+
+      req->bufs = NULL;
+      req->nbufs = 0;
+      break;
+
+    case UV_FS_FSTAT:
+    case UV_FS_LSTAT:
+    case UV_FS_STAT:
+      statxbuf = req->ptr;
+      req->ptr = NULL;
+
+      if (res == 0) {
+        uv__statx_to_stat(statxbuf, &req->statbuf);
+        req->ptr = &req->statbuf;
+      }
+
+      uv__free(statxbuf);
+
+      /* Same errors that make uv__fs_statx() give up on statx(). Let the
+       * threadpool retry with plain stat().
+       */
+      if (res == UV_EINVAL ||
+          res == UV_EPERM ||
+          res == UV_ENOSYS ||
+          res == UV_ENOTSUP) {
+        uv__store_relaxed(&no_iou_statx, 1);
+        req->result = 0;
+        uv__fs_post(loop, req);
+        return 1;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return 0;
+}
+
+
+void uv__poll_io_uring(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_cqe* cqe;
+  struct uv__io_uring_cqe* e;
+  uv_fs_t* req;
+  uint32_t head;
+  uint32_t tail;
+  int32_t res;
+
+  head = *iou->cqhead;
+  tail = __atomic_load_n(iou->cqtail, __ATOMIC_ACQUIRE);
+  cqe = iou->cqe;
+
+  while (head != tail) {
+    e = &cqe[head & iou->cqmask];
+    req = (uv_fs_t*) (uintptr_t) e->user_data;
+    res = e->res;
+
+    /* Give the slot back before running the callback, the callback is free
+     * to start new requests.
+     */
+    head++;
+    __atomic_store_n(iou->cqhead, head, __ATOMIC_RELEASE);
+
+    assert(req->type == UV_FS);
+    assert(iou->in_flight > 0);
+    uv__req_unregister(loop, req);
+    iou->in_flight--;
+
+    if (uv__iou_fs_complete(loop, req, res))
+      continue;
+
+    uv__metrics_update_idle_time(loop);
+    req->cb(req);
+  }
+}
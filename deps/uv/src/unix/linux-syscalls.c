@@ -140,6 +140,30 @@
 # endif
 #endif /* __NR_getrandom */
 
+#ifndef __NR_io_uring_setup
+# if defined(__x86_64__)   || \
+     defined(__i386__)     || \
+     defined(__aarch64__)  || \
+     defined(__powerpc__)  || \
+     defined(__s390__)
+#  define __NR_io_uring_setup 425
+# elif defined(__arm__)
+#  define __NR_io_uring_setup (UV_SYSCALL_BASE + 425)
+# endif
+#endif /* __NR_io_uring_setup */
+
+#ifndef __NR_io_uring_enter
+# if defined(__x86_64__)   || \
+     defined(__i386__)     || \
+     defined(__aarch64__)  || \
+     defined(__powerpc__)  || \
+     defined(__s390__)
+#  define __NR_io_uring_enter 426
+# elif defined(__arm__)
+#  define __NR_io_uring_enter (UV_SYSCALL_BASE + 426)
+# endif
+#endif /* __NR_io_uring_enter */
+
 struct uv__mmsghdr;
 
 int uv__sendmmsg(int fd, struct uv__mmsghdr* mmsg, unsigned int vlen) {
@@ -262,3 +286,34 @@ ssize_t uv__getrandom(void* buf, size_t buflen, unsigned flags) {
   return syscall(__NR_getrandom, buf, buflen, flags);
 #endif
 }
+
+
+int uv__io_uring_setup(int entries, struct uv__io_uring_params* params) {
+#if !defined(__NR_io_uring_setup) || defined(__ANDROID_API__)
+  return errno = ENOSYS, -1;
+#else
+  return syscall(__NR_io_uring_setup, entries, params);
+#endif
+}
+
+
+int uv__io_uring_enter(int fd,
+                       unsigned to_submit,
+                       unsigned min_complete,
+                       unsigned flags) {
+#if !defined(__NR_io_uring_enter) || defined(__ANDROID_API__)
+  return errno = ENOSYS, -1;
+#else
+  /* io_uring_enter used to take a sigset_t but it's unused
+   * in newer kernels unless IORING_ENTER_EXT_ARG is set,
+   * in which case it takes a struct io_uring_getevents_arg.
+   */
+  return syscall(__NR_io_uring_enter,
+                 fd,
+                 to_submit,
+                 min_complete,
+                 flags,
+                 NULL,
+                 0L);
+#endif
+}
@@ -58,6 +58,89 @@ struct uv__statx {
   uint64_t unused1[14];
 };
 
+/* Mirrors the kernel's io_uring ABI (include/uapi/linux/io_uring.h). Defined
+ * here so libuv builds against kernel headers that predate io_uring.
+ */
+#define UV__IORING_OP_READV 1
+#define UV__IORING_OP_WRITEV 2
+#define UV__IORING_OP_FSYNC 3
+#define UV__IORING_OP_OPENAT 18
+#define UV__IORING_OP_CLOSE 19
+#define UV__IORING_OP_STATX 21
+
+#define UV__IORING_FSYNC_DATASYNC 1u
+
+#define UV__IORING_ENTER_GETEVENTS 1u
+
+#define UV__IORING_FEAT_SINGLE_MMAP 1u
+#define UV__IORING_FEAT_NODROP 2u
+#define UV__IORING_FEAT_RW_CUR_POS 8u
+
+#define UV__IORING_OFF_SQ_RING 0ull
+#define UV__IORING_OFF_SQES 0x10000000ull
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint64_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  union {
+    uint64_t off;
+    uint64_t addr2;
+  };
+  uint64_t addr;
+  uint32_t len;
+  union {
+    uint32_t rw_flags;
+    uint32_t fsync_flags;
+    uint32_t open_flags;
+    uint32_t statx_flags;
+  };
+  uint64_t user_data;
+  uint64_t pad[3];
+};
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t reserved[4];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
 ssize_t uv__preadv(int fd, const struct iovec *iov, int iovcnt, int64_t offset);
 ssize_t uv__pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset);
 int uv__dup3(int oldfd, int newfd, int flags);
@@ -74,5 +157,10 @@ int uv__statx(int dirfd,
               unsigned int mask,
               struct uv__statx* statxbuf);
 ssize_t uv__getrandom(void* buf, size_t buflen, unsigned flags);
+int uv__io_uring_setup(int entries, struct uv__io_uring_params* params);
+int uv__io_uring_enter(int fd,
+                       unsigned to_submit,
+                       unsigned min_complete,
+                       unsigned flags);
 
 #endif /* UV_LINUX_SYSCALL_H_ */
@@ -217,6 +217,18 @@ int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
     return 0;
   }
 
+#if defined(__linux__)
+  if (option == UV_LOOP_BUSY_POLL) {
+    lfields->busy_poll = va_arg(ap, unsigned int);
+    return 0;
+  }
+
+  if (option == UV_LOOP_EPOLL_EXCLUSIVE) {
+    lfields->epoll_exclusive = 1;
+    return 0;
+  }
+#endif
+
   if (option != UV_LOOP_BLOCK_SIGNAL)
     return UV_ENOSYS;
 
@@ -136,6 +136,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   sigset_t set;
   uint64_t time_base;
   uint64_t time_diff;
+  uint64_t cb_start;
   QUEUE* q;
   uv__io_t* w;
   size_t i;
@@ -211,6 +212,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * operating system didn't reschedule our process while in the syscall.
      */
     SAVE_ERRNO(uv__update_time(loop));
+    uv__metrics_inc_poll_count(loop);
 
     if (nfds == 0) {
       if (reset_timeout != 0) {
@@ -253,6 +255,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     /* Initialize a count of events that we care about.  */
     nevents = 0;
     have_signals = 0;
+    cb_start = uv__metrics_callbacks_start(loop);
 
     /* Loop over the entire poll fds array looking for returned events.  */
     for (i = 0; i < loop->poll_fds_used; i++) {
@@ -302,6 +305,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       loop->signal_io_watcher.cb(loop, &loop->signal_io_watcher, POLLIN);
     }
 
+    uv__metrics_callbacks_end(loop, cb_start, nevents);
+
     loop->poll_fds_iterating = 0;
 
     /* Purge invalidated fds from our poll fds array.  */
@@ -45,6 +45,13 @@ extern char **environ;
 # include <grp.h>
 #endif
 
+#if defined(__linux__)
+# include <alloca.h>
+/* Spawn with vfork() rather than fork(), which would copy the page tables
+ * of the parent, however large; see uv__process_can_vfork(). */
+# define UV__SPAWN_VFORK 1
+#endif
+
 #if defined(__MVS__)
 # include "zos-base.h"
 #endif
@@ -208,15 +215,134 @@ static void uv__write_errno(int error_fd) {
 }
 
 
+#if defined(UV__SPAWN_VFORK)
+/* A vfork()ed child shares its memory with the parent. Everything except
+ * these flags only needs system calls and the child's own stack. setuid()
+ * and setgid() are not such calls in some libcs, which make every thread
+ * of the process change its ids, and a setsid() child is meant to outlive
+ * the parent in every way, so these keep using fork().
+ */
+static int uv__process_can_vfork(const uv_process_options_t* options) {
+  return !(options->flags & (UV_PROCESS_DETACHED |
+                             UV_PROCESS_SETUID |
+                             UV_PROCESS_SETGID));
+}
+
+
+static void uv__execve_sh(const char* path,
+                          char* const argv[],
+                          char* const envp[]) {
+  char** sh_argv;
+  int argc;
+
+  for (argc = 0; argv[argc] != NULL; argc++);
+
+  /* Not malloc(), which may be locked by another thread of the parent. */
+  sh_argv = alloca((argc + 2) * sizeof(*sh_argv));
+  sh_argv[0] = "/bin/sh";
+  sh_argv[1] = (char*) path;
+  memcpy(sh_argv + 2, argv + 1, argc * sizeof(*sh_argv));
+  execve("/bin/sh", sh_argv, envp);
+}
+
+
+/* execvp() as with `environ = envp`, which a vfork()ed child can not set,
+ * as the parent's other threads would see it: the PATH of `envp` is
+ * searched, and files that are not executables are run with /bin/sh.
+ * Only returns on failure, with errno set.
+ */
+static void uv__execvpe(const char* file,
+                        char* const argv[],
+                        char* const envp[]) {
+  char buf[PATH_MAX];
+  const char* path;
+  const char* p;
+  const char* z;
+  size_t file_len;
+  size_t dir_len;
+  int seen_eacces;
+  int i;
+
+  if (*file == '\0') {
+    errno = ENOENT;
+    return;
+  }
+
+  if (strchr(file, '/') != NULL) {
+    execve(file, argv, envp);
+    if (errno == ENOEXEC)
+      uv__execve_sh(file, argv, envp);
+    return;
+  }
+
+  path = "/bin:/usr/bin";
+  for (i = 0; envp[i] != NULL; i++) {
+    if (strncmp(envp[i], "PATH=", 5) == 0) {
+      path = envp[i] + 5;
+      break;
+    }
+  }
+
+  file_len = strlen(file);
+  if (file_len >= sizeof(buf)) {
+    errno = ENAMETOOLONG;
+    return;
+  }
+
+  seen_eacces = 0;
+  for (p = path; ; p = z + 1) {
+    z = strchr(p, ':');
+    if (z == NULL)
+      z = p + strlen(p);
+    dir_len = z - p;
+
+    /* An empty entry is the current directory. */
+    if (dir_len + 1 + file_len < sizeof(buf)) {
+      memcpy(buf, p, dir_len);
+      if (dir_len > 0)
+        buf[dir_len++] = '/';
+      memcpy(buf + dir_len, file, file_len + 1);
+
+      execve(buf, argv, envp);
+      switch (errno) {
+        case EACCES:
+          seen_eacces = 1;
+          /* Fall through. */
+        case ENOENT:
+        case ENOTDIR:
+        case ENAMETOOLONG:
+        case ELOOP:
+          break;
+        case ENOEXEC:
+          uv__execve_sh(buf, argv, envp);
+          return;
+        default:
+          return;
+      }
+    }
+
+    if (*z == '\0')
+      break;
+  }
+
+  errno = seen_eacces ? EACCES : ENOENT;
+}
+#endif  /* defined(UV__SPAWN_VFORK) */
+
+
 #if !(defined(__APPLE__) && (TARGET_OS_TV || TARGET_OS_WATCH))
 /* execvp is marked __WATCHOS_PROHIBITED __TVOS_PROHIBITED, so must be
  * avoided. Since this isn't called on those targets, the function
  * doesn't even need to be defined for them.
+ *
+ * With `vforked`, this runs in the memory of the parent, and must not write
+ * to anything but its own stack and `pipes`, which is then the child's copy.
  */
 static void uv__process_child_init(const uv_process_options_t* options,
                                    int stdio_count,
                                    int (*pipes)[2],
-                                   int error_fd) {
+                                   int error_fd,
+                                   int vforked) {
   sigset_t signewset;
   int close_fd;
   int use_fd;
@@ -320,7 +446,7 @@ static void uv__process_child_init(const uv_process_options_t* options,
   if ((options->flags & UV_PROCESS_SETUID) && setuid(options->uid))
     uv__write_errno(error_fd);
 
-  if (options->env != NULL) {
+  if (options->env != NULL && !vforked) {
     environ = options->env;
   }
 
@@ -329,6 +455,15 @@ static void uv__process_child_init(const uv_process_options_t* options,
   if (sigprocmask(SIG_SETMASK, &signewset, NULL) != 0)
     abort();
 
+#if defined(UV__SPAWN_VFORK)
+  if (vforked) {
+    uv__execvpe(options->file,
+                options->args,
+                options->env != NULL ? options->env : environ);
+    uv__write_errno(error_fd);
+  }
+#endif
+
 #ifdef __MVS__
   execvpe(options->file, options->args, environ);
 #else
@@ -353,6 +488,11 @@ int uv_spawn(uv_loop_t* loop,
   int signal_pipe[2] = { -1, -1 };
   int pipes_storage[8][2];
   int (*pipes)[2];
+#if defined(UV__SPAWN_VFORK)
+  int child_pipes_storage[8][2];
+  int (*child_pipes)[2] = NULL;
+  int use_vfork;
+#endif
   int stdio_count;
   ssize_t r;
   pid_t pid;
@@ -385,6 +525,18 @@ int uv_spawn(uv_loop_t* loop,
   if (pipes == NULL)
     goto error;
 
+#if defined(UV__SPAWN_VFORK)
+  /* The child rearranges its fds in here, without clobbering the parent's
+   * view of them. */
+  use_vfork = uv__process_can_vfork(options);
+  child_pipes = child_pipes_storage;
+  if (use_vfork && stdio_count > (int) ARRAY_SIZE(child_pipes_storage)) {
+    child_pipes = uv__malloc(stdio_count * sizeof(*child_pipes));
+    if (child_pipes == NULL)
+      goto error;
+  }
+#endif
+
   for (i = 0; i < stdio_count; i++) {
     pipes[i][0] = -1;
     pipes[i][1] = -1;
@@ -439,12 +591,27 @@ int uv_spawn(uv_loop_t* loop,
   if (pthread_sigmask(SIG_BLOCK, &signewset, &sigoldset) != 0)
     abort();
 
+#if defined(UV__SPAWN_VFORK)
+  if (use_vfork) {
+    memcpy(child_pipes, pipes, stdio_count * sizeof(*pipes));
+    pid = vfork();
+    if (pid == 0)
+      uv__process_child_init(options,
+                             stdio_count,
+                             child_pipes,
+                             signal_pipe[1],
+                             1);
+  } else {
+    pid = fork();
+  }
+#else
   pid = fork();
+#endif
   if (pid == -1)
     err = UV__ERR(errno);
 
   if (pid == 0)
-    uv__process_child_init(options, stdio_count, pipes, signal_pipe[1]);
+    uv__process_child_init(options, stdio_count, pipes, signal_pipe[1], 0);
 
   if (pthread_sigmask(SIG_SETMASK, &sigoldset, NULL) != 0)
     abort();
@@ -505,6 +672,11 @@ int uv_spawn(uv_loop_t* loop,
   if (pipes != pipes_storage)
     uv__free(pipes);
 
+#if defined(UV__SPAWN_VFORK)
+  if (child_pipes != child_pipes_storage)
+    uv__free(child_pipes);
+#endif
+
   return exec_errorno;
 
 error:
@@ -523,6 +695,11 @@ error:
       uv__free(pipes);
   }
 
+#if defined(UV__SPAWN_VFORK)
+  if (child_pipes != NULL && child_pipes != child_pipes_storage)
+    uv__free(child_pipes);
+#endif
+
   return err;
 #endif
 }
@@ -279,6 +279,96 @@ int uv_thread_equal(const uv_thread_t* t1, const uv_thread_t* t2) {
 }
 
 
+#if defined(__linux__) && !defined(__ANDROID__)
+int uv_cpumask_size(void) {
+  return CPU_SETSIZE;
+}
+
+
+int uv_thread_setaffinity(uv_thread_t* tid,
+                          char* cpumask,
+                          char* oldmask,
+                          size_t mask_size) {
+  cpu_set_t cpuset;
+  int i;
+  int r;
+
+  if (mask_size < (size_t) CPU_SETSIZE)
+    return UV_EINVAL;
+
+  if (oldmask != NULL) {
+    r = uv_thread_getaffinity(tid, oldmask, mask_size);
+    if (r < 0)
+      return r;
+  }
+
+  CPU_ZERO(&cpuset);
+  for (i = 0; i < CPU_SETSIZE; i++)
+    if (cpumask[i])
+      CPU_SET(i, &cpuset);
+
+  return UV__ERR(pthread_setaffinity_np(*tid, sizeof(cpuset), &cpuset));
+}
+
+
+int uv_thread_getaffinity(uv_thread_t* tid,
+                          char* cpumask,
+                          size_t mask_size) {
+  cpu_set_t cpuset;
+  int i;
+  int r;
+
+  if (mask_size < (size_t) CPU_SETSIZE)
+    return UV_EINVAL;
+
+  CPU_ZERO(&cpuset);
+  r = pthread_getaffinity_np(*tid, sizeof(cpuset), &cpuset);
+  if (r)
+    return UV__ERR(r);
+
+  for (i = 0; i < CPU_SETSIZE; i++)
+    cpumask[i] = !!CPU_ISSET(i, &cpuset);
+
+  return 0;
+}
+
+
+int uv_thread_getcpu(void) {
+  int cpu;
+
+  cpu = sched_getcpu();
+  if (cpu < 0)
+    return UV__ERR(errno);
+
+  return cpu;
+}
+#else
+int uv_cpumask_size(void) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_thread_setaffinity(uv_thread_t* tid,
+                          char* cpumask,
+                          char* oldmask,
+                          size_t mask_size) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_thread_getaffinity(uv_thread_t* tid,
+                          char* cpumask,
+                          size_t mask_size) {
+  return UV_ENOTSUP;
+}
+
+
+int uv_thread_getcpu(void) {
+  return UV_ENOTSUP;
+}
+#endif
+
+
 int uv_mutex_init(uv_mutex_t* mutex) {
 #if defined(NDEBUG) || !defined(PTHREAD_MUTEX_ERRORCHECK)
   return UV__ERR(pthread_mutex_init(mutex, NULL));
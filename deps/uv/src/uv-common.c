@@ -763,7 +763,10 @@ int uv_loop_configure(uv_loop_t* loop, uv_loop_option option, ...) {
 
   va_start(ap, option);
   /* Any platform-agnostic options should be handled here. */
-  err = uv__loop_configure(loop, option, ap);
+  if (option == UV_LOOP_USE_TIMER_WHEEL)
+    err = uv__timer_wheel_configure(loop, va_arg(ap, unsigned int));
+  else
+    err = uv__loop_configure(loop, option, ap);
   va_end(ap);
 
   return err;
@@ -818,6 +821,7 @@ int uv_loop_close(uv_loop_t* loop) {
       return UV_EBUSY;
   }
 
+  uv__timer_wheel_delete(loop);
   uv__loop_close(loop);
 
 #ifndef NDEBUG
@@ -953,6 +957,66 @@ void uv__metrics_set_provider_entry_time(uv_loop_t* loop) {
 }
 
 
+void uv__metrics_inc_loop_count(uv_loop_t* loop) {
+  uv__get_loop_metrics(loop)->loop_count++;
+}
+
+
+void uv__metrics_inc_poll_count(uv_loop_t* loop) {
+  uv__get_loop_metrics(loop)->poll_count++;
+}
+
+
+/* Callback time is measured with the same opt-in as the idle time, so loops
+ * that don't ask for metrics don't pay for the extra clock reads.
+ */
+uint64_t uv__metrics_callbacks_start(uv_loop_t* loop) {
+  if (!(uv__get_internal_fields(loop)->flags & UV_METRICS_IDLE_TIME))
+    return 0;
+
+  return uv_hrtime();
+}
+
+
+void uv__metrics_callbacks_end(uv_loop_t* loop,
+                               uint64_t start,
+                               unsigned int nevents) {
+  uv__loop_metrics_t* loop_metrics;
+
+  loop_metrics = uv__get_loop_metrics(loop);
+  loop_metrics->events += nevents;
+  if (start != 0)
+    loop_metrics->poll_callback_time += uv_hrtime() - start;
+}
+
+
+int uv_metrics_info(uv_loop_t* loop, uv_metrics_t* metrics) {
+  uv__loop_metrics_t* loop_metrics;
+  QUEUE* q;
+  uv_handle_t* h;
+
+  memset(metrics, 0, sizeof(*metrics));
+  loop_metrics = uv__get_loop_metrics(loop);
+  metrics->loop_count = loop_metrics->loop_count;
+  metrics->events = loop_metrics->events;
+  metrics->poll_count = loop_metrics->poll_count;
+  metrics->poll_callback_time = loop_metrics->poll_callback_time;
+  metrics->idle_time = uv_metrics_idle_time(loop);
+  metrics->threadpool_pending =
+      uv__get_internal_fields(loop)->threadpool_pending;
+
+  QUEUE_FOREACH(q, &loop->handle_queue) {
+    h = QUEUE_DATA(q, uv_handle_t, handle_queue);
+    if (uv__is_active(h) && h->type > UV_UNKNOWN_HANDLE &&
+        h->type < UV_HANDLE_TYPE_MAX) {
+      metrics->active_handles[h->type]++;
+    }
+  }
+
+  return 0;
+}
+
+
 uint64_t uv_metrics_idle_time(uv_loop_t* loop) {
   uv__loop_metrics_t* loop_metrics;
   uint64_t entry_time;
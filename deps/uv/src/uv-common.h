@@ -218,6 +218,8 @@ uv_dirent_type_t uv__fs_get_dirent_type(uv__dirent_t* dent);
 int uv__next_timeout(const uv_loop_t* loop);
 void uv__run_timers(uv_loop_t* loop);
 void uv__timer_close(uv_timer_t* handle);
+int uv__timer_wheel_configure(uv_loop_t* loop, unsigned int granularity);
+void uv__timer_wheel_delete(uv_loop_t* loop);
 
 void uv__process_title_cleanup(void);
 void uv__signal_cleanup(void);
@@ -360,14 +362,56 @@ struct uv__loop_metrics_s {
   uint64_t provider_entry_time;
   uint64_t provider_idle_time;
   uv_mutex_t lock;
+  /* Only touched by the loop thread, see uv_metrics_info(). */
+  uint64_t loop_count;
+  uint64_t events;
+  uint64_t poll_count;
+  uint64_t poll_callback_time;
 };
 
 void uv__metrics_update_idle_time(uv_loop_t* loop);
 void uv__metrics_set_provider_entry_time(uv_loop_t* loop);
+void uv__metrics_inc_loop_count(uv_loop_t* loop);
+void uv__metrics_inc_poll_count(uv_loop_t* loop);
+uint64_t uv__metrics_callbacks_start(uv_loop_t* loop);
+void uv__metrics_callbacks_end(uv_loop_t* loop,
+                               uint64_t start,
+                               unsigned int nevents);
+
+#ifdef __linux__
+struct uv__iou {
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t* sqarray;
+  uint32_t sqmask;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  uint32_t cqentries;
+  void* sq;   /* pointer to munmap() on event loop teardown */
+  void* cqe;  /* pointer to array of struct uv__io_uring_cqe */
+  void* sqe;  /* pointer to array of struct uv__io_uring_sqe */
+  size_t maxlen;
+  size_t sqelen;
+  int ringfd;  /* -2 when not yet initialized, -1 when unavailable */
+  uint32_t in_flight;
+};
+#endif  /* __linux__ */
+
+struct uv__timer_wheel;
 
 struct uv__loop_internal_fields_s {
   unsigned int flags;
   uv__loop_metrics_t loop_metrics;
+  unsigned int threadpool_cursor;  /* Next worker for uv__work_submit(). */
+  unsigned int threadpool_pending;  /* Submitted but not yet done. */
+  struct uv__timer_wheel* timer_wheel;  /* NULL unless enabled. */
+  unsigned int busy_poll;  /* Microseconds to spin before blocking. */
+  int epoll_exclusive;  /* Use EPOLLEXCLUSIVE for listening sockets. */
+  int async_wakeup_pending;  /* Unix only, see uv__async_send(). */
+#ifdef __linux__
+  struct uv__iou iou;
+#endif  /* __linux__ */
 };
 
 #endif /* UV_COMMON_H_ */
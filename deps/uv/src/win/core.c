@@ -500,6 +500,7 @@ static void uv__poll(uv_loop_t* loop, DWORD timeout) {
   OVERLAPPED_ENTRY overlappeds[128];
   ULONG count;
   ULONG i;
+  unsigned int nevents;
   int repeat;
   uint64_t timeout_time;
   uint64_t user_timeout;
@@ -540,8 +541,10 @@ static void uv__poll(uv_loop_t* loop, DWORD timeout) {
      * the idle time will need to be updated.
      */
     uv__metrics_update_idle_time(loop);
+    uv__metrics_inc_poll_count(loop);
 
     if (success) {
+      nevents = 0;
       for (i = 0; i < count; i++) {
         /* Package was dequeued, but see if it is not a empty package
          * meant only to wake us up.
@@ -549,9 +552,15 @@ static void uv__poll(uv_loop_t* loop, DWORD timeout) {
         if (overlappeds[i].lpOverlapped) {
           req = uv_overlapped_to_req(overlappeds[i].lpOverlapped);
           uv_insert_pending_req(loop, req);
+          nevents++;
         }
       }
 
+      /* The callbacks run from uv_process_reqs(), which accounts for their
+       * time, so only the events are counted here.
+       */
+      uv__metrics_callbacks_end(loop, 0, nevents);
+
       /* Some time might have passed waiting for I/O,
        * so update the loop time here.
        */
@@ -595,6 +604,7 @@ int uv_loop_alive(const uv_loop_t* loop) {
 
 int uv_run(uv_loop_t *loop, uv_run_mode mode) {
   DWORD timeout;
+  uint64_t cb_start;
   int r;
   int ran_pending;
 
@@ -603,10 +613,13 @@ int uv_run(uv_loop_t *loop, uv_run_mode mode) {
     uv_update_time(loop);
 
   while (r != 0 && loop->stop_flag == 0) {
+    uv__metrics_inc_loop_count(loop);
     uv_update_time(loop);
     uv__run_timers(loop);
 
+    cb_start = uv__metrics_callbacks_start(loop);
     ran_pending = uv_process_reqs(loop);
+    uv__metrics_callbacks_end(loop, cb_start, 0);
     uv_idle_invoke(loop);
     uv_prepare_invoke(loop);
 
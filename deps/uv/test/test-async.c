@@ -132,3 +132,73 @@ TEST_IMPL(async) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+#define MANY_HANDLES 4
+#define MANY_ROUNDS 2000
+
+struct many_ctx {
+  uv_async_t handle;
+  uv_sem_t ack;
+  uv_thread_t thread;
+  int called;
+};
+
+static struct many_ctx many[MANY_HANDLES];
+static int many_done;
+
+
+static void many_async_cb(uv_async_t* handle) {
+  struct many_ctx* ctx;
+  int i;
+
+  ctx = container_of(handle, struct many_ctx, handle);
+  if (++ctx->called == MANY_ROUNDS && ++many_done == MANY_HANDLES)
+    for (i = 0; i < MANY_HANDLES; i++)
+      uv_close((uv_handle_t*) &many[i].handle, NULL);
+
+  uv_sem_post(&ctx->ack);
+}
+
+
+static void many_thread_cb(void* arg) {
+  struct many_ctx* ctx;
+  int i;
+
+  ctx = arg;
+  for (i = 0; i < MANY_ROUNDS; i++) {
+    ASSERT_EQ(0, uv_async_send(&ctx->handle));
+    uv_sem_wait(&ctx->ack);
+  }
+}
+
+
+/* Several threads sending to different handles of the same loop share its
+ * wakeups. None of the sends may get lost, or a thread waits forever.
+ */
+TEST_IMPL(async_many_handles) {
+  int i;
+
+  for (i = 0; i < MANY_HANDLES; i++) {
+    ASSERT_EQ(0, uv_async_init(uv_default_loop(),
+                               &many[i].handle,
+                               many_async_cb));
+    ASSERT_EQ(0, uv_sem_init(&many[i].ack, 0));
+  }
+
+  for (i = 0; i < MANY_HANDLES; i++)
+    ASSERT_EQ(0, uv_thread_create(&many[i].thread,
+                                  many_thread_cb,
+                                  &many[i]));
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  for (i = 0; i < MANY_HANDLES; i++) {
+    ASSERT_EQ(0, uv_thread_join(&many[i].thread));
+    ASSERT_EQ(MANY_ROUNDS, many[i].called);
+    uv_sem_destroy(&many[i].ack);
+  }
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include <limits.h> /* INT_MAX, PATH_MAX, IOV_MAX */
 
 #ifndef _WIN32
+# include <sys/socket.h>
 # include <unistd.h> /* unlink, rmdir, etc. */
 #else
 # include <winioctl.h>
@@ -1282,6 +1283,57 @@ TEST_IMPL(fs_async_sendfile_nodata) {
 }
 
 
+TEST_IMPL(fs_async_sendfile_socket) {
+#if defined(__linux__)
+  int fds[2];
+  int f;
+  int r;
+
+  loop = uv_default_loop();
+
+  unlink("test_file");
+  f = open("test_file", O_WRONLY | O_CREAT, S_IWUSR | S_IRUSR);
+  ASSERT(f != -1);
+  ASSERT(0 == ftruncate(f, 4 << 20));
+  ASSERT(0 == close(f));
+
+  /* Nobody reads from fds[1], so a non-blocking sendfile() can only make
+   * partial progress. It must not block waiting for the peer.
+   */
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK));
+
+  r = uv_fs_open(NULL, &open_req1, "test_file", O_RDONLY, 0, NULL);
+  ASSERT(r >= 0);
+  uv_fs_req_cleanup(&open_req1);
+
+  r = uv_fs_sendfile(NULL, &sendfile_req, fds[0], open_req1.result,
+                     0, 4 << 20, NULL);
+  ASSERT_GT(r, 0);
+  ASSERT_LT(r, 4 << 20);
+  ASSERT_EQ(sendfile_req.result, r);
+  uv_fs_req_cleanup(&sendfile_req);
+
+  r = uv_fs_sendfile(NULL, &sendfile_req, fds[0], open_req1.result,
+                     0, 4 << 20, NULL);
+  ASSERT_EQ(r, UV_EAGAIN);
+  uv_fs_req_cleanup(&sendfile_req);
+
+  r = uv_fs_close(NULL, &close_req, open_req1.result, NULL);
+  ASSERT(r == 0);
+  uv_fs_req_cleanup(&close_req);
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+  unlink("test_file");
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#else
+  RETURN_SKIP("Linux only test");
+#endif
+}
+
+
 TEST_IMPL(fs_mkdtemp) {
   int r;
   const char* path_template = "test_dir_XXXXXX";
@@ -3217,6 +3269,72 @@ TEST_IMPL(fs_read_file_eof) {
 }
 
 
+/* More requests than fit in the io_uring submission and completion queues,
+ * the excess has to spill over to the threadpool.
+ */
+#define CONCURRENT_READS 300
+
+static uv_fs_t concurrent_read_reqs[CONCURRENT_READS];
+static char concurrent_read_bufs[CONCURRENT_READS][sizeof(test_buf)];
+static unsigned concurrent_read_cb_count;
+
+static void concurrent_read_cb(uv_fs_t* req) {
+  size_t i;
+
+  i = req - concurrent_read_reqs;
+  ASSERT(i < CONCURRENT_READS);
+  ASSERT(req->fs_type == UV_FS_READ);
+  ASSERT(req->result == sizeof(test_buf));
+  ASSERT(0 == memcmp(concurrent_read_bufs[i], test_buf, sizeof(test_buf)));
+  uv_fs_req_cleanup(req);
+  concurrent_read_cb_count++;
+}
+
+
+TEST_IMPL(fs_read_concurrent) {
+  uv_file file;
+  size_t i;
+  int r;
+
+  /* Setup. */
+  unlink("test_file");
+
+  loop = uv_default_loop();
+
+  r = uv_fs_open(NULL, &open_req1, "test_file",
+      O_RDWR | O_CREAT, S_IWUSR | S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  file = open_req1.result;
+  uv_fs_req_cleanup(&open_req1);
+
+  iov = uv_buf_init(test_buf, sizeof(test_buf));
+  r = uv_fs_write(NULL, &write_req, file, &iov, 1, 0, NULL);
+  ASSERT(r == sizeof(test_buf));
+  uv_fs_req_cleanup(&write_req);
+
+  for (i = 0; i < CONCURRENT_READS; i++) {
+    iov = uv_buf_init(concurrent_read_bufs[i], sizeof(test_buf));
+    r = uv_fs_read(loop, concurrent_read_reqs + i, file, &iov, 1, 0,
+                   concurrent_read_cb);
+    ASSERT(r == 0);
+  }
+
+  r = uv_run(loop, UV_RUN_DEFAULT);
+  ASSERT(r == 0);
+  ASSERT(concurrent_read_cb_count == CONCURRENT_READS);
+
+  r = uv_fs_close(NULL, &close_req, file, NULL);
+  ASSERT(r == 0);
+  uv_fs_req_cleanup(&close_req);
+
+  /* Cleanup */
+  unlink("test_file");
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
 static void fs_write_multiple_bufs(int add_flags) {
   uv_buf_t iovs[2];
   int r;
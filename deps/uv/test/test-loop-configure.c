@@ -36,3 +36,67 @@ TEST_IMPL(loop_configure) {
   ASSERT(0 == uv_loop_close(&loop));
   return 0;
 }
+
+
+static uv_tcp_t server_handle;
+static uv_tcp_t peer_handle;
+static uv_tcp_t client_handle;
+static uv_connect_t connect_req;
+static int connection_cb_called;
+static int connect_cb_called;
+
+
+static void connection_cb(uv_stream_t* server, int status) {
+  ASSERT(0 == status);
+  ASSERT(0 == uv_tcp_init(server->loop, &peer_handle));
+  ASSERT(0 == uv_accept(server, (uv_stream_t*) &peer_handle));
+  uv_close((uv_handle_t*) &peer_handle, NULL);
+  uv_close((uv_handle_t*) server, NULL);
+  connection_cb_called++;
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(0 == status);
+  uv_close((uv_handle_t*) req->handle, NULL);
+  connect_cb_called++;
+}
+
+
+TEST_IMPL(loop_configure_busy_poll) {
+#ifndef __linux__
+  RETURN_SKIP("Busy polling is only implemented for epoll.");
+#else
+  struct sockaddr_in addr;
+  uv_timer_t timer_handle;
+  uv_loop_t loop;
+  uint64_t start;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 500u));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_EPOLL_EXCLUSIVE));
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_tcp_init(&loop, &server_handle));
+  ASSERT(0 == uv_tcp_bind(&server_handle, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server_handle, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(&loop, &client_handle));
+  ASSERT(0 == uv_tcp_connect(&connect_req,
+                             &client_handle,
+                             (const struct sockaddr*) &addr,
+                             connect_cb));
+
+  /* Spinning must not make the loop oversleep or wake up too early. */
+  start = uv_now(&loop);
+  ASSERT(0 == uv_timer_init(&loop, &timer_handle));
+  ASSERT(0 == uv_timer_start(&timer_handle, timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(uv_now(&loop) >= start + 10);
+
+  ASSERT(1 == connection_cb_called);
+  ASSERT(1 == connect_cb_called);
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+#endif
+}
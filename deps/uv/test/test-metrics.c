@@ -133,3 +133,67 @@ TEST_IMPL(metrics_idle_time_zero) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static void metrics_work_cb(uv_work_t* req) {
+}
+
+
+static void metrics_after_work_cb(uv_work_t* req, int status) {
+  uv_metrics_t metrics;
+
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(0, uv_metrics_info(req->loop, &metrics));
+  ASSERT_EQ(0, metrics.threadpool_pending);
+  (*(int*) req->data)++;
+}
+
+
+static void metrics_async_cb(uv_async_t* handle) {
+  (*(int*) handle->data)++;
+  uv_close((uv_handle_t*) handle, NULL);
+}
+
+
+TEST_IMPL(metrics_info) {
+  uv_metrics_t metrics;
+  uv_async_t async;
+  uv_timer_t timer;
+  uv_work_t work;
+  int cntr;
+
+  cntr = 0;
+  async.data = &cntr;
+  timer.data = &cntr;
+  work.data = &cntr;
+  ASSERT_EQ(0, uv_loop_configure(uv_default_loop(), UV_METRICS_IDLE_TIME));
+  ASSERT_EQ(0, uv_async_init(uv_default_loop(), &async, metrics_async_cb));
+  ASSERT_EQ(0, uv_timer_init(uv_default_loop(), &timer));
+  ASSERT_EQ(0, uv_timer_start(&timer, timer_noop_cb, 10, 0));
+  ASSERT_EQ(0, uv_queue_work(uv_default_loop(),
+                             &work,
+                             metrics_work_cb,
+                             metrics_after_work_cb));
+  ASSERT_EQ(0, uv_async_send(&async));
+
+  ASSERT_EQ(0, uv_metrics_info(uv_default_loop(), &metrics));
+  ASSERT_EQ(0, metrics.loop_count);
+  ASSERT_EQ(1, metrics.threadpool_pending);
+  ASSERT_EQ(1, metrics.active_handles[UV_TIMER]);
+  ASSERT_EQ(0, metrics.active_handles[UV_IDLE]);
+  ASSERT_GE(metrics.active_handles[UV_ASYNC], 1);
+
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT_EQ(3, cntr);
+
+  ASSERT_EQ(0, uv_metrics_info(uv_default_loop(), &metrics));
+  ASSERT_GT(metrics.loop_count, 0);
+  ASSERT_GT(metrics.poll_count, 0);
+  ASSERT_GT(metrics.events, 0);
+  ASSERT_GT(metrics.idle_time, 0);
+  ASSERT_EQ(0, metrics.threadpool_pending);
+  ASSERT_EQ(0, metrics.active_handles[UV_TIMER]);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -35,6 +35,7 @@
 #else
 # include <unistd.h>
 # include <sys/wait.h>
+extern char** environ;
 #endif
 
 
@@ -258,6 +259,41 @@ TEST_IMPL(spawn_empty_env) {
 }
 
 
+/* The child must not leave options.env as the parent's environment, which
+ * it shares with a vfork() based spawn until it execs. */
+TEST_IMPL(spawn_keeps_parent_env) {
+#ifdef _WIN32
+  RETURN_SKIP("Test for Unix-like platforms only");
+#else
+  char* env[2];
+  char** parent_env;
+
+  if (NULL != getenv("DYLD_LIBRARY_PATH") ||
+      NULL != getenv("LD_LIBRARY_PATH") ||
+      NULL != getenv("LIBPATH")) {
+    RETURN_SKIP("doesn't work with DYLD_LIBRARY_PATH/LD_LIBRARY_PATH/LIBPATH");
+  }
+
+  parent_env = environ;
+  init_process_options("spawn_helper1", exit_cb);
+  env[0] = "UV_TEST_SPAWN_ENV=1";
+  env[1] = NULL;
+  options.env = env;
+
+  ASSERT(0 == uv_spawn(uv_default_loop(), &process, &options));
+  ASSERT(environ == parent_env);
+  ASSERT(NULL == getenv("UV_TEST_SPAWN_ENV"));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT(exit_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
+
+
 TEST_IMPL(spawn_exit_code) {
   int r;
 
@@ -0,0 +1,152 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int first_allowed_cpu(char* mask, int size) {
+  int i;
+
+  for (i = 0; i < size; i++)
+    if (mask[i])
+      return i;
+
+  return -1;
+}
+
+
+TEST_IMPL(thread_affinity) {
+  uv_thread_t self;
+  char* cpumask;
+  char* oldmask;
+  int cpumasksize;
+  int cpu;
+  int i;
+
+  cpumasksize = uv_cpumask_size();
+  if (cpumasksize == UV_ENOTSUP)
+    RETURN_SKIP("Thread affinity is not supported on this platform.");
+  ASSERT_GT(cpumasksize, 0);
+
+  cpumask = calloc(cpumasksize, 1);
+  oldmask = calloc(cpumasksize, 1);
+  ASSERT_NOT_NULL(cpumask);
+  ASSERT_NOT_NULL(oldmask);
+
+  self = uv_thread_self();
+  ASSERT_EQ(UV_EINVAL, uv_thread_getaffinity(&self, cpumask, 0));
+  ASSERT_EQ(0, uv_thread_getaffinity(&self, cpumask, cpumasksize));
+  cpu = first_allowed_cpu(cpumask, cpumasksize);
+  ASSERT_GE(cpu, 0);
+
+  /* Pin to a single CPU and check that we run there. */
+  memset(cpumask, 0, cpumasksize);
+  cpumask[cpu] = 1;
+  ASSERT_EQ(0, uv_thread_setaffinity(&self, cpumask, oldmask, cpumasksize));
+  ASSERT_EQ(cpu, uv_thread_getcpu());
+
+  memset(cpumask, 0, cpumasksize);
+  ASSERT_EQ(0, uv_thread_getaffinity(&self, cpumask, cpumasksize));
+  for (i = 0; i < cpumasksize; i++)
+    ASSERT_EQ(i == cpu, cpumask[i]);
+
+  ASSERT_EQ(0, uv_thread_setaffinity(&self, oldmask, NULL, cpumasksize));
+
+  free(cpumask);
+  free(oldmask);
+  return 0;
+}
+
+
+static int pinned_cpu;
+static int pool_cpu;
+static int pool_pinned;
+
+
+static void affinity_work_cb(uv_work_t* req) {
+  uv_thread_t self;
+  char* mask;
+  int size;
+  int i;
+
+  size = uv_cpumask_size();
+  mask = calloc(size, 1);
+  ASSERT_NOT_NULL(mask);
+
+  self = uv_thread_self();
+  ASSERT_EQ(0, uv_thread_getaffinity(&self, mask, size));
+  pool_pinned = 1;
+  for (i = 0; i < size; i++)
+    if (mask[i] != (i == pinned_cpu))
+      pool_pinned = 0;
+  pool_cpu = uv_thread_getcpu();
+
+  free(mask);
+}
+
+
+static void affinity_after_work_cb(uv_work_t* req, int status) {
+  ASSERT_EQ(0, status);
+}
+
+
+TEST_IMPL(threadpool_affinity) {
+  static char env[64];
+  uv_thread_t self;
+  uv_work_t req;
+  char* mask;
+  int size;
+
+  size = uv_cpumask_size();
+  if (size == UV_ENOTSUP)
+    RETURN_SKIP("Thread affinity is not supported on this platform.");
+
+  mask = calloc(size, 1);
+  ASSERT_NOT_NULL(mask);
+  self = uv_thread_self();
+  ASSERT_EQ(0, uv_thread_getaffinity(&self, mask, size));
+  pinned_cpu = first_allowed_cpu(mask, size);
+  ASSERT_GE(pinned_cpu, 0);
+  free(mask);
+
+  /* Every worker lands in the one group; the bogus trailing entry is
+   * ignored.
+   */
+  snprintf(env, sizeof(env), "UV_THREADPOOL_AFFINITY=%d-%d,x",
+           pinned_cpu, pinned_cpu);
+  ASSERT_EQ(0, putenv(env));
+
+  ASSERT_EQ(0, uv_queue_work(uv_default_loop(),
+                             &req,
+                             affinity_work_cb,
+                             affinity_after_work_cb));
+  ASSERT_EQ(0, uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT_EQ(1, pool_pinned);
+  ASSERT_EQ(pinned_cpu, pool_cpu);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
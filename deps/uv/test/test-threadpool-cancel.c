@@ -284,6 +284,13 @@ TEST_IMPL(threadpool_cancel_fs) {
   unsigned n;
   uv_buf_t iov;
 
+  static char no_io_uring[] = "UV_USE_IO_URING=0";
+
+  /* Requests that go through io_uring are owned by the kernel and can't be
+   * cancelled. This test is about the threadpool so keep them there.
+   */
+  putenv(no_io_uring);
+
   INIT_CANCEL_INFO(&ci, reqs);
   loop = uv_default_loop();
   saturate_threadpool();
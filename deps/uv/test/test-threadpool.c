@@ -74,3 +74,99 @@ TEST_IMPL(threadpool_queue_work_einval) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static uv_work_t blocking_reqs[8];
+static uv_sem_t blocking_sem;
+
+
+static void blocking_work_cb(uv_work_t* req) {
+  uv_sem_wait(&blocking_sem);
+}
+
+
+static void blocking_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  after_work_cb_count++;
+}
+
+
+static void stat_cb(uv_fs_t* req) {
+  unsigned i;
+
+  ASSERT(req->result == 0);
+  uv_fs_req_cleanup(req);
+
+  /* Got here while the CPU-bound requests were still blocked. */
+  for (i = 0; i < ARRAY_SIZE(blocking_reqs); i++)
+    uv_sem_post(&blocking_sem);
+}
+
+
+TEST_IMPL(threadpool_fast_io_not_starved) {
+  static char pool_size[] = "UV_THREADPOOL_SIZE=8";
+  static char no_io_uring[] = "UV_USE_IO_URING=0";
+  uv_fs_t stat_req;
+  unsigned i;
+
+  /* As many CPU-bound requests as there are threads must not be able to keep
+   * a file system request from running.
+   */
+  putenv(pool_size);
+  putenv(no_io_uring);
+
+  ASSERT(0 == uv_sem_init(&blocking_sem, 0));
+
+  for (i = 0; i < ARRAY_SIZE(blocking_reqs); i++)
+    ASSERT(0 == uv_queue_work(uv_default_loop(),
+                              blocking_reqs + i,
+                              blocking_work_cb,
+                              blocking_after_work_cb));
+
+  ASSERT(0 == uv_fs_stat(uv_default_loop(), &stat_req, ".", stat_cb));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(after_work_cb_count == ARRAY_SIZE(blocking_reqs));
+
+  uv_sem_destroy(&blocking_sem);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_work_t barrier_reqs[4];
+static uv_barrier_t work_barrier;
+
+
+static void barrier_work_cb(uv_work_t* req) {
+  uv_barrier_wait(&work_barrier);
+}
+
+
+TEST_IMPL(threadpool_grow) {
+  static char pool_size[] = "UV_THREADPOOL_SIZE=1";
+  static char max_pool_size[] = "UV_THREADPOOL_MAX_SIZE=4";
+  unsigned i;
+
+  /* The requests can only finish if they all run at the same time, which
+   * they can't unless the pool grows past its initial size.
+   */
+  putenv(pool_size);
+  putenv(max_pool_size);
+
+  ASSERT(0 == uv_barrier_init(&work_barrier, ARRAY_SIZE(barrier_reqs)));
+
+  for (i = 0; i < ARRAY_SIZE(barrier_reqs); i++)
+    ASSERT(0 == uv_queue_work(uv_default_loop(),
+                              barrier_reqs + i,
+                              barrier_work_cb,
+                              blocking_after_work_cb));
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(after_work_cb_count == ARRAY_SIZE(barrier_reqs));
+
+  uv_barrier_destroy(&work_barrier);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
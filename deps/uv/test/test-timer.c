@@ -345,3 +345,81 @@ TEST_IMPL(timer_early_check) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static uint64_t wheel_start_time;
+static unsigned wheel_cb_called;
+static uv_timer_t wheel_timers[6];
+static const uint64_t wheel_timeouts[] = { 150, 5, 70, 5, 0, 300 };
+static const unsigned wheel_order[] = { 4, 1, 3, 2, 0, 5 };
+
+
+static void wheel_cb(uv_timer_t* handle) {
+  unsigned i;
+
+  i = handle - wheel_timers;
+  ASSERT(i == wheel_order[wheel_cb_called]);
+  ASSERT(uv_now(handle->loop) >= wheel_start_time + wheel_timeouts[i]);
+  wheel_cb_called++;
+}
+
+
+static void wheel_repeat_cb(uv_timer_t* handle) {
+  if (++repeat_cb_called == 3)
+    uv_timer_stop(handle);
+}
+
+
+TEST_IMPL(timer_wheel) {
+  uv_timer_t repeat_timer;
+  uv_timer_t huge_timer;
+  uv_timer_t stopped_timer;
+  uv_loop_t loop;
+  unsigned i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_EINVAL == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL, 0u));
+
+  /* Only a loop without active timers can switch. */
+  ASSERT(0 == uv_timer_init(&loop, &huge_timer));
+  ASSERT(0 == uv_timer_start(&huge_timer, wheel_cb, 1000, 0));
+  ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL, 1u));
+  ASSERT(0 == uv_timer_stop(&huge_timer));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_USE_TIMER_WHEEL, 1u));
+
+  wheel_start_time = uv_now(&loop);
+
+  /* 70, 150 and 300 ms have to cascade down from the higher levels. */
+  for (i = 0; i < ARRAY_SIZE(wheel_timers); i++) {
+    ASSERT(0 == uv_timer_init(&loop, wheel_timers + i));
+    ASSERT(0 == uv_timer_start(wheel_timers + i,
+                               wheel_cb,
+                               wheel_timeouts[i],
+                               0));
+  }
+
+  ASSERT(0 == uv_timer_init(&loop, &repeat_timer));
+  ASSERT(0 == uv_timer_start(&repeat_timer, wheel_repeat_cb, 20, 20));
+
+  ASSERT(0 == uv_timer_init(&loop, &stopped_timer));
+  ASSERT(0 == uv_timer_start(&stopped_timer, wheel_cb, 10, 0));
+  ASSERT(0 == uv_timer_stop(&stopped_timer));
+
+  ASSERT(0 == uv_timer_start(&huge_timer, wheel_cb, (uint64_t) -1, 0));
+  uv_unref((uv_handle_t*) &huge_timer);
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(wheel_cb_called == ARRAY_SIZE(wheel_timers));
+  ASSERT(repeat_cb_called == 3);
+  ASSERT(1 == uv_is_active((uv_handle_t*) &huge_timer));
+
+  for (i = 0; i < ARRAY_SIZE(wheel_timers); i++)
+    uv_close((uv_handle_t*) (wheel_timers + i), NULL);
+  uv_close((uv_handle_t*) &repeat_timer, NULL);
+  uv_close((uv_handle_t*) &stopped_timer, NULL);
+  uv_close((uv_handle_t*) &huge_timer, NULL);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+
+  return 0;
+}
@@ -97,6 +97,12 @@ class V8_EXPORT MicrotaskQueue {
    */
   virtual int GetMicrotasksScopeDepth() const = 0;
 
+  /**
+   * Returns the number of microtasks that have run on this MicrotaskQueue
+   * instance so far.
+   */
+  virtual size_t GetFinishedMicrotaskCount() const = 0;
+
   MicrotaskQueue(const MicrotaskQueue&) = delete;
   MicrotaskQueue& operator=(const MicrotaskQueue&) = delete;
 
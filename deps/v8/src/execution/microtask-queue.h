@@ -73,6 +73,10 @@ class V8_EXPORT_PRIVATE MicrotaskQueue final : public v8::MicrotaskQueue {
   void DecrementMicrotasksScopeDepth() { --microtasks_depth_; }
   int GetMicrotasksScopeDepth() const override { return microtasks_depth_; }
 
+  size_t GetFinishedMicrotaskCount() const override {
+    return static_cast<size_t>(finished_microtask_count_);
+  }
+
   // Possibly nested microtasks suppression scopes prevent microtasks
   // from running.
   void IncrementMicrotasksSuppressions() { ++microtasks_suppressions_; }
@@ -44,6 +44,7 @@
 #include "src/heap/sweeper.h"
 #include "src/init/v8.h"
 #include "src/profiler/heap-profiler.h"
+#include "src/utils/allocation.h"
 
 namespace v8 {
 
@@ -107,14 +108,16 @@ namespace {
 
 class CppgcPlatformAdapter final : public cppgc::Platform {
  public:
-  explicit CppgcPlatformAdapter(v8::Platform* platform) : platform_(platform) {}
+  explicit CppgcPlatformAdapter(v8::Platform* platform)
+      : platform_(platform),
+        page_allocator_(platform->GetPageAllocator()
+                            ? platform->GetPageAllocator()
+                            : GetPlatformPageAllocator()) {}
 
   CppgcPlatformAdapter(const CppgcPlatformAdapter&) = delete;
   CppgcPlatformAdapter& operator=(const CppgcPlatformAdapter&) = delete;
 
-  PageAllocator* GetPageAllocator() final {
-    return platform_->GetPageAllocator();
-  }
+  PageAllocator* GetPageAllocator() final { return page_allocator_; }
 
   double MonotonicallyIncreasingTime() final {
     return platform_->MonotonicallyIncreasingTime();
@@ -143,6 +146,9 @@ class CppgcPlatformAdapter final : public cppgc::Platform {
 
  private:
   v8::Platform* platform_;
+  // Platforms are not required to provide a page allocator, in which case
+  // V8 uses its own, and so does the C++ heap.
+  v8::PageAllocator* page_allocator_;
   v8::Isolate* isolate_ = nullptr;
   bool is_in_detached_mode_ = false;
 };
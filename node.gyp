@@ -452,6 +452,7 @@
         'src/api/exceptions.cc',
         'src/api/hooks.cc',
         'src/api/utils.cc',
+        'src/array_buffer_pool.cc',
         'src/async_wrap.cc',
         'src/cares_wrap.cc',
         'src/connect_wrap.cc',
@@ -470,26 +471,35 @@
         'src/js_stream.cc',
         'src/json_utils.cc',
         'src/js_udp_wrap.cc',
+        'src/line_splitter.cc',
+        'src/memory_budget.cc',
+        'src/memory_tracker.cc',
         'src/module_wrap.cc',
+        'src/multi_string_search.cc',
         'src/node.cc',
         'src/node_api.cc',
         'src/node_binding.cc',
         'src/node_blob.cc',
         'src/node_buffer.cc',
+        'src/node_compile_cache.cc',
         'src/node_config.cc',
         'src/node_constants.cc',
         'src/node_contextify.cc',
+        'src/node_continuous_profiler.cc',
         'src/node_credentials.cc',
         'src/node_dir.cc',
         'src/node_env_var.cc',
         'src/node_errors.cc',
+        'src/node_executor_pool.cc',
         'src/node_external_reference.cc',
         'src/node_file.cc',
         'src/node_http_parser.cc',
         'src/node_http2.cc',
         'src/node_i18n.cc',
+        'src/node_log_sink.cc',
         'src/node_main_instance.cc',
         'src/node_messaging.cc',
+        'src/node_messaging_codec.cc',
         'src/node_metadata.cc',
         'src/node_native_module.cc',
         'src/node_native_module_env.cc',
@@ -498,22 +508,30 @@
         'src/node_perf.cc',
         'src/node_platform.cc',
         'src/node_postmortem_metadata.cc',
+        'src/node_pprof.cc',
         'src/node_process_events.cc',
         'src/node_process_methods.cc',
         'src/node_process_object.cc',
+        'src/node_realpath_cache.cc',
         'src/node_report.cc',
         'src/node_report_module.cc',
         'src/node_report_utils.cc',
+        'src/node_resolve_cache.cc',
+        'src/node_ring_channel.cc',
         'src/node_serdes.cc',
         'src/node_snapshotable.cc',
         'src/node_sockaddr.cc',
+        'src/node_startup_profile.cc',
+        'src/node_stall_detector.cc',
         'src/node_stat_watcher.cc',
         'src/node_symbols.cc',
         'src/node_task_queue.cc',
+        'src/node_thread_affinity.cc',
         'src/node_trace_events.cc',
         'src/node_types.cc',
         'src/node_url.cc',
         'src/node_url_tables.cc',
+        'src/node_usdt.cc',
         'src/node_util.cc',
         'src/node_v8.cc',
         'src/node_wasi.cc',
@@ -523,11 +541,17 @@
         'src/pipe_wrap.cc',
         'src/process_wrap.cc',
         'src/signal_wrap.cc',
+        'src/socket_pool.cc',
+        'src/spawn_server.cc',
         'src/spawn_sync.cc',
         'src/stream_base.cc',
+        'src/stream_ipc_channel.cc',
+        'src/stream_line_splitter.cc',
         'src/stream_pipe.cc',
         'src/stream_wrap.cc',
         'src/string_bytes.cc',
+        'src/base64.cc',
+        'src/utf8.cc',
         'src/string_decoder.cc',
         'src/tcp_wrap.cc',
         'src/timers.cc',
@@ -535,6 +559,7 @@
         'src/tracing/agent.cc',
         'src/tracing/node_trace_buffer.cc',
         'src/tracing/node_trace_writer.cc',
+        'src/tracing/proto_trace_writer.cc',
         'src/tracing/trace_event.cc',
         'src/tracing/traced_value.cc',
         'src/tty_wrap.cc',
@@ -547,6 +572,7 @@
         'src/aliased_struct-inl.h',
         'src/allocated_buffer.h',
         'src/allocated_buffer-inl.h',
+        'src/array_buffer_pool.h',
         'src/async_wrap.h',
         'src/async_wrap-inl.h',
         'src/base_object.h',
@@ -555,8 +581,11 @@
         'src/base64-inl.h',
         'src/callback_queue.h',
         'src/callback_queue-inl.h',
+        'src/chunk_list.h',
         'src/connect_wrap.h',
         'src/connection_wrap.h',
+        'src/cppgc_helpers.h',
+        'src/cppgc_helpers-inl.h',
         'src/debug_utils.h',
         'src/debug_utils-inl.h',
         'src/env.h',
@@ -564,24 +593,34 @@
         'src/handle_wrap.h',
         'src/histogram.h',
         'src/histogram-inl.h',
+        'src/idle_connection_pool.h',
+        'src/ipc_frame.h',
         'src/js_stream.h',
         'src/json_utils.h',
+        'src/large_pages/node_huge_pages.cc',
+        'src/large_pages/node_huge_pages.h',
         'src/large_pages/node_large_page.cc',
         'src/large_pages/node_large_page.h',
+        'src/line_splitter.h',
+        'src/memory_budget.h',
         'src/memory_tracker.h',
         'src/memory_tracker-inl.h',
         'src/module_wrap.h',
+        'src/multi_string_search.h',
         'src/node.h',
         'src/node_api.h',
         'src/node_api_types.h',
         'src/node_binding.h',
         'src/node_blob.h',
         'src/node_buffer.h',
+        'src/node_compile_cache.h',
         'src/node_constants.h',
         'src/node_context_data.h',
         'src/node_contextify.h',
+        'src/node_continuous_profiler.h',
         'src/node_dir.h',
         'src/node_errors.h',
+        'src/node_executor_pool.h',
         'src/node_external_reference.h',
         'src/node_file.h',
         'src/node_file-inl.h',
@@ -591,10 +630,12 @@
         'src/node_http2_state.h',
         'src/node_i18n.h',
         'src/node_internals.h',
+        'src/node_log_sink.h',
         'src/node_main_instance.h',
         'src/node_mem.h',
         'src/node_mem-inl.h',
         'src/node_messaging.h',
+        'src/node_messaging_codec.h',
         'src/node_metadata.h',
         'src/node_mutex.h',
         'src/node_native_module.h',
@@ -605,17 +646,26 @@
         'src/node_perf.h',
         'src/node_perf_common.h',
         'src/node_platform.h',
+        'src/node_pprof.h',
         'src/node_process.h',
         'src/node_process-inl.h',
+        'src/node_protobuf.h',
+        'src/node_realpath_cache.h',
         'src/node_report.h',
+        'src/node_resolve_cache.h',
         'src/node_revert.h',
+        'src/node_ring_channel.h',
         'src/node_root_certs.h',
         'src/node_snapshotable.h',
         'src/node_sockaddr.h',
         'src/node_sockaddr-inl.h',
+        'src/node_startup_profile.h',
+        'src/node_stall_detector.h',
         'src/node_stat_watcher.h',
+        'src/node_thread_affinity.h',
         'src/node_union_bytes.h',
         'src/node_url.h',
+        'src/node_usdt.h',
         'src/node_version.h',
         'src/node_v8.h',
         'src/node_v8_platform-inl.h',
@@ -625,6 +675,8 @@
         'src/pipe_wrap.h',
         'src/req_wrap.h',
         'src/req_wrap-inl.h',
+        'src/server_counters.h',
+        'src/spawn_server.h',
         'src/spawn_sync.h',
         'src/stream_base.h',
         'src/stream_base-inl.h',
@@ -638,13 +690,16 @@
         'src/tracing/agent.h',
         'src/tracing/node_trace_buffer.h',
         'src/tracing/node_trace_writer.h',
+        'src/tracing/proto_trace_writer.h',
         'src/tracing/trace_event.h',
         'src/tracing/trace_event_common.h',
         'src/tracing/traced_value.h',
         'src/timer_wrap.h',
         'src/timer_wrap-inl.h',
+        'src/timers.h',
         'src/tty_wrap.h',
         'src/udp_wrap.h',
+        'src/utf8.h',
         'src/util.h',
         'src/util-inl.h',
         # Dependency headers
@@ -814,6 +869,8 @@
             'src/crypto/crypto_keys.cc',
             'src/crypto/crypto_keygen.cc',
             'src/crypto/crypto_scrypt.cc',
+            'src/crypto/crypto_pem_cache.cc',
+            'src/crypto/crypto_session_cache.cc',
             'src/crypto/crypto_tls.cc',
             'src/crypto/crypto_aes.cc',
             'src/crypto/crypto_x509.cc',
@@ -832,6 +889,8 @@
             'src/crypto/crypto_keys.h',
             'src/crypto/crypto_keygen.h',
             'src/crypto/crypto_scrypt.h',
+            'src/crypto/crypto_pem_cache.h',
+            'src/crypto/crypto_session_cache.h',
             'src/crypto/crypto_tls.h',
             'src/crypto/crypto_clienthello.h',
             'src/crypto/crypto_context.h',
@@ -1198,20 +1257,39 @@
         'test/cctest/node_test_fixture.cc',
         'test/cctest/node_test_fixture.h',
         'test/cctest/test_aliased_buffer.cc',
+        'test/cctest/test_array_buffer_pool.cc',
         'test/cctest/test_base64.cc',
         'test/cctest/test_base_object_ptr.cc',
+        'test/cctest/test_callback_queue.cc',
+        'test/cctest/test_chunk_list.cc',
+        'test/cctest/test_cppgc.cc',
         'test/cctest/test_node_postmortem_metadata.cc',
         'test/cctest/test_environment.cc',
+        'test/cctest/test_histogram.cc',
+        'test/cctest/test_idle_connection_pool.cc',
+        'test/cctest/test_ipc_frame.cc',
         'test/cctest/test_js_native_api_v8.cc',
+        'test/cctest/test_line_splitter.cc',
         'test/cctest/test_linked_binding.cc',
+        'test/cctest/test_log_sink.cc',
+        'test/cctest/test_memory_budget.cc',
+        'test/cctest/test_multi_string_search.cc',
         'test/cctest/test_node_api.cc',
         'test/cctest/test_per_process.cc',
         'test/cctest/test_platform.cc',
+        'test/cctest/test_read_buffer_pool.cc',
+        'test/cctest/test_realpath_cache.cc',
+        'test/cctest/test_ring_channel.cc',
         'test/cctest/test_json_utils.cc',
+        'test/cctest/test_messaging_codec.cc',
         'test/cctest/test_sockaddr.cc',
+        'test/cctest/test_spawn_server.cc',
+        'test/cctest/test_string_bytes.cc',
+        'test/cctest/test_timer_wheel.cc',
         'test/cctest/test_traced_value.cc',
         'test/cctest/test_util.cc',
         'test/cctest/test_url.cc',
+        'test/cctest/test_utf8.cc',
       ],
 
       'conditions': [
@@ -1258,6 +1336,134 @@
       ],
     }, # cctest
 
+    {
+      'target_name': 'native_benchmark',
+      'type': 'executable',
+
+      'dependencies': [
+        '<(node_lib_target_name)',
+        'deps/histogram/histogram.gyp:histogram',
+        'deps/uvwasi/uvwasi.gyp:uvwasi',
+        'node_dtrace_header',
+        'node_dtrace_ustack',
+        'node_dtrace_provider',
+      ],
+
+      'includes': [
+        'node.gypi'
+      ],
+
+      'include_dirs': [
+        'src',
+        'tools/msvs/genfiles',
+        'deps/v8/include',
+        'deps/cares/include',
+        'deps/uv/include',
+        'deps/uvwasi/include',
+        'benchmark/native',
+      ],
+
+      'defines': [
+        'NODE_ARCH="<(target_arch)"',
+        'NODE_PLATFORM="<(OS)"',
+        'NODE_WANT_INTERNALS=1',
+      ],
+
+      'sources': [
+        'src/node_snapshot_stub.cc',
+        'src/node_code_cache_stub.cc',
+        'benchmark/native/bench_base64.cc',
+        'benchmark/native/bench_histogram.cc',
+        'benchmark/native/bench_http_parser.cc',
+        'benchmark/native/bench_sockaddr.cc',
+        'benchmark/native/bench_string_bytes.cc',
+        'benchmark/native/bench_url.cc',
+        'benchmark/native/bench_zlib.cc',
+        'benchmark/native/native_benchmark.cc',
+        'benchmark/native/native_benchmark.h',
+      ],
+
+      'conditions': [
+        [ 'node_use_openssl=="true"', {
+          'defines': [
+            'HAVE_OPENSSL=1',
+          ],
+        }],
+        ['v8_enable_inspector==1', {
+          'defines': [
+            'HAVE_INSPECTOR=1',
+          ],
+        }, {
+           'defines': [
+             'HAVE_INSPECTOR=0',
+           ]
+        }],
+        ['OS=="solaris"', {
+          'ldflags': [ '-I<(SHARED_INTERMEDIATE_DIR)' ]
+        }],
+        # Skip native_benchmark while building shared lib node for Windows
+        [ 'OS=="win" and node_shared=="true"', {
+          'type': 'none',
+        }],
+        [ 'node_shared=="true"', {
+          'xcode_settings': {
+            'OTHER_LDFLAGS': [ '-Wl,-rpath,@loader_path', ],
+          },
+        }],
+        ['OS=="win"', {
+          'libraries': [
+            'Dbghelp.lib',
+            'winmm.lib',
+            'Ws2_32.lib',
+          ],
+        }],
+      ],
+    }, # native_benchmark
+
+    {
+      'target_name': 'load_generator',
+      'type': 'executable',
+
+      'dependencies': [
+        'deps/histogram/histogram.gyp:histogram',
+      ],
+
+      'include_dirs': [
+        'deps/histogram/src',
+      ],
+
+      'sources': [
+        'benchmark/net/load_generator.cc',
+      ],
+
+      'conditions': [
+        [ 'node_shared_libuv=="false"', {
+          'dependencies': [ 'deps/uv/uv.gyp:libuv' ],
+        }],
+        [ 'node_shared_http_parser=="false"', {
+          'dependencies': [ 'deps/llhttp/llhttp.gyp:llhttp' ],
+        }],
+        [ 'node_shared_nghttp2=="false"', {
+          'dependencies': [ 'deps/nghttp2/nghttp2.gyp:nghttp2' ],
+        }],
+        [ 'node_use_openssl=="true"', {
+          'defines': [
+            'HAVE_OPENSSL=1',
+          ],
+          'conditions': [
+            [ 'node_shared_openssl=="false"', {
+              'dependencies': [ './deps/openssl/openssl.gyp:openssl' ],
+            }],
+          ],
+        }],
+        ['OS=="win"', {
+          'libraries': [
+            'Ws2_32.lib',
+          ],
+        }],
+      ],
+    }, # load_generator
+
     {
       'target_name': 'embedtest',
       'type': 'executable',
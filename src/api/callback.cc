@@ -12,6 +12,7 @@ using v8::HandleScope;
 using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
+using v8::MicrotaskQueue;
 using v8::Object;
 using v8::String;
 using v8::Value;
@@ -42,7 +43,11 @@ InternalCallbackScope::InternalCallbackScope(AsyncWrap* async_wrap, int flags)
                             async_wrap->object(),
                             { async_wrap->get_async_id(),
                               async_wrap->get_trigger_async_id() },
-                            flags) {}
+                            flags) {
+  if (failed_) return;
+  entered_context_frame_ = env_->async_hooks()->EnterContextFrame(
+      async_wrap->context_frame_, &prior_context_frame_);
+}
 
 InternalCallbackScope::InternalCallbackScope(Environment* env,
                                              Local<Object> object,
@@ -97,6 +102,10 @@ void InternalCallbackScope::Close() {
   if (closed_) return;
   closed_ = true;
 
+  // The callback is done, so the task queues below run in the outer frame.
+  if (entered_context_frame_)
+    env_->async_hooks()->ExitContextFrame(&prior_context_frame_);
+
   Isolate* isolate = env_->isolate();
   auto idle = OnScopeLeave([&]() { isolate->SetIdle(true); });
 
@@ -129,8 +138,19 @@ void InternalCallbackScope::Close() {
   auto weakref_cleanup = OnScopeLeave([&]() { env_->RunWeakRefCleanup(); });
 
   Local<Context> context = env_->context();
+  MicrotaskQueue* microtask_queue = context->GetMicrotaskQueue();
+  uint64_t drain_start;
+  size_t drain_microtasks;
+  if (!env_->BeginTaskQueueDrain(
+          microtask_queue, &drain_start, &drain_microtasks)) {
+    return;
+  }
+  auto end_drain = OnScopeLeave([&]() {
+    env_->EndTaskQueueDrain(microtask_queue, drain_start, drain_microtasks);
+  });
+
   if (!tick_info->has_tick_scheduled()) {
-    context->GetMicrotaskQueue()->PerformCheckpoint(isolate);
+    microtask_queue->PerformCheckpoint(isolate);
 
     perform_stopping_check();
   }
@@ -1,12 +1,20 @@
+#include "array_buffer_pool.h"
+#include "large_pages/node_huge_pages.h"
 #include "node.h"
+#include "node_compile_cache.h"
 #include "node_context_data.h"
 #include "node_errors.h"
 #include "node_internals.h"
+#include "node_log_sink.h"
 #include "node_native_module_env.h"
 #include "node_platform.h"
+#include "node_resolve_cache.h"
 #include "node_v8_platform-inl.h"
+#include "stream_wrap.h"
 #include "uv.h"
 
+#include <cstdlib>
+
 #if HAVE_INSPECTOR
 #include "inspector/worker_inspector.h"  // ParentInspectorHandle
 #endif
@@ -82,33 +90,52 @@ MaybeLocal<Value> PrepareStackTraceCallback(Local<Context> context,
 
 void* NodeArrayBufferAllocator::Allocate(size_t size) {
   void* ret;
-  if (zero_fill_field_ || per_process::cli_options->zero_fill_all_buffers)
+  if (UNLIKELY(huge_pages::ShouldUse(size)))
+    ret = huge_pages::Allocate(size);  // Always zero-filled.
+  else if (zero_fill_field_ || per_process::cli_options->zero_fill_all_buffers)
     ret = UncheckedCalloc(size);
   else
     ret = UncheckedMalloc(size);
   if (LIKELY(ret != nullptr))
-    total_mem_usage_.fetch_add(size, std::memory_order_relaxed);
+    AddMemUsage(static_cast<int64_t>(size));
   return ret;
 }
 
 void* NodeArrayBufferAllocator::AllocateUninitialized(size_t size) {
-  void* ret = node::UncheckedMalloc(size);
+  void* ret = UNLIKELY(huge_pages::ShouldUse(size)) ?
+      huge_pages::Allocate(size) : node::UncheckedMalloc(size);
   if (LIKELY(ret != nullptr))
-    total_mem_usage_.fetch_add(size, std::memory_order_relaxed);
+    AddMemUsage(static_cast<int64_t>(size));
   return ret;
 }
 
 void* NodeArrayBufferAllocator::Reallocate(
     void* data, size_t old_size, size_t size) {
+  if (UNLIKELY(huge_pages::ShouldUse(old_size) ||
+               huge_pages::ShouldUse(size))) {
+    // Memory cannot move between huge pages and malloc(), so copy it.
+    void* ret = nullptr;
+    if (size > 0) {
+      ret = NodeArrayBufferAllocator::AllocateUninitialized(size);
+      if (UNLIKELY(ret == nullptr))
+        return nullptr;
+      memcpy(ret, data, std::min(old_size, size));
+    }
+    NodeArrayBufferAllocator::Free(data, old_size);
+    return ret;
+  }
   void* ret = UncheckedRealloc<char>(static_cast<char*>(data), size);
   if (LIKELY(ret != nullptr) || UNLIKELY(size == 0))
-    total_mem_usage_.fetch_add(size - old_size, std::memory_order_relaxed);
+    AddMemUsage(static_cast<int64_t>(size) - static_cast<int64_t>(old_size));
   return ret;
 }
 
 void NodeArrayBufferAllocator::Free(void* data, size_t size) {
-  total_mem_usage_.fetch_sub(size, std::memory_order_relaxed);
-  free(data);
+  AddMemUsage(-static_cast<int64_t>(size));
+  if (UNLIKELY(huge_pages::ShouldUse(size)))
+    huge_pages::Free(data, size);
+  else
+    free(data);
 }
 
 DebuggingArrayBufferAllocator::~DebuggingArrayBufferAllocator() {
@@ -188,9 +215,63 @@ void DebuggingArrayBufferAllocator::RegisterPointerInternal(void* data,
   allocations_[data] = size;
 }
 
+void* PooledArrayBufferAllocator::Allocate(size_t size) {
+  if (!array_buffer_pool::Serves(size))
+    return NodeArrayBufferAllocator::Allocate(size);
+  void* ret = array_buffer_pool::Allocate(size);
+  if (LIKELY(ret != nullptr)) {
+    if (zero_fill_field()[0] || per_process::cli_options->zero_fill_all_buffers)
+      memset(ret, 0, size);
+    NodeArrayBufferAllocator::RegisterPointer(ret, size);
+  }
+  return ret;
+}
+
+void* PooledArrayBufferAllocator::AllocateUninitialized(size_t size) {
+  if (!array_buffer_pool::Serves(size))
+    return NodeArrayBufferAllocator::AllocateUninitialized(size);
+  void* ret = array_buffer_pool::Allocate(size);
+  if (LIKELY(ret != nullptr))
+    NodeArrayBufferAllocator::RegisterPointer(ret, size);
+  return ret;
+}
+
+void PooledArrayBufferAllocator::Free(void* data, size_t size) {
+  if (!array_buffer_pool::Serves(size))
+    return NodeArrayBufferAllocator::Free(data, size);
+  NodeArrayBufferAllocator::UnregisterPointer(data, size);
+  array_buffer_pool::Free(data, size);
+}
+
+void* PooledArrayBufferAllocator::Reallocate(
+    void* data, size_t old_size, size_t size) {
+  const bool pooled = array_buffer_pool::Serves(old_size);
+  if (!pooled && !array_buffer_pool::Serves(size))
+    return NodeArrayBufferAllocator::Reallocate(data, old_size, size);
+  if (pooled && array_buffer_pool::Serves(size) &&
+      array_buffer_pool::BlockSize(old_size) ==
+          array_buffer_pool::BlockSize(size)) {
+    NodeArrayBufferAllocator::UnregisterPointer(data, old_size);
+    NodeArrayBufferAllocator::RegisterPointer(data, size);
+    return data;
+  }
+  if (size == 0) {
+    Free(data, old_size);
+    return nullptr;
+  }
+  void* ret = AllocateUninitialized(size);
+  if (UNLIKELY(ret == nullptr))
+    return nullptr;
+  memcpy(ret, data, std::min(old_size, size));
+  Free(data, old_size);
+  return ret;
+}
+
 std::unique_ptr<ArrayBufferAllocator> ArrayBufferAllocator::Create(bool debug) {
   if (debug || per_process::cli_options->debug_arraybuffer_allocations)
     return std::make_unique<DebuggingArrayBufferAllocator>();
+  else if (per_process::cli_options->arraybuffer_pool)
+    return std::make_unique<PooledArrayBufferAllocator>();
   else
     return std::make_unique<NodeArrayBufferAllocator>();
 }
@@ -256,6 +337,10 @@ void SetIsolateMiscHandlers(v8::Isolate* isolate, const IsolateSettings& s) {
 
   if (s.flags & DETAILED_SOURCE_POSITIONS_FOR_PROFILING)
     v8::CpuProfiler::UseDetailedSourcePositionsForProfiling(isolate);
+
+  // Only with --compile-cache-dir, so as not to replace an embedder's own.
+  if (CompileCache::Get() != nullptr)
+    isolate->SetWasmStreamingCallback(WasmStreamingCallback);
 }
 
 void SetIsolateUpForNode(v8::Isolate* isolate,
@@ -750,7 +835,30 @@ ThreadId AllocateEnvironmentThreadId() {
   return ThreadId { next_thread_id++ };
 }
 
+void FastExit(Environment* env, int exit_code) {
+  CHECK(env->is_main_thread());
+  env->set_can_call_into_js(false);
+  {
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    LibuvStreamWrap::FlushCoalescedWritesSync(env);
+    env->RunCriticalExitHooks();
+  }
+  log_sink::LogWriter::FlushAll();
+  ResolveCache::Persist();
+  // Closes the trace file, after writing out what is buffered.
+  per_process::v8_platform.StopTracingAgent();
+  ResetStdio();
+  fflush(stdout);
+  fflush(stderr);
+  // Neither atexit() handlers nor static destructors run from here, and
+  // worker threads are not stopped first.
+  std::_Exit(exit_code);
+}
+
 void DefaultProcessExitHandler(Environment* env, int exit_code) {
+  if (per_process::cli_options->fast_exit && env->is_main_thread())
+    FastExit(env, exit_code);
   env->set_can_call_into_js(false);
   env->stop_sub_worker_contexts();
   DisposePlatform();
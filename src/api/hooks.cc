@@ -125,6 +125,14 @@ void AddEnvironmentCleanupHook(Isolate* isolate,
   env->AddCleanupHook(fun, arg);
 }
 
+void AddCriticalEnvironmentCleanupHook(Isolate* isolate,
+                                       CleanupHook fun,
+                                       void* arg) {
+  Environment* env = Environment::GetCurrent(isolate);
+  CHECK_NOT_NULL(env);
+  env->AddCleanupHook(fun, arg, true);
+}
+
 void RemoveEnvironmentCleanupHook(Isolate* isolate,
                                   CleanupHook fun,
                                   void* arg) {
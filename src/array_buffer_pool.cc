@@ -0,0 +1,388 @@
+#include "array_buffer_pool.h"
+#include "node_mutex.h"
+#include "util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace node {
+namespace array_buffer_pool {
+
+namespace {
+
+constexpr size_t kSlabSize = 256 * 1024;
+constexpr size_t kSlabHeaderSize = 64;
+constexpr size_t kMinBlockSize = 16;
+// Sizes up to 128 bytes in steps of 16 bytes, and then four classes for
+// every power of two, which wastes at most a fifth of each block.
+constexpr size_t kClassCount = 8 + 4 * 7;
+// How many blocks a thread moves between its own cache and the slabs at
+// once, at most.
+constexpr size_t kMaxBatch = 32;
+constexpr size_t kBatchBytes = 32 * 1024;
+
+constexpr size_t ClassSize(size_t index) {
+  return index < 8 ?
+      kMinBlockSize * (index + 1) :
+      (size_t{128} << ((index - 8) / 4)) / 4 * (4 + 1 + (index - 8) % 4);
+}
+
+static_assert(ClassSize(kClassCount - 1) == kMaxBlockSize,
+              "The largest size class must match kMaxBlockSize");
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// Lives at the start of each slab. All fields are protected by the mutex
+// of the size class that the slab belongs to.
+struct Slab {
+  Slab* prev;
+  Slab* next;
+  FreeBlock* free_list;
+  uint32_t carved;  // Blocks handed out at least once since the last reset.
+  uint32_t live;    // Blocks in use, including those in thread caches.
+  bool listed;      // Whether the slab is on its class's `available` list.
+  bool resident;    // False after its memory was returned to the OS.
+};
+
+static_assert(sizeof(Slab) <= kSlabHeaderSize, "Slab header too large");
+
+struct SizeClass {
+  Mutex mutex;
+  size_t block_size;
+  uint32_t capacity;  // Blocks per slab.
+  uint32_t batch;
+  // Slabs with blocks to hand out. Those whose memory was returned to the
+  // OS go last, so that resident ones are filled up first.
+  Slab* available_head = nullptr;
+  Slab* available_tail = nullptr;
+  // Resident slabs without blocks in use.
+  size_t empty_slabs = 0;
+};
+
+Slab* SlabOf(void* block) {
+  return reinterpret_cast<Slab*>(
+      reinterpret_cast<uintptr_t>(block) & ~(kSlabSize - 1));
+}
+
+size_t PageSize() {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Maps kSlabSize bytes, aligned to kSlabSize so that SlabOf() works.
+void* MapSlab() {
+#ifdef _WIN32
+  for (int attempt = 0; attempt < 8; attempt++) {
+    // Find an aligned range of free address space, then map it on its
+    // own. Another thread can take the range in between, hence the retry.
+    void* range = VirtualAlloc(nullptr, 2 * kSlabSize, MEM_RESERVE,
+                               PAGE_NOACCESS);
+    if (range == nullptr)
+      return nullptr;
+    uintptr_t aligned = RoundUp(reinterpret_cast<uintptr_t>(range),
+                                kSlabSize);
+    VirtualFree(range, 0, MEM_RELEASE);
+    void* slab = VirtualAlloc(reinterpret_cast<void*>(aligned), kSlabSize,
+                              MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (slab != nullptr)
+      return slab;
+  }
+  return nullptr;
+#else
+  void* range = mmap(nullptr, 2 * kSlabSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (range == MAP_FAILED)
+    return nullptr;
+  char* start = static_cast<char*>(range);
+  char* slab = reinterpret_cast<char*>(
+      RoundUp(reinterpret_cast<uintptr_t>(range), kSlabSize));
+  if (slab != start)
+    munmap(start, slab - start);
+  munmap(slab + kSlabSize, start + kSlabSize - slab);
+  return slab;
+#endif
+}
+
+void ReturnPages(void* start, size_t length) {
+#ifdef _WIN32
+  VirtualAlloc(start, length, MEM_RESET, PAGE_READWRITE);
+#else
+  madvise(start, length, MADV_DONTNEED);
+#endif
+}
+
+class Pool {
+ public:
+  Pool();
+
+  size_t ClassIndex(size_t size) const {
+    return class_of_[(size + kMinBlockSize - 1) / kMinBlockSize];
+  }
+  const SizeClass& size_class(size_t index) const { return classes_[index]; }
+
+  // Move up to `count` blocks onto the list at `*head`, and return how
+  // many it were.
+  size_t TakeBlocks(size_t index, FreeBlock** head, size_t count);
+  // Return the blocks on the null-terminated list at `head`.
+  void ReturnBlocks(size_t index, FreeBlock* head);
+
+ private:
+  void Unlink(SizeClass* size_class, Slab* slab);
+  void PushFront(SizeClass* size_class, Slab* slab);
+  void PushBack(SizeClass* size_class, Slab* slab);
+
+  SizeClass classes_[kClassCount];
+  uint8_t class_of_[kMaxBlockSize / kMinBlockSize + 1];
+  const size_t page_size_;
+};
+
+// Kept outside of the pool, so that reading them does not create it.
+std::atomic<size_t> committed_bytes {0};
+std::atomic<size_t> used_bytes {0};
+std::atomic<size_t> returned_bytes {0};
+
+Pool::Pool() : page_size_(PageSize()) {
+  size_t index = 0;
+  for (size_t i = 0; i < arraysize(class_of_); i++) {
+    while (ClassSize(index) < i * kMinBlockSize)
+      index++;
+    class_of_[i] = static_cast<uint8_t>(index);
+  }
+  for (size_t i = 0; i < kClassCount; i++) {
+    SizeClass* size_class = &classes_[i];
+    size_class->block_size = ClassSize(i);
+    size_class->capacity = static_cast<uint32_t>(
+        (kSlabSize - kSlabHeaderSize) / size_class->block_size);
+    size_class->batch = static_cast<uint32_t>(std::max<size_t>(
+        1, std::min<size_t>(kMaxBatch, kBatchBytes / size_class->block_size)));
+  }
+}
+
+void Pool::Unlink(SizeClass* size_class, Slab* slab) {
+  if (slab->prev != nullptr)
+    slab->prev->next = slab->next;
+  else
+    size_class->available_head = slab->next;
+  if (slab->next != nullptr)
+    slab->next->prev = slab->prev;
+  else
+    size_class->available_tail = slab->prev;
+  slab->prev = slab->next = nullptr;
+  slab->listed = false;
+}
+
+void Pool::PushFront(SizeClass* size_class, Slab* slab) {
+  slab->prev = nullptr;
+  slab->next = size_class->available_head;
+  if (slab->next != nullptr)
+    slab->next->prev = slab;
+  else
+    size_class->available_tail = slab;
+  size_class->available_head = slab;
+  slab->listed = true;
+}
+
+void Pool::PushBack(SizeClass* size_class, Slab* slab) {
+  slab->next = nullptr;
+  slab->prev = size_class->available_tail;
+  if (slab->prev != nullptr)
+    slab->prev->next = slab;
+  else
+    size_class->available_head = slab;
+  size_class->available_tail = slab;
+  slab->listed = true;
+}
+
+size_t Pool::TakeBlocks(size_t index, FreeBlock** head, size_t count) {
+  SizeClass* size_class = &classes_[index];
+  const size_t block_size = size_class->block_size;
+  size_t taken = 0;
+  Mutex::ScopedLock lock(size_class->mutex);
+  while (taken < count) {
+    Slab* slab = size_class->available_head;
+    if (slab == nullptr) {
+      slab = static_cast<Slab*>(MapSlab());
+      if (slab == nullptr)
+        break;
+      *slab = Slab {};
+      slab->resident = true;
+      committed_bytes.fetch_add(kSlabSize, std::memory_order_relaxed);
+      PushFront(size_class, slab);
+    } else if (!slab->resident) {
+      slab->resident = true;
+      committed_bytes.fetch_add(kSlabSize - page_size_,
+                                std::memory_order_relaxed);
+    } else if (slab->live == 0) {
+      size_class->empty_slabs--;
+    }
+
+    char* blocks = reinterpret_cast<char*>(slab) + kSlabHeaderSize;
+    for (; taken < count; taken++) {
+      FreeBlock* block = slab->free_list;
+      if (block != nullptr) {
+        slab->free_list = block->next;
+      } else if (slab->carved < size_class->capacity) {
+        block = reinterpret_cast<FreeBlock*>(
+            blocks + slab->carved++ * block_size);
+      } else {
+        break;
+      }
+      slab->live++;
+      block->next = *head;
+      *head = block;
+    }
+    if (slab->free_list == nullptr && slab->carved == size_class->capacity)
+      Unlink(size_class, slab);
+  }
+  used_bytes.fetch_add(taken * block_size, std::memory_order_relaxed);
+  return taken;
+}
+
+void Pool::ReturnBlocks(size_t index, FreeBlock* head) {
+  SizeClass* size_class = &classes_[index];
+  size_t returned = 0;
+  Mutex::ScopedLock lock(size_class->mutex);
+  while (head != nullptr) {
+    FreeBlock* block = head;
+    head = head->next;
+    returned++;
+
+    Slab* slab = SlabOf(block);
+    block->next = slab->free_list;
+    slab->free_list = block;
+    if (!slab->listed)
+      PushFront(size_class, slab);
+    if (--slab->live != 0)
+      continue;
+    if (size_class->empty_slabs == 0) {
+      size_class->empty_slabs++;
+      continue;
+    }
+    // Keep the header page, and start over with the slab once it is used
+    // again, as the contents of the other pages are gone.
+    slab->free_list = nullptr;
+    slab->carved = 0;
+    slab->resident = false;
+    ReturnPages(reinterpret_cast<char*>(slab) + page_size_,
+                kSlabSize - page_size_);
+    committed_bytes.fetch_sub(kSlabSize - page_size_,
+                              std::memory_order_relaxed);
+    returned_bytes.fetch_add(kSlabSize - page_size_,
+                             std::memory_order_relaxed);
+    Unlink(size_class, slab);
+    PushBack(size_class, slab);
+  }
+  used_bytes.fetch_sub(returned * size_class->block_size,
+                       std::memory_order_relaxed);
+}
+
+Pool* GetPool() {
+  // Never destroyed, as threads can hand back their caches at any time.
+  static Pool* const pool = new Pool();
+  return pool;
+}
+
+struct ThreadCache {
+  struct Bin {
+    FreeBlock* head = nullptr;
+    size_t count = 0;
+  };
+
+  ~ThreadCache();
+
+  Bin bins[kClassCount];
+};
+
+thread_local ThreadCache thread_cache;
+// Set once `thread_cache` has been destroyed on this thread, after which
+// buffers that are freed during thread teardown go to the slabs directly.
+thread_local bool thread_cache_gone = false;
+
+ThreadCache::~ThreadCache() {
+  thread_cache_gone = true;
+  for (size_t i = 0; i < kClassCount; i++) {
+    if (bins[i].head != nullptr)
+      GetPool()->ReturnBlocks(i, bins[i].head);
+  }
+}
+
+}  // anonymous namespace
+
+size_t BlockSize(size_t size) {
+  CHECK(Serves(size));
+  return ClassSize(GetPool()->ClassIndex(size));
+}
+
+void* Allocate(size_t size) {
+  Pool* pool = GetPool();
+  const size_t index = pool->ClassIndex(size);
+  if (UNLIKELY(thread_cache_gone)) {
+    FreeBlock* block = nullptr;
+    pool->TakeBlocks(index, &block, 1);
+    return block;
+  }
+
+  ThreadCache::Bin* bin = &thread_cache.bins[index];
+  if (bin->head == nullptr) {
+    bin->count = pool->TakeBlocks(index, &bin->head,
+                                  pool->size_class(index).batch);
+    if (bin->head == nullptr)
+      return nullptr;
+  }
+  FreeBlock* block = bin->head;
+  bin->head = block->next;
+  bin->count--;
+  return block;
+}
+
+void Free(void* data, size_t size) {
+  Pool* pool = GetPool();
+  const size_t index = pool->ClassIndex(size);
+  FreeBlock* block = static_cast<FreeBlock*>(data);
+  if (UNLIKELY(thread_cache_gone)) {
+    block->next = nullptr;
+    pool->ReturnBlocks(index, block);
+    return;
+  }
+
+  ThreadCache::Bin* bin = &thread_cache.bins[index];
+  block->next = bin->head;
+  bin->head = block;
+  const size_t batch = pool->size_class(index).batch;
+  if (++bin->count <= 2 * batch)
+    return;
+  // Hand back the older half of the cache.
+  FreeBlock* last_kept = bin->head;
+  for (size_t i = 1; i < batch; i++)
+    last_kept = last_kept->next;
+  FreeBlock* rest = last_kept->next;
+  last_kept->next = nullptr;
+  bin->count = batch;
+  pool->ReturnBlocks(index, rest);
+}
+
+Statistics GetStatistics() {
+  return Statistics {
+    committed_bytes.load(std::memory_order_relaxed),
+    used_bytes.load(std::memory_order_relaxed),
+    returned_bytes.load(std::memory_order_relaxed)
+  };
+}
+
+}  // namespace array_buffer_pool
+}  // namespace node
@@ -0,0 +1,48 @@
+#ifndef SRC_ARRAY_BUFFER_POOL_H_
+#define SRC_ARRAY_BUFFER_POOL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+
+namespace node {
+
+// A process-wide pool for small ArrayBuffer backing stores, used by
+// --arraybuffer-pool. Sizes are rounded up to one of a few dozen size
+// classes, and each class is served from 256 KiB slabs of equally sized
+// blocks, so that short-lived buffers do not fragment the malloc() heap.
+// Every thread keeps a few free blocks of each class, to avoid taking
+// a lock for most allocations. Slabs that become completely free are
+// returned to the operating system, except for one of each class that is
+// kept for reuse.
+namespace array_buffer_pool {
+
+constexpr size_t kMaxBlockSize = 16 * 1024;
+
+struct Statistics {
+  size_t committed;  // Slab memory that has not been returned to the OS.
+  size_t used;       // Of that, the memory in blocks that are in use, or
+                     // that threads keep for reuse.
+  size_t returned;   // Slab memory returned to the OS since startup.
+};
+
+inline bool Serves(size_t size) {
+  return size > 0 && size <= kMaxBlockSize;
+}
+
+// The size that `size` is rounded up to. `size` must be one that the pool
+// serves.
+size_t BlockSize(size_t size);
+// Returns an uninitialized block of BlockSize(size) bytes, or nullptr.
+void* Allocate(size_t size);
+// `size` must be the size that `data` was allocated with.
+void Free(void* data, size_t size);
+
+Statistics GetStatistics();
+
+}  // namespace array_buffer_pool
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_ARRAY_BUFFER_POOL_H_
@@ -106,7 +106,18 @@ void AsyncWrap::EmitPromiseResolve(Environment* env, double async_id) {
 }
 
 
+// The category flag is looked up once here, instead of once per provider in
+// each of the switches below, so that wraps cost a single load when the
+// async_hooks trace category is disabled.
+static inline bool IsTraceEnabled() {
+  static const uint8_t* enabled = TRACE_EVENT_API_GET_CATEGORY_GROUP_ENABLED(
+      TRACING_CATEGORY_NODE1(async_hooks));
+  return *enabled != 0;
+}
+
+
 void AsyncWrap::EmitTraceEventBefore() {
+  if (!IsTraceEnabled()) return;
   switch (provider_type()) {
 #define V(PROVIDER)                                                           \
     case PROVIDER_ ## PROVIDER:                                               \
@@ -129,6 +140,7 @@ void AsyncWrap::EmitBefore(Environment* env, double async_id) {
 
 
 void AsyncWrap::EmitTraceEventAfter(ProviderType type, double async_id) {
+  if (!IsTraceEnabled()) return;
   switch (type) {
 #define V(PROVIDER)                                                           \
     case PROVIDER_ ## PROVIDER:                                               \
@@ -195,6 +207,19 @@ static void SetPromiseHooks(const FunctionCallbackInfo<Value>& args) {
     args[3]->IsFunction() ? args[3].As<Function>() : Local<Function>());
 }
 
+static void GetContextFrame(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Local<Value> frame = env->async_hooks()->context_frame();
+  if (!frame.IsEmpty()) args.GetReturnValue().Set(frame);
+}
+
+static void SetContextFrame(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  AsyncHooks* hooks = env->async_hooks();
+  hooks->EnableContextFramePromiseHook();
+  hooks->set_context_frame(args[0]->IsUndefined() ? Local<Value>() : args[0]);
+}
+
 class DestroyParam {
  public:
   double asyncId;
@@ -311,7 +336,8 @@ void AsyncWrap::EmitDestroy(bool from_gc) {
   // Ensure no double destroy is emitted via AsyncReset().
   async_id_ = kInvalidAsyncId;
 
-  if (!persistent().IsEmpty() && !from_gc) {
+  if (has_resource_ && !persistent().IsEmpty() && !from_gc) {
+    has_resource_ = false;
     HandleScope handle_scope(env()->isolate());
     USE(object()->Set(env()->context(), env()->resource_symbol(), object()));
   }
@@ -364,6 +390,8 @@ void AsyncWrap::Initialize(Local<Object> target,
   env->SetMethod(target, "clearAsyncIdStack", ClearAsyncIdStack);
   env->SetMethod(target, "queueDestroyAsyncId", QueueDestroyAsyncId);
   env->SetMethod(target, "setPromiseHooks", SetPromiseHooks);
+  env->SetMethod(target, "getContextFrame", GetContextFrame);
+  env->SetMethod(target, "setContextFrame", SetContextFrame);
   env->SetMethod(target, "registerDestroyHook", RegisterDestroyHook);
 
   PropertyAttribute ReadOnlyDontDelete =
@@ -455,6 +483,8 @@ void AsyncWrap::RegisterExternalReferences(
   registry->Register(ClearAsyncIdStack);
   registry->Register(QueueDestroyAsyncId);
   registry->Register(SetPromiseHooks);
+  registry->Register(GetContextFrame);
+  registry->Register(SetContextFrame);
   registry->Register(RegisterDestroyHook);
   registry->Register(AsyncWrap::GetAsyncId);
   registry->Register(AsyncWrap::AsyncReset);
@@ -525,6 +555,7 @@ AsyncWrap::~AsyncWrap() {
 }
 
 void AsyncWrap::EmitTraceEventDestroy() {
+  if (!IsTraceEnabled()) return;
   switch (provider_type()) {
   #define V(PROVIDER)                                                         \
     case PROVIDER_ ## PROVIDER:                                               \
@@ -583,6 +614,7 @@ void AsyncWrap::AsyncReset(Local<Object> resource, double execution_async_id,
   async_id_ = execution_async_id == kInvalidAsyncId ? env()->new_async_id()
                                                      : execution_async_id;
   trigger_async_id_ = env()->get_default_trigger_async_id();
+  context_frame_.Reset(env()->isolate(), env()->async_hooks()->context_frame());
 
   {
     HandleScope handle_scope(env()->isolate());
@@ -590,36 +622,39 @@ void AsyncWrap::AsyncReset(Local<Object> resource, double execution_async_id,
     CHECK(!obj.IsEmpty());
     if (resource != obj) {
       USE(obj->Set(env()->context(), env()->resource_symbol(), resource));
+      has_resource_ = true;
     }
   }
 
+  if (IsTraceEnabled()) EmitTraceEventInit();
+
+  if (silent || env()->async_hooks()->fields()[AsyncHooks::kInit] == 0) return;
+
+  EmitAsyncInit(env(), resource,
+                env()->async_hooks()->provider_string(provider_type()),
+                async_id_, trigger_async_id_);
+}
+
+void AsyncWrap::EmitTraceEventInit() {
   switch (provider_type()) {
 #define V(PROVIDER)                                                           \
-    case PROVIDER_ ## PROVIDER:                                               \
-      if (*TRACE_EVENT_API_GET_CATEGORY_GROUP_ENABLED(                        \
-          TRACING_CATEGORY_NODE1(async_hooks))) {                             \
-        auto data = tracing::TracedValue::Create();                           \
-        data->SetInteger("executionAsyncId",                                  \
-                         static_cast<int64_t>(env()->execution_async_id()));  \
-        data->SetInteger("triggerAsyncId",                                    \
-                         static_cast<int64_t>(get_trigger_async_id()));       \
-        TRACE_EVENT_NESTABLE_ASYNC_BEGIN1(                                    \
-          TRACING_CATEGORY_NODE1(async_hooks),                                \
-          #PROVIDER, static_cast<int64_t>(get_async_id()),                    \
-          "data", std::move(data));                                           \
-        }                                                                     \
-      break;
+    case PROVIDER_ ## PROVIDER: {                                             \
+      auto data = tracing::TracedValue::Create();                             \
+      data->SetInteger("executionAsyncId",                                    \
+                       static_cast<int64_t>(env()->execution_async_id()));    \
+      data->SetInteger("triggerAsyncId",                                      \
+                       static_cast<int64_t>(get_trigger_async_id()));         \
+      TRACE_EVENT_NESTABLE_ASYNC_BEGIN1(                                      \
+        TRACING_CATEGORY_NODE1(async_hooks),                                  \
+        #PROVIDER, static_cast<int64_t>(get_async_id()),                      \
+        "data", std::move(data));                                             \
+      break;                                                                  \
+    }
     NODE_ASYNC_PROVIDER_TYPES(V)
 #undef V
     default:
       UNREACHABLE();
   }
-
-  if (silent) return;
-
-  EmitAsyncInit(env(), resource,
-                env()->async_hooks()->provider_string(provider_type()),
-                async_id_, trigger_async_id_);
 }
 
 
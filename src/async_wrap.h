@@ -33,11 +33,13 @@ namespace node {
 
 #define NODE_ASYNC_NON_CRYPTO_PROVIDER_TYPES(V)                               \
   V(NONE)                                                                     \
+  V(BLOBREADER)                                                               \
   V(DIRHANDLE)                                                                \
   V(DNSCHANNEL)                                                               \
   V(ELDHISTOGRAM)                                                             \
   V(FILEHANDLE)                                                               \
   V(FILEHANDLECLOSEREQ)                                                       \
+  V(FILEHANDLESENDWRAP)                                                       \
   V(FIXEDSIZEBLOBCOPY)                                                        \
   V(FSEVENTWRAP)                                                              \
   V(FSREQCALLBACK)                                                            \
@@ -51,8 +53,11 @@ namespace node {
   V(HTTP2SETTINGS)                                                            \
   V(HTTPINCOMINGMESSAGE)                                                      \
   V(HTTPCLIENTREQUEST)                                                        \
+  V(IPCCHANNEL)                                                               \
   V(JSSTREAM)                                                                 \
   V(JSUDPWRAP)                                                                \
+  V(LINESPLITTER)                                                             \
+  V(LOGSINK)                                                                  \
   V(MESSAGEPORT)                                                              \
   V(PIPECONNECTWRAP)                                                          \
   V(PIPESERVERWRAP)                                                           \
@@ -60,9 +65,12 @@ namespace node {
   V(PROCESSWRAP)                                                              \
   V(PROMISE)                                                                  \
   V(QUERYWRAP)                                                                \
+  V(RINGCHANNEL)                                                              \
   V(SHUTDOWNWRAP)                                                             \
   V(SIGNALWRAP)                                                               \
+  V(SOCKETPOOL)                                                               \
   V(STATWATCHER)                                                              \
+  V(STREAMCOMPRESSOR)                                                         \
   V(STREAMPIPE)                                                               \
   V(TCPCONNECTWRAP)                                                           \
   V(TCPSERVERWRAP)                                                            \
@@ -86,6 +94,7 @@ namespace node {
   V(CIPHERREQUEST)                                                            \
   V(DERIVEBITSREQUEST)                                                        \
   V(HASHREQUEST)                                                              \
+  V(HASHSTREAM)                                                               \
   V(RANDOMBYTESREQUEST)                                                       \
   V(RANDOMPRIMEREQUEST)                                                       \
   V(SCRYPTREQUEST)                                                            \
@@ -173,6 +182,7 @@ class AsyncWrap : public BaseObject {
 
   void EmitDestroy(bool from_gc = false);
 
+  void EmitTraceEventInit();
   void EmitTraceEventBefore();
   static void EmitTraceEventAfter(ProviderType type, double async_id);
   void EmitTraceEventDestroy();
@@ -237,6 +247,14 @@ class AsyncWrap : public BaseObject {
   // Because the values may be Reset(), cannot be made const.
   double async_id_ = kInvalidAsyncId;
   double trigger_async_id_ = kInvalidAsyncId;
+  // Whether resource_symbol was set to a resource other than the wrap
+  // itself, and needs to be cleared when the wrap is reset.
+  bool has_resource_ = false;
+  // The context frame that was current when this was last (re)initialized,
+  // which InternalCallbackScope restores around the callbacks.
+  v8::Global<v8::Value> context_frame_;
+
+  friend class InternalCallbackScope;
 };
 
 }  // namespace node
@@ -10,6 +10,9 @@ namespace node {
 
 extern const int8_t unbase64_table[256];
 
+// Below this, calling into the vector kernels costs more than it saves.
+static constexpr size_t kBase64SimdThreshold = 64;
+
 
 inline static int8_t unbase64(uint8_t x) {
   return unbase64_table[x];
@@ -65,9 +68,11 @@ size_t base64_decode_fast(char* const dst, const size_t dstlen,
                           const size_t decoded_size) {
   const size_t available = dstlen < decoded_size ? dstlen : decoded_size;
   const size_t max_k = available / 3 * 3;
-  size_t max_i = srclen / 4 * 4;
   size_t i = 0;
   size_t k = 0;
+  if (srclen >= kBase64SimdThreshold)
+    i = base64_decode_simd(dst, max_k, src, srclen, &k);
+  size_t max_i = i + (srclen - i) / 4 * 4;
   while (i < max_i && k < max_k) {
     const unsigned char txt[] = {
         static_cast<unsigned char>(unbase64(static_cast<uint8_t>(src[i + 0]))),
@@ -144,6 +149,11 @@ inline size_t base64_encode(const char* src,
   k = 0;
   n = slen / 3 * 3;
 
+  if (slen >= kBase64SimdThreshold) {
+    i = base64_encode_simd(src, slen, dst, mode);
+    k = i / 3 * 4;
+  }
+
   while (i < n) {
     a = src[i + 0] & 0xff;
     b = src[i + 1] & 0xff;
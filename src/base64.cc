@@ -0,0 +1,462 @@
+#include "base64.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+# define NODE_BASE64_X86 1
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  include <immintrin.h>
+#  define NODE_BASE64_TARGET(features)
+# else
+#  include <cpuid.h>
+#  include <immintrin.h>
+#  define NODE_BASE64_TARGET(features) __attribute__((target(features)))
+# endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+# define NODE_BASE64_NEON 1
+# include <arm_neon.h>
+#endif
+
+namespace node {
+
+extern const int8_t unbase64_table[256];
+
+// The kernels below only ever look at whole blocks of input, and write
+// exactly the bytes that they decode, so that the scalar code in
+// base64-inl.h can pick up where they stop. Decoding stops at the first
+// block that contains anything other than base64 characters, such as
+// whitespace or padding, which is then left to the scalar code as well.
+// Both the regular and the URL-safe alphabet are accepted, like in
+// unbase64_table.
+//
+// The x86 kernels follow W. Muła and D. Lemire, "Faster Base64 Encoding
+// and Decoding Using AVX2 Instructions" and "Base64 encoding and decoding
+// at almost the speed of a memory copy".
+
+namespace {
+
+using EncodeFn = size_t (*)(const char* src, size_t slen, char* dst,
+                            const char* table);
+using DecodeFn = size_t (*)(char* dst, size_t dstlen,
+                            const char* src, size_t srclen, size_t* written);
+using Decode16Fn = size_t (*)(char* dst, size_t dstlen,
+                              const uint16_t* src, size_t srclen,
+                              size_t* written);
+
+struct Kernels {
+  EncodeFn encode = nullptr;
+  DecodeFn decode = nullptr;
+  Decode16Fn decode16 = nullptr;
+};
+
+#ifdef NODE_BASE64_X86
+
+// AVX2: 24 bytes to 32 characters, and back.
+
+NODE_BASE64_TARGET("avx2")
+inline __m256i EncodeLookupAvx2(__m256i indices, const char* table) {
+  // Maps the 6-bit indices to characters by adding the offset of the range
+  // that each belongs to. Only the last two characters depend on `table`.
+  const __m256i shift_lut = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, table[62] - 62,
+      table[63] - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, table[62] - 62,
+      table[63] - 63, 'A', 0, 0);
+  __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+  const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+  result = _mm256_or_si256(result,
+                           _mm256_and_si256(less, _mm256_set1_epi8(13)));
+  result = _mm256_shuffle_epi8(shift_lut, result);
+  return _mm256_add_epi8(result, indices);
+}
+
+NODE_BASE64_TARGET("avx2")
+size_t EncodeAvx2(const char* src, size_t slen, char* dst,
+                  const char* table) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  size_t i = 0;
+  size_t k = 0;
+  // Each lane loads 16 bytes and uses 12 of them.
+  while (i + 28 <= slen) {
+    const __m128i lo =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    in = _mm256_shuffle_epi8(in, shuffle);
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i out = EncodeLookupAvx2(_mm256_or_si256(t1, t3), table);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k), out);
+    i += 24;
+    k += 32;
+  }
+  return i;
+}
+
+NODE_BASE64_TARGET("avx2")
+inline __m256i LoadAvx2(const char* src) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+}
+
+NODE_BASE64_TARGET("avx2")
+inline __m256i LoadAvx2(const uint16_t* src) {
+  // Characters above 0xff saturate to 0xff, which is not valid base64.
+  const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+  const __m256i b =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 16));
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+}
+
+template <typename TypeName>
+NODE_BASE64_TARGET("avx2")
+size_t DecodeAvx2(char* dst, size_t dstlen,
+                  const TypeName* src, size_t srclen, size_t* written) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t i = 0;
+  size_t k = 0;
+  while (i + 32 <= srclen && k + 24 <= dstlen) {
+    __m256i in = LoadAvx2(src + i);
+    // The lookup tables only know the regular alphabet.
+    in = _mm256_blendv_epi8(in, _mm256_set1_epi8('+'),
+                            _mm256_cmpeq_epi8(in, _mm256_set1_epi8('-')));
+    in = _mm256_blendv_epi8(in, _mm256_set1_epi8('/'),
+                            _mm256_cmpeq_epi8(in, _mm256_set1_epi8('_')));
+
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(in, mask_2f);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    if (!_mm256_testz_si256(lo, hi))
+      break;
+
+    const __m256i eq_2f = _mm256_cmpeq_epi8(in, mask_2f);
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    const __m256i values = _mm256_add_epi8(in, roll);
+
+    const __m256i merged = _mm256_madd_epi16(
+        _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+        _mm256_set1_epi32(0x00011000));
+    const __m256i out = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(merged, pack),
+        _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 0, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k),
+                     _mm256_castsi256_si128(out));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + k + 16),
+                     _mm256_extracti128_si256(out, 1));
+    i += 32;
+    k += 24;
+  }
+  *written = k;
+  return i;
+}
+
+size_t DecodeAvx2Char(char* dst, size_t dstlen,
+                      const char* src, size_t srclen, size_t* written) {
+  return DecodeAvx2(dst, dstlen, src, srclen, written);
+}
+
+size_t DecodeAvx2Uint16(char* dst, size_t dstlen,
+                        const uint16_t* src, size_t srclen, size_t* written) {
+  return DecodeAvx2(dst, dstlen, src, srclen, written);
+}
+
+// AVX-512 VBMI: 48 bytes to 64 characters, and back, with byte permutes
+// doing the table lookups.
+
+NODE_BASE64_TARGET("avx512f,avx512bw,avx512vbmi")
+size_t EncodeAvx512(const char* src, size_t slen, char* dst,
+                    const char* table) {
+  const __m512i shuffle = _mm512_setr_epi32(
+      0x01020001, 0x04050304, 0x07080607, 0x0a0b090a,
+      0x0d0e0c0d, 0x10110f10, 0x13141213, 0x16171516,
+      0x191a1819, 0x1c1d1b1c, 0x1f201e1f, 0x22232122,
+      0x25262425, 0x28292728, 0x2b2c2a2b, 0x2e2f2d2e);
+  const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040aULL);
+  const __m512i lookup = _mm512_loadu_si512(table);
+  size_t i = 0;
+  size_t k = 0;
+  while (i + 48 <= slen) {
+    const __m512i in = _mm512_permutexvar_epi8(
+        shuffle, _mm512_maskz_loadu_epi8(0xffffffffffffULL, src + i));
+    const __m512i indices = _mm512_multishift_epi64_epi8(shifts, in);
+    _mm512_storeu_si512(dst + k, _mm512_permutexvar_epi8(indices, lookup));
+    i += 48;
+    k += 64;
+  }
+  return i;
+}
+
+NODE_BASE64_TARGET("avx512f,avx512bw,avx512vbmi")
+inline __m512i LoadAvx512(const char* src) {
+  return _mm512_loadu_si512(src);
+}
+
+NODE_BASE64_TARGET("avx512f,avx512bw,avx512vbmi")
+inline __m512i LoadAvx512(const uint16_t* src) {
+  const __m512i a = _mm512_loadu_si512(src);
+  const __m512i b = _mm512_loadu_si512(src + 32);
+  return _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7),
+                                  _mm512_packus_epi16(a, b));
+}
+
+template <typename TypeName>
+NODE_BASE64_TARGET("avx512f,avx512bw,avx512vbmi")
+size_t DecodeAvx512(char* dst, size_t dstlen,
+                    const TypeName* src, size_t srclen, size_t* written) {
+  // Invalid characters map to negative values in unbase64_table.
+  const __m512i lookup_0 = _mm512_loadu_si512(unbase64_table);
+  const __m512i lookup_1 = _mm512_loadu_si512(unbase64_table + 64);
+  const __m512i pack = _mm512_setr_epi32(
+      0x06000102, 0x090a0405, 0x0c0d0e08, 0x16101112,
+      0x191a1415, 0x1c1d1e18, 0x26202122, 0x292a2425,
+      0x2c2d2e28, 0x36303132, 0x393a3435, 0x3c3d3e38,
+      0, 0, 0, 0);
+  size_t i = 0;
+  size_t k = 0;
+  while (i + 64 <= srclen && k + 48 <= dstlen) {
+    const __m512i in = LoadAvx512(src + i);
+    const __m512i values = _mm512_permutex2var_epi8(lookup_0, in, lookup_1);
+    if (_mm512_movepi8_mask(_mm512_or_si512(values, in)) != 0)
+      break;
+
+    const __m512i merged = _mm512_madd_epi16(
+        _mm512_maddubs_epi16(values, _mm512_set1_epi32(0x01400140)),
+        _mm512_set1_epi32(0x00011000));
+    _mm512_mask_storeu_epi8(dst + k, 0xffffffffffffULL,
+                            _mm512_permutexvar_epi8(pack, merged));
+    i += 64;
+    k += 48;
+  }
+  *written = k;
+  return i;
+}
+
+size_t DecodeAvx512Char(char* dst, size_t dstlen,
+                        const char* src, size_t srclen, size_t* written) {
+  return DecodeAvx512(dst, dstlen, src, srclen, written);
+}
+
+size_t DecodeAvx512Uint16(char* dst, size_t dstlen,
+                          const uint16_t* src, size_t srclen,
+                          size_t* written) {
+  return DecodeAvx512(dst, dstlen, src, srclen, written);
+}
+
+Kernels SelectKernels() {
+  bool avx2;
+  bool avx512;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] >> 27) & 1;
+  const uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+  __cpuidex(info, 7, 0);
+  avx2 = ((info[1] >> 5) & 1) && (xcr0 & 0x6) == 0x6;
+  avx512 = ((info[1] >> 16) & 1) && ((info[1] >> 30) & 1) &&
+           ((info[2] >> 1) & 1) && (xcr0 & 0xe6) == 0xe6;
+#else
+  __builtin_cpu_init();
+  avx2 = __builtin_cpu_supports("avx2");
+  avx512 = __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512vbmi");
+#endif
+
+  Kernels kernels;
+  if (avx512) {
+    kernels.encode = EncodeAvx512;
+    kernels.decode = DecodeAvx512Char;
+    kernels.decode16 = DecodeAvx512Uint16;
+  } else if (avx2) {
+    kernels.encode = EncodeAvx2;
+    kernels.decode = DecodeAvx2Char;
+    kernels.decode16 = DecodeAvx2Uint16;
+  }
+  return kernels;
+}
+
+#elif defined(NODE_BASE64_NEON)
+
+// NEON: 48 bytes to 64 characters, and back. The structured loads and
+// stores take care of splitting bytes into groups of three or four.
+
+size_t EncodeNeon(const char* src, size_t slen, char* dst,
+                  const char* table) {
+  const uint8_t* table_bytes = reinterpret_cast<const uint8_t*>(table);
+  const uint8x16x4_t lookup = {{
+    vld1q_u8(table_bytes), vld1q_u8(table_bytes + 16),
+    vld1q_u8(table_bytes + 32), vld1q_u8(table_bytes + 48)
+  }};
+  const uint8x16_t mask = vdupq_n_u8(0x3f);
+  size_t i = 0;
+  size_t k = 0;
+  while (i + 48 <= slen) {
+    const uint8x16x3_t in =
+        vld3q_u8(reinterpret_cast<const uint8_t*>(src + i));
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8(in.val[0], 2);
+    out.val[1] = vandq_u8(
+        vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+    out.val[2] = vandq_u8(
+        vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+    out.val[3] = vandq_u8(in.val[2], mask);
+    for (int j = 0; j < 4; j++)
+      out.val[j] = vqtbl4q_u8(lookup, out.val[j]);
+    vst4q_u8(reinterpret_cast<uint8_t*>(dst + k), out);
+    i += 48;
+    k += 64;
+  }
+  return i;
+}
+
+inline uint8x16x4_t LoadNeon(const char* src) {
+  return vld4q_u8(reinterpret_cast<const uint8_t*>(src));
+}
+
+inline uint8x16x4_t LoadNeon(const uint16_t* src) {
+  // Characters above 0xff saturate to 0xff, which is not valid base64.
+  const uint16x8x4_t a = vld4q_u16(src);
+  const uint16x8x4_t b = vld4q_u16(src + 32);
+  uint8x16x4_t in;
+  for (int j = 0; j < 4; j++)
+    in.val[j] = vcombine_u8(vqmovn_u16(a.val[j]), vqmovn_u16(b.val[j]));
+  return in;
+}
+
+template <typename TypeName>
+size_t DecodeNeon(char* dst, size_t dstlen,
+                  const TypeName* src, size_t srclen, size_t* written) {
+  const uint8_t* table = reinterpret_cast<const uint8_t*>(unbase64_table);
+  const uint8x16x4_t lookup_0 = {{
+    vld1q_u8(table), vld1q_u8(table + 16),
+    vld1q_u8(table + 32), vld1q_u8(table + 48)
+  }};
+  const uint8x16x4_t lookup_1 = {{
+    vld1q_u8(table + 64), vld1q_u8(table + 80),
+    vld1q_u8(table + 96), vld1q_u8(table + 112)
+  }};
+  const uint8x16_t offset = vdupq_n_u8(64);
+  size_t i = 0;
+  size_t k = 0;
+  while (i + 64 <= srclen && k + 48 <= dstlen) {
+    const uint8x16x4_t in = LoadNeon(src + i);
+    uint8x16x4_t values;
+    uint8x16_t invalid = vdupq_n_u8(0);
+    for (int j = 0; j < 4; j++) {
+      // Invalid characters map to negative values in unbase64_table, and
+      // characters from 0x80 up are not looked up at all.
+      values.val[j] = vqtbx4q_u8(vqtbl4q_u8(lookup_0, in.val[j]),
+                                 lookup_1,
+                                 vsubq_u8(in.val[j], offset));
+      invalid = vorrq_u8(invalid, vorrq_u8(values.val[j], in.val[j]));
+    }
+    if (vmaxvq_u8(invalid) & 0x80)
+      break;
+
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2),
+                          vshrq_n_u8(values.val[1], 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4),
+                          vshrq_n_u8(values.val[2], 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+    vst3q_u8(reinterpret_cast<uint8_t*>(dst + k), out);
+    i += 64;
+    k += 48;
+  }
+  *written = k;
+  return i;
+}
+
+size_t DecodeNeonChar(char* dst, size_t dstlen,
+                      const char* src, size_t srclen, size_t* written) {
+  return DecodeNeon(dst, dstlen, src, srclen, written);
+}
+
+size_t DecodeNeonUint16(char* dst, size_t dstlen,
+                        const uint16_t* src, size_t srclen, size_t* written) {
+  return DecodeNeon(dst, dstlen, src, srclen, written);
+}
+
+Kernels SelectKernels() {
+  // NEON is part of the baseline of arm64.
+  Kernels kernels;
+  kernels.encode = EncodeNeon;
+  kernels.decode = DecodeNeonChar;
+  kernels.decode16 = DecodeNeonUint16;
+  return kernels;
+}
+
+#else
+
+Kernels SelectKernels() {
+  return Kernels();
+}
+
+#endif
+
+const Kernels& GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+}  // anonymous namespace
+
+size_t base64_encode_simd(const char* src,
+                          size_t slen,
+                          char* dst,
+                          Base64Mode mode) {
+  const EncodeFn encode = GetKernels().encode;
+  if (encode == nullptr)
+    return 0;
+  return encode(src, slen, dst, base64_select_table(mode));
+}
+
+size_t base64_decode_simd(char* dst, size_t dstlen,
+                          const char* src, size_t srclen,
+                          size_t* written) {
+  const DecodeFn decode = GetKernels().decode;
+  if (decode == nullptr) {
+    *written = 0;
+    return 0;
+  }
+  return decode(dst, dstlen, src, srclen, written);
+}
+
+size_t base64_decode_simd(char* dst, size_t dstlen,
+                          const uint16_t* src, size_t srclen,
+                          size_t* written) {
+  const Decode16Fn decode16 = GetKernels().decode16;
+  if (decode16 == nullptr) {
+    *written = 0;
+    return 0;
+  }
+  return decode16(dst, dstlen, src, srclen, written);
+}
+
+}  // namespace node
@@ -61,6 +61,34 @@ inline size_t base64_encode(const char* src,
                             char* dst,
                             size_t dlen,
                             Base64Mode mode = Base64Mode::NORMAL);
+
+// Vectorized kernels for the bulk of base64_encode() and base64_decode(),
+// picked at runtime for the CPU that we run on. They only handle whole
+// blocks and leave the rest, including padding, whitespace and anything
+// else that is not plain base64, to the scalar code.
+//
+// Returns the number of bytes of `src` that were encoded, a multiple of 3.
+size_t base64_encode_simd(const char* src,
+                          size_t slen,
+                          char* dst,
+                          Base64Mode mode);
+// Returns the number of characters of `src` that were decoded, and stores
+// the number of bytes written to `dst` in `*written`.
+size_t base64_decode_simd(char* dst, size_t dstlen,
+                          const char* src, size_t srclen,
+                          size_t* written);
+size_t base64_decode_simd(char* dst, size_t dstlen,
+                          const uint16_t* src, size_t srclen,
+                          size_t* written);
+
+// Other character types are not vectorized.
+template <typename TypeName>
+inline size_t base64_decode_simd(char* dst, size_t dstlen,
+                                 const TypeName* src, size_t srclen,
+                                 size_t* written) {
+  *written = 0;
+  return 0;
+}
 }  // namespace node
 
 
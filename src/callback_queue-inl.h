@@ -90,6 +90,61 @@ R CallbackQueue<R, Args...>::CallbackImpl<Fn>::Call(Args... args) {
   return callback_(std::forward<Args>(args)...);
 }
 
+template <typename R, typename... Args>
+ThreadsafeCallbackQueue<R, Args...>::~ThreadsafeCallbackQueue() {
+  std::unique_ptr<Callback> head { head_.exchange(nullptr) };
+}
+
+template <typename R, typename... Args>
+template <typename Fn>
+std::unique_ptr<typename ThreadsafeCallbackQueue<R, Args...>::Callback>
+ThreadsafeCallbackQueue<R, Args...>::CreateCallback(
+    Fn&& fn, CallbackFlags::Flags flags) {
+  return Queue::CreateCallback(std::move(fn), flags);
+}
+
+template <typename R, typename... Args>
+bool ThreadsafeCallbackQueue<R, Args...>::Push(std::unique_ptr<Callback> cb) {
+  Callback* node = cb.release();
+  Callback* head = head_.load(std::memory_order_relaxed);
+  do {
+    // `node` is not visible to other threads yet, so it is fine to relink it
+    // without synchronization. release() only drops the non-owning pointer
+    // from the previous iteration.
+    node->next_.release();
+    node->next_.reset(head);
+  } while (!head_.compare_exchange_weak(head, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+  return head == nullptr;
+}
+
+template <typename R, typename... Args>
+void ThreadsafeCallbackQueue<R, Args...>::PopAll(Queue* queue) {
+  std::unique_ptr<Callback> head {
+      head_.exchange(nullptr, std::memory_order_acquire) };
+  if (!head) return;
+
+  // The entries are linked newest-first; reverse them before appending.
+  std::unique_ptr<Callback> reversed;
+  while (head) {
+    std::unique_ptr<Callback> next = head->get_next();
+    head->set_next(std::move(reversed));
+    reversed = std::move(head);
+    head = std::move(next);
+  }
+  while (reversed) {
+    std::unique_ptr<Callback> next = reversed->get_next();
+    queue->Push(std::move(reversed));
+    reversed = std::move(next);
+  }
+}
+
+template <typename R, typename... Args>
+bool ThreadsafeCallbackQueue<R, Args...>::empty() const {
+  return head_.load() == nullptr;
+}
+
 }  // namespace node
 
 #endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
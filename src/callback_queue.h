@@ -4,6 +4,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include <atomic>
+#include <memory>
 
 namespace node {
 
@@ -14,6 +15,9 @@ enum Flags {
 };
 }
 
+template <typename R, typename... Args>
+class ThreadsafeCallbackQueue;
+
 // A queue of C++ functions that take Args... as arguments and return R
 // (this is similar to the signature of std::function).
 // New entries are added using `CreateCallback()`/`Push()`, and removed using
@@ -40,10 +44,11 @@ class CallbackQueue {
     std::unique_ptr<Callback> next_;
 
     friend class CallbackQueue;
+    friend class ThreadsafeCallbackQueue<R, Args...>;
   };
 
   template <typename Fn>
-  inline std::unique_ptr<Callback> CreateCallback(
+  static inline std::unique_ptr<Callback> CreateCallback(
       Fn&& fn, CallbackFlags::Flags);
 
   inline std::unique_ptr<Callback> Shift();
@@ -71,6 +76,41 @@ class CallbackQueue {
   Callback* tail_ = nullptr;
 };
 
+// A multi-producer, single-consumer variant of CallbackQueue. `Push()` may be
+// called from any thread and does not take a lock; it returns true if the
+// queue was empty beforehand, so that callers only need to wake up the
+// consuming thread once per batch. The consuming thread takes all pending
+// entries at once with `PopAll()`, which preserves the order in which they
+// were pushed.
+template <typename R, typename... Args>
+class ThreadsafeCallbackQueue {
+ public:
+  typedef CallbackQueue<R, Args...> Queue;
+  typedef typename Queue::Callback Callback;
+
+  ThreadsafeCallbackQueue() = default;
+  inline ~ThreadsafeCallbackQueue();
+  ThreadsafeCallbackQueue(const ThreadsafeCallbackQueue&) = delete;
+  ThreadsafeCallbackQueue& operator=(const ThreadsafeCallbackQueue&) = delete;
+
+  template <typename Fn>
+  static inline std::unique_ptr<Callback> CreateCallback(
+      Fn&& fn, CallbackFlags::Flags flags);
+
+  inline bool Push(std::unique_ptr<Callback> cb);
+  // PopAll moves all entries to the end of 'queue'. It must only be called
+  // from the consuming thread.
+  inline void PopAll(Queue* queue);
+
+  // empty() is atomic and may be called from any thread.
+  inline bool empty() const;
+
+ private:
+  // Most recently pushed entry; older entries are reachable through
+  // Callback::next_.
+  std::atomic<Callback*> head_ {nullptr};
+};
+
 }  // namespace node
 
 #endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
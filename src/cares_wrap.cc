@@ -65,9 +65,11 @@ using v8::Integer;
 using v8::Isolate;
 using v8::Just;
 using v8::Local;
+using v8::MaybeLocal;
 using v8::Maybe;
 using v8::Nothing;
 using v8::Null;
+using v8::Number;
 using v8::Object;
 using v8::String;
 using v8::Value;
@@ -671,6 +673,122 @@ GetAddrInfoReqWrap::GetAddrInfoReqWrap(
     : ReqWrap(env, req_wrap_obj, AsyncWrap::PROVIDER_GETADDRINFOREQWRAP),
       verbatim_(verbatim) {}
 
+LookupCache* LookupCache::GetInstance() {
+  // Intentionally leaked, worker threads may still use it during exit.
+  static LookupCache* cache = new LookupCache();
+  return cache;
+}
+
+std::string LookupCache::MakeKey(const char* hostname,
+                                 int family,
+                                 int flags,
+                                 bool verbatim) {
+  std::string key(hostname);
+  key += '\0';
+  key += std::to_string(family);
+  key += ':';
+  key += std::to_string(flags);
+  key += verbatim ? ":v" : ":";
+  return key;
+}
+
+LookupCache::Shard* LookupCache::ShardFor(const std::string& key) {
+  return &shards_[std::hash<std::string>()(key) % kShardCount];
+}
+
+void LookupCache::Configure(const Options& options) {
+  ttl_ = options.ttl;
+  negative_ttl_ = options.negative_ttl;
+  stale_ = options.stale;
+  max_entries_ = options.max_entries;
+  if (options.max_entries == 0)
+    Clear();
+}
+
+void LookupCache::Clear() {
+  for (Shard& shard : shards_) {
+    Mutex::ScopedLock lock(shard.mutex);
+    shard.lru.clear();
+    shard.index.clear();
+  }
+}
+
+LookupCache::Stats LookupCache::GetStats() const {
+  Stats stats = { 0, hits_, stale_hits_, misses_ };
+  for (const Shard& shard : shards_) {
+    Mutex::ScopedLock lock(shard.mutex);
+    stats.entries += shard.lru.size();
+  }
+  return stats;
+}
+
+bool LookupCache::Get(const std::string& key,
+                      int* status,
+                      std::vector<std::string>* addresses,
+                      bool* refresh) {
+  Shard* shard = ShardFor(key);
+  const uint64_t now = uv_hrtime();
+  *refresh = false;
+  {
+    Mutex::ScopedLock lock(shard->mutex);
+    auto it = shard->index.find(key);
+    if (it != shard->index.end()) {
+      Entry& entry = *it->second;
+      if (now < entry.expires + stale_ * 1000000) {
+        shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+        *status = entry.status;
+        *addresses = entry.addresses;
+        if (now >= entry.expires) {
+          *refresh = !entry.refreshing;
+          entry.refreshing = true;
+          stale_hits_++;
+        } else {
+          hits_++;
+        }
+        return true;
+      }
+      shard->lru.erase(it->second);
+      shard->index.erase(it);
+    }
+  }
+  misses_++;
+  return false;
+}
+
+void LookupCache::Put(const std::string& key,
+                      int status,
+                      std::vector<std::string>&& addresses) {
+  Shard* shard = ShardFor(key);
+  const size_t shard_limit =
+      std::max<size_t>(max_entries_ / kShardCount, 1);
+  uint64_t ttl = 0;
+  if (status == 0)
+    ttl = ttl_;
+  else if (status == UV_EAI_NONAME || status == UV_EAI_NODATA)
+    ttl = negative_ttl_;
+
+  Mutex::ScopedLock lock(shard->mutex);
+  auto existing = shard->index.find(key);
+  if (ttl == 0 || !enabled()) {
+    if (existing != shard->index.end())
+      existing->second->refreshing = false;
+    return;
+  }
+  if (existing != shard->index.end()) {
+    shard->lru.erase(existing->second);
+    shard->index.erase(existing);
+  }
+
+  shard->lru.push_front(
+      Entry { key, status, std::move(addresses), uv_hrtime() + ttl * 1000000,
+              false });
+  shard->index[shard->lru.front().key] = shard->lru.begin();
+  while (shard->lru.size() > shard_limit) {
+    shard->index.erase(shard->lru.back().key);
+    shard->lru.pop_back();
+  }
+}
+
 GetNameInfoReqWrap::GetNameInfoReqWrap(
     Environment* env,
     Local<Object> req_wrap_obj)
@@ -1427,6 +1545,50 @@ static void Query(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+// Collects the addresses in `res`, IPv4 first unless `verbatim` is set.
+// Returns UV_EAI_NODATA if there are none. Works with both struct addrinfo
+// and struct ares_addrinfo_node lists.
+template <typename AddrInfo>
+int AddrInfoToStrings(const AddrInfo* res,
+                      bool verbatim,
+                      std::vector<std::string>* addresses) {
+  auto add = [&] (bool want_ipv4, bool want_ipv6) {
+    for (auto p = res; p != nullptr; p = p->ai_next) {
+      const char* addr;
+      if (want_ipv4 && p->ai_family == AF_INET) {
+        addr = reinterpret_cast<char*>(
+            &(reinterpret_cast<struct sockaddr_in*>(p->ai_addr)->sin_addr));
+      } else if (want_ipv6 && p->ai_family == AF_INET6) {
+        addr = reinterpret_cast<char*>(
+            &(reinterpret_cast<struct sockaddr_in6*>(p->ai_addr)->sin6_addr));
+      } else {
+        continue;
+      }
+
+      char ip[INET6_ADDRSTRLEN];
+      if (uv_inet_ntop(p->ai_family, addr, ip, sizeof(ip)))
+        continue;
+
+      addresses->emplace_back(ip);
+    }
+  };
+
+  add(true, verbatim);
+  if (verbatim == false)
+    add(false, true);
+
+  // No responses were found to return
+  return addresses->empty() ? UV_EAI_NODATA : 0;
+}
+
+MaybeLocal<Array> AddressesToArray(Environment* env,
+                                   const std::vector<std::string>& addresses) {
+  MaybeStackBuffer<Local<Value>, 16> values(addresses.size());
+  for (size_t i = 0; i < addresses.size(); i++)
+    values[i] = OneByteString(env->isolate(), addresses[i].c_str());
+  return Array::New(env->isolate(), values.out(), addresses.size());
+}
+
 void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
   std::unique_ptr<GetAddrInfoReqWrap> req_wrap {
       static_cast<GetAddrInfoReqWrap*>(req->data)};
@@ -1440,55 +1602,26 @@ void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
     Null(env->isolate())
   };
 
-  uint32_t n = 0;
   const bool verbatim = req_wrap->verbatim();
+  std::vector<std::string> addresses;
+  const bool succeeded = status == 0;
+  if (succeeded)
+    status = AddrInfoToStrings(res, verbatim, &addresses);
+  uv_freeaddrinfo(res);
 
-  if (status == 0) {
-    Local<Array> results = Array::New(env->isolate());
-
-    auto add = [&] (bool want_ipv4, bool want_ipv6) -> Maybe<bool> {
-      for (auto p = res; p != nullptr; p = p->ai_next) {
-        CHECK_EQ(p->ai_socktype, SOCK_STREAM);
-
-        const char* addr;
-        if (want_ipv4 && p->ai_family == AF_INET) {
-          addr = reinterpret_cast<char*>(
-              &(reinterpret_cast<struct sockaddr_in*>(p->ai_addr)->sin_addr));
-        } else if (want_ipv6 && p->ai_family == AF_INET6) {
-          addr = reinterpret_cast<char*>(
-              &(reinterpret_cast<struct sockaddr_in6*>(p->ai_addr)->sin6_addr));
-        } else {
-          continue;
-        }
-
-        char ip[INET6_ADDRSTRLEN];
-        if (uv_inet_ntop(p->ai_family, addr, ip, sizeof(ip)))
-          continue;
-
-        Local<String> s = OneByteString(env->isolate(), ip);
-        if (results->Set(env->context(), n, s).IsNothing())
-          return Nothing<bool>();
-        n++;
-      }
-      return Just(true);
-    };
-
-    if (add(true, verbatim).IsNothing())
+  if (succeeded) {
+    Local<Array> results;
+    if (!AddressesToArray(env, addresses).ToLocal(&results))
       return;
-    if (verbatim == false) {
-      if (add(false, true).IsNothing())
-        return;
-    }
-
-    // No responses were found to return
-    if (n == 0) {
-      argv[0] = Integer::New(env->isolate(), UV_EAI_NODATA);
-    }
-
+    argv[0] = Integer::New(env->isolate(), status);
     argv[1] = results;
   }
 
-  uv_freeaddrinfo(res);
+  const uint32_t n = addresses.size();
+  if (!req_wrap->cache_key().empty()) {
+    LookupCache::GetInstance()->Put(
+        req_wrap->cache_key(), status, std::move(addresses));
+  }
 
   TRACE_EVENT_NESTABLE_ASYNC_END2(
       TRACING_CATEGORY_NODE2(dns, native), "lookup", req_wrap.get(),
@@ -1560,6 +1693,201 @@ void CanonicalizeIP(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(val);
 }
 
+int ToAddressFamily(int32_t family) {
+  switch (family) {
+    case 0:
+      return AF_UNSPEC;
+    case 4:
+      return AF_INET;
+    case 6:
+      return AF_INET6;
+    default:
+      CHECK(0 && "bad address family");
+  }
+  return AF_UNSPEC;
+}
+
+// A lookup that refreshes a stale LookupCache entry. It is not visible to
+// JS, but the Environment waits for it before it is torn down.
+struct LookupRefresh {
+  uv_getaddrinfo_t req;
+  Environment* env;
+  std::string key;
+  bool verbatim;
+};
+
+void AfterLookupRefresh(uv_getaddrinfo_t* req,
+                        int status,
+                        struct addrinfo* res) {
+  std::unique_ptr<LookupRefresh> refresh {
+      ContainerOf(&LookupRefresh::req, req)};
+  std::vector<std::string> addresses;
+  if (status == 0) {
+    status = AddrInfoToStrings(res, refresh->verbatim, &addresses);
+    uv_freeaddrinfo(res);
+  }
+  LookupCache::GetInstance()->Put(refresh->key, status, std::move(addresses));
+  refresh->env->DecreaseWaitingRequestCounter();
+}
+
+void StartLookupRefresh(Environment* env,
+                        std::string&& key,
+                        const char* hostname,
+                        int family,
+                        int flags,
+                        bool verbatim) {
+  auto refresh = std::make_unique<LookupRefresh>();
+  refresh->env = env;
+  refresh->key = std::move(key);
+  refresh->verbatim = verbatim;
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = family;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = flags;
+
+  int err = uv_getaddrinfo(env->event_loop(),
+                           &refresh->req,
+                           AfterLookupRefresh,
+                           hostname,
+                           nullptr,
+                           &hints);
+  if (err != 0) {
+    // Let a later stale hit try again.
+    LookupCache::GetInstance()->Put(refresh->key, err, {});
+    return;
+  }
+  env->IncreaseWaitingRequestCounter();
+  USE(refresh.release());
+}
+
+// lookupCached(hostname, family, hints, verbatim) returns the cached result
+// of a getaddrinfo() call with the same arguments: an array of addresses, or
+// an error code for names that have none. Returns undefined on a miss.
+void LookupCached(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LookupCache* cache = LookupCache::GetInstance();
+  if (!cache->enabled())
+    return;
+
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsInt32());
+  CHECK(args[3]->IsBoolean());
+  node::Utf8Value hostname(env->isolate(), args[0]);
+  int family = ToAddressFamily(args[1].As<Int32>()->Value());
+  int32_t flags = args[2]->IsInt32() ? args[2].As<Int32>()->Value() : 0;
+  const bool verbatim = args[3]->IsTrue();
+
+  std::string key = LookupCache::MakeKey(*hostname, family, flags, verbatim);
+  int status;
+  std::vector<std::string> addresses;
+  bool refresh;
+  if (!cache->Get(key, &status, &addresses, &refresh))
+    return;
+  if (refresh) {
+    StartLookupRefresh(
+        env, std::move(key), *hostname, family, flags, verbatim);
+  }
+
+  if (status != 0)
+    return args.GetReturnValue().Set(status);
+  Local<Array> results;
+  if (AddressesToArray(env, addresses).ToLocal(&results))
+    args.GetReturnValue().Set(results);
+}
+
+// setLookupCacheOptions(maxEntries, ttl, negativeTtl, stale), with times in
+// milliseconds. A maxEntries of 0 turns the cache off and empties it.
+void SetLookupCacheOptions(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LookupCache::Options options;
+  for (int i = 0; i < 4; i++)
+    CHECK(args[i]->IsNumber());
+  options.max_entries = args[0]->IntegerValue(env->context()).FromJust();
+  options.ttl = args[1]->IntegerValue(env->context()).FromJust();
+  options.negative_ttl = args[2]->IntegerValue(env->context()).FromJust();
+  options.stale = args[3]->IntegerValue(env->context()).FromJust();
+  LookupCache::GetInstance()->Configure(options);
+}
+
+void ClearLookupCache(const FunctionCallbackInfo<Value>& args) {
+  LookupCache::GetInstance()->Clear();
+}
+
+// Returns [entries, hits, staleHits, misses].
+void GetLookupCacheStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LookupCache::Stats stats = LookupCache::GetInstance()->GetStats();
+  Local<Value> values[] = {
+    Number::New(env->isolate(), stats.entries),
+    Number::New(env->isolate(), stats.hits),
+    Number::New(env->isolate(), stats.stale_hits),
+    Number::New(env->isolate(), stats.misses),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
+// Maps c-ares errors to the codes that getaddrinfo() would have reported.
+int AresToEaiError(int status) {
+  switch (status) {
+    case ARES_SUCCESS:
+      return 0;
+    case ARES_ENOTFOUND:
+      return UV_EAI_NONAME;
+    case ARES_ENODATA:
+      return UV_EAI_NODATA;
+    case ARES_ETIMEOUT:
+    case ARES_ECONNREFUSED:
+    case ARES_ESERVFAIL:
+      return UV_EAI_AGAIN;
+    case ARES_ENOMEM:
+      return UV_EAI_MEMORY;
+    case ARES_EBADFAMILY:
+      return UV_EAI_FAMILY;
+    case ARES_EBADFLAGS:
+      return UV_EAI_BADFLAGS;
+    case ARES_ECANCELLED:
+    case ARES_EDESTRUCTION:
+      return UV_EAI_CANCELED;
+    default:
+      return UV_EAI_FAIL;
+  }
+}
+
+// ChannelWrap.prototype.getaddrinfo(req, hostname, family, hints, verbatim)
+// takes the same arguments as the getaddrinfo() binding function.
+void ChannelGetAddrInfo(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  ChannelWrap* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsString());
+  CHECK(args[2]->IsInt32());
+  CHECK(args[4]->IsBoolean());
+  Local<Object> req_wrap_obj = args[0].As<Object>();
+  node::Utf8Value hostname(env->isolate(), args[1]);
+  int family = ToAddressFamily(args[2].As<Int32>()->Value());
+  int32_t flags = args[3]->IsInt32() ? args[3].As<Int32>()->Value() : 0;
+  const bool verbatim = args[4]->IsTrue();
+
+  auto wrap =
+      std::make_unique<AresGetAddrInfoWrap>(channel, req_wrap_obj, verbatim);
+  if (LookupCache::GetInstance()->enabled()) {
+    wrap->set_cache_key(
+        LookupCache::MakeKey(*hostname, family, flags, verbatim));
+  }
+
+  channel->ModifyActivityQueryCount(1);
+  wrap->Send(*hostname, family, flags);
+  // Ownership passes to the callback, which c-ares always invokes.
+  USE(wrap.release());
+
+  args.GetReturnValue().Set(0);
+}
+
 void GetAddrInfo(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
 
@@ -1575,25 +1903,16 @@ void GetAddrInfo(const FunctionCallbackInfo<Value>& args) {
     flags = args[3].As<Int32>()->Value();
   }
 
-  int family;
-
-  switch (args[2].As<Int32>()->Value()) {
-    case 0:
-      family = AF_UNSPEC;
-      break;
-    case 4:
-      family = AF_INET;
-      break;
-    case 6:
-      family = AF_INET6;
-      break;
-    default:
-      CHECK(0 && "bad address family");
-  }
+  int family = ToAddressFamily(args[2].As<Int32>()->Value());
 
   auto req_wrap = std::make_unique<GetAddrInfoReqWrap>(env,
                                                        req_wrap_obj,
                                                        args[4]->IsTrue());
+  LookupCache* cache = LookupCache::GetInstance();
+  if (cache->enabled()) {
+    req_wrap->set_cache_key(
+        LookupCache::MakeKey(*hostname, family, flags, args[4]->IsTrue()));
+  }
 
   struct addrinfo hints;
   memset(&hints, 0, sizeof(hints));
@@ -1857,6 +2176,120 @@ void StrError(const FunctionCallbackInfo<Value>& args) {
 
 }  // namespace
 
+AresGetAddrInfoWrap::AresGetAddrInfoWrap(ChannelWrap* channel,
+                                         Local<Object> req_wrap_obj,
+                                         bool verbatim)
+    : AsyncWrap(channel->env(),
+                req_wrap_obj,
+                AsyncWrap::PROVIDER_GETADDRINFOREQWRAP),
+      channel_(channel),
+      verbatim_(verbatim) {}
+
+AresGetAddrInfoWrap::~AresGetAddrInfoWrap() {
+  // Let Callback() know that this object no longer exists.
+  if (callback_ptr_ != nullptr)
+    *callback_ptr_ = nullptr;
+}
+
+void AresGetAddrInfoWrap::Send(const char* hostname, int family, int flags) {
+  channel_->EnsureServers();
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN2(
+      TRACING_CATEGORY_NODE2(dns, native), "lookup", this,
+      "hostname", TRACE_STR_COPY(hostname),
+      "family",
+      family == AF_INET ? "ipv4" : family == AF_INET6 ? "ipv6" : "unspec");
+
+  struct ares_addrinfo_hints hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = family;
+  hints.ai_socktype = SOCK_STREAM;
+  if (flags & AI_ADDRCONFIG)
+    hints.ai_flags |= ARES_AI_ADDRCONFIG;
+  if (flags & AI_V4MAPPED)
+    hints.ai_flags |= ARES_AI_V4MAPPED;
+  if (flags & AI_ALL)
+    hints.ai_flags |= ARES_AI_ALL;
+
+  CHECK_NULL(callback_ptr_);
+  callback_ptr_ = new AresGetAddrInfoWrap*(this);
+  ares_getaddrinfo(channel_->cares_channel(),
+                   hostname,
+                   nullptr,
+                   &hints,
+                   Callback,
+                   callback_ptr_);
+}
+
+void AresGetAddrInfoWrap::Callback(void* arg,
+                                   int status,
+                                   int timeouts,
+                                   struct ares_addrinfo* res) {
+  std::unique_ptr<AresGetAddrInfoWrap*> wrap_ptr {
+      static_cast<AresGetAddrInfoWrap**>(arg)
+  };
+  AresGetAddrInfoWrap* wrap = *wrap_ptr.get();
+  if (wrap == nullptr) {
+    if (res != nullptr)
+      ares_freeaddrinfo(res);
+    return;
+  }
+  wrap->callback_ptr_ = nullptr;
+
+  wrap->status_ = AresToEaiError(status);
+  if (status == ARES_SUCCESS) {
+    wrap->status_ =
+        AddrInfoToStrings(res->nodes, wrap->verbatim_, &wrap->addresses_);
+  }
+  if (res != nullptr)
+    ares_freeaddrinfo(res);
+
+  // c-ares may call this synchronously, or from within its own socket
+  // handling, so call into JS later.
+  BaseObjectPtr<AresGetAddrInfoWrap> strong_ref{wrap};
+  wrap->env()->SetImmediate([wrap, strong_ref](Environment*) {
+    wrap->AfterResponse();
+
+    // Delete once strong_ref goes out of scope.
+    wrap->Detach();
+  });
+
+  wrap->channel_->set_query_last_ok(status != ARES_ECONNREFUSED);
+  wrap->channel_->ModifyActivityQueryCount(-1);
+}
+
+void AresGetAddrInfoWrap::AfterResponse() {
+  Environment* env = this->env();
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  Local<Value> argv[] = {
+    Integer::New(env->isolate(), status_),
+    Null(env->isolate())
+  };
+  if (status_ == 0) {
+    Local<Array> results;
+    if (!AddressesToArray(env, addresses_).ToLocal(&results))
+      return;
+    argv[1] = results;
+  }
+
+  const uint32_t n = addresses_.size();
+  if (!cache_key_.empty()) {
+    LookupCache::GetInstance()->Put(
+        cache_key_, status_, std::move(addresses_));
+  }
+
+  TRACE_EVENT_NESTABLE_ASYNC_END2(
+      TRACING_CATEGORY_NODE2(dns, native), "lookup", this,
+      "count", n, "verbatim", verbatim_);
+
+  MakeCallback(env->oncomplete_string(), arraysize(argv), argv);
+}
+
+void AresGetAddrInfoWrap::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("channel", channel_);
+}
+
 inline void safe_free_hostent(struct hostent* host) {
   int idx;
 
@@ -1889,6 +2322,12 @@ void Initialize(Local<Object> target,
   Environment* env = Environment::GetCurrent(context);
 
   env->SetMethod(target, "getaddrinfo", GetAddrInfo);
+  env->SetMethod(target, "lookupCached", LookupCached);
+  env->SetMethod(target, "setLookupCacheOptions", SetLookupCacheOptions);
+  env->SetMethod(target, "clearLookupCache", ClearLookupCache);
+  env->SetMethodNoSideEffect(target,
+                             "getLookupCacheStats",
+                             GetLookupCacheStats);
   env->SetMethod(target, "getnameinfo", GetNameInfo);
   env->SetMethodNoSideEffect(target, "canonicalizeIP", CanonicalizeIP);
 
@@ -1945,6 +2384,7 @@ void Initialize(Local<Object> target,
   env->SetProtoMethod(channel_wrap, "queryNaptr", Query<QueryNaptrWrap>);
   env->SetProtoMethod(channel_wrap, "querySoa", Query<QuerySoaWrap>);
   env->SetProtoMethod(channel_wrap, "getHostByAddr", Query<GetHostByAddrWrap>);
+  env->SetProtoMethod(channel_wrap, "getaddrinfo", ChannelGetAddrInfo);
 
   env->SetProtoMethodNoSideEffect(channel_wrap, "getServers", GetServers);
   env->SetProtoMethod(channel_wrap, "setServers", SetServers);
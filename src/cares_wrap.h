@@ -9,6 +9,7 @@
 #include "base_object.h"
 #include "env.h"
 #include "memory_tracker.h"
+#include "node_mutex.h"
 #include "util.h"
 #include "node.h"
 
@@ -16,7 +17,12 @@
 #include "v8.h"
 #include "uv.h"
 
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #ifdef __POSIX__
 # include <netdb.h>
@@ -202,8 +208,124 @@ class GetAddrInfoReqWrap final : public ReqWrap<uv_getaddrinfo_t> {
 
   bool verbatim() const { return verbatim_; }
 
+  // Set if the result should be stored in the LookupCache.
+  const std::string& cache_key() const { return cache_key_; }
+  void set_cache_key(std::string&& key) { cache_key_ = std::move(key); }
+
  private:
   const bool verbatim_;
+  std::string cache_key_;
+};
+
+// An opt-in, process-wide cache of getaddrinfo() results, shared by all
+// threads. getaddrinfo() does not report TTLs, so results are kept for a
+// configured time: `ttl` for addresses, `negative_ttl` for names that have
+// none. Expired results are served for up to `stale` more milliseconds
+// while the first caller that sees them looks the name up again.
+class LookupCache final {
+ public:
+  struct Options {
+    size_t max_entries;  // 0 turns the cache off.
+    uint64_t ttl;
+    uint64_t negative_ttl;
+    uint64_t stale;
+  };
+
+  struct Stats {
+    size_t entries;
+    uint64_t hits;
+    uint64_t stale_hits;
+    uint64_t misses;
+  };
+
+  static LookupCache* GetInstance();
+
+  static std::string MakeKey(const char* hostname,
+                             int family,
+                             int flags,
+                             bool verbatim);
+
+  bool enabled() const { return max_entries_ > 0; }
+  void Configure(const Options& options);
+  void Clear();
+  Stats GetStats() const;
+
+  // Returns false on a miss. `refresh` is set for the one caller that
+  // should look up an expired entry again.
+  bool Get(const std::string& key,
+           int* status,
+           std::vector<std::string>* addresses,
+           bool* refresh);
+  // Results with statuses other than 0, UV_EAI_NONAME and UV_EAI_NODATA are
+  // not stored, but let the next stale hit start another refresh.
+  void Put(const std::string& key,
+           int status,
+           std::vector<std::string>&& addresses);
+
+ private:
+  static constexpr size_t kShardCount = 16;
+
+  struct Entry {
+    std::string key;
+    int status;
+    std::vector<std::string> addresses;
+    uint64_t expires;  // uv_hrtime() based
+    bool refreshing;
+  };
+
+  struct Shard {
+    mutable Mutex mutex;
+    std::list<Entry> lru;  // Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  };
+
+  Shard* ShardFor(const std::string& key);
+
+  std::atomic<size_t> max_entries_{0};
+  std::atomic<uint64_t> ttl_{0};
+  std::atomic<uint64_t> negative_ttl_{0};
+  std::atomic<uint64_t> stale_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> stale_hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  Shard shards_[kShardCount];
+};
+
+// Resolves a name like GetAddrInfoReqWrap, but through ares_getaddrinfo()
+// on a ChannelWrap instead of getaddrinfo() on the threadpool. c-ares reads
+// the hosts file and queries DNS in the order that nsswitch.conf (or
+// host.conf/svc.conf) configures. Errors are reported with the same UV_EAI_*
+// codes as getaddrinfo() reports them.
+class AresGetAddrInfoWrap final : public AsyncWrap {
+ public:
+  AresGetAddrInfoWrap(ChannelWrap* channel,
+                      v8::Local<v8::Object> req_wrap_obj,
+                      bool verbatim);
+  ~AresGetAddrInfoWrap() override;
+
+  void Send(const char* hostname, int family, int flags);
+
+  void set_cache_key(std::string&& key) { cache_key_ = std::move(key); }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(AresGetAddrInfoWrap)
+  SET_SELF_SIZE(AresGetAddrInfoWrap)
+
+ private:
+  static void Callback(void* arg,
+                       int status,
+                       int timeouts,
+                       struct ares_addrinfo* res);
+  void AfterResponse();
+
+  BaseObjectPtr<ChannelWrap> channel_;
+  const bool verbatim_;
+  int status_ = 0;
+  std::vector<std::string> addresses_;
+  std::string cache_key_;
+  // Pointer to pointer to 'this' that can be reset from the destructor,
+  // in order to let Callback() know that 'this' no longer exists.
+  AresGetAddrInfoWrap** callback_ptr_ = nullptr;
 };
 
 class GetNameInfoReqWrap final : public ReqWrap<uv_getnameinfo_t> {
@@ -0,0 +1,188 @@
+#ifndef SRC_CHUNK_LIST_H_
+#define SRC_CHUNK_LIST_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <utility>
+
+#include "util.h"
+
+namespace node {
+
+// A sequence of bytes that is made up of slices of other buffers, which it
+// shares rather than copies, like a rope. Appending, and removing bytes from
+// the front, never copies data. Searching and reading work across the
+// boundaries between slices, and only reading a range that spans more than
+// one slice into a contiguous buffer copies.
+//
+// Each slice keeps an `Owner`, e.g. a std::shared_ptr<v8::BackingStore>,
+// which keeps its memory alive for as long as the slice is in the list.
+template <typename Owner>
+class ChunkList {
+ public:
+  struct Chunk {
+    Owner owner;
+    const char* data;
+    size_t length;
+  };
+
+  // Empty slices are dropped.
+  void Push(Owner owner, const char* data, size_t length) {
+    if (length == 0) return;
+    chunks_.push_back(Chunk{std::move(owner), data, length});
+    length_ += length;
+  }
+
+  size_t length() const { return length_; }
+  size_t chunk_count() const { return chunks_.size(); }
+  const Chunk& chunk(size_t index) const { return chunks_[index]; }
+
+  // Returns the offset of the first occurrence of `needle` at or after
+  // `from`, or -1. An empty needle is found at `from`, or at the end.
+  int64_t IndexOf(const char* needle, size_t needle_length, size_t from) const;
+
+  // Copies `length` bytes at `offset` to `dest`. The range must be within
+  // the list.
+  void CopyOut(size_t offset, char* dest, size_t length) const;
+
+  // Returns the slice that contains all of the `length` bytes at `offset`,
+  // and the offset of the range within it, or nullptr if the range spans
+  // more than one slice.
+  const Chunk* FindContiguous(size_t offset,
+                              size_t length,
+                              size_t* chunk_offset) const;
+
+  // Removes up to `length` bytes from the front.
+  void Consume(size_t length);
+
+  void Clear() {
+    chunks_.clear();
+    length_ = 0;
+  }
+
+ private:
+  // Returns the index of the slice that contains the byte at `offset` and
+  // sets `*chunk_offset` to the offset of that byte within the slice.
+  size_t Locate(size_t offset, size_t* chunk_offset) const;
+  bool Matches(size_t index,
+               size_t chunk_offset,
+               const char* needle,
+               size_t needle_length) const;
+
+  std::deque<Chunk> chunks_;
+  size_t length_ = 0;
+};
+
+template <typename Owner>
+size_t ChunkList<Owner>::Locate(size_t offset, size_t* chunk_offset) const {
+  size_t index = 0;
+  while (index < chunks_.size() && offset >= chunks_[index].length) {
+    offset -= chunks_[index].length;
+    index++;
+  }
+  *chunk_offset = offset;
+  return index;
+}
+
+template <typename Owner>
+bool ChunkList<Owner>::Matches(size_t index,
+                               size_t chunk_offset,
+                               const char* needle,
+                               size_t needle_length) const {
+  while (needle_length > 0) {
+    if (index == chunks_.size()) return false;
+    const Chunk& chunk = chunks_[index];
+    const size_t n = std::min(needle_length, chunk.length - chunk_offset);
+    if (memcmp(chunk.data + chunk_offset, needle, n) != 0) return false;
+    needle += n;
+    needle_length -= n;
+    chunk_offset = 0;
+    index++;
+  }
+  return true;
+}
+
+template <typename Owner>
+int64_t ChunkList<Owner>::IndexOf(const char* needle,
+                                  size_t needle_length,
+                                  size_t from) const {
+  if (needle_length == 0) return std::min(from, length_);
+  if (from >= length_ || needle_length > length_ - from) return -1;
+
+  size_t chunk_offset;
+  size_t index = Locate(from, &chunk_offset);
+  size_t position = from - chunk_offset;  // Where the slice starts.
+  const size_t last = length_ - needle_length;
+  for (; index < chunks_.size(); index++) {
+    const Chunk& chunk = chunks_[index];
+    while (chunk_offset < chunk.length && position + chunk_offset <= last) {
+      const void* candidate = memchr(chunk.data + chunk_offset,
+                                     needle[0],
+                                     chunk.length - chunk_offset);
+      if (candidate == nullptr) break;
+      chunk_offset = static_cast<const char*>(candidate) - chunk.data;
+      if (position + chunk_offset > last) return -1;
+      if (Matches(index, chunk_offset, needle, needle_length))
+        return static_cast<int64_t>(position + chunk_offset);
+      chunk_offset++;
+    }
+    position += chunk.length;
+    chunk_offset = 0;
+  }
+  return -1;
+}
+
+template <typename Owner>
+void ChunkList<Owner>::CopyOut(size_t offset,
+                               char* dest,
+                               size_t length) const {
+  CHECK_LE(offset, length_);
+  CHECK_LE(length, length_ - offset);
+  size_t chunk_offset;
+  for (size_t index = Locate(offset, &chunk_offset); length > 0; index++) {
+    const Chunk& chunk = chunks_[index];
+    const size_t n = std::min(length, chunk.length - chunk_offset);
+    memcpy(dest, chunk.data + chunk_offset, n);
+    dest += n;
+    length -= n;
+    chunk_offset = 0;
+  }
+}
+
+template <typename Owner>
+const typename ChunkList<Owner>::Chunk* ChunkList<Owner>::FindContiguous(
+    size_t offset, size_t length, size_t* chunk_offset) const {
+  const size_t index = Locate(offset, chunk_offset);
+  if (index == chunks_.size() ||
+      length > chunks_[index].length - *chunk_offset) {
+    return nullptr;
+  }
+  return &chunks_[index];
+}
+
+template <typename Owner>
+void ChunkList<Owner>::Consume(size_t length) {
+  length = std::min(length, length_);
+  length_ -= length;
+  while (length > 0) {
+    Chunk& chunk = chunks_.front();
+    if (length < chunk.length) {
+      chunk.data += length;
+      chunk.length -= length;
+      return;
+    }
+    length -= chunk.length;
+    chunks_.pop_front();
+  }
+}
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CHUNK_LIST_H_
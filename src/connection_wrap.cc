@@ -1,21 +1,32 @@
 #include "connection_wrap.h"
 
+#include "aliased_struct-inl.h"
 #include "connect_wrap.h"
 #include "env-inl.h"
+#include "node_sockaddr-inl.h"
+#include "node_usdt.h"
 #include "pipe_wrap.h"
 #include "stream_base-inl.h"
 #include "stream_wrap.h"
 #include "tcp_wrap.h"
 #include "util-inl.h"
 
+#include <algorithm>
+
 namespace node {
 
+using v8::Array;
 using v8::Boolean;
 using v8::Context;
+using v8::Float64Array;
+using v8::FunctionCallbackInfo;
 using v8::HandleScope;
 using v8::Integer;
+using v8::Isolate;
 using v8::Local;
+using v8::Number;
 using v8::Object;
+using v8::Uint32;
 using v8::Value;
 
 
@@ -44,6 +55,16 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
   // uv_close() on the handle.
   CHECK_EQ(wrap_data->persistent().IsEmpty(), false);
 
+  if (status == 0 && wrap_data->RejectPendingConnection())
+    return;
+
+  if (wrap_data->accept_batch_size_ > 1) {
+    if (status == 0)
+      return wrap_data->AcceptIntoBatch();
+    // Report errors only after the connections accepted before them.
+    wrap_data->FlushAcceptedClients();
+  }
+
   Local<Value> client_handle;
 
   if (status == 0) {
@@ -62,6 +83,9 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
     // returned.
     if (uv_accept(handle, client))
       return;
+    NODE_USDT_PROBE2(net__accept, NODE_USDT_PTR(wrap_data),
+                     NODE_USDT_PTR(wrap));
+    wrap_data->SetUpClient(wrap);
 
     // Successful accept. Call the onconnection callback in JavaScript land.
     client_handle = client_obj;
@@ -74,6 +98,235 @@ void ConnectionWrap<WrapType, UVType>::OnConnection(uv_stream_t* handle,
 }
 
 
+template <typename WrapType, typename UVType>
+bool ConnectionWrap<WrapType, UVType>::RejectPendingConnection() {
+  if (!rate_limiter_)
+    return false;
+
+#ifdef __POSIX__
+  // libuv has accept()ed the connection already and keeps its fd for
+  // uv_accept(), so the peer is known before there is a handle for it.
+  sockaddr_storage storage;
+  socklen_t length = sizeof(storage);
+  if (getpeername(handle_.accepted_fd,
+                  reinterpret_cast<sockaddr*>(&storage),
+                  &length) != 0 ||
+      (storage.ss_family != AF_INET && storage.ss_family != AF_INET6) ||
+      rate_limiter_->Admit(
+          SocketAddress(reinterpret_cast<sockaddr*>(&storage)))) {
+    return false;
+  }
+
+  // The connection still has to be taken off the server to be closed.
+  uv_tcp_t* rejected = new uv_tcp_t;
+  CHECK_EQ(uv_tcp_init(env()->event_loop(), rejected), 0);
+  uv_accept(stream(), reinterpret_cast<uv_stream_t*>(rejected));
+  uv_close(reinterpret_cast<uv_handle_t*>(rejected), [](uv_handle_t* handle) {
+    delete reinterpret_cast<uv_tcp_t*>(handle);
+  });
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::AcceptIntoBatch() {
+  BaseObjectPtr<WrapType> client;
+  if (!spare_clients_.empty()) {
+    client = std::move(spare_clients_.back());
+    spare_clients_.pop_back();
+  } else {
+    Local<Object> client_obj;
+    if (!WrapType::Instantiate(env(), this, WrapType::SOCKET)
+             .ToLocal(&client_obj))
+      return;
+    client.reset(Unwrap<WrapType>(client_obj));
+    if (!client) return;
+  }
+
+  // See OnConnection() for why this may fail. The client object stays
+  // unused, so it can be kept for the next connection.
+  if (uv_accept(stream(), client->stream())) {
+    spare_clients_.emplace_back(std::move(client));
+    return;
+  }
+  NODE_USDT_PROBE2(net__accept, NODE_USDT_PTR(this),
+                   NODE_USDT_PTR(client.get()));
+  SetUpClient(client.get());
+  accepted_clients_.emplace_back(std::move(client));
+
+  if (accepted_clients_.size() >= accept_batch_size_)
+    return FlushAcceptedClients();
+
+  if (accept_flush_scheduled_)
+    return;
+  accept_flush_scheduled_ = true;
+  env()->SetImmediate([self = BaseObjectPtr<ConnectionWrap>(this)](
+      Environment* env) {
+    self->accept_flush_scheduled_ = false;
+    if (self->IsHandleClosing())
+      return;
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    self->FlushAcceptedClients();
+    self->RefillSpareClients();
+  });
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::FlushAcceptedClients() {
+  if (accepted_clients_.empty())
+    return;
+
+  Isolate* isolate = env()->isolate();
+  std::vector<Local<Value>> clients;
+  clients.reserve(accepted_clients_.size());
+  for (const BaseObjectPtr<WrapType>& client : accepted_clients_)
+    clients.push_back(client->object());
+  accepted_clients_.clear();
+
+  Local<Value> cb;
+  if (!object()->Get(env()->context(), env()->onconnectionbatch_string())
+           .ToLocal(&cb)) {
+    return;
+  }
+  if (cb->IsFunction()) {
+    Local<Value> arg = Array::New(isolate, clients.data(), clients.size());
+    MakeCallback(cb.As<v8::Function>(), 1, &arg);
+    return;
+  }
+
+  // Fall back to one callback per client for code that does not know about
+  // batches.
+  for (Local<Value> client : clients) {
+    Local<Value> argv[] = { Integer::New(isolate, 0), client };
+    if (MakeCallback(env()->onconnection_string(), arraysize(argv), argv)
+            .IsEmpty()) {
+      return;
+    }
+  }
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::RefillSpareClients() {
+  size_t wanted = std::min<size_t>(accept_batch_size_, kMaxSpareClients);
+  while (spare_clients_.size() < wanted && !IsHandleClosing()) {
+    Local<Object> client_obj;
+    if (!WrapType::Instantiate(env(), this, WrapType::SOCKET)
+             .ToLocal(&client_obj))
+      return;
+    WrapType* client = Unwrap<WrapType>(client_obj);
+    if (client == nullptr) return;
+    spare_clients_.emplace_back(client);
+  }
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::SetAcceptBatchSize(
+    const FunctionCallbackInfo<Value>& args) {
+  WrapType* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  CHECK(args[0]->IsUint32());
+  wrap->accept_batch_size_ =
+      std::min(args[0].As<Uint32>()->Value(), kMaxAcceptBatchSize);
+  if (wrap->accept_batch_size_ <= 1)
+    wrap->FlushAcceptedClients();
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::SetRateLimit(
+    const FunctionCallbackInfo<Value>& args) {
+  WrapType* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+  CHECK(args[0]->IsNumber());
+  CHECK(args[1]->IsNumber());
+  CHECK(args[2]->IsUint32());
+  double rate = args[0].As<Number>()->Value();
+  double burst = args[1].As<Number>()->Value();
+  uint32_t max_addresses = args[2].As<Uint32>()->Value();
+  if (rate <= 0 && burst <= 0) {
+    wrap->rate_limiter_.reset();
+    return args.GetReturnValue().Set(0);
+  }
+#ifdef __POSIX__
+  wrap->rate_limiter_ = std::make_unique<SocketAddressRateLimiter>(
+      rate, burst, max_addresses);
+  args.GetReturnValue().Set(0);
+#else
+  // The peer of a pending connection is not known on Windows.
+  args.GetReturnValue().Set(UV_ENOTSUP);
+#endif
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::SetConnectionMemoryBudget(
+    const FunctionCallbackInfo<Value>& args) {
+  WrapType* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  for (int i = 0; i < 4; i++) {
+    CHECK(args[i]->IsNumber());
+    CHECK_GE(args[i].As<Integer>()->Value(), 0);
+  }
+  const size_t high = args[0].As<Integer>()->Value();
+  const size_t low = args[1].As<Integer>()->Value();
+  // Connections that were accepted already keep the budget they have.
+  if (high > 0)
+    wrap->connections_budget_ = std::make_shared<MemoryBudget>(high, low);
+  else
+    wrap->connections_budget_.reset();
+  wrap->connection_high_watermark_ = args[2].As<Integer>()->Value();
+  wrap->connection_low_watermark_ = args[3].As<Integer>()->Value();
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::GetServerCounters(
+    const FunctionCallbackInfo<Value>& args) {
+  WrapType* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  if (!wrap->server_counters_) {
+    wrap->server_counters_ = std::make_shared<AliasedStruct<ServerCounters>>(
+        wrap->env()->isolate());
+  }
+  args.GetReturnValue().Set(Float64Array::New(
+      wrap->server_counters_->GetArrayBuffer(), 0, kServerCounterCount));
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::SetUpClient(WrapType* client) {
+  if (server_counters_)
+    client->SetServerCounters(server_counters_);
+  if (!connections_budget_ && connection_high_watermark_ == 0)
+    return;
+  client->SetMemoryBudget(
+      connection_high_watermark_, connection_low_watermark_,
+      connections_budget_);
+}
+
+
+template <typename WrapType, typename UVType>
+void ConnectionWrap<WrapType, UVType>::Close(Local<Value> close_callback) {
+  // Neither kind of client has been seen by JS yet.
+  for (const BaseObjectPtr<WrapType>& client : accepted_clients_)
+    client->Close();
+  for (const BaseObjectPtr<WrapType>& client : spare_clients_)
+    client->Close();
+  accepted_clients_.clear();
+  spare_clients_.clear();
+  LibuvStreamWrap::Close(close_callback);
+}
+
+
 template <typename WrapType, typename UVType>
 void ConnectionWrap<WrapType, UVType>::AfterConnect(uv_connect_t* req,
                                                     int status) {
@@ -133,5 +386,32 @@ template void ConnectionWrap<PipeWrap, uv_pipe_t>::AfterConnect(
 template void ConnectionWrap<TCPWrap, uv_tcp_t>::AfterConnect(
     uv_connect_t* handle, int status);
 
+template void ConnectionWrap<PipeWrap, uv_pipe_t>::SetAcceptBatchSize(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<TCPWrap, uv_tcp_t>::SetAcceptBatchSize(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<TCPWrap, uv_tcp_t>::SetRateLimit(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<PipeWrap, uv_pipe_t>::SetConnectionMemoryBudget(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<TCPWrap, uv_tcp_t>::SetConnectionMemoryBudget(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<PipeWrap, uv_pipe_t>::GetServerCounters(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<TCPWrap, uv_tcp_t>::GetServerCounters(
+    const FunctionCallbackInfo<Value>& args);
+
+template void ConnectionWrap<PipeWrap, uv_pipe_t>::Close(
+    Local<Value> close_callback);
+
+template void ConnectionWrap<TCPWrap, uv_tcp_t>::Close(
+    Local<Value> close_callback);
+
 
 }  // namespace node
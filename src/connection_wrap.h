@@ -3,8 +3,12 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include "node_sockaddr.h"
 #include "stream_wrap.h"
 
+#include <memory>
+#include <vector>
+
 namespace node {
 
 class Environment;
@@ -15,12 +19,62 @@ class ConnectionWrap : public LibuvStreamWrap {
   static void OnConnection(uv_stream_t* handle, int status);
   static void AfterConnect(uv_connect_t* req, int status);
 
+  // Enables accept batching for servers: with a batch size above 1, accepted
+  // clients are collected and passed to `.onconnectionbatch(clients)` once
+  // the batch is full or at the end of the event loop iteration.
+  static void SetAcceptBatchSize(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Limits the connections a server accepts per peer host with a token
+  // bucket, see SocketAddressRateLimiter: setRateLimit(rate, burst,
+  // maxAddresses). Connections beyond the limit are closed without being
+  // reported. A rate and burst of 0 remove the limit.
+  static void SetRateLimit(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Gives each connection that a server accepts a MemoryBudget, see
+  // LibuvStreamWrap::SetMemoryBudget(), and has them share another one:
+  // setConnectionMemoryBudget(highWatermark, lowWatermark,
+  // connectionHighWatermark, connectionLowWatermark). While the shared
+  // budget is exceeded, none of the connections read. High watermarks of
+  // 0 leave out the respective limit.
+  static void SetConnectionMemoryBudget(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Returns a Float64Array with the ServerCounters of a server, indexed by
+  // the kServer* constants, and starts keeping them if it did not yet.
+  // Only connections accepted from then on are counted.
+  static void GetServerCounters(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  void Close(
+      v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
+
  protected:
   ConnectionWrap(Environment* env,
                  v8::Local<v8::Object> object,
                  ProviderType provider);
 
   UVType handle_;
+
+ private:
+  static constexpr uint32_t kMaxAcceptBatchSize = 1024;
+  static constexpr size_t kMaxSpareClients = 64;
+
+  // Closes the pending connection if its peer is over the rate limit.
+  bool RejectPendingConnection();
+  void AcceptIntoBatch();
+  void FlushAcceptedClients();
+  void RefillSpareClients();
+  // Applies the per-connection settings of the server to `client`.
+  void SetUpClient(WrapType* client);
+
+  uint32_t accept_batch_size_ = 0;
+  bool accept_flush_scheduled_ = false;
+  std::vector<BaseObjectPtr<WrapType>> accepted_clients_;
+  // Client objects instantiated ahead of time, outside of accept callbacks.
+  std::vector<BaseObjectPtr<WrapType>> spare_clients_;
+  std::unique_ptr<SocketAddressRateLimiter> rate_limiter_;
+  std::shared_ptr<MemoryBudget> connections_budget_;
+  size_t connection_high_watermark_ = 0;
+  size_t connection_low_watermark_ = 0;
+  SharedServerCounters server_counters_;
 };
 
 }  // namespace node
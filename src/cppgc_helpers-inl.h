@@ -0,0 +1,51 @@
+#ifndef SRC_CPPGC_HELPERS_INL_H_
+#define SRC_CPPGC_HELPERS_INL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "cppgc_helpers.h"
+#include "env-inl.h"
+#include "util.h"
+
+namespace node {
+
+cppgc::AllocationHandle& CppgcMixin::GetAllocationHandle(Environment* env) {
+  v8::CppHeap* heap = env->isolate()->GetCppHeap();
+  CHECK_NOT_NULL(heap);
+  return heap->GetAllocationHandle();
+}
+
+template <typename T>
+void CppgcMixin::Wrap(T* ptr, Environment* env, v8::Local<v8::Object> object) {
+  static_assert(std::is_base_of<CppgcMixin, T>::value,
+                "T must derive from CppgcMixin");
+  CHECK_GE(object->InternalFieldCount(), kInternalFieldCount);
+  CppgcMixin* mixin = ptr;
+  mixin->env_ = env;
+  mixin->traced_reference_.Reset(env->isolate(), object);
+  // V8 expects the start of the cppgc object here, which is `ptr` rather
+  // than `mixin` when T has other base classes.
+  object->SetAlignedPointerInInternalField(kSlot, ptr);
+  object->SetAlignedPointerInInternalField(
+      kEmbedderType, const_cast<uint16_t*>(&kEmbedderId));
+}
+
+template <typename T>
+T* CppgcMixin::Unwrap(v8::Local<v8::Object> object) {
+  if (object->InternalFieldCount() < kInternalFieldCount ||
+      object->GetAlignedPointerFromInternalField(kEmbedderType) !=
+          &kEmbedderId) {
+    return nullptr;
+  }
+  return static_cast<T*>(object->GetAlignedPointerFromInternalField(kSlot));
+}
+
+v8::Local<v8::Object> CppgcMixin::object() const {
+  return traced_reference_.Get(env_->isolate());
+}
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CPPGC_HELPERS_INL_H_
@@ -0,0 +1,97 @@
+#ifndef SRC_CPPGC_HELPERS_H_
+#define SRC_CPPGC_HELPERS_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstdint>
+#include <type_traits>
+
+#include "base_object.h"
+#include "cppgc/garbage-collected.h"
+#include "cppgc/visitor.h"
+#include "v8-cppgc.h"
+#include "v8.h"
+
+namespace node {
+
+class Environment;
+
+// An alternative to BaseObject for wrappers that are created in large
+// numbers and die young, such as request objects. The C++ object lives on
+// the cppgc (Oilpan) heap that IsolateData attaches to the isolate, and it
+// is traced and collected by V8 together with its JS object. There is no
+// v8::Global, weak callback or cleanup hook per object.
+//
+// Subclasses look like this:
+//
+//   class Foo final : public cppgc::GarbageCollected<Foo>, public CppgcMixin {
+//    public:
+//     Foo(Environment* env, v8::Local<v8::Object> object) {
+//       CppgcMixin::Wrap(this, env, object);
+//     }
+//     void Trace(cppgc::Visitor* visitor) const final {
+//       CppgcMixin::Trace(visitor);
+//       visitor->Trace(other_);  // Other cppgc::Member<> fields.
+//     }
+//   };
+//
+//   Foo* foo = cppgc::MakeGarbageCollected<Foo>(
+//       CppgcMixin::GetAllocationHandle(env), env, object);
+//
+// The JS object needs CppgcMixin::kInternalFieldCount internal fields
+// and must not be passed to BaseObject::FromJSObject(), use Unwrap() instead.
+// Destructors run during garbage collection and, unlike those of
+// BaseObjects, must not touch the JS heap or the Environment, which may be
+// gone by then. Keeping the object alive from C++ works through
+// cppgc::Persistent or cppgc::Member rather than BaseObjectPtr.
+class CppgcMixin : public cppgc::GarbageCollectedMixin {
+ public:
+  // kSlot is the same as for BaseObject, so that V8's fast API calls find
+  // the receiver in the same place for either kind of wrapper.
+  enum InternalFields {
+    kSlot = BaseObject::kSlot,
+    kEmbedderType,
+    kInternalFieldCount
+  };
+
+  // V8 only traces JS objects whose kEmbedderType field points to this id.
+  // BaseObjects with more internal fields may keep pointers to C++ objects
+  // there, whose first bytes are the low bits of a vtable pointer. An odd
+  // id can never match those.
+  static constexpr uint16_t kEmbedderId = 0x90df;
+
+  static inline cppgc::AllocationHandle& GetAllocationHandle(
+      Environment* env);
+
+  template <typename T>
+  static inline void Wrap(T* ptr, Environment* env,
+                          v8::Local<v8::Object> object);
+
+  // Returns nullptr if `object` does not wrap a CppgcMixin.
+  template <typename T>
+  static inline T* Unwrap(v8::Local<v8::Object> object);
+
+  inline Environment* env() const { return env_; }
+  inline v8::Local<v8::Object> object() const;
+
+  void Trace(cppgc::Visitor* visitor) const override {
+    static_cast<v8::JSVisitor*>(visitor)->Trace(traced_reference_);
+  }
+
+ private:
+  Environment* env_ = nullptr;
+  v8::TracedReference<v8::Object> traced_reference_;
+};
+
+#define ASSIGN_OR_RETURN_UNWRAP_CPPGC(ptr, obj, ...)                           \
+  do {                                                                         \
+    *ptr = node::CppgcMixin::Unwrap<                                           \
+        typename std::remove_reference<decltype(**ptr)>::type>(obj);           \
+    if (*ptr == nullptr) return __VA_ARGS__;                                   \
+  } while (0)
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CPPGC_HELPERS_H_
@@ -27,9 +27,14 @@
 
 #include <openssl/bio.h>
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
 
+#ifdef NODE_CRYPTO_HAVE_KTLS
+#include <linux/tls.h>
+#endif
+
 namespace node {
 namespace crypto {
 
@@ -131,7 +136,15 @@ size_t NodeBIO::PeekMultiple(char** out, size_t* size, size_t* count) {
 int NodeBIO::Write(BIO* bio, const char* data, int len) {
   BIO_clear_retry_flags(bio);
 
-  FromBIO(bio)->Write(data, len);
+  NodeBIO* nbio = FromBIO(bio);
+  if (nbio->ktls_next_record_type_ != 0) {
+    // The record type applies to this one write only.
+    uint64_t begin = nbio->read_total_ + nbio->Length();
+    nbio->ktls_records_.push_back(
+        { begin, begin + len, nbio->ktls_next_record_type_ });
+    nbio->ktls_next_record_type_ = 0;
+  }
+  nbio->Write(data, len);
 
   return len;
 }
@@ -213,6 +226,25 @@ long NodeBIO::Ctrl(BIO* bio, int cmd, long num,  // NOLINT(runtime/int)
     case BIO_CTRL_FLUSH:
       ret = 1;
       break;
+#ifdef NODE_CRYPTO_HAVE_KTLS
+    // The BIO_CTRL_*_KTLS* constants for setting things are internal to
+    // OpenSSL, so their values are spelled out.
+    case BIO_CTRL_GET_KTLS_SEND:
+      ret = nbio->ktls_send_;
+      break;
+    case 72:  // BIO_CTRL_SET_KTLS
+      // Only transmission is offloaded. Reads keep going through OpenSSL.
+      ret = num != 0 && nbio->SetKTLSCryptoInfo(ptr);
+      break;
+    case 74:  // BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG
+      nbio->ktls_next_record_type_ = num;
+      ret = 1;
+      break;
+    case 75:  // BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG
+      nbio->ktls_next_record_type_ = 0;
+      ret = 1;
+      break;
+#endif  // NODE_CRYPTO_HAVE_KTLS
     case BIO_CTRL_PUSH:
     case BIO_CTRL_POP:
     default:
@@ -288,6 +320,9 @@ size_t NodeBIO::Read(char* out, size_t size) {
   }
   CHECK_EQ(expected, bytes_read);
   length_ -= bytes_read;
+  read_total_ += bytes_read;
+  while (!ktls_records_.empty() && ktls_records_.front().end <= read_total_)
+    ktls_records_.pop_front();
 
   // Free all empty buffers, but write_head's child
   FreeEmpty();
@@ -466,6 +501,9 @@ void NodeBIO::Reset() {
   if (read_head_ == nullptr)
     return;
 
+  read_total_ += length_;
+  ktls_records_.clear();
+
   while (read_head_->read_pos_ != read_head_->write_pos_) {
     CHECK(read_head_->write_pos_ > read_head_->read_pos_);
 
@@ -480,7 +518,78 @@ void NodeBIO::Reset() {
 }
 
 
+size_t NodeBIO::NextSegment(int* record_type) const {
+  *record_type = kCiphertext;
+  if (!ktls_send_)
+    return Length();
+  if (read_total_ < ktls_start_)
+    return std::min<uint64_t>(Length(), ktls_start_ - read_total_);
+
+  *record_type = SSL3_RT_APPLICATION_DATA;
+  if (ktls_records_.empty())
+    return Length();
+  const KTLSRecord& next = ktls_records_.front();
+  if (next.begin > read_total_)
+    return next.begin - read_total_;
+  *record_type = next.type;
+  return next.end - read_total_;
+}
+
+
+std::vector<unsigned char> NodeBIO::TakeKTLSCryptoInfo() {
+  return std::move(ktls_crypto_info_);
+}
+
+
+bool NodeBIO::SetKTLSCryptoInfo(const void* crypto_info) {
+#ifdef NODE_CRYPTO_HAVE_KTLS
+  // OpenSSL refuses to change keys once kTLS is on, but be safe.
+  if (ktls_send_)
+    return false;
+
+  // OpenSSL passes a union of the kernel's structs, which all start with
+  // the common tls_crypto_info header.
+  const tls_crypto_info* info =
+      static_cast<const tls_crypto_info*>(crypto_info);
+  size_t size;
+  switch (info->cipher_type) {
+    case TLS_CIPHER_AES_GCM_128:
+      size = sizeof(tls12_crypto_info_aes_gcm_128);
+      break;
+#ifdef TLS_CIPHER_AES_GCM_256
+    case TLS_CIPHER_AES_GCM_256:
+      size = sizeof(tls12_crypto_info_aes_gcm_256);
+      break;
+#endif
+#ifdef TLS_CIPHER_AES_CCM_128
+    case TLS_CIPHER_AES_CCM_128:
+      size = sizeof(tls12_crypto_info_aes_ccm_128);
+      break;
+#endif
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    case TLS_CIPHER_CHACHA20_POLY1305:
+      size = sizeof(tls12_crypto_info_chacha20_poly1305);
+      break;
+#endif
+    default:
+      return false;
+  }
+
+  const unsigned char* data = static_cast<const unsigned char*>(crypto_info);
+  ktls_crypto_info_.assign(data, data + size);
+  ktls_start_ = read_total_ + Length();
+  ktls_send_ = true;
+  return true;
+#else
+  return false;
+#endif  // NODE_CRYPTO_HAVE_KTLS
+}
+
+
 NodeBIO::~NodeBIO() {
+  if (!ktls_crypto_info_.empty())
+    OPENSSL_cleanse(ktls_crypto_info_.data(), ktls_crypto_info_.size());
+
   if (read_head_ == nullptr)
     return;
 
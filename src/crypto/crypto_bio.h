@@ -24,11 +24,23 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include "memory_tracker.h"
 #include "node_crypto.h"
 #include "openssl/bio.h"
+#include "openssl/ssl.h"
 #include "util.h"
 #include "v8.h"
 
+#include <deque>
+#include <vector>
+
+// Kernel TLS transmit offload needs Linux and an OpenSSL 3 that has been
+// built with kTLS support, which the bundled one is not.
+#if defined(__linux__) && defined(SSL_OP_ENABLE_KTLS) && \
+    !defined(OPENSSL_NO_KTLS)
+#define NODE_CRYPTO_HAVE_KTLS 1
+#endif
+
 namespace node {
 
 class Environment;
@@ -124,6 +136,20 @@ class NodeBIO : public MemoryRetainer {
 
   static NodeBIO* FromBIO(BIO* bio);
 
+  // Once OpenSSL has handed its write keys over with BIO_set_ktls(), it
+  // writes plaintext records into the BIO and leaves the encryption to the
+  // kernel. Everything written before that point is still ciphertext.
+  static constexpr int kCiphertext = -1;
+
+  // Returns how many bytes at the read head have to be written to the socket
+  // as one unit. `record_type` is set to kCiphertext for data encrypted by
+  // OpenSSL, or to the TLS record type that the kernel has to use.
+  size_t NextSegment(int* record_type) const;
+
+  // Returns the struct for the TLS_TX socket option. The caller has to
+  // cleanse it after use.
+  std::vector<unsigned char> TakeKTLSCryptoInfo();
+
   void MemoryInfo(MemoryTracker* tracker) const override {
     tracker->TrackFieldWithSize("buffer", length_, "NodeBIO::Buffer");
   }
@@ -143,6 +169,8 @@ class NodeBIO : public MemoryRetainer {
 
   static const BIO_METHOD* GetMethod();
 
+  bool SetKTLSCryptoInfo(const void* crypto_info);
+
   // Enough to handle the most of the client hellos
   static const size_t kInitialBufferLength = 1024;
   static const size_t kThroughputBufferLength = 16384;
@@ -155,8 +183,10 @@ class NodeBIO : public MemoryRetainer {
                                            len_(len),
                                            next_(nullptr) {
       data_ = new char[len];
-      if (env_ != nullptr)
+      if (env_ != nullptr) {
         env_->isolate()->AdjustAmountOfExternalAllocatedMemory(len);
+        native_memory::Track(native_memory::kTls, len);
+      }
     }
 
     ~Buffer() {
@@ -164,6 +194,7 @@ class NodeBIO : public MemoryRetainer {
       if (env_ != nullptr) {
         const int64_t len = static_cast<int64_t>(len_);
         env_->isolate()->AdjustAmountOfExternalAllocatedMemory(-len);
+        native_memory::Track(native_memory::kTls, -len);
       }
     }
 
@@ -182,6 +213,21 @@ class NodeBIO : public MemoryRetainer {
   int eof_return_ = -1;
   Buffer* read_head_ = nullptr;
   Buffer* write_head_ = nullptr;
+  // Total number of bytes ever read, for locating the kTLS marks below.
+  uint64_t read_total_ = 0;
+
+  struct KTLSRecord {
+    uint64_t begin;
+    uint64_t end;
+    int type;
+  };
+
+  bool ktls_send_ = false;
+  uint64_t ktls_start_ = 0;  // Where the plaintext begins.
+  std::vector<unsigned char> ktls_crypto_info_;
+  // Non-application records, which the kernel needs to be told about.
+  std::deque<KTLSRecord> ktls_records_;
+  int ktls_next_record_type_ = 0;
 
   friend void node::crypto::InitCryptoOnce();
 };
@@ -1,12 +1,14 @@
 #include "crypto/crypto_cipher.h"
 #include "crypto/crypto_util.h"
 #include "allocated_buffer-inl.h"
+#include "async_wrap-inl.h"
 #include "base_object-inl.h"
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
 #include "node_buffer.h"
 #include "node_internals.h"
 #include "node_process-inl.h"
+#include "threadpoolwork-inl.h"
 #include "v8.h"
 
 namespace node {
@@ -18,7 +20,10 @@ using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
 using v8::Int32;
+using v8::Just;
 using v8::Local;
+using v8::Maybe;
+using v8::Nothing;
 using v8::Object;
 using v8::Uint32;
 using v8::Value;
@@ -61,7 +66,7 @@ void GetCipherInfo(const FunctionCallbackInfo<Value>& args) {
   const EVP_CIPHER* cipher;
   if (args[1]->IsString()) {
     Utf8Value name(env->isolate(), args[1]);
-    cipher = EVP_get_cipherbyname(*name);
+    cipher = GetCipherByName(*name);
   } else {
     int nid = args[1].As<Int32>()->Value();
     cipher = EVP_get_cipherbynid(nid);
@@ -295,6 +300,8 @@ void CipherBase::Initialize(Environment* env, Local<Object> target) {
 
   env->SetMethodNoSideEffect(target, "getCipherInfo", GetCipherInfo);
 
+  AEADBatchJob::Initialize(env, target);
+
   NODE_DEFINE_CONSTANT(target, kWebCryptoCipherEncrypt);
   NODE_DEFINE_CONSTANT(target, kWebCryptoCipherDecrypt);
 }
@@ -329,6 +336,8 @@ void CipherBase::RegisterExternalReferences(
                                              EVP_PKEY_verify_recover>);
 
   registry->Register(GetCipherInfo);
+
+  AEADBatchJob::RegisterExternalReferences(registry);
 }
 
 void CipherBase::New(const FunctionCallbackInfo<Value>& args) {
@@ -389,7 +398,7 @@ void CipherBase::Init(const char* cipher_type,
         "crypto.createCipher() is not supported in FIPS mode.");
   }
 
-  const EVP_CIPHER* const cipher = EVP_get_cipherbyname(cipher_type);
+  const EVP_CIPHER* const cipher = GetCipherByName(cipher_type);
   if (cipher == nullptr)
     return THROW_ERR_CRYPTO_UNKNOWN_CIPHER(env());
 
@@ -453,7 +462,7 @@ void CipherBase::InitIv(const char* cipher_type,
   HandleScope scope(env()->isolate());
   MarkPopErrorOnReturn mark_pop_error_on_return;
 
-  const EVP_CIPHER* const cipher = EVP_get_cipherbyname(cipher_type);
+  const EVP_CIPHER* const cipher = GetCipherByName(cipher_type);
   if (cipher == nullptr)
     return THROW_ERR_CRYPTO_UNKNOWN_CIPHER(env());
 
@@ -940,11 +949,9 @@ bool PublicKeyCipher::Cipher(
     const ArrayBufferOrViewContents<unsigned char>& oaep_label,
     const ArrayBufferOrViewContents<unsigned char>& data,
     std::unique_ptr<BackingStore>* out) {
-  EVPKeyCtxPointer ctx(EVP_PKEY_CTX_new(pkey.get(), nullptr));
+  EVPKeyCtxPointer ctx = pkey.NewInitializedContext(EVP_PKEY_cipher_init);
   if (!ctx)
     return false;
-  if (EVP_PKEY_cipher_init(ctx.get()) <= 0)
-    return false;
   if (EVP_PKEY_CTX_set_rsa_padding(ctx.get(), padding) <= 0)
     return false;
 
@@ -1021,7 +1028,7 @@ void PublicKeyCipher::Cipher(const FunctionCallbackInfo<Value>& args) {
   const EVP_MD* digest = nullptr;
   if (args[offset + 2]->IsString()) {
     const Utf8Value oaep_str(env->isolate(), args[offset + 2]);
-    digest = EVP_get_digestbyname(*oaep_str);
+    digest = GetDigestByName(*oaep_str);
     if (digest == nullptr)
       return THROW_ERR_OSSL_EVP_INVALID_DIGEST(env);
   }
@@ -1044,5 +1051,267 @@ void PublicKeyCipher::Cipher(const FunctionCallbackInfo<Value>& args) {
       Buffer::New(env, ab, 0, ab->ByteLength()).FromMaybe(Local<Value>()));
 }
 
+AEADBatchConfig::AEADBatchConfig(AEADBatchConfig&& other) noexcept
+    : job_mode(other.job_mode),
+      mode(other.mode),
+      cipher(other.cipher),
+      auth_tag_length(other.auth_tag_length),
+      records(std::move(other.records)),
+      out_length(other.out_length) {}
+
+AEADBatchConfig& AEADBatchConfig::operator=(AEADBatchConfig&& other) noexcept {
+  if (&other == this) return *this;
+  this->~AEADBatchConfig();
+  return *new (this) AEADBatchConfig(std::move(other));
+}
+
+void AEADBatchConfig::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("records", records.size() * sizeof(Record));
+  if (job_mode != kCryptoJobAsync)
+    return;
+  size_t size = 0;
+  for (const Record& record : records)
+    size += record.in.size() + record.aad.size();
+  tracker->TrackFieldWithSize("data", size);
+}
+
+// The arguments are the cipher mode, the cipher name, an array each of keys,
+// IVs, AADs (or undefined) and inputs, all of the same length, and the auth
+// tag length that applies to all records.
+Maybe<bool> AEADBatchTraits::AdditionalConfig(
+    CryptoJobMode mode,
+    const FunctionCallbackInfo<Value>& args,
+    unsigned int offset,
+    AEADBatchConfig* params) {
+  Environment* env = Environment::GetCurrent(args);
+
+  params->job_mode = mode;
+
+  CHECK(args[offset]->IsUint32());  // Cipher mode
+  CHECK(args[offset + 1]->IsString());  // Cipher name
+  CHECK(args[offset + 2]->IsArray());  // Keys
+  CHECK(args[offset + 3]->IsArray());  // IVs
+  CHECK(args[offset + 4]->IsArray() || args[offset + 4]->IsUndefined());
+  CHECK(args[offset + 5]->IsArray());  // Inputs
+
+  uint32_t cmode = args[offset].As<Uint32>()->Value();
+  CHECK_LE(cmode, kWebCryptoCipherDecrypt);
+  params->mode = static_cast<WebCryptoCipherMode>(cmode);
+
+  Utf8Value cipher_name(env->isolate(), args[offset + 1]);
+  params->cipher = GetCipherByName(*cipher_name);
+  if (params->cipher == nullptr ||
+      (EVP_CIPHER_mode(params->cipher) != EVP_CIPH_GCM_MODE &&
+       EVP_CIPHER_nid(params->cipher) != NID_chacha20_poly1305)) {
+    THROW_ERR_CRYPTO_UNKNOWN_CIPHER(env);
+    return Nothing<bool>();
+  }
+
+  if (args[offset + 6]->IsUint32())
+    params->auth_tag_length = args[offset + 6].As<Uint32>()->Value();
+  const bool gcm = EVP_CIPHER_mode(params->cipher) == EVP_CIPH_GCM_MODE;
+  if (gcm ? !IsValidGCMTagLength(params->auth_tag_length)
+          : params->auth_tag_length == 0 || params->auth_tag_length > 16) {
+    THROW_ERR_CRYPTO_INVALID_AUTH_TAG(
+        env, "Invalid authentication tag length: %u",
+        params->auth_tag_length);
+    return Nothing<bool>();
+  }
+
+  Local<Array> keys = args[offset + 2].As<Array>();
+  Local<Array> ivs = args[offset + 3].As<Array>();
+  Local<Array> inputs = args[offset + 5].As<Array>();
+  Local<Array> aads;
+  if (args[offset + 4]->IsArray())
+    aads = args[offset + 4].As<Array>();
+  const uint32_t count = keys->Length();
+  CHECK_EQ(ivs->Length(), count);
+  CHECK_EQ(inputs->Length(), count);
+  CHECK(aads.IsEmpty() || aads->Length() == count);
+
+  const size_t key_length = EVP_CIPHER_key_length(params->cipher);
+  auto to_bytes = [mode](const ArrayBufferOrViewContents<char>& buf) {
+    return buf.ToJobInput(mode);
+  };
+
+  params->records.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> key;
+    Local<Value> iv;
+    Local<Value> aad;
+    Local<Value> input;
+    if (!keys->Get(env->context(), i).ToLocal(&key) ||
+        !ivs->Get(env->context(), i).ToLocal(&iv) ||
+        !inputs->Get(env->context(), i).ToLocal(&input) ||
+        (!aads.IsEmpty() && !aads->Get(env->context(), i).ToLocal(&aad))) {
+      return Nothing<bool>();
+    }
+
+    ArrayBufferOrViewContents<char> key_buf(key);
+    ArrayBufferOrViewContents<char> iv_buf(iv);
+    ArrayBufferOrViewContents<char> input_buf(input);
+    if (key_buf.size() != key_length) {
+      THROW_ERR_CRYPTO_INVALID_KEYLEN(env);
+      return Nothing<bool>();
+    }
+    if (iv_buf.size() == 0 || (!gcm && iv_buf.size() > 12)) {
+      THROW_ERR_CRYPTO_INVALID_IV(env);
+      return Nothing<bool>();
+    }
+    if (UNLIKELY(!input_buf.CheckSizeInt32())) {
+      THROW_ERR_OUT_OF_RANGE(env, "data is too big");
+      return Nothing<bool>();
+    }
+
+    AEADBatchConfig::Record record;
+    record.key = to_bytes(key_buf);
+    record.iv = to_bytes(iv_buf);
+    if (!aad.IsEmpty() && !aad->IsUndefined()) {
+      ArrayBufferOrViewContents<char> aad_buf(aad);
+      if (UNLIKELY(!aad_buf.CheckSizeInt32())) {
+        THROW_ERR_OUT_OF_RANGE(env, "aad is too big");
+        return Nothing<bool>();
+      }
+      record.aad = to_bytes(aad_buf);
+    }
+    record.in = to_bytes(input_buf);
+    record.out_offset = params->out_length;
+
+    if (params->mode == kWebCryptoCipherEncrypt) {
+      params->out_length += record.in.size() + params->auth_tag_length;
+    } else {
+      if (record.in.size() < params->auth_tag_length) {
+        THROW_ERR_CRYPTO_INVALID_AUTH_TAG(env);
+        return Nothing<bool>();
+      }
+      params->out_length += record.in.size() - params->auth_tag_length;
+    }
+    params->records.emplace_back(std::move(record));
+  }
+
+  return Just(true);
+}
+
+namespace {
+// Batches smaller than this are not worth spreading over several threads.
+constexpr size_t kAEADRecordsPerTask = 64;
+
+bool AEADBatchRecord(EVP_CIPHER_CTX* ctx,
+                     const AEADBatchConfig& params,
+                     const AEADBatchConfig::Record& record,
+                     unsigned char* out) {
+  const bool encrypt = params.mode == kWebCryptoCipherEncrypt;
+  const size_t length = encrypt
+      ? record.in.size()
+      : record.in.size() - params.auth_tag_length;
+  const unsigned char* in = record.in.data<unsigned char>();
+  int out_len;
+
+  if (!EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN,
+                           record.iv.size(), nullptr) ||
+      !EVP_CipherInit_ex(ctx, nullptr, nullptr,
+                         record.key.data<unsigned char>(),
+                         record.iv.data<unsigned char>(),
+                         encrypt)) {
+    return false;
+  }
+  if (!encrypt &&
+      !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG,
+                           params.auth_tag_length,
+                           const_cast<unsigned char*>(in + length))) {
+    return false;
+  }
+  if (record.aad.size() > 0 &&
+      !EVP_CipherUpdate(ctx, nullptr, &out_len,
+                        record.aad.data<unsigned char>(),
+                        record.aad.size())) {
+    return false;
+  }
+  out_len = 0;
+  if (length > 0 && !EVP_CipherUpdate(ctx, out, &out_len, in, length))
+    return false;
+  int final_len;
+  if (!EVP_CipherFinal_ex(ctx, out + out_len, &final_len))
+    return false;
+  return !encrypt ||
+         EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG,
+                             params.auth_tag_length, out + length);
+}
+}  // namespace
+
+// The output holds the records, followed by one byte per record that is 1 if
+// it was processed successfully. A record that fails to decrypt, usually
+// because its tag does not match, is zeroed without failing the others.
+bool AEADBatchTraits::DeriveBits(
+    Environment* env,
+    const AEADBatchConfig& params,
+    ByteSource* out) {
+  const size_t count = params.records.size();
+  const size_t size = params.out_length + count;
+  char* data = MallocOpenSSL<char>(size > 0 ? size : 1);
+  ByteSource buf = ByteSource::Allocated(data, size);
+  unsigned char* ptr = reinterpret_cast<unsigned char*>(data);
+  unsigned char* status = ptr + params.out_length;
+
+  // Each task handles a range of records with a single context, which is
+  // only rekeyed between records. OpenSSL's multi-block code paths only
+  // cover the CBC-HMAC TLS ciphers, so spreading the records over threads
+  // is the parallelism that is available for these.
+  const size_t tasks = (count + kAEADRecordsPerTask - 1) / kAEADRecordsPerTask;
+  bool ok = RunParallelTasks(tasks, tasks, [&](size_t task) {
+    ClearErrorOnReturn clear_error_on_return;
+    CipherCtxPointer ctx(EVP_CIPHER_CTX_new());
+    if (!ctx ||
+        !EVP_CipherInit_ex(ctx.get(), params.cipher, nullptr, nullptr,
+                           nullptr,
+                           params.mode == kWebCryptoCipherEncrypt)) {
+      return false;
+    }
+    const size_t end = std::min(count, (task + 1) * kAEADRecordsPerTask);
+    for (size_t i = task * kAEADRecordsPerTask; i < end; i++) {
+      const AEADBatchConfig::Record& record = params.records[i];
+      unsigned char* record_out = ptr + record.out_offset;
+      status[i] = AEADBatchRecord(ctx.get(), params, record, record_out);
+      if (!status[i]) {
+        size_t length = (i + 1 < count
+            ? params.records[i + 1].out_offset
+            : params.out_length) - record.out_offset;
+        OPENSSL_cleanse(record_out, length);
+        if (params.mode == kWebCryptoCipherEncrypt)
+          return false;
+      }
+    }
+    return true;
+  });
+  if (!ok)
+    return false;
+
+  *out = std::move(buf);
+  return true;
+}
+
+// Produces [output, ok], where `ok` has one boolean per record.
+Maybe<bool> AEADBatchTraits::EncodeOutput(
+    Environment* env,
+    const AEADBatchConfig& params,
+    ByteSource* out,
+    Local<Value>* result) {
+  const size_t count = params.records.size();
+  std::vector<Local<Value>> ok(count);
+  const char* status = out->get() + params.out_length;
+  for (size_t i = 0; i < count; i++)
+    ok[i] = v8::Boolean::New(env->isolate(), status[i] == 1);
+  out->Resize(params.out_length);
+
+  Local<Value> values[] = {
+    out->ToArrayBuffer(env),
+    Array::New(env->isolate(), ok.data(), ok.size())
+  };
+  if (values[0].IsEmpty())
+    return Nothing<bool>();
+  *result = Array::New(env->isolate(), values, arraysize(values));
+  return Just(true);
+}
+
 }  // namespace crypto
 }  // namespace node
@@ -11,6 +11,7 @@
 #include "v8.h"
 
 #include <string>
+#include <vector>
 
 namespace node {
 namespace crypto {
@@ -211,9 +212,7 @@ class CipherJob final : public CryptoJob<CipherTraits> {
             std::move(params)),
         key_(key->Data()),
         cipher_mode_(cipher_mode),
-        in_(mode == kCryptoJobAsync
-            ? data.ToCopy()
-            : data.ToByteSource()) {}
+        in_(data.ToJobInput(mode)) {}
 
   std::shared_ptr<KeyObjectData> key() const { return key_; }
 
@@ -284,6 +283,65 @@ class CipherJob final : public CryptoJob<CipherTraits> {
   ByteSource out_;
 };
 
+// Encrypts or decrypts many independent records with an AEAD cipher
+// (AES-GCM or ChaCha20-Poly1305) in one job. Each record has its own key,
+// IV, AAD and input. When encrypting, the output holds each ciphertext
+// followed by its tag. When decrypting, each input is expected in that same
+// layout and the output holds the plaintexts. Either way the records are
+// laid out back to back in a single buffer.
+struct AEADBatchConfig final : public MemoryRetainer {
+  struct Record {
+    ByteSource key;
+    ByteSource iv;
+    ByteSource aad;
+    ByteSource in;
+    size_t out_offset;
+  };
+
+  CryptoJobMode job_mode;
+  WebCryptoCipherMode mode;
+  const EVP_CIPHER* cipher = nullptr;
+  unsigned int auth_tag_length = 16;
+  std::vector<Record> records;
+  size_t out_length = 0;
+
+  AEADBatchConfig() = default;
+
+  explicit AEADBatchConfig(AEADBatchConfig&& other) noexcept;
+
+  AEADBatchConfig& operator=(AEADBatchConfig&& other) noexcept;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(AEADBatchConfig)
+  SET_SELF_SIZE(AEADBatchConfig)
+};
+
+struct AEADBatchTraits final {
+  using AdditionalParameters = AEADBatchConfig;
+  static constexpr const char* JobName = "AEADBatchJob";
+  static constexpr AsyncWrap::ProviderType Provider =
+      AsyncWrap::PROVIDER_CIPHERREQUEST;
+
+  static v8::Maybe<bool> AdditionalConfig(
+      CryptoJobMode mode,
+      const v8::FunctionCallbackInfo<v8::Value>& args,
+      unsigned int offset,
+      AEADBatchConfig* params);
+
+  static bool DeriveBits(
+      Environment* env,
+      const AEADBatchConfig& params,
+      ByteSource* out);
+
+  static v8::Maybe<bool> EncodeOutput(
+      Environment* env,
+      const AEADBatchConfig& params,
+      ByteSource* out,
+      v8::Local<v8::Value>* result);
+};
+
+using AEADBatchJob = DeriveBitsJob<AEADBatchTraits>;
+
 }  // namespace crypto
 }  // namespace node
 
@@ -116,6 +116,8 @@ void ClientHelloParser::ParseHeader(const uint8_t* data, size_t avail) {
   hello.has_ticket_ = tls_ticket_ != nullptr && tls_ticket_size_ != 0;
   hello.servername_ = servername_;
   hello.servername_size_ = static_cast<uint8_t>(servername_size_);
+  hello.alpn_ = alpn_;
+  hello.alpn_size_ = alpn_size_;
   onhello_cb_(cb_arg_, hello);
 }
 
@@ -150,6 +152,17 @@ void ClientHelloParser::ParseExtension(const uint16_t type,
         }
       }
       break;
+    case kALPN:
+      {
+        if (len < 2)
+          return;
+        uint32_t protocols_len = (data[0] << 8) + data[1];
+        if (protocols_len + 2 > len)
+          return;
+        alpn_ = data + 2;
+        alpn_size_ = protocols_len;
+      }
+      break;
     case kTLSSessionTicket:
       tls_ticket_size_ = len;
       tls_ticket_ = data + len;
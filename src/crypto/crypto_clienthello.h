@@ -49,6 +49,9 @@ class ClientHelloParser {
     inline bool has_ticket() const { return has_ticket_; }
     inline uint8_t servername_size() const { return servername_size_; }
     inline const uint8_t* servername() const { return servername_; }
+    // The ALPN ProtocolNameList, without its length prefix.
+    inline uint16_t alpn_size() const { return alpn_size_; }
+    inline const uint8_t* alpn() const { return alpn_; }
 
    private:
     uint8_t session_size_;
@@ -56,6 +59,8 @@ class ClientHelloParser {
     bool has_ticket_;
     uint8_t servername_size_;
     const uint8_t* servername_;
+    uint16_t alpn_size_;
+    const uint8_t* alpn_;
 
     friend class ClientHelloParser;
   };
@@ -98,6 +103,7 @@ class ClientHelloParser {
 
   enum ExtensionType {
     kServerName = 0,
+    kALPN = 16,
     kTLSSessionTicket = 35
   };
 
@@ -119,6 +125,8 @@ class ClientHelloParser {
   const uint8_t* session_id_ = nullptr;
   uint16_t servername_size_ = 0;
   const uint8_t* servername_ = nullptr;
+  uint16_t alpn_size_ = 0;
+  const uint8_t* alpn_ = nullptr;
   uint16_t tls_ticket_size_ = -1;
   const uint8_t* tls_ticket_ = nullptr;
 };
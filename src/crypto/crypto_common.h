@@ -13,11 +13,6 @@
 namespace node {
 namespace crypto {
 
-struct StackOfX509Deleter {
-  void operator()(STACK_OF(X509)* p) const { sk_X509_pop_free(p, X509_free); }
-};
-using StackOfX509 = std::unique_ptr<STACK_OF(X509), StackOfX509Deleter>;
-
 struct StackOfXASN1Deleter {
   void operator()(STACK_OF(ASN1_OBJECT)* p) const {
     sk_ASN1_OBJECT_pop_free(p, ASN1_OBJECT_free);
@@ -1,6 +1,8 @@
 #include "crypto/crypto_context.h"
 #include "crypto/crypto_bio.h"
 #include "crypto/crypto_common.h"
+#include "crypto/crypto_session_cache.h"
+#include "crypto/crypto_tls.h"
 #include "crypto/crypto_util.h"
 #include "base_object-inl.h"
 #include "env-inl.h"
@@ -11,6 +13,8 @@
 #include "util.h"
 #include "v8.h"
 
+#include <openssl/asn1.h>
+#include <openssl/async.h>
 #include <openssl/x509.h>
 #include <openssl/pkcs12.h>
 #include <openssl/rand.h>
@@ -18,6 +22,8 @@
 #include <openssl/engine.h>
 #endif  // !OPENSSL_NO_ENGINE
 
+#include <unordered_map>
+
 namespace node {
 
 using v8::Array;
@@ -133,84 +139,150 @@ int SSL_CTX_use_certificate_chain(SSL_CTX* ctx,
   return ret;
 }
 
-// Read a file that contains our certificate in "PEM" format,
-// possibly followed by a sequence of CA certificates that should be
-// sent to the peer in the Certificate message.
-//
-// Taken from OpenSSL - edited for style.
-int SSL_CTX_use_certificate_chain(SSL_CTX* ctx,
-                                  BIOPointer&& in,
-                                  X509Pointer* cert,
-                                  X509Pointer* issuer) {
-  // Just to ensure that `ERR_peek_last_error` below will return only errors
-  // that we are interested in
-  ERR_clear_error();
+// Like LoadBIO(), but keeps the data so that it can be looked up in the
+// PEMCache.
+bool LoadPEM(Environment* env, Local<Value> v, ByteSource* pem) {
+  if (v->IsString()) {
+    *pem = ByteSource::FromString(env, v.As<String>());
+    return true;
+  }
 
-  X509Pointer x(
-      PEM_read_bio_X509_AUX(in.get(), nullptr, NoPasswordCallback, nullptr));
+  if (v->IsArrayBufferView()) {
+    *pem = ByteSource::FromBuffer(v);
+    return true;
+  }
 
-  if (!x)
-    return 0;
+  return false;
+}
 
-  unsigned long err = 0;  // NOLINT(runtime/int)
+#if OPENSSL_VERSION_MAJOR >= 3
+using LookupName = const X509_NAME*;
+#else
+using LookupName = X509_NAME*;
+#endif
 
-  StackOfX509 extra_certs(sk_X509_new_null());
-  if (!extra_certs)
-    return 0;
+// The built-in root certificates are only parsed once a certificate store
+// looks up a certificate with their subject. To find them, the subjects are
+// indexed on the first lookup, which only decodes the subject names and
+// not, in particular, the public keys. Parsed certificates are shared by
+// all stores in the process and never freed.
+class RootCertificates {
+ public:
+  // Adds the built-in root certificates with the subject `name` to `store`
+  // and returns one of them, or returns nullptr if there are none.
+  static X509* AddToStore(X509_STORE* store, LookupName name) {
+    static RootCertificates* root_certificates = new RootCertificates();
+    return root_certificates->AddToStoreImpl(store, name);
+  }
 
-  while (X509Pointer extra {PEM_read_bio_X509(in.get(),
-                                    nullptr,
-                                    NoPasswordCallback,
-                                    nullptr)}) {
-    if (sk_X509_push(extra_certs.get(), extra.get())) {
-      extra.release();
-      continue;
+ private:
+  X509* AddToStoreImpl(X509_STORE* store, LookupName name) {
+    Mutex::ScopedLock lock(mutex_);
+    if (index_.empty()) {
+      for (size_t i = 0; i < arraysize(root_certs); i++)
+        index_.emplace(X509_NAME_hash(ParseSubject(i).get()), i);
     }
 
-    return 0;
+    X509* found = nullptr;
+    auto range = index_.equal_range(
+        X509_NAME_hash(const_cast<X509_NAME*>(name)));
+    for (auto it = range.first; it != range.second; ++it) {
+      X509Pointer& cert = certs_[it->second];
+      if (!cert) {
+        cert.reset(PEM_read_bio_X509(
+            NodeBIO::NewFixed(root_certs[it->second],
+                              strlen(root_certs[it->second])).get(),
+            nullptr,   // no re-use of X509 structure
+            NoPasswordCallback,
+            nullptr));  // no callback data
+        // Parse errors from the built-in roots are fatal.
+        CHECK(cert);
+      }
+      if (X509_NAME_cmp(X509_get_subject_name(cert.get()), name) != 0)
+        continue;
+      X509_STORE_add_cert(store, cert.get());
+      found = cert.get();
+    }
+    return found;
   }
 
-  // When the while loop ends, it's usually just EOF.
-  err = ERR_peek_last_error();
-  if (ERR_GET_LIB(err) == ERR_LIB_PEM &&
-      ERR_GET_REASON(err) == PEM_R_NO_START_LINE) {
-    ERR_clear_error();
-  } else {
-    // some real error
-    return 0;
+  // Certificate ::= SEQUENCE {
+  //   tbsCertificate SEQUENCE {
+  //     version [0] EXPLICIT Version DEFAULT v1,
+  //     serialNumber, signature, issuer, validity, subject, ... } ... }
+  static X509NamePointer ParseSubject(size_t i) {
+    char* pem_name;
+    char* pem_header;
+    unsigned char* der;
+    long der_length;  // NOLINT(runtime/int)
+    BIOPointer bio = NodeBIO::NewFixed(root_certs[i], strlen(root_certs[i]));
+    CHECK(PEM_read_bio(bio.get(), &pem_name, &pem_header, &der, &der_length));
+    OPENSSL_free(pem_name);
+    OPENSSL_free(pem_header);
+
+    const unsigned char* p = der;
+    const unsigned char* end = der + der_length;
+    long length;  // NOLINT(runtime/int)
+    int tag;
+    int xclass;
+    // Enter the two SEQUENCEs.
+    for (int j = 0; j < 2; j++) {
+      CHECK_EQ(ASN1_get_object(&p, &length, &tag, &xclass, end - p),
+               V_ASN1_CONSTRUCTED);
+      CHECK_EQ(tag, V_ASN1_SEQUENCE);
+    }
+    // Skip the version, if present, and the four fields before the subject.
+    for (int j = 0; j < 5; j++) {
+      const unsigned char* q = p;
+      CHECK_EQ(ASN1_get_object(&q, &length, &tag, &xclass, end - p) & 0x80,
+               0);
+      if (j == 0 && xclass != V_ASN1_CONTEXT_SPECIFIC)
+        continue;
+      p = q + length;
+    }
+    X509NamePointer subject(d2i_X509_NAME(nullptr, &p, end - p));
+    CHECK(subject);
+    OPENSSL_free(der);
+    return subject;
   }
 
-  return SSL_CTX_use_certificate_chain(ctx,
-                                       std::move(x),
-                                       extra_certs.get(),
-                                       cert,
-                                       issuer);
+  Mutex mutex_;
+  // Subject name hash -> index into root_certs.
+  std::unordered_multimap<unsigned long, size_t> index_;  // NOLINT
+  X509Pointer certs_[arraysize(root_certs)];
+};
+
+int GetRootCertBySubject(X509_LOOKUP* lookup,
+                         X509_LOOKUP_TYPE type,
+                         LookupName name,
+                         X509_OBJECT* ret) {
+  if (type != X509_LU_X509)
+    return 0;
+  X509* cert = RootCertificates::AddToStore(X509_LOOKUP_get_store(lookup),
+                                            name);
+  if (cert == nullptr || !X509_OBJECT_set1_X509(ret, cert))
+    return 0;
+  // Like the lookups OpenSSL implements, hand out the reference held by
+  // the store. X509_STORE_CTX_get_by_subject() takes its own.
+  X509_free(cert);
+  return 1;
+}
+
+X509_LOOKUP_METHOD* GetRootCertLookupMethod() {
+  // Intentionally leaked, stores using it may outlive any Environment.
+  static X509_LOOKUP_METHOD* method = []() {
+    X509_LOOKUP_METHOD* method =
+        X509_LOOKUP_meth_new("node built-in root certificates");
+    CHECK_NOT_NULL(method);
+    X509_LOOKUP_meth_set_get_by_subject(method, GetRootCertBySubject);
+    return method;
+  }();
+  return method;
 }
 
 }  // namespace
 
 X509_STORE* NewRootCertStore() {
-  static std::vector<X509*> root_certs_vector;
-  static Mutex root_certs_vector_mutex;
-  Mutex::ScopedLock lock(root_certs_vector_mutex);
-
-  if (root_certs_vector.empty() &&
-      per_process::cli_options->ssl_openssl_cert_store == false) {
-    for (size_t i = 0; i < arraysize(root_certs); i++) {
-      X509* x509 =
-          PEM_read_bio_X509(NodeBIO::NewFixed(root_certs[i],
-                                              strlen(root_certs[i])).get(),
-                            nullptr,   // no re-use of X509 structure
-                            NoPasswordCallback,
-                            nullptr);  // no callback data
-
-      // Parse errors from the built-in roots are fatal.
-      CHECK_NOT_NULL(x509);
-
-      root_certs_vector.push_back(x509);
-    }
-  }
-
   X509_STORE* store = X509_STORE_new();
   if (*system_cert_path != '\0') {
     ERR_set_mark();
@@ -222,10 +294,7 @@ X509_STORE* NewRootCertStore() {
   if (per_process::cli_options->ssl_openssl_cert_store) {
     X509_STORE_set_default_paths(store);
   } else {
-    for (X509* cert : root_certs_vector) {
-      X509_up_ref(cert);
-      X509_STORE_add_cert(store, cert);
-    }
+    CHECK_NOT_NULL(X509_STORE_add_lookup(store, GetRootCertLookupMethod()));
   }
 
   return store;
@@ -286,6 +355,12 @@ Local<FunctionTemplate> SecureContext::GetConstructorTemplate(
     env->SetProtoMethod(tmpl, "setFreeListLength", SetFreeListLength);
     env->SetProtoMethod(tmpl, "enableTicketKeyCallback",
         EnableTicketKeyCallback);
+    env->SetProtoMethod(tmpl, "enableSharedSessionCache",
+        EnableSharedSessionCache);
+    env->SetProtoMethod(tmpl, "enableSharedTicketKeys",
+        EnableSharedTicketKeys);
+    env->SetProtoMethod(tmpl, "enableAsyncPrivateKey",
+        EnableAsyncPrivateKey);
 
     env->SetProtoMethodNoSideEffect(tmpl, "getTicketKeys", GetTicketKeys);
     env->SetProtoMethodNoSideEffect(tmpl, "getCertificate",
@@ -365,6 +440,9 @@ void SecureContext::RegisterExternalReferences(
   registry->Register(SetTicketKeys);
   registry->Register(SetFreeListLength);
   registry->Register(EnableTicketKeyCallback);
+  registry->Register(EnableSharedSessionCache);
+  registry->Register(EnableSharedTicketKeys);
+  registry->Register(EnableAsyncPrivateKey);
   registry->Register(GetTicketKeys);
   registry->Register(GetCertificate<true>);
   registry->Register(GetCertificate<false>);
@@ -395,6 +473,7 @@ SecureContext::SecureContext(Environment* env, Local<Object> wrap)
     : BaseObject(env, wrap) {
   MakeWeak();
   env->isolate()->AdjustAmountOfExternalAllocatedMemory(kExternalSize);
+  native_memory::Track(native_memory::kTls, kExternalSize);
 }
 
 inline void SecureContext::Reset() {
@@ -404,10 +483,15 @@ inline void SecureContext::Reset() {
   ctx_.reset();
   cert_.reset();
   issuer_.reset();
+  cert_chain_.reset();
+  private_key_.reset();
+  ca_certs_.clear();
+  cert_store_.reset();
 }
 
 SecureContext::~SecureContext() {
   Reset();
+  native_memory::Track(native_memory::kTls, -kExternalSize);
 }
 
 void SecureContext::New(const FunctionCallbackInfo<Value>& args) {
@@ -575,29 +659,25 @@ void SecureContext::SetKey(const FunctionCallbackInfo<Value>& args) {
 
   CHECK_GE(args.Length(), 1);  // Private key argument is mandatory
 
-  BIOPointer bio(LoadBIO(env, args[0]));
-  if (!bio)
+  ByteSource pem;
+  if (!LoadPEM(env, args[0], &pem))
     return;
 
   ByteSource passphrase;
   if (args[1]->IsString())
     passphrase = ByteSource::FromString(env, args[1].As<String>());
-  // This redirection is necessary because the PasswordCallback expects a
-  // pointer to a pointer to the passphrase ByteSource to allow passing in
-  // const ByteSources.
-  const ByteSource* pass_ptr = &passphrase;
 
-  EVPKeyPointer key(
-      PEM_read_bio_PrivateKey(bio.get(),
-                              nullptr,
-                              PasswordCallback,
-                              &pass_ptr));
+  std::shared_ptr<const PEMCache::PrivateKey> key =
+      PEMCache::GetInstance()->GetPrivateKey(pem.get(), pem.size(),
+                                             passphrase);
 
   if (!key)
     return ThrowCryptoError(env, ERR_get_error(), "PEM_read_bio_PrivateKey");
 
-  if (!SSL_CTX_use_PrivateKey(sc->ctx_.get(), key.get()))
+  if (!SSL_CTX_use_PrivateKey(sc->ctx_.get(), key->pkey.get()))
     return ThrowCryptoError(env, ERR_get_error(), "SSL_CTX_use_PrivateKey");
+
+  sc->private_key_ = std::move(key);
 }
 
 void SecureContext::SetSigalgs(const FunctionCallbackInfo<Value>& args) {
@@ -663,23 +743,36 @@ void SecureContext::SetCert(const FunctionCallbackInfo<Value>& args) {
 
   CHECK_GE(args.Length(), 1);  // Certificate argument is mandator
 
-  BIOPointer bio(LoadBIO(env, args[0]));
-  if (!bio)
+  ByteSource pem;
+  if (!LoadPEM(env, args[0], &pem))
     return;
 
   sc->cert_.reset();
   sc->issuer_.reset();
 
-  if (!SSL_CTX_use_certificate_chain(
-          sc->ctx_.get(),
-          std::move(bio),
-          &sc->cert_,
-          &sc->issuer_)) {
+  std::shared_ptr<const PEMCache::CertChain> chain =
+      PEMCache::GetInstance()->GetCertChain(pem.get(), pem.size());
+  if (chain) {
+    X509_up_ref(chain->cert.get());
+    X509Pointer cert(chain->cert.get());
+    if (!SSL_CTX_use_certificate_chain(
+            sc->ctx_.get(),
+            std::move(cert),
+            chain->extra_certs.get(),
+            &sc->cert_,
+            &sc->issuer_)) {
+      chain.reset();
+    }
+  }
+
+  if (!chain) {
     return ThrowCryptoError(
         env,
         ERR_get_error(),
         "SSL_CTX_use_certificate_chain");
   }
+
+  sc->cert_chain_ = std::move(chain);
 }
 
 void SecureContext::AddCACert(const FunctionCallbackInfo<Value>& args) {
@@ -691,21 +784,35 @@ void SecureContext::AddCACert(const FunctionCallbackInfo<Value>& args) {
 
   CHECK_GE(args.Length(), 1);  // CA certificate argument is mandatory
 
-  BIOPointer bio(LoadBIO(env, args[0]));
-  if (!bio)
+  ByteSource pem;
+  if (!LoadPEM(env, args[0], &pem))
     return;
 
-  X509_STORE* cert_store = SSL_CTX_get_cert_store(sc->ctx_.get());
-  while (X509* x509 = PEM_read_bio_X509_AUX(
-      bio.get(), nullptr, NoPasswordCallback, nullptr)) {
-    if (cert_store == root_cert_store) {
-      cert_store = NewRootCertStore();
-      SSL_CTX_set_cert_store(sc->ctx_.get(), cert_store);
-    }
-    X509_STORE_add_cert(cert_store, x509);
-    SSL_CTX_add_client_CA(sc->ctx_.get(), x509);
-    X509_free(x509);
+  std::shared_ptr<const PEMCache::CertList> certs =
+      PEMCache::GetInstance()->GetCertList(pem.get(), pem.size());
+  if (!certs || certs->certs.empty())
+    return;
+
+  for (const X509Pointer& x509 : certs->certs)
+    SSL_CTX_add_client_CA(sc->ctx_.get(), x509.get());
+
+  if (sc->private_cert_store_) {
+    X509_STORE* cert_store = SSL_CTX_get_cert_store(sc->ctx_.get());
+    for (const X509Pointer& x509 : certs->certs)
+      X509_STORE_add_cert(cert_store, x509.get());
+    return;
   }
+
+  // Contexts that were given the same CA certificates in the same order
+  // share one store, which is never changed once built.
+  sc->ca_certs_.push_back(certs);
+  sc->cert_store_key_ = PEMCache::NextCertStoreKey(sc->cert_store_key_,
+                                                   *certs);
+  sc->cert_store_ = PEMCache::GetInstance()->GetCertStore(
+      sc->cert_store_key_, [sc]() { return sc->NewCertStore(); });
+  CHECK(sc->cert_store_);
+  X509_STORE_up_ref(sc->cert_store_->store.get());
+  SSL_CTX_set_cert_store(sc->ctx_.get(), sc->cert_store_->store.get());
 }
 
 void SecureContext::AddCRL(const FunctionCallbackInfo<Value>& args) {
@@ -728,12 +835,7 @@ void SecureContext::AddCRL(const FunctionCallbackInfo<Value>& args) {
   if (!crl)
     return THROW_ERR_CRYPTO_OPERATION_FAILED(env, "Failed to parse CRL");
 
-  X509_STORE* cert_store = SSL_CTX_get_cert_store(sc->ctx_.get());
-  if (cert_store == root_cert_store) {
-    cert_store = NewRootCertStore();
-    SSL_CTX_set_cert_store(sc->ctx_.get(), cert_store);
-  }
-
+  X509_STORE* cert_store = sc->GetPrivateCertStore();
   X509_STORE_add_crl(cert_store, crl.get());
   X509_STORE_set_flags(cert_store,
                        X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL);
@@ -751,6 +853,34 @@ void SecureContext::AddRootCerts(const FunctionCallbackInfo<Value>& args) {
   // Increment reference count so global store is not deleted along with CTX.
   X509_STORE_up_ref(root_cert_store);
   SSL_CTX_set_cert_store(sc->ctx_.get(), root_cert_store);
+
+  sc->ca_certs_.clear();
+  sc->cert_store_.reset();
+  sc->cert_store_key_ = "root";
+  sc->cert_store_has_roots_ = true;
+  sc->private_cert_store_ = false;
+}
+
+X509StorePointer SecureContext::NewCertStore() const {
+  X509StorePointer store(cert_store_has_roots_ ? NewRootCertStore()
+                                               : X509_STORE_new());
+  CHECK(store);
+  for (const auto& certs : ca_certs_) {
+    for (const X509Pointer& x509 : certs->certs)
+      X509_STORE_add_cert(store.get(), x509.get());
+  }
+  return store;
+}
+
+X509_STORE* SecureContext::GetPrivateCertStore() {
+  X509_STORE* cert_store = SSL_CTX_get_cert_store(ctx_.get());
+  if (cert_store == root_cert_store || cert_store_) {
+    cert_store = NewCertStore().release();
+    SSL_CTX_set_cert_store(ctx_.get(), cert_store);
+    cert_store_.reset();
+  }
+  private_cert_store_ = true;
+  return cert_store;
 }
 
 void SecureContext::SetCipherSuites(const FunctionCallbackInfo<Value>& args) {
@@ -994,8 +1124,6 @@ void SecureContext::LoadPKCS12(const FunctionCallbackInfo<Value>& args) {
   sc->issuer_.reset();
   sc->cert_.reset();
 
-  X509_STORE* cert_store = SSL_CTX_get_cert_store(sc->ctx_.get());
-
   DeleteFnPtr<PKCS12, PKCS12_free> p12;
   EVPKeyPointer pkey;
   X509Pointer cert;
@@ -1023,11 +1151,7 @@ void SecureContext::LoadPKCS12(const FunctionCallbackInfo<Value>& args) {
     for (int i = 0; i < sk_X509_num(extra_certs.get()); i++) {
       X509* ca = sk_X509_value(extra_certs.get(), i);
 
-      if (cert_store == root_cert_store) {
-        cert_store = NewRootCertStore();
-        SSL_CTX_set_cert_store(sc->ctx_.get(), cert_store);
-      }
-      X509_STORE_add_cert(cert_store, ca);
+      X509_STORE_add_cert(sc->GetPrivateCertStore(), ca);
       SSL_CTX_add_client_CA(sc->ctx_.get(), ca);
     }
     ret = true;
@@ -1265,6 +1389,95 @@ int SecureContext::TicketCompatibilityCallback(SSL* ssl,
   return 1;
 }
 
+// Stores this context's server sessions in the process-wide cache, where
+// contexts in other threads can find them. See NewSessionCallback() and
+// GetSessionCallback() in crypto_tls.cc.
+void SecureContext::EnableSharedSessionCache(
+    const FunctionCallbackInfo<Value>& args) {
+  SecureContext* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+
+  wrap->shared_session_cache_ = true;
+  SSL_CTX_sess_set_remove_cb(wrap->ctx_.get(), RemoveSharedSessionCallback);
+}
+
+// Encrypts session tickets with the process-wide ticket keys, so that any
+// context using them can decrypt them.
+void SecureContext::EnableSharedTicketKeys(
+    const FunctionCallbackInfo<Value>& args) {
+  SecureContext* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+
+  SSL_CTX_set_tlsext_ticket_key_cb(wrap->ctx_.get(), SharedTicketKeyCallback);
+}
+
+// Moves the signing and decryption with the context's private key off the
+// event loop, see TLSWrap::NewAsyncPrivateKey(). Must be called after the
+// key is set, and returns false if it is not an RSA or EC key or if OpenSSL
+// cannot suspend handshakes on this platform.
+void SecureContext::EnableAsyncPrivateKey(
+    const FunctionCallbackInfo<Value>& args) {
+  SecureContext* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  ClearErrorOnReturn clear_error_on_return;
+
+  EVP_PKEY* pkey = SSL_CTX_get0_privatekey(wrap->ctx_.get());
+  if (pkey == nullptr || !ASYNC_is_capable())
+    return args.GetReturnValue().Set(false);
+
+  EVPKeyPointer key = TLSWrap::NewAsyncPrivateKey(pkey);
+  if (!key || !SSL_CTX_use_PrivateKey(wrap->ctx_.get(), key.get()))
+    return args.GetReturnValue().Set(false);
+
+  SSL_CTX_set_mode(wrap->ctx_.get(), SSL_MODE_ASYNC);
+  args.GetReturnValue().Set(true);
+}
+
+void SecureContext::RemoveSharedSessionCallback(SSL_CTX* ctx,
+                                                SSL_SESSION* sess) {
+  unsigned int id_length;
+  const unsigned char* id = SSL_SESSION_get_id(sess, &id_length);
+  SharedSessionCache::GetInstance()->Remove(id, id_length);
+}
+
+int SecureContext::SharedTicketKeyCallback(SSL* ssl,
+                                           unsigned char* name,
+                                           unsigned char* iv,
+                                           EVP_CIPHER_CTX* ectx,
+                                           HMAC_CTX* hctx,
+                                           int enc) {
+  SharedSessionCache* cache = SharedSessionCache::GetInstance();
+  SharedSessionCache::TicketKeys keys;
+  int ret = 1;
+
+  if (enc) {
+    keys = cache->GetTicketKeys();
+    memcpy(name, keys.name, sizeof(keys.name));
+    if (RAND_bytes(iv, 16) <= 0 ||
+        EVP_EncryptInit_ex(ectx, EVP_aes_128_cbc(), nullptr,
+                           keys.aes, iv) <= 0 ||
+        HMAC_Init_ex(hctx, keys.hmac, sizeof(keys.hmac),
+                     EVP_sha256(), nullptr) <= 0) {
+      ret = -1;
+    }
+  } else {
+    bool current;
+    if (!cache->FindTicketKeys(name, &keys, &current))
+      return 0;  // Unknown or expired keys, discard the ticket.
+    // A return value of 2 makes OpenSSL issue a ticket with the new keys.
+    ret = current ? 1 : 2;
+    if (EVP_DecryptInit_ex(ectx, EVP_aes_128_cbc(), nullptr,
+                           keys.aes, iv) <= 0 ||
+        HMAC_Init_ex(hctx, keys.hmac, sizeof(keys.hmac),
+                     EVP_sha256(), nullptr) <= 0) {
+      ret = -1;
+    }
+  }
+
+  OPENSSL_cleanse(&keys, sizeof(keys));
+  return ret;
+}
+
 void SecureContext::CtxGetter(const FunctionCallbackInfo<Value>& info) {
   SecureContext* sc;
   ASSIGN_OR_RETURN_UNWRAP(&sc, info.This());
@@ -3,6 +3,7 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include "crypto/crypto_pem_cache.h"
 #include "crypto/crypto_util.h"
 #include "base_object.h"
 #include "env.h"
@@ -52,6 +53,9 @@ class SecureContext final : public BaseObject {
   void SetNewSessionCallback(NewSessionCb cb);
   void SetSelectSNIContextCallback(SelectSNIContextCb cb);
 
+  // Whether sessions go to the process-wide SharedSessionCache.
+  bool has_shared_session_cache() const { return shared_session_cache_; }
+
   // TODO(joyeecheung): track the memory used by OpenSSL types
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(SecureContext)
@@ -60,6 +64,19 @@ class SecureContext final : public BaseObject {
   SSLCtxPointer ctx_;
   X509Pointer cert_;
   X509Pointer issuer_;
+
+  // The PEMCache entries this context was configured with. Holding on to
+  // them keeps them cached for other contexts.
+  std::shared_ptr<const PEMCache::CertChain> cert_chain_;
+  std::shared_ptr<const PEMCache::PrivateKey> private_key_;
+  std::vector<std::shared_ptr<const PEMCache::CertList>> ca_certs_;
+  std::shared_ptr<const PEMCache::CertStore> cert_store_;
+  // Identifies the certificate store, see AddCACert().
+  PEMCache::Key cert_store_key_;
+  // Whether the store was built on top of the root certificates.
+  bool cert_store_has_roots_ = false;
+  // Set once the store has been changed in ways the cache does not track.
+  bool private_cert_store_ = false;
 #ifndef OPENSSL_NO_ENGINE
   bool client_cert_engine_provided_ = false;
   EnginePointer private_key_engine_;
@@ -82,6 +99,13 @@ class SecureContext final : public BaseObject {
   // OpenSSL structures are opaque. This is sizeof(SSL_CTX) for OpenSSL 1.1.1b:
   static const int64_t kExternalSize = 1024;
 
+  // Builds the certificate store from the root certificates, if used, and
+  // the CA certificates, without anything the cache does not track.
+  X509StorePointer NewCertStore() const;
+  // Returns the certificate store for changes the cache does not track,
+  // after replacing it with a copy if it is shared with other contexts.
+  X509_STORE* GetPrivateCertStore();
+
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Init(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetKey(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -118,6 +142,12 @@ class SecureContext final : public BaseObject {
       const v8::FunctionCallbackInfo<v8::Value>& args);
   static void EnableTicketKeyCallback(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableSharedSessionCache(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableSharedTicketKeys(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableAsyncPrivateKey(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
   static void CtxGetter(const v8::FunctionCallbackInfo<v8::Value>& info);
 
   template <bool primary>
@@ -137,6 +167,17 @@ class SecureContext final : public BaseObject {
                                          HMAC_CTX* hctx,
                                          int enc);
 
+  static int SharedTicketKeyCallback(SSL* ssl,
+                                     unsigned char* name,
+                                     unsigned char* iv,
+                                     EVP_CIPHER_CTX* ectx,
+                                     HMAC_CTX* hctx,
+                                     int enc);
+
+  static void RemoveSharedSessionCallback(SSL_CTX* ctx, SSL_SESSION* sess);
+
+  bool shared_session_cache_ = false;
+
   SecureContext(Environment* env, v8::Local<v8::Object> wrap);
   void Reset();
 };
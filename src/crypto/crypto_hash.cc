@@ -9,18 +9,23 @@
 #include "v8.h"
 
 #include <cstdio>
+#include <string>
 
 namespace node {
 
+using v8::Context;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::HandleScope;
 using v8::Just;
 using v8::Local;
 using v8::Maybe;
 using v8::MaybeLocal;
 using v8::Nothing;
 using v8::Object;
+using v8::String;
 using v8::Uint32;
+using v8::Undefined;
 using v8::Value;
 
 namespace crypto {
@@ -53,8 +58,10 @@ void Hash::Initialize(Environment* env, Local<Object> target) {
   env->SetConstructorFunction(target, "Hash", t);
 
   env->SetMethodNoSideEffect(target, "getHashes", GetHashes);
+  env->SetMethodNoSideEffect(target, "oneShotDigest", OneShotDigest);
 
   HashJob::Initialize(env, target);
+  HashStream::Initialize(env, target);
 }
 
 void Hash::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
@@ -62,8 +69,61 @@ void Hash::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(HashUpdate);
   registry->Register(HashDigest);
   registry->Register(GetHashes);
+  registry->Register(OneShotDigest);
 
   HashJob::RegisterExternalReferences(registry);
+  HashStream::RegisterExternalReferences(registry);
+}
+
+// oneShotDigest(algorithm, data, inputEncoding, outputEncoding) hashes a
+// string or buffer in a single call, without creating a Hash object. The
+// digest context is reused by subsequent calls on the same thread.
+void Hash::OneShotDigest(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsString());
+
+  const Utf8Value hash_type(env->isolate(), args[0]);
+  const EVP_MD* md = GetDigestByName(*hash_type);
+  if (md == nullptr)
+    return THROW_ERR_CRYPTO_INVALID_DIGEST(env, "Invalid digest: %s",
+                                           *hash_type);
+
+  static thread_local EVPMDPointer mdctx(EVP_MD_CTX_new());
+  if (!mdctx || EVP_DigestInit_ex(mdctx.get(), md, nullptr) <= 0)
+    return ThrowCryptoError(env, ERR_get_error(), "Digest init error");
+
+  if (args[1]->IsString()) {
+    StringBytes::InlineDecoder decoder;
+    enum encoding enc = ParseEncoding(env->isolate(), args[2], UTF8);
+    if (decoder.Decode(env, args[1].As<String>(), enc).IsNothing())
+      return;
+    EVP_DigestUpdate(mdctx.get(), decoder.out(), decoder.size());
+  } else {
+    ArrayBufferOrViewContents<char> data(args[1]);
+    if (UNLIKELY(!data.CheckSizeInt32()))
+      return THROW_ERR_OUT_OF_RANGE(env, "data is too big");
+    EVP_DigestUpdate(mdctx.get(), data.data(), data.size());
+  }
+
+  unsigned char md_value[EVP_MAX_MD_SIZE];
+  unsigned int md_len = 0;
+  if (EVP_DigestFinal_ex(mdctx.get(), md_value, &md_len) != 1)
+    return ThrowCryptoError(env, ERR_get_error());
+
+  enum encoding encoding = ParseEncoding(env->isolate(), args[3], BUFFER);
+  Local<Value> error;
+  MaybeLocal<Value> rc =
+      StringBytes::Encode(env->isolate(),
+                          reinterpret_cast<const char*>(md_value),
+                          md_len,
+                          encoding,
+                          &error);
+  if (rc.IsEmpty()) {
+    CHECK(!error.IsEmpty());
+    env->isolate()->ThrowException(error);
+    return;
+  }
+  args.GetReturnValue().Set(rc.FromMaybe(Local<Value>()));
 }
 
 void Hash::New(const FunctionCallbackInfo<Value>& args) {
@@ -77,7 +137,7 @@ void Hash::New(const FunctionCallbackInfo<Value>& args) {
     md = EVP_MD_CTX_md(orig->mdctx_.get());
   } else {
     const Utf8Value hash_type(env->isolate(), args[0]);
-    md = EVP_get_digestbyname(*hash_type);
+    md = GetDigestByName(*hash_type);
   }
 
   Maybe<unsigned int> xof_md_len = Nothing<unsigned int>();
@@ -202,6 +262,208 @@ void Hash::HashDigest(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(rc.FromMaybe(Local<Value>()));
 }
 
+HashStream::HashStream(Environment* env,
+                       Local<Object> wrap,
+                       EVPMDPointer&& mdctx,
+                       unsigned int md_len,
+                       size_t high_water_mark)
+    : AsyncWrap(env, wrap, AsyncWrap::PROVIDER_HASHSTREAM),
+      ThreadPoolWork(env),
+      mdctx_(std::move(mdctx)),
+      md_len_(md_len),
+      high_water_mark_(high_water_mark) {
+  MakeWeak();
+}
+
+void HashStream::Initialize(Environment* env, Local<Object> target) {
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      AsyncWrap::kInternalFieldCount);
+
+  env->SetProtoMethod(t, "update", Update);
+  env->SetProtoMethod(t, "digest", Digest);
+
+  env->SetConstructorFunction(target, "HashStream", t);
+}
+
+void HashStream::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Update);
+  registry->Register(Digest);
+}
+
+void HashStream::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("mdctx", mdctx_ ? kSizeOf_EVP_MD_CTX : 0);
+  tracker->TrackFieldWithSize("queued", queued_bytes_);
+  tracker->TrackFieldWithSize("md", digest_ ? md_len_ : 0);
+}
+
+// new HashStream(algorithm[, highWaterMark])
+void HashStream::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsString());
+
+  const Utf8Value hash_type(env->isolate(), args[0]);
+  const EVP_MD* md = GetDigestByName(*hash_type);
+  if (md == nullptr)
+    return THROW_ERR_CRYPTO_INVALID_DIGEST(env, "Invalid digest: %s",
+                                           *hash_type);
+
+  size_t high_water_mark = kDefaultHighWaterMark;
+  if (args[1]->IsUint32())
+    high_water_mark = args[1].As<Uint32>()->Value();
+
+  EVPMDPointer mdctx(EVP_MD_CTX_new());
+  if (!mdctx || EVP_DigestInit_ex(mdctx.get(), md, nullptr) <= 0) {
+    return ThrowCryptoError(env, ERR_get_error(),
+                            "Digest method not supported");
+  }
+
+  new HashStream(env,
+                 args.This(),
+                 std::move(mdctx),
+                 EVP_MD_size(md),
+                 high_water_mark);
+}
+
+// update(data[, inputEncoding]) returns false if the caller should wait for
+// `ondrain` before queueing more data.
+void HashStream::Update(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  HashStream* hash;
+  ASSIGN_OR_RETURN_UNWRAP(&hash, args.Holder());
+  if (hash->digest_requested_)
+    return args.GetReturnValue().Set(false);
+
+  ByteSource chunk;
+  if (args[0]->IsString()) {
+    enum encoding enc = ParseEncoding(env->isolate(), args[1], UTF8);
+    chunk = ByteSource::FromEncodedString(env, args[0].As<String>(), enc);
+  } else {
+    ArrayBufferOrViewContents<char> data(args[0]);
+    chunk = data.ToCopy();
+  }
+
+  if (chunk.size() > 0) {
+    hash->queued_bytes_ += chunk.size();
+    hash->pending_.emplace_back(std::move(chunk));
+    hash->MaybeScheduleWork();
+  }
+
+  bool below = hash->queued_bytes_ < hash->high_water_mark_;
+  if (!below)
+    hash->need_drain_ = true;
+  args.GetReturnValue().Set(below);
+}
+
+// digest([outputEncoding])
+void HashStream::Digest(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  HashStream* hash;
+  ASSIGN_OR_RETURN_UNWRAP(&hash, args.Holder());
+  CHECK(!hash->digest_requested_);
+
+  hash->digest_requested_ = true;
+  hash->digest_encoding_ = ParseEncoding(env->isolate(), args[0], BUFFER);
+  hash->MaybeScheduleWork();
+}
+
+void HashStream::MaybeScheduleWork() {
+  if (scheduled_)
+    return;
+  if (failed_) {
+    // Chunks queued after an error are dropped, digest() reports it.
+    pending_.clear();
+    queued_bytes_ = 0;
+  }
+  if (pending_.empty() && !digest_requested_)
+    return;
+  CHECK(in_flight_.empty());
+  std::swap(pending_, in_flight_);
+  finalizing_ = digest_requested_;
+  scheduled_ = true;
+  // Keep the object alive while the thread pool may use it.
+  ClearWeak();
+  ScheduleWork();
+}
+
+void HashStream::DoThreadPoolWork() {
+  if (failed_)
+    return;
+  for (const ByteSource& chunk : in_flight_) {
+    if (EVP_DigestUpdate(mdctx_.get(), chunk.get(), chunk.size()) <= 0) {
+      failed_ = true;
+      errors_.Capture();
+      return;
+    }
+  }
+
+  // TODO(tniessen): SHA3_squeeze does not work for zero-length outputs on all
+  // platforms, see Hash::HashDigest().
+  if (!finalizing_ || md_len_ == 0)
+    return;
+
+  char* md_value = MallocOpenSSL<char>(md_len_);
+  ByteSource digest = ByteSource::Allocated(md_value, md_len_);
+  unsigned int len = md_len_;
+  if (EVP_DigestFinal_ex(mdctx_.get(),
+                         reinterpret_cast<unsigned char*>(md_value),
+                         &len) != 1) {
+    failed_ = true;
+    errors_.Capture();
+    return;
+  }
+  CHECK_EQ(len, md_len_);
+  digest_ = std::move(digest);
+}
+
+void HashStream::AfterThreadPoolWork(int status) {
+  Environment* env = AsyncWrap::env();
+  CHECK(status == 0 || status == UV_ECANCELED);
+
+  for (const ByteSource& chunk : in_flight_)
+    queued_bytes_ -= chunk.size();
+  in_flight_.clear();
+  scheduled_ = false;
+  MakeWeak();
+
+  if (status == UV_ECANCELED || !env->can_call_into_js())
+    return;
+
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  if (finalizing_) {
+    Local<Value> argv[2] = { Undefined(env->isolate()),
+                             Undefined(env->isolate()) };
+    if (failed_) {
+      if (!errors_.ToException(env).ToLocal(&argv[0]))
+        return;
+    } else {
+      Local<Value> error;
+      if (!StringBytes::Encode(env->isolate(),
+                               digest_.get(),
+                               md_len_,
+                               digest_encoding_,
+                               &error).ToLocal(&argv[1])) {
+        CHECK(!error.IsEmpty());
+        argv[0] = error;
+      }
+    }
+    MakeCallback(env->ondone_string(), arraysize(argv), argv);
+    return;
+  }
+
+  MaybeScheduleWork();
+  if (need_drain_ && queued_bytes_ < high_water_mark_) {
+    need_drain_ = false;
+    MakeCallback(env->ondrain_string(), 0, nullptr);
+  }
+}
+
 HashConfig::HashConfig(HashConfig&& other) noexcept
     : mode(other.mode),
       in(std::move(other.in)),
@@ -240,7 +502,7 @@ Maybe<bool> HashTraits::AdditionalConfig(
 
   CHECK(args[offset]->IsString());  // Hash algorithm
   Utf8Value digest(env->isolate(), args[offset]);
-  params->digest = EVP_get_digestbyname(*digest);
+  params->digest = GetDigestByName(*digest);
   if (UNLIKELY(params->digest == nullptr)) {
     THROW_ERR_CRYPTO_INVALID_DIGEST(env, "Invalid digest: %s", *digest);
     return Nothing<bool>();
@@ -251,9 +513,7 @@ Maybe<bool> HashTraits::AdditionalConfig(
     THROW_ERR_OUT_OF_RANGE(env, "data is too big");
     return Nothing<bool>();
   }
-  params->in = mode == kCryptoJobAsync
-      ? data.ToCopy()
-      : data.ToByteSource();
+  params->in = data.ToJobInput(mode);
 
   unsigned int expected = EVP_MD_size(params->digest);
   params->length = expected;
@@ -9,8 +9,11 @@
 #include "base_object.h"
 #include "env.h"
 #include "memory_tracker.h"
+#include "node_internals.h"
 #include "v8.h"
 
+#include <vector>
+
 namespace node {
 namespace crypto {
 class Hash final : public BaseObject {
@@ -26,6 +29,7 @@ class Hash final : public BaseObject {
   bool HashUpdate(const char* data, size_t len);
 
   static void GetHashes(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void OneShotDigest(const v8::FunctionCallbackInfo<v8::Value>& args);
 
  protected:
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -40,6 +44,64 @@ class Hash final : public BaseObject {
   ByteSource digest_;
 };
 
+// A Hash that does its work on the thread pool. Chunks passed to update()
+// are copied and hashed in order by a single piece of work at a time, so
+// the event loop is not blocked while large inputs are hashed. update()
+// returns false once more than the high water mark is queued, and
+// `ondrain` is called when the queue has gone below it again. digest()
+// calls `ondone(err, digest)` after all chunks queued before it.
+class HashStream final : public AsyncWrap, public ThreadPoolWork {
+ public:
+  static constexpr size_t kDefaultHighWaterMark = 4 * 1024 * 1024;
+
+  static void Initialize(Environment* env, v8::Local<v8::Object> target);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  bool IsNotIndicativeOfMemoryLeakAtExit() const override {
+    // Like CryptoJobs, these may have work in the thread pool when the
+    // event loop empties and starts to exit.
+    return true;
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(HashStream)
+  SET_SELF_SIZE(HashStream)
+
+  void DoThreadPoolWork() override;
+  void AfterThreadPoolWork(int status) override;
+
+ protected:
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Update(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Digest(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  HashStream(Environment* env,
+             v8::Local<v8::Object> wrap,
+             EVPMDPointer&& mdctx,
+             unsigned int md_len,
+             size_t high_water_mark);
+
+ private:
+  void MaybeScheduleWork();
+
+  EVPMDPointer mdctx_;
+  const unsigned int md_len_;
+  const size_t high_water_mark_;
+  size_t queued_bytes_ = 0;
+  bool need_drain_ = false;
+  // Chunks are only added to `pending_`, and moved to `in_flight_` when
+  // work is scheduled, so the thread pool and the loop never share them.
+  std::vector<ByteSource> pending_;
+  std::vector<ByteSource> in_flight_;
+  bool scheduled_ = false;
+  bool digest_requested_ = false;
+  bool finalizing_ = false;
+  enum encoding digest_encoding_ = BUFFER;
+  bool failed_ = false;
+  CryptoErrorStore errors_;
+  ByteSource digest_;
+};
+
 struct HashConfig final : public MemoryRetainer {
   CryptoJobMode mode;
   ByteSource in;
@@ -57,6 +119,10 @@ struct HashConfig final : public MemoryRetainer {
   SET_SELF_SIZE(HashConfig)
 };
 
+inline size_t JobInputSize(const HashConfig& params) {
+  return params.in.size();
+}
+
 struct HashTraits final {
   using AdditionalParameters = HashConfig;
   static constexpr const char* JobName = "HashJob";
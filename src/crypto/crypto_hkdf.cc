@@ -57,7 +57,7 @@ Maybe<bool> HKDFTraits::AdditionalConfig(
   CHECK(args[offset + 4]->IsUint32());  // Length
 
   Utf8Value hash(env->isolate(), args[offset]);
-  params->digest = EVP_get_digestbyname(*hash);
+  params->digest = GetDigestByName(*hash);
   if (params->digest == nullptr) {
     THROW_ERR_CRYPTO_INVALID_DIGEST(env);
     return Nothing<bool>();
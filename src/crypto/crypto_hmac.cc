@@ -12,6 +12,11 @@
 #include "threadpoolwork-inl.h"
 #include "v8.h"
 
+#include <openssl/crypto.h>
+
+#include <list>
+#include <memory>
+
 namespace node {
 
 using v8::FunctionCallbackInfo;
@@ -49,6 +54,7 @@ void Hmac::Initialize(Environment* env, Local<Object> target) {
   env->SetProtoMethod(t, "digest", HmacDigest);
 
   env->SetConstructorFunction(target, "Hmac", t);
+  env->SetMethod(target, "hmacVerify", OneShotVerify);
 
   HmacJob::Initialize(env, target);
 }
@@ -58,6 +64,7 @@ void Hmac::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(HmacInit);
   registry->Register(HmacUpdate);
   registry->Register(HmacDigest);
+  registry->Register(OneShotVerify);
   HmacJob::RegisterExternalReferences(registry);
 }
 
@@ -69,7 +76,7 @@ void Hmac::New(const FunctionCallbackInfo<Value>& args) {
 void Hmac::HmacInit(const char* hash_type, const char* key, int key_len) {
   HandleScope scope(env()->isolate());
 
-  const EVP_MD* md = EVP_get_digestbyname(hash_type);
+  const EVP_MD* md = GetDigestByName(hash_type);
   if (md == nullptr)
     return THROW_ERR_CRYPTO_INVALID_DIGEST(env());
   if (key_len == 0) {
@@ -143,6 +150,123 @@ void Hmac::HmacDigest(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(rc.FromMaybe(Local<Value>()));
 }
 
+namespace {
+// HMAC contexts keyed with the KeyObjects that were most recently used with
+// hmacVerify() on this thread. HMAC_Init_ex() can then reset them to their
+// keyed state instead of processing the key again.
+class HmacContextCache final {
+ public:
+  static constexpr size_t kMaxEntries = 16;
+
+  static HmacContextCache* GetForCurrentThread() {
+    static thread_local HmacContextCache cache;
+    return &cache;
+  }
+
+  // Returns nullptr if a context could not be created.
+  HMAC_CTX* Get(const std::shared_ptr<KeyObjectData>& key, const EVP_MD* md) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->key.expired()) {
+        it = entries_.erase(it);
+        continue;
+      }
+      if (it->md == md && !it->key.owner_before(key) &&
+          !key.owner_before(it->key)) {
+        entries_.splice(entries_.begin(), entries_, it);
+        HMAC_CTX* ctx = it->ctx.get();
+        return HMAC_Init_ex(ctx, nullptr, 0, nullptr, nullptr) ? ctx : nullptr;
+      }
+      ++it;
+    }
+
+    HMACCtxPointer ctx(HMAC_CTX_new());
+    if (!ctx ||
+        !HMAC_Init_ex(ctx.get(),
+                      key->GetSymmetricKey(),
+                      key->GetSymmetricKeySize(),
+                      md,
+                      nullptr)) {
+      return nullptr;
+    }
+    entries_.push_front({ key, md, std::move(ctx) });
+    if (entries_.size() > kMaxEntries)
+      entries_.pop_back();
+    return entries_.front().ctx.get();
+  }
+
+  // Contexts for keys passed as bytes are not worth keeping.
+  HMAC_CTX* Get(const ByteSource& key, const EVP_MD* md) {
+    if (!scratch_)
+      scratch_.reset(HMAC_CTX_new());
+    if (!scratch_ ||
+        !HMAC_Init_ex(scratch_.get(),
+                      key.size() > 0 ? key.get() : "",
+                      key.size(),
+                      md,
+                      nullptr)) {
+      return nullptr;
+    }
+    return scratch_.get();
+  }
+
+ private:
+  struct Entry {
+    std::weak_ptr<KeyObjectData> key;
+    const EVP_MD* md;
+    HMACCtxPointer ctx;
+  };
+
+  std::list<Entry> entries_;  // Most recently used first.
+  HMACCtxPointer scratch_;
+};
+}  // namespace
+
+// hmacVerify(algorithm, key, data, expected) returns whether `expected` is
+// the HMAC of `data`, comparing them in constant time. `key` is a secret
+// KeyObjectHandle, a string or a buffer.
+void Hmac::OneShotVerify(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsString());  // Algorithm
+  CHECK(IsAnyByteSource(args[2]));  // Data
+  CHECK(IsAnyByteSource(args[3]));  // Expected
+
+  const Utf8Value hash_type(env->isolate(), args[0]);
+  const EVP_MD* md = GetDigestByName(*hash_type);
+  if (md == nullptr)
+    return THROW_ERR_CRYPTO_INVALID_DIGEST(env);
+
+  ArrayBufferOrViewContents<unsigned char> data(args[2]);
+  ArrayBufferOrViewContents<unsigned char> expected(args[3]);
+  if (UNLIKELY(!data.CheckSizeInt32()))
+    return THROW_ERR_OUT_OF_RANGE(env, "data is too big");
+
+  ClearErrorOnReturn clear_error_on_return;
+  HmacContextCache* cache = HmacContextCache::GetForCurrentThread();
+  HMAC_CTX* ctx;
+  if (args[1]->IsObject() && !IsAnyByteSource(args[1])) {
+    KeyObjectHandle* key;
+    ASSIGN_OR_RETURN_UNWRAP(&key, args[1]);
+    CHECK_EQ(key->Data()->GetKeyType(), kKeyTypeSecret);
+    ctx = cache->Get(key->Data(), md);
+  } else {
+    ctx = cache->Get(ByteSource::FromSecretKeyBytes(env, args[1]), md);
+  }
+  if (ctx == nullptr)
+    return ThrowCryptoError(env, ERR_get_error());
+
+  unsigned char md_value[EVP_MAX_MD_SIZE];
+  unsigned int md_len = 0;
+  if (!HMAC_Update(ctx, data.data(), data.size()) ||
+      !HMAC_Final(ctx, md_value, &md_len)) {
+    return ThrowCryptoError(env, ERR_get_error());
+  }
+
+  bool match = expected.size() == md_len &&
+               CRYPTO_memcmp(md_value, expected.data(), md_len) == 0;
+  OPENSSL_cleanse(md_value, sizeof(md_value));
+  args.GetReturnValue().Set(match);
+}
+
 HmacConfig::HmacConfig(HmacConfig&& other) noexcept
     : job_mode(other.job_mode),
       mode(other.mode),
@@ -183,7 +307,7 @@ Maybe<bool> HmacTraits::AdditionalConfig(
   CHECK(args[offset + 2]->IsObject());  // Key
 
   Utf8Value digest(env->isolate(), args[offset + 1]);
-  params->digest = EVP_get_digestbyname(*digest);
+  params->digest = GetDigestByName(*digest);
   if (params->digest == nullptr) {
     THROW_ERR_CRYPTO_INVALID_DIGEST(env);
     return Nothing<bool>();
@@ -198,9 +322,7 @@ Maybe<bool> HmacTraits::AdditionalConfig(
     THROW_ERR_OUT_OF_RANGE(env, "data is too big");
     return Nothing<bool>();
   }
-  params->data = mode == kCryptoJobAsync
-      ? data.ToCopy()
-      : data.ToByteSource();
+  params->data = data.ToJobInput(mode);
 
   if (!args[offset + 4]->IsUndefined()) {
     ArrayBufferOrViewContents<char> signature(args[offset + 4]);
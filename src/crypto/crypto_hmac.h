@@ -35,6 +35,7 @@ class Hmac : public BaseObject {
   Hmac(Environment* env, v8::Local<v8::Object> wrap);
 
   static void Sign(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void OneShotVerify(const v8::FunctionCallbackInfo<v8::Value>& args);
 
  private:
   HMACCtxPointer ctx_;
@@ -59,6 +60,10 @@ struct HmacConfig final : public MemoryRetainer {
   SET_SELF_SIZE(HmacConfig)
 };
 
+inline size_t JobInputSize(const HmacConfig& params) {
+  return params.data.size();
+}
+
 struct HmacTraits final {
   using AdditionalParameters = HmacConfig;
   static constexpr const char* JobName = "HmacJob";
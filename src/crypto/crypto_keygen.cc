@@ -18,11 +18,134 @@ using v8::Just;
 using v8::Local;
 using v8::Maybe;
 using v8::Nothing;
+using v8::Number;
 using v8::Object;
 using v8::Uint32;
 using v8::Value;
 
 namespace crypto {
+struct KeyPairPool::Shape {
+  // Only used by the RefillWork in flight, if any.
+  EVPKeyCtxPointer ctx;
+  std::deque<EVPKeyPointer> keys;
+  size_t depth = 0;
+  bool refilling = false;
+};
+
+class KeyPairPool::RefillWork final : public ThreadPoolWork {
+ public:
+  RefillWork(Environment* env, KeyPairPool* pool, Shape* shape)
+      : ThreadPoolWork(env), pool_(pool), shape_(shape) {}
+
+  void DoThreadPoolWork() override {
+    CheckEntropy();
+    ClearErrorOnReturn clear_error_on_return;
+    EVP_PKEY* pkey = nullptr;
+    if (EVP_PKEY_keygen(shape_->ctx.get(), &pkey) > 0)
+      key_.reset(pkey);
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<RefillWork> self(this);
+    Mutex::ScopedLock lock(pool_->mutex_);
+    shape_->refilling = false;
+    // Give up on a shape that cannot be generated until it is asked for
+    // again, rather than retrying in a loop.
+    if (!key_)
+      return;
+    if (shape_->keys.size() < shape_->depth)
+      shape_->keys.emplace_back(std::move(key_));
+    if (status == 0 && !env()->is_stopping())
+      pool_->ScheduleRefillLocked(env(), shape_);
+  }
+
+ private:
+  KeyPairPool* pool_;
+  Shape* shape_;
+  EVPKeyPointer key_;
+};
+
+KeyPairPool* KeyPairPool::GetInstance() {
+  // Intentionally leaked, worker threads may still use it during exit.
+  static KeyPairPool* pool = new KeyPairPool();
+  return pool;
+}
+
+std::string KeyPairPool::ShapeOf(const char* job_name,
+                                 const FunctionCallbackInfo<Value>& args,
+                                 unsigned int begin,
+                                 unsigned int end) {
+  std::string shape(job_name);
+  // Every argument is prefixed with its type and length, so that different
+  // arguments cannot produce the same shape.
+  auto append = [&](char type, const char* data, size_t length) {
+    shape += type;
+    shape += std::to_string(length);
+    shape += ':';
+    shape.append(data, length);
+  };
+  for (unsigned int i = begin; i < end; i++) {
+    Local<Value> arg = args[i];
+    if (arg->IsUndefined()) {
+      append('u', "", 0);
+    } else if (arg->IsNumber()) {
+      std::string number = std::to_string(arg.As<Number>()->Value());
+      append('n', number.data(), number.size());
+    } else if (arg->IsString()) {
+      Utf8Value str(args.GetIsolate(), arg);
+      append('s', *str, str.length());
+    } else if (IsAnyByteSource(arg)) {
+      ArrayBufferOrViewContents<char> buf(arg);
+      append('b', buf.data(), buf.size());
+    } else {
+      return std::string();
+    }
+  }
+  return shape;
+}
+
+void KeyPairPool::SetDepth(Environment* env,
+                           const std::string& shape,
+                           size_t depth,
+                           EVPKeyCtxPointer&& ctx) {
+  Mutex::ScopedLock lock(mutex_);
+  std::unique_ptr<Shape>& entry = shapes_[shape];
+  if (!entry)
+    entry = std::make_unique<Shape>();
+  if (!entry->ctx)
+    entry->ctx = std::move(ctx);
+  entry->depth = depth;
+  while (entry->keys.size() > depth)
+    entry->keys.pop_back();
+  if (depth > 0)
+    enabled_ = true;
+  ScheduleRefillLocked(env, entry.get());
+}
+
+EVPKeyPointer KeyPairPool::Take(const std::string& shape) {
+  Mutex::ScopedLock lock(mutex_);
+  auto it = shapes_.find(shape);
+  if (it == shapes_.end() || it->second->keys.empty())
+    return EVPKeyPointer();
+  EVPKeyPointer key = std::move(it->second->keys.front());
+  it->second->keys.pop_front();
+  return key;
+}
+
+void KeyPairPool::Refill(Environment* env, const std::string& shape) {
+  Mutex::ScopedLock lock(mutex_);
+  auto it = shapes_.find(shape);
+  if (it != shapes_.end())
+    ScheduleRefillLocked(env, it->second.get());
+}
+
+void KeyPairPool::ScheduleRefillLocked(Environment* env, Shape* shape) {
+  if (shape->refilling || !shape->ctx || shape->keys.size() >= shape->depth)
+    return;
+  shape->refilling = true;
+  (new RefillWork(env, this, shape))->ScheduleWork();
+}
+
 // NidKeyPairGenJob input arguments:
 //   1. CryptoJobMode
 //   2. NID
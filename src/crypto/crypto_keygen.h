@@ -10,8 +10,15 @@
 #include "base_object.h"
 #include "env.h"
 #include "memory_tracker.h"
+#include "node_mutex.h"
 #include "v8.h"
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
 namespace node {
 namespace crypto {
 namespace Keygen {
@@ -24,6 +31,51 @@ enum class KeyGenJobStatus {
   FAILED
 };
 
+// Key pairs generated ahead of time on the thread pool, so that a key pair
+// job can take one instead of generating it while its caller waits.
+//
+// Keys are kept per shape, i.e. per job type and the algorithm specific
+// arguments the job was given, since any two keys generated from the same
+// arguments are interchangeable. Each shape has a target depth, which is 0
+// (no pooling) unless it has been set with the job's setPoolDepth(). A shape
+// is refilled by one key at a time, so that refills do not take over more
+// than one thread of the pool.
+class KeyPairPool final {
+ public:
+  static KeyPairPool* GetInstance();
+
+  // Returns an empty string if the arguments cannot be used as a shape.
+  static std::string ShapeOf(const char* job_name,
+                             const v8::FunctionCallbackInfo<v8::Value>& args,
+                             unsigned int begin,
+                             unsigned int end);
+
+  // Whether any shape has been given a depth yet.
+  bool enabled() const { return enabled_; }
+
+  // `ctx` must be ready for EVP_PKEY_keygen(). It is only used if the shape
+  // does not have one yet.
+  void SetDepth(Environment* env,
+                const std::string& shape,
+                size_t depth,
+                EVPKeyCtxPointer&& ctx);
+  EVPKeyPointer Take(const std::string& shape);
+  void Refill(Environment* env, const std::string& shape);
+
+ private:
+  struct Shape;
+  class RefillWork;
+
+  void ScheduleRefillLocked(Environment* env, Shape* shape);
+
+  Mutex mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Shape>> shapes_;
+  std::atomic<bool> enabled_{false};
+};
+
+template <typename KeyPairAlgorithmTraits>
+struct KeyPairGenTraits;
+
 // A Base CryptoJob for generating secret keys or key pairs.
 // The KeyGenTraits is largely responsible for the details of
 // the implementation, while KeyGenJob handles the common
@@ -57,10 +109,12 @@ class KeyGenJob final : public CryptoJob<KeyGenTraits> {
       Environment* env,
       v8::Local<v8::Object> target) {
     CryptoJob<KeyGenTraits>::Initialize(New, env, target);
+    InitializePool(env, target, static_cast<KeyGenTraits*>(nullptr));
   }
 
   static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
     CryptoJob<KeyGenTraits>::RegisterExternalReferences(New, registry);
+    RegisterPool(registry, static_cast<KeyGenTraits*>(nullptr));
   }
 
   KeyGenJob(
@@ -120,6 +174,38 @@ class KeyGenJob final : public CryptoJob<KeyGenTraits> {
   SET_SELF_SIZE(KeyGenJob)
 
  private:
+  // Only key pair jobs can be pooled. They get a setPoolDepth() method on
+  // their constructor.
+  template <typename T>
+  static void InitializePool(
+      Environment* env,
+      v8::Local<v8::Object> target,
+      T*) {}
+
+  template <typename T>
+  static void InitializePool(
+      Environment* env,
+      v8::Local<v8::Object> target,
+      KeyPairGenTraits<T>*) {
+    v8::Local<v8::Value> job;
+    if (target->Get(env->context(),
+                    OneByteString(env->isolate(), KeyGenTraits::JobName))
+            .ToLocal(&job)) {
+      env->SetMethod(job.As<v8::Object>(),
+                     "setPoolDepth",
+                     KeyGenTraits::SetPoolDepth);
+    }
+  }
+
+  template <typename T>
+  static void RegisterPool(ExternalReferenceRegistry* registry, T*) {}
+
+  template <typename T>
+  static void RegisterPool(ExternalReferenceRegistry* registry,
+                           KeyPairGenTraits<T>*) {
+    registry->Register(KeyGenTraits::SetPoolDepth);
+  }
+
   KeyGenJobStatus status_ = KeyGenJobStatus::FAILED;
 };
 
@@ -143,11 +229,17 @@ struct KeyPairGenTraits final {
     // functions will update the value of the offset as they successfully
     // process input parameters. This allows each job to have a variable
     // number of input parameters specific to each job type.
+    unsigned int begin = *offset;
     if (KeyPairAlgorithmTraits::AdditionalConfig(mode, args, offset, params)
             .IsNothing()) {
       return v8::Just(false);
     }
 
+    if (KeyPairPool::GetInstance()->enabled()) {
+      params->pool_shape =
+          KeyPairPool::ShapeOf(JobName, args, begin, *offset);
+    }
+
     params->public_key_encoding = ManagedEVPPKey::GetPublicKeyEncodingFromJs(
         args,
         offset,
@@ -168,6 +260,15 @@ struct KeyPairGenTraits final {
   static KeyGenJobStatus DoKeyGen(
       Environment* env,
       AdditionalParameters* params) {
+    if (!params->pool_shape.empty()) {
+      EVPKeyPointer pooled =
+          KeyPairPool::GetInstance()->Take(params->pool_shape);
+      if (pooled) {
+        params->key = ManagedEVPPKey(std::move(pooled));
+        return KeyGenJobStatus::OK;
+      }
+    }
+
     EVPKeyCtxPointer ctx = KeyPairAlgorithmTraits::Setup(params);
 
     if (!ctx)
@@ -186,6 +287,9 @@ struct KeyPairGenTraits final {
       Environment* env,
       AdditionalParameters* params,
       v8::Local<v8::Value>* result) {
+    if (!params->pool_shape.empty())
+      KeyPairPool::GetInstance()->Refill(env, params->pool_shape);
+
     v8::Local<v8::Value> keys[2];
     if (ManagedEVPPKey::ToEncodedPublicKey(
             env,
@@ -202,6 +306,33 @@ struct KeyPairGenTraits final {
     *result = v8::Array::New(env->isolate(), keys, arraysize(keys));
     return v8::Just(true);
   }
+
+  // setPoolDepth(depth, ...args) keeps up to `depth` key pairs generated
+  // from the algorithm specific arguments `args`, as passed to the job, ready
+  // to be taken by jobs that are given the same arguments. Algorithms that
+  // generate their own parameters (DSA, and DH with a prime length) do so
+  // once here, and the pooled keys share them.
+  static void SetPoolDepth(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args[0]->IsUint32());  // Depth
+
+    unsigned int offset = 1;
+    AdditionalParameters params;
+    if (KeyPairAlgorithmTraits::AdditionalConfig(
+            kCryptoJobAsync, args, &offset, &params).IsNothing()) {
+      return;
+    }
+
+    std::string shape = KeyPairPool::ShapeOf(JobName, args, 1, offset);
+    CHECK(!shape.empty());
+
+    EVPKeyCtxPointer ctx = KeyPairAlgorithmTraits::Setup(&params);
+    if (!ctx)
+      return ThrowCryptoError(env, ERR_get_error());
+
+    KeyPairPool::GetInstance()->SetDepth(
+        env, shape, args[0].As<v8::Uint32>()->Value(), std::move(ctx));
+  }
 };
 
 struct SecretKeyGenConfig final : public MemoryRetainer {
@@ -241,6 +372,8 @@ struct KeyPairGenConfig final : public MemoryRetainer {
   PrivateKeyEncodingConfig private_key_encoding;
   ManagedEVPPKey key;
   AlgorithmParams params;
+  // Set if key pairs generated from the same arguments may be pooled.
+  std::string pool_shape;
 
   KeyPairGenConfig() = default;
   ~KeyPairGenConfig() {
@@ -253,7 +386,8 @@ struct KeyPairGenConfig final : public MemoryRetainer {
             std::forward<PrivateKeyEncodingConfig>(
                 other.private_key_encoding)),
         key(std::move(other.key)),
-        params(std::move(other.params)) {}
+        params(std::move(other.params)),
+        pool_shape(std::move(other.pool_shape)) {}
 
   KeyPairGenConfig& operator=(KeyPairGenConfig&& other) noexcept {
     if (&other == this) return *this;
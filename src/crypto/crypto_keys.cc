@@ -557,7 +557,8 @@ Maybe<bool> GetAsymmetricKeyDetail(
 }  // namespace
 
 ManagedEVPPKey::ManagedEVPPKey(EVPKeyPointer&& pkey) : pkey_(std::move(pkey)),
-    mutex_(std::make_shared<Mutex>()) {}
+    mutex_(std::make_shared<Mutex>()),
+    contexts_(std::make_shared<ContextCache>()) {}
 
 ManagedEVPPKey::ManagedEVPPKey(const ManagedEVPPKey& that) {
   *this = that;
@@ -572,10 +573,41 @@ ManagedEVPPKey& ManagedEVPPKey::operator=(const ManagedEVPPKey& that) {
     EVP_PKEY_up_ref(pkey_.get());
 
   mutex_ = that.mutex_;
+  contexts_ = that.contexts_;
 
   return *this;
 }
 
+EVPKeyCtxPointer ManagedEVPPKey::NewInitializedContext(
+    ContextInit init) const {
+  if (contexts_) {
+    Mutex::ScopedLock lock(contexts_->mutex);
+    for (const auto& context : contexts_->contexts) {
+      if (context.first == init)
+        return EVPKeyCtxPointer(EVP_PKEY_CTX_dup(context.second.get()));
+    }
+  }
+
+  EVPKeyCtxPointer ctx(EVP_PKEY_CTX_new(pkey_.get(), nullptr));
+  if (!ctx || init(ctx.get()) <= 0)
+    return EVPKeyCtxPointer();
+  if (!contexts_)
+    return ctx;
+
+  // Keys that can't duplicate their contexts are still usable, they just
+  // don't benefit from the cache.
+  EVPKeyCtxPointer copy(EVP_PKEY_CTX_dup(ctx.get()));
+  if (!copy)
+    return ctx;
+  Mutex::ScopedLock lock(contexts_->mutex);
+  for (const auto& context : contexts_->contexts) {
+    if (context.first == init)
+      return copy;
+  }
+  contexts_->contexts.emplace_back(init, std::move(ctx));
+  return copy;
+}
+
 ManagedEVPPKey::operator bool() const {
   return !!pkey_;
 }
@@ -689,7 +721,7 @@ ManagedEVPPKey::GetPrivateKeyEncodingFromJs(
     if (context != kKeyContextInput) {
       if (args[*offset]->IsString()) {
         Utf8Value cipher_name(env->isolate(), args[*offset]);
-        result.cipher_ = EVP_get_cipherbyname(*cipher_name);
+        result.cipher_ = GetCipherByName(*cipher_name);
         if (result.cipher_ == nullptr) {
           THROW_ERR_CRYPTO_UNKNOWN_CIPHER(env);
           return NonCopyableMaybe<PrivateKeyEncodingConfig>();
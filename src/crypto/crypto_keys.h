@@ -15,6 +15,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace node {
 namespace crypto {
@@ -84,6 +86,14 @@ class ManagedEVPPKey : public MemoryRetainer {
   EVP_PKEY* get() const;
   Mutex* mutex() const;
 
+  typedef int (*ContextInit)(EVP_PKEY_CTX* ctx);
+  // Returns a new EVP_PKEY_CTX for the key on which `init` (for example
+  // EVP_PKEY_encrypt_init) has been called. The first context for each
+  // `init` is kept, and later ones are duplicated from it, which skips the
+  // provider fetch that the initialization does. All copies of a key share
+  // these contexts, so this is safe to call from any thread.
+  EVPKeyCtxPointer NewInitializedContext(ContextInit init) const;
+
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(ManagedEVPPKey)
   SET_SELF_SIZE(ManagedEVPPKey)
@@ -128,8 +138,14 @@ class ManagedEVPPKey : public MemoryRetainer {
   size_t size_of_private_key() const;
   size_t size_of_public_key() const;
 
+  struct ContextCache {
+    Mutex mutex;
+    std::vector<std::pair<ContextInit, EVPKeyCtxPointer>> contexts;
+  };
+
   EVPKeyPointer pkey_;
   std::shared_ptr<Mutex> mutex_;
+  std::shared_ptr<ContextCache> contexts_;
 };
 
 // Objects of this class can safely be shared among threads.
@@ -18,6 +18,61 @@ using v8::Nothing;
 using v8::Value;
 
 namespace crypto {
+namespace {
+// Below this, a block takes less time than starting a thread.
+constexpr int32_t kMinParallelPBKDF2Iterations = 1000;
+
+// Computes block `block` (counting from 1) of the output, as described in
+// RFC 8018, section 5.2.
+bool DerivePBKDF2Block(const PBKDF2Config& params,
+                       uint32_t block,
+                       unsigned char* out,
+                       size_t out_len) {
+  // HMAC_Init_ex() treats a null key as "keep the previous key".
+  static const unsigned char kEmptyPass = 0;
+  const unsigned char* pass = params.pass.size() > 0
+      ? params.pass.data<unsigned char>()
+      : &kEmptyPass;
+  const unsigned char counter[4] = {
+    static_cast<unsigned char>(block >> 24),
+    static_cast<unsigned char>(block >> 16),
+    static_cast<unsigned char>(block >> 8),
+    static_cast<unsigned char>(block)
+  };
+  unsigned char u[EVP_MAX_MD_SIZE];
+  unsigned char t[EVP_MAX_MD_SIZE];
+  unsigned int md_len;
+
+  HMACCtxPointer key(HMAC_CTX_new());
+  HMACCtxPointer ctx(HMAC_CTX_new());
+  if (!key || !ctx ||
+      !HMAC_Init_ex(key.get(), pass, params.pass.size(), params.digest,
+                    nullptr) ||
+      !HMAC_CTX_copy(ctx.get(), key.get()) ||
+      !HMAC_Update(ctx.get(), params.salt.data<unsigned char>(),
+                   params.salt.size()) ||
+      !HMAC_Update(ctx.get(), counter, sizeof(counter)) ||
+      !HMAC_Final(ctx.get(), u, &md_len)) {
+    return false;
+  }
+
+  memcpy(t, u, md_len);
+  for (int32_t i = 1; i < params.iterations; i++) {
+    if (!HMAC_CTX_copy(ctx.get(), key.get()) ||
+        !HMAC_Update(ctx.get(), u, md_len) ||
+        !HMAC_Final(ctx.get(), u, &md_len)) {
+      return false;
+    }
+    for (unsigned int k = 0; k < md_len; k++)
+      t[k] ^= u[k];
+  }
+  memcpy(out, t, out_len);
+  OPENSSL_cleanse(u, sizeof(u));
+  OPENSSL_cleanse(t, sizeof(t));
+  return true;
+}
+}  // namespace
+
 PBKDF2Config::PBKDF2Config(PBKDF2Config&& other) noexcept
     : mode(other.mode),
       pass(std::move(other.pass)),
@@ -103,7 +158,7 @@ Maybe<bool> PBKDF2Traits::AdditionalConfig(
   }
 
   Utf8Value name(args.GetIsolate(), args[offset + 4]);
-  params->digest = EVP_get_digestbyname(*name);
+  params->digest = GetDigestByName(*name);
   if (params->digest == nullptr) {
     THROW_ERR_CRYPTO_INVALID_DIGEST(env, "Invalid digest: %s", *name);
     return Nothing<bool>();
@@ -124,6 +179,26 @@ bool PBKDF2Traits::DeriveBits(
   // The generated bytes are stored in buf, which is
   // assigned to out on success.
 
+  // The blocks of the output don't depend on each other, so a long output
+  // is derived on several threads.
+  const size_t length = params.length;
+  const size_t md_size = EVP_MD_size(params.digest);
+  const size_t blocks = (length + md_size - 1) / md_size;
+  if (blocks > 1 && params.iterations >= kMinParallelPBKDF2Iterations) {
+    bool ok = RunParallelTasks(blocks, blocks, [&](size_t index) {
+      size_t offset = index * md_size;
+      return DerivePBKDF2Block(
+          params,
+          static_cast<uint32_t>(index + 1),
+          ptr + offset,
+          std::min(md_size, length - offset));
+    });
+    if (!ok)
+      return false;
+    *out = std::move(buf);
+    return true;
+  }
+
   if (PKCS5_PBKDF2_HMAC(
           params.pass.get(),
           params.pass.size(),
@@ -0,0 +1,188 @@
+#include "crypto/crypto_pem_cache.h"
+#include "crypto/crypto_bio.h"
+#include "crypto/crypto_util.h"
+#include "memory_tracker-inl.h"
+#include "util-inl.h"
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+namespace node {
+namespace crypto {
+
+PEMCache* PEMCache::GetInstance() {
+  // Intentionally leaked, worker threads may still use it during exit.
+  static PEMCache* cache = new PEMCache();
+  return cache;
+}
+
+template <typename T>
+template <typename Create>
+std::shared_ptr<const T> PEMCache::Table<T>::Get(const Key& key,
+                                                 Create&& create) {
+  {
+    Mutex::ScopedLock lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      if (std::shared_ptr<const T> entry = it->second.lock())
+        return entry;
+    }
+  }
+
+  // Parse without holding the lock. If another thread does the same in the
+  // meantime, whichever entry is cached first wins.
+  std::shared_ptr<const T> entry = create();
+  if (!entry)
+    return entry;
+
+  Mutex::ScopedLock lock(mutex_);
+  std::weak_ptr<const T>& slot = entries_[key];
+  if (std::shared_ptr<const T> existing = slot.lock())
+    return existing;
+  slot = entry;
+
+  if (entries_.size() >= prune_size_) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.expired())
+        it = entries_.erase(it);
+      else
+        ++it;
+    }
+    prune_size_ = std::max<size_t>(64, entries_.size() * 2);
+  }
+  return entry;
+}
+
+PEMCache::Key PEMCache::ComputeKey(const char* data,
+                                   size_t size,
+                                   const char* extra,
+                                   size_t extra_size) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_size;
+  const uint64_t sizes[] = { size, extra_size };
+  EVPMDPointer ctx(EVP_MD_CTX_new());
+  CHECK(ctx);
+  CHECK_EQ(EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr), 1);
+  CHECK_EQ(EVP_DigestUpdate(ctx.get(), sizes, sizeof(sizes)), 1);
+  CHECK_EQ(EVP_DigestUpdate(ctx.get(), data, size), 1);
+  CHECK_EQ(EVP_DigestUpdate(ctx.get(), extra, extra_size), 1);
+  CHECK_EQ(EVP_DigestFinal_ex(ctx.get(), digest, &digest_size), 1);
+  return Key(reinterpret_cast<const char*>(digest), digest_size);
+}
+
+// Read a certificate in "PEM" format, possibly followed by a sequence of CA
+// certificates that should be sent to the peer in the Certificate message.
+//
+// Taken from OpenSSL - edited for style.
+std::shared_ptr<const PEMCache::CertChain> PEMCache::GetCertChain(
+    const char* data,
+    size_t size) {
+  return cert_chains_.Get(ComputeKey(data, size), [&]() {
+    std::shared_ptr<CertChain> chain;
+
+    // Just to ensure that `ERR_peek_last_error` below will return only
+    // errors that we are interested in
+    ERR_clear_error();
+
+    BIOPointer in = NodeBIO::NewFixed(data, size);
+    X509Pointer x(
+        PEM_read_bio_X509_AUX(in.get(), nullptr, NoPasswordCallback, nullptr));
+    if (!x)
+      return chain;
+
+    StackOfX509 extra_certs(sk_X509_new_null());
+    if (!extra_certs)
+      return chain;
+
+    while (X509Pointer extra {PEM_read_bio_X509(in.get(),
+                                      nullptr,
+                                      NoPasswordCallback,
+                                      nullptr)}) {
+      if (!sk_X509_push(extra_certs.get(), extra.get()))
+        return chain;
+      extra.release();
+    }
+
+    // When the while loop ends, it's usually just EOF.
+    unsigned long err = ERR_peek_last_error();  // NOLINT(runtime/int)
+    if (ERR_GET_LIB(err) != ERR_LIB_PEM ||
+        ERR_GET_REASON(err) != PEM_R_NO_START_LINE) {
+      // some real error
+      return chain;
+    }
+    ERR_clear_error();
+
+    chain = std::make_shared<CertChain>();
+    chain->cert = std::move(x);
+    chain->extra_certs = std::move(extra_certs);
+    return chain;
+  });
+}
+
+std::shared_ptr<const PEMCache::CertList> PEMCache::GetCertList(
+    const char* data,
+    size_t size) {
+  Key key = ComputeKey(data, size);
+  return cert_lists_.Get(key, [&]() {
+    std::shared_ptr<CertList> list = std::make_shared<CertList>();
+    list->key = key;
+    BIOPointer in = NodeBIO::NewFixed(data, size);
+    while (X509* x509 = PEM_read_bio_X509_AUX(
+        in.get(), nullptr, NoPasswordCallback, nullptr)) {
+      list->certs.emplace_back(x509);
+    }
+    // Like in SecureContext::AddCACert(), the first certificate that cannot
+    // be parsed ends the list.
+    ERR_clear_error();
+    return list;
+  });
+}
+
+std::shared_ptr<const PEMCache::PrivateKey> PEMCache::GetPrivateKey(
+    const char* data,
+    size_t size,
+    const ByteSource& passphrase) {
+  return private_keys_.Get(
+      ComputeKey(data, size, passphrase.get(), passphrase.size()), [&]() {
+        std::shared_ptr<PrivateKey> key;
+        BIOPointer in = NodeBIO::NewFixed(data, size);
+        // This redirection is necessary because the PasswordCallback
+        // expects a pointer to a pointer to the passphrase ByteSource to
+        // allow passing in const ByteSources.
+        const ByteSource* pass_ptr = &passphrase;
+        EVPKeyPointer pkey(
+            PEM_read_bio_PrivateKey(in.get(),
+                                    nullptr,
+                                    PasswordCallback,
+                                    &pass_ptr));
+        if (pkey) {
+          key = std::make_shared<PrivateKey>();
+          key->pkey = std::move(pkey);
+        }
+        return key;
+      });
+}
+
+std::shared_ptr<const PEMCache::CertStore> PEMCache::GetCertStore(
+    const Key& key,
+    const std::function<X509StorePointer()>& build) {
+  return cert_stores_.Get(key, [&]() {
+    std::shared_ptr<CertStore> store;
+    X509StorePointer x509_store = build();
+    if (x509_store) {
+      store = std::make_shared<CertStore>();
+      store->store = std::move(x509_store);
+    }
+    return store;
+  });
+}
+
+PEMCache::Key PEMCache::NextCertStoreKey(const Key& key,
+                                         const CertList& certs) {
+  return ComputeKey(key.data(), key.size(),
+                    certs.key.data(), certs.key.size());
+}
+
+}  // namespace crypto
+}  // namespace node
@@ -0,0 +1,103 @@
+#ifndef SRC_CRYPTO_CRYPTO_PEM_CACHE_H_
+#define SRC_CRYPTO_CRYPTO_PEM_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "crypto/crypto_util.h"
+#include "node_mutex.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node {
+namespace crypto {
+
+// A process-wide cache of the certificates, private keys and certificate
+// stores that SecureContexts are configured with, so that contexts in any
+// thread that are given the same PEM data share what was parsed from it
+// instead of parsing it again.
+//
+// Entries are looked up by a digest of their PEM data. They are shared
+// through std::shared_ptr and must not be modified once cached. A context
+// keeps the entries it uses alive; the cache itself only holds weak
+// references, so entries go away with the last context using them.
+class PEMCache final {
+ public:
+  // SHA-256 digest of the data an entry was created from.
+  using Key = std::string;
+
+  // A certificate followed by the chain certificates sent along with it,
+  // see SecureContext::SetCert().
+  struct CertChain {
+    X509Pointer cert;
+    StackOfX509 extra_certs;
+  };
+
+  // The certificates of a CA bundle, see SecureContext::AddCACert().
+  struct CertList {
+    Key key;
+    std::vector<X509Pointer> certs;
+  };
+
+  struct PrivateKey {
+    EVPKeyPointer pkey;
+  };
+
+  struct CertStore {
+    X509StorePointer store;
+  };
+
+  static PEMCache* GetInstance();
+
+  // Return an empty pointer if the data cannot be parsed, with the reason
+  // on the OpenSSL error stack.
+  std::shared_ptr<const CertChain> GetCertChain(const char* data,
+                                                size_t size);
+  std::shared_ptr<const CertList> GetCertList(const char* data, size_t size);
+  std::shared_ptr<const PrivateKey> GetPrivateKey(
+      const char* data,
+      size_t size,
+      const ByteSource& passphrase);
+
+  // Certificate stores are identified by how they were built: `key` is
+  // derived from the key of the store the certificates were added to, see
+  // NextCertStoreKey(). `build` creates the store on a cache miss.
+  std::shared_ptr<const CertStore> GetCertStore(
+      const Key& key,
+      const std::function<X509StorePointer()>& build);
+  static Key NextCertStoreKey(const Key& key, const CertList& certs);
+
+ private:
+  template <typename T>
+  class Table {
+   public:
+    template <typename Create>
+    std::shared_ptr<const T> Get(const Key& key, Create&& create);
+
+   private:
+    Mutex mutex_;
+    std::unordered_map<Key, std::weak_ptr<const T>> entries_;
+    // Expired entries are removed whenever the table grows to this size.
+    size_t prune_size_ = 64;
+  };
+
+  static Key ComputeKey(const char* data,
+                        size_t size,
+                        const char* extra = nullptr,
+                        size_t extra_size = 0);
+
+  Table<CertChain> cert_chains_;
+  Table<CertList> cert_lists_;
+  Table<PrivateKey> private_keys_;
+  Table<CertStore> cert_stores_;
+};
+
+}  // namespace crypto
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CRYPTO_CRYPTO_PEM_CACHE_H_
@@ -10,6 +10,14 @@
 #include <openssl/bn.h>
 #include <openssl/rand.h>
 
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 namespace node {
 
 using v8::ArrayBuffer;
@@ -240,14 +248,163 @@ Maybe<bool> CheckPrimeTraits::EncodeOutput(
   return Just(true);
 }
 
+namespace {
+constexpr size_t kRandomPoolSize = 4096;
+// Larger requests are not worth copying through the pool.
+constexpr size_t kMaxPooledRandomBytes = 256;
+
+// Incremented in the child after fork(), so that the child never hands out
+// bytes that the parent may hand out as well.
+std::atomic<uint64_t> random_pool_generation{0};
+
+// Random bytes for small requests, generated kRandomPoolSize bytes at a time.
+// Each thread has a pool of its own. Once half of the current buffer has been
+// used, a spare buffer is filled on the thread pool, so that the loop thread
+// usually does not have to call RAND_bytes() itself. Bytes are wiped from the
+// buffer as they are handed out.
+class RandomPool final {
+ public:
+  RandomPool();
+  ~RandomPool();
+
+  RandomPool(const RandomPool&) = delete;
+  RandomPool& operator=(const RandomPool&) = delete;
+
+  static RandomPool* GetForCurrentThread();
+
+  bool Fill(Environment* env, unsigned char* out, size_t size);
+
+ private:
+  struct Buffer {
+    unsigned char data[kRandomPoolSize];
+    size_t available = 0;
+  };
+
+  class RefillWork final : public ThreadPoolWork {
+   public:
+    RefillWork(Environment* env, RandomPool* pool, uint64_t generation)
+        : ThreadPoolWork(env), pool_(pool), generation_(generation) {}
+
+    void DoThreadPoolWork() override {
+      CheckEntropy();
+      ok_ = RAND_bytes(pool_->spare_->data, kRandomPoolSize) == 1;
+    }
+
+    void AfterThreadPoolWork(int status) override {
+      std::unique_ptr<RefillWork> self(this);
+      pool_->refilling_ = false;
+      if (status == 0 && ok_ && generation_ == random_pool_generation)
+        pool_->spare_->available = kRandomPoolSize;
+    }
+
+   private:
+    RandomPool* pool_;
+    uint64_t generation_;
+    bool ok_ = false;
+  };
+
+  void Discard(Buffer* buffer);
+
+  Buffer buffers_[2];
+  Buffer* active_ = &buffers_[0];
+  Buffer* spare_ = &buffers_[1];
+  bool refilling_ = false;
+  uint64_t generation_ = random_pool_generation;
+};
+
+RandomPool::RandomPool() {
+#ifndef _WIN32
+  static int registered = pthread_atfork(nullptr, nullptr, []() {
+    random_pool_generation++;
+  });
+  USE(registered);
+#endif
+}
+
+RandomPool::~RandomPool() {
+  Discard(active_);
+  Discard(spare_);
+}
+
+RandomPool* RandomPool::GetForCurrentThread() {
+  static thread_local RandomPool pool;
+  return &pool;
+}
+
+void RandomPool::Discard(Buffer* buffer) {
+  OPENSSL_cleanse(buffer->data, sizeof(buffer->data));
+  buffer->available = 0;
+}
+
+bool RandomPool::Fill(Environment* env, unsigned char* out, size_t size) {
+  CHECK_LE(size, kMaxPooledRandomBytes);
+  if (UNLIKELY(generation_ != random_pool_generation)) {
+    generation_ = random_pool_generation;
+    Discard(active_);
+    // A refill that is still in progress was started by the parent.
+    if (!refilling_)
+      Discard(spare_);
+  }
+
+  if (active_->available < size) {
+    if (!refilling_ && spare_->available == kRandomPoolSize) {
+      Discard(active_);
+      std::swap(active_, spare_);
+    } else {
+      CheckEntropy();
+      if (RAND_bytes(active_->data, kRandomPoolSize) != 1)
+        return false;
+      active_->available = kRandomPoolSize;
+    }
+  }
+
+  unsigned char* data = active_->data + active_->available - size;
+  memcpy(out, data, size);
+  OPENSSL_cleanse(data, size);
+  active_->available -= size;
+
+  if (active_->available < kRandomPoolSize / 2 &&
+      !refilling_ &&
+      spare_->available == 0 &&
+      env != nullptr) {
+    refilling_ = true;
+    (new RefillWork(env, this, generation_))->ScheduleWork();
+  }
+  return true;
+}
+
+// randomFillPooled(buffer, offset, size) fills a small range of `buffer`
+// synchronously and returns true, or returns false if the request should
+// go through a RandomBytesJob instead.
+void RandomFillPooled(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(IsAnyByteSource(args[0]));  // Buffer to fill
+  CHECK(args[1]->IsUint32());  // Offset
+  CHECK(args[2]->IsUint32());  // Size
+
+  ArrayBufferOrViewContents<unsigned char> in(args[0]);
+  const uint32_t byte_offset = args[1].As<Uint32>()->Value();
+  const uint32_t size = args[2].As<Uint32>()->Value();
+  CHECK_GE(byte_offset + size, byte_offset);  // Overflow check.
+  CHECK_LE(byte_offset + size, in.size());  // Bounds check.
+
+  if (size > kMaxPooledRandomBytes)
+    return args.GetReturnValue().Set(false);
+  args.GetReturnValue().Set(RandomPool::GetForCurrentThread()->Fill(
+      env, in.data() + byte_offset, size));
+}
+}  // namespace
+
 namespace Random {
 void Initialize(Environment* env, Local<Object> target) {
+  env->SetMethod(target, "randomFillPooled", RandomFillPooled);
   RandomBytesJob::Initialize(env, target);
   RandomPrimeJob::Initialize(env, target);
   CheckPrimeJob::Initialize(env, target);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
+  registry->Register(RandomFillPooled);
   RandomBytesJob::RegisterExternalReferences(registry);
   RandomPrimeJob::RegisterExternalReferences(registry);
   CheckPrimeJob::RegisterExternalReferences(registry);
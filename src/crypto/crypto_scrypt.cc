@@ -8,6 +8,10 @@
 #include "threadpoolwork-inl.h"
 #include "v8.h"
 
+#include <memory>
+#include <new>
+#include <vector>
+
 namespace node {
 
 using v8::FunctionCallbackInfo;
@@ -118,6 +122,144 @@ Maybe<bool> ScryptTraits::AdditionalConfig(
   return Just(true);
 }
 
+namespace {
+// What EVP_PBE_scrypt() uses when maxmem is 0.
+constexpr uint64_t kDefaultScryptMaxMem = 32 * 1024 * 1024;
+
+#define ROTL(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
+// The Salsa20/8 core of RFC 7914, section 3.
+void Salsa208(uint32_t b[16]) {
+  uint32_t x[16];
+  memcpy(x, b, sizeof(x));
+  for (int i = 8; i > 0; i -= 2) {
+    x[ 4] ^= ROTL(x[ 0] + x[12],  7);  x[ 8] ^= ROTL(x[ 4] + x[ 0],  9);
+    x[12] ^= ROTL(x[ 8] + x[ 4], 13);  x[ 0] ^= ROTL(x[12] + x[ 8], 18);
+    x[ 9] ^= ROTL(x[ 5] + x[ 1],  7);  x[13] ^= ROTL(x[ 9] + x[ 5],  9);
+    x[ 1] ^= ROTL(x[13] + x[ 9], 13);  x[ 5] ^= ROTL(x[ 1] + x[13], 18);
+    x[14] ^= ROTL(x[10] + x[ 6],  7);  x[ 2] ^= ROTL(x[14] + x[10],  9);
+    x[ 6] ^= ROTL(x[ 2] + x[14], 13);  x[10] ^= ROTL(x[ 6] + x[ 2], 18);
+    x[ 3] ^= ROTL(x[15] + x[11],  7);  x[ 7] ^= ROTL(x[ 3] + x[15],  9);
+    x[11] ^= ROTL(x[ 7] + x[ 3], 13);  x[15] ^= ROTL(x[11] + x[ 7], 18);
+    x[ 1] ^= ROTL(x[ 0] + x[ 3],  7);  x[ 2] ^= ROTL(x[ 1] + x[ 0],  9);
+    x[ 3] ^= ROTL(x[ 2] + x[ 1], 13);  x[ 0] ^= ROTL(x[ 3] + x[ 2], 18);
+    x[ 6] ^= ROTL(x[ 5] + x[ 4],  7);  x[ 7] ^= ROTL(x[ 6] + x[ 5],  9);
+    x[ 4] ^= ROTL(x[ 7] + x[ 6], 13);  x[ 5] ^= ROTL(x[ 4] + x[ 7], 18);
+    x[11] ^= ROTL(x[10] + x[ 9],  7);  x[ 8] ^= ROTL(x[11] + x[10],  9);
+    x[ 9] ^= ROTL(x[ 8] + x[11], 13);  x[10] ^= ROTL(x[ 9] + x[ 8], 18);
+    x[12] ^= ROTL(x[15] + x[14],  7);  x[13] ^= ROTL(x[12] + x[15],  9);
+    x[14] ^= ROTL(x[13] + x[12], 13);  x[15] ^= ROTL(x[14] + x[13], 18);
+  }
+  for (int i = 0; i < 16; i++)
+    b[i] += x[i];
+}
+#undef ROTL
+
+// scryptBlockMix, RFC 7914 section 4. `b` and `y` are 32 * r words.
+void BlockMix(uint32_t* b, uint32_t* y, uint32_t r) {
+  uint32_t x[16];
+  memcpy(x, &b[(2 * r - 1) * 16], sizeof(x));
+  for (uint32_t i = 0; i < 2 * r; i++) {
+    for (int k = 0; k < 16; k++)
+      x[k] ^= b[i * 16 + k];
+    Salsa208(x);
+    // Even blocks go to the first half, odd ones to the second.
+    memcpy(&y[((i & 1) * r + i / 2) * 16], x, sizeof(x));
+  }
+  memcpy(b, y, 128 * r);
+}
+
+// scryptROMix, RFC 7914 section 5, for one lane of 128 * r bytes. `v` is
+// 32 * r * n words, `x` and `y` are 32 * r words each.
+void ROMix(unsigned char* b,
+           uint32_t r,
+           uint64_t n,
+           uint32_t* v,
+           uint32_t* x,
+           uint32_t* y) {
+  const size_t words = 32 * r;
+  for (size_t k = 0; k < words; k++) {
+    const unsigned char* p = b + 4 * k;
+    x[k] = static_cast<uint32_t>(p[0]) |
+           static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    memcpy(&v[i * words], x, 128 * r);
+    BlockMix(x, y, r);
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t j = x[(2 * r - 1) * 16] & (n - 1);
+    for (size_t k = 0; k < words; k++)
+      x[k] ^= v[j * words + k];
+    BlockMix(x, y, r);
+  }
+  for (size_t k = 0; k < words; k++) {
+    unsigned char* p = b + 4 * k;
+    p[0] = x[k];
+    p[1] = x[k] >> 8;
+    p[2] = x[k] >> 16;
+    p[3] = x[k] >> 24;
+  }
+}
+
+// Derives the key with the p lanes of scrypt running in parallel, in as many
+// of them at a time as `maxmem` allows.
+bool ScryptParallel(const ScryptConfig& params, unsigned char* out) {
+  const uint64_t lane_size = 128 * static_cast<uint64_t>(params.r);
+  const uint64_t b_size = lane_size * params.p;
+  const uint64_t v_size = lane_size * params.N;
+  // OpenSSL accounts for 256 bytes of scratch space per lane, on top of V.
+  const uint64_t lane_memory = v_size + 2 * lane_size;
+  const uint64_t maxmem =
+      params.maxmem == 0 ? kDefaultScryptMaxMem : params.maxmem;
+  if (b_size + lane_memory > maxmem)
+    return false;
+  const size_t max_lanes =
+      static_cast<size_t>(std::min<uint64_t>((maxmem - b_size) / lane_memory,
+                                             params.p));
+
+  // HMAC_Init_ex() treats a null key as "keep the previous key".
+  static const char kEmptyPass = 0;
+  const char* pass = params.pass.size() > 0 ? params.pass.get() : &kEmptyPass;
+
+  std::vector<unsigned char> b(b_size);
+  if (PKCS5_PBKDF2_HMAC(pass,
+                        params.pass.size(),
+                        params.salt.data<unsigned char>(),
+                        params.salt.size(),
+                        1,
+                        EVP_sha256(),
+                        b.size(),
+                        b.data()) <= 0) {
+    return false;
+  }
+
+  bool ok = RunParallelTasks(params.p, max_lanes, [&](size_t lane) {
+    std::unique_ptr<uint32_t[]> v(
+        new (std::nothrow) uint32_t[v_size / 4 + lane_size / 2]);
+    if (!v)
+      return false;
+    uint32_t* x = v.get() + v_size / 4;
+    uint32_t* y = x + lane_size / 4;
+    ROMix(b.data() + lane * lane_size, params.r, params.N, v.get(), x, y);
+    OPENSSL_cleanse(v.get(), v_size + lane_size * 2);
+    return true;
+  });
+
+  ok = ok && PKCS5_PBKDF2_HMAC(pass,
+                               params.pass.size(),
+                               b.data(),
+                               b.size(),
+                               1,
+                               EVP_sha256(),
+                               params.length,
+                               out) > 0;
+  OPENSSL_cleanse(b.data(), b.size());
+  return ok;
+}
+}  // namespace
+
 bool ScryptTraits::DeriveBits(
     Environment* env,
     const ScryptConfig& params,
@@ -128,6 +270,15 @@ bool ScryptTraits::DeriveBits(
 
   // Both the pass and salt may be zero-length at this point
 
+  // The p lanes don't depend on each other, so they are mixed on several
+  // threads. With a single lane, OpenSSL's own implementation is used.
+  if (params.p > 1) {
+    if (!ScryptParallel(params, ptr))
+      return false;
+    *out = std::move(buf);
+    return true;
+  }
+
   if (!EVP_PBE_scrypt(
           params.pass.get(),
           params.pass.size(),
@@ -0,0 +1,214 @@
+#include "crypto/crypto_session_cache.h"
+#include "crypto/crypto_context.h"
+#include "crypto/crypto_util.h"
+#include "env-inl.h"
+#include "node_external_reference.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#include <openssl/crypto.h>
+#include <openssl/ssl.h>
+
+namespace node {
+
+using v8::Array;
+using v8::FunctionCallbackInfo;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::Value;
+
+namespace crypto {
+
+SharedSessionCache::SharedSessionCache(size_t max_bytes)
+    : max_bytes_(max_bytes) {
+  CHECK(EntropySource(reinterpret_cast<unsigned char*>(&current_keys_),
+                      sizeof(current_keys_)));
+}
+
+SharedSessionCache::~SharedSessionCache() {
+  OPENSSL_cleanse(&current_keys_, sizeof(current_keys_));
+  OPENSSL_cleanse(&previous_keys_, sizeof(previous_keys_));
+}
+
+SharedSessionCache* SharedSessionCache::GetInstance() {
+  // Intentionally leaked, worker threads may still use it during exit.
+  static SharedSessionCache* cache = new SharedSessionCache();
+  return cache;
+}
+
+size_t SharedSessionCache::EntrySize(const Entry& entry) {
+  return entry.id.size() + entry.data.size() + kEntryOverhead;
+}
+
+SharedSessionCache::Shard* SharedSessionCache::ShardFor(const std::string& id) {
+  return &shards_[std::hash<std::string>()(id) % kShardCount];
+}
+
+void SharedSessionCache::EraseLocked(Shard* shard,
+                                     std::list<Entry>::iterator it) {
+  shard->bytes -= EntrySize(*it);
+  shard->index.erase(it->id);
+  shard->lru.erase(it);
+}
+
+bool SharedSessionCache::Put(SSL_SESSION* session) {
+  int size = i2d_SSL_SESSION(session, nullptr);
+  if (size <= 0 || size > SecureContext::kMaxSessionSize)
+    return false;
+
+  unsigned int id_length;
+  const unsigned char* id_data = SSL_SESSION_get_id(session, &id_length);
+  Entry entry;
+  entry.id.assign(reinterpret_cast<const char*>(id_data), id_length);
+  entry.data.resize(size);
+  unsigned char* data = entry.data.data();
+  if (i2d_SSL_SESSION(session, &data) != size)
+    return false;
+
+  Shard* shard = ShardFor(entry.id);
+  const size_t shard_limit = max_bytes_ / kShardCount;
+  Mutex::ScopedLock lock(shard->mutex);
+  auto existing = shard->index.find(entry.id);
+  if (existing != shard->index.end())
+    EraseLocked(shard, existing->second);
+
+  shard->bytes += EntrySize(entry);
+  shard->lru.push_front(std::move(entry));
+  shard->index[shard->lru.front().id] = shard->lru.begin();
+
+  while (shard->bytes > shard_limit && !shard->lru.empty()) {
+    EraseLocked(shard, std::prev(shard->lru.end()));
+    evictions_++;
+  }
+  return true;
+}
+
+SSLSessionPointer SharedSessionCache::Get(const unsigned char* id,
+                                          size_t id_length) {
+  std::string key(reinterpret_cast<const char*>(id), id_length);
+  Shard* shard = ShardFor(key);
+  std::vector<unsigned char> data;
+  {
+    Mutex::ScopedLock lock(shard->mutex);
+    auto it = shard->index.find(key);
+    if (it == shard->index.end()) {
+      misses_++;
+      return SSLSessionPointer();
+    }
+    shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+    data = it->second->data;
+  }
+  hits_++;
+
+  const unsigned char* p = data.data();
+  return SSLSessionPointer(d2i_SSL_SESSION(nullptr, &p, data.size()));
+}
+
+void SharedSessionCache::Remove(const unsigned char* id, size_t id_length) {
+  std::string key(reinterpret_cast<const char*>(id), id_length);
+  Shard* shard = ShardFor(key);
+  Mutex::ScopedLock lock(shard->mutex);
+  auto it = shard->index.find(key);
+  if (it != shard->index.end())
+    EraseLocked(shard, it->second);
+}
+
+SharedSessionCache::Stats SharedSessionCache::GetStats() const {
+  Stats stats = { 0, 0, hits_, misses_, evictions_ };
+  for (const Shard& shard : shards_) {
+    Mutex::ScopedLock lock(shard.mutex);
+    stats.entries += shard.lru.size();
+    stats.bytes += shard.bytes;
+  }
+  return stats;
+}
+
+void SharedSessionCache::RotateTicketKeys(const TicketKeys& keys) {
+  Mutex::ScopedLock lock(ticket_keys_mutex_);
+  previous_keys_ = current_keys_;
+  has_previous_keys_ = true;
+  current_keys_ = keys;
+}
+
+SharedSessionCache::TicketKeys SharedSessionCache::GetTicketKeys() const {
+  Mutex::ScopedLock lock(ticket_keys_mutex_);
+  return current_keys_;
+}
+
+bool SharedSessionCache::FindTicketKeys(const unsigned char* name,
+                                        TicketKeys* keys,
+                                        bool* current) const {
+  Mutex::ScopedLock lock(ticket_keys_mutex_);
+  if (memcmp(name, current_keys_.name, sizeof(current_keys_.name)) == 0) {
+    *keys = current_keys_;
+    *current = true;
+    return true;
+  }
+  if (has_previous_keys_ &&
+      memcmp(name, previous_keys_.name, sizeof(previous_keys_.name)) == 0) {
+    *keys = previous_keys_;
+    *current = false;
+    return true;
+  }
+  return false;
+}
+
+// rotateSharedTicketKeys([keys]) installs the given 48 bytes, or new random
+// keys, as the shared ticket keys.
+void SharedSessionCache::RotateSharedTicketKeys(
+    const FunctionCallbackInfo<Value>& args) {
+  TicketKeys keys;
+  if (args[0]->IsUndefined()) {
+    CHECK(EntropySource(reinterpret_cast<unsigned char*>(&keys),
+                        sizeof(keys)));
+  } else {
+    ArrayBufferOrViewContents<unsigned char> buf(args[0]);
+    CHECK_EQ(buf.size(), sizeof(keys));
+    memcpy(&keys, buf.data(), sizeof(keys));
+  }
+  GetInstance()->RotateTicketKeys(keys);
+  OPENSSL_cleanse(&keys, sizeof(keys));
+}
+
+void SharedSessionCache::SetSharedSessionCacheSize(
+    const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsNumber());
+  GetInstance()->set_max_bytes(args[0].As<Number>()->Value());
+}
+
+// Returns [entries, bytes, hits, misses, evictions].
+void SharedSessionCache::GetSharedSessionCacheStats(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Stats stats = GetInstance()->GetStats();
+  Local<Value> values[] = {
+    Number::New(env->isolate(), stats.entries),
+    Number::New(env->isolate(), stats.bytes),
+    Number::New(env->isolate(), stats.hits),
+    Number::New(env->isolate(), stats.misses),
+    Number::New(env->isolate(), stats.evictions),
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), values, arraysize(values)));
+}
+
+void SharedSessionCache::Initialize(Environment* env, Local<Object> target) {
+  env->SetMethod(target, "rotateSharedTicketKeys", RotateSharedTicketKeys);
+  env->SetMethod(target,
+                 "setSharedSessionCacheSize",
+                 SetSharedSessionCacheSize);
+  env->SetMethodNoSideEffect(target,
+                             "getSharedSessionCacheStats",
+                             GetSharedSessionCacheStats);
+}
+
+void SharedSessionCache::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(RotateSharedTicketKeys);
+  registry->Register(SetSharedSessionCacheSize);
+  registry->Register(GetSharedSessionCacheStats);
+}
+
+}  // namespace crypto
+}  // namespace node
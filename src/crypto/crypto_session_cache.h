@@ -0,0 +1,122 @@
+#ifndef SRC_CRYPTO_CRYPTO_SESSION_CACHE_H_
+#define SRC_CRYPTO_CRYPTO_SESSION_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "crypto/crypto_util.h"
+#include "env.h"
+#include "node_mutex.h"
+#include "v8.h"
+
+#include <atomic>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node {
+namespace crypto {
+
+// A process-wide TLS session cache and ticket key store. SecureContexts in
+// any thread can attach to it (see SecureContext::EnableSharedSessionCache()
+// and SecureContext::EnableSharedTicketKeys()), so that a client that comes
+// back to a different worker than the one it first talked to can still
+// resume its session.
+//
+// Sessions are kept serialized, which makes their memory use exact. The
+// cache is split into shards with a lock and an LRU list each, and the
+// least recently used sessions of a shard are evicted once it goes over
+// its share of the memory limit.
+class SharedSessionCache final {
+ public:
+  struct Stats {
+    size_t entries;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+  };
+
+  // Same layout as the buffers used by SecureContext::SetTicketKeys().
+  struct TicketKeys {
+    unsigned char name[16];
+    unsigned char hmac[16];
+    unsigned char aes[16];
+  };
+
+  static constexpr size_t kDefaultMaxBytes = 16 * 1024 * 1024;
+
+  explicit SharedSessionCache(size_t max_bytes = kDefaultMaxBytes);
+  ~SharedSessionCache();
+
+  static SharedSessionCache* GetInstance();
+
+  static void Initialize(Environment* env, v8::Local<v8::Object> target);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  // Takes effect for each shard the next time a session is added to it.
+  void set_max_bytes(size_t max_bytes) { max_bytes_ = max_bytes; }
+
+  // Returns false if the session could not be serialized or is too large.
+  bool Put(SSL_SESSION* session);
+  SSLSessionPointer Get(const unsigned char* id, size_t id_length);
+  void Remove(const unsigned char* id, size_t id_length);
+  Stats GetStats() const;
+
+  // New tickets are issued with `keys`. Tickets issued with the keys they
+  // replace are still accepted until the next rotation.
+  void RotateTicketKeys(const TicketKeys& keys);
+  TicketKeys GetTicketKeys() const;
+  // Looks up the keys that a ticket named `name` was issued with. `current`
+  // is set to false if they have been rotated out already.
+  bool FindTicketKeys(const unsigned char* name,
+                      TicketKeys* keys,
+                      bool* current) const;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+  // Rough bookkeeping cost of one entry, on top of its data.
+  static constexpr size_t kEntryOverhead = 128;
+
+  struct Entry {
+    std::string id;
+    std::vector<unsigned char> data;
+  };
+
+  struct Shard {
+    mutable Mutex mutex;
+    std::list<Entry> lru;  // Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes = 0;
+  };
+
+  static size_t EntrySize(const Entry& entry);
+  Shard* ShardFor(const std::string& id);
+  void EraseLocked(Shard* shard, std::list<Entry>::iterator it);
+
+  static void RotateSharedTicketKeys(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetSharedSessionCacheSize(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetSharedSessionCacheStats(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  std::atomic<size_t> max_bytes_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  Shard shards_[kShardCount];
+
+  mutable Mutex ticket_keys_mutex_;
+  TicketKeys current_keys_;
+  TicketKeys previous_keys_;
+  bool has_previous_keys_ = false;
+};
+
+}  // namespace crypto
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_CRYPTO_CRYPTO_SESSION_CACHE_H_
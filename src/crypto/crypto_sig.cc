@@ -12,6 +12,7 @@
 
 namespace node {
 
+using v8::Array;
 using v8::ArrayBuffer;
 using v8::BackingStore;
 using v8::FunctionCallbackInfo;
@@ -90,9 +91,8 @@ std::unique_ptr<BackingStore> Node_SignFinal(Environment* env,
     NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
     sig = ArrayBuffer::NewBackingStore(env->isolate(), sig_len);
   }
-  EVPKeyCtxPointer pkctx(EVP_PKEY_CTX_new(pkey.get(), nullptr));
+  EVPKeyCtxPointer pkctx = pkey.NewInitializedContext(EVP_PKEY_sign_init);
   if (pkctx &&
-      EVP_PKEY_sign_init(pkctx.get()) &&
       ApplyRSAOptions(pkey, pkctx.get(), padding, pss_salt_len) &&
       EVP_PKEY_CTX_set_signature_md(pkctx.get(), EVP_MD_CTX_md(mdctx.get())) &&
       EVP_PKEY_sign(pkctx.get(), static_cast<unsigned char*>(sig->Data()),
@@ -297,7 +297,7 @@ SignBase::Error SignBase::Init(const char* sign_type) {
       strcmp(sign_type, "DSS1") == 0) {
     sign_type = "SHA1";
   }
-  const EVP_MD* md = EVP_get_digestbyname(sign_type);
+  const EVP_MD* md = GetDigestByName(sign_type);
   if (md == nullptr)
     return kSignUnknownDigest;
 
@@ -343,6 +343,7 @@ void Sign::Initialize(Environment* env, Local<Object> target) {
   env->SetConstructorFunction(target, "Sign", t);
 
   SignJob::Initialize(env, target);
+  VerifyBatchJob::Initialize(env, target);
 
   constexpr int kSignJobModeSign = SignConfiguration::kSign;
   constexpr int kSignJobModeVerify = SignConfiguration::kVerify;
@@ -360,6 +361,7 @@ void Sign::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(SignUpdate);
   registry->Register(SignFinal);
   SignJob::RegisterExternalReferences(registry);
+  VerifyBatchJob::RegisterExternalReferences(registry);
 }
 
 void Sign::New(const FunctionCallbackInfo<Value>& args) {
@@ -521,9 +523,8 @@ SignBase::Error Verify::VerifyFinal(const ManagedEVPPKey& pkey,
   if (!EVP_DigestFinal_ex(mdctx.get(), m, &m_len))
     return kSignPublicKey;
 
-  EVPKeyCtxPointer pkctx(EVP_PKEY_CTX_new(pkey.get(), nullptr));
+  EVPKeyCtxPointer pkctx = pkey.NewInitializedContext(EVP_PKEY_verify_init);
   if (pkctx &&
-      EVP_PKEY_verify_init(pkctx.get()) > 0 &&
       ApplyRSAOptions(pkey, pkctx.get(), padding, saltlen) &&
       EVP_PKEY_CTX_set_signature_md(pkctx.get(),
                                     EVP_MD_CTX_md(mdctx.get())) > 0) {
@@ -641,13 +642,11 @@ Maybe<bool> SignTraits::AdditionalConfig(
     THROW_ERR_OUT_OF_RANGE(env, "data is too big");
     return Nothing<bool>();
   }
-  params->data = mode == kCryptoJobAsync
-      ? data.ToCopy()
-      : data.ToByteSource();
+  params->data = data.ToJobInput(mode);
 
   if (args[offset + 6]->IsString()) {
     Utf8Value digest(env->isolate(), args[offset + 6]);
-    params->digest = EVP_get_digestbyname(*digest);
+    params->digest = GetDigestByName(*digest);
     if (params->digest == nullptr) {
       THROW_ERR_CRYPTO_INVALID_DIGEST(env);
       return Nothing<bool>();
@@ -836,5 +835,202 @@ Maybe<bool> SignTraits::EncodeOutput(
   return Just(!result->IsEmpty());
 }
 
+VerifyBatchConfiguration::VerifyBatchConfiguration(
+    VerifyBatchConfiguration&& other) noexcept
+    : job_mode(other.job_mode),
+      items(std::move(other.items)) {}
+
+VerifyBatchConfiguration& VerifyBatchConfiguration::operator=(
+    VerifyBatchConfiguration&& other) noexcept {
+  if (&other == this) return *this;
+  this->~VerifyBatchConfiguration();
+  return *new (this) VerifyBatchConfiguration(std::move(other));
+}
+
+void VerifyBatchConfiguration::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("items",
+                              items.size() * sizeof(SignConfiguration));
+  if (job_mode != kCryptoJobAsync)
+    return;
+  size_t size = 0;
+  for (const SignConfiguration& item : items)
+    size += item.data.size() + item.signature.size();
+  tracker->TrackFieldWithSize("data", size);
+}
+
+// The arguments are an array of KeyObjectHandles, an array of data and an
+// array of signatures of the same length, followed by the digest, salt
+// length, padding and DSA encoding options that apply to all of them.
+Maybe<bool> VerifyBatchTraits::AdditionalConfig(
+    CryptoJobMode mode,
+    const FunctionCallbackInfo<Value>& args,
+    unsigned int offset,
+    VerifyBatchConfiguration* params) {
+  ClearErrorOnReturn clear_error_on_return;
+  Environment* env = Environment::GetCurrent(args);
+
+  params->job_mode = mode;
+
+  CHECK(args[offset]->IsArray());  // Keys
+  CHECK(args[offset + 1]->IsArray());  // Data
+  CHECK(args[offset + 2]->IsArray());  // Signatures
+  Local<Array> keys = args[offset].As<Array>();
+  Local<Array> data = args[offset + 1].As<Array>();
+  Local<Array> signatures = args[offset + 2].As<Array>();
+  CHECK_EQ(keys->Length(), data->Length());
+  CHECK_EQ(keys->Length(), signatures->Length());
+
+  SignConfiguration options;
+  options.job_mode = mode;
+  options.mode = SignConfiguration::kVerify;
+  if (args[offset + 3]->IsString()) {
+    Utf8Value digest(env->isolate(), args[offset + 3]);
+    options.digest = GetDigestByName(*digest);
+    if (options.digest == nullptr) {
+      THROW_ERR_CRYPTO_INVALID_DIGEST(env);
+      return Nothing<bool>();
+    }
+  }
+  if (args[offset + 4]->IsInt32()) {  // Salt length
+    options.flags |= SignConfiguration::kHasSaltLength;
+    options.salt_length = args[offset + 4].As<Int32>()->Value();
+  }
+  if (args[offset + 5]->IsUint32()) {  // Padding
+    options.flags |= SignConfiguration::kHasPadding;
+    options.padding = args[offset + 5].As<Uint32>()->Value();
+  }
+  if (args[offset + 6]->IsUint32()) {  // DSA Encoding
+    options.dsa_encoding =
+        static_cast<DSASigEnc>(args[offset + 6].As<Uint32>()->Value());
+    if (options.dsa_encoding != kSigEncDER &&
+        options.dsa_encoding != kSigEncP1363) {
+      THROW_ERR_OUT_OF_RANGE(env, "invalid signature encoding");
+      return Nothing<bool>();
+    }
+  }
+
+  params->items.reserve(keys->Length());
+  for (uint32_t i = 0; i < keys->Length(); i++) {
+    Local<Value> key_value;
+    Local<Value> data_value;
+    Local<Value> signature_value;
+    if (!keys->Get(env->context(), i).ToLocal(&key_value) ||
+        !data->Get(env->context(), i).ToLocal(&data_value) ||
+        !signatures->Get(env->context(), i).ToLocal(&signature_value)) {
+      return Nothing<bool>();
+    }
+
+    CHECK(key_value->IsObject());
+    KeyObjectHandle* key;
+    ASSIGN_OR_RETURN_UNWRAP(&key, key_value.As<Object>(), Nothing<bool>());
+    CHECK_NE(key->Data()->GetKeyType(), kKeyTypeSecret);
+
+    ArrayBufferOrViewContents<char> item_data(data_value);
+    ArrayBufferOrViewContents<char> signature(signature_value);
+    if (UNLIKELY(!item_data.CheckSizeInt32())) {
+      THROW_ERR_OUT_OF_RANGE(env, "data is too big");
+      return Nothing<bool>();
+    }
+    if (UNLIKELY(!signature.CheckSizeInt32())) {
+      THROW_ERR_OUT_OF_RANGE(env, "signature is too big");
+      return Nothing<bool>();
+    }
+
+    SignConfiguration item;
+    item.job_mode = mode;
+    item.mode = SignConfiguration::kVerify;
+    item.key = key->Data()->GetAsymmetricKey();
+    item.digest = options.digest;
+    item.flags = options.flags;
+    item.padding = options.padding;
+    item.salt_length = options.salt_length;
+    item.dsa_encoding = options.dsa_encoding;
+    item.data = item_data.ToJobInput(mode);
+    {
+      Mutex::ScopedLock lock(*item.key.mutex());
+      if (UseP1363Encoding(item.key, item.dsa_encoding)) {
+        item.signature =
+            ConvertSignatureToDER(item.key, signature.ToByteSource());
+      } else {
+        item.signature = mode == kCryptoJobAsync
+            ? signature.ToCopy()
+            : signature.ToByteSource();
+      }
+    }
+    params->items.emplace_back(std::move(item));
+  }
+
+  return Just(true);
+}
+
+// Produces one byte per item, 1 if its signature is valid. An item that
+// can't be verified at all, e.g. because its key does not support the
+// digest, counts as invalid rather than failing the whole batch.
+bool VerifyBatchTraits::DeriveBits(
+    Environment* env,
+    const VerifyBatchConfiguration& params,
+    ByteSource* out) {
+  ClearErrorOnReturn clear_error_on_return;
+  const size_t count = params.items.size();
+  char* data = MallocOpenSSL<char>(count > 0 ? count : 1);
+  ByteSource results = ByteSource::Allocated(data, count);
+
+  // The digest context is reset and reused for each item.
+  EVPMDPointer context(EVP_MD_CTX_new());
+  if (!context)
+    return false;
+
+  for (size_t i = 0; i < count; i++) {
+    const SignConfiguration& item = params.items[i];
+    data[i] = 0;
+    EVP_MD_CTX_reset(context.get());
+
+    EVP_PKEY_CTX* ctx = nullptr;
+    if (!EVP_DigestVerifyInit(
+            context.get(),
+            &ctx,
+            item.digest,
+            nullptr,
+            item.key.get())) {
+      continue;
+    }
+
+    int padding = item.flags & SignConfiguration::kHasPadding
+        ? item.padding
+        : GetDefaultSignPadding(item.key);
+    Maybe<int> salt_length = item.flags & SignConfiguration::kHasSaltLength
+        ? Just<int>(item.salt_length) : Nothing<int>();
+    if (!ApplyRSAOptions(item.key, ctx, padding, salt_length))
+      continue;
+
+    if (EVP_DigestVerify(
+            context.get(),
+            item.signature.data<unsigned char>(),
+            item.signature.size(),
+            item.data.data<unsigned char>(),
+            item.data.size()) == 1) {
+      data[i] = 1;
+    }
+  }
+
+  *out = std::move(results);
+  return true;
+}
+
+Maybe<bool> VerifyBatchTraits::EncodeOutput(
+    Environment* env,
+    const VerifyBatchConfiguration& params,
+    ByteSource* out,
+    Local<Value>* result) {
+  std::vector<Local<Value>> values(out->size());
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = out->get()[i] == 1
+        ? v8::True(env->isolate())
+        : v8::False(env->isolate());
+  }
+  *result = Array::New(env->isolate(), values.data(), values.size());
+  return Just(!result->IsEmpty());
+}
+
 }  // namespace crypto
 }  // namespace node
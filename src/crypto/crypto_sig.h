@@ -10,6 +10,8 @@
 #include "env.h"
 #include "memory_tracker.h"
 
+#include <vector>
+
 namespace node {
 namespace crypto {
 static const unsigned int kNoDsaSignature = static_cast<unsigned int>(-1);
@@ -162,6 +164,50 @@ struct SignTraits final {
 
 using SignJob = DeriveBitsJob<SignTraits>;
 
+// Verifies many signatures in a single job. All items share the digest and
+// signature options, each has its own key, data and signature.
+struct VerifyBatchConfiguration final : public MemoryRetainer {
+  CryptoJobMode job_mode;
+  std::vector<SignConfiguration> items;
+
+  VerifyBatchConfiguration() = default;
+
+  explicit VerifyBatchConfiguration(VerifyBatchConfiguration&& other) noexcept;
+
+  VerifyBatchConfiguration& operator=(
+      VerifyBatchConfiguration&& other) noexcept;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(VerifyBatchConfiguration)
+  SET_SELF_SIZE(VerifyBatchConfiguration)
+};
+
+struct VerifyBatchTraits final {
+  using AdditionalParameters = VerifyBatchConfiguration;
+  static constexpr const char* JobName = "VerifyBatchJob";
+  static constexpr AsyncWrap::ProviderType Provider =
+      AsyncWrap::PROVIDER_VERIFYREQUEST;
+
+  static v8::Maybe<bool> AdditionalConfig(
+      CryptoJobMode mode,
+      const v8::FunctionCallbackInfo<v8::Value>& args,
+      unsigned int offset,
+      VerifyBatchConfiguration* params);
+
+  static bool DeriveBits(
+      Environment* env,
+      const VerifyBatchConfiguration& params,
+      ByteSource* out);
+
+  static v8::Maybe<bool> EncodeOutput(
+      Environment* env,
+      const VerifyBatchConfiguration& params,
+      ByteSource* out,
+      v8::Local<v8::Value>* result);
+};
+
+using VerifyBatchJob = DeriveBitsJob<VerifyBatchTraits>;
+
 }  // namespace crypto
 }  // namespace node
 
@@ -22,6 +22,7 @@
 #include "crypto/crypto_tls.h"
 #include "crypto/crypto_context.h"
 #include "crypto/crypto_common.h"
+#include "crypto/crypto_session_cache.h"
 #include "crypto/crypto_util.h"
 #include "crypto/crypto_bio.h"
 #include "crypto/crypto_clienthello-inl.h"
@@ -32,8 +33,31 @@
 #include "node_buffer.h"
 #include "node_errors.h"
 #include "stream_base-inl.h"
+#include "threadpoolwork-inl.h"
 #include "util-inl.h"
 
+#include <openssl/async.h>
+#include <openssl/ec.h>
+#include <openssl/rsa.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#ifdef NODE_CRYPTO_HAVE_KTLS
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif  // NODE_CRYPTO_HAVE_KTLS
+
 namespace node {
 
 using v8::Array;
@@ -72,7 +96,16 @@ SSL_SESSION* GetSessionCallback(
     int* copy) {
   TLSWrap* w = static_cast<TLSWrap*>(SSL_get_app_data(s));
   *copy = 0;
-  return w->ReleaseSession();
+  SSL_SESSION* sess = w->ReleaseSession();
+  if (sess != nullptr)
+    return sess;
+
+  // Nothing was loaded from JS, try the sessions of the other threads.
+  SecureContext* sc = static_cast<SecureContext*>(
+      SSL_CTX_get_app_data(SSL_get_SSL_CTX(s)));
+  if (sc == nullptr || !sc->has_shared_session_cache())
+    return nullptr;
+  return SharedSessionCache::GetInstance()->Get(key, len).release();
 }
 
 void OnClientHello(
@@ -136,6 +169,11 @@ int NewSessionCallback(SSL* s, SSL_SESSION* sess) {
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
 
+  SecureContext* sc = static_cast<SecureContext*>(
+      SSL_CTX_get_app_data(SSL_get_SSL_CTX(s)));
+  if (w->is_server() && sc != nullptr && sc->has_shared_session_cache())
+    SharedSessionCache::GetInstance()->Put(sess);
+
   if (!w->has_session_callbacks())
     return 0;
 
@@ -327,6 +365,236 @@ std::string GetBIOError() {
 }
 }  // namespace
 
+// A private key operation that a suspended handshake is waiting for. The
+// async job OpenSSL runs SSL_read() and SSL_write() in for SSL_MODE_ASYNC
+// connections is paused while the operation runs on the thread pool, which
+// makes that SSL function return SSL_ERROR_WANT_ASYNC. Once the operation
+// is done the owning TLSWrap cycles again, which resumes the job.
+class PrivateKeyWork final : public ThreadPoolWork {
+ public:
+  // Computes the result into `out`, which has room for `out_size` bytes,
+  // and returns what the OpenSSL method it implements returns.
+  using Operation = std::function<int(unsigned char* out, unsigned int*)>;
+
+  PrivateKeyWork(TLSWrap* wrap, size_t out_size, Operation&& operation)
+      : ThreadPoolWork(wrap->env()),
+        wrap_(wrap),
+        out_(out_size),
+        operation_(std::move(operation)) {}
+
+  // Runs `operation` on the thread pool if it is needed by the TLSWrap that
+  // is currently in SSL_read() or SSL_write() on this thread, and inline
+  // otherwise.
+  static int Run(size_t out_size,
+                 Operation&& operation,
+                 unsigned char* out,
+                 unsigned int* out_len) {
+    TLSWrap* wrap = current_;
+    if (wrap == nullptr || ASYNC_get_current_job() == nullptr)
+      return operation(out, out_len);
+
+    CHECK_NULL(wrap->async_key_work_);
+    std::unique_ptr<PrivateKeyWork> work(
+        new PrivateKeyWork(wrap, out_size, std::move(operation)));
+    wrap->async_key_work_ = work.get();
+    work->ScheduleWork();
+    CHECK_EQ(ASYNC_pause_job(), 1);
+
+    if (work->abandoned_ || work->result_ <= 0)
+      return -1;
+    memcpy(out, work->out_.data(), work->out_len_);
+    *out_len = work->out_len_;
+    return work->result_;
+  }
+
+  // Called by TLSWrap::Destroy(). The suspended job is only released by
+  // OpenSSL once it runs to completion, so the SSL object has to be kept
+  // until the operation is done.
+  void Abandon(SSLPointer&& ssl) {
+    abandoned_ = true;
+    ssl_ = std::move(ssl);
+  }
+
+  void DoThreadPoolWork() override {
+    result_ = operation_(out_.data(), &out_len_);
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    if (status != 0)
+      result_ = -1;
+
+    // Resuming the job returns into Run(), which deletes this.
+    BaseObjectPtr<TLSWrap> wrap = std::move(wrap_);
+    SSLPointer ssl = std::move(ssl_);
+    wrap->async_key_work_ = nullptr;
+
+    HandleScope handle_scope(env()->isolate());
+    Context::Scope context_scope(env()->context());
+    if (ssl) {
+      // The resumed handshake fails, which lets the job finish.
+      ClearErrorOnReturn clear_error_on_return;
+      char c;
+      SSL_read(ssl.get(), &c, sizeof(c));
+      return;
+    }
+    wrap->Cycle();
+  }
+
+  // Set for the duration of each SSL_read() and SSL_write() of a TLSWrap.
+  class Scope {
+   public:
+    explicit Scope(TLSWrap* wrap) : previous_(current_) { current_ = wrap; }
+    ~Scope() { current_ = previous_; }
+
+   private:
+    TLSWrap* previous_;
+  };
+
+ private:
+  static thread_local TLSWrap* current_;
+
+  BaseObjectPtr<TLSWrap> wrap_;
+  SSLPointer ssl_;
+  std::vector<unsigned char> out_;
+  unsigned int out_len_ = 0;
+  Operation operation_;
+  int result_ = -1;
+  bool abandoned_ = false;
+};
+
+thread_local TLSWrap* PrivateKeyWork::current_ = nullptr;
+
+namespace {
+// The private key operations of keys created by NewAsyncPrivateKey(). They
+// only copy their input, the key itself is kept alive by the EVP_PKEY_CTX
+// of the suspended job until the operation is done.
+using RSAOperation =
+    int (*)(int, const unsigned char*, unsigned char*, RSA*, int);
+
+int AsyncRSAOperation(RSAOperation method,
+                      int flen,
+                      const unsigned char* from,
+                      unsigned char* to,
+                      RSA* rsa,
+                      int padding) {
+  std::vector<unsigned char> in(from, from + flen);
+  unsigned int to_len;
+  return PrivateKeyWork::Run(
+      RSA_size(rsa),
+      [=](unsigned char* out, unsigned int* out_len) {
+        int ret = method(in.size(), in.data(), out, rsa, padding);
+        *out_len = ret > 0 ? ret : 0;
+        return ret;
+      },
+      to,
+      &to_len);
+}
+
+int AsyncRSAPrivateEncrypt(int flen,
+                           const unsigned char* from,
+                           unsigned char* to,
+                           RSA* rsa,
+                           int padding) {
+  return AsyncRSAOperation(RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL()),
+                           flen, from, to, rsa, padding);
+}
+
+int AsyncRSAPrivateDecrypt(int flen,
+                           const unsigned char* from,
+                           unsigned char* to,
+                           RSA* rsa,
+                           int padding) {
+  return AsyncRSAOperation(RSA_meth_get_priv_dec(RSA_PKCS1_OpenSSL()),
+                           flen, from, to, rsa, padding);
+}
+
+int AsyncECDSASign(int type,
+                   const unsigned char* dgst,
+                   int dlen,
+                   unsigned char* sig,
+                   unsigned int* siglen,
+                   const BIGNUM* kinv,
+                   const BIGNUM* r,
+                   EC_KEY* eckey) {
+  int (*method)(int, const unsigned char*, int, unsigned char*,
+                unsigned int*, const BIGNUM*, const BIGNUM*, EC_KEY*);
+  EC_KEY_METHOD_get_sign(EC_KEY_OpenSSL(), &method, nullptr, nullptr);
+  // Precomputed values are not used by TLS, don't bother copying them.
+  if (kinv != nullptr || r != nullptr)
+    return method(type, dgst, dlen, sig, siglen, kinv, r, eckey);
+
+  std::vector<unsigned char> in(dgst, dgst + dlen);
+  return PrivateKeyWork::Run(
+      ECDSA_size(eckey),
+      [=](unsigned char* out, unsigned int* out_len) {
+        return method(type, in.data(), in.size(), out, out_len,
+                      nullptr, nullptr, eckey);
+      },
+      sig,
+      siglen);
+}
+
+const RSA_METHOD* GetAsyncRSAMethod() {
+  // Intentionally leaked, keys using it may outlive any Environment.
+  static const RSA_METHOD* method = []() {
+    RSA_METHOD* method = RSA_meth_dup(RSA_PKCS1_OpenSSL());
+    CHECK_NOT_NULL(method);
+    RSA_meth_set1_name(method, "node async RSA method");
+    RSA_meth_set_priv_enc(method, AsyncRSAPrivateEncrypt);
+    RSA_meth_set_priv_dec(method, AsyncRSAPrivateDecrypt);
+    return method;
+  }();
+  return method;
+}
+
+const EC_KEY_METHOD* GetAsyncECKeyMethod() {
+  // Intentionally leaked, keys using it may outlive any Environment.
+  static const EC_KEY_METHOD* method = []() {
+    EC_KEY_METHOD* method = EC_KEY_METHOD_new(EC_KEY_OpenSSL());
+    CHECK_NOT_NULL(method);
+    int (*sign_setup)(EC_KEY*, BN_CTX*, BIGNUM**, BIGNUM**);
+    ECDSA_SIG* (*sign_sig)(const unsigned char*, int, const BIGNUM*,
+                           const BIGNUM*, EC_KEY*);
+    EC_KEY_METHOD_get_sign(method, nullptr, &sign_setup, &sign_sig);
+    EC_KEY_METHOD_set_sign(method, AsyncECDSASign, sign_setup, sign_sig);
+    return method;
+  }();
+  return method;
+}
+}  // namespace
+
+EVPKeyPointer TLSWrap::NewAsyncPrivateKey(EVP_PKEY* pkey) {
+  EVPKeyPointer key(EVP_PKEY_new());
+  if (!key)
+    return EVPKeyPointer();
+
+  switch (EVP_PKEY_base_id(pkey)) {
+    case EVP_PKEY_RSA: {
+      RSAPointer rsa(RSAPrivateKey_dup(EVP_PKEY_get0_RSA(pkey)));
+      if (!rsa ||
+          !RSA_set_method(rsa.get(), GetAsyncRSAMethod()) ||
+          !EVP_PKEY_assign_RSA(key.get(), rsa.get())) {
+        return EVPKeyPointer();
+      }
+      rsa.release();
+      break;
+    }
+    case EVP_PKEY_EC: {
+      ECKeyPointer ec(EC_KEY_dup(EVP_PKEY_get0_EC_KEY(pkey)));
+      if (!ec ||
+          !EC_KEY_set_method(ec.get(), GetAsyncECKeyMethod()) ||
+          !EVP_PKEY_assign_EC_KEY(key.get(), ec.get())) {
+        return EVPKeyPointer();
+      }
+      ec.release();
+      break;
+    }
+    default:
+      return EVPKeyPointer();
+  }
+  return key;
+}
+
 TLSWrap::TLSWrap(Environment* env,
                  Local<Object> obj,
                  Kind kind,
@@ -349,6 +617,7 @@ TLSWrap::TLSWrap(Environment* env,
   stream->PushStreamListener(this);
 
   env_->isolate()->AdjustAmountOfExternalAllocatedMemory(kExternalSize);
+  native_memory::Track(native_memory::kTls, kExternalSize);
 
   InitSSL();
   Debug(this, "Created new TLSWrap");
@@ -608,11 +877,44 @@ void TLSWrap::EncOut() {
     return;
   }
 
+  NodeBIO* enc_out = NodeBIO::FromBIO(enc_out_);
+  size_t limit = enc_out->Length();
+#ifdef NODE_CRYPTO_HAVE_KTLS
+  int record_type;
+  limit = enc_out->NextSegment(&record_type);
+  if (record_type != NodeBIO::kCiphertext) {
+    // All data encrypted by OpenSSL has been written at this point, so the
+    // kernel can take over.
+    if (!ktls_send_) {
+      int err = InstallKTLSKeys();
+      if (err != 0) {
+        InvokeQueued(err);
+        return;
+      }
+    }
+    if (record_type != SSL3_RT_APPLICATION_DATA)
+      return WriteKTLSRecord(record_type, limit);
+  }
+#endif  // NODE_CRYPTO_HAVE_KTLS
+
   char* data[kSimultaneousBufferCount];
   size_t size[arraysize(data)];
   size_t count = arraysize(data);
-  write_size_ = NodeBIO::FromBIO(enc_out_)->PeekMultiple(data, size, &count);
+  write_size_ = enc_out->PeekMultiple(data, size, &count);
   CHECK(write_size_ != 0 && count != 0);
+  if (write_size_ > limit) {
+    // Don't mix data that needs to be written differently.
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (total + size[i] >= limit) {
+        size[i] = limit - total;
+        count = i + 1;
+        break;
+      }
+      total += size[i];
+    }
+    write_size_ = limit;
+  }
 
   uv_buf_t buf[arraysize(data)];
   uv_buf_t* bufs = buf;
@@ -638,6 +940,81 @@ void TLSWrap::EncOut() {
   }
 }
 
+#ifdef NODE_CRYPTO_HAVE_KTLS
+int TLSWrap::InstallKTLSKeys() {
+  std::vector<unsigned char> crypto_info =
+      NodeBIO::FromBIO(enc_out_)->TakeKTLSCryptoInfo();
+  CHECK(!crypto_info.empty());
+  int err = 0;
+  if (setsockopt(underlying_stream()->GetFD(),
+                 SOL_TLS,
+                 TLS_TX,
+                 crypto_info.data(),
+                 crypto_info.size()) != 0) {
+    err = -errno;
+  }
+  OPENSSL_cleanse(crypto_info.data(), crypto_info.size());
+  Debug(this, "Installed kTLS transmit keys, err = %d", err);
+  if (err == 0)
+    ktls_send_ = true;
+  return err;
+}
+
+void TLSWrap::WriteKTLSRecord(int record_type, size_t size) {
+  char* data[kSimultaneousBufferCount];
+  size_t sizes[arraysize(data)];
+  size_t count = arraysize(data);
+  NodeBIO* enc_out = NodeBIO::FromBIO(enc_out_);
+  enc_out->PeekMultiple(data, sizes, &count);
+
+  iovec iov[arraysize(data)];
+  size_t iovcnt = 0;
+  for (size_t i = 0; i < count && size > 0; i++) {
+    iov[i].iov_base = data[i];
+    iov[i].iov_len = std::min(sizes[i], size);
+    size -= iov[i].iov_len;
+    iovcnt++;
+  }
+
+  // The record type travels as ancillary data, which streams cannot carry,
+  // so this goes to the socket directly. Nothing else is queued on it,
+  // because EncOut() only gets here between writes. Records like this are
+  // small and rare, so they are written synchronously.
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(unsigned char))] = {};
+  msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+  *CMSG_DATA(cmsg) = static_cast<unsigned char>(record_type);
+
+  ssize_t written;
+  do
+    written = sendmsg(underlying_stream()->GetFD(), &msg, 0);
+  while (written == -1 && errno == EINTR);
+
+  if (written == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      InvokeQueued(-errno);
+      return;
+    }
+    Debug(this, "kTLS record write would block, retrying");
+    BaseObjectPtr<TLSWrap> strong_ref{this};
+    env()->SetImmediate([this, strong_ref](Environment* env) {
+      EncOut();
+    });
+    return;
+  }
+
+  enc_out->Read(nullptr, written);
+  EncOut();
+}
+#endif  // NODE_CRYPTO_HAVE_KTLS
+
 void TLSWrap::OnStreamAfterWrite(WriteWrap* req_wrap, int status) {
   Debug(this, "OnStreamAfterWrite(status = %d)", status);
   if (current_empty_write_) {
@@ -702,11 +1079,37 @@ void TLSWrap::ClearOut() {
     return;
   }
 
+  if (async_key_work_ != nullptr || async_key_op_ == AsyncKeyOp::kWrite) {
+    Debug(this, "Returning from ClearOut(), private key operation pending");
+    return;
+  }
+
   MarkPopErrorOnReturn mark_pop_error_on_return;
+  PrivateKeyWork::Scope private_key_scope(this);
 
   char out[kClearOutChunkSize];
   int read;
   for (;;) {
+    // When there are records to decrypt, decrypt them straight into the
+    // listener's buffer. Otherwise SSL_read() most likely only drives the
+    // handshake, and allocating a buffer for that would be wasted.
+    if (SSL_has_pending(ssl_.get()) || BIO_pending(enc_in_) > 0) {
+      uv_buf_t buf = EmitAlloc(kClearOutChunkSize);
+      read = SSL_read(ssl_.get(),
+                      buf.base,
+                      std::min<size_t>(buf.len, kClearOutChunkSize));
+      Debug(this, "Read %d bytes of cleartext output", read);
+      // A zero-length read hands the buffer back.
+      EmitRead(read > 0 ? read : 0, buf);
+      if (ssl_ == nullptr) {
+        Debug(this, "Returning from read loop, ssl_ == nullptr");
+        return;
+      }
+      if (read <= 0)
+        break;
+      continue;
+    }
+
     read = SSL_read(ssl_.get(), out, sizeof(out));
     Debug(this, "Read %d bytes of cleartext output", read);
 
@@ -736,6 +1139,13 @@ void TLSWrap::ClearOut() {
     }
   }
 
+  if (GetSSLError(read) == SSL_ERROR_WANT_ASYNC) {
+    Debug(this, "SSL_read() is waiting for a private key operation");
+    async_key_op_ = AsyncKeyOp::kRead;
+    return;
+  }
+  async_key_op_ = AsyncKeyOp::kNone;
+
   int flags = SSL_get_shutdown(ssl_.get());
   if (!eof_ && flags & SSL_RECEIVED_SHUTDOWN) {
     eof_ = true;
@@ -824,8 +1234,14 @@ void TLSWrap::ClearIn() {
     return;
   }
 
+  if (async_key_work_ != nullptr || async_key_op_ == AsyncKeyOp::kRead) {
+    Debug(this, "Returning from ClearIn(), private key operation pending");
+    return;
+  }
+
   std::unique_ptr<BackingStore> bs = std::move(pending_cleartext_input_);
   MarkPopErrorOnReturn mark_pop_error_on_return;
+  PrivateKeyWork::Scope private_key_scope(this);
 
   NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(bs->ByteLength());
   int written = SSL_write(ssl_.get(), bs->Data(), bs->ByteLength());
@@ -835,11 +1251,14 @@ void TLSWrap::ClearIn() {
   // All written
   if (written != -1) {
     Debug(this, "Successfully wrote all data to SSL");
+    async_key_op_ = AsyncKeyOp::kNone;
     return;
   }
 
   // Error or partial write
   int err = GetSSLError(written);
+  async_key_op_ = err == SSL_ERROR_WANT_ASYNC ? AsyncKeyOp::kWrite
+                                               : AsyncKeyOp::kNone;
   if (err == SSL_ERROR_SSL || err == SSL_ERROR_SYSCALL) {
     Debug(this, "Got SSL error (%d)", err);
     write_callback_scheduled_ = true;
@@ -855,6 +1274,30 @@ void TLSWrap::ClearIn() {
   pending_cleartext_input_ = std::move(bs);
 }
 
+// The retry of an SSL_write() in ClearIn() must not change the record size,
+// so it is only picked for the first attempt.
+void TLSWrap::UpdateSendFragment(size_t length) {
+#ifdef SSL_set_max_send_fragment
+  if (!dynamic_record_sizing_)
+    return;
+
+  uint64_t now = uv_now(env()->event_loop());
+  if (now - last_write_time_ >= kDynamicRecordIdleTimeout)
+    dynamic_record_bytes_ = 0;
+  last_write_time_ = now;
+
+  size_t fragment = max_send_fragment_;
+  if (dynamic_record_bytes_ < kDynamicRecordThreshold)
+    fragment = std::min(fragment, kDynamicRecordSmallSize);
+  dynamic_record_bytes_ += length;
+
+  if (fragment != send_fragment_ &&
+      SSL_set_max_send_fragment(ssl_.get(), fragment) == 1) {
+    send_fragment_ = fragment;
+  }
+#endif  // SSL_set_max_send_fragment
+}
+
 std::string TLSWrap::diagnostic_name() const {
   std::string name = "TLSWrap ";
   name += is_server() ? "server (" : "client (";
@@ -972,8 +1415,13 @@ int TLSWrap::DoWrite(WriteWrap* w,
 
   std::unique_ptr<BackingStore> bs;
   MarkPopErrorOnReturn mark_pop_error_on_return;
+  PrivateKeyWork::Scope private_key_scope(this);
 
   int written = 0;
+  // While a handshake is suspended, leave the data to ClearIn(), which
+  // knows when SSL_write() may be called again.
+  const bool can_write =
+      async_key_work_ == nullptr && async_key_op_ != AsyncKeyOp::kRead;
 
   // It is common for zero length buffers to be written,
   // don't copy data if there there is one buffer with data
@@ -981,9 +1429,10 @@ int TLSWrap::DoWrite(WriteWrap* w,
   // _http_outgoing.js writes a zero length buffer in
   // in OutgoingMessage.prototype.end.  If there was a large amount
   // of data supplied to end() there is no sense allocating
-  // and copying it when it could just be used.
+  // and copying it when it could just be used. That is not the case with
+  // SSL_MODE_ASYNC, a suspended SSL_write() reads the data once resumed.
 
-  if (nonempty_count != 1) {
+  if (nonempty_count != 1 || (SSL_get_mode(ssl_.get()) & SSL_MODE_ASYNC)) {
     {
       NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
       bs = ArrayBuffer::NewBackingStore(env()->isolate(), length);
@@ -996,12 +1445,14 @@ int TLSWrap::DoWrite(WriteWrap* w,
     }
 
     NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(length);
-    written = SSL_write(ssl_.get(), bs->Data(), length);
+    UpdateSendFragment(length);
+    written = can_write ? SSL_write(ssl_.get(), bs->Data(), length) : -1;
   } else {
     // Only one buffer: try to write directly, only store if it fails
     uv_buf_t* buf = &bufs[nonempty_i];
     NodeBIO::FromBIO(enc_out_)->set_allocate_tls_hint(buf->len);
-    written = SSL_write(ssl_.get(), buf->base, buf->len);
+    UpdateSendFragment(buf->len);
+    written = can_write ? SSL_write(ssl_.get(), buf->base, buf->len) : -1;
 
     if (written == -1) {
       NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
@@ -1013,9 +1464,15 @@ int TLSWrap::DoWrite(WriteWrap* w,
   CHECK(written == -1 || written == static_cast<int>(length));
   Debug(this, "Writing %zu bytes, written = %d", length, written);
 
+  if (can_write) {
+    async_key_op_ = GetSSLError(written) == SSL_ERROR_WANT_ASYNC
+                        ? AsyncKeyOp::kWrite
+                        : AsyncKeyOp::kNone;
+  }
+
   if (written == -1) {
     // If we stopped writing because of an error, it's fatal, discard the data.
-    int err = GetSSLError(written);
+    int err = can_write ? GetSSLError(written) : SSL_ERROR_WANT_ASYNC;
     if (err == SSL_ERROR_SSL || err == SSL_ERROR_SYSCALL) {
       // TODO(@jasnell): What are we doing with the error?
       Debug(this, "Got SSL error (%d), returning UV_EPROTO", err);
@@ -1101,8 +1558,12 @@ int TLSWrap::DoShutdown(ShutdownWrap* req_wrap) {
   Debug(this, "DoShutdown()");
   MarkPopErrorOnReturn mark_pop_error_on_return;
 
-  if (ssl_ && SSL_shutdown(ssl_.get()) == 0)
+  // SSL_shutdown() would resume a suspended handshake. It does not send
+  // anything during the handshake anyway.
+  if (ssl_ && async_key_op_ == AsyncKeyOp::kNone &&
+      SSL_shutdown(ssl_.get()) == 0) {
     SSL_shutdown(ssl_.get());
+  }
 
   shutdown_ = true;
   EncOut();
@@ -1164,6 +1625,35 @@ void TLSWrap::EnableKeylogCallback(const FunctionCallbackInfo<Value>& args) {
   wrap->sc_->SetKeylogCallback(KeylogCallback);
 }
 
+// Lets OpenSSL hand its transmit keys to the kernel after the handshake
+// (SSL_OP_ENABLE_KTLS). From then on, the underlying socket is written to in
+// plaintext and encrypted by the kernel, while reads still go through
+// OpenSSL. This has to happen before the handshake starts, and needs a
+// connected TCP socket. OpenSSL silently keeps encrypting itself if it
+// cannot offload the negotiated cipher.
+void TLSWrap::EnableKTLS(const FunctionCallbackInfo<Value>& args) {
+  TLSWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+
+  int err = UV_ENOTSUP;
+#ifdef NODE_CRYPTO_HAVE_KTLS
+  int fd = wrap->underlying_stream()->GetFD();
+  if (!wrap->ssl_ || !SSL_in_before(wrap->ssl_.get())) {
+    err = UV_EINVAL;
+  } else if (fd >= 0) {
+    err = 0;
+    // This only makes the socket accept the TLS socket options.
+    if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0 &&
+        errno != EEXIST) {
+      err = -errno;
+    }
+  }
+  if (err == 0)
+    SSL_set_options(wrap->ssl_.get(), SSL_OP_ENABLE_KTLS);
+#endif
+  args.GetReturnValue().Set(err);
+}
+
 // Check required capabilities were not excluded from the OpenSSL build:
 // - OPENSSL_NO_SSL_TRACE excludes SSL_trace()
 // - OPENSSL_NO_STDIO excludes BIO_new_fp()
@@ -1215,6 +1705,9 @@ void TLSWrap::Destroy() {
   InvokeQueued(UV_ECANCELED, "Canceled because of SSL destruction");
 
   env()->isolate()->AdjustAmountOfExternalAllocatedMemory(-kExternalSize);
+  native_memory::Track(native_memory::kTls, -kExternalSize);
+  if (async_key_work_ != nullptr)
+    async_key_work_->Abandon(std::move(ssl_));
   ssl_.reset();
 
   enc_in_ = nullptr;
@@ -1982,11 +2475,30 @@ void TLSWrap::SetMaxSendFragment(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   TLSWrap* w;
   ASSIGN_OR_RETURN_UNWRAP(&w, args.Holder());
-  int rv = SSL_set_max_send_fragment(
-      w->ssl_.get(),
-      args[0]->Int32Value(env->context()).FromJust());
+  int size = args[0]->Int32Value(env->context()).FromJust();
+  int rv = SSL_set_max_send_fragment(w->ssl_.get(), size);
+  if (rv == 1)
+    w->send_fragment_ = w->max_send_fragment_ = size;
   args.GetReturnValue().Set(rv);
 }
+
+// setDynamicRecordSizing(enabled) makes the records sent at the start of the
+// connection, and after it has been idle, small enough for the peer to
+// decrypt each of them as soon as its first TCP segment arrives.
+void TLSWrap::SetDynamicRecordSizing(const FunctionCallbackInfo<Value>& args) {
+  TLSWrap* w;
+  ASSIGN_OR_RETURN_UNWRAP(&w, args.Holder());
+  CHECK(args[0]->IsBoolean());
+  CHECK_NOT_NULL(w->ssl_);
+  w->dynamic_record_sizing_ = args[0]->IsTrue();
+  w->dynamic_record_bytes_ = 0;
+  w->last_write_time_ = 0;
+  if (!w->dynamic_record_sizing_ &&
+      w->send_fragment_ != w->max_send_fragment_ &&
+      SSL_set_max_send_fragment(w->ssl_.get(), w->max_send_fragment_) == 1) {
+    w->send_fragment_ = w->max_send_fragment_;
+  }
+}
 #endif  // SSL_set_max_send_fragment
 
 void TLSWrap::Initialize(
@@ -2025,6 +2537,7 @@ void TLSWrap::Initialize(
   env->SetProtoMethod(t, "endParser", EndParser);
   env->SetProtoMethod(t, "enableKeylogCallback", EnableKeylogCallback);
   env->SetProtoMethod(t, "enableSessionCallbacks", EnableSessionCallbacks);
+  env->SetProtoMethod(t, "enableKTLS", EnableKTLS);
   env->SetProtoMethod(t, "enableTrace", EnableTrace);
   env->SetProtoMethod(t, "getServername", GetServername);
   env->SetProtoMethod(t, "loadSession", LoadSession);
@@ -2062,6 +2575,7 @@ void TLSWrap::Initialize(
 
 #ifdef SSL_set_max_send_fragment
   env->SetProtoMethod(t, "setMaxSendFragment", SetMaxSendFragment);
+  env->SetProtoMethod(t, "setDynamicRecordSizing", SetDynamicRecordSizing);
 #endif  // SSL_set_max_send_fragment
 
 #ifndef OPENSSL_NO_PSK
@@ -2088,6 +2602,7 @@ void TLSWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(EndParser);
   registry->Register(EnableKeylogCallback);
   registry->Register(EnableSessionCallbacks);
+  registry->Register(EnableKTLS);
   registry->Register(EnableTrace);
   registry->Register(GetServername);
   registry->Register(LoadSession);
@@ -2120,6 +2635,7 @@ void TLSWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
 
 #ifdef SSL_set_max_send_fragment
   registry->Register(SetMaxSendFragment);
+  registry->Register(SetDynamicRecordSizing);
 #endif  // SSL_set_max_send_fragment
 
 #ifndef OPENSSL_NO_PSK
@@ -38,6 +38,8 @@
 namespace node {
 namespace crypto {
 
+class PrivateKeyWork;
+
 class TLSWrap : public AsyncWrap,
                 public StreamBase,
                 public StreamListener {
@@ -55,6 +57,12 @@ class TLSWrap : public AsyncWrap,
 
   ~TLSWrap() override;
 
+  // Returns a copy of the RSA or EC private key `pkey` whose signing and
+  // decryption run on the thread pool when they are needed by a connection
+  // that uses SSL_MODE_ASYNC, see SecureContext::EnableAsyncPrivateKey().
+  // Returns an empty pointer for other key types.
+  static EVPKeyPointer NewAsyncPrivateKey(EVP_PKEY* pkey);
+
   bool is_cert_cb_running() const { return cert_cb_running_; }
   bool is_waiting_cert_cb() const { return cert_cb_ != nullptr; }
   bool has_session_callbacks() const { return session_callbacks_; }
@@ -87,6 +95,10 @@ class TLSWrap : public AsyncWrap,
   const char* Error() const override;
   // Reset error_ string to empty. Not related to "clear text".
   void ClearError() override;
+  // Those of the socket underneath, which counts the encrypted bytes.
+  ServerCounters* server_counters() override {
+    return stream() != nullptr ? stream()->server_counters() : nullptr;
+  }
 
   v8::MaybeLocal<v8::ArrayBufferView> ocsp_response() const;
   void ClearOcspResponse();
@@ -103,6 +115,17 @@ class TLSWrap : public AsyncWrap,
   std::string diagnostic_name() const override;
 
  private:
+  friend class PrivateKeyWork;
+
+  // Where an SSL_read() or SSL_write() stopped for a private key operation.
+  // OpenSSL resumes the suspended job from whichever SSL function runs next,
+  // so only the function that started it may be called until it is done.
+  enum class AsyncKeyOp {
+    kNone,
+    kRead,
+    kWrite
+  };
+
   // OpenSSL structures are opaque. Estimate SSL memory size for OpenSSL 1.1.1b:
   //   SSL: 6224
   //   SSL->SSL3_STATE: 1040
@@ -121,6 +144,14 @@ class TLSWrap : public AsyncWrap,
   // Maximum number of buffers passed to uv_write()
   static constexpr int kSimultaneousBufferCount = 10;
 
+  // With dynamic record sizing, records are kept small enough to fit a
+  // single TCP segment until kDynamicRecordThreshold bytes have been written,
+  // and again after the connection has been idle for
+  // kDynamicRecordIdleTimeout milliseconds.
+  static constexpr size_t kDynamicRecordSmallSize = 1369;
+  static constexpr uint64_t kDynamicRecordThreshold = 128 * 1024;
+  static constexpr uint64_t kDynamicRecordIdleTimeout = 1000;
+
   typedef void (*CertCb)(void* arg);
 
   // Alternative to StreamListener::stream(), that returns a StreamBase instead
@@ -146,7 +177,14 @@ class TLSWrap : public AsyncWrap,
   // EncIn() doesn't exist. Encrypted data is pushed from underlying stream into
   // enc_in_ via the stream listener's OnStreamAlloc()/OnStreamRead() interface.
   void EncOut();  // Write encrypted data from enc_out_ to underlying stream.
+  // Passes the keys from enc_out_ to the kernel, see EnableKTLS().
+  int InstallKTLSKeys();
+  // Writes a non-application record, which the kernel has to encrypt with
+  // the given record type.
+  void WriteKTLSRecord(int record_type, size_t size);
   void ClearIn();  // SSL_write() clear data "in" to SSL.
+  // Picks the record size for an SSL_write() of `length` bytes.
+  void UpdateSendFragment(size_t length);
   void ClearOut();  // SSL_read() clear text "out" from SSL.
   void Destroy();
 
@@ -177,6 +215,7 @@ class TLSWrap : public AsyncWrap,
       const v8::FunctionCallbackInfo<v8::Value>& args);
   static void EnableSessionCallbacks(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void EnableKTLS(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void EnableTrace(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void EndParser(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void ExportKeyingMaterial(
@@ -221,6 +260,8 @@ class TLSWrap : public AsyncWrap,
 #ifdef SSL_set_max_send_fragment
   static void SetMaxSendFragment(
       const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetDynamicRecordSizing(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
 #endif  // SSL_set_max_send_fragment
 
 #ifndef OPENSSL_NO_PSK
@@ -275,6 +316,20 @@ class TLSWrap : public AsyncWrap,
   // is set to true, so it's likely redundant.
   bool established_ = false;
   bool write_callback_scheduled_ = false;
+  // Set once the kernel encrypts everything written to the socket.
+  bool ktls_send_ = false;
+
+  bool dynamic_record_sizing_ = false;
+  uint64_t dynamic_record_bytes_ = 0;
+  uint64_t last_write_time_ = 0;
+  // The record size currently set on ssl_, and the one set by
+  // setMaxSendFragment(), which dynamic record sizing never exceeds.
+  size_t send_fragment_ = SSL3_RT_MAX_PLAIN_LENGTH;
+  size_t max_send_fragment_ = SSL3_RT_MAX_PLAIN_LENGTH;
+
+  AsyncKeyOp async_key_op_ = AsyncKeyOp::kNone;
+  // The private key operation the handshake is waiting for, if any.
+  PrivateKeyWork* async_key_work_ = nullptr;
 
   int cycle_depth_ = 0;
 
@@ -20,6 +20,10 @@
 
 #include <openssl/rand.h>
 
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
 namespace node {
 
 using v8::ArrayBuffer;
@@ -36,6 +40,7 @@ using v8::Maybe;
 using v8::MaybeLocal;
 using v8::NewStringType;
 using v8::Nothing;
+using v8::Number;
 using v8::Object;
 using v8::String;
 using v8::TryCatch;
@@ -83,6 +88,77 @@ bool EntropySource(unsigned char* buffer, size_t length) {
   return RAND_bytes(buffer, length) != -1;
 }
 
+namespace {
+struct ParallelTasks {
+  const std::function<bool(size_t)>* task;
+  size_t count;
+  std::atomic<size_t> next{0};
+  std::atomic<bool> failed{false};
+
+  void Run() {
+    for (;;) {
+      size_t index = next++;
+      if (index >= count || failed)
+        return;
+      if (!(*task)(index))
+        failed = true;
+    }
+  }
+};
+
+std::atomic<int>* SpareParallelTaskThreads() {
+  static std::atomic<int> spare([]() {
+    uv_cpu_info_t* cpu_infos;
+    int count;
+    if (uv_cpu_info(&cpu_infos, &count) != 0)
+      return 0;
+    uv_free_cpu_info(cpu_infos, count);
+    return count - 1;
+  }());
+  return &spare;
+}
+}  // namespace
+
+bool RunParallelTasks(size_t count,
+                      size_t max_threads,
+                      const std::function<bool(size_t)>& task) {
+  ParallelTasks tasks;
+  tasks.task = &task;
+  tasks.count = count;
+
+  // Take as many helper threads from the budget as are available.
+  std::atomic<int>* spare = SpareParallelTaskThreads();
+  int wanted = static_cast<int>(
+      std::min<size_t>(std::min(count, max_threads), INT_MAX)) - 1;
+  int helpers = 0;
+  if (wanted > 0) {
+    int available = spare->load();
+    do {
+      helpers = std::min(wanted, available);
+      if (helpers <= 0) {
+        helpers = 0;
+        break;
+      }
+    } while (!spare->compare_exchange_weak(available, available - helpers));
+  }
+
+  std::vector<uv_thread_t> threads(helpers);
+  int started = 0;
+  for (; started < helpers; started++) {
+    if (uv_thread_create(&threads[started], [](void* arg) {
+          static_cast<ParallelTasks*>(arg)->Run();
+        }, &tasks) != 0) {
+      break;
+    }
+  }
+
+  tasks.Run();
+  for (int i = 0; i < started; i++)
+    CHECK_EQ(uv_thread_join(&threads[i]), 0);
+  *spare += helpers;
+  return !tasks.failed;
+}
+
 int PasswordCallback(char* buf, int size, int rwflag, void* u) {
   const ByteSource* passphrase = *static_cast<const ByteSource**>(u);
   if (passphrase != nullptr) {
@@ -195,6 +271,123 @@ void InitCryptoOnce() {
   NodeBIO::GetMethod();
 }
 
+namespace {
+class AlgorithmCache final {
+ public:
+  static AlgorithmCache* GetInstance() {
+    // Intentionally leaked, worker threads may still use it during exit.
+    static AlgorithmCache* cache = new AlgorithmCache();
+    return cache;
+  }
+
+  const EVP_MD* GetDigest(const char* name) {
+    return Get(&digests_, name, [](const char* name) {
+      const EVP_MD* md = EVP_get_digestbyname(name);
+#if OPENSSL_VERSION_MAJOR >= 3
+      // Aliases such as RSA-SHA256 are only known to the legacy name table.
+      MarkPopErrorOnReturn mark_pop_error_on_return;
+      if (EVP_MD* fetched = EVP_MD_fetch(
+              nullptr, md != nullptr ? EVP_MD_get0_name(md) : name, nullptr)) {
+        return static_cast<const EVP_MD*>(fetched);
+      }
+#endif
+      return md;
+    });
+  }
+
+  const EVP_CIPHER* GetCipher(const char* name) {
+    return Get(&ciphers_, name, [](const char* name) {
+      const EVP_CIPHER* cipher = EVP_get_cipherbyname(name);
+#if OPENSSL_VERSION_MAJOR >= 3
+      MarkPopErrorOnReturn mark_pop_error_on_return;
+      const char* fetch_name =
+          cipher != nullptr ? EVP_CIPHER_get0_name(cipher) : name;
+      if (EVP_CIPHER* fetched = EVP_CIPHER_fetch(nullptr, fetch_name, nullptr))
+        return static_cast<const EVP_CIPHER*>(fetched);
+#endif
+      return cipher;
+    });
+  }
+
+  // Algorithms that were fetched under different default properties, e.g.
+  // before FIPS mode was changed, must not be handed out anymore. They are
+  // still not freed, since jobs may hold on to them.
+  void Reset() {
+    RwLock::ScopedWriteLock lock(lock_);
+    digests_.clear();
+    ciphers_.clear();
+  }
+
+#if OPENSSL_VERSION_MAJOR >= 3
+  void Prefetch() {
+    RwLock::ScopedWriteLock lock(lock_);
+    EVP_MD_do_all_provided(nullptr, [](EVP_MD* md, void* arg) {
+      if (!EVP_MD_up_ref(md))
+        return;
+      auto* digests = static_cast<Map<EVP_MD>*>(arg);
+      std::pair<Map<EVP_MD>*, const EVP_MD*> entry(digests, md);
+      EVP_MD_names_do_all(md, [](const char* name, void* arg) {
+        auto* entry = static_cast<std::pair<Map<EVP_MD>*, const EVP_MD*>*>(arg);
+        entry->first->emplace(name, entry->second);
+      }, &entry);
+    }, &digests_);
+    EVP_CIPHER_do_all_provided(nullptr, [](EVP_CIPHER* cipher, void* arg) {
+      if (!EVP_CIPHER_up_ref(cipher))
+        return;
+      auto* ciphers = static_cast<Map<EVP_CIPHER>*>(arg);
+      std::pair<Map<EVP_CIPHER>*, const EVP_CIPHER*> entry(ciphers, cipher);
+      EVP_CIPHER_names_do_all(cipher, [](const char* name, void* arg) {
+        auto* entry =
+            static_cast<std::pair<Map<EVP_CIPHER>*, const EVP_CIPHER*>*>(arg);
+        entry->first->emplace(name, entry->second);
+      }, &entry);
+    }, &ciphers_);
+  }
+#endif  // OPENSSL_VERSION_MAJOR >= 3
+
+ private:
+  template <typename T>
+  using Map = std::unordered_map<std::string, const T*>;
+
+  // Only successful lookups are cached, so the maps can't grow much past the
+  // number of names the algorithms have.
+  template <typename T, typename Lookup>
+  const T* Get(Map<T>* map, const char* name, Lookup lookup) {
+    {
+      RwLock::ScopedReadLock lock(lock_);
+      auto it = map->find(name);
+      if (it != map->end())
+        return it->second;
+    }
+    const T* algorithm = lookup(name);
+    if (algorithm != nullptr) {
+      RwLock::ScopedWriteLock lock(lock_);
+      map->emplace(name, algorithm);
+    }
+    return algorithm;
+  }
+
+  RwLock lock_;
+  Map<EVP_MD> digests_;
+  Map<EVP_CIPHER> ciphers_;
+};
+}  // namespace
+
+const EVP_MD* GetDigestByName(const char* name) {
+  return AlgorithmCache::GetInstance()->GetDigest(name);
+}
+
+const EVP_CIPHER* GetCipherByName(const char* name) {
+  return AlgorithmCache::GetInstance()->GetCipher(name);
+}
+
+void PrefetchAlgorithms() {
+#if OPENSSL_VERSION_MAJOR >= 3
+  static uv_once_t once = UV_ONCE_INIT;
+  uv_once(&once, []() { AlgorithmCache::GetInstance()->Prefetch(); });
+#endif
+}
+
 void GetFipsCrypto(const FunctionCallbackInfo<Value>& args) {
 #if OPENSSL_VERSION_MAJOR >= 3
   args.GetReturnValue().Set(EVP_default_properties_is_fips_enabled(nullptr) ?
@@ -224,6 +417,7 @@ void SetFipsCrypto(const FunctionCallbackInfo<Value>& args) {
     unsigned long err = ERR_get_error();  // NOLINT(runtime/int)
     return ThrowCryptoError(env, err);
   }
+  AlgorithmCache::GetInstance()->Reset();
 }
 
 void TestFipsCrypto(const v8::FunctionCallbackInfo<v8::Value>& args) {
@@ -303,7 +497,8 @@ MaybeLocal<Value> CryptoErrorStore::ToException(
 ByteSource::ByteSource(ByteSource&& other) noexcept
     : data_(other.data_),
       allocated_data_(other.allocated_data_),
-      size_(other.size_) {
+      size_(other.size_),
+      pinned_store_(std::move(other.pinned_store_)) {
   other.allocated_data_ = nullptr;
 }
 
@@ -315,6 +510,7 @@ void ByteSource::reset() {
   OPENSSL_clear_free(allocated_data_, size_);
   data_ = nullptr;
   size_ = 0;
+  pinned_store_.reset();
 }
 
 ByteSource& ByteSource::operator=(ByteSource&& other) noexcept {
@@ -324,6 +520,7 @@ ByteSource& ByteSource::operator=(ByteSource&& other) noexcept {
     allocated_data_ = other.allocated_data_;
     other.allocated_data_ = nullptr;
     size_ = other.size_;
+    pinned_store_ = std::move(other.pinned_store_);
   }
   return *this;
 }
@@ -457,6 +654,14 @@ ByteSource ByteSource::Foreign(const char* data, size_t size) {
   return ByteSource(data, nullptr, size);
 }
 
+ByteSource ByteSource::Pinned(std::shared_ptr<BackingStore> store,
+                              const char* data,
+                              size_t size) {
+  ByteSource source(data, nullptr, size);
+  source.pinned_store_ = std::move(store);
+  return source;
+}
+
 namespace error {
 Maybe<bool> Decorate(Environment* env, Local<Object> obj,
               unsigned long err) {  // NOLINT(runtime/int)
@@ -677,6 +882,23 @@ Maybe<bool> SetEncodedValue(
   return target->Set(env->context(), name, value);
 }
 
+namespace {
+// 0 if inputs to async jobs are always copied.
+std::atomic<size_t> job_input_pinning_threshold{0};
+// Async jobs with less input than this are run inline. For the digests and
+// HMACs that qualify, that is well below the cost of a threadpool round trip.
+std::atomic<size_t> inline_job_threshold{1024};
+}  // namespace
+
+bool ShouldPinJobInput(size_t size) {
+  size_t threshold = job_input_pinning_threshold;
+  return threshold > 0 && size >= threshold;
+}
+
+bool ShouldRunJobInline(size_t size) {
+  return size < inline_job_threshold;
+}
+
 CryptoJobMode GetCryptoJobMode(v8::Local<v8::Value> args) {
   CHECK(args->IsUint32());
   uint32_t mode = args.As<v8::Uint32>()->Value();
@@ -713,6 +935,22 @@ void SecureBuffer(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(Uint8Array::New(buffer, 0, len));
 }
 
+// setJobInputPinningThreshold(bytes) makes async jobs keep inputs of at least
+// `bytes` bytes in place instead of copying them. Callers then must not modify
+// such inputs until the job has completed. 0 turns pinning off again.
+void SetJobInputPinningThreshold(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsNumber());
+  job_input_pinning_threshold = args[0].As<Number>()->Value();
+}
+
+// setInlineJobThreshold(bytes) sets the input size below which async jobs
+// that support it are run on the main thread. 0 sends all of them to the
+// threadpool.
+void SetInlineJobThreshold(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsNumber());
+  inline_job_threshold = args[0].As<Number>()->Value();
+}
+
 void SecureHeapUsed(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   if (CRYPTO_secure_malloc_initialized())
@@ -723,6 +961,8 @@ void SecureHeapUsed(const FunctionCallbackInfo<Value>& args) {
 
 namespace Util {
 void Initialize(Environment* env, Local<Object> target) {
+  PrefetchAlgorithms();
+
 #ifndef OPENSSL_NO_ENGINE
   env->SetMethod(target, "setEngine", SetEngine);
 #endif  // !OPENSSL_NO_ENGINE
@@ -736,6 +976,10 @@ void Initialize(Environment* env, Local<Object> target) {
 
   env->SetMethod(target, "secureBuffer", SecureBuffer);
   env->SetMethod(target, "secureHeapUsed", SecureHeapUsed);
+  env->SetMethod(target,
+                 "setJobInputPinningThreshold",
+                 SetJobInputPinningThreshold);
+  env->SetMethod(target, "setInlineJobThreshold", SetInlineJobThreshold);
 }
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
 #ifndef OPENSSL_NO_ENGINE
@@ -747,6 +991,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(TestFipsCrypto);
   registry->Register(SecureBuffer);
   registry->Register(SecureHeapUsed);
+  registry->Register(SetJobInputPinningThreshold);
+  registry->Register(SetInlineJobThreshold);
 }
 
 }  // namespace Util
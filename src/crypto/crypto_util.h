@@ -30,6 +30,8 @@
 #endif  // OPENSSL_FIPS
 
 #include <algorithm>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -54,6 +56,8 @@ constexpr size_t kSizeOf_HMAC_CTX = 32;
 
 // Define smart pointers for the most commonly used OpenSSL types:
 using X509Pointer = DeleteFnPtr<X509, X509_free>;
+using X509StorePointer = DeleteFnPtr<X509_STORE, X509_STORE_free>;
+using X509NamePointer = DeleteFnPtr<X509_NAME, X509_NAME_free>;
 using BIOPointer = DeleteFnPtr<BIO, BIO_free_all>;
 using SSLCtxPointer = DeleteFnPtr<SSL_CTX, SSL_CTX_free>;
 using SSLSessionPointer = DeleteFnPtr<SSL_SESSION, SSL_SESSION_free>;
@@ -78,6 +82,11 @@ using RsaPointer = DeleteFnPtr<RSA, RSA_free>;
 using DsaPointer = DeleteFnPtr<DSA, DSA_free>;
 using DsaSigPointer = DeleteFnPtr<DSA_SIG, DSA_SIG_free>;
 
+struct StackOfX509Deleter {
+  void operator()(STACK_OF(X509)* p) const { sk_X509_pop_free(p, X509_free); }
+};
+using StackOfX509 = std::unique_ptr<STACK_OF(X509), StackOfX509Deleter>;
+
 // Our custom implementation of the certificate verify callback
 // used when establishing a TLS handshake. Because we cannot perform
 // I/O quickly enough with X509_STORE_CTX_ APIs in this callback,
@@ -137,6 +146,15 @@ void CheckEntropy();
 // may not be truly random but it's still generally good enough.
 bool EntropySource(unsigned char* buffer, size_t length);
 
+// Runs task(0) to task(count - 1) on up to `max_threads` threads, the
+// calling one included, and returns false if any of them failed. This lets
+// a DeriveBits step split independent parts of its work across cores. Helper
+// threads come from a process-wide budget of one per CPU, so tasks simply
+// run on fewer threads when many jobs do this at once.
+bool RunParallelTasks(size_t count,
+                      size_t max_threads,
+                      const std::function<bool(size_t)>& task);
+
 int PasswordCallback(char* buf, int size, int rwflag, void* u);
 
 int NoPasswordCallback(char* buf, int size, int rwflag, void* u);
@@ -274,6 +292,11 @@ class ByteSource {
 
   static ByteSource Allocated(char* data, size_t size);
   static ByteSource Foreign(const char* data, size_t size);
+  // Refers to data inside of `store`, which is kept alive for as long as the
+  // ByteSource is.
+  static ByteSource Pinned(std::shared_ptr<v8::BackingStore> store,
+                           const char* data,
+                           size_t size);
 
   static ByteSource FromEncodedString(Environment* env,
                                       v8::Local<v8::String> value,
@@ -306,6 +329,7 @@ class ByteSource {
   const char* data_ = nullptr;
   char* allocated_data_ = nullptr;
   size_t size_ = 0;
+  std::shared_ptr<v8::BackingStore> pinned_store_;
 
   ByteSource(const char* data, char* allocated_data, size_t size);
 };
@@ -317,6 +341,32 @@ enum CryptoJobMode {
 
 CryptoJobMode GetCryptoJobMode(v8::Local<v8::Value> args);
 
+// Whether an input of `size` bytes to an async job should be pinned rather
+// than copied, see ArrayBufferOrViewContents::ToJobInput().
+bool ShouldPinJobInput(size_t size);
+
+// Whether an async job with `size` bytes of input should be run on the
+// calling thread, see CryptoJob::Run().
+bool ShouldRunJobInline(size_t size);
+
+// The number of input bytes a job has to process. Jobs whose cost is linear
+// in their input, and small for small inputs, provide an overload for their
+// parameters so that they can be run inline. All others always go to the
+// threadpool.
+template <typename AdditionalParams>
+size_t JobInputSize(const AdditionalParams& params) {
+  return std::numeric_limits<size_t>::max();
+}
+
+// Looks up digests and ciphers through a process-wide cache. With OpenSSL 3,
+// the cache holds algorithms fetched from the providers, so that neither the
+// lookup nor the init calls that use the result need to go through the
+// locked provider tables again. The returned pointers are never freed.
+const EVP_MD* GetDigestByName(const char* name);
+const EVP_CIPHER* GetCipherByName(const char* name);
+// Fills the cache with every digest and cipher the providers offer.
+void PrefetchAlgorithms();
+
 template <typename CryptoJobTraits>
 class CryptoJob : public AsyncWrap, public ThreadPoolWork {
  public:
@@ -402,8 +452,19 @@ class CryptoJob : public AsyncWrap, public ThreadPoolWork {
 
     CryptoJob<CryptoJobTraits>* job;
     ASSIGN_OR_RETURN_UNWRAP(&job, args.Holder());
-    if (job->mode() == kCryptoJobAsync)
-      return job->ScheduleWork();
+    if (job->mode() == kCryptoJobAsync) {
+      if (!ShouldRunJobInline(JobInputSize(*job->params())))
+        return job->ScheduleWork();
+
+      // Scheduling the work would cost more than doing it, but the result
+      // is still delivered from a later turn of the event loop, exactly as
+      // it would be from the threadpool.
+      job->DoThreadPoolWork();
+      env->SetImmediate([job](Environment* env) {
+        job->AfterThreadPoolWork(env->can_call_into_js() ? 0 : UV_ECANCELED);
+      });
+      return;
+    }
 
     v8::Local<v8::Value> ret[2];
     env->PrintSyncTrace();
@@ -683,6 +744,21 @@ class ArrayBufferOrViewContents {
     return ByteSource::Foreign(data(), size());
   }
 
+  // Returns the contents as an input for a job that runs in `mode`. Sync jobs
+  // use the contents in place. Async jobs get a copy, unless pinning has been
+  // enabled with setJobInputPinningThreshold() for inputs of this size. The
+  // ByteSource then keeps the backing store alive instead, and the caller
+  // must not modify the contents until the job has completed.
+  inline ByteSource ToJobInput(CryptoJobMode mode) const {
+    if (mode == kCryptoJobSync)
+      return ToByteSource();
+    if (store_ && size() > 0 && ShouldPinJobInput(size())) {
+      return ByteSource::Pinned(
+          store_, reinterpret_cast<const char*>(data()), size());
+    }
+    return ToCopy();
+  }
+
   inline ByteSource ToCopy() const {
     if (size() == 0) return ByteSource();
     char* buf = MallocOpenSSL<char>(size());
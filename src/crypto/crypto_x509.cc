@@ -10,7 +10,9 @@
 #include "util-inl.h"
 #include "v8.h"
 
+#include <list>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace node {
@@ -29,7 +31,54 @@ using v8::Value;
 
 namespace crypto {
 
-ManagedX509::ManagedX509(X509Pointer&& cert) : cert_(std::move(cert)) {}
+namespace {
+// Keeps the ManagedX509s of the most recently seen peer certificates, keyed
+// by the SHA-256 digest of their DER encoding.
+class ManagedX509Cache final {
+ public:
+  static constexpr size_t kMaxEntries = 256;
+
+  static ManagedX509Cache* GetInstance() {
+    // Intentionally leaked, worker threads may still use it during exit.
+    static ManagedX509Cache* cache = new ManagedX509Cache();
+    return cache;
+  }
+
+  std::shared_ptr<ManagedX509> Intern(X509Pointer&& cert) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_size;
+    if (!X509_digest(cert.get(), EVP_sha256(), md, &md_size))
+      return std::make_shared<ManagedX509>(std::move(cert));
+    std::string key(reinterpret_cast<const char*>(md), md_size);
+
+    Mutex::ScopedLock lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->second;
+    }
+
+    lru_.emplace_front(key, std::make_shared<ManagedX509>(std::move(cert)));
+    index_[key] = lru_.begin();
+    if (lru_.size() > kMaxEntries) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+    return lru_.front().second;
+  }
+
+ private:
+  typedef std::pair<std::string, std::shared_ptr<ManagedX509>> Entry;
+
+  Mutex mutex_;
+  std::list<Entry> lru_;  // Most recently used first.
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+}  // namespace
+
+ManagedX509::ManagedX509(X509Pointer&& cert)
+    : cert_(std::move(cert)),
+      fields_(std::make_shared<DecodedFields>()) {}
 
 ManagedX509::ManagedX509(const ManagedX509& that) {
   *this = that;
@@ -37,6 +86,7 @@ ManagedX509::ManagedX509(const ManagedX509& that) {
 
 ManagedX509& ManagedX509::operator=(const ManagedX509& that) {
   cert_.reset(that.get());
+  fields_ = that.fields_;
 
   if (cert_)
     X509_up_ref(cert_.get());
@@ -44,11 +94,79 @@ ManagedX509& ManagedX509::operator=(const ManagedX509& that) {
   return *this;
 }
 
+std::shared_ptr<ManagedX509> ManagedX509::Intern(X509Pointer&& cert) {
+  return ManagedX509Cache::GetInstance()->Intern(std::move(cert));
+}
+
+bool ManagedX509::GetDecodedField(Field field,
+                                  std::string* value,
+                                  bool* present) const {
+  if (!fields_)
+    return false;
+  Mutex::ScopedLock lock(fields_->mutex);
+  if (!(fields_->decoded & (1 << field)))
+    return false;
+  *present = fields_->present & (1 << field);
+  *value = fields_->values[field];
+  return true;
+}
+
+void ManagedX509::SetDecodedField(Field field,
+                                  std::string&& value,
+                                  bool present) {
+  if (!fields_)
+    return;
+  Mutex::ScopedLock lock(fields_->mutex);
+  fields_->decoded |= 1 << field;
+  if (present)
+    fields_->present |= 1 << field;
+  fields_->values[field] = std::move(value);
+}
+
 void ManagedX509::MemoryInfo(MemoryTracker* tracker) const {
   // This is an approximation based on the der encoding size.
   int size = i2d_X509(cert_.get(), nullptr);
   tracker->TrackFieldWithSize("cert", size);
+  if (fields_) {
+    size_t fields_size = 0;
+    for (const std::string& value : fields_->values)
+      fields_size += value.size();
+    tracker->TrackFieldWithSize("fields", fields_size);
+  }
+}
+
+namespace {
+typedef MaybeLocal<Value> (*DecodeField)(Environment* env, X509* cert);
+
+// Returns the field decoded by `decode`, which is only called if no
+// X509Certificate sharing the same ManagedX509 has done so yet.
+void ReturnDecodedField(const FunctionCallbackInfo<Value>& args,
+                        X509Certificate* cert,
+                        ManagedX509::Field field,
+                        DecodeField decode) {
+  Environment* env = Environment::GetCurrent(args);
+  std::string value;
+  bool present;
+  Local<Value> ret;
+  if (cert->managed()->GetDecodedField(field, &value, &present)) {
+    if (!present)
+      return args.GetReturnValue().SetUndefined();
+    if (node::ToV8Value(env->context(), value).ToLocal(&ret))
+      args.GetReturnValue().Set(ret);
+    return;
+  }
+
+  if (!decode(env, cert->get()).ToLocal(&ret))
+    return;
+  if (ret->IsString()) {
+    Utf8Value str(env->isolate(), ret);
+    cert->managed()->SetDecodedField(field, str.ToString(), true);
+  } else if (ret->IsUndefined()) {
+    cert->managed()->SetDecodedField(field, std::string(), false);
+  }
+  args.GetReturnValue().Set(ret);
 }
+}  // namespace
 
 Local<FunctionTemplate> X509Certificate::GetConstructorTemplate(
     Environment* env) {
@@ -104,6 +222,22 @@ MaybeLocal<Object> X509Certificate::New(
     Environment* env,
     std::shared_ptr<ManagedX509> cert,
     STACK_OF(X509)* issuer_chain) {
+  IssuerChain chain;
+  if (issuer_chain != nullptr) {
+    chain.reserve(sk_X509_num(issuer_chain));
+    for (int i = 0; i < sk_X509_num(issuer_chain); i++) {
+      X509* issuer = sk_X509_value(issuer_chain, i);
+      X509_up_ref(issuer);
+      chain.emplace_back(ManagedX509::Intern(X509Pointer(issuer)));
+    }
+  }
+  return New(env, std::move(cert), std::move(chain));
+}
+
+MaybeLocal<Object> X509Certificate::New(
+    Environment* env,
+    std::shared_ptr<ManagedX509> cert,
+    IssuerChain&& issuer_chain) {
   EscapableHandleScope scope(env->isolate());
   Local<Function> ctor;
   if (!GetConstructorTemplate(env)->GetFunction(env->context()).ToLocal(&ctor))
@@ -113,7 +247,7 @@ MaybeLocal<Object> X509Certificate::New(
   if (!ctor->NewInstance(env->context()).ToLocal(&obj))
     return MaybeLocal<Object>();
 
-  new X509Certificate(env, obj, std::move(cert), issuer_chain);
+  new X509Certificate(env, obj, std::move(cert), std::move(issuer_chain));
   return scope.Escape(obj);
 }
 
@@ -152,9 +286,7 @@ MaybeLocal<Object> X509Certificate::GetPeerCert(
     sk_X509_delete(ssl_certs, 0);
   }
 
-  return sk_X509_num(ssl_certs)
-      ? New(env, std::move(cert), ssl_certs)
-      : New(env, std::move(cert));
+  return New(env, ManagedX509::Intern(std::move(cert)), ssl_certs);
 }
 
 void X509Certificate::Parse(const FunctionCallbackInfo<Value>& args) {
@@ -192,90 +324,90 @@ void X509Certificate::Parse(const FunctionCallbackInfo<Value>& args) {
 }
 
 void X509Certificate::Subject(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  BIOPointer bio(BIO_new(BIO_s_mem()));
-  Local<Value> ret;
-  if (GetSubject(env, bio, cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kSubject,
+                     [](Environment* env, X509* cert) {
+    BIOPointer bio(BIO_new(BIO_s_mem()));
+    return GetSubject(env, bio, cert);
+  });
 }
 
 void X509Certificate::Issuer(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  BIOPointer bio(BIO_new(BIO_s_mem()));
-  Local<Value> ret;
-  if (GetIssuerString(env, bio, cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kIssuer,
+                     [](Environment* env, X509* cert) {
+    BIOPointer bio(BIO_new(BIO_s_mem()));
+    return GetIssuerString(env, bio, cert);
+  });
 }
 
 void X509Certificate::SubjectAltName(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  BIOPointer bio(BIO_new(BIO_s_mem()));
-  Local<Value> ret;
-  if (GetSubjectAltNameString(env, bio, cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kSubjectAltName,
+                     [](Environment* env, X509* cert) {
+    BIOPointer bio(BIO_new(BIO_s_mem()));
+    return GetSubjectAltNameString(env, bio, cert);
+  });
 }
 
 void X509Certificate::InfoAccess(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  BIOPointer bio(BIO_new(BIO_s_mem()));
-  Local<Value> ret;
-  if (GetInfoAccessString(env, bio, cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kInfoAccess,
+                     [](Environment* env, X509* cert) {
+    BIOPointer bio(BIO_new(BIO_s_mem()));
+    return GetInfoAccessString(env, bio, cert);
+  });
 }
 
 void X509Certificate::ValidFrom(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  BIOPointer bio(BIO_new(BIO_s_mem()));
-  Local<Value> ret;
-  if (GetValidFrom(env, cert->get(), bio).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kValidFrom,
+                     [](Environment* env, X509* cert) {
+    BIOPointer bio(BIO_new(BIO_s_mem()));
+    return GetValidFrom(env, cert, bio);
+  });
 }
 
 void X509Certificate::ValidTo(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  BIOPointer bio(BIO_new(BIO_s_mem()));
-  Local<Value> ret;
-  if (GetValidTo(env, cert->get(), bio).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kValidTo,
+                     [](Environment* env, X509* cert) {
+    BIOPointer bio(BIO_new(BIO_s_mem()));
+    return GetValidTo(env, cert, bio);
+  });
 }
 
 void X509Certificate::Fingerprint(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  Local<Value> ret;
-  if (GetFingerprintDigest(env, EVP_sha1(), cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kFingerprint,
+                     [](Environment* env, X509* cert) {
+    return GetFingerprintDigest(env, EVP_sha1(), cert);
+  });
 }
 
 void X509Certificate::Fingerprint256(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  Local<Value> ret;
-  if (GetFingerprintDigest(env, EVP_sha256(), cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kFingerprint256,
+                     [](Environment* env, X509* cert) {
+    return GetFingerprintDigest(env, EVP_sha256(), cert);
+  });
 }
 
 void X509Certificate::Fingerprint512(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  Local<Value> ret;
-  if (GetFingerprintDigest(env, EVP_sha512(), cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kFingerprint512,
+                     [](Environment* env, X509* cert) {
+    return GetFingerprintDigest(env, EVP_sha512(), cert);
+  });
 }
 
 void X509Certificate::KeyUsage(const FunctionCallbackInfo<Value>& args) {
@@ -288,12 +420,9 @@ void X509Certificate::KeyUsage(const FunctionCallbackInfo<Value>& args) {
 }
 
 void X509Certificate::SerialNumber(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
-  Local<Value> ret;
-  if (GetSerialNumber(env, cert->get()).ToLocal(&ret))
-    args.GetReturnValue().Set(ret);
+  ReturnDecodedField(args, cert, ManagedX509::kSerialNumber, GetSerialNumber);
 }
 
 void X509Certificate::Raw(const FunctionCallbackInfo<Value>& args) {
@@ -475,8 +604,19 @@ void X509Certificate::ToLegacy(const FunctionCallbackInfo<Value>& args) {
 }
 
 void X509Certificate::GetIssuerCert(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
   X509Certificate* cert;
   ASSIGN_OR_RETURN_UNWRAP(&cert, args.Holder());
+  if (!cert->issuer_cert_ && !cert->issuer_chain_.empty()) {
+    std::shared_ptr<ManagedX509> issuer = std::move(cert->issuer_chain_[0]);
+    IssuerChain rest(std::make_move_iterator(cert->issuer_chain_.begin() + 1),
+                     std::make_move_iterator(cert->issuer_chain_.end()));
+    cert->issuer_chain_.clear();
+    Local<Object> obj;
+    if (!New(env, std::move(issuer), std::move(rest)).ToLocal(&obj))
+      return;
+    cert->issuer_cert_.reset(Unwrap<X509Certificate>(obj));
+  }
   if (cert->issuer_cert_)
     args.GetReturnValue().Set(cert->issuer_cert_->object());
 }
@@ -485,25 +625,16 @@ X509Certificate::X509Certificate(
     Environment* env,
     Local<Object> object,
     std::shared_ptr<ManagedX509> cert,
-    STACK_OF(X509)* issuer_chain)
+    IssuerChain&& issuer_chain)
     : BaseObject(env, object),
-      cert_(std::move(cert)) {
+      cert_(std::move(cert)),
+      issuer_chain_(std::move(issuer_chain)) {
   MakeWeak();
-
-  if (issuer_chain != nullptr && sk_X509_num(issuer_chain)) {
-    X509Pointer cert(X509_dup(sk_X509_value(issuer_chain, 0)));
-    sk_X509_delete(issuer_chain, 0);
-    Local<Object> obj = sk_X509_num(issuer_chain)
-        ? X509Certificate::New(env, std::move(cert), issuer_chain)
-            .ToLocalChecked()
-        : X509Certificate::New(env, std::move(cert))
-            .ToLocalChecked();
-    issuer_cert_.reset(Unwrap<X509Certificate>(obj));
-  }
 }
 
 void X509Certificate::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("cert", cert_);
+  tracker->TrackField("issuer_chain", issuer_chain_);
 }
 
 BaseObjectPtr<BaseObject>
@@ -7,9 +7,14 @@
 #include "crypto/crypto_util.h"
 #include "env.h"
 #include "memory_tracker.h"
+#include "node_mutex.h"
 #include "node_worker.h"
 #include "v8.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace node {
 namespace crypto {
 
@@ -17,22 +22,58 @@ namespace crypto {
 // X509 objects that allows an X509Certificate instance to
 // be cloned at the JS level while pointing at the same
 // underlying X509 instance.
+//
+// It also remembers the fields that X509Certificate has decoded as strings,
+// so that they are only decoded once no matter how many X509Certificate
+// instances, possibly in different threads, share the certificate.
 class ManagedX509 : public MemoryRetainer {
  public:
+  enum Field {
+    kSubject,
+    kIssuer,
+    kSubjectAltName,
+    kInfoAccess,
+    kValidFrom,
+    kValidTo,
+    kFingerprint,
+    kFingerprint256,
+    kFingerprint512,
+    kSerialNumber,
+    kFieldCount
+  };
+
   ManagedX509() = default;
   explicit ManagedX509(X509Pointer&& cert);
   ManagedX509(const ManagedX509& that);
   ManagedX509& operator=(const ManagedX509& that);
 
+  // Returns the ManagedX509 that already holds a certificate with the same
+  // DER encoding as `cert`, if one is still cached, so that peers that
+  // present the same certificates again do not have them decoded again.
+  static std::shared_ptr<ManagedX509> Intern(X509Pointer&& cert);
+
   operator bool() const { return !!cert_; }
   X509* get() const { return cert_.get(); }
 
+  // Returns false if `field` has not been decoded yet. Otherwise, `present`
+  // is set to false if the certificate does not have the field.
+  bool GetDecodedField(Field field, std::string* value, bool* present) const;
+  void SetDecodedField(Field field, std::string&& value, bool present);
+
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(ManagedX509)
   SET_SELF_SIZE(ManagedX509)
 
  private:
+  struct DecodedFields {
+    Mutex mutex;
+    uint32_t decoded = 0;
+    uint32_t present = 0;
+    std::string values[kFieldCount];
+  };
+
   X509Pointer cert_;
+  std::shared_ptr<DecodedFields> fields_;
 };
 
 class X509Certificate : public BaseObject {
@@ -98,6 +139,7 @@ class X509Certificate : public BaseObject {
   static void GetIssuerCert(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   X509* get() { return cert_->get(); }
+  ManagedX509* managed() { return cert_.get(); }
 
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(X509Certificate)
@@ -126,13 +168,22 @@ class X509Certificate : public BaseObject {
   std::unique_ptr<worker::TransferData> CloneForMessaging() const override;
 
  private:
+  typedef std::vector<std::shared_ptr<ManagedX509>> IssuerChain;
+
   X509Certificate(
       Environment* env,
       v8::Local<v8::Object> object,
       std::shared_ptr<ManagedX509> cert,
-      STACK_OF(X509)* issuer_chain = nullptr);
+      IssuerChain&& issuer_chain);
+
+  static v8::MaybeLocal<v8::Object> New(
+      Environment* env,
+      std::shared_ptr<ManagedX509> cert,
+      IssuerChain&& issuer_chain);
 
   std::shared_ptr<ManagedX509> cert_;
+  // The issuers are only wrapped once getIssuerCert() asks for them.
+  IssuerChain issuer_chain_;
   BaseObjectPtr<X509Certificate> issuer_cert_;
 };
 
@@ -59,6 +59,10 @@ inline MultiIsolatePlatform* IsolateData::platform() const {
   return platform_;
 }
 
+inline bool IsolateData::created_from_snapshot() const {
+  return created_from_snapshot_;
+}
+
 inline void IsolateData::set_worker_context(worker::Worker* context) {
   CHECK_NULL(worker_context_);  // Should be set only once.
   worker_context_ = context;
@@ -120,6 +124,26 @@ inline v8::Local<v8::String> AsyncHooks::provider_string(int idx) {
   return env()->isolate_data()->async_wrap_provider(idx);
 }
 
+inline v8::Local<v8::Value> AsyncHooks::context_frame() {
+  return PersistentToLocal::Strong(context_frame_);
+}
+
+inline void AsyncHooks::set_context_frame(v8::Local<v8::Value> frame) {
+  context_frame_.Reset(env()->isolate(), frame);
+}
+
+inline bool AsyncHooks::EnterContextFrame(const v8::Global<v8::Value>& frame,
+                                          v8::Global<v8::Value>* prior) {
+  if (frame.IsEmpty() && context_frame_.IsEmpty()) return false;
+  *prior = std::move(context_frame_);
+  context_frame_.Reset(env()->isolate(), frame);
+  return true;
+}
+
+inline void AsyncHooks::ExitContextFrame(v8::Global<v8::Value>* prior) {
+  context_frame_ = std::move(*prior);
+}
+
 inline void AsyncHooks::no_force_checks() {
   fields_[kCheck] -= 1;
 }
@@ -297,7 +321,8 @@ inline size_t Environment::async_callback_scope_depth() const {
 }
 
 inline void Environment::PushAsyncCallbackScope() {
-  async_callback_scope_depth_++;
+  if (async_callback_scope_depth_++ == 0)
+    loop_phase_state_.callbacks++;
 }
 
 inline void Environment::PopAsyncCallbackScope() {
@@ -497,6 +522,32 @@ void Environment::DecreaseWaitingRequestCounter() {
   CHECK_GE(request_waiting_, 0);
 }
 
+void Environment::ThreadPoolWorkStarted() {
+  threadpool_queued_work_--;
+}
+
+const std::shared_ptr<Histogram>&
+Environment::threadpool_queue_wait_histogram() {
+  return threadpool_queue_wait_histogram_;
+}
+
+const std::shared_ptr<Histogram>&
+Environment::threadpool_queue_depth_histogram() {
+  return threadpool_queue_depth_histogram_;
+}
+
+inline const std::shared_ptr<Histogram>&
+Environment::loop_phase_histogram(LoopPhaseMetric metric) {
+  CHECK_LT(metric, kLoopPhaseMetricCount);
+  return loop_phase_histograms_[metric];
+}
+
+inline const std::shared_ptr<Histogram>&
+Environment::task_queue_drain_histogram(TaskQueueDrainMetric metric) {
+  CHECK_LT(metric, kTaskQueueDrainMetricCount);
+  return task_queue_drain_histograms_[metric];
+}
+
 inline uv_loop_t* Environment::event_loop() const {
   return isolate_data()->event_loop();
 }
@@ -799,27 +850,27 @@ template <typename Fn>
 void Environment::SetImmediateThreadsafe(Fn&& cb, CallbackFlags::Flags flags) {
   auto callback = native_immediates_threadsafe_.CreateCallback(
       std::move(cb), flags);
-  {
-    Mutex::ScopedLock lock(native_immediates_threadsafe_mutex_);
-    native_immediates_threadsafe_.Push(std::move(callback));
-    if (task_queues_async_initialized_)
-      uv_async_send(&task_queues_async_);
-  }
+  if (native_immediates_threadsafe_.Push(std::move(callback)))
+    SendTaskQueuesAsync();
 }
 
 template <typename Fn>
 void Environment::RequestInterrupt(Fn&& cb) {
   auto callback = native_immediates_interrupts_.CreateCallback(
       std::move(cb), CallbackFlags::kRefed);
-  {
-    Mutex::ScopedLock lock(native_immediates_threadsafe_mutex_);
-    native_immediates_interrupts_.Push(std::move(callback));
-    if (task_queues_async_initialized_)
-      uv_async_send(&task_queues_async_);
-  }
+  if (native_immediates_interrupts_.Push(std::move(callback)))
+    SendTaskQueuesAsync();
   RequestInterruptFromV8();
 }
 
+// Only the producer that found a threadsafe queue empty needs to wake up the
+// loop; everything pushed afterwards is picked up by the same PopAll() call.
+inline void Environment::SendTaskQueuesAsync() {
+  Mutex::ScopedLock lock(native_immediates_threadsafe_mutex_);
+  if (task_queues_async_initialized_)
+    uv_async_send(&task_queues_async_);
+}
+
 inline bool Environment::can_call_into_js() const {
   return can_call_into_js_ && !is_stopping();
 }
@@ -971,8 +1022,15 @@ inline IsolateData* Environment::isolate_data() const {
   return isolate_data_;
 }
 
+inline bool ReadBufferPool::Owns(char* data) const {
+  return in_use_.count(data) != 0;
+}
+
 inline uv_buf_t Environment::allocate_managed_buffer(
     const size_t suggested_size) {
+  if (char* data = read_buffer_pool_.Acquire(suggested_size))
+    return uv_buf_init(data, suggested_size);
+
   NoArrayBufferZeroFillScope no_zero_fill_scope(isolate_data());
   std::unique_ptr<v8::BackingStore> bs =
       v8::ArrayBuffer::NewBackingStore(isolate(), suggested_size);
@@ -982,15 +1040,28 @@ inline uv_buf_t Environment::allocate_managed_buffer(
 }
 
 inline std::unique_ptr<v8::BackingStore> Environment::release_managed_buffer(
-    const uv_buf_t& buf) {
+    const uv_buf_t& buf, size_t used) {
   std::unique_ptr<v8::BackingStore> bs;
-  if (buf.base != nullptr) {
-    auto map = released_allocated_buffers();
-    auto it = map->find(buf.base);
-    CHECK_NE(it, map->end());
-    bs = std::move(it->second);
-    map->erase(it);
+  if (buf.base == nullptr) return bs;
+  CHECK_LE(used, buf.len);
+
+  if (read_buffer_pool_.Owns(buf.base)) {
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(isolate_data());
+      bs = v8::ArrayBuffer::NewBackingStore(isolate(), used);
+    }
+    if (used > 0) memcpy(bs->Data(), buf.base, used);
+    read_buffer_pool_.Release(buf.base);
+    return bs;
   }
+
+  auto map = released_allocated_buffers();
+  auto it = map->find(buf.base);
+  CHECK_NE(it, map->end());
+  bs = std::move(it->second);
+  map->erase(it);
+  if (used != bs->ByteLength())
+    bs = v8::BackingStore::Reallocate(isolate(), std::move(bs), used);
   return bs;
 }
 
@@ -1173,9 +1244,11 @@ inline void Environment::SetConstructorFunction(
       tmpl->GetFunction(context()).ToLocalChecked()).Check();
 }
 
-void Environment::AddCleanupHook(CleanupCallback fn, void* arg) {
+void Environment::AddCleanupHook(CleanupCallback fn,
+                                 void* arg,
+                                 bool critical) {
   auto insertion_info = cleanup_hooks_.emplace(CleanupHookCallback {
-    fn, arg, cleanup_hook_counter_++
+    fn, arg, cleanup_hook_counter_++, critical
   });
   // Make sure there was no existing element with these values.
   CHECK_EQ(insertion_info.second, true);
@@ -2,19 +2,24 @@
 #include "allocated_buffer-inl.h"
 #include "async_wrap.h"
 #include "base_object-inl.h"
+#include "cppgc/platform.h"
+#include "cppgc_helpers.h"
 #include "debug_utils-inl.h"
 #include "diagnosticfilename-inl.h"
+#include "histogram-inl.h"
 #include "memory_tracker-inl.h"
 #include "node_buffer.h"
 #include "node_context_data.h"
 #include "node_errors.h"
 #include "node_internals.h"
+#include "node_log_sink.h"
 #include "node_options-inl.h"
 #include "node_process-inl.h"
 #include "node_v8_platform-inl.h"
 #include "node_worker.h"
 #include "req_wrap-inl.h"
 #include "stream_base.h"
+#include "stream_wrap.h"
 #include "tracing/agent.h"
 #include "tracing/traced_value.h"
 #include "util-inl.h"
@@ -27,6 +32,7 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 
 namespace node {
 
@@ -43,10 +49,13 @@ using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
+using v8::MicrotaskQueue;
 using v8::NewStringType;
 using v8::Number;
 using v8::Object;
 using v8::Private;
+using v8::Promise;
+using v8::PromiseHookType;
 using v8::Script;
 using v8::SnapshotCreator;
 using v8::StackTrace;
@@ -198,7 +207,8 @@ IsolateData::IsolateData(Isolate* isolate,
       event_loop_(event_loop),
       node_allocator_(node_allocator == nullptr ? nullptr
                                                 : node_allocator->GetImpl()),
-      platform_(platform) {
+      platform_(platform),
+      created_from_snapshot_(indexes != nullptr) {
   options_.reset(
       new PerIsolateOptions(*(per_process::cli_options->per_isolate)));
 
@@ -207,6 +217,30 @@ IsolateData::IsolateData(Isolate* isolate,
   } else {
     DeserializeProperties(indexes);
   }
+
+  if (platform != nullptr && isolate->GetCppHeap() == nullptr) {
+    // The page allocator of the process-wide GC info table outlives any
+    // platform, so leave it to cppgc.
+    static std::once_flag cppgc_initialized;
+    std::call_once(cppgc_initialized, []() {
+      cppgc::InitializeProcess(nullptr);
+    });
+    v8::CppHeapCreateParams params{
+        {},
+        v8::WrapperDescriptor(CppgcMixin::kEmbedderType,
+                              CppgcMixin::kSlot,
+                              CppgcMixin::kEmbedderId)};
+    cpp_heap_ = v8::CppHeap::Create(platform, params);
+    isolate->AttachCppHeap(cpp_heap_.get());
+  }
+}
+
+IsolateData::~IsolateData() {
+  if (cpp_heap_) {
+    // This runs the destructors of the CppgcMixin objects that are left.
+    isolate_->DetachCppHeap();
+    cpp_heap_->Terminate();
+  }
 }
 
 void IsolateData::MemoryInfo(MemoryTracker* tracker) const {
@@ -576,8 +610,8 @@ void Environment::InitializeLibuv() {
   {
     Mutex::ScopedLock lock(native_immediates_threadsafe_mutex_);
     task_queues_async_initialized_ = true;
-    if (native_immediates_threadsafe_.size() > 0 ||
-        native_immediates_interrupts_.size() > 0) {
+    if (!native_immediates_threadsafe_.empty() ||
+        !native_immediates_interrupts_.empty()) {
       uv_async_send(&task_queues_async_);
     }
   }
@@ -653,10 +687,14 @@ void Environment::StartProfilerIdleNotifier() {
   uv_prepare_start(&idle_prepare_handle_, [](uv_prepare_t* handle) {
     Environment* env = ContainerOf(&Environment::idle_prepare_handle_, handle);
     env->isolate()->SetIdle(true);
+    if (env->loop_phase_histograms_enabled_)
+      env->RecordLoopPrepare();
   });
   uv_check_start(&idle_check_handle_, [](uv_check_t* handle) {
     Environment* env = ContainerOf(&Environment::idle_check_handle_, handle);
     env->isolate()->SetIdle(false);
+    if (env->loop_phase_histograms_enabled_)
+      env->RecordLoopCheck();
   });
 }
 
@@ -681,8 +719,8 @@ void Environment::RunCleanup() {
 
   while (!cleanup_hooks_.empty() ||
          native_immediates_.size() > 0 ||
-         native_immediates_threadsafe_.size() > 0 ||
-         native_immediates_interrupts_.size() > 0) {
+         !native_immediates_threadsafe_.empty() ||
+         !native_immediates_interrupts_.empty()) {
     // Copy into a vector, since we can't sort an unordered_set in-place.
     std::vector<CleanupHookCallback> callbacks(
         cleanup_hooks_.begin(), cleanup_hooks_.end());
@@ -725,17 +763,43 @@ void Environment::RunAtExitCallbacks() {
   at_exit_functions_.clear();
 }
 
-void Environment::AtExit(void (*cb)(void* arg), void* arg) {
-  at_exit_functions_.push_front(ExitCallback{cb, arg});
+void Environment::AtExit(void (*cb)(void* arg), void* arg, bool critical) {
+  at_exit_functions_.push_front(ExitCallback{cb, arg, critical});
+}
+
+void Environment::RunCriticalExitHooks() {
+  TraceEventScope trace_scope(TRACING_CATEGORY_NODE1(environment),
+                              "RunCriticalExitHooks", this);
+  std::vector<CleanupHookCallback> callbacks;
+  for (const CleanupHookCallback& cb : cleanup_hooks_) {
+    if (cb.critical_) callbacks.push_back(cb);
+  }
+  std::sort(callbacks.begin(), callbacks.end(),
+            [](const CleanupHookCallback& a, const CleanupHookCallback& b) {
+    return a.insertion_order_counter_ > b.insertion_order_counter_;
+  });
+  for (const CleanupHookCallback& cb : callbacks) {
+    // As in RunCleanup(), an earlier hook may have removed this one.
+    if (cleanup_hooks_.count(cb) == 0) continue;
+    cb.fn_(cb.arg_);
+    cleanup_hooks_.erase(cb);
+  }
+
+  for (auto it = at_exit_functions_.begin(); it != at_exit_functions_.end();) {
+    ExitCallback at_exit = *it;
+    if (!at_exit.critical_) {
+      ++it;
+      continue;
+    }
+    it = at_exit_functions_.erase(it);
+    at_exit.cb_(at_exit.arg_);
+  }
 }
 
 void Environment::RunAndClearInterrupts() {
-  while (native_immediates_interrupts_.size() > 0) {
+  while (!native_immediates_interrupts_.empty()) {
     NativeImmediateQueue queue;
-    {
-      Mutex::ScopedLock lock(native_immediates_threadsafe_mutex_);
-      queue.ConcatMove(std::move(native_immediates_interrupts_));
-    }
+    native_immediates_interrupts_.PopAll(&queue);
     DebugSealHandleScope seal_handle_scope(isolate());
 
     while (auto head = queue.Shift())
@@ -784,18 +848,13 @@ void Environment::RunAndClearNativeImmediates(bool only_refed) {
   if (immediate_info()->ref_count() == 0)
     ToggleImmediateRef(false);
 
-  // It is safe to check .size() first, because there is a causal relationship
-  // between pushes to the threadsafe immediate list and this function being
-  // called. For the common case, it's worth checking the size first before
-  // establishing a mutex lock.
+  // The threadsafe immediate list is taken over in a single atomic exchange,
+  // so no lock is needed here.
   // This is intentionally placed after the `ref_count` handling, because when
   // refed threadsafe immediates are created, they are not counted towards the
   // count in immediate_info() either.
   NativeImmediateQueue threadsafe_immediates;
-  if (native_immediates_threadsafe_.size() > 0) {
-    Mutex::ScopedLock lock(native_immediates_threadsafe_mutex_);
-    threadsafe_immediates.ConcatMove(std::move(native_immediates_threadsafe_));
-  }
+  native_immediates_threadsafe_.PopAll(&threadsafe_immediates);
   while (drain_list(&threadsafe_immediates)) {}
 }
 
@@ -851,6 +910,10 @@ void Environment::RunTimers(uv_timer_t* handle) {
   Environment* env = Environment::from_timer_handle(handle);
   TraceEventScope trace_scope(TRACING_CATEGORY_NODE1(environment),
                               "RunTimers", env);
+  uint64_t start = env->loop_phase_histograms_enabled_ ? uv_hrtime() : 0;
+  auto record_phase = OnScopeLeave([&]() {
+    if (start != 0) env->RecordLoopPhase(kLoopPhaseTimers, start);
+  });
 
   if (!env->can_call_into_js())
     return;
@@ -913,10 +976,18 @@ void Environment::CheckImmediate(uv_check_t* handle) {
   Environment* env = Environment::from_immediate_check_handle(handle);
   TraceEventScope trace_scope(TRACING_CATEGORY_NODE1(environment),
                               "CheckImmediate", env);
+  uint64_t start = env->loop_phase_histograms_enabled_ ? uv_hrtime() : 0;
+  auto record_phase = OnScopeLeave([&]() {
+    if (start != 0) env->RecordLoopPhase(kLoopPhaseCheck, start);
+  });
 
   HandleScope scope(env->isolate());
   Context::Scope context_scope(env->context());
 
+  // A new loop iteration, and a new microtask budget to drain the queues
+  // that earlier callbacks have left behind.
+  env->task_queue_drain_budget_ = TaskQueueDrainBudget {};
+
   env->RunAndClearNativeImmediates();
 
   if (env->immediate_info()->count() == 0 || !env->can_call_into_js())
@@ -1196,6 +1267,53 @@ void AsyncHooks::grow_async_ids_stack() {
       async_ids_stack_.GetJSArray()).Check();
 }
 
+void AsyncHooks::EnableContextFramePromiseHook() {
+  if (context_frame_promise_hook_) return;
+  context_frame_promise_hook_ = true;
+  env()->isolate()->SetPromiseHook(ContextFramePromiseHook);
+}
+
+// Unlike the hooks set through SetJSPromiseHooks(), this one never calls
+// into JS, so that promises carry the context frame at next to no cost.
+void AsyncHooks::ContextFramePromiseHook(PromiseHookType type,
+                                         Local<Promise> promise,
+                                         Local<Value> parent) {
+  Environment* env = Environment::GetCurrent(promise->GetIsolate());
+  if (env == nullptr) return;
+  AsyncHooks* hooks = env->async_hooks();
+  Local<Context> context = env->context();
+
+  switch (type) {
+    case PromiseHookType::kInit:
+      if (hooks->context_frame_.IsEmpty()) return;
+      USE(promise->SetPrivate(context,
+                              env->async_context_frame_private_symbol(),
+                              hooks->context_frame()));
+      break;
+    case PromiseHookType::kBefore: {
+      Local<Value> frame;
+      if (!promise->GetPrivate(context,
+                               env->async_context_frame_private_symbol())
+               .ToLocal(&frame) ||
+          frame->IsUndefined()) {
+        frame = Local<Value>();
+      }
+      hooks->promise_context_frames_.emplace_back(
+          std::move(hooks->context_frame_));
+      hooks->context_frame_.Reset(env->isolate(), frame);
+      break;
+    }
+    case PromiseHookType::kAfter:
+      // The hook may have been enabled while a reaction was running.
+      if (hooks->promise_context_frames_.empty()) return;
+      hooks->context_frame_ = std::move(hooks->promise_context_frames_.back());
+      hooks->promise_context_frames_.pop_back();
+      break;
+    case PromiseHookType::kResolve:
+      break;
+  }
+}
+
 void AsyncHooks::FailWithCorruptedAsyncStack(double expected_async_id) {
   fprintf(stderr,
           "Error: async hook stack has become corrupted ("
@@ -1230,6 +1348,11 @@ void Environment::Exit(int exit_code) {
                     StackTrace::CurrentStackTrace(
                         isolate(), stack_trace_limit(), StackTrace::kDetailed));
   }
+  // Coalesced stdout writes, for instance, would be lost otherwise.
+  LibuvStreamWrap::FlushCoalescedWritesSync(this);
+  // Workers close their log sinks, and flush them, during cleanup.
+  if (is_main_thread())
+    log_sink::LogWriter::FlushAll();
   process_exit_handler_(this, exit_code);
 }
 
@@ -1249,6 +1372,128 @@ Environment* Environment::worker_parent_env() const {
   return worker_context()->env();
 }
 
+void Environment::ThreadPoolWorkQueued() {
+  int64_t depth = ++threadpool_queued_work_;
+  if (threadpool_queue_depth_histogram_)
+    threadpool_queue_depth_histogram_->Record(depth);
+}
+
+void Environment::ThreadPoolWorkDone(int status, uint64_t queue_wait) {
+  if (status == UV_ECANCELED) {
+    // The work never started, so it's still counted as queued.
+    threadpool_queued_work_--;
+    return;
+  }
+  if (threadpool_queue_wait_histogram_) {
+    threadpool_queue_wait_histogram_->Record(
+        std::max<int64_t>(queue_wait, 1));
+  }
+}
+
+void Environment::EnableThreadPoolHistograms() {
+  if (threadpool_queue_wait_histogram_) return;
+  threadpool_queue_wait_histogram_ =
+      std::make_shared<Histogram>(Histogram::Options {});
+  threadpool_queue_depth_histogram_ =
+      std::make_shared<Histogram>(Histogram::Options {});
+}
+
+void Environment::EnableLoopPhaseHistograms() {
+  if (loop_phase_histograms_enabled_) return;
+  for (std::shared_ptr<Histogram>& histogram : loop_phase_histograms_)
+    histogram = std::make_shared<Histogram>(Histogram::Options {});
+  loop_phase_state_ = LoopPhaseState {};
+  loop_phase_histograms_enabled_ = true;
+}
+
+void Environment::RecordLoopPhase(LoopPhaseMetric metric, uint64_t start) {
+  uint64_t duration = uv_hrtime() - start;
+  loop_phase_histograms_[metric]->Record(std::max<int64_t>(duration, 1));
+  loop_phase_state_.accounted += duration;
+}
+
+void Environment::RecordLoopPrepare() {
+  uint64_t now = uv_hrtime();
+  LoopPhaseState* state = &loop_phase_state_;
+  if (state->iteration_start != 0) {
+    uint64_t total = now - state->iteration_start;
+    if (total > state->accounted) {
+      loop_phase_histograms_[kLoopPhaseOther]->Record(
+          total - state->accounted);
+    }
+    loop_phase_histograms_[kLoopCallbacks]->Record(
+        std::max<int64_t>(state->callbacks, 1));
+  }
+  state->iteration_start = now;
+  state->idle_time = uv_metrics_idle_time(event_loop());
+  state->accounted = 0;
+  state->callbacks = 0;
+}
+
+void Environment::RecordLoopCheck() {
+  LoopPhaseState* state = &loop_phase_state_;
+  if (state->iteration_start == 0) return;
+  uint64_t total = uv_hrtime() - state->iteration_start;
+  uint64_t wait = uv_metrics_idle_time(event_loop()) - state->idle_time;
+  if (wait > total) wait = total;
+  loop_phase_histograms_[kLoopPhasePollWait]->Record(
+      std::max<int64_t>(wait, 1));
+  loop_phase_histograms_[kLoopPhasePoll]->Record(
+      std::max<int64_t>(total - wait, 1));
+  state->accounted += total;
+}
+
+void Environment::EnableTaskQueueDrainHistograms() {
+  if (task_queue_drain_histograms_enabled_) return;
+  for (std::shared_ptr<Histogram>& histogram : task_queue_drain_histograms_)
+    histogram = std::make_shared<Histogram>(Histogram::Options {});
+  task_queue_drain_histograms_enabled_ = true;
+}
+
+bool Environment::BeginTaskQueueDrain(MicrotaskQueue* queue,
+                                      uint64_t* start,
+                                      size_t* microtasks) {
+  TaskQueueDrainBudget* budget = &task_queue_drain_budget_;
+  if (budget->exhausted) {
+    // Make sure that the loop does not block in poll while the queues wait,
+    // and that the check phase has a callback scope to drain them in.
+    if (!budget->yield_scheduled) {
+      budget->yield_scheduled = true;
+      SetImmediate([](Environment* env) {});
+    }
+    return false;
+  }
+  bool measure = task_queue_drain_histograms_enabled_ ||
+                 options_->microtask_count_budget != 0 ||
+                 options_->microtask_time_budget != 0;
+  *start = measure ? uv_hrtime() : 0;
+  *microtasks = measure ? queue->GetFinishedMicrotaskCount() : 0;
+  return true;
+}
+
+void Environment::EndTaskQueueDrain(MicrotaskQueue* queue,
+                                    uint64_t start,
+                                    size_t microtasks) {
+  if (start == 0) return;
+  uint64_t duration = uv_hrtime() - start;
+  size_t ran = queue->GetFinishedMicrotaskCount() - microtasks;
+  if (task_queue_drain_histograms_enabled_ && ran != 0) {
+    task_queue_drain_histograms_[kTaskQueueDrainMicrotasks]->Record(ran);
+    task_queue_drain_histograms_[kTaskQueueDrainDuration]->Record(
+        std::max<int64_t>(duration, 1));
+  }
+
+  TaskQueueDrainBudget* budget = &task_queue_drain_budget_;
+  budget->time += duration;
+  budget->microtasks += ran;
+  uint64_t count_budget = options_->microtask_count_budget;
+  uint64_t time_budget = options_->microtask_time_budget * 1000000;
+  if ((count_budget != 0 && budget->microtasks >= count_budget) ||
+      (time_budget != 0 && budget->time >= time_budget)) {
+    budget->exhausted = true;
+  }
+}
+
 void Environment::AddUnmanagedFd(int fd) {
   if (!tracks_unmanaged_fds()) return;
   auto result = unmanaged_fds_.insert(fd);
@@ -1633,7 +1878,7 @@ size_t Environment::NearHeapLimitCallback(void* data,
   if (dir.empty()) {
     dir = env->GetCwd();
   }
-  DiagnosticFilename name(env, "Heap", "heapsnapshot");
+  DiagnosticFilename name(env, "Heap", heap::SnapshotExtension(env));
   std::string filename = dir + kPathSeparator + (*name);
 
   Debug(env, DebugCategory::DIAGNOSTICS, "Start generating %s...\n", *name);
@@ -1677,6 +1922,58 @@ inline size_t Environment::SelfSize() const {
   return size;
 }
 
+ReadBufferPool::~ReadBufferPool() {
+  // Slabs still in use belong to reads that never completed; libuv does not
+  // hand those back once the handle is gone.
+  for (const auto& slab : in_use_) delete[] slab.first;
+  for (std::vector<char*>& slabs : free_slabs_) {
+    for (char* data : slabs) delete[] data;
+  }
+}
+
+size_t ReadBufferPool::SizeClass(size_t size) {
+  size_t index = 0;
+  while ((kMinSlabSize << (2 * index)) < size) index++;
+  return index;
+}
+
+char* ReadBufferPool::Acquire(size_t size) {
+  if (size > kMaxSlabSize) return nullptr;
+  size_t index = SizeClass(size);
+  char* data;
+  if (!free_slabs_[index].empty()) {
+    data = free_slabs_[index].back();
+    free_slabs_[index].pop_back();
+  } else {
+    data = new char[kMinSlabSize << (2 * index)];
+  }
+  in_use_.emplace(data, index);
+  return data;
+}
+
+void ReadBufferPool::Release(char* data) {
+  auto it = in_use_.find(data);
+  CHECK_NE(it, in_use_.end());
+  size_t index = it->second;
+  in_use_.erase(it);
+  if (free_slabs_[index].size() < kMaxFreeSlabs) {
+    free_slabs_[index].push_back(data);
+  } else {
+    delete[] data;
+  }
+}
+
+void ReadBufferPool::MemoryInfo(MemoryTracker* tracker) const {
+  size_t free_size = 0;
+  for (size_t i = 0; i < kNumSizeClasses; i++)
+    free_size += free_slabs_[i].size() * (kMinSlabSize << (2 * i));
+  size_t used_size = 0;
+  for (const auto& slab : in_use_)
+    used_size += kMinSlabSize << (2 * slab.second);
+  tracker->TrackFieldWithSize("free_slabs", free_size);
+  tracker->TrackFieldWithSize("slabs_in_use", used_size);
+}
+
 void Environment::MemoryInfo(MemoryTracker* tracker) const {
   // Iteratable STLs have their own sizes subtracted from the parent
   // by default.
@@ -1694,6 +1991,7 @@ void Environment::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("async_hooks", async_hooks_);
   tracker->TrackField("immediate_info", immediate_info_);
   tracker->TrackField("tick_info", tick_info_);
+  tracker->TrackField("read_buffer_pool", read_buffer_pool_);
 
 #define V(PropertyName, TypeName)                                              \
   tracker->TrackField(#PropertyName, PropertyName());
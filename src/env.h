@@ -64,6 +64,8 @@ class ContextifyScript;
 class CompiledFnEntry;
 }
 
+class Histogram;
+
 namespace performance {
 class PerformanceState;
 }
@@ -89,6 +91,7 @@ class Worker;
 }
 
 namespace loader {
+class ModuleCompileJob;
 class ModuleWrap;
 
 struct PackageConfig {
@@ -154,6 +157,7 @@ constexpr size_t kFsStatsBufferLength =
 #define PER_ISOLATE_PRIVATE_SYMBOL_PROPERTIES(V)                              \
   V(alpn_buffer_private_symbol, "node:alpnBuffer")                            \
   V(arrow_message_private_symbol, "node:arrowMessage")                        \
+  V(async_context_frame_private_symbol, "node:asyncContextFrame")             \
   V(contextify_context_private_symbol, "node:contextify:context")             \
   V(contextify_global_private_symbol, "node:contextify:global")               \
   V(decorated_private_symbol, "node:decorated")                               \
@@ -341,15 +345,22 @@ constexpr size_t kFsStatsBufferLength =
   V(onclienthello_string, "onclienthello")                                     \
   V(oncomplete_string, "oncomplete")                                           \
   V(onconnection_string, "onconnection")                                       \
+  V(onconnectionbatch_string, "onconnectionbatch")                             \
   V(ondone_string, "ondone")                                                   \
+  V(ondrain_string, "ondrain")                                                 \
   V(onerror_string, "onerror")                                                 \
+  V(onevict_string, "onevict")                                                 \
   V(onexit_string, "onexit")                                                   \
   V(onhandshakedone_string, "onhandshakedone")                                 \
   V(onhandshakestart_string, "onhandshakestart")                               \
   V(onkeylog_string, "onkeylog")                                               \
+  V(onlines_string, "onlines")                                                 \
   V(onmessage_string, "onmessage")                                             \
+  V(onmessagebatch_string, "onmessagebatch")                                   \
   V(onnewsession_string, "onnewsession")                                       \
   V(onocspresponse_string, "onocspresponse")                                   \
+  V(onprogress_string, "onprogress")                                           \
+  V(onreadable_string, "onreadable")                                           \
   V(onreadstart_string, "onreadstart")                                         \
   V(onreadstop_string, "onreadstop")                                           \
   V(onshutdown_string, "onshutdown")                                           \
@@ -401,6 +412,7 @@ constexpr size_t kFsStatsBufferLength =
   V(servername_string, "servername")                                           \
   V(service_string, "service")                                                 \
   V(session_id_string, "sessionId")                                            \
+  V(shared_string, "shared")                                                   \
   V(shell_string, "shell")                                                     \
   V(signal_string, "signal")                                                   \
   V(sink_string, "sink")                                                       \
@@ -462,8 +474,10 @@ constexpr size_t kFsStatsBufferLength =
   V(base_object_ctor_template, v8::FunctionTemplate)                           \
   V(binding_data_ctor_template, v8::FunctionTemplate)                          \
   V(blob_constructor_template, v8::FunctionTemplate)                           \
+  V(blob_reader_constructor_template, v8::FunctionTemplate)                    \
   V(blocklist_constructor_template, v8::FunctionTemplate)                      \
   V(compiled_fn_entry_template, v8::ObjectTemplate)                            \
+  V(contextify_global_template, v8::ObjectTemplate)                            \
   V(dir_instance_template, v8::ObjectTemplate)                                 \
   V(fd_constructor_template, v8::ObjectTemplate)                               \
   V(fdclose_constructor_template, v8::ObjectTemplate)                          \
@@ -481,6 +495,7 @@ constexpr size_t kFsStatsBufferLength =
   V(microtask_queue_ctor_template, v8::FunctionTemplate)                       \
   V(pipe_constructor_template, v8::FunctionTemplate)                           \
   V(promise_wrap_template, v8::ObjectTemplate)                                 \
+  V(ring_channel_constructor_template, v8::FunctionTemplate)                   \
   V(sab_lifetimepartner_constructor_template, v8::FunctionTemplate)            \
   V(script_context_constructor_template, v8::FunctionTemplate)                 \
   V(secure_context_constructor_template, v8::FunctionTemplate)                 \
@@ -492,7 +507,8 @@ constexpr size_t kFsStatsBufferLength =
   V(tty_constructor_template, v8::FunctionTemplate)                            \
   V(write_wrap_template, v8::ObjectTemplate)                                   \
   V(worker_heap_snapshot_taker_template, v8::ObjectTemplate)                   \
-  V(x509_constructor_template, v8::FunctionTemplate)
+  V(x509_constructor_template, v8::FunctionTemplate)                           \
+  V(zlib_dictionary_constructor_template, v8::FunctionTemplate)
 
 #define ENVIRONMENT_STRONG_PERSISTENT_VALUES(V)                                \
   V(async_hooks_after_function, v8::Function)                                  \
@@ -544,7 +560,6 @@ constexpr size_t kFsStatsBufferLength =
   V(primordials_safe_weak_set_prototype_object, v8::Object)                    \
   V(promise_hook_handler, v8::Function)                                        \
   V(promise_reject_callback, v8::Function)                                     \
-  V(script_data_constructor_function, v8::Function)                            \
   V(source_map_cache_getter, v8::Function)                                     \
   V(tick_callback_function, v8::Function)                                      \
   V(timers_callback_function, v8::Function)                                    \
@@ -564,6 +579,7 @@ class IsolateData : public MemoryRetainer {
               MultiIsolatePlatform* platform = nullptr,
               ArrayBufferAllocator* node_allocator = nullptr,
               const std::vector<size_t>* indexes = nullptr);
+  ~IsolateData() override;
   SET_MEMORY_INFO_NAME(IsolateData)
   SET_SELF_SIZE(IsolateData)
   void MemoryInfo(MemoryTracker* tracker) const override;
@@ -571,6 +587,9 @@ class IsolateData : public MemoryRetainer {
 
   inline uv_loop_t* event_loop() const;
   inline MultiIsolatePlatform* platform() const;
+  // Whether the isolate was deserialized from the built-in snapshot, which
+  // then also holds the contexts that vm.createContext() starts from.
+  inline bool created_from_snapshot() const;
   inline std::shared_ptr<PerIsolateOptions> options();
   inline void set_options(std::shared_ptr<PerIsolateOptions> options);
 
@@ -626,8 +645,11 @@ class IsolateData : public MemoryRetainer {
   uv_loop_t* const event_loop_;
   NodeArrayBufferAllocator* const node_allocator_;
   MultiIsolatePlatform* platform_;
+  const bool created_from_snapshot_;
   std::shared_ptr<PerIsolateOptions> options_;
   worker::Worker* worker_context_ = nullptr;
+  // The C++ heap for CppgcMixin wrappers, unless the embedder attached one.
+  std::unique_ptr<v8::CppHeap> cpp_heap_;
 };
 
 struct ContextInfo {
@@ -665,6 +687,12 @@ class KVStore {
                                            v8::Local<v8::Object> entries);
 
   static std::shared_ptr<KVStore> CreateMapKVStore();
+  // A copy of the process environment, read once, for --env-var-snapshot.
+  // Lookups take no process-wide lock and Environments keep the V8 strings
+  // of the values they read until the entry is written. Writes also go to
+  // the process environment, but changes that are made to that directly,
+  // e.g. by addons calling setenv(), are not seen.
+  static std::shared_ptr<KVStore> CreateSnapshotKVStore();
 };
 
 namespace per_process {
@@ -719,6 +747,19 @@ class AsyncHooks : public MemoryRetainer {
 
   inline v8::Local<v8::String> provider_string(int idx);
 
+  // The AsyncLocalStorage context frame of the code that is running. It is
+  // captured by AsyncWraps when they are (re)initialized, and by promises
+  // once EnableContextFramePromiseHook() was called, and is restored around
+  // their callbacks without calling into JS. Empty when no store is set.
+  inline v8::Local<v8::Value> context_frame();
+  inline void set_context_frame(v8::Local<v8::Value> frame);
+  // Makes `frame` the current frame and stores the previous one in `prior`.
+  // Returns false, without doing anything, if both are empty.
+  inline bool EnterContextFrame(const v8::Global<v8::Value>& frame,
+                                v8::Global<v8::Value>* prior);
+  inline void ExitContextFrame(v8::Global<v8::Value>* prior);
+  void EnableContextFramePromiseHook();
+
   inline void no_force_checks();
   inline Environment* env();
 
@@ -798,6 +839,15 @@ class AsyncHooks : public MemoryRetainer {
   std::vector<v8::Global<v8::Context>> contexts_;
 
   std::array<v8::Global<v8::Function>, 4> js_promise_hooks_;
+
+  static void ContextFramePromiseHook(v8::PromiseHookType type,
+                                      v8::Local<v8::Promise> promise,
+                                      v8::Local<v8::Value> parent);
+
+  v8::Global<v8::Value> context_frame_;
+  // The frames that were current before each running promise reaction.
+  std::vector<v8::Global<v8::Value>> promise_context_frames_;
+  bool context_frame_promise_hook_ = false;
 };
 
 class ImmediateInfo : public MemoryRetainer {
@@ -908,8 +958,12 @@ class CleanupHookCallback {
 
   CleanupHookCallback(Callback fn,
                       void* arg,
-                      uint64_t insertion_order_counter)
-      : fn_(fn), arg_(arg), insertion_order_counter_(insertion_order_counter) {}
+                      uint64_t insertion_order_counter,
+                      bool critical = false)
+      : fn_(fn),
+        arg_(arg),
+        insertion_order_counter_(insertion_order_counter),
+        critical_(critical) {}
 
   // Only hashes `arg_`, since that is usually enough to identify the hook.
   struct Hash {
@@ -932,6 +986,8 @@ class CleanupHookCallback {
   // We keep track of the insertion order for these objects, so that we can
   // call the callbacks in reverse order when we are cleaning up.
   uint64_t insertion_order_counter_;
+  // Whether the hook also runs with --fast-exit. Not part of the identity.
+  bool critical_;
 };
 
 struct PropInfo {
@@ -978,6 +1034,40 @@ struct SnapshotData {
   EnvSerializeInfo env_info;
 };
 
+// Recycles the buffers that libuv reads stream and UDP data into. A read
+// borrows a slab of the next larger size class, and only the bytes that were
+// actually read are copied into an exactly sized BackingStore when the data
+// is handed on. This replaces allocating (and then shrinking) a fresh 64 KiB
+// BackingStore for every read.
+class ReadBufferPool : public MemoryRetainer {
+ public:
+  static constexpr size_t kMinSlabSize = 4 * 1024;
+  static constexpr size_t kNumSizeClasses = 3;  // 4, 16 and 64 KiB.
+  static constexpr size_t kMaxSlabSize =
+      kMinSlabSize << (2 * (kNumSizeClasses - 1));
+  static constexpr size_t kMaxFreeSlabs = 16;  // Kept per size class.
+
+  ReadBufferPool() = default;
+  ~ReadBufferPool() override;
+  ReadBufferPool(const ReadBufferPool&) = delete;
+  ReadBufferPool& operator=(const ReadBufferPool&) = delete;
+
+  // Returns nullptr if `size` is larger than kMaxSlabSize.
+  char* Acquire(size_t size);
+  inline bool Owns(char* data) const;
+  void Release(char* data);
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(ReadBufferPool)
+  SET_SELF_SIZE(ReadBufferPool)
+
+ private:
+  static size_t SizeClass(size_t size);
+
+  std::vector<char*> free_slabs_[kNumSizeClasses];
+  std::unordered_map<char*, size_t> in_use_;  // Slab -> size class.
+};
+
 class Environment : public MemoryRetainer {
  public:
   Environment(const Environment&) = delete;
@@ -1121,12 +1211,80 @@ class Environment : public MemoryRetainer {
   inline void IncreaseWaitingRequestCounter();
   inline void DecreaseWaitingRequestCounter();
 
+  // Queue statistics for work submitted through ThreadPoolWork. The
+  // histograms only exist once EnableThreadPoolHistograms() has been called.
+  void ThreadPoolWorkQueued();
+  inline void ThreadPoolWorkStarted();
+  void ThreadPoolWorkDone(int status, uint64_t queue_wait);
+  void EnableThreadPoolHistograms();
+  inline const std::shared_ptr<Histogram>& threadpool_queue_wait_histogram();
+  inline const std::shared_ptr<Histogram>& threadpool_queue_depth_histogram();
+
+  // Event loop phase statistics. Durations are in nanoseconds; a loop
+  // iteration is counted from one prepare phase to the next. kLoopPhasePoll
+  // is the time spent in I/O callbacks and kLoopPhasePollWait the time spent
+  // blocked waiting for I/O (only tracked when the loop was configured with
+  // UV_METRICS_IDLE_TIME). kLoopPhaseOther covers everything that happens
+  // outside of Node.js' own hooks: pending, idle, prepare and close
+  // callbacks, and timers other than the Environment's. kLoopCallbacks is the
+  // number of top-level callbacks into JS per iteration. The histograms only
+  // exist once EnableLoopPhaseHistograms() has been called.
+  enum LoopPhaseMetric {
+    kLoopPhaseTimers,
+    kLoopPhasePollWait,
+    kLoopPhasePoll,
+    kLoopPhaseCheck,
+    kLoopPhaseOther,
+    kLoopCallbacks,
+    kLoopPhaseMetricCount
+  };
+  void EnableLoopPhaseHistograms();
+  inline const std::shared_ptr<Histogram>& loop_phase_histogram(
+      LoopPhaseMetric metric);
+
+  // Microtask and process.nextTick() queue drains, as they happen when a
+  // top-level callback into JS returns. kTaskQueueDrainMicrotasks is the
+  // number of microtasks run per drain and kTaskQueueDrainDuration the
+  // duration of the drain in nanoseconds. Drains that run no microtasks are
+  // not recorded. The histograms only exist once
+  // EnableTaskQueueDrainHistograms() has been called.
+  enum TaskQueueDrainMetric {
+    kTaskQueueDrainMicrotasks,
+    kTaskQueueDrainDuration,
+    kTaskQueueDrainMetricCount
+  };
+  void EnableTaskQueueDrainHistograms();
+  inline const std::shared_ptr<Histogram>& task_queue_drain_histogram(
+      TaskQueueDrainMetric metric);
+
+  // Called around each drain. With --microtask-count-budget or
+  // --microtask-time-budget, BeginTaskQueueDrain() returns false once the
+  // drains of the current loop iteration have used up the budget. The queues
+  // are then left to the next check phase, and the event loop gets to run
+  // I/O callbacks in the meantime. A single drain can not be split up, so a
+  // budget bounds the time spent between two polls only approximately.
+  bool BeginTaskQueueDrain(v8::MicrotaskQueue* queue,
+                           uint64_t* start,
+                           size_t* microtasks);
+  void EndTaskQueueDrain(v8::MicrotaskQueue* queue,
+                         uint64_t start,
+                         size_t microtasks);
+
   inline AsyncHooks* async_hooks();
   inline ImmediateInfo* immediate_info();
   inline TickInfo* tick_info();
   inline uint64_t timer_base() const;
   inline std::shared_ptr<KVStore> env_vars();
   inline void set_env_vars(std::shared_ptr<KVStore> env_vars);
+  // The values that a snapshot KVStore has handed out to this Environment,
+  // by the id of their entry. See KVStore::CreateSnapshotKVStore().
+  struct EnvVarCacheEntry {
+    uint64_t version;
+    v8::Global<v8::String> value;
+  };
+  std::unordered_map<uint64_t, EnvVarCacheEntry>* env_var_cache() {
+    return &env_var_cache_;
+  }
 
   inline IsolateData* isolate_data() const;
 
@@ -1168,6 +1326,10 @@ class Environment : public MemoryRetainer {
 
   std::unordered_multimap<int, loader::ModuleWrap*> hash_to_module_map;
   std::unordered_map<uint32_t, loader::ModuleWrap*> id_to_module_map;
+  // Modules that are being compiled in the background, by URL, until a
+  // ModuleWrap is created for them.
+  std::unordered_map<std::string, std::shared_ptr<loader::ModuleCompileJob>>
+      url_to_compile_job_map;
   std::unordered_map<uint32_t, contextify::ContextifyScript*>
       id_to_script_map;
   std::unordered_map<uint32_t, contextify::CompiledFnEntry*> id_to_function_map;
@@ -1301,7 +1463,8 @@ class Environment : public MemoryRetainer {
                           SetConstructorFunctionFlag flag =
                               SetConstructorFunctionFlag::SET_CLASS_NAME);
 
-  void AtExit(void (*cb)(void* arg), void* arg);
+  // Critical callbacks also run with --fast-exit, see RunCriticalExitHooks().
+  void AtExit(void (*cb)(void* arg), void* arg, bool critical = false);
   void RunAtExitCallbacks();
 
   void RunWeakRefCleanup();
@@ -1387,9 +1550,16 @@ class Environment : public MemoryRetainer {
   void ToggleTimerRef(bool ref);
 
   using CleanupCallback = CleanupHookCallback::Callback;
-  inline void AddCleanupHook(CleanupCallback cb, void* arg);
+  inline void AddCleanupHook(CleanupCallback cb,
+                             void* arg,
+                             bool critical = false);
   inline void RemoveCleanupHook(CleanupCallback cb, void* arg);
   void RunCleanup();
+  // With --fast-exit, this runs instead of RunCleanup() and
+  // RunAtExitCallbacks(): the critical cleanup hooks, newest first, and
+  // then the critical AtExit callbacks. These are the ones that write
+  // something out that would be lost otherwise, such as profiles.
+  void RunCriticalExitHooks();
 
   static size_t NearHeapLimitCallback(void* data,
                                       size_t current_heap_limit,
@@ -1453,9 +1623,11 @@ class Environment : public MemoryRetainer {
   void RunAndClearNativeImmediates(bool only_refed = false);
   void RunAndClearInterrupts();
 
+  // Buffers for libuv reads. release_managed_buffer() returns a BackingStore
+  // holding the first `used` bytes of `buf`, or nullptr if `buf` is empty.
   inline uv_buf_t allocate_managed_buffer(const size_t suggested_size);
   inline std::unique_ptr<v8::BackingStore> release_managed_buffer(
-      const uv_buf_t& buf);
+      const uv_buf_t& buf, size_t used);
   inline std::unordered_map<char*, std::unique_ptr<v8::BackingStore>>*
       released_allocated_buffers();
 
@@ -1485,6 +1657,7 @@ class Environment : public MemoryRetainer {
   TickInfo tick_info_;
   const uint64_t timer_base_;
   std::shared_ptr<KVStore> env_vars_;
+  std::unordered_map<uint64_t, EnvVarCacheEntry> env_var_cache_;
   bool printed_error_ = false;
   bool trace_sync_io_ = false;
   bool emit_env_nonstring_warning_ = true;
@@ -1569,6 +1742,34 @@ class Environment : public MemoryRetainer {
   int handle_cleanup_waiting_ = 0;
   int request_waiting_ = 0;
 
+  // Decremented from the threadpool when the work starts running.
+  std::atomic<int64_t> threadpool_queued_work_ {0};
+  std::shared_ptr<Histogram> threadpool_queue_wait_histogram_;
+  std::shared_ptr<Histogram> threadpool_queue_depth_histogram_;
+
+  void RecordLoopPrepare();
+  void RecordLoopCheck();
+  void RecordLoopPhase(LoopPhaseMetric metric, uint64_t start);
+  bool loop_phase_histograms_enabled_ = false;
+  std::shared_ptr<Histogram> loop_phase_histograms_[kLoopPhaseMetricCount];
+  struct LoopPhaseState {
+    uint64_t iteration_start = 0;  // uv_hrtime() at the last prepare phase.
+    uint64_t idle_time = 0;  // uv_metrics_idle_time() at that point.
+    uint64_t accounted = 0;  // Time attributed to other metrics since then.
+    uint64_t callbacks = 0;
+  } loop_phase_state_;
+
+  bool task_queue_drain_histograms_enabled_ = false;
+  std::shared_ptr<Histogram>
+      task_queue_drain_histograms_[kTaskQueueDrainMetricCount];
+  // Reset by CheckImmediate() in every loop iteration.
+  struct TaskQueueDrainBudget {
+    uint64_t time = 0;
+    uint64_t microtasks = 0;
+    bool exhausted = false;
+    bool yield_scheduled = false;
+  } task_queue_drain_budget_;
+
   EnabledDebugList enabled_debug_list_;
 
   std::list<node_module> extra_linked_bindings_;
@@ -1579,20 +1780,25 @@ class Environment : public MemoryRetainer {
   struct ExitCallback {
     void (*cb_)(void* arg);
     void* arg_;
+    bool critical_;
   };
 
   std::list<ExitCallback> at_exit_functions_;
 
   typedef CallbackQueue<void, Environment*> NativeImmediateQueue;
+  typedef ThreadsafeCallbackQueue<void, Environment*>
+      ThreadsafeNativeImmediateQueue;
   NativeImmediateQueue native_immediates_;
+  ThreadsafeNativeImmediateQueue native_immediates_threadsafe_;
+  ThreadsafeNativeImmediateQueue native_immediates_interrupts_;
+  // The threadsafe queues above are lock-free. This mutex only guards
+  // task_queues_async_initialized_, and is taken once per batch of pushes
+  // (see SendTaskQueuesAsync()), as the libuv handle for the immediate queues
+  // (task_queues_async_) may not be initialized yet or already have been
+  // destroyed.
   Mutex native_immediates_threadsafe_mutex_;
-  NativeImmediateQueue native_immediates_threadsafe_;
-  NativeImmediateQueue native_immediates_interrupts_;
-  // Also guarded by native_immediates_threadsafe_mutex_. This can be used when
-  // trying to post tasks from other threads to an Environment, as the libuv
-  // handle for the immediate queues (task_queues_async_) may not be initialized
-  // yet or already have been destroyed.
   bool task_queues_async_initialized_ = false;
+  inline void SendTaskQueuesAsync();
 
   std::atomic<Environment**> interrupt_data_ {nullptr};
   void RequestInterruptFromV8();
@@ -1635,6 +1841,8 @@ class Environment : public MemoryRetainer {
   // a given pointer.
   std::unordered_map<char*, std::unique_ptr<v8::BackingStore>>
       released_allocated_buffers_;
+
+  ReadBufferPool read_buffer_pool_;
 };
 
 }  // namespace node
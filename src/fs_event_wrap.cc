@@ -23,9 +23,23 @@
 #include "env-inl.h"
 #include "handle_wrap.h"
 #include "node.h"
+#include "node_file.h"
 #include "node_external_reference.h"
 #include "string_bytes.h"
 
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#endif  // __linux__
+
 namespace node {
 
 using v8::Context;
@@ -46,6 +60,215 @@ using v8::Value;
 
 namespace {
 
+#ifdef __linux__
+// libuv watches a single directory per uv_fs_event_t on Linux and ignores
+// UV_FS_EVENT_RECURSIVE. This keeps one inotify descriptor with a watch for
+// every directory below a root instead, adding and removing watches as
+// subdirectories come and go, so that a whole tree can be watched through
+// one handle.
+class InotifyTree {
+ public:
+  struct Change {
+    std::string filename;  // Relative to the root.
+    int events;            // UV_RENAME and/or UV_CHANGE.
+  };
+
+  InotifyTree() = default;
+  ~InotifyTree();
+
+  InotifyTree(const InotifyTree&) = delete;
+  InotifyTree& operator=(const InotifyTree&) = delete;
+
+  // Returns 0 or a libuv error code.
+  int Init(const std::string& root);
+  int fd() const { return fd_; }
+
+  // Reads everything that is pending on the descriptor. Changes to the same
+  // file are merged into one entry, in the order they were first seen.
+  // Returns 0 or a libuv error code.
+  int ReadChanges(std::vector<Change>* changes);
+
+ private:
+  static constexpr uint32_t kWatchMask =
+      IN_ATTRIB | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MODIFY |
+      IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+  // Watches `relative` and the directories below it. When `report` is set,
+  // their contents are reported as renames, since anything created in them
+  // before the watches were in place would otherwise go unnoticed.
+  int AddWatches(const std::string& relative, std::vector<Change>* report);
+  // Drops the watches for `relative` and the directories below it.
+  void RemoveWatches(const std::string& relative);
+  std::string Join(const std::string& dir, const char* name) const;
+  std::string FullPath(const std::string& relative) const;
+
+  int fd_ = -1;
+  std::string root_;
+  std::string root_name_;
+  std::unordered_map<int, std::string> paths_;
+  std::unordered_map<std::string, int> watches_;
+};
+
+InotifyTree::~InotifyTree() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+std::string InotifyTree::Join(const std::string& dir, const char* name) const {
+  return dir.empty() ? std::string(name) : dir + '/' + name;
+}
+
+std::string InotifyTree::FullPath(const std::string& relative) const {
+  return relative.empty() ? root_ : root_ + '/' + relative;
+}
+
+int InotifyTree::Init(const std::string& root) {
+  root_ = root;
+  while (root_.size() > 1 && root_.back() == '/')
+    root_.pop_back();
+  size_t slash = root_.rfind('/');
+  root_name_ = slash == std::string::npos ? root_ : root_.substr(slash + 1);
+
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0)
+    return -errno;
+  return AddWatches("", nullptr);
+}
+
+int InotifyTree::AddWatches(const std::string& relative,
+                            std::vector<Change>* report) {
+  const std::string full_path = FullPath(relative);
+  int wd = inotify_add_watch(fd_, full_path.c_str(), kWatchMask);
+  if (wd < 0)
+    return -errno;
+  paths_[wd] = relative;
+  watches_[relative] = wd;
+
+  DIR* dir = opendir(full_path.c_str());
+  if (dir == nullptr)
+    return 0;  // Gone again already, the watch will be dropped with it.
+
+  std::vector<std::string> subdirs;
+  while (dirent* ent = readdir(dir)) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+      continue;
+    std::string child = Join(relative, ent->d_name);
+    if (report != nullptr)
+      report->push_back({child, UV_RENAME});
+
+    bool is_dir = ent->d_type == DT_DIR;
+    if (ent->d_type == DT_UNKNOWN) {
+      struct stat st;
+      is_dir = lstat(FullPath(child).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    if (is_dir)
+      subdirs.push_back(std::move(child));
+  }
+  closedir(dir);
+
+  for (const std::string& subdir : subdirs) {
+    int err = AddWatches(subdir, report);
+    if (err == UV_ENOSPC)
+      return err;  // Out of watches, max_user_watches needs to be raised.
+  }
+  return 0;
+}
+
+void InotifyTree::RemoveWatches(const std::string& relative) {
+  const std::string prefix = relative + '/';
+  for (auto it = watches_.begin(); it != watches_.end();) {
+    if (it->first == relative ||
+        it->first.compare(0, prefix.size(), prefix) == 0) {
+      inotify_rm_watch(fd_, it->second);
+      paths_.erase(it->second);
+      it = watches_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+int InotifyTree::ReadChanges(std::vector<Change>* changes) {
+  std::unordered_map<std::string, size_t> index;
+  std::vector<Change> found;
+  auto add = [&](std::string&& filename, int events) {
+    auto it = index.find(filename);
+    if (it != index.end()) {
+      (*changes)[it->second].events |= events;
+      return;
+    }
+    index.emplace(filename, changes->size());
+    changes->push_back({std::move(filename), events});
+  };
+
+  alignas(struct inotify_event) char buf[16 * 1024];
+  for (;;) {
+    ssize_t nread = read(fd_, buf, sizeof(buf));
+    if (nread < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+      return -errno;
+    }
+
+    for (char* p = buf; p < buf + nread;) {
+      const struct inotify_event* e =
+          reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(*e) + e->len;
+
+      if (e->mask & IN_Q_OVERFLOW) {
+        // Events were lost, all that can be said is that something changed.
+        add(std::string(root_name_), UV_RENAME);
+        continue;
+      }
+
+      auto dir = paths_.find(e->wd);
+      if (dir == paths_.end())
+        continue;  // Already removed.
+      const std::string dir_path = dir->second;
+
+      if (e->mask & IN_IGNORED) {
+        watches_.erase(dir_path);
+        paths_.erase(dir);
+        continue;
+      }
+
+      int events = 0;
+      if (e->mask & (IN_ATTRIB | IN_MODIFY))
+        events |= UV_CHANGE;
+      if (e->mask & ~(IN_ATTRIB | IN_MODIFY))
+        events |= UV_RENAME;
+
+      if (e->len == 0) {
+        // An event on a watched directory itself. Its parent reports the
+        // same change, except for the root.
+        if (dir_path.empty())
+          add(std::string(root_name_), events);
+        continue;
+      }
+
+      std::string filename = Join(dir_path, e->name);
+      if (e->mask & IN_ISDIR) {
+        if (e->mask & (IN_CREATE | IN_MOVED_TO)) {
+          found.clear();
+          int err = AddWatches(filename, &found);
+          if (err < 0 && err != UV_ENOENT && err != UV_ENOTDIR)
+            return err;
+        } else if (e->mask & (IN_DELETE | IN_MOVED_FROM)) {
+          RemoveWatches(filename);
+        }
+      }
+
+      add(std::move(filename), events);
+      for (Change& change : found)
+        add(std::move(change.filename), change.events);
+      found.clear();
+    }
+  }
+}
+#endif  // __linux__
+
 class FSEventWrap: public HandleWrap {
  public:
   static void Initialize(Local<Object> target,
@@ -69,16 +292,35 @@ class FSEventWrap: public HandleWrap {
 
   static void OnEvent(uv_fs_event_t* handle, const char* filename, int events,
     int status);
-
-  uv_fs_event_t handle_;
+  void EmitChange(int status, int events, const char* filename);
+  void InvalidateRealpathCache(const char* filename);
+
+#ifdef __linux__
+  int StartRecursive(const char* path);
+  static void OnInotifyReadable(uv_poll_t* handle, int status, int events);
+#endif  // __linux__
+
+  // On Linux, recursive watches sit on a uv_poll_t for an InotifyTree's
+  // descriptor rather than on a uv_fs_event_t.
+  union {
+    uv_handle_t handle;
+    uv_fs_event_t fs_event;
+#ifdef __linux__
+    uv_poll_t poll;
+#endif  // __linux__
+  } handle_;
   enum encoding encoding_ = kDefaultEncoding;
+  std::string path_;
+#ifdef __linux__
+  std::unique_ptr<InotifyTree> tree_;
+#endif  // __linux__
 };
 
 
 FSEventWrap::FSEventWrap(Environment* env, Local<Object> object)
     : HandleWrap(env,
                  object,
-                 reinterpret_cast<uv_handle_t*>(&handle_),
+                 &handle_.handle,
                  AsyncWrap::PROVIDER_FSEVENTWRAP) {
   MarkAsUninitialized();
 }
@@ -150,13 +392,28 @@ void FSEventWrap::Start(const FunctionCallbackInfo<Value>& args) {
     flags |= UV_FS_EVENT_RECURSIVE;
 
   wrap->encoding_ = ParseEncoding(env->isolate(), args[3], kDefaultEncoding);
+  wrap->path_.assign(*path, path.length());
+
+#ifdef __linux__
+  struct stat st;
+  if ((flags & UV_FS_EVENT_RECURSIVE) &&
+      stat(*path, &st) == 0 && S_ISDIR(st.st_mode)) {
+    int err = wrap->StartRecursive(*path);
+    if (err != 0 && !wrap->IsHandleClosing())
+      FSEventWrap::Close(args);
+    if (err == 0 && !args[1]->IsTrue())
+      uv_unref(&wrap->handle_.handle);
+    return args.GetReturnValue().Set(err);
+  }
+#endif  // __linux__
 
-  int err = uv_fs_event_init(wrap->env()->event_loop(), &wrap->handle_);
+  int err = uv_fs_event_init(wrap->env()->event_loop(),
+                             &wrap->handle_.fs_event);
   if (err != 0) {
     return args.GetReturnValue().Set(err);
   }
 
-  err = uv_fs_event_start(&wrap->handle_, OnEvent, *path, flags);
+  err = uv_fs_event_start(&wrap->handle_.fs_event, OnEvent, *path, flags);
   wrap->MarkAsInitialized();
 
   if (err != 0) {
@@ -166,12 +423,53 @@ void FSEventWrap::Start(const FunctionCallbackInfo<Value>& args) {
 
   // Check for persistent argument
   if (!args[1]->IsTrue()) {
-    uv_unref(reinterpret_cast<uv_handle_t*>(&wrap->handle_));
+    uv_unref(&wrap->handle_.handle);
   }
 
   args.GetReturnValue().Set(err);
 }
 
+#ifdef __linux__
+int FSEventWrap::StartRecursive(const char* path) {
+  std::unique_ptr<InotifyTree> tree = std::make_unique<InotifyTree>();
+  int err = tree->Init(path);
+  if (err != 0)
+    return err;
+
+  err = uv_poll_init(env()->event_loop(), &handle_.poll, tree->fd());
+  if (err != 0)
+    return err;
+  tree_ = std::move(tree);
+  MarkAsInitialized();
+
+  return uv_poll_start(&handle_.poll, UV_READABLE, OnInotifyReadable);
+}
+
+void FSEventWrap::OnInotifyReadable(uv_poll_t* handle,
+                                    int status,
+                                    int events) {
+  FSEventWrap* wrap = static_cast<FSEventWrap*>(handle->data);
+  Environment* env = wrap->env();
+
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+
+  // Everything that is pending is delivered as one batch, with repeated
+  // changes to the same file merged into one callback.
+  std::vector<InotifyTree::Change> changes;
+  if (status == 0)
+    status = wrap->tree_->ReadChanges(&changes);
+
+  for (const InotifyTree::Change& change : changes) {
+    wrap->EmitChange(0, change.events, change.filename.c_str());
+    if (wrap->IsHandleClosing())
+      return;  // Closed from the callback.
+  }
+  if (status != 0)
+    wrap->EmitChange(status, 0, nullptr);
+}
+#endif  // __linux__
+
 
 void FSEventWrap::OnEvent(uv_fs_event_t* handle, const char* filename,
     int events, int status) {
@@ -181,8 +479,31 @@ void FSEventWrap::OnEvent(uv_fs_event_t* handle, const char* filename,
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
 
+  wrap->EmitChange(status, events, filename);
+}
+
+// Something under the watched path was created, removed or renamed, which
+// may make what fs.realpathSync() cached about it stale.
+void FSEventWrap::InvalidateRealpathCache(const char* filename) {
+  fs::BindingData* binding_data =
+      Environment::GetBindingData<fs::BindingData>(env()->context());
+  if (binding_data == nullptr) return;
+  binding_data->realpath_cache.Invalidate(path_ + '/' + filename);
+  // A watched file reports changes to itself under its own name.
+  const size_t slash = path_.find_last_of("/\\");
+  if (path_.compare(slash + 1, std::string::npos, filename) == 0)
+    binding_data->realpath_cache.Invalidate(path_);
+}
+
+void FSEventWrap::EmitChange(int status, int events, const char* filename) {
+  Environment* env = this->env();
+  FSEventWrap* wrap = this;
+
   CHECK_EQ(wrap->persistent().IsEmpty(), false);
 
+  if (status == 0 && (events & UV_RENAME) && filename != nullptr)
+    InvalidateRealpathCache(filename);
+
   // We're in a bind here. libuv can set both UV_RENAME and UV_CHANGE but
   // the Node API only lets us pass a single event to JS land.
   //
@@ -1,9 +1,16 @@
 #include "diagnosticfilename-inl.h"
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
+#include "node_buffer.h"
 #include "node_external_reference.h"
+#include "node_pprof.h"
 #include "stream_base-inl.h"
 #include "util-inl.h"
+#include "zlib.h"
+
+#include <fcntl.h>
+#include <algorithm>
+#include <deque>
 
 using v8::Array;
 using v8::Boolean;
@@ -22,6 +29,7 @@ using v8::Number;
 using v8::Object;
 using v8::ObjectTemplate;
 using v8::String;
+using v8::Uint32;
 using v8::Value;
 
 namespace node {
@@ -204,30 +212,84 @@ void BuildEmbedderGraph(const FunctionCallbackInfo<Value>& args) {
 }
 
 namespace {
+
+constexpr int kSnapshotChunkSize = 65536;  // big chunks == faster
+
+// Writes the serialized snapshot straight to the file as V8 produces it,
+// gzipped if `gzip` is set, so that it is never held in memory in full.
 class FileOutputStream : public v8::OutputStream {
  public:
-  explicit FileOutputStream(FILE* stream) : stream_(stream) {}
+  FileOutputStream(uv_file fd, bool gzip) : fd_(fd), gzip_(gzip) {
+    if (gzip_) {
+      memset(&zstream_, 0, sizeof(zstream_));
+      // A window size of 15 plus 16 selects the gzip format.
+      CHECK_EQ(deflateInit2(&zstream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                            15 + 16, 8, Z_DEFAULT_STRATEGY),
+               Z_OK);
+    }
+  }
 
-  int GetChunkSize() override {
-    return 65536;  // big chunks == faster
+  ~FileOutputStream() override {
+    if (gzip_) deflateEnd(&zstream_);
   }
 
-  void EndOfStream() override {}
+  int GetChunkSize() override { return kSnapshotChunkSize; }
+
+  void EndOfStream() override {
+    if (gzip_) Deflate(nullptr, 0, Z_FINISH);
+  }
 
   WriteResult WriteAsciiChunk(char* data, int size) override {
-    const size_t len = static_cast<size_t>(size);
-    size_t off = 0;
+    if (gzip_)
+      Deflate(data, size, Z_NO_FLUSH);
+    else
+      Write(data, size);
+    return status_ == 0 ? kContinue : kAbort;
+  }
 
-    while (off < len && !feof(stream_) && !ferror(stream_))
-      off += fwrite(data + off, 1, len - off, stream_);
+  // A libuv error code, or 0.
+  int status() const { return status_; }
 
-    return off == len ? kContinue : kAbort;
+ private:
+  void Write(char* data, size_t size) {
+    while (size > 0 && status_ == 0) {
+      uv_buf_t buf = uv_buf_init(data, size);
+      uv_fs_t req;
+      int written = uv_fs_write(nullptr, &req, fd_, &buf, 1, -1, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (written < 0) {
+        status_ = written;
+      } else {
+        data += written;
+        size -= written;
+      }
+    }
   }
 
- private:
-  FILE* stream_;
+  void Deflate(char* data, size_t size, int flush) {
+    zstream_.next_in = reinterpret_cast<Bytef*>(data);
+    zstream_.avail_in = size;
+    do {
+      zstream_.next_out = reinterpret_cast<Bytef*>(out_);
+      zstream_.avail_out = sizeof(out_);
+      CHECK_NE(deflate(&zstream_, flush), Z_STREAM_ERROR);
+      Write(out_, sizeof(out_) - zstream_.avail_out);
+    } while (zstream_.avail_out == 0 && status_ == 0);
+  }
+
+  const uv_file fd_;
+  const bool gzip_;
+  int status_ = 0;
+  z_stream zstream_;
+  char out_[kSnapshotChunkSize];
 };
 
+// Serializes the snapshot on a thread of its own, since that takes long
+// for large heaps. The snapshot is a copy of the heap graph, so this does
+// not need the isolate. Chunks are handed to the main thread, which emits
+// them as the stream is read. At most kMaxQueuedChunks are queued, after
+// which the serializer waits, so a slow or paused reader does not make the
+// whole snapshot pile up in memory.
 class HeapSnapshotStream : public AsyncWrap,
                            public StreamBase,
                            public v8::OutputStream {
@@ -238,44 +300,58 @@ class HeapSnapshotStream : public AsyncWrap,
       Local<Object> obj) :
       AsyncWrap(env, obj, AsyncWrap::PROVIDER_HEAPSNAPSHOT),
       StreamBase(env),
-      snapshot_(std::move(snapshot)) {
+      snapshot_(std::move(snapshot)),
+      queue_(std::make_shared<Queue>()) {
     MakeWeak();
     StreamBase::AttachToObject(GetObject());
+    queue_->stream = this;
   }
 
-  ~HeapSnapshotStream() override {}
-
-  int GetChunkSize() override {
-    return 65536;  // big chunks == faster
+  ~HeapSnapshotStream() override {
+    {
+      Mutex::ScopedLock lock(queue_->mutex);
+      queue_->stream = nullptr;
+      queue_->cancelled = true;
+      queue_->cond.Broadcast(lock);
+    }
+    if (thread_running_) CHECK_EQ(uv_thread_join(&thread_), 0);
   }
 
+  int GetChunkSize() override { return kSnapshotChunkSize; }
+
+  // Called on the serializer thread.
   void EndOfStream() override {
-    EmitRead(UV_EOF);
-    snapshot_.reset();
+    Mutex::ScopedLock lock(queue_->mutex);
+    queue_->done = true;
+    ScheduleDrain(lock);
   }
 
+  // Called on the serializer thread.
   WriteResult WriteAsciiChunk(char* data, int size) override {
-    int len = size;
-    while (len != 0) {
-      uv_buf_t buf = EmitAlloc(size);
-      ssize_t avail = len;
-      if (static_cast<ssize_t>(buf.len) < avail)
-        avail = buf.len;
-      memcpy(buf.base, data, avail);
-      data += avail;
-      len -= static_cast<int>(avail);
-      EmitRead(size, buf);
-    }
+    Mutex::ScopedLock lock(queue_->mutex);
+    while (queue_->chunks.size() >= kMaxQueuedChunks && !queue_->cancelled)
+      queue_->cond.Wait(lock);
+    if (queue_->cancelled) return kAbort;
+    queue_->chunks.emplace_back(data, size);
+    ScheduleDrain(lock);
     return kContinue;
   }
 
   int ReadStart() override {
     CHECK_NE(snapshot_, nullptr);
-    snapshot_->Serialize(this, HeapSnapshot::kJSON);
+    reading_ = true;
+    if (!thread_running_) {
+      CHECK_EQ(uv_thread_create(&thread_, SerializerMain, this), 0);
+      thread_running_ = true;
+    } else {
+      Mutex::ScopedLock lock(queue_->mutex);
+      ScheduleDrain(lock);
+    }
     return 0;
   }
 
   int ReadStop() override {
+    reading_ = false;
     return 0;
   }
 
@@ -305,7 +381,79 @@ class HeapSnapshotStream : public AsyncWrap,
   SET_SELF_SIZE(HeapSnapshotStream)
 
  private:
+  static constexpr size_t kMaxQueuedChunks = 16;
+
+  // Shared with the callbacks scheduled on the main thread, which may run
+  // after the stream is gone.
+  struct Queue {
+    Mutex mutex;
+    ConditionVariable cond;
+    std::deque<std::string> chunks;
+    bool done = false;
+    bool cancelled = false;
+    bool drain_scheduled = false;
+    HeapSnapshotStream* stream = nullptr;  // Only used on the main thread.
+  };
+
+  static void SerializerMain(void* data) {
+    HeapSnapshotStream* stream = static_cast<HeapSnapshotStream*>(data);
+    stream->snapshot_->Serialize(stream, HeapSnapshot::kJSON);
+  }
+
+  // At most one drain is pending at a time, so none can be left over once
+  // the end of the stream has been emitted.
+  void ScheduleDrain(const Mutex::ScopedLock& lock) {
+    if (queue_->drain_scheduled) return;
+    queue_->drain_scheduled = true;
+    std::shared_ptr<Queue> queue = queue_;
+    env()->SetImmediateThreadsafe([queue](Environment* env) {
+      HeapSnapshotStream* stream;
+      {
+        Mutex::ScopedLock lock(queue->mutex);
+        queue->drain_scheduled = false;
+        stream = queue->stream;
+      }
+      if (stream != nullptr) stream->Drain();
+    });
+  }
+
+  void Drain() {
+    while (reading_) {
+      std::string chunk;
+      {
+        Mutex::ScopedLock lock(queue_->mutex);
+        if (queue_->chunks.empty()) {
+          if (queue_->done) break;
+          return;
+        }
+        chunk = std::move(queue_->chunks.front());
+        queue_->chunks.pop_front();
+        queue_->cond.Signal(lock);
+      }
+      const char* data = chunk.data();
+      size_t len = chunk.size();
+      while (len != 0) {
+        uv_buf_t buf = EmitAlloc(len);
+        size_t avail = std::min(len, buf.len);
+        memcpy(buf.base, data, avail);
+        data += avail;
+        len -= avail;
+        EmitRead(avail, buf);
+      }
+    }
+    if (!reading_) return;
+
+    CHECK_EQ(uv_thread_join(&thread_), 0);
+    thread_running_ = false;
+    EmitRead(UV_EOF);
+    snapshot_.reset();
+  }
+
   HeapSnapshotPointer snapshot_;
+  std::shared_ptr<Queue> queue_;
+  uv_thread_t thread_;
+  bool thread_running_ = false;
+  bool reading_ = false;
 };
 
 inline void TakeSnapshot(Environment* env, v8::OutputStream* out) {
@@ -314,18 +462,43 @@ inline void TakeSnapshot(Environment* env, v8::OutputStream* out) {
   snapshot->Serialize(out, HeapSnapshot::kJSON);
 }
 
+bool EndsWith(const char* str, const char* suffix) {
+  size_t str_len = strlen(str);
+  size_t suffix_len = strlen(suffix);
+  return str_len >= suffix_len &&
+         strcmp(str + str_len - suffix_len, suffix) == 0;
+}
+
 }  // namespace
 
+const char* SnapshotExtension(Environment* env) {
+  return env->options()->heap_snapshot_gzip ? "heapsnapshot.gz"
+                                            : "heapsnapshot";
+}
+
 bool WriteSnapshot(Environment* env, const char* filename) {
-  FILE* fp = fopen(filename, "w");
-  if (fp == nullptr) {
-    env->ThrowErrnoException(errno, "open");
+  uv_fs_t req;
+  int fd = uv_fs_open(nullptr, &req, filename,
+                      O_WRONLY | O_CREAT | O_TRUNC, 0666, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (fd < 0) {
+    env->ThrowUVException(fd, "open", nullptr, filename);
+    return false;
+  }
+  int err;
+  {
+    FileOutputStream stream(fd, EndsWith(filename, ".gz"));
+    TakeSnapshot(env, &stream);
+    err = stream.status();
+  }
+  int close_err = uv_fs_close(nullptr, &req, fd, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (err != 0) {
+    env->ThrowUVException(err, "write", nullptr, filename);
     return false;
   }
-  FileOutputStream stream(fp);
-  TakeSnapshot(env, &stream);
-  if (fclose(fp) == EOF) {
-    env->ThrowErrnoException(errno, "close");
+  if (close_err != 0) {
+    env->ThrowUVException(close_err, "close", nullptr, filename);
     return false;
   }
   return true;
@@ -378,7 +551,7 @@ void TriggerHeapSnapshot(const FunctionCallbackInfo<Value>& args) {
   Local<Value> filename_v = args[0];
 
   if (filename_v->IsUndefined()) {
-    DiagnosticFilename name(env, "Heap", "heapsnapshot");
+    DiagnosticFilename name(env, "Heap", SnapshotExtension(env));
     if (!WriteSnapshot(env, *name))
       return;
     if (String::NewFromUtf8(isolate, *name).ToLocal(&filename_v)) {
@@ -394,6 +567,82 @@ void TriggerHeapSnapshot(const FunctionCallbackInfo<Value>& args) {
   return args.GetReturnValue().Set(filename_v);
 }
 
+void StartSamplingHeapProfiler(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsUint32());
+  uint32_t interval = args[0].As<Uint32>()->Value();
+  uint32_t stack_depth = args[1].As<Uint32>()->Value();
+  bool started = env->isolate()->GetHeapProfiler()->StartSamplingHeapProfiler(
+      interval, static_cast<int>(stack_depth));
+  args.GetReturnValue().Set(started);
+}
+
+void StopSamplingHeapProfiler(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->isolate()->GetHeapProfiler()->StopSamplingHeapProfiler();
+}
+
+// Returns the objects sampled so far that are still alive, as a gzipped
+// pprof profile with their count and size by allocation site. This can be
+// called any number of times while the profiler runs, so that a leak shows
+// up as a site whose size keeps growing from one profile to the next.
+void TakeSamplingHeapProfile(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  HandleScope scope(isolate);
+  std::unique_ptr<v8::AllocationProfile> profile(
+      isolate->GetHeapProfiler()->GetAllocationProfile());
+  if (!profile) return;
+
+  profiler::PprofBuilder builder;
+  builder.AddSampleType("inuse_objects", "count");
+  builder.AddSampleType("inuse_space", "bytes");
+
+  // Walked iteratively, since JavaScript stacks can be very deep.
+  using Node = v8::AllocationProfile::Node;
+  std::vector<std::pair<Node*, size_t>> path = {{profile->GetRootNode(), 0}};
+  // The locations of the callers, outermost first.
+  std::vector<uint64_t> callers;
+  while (!path.empty()) {
+    Node* node = path.back().first;
+    if (path.back().second == node->children.size()) {
+      path.pop_back();
+      if (!callers.empty()) callers.pop_back();
+      continue;
+    }
+    Node* child = node->children[path.back().second++];
+    uint64_t function_id =
+        builder.Function(*Utf8Value(isolate, child->name),
+                         *Utf8Value(isolate, child->script_name),
+                         child->script_id,
+                         child->line_number,
+                         child->column_number);
+    callers.push_back(builder.Location(function_id, child->line_number));
+    path.emplace_back(child, 0);
+
+    uint64_t count = 0;
+    uint64_t size = 0;
+    for (const v8::AllocationProfile::Allocation& allocation :
+         child->allocations) {
+      count += allocation.count;
+      size += static_cast<uint64_t>(allocation.size) * allocation.count;
+    }
+    if (count == 0) continue;
+    std::vector<uint64_t> stack(callers.rbegin(), callers.rend());
+    builder.AddSample(stack, {count, size});
+  }
+
+  uint64_t now_ns =
+      static_cast<uint64_t>(GetCurrentTimeInMicroseconds() * 1000);
+  std::string out = builder.Finish(now_ns, 0);
+  Local<Object> buffer;
+  if (!out.empty() &&
+      Buffer::Copy(env, out.data(), out.size()).ToLocal(&buffer)) {
+    args.GetReturnValue().Set(buffer);
+  }
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -403,12 +652,19 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "buildEmbedderGraph", BuildEmbedderGraph);
   env->SetMethod(target, "triggerHeapSnapshot", TriggerHeapSnapshot);
   env->SetMethod(target, "createHeapSnapshotStream", CreateHeapSnapshotStream);
+  env->SetMethod(
+      target, "startSamplingHeapProfiler", StartSamplingHeapProfiler);
+  env->SetMethod(target, "stopSamplingHeapProfiler", StopSamplingHeapProfiler);
+  env->SetMethod(target, "takeSamplingHeapProfile", TakeSamplingHeapProfile);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(BuildEmbedderGraph);
   registry->Register(TriggerHeapSnapshot);
   registry->Register(CreateHeapSnapshotStream);
+  registry->Register(StartSamplingHeapProfiler);
+  registry->Register(StopSamplingHeapProfiler);
+  registry->Register(TakeSamplingHeapProfile);
 }
 
 }  // namespace heap
@@ -12,42 +12,92 @@ namespace node {
 void Histogram::Reset() {
   Mutex::ScopedLock lock(mutex_);
   hdr_reset(histogram_.get());
+  if (shards_) {
+    for (size_t i = 0; i < kShards; i++) {
+      hdr_reset(shards_[i].histogram.get());
+      shards_[i].exceeds = 0;
+    }
+  }
   exceeds_ = 0;
   count_ = 0;
   prev_ = 0;
 }
 
+void Histogram::Merge() const {
+  if (!shards_) return;
+  hdr_reset(histogram_.get());
+  for (size_t i = 0; i < kShards; i++)
+    hdr_add(histogram_.get(), shards_[i].histogram.get());
+}
+
 double Histogram::Add(const Histogram& other) {
+  size_t other_count = other.count_;
+  if (other.shards_) {
+    Mutex::ScopedLock lock(other.mutex_);
+    other.Merge();
+    other_count = static_cast<size_t>(other.histogram_->total_count);
+  }
+  size_t other_exceeds = other.Exceeds();
   Mutex::ScopedLock lock(mutex_);
-  count_ += other.count_;
-  exceeds_ += other.exceeds_;
+  exceeds_ += other_exceeds;
   if (other.prev_ > prev_)
     prev_ = other.prev_;
-  return static_cast<double>(hdr_add(histogram_.get(), other.histogram_.get()));
+  if (!shards_) {
+    count_ += other_count;
+    return static_cast<double>(
+        hdr_add(histogram_.get(), other.histogram_.get()));
+  }
+  // Recording atomically keeps this safe against concurrent Record()s.
+  double dropped = 0;
+  hdr_iter iter;
+  hdr_iter_recorded_init(&iter, other.histogram_.get());
+  while (hdr_iter_next(&iter)) {
+    if (!hdr_record_values_atomic(
+            shards_[0].histogram.get(), iter.value, iter.count)) {
+      dropped += iter.count;
+    }
+  }
+  return dropped;
 }
 
 size_t Histogram::Count() const {
   Mutex::ScopedLock lock(mutex_);
+  if (shards_) {
+    Merge();
+    return static_cast<size_t>(histogram_->total_count);
+  }
   return count_;
 }
 
+size_t Histogram::Exceeds() const {
+  if (!shards_) return exceeds_;
+  size_t exceeds = exceeds_;
+  for (size_t i = 0; i < kShards; i++)
+    exceeds += shards_[i].exceeds.load(std::memory_order_relaxed);
+  return exceeds;
+}
+
 int64_t Histogram::Min() const {
   Mutex::ScopedLock lock(mutex_);
+  Merge();
   return hdr_min(histogram_.get());
 }
 
 int64_t Histogram::Max() const {
   Mutex::ScopedLock lock(mutex_);
+  Merge();
   return hdr_max(histogram_.get());
 }
 
 double Histogram::Mean() const {
   Mutex::ScopedLock lock(mutex_);
+  Merge();
   return hdr_mean(histogram_.get());
 }
 
 double Histogram::Stddev() const {
   Mutex::ScopedLock lock(mutex_);
+  Merge();
   return hdr_stddev(histogram_.get());
 }
 
@@ -55,12 +105,14 @@ int64_t Histogram::Percentile(double percentile) const {
   Mutex::ScopedLock lock(mutex_);
   CHECK_GT(percentile, 0);
   CHECK_LE(percentile, 100);
+  Merge();
   return hdr_value_at_percentile(histogram_.get(), percentile);
 }
 
 template <typename Iterator>
 void Histogram::Percentiles(Iterator&& fn) {
   Mutex::ScopedLock lock(mutex_);
+  Merge();
   hdr_iter iter;
   hdr_iter_percentile_init(&iter, histogram_.get(), 1);
   while (hdr_iter_next(&iter)) {
@@ -69,7 +121,20 @@ void Histogram::Percentiles(Iterator&& fn) {
   }
 }
 
+bool Histogram::RecordConcurrent(int64_t value) {
+  // Threads are spread over the shards in the order they first record.
+  static std::atomic<size_t> next_shard {0};
+  thread_local size_t shard_index =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  Shard& shard = shards_[shard_index];
+  bool recorded = hdr_record_value_atomic(shard.histogram.get(), value);
+  if (!recorded)
+    shard.exceeds.fetch_add(1, std::memory_order_relaxed);
+  return recorded;
+}
+
 bool Histogram::Record(int64_t value) {
+  if (shards_) return RecordConcurrent(value);
   Mutex::ScopedLock lock(mutex_);
   bool recorded = hdr_record_value(histogram_.get(), value);
   if (!recorded)
@@ -86,7 +151,9 @@ uint64_t Histogram::RecordDelta() {
   if (prev_ > 0) {
     CHECK_GE(time, prev_);
     delta = time - prev_;
-    if (hdr_record_value(histogram_.get(), delta))
+    if (shards_)
+      RecordConcurrent(delta);
+    else if (hdr_record_value(histogram_.get(), delta))
       count_++;
     else
       exceeds_++;
@@ -97,7 +164,12 @@ uint64_t Histogram::RecordDelta() {
 
 size_t Histogram::GetMemorySize() const {
   Mutex::ScopedLock lock(mutex_);
-  return hdr_get_memory_size(histogram_.get());
+  size_t size = hdr_get_memory_size(histogram_.get());
+  if (shards_) {
+    for (size_t i = 0; i < kShards; i++)
+      size += hdr_get_memory_size(shards_[i].histogram.get());
+  }
+  return size;
 }
 
 }  // namespace node
@@ -26,6 +26,16 @@ Histogram::Histogram(const Options& options) {
                        options.figures,
                        &histogram));
   histogram_.reset(histogram);
+  if (options.concurrent) {
+    shards_.reset(new Shard[kShards]);
+    for (size_t i = 0; i < kShards; i++) {
+      CHECK_EQ(0, hdr_init(options.lowest,
+                           options.highest,
+                           options.figures,
+                           &histogram));
+      shards_[i].histogram.reset(histogram);
+    }
+  }
 }
 
 void Histogram::MemoryInfo(MemoryTracker* tracker) const {
@@ -252,6 +262,7 @@ void HistogramBase::New(const FunctionCallbackInfo<Value>& args) {
   CHECK_IMPLIES(!args[0]->IsNumber(), args[0]->IsBigInt());
   CHECK_IMPLIES(!args[1]->IsNumber(), args[1]->IsBigInt());
   CHECK(args[2]->IsUint32());
+  CHECK_IMPLIES(!args[3]->IsUndefined(), args[3]->IsBoolean());
 
   int64_t lowest = 1;
   int64_t highest = std::numeric_limits<int64_t>::max();
@@ -271,8 +282,9 @@ void HistogramBase::New(const FunctionCallbackInfo<Value>& args) {
   }
 
   int32_t figures = args[2].As<Uint32>()->Value();
+  bool concurrent = args[3]->IsTrue();
   new HistogramBase(env, args.This(), Histogram::Options {
-    lowest, highest, figures
+    lowest, highest, figures, concurrent
   });
 }
 
@@ -11,6 +11,7 @@
 #include "v8.h"
 #include "uv.h"
 
+#include <atomic>
 #include <functional>
 #include <limits>
 #include <map>
@@ -22,14 +23,23 @@ class ExternalReferenceRegistry;
 
 constexpr int kDefaultHistogramFigures = 3;
 
+// With Options::concurrent, Record() does not take a lock. Each thread
+// records into one of kShards hdr_histograms, with hdr_record_value_atomic(),
+// so that threads of the libuv pool, platform workers and worker_threads
+// sharing the histogram do not contend. Reads merge the shards first.
+// RecordDelta() and Reset() still serialize on the mutex, and a Reset()
+// may miss values that are recorded at the same time.
 class Histogram : public MemoryRetainer {
  public:
   struct Options {
     int64_t lowest = 1;
     int64_t highest = std::numeric_limits<int64_t>::max();
     int figures = kDefaultHistogramFigures;
+    bool concurrent = false;
   };
 
+  static constexpr size_t kShards = 16;
+
   explicit Histogram(const Options& options);
   virtual ~Histogram() = default;
 
@@ -40,7 +50,7 @@ class Histogram : public MemoryRetainer {
   inline double Mean() const;
   inline double Stddev() const;
   inline int64_t Percentile(double percentile) const;
-  inline size_t Exceeds() const { return exceeds_; }
+  inline size_t Exceeds() const;
   inline size_t Count() const;
 
   inline uint64_t RecordDelta();
@@ -60,7 +70,18 @@ class Histogram : public MemoryRetainer {
 
  private:
   using HistogramPointer = DeleteFnPtr<hdr_histogram, hdr_close>;
+
+  struct alignas(64) Shard {
+    HistogramPointer histogram;
+    std::atomic<size_t> exceeds {0};
+  };
+
+  inline bool RecordConcurrent(int64_t value);
+  // Merges the shards into histogram_, with mutex_ held.
+  inline void Merge() const;
+
   HistogramPointer histogram_;
+  std::unique_ptr<Shard[]> shards_;
   uint64_t prev_ = 0;
   size_t exceeds_ = 0;
   size_t count_ = 0;
@@ -0,0 +1,200 @@
+#ifndef SRC_IDLE_CONNECTION_POOL_H_
+#define SRC_IDLE_CONNECTION_POOL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "timers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace node {
+
+// Keeps idle keep-alive connections by origin for reuse. The connection
+// that was released last is handed out first, as it is the least likely to
+// have been closed by the peer, and the most likely to still be warm in its
+// caches and congestion window. Idle timeouts are kept on a TimerWheel, so
+// that releasing and acquiring a connection stay O(1). Times are in
+// milliseconds. The `on_evict` callbacks must not call back into the pool.
+template <typename T>
+class IdleConnectionPool {
+ public:
+  struct Stats {
+    uint64_t hits = 0;     // Acquire() handed out a connection.
+    uint64_t misses = 0;   // Acquire() found none that was usable.
+    uint64_t expired = 0;  // Evicted after the idle timeout.
+    uint64_t closed = 0;   // Evicted when found closed by the peer.
+  };
+
+  IdleConnectionPool(size_t max_idle_per_origin,
+                     uint64_t idle_timeout,
+                     uint64_t granularity = 100)
+      : max_idle_per_origin_(max_idle_per_origin),
+        idle_timeout_(idle_timeout),
+        wheel_(granularity) {}
+
+  IdleConnectionPool(const IdleConnectionPool&) = delete;
+  IdleConnectionPool& operator=(const IdleConnectionPool&) = delete;
+
+  // Adds `connection` as idle since `now`. Returns false, and leaves
+  // `connection` alone, if `origin` has no room for another one.
+  bool Release(const std::string& origin, T* connection, uint64_t now) {
+    auto it = origins_.find(origin);
+    if (it == origins_.end()) {
+      if (max_idle_per_origin_ == 0) return false;
+      it = origins_.emplace(origin, Origin()).first;
+    } else if (it->second.size() >= max_idle_per_origin_) {
+      return false;
+    }
+    const timers::TimerWheel::Id timer = wheel_.Add(now, idle_timeout_);
+    entries_.push_back(
+        Entry { &it->first, std::move(*connection), now, timer });
+    if (timer >= by_timer_.size()) by_timer_.resize(timer + 1);
+    by_timer_[timer] = std::prev(entries_.end());
+    it->second.push_back(by_timer_[timer]);
+    return true;
+  }
+
+  // Moves the connection of `origin` that was released last into `out`.
+  // Connections for which `is_alive(const T&)` returns false, or that are
+  // past the idle timeout, are passed to `on_evict(T*)` on the way, and the
+  // next one is tried. Returns false if none was usable.
+  template <typename IsAlive, typename OnEvict>
+  bool Acquire(const std::string& origin,
+               uint64_t now,
+               T* out,
+               IsAlive&& is_alive,
+               OnEvict&& on_evict) {
+    auto it = origins_.find(origin);
+    while (it != origins_.end()) {
+      auto entry = it->second.back();
+      it->second.pop_back();
+      const bool expired = now - entry->released_at >= idle_timeout_;
+      const bool alive = !expired && is_alive(entry->connection);
+      T connection = std::move(entry->connection);
+      wheel_.Remove(entry->timer);
+      entries_.erase(entry);
+      if (it->second.empty()) {
+        origins_.erase(it);
+        it = origins_.end();
+      }
+
+      if (alive) {
+        stats_.hits++;
+        *out = std::move(connection);
+        return true;
+      }
+      if (expired)
+        stats_.expired++;
+      else
+        stats_.closed++;
+      on_evict(&connection);
+    }
+    stats_.misses++;
+    return false;
+  }
+
+  // Passes each connection that is past the idle timeout at `now` to
+  // `on_evict(T*)`. Like the TimerWheel, this may be up to `granularity`
+  // milliseconds late.
+  template <typename OnEvict>
+  void Expire(uint64_t now, OnEvict&& on_evict) {
+    expired_.clear();
+    wheel_.Expire(now, &expired_);
+    for (timers::TimerWheel::Id timer : expired_) {
+      stats_.expired++;
+      Evict(by_timer_[timer], on_evict);
+    }
+  }
+
+  // Passes each connection for which `is_dead(const T&)` returns true to
+  // `on_evict(T*)`, counting it as closed.
+  template <typename IsDead, typename OnEvict>
+  void EvictIf(IsDead&& is_dead, OnEvict&& on_evict) {
+    for (auto entry = entries_.begin(); entry != entries_.end();) {
+      auto next = std::next(entry);
+      if (is_dead(entry->connection)) {
+        stats_.closed++;
+        Evict(entry, on_evict);
+      }
+      entry = next;
+    }
+  }
+
+  // Passes every connection to `on_evict(T*)`, without counting them.
+  template <typename OnEvict>
+  void Clear(OnEvict&& on_evict) {
+    while (!entries_.empty())
+      Evict(entries_.begin(), on_evict);
+  }
+
+  // When Expire() should run next, if there are idle connections.
+  bool NextExpiry(uint64_t* when) const {
+    return wheel_.NextExpiry(when);
+  }
+
+  size_t size() const { return entries_.size(); }
+  size_t size(const std::string& origin) const {
+    auto it = origins_.find(origin);
+    return it == origins_.end() ? 0 : it->second.size();
+  }
+  uint64_t idle_timeout() const { return idle_timeout_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Entry {
+    const std::string* origin;  // The key in origins_.
+    T connection;
+    uint64_t released_at;
+    timers::TimerWheel::Id timer;
+  };
+  using EntryList = std::list<Entry>;
+  // In release order, so the back is the one to hand out first.
+  using Origin = std::deque<typename EntryList::iterator>;
+
+  // Removes `entry`. The connections of an origin share a timeout, so the
+  // oldest one is usually the one that goes, but EvictIf() and Clear() may
+  // remove any of them.
+  template <typename OnEvict>
+  void Evict(typename EntryList::iterator entry, OnEvict& on_evict) {
+    auto it = origins_.find(*entry->origin);
+    Origin& list = it->second;
+    if (list.front() == entry) {
+      list.pop_front();
+    } else {
+      for (auto i = list.begin(); i != list.end(); ++i) {
+        if (*i == entry) {
+          list.erase(i);
+          break;
+        }
+      }
+    }
+    T connection = std::move(entry->connection);
+    wheel_.Remove(entry->timer);
+    entries_.erase(entry);
+    if (list.empty()) origins_.erase(it);
+    on_evict(&connection);
+  }
+
+  const size_t max_idle_per_origin_;
+  const uint64_t idle_timeout_;
+  EntryList entries_;
+  std::unordered_map<std::string, Origin> origins_;
+  timers::TimerWheel wheel_;
+  // The timer ids of the wheel are small and reused, so they index this.
+  std::vector<typename EntryList::iterator> by_timer_;
+  std::vector<timers::TimerWheel::Id> expired_;
+  Stats stats_;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_IDLE_CONNECTION_POOL_H_
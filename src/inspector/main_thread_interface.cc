@@ -186,10 +186,15 @@ class ThreadSafeDelegate : public InspectorSessionDelegate {
                      : thread_(thread), delegate_(thread, object_id) {}
 
   void SendMessageToFrontend(const v8_inspector::StringView& message) override {
+    SendMessageBufferToFrontend(StringBuffer::create(message));
+  }
+
+  void SendMessageBufferToFrontend(
+      std::unique_ptr<StringBuffer> message) override {
     delegate_.Call(
-        [m = StringBuffer::create(message)]
-        (InspectorSessionDelegate* delegate) {
-      delegate->SendMessageToFrontend(m->string());
+        [m = std::move(message)]
+        (InspectorSessionDelegate* delegate) mutable {
+      delegate->SendMessageBufferToFrontend(std::move(m));
     });
   }
 
@@ -296,6 +301,12 @@ std::unique_ptr<StringBuffer> Utf8ToStringView(const std::string& message) {
   return StringBuffer::create(view);
 }
 
+bool IsCBORMessage(const StringView& message) {
+  // Every CBOR message starts with an envelope, as V8 checks for as well.
+  return message.is8Bit() && message.length() >= 2 &&
+         message.characters8()[0] == 0xd8 && message.characters8()[1] == 0x5a;
+}
+
 std::unique_ptr<InspectorSession> MainThreadHandle::Connect(
     std::unique_ptr<InspectorSessionDelegate> delegate,
     bool prevent_shutdown) {
@@ -35,6 +35,9 @@ class Deletable {
 
 std::unique_ptr<v8_inspector::StringBuffer> Utf8ToStringView(
     const std::string& message);
+// Frontends may send CBOR encoded messages instead of JSON, and then get
+// their responses encoded the same way.
+bool IsCBORMessage(const v8_inspector::StringView& message);
 
 using MessageQueue = std::deque<std::unique_ptr<Request>>;
 
@@ -3,6 +3,8 @@
 
 #include <unicode/unistr.h>
 
+#include <algorithm>
+
 namespace node {
 namespace inspector {
 namespace protocol {
@@ -50,13 +52,18 @@ String StringViewToUtf8(v8_inspector::StringView view) {
                        view.length());
   }
   const uint16_t* source = view.characters16();
+  const uint16_t* end = source + view.length();
+  // The JSON that V8 sends is ASCII, with anything else escaped.
+  if (std::all_of(source, end, [](uint16_t c) { return c < 0x80; }))
+    return std::string(source, end);
   const UChar* unicodeSource = reinterpret_cast<const UChar*>(source);
   static_assert(sizeof(*source) == sizeof(*unicodeSource),
                 "sizeof(*source) == sizeof(*unicodeSource)");
 
   size_t result_length = view.length() * sizeof(*source);
   std::string result(result_length, '\0');
-  icu::UnicodeString utf16(unicodeSource, view.length());
+  // Read-only alias of the view, rather than a copy.
+  icu::UnicodeString utf16(false, unicodeSource, view.length());
   // ICU components for std::string compatibility are not enabled in build...
   bool done = false;
   while (!done) {
@@ -243,9 +243,12 @@ class ChannelImpl final : public v8_inspector::V8Inspector::Channel,
 
   void dispatchProtocolMessage(const StringView& message) {
     std::string raw_message = protocol::StringUtil::StringViewToUtf8(message);
+    // Once the frontend sends CBOR, V8 answers in CBOR, and so do we.
+    const bool binary = IsCBORMessage(message);
+    if (binary) binary_protocol_ = true;
     std::unique_ptr<protocol::DictionaryValue> value =
         protocol::DictionaryValue::cast(protocol::StringUtil::parseMessage(
-            raw_message, false));
+            raw_message, binary));
     int call_id;
     std::string method;
     node_dispatcher_->parseCommand(value.get(), &call_id, &method);
@@ -280,12 +283,12 @@ class ChannelImpl final : public v8_inspector::V8Inspector::Channel,
   void sendResponse(
       int callId,
       std::unique_ptr<v8_inspector::StringBuffer> message) override {
-    sendMessageToFrontend(message->string());
+    delegate_->SendMessageBufferToFrontend(std::move(message));
   }
 
   void sendNotification(
       std::unique_ptr<v8_inspector::StringBuffer> message) override {
-    sendMessageToFrontend(message->string());
+    delegate_->SendMessageBufferToFrontend(std::move(message));
   }
 
   void flushProtocolNotifications() override { }
@@ -300,13 +303,20 @@ class ChannelImpl final : public v8_inspector::V8Inspector::Channel,
 
   using Serializable = protocol::Serializable;
 
+  void sendMessageToFrontend(std::unique_ptr<Serializable> message) {
+    if (!binary_protocol_)
+      return sendMessageToFrontend(message->serializeToJSON());
+    std::vector<uint8_t> cbor = message->serializeToBinary();
+    sendMessageToFrontend(StringView(cbor.data(), cbor.size()));
+  }
+
   void sendProtocolResponse(int callId,
                             std::unique_ptr<Serializable> message) override {
-    sendMessageToFrontend(message->serializeToJSON());
+    sendMessageToFrontend(std::move(message));
   }
   void sendProtocolNotification(
       std::unique_ptr<Serializable> message) override {
-    sendMessageToFrontend(message->serializeToJSON());
+    sendMessageToFrontend(std::move(message));
   }
 
   void fallThrough(int callId,
@@ -323,6 +333,7 @@ class ChannelImpl final : public v8_inspector::V8Inspector::Channel,
   std::unique_ptr<protocol::UberDispatcher> node_dispatcher_;
   bool prevent_shutdown_;
   bool retaining_context_;
+  bool binary_protocol_ = false;
 };
 
 class SameThreadInspectorSession : public InspectorSession {
@@ -935,6 +946,11 @@ std::string Agent::GetWsUrl() const {
   return io_->GetWsUrl();
 }
 
+void InspectorSessionDelegate::SendMessageBufferToFrontend(
+    std::unique_ptr<StringBuffer> message) {
+  SendMessageToFrontend(message->string());
+}
+
 SameThreadInspectorSession::~SameThreadInspectorSession() {
   auto client = client_.lock();
   if (client)
@@ -13,6 +13,7 @@
 #include <memory>
 
 namespace v8_inspector {
+class StringBuffer;
 class StringView;
 }  // namespace v8_inspector
 
@@ -38,6 +39,10 @@ class InspectorSessionDelegate {
   virtual ~InspectorSessionDelegate() = default;
   virtual void SendMessageToFrontend(const v8_inspector::StringView& message)
                                      = 0;
+  // Takes over |message|, so that delegates which pass messages on to
+  // another thread can do so without copying them.
+  virtual void SendMessageBufferToFrontend(
+      std::unique_ptr<v8_inspector::StringBuffer> message);
 };
 
 class Agent {
@@ -82,7 +82,8 @@ class RequestToServer {
       case TransportAction::kSendMessage:
         server->Send(
             session_id_,
-            protocol::StringUtil::StringViewToUtf8(message_->string()));
+            protocol::StringUtil::StringViewToUtf8(message_->string()),
+            IsCBORMessage(message_->string()));
         break;
     }
   }
@@ -199,6 +200,12 @@ class IoSessionDelegate : public InspectorSessionDelegate {
                          StringBuffer::create(message));
   }
 
+  void SendMessageBufferToFrontend(
+      std::unique_ptr<StringBuffer> message) override {
+    request_queue_->Post(id_, TransportAction::kSendMessage,
+                         std::move(message));
+  }
+
  private:
   std::shared_ptr<RequestQueue> request_queue_;
   int id_;
@@ -349,8 +356,13 @@ void InspectorIoDelegate::StartSession(int session_id,
 void InspectorIoDelegate::MessageReceived(int session_id,
                                           const std::string& message) {
   auto session = sessions_.find(session_id);
-  if (session != sessions_.end())
-    session->second->Dispatch(Utf8ToStringView(message)->string());
+  // V8 reads 8-bit JSON as UTF-8, so there is no need to convert it to
+  // UTF-16 first. CBOR messages pass through unchanged.
+  if (session != sessions_.end()) {
+    session->second->Dispatch(
+        StringView(reinterpret_cast<const uint8_t*>(message.data()),
+                   message.size()));
+  }
 }
 
 void InspectorIoDelegate::EndSession(int session_id) {
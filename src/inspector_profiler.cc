@@ -420,9 +420,9 @@ static void EndStartedProfilers(Environment* env) {
 }
 
 void StartProfilers(Environment* env) {
-  AtExit(env, [](void* env) {
+  env->AtExit([](void* env) {
     EndStartedProfilers(static_cast<Environment*>(env));
-  }, env);
+  }, env, true);
 
   Isolate* isolate = env->isolate();
   Local<String> coverage_str = env->env_vars()->Get(
@@ -25,7 +25,8 @@ class TcpHolder {
   static Pointer Accept(uv_stream_t* server,
                         InspectorSocket::DelegatePointer delegate);
   void SetHandler(ProtocolHandler* handler);
-  int WriteRaw(const std::vector<char>& buffer, uv_write_cb write_cb);
+  int WriteRaw(const std::vector<char>& buffer, uv_write_cb write_cb,
+               std::string payload = std::string());
   uv_tcp_t* tcp() {
     return &tcp_;
   }
@@ -57,7 +58,7 @@ class ProtocolHandler {
   virtual void AcceptUpgrade(const std::string& accept_key) = 0;
   virtual void OnData(std::vector<char>* data) = 0;
   virtual void OnEof() = 0;
-  virtual void Write(const std::vector<char> data) = 0;
+  virtual void Write(std::string data, bool binary) = 0;
   virtual void CancelHandshake() = 0;
 
   std::string GetHost() const;
@@ -69,7 +70,8 @@ class ProtocolHandler {
 
  protected:
   virtual ~ProtocolHandler() = default;
-  int WriteRaw(const std::vector<char>& buffer, uv_write_cb write_cb);
+  int WriteRaw(const std::vector<char>& buffer, uv_write_cb write_cb,
+               std::string payload = std::string());
   InspectorSocket::Delegate* delegate();
 
   InspectorSocket* const inspector_;
@@ -106,11 +108,15 @@ static void dump_hex(const char* buf, size_t len) {
 
 class WriteRequest {
  public:
-  WriteRequest(ProtocolHandler* handler, const std::vector<char>& buffer)
+  WriteRequest(ProtocolHandler* handler, const std::vector<char>& buffer,
+               std::string payload)
       : handler(handler)
       , storage(buffer)
-      , req(uv_write_t())
-      , buf(uv_buf_init(storage.data(), storage.size())) {}
+      , payload(std::move(payload))
+      , req(uv_write_t()) {
+    bufs[0] = uv_buf_init(storage.data(), storage.size());
+    bufs[1] = uv_buf_init(&this->payload[0], this->payload.size());
+  }
 
   static WriteRequest* from_write_req(uv_write_t* req) {
     return node::ContainerOf(&WriteRequest::req, req);
@@ -122,8 +128,11 @@ class WriteRequest {
 
   ProtocolHandler* const handler;
   std::vector<char> storage;
+  // Written after storage. Messages are moved here rather than copied into
+  // storage, as they can be large, e.g. profiles and heap snapshot chunks.
+  std::string payload;
   uv_write_t req;
-  uv_buf_t buf;
+  uv_buf_t bufs[2];
 };
 
 void allocate_buffer(uv_handle_t* stream, size_t len, uv_buf_t* buf) {
@@ -198,11 +207,12 @@ const size_t kTwoBytePayloadLengthField = 126;
 const size_t kEightBytePayloadLengthField = 127;
 const size_t kMaskingKeyWidthInBytes = 4;
 
-static std::vector<char> encode_frame_hybi17(const std::vector<char>& message) {
+// The frame header for a payload of |data_length| bytes, which is sent
+// after it without being copied.
+static std::vector<char> encode_frame_header_hybi17(size_t data_length,
+                                                    OpCode op_code) {
   std::vector<char> frame;
-  OpCode op_code = kOpCodeText;
   frame.push_back(kFinalBit | op_code);
-  const size_t data_length = message.size();
   if (data_length <= kMaxSingleBytePayloadLength) {
     frame.push_back(static_cast<char>(data_length));
   } else if (data_length <= 0xFFFF) {
@@ -222,7 +232,6 @@ static std::vector<char> encode_frame_hybi17(const std::vector<char>& message) {
                  extended_payload_length + 8);
     CHECK_EQ(0, remaining);
   }
-  frame.insert(frame.end(), message.begin(), message.end());
   return frame;
 }
 
@@ -256,8 +265,8 @@ static ws_decode_result decode_frame_hybi17(const std::vector<char>& buffer,
       closed = true;
       break;
     case kOpCodeText:
+    case kOpCodeBinary:  // CBOR encoded protocol messages.
       break;
-    case kOpCodeBinary:        // We don't support binary frames yet.
     case kOpCodeContinuation:  // We don't support binary frames yet.
     case kOpCodePing:          // We don't support binary frames yet.
     case kOpCodePong:          // We don't support binary frames yet.
@@ -342,9 +351,10 @@ class WsHandler : public ProtocolHandler {
     } while (processed > 0 && !data->empty());
   }
 
-  void Write(const std::vector<char> data) override {
-    std::vector<char> output = encode_frame_hybi17(data);
-    WriteRaw(output, WriteRequest::Cleanup);
+  void Write(std::string data, bool binary) override {
+    std::vector<char> header = encode_frame_header_hybi17(
+        data.size(), binary ? kOpCodeBinary : kOpCodeText);
+    WriteRaw(header, WriteRequest::Cleanup, std::move(data));
   }
 
  protected:
@@ -504,8 +514,8 @@ class HttpHandler : public ProtocolHandler {
     }
   }
 
-  void Write(const std::vector<char> data) override {
-    WriteRaw(data, WriteRequest::Cleanup);
+  void Write(std::string data, bool binary) override {
+    WriteRaw(std::vector<char>(), WriteRequest::Cleanup, std::move(data));
   }
 
  protected:
@@ -603,8 +613,9 @@ ProtocolHandler::ProtocolHandler(InspectorSocket* inspector,
 }
 
 int ProtocolHandler::WriteRaw(const std::vector<char>& buffer,
-                              uv_write_cb write_cb) {
-  return tcp_->WriteRaw(buffer, write_cb);
+                              uv_write_cb write_cb,
+                              std::string payload) {
+  return tcp_->WriteRaw(buffer, write_cb, std::move(payload));
 }
 
 InspectorSocket::Delegate* ProtocolHandler::delegate() {
@@ -663,17 +674,20 @@ void TcpHolder::SetHandler(ProtocolHandler* handler) {
   handler_ = handler;
 }
 
-int TcpHolder::WriteRaw(const std::vector<char>& buffer, uv_write_cb write_cb) {
+int TcpHolder::WriteRaw(const std::vector<char>& buffer, uv_write_cb write_cb,
+                        std::string payload) {
 #if DUMP_WRITES
-  printf("%s (%ld bytes):\n", __FUNCTION__, buffer.size());
+  printf("%s (%ld bytes):\n", __FUNCTION__, buffer.size() + payload.size());
   dump_hex(buffer.data(), buffer.size());
+  dump_hex(payload.data(), payload.size());
   printf("\n");
 #endif
 
   // Freed in write_request_cleanup
-  WriteRequest* wr = new WriteRequest(handler_, buffer);
+  WriteRequest* wr = new WriteRequest(handler_, buffer, std::move(payload));
   uv_stream_t* stream = reinterpret_cast<uv_stream_t*>(&tcp_);
-  int err = uv_write(&wr->req, stream, &wr->buf, 1, write_cb);
+  int err = uv_write(&wr->req, stream, wr->bufs, arraysize(wr->bufs),
+                     write_cb);
   if (err < 0)
     delete wr;
   return err < 0;
@@ -757,7 +771,11 @@ void InspectorSocket::SwitchProtocol(ProtocolHandler* handler) {
 }
 
 void InspectorSocket::Write(const char* data, size_t len) {
-  protocol_handler_->Write(std::vector<char>(data, data + len));
+  protocol_handler_->Write(std::string(data, len), false);
+}
+
+void InspectorSocket::Write(std::string data, bool binary) {
+  protocol_handler_->Write(std::move(data), binary);
 }
 
 }  // namespace inspector
@@ -38,6 +38,9 @@ class InspectorSocket {
   void AcceptUpgrade(const std::string& accept_key);
   void CancelHandshake();
   void Write(const char* data, size_t len);
+  // Takes over |data| rather than copying it. Once upgraded, it is sent as
+  // a binary WebSocket frame if |binary| is set, or as a text frame if not.
+  void Write(std::string data, bool binary);
   void SwitchProtocol(ProtocolHandler* handler);
   std::string GetHost();
 
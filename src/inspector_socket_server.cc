@@ -157,7 +157,7 @@ class SocketSession {
   void Close() {
     ws_socket_.reset();
   }
-  void Send(const std::string& message);
+  void Send(std::string message, bool binary);
   void Own(InspectorSocket::Pointer ws_socket) {
     ws_socket_ = std::move(ws_socket);
   }
@@ -479,10 +479,12 @@ void InspectorSocketServer::Accept(int server_port,
   }
 }
 
-void InspectorSocketServer::Send(int session_id, const std::string& message) {
+void InspectorSocketServer::Send(int session_id,
+                                 std::string message,
+                                 bool binary) {
   SocketSession* session = Session(session_id);
   if (session != nullptr) {
-    session->Send(message);
+    session->Send(std::move(message), binary);
   }
 }
 
@@ -495,8 +497,8 @@ SocketSession::SocketSession(InspectorSocketServer* server, int id,
                              int server_port)
     : id_(id), server_port_(server_port) {}
 
-void SocketSession::Send(const std::string& message) {
-  ws_socket_->Write(message.data(), message.length());
+void SocketSession::Send(std::string message, bool binary) {
+  ws_socket_->Write(std::move(message), binary);
 }
 
 void SocketSession::Delegate::OnHttpGet(const std::string& host,
@@ -57,8 +57,8 @@ class InspectorSocketServer {
   // Called by the TransportAction sent with InspectorIo::Write():
   //   kKill and kStop
   void Stop();
-  //   kSendMessage
-  void Send(int session_id, const std::string& message);
+  //   kSendMessage, with |binary| set for CBOR encoded messages
+  void Send(int session_id, std::string message, bool binary = false);
   //   kKill
   void TerminateConnections();
   int Port() const;
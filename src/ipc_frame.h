@@ -0,0 +1,56 @@
+#ifndef SRC_IPC_FRAME_H_
+#define SRC_IPC_FRAME_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace node {
+
+// The framing of the native IPC channel. Each frame is the length of its
+// payload as a 32-bit little-endian integer, followed by the payload, which
+// is a message as written by v8::ValueSerializer.
+namespace ipc_frame {
+
+constexpr size_t kHeaderSize = 4;
+
+enum class ParseResult {
+  kIncomplete,  // More bytes are needed.
+  kComplete,
+  kTooLong,     // The payload would be longer than the maximum.
+};
+
+inline void WriteHeader(char* out, uint32_t payload_length) {
+  for (size_t i = 0; i < kHeaderSize; i++)
+    out[i] = static_cast<char>((payload_length >> (8 * i)) & 0xff);
+}
+
+inline uint32_t ReadHeader(const char* data) {
+  uint32_t payload_length = 0;
+  for (size_t i = 0; i < kHeaderSize; i++)
+    payload_length |= uint32_t{static_cast<uint8_t>(data[i])} << (8 * i);
+  return payload_length;
+}
+
+// Looks at the frame that `data` starts with. `payload_length` is set as
+// soon as the header is complete, so that a caller can make room for the
+// rest of the frame.
+inline ParseResult Parse(const char* data,
+                         size_t length,
+                         size_t max_payload_length,
+                         size_t* payload_length) {
+  if (length < kHeaderSize) return ParseResult::kIncomplete;
+  *payload_length = ReadHeader(data);
+  if (*payload_length > max_payload_length) return ParseResult::kTooLong;
+  if (length - kHeaderSize < *payload_length) return ParseResult::kIncomplete;
+  return ParseResult::kComplete;
+}
+
+}  // namespace ipc_frame
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_IPC_FRAME_H_
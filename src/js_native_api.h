@@ -105,6 +105,22 @@ NAPI_EXTERN napi_status napi_create_function(napi_env env,
                                              napi_callback cb,
                                              void* data,
                                              napi_value* result);
+#ifdef NAPI_EXPERIMENTAL
+// Like napi_create_function(), but optimized code may call fast_signature's
+// fast_cb directly instead of cb, when the arguments have the types of the
+// signature. fast_cb must not call into Node-API, nor into JavaScript; cb
+// remains the fallback for every other call, so both have to behave the
+// same. Engines without fast calls always call cb.
+NAPI_EXTERN napi_status
+node_api_create_function_with_fast_path(
+    napi_env env,
+    const char* utf8name,
+    size_t length,
+    napi_callback cb,
+    void* data,
+    const node_api_fast_signature* fast_signature,
+    napi_value* result);
+#endif  // NAPI_EXPERIMENTAL
 NAPI_EXTERN napi_status napi_create_error(napi_env env,
                                           napi_value code,
                                           napi_value msg,
@@ -6,6 +6,7 @@
 // became part of it's API.
 #include <stddef.h>  // NOLINT(modernize-deprecated-headers)
 #include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdbool.h>  // NOLINT(modernize-deprecated-headers)
 
 #if !defined __cplusplus || (defined(_MSC_VER) && _MSC_VER < 1900)
     typedef uint16_t char16_t;
@@ -157,4 +158,61 @@ typedef struct {
 } napi_type_tag;
 #endif  // NAPI_VERSION >= 8
 
+#ifdef NAPI_EXPERIMENTAL
+// The types of the arguments and the return value of a fast callback, see
+// node_api_create_function_with_fast_path().
+typedef enum {
+  node_api_fast_void,  // Return type only.
+  node_api_fast_bool,
+  node_api_fast_int32,
+  node_api_fast_uint32,
+  node_api_fast_int64,  // Argument type only, as are all below.
+  node_api_fast_uint64,
+  node_api_fast_float32,
+  node_api_fast_float64,
+  // Any value, passed as a napi_value.
+  node_api_fast_value,
+  // Typed arrays of the given element type, BigInt64Array and
+  // BigUint64Array for the 64-bit ones, passed as
+  // const node_api_fast_typed_array*.
+  node_api_fast_int32_array,
+  node_api_fast_uint32_array,
+  node_api_fast_int64_array,
+  node_api_fast_uint64_array,
+  node_api_fast_float32_array,
+  node_api_fast_float64_array
+} node_api_fast_type;
+
+typedef struct {
+  size_t length;  // In elements.
+  // Only guaranteed to be 4-byte aligned, so 8-byte elements have to be
+  // read with memcpy().
+  void* data;
+} node_api_fast_typed_array;
+
+// Passed as the last argument of every fast callback.
+typedef struct {
+  // Set to true before returning for the call to be repeated through the
+  // napi_callback, e.g. to throw an error.
+  bool fallback;
+  uintptr_t reserved;
+} node_api_fast_callback_options;
+
+// A fast callback is called as
+//
+//   return_type fast_cb(napi_value receiver,
+//                       arg_types[0] arg0, ..., arg_types[arg_count - 1] argN,
+//                       node_api_fast_callback_options* options)
+//
+// and is cast to node_api_fast_callback for passing it in.
+typedef void (*node_api_fast_callback)(void);
+
+typedef struct {
+  node_api_fast_callback fast_cb;
+  node_api_fast_type return_type;
+  const node_api_fast_type* arg_types;
+  size_t arg_count;
+} node_api_fast_signature;
+#endif  // NAPI_EXPERIMENTAL
+
 #endif  // SRC_JS_NATIVE_API_TYPES_H_
@@ -1,6 +1,7 @@
 #include <climits>  // INT_MAX
 #include <cmath>
 #include <algorithm>
+#include <new>
 #define NAPI_EXPERIMENTAL
 #include "env-inl.h"
 #include "js_native_api_v8.h"
@@ -347,6 +348,31 @@ class FunctionCallbackWrapper
     return napi_clear_last_error(env);
   }
 
+  static inline napi_status NewFunction(napi_env env,
+                                        napi_callback cb,
+                                        void* cb_data,
+                                        const v8::CFunction* c_function,
+                                        v8::Local<v8::Function>* result) {
+    v8::Local<v8::Value> cbdata = v8impl::CallbackBundle::New(env, cb, cb_data);
+    RETURN_STATUS_IF_FALSE(env, !cbdata.IsEmpty(), napi_generic_failure);
+
+    v8::Local<v8::FunctionTemplate> tpl =
+        v8::FunctionTemplate::New(env->isolate,
+                                  Invoke,
+                                  cbdata,
+                                  v8::Local<v8::Signature>(),
+                                  0,
+                                  v8::ConstructorBehavior::kThrow,
+                                  v8::SideEffectType::kHasSideEffect,
+                                  c_function);
+    v8::MaybeLocal<v8::Function> maybe_function =
+        tpl->GetFunction(env->context());
+    CHECK_MAYBE_EMPTY(env, maybe_function, napi_generic_failure);
+
+    *result = maybe_function.ToLocalChecked();
+    return napi_clear_last_error(env);
+  }
+
   static inline napi_status NewTemplate(napi_env env,
                     napi_callback cb,
                     void* cb_data,
@@ -452,8 +478,90 @@ inline napi_status Wrap(napi_env env,
   return GET_RETURN_STATUS(env);
 }
 
+// The fast callback gets these as they are, so their layout has to match.
+static_assert(sizeof(node_api_fast_typed_array) ==
+                  sizeof(v8::FastApiTypedArray<double>),
+              "node_api_fast_typed_array does not match V8's layout");
+static_assert(sizeof(node_api_fast_callback_options) ==
+                  sizeof(v8::FastApiCallbackOptions),
+              "node_api_fast_callback_options does not match V8's layout");
+
+inline static bool FastTypeToCTypeInfo(node_api_fast_type type,
+                                       bool is_return,
+                                       v8::CTypeInfo* result) {
+  using Type = v8::CTypeInfo::Type;
+  using SequenceType = v8::CTypeInfo::SequenceType;
+  switch (type) {
+    case node_api_fast_void:
+      if (!is_return) return false;
+      *result = v8::CTypeInfo(Type::kVoid);
+      return true;
+    case node_api_fast_bool:
+      *result = v8::CTypeInfo(Type::kBool);
+      return true;
+    case node_api_fast_int32:
+      *result = v8::CTypeInfo(Type::kInt32);
+      return true;
+    case node_api_fast_uint32:
+      *result = v8::CTypeInfo(Type::kUint32);
+      return true;
+    case node_api_fast_float32:
+      *result = v8::CTypeInfo(Type::kFloat32);
+      return true;
+    case node_api_fast_float64:
+      *result = v8::CTypeInfo(Type::kFloat64);
+      return true;
+    default:
+      break;
+  }
+
+  // V8 does not return anything wider than 32 bits, nor objects.
+  if (is_return) return false;
+  switch (type) {
+    case node_api_fast_int64:
+      *result = v8::CTypeInfo(Type::kInt64);
+      return true;
+    case node_api_fast_uint64:
+      *result = v8::CTypeInfo(Type::kUint64);
+      return true;
+    case node_api_fast_value:
+      *result = v8::CTypeInfo(Type::kV8Value);
+      return true;
+    case node_api_fast_int32_array:
+      *result = v8::CTypeInfo(Type::kInt32, SequenceType::kIsTypedArray);
+      return true;
+    case node_api_fast_uint32_array:
+      *result = v8::CTypeInfo(Type::kUint32, SequenceType::kIsTypedArray);
+      return true;
+    case node_api_fast_int64_array:
+      *result = v8::CTypeInfo(Type::kInt64, SequenceType::kIsTypedArray);
+      return true;
+    case node_api_fast_uint64_array:
+      *result = v8::CTypeInfo(Type::kUint64, SequenceType::kIsTypedArray);
+      return true;
+    case node_api_fast_float32_array:
+      *result = v8::CTypeInfo(Type::kFloat32, SequenceType::kIsTypedArray);
+      return true;
+    case node_api_fast_float64_array:
+      *result = v8::CTypeInfo(Type::kFloat64, SequenceType::kIsTypedArray);
+      return true;
+    default:
+      return false;
+  }
+}
+
 }  // end of anonymous namespace
 
+static_assert(sizeof(RefBase) <= RefPool::kBlockSize &&
+                  sizeof(Reference) <= RefPool::kBlockSize,
+              "References do not fit into the blocks of RefPool");
+
+void RefPool::Grow() {
+  _slabs.emplace_back(new Block[kBlocksPerSlab]);
+  Block* slab = _slabs.back().get();
+  for (size_t i = 0; i < kBlocksPerSlab; i++) Free(&slab[i]);
+}
+
 // Wrapper around v8impl::Persistent that implements reference counting.
 RefBase::RefBase(napi_env env,
                  uint32_t initial_refcount,
@@ -473,12 +581,12 @@ RefBase* RefBase::New(napi_env env,
                       napi_finalize finalize_callback,
                       void* finalize_data,
                       void* finalize_hint) {
-  return new RefBase(env,
-                     initial_refcount,
-                     delete_self,
-                     finalize_callback,
-                     finalize_data,
-                     finalize_hint);
+  return new (env->ref_pool.Allocate()) RefBase(env,
+                                                initial_refcount,
+                                                delete_self,
+                                                finalize_callback,
+                                                finalize_data,
+                                                finalize_hint);
 }
 
 RefBase::~RefBase() {
@@ -507,7 +615,9 @@ void* RefBase::Data() {
 void RefBase::Delete(RefBase* reference) {
   if ((reference->RefCount() != 0) || (reference->_delete_self) ||
       (reference->_finalize_ran)) {
-    delete reference;
+    napi_env env = reference->_env;
+    reference->~RefBase();
+    env->ref_pool.Free(reference);
   } else {
     // defer until finalizer runs as
     // it may already be queued
@@ -587,13 +697,13 @@ Reference* Reference::New(napi_env env,
                           napi_finalize finalize_callback,
                           void* finalize_data,
                           void* finalize_hint) {
-  return new Reference(env,
-                       value,
-                       initial_refcount,
-                       delete_self,
-                       finalize_callback,
-                       finalize_data,
-                       finalize_hint);
+  return new (env->ref_pool.Allocate()) Reference(env,
+                                                  value,
+                                                  initial_refcount,
+                                                  delete_self,
+                                                  finalize_callback,
+                                                  finalize_data,
+                                                  finalize_hint);
 }
 
 Reference::~Reference() {
@@ -801,6 +911,68 @@ napi_status napi_create_function(napi_env env,
   return GET_RETURN_STATUS(env);
 }
 
+napi_status node_api_create_function_with_fast_path(
+    napi_env env,
+    const char* utf8name,
+    size_t length,
+    napi_callback cb,
+    void* callback_data,
+    const node_api_fast_signature* fast_signature,
+    napi_value* result) {
+  NAPI_PREAMBLE(env);
+  CHECK_ARG(env, result);
+  CHECK_ARG(env, cb);
+  CHECK_ARG(env, fast_signature);
+  CHECK_ARG(env, fast_signature->fast_cb);
+  RETURN_STATUS_IF_FALSE(env,
+      fast_signature->arg_count == 0 || fast_signature->arg_types != nullptr,
+      napi_invalid_arg);
+
+  v8::CTypeInfo return_info(v8::CTypeInfo::Type::kVoid);
+  RETURN_STATUS_IF_FALSE(env,
+      v8impl::FastTypeToCTypeInfo(
+          fast_signature->return_type, true, &return_info),
+      napi_invalid_arg);
+  // The receiver, the arguments, and the options.
+  std::vector<v8::CTypeInfo> arg_info;
+  arg_info.reserve(fast_signature->arg_count + 2);
+  arg_info.emplace_back(v8::CTypeInfo::Type::kV8Value);
+  for (size_t i = 0; i < fast_signature->arg_count; i++) {
+    v8::CTypeInfo info(v8::CTypeInfo::Type::kVoid);
+    RETURN_STATUS_IF_FALSE(env,
+        v8impl::FastTypeToCTypeInfo(
+            fast_signature->arg_types[i], false, &info),
+        napi_invalid_arg);
+    arg_info.push_back(info);
+  }
+  arg_info.emplace_back(v8::CTypeInfo::kCallbackOptionsType);
+
+  env->fast_call_signatures.emplace_back(
+      std::make_unique<v8impl::FastCallSignature>(
+          reinterpret_cast<const void*>(fast_signature->fast_cb),
+          return_info,
+          std::move(arg_info)));
+  const v8::CFunction* c_function =
+      &env->fast_call_signatures.back()->function;
+
+  v8::Local<v8::Function> return_value;
+  v8::EscapableHandleScope scope(env->isolate);
+  v8::Local<v8::Function> fn;
+  STATUS_CALL(v8impl::FunctionCallbackWrapper::NewFunction(
+      env, cb, callback_data, c_function, &fn));
+  return_value = scope.Escape(fn);
+
+  if (utf8name != nullptr) {
+    v8::Local<v8::String> name_string;
+    CHECK_NEW_FROM_UTF8_LEN(env, name_string, utf8name, length);
+    return_value->SetName(name_string);
+  }
+
+  *result = v8impl::JsValueFromV8LocalValue(return_value);
+
+  return GET_RETURN_STATUS(env);
+}
+
 napi_status napi_define_class(napi_env env,
                               const char* utf8name,
                               size_t length,
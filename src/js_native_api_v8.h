@@ -3,8 +3,12 @@
 
 // This file needs to be compatible with C compilers.
 #include <string.h>  // NOLINT(modernize-deprecated-headers)
+#include <cstddef>
+#include <memory>
+#include <vector>
 #include "js_native_api_types.h"
 #include "js_native_api_v8_internals.h"
+#include "v8-fast-api-calls.h"
 
 static napi_status napi_clear_last_error(napi_env env);
 
@@ -49,6 +53,59 @@ class RefTracker {
   RefList* prev_ = nullptr;
 };
 
+// The type information of a fast callback, which V8 reads whenever it
+// optimizes a call to the function, and which therefore lives as long as the
+// napi_env does.
+struct FastCallSignature {
+  FastCallSignature(const void* address,
+                    const v8::CTypeInfo& return_info,
+                    std::vector<v8::CTypeInfo>&& arg_info)
+      : arg_info(std::move(arg_info)),
+        info(return_info, this->arg_info.size(), this->arg_info.data()),
+        function(address, &info) {}
+
+  const std::vector<v8::CTypeInfo> arg_info;
+  const v8::CFunctionInfo info;
+  const v8::CFunction function;
+};
+
+// Memory for References, carved out of slabs that are only returned to the
+// system with the napi_env, so that wrapping an object does not take a heap
+// allocation of its own. Only used on the napi_env's thread.
+class RefPool {
+ public:
+  static constexpr size_t kBlockSize = 128;
+  static constexpr size_t kBlocksPerSlab = 256;
+
+  RefPool() = default;
+  RefPool(const RefPool&) = delete;
+  RefPool& operator=(const RefPool&) = delete;
+
+  inline void* Allocate() {
+    if (_free == nullptr) Grow();
+    Block* block = _free;
+    _free = block->next;
+    return block;
+  }
+
+  inline void Free(void* pointer) {
+    Block* block = static_cast<Block*>(pointer);
+    block->next = _free;
+    _free = block;
+  }
+
+ private:
+  union Block {
+    Block* next;
+    alignas(std::max_align_t) char storage[kBlockSize];
+  };
+
+  void Grow();
+
+  std::vector<std::unique_ptr<Block[]>> _slabs;
+  Block* _free = nullptr;
+};
+
 }  // end of namespace v8impl
 
 struct napi_env__ {
@@ -121,6 +178,9 @@ struct napi_env__ {
   int open_callback_scopes = 0;
   int refs = 1;
   void* instance_data = nullptr;
+  std::vector<std::unique_ptr<v8impl::FastCallSignature>>
+      fast_call_signatures;
+  v8impl::RefPool ref_pool;
 };
 
 // This class is used to keep a napi_env live in a way that
@@ -440,6 +500,7 @@ class Reference : public RefBase {
   bool _secondPassScheduled;
 
   FRIEND_TEST(JsNativeApiV8Test, Reference);
+  FRIEND_TEST(JsNativeApiV8Test, FinalizersAreBatched);
 };
 
 }  // end of namespace v8impl
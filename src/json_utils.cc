@@ -1,42 +1,92 @@
 #include "json_utils.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>  // SSE2, which is part of the x86-64 baseline.
+#define NODE_JSON_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_JSON_NEON 1
+#endif
+
 namespace node {
 
-std::string EscapeJsonChars(const std::string& str) {
-  const std::string control_symbols[0x20] = {
-      "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005",
-      "\\u0006", "\\u0007", "\\b", "\\t", "\\n", "\\v", "\\f", "\\r",
-      "\\u000e", "\\u000f", "\\u0010", "\\u0011", "\\u0012", "\\u0013",
-      "\\u0014", "\\u0015", "\\u0016", "\\u0017", "\\u0018", "\\u0019",
-      "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"
-  };
+namespace {
 
-  std::string ret;
-  size_t last_pos = 0;
+const char* const kControlSymbols[0x20] = {
+    "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005",
+    "\\u0006", "\\u0007", "\\b", "\\t", "\\n", "\\v", "\\f", "\\r",
+    "\\u000e", "\\u000f", "\\u0010", "\\u0011", "\\u0012", "\\u0013",
+    "\\u0014", "\\u0015", "\\u0016", "\\u0017", "\\u0018", "\\u0019",
+    "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f"
+};
+
+inline bool NeedsEscape(char ch) {
+  return static_cast<unsigned char>(ch) < 0x20 || ch == '"' || ch == '\\';
+}
+
+// Returns the position of the first character at or after `pos` that needs
+// to be escaped, or `length` if there is none.
+size_t FindEscape(const char* str, size_t pos, size_t length) {
+#if defined(NODE_JSON_SSE2)
+  const __m128i max_control = _mm_set1_epi8(0x1f);
+  for (; pos + 16 <= length; pos += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos));
+    // The unsigned maximum with 0x1f is 0x1f exactly for the controls.
+    const __m128i escaped = _mm_or_si128(
+        _mm_cmpeq_epi8(_mm_max_epu8(block, max_control), max_control),
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))));
+    if (_mm_movemask_epi8(escaped) != 0)
+      break;
+  }
+#elif defined(NODE_JSON_NEON)
+  for (; pos + 16 <= length; pos += 16) {
+    const uint8x16_t block =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(str + pos));
+    const uint8x16_t escaped = vorrq_u8(
+        vcltq_u8(block, vdupq_n_u8(0x20)),
+        vorrq_u8(vceqq_u8(block, vdupq_n_u8('"')),
+                 vceqq_u8(block, vdupq_n_u8('\\'))));
+    if (vmaxvq_u8(escaped) != 0)
+      break;
+  }
+#endif
+  for (; pos < length; pos++) {
+    if (NeedsEscape(str[pos]))
+      break;
+  }
+  return pos;
+}
+
+}  // anonymous namespace
+
+void EscapeJsonChars(const char* str, size_t length, std::string* out) {
   size_t pos = 0;
-  for (; pos < str.size(); ++pos) {
-    std::string replace;
-    char ch = str[pos];
+  while (pos < length) {
+    const size_t next = FindEscape(str, pos, length);
+    out->append(str + pos, next - pos);
+    if (next == length)
+      break;
+    const char ch = str[next];
     if (ch == '\\') {
-      replace = "\\\\";
-    } else if (ch == '\"') {
-      replace = "\\\"";
+      out->append("\\\\", 2);
+    } else if (ch == '"') {
+      out->append("\\\"", 2);
     } else {
-      size_t num = static_cast<size_t>(ch);
-      if (num < 0x20) replace = control_symbols[num];
-    }
-    if (!replace.empty()) {
-      if (pos > last_pos) {
-        ret += str.substr(last_pos, pos - last_pos);
-      }
-      last_pos = pos + 1;
-      ret += replace;
+      out->append(kControlSymbols[static_cast<unsigned char>(ch)]);
     }
+    pos = next + 1;
   }
-  // Append any remaining symbols.
-  if (last_pos < str.size()) {
-    ret += str.substr(last_pos, pos - last_pos);
-  }
+}
+
+std::string EscapeJsonChars(const std::string& str) {
+  std::string ret;
+  ret.reserve(str.size());
+  EscapeJsonChars(str.data(), str.size(), &ret);
   return ret;
 }
 
@@ -63,4 +113,66 @@ std::string Reindent(const std::string& str, int indent_depth) {
   return out;
 }
 
+FdOutputStream::FdOutputStream(uv_file fd)
+    : std::ostream(nullptr), buffer_(fd) {
+  rdbuf(&buffer_);
+}
+
+FdOutputStream::~FdOutputStream() {
+  buffer_.pubsync();
+}
+
+FdOutputStream::Buffer::Buffer(uv_file fd)
+    : fd_(fd), data_(new char[kBufferSize]) {
+  setp(data_.get(), data_.get() + kBufferSize);
+}
+
+bool FdOutputStream::Buffer::Flush() {
+  const char* data = pbase();
+  size_t length = pptr() - pbase();
+  setp(data_.get(), data_.get() + kBufferSize);
+  while (length > 0 && error_ == 0) {
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(data), length);
+    uv_fs_t req;
+    const int written = uv_fs_write(nullptr, &req, fd_, &buf, 1, -1, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (written < 0) {
+      error_ = written;
+    } else {
+      data += written;
+      length -= written;
+    }
+  }
+  return error_ == 0;
+}
+
+FdOutputStream::Buffer::int_type FdOutputStream::Buffer::overflow(
+    int_type ch) {
+  if (!Flush())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(ch, traits_type::eof()))
+    sputc(traits_type::to_char_type(ch));
+  return traits_type::not_eof(ch);
+}
+
+std::streamsize FdOutputStream::Buffer::xsputn(const char* data,
+                                               std::streamsize length) {
+  const std::streamsize total = length;
+  while (length > 0) {
+    if (pptr() == epptr() && !Flush())
+      return total - length;
+    const std::streamsize chunk =
+        std::min<std::streamsize>(length, epptr() - pptr());
+    memcpy(pptr(), data, chunk);
+    pbump(static_cast<int>(chunk));
+    data += chunk;
+    length -= chunk;
+  }
+  return total;
+}
+
+int FdOutputStream::Buffer::sync() {
+  return Flush() ? 0 : -1;
+}
+
 }  // namespace node
@@ -3,16 +3,58 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <cstring>
 #include <iomanip>
 #include <ostream>
 #include <limits>
+#include <memory>
+#include <streambuf>
 #include <string>
 
+#include "uv.h"
+
 namespace node {
 
 std::string EscapeJsonChars(const std::string& str);
+// Appends the escaped form of `length` bytes at `str` to `out`.
+void EscapeJsonChars(const char* str, size_t length, std::string* out);
 std::string Reindent(const std::string& str, int indentation);
 
+// An output stream that writes straight to a file descriptor through
+// a 64 KiB buffer, for writing large reports without going through the
+// C++ file streams. The descriptor is not closed. error() is the libuv
+// error code of the first write that failed, or 0.
+class FdOutputStream : public std::ostream {
+ public:
+  explicit FdOutputStream(uv_file fd);
+  ~FdOutputStream() override;
+
+  int error() const { return buffer_.error(); }
+
+ private:
+  class Buffer : public std::streambuf {
+   public:
+    explicit Buffer(uv_file fd);
+    int error() const { return error_; }
+
+   protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize length) override;
+    int sync() override;
+
+   private:
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    bool Flush();
+
+    uv_file fd_;
+    int error_ = 0;
+    std::unique_ptr<char[]> data_;
+  };
+
+  Buffer buffer_;
+};
+
 // JSON compiler definitions.
 class JSONWriter {
  public:
@@ -142,16 +184,26 @@ class JSONWriter {
     out_ << Reindent(json.as_string, indent_);
   }
 
+  inline void write_string(const char* str, size_t length) {
+    // Escape into a buffer that is reused, and write it in one go.
+    escaped_.assign(1, '"');
+    EscapeJsonChars(str, length, &escaped_);
+    escaped_ += '"';
+    out_.write(escaped_.data(), escaped_.size());
+  }
   inline void write_string(const std::string& str) {
-    out_ << '"' << EscapeJsonChars(str) << '"';
+    write_string(str.data(), str.size());
+  }
+  inline void write_string(const char* str) {
+    write_string(str, strlen(str));
   }
-  inline void write_string(const char* str) { write_string(std::string(str)); }
 
   enum JSONState { kObjectStart, kAfterValue };
   std::ostream& out_;
   bool compact_;
   int indent_ = 0;
   int state_ = kObjectStart;
+  std::string escaped_;
 };
 
 }  // namespace node
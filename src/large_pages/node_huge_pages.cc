@@ -0,0 +1,267 @@
+#include "node_huge_pages.h"
+#include "node_mutex.h"
+#include "util.h"
+#include "v8-platform.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#endif
+
+namespace node {
+namespace huge_pages {
+
+#if defined(__linux__)
+
+namespace {
+
+enum class Mode { kOff, kMadvise, kExplicit };
+
+Mode mode = Mode::kOff;
+size_t huge_page_size = 2 * 1024 * 1024;
+size_t threshold = SIZE_MAX;
+
+// Reads the value of a line like "Hugepagesize:    2048 kB".
+size_t ReadMeminfoSize(const char* key) {
+  std::ifstream meminfo("/proc/meminfo");
+  std::string name;
+  size_t value;
+  std::string unit;
+  while (meminfo >> name >> value) {
+    std::getline(meminfo, unit);
+    if (name == key)
+      return value * 1024;
+  }
+  return 0;
+}
+
+size_t ReadTransparentHugePageSize() {
+  std::ifstream file("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+  size_t value = 0;
+  file >> value;
+  return value;
+}
+
+// Maps `length` bytes aligned to `alignment`, which must be a multiple of
+// the page size, near `hint` if possible.
+void* MapAligned(void* hint, size_t length, size_t alignment, int protection,
+                 int flags) {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t request = length + alignment - page_size;
+  void* result = mmap(hint, request, protection,
+                      MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  if (result == MAP_FAILED)
+    return nullptr;
+  char* start = static_cast<char*>(result);
+  char* aligned = reinterpret_cast<char*>(
+      RoundUp(reinterpret_cast<uintptr_t>(start), alignment));
+  if (aligned != start)
+    munmap(start, aligned - start);
+  if (aligned + length != start + request)
+    munmap(aligned + length, start + request - (aligned + length));
+  return aligned;
+}
+
+void AdviseHugePages(void* address, size_t length) {
+  if (length >= huge_page_size)
+    madvise(address, length, MADV_HUGEPAGE);
+}
+
+int Protection(v8::PageAllocator::Permission permission) {
+  switch (permission) {
+    case v8::PageAllocator::kNoAccess:
+    case v8::PageAllocator::kNoAccessWillJitLater:
+      return PROT_NONE;
+    case v8::PageAllocator::kRead:
+      return PROT_READ;
+    case v8::PageAllocator::kReadWrite:
+      return PROT_READ | PROT_WRITE;
+    case v8::PageAllocator::kReadWriteExecute:
+      return PROT_READ | PROT_WRITE | PROT_EXEC;
+    case v8::PageAllocator::kReadExecute:
+      return PROT_READ | PROT_EXEC;
+  }
+  UNREACHABLE();
+}
+
+// Does what V8's own page allocator does on Linux, and additionally asks
+// for transparent huge pages for every range of at least one huge page.
+class HugePageAllocator final : public v8::PageAllocator {
+ public:
+  HugePageAllocator()
+      : page_size_(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+        random_state_(static_cast<uint64_t>(time(nullptr)) ^
+                      reinterpret_cast<uintptr_t>(this)) {}
+
+  size_t AllocatePageSize() override { return page_size_; }
+  size_t CommitPageSize() override { return page_size_; }
+
+  void SetRandomMmapSeed(int64_t seed) override {
+    if (seed == 0)
+      return;
+    Mutex::ScopedLock lock(mutex_);
+    random_state_ = static_cast<uint64_t>(seed);
+  }
+
+  void* GetRandomMmapAddr() override {
+#if UINTPTR_MAX == 0xffffffffffffffff
+    Mutex::ScopedLock lock(mutex_);
+    // xorshift64*
+    random_state_ ^= random_state_ >> 12;
+    random_state_ ^= random_state_ << 25;
+    random_state_ ^= random_state_ >> 27;
+    const uint64_t random = random_state_ * 0x2545f4914f6cdd1dULL;
+    // Stay within the 46 bits of address space that V8 uses as well.
+    return reinterpret_cast<void*>(
+        random & 0x3fffffffffffULL & ~static_cast<uint64_t>(page_size_ - 1));
+#else
+    return nullptr;
+#endif
+  }
+
+  void* AllocatePages(void* address, size_t length, size_t alignment,
+                      Permission permission) override {
+    const int flags = permission == kNoAccess ||
+                      permission == kNoAccessWillJitLater ?
+                          MAP_NORESERVE : 0;
+    if (length >= huge_page_size)
+      alignment = std::max(alignment, huge_page_size);
+    void* result =
+        MapAligned(address, length, alignment, Protection(permission), flags);
+    if (result != nullptr)
+      AdviseHugePages(result, length);
+    return result;
+  }
+
+  bool FreePages(void* address, size_t length) override {
+    return munmap(address, length) == 0;
+  }
+
+  bool ReleasePages(void* address, size_t length, size_t new_length) override {
+    return munmap(static_cast<char*>(address) + new_length,
+                  length - new_length) == 0;
+  }
+
+  bool SetPermissions(void* address, size_t length,
+                      Permission permission) override {
+    if (mprotect(address, length, Protection(permission)) != 0)
+      return false;
+    // Like V8, release the memory of pages that become inaccessible.
+    if (permission == kNoAccess)
+      DiscardSystemPages(address, length);
+    return true;
+  }
+
+  bool DiscardSystemPages(void* address, size_t size) override {
+    return madvise(address, size, MADV_DONTNEED) == 0;
+  }
+
+  bool DecommitPages(void* address, size_t size) override {
+    // Mapping fresh pages over the range both frees the memory and makes
+    // it read as zero once it is accessible again.
+    void* result = mmap(address, size, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED |
+                            MAP_NORESERVE,
+                        -1, 0);
+    if (result != address)
+      return false;
+    AdviseHugePages(address, size);
+    return true;
+  }
+
+ private:
+  const size_t page_size_;
+  Mutex mutex_;
+  uint64_t random_state_;
+};
+
+}  // anonymous namespace
+
+bool Initialize(const std::string& mode_name, size_t size_threshold) {
+  CHECK_EQ(mode, Mode::kOff);
+  if (mode_name == "off")
+    return true;
+
+  size_t page_size = 0;
+  if (mode_name == "explicit") {
+    mode = Mode::kExplicit;
+    page_size = ReadMeminfoSize("Hugepagesize:");
+  } else {
+    CHECK_EQ(mode_name, "madvise");
+    mode = Mode::kMadvise;
+    page_size = ReadTransparentHugePageSize();
+  }
+  if (page_size == 0 ||
+      page_size % static_cast<size_t>(sysconf(_SC_PAGESIZE)) != 0) {
+    mode = Mode::kOff;
+    return false;
+  }
+  huge_page_size = page_size;
+  threshold = std::max(RoundUp(size_threshold, page_size), page_size);
+  return true;
+}
+
+bool ShouldUse(size_t size) {
+  return size >= threshold;
+}
+
+void* Allocate(size_t size) {
+  const size_t length = RoundUp(size, huge_page_size);
+  if (mode == Mode::kExplicit) {
+    void* result = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (result != MAP_FAILED)
+      return result;
+  }
+  void* result = MapAligned(nullptr, length, huge_page_size,
+                            PROT_READ | PROT_WRITE, 0);
+  if (result != nullptr)
+    AdviseHugePages(result, length);
+  return result;
+}
+
+void Free(void* data, size_t size) {
+  if (data != nullptr)
+    CHECK_EQ(munmap(data, RoundUp(size, huge_page_size)), 0);
+}
+
+v8::PageAllocator* GetPageAllocator() {
+  if (mode == Mode::kOff)
+    return nullptr;
+  // Never destroyed, as V8 may use it until the process exits.
+  static HugePageAllocator* const allocator = new HugePageAllocator();
+  return allocator;
+}
+
+#else  // !defined(__linux__)
+
+bool Initialize(const std::string& mode, size_t threshold) {
+  return mode == "off";
+}
+
+bool ShouldUse(size_t size) {
+  return false;
+}
+
+void* Allocate(size_t size) {
+  UNREACHABLE();
+}
+
+void Free(void* data, size_t size) {
+  UNREACHABLE();
+}
+
+v8::PageAllocator* GetPageAllocator() {
+  return nullptr;
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace huge_pages
+}  // namespace node
@@ -0,0 +1,44 @@
+#ifndef SRC_LARGE_PAGES_NODE_HUGE_PAGES_H_
+#define SRC_LARGE_PAGES_NODE_HUGE_PAGES_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <string>
+
+namespace v8 {
+class PageAllocator;
+}  // namespace v8
+
+namespace node {
+
+// Huge page backing for large ArrayBuffers and for the V8 heap, used by
+// --huge-pages. This is only supported on Linux, where 'madvise' asks for
+// transparent huge pages, and 'explicit' maps ArrayBuffers from the
+// hugetlbfs pool, falling back to transparent huge pages when that is
+// exhausted. The V8 heap always uses transparent huge pages, as it frees
+// and decommits memory in pieces smaller than a huge page.
+namespace huge_pages {
+
+// Must be called before any of the functions below, and before V8 is
+// initialized. Returns false if the mode is not supported on this platform,
+// in which case huge pages stay off. The threshold is rounded up to the
+// huge page size.
+bool Initialize(const std::string& mode, size_t threshold);
+
+// Whether an ArrayBuffer of `size` bytes is backed by huge pages.
+bool ShouldUse(size_t size);
+// Returns zero-filled memory for `size` bytes that ShouldUse(), or nullptr.
+void* Allocate(size_t size);
+void Free(void* data, size_t size);
+
+// Returns a page allocator for V8 that asks for huge pages for large
+// reservations, or nullptr if huge pages are off.
+v8::PageAllocator* GetPageAllocator();
+
+}  // namespace huge_pages
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_LARGE_PAGES_NODE_HUGE_PAGES_H_
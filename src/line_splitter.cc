@@ -0,0 +1,107 @@
+#include "line_splitter.h"
+#include "util.h"
+
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>  // SSE2, which is part of the x86-64 baseline.
+#define NODE_LINE_SPLITTER_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_LINE_SPLITTER_NEON 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace node {
+
+namespace {
+
+// Calls `on_delimiter(offset)` for each occurrence of `delimiter` in
+// data[index, length), in order.
+template <typename Callback>
+inline void ForEachDelimiter(const char* data,
+                             size_t index,
+                             size_t length,
+                             char delimiter,
+                             Callback&& on_delimiter) {
+#if defined(NODE_LINE_SPLITTER_SSE2)
+  const __m128i needle = _mm_set1_epi8(delimiter);
+  for (; index + 16 <= length; index += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    while (mask != 0) {
+#ifdef _MSC_VER
+      unsigned long bit;  // NOLINT(runtime/int)
+      _BitScanForward(&bit, mask);
+#else
+      const unsigned bit = __builtin_ctz(mask);
+#endif
+      on_delimiter(index + bit);
+      mask &= mask - 1;
+    }
+  }
+#elif defined(NODE_LINE_SPLITTER_NEON)
+  const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(delimiter));
+  for (; index + 16 <= length; index += 16) {
+    const uint8x16_t matches = vceqq_u8(
+        vld1q_u8(reinterpret_cast<const uint8_t*>(data + index)), needle);
+    // Four bits for each byte.
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+        vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+    while (mask != 0) {
+#ifdef _MSC_VER
+      unsigned long bit;  // NOLINT(runtime/int)
+      _BitScanForward64(&bit, mask);
+#else
+      const unsigned bit = __builtin_ctzll(mask);
+#endif
+      on_delimiter(index + bit / 4);
+      mask &= ~(uint64_t{0xf} << (bit & ~3u));
+    }
+  }
+#endif
+  while (index < length) {
+    const void* match = memchr(data + index, delimiter, length - index);
+    if (match == nullptr) return;
+    index = static_cast<const char*>(match) - data;
+    on_delimiter(index++);
+  }
+}
+
+}  // anonymous namespace
+
+size_t LineSplitter::Split(const char* data,
+                           size_t length,
+                           size_t carried,
+                           std::vector<uint32_t>* lines) {
+  CHECK_LE(carried, length);
+  CHECK_LE(length, std::numeric_limits<uint32_t>::max());
+
+  size_t start = 0;
+  ForEachDelimiter(data, carried, length, delimiter_, [&](size_t end) {
+    if (dropping_) {
+      dropping_ = false;
+    } else if (end - start > max_line_length_) {
+      dropped_++;
+    } else {
+      lines->push_back(static_cast<uint32_t>(start));
+      lines->push_back(static_cast<uint32_t>(end));
+    }
+    start = end + 1;
+  });
+
+  if (dropping_) return length;
+  if (length - start > max_line_length_) {
+    // Whatever follows cannot make the line short enough again.
+    dropping_ = true;
+    dropped_++;
+    return length;
+  }
+  return start;
+}
+
+}  // namespace node
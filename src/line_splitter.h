@@ -0,0 +1,58 @@
+#ifndef SRC_LINE_SPLITTER_H_
+#define SRC_LINE_SPLITTER_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace node {
+
+// Splits a stream of bytes into lines that end with a single-byte
+// delimiter, such as '\n' for NDJSON, scanning 16 bytes at a time with
+// vector instructions. Lines that are longer than `max_line_length`, not
+// counting the delimiter, are dropped rather than buffered without bound.
+//
+// The caller keeps the unterminated rest of each chunk and passes it in
+// front of the next one, so that a line always ends up in one piece.
+class LineSplitter {
+ public:
+  LineSplitter(char delimiter, size_t max_line_length)
+      : delimiter_(delimiter), max_line_length_(max_line_length) {}
+
+  // Appends the start and end offsets of each complete line in `data` to
+  // `lines`, without the delimiter. The first `carried` bytes are the rest
+  // that the previous call left over, and are not scanned again. Returns the
+  // offset of the new rest, which is `length` if there is none or if it is
+  // part of a line that is being dropped. `length` must fit in 32 bits.
+  size_t Split(const char* data,
+               size_t length,
+               size_t carried,
+               std::vector<uint32_t>* lines);
+
+  // Returns how many lines were dropped since the last call.
+  size_t TakeDropped() {
+    const size_t dropped = dropped_;
+    dropped_ = 0;
+    return dropped;
+  }
+
+  // Whether the bytes that follow belong to a line that is being dropped.
+  bool dropping() const { return dropping_; }
+
+  char delimiter() const { return delimiter_; }
+  size_t max_line_length() const { return max_line_length_; }
+
+ private:
+  const char delimiter_;
+  const size_t max_line_length_;
+  bool dropping_ = false;
+  size_t dropped_ = 0;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_LINE_SPLITTER_H_
@@ -0,0 +1,93 @@
+#include "memory_budget.h"
+#include "util.h"
+
+#include <algorithm>
+
+namespace node {
+
+MemoryBudget::MemoryBudget(size_t high_watermark,
+                           size_t low_watermark,
+                           std::shared_ptr<MemoryBudget> parent,
+                           std::function<void(bool exceeded)> on_change)
+    : high_watermark_(high_watermark),
+      low_watermark_(std::min(low_watermark, high_watermark)),
+      parent_(std::move(parent)),
+      on_change_(std::move(on_change)) {
+  if (parent_) {
+    parent_->children_.push_back(this);
+    reported_ = exceeded();
+  }
+}
+
+MemoryBudget::~MemoryBudget() {
+  CHECK(children_.empty());
+  if (!parent_) return;
+  auto it = std::find(parent_->children_.begin(),
+                      parent_->children_.end(),
+                      this);
+  CHECK_NE(it, parent_->children_.end());
+  parent_->children_.erase(it);
+  if (parent_->Update(used_, false))
+    parent_->ReportChange();
+}
+
+void MemoryBudget::Charge(size_t bytes) {
+  if (bytes > 0) Adjust(bytes, true);
+}
+
+void MemoryBudget::Release(size_t bytes) {
+  if (bytes > 0) Adjust(bytes, false);
+}
+
+void MemoryBudget::SetWatermarks(size_t high_watermark,
+                                 size_t low_watermark) {
+  high_watermark_ = high_watermark;
+  low_watermark_ = std::min(low_watermark, high_watermark);
+  if (Update(0, true))
+    ReportChange();
+  else
+    Report();
+}
+
+void MemoryBudget::Adjust(size_t bytes, bool charge) {
+  Update(bytes, charge);
+  if (parent_ && parent_->Update(bytes, charge))
+    parent_->ReportChange();
+  else
+    Report();
+}
+
+bool MemoryBudget::Update(size_t bytes, bool charge) {
+  if (charge) {
+    used_ += bytes;
+  } else {
+    CHECK_GE(used_, bytes);
+    used_ -= bytes;
+  }
+  const bool over = used_ > high_watermark_ ||
+                    (over_ && used_ > low_watermark_);
+  if (over == over_) return false;
+  over_ = over;
+  return true;
+}
+
+void MemoryBudget::ReportChange() {
+  Report();
+  // Copied, since callbacks may create or destroy budgets.
+  std::vector<MemoryBudget*> children = children_;
+  for (MemoryBudget* child : children) {
+    if (std::find(children_.begin(), children_.end(), child) !=
+        children_.end()) {
+      child->Report();
+    }
+  }
+}
+
+void MemoryBudget::Report() {
+  const bool now = exceeded();
+  if (now == reported_) return;
+  reported_ = now;
+  if (on_change_) on_change_(now);
+}
+
+}  // namespace node
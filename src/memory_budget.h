@@ -0,0 +1,69 @@
+#ifndef SRC_MEMORY_BUDGET_H_
+#define SRC_MEMORY_BUDGET_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace node {
+
+// Counts the bytes that a connection holds in native buffers, such as
+// queued writes and parser state, so that it can stop reading when it holds
+// too much. A budget is exceeded once it goes above its high watermark, and
+// until it is back at or below its low watermark.
+//
+// A budget may have a parent, e.g. the one of the server that accepted the
+// connection. What is charged to a budget is charged to its parent as well,
+// and a budget also counts as exceeded while its parent is. Budgets belong to
+// a single thread.
+class MemoryBudget {
+ public:
+  // `on_change` is called whenever exceeded() changes.
+  MemoryBudget(size_t high_watermark,
+               size_t low_watermark,
+               std::shared_ptr<MemoryBudget> parent = nullptr,
+               std::function<void(bool exceeded)> on_change = nullptr);
+  // Gives what is still charged back to the parent.
+  ~MemoryBudget();
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  void Charge(size_t bytes);
+  void Release(size_t bytes);
+  // What is charged already stays charged.
+  void SetWatermarks(size_t high_watermark, size_t low_watermark);
+
+  bool exceeded() const { return over_ || (parent_ && parent_->over_); }
+  size_t used() const { return used_; }
+  size_t high_watermark() const { return high_watermark_; }
+  size_t low_watermark() const { return low_watermark_; }
+  const std::shared_ptr<MemoryBudget>& parent() const { return parent_; }
+
+ private:
+  // Adds `bytes` to `used_`, or takes them away, and returns whether that
+  // moved this budget across its watermarks.
+  bool Update(size_t bytes, bool charge);
+  void Adjust(size_t bytes, bool charge);
+  // Calls Report() on this budget and its children.
+  void ReportChange();
+  void Report();
+
+  size_t high_watermark_;
+  size_t low_watermark_;
+  const std::shared_ptr<MemoryBudget> parent_;
+  const std::function<void(bool exceeded)> on_change_;
+  std::vector<MemoryBudget*> children_;
+  size_t used_ = 0;
+  bool over_ = false;
+  bool reported_ = false;  // What on_change_ was last called with.
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_MEMORY_BUDGET_H_
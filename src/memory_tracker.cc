@@ -0,0 +1,9 @@
+#include "memory_tracker.h"
+
+namespace node {
+namespace native_memory {
+
+std::atomic<int64_t> totals[kCategoryCount] = {};
+
+}  // namespace native_memory
+}  // namespace node
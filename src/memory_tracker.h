@@ -7,6 +7,7 @@
 
 #include <uv.h>
 
+#include <atomic>
 #include <limits>
 #include <queue>
 #include <stack>
@@ -279,6 +280,40 @@ class MemoryTracker {
   NodeMap seen_;
 };
 
+// Live, process-wide totals of the native memory that some subsystems hold,
+// kept up to date by the classes that allocate it. Unlike MemoryInfo(),
+// which walks the object graph for heap snapshots, these are cheap enough
+// to be read at any time, e.g. from process.memoryUsage().
+//
+// Category (name in JavaScript):
+#define NODE_NATIVE_MEMORY_CATEGORIES(V)                                      \
+  V(kHttp2, http2)               /* nghttp2 sessions                      */  \
+  V(kZlib, zlib)                 /* zlib and brotli streams               */  \
+  V(kTls, tls)                   /* SecureContext, TLSWrap and their BIOs */  \
+  V(kArrayBuffers, arrayBuffers) /* ArrayBuffer backing stores            */
+
+namespace native_memory {
+
+enum Category {
+#define V(id, name) id,
+  NODE_NATIVE_MEMORY_CATEGORIES(V)
+#undef V
+  kCategoryCount
+};
+
+// Defined in src/memory_tracker.cc.
+extern std::atomic<int64_t> totals[kCategoryCount];
+
+inline void Track(Category category, int64_t delta) {
+  totals[category].fetch_add(delta, std::memory_order_relaxed);
+}
+
+inline int64_t Get(Category category) {
+  return totals[category].load(std::memory_order_relaxed);
+}
+
+}  // namespace native_memory
+
 }  // namespace node
 
 #endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
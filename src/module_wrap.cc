@@ -2,10 +2,12 @@
 
 #include "env.h"
 #include "memory_tracker-inl.h"
+#include "node_compile_cache.h"
 #include "node_contextify.h"
 #include "node_errors.h"
 #include "node_internals.h"
 #include "node_process-inl.h"
+#include "node_startup_profile.h"
 #include "node_url.h"
 #include "node_watchdog.h"
 #include "util-inl.h"
@@ -52,6 +54,108 @@ using v8::UnboundModuleScript;
 using v8::Undefined;
 using v8::Value;
 
+namespace {
+
+// Hands the whole source text to V8 at once.
+class SourceTextStream final : public ScriptCompiler::ExternalSourceStream {
+ public:
+  SourceTextStream(uint8_t* data, size_t length)
+      : data_(data), length_(length) {}
+  ~SourceTextStream() override { delete[] data_; }
+
+  size_t GetMoreData(const uint8_t** src) override {
+    if (data_ == nullptr) return 0;
+    // V8 takes ownership of the data.
+    *src = data_;
+    data_ = nullptr;
+    return length_;
+  }
+
+ private:
+  uint8_t* data_;
+  size_t length_;
+};
+
+std::unique_ptr<ScriptCompiler::ExternalSourceStream> CopySourceText(
+    Isolate* isolate, Local<String> source) {
+  size_t length = source->Length();
+  uint8_t* data;
+  if (source->IsOneByte()) {
+    data = new uint8_t[length];
+    source->WriteOneByte(
+        isolate, data, 0, length, String::NO_NULL_TERMINATION);
+  } else {
+    data = new uint8_t[length * sizeof(uint16_t)];
+    source->Write(isolate,
+                  reinterpret_cast<uint16_t*>(data),
+                  0,
+                  length,
+                  String::NO_NULL_TERMINATION);
+    length *= sizeof(uint16_t);
+  }
+  return std::make_unique<SourceTextStream>(data, length);
+}
+
+}  // anonymous namespace
+
+class ModuleCompileJob::Task : public v8::Task {
+ public:
+  explicit Task(ModuleCompileJob* job) : job_(job) {}
+
+  void Run() override {
+    job_->streaming_task_->Run();
+    Mutex::ScopedLock lock(job_->mutex_);
+    job_->done_ = true;
+    job_->done_cv_.Broadcast(lock);
+  }
+
+ private:
+  ModuleCompileJob* job_;
+};
+
+ModuleCompileJob::ModuleCompileJob(Isolate* isolate, Local<String> source)
+    : source_(isolate, source),
+      streamed_source_(CopySourceText(isolate, source),
+                       source->IsOneByte()
+                           ? ScriptCompiler::StreamedSource::ONE_BYTE
+                           : ScriptCompiler::StreamedSource::TWO_BYTE) {}
+
+ModuleCompileJob::~ModuleCompileJob() {
+  Wait();
+}
+
+void ModuleCompileJob::Start(Environment* env) {
+  CHECK(!started_);
+  started_ = true;
+  streaming_task_.reset(ScriptCompiler::StartStreaming(
+      env->isolate(), &streamed_source_, v8::ScriptType::kModule));
+  if (!streaming_task_) {
+    Mutex::ScopedLock lock(mutex_);
+    done_ = true;
+    return;
+  }
+  env->isolate_data()->platform()->CallOnWorkerThread(
+      std::make_unique<Task>(this));
+}
+
+bool ModuleCompileJob::Matches(Isolate* isolate, Local<String> source) const {
+  return source->StringEquals(source_.Get(isolate));
+}
+
+MaybeLocal<Module> ModuleCompileJob::Finish(Local<Context> context,
+                                            Local<String> source,
+                                            const ScriptOrigin& origin) {
+  Wait();
+  return ScriptCompiler::CompileModule(
+      context, &streamed_source_, source, origin);
+}
+
+void ModuleCompileJob::Wait() {
+  if (!started_) return;
+  Mutex::ScopedLock lock(mutex_);
+  while (!done_) done_cv_.Wait(lock);
+}
+
 ModuleWrap::ModuleWrap(Environment* env,
                        Local<Object> object,
                        Local<Module> module,
@@ -187,6 +291,26 @@ void ModuleWrap::New(const FunctionCallbackInfo<Value>& args) {
       }
 
       Local<String> source_text = args[2].As<String>();
+      CompileCache* compile_cache = nullptr;
+      CompileCache::Entry cache_entry;
+      if (cached_data == nullptr &&
+          (compile_cache = CompileCache::Get()) != nullptr) {
+        cached_data = compile_cache->Lookup(
+            isolate, url, source_text, CachedCodeType::kESM, &cache_entry);
+      }
+      // Use the result of startCompile(), unless there is cached code.
+      std::shared_ptr<ModuleCompileJob> compile_job;
+      if (!env->url_to_compile_job_map.empty()) {
+        Utf8Value url_utf8(isolate, url);
+        auto it = env->url_to_compile_job_map.find(url_utf8.ToString());
+        if (it != env->url_to_compile_job_map.end()) {
+          if (cached_data == nullptr &&
+              it->second->Matches(isolate, source_text)) {
+            compile_job = std::move(it->second);
+          }
+          env->url_to_compile_job_map.erase(it);
+        }
+      }
       ScriptOrigin origin(isolate,
                           url,
                           line_offset,
@@ -205,8 +329,11 @@ void ModuleWrap::New(const FunctionCallbackInfo<Value>& args) {
       } else {
         options = ScriptCompiler::kConsumeCodeCache;
       }
-      if (!ScriptCompiler::CompileModule(isolate, &source, options)
-               .ToLocal(&module)) {
+      MaybeLocal<Module> maybe_module =
+          compile_job
+              ? compile_job->Finish(context, source_text, origin)
+              : ScriptCompiler::CompileModule(isolate, &source, options);
+      if (!maybe_module.ToLocal(&module)) {
         if (try_catch.HasCaught() && !try_catch.HasTerminated()) {
           CHECK(!try_catch.Message().IsEmpty());
           CHECK(!try_catch.Exception().IsEmpty());
@@ -216,8 +343,17 @@ void ModuleWrap::New(const FunctionCallbackInfo<Value>& args) {
         }
         return;
       }
-      if (options == ScriptCompiler::kConsumeCodeCache &&
-          source.GetCachedData()->rejected) {
+      if (cache_entry.IsValid()) {
+        if (StartupProfile* profile = StartupProfile::GetRecording(isolate))
+          profile->AddModule(cache_entry, module->GetUnboundModuleScript());
+        if (!cache_entry.loaded || source.GetCachedData()->rejected) {
+          compile_cache->Save(std::move(cache_entry),
+                              std::unique_ptr<ScriptCompiler::CachedData>(
+                                  ScriptCompiler::CreateCodeCache(
+                                      module->GetUnboundModuleScript())));
+        }
+      } else if (options == ScriptCompiler::kConsumeCodeCache &&
+                 source.GetCachedData()->rejected) {
         THROW_ERR_VM_MODULE_CACHED_DATA_REJECTED(
             env, "cachedData buffer was rejected");
         try_catch.ReThrow();
@@ -766,6 +902,129 @@ void ModuleWrap::CreateCachedData(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// startCompile(url, source)
+// Starts compiling a module in the background, to be picked up by
+// new ModuleWrap(url, context, source, ...) with the same URL and source.
+void ModuleWrap::StartCompile(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  CHECK(args[0]->IsString());
+  Utf8Value url(isolate, args[0]);
+  CHECK(args[1]->IsString());
+
+  auto job = std::make_shared<ModuleCompileJob>(isolate, args[1].As<String>());
+  job->Start(env);
+  env->url_to_compile_job_map[url.ToString()] = std::move(job);
+}
+
+namespace {
+
+// Export names are stored as a count followed by length-prefixed UTF-8
+// strings, once for the exports and once for the reexports.
+bool AppendNames(Isolate* isolate, Local<Array> names, std::string* out) {
+  Local<Context> context = isolate->GetCurrentContext();
+  uint32_t count = names->Length();
+  out->append(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> name;
+    if (!names->Get(context, i).ToLocal(&name)) return false;
+    Utf8Value utf8(isolate, name);
+    uint32_t length = utf8.length();
+    out->append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out->append(*utf8, length);
+  }
+  return true;
+}
+
+MaybeLocal<Array> ReadNames(Isolate* isolate,
+                            const std::string& in,
+                            size_t* pos) {
+  uint32_t count;
+  if (in.size() - *pos < sizeof(count)) return MaybeLocal<Array>();
+  memcpy(&count, in.data() + *pos, sizeof(count));
+  *pos += sizeof(count);
+  std::vector<Local<Value>> names;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t length;
+    if (in.size() - *pos < sizeof(length)) return MaybeLocal<Array>();
+    memcpy(&length, in.data() + *pos, sizeof(length));
+    *pos += sizeof(length);
+    Local<String> name;
+    if (in.size() - *pos < length ||
+        !String::NewFromUtf8(isolate, in.data() + *pos,
+                             v8::NewStringType::kNormal, length)
+             .ToLocal(&name)) {
+      return MaybeLocal<Array>();
+    }
+    *pos += length;
+    names.push_back(name);
+  }
+  return Array::New(isolate, names.data(), names.size());
+}
+
+}  // anonymous namespace
+
+// getCachedCJSExports(filename, source) returns [exports, reexports], as
+// cjs-module-lexer found them for the same source before, or undefined.
+void ModuleWrap::GetCachedCJSExports(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+
+  CompileCache* compile_cache = CompileCache::Get();
+  if (compile_cache == nullptr) return;
+  CompileCache::Entry entry;
+  std::string data;
+  if (!compile_cache->LookupData(isolate,
+                                 args[0].As<String>(),
+                                 args[1].As<String>(),
+                                 CachedCodeType::kCJSExports,
+                                 &entry,
+                                 &data)) {
+    return;
+  }
+
+  size_t pos = 0;
+  Local<Value> result[2];
+  for (Local<Value>& names : result) {
+    Local<Array> array;
+    if (!ReadNames(isolate, data, &pos).ToLocal(&array)) return;
+    names = array;
+  }
+  args.GetReturnValue().Set(Array::New(isolate, result, arraysize(result)));
+}
+
+// saveCachedCJSExports(filename, source, exports, reexports)
+void ModuleWrap::SaveCachedCJSExports(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsString());
+  CHECK(args[2]->IsArray());
+  CHECK(args[3]->IsArray());
+
+  CompileCache* compile_cache = CompileCache::Get();
+  if (compile_cache == nullptr) return;
+  CompileCache::Entry entry;
+  std::string data;
+  if (compile_cache->LookupData(isolate,
+                                args[0].As<String>(),
+                                args[1].As<String>(),
+                                CachedCodeType::kCJSExports,
+                                &entry,
+                                &data) ||
+      !entry.IsValid()) {
+    return;
+  }
+
+  data.clear();
+  if (!AppendNames(isolate, args[2].As<Array>(), &data) ||
+      !AppendNames(isolate, args[3].As<Array>(), &data)) {
+    return;
+  }
+  compile_cache->SaveData(std::move(entry), data.data(), data.size());
+}
+
 void ModuleWrap::Initialize(Local<Object> target,
                             Local<Value> unused,
                             Local<Context> context,
@@ -790,6 +1049,9 @@ void ModuleWrap::Initialize(Local<Object> target,
 
   env->SetConstructorFunction(target, "ModuleWrap", tpl);
 
+  env->SetMethod(target, "startCompile", StartCompile);
+  env->SetMethod(target, "getCachedCJSExports", GetCachedCJSExports);
+  env->SetMethod(target, "saveCachedCJSExports", SaveCachedCJSExports);
   env->SetMethod(target,
                  "setImportModuleDynamicallyCallback",
                  SetImportModuleDynamicallyCallback);
@@ -3,10 +3,12 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include "base_object.h"
+#include "node_mutex.h"
 
 namespace node {
 
@@ -30,6 +32,39 @@ enum HostDefinedOptions : int {
   kLength = 10,
 };
 
+// Compiles the source text of a module on a platform worker thread, through
+// V8's script streaming, so that when the loader creates the ModuleWrap for
+// it later on, only the main thread part of compiling is left to do.
+class ModuleCompileJob {
+ public:
+  ModuleCompileJob(v8::Isolate* isolate, v8::Local<v8::String> source);
+  // Waits for the background part to finish, as it uses the isolate.
+  ~ModuleCompileJob();
+
+  ModuleCompileJob(const ModuleCompileJob&) = delete;
+  ModuleCompileJob& operator=(const ModuleCompileJob&) = delete;
+
+  void Start(Environment* env);
+  bool Matches(v8::Isolate* isolate, v8::Local<v8::String> source) const;
+  // Waits for the background part, and creates the module.
+  v8::MaybeLocal<v8::Module> Finish(v8::Local<v8::Context> context,
+                                    v8::Local<v8::String> source,
+                                    const v8::ScriptOrigin& origin);
+
+ private:
+  class Task;
+
+  void Wait();
+
+  v8::Global<v8::String> source_;
+  v8::ScriptCompiler::StreamedSource streamed_source_;
+  std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> streaming_task_;
+  Mutex mutex_;
+  ConditionVariable done_cv_;
+  bool started_ = false;
+  bool done_ = false;  // Protected by mutex_.
+};
+
 class ModuleWrap : public BaseObject {
  public:
   enum InternalFields {
@@ -92,6 +127,11 @@ class ModuleWrap : public BaseObject {
   static void SetSyntheticExport(
       const v8::FunctionCallbackInfo<v8::Value>& args);
   static void CreateCachedData(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void StartCompile(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetCachedCJSExports(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SaveCachedCJSExports(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
 
   static v8::MaybeLocal<v8::Module> ResolveModuleCallback(
       v8::Local<v8::Context> context,
@@ -0,0 +1,163 @@
+#include "multi_string_search.h"
+#include "util.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>  // SSE2, which is part of the x86-64 baseline.
+#define NODE_MULTI_STRING_SEARCH_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_MULTI_STRING_SEARCH_NEON 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace node {
+namespace stringsearch {
+
+MultiStringSearch::MultiStringSearch(const std::vector<std::string>& patterns,
+                                     bool prefilter) {
+  // Give every byte that occurs in a pattern its own column. All others
+  // share column 0, which always leads back to the root.
+  for (const std::string& pattern : patterns) {
+    CHECK(!pattern.empty());
+    for (unsigned char c : pattern) {
+      if (byte_class_[c] == 0)
+        byte_class_[c] = 1;
+    }
+  }
+  for (size_t c = 0; c < 256; c++) {
+    if (byte_class_[c] != 0)
+      byte_class_[c] = static_cast<uint16_t>(class_count_++);
+  }
+
+  // Build the trie, with 0 standing for a missing edge for now. Nothing
+  // leads back to the root in a trie, so that is unambiguous.
+  std::vector<std::vector<uint32_t>> ends(1);
+  next_.assign(class_count_, 0);
+  pattern_lengths_.reserve(patterns.size());
+  for (size_t i = 0; i < patterns.size(); i++) {
+    uint32_t state = 0;
+    for (unsigned char c : patterns[i]) {
+      uint32_t* edge = &next_[state * class_count_ + byte_class_[c]];
+      if (*edge == 0) {
+        *edge = static_cast<uint32_t>(ends.size());
+        ends.emplace_back();
+        next_.resize(next_.size() + class_count_, 0);
+        // `next_` may have moved.
+        edge = &next_[state * class_count_ + byte_class_[c]];
+      }
+      state = *edge;
+    }
+    ends[state].push_back(static_cast<uint32_t>(i));
+    pattern_lengths_.push_back(patterns[i].size());
+  }
+
+  const size_t state_count = ends.size();
+  output_begin_.reserve(state_count + 1);
+  for (const std::vector<uint32_t>& state_ends : ends) {
+    output_begin_.push_back(static_cast<uint32_t>(outputs_.size()));
+    outputs_.insert(outputs_.end(), state_ends.begin(), state_ends.end());
+  }
+  output_begin_.push_back(static_cast<uint32_t>(outputs_.size()));
+
+  // Visit the states breadth-first, so that the suffix link of a state is
+  // complete before any state that is deeper in the trie needs it, and
+  // turn missing edges into the edges of the suffix link.
+  std::vector<uint32_t> fail(state_count, 0);
+  report_.assign(state_count, 0);
+  dictionary_link_.assign(state_count, 0);
+  std::vector<uint32_t> queue;
+  queue.reserve(state_count);
+  queue.push_back(0);
+  for (size_t head = 0; head < queue.size(); head++) {
+    const uint32_t state = queue[head];
+    const uint32_t* fallback = &next_[fail[state] * class_count_];
+    uint32_t* edges = &next_[state * class_count_];
+    for (size_t c = 0; c < class_count_; c++) {
+      if (edges[c] == 0) {
+        edges[c] = state == 0 ? 0 : fallback[c];
+        continue;
+      }
+      const uint32_t child = edges[c];
+      const uint32_t link = state == 0 ? 0 : fallback[c];
+      fail[child] = link;
+      dictionary_link_[child] = report_[link];
+      report_[child] = ends[child].empty() ? report_[link] : child;
+      queue.push_back(child);
+    }
+  }
+
+  if (!prefilter)
+    return;
+  bool seen[256] = {};
+  for (const std::string& pattern : patterns) {
+    const unsigned char c = pattern[0];
+    if (seen[c])
+      continue;
+    if (prefilter_count_ == kMaxPrefilterBytes) {
+      // Too many to compare against; the automaton is faster on its own.
+      prefilter_count_ = 0;
+      return;
+    }
+    seen[c] = true;
+    prefilter_bytes_[prefilter_count_++] = c;
+  }
+}
+
+size_t MultiStringSearch::memory_size() const {
+  return (next_.size() + report_.size() + dictionary_link_.size() +
+          output_begin_.size() + outputs_.size()) * sizeof(uint32_t) +
+         pattern_lengths_.size() * sizeof(size_t);
+}
+
+size_t MultiStringSearch::SkipToCandidate(const uint8_t* subject,
+                                          size_t index,
+                                          size_t length) const {
+  const size_t count = prefilter_count_;
+#if defined(NODE_MULTI_STRING_SEARCH_SSE2)
+  __m128i needles[kMaxPrefilterBytes];
+  for (size_t k = 0; k < count; k++)
+    needles[k] = _mm_set1_epi8(static_cast<char>(prefilter_bytes_[k]));
+  for (; index + 16 <= length; index += 16) {
+    const __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(subject + index));
+    __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+    for (size_t k = 1; k < count; k++)
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[k]));
+    const unsigned mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+#ifdef _MSC_VER
+      unsigned long bit;  // NOLINT(runtime/int)
+      _BitScanForward(&bit, mask);
+      return index + bit;
+#else
+      return index + __builtin_ctz(mask);
+#endif
+    }
+  }
+#elif defined(NODE_MULTI_STRING_SEARCH_NEON)
+  uint8x16_t needles[kMaxPrefilterBytes];
+  for (size_t k = 0; k < count; k++)
+    needles[k] = vdupq_n_u8(prefilter_bytes_[k]);
+  for (; index + 16 <= length; index += 16) {
+    const uint8x16_t block = vld1q_u8(subject + index);
+    uint8x16_t hits = vceqq_u8(block, needles[0]);
+    for (size_t k = 1; k < count; k++)
+      hits = vorrq_u8(hits, vceqq_u8(block, needles[k]));
+    if (vmaxvq_u8(hits) != 0)
+      break;  // The scalar loop below finds the exact position.
+  }
+#endif
+  for (; index < length; index++) {
+    const uint8_t c = subject[index];
+    for (size_t k = 0; k < count; k++) {
+      if (prefilter_bytes_[k] == c)
+        return index;
+    }
+  }
+  return length;
+}
+
+}  // namespace stringsearch
+}  // namespace node
@@ -0,0 +1,95 @@
+#ifndef SRC_MULTI_STRING_SEARCH_H_
+#define SRC_MULTI_STRING_SEARCH_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace node {
+namespace stringsearch {
+
+// Finds all occurrences of any of a set of byte patterns in a single pass
+// over the subject, using an Aho-Corasick automaton that is built once and
+// can then be used for any number of searches.
+//
+// The automaton is a dense transition table. To keep it small, bytes that
+// do not occur in any pattern share a single column.
+//
+// With `prefilter`, and if the patterns start with only a few different
+// bytes, the search skips ahead with vector instructions whenever it is
+// back at the root of the automaton, that is, whenever no partial match
+// is in progress.
+class MultiStringSearch {
+ public:
+  static constexpr size_t kMaxPrefilterBytes = 8;
+
+  MultiStringSearch(const std::vector<std::string>& patterns, bool prefilter);
+
+  // Calls `on_match(offset, pattern_index)` for every occurrence of every
+  // pattern in `subject`, including overlapping ones, in the order in which
+  // they end. Stops early once `on_match` returns false.
+  template <typename Callback>
+  inline void Search(const uint8_t* subject,
+                     size_t length,
+                     Callback&& on_match) const;
+
+  size_t pattern_count() const { return pattern_lengths_.size(); }
+  bool prefiltered() const { return prefilter_count_ > 0; }
+  size_t memory_size() const;
+
+ private:
+  // Returns the first position from `index` on at which a pattern could
+  // start, or `length`.
+  size_t SkipToCandidate(const uint8_t* subject,
+                         size_t index,
+                         size_t length) const;
+
+  uint16_t byte_class_[256] = {};
+  size_t class_count_ = 1;
+  // State transitions, `class_count_` for each state. State 0 is the root.
+  std::vector<uint32_t> next_;
+  // The first state on the suffix link chain from a state, the state
+  // itself included, at which patterns end, or 0.
+  std::vector<uint32_t> report_;
+  // The next state on the suffix link chain at which patterns end, or 0.
+  std::vector<uint32_t> dictionary_link_;
+  // The patterns that end at each state, as ranges of `outputs_`.
+  std::vector<uint32_t> output_begin_;
+  std::vector<uint32_t> outputs_;
+  std::vector<size_t> pattern_lengths_;
+
+  uint8_t prefilter_bytes_[kMaxPrefilterBytes];
+  size_t prefilter_count_ = 0;
+};
+
+template <typename Callback>
+void MultiStringSearch::Search(const uint8_t* subject,
+                               size_t length,
+                               Callback&& on_match) const {
+  uint32_t state = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (state == 0 && prefilter_count_ > 0) {
+      i = SkipToCandidate(subject, i, length);
+      if (i == length)
+        return;
+    }
+    state = next_[state * class_count_ + byte_class_[subject[i]]];
+    for (uint32_t s = report_[state]; s != 0; s = dictionary_link_[s]) {
+      for (uint32_t k = output_begin_[s]; k < output_begin_[s + 1]; k++) {
+        const uint32_t pattern = outputs_[k];
+        if (!on_match(i + 1 - pattern_lengths_[pattern], pattern))
+          return;
+      }
+    }
+  }
+}
+
+}  // namespace stringsearch
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_MULTI_STRING_SEARCH_H_
@@ -28,6 +28,7 @@
 #include "memory_tracker-inl.h"
 #include "histogram-inl.h"
 #include "node_binding.h"
+#include "node_continuous_profiler.h"
 #include "node_errors.h"
 #include "node_internals.h"
 #include "node_main_instance.h"
@@ -37,9 +38,15 @@
 #include "node_perf.h"
 #include "node_process-inl.h"
 #include "node_report.h"
+#include "node_resolve_cache.h"
 #include "node_revert.h"
+#include "node_snapshotable.h"
+#include "node_stall_detector.h"
+#include "node_thread_affinity.h"
+#include "node_usdt.h"
 #include "node_v8_platform-inl.h"
 #include "node_version.h"
+#include "spawn_server.h"
 
 #if HAVE_OPENSSL
 #include "allocated_buffer-inl.h"  // Inlined functions needed by node_crypto.h
@@ -68,6 +75,7 @@
 #include "inspector/worker_inspector.h"  // ParentInspectorHandle
 #endif
 
+#include "large_pages/node_huge_pages.h"
 #include "large_pages/node_large_page.h"
 
 #if defined(__APPLE__) || defined(__linux__) || defined(_WIN32)
@@ -120,6 +128,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -289,6 +298,11 @@ void Environment::InitializeDiagnostics() {
       env->isolate()->SetAtomicsWaitCallback(nullptr, nullptr);
     }, this);
   }
+  if (options_->cpu_prof_continuous)
+    profiler::ContinuousCpuProfiler::Start(this);
+  if (options_->event_loop_stall_threshold > 0)
+    StallDetector::Start(this);
+  InitUSDT(this);
 
 #if defined HAVE_DTRACE || defined HAVE_ETW
   InitDTrace(this);
@@ -923,6 +937,10 @@ int InitializeNodeWithArgs(std::vector<std::string>* argv,
     if (exit_code != 0) return exit_code;
   }
 
+  // Before the first Environment takes the store.
+  if (per_process::cli_options->env_var_snapshot)
+    per_process::system_environment = KVStore::CreateSnapshotKVStore();
+
   // Set the process.title immediately after processing argv if --title is set.
   if (!per_process::cli_options->title.empty())
     uv_set_process_title(per_process::cli_options->title.c_str());
@@ -1032,6 +1050,13 @@ InitializationResult InitializeOncePerProcess(
     }
   }
 
+  const size_t huge_pages_threshold =
+      static_cast<size_t>(per_process::cli_options->huge_pages_threshold);
+  if (!huge_pages::Initialize(per_process::cli_options->huge_pages,
+                              huge_pages_threshold)) {
+    fprintf(stderr, "Huge pages are not supported on this system\n");
+  }
+
   if (per_process::cli_options->print_version) {
     printf("%s\n", NODE_VERSION);
     result.exit_code = 0;
@@ -1112,14 +1137,36 @@ InitializationResult InitializeOncePerProcess(
       ERR_print_errors_fp(stderr);
       return result;
   }
+  per_process::metadata.versions.InitializeOpenSSLVersions();
 
   // V8 on Windows doesn't have a good source of entropy. Seed it from
   // OpenSSL's pool.
   V8::SetEntropySource(crypto::EntropySource);
 #endif  // HAVE_OPENSSL && !defined(OPENSSL_IS_BORINGSSL)
 }
-  per_process::v8_platform.Initialize(
-      static_cast<int>(per_process::cli_options->v8_thread_pool_size));
+  // Has to happen before any thread is started, and before V8 makes the
+  // process large.
+  if (per_process::cli_options->spawn_server && !spawn_server::Start())
+    fprintf(stderr, "The spawn server is not supported on this system\n");
+
+  {
+    // Has to happen before the platform and the threadpool start threads.
+    thread_affinity::Policy policy;
+    if (thread_affinity::ParsePolicy(per_process::cli_options->thread_affinity,
+                                     &policy)) {
+      thread_affinity::Initialize(policy);
+    }
+  }
+
+  // The platform threads also run V8's parallel GC, which is slower than
+  // running it on fewer threads when the process gets fewer CPUs than the
+  // host has, as in containers with a CPU quota.
+  int64_t v8_thread_pool_size = per_process::cli_options->v8_thread_pool_size;
+  if (v8_thread_pool_size < 0) {
+    v8_thread_pool_size =
+        std::min<int64_t>(4, uv_available_parallelism());
+  }
+  per_process::v8_platform.Initialize(static_cast<int>(v8_thread_pool_size));
   if (init_flags & kInitializeV8) {
     V8::Initialize();
   }
@@ -1131,6 +1178,7 @@ InitializationResult InitializeOncePerProcess(
 }
 
 void TearDownOncePerProcess() {
+  ResolveCache::Persist();
   per_process::v8_initialized = false;
   V8::Dispose();
 
@@ -1147,19 +1195,63 @@ void TearDownOncePerProcess() {
   per_process::v8_platform.Dispose();
 }
 
+// Runs the entry script of --build-snapshot and writes the snapshot blob.
+static int BuildSnapshot(const InitializationResult& result) {
+  if (result.args.size() < 2) {
+    FPrintF(stderr,
+            "%s: --build-snapshot must be used with an entry point script\n",
+            result.args[0]);
+    return 9;
+  }
+  std::string path = per_process::cli_options->snapshot_blob;
+  if (path.empty())
+    path = "snapshot.blob";
+
+  SnapshotData data;
+  SnapshotBuilder::Generate(
+      &data, result.args, result.exec_args, result.args[1]);
+  const bool written = WriteSnapshotBlob(data, path);
+  delete[] data.blob.data;
+  if (!written) {
+    FPrintF(stderr, "Cannot write the snapshot blob to %s\n", path);
+    return 1;
+  }
+  return 0;
+}
+
 int Start(int argc, char** argv) {
   InitializationResult result = InitializeOncePerProcess(argc, argv);
   if (result.early_return) {
     return result.exit_code;
   }
 
+  if (per_process::cli_options->build_snapshot) {
+    result.exit_code = BuildSnapshot(result);
+    TearDownOncePerProcess();
+    return result.exit_code;
+  }
+
   {
     Isolate::CreateParams params;
     const std::vector<size_t>* indices = nullptr;
     const EnvSerializeInfo* env_info = nullptr;
     bool use_node_snapshot =
         per_process::cli_options->per_isolate->node_snapshot;
-    if (use_node_snapshot) {
+    // A user-land snapshot replaces the built-in one.
+    SnapshotData user_snapshot;
+    auto free_user_snapshot =
+        OnScopeLeave([&]() { delete[] user_snapshot.blob.data; });
+    const std::string& blob_path = per_process::cli_options->snapshot_blob;
+    if (!blob_path.empty()) {
+      if (!ReadSnapshotBlob(&user_snapshot, blob_path)) {
+        FPrintF(stderr, "Cannot read the snapshot blob %s\n", blob_path);
+        TearDownOncePerProcess();
+        return 1;
+      }
+      params.snapshot_blob = &user_snapshot.blob;
+      indices = &user_snapshot.isolate_data_indices;
+      env_info = &user_snapshot.env_info;
+    } else if (use_node_snapshot) {
       v8::StartupData* blob = NodeMainInstance::GetEmbeddedSnapshotBlob();
       if (blob != nullptr) {
         params.snapshot_blob = blob;
@@ -1168,6 +1260,13 @@ int Start(int argc, char** argv) {
       }
     }
     uv_loop_configure(uv_default_loop(), UV_METRICS_IDLE_TIME);
+    if (per_process::cli_options->loop_busy_poll > 0) {
+      uv_loop_configure(uv_default_loop(), UV_LOOP_BUSY_POLL,
+                        static_cast<unsigned int>(
+                            per_process::cli_options->loop_busy_poll));
+    }
+    if (per_process::cli_options->loop_epoll_exclusive)
+      uv_loop_configure(uv_default_loop(), UV_LOOP_EPOLL_EXCLUSIVE);
 
     NodeMainInstance main_instance(&params,
                                    uv_default_loop(),
@@ -495,7 +495,8 @@ NODE_EXTERN void FreeEnvironment(Environment* env);
 // This could e.g. call Stop(env); in order to terminate execution and stop
 // the event loop.
 // The default handler disposes of the global V8 platform instance, if one is
-// being used, and calls exit().
+// being used, and calls exit(). With --fast-exit, it only runs the critical
+// exit hooks of the main thread and flushes outputs before it exits.
 NODE_EXTERN void SetProcessExitHandler(
     Environment* env,
     std::function<void(Environment*, int)>&& handler);
@@ -957,6 +958,15 @@ NODE_EXTERN void RemoveEnvironmentCleanupHook(v8::Isolate* isolate,
                                               void (*fun)(void* arg),
                                               void* arg);
 
+/* Like AddEnvironmentCleanupHook(), but the hook also runs when the process
+ * is started with --fast-exit, which skips the rest of the teardown of the
+ * Environment. Use this for hooks that must not be skipped, such as flushing
+ * buffered output to a file, and keep them short. The hook is removed with
+ * RemoveEnvironmentCleanupHook(). */
+NODE_EXTERN void AddCriticalEnvironmentCleanupHook(v8::Isolate* isolate,
+                                                   void (*fun)(void* arg),
+                                                   void* arg);
+
 /* These are async equivalents of the above. After the cleanup hook is invoked,
  * `cb(cbarg)` *must* be called, and attempting to remove the cleanup hook will
  * have no effect. */
@@ -8,6 +8,7 @@
 #include "node_binding.h"
 #include "node_buffer.h"
 #include "node_errors.h"
+#include "node_executor_pool.h"
 #include "node_internals.h"
 #include "threadpoolwork-inl.h"
 #include "tracing/traced_value.h"
@@ -15,11 +16,28 @@
 
 #include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 
 node_napi_env__::node_napi_env__(v8::Local<v8::Context> context,
                                  const std::string& module_filename)
     : napi_env__(context), filename(module_filename) {
   CHECK_NOT_NULL(node_env());
+  finalizer_prepare = new uv_prepare_t;
+  CHECK_EQ(uv_prepare_init(node_env()->event_loop(), finalizer_prepare), 0);
+  finalizer_prepare->data = this;
+}
+
+void node_napi_env__::Close() {
+  uv_prepare_t* prepare = finalizer_prepare;
+  finalizer_prepare = nullptr;
+  bool waiting = uv_is_active(reinterpret_cast<uv_handle_t*>(prepare));
+  node_env()->CloseHandle(prepare, [](uv_prepare_t* handle) {
+    delete handle;
+  });
+  // Without the wait, as the Environment is going away.
+  if (waiting) ScheduleFinalizers();
+  Unref();
 }
 
 bool node_napi_env__::can_call_into_js() const {
@@ -34,19 +52,63 @@ v8::Maybe<bool> node_napi_env__::mark_arraybuffer_as_untransferable(
 }
 
 void node_napi_env__::CallFinalizer(napi_finalize cb, void* data, void* hint) {
-  // we need to keep the env live until the finalizer has been run
+  // Finalizers queue up here rather than getting an immediate each, which
+  // is what GC collecting millions of wrapped objects at once would take.
+  pending_finalizers.push_back({cb, data, hint});
+  if (!finalizers_scheduled) ScheduleFinalizers();
+}
+
+void node_napi_env__::ScheduleFinalizers() {
+  // we need to keep the env live until the finalizers have been run
   // EnvRefHolder provides an exception safe wrapper to Ref and then
   // Unref once the lamba is freed
   EnvRefHolder liveEnv(static_cast<napi_env>(this));
+  finalizers_scheduled = true;
   node_env()->SetImmediate(
-      [=, liveEnv = std::move(liveEnv)](node::Environment* node_env) {
-        napi_env env = liveEnv.env();
-        v8::HandleScope handle_scope(env->isolate);
-        v8::Context::Scope context_scope(env->context());
-        env->CallIntoModule([&](napi_env env) { cb(env, data, hint); });
+      [liveEnv = std::move(liveEnv)](node::Environment* node_env) {
+        static_cast<node_napi_env>(liveEnv.env())->DrainFinalizers();
       });
 }
 
+void node_napi_env__::DrainFinalizers() {
+  v8::Context::Scope context_scope(context());
+  const uint64_t deadline = uv_hrtime() + kFinalizerBudgetNs;
+  size_t count = 0;
+  bool threw = false;
+  bool out_of_time = false;
+  while (!pending_finalizers.empty() && !threw) {
+    PendingFinalizer finalizer = pending_finalizers.front();
+    pending_finalizers.pop_front();
+    v8::HandleScope handle_scope(isolate);
+    CallIntoModule(
+        [&](napi_env env) {
+          finalizer.cb(env, finalizer.data, finalizer.hint);
+        },
+        [&](napi_env env, v8::Local<v8::Value> value) {
+          // The immediate reports it; the rest run in the next one.
+          HandleThrow(env, value);
+          threw = true;
+        });
+    // Reading the clock is not free either.
+    if (++count % 16 == 0 && uv_hrtime() > deadline) {
+      out_of_time = true;
+      break;
+    }
+  }
+  finalizers_scheduled = false;
+  if (pending_finalizers.empty()) return;
+
+  if (out_of_time && finalizer_prepare != nullptr) {
+    finalizers_scheduled = true;
+    uv_prepare_start(finalizer_prepare, [](uv_prepare_t* handle) {
+      uv_prepare_stop(handle);
+      static_cast<node_napi_env>(handle->data)->ScheduleFinalizers();
+    });
+  } else {
+    ScheduleFinalizers();
+  }
+}
+
 namespace v8impl {
 
 namespace {
@@ -98,7 +160,7 @@ NewEnv(v8::Local<v8::Context> context, const std::string& module_filename) {
   // For now, a per-Environment cleanup hook is the best we can do.
   result->node_env()->AddCleanupHook(
       [](void* arg) {
-        static_cast<napi_env>(arg)->Unref();
+        static_cast<node_napi_env>(arg)->Close();
       },
       static_cast<void*>(result));
 
@@ -112,6 +174,71 @@ static inline void trigger_fatal_exception(
   node::errors::TriggerUncaughtException(env->isolate, local_err, local_msg);
 }
 
+// A bounded multi-producer, single-consumer ring of data pointers, used by
+// batched thread-safe functions. Each cell carries a sequence number that
+// tells producers whether it is free and the consumer whether it has been
+// published, so neither side needs a lock.
+class ThreadSafeFunctionRing {
+ public:
+  explicit ThreadSafeFunctionRing(size_t capacity)
+      : capacity_(capacity), cells_(new Cell[capacity]) {
+    for (size_t i = 0; i < capacity_; i++)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // May be called from any thread. Returns false if the ring is full.
+  bool TryPush(void* data) {
+    Cell* cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos % capacity_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = data;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Must only be called from the consuming thread.
+  bool TryPop(void** data) {
+    Cell* cell = &cells_[dequeue_pos_ % capacity_];
+    if (cell->sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1)
+      return false;
+    *data = cell->data;
+    cell->sequence.store(dequeue_pos_ + capacity_, std::memory_order_release);
+    dequeue_pos_++;
+    return true;
+  }
+
+  // Must only be called from the consuming thread.
+  bool empty() const {
+    const Cell& cell = cells_[dequeue_pos_ % capacity_];
+    return cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    void* data;
+  };
+
+  const size_t capacity_;
+  std::unique_ptr<Cell[]> cells_;
+  std::atomic<size_t> enqueue_pos_ {0};
+  size_t dequeue_pos_ = 0;
+};
+
 class ThreadSafeFunction : public node::AsyncResource {
  public:
   ThreadSafeFunction(v8::Local<v8::Function> func,
@@ -123,7 +250,9 @@ class ThreadSafeFunction : public node::AsyncResource {
                      node_napi_env env_,
                      void* finalize_data_,
                      napi_finalize finalize_cb_,
-                     napi_threadsafe_function_call_js call_js_cb_):
+                     napi_threadsafe_function_call_js call_js_cb_,
+                     node_api_threadsafe_function_call_js_batch
+                         call_js_batch_cb_ = nullptr):
                      AsyncResource(env_->isolate,
                                    resource,
                                    *v8::String::Utf8Value(env_->isolate, name)),
@@ -136,7 +265,13 @@ class ThreadSafeFunction : public node::AsyncResource {
       finalize_data(finalize_data_),
       finalize_cb(finalize_cb_),
       call_js_cb(call_js_cb_ == nullptr ? CallJs : call_js_cb_),
+      call_js_batch_cb(call_js_batch_cb_),
       handles_closing(false) {
+    if (call_js_batch_cb != nullptr) {
+      CHECK_GT(max_queue_size, 0);
+      ring = std::make_unique<ThreadSafeFunctionRing>(max_queue_size);
+      batch.reserve(max_queue_size);
+    }
     ref.Reset(env->isolate, func);
     node::AddEnvironmentCleanupHook(env->isolate, Cleanup, this);
     env->Ref();
@@ -150,6 +285,10 @@ class ThreadSafeFunction : public node::AsyncResource {
   // These methods can be called from any thread.
 
   napi_status Push(void* data, napi_threadsafe_function_call_mode mode) {
+    if (ring) {
+      return PushBatched(data, mode);
+    }
+
     node::Mutex::ScopedLock lock(this->mutex);
 
     while (queue.size() >= max_queue_size &&
@@ -175,6 +314,47 @@ class ThreadSafeFunction : public node::AsyncResource {
     }
   }
 
+  napi_status PushBatched(void* data, napi_threadsafe_function_call_mode mode) {
+    // Fast path: no lock. pushers_in_flight keeps the object alive until
+    // Send() returns; EmptyQueueAndDelete() waits for it to drop to zero.
+    pushers_in_flight++;
+    if (!is_closing && ring->TryPush(data)) {
+      Send();
+      pushers_in_flight--;
+      return napi_ok;
+    }
+    pushers_in_flight--;
+
+    // The ring is full or the function is closing.
+    node::Mutex::ScopedLock lock(this->mutex);
+    bool pushed = false;
+    blocked_producers++;
+    while (!is_closing) {
+      pushed = ring->TryPush(data);
+      if (pushed || mode == napi_tsfn_nonblocking) {
+        break;
+      }
+      cond->Wait(lock);
+    }
+    blocked_producers--;
+
+    if (pushed) {
+      Send();
+      return napi_ok;
+    } else if (!is_closing) {
+      return napi_queue_full;
+    }
+
+    // Pass the close notification on to other blocked producers.
+    cond->Signal(lock);
+    if (thread_count == 0) {
+      return napi_invalid_arg;
+    } else {
+      thread_count--;
+      return napi_closing;
+    }
+  }
+
   napi_status Acquire() {
     node::Mutex::ScopedLock lock(this->mutex);
 
@@ -213,6 +393,19 @@ class ThreadSafeFunction : public node::AsyncResource {
     for (; !queue.empty() ; queue.pop()) {
       call_js_cb(nullptr, nullptr, context, queue.front());
     }
+    if (ring) {
+      // is_closing is set, so no new lock-free pushes start; wait for the
+      // ones that are already running to leave.
+      while (pushers_in_flight != 0)
+        std::this_thread::yield();
+      batch.clear();
+      void* data;
+      while (ring->TryPop(&data))
+        batch.push_back(data);
+      if (!batch.empty()) {
+        call_js_batch_cb(nullptr, nullptr, context, batch.data(), batch.size());
+      }
+    }
     delete this;
   }
 
@@ -274,7 +467,7 @@ class ThreadSafeFunction : public node::AsyncResource {
     unsigned int iterations_left = kMaxIterationCount;
     while (has_more && --iterations_left != 0) {
       dispatch_state = kDispatchRunning;
-      has_more = DispatchOne();
+      has_more = ring ? DispatchBatch() : DispatchOne();
 
       // Send() was called while we were executing the JS function
       if (dispatch_state.exchange(kDispatchIdle) != kDispatchRunning) {
@@ -339,6 +532,51 @@ class ThreadSafeFunction : public node::AsyncResource {
     return has_more;
   }
 
+  bool DispatchBatch() {
+    if (is_closing) {
+      node::Mutex::ScopedLock lock(this->mutex);
+      CloseHandlesAndMaybeDelete();
+      return false;
+    }
+
+    void* data;
+    while (batch.size() < max_queue_size && ring->TryPop(&data))
+      batch.push_back(data);
+
+    bool has_more = !ring->empty();
+    // Pairs with the blocked_producers increment in PushBatched(): either the
+    // producer sees the slots freed above, or we see it waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_more || blocked_producers > 0) {
+      node::Mutex::ScopedLock lock(this->mutex);
+      if (!batch.empty() && blocked_producers > 0) {
+        cond->Broadcast(lock);
+      }
+      if (!has_more && thread_count == 0) {
+        is_closing = true;
+        cond->Broadcast(lock);
+        CloseHandlesAndMaybeDelete();
+      }
+    }
+
+    if (!batch.empty()) {
+      v8::HandleScope scope(env->isolate);
+      CallbackScope cb_scope(this);
+      napi_value js_callback = nullptr;
+      if (!ref.IsEmpty()) {
+        v8::Local<v8::Function> js_cb =
+          v8::Local<v8::Function>::New(env->isolate, ref);
+        js_callback = v8impl::JsValueFromV8LocalValue(js_cb);
+      }
+      env->CallIntoModule([&](napi_env env) {
+        call_js_batch_cb(env, js_callback, context, batch.data(), batch.size());
+      });
+      batch.clear();
+    }
+
+    return has_more;
+  }
+
   void Finalize() {
     v8::HandleScope scope(env->isolate);
     if (finalize_cb) {
@@ -430,9 +668,16 @@ class ThreadSafeFunction : public node::AsyncResource {
   std::queue<void*> queue;
   uv_async_t async;
   size_t thread_count;
-  bool is_closing;
+  // Only modified while holding the mutex, but read without it by the
+  // lock-free paths of batched functions.
+  std::atomic_bool is_closing;
   std::atomic_uchar dispatch_state;
 
+  // These are only used by batched functions.
+  std::unique_ptr<ThreadSafeFunctionRing> ring;
+  std::atomic<size_t> pushers_in_flight {0};
+  std::atomic<size_t> blocked_producers {0};
+
   // These are variables set once, upon creation, and then never again, which
   // means we don't need the mutex to read them.
   void* context;
@@ -444,6 +689,8 @@ class ThreadSafeFunction : public node::AsyncResource {
   void* finalize_data;
   napi_finalize finalize_cb;
   napi_threadsafe_function_call_js call_js_cb;
+  node_api_threadsafe_function_call_js_batch call_js_batch_cb;
+  std::vector<void*> batch;
   bool handles_closing;
 };
 
@@ -650,6 +897,17 @@ napi_status napi_add_env_cleanup_hook(napi_env env,
   return napi_ok;
 }
 
+napi_status node_api_add_critical_env_cleanup_hook(napi_env env,
+                                                   void (*fun)(void* arg),
+                                                   void* arg) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, fun);
+
+  node::AddCriticalEnvironmentCleanupHook(env->isolate, fun, arg);
+
+  return napi_ok;
+}
+
 napi_status napi_remove_env_cleanup_hook(napi_env env,
                                          void (*fun)(void* arg),
                                          void* arg) {
@@ -1074,6 +1332,19 @@ class Work : public node::AsyncResource, public node::ThreadPoolWork {
     _execute(_env, _data);
   }
 
+  // Runs the work on `executor` instead of the libuv threadpool.
+  void ScheduleOnExecutor(node::ExecutorPool* executor) {
+    _env->node_env()->IncreaseWaitingRequestCounter();
+    _executor = executor;
+    executor->Schedule(_env->node_env()->event_loop(), &_executor_task);
+  }
+
+  int Cancel() {
+    if (_executor != nullptr)
+      return _executor->Cancel(&_executor_task);
+    return CancelWork();
+  }
+
   void AfterThreadPoolWork(int status) override {
     if (_complete == nullptr)
       return;
@@ -1098,10 +1369,30 @@ class Work : public node::AsyncResource, public node::ThreadPoolWork {
   }
 
  private:
+  class ExecutorTask final : public node::ExecutorPool::Task {
+   public:
+    explicit ExecutorTask(Work* work) : _work(work) {}
+
+    void Run() override { _work->DoThreadPoolWork(); }
+
+    void Done(int status) override {
+      Work* work = _work;
+      work->_executor = nullptr;
+      work->_env->node_env()->DecreaseWaitingRequestCounter();
+      work->AfterThreadPoolWork(status);
+    }
+
+   private:
+    Work* _work;
+  };
+
   node_napi_env _env;
   void* _data;
   napi_async_execute_callback _execute;
   napi_async_complete_callback _complete;
+  // Set while the work is scheduled on an executor.
+  node::ExecutorPool* _executor = nullptr;
+  ExecutorTask _executor_task{this};
 };
 
 }  // end of namespace uvimpl
@@ -1187,23 +1478,113 @@ napi_status napi_cancel_async_work(napi_env env, napi_async_work work) {
 
   uvimpl::Work* w = reinterpret_cast<uvimpl::Work*>(work);
 
-  CALL_UV(env, w->CancelWork());
+  CALL_UV(env, w->Cancel());
 
   return napi_clear_last_error(env);
 }
 
-napi_status
-napi_create_threadsafe_function(napi_env env,
-                                napi_value func,
-                                napi_value async_resource,
-                                napi_value async_resource_name,
-                                size_t max_queue_size,
-                                size_t initial_thread_count,
-                                void* thread_finalize_data,
-                                napi_finalize thread_finalize_cb,
-                                void* context,
-                                napi_threadsafe_function_call_js call_js_cb,
-                                napi_threadsafe_function* result) {
+struct node_api_executor__ {
+  std::shared_ptr<node::ExecutorPool> pool;
+};
+
+napi_status node_api_create_executor(napi_env env,
+                                     const char* name,
+                                     size_t name_length,
+                                     size_t thread_count,
+                                     node_api_executor_priority priority,
+                                     node_api_executor* result) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, name);
+  CHECK_ARG(env, result);
+  RETURN_STATUS_IF_FALSE(env,
+      thread_count > 0 && thread_count <= node::ExecutorPool::kMaxThreads,
+      napi_invalid_arg);
+
+  node::ExecutorPool::Priority pool_priority;
+  switch (priority) {
+    case node_api_executor_priority_normal:
+      pool_priority = node::ExecutorPool::Priority::kNormal;
+      break;
+    case node_api_executor_priority_low:
+      pool_priority = node::ExecutorPool::Priority::kLow;
+      break;
+    case node_api_executor_priority_background:
+      pool_priority = node::ExecutorPool::Priority::kBackground;
+      break;
+    case node_api_executor_priority_high:
+      pool_priority = node::ExecutorPool::Priority::kHigh;
+      break;
+    default:
+      return napi_set_last_error(env, napi_invalid_arg);
+  }
+
+  if (name_length == NAPI_AUTO_LENGTH)
+    name_length = strlen(name);
+  std::shared_ptr<node::ExecutorPool> pool =
+      node::ExecutorPool::GetOrCreate(std::string(name, name_length),
+                                      thread_count,
+                                      pool_priority);
+  if (!pool)
+    return napi_set_last_error(env, napi_generic_failure);
+
+  *result = new node_api_executor__ { std::move(pool) };
+  return napi_clear_last_error(env);
+}
+
+napi_status node_api_release_executor(napi_env env,
+                                      node_api_executor executor) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, executor);
+  delete executor;
+  return napi_clear_last_error(env);
+}
+
+napi_status node_api_queue_async_work_on_executor(napi_env env,
+                                                  napi_async_work work,
+                                                  node_api_executor executor) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, work);
+  CHECK_ARG(env, executor);
+
+  reinterpret_cast<uvimpl::Work*>(work)->ScheduleOnExecutor(
+      executor->pool.get());
+
+  return napi_clear_last_error(env);
+}
+
+napi_status node_api_get_executor_metrics(napi_env env,
+                                          node_api_executor executor,
+                                          node_api_executor_metrics* result) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, executor);
+  CHECK_ARG(env, result);
+
+  const node::ExecutorPool::Metrics metrics = executor->pool->GetMetrics();
+  result->thread_count = metrics.threads;
+  result->queued = metrics.queued;
+  result->running = metrics.running;
+  result->completed = metrics.completed;
+  result->cancelled = metrics.cancelled;
+  result->total_queue_wait_ns = metrics.total_queue_wait;
+  result->max_queue_wait_ns = metrics.max_queue_wait;
+
+  return napi_clear_last_error(env);
+}
+
+static napi_status
+CreateThreadSafeFunction(
+    napi_env env,
+    napi_value func,
+    napi_value async_resource,
+    napi_value async_resource_name,
+    size_t max_queue_size,
+    size_t initial_thread_count,
+    void* thread_finalize_data,
+    napi_finalize thread_finalize_cb,
+    void* context,
+    napi_threadsafe_function_call_js call_js_cb,
+    node_api_threadsafe_function_call_js_batch call_js_batch_cb,
+    napi_threadsafe_function* result) {
   CHECK_ENV(env);
   CHECK_ARG(env, async_resource_name);
   RETURN_STATUS_IF_FALSE(env, initial_thread_count > 0, napi_invalid_arg);
@@ -1213,7 +1594,9 @@ napi_create_threadsafe_function(napi_env env,
 
   v8::Local<v8::Function> v8_func;
   if (func == nullptr) {
-    CHECK_ARG(env, call_js_cb);
+    RETURN_STATUS_IF_FALSE(env,
+                           call_js_cb != nullptr || call_js_batch_cb != nullptr,
+                           napi_invalid_arg);
   } else {
     CHECK_TO_FUNCTION(env, v8_func, func);
   }
@@ -1240,7 +1623,8 @@ napi_create_threadsafe_function(napi_env env,
                                      reinterpret_cast<node_napi_env>(env),
                                      thread_finalize_data,
                                      thread_finalize_cb,
-                                     call_js_cb);
+                                     call_js_cb,
+                                     call_js_batch_cb);
 
   if (ts_fn == nullptr) {
     status = napi_generic_failure;
@@ -1255,6 +1639,62 @@ napi_create_threadsafe_function(napi_env env,
   return napi_set_last_error(env, status);
 }
 
+napi_status
+napi_create_threadsafe_function(napi_env env,
+                                napi_value func,
+                                napi_value async_resource,
+                                napi_value async_resource_name,
+                                size_t max_queue_size,
+                                size_t initial_thread_count,
+                                void* thread_finalize_data,
+                                napi_finalize thread_finalize_cb,
+                                void* context,
+                                napi_threadsafe_function_call_js call_js_cb,
+                                napi_threadsafe_function* result) {
+  return CreateThreadSafeFunction(env,
+                                  func,
+                                  async_resource,
+                                  async_resource_name,
+                                  max_queue_size,
+                                  initial_thread_count,
+                                  thread_finalize_data,
+                                  thread_finalize_cb,
+                                  context,
+                                  call_js_cb,
+                                  nullptr,
+                                  result);
+}
+
+napi_status
+node_api_create_threadsafe_function_batched(
+    napi_env env,
+    napi_value func,
+    napi_value async_resource,
+    napi_value async_resource_name,
+    size_t max_queue_size,
+    size_t initial_thread_count,
+    void* thread_finalize_data,
+    napi_finalize thread_finalize_cb,
+    void* context,
+    node_api_threadsafe_function_call_js_batch call_js_batch_cb,
+    napi_threadsafe_function* result) {
+  CHECK_ENV(env);
+  CHECK_ARG(env, call_js_batch_cb);
+  RETURN_STATUS_IF_FALSE(env, max_queue_size > 0, napi_invalid_arg);
+  return CreateThreadSafeFunction(env,
+                                  func,
+                                  async_resource,
+                                  async_resource_name,
+                                  max_queue_size,
+                                  initial_thread_count,
+                                  thread_finalize_data,
+                                  thread_finalize_cb,
+                                  context,
+                                  nullptr,
+                                  call_js_batch_cb,
+                                  result);
+}
+
 napi_status
 napi_get_threadsafe_function_context(napi_threadsafe_function func,
                                      void** result) {
@@ -268,6 +268,59 @@ NAPI_EXTERN napi_status napi_remove_async_cleanup_hook(
 NAPI_EXTERN napi_status
 node_api_get_module_file_name(napi_env env, const char** result);
 
+// Like napi_create_threadsafe_function(), but items are kept in a lock-free
+// ring of max_queue_size entries, and call_js_batch_cb receives all items
+// pending at the time of a dispatch at once. max_queue_size must be non-zero.
+NAPI_EXTERN napi_status
+node_api_create_threadsafe_function_batched(
+    napi_env env,
+    napi_value func,
+    napi_value async_resource,
+    napi_value async_resource_name,
+    size_t max_queue_size,
+    size_t initial_thread_count,
+    void* thread_finalize_data,
+    napi_finalize thread_finalize_cb,
+    void* context,
+    node_api_threadsafe_function_call_js_batch call_js_batch_cb,
+    napi_threadsafe_function* result);
+
+// Executors are pools of threads of their own, for async work that should
+// not hold up fs, dns and other users of the libuv threadpool. An executor
+// is shared by name within the process, and the thread count and priority
+// of the first creation win. The priority only has an effect on Linux.
+// Work is queued on an executor with node_api_queue_async_work_on_executor()
+// instead of napi_queue_async_work(), and can be cancelled in the same way.
+NAPI_EXTERN napi_status
+node_api_create_executor(napi_env env,
+                         const char* name,
+                         size_t name_length,
+                         size_t thread_count,
+                         node_api_executor_priority priority,
+                         node_api_executor* result);
+
+// Queued work keeps the executor running after it was released.
+NAPI_EXTERN napi_status
+node_api_release_executor(napi_env env, node_api_executor executor);
+
+NAPI_EXTERN napi_status
+node_api_queue_async_work_on_executor(napi_env env,
+                                      napi_async_work work,
+                                      node_api_executor executor);
+
+NAPI_EXTERN napi_status
+node_api_get_executor_metrics(napi_env env,
+                              node_api_executor executor,
+                              node_api_executor_metrics* result);
+
+// Like napi_add_env_cleanup_hook(), but the hook also runs when the process
+// is started with --fast-exit, which skips the rest of the cleanup. It is
+// removed with napi_remove_env_cleanup_hook().
+NAPI_EXTERN napi_status
+node_api_add_critical_env_cleanup_hook(napi_env env,
+                                       void (*fun)(void* arg),
+                                       void* arg);
+
 #endif  // NAPI_EXPERIMENTAL
 
 EXTERN_C_END
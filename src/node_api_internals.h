@@ -8,6 +8,8 @@
 #include "node_api.h"
 #include "util-inl.h"
 
+#include <deque>
+
 struct node_napi_env__ : public napi_env__ {
   node_napi_env__(v8::Local<v8::Context> context,
                   const std::string& module_filename);
@@ -23,6 +25,32 @@ struct node_napi_env__ : public napi_env__ {
   inline const char* GetFilename() const { return filename.c_str(); }
 
   std::string filename;
+
+  // Called from the Environment's cleanup hook, before the napi_env is
+  // released.
+  void Close();
+
+ private:
+  struct PendingFinalizer {
+    napi_finalize cb;
+    void* data;
+    void* hint;
+  };
+
+  // How long finalizers run for in one go. When GC collects many wrapped
+  // objects at once, running all of their finalizers would stall the loop,
+  // so the rest wait until it has polled for I/O again.
+  static constexpr uint64_t kFinalizerBudgetNs = 1000000;
+
+  void ScheduleFinalizers();
+  void DrainFinalizers();
+
+  std::deque<PendingFinalizer> pending_finalizers;
+  bool finalizers_scheduled = false;
+  // Immediates that are added while immediates run also run right away, so
+  // the next batch is scheduled from the prepare phase instead, which
+  // comes before the poll phase.
+  uv_prepare_t* finalizer_prepare;
 };
 
 using node_napi_env = node_napi_env__*;
@@ -47,4 +47,32 @@ typedef void (*napi_async_cleanup_hook)(napi_async_cleanup_hook_handle handle,
                                         void* data);
 #endif  // NAPI_VERSION >= 8
 
+#ifdef NAPI_EXPERIMENTAL
+typedef void (*node_api_threadsafe_function_call_js_batch)(
+    napi_env env,
+    napi_value js_callback,
+    void* context,
+    void** data,
+    size_t count);
+
+typedef struct node_api_executor__* node_api_executor;
+
+typedef enum {
+  node_api_executor_priority_normal,
+  node_api_executor_priority_low,
+  node_api_executor_priority_background,
+  node_api_executor_priority_high
+} node_api_executor_priority;
+
+typedef struct {
+  size_t thread_count;
+  size_t queued;
+  size_t running;
+  uint64_t completed;
+  uint64_t cancelled;
+  uint64_t total_queue_wait_ns;
+  uint64_t max_queue_wait_ns;
+} node_api_executor_metrics;
+#endif  // NAPI_EXPERIMENTAL
+
 #endif  // SRC_NODE_API_TYPES_H_
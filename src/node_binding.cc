@@ -57,6 +57,7 @@
   V(inspector)                                                                 \
   V(js_stream)                                                                 \
   V(js_udp_wrap)                                                               \
+  V(log_sink)                                                                  \
   V(messaging)                                                                 \
   V(module_wrap)                                                               \
   V(native_module)                                                             \
@@ -69,7 +70,10 @@
   V(report)                                                                    \
   V(serdes)                                                                    \
   V(signal_wrap)                                                               \
+  V(socket_pool)                                                               \
   V(spawn_sync)                                                                \
+  V(stream_ipc_channel)                                                        \
+  V(stream_line_splitter)                                                      \
   V(stream_pipe)                                                               \
   V(stream_wrap)                                                               \
   V(string_decoder)                                                            \
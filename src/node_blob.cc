@@ -3,8 +3,11 @@
 #include "base_object-inl.h"
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
+#include "node_bob-inl.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_file.h"
+#include "string_bytes.h"
 #include "threadpoolwork-inl.h"
 #include "v8.h"
 
@@ -22,15 +25,133 @@ using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
+using v8::Integer;
+using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
 using v8::Number;
 using v8::Object;
 using v8::String;
 using v8::Uint32;
+using v8::Uint8Array;
 using v8::Undefined;
 using v8::Value;
 
+namespace {
+// Keeps single reads of a file within what uv_buf_t can describe.
+constexpr size_t kMaxFileReadSize = 1 << 30;
+
+// Reads all of `entries` into `dest`. Returns 0 or a negative libuv error
+// code.
+int ReadEntries(const std::vector<BlobEntry>& entries,
+                char* dest,
+                size_t length) {
+  BlobSource source(entries);
+  size_t total = 0;
+  int status = bob::STATUS_CONTINUE;
+  while (status == bob::STATUS_CONTINUE) {
+    status = source.Pull(
+        [&](int status, const char* data, size_t count, bob::Done done) {
+          total += count;
+        },
+        bob::OPTIONS_SYNC,
+        dest + total,
+        length - total);
+  }
+  CHECK_IMPLIES(status == bob::STATUS_END, total == length);
+  return status < 0 ? status : 0;
+}
+}  // anonymous namespace
+
+int BlobFile::Open(const char* path,
+                   std::shared_ptr<BlobFile>* file,
+                   uint64_t* size) {
+  uv_fs_t req;
+  const uv_file fd = uv_fs_open(nullptr, &req, path, O_RDONLY, 0, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (fd < 0)
+    return fd;
+  std::shared_ptr<BlobFile> opened(new BlobFile(fd));
+
+  int err = uv_fs_fstat(nullptr, &req, fd, nullptr);
+  // Only regular files have a size that the Blob can be made of.
+  if (err == 0 && (req.statbuf.st_mode & S_IFMT) != S_IFREG)
+    err = UV_EINVAL;
+  *size = req.statbuf.st_size;
+  uv_fs_req_cleanup(&req);
+  if (err < 0)
+    return err;
+
+  *file = std::move(opened);
+  return 0;
+}
+
+BlobFile::~BlobFile() {
+  uv_fs_t req;
+  uv_fs_close(nullptr, &req, fd_, nullptr);
+  uv_fs_req_cleanup(&req);
+}
+
+int BlobFile::Read(char* data, size_t length, int64_t offset) const {
+  uv_buf_t buf = uv_buf_init(data, length);
+  uv_fs_t req;
+  const int ret = uv_fs_read(nullptr, &req, fd_, &buf, 1, offset, nullptr);
+  uv_fs_req_cleanup(&req);
+  return ret;
+}
+
+size_t BlobSource::NextChunkSize(size_t max) const {
+  if (index_ == entries_.size())
+    return 0;
+  return std::min(max, entries_[index_].length - position_);
+}
+
+bool BlobSource::NextNeedsFile() const {
+  return index_ < entries_.size() && entries_[index_].file;
+}
+
+int BlobSource::DoPull(
+    bob::Next<char> next,
+    int options,
+    char* data,
+    size_t count,
+    size_t max_count_hint) {
+  // Empty entries have nothing to pull.
+  while (index_ < entries_.size() && entries_[index_].length == position_) {
+    index_++;
+    position_ = 0;
+  }
+  if (index_ == entries_.size()) {
+    std::move(next)(bob::STATUS_END, nullptr, 0, [](size_t len) {});
+    return bob::STATUS_END;
+  }
+
+  CHECK_NOT_NULL(data);
+  CHECK_GT(count, 0);
+  const BlobEntry& entry = entries_[index_];
+  size_t length = std::min(count, entry.length - position_);
+  if (entry.file) {
+    length = std::min(length, kMaxFileReadSize);
+    const int ret = entry.file->Read(data, length, entry.offset + position_);
+    if (ret <= 0) {
+      // Running out of data means that the file has been cut short since
+      // the Blob was created.
+      const int status = ret < 0 ? ret : UV_EIO;
+      std::move(next)(status, nullptr, 0, [](size_t len) {});
+      return status;
+    }
+    length = ret;
+  } else {
+    memcpy(data,
+           static_cast<char*>(entry.store->Data()) + entry.offset + position_,
+           length);
+  }
+
+  position_ += length;
+  std::move(next)(bob::STATUS_CONTINUE, data, length, [](size_t len) {});
+  return bob::STATUS_CONTINUE;
+}
+
 void Blob::Initialize(
     Local<Object> target,
     Local<Value> unused,
@@ -43,6 +164,8 @@ void Blob::Initialize(
   if (binding_data == nullptr) return;
 
   env->SetMethod(target, "createBlob", New);
+  env->SetMethod(target, "createMappedBlob", CreateMappedBlob);
+  env->SetMethod(target, "createFileBlob", CreateFileBlob);
   env->SetMethod(target, "storeDataObject", StoreDataObject);
   env->SetMethod(target, "getDataObject", GetDataObject);
   env->SetMethod(target, "revokeDataObject", RevokeDataObject);
@@ -60,6 +183,8 @@ Local<FunctionTemplate> Blob::GetConstructorTemplate(Environment* env) {
         FIXED_ONE_BYTE_STRING(env->isolate(), "Blob"));
     env->SetProtoMethod(tmpl, "toArrayBuffer", ToArrayBuffer);
     env->SetProtoMethod(tmpl, "slice", ToSlice);
+    env->SetProtoMethod(tmpl, "toString", ToString);
+    env->SetProtoMethod(tmpl, "getReader", GetReader);
     env->set_blob_constructor_template(tmpl);
   }
   return tmpl;
@@ -108,7 +233,8 @@ void Blob::New(const FunctionCallbackInfo<Value>& args) {
       std::shared_ptr<BackingStore> store = view->Buffer()->GetBackingStore();
       size_t byte_length = view->ByteLength();
       view->Buffer()->Detach();  // The Blob will own the backing store now.
-      entries.emplace_back(BlobEntry{std::move(store), byte_length, 0});
+      entries.emplace_back(
+          BlobEntry{std::move(store), byte_length, 0, nullptr});
       len += byte_length;
     } else {
       Blob* blob;
@@ -125,6 +251,80 @@ void Blob::New(const FunctionCallbackInfo<Value>& args) {
     args.GetReturnValue().Set(blob->object());
 }
 
+// createMappedBlob(path, ctx) returns a Blob whose data is a copy-on-write
+// mapping of the file, so that it can be sliced and sent to other threads
+// without being read or copied. Files larger than an ArrayBuffer can hold
+// are mapped in several parts.
+void Blob::CreateMappedBlob(const FunctionCallbackInfo<Value>& args) {
+  static constexpr int64_t kChunkSize = 1 << 30;
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  CHECK_EQ(args.Length(), 2);
+
+  BufferValue path(isolate, args[0]);
+  CHECK_NOT_NULL(*path);
+  Local<Object> ctx = args[1].As<Object>();
+
+  std::vector<BlobEntry> entries;
+  size_t length = 0;
+  for (;;) {
+    std::shared_ptr<BackingStore> store;
+    const char* syscall = nullptr;
+    const int err = fs::MapFileToBackingStore(
+        env->event_loop(), isolate, *path, length, kChunkSize, &store,
+        &syscall);
+    if (err < 0) {
+      ctx->Set(env->context(), env->errno_string(),
+               Integer::New(isolate, err)).Check();
+      ctx->Set(env->context(), env->syscall_string(),
+               OneByteString(isolate, syscall)).Check();
+      return;
+    }
+    const size_t byte_length = store->ByteLength();
+    if (byte_length == 0)
+      break;
+    entries.emplace_back(
+        BlobEntry{std::move(store), byte_length, 0, nullptr, true});
+    length += byte_length;
+    if (byte_length < static_cast<size_t>(kChunkSize))
+      break;
+  }
+
+  BaseObjectPtr<Blob> blob = Create(env, entries, length);
+  if (blob)
+    args.GetReturnValue().Set(blob->object());
+}
+
+// createFileBlob(path, ctx) returns a Blob made of the current contents of
+// the file, which are only read when the Blob is read.
+void Blob::CreateFileBlob(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  CHECK_EQ(args.Length(), 2);
+
+  BufferValue path(isolate, args[0]);
+  CHECK_NOT_NULL(*path);
+  Local<Object> ctx = args[1].As<Object>();
+
+  std::shared_ptr<BlobFile> file;
+  uint64_t size;
+  const int err = BlobFile::Open(*path, &file, &size);
+  if (err < 0) {
+    ctx->Set(env->context(), env->errno_string(),
+             Integer::New(isolate, err)).Check();
+    ctx->Set(env->context(), env->syscall_string(),
+             OneByteString(isolate, "open")).Check();
+    return;
+  }
+
+  std::vector<BlobEntry> entries;
+  if (size > 0)
+    entries.emplace_back(BlobEntry{nullptr, size, 0, std::move(file)});
+  BaseObjectPtr<Blob> blob = Create(env, entries, size);
+  if (blob)
+    args.GetReturnValue().Set(blob->object());
+}
+
 void Blob::ToArrayBuffer(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Blob* blob;
@@ -147,8 +347,67 @@ void Blob::ToSlice(const FunctionCallbackInfo<Value>& args) {
     args.GetReturnValue().Set(slice->object());
 }
 
+// toString(encoding) decodes the whole Blob. A Blob that is a single part
+// of a buffer shares its memory with the string when that is possible, as
+// the data of a Blob never changes. Blobs that read from files return
+// undefined, and need to be read with getReader() instead.
+void Blob::ToString(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Blob* blob;
+  ASSIGN_OR_RETURN_UNWRAP(&blob, args.Holder());
+  const enum encoding encoding = ParseEncoding(isolate, args[0], UTF8);
+  if (blob->HasFileEntries())
+    return;
+
+  Local<Value> error;
+  MaybeLocal<Value> maybe_ret;
+  const std::vector<BlobEntry>& entries = blob->store_;
+  if (entries.size() == 1 && !entries[0].mapped) {
+    maybe_ret = StringBytes::EncodeShared(isolate,
+                                          entries[0].store,
+                                          entries[0].offset,
+                                          entries[0].length,
+                                          encoding,
+                                          &error);
+  } else {
+    MaybeStackBuffer<char> data(blob->length());
+    CHECK_EQ(ReadEntries(entries, data.out(), blob->length()), 0);
+    maybe_ret =
+        StringBytes::Encode(isolate, data.out(), blob->length(), encoding,
+                            &error);
+  }
+  Local<Value> ret;
+  if (!maybe_ret.ToLocal(&ret)) {
+    CHECK(!error.IsEmpty());
+    isolate->ThrowException(error);
+    return;
+  }
+  args.GetReturnValue().Set(ret);
+}
+
+void Blob::GetReader(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Blob* blob;
+  ASSIGN_OR_RETURN_UNWRAP(&blob, args.Holder());
+  BaseObjectPtr<Reader> reader = Reader::Create(env, blob);
+  if (reader)
+    args.GetReturnValue().Set(reader->object());
+}
+
 void Blob::MemoryInfo(MemoryTracker* tracker) const {
-  tracker->TrackFieldWithSize("store", length_);
+  size_t in_memory = 0;
+  for (const auto& entry : store_) {
+    if (!entry.file)
+      in_memory += entry.length;
+  }
+  tracker->TrackFieldWithSize("store", in_memory);
+}
+
+bool Blob::HasFileEntries() const {
+  return std::any_of(store_.begin(), store_.end(), [](const BlobEntry& entry) {
+    return static_cast<bool>(entry.file);
+  });
 }
 
 MaybeLocal<Value> Blob::GetArrayBuffer(Environment* env) {
@@ -156,17 +415,11 @@ MaybeLocal<Value> Blob::GetArrayBuffer(Environment* env) {
   size_t len = length();
   std::shared_ptr<BackingStore> store =
       ArrayBuffer::NewBackingStore(env->isolate(), len);
-  if (len > 0) {
-    unsigned char* dest = static_cast<unsigned char*>(store->Data());
-    size_t total = 0;
-    for (const auto& entry : entries()) {
-      unsigned char* src = static_cast<unsigned char*>(entry.store->Data());
-      src += entry.offset;
-      memcpy(dest, src, entry.length);
-      dest += entry.length;
-      total += entry.length;
-      CHECK_LE(total, len);
-    }
+  const int err =
+      ReadEntries(entries(), static_cast<char*>(store->Data()), len);
+  if (err < 0) {
+    env->ThrowUVException(err, "read");
+    return MaybeLocal<Value>();
   }
 
   return scope.Escape(ArrayBuffer::New(env->isolate(), store));
@@ -184,14 +437,15 @@ BaseObjectPtr<Blob> Blob::Slice(Environment* env, size_t start, size_t end) {
   if (total == 0) return Create(env, slices, 0);
 
   for (const auto& entry : entries()) {
-    if (start + entry.offset > entry.store->ByteLength()) {
+    if (start >= entry.length) {
       start -= entry.length;
       continue;
     }
 
     size_t offset = entry.offset + start;
-    size_t len = std::min(remaining, entry.store->ByteLength() - offset);
-    slices.emplace_back(BlobEntry{entry.store, len, offset});
+    size_t len = std::min(remaining, entry.length - start);
+    slices.emplace_back(
+        BlobEntry{entry.store, len, offset, entry.file, entry.mapped});
 
     remaining -= len;
     start = 0;
@@ -214,6 +468,114 @@ Blob::Blob(
   MakeWeak();
 }
 
+Local<FunctionTemplate> Blob::Reader::GetConstructorTemplate(
+    Environment* env) {
+  Local<FunctionTemplate> tmpl = env->blob_reader_constructor_template();
+  if (tmpl.IsEmpty()) {
+    tmpl = FunctionTemplate::New(env->isolate());
+    tmpl->InstanceTemplate()->SetInternalFieldCount(
+        AsyncWrap::kInternalFieldCount);
+    tmpl->Inherit(AsyncWrap::GetConstructorTemplate(env));
+    tmpl->SetClassName(
+        FIXED_ONE_BYTE_STRING(env->isolate(), "BlobReader"));
+    env->SetProtoMethod(tmpl, "pull", Pull);
+    env->set_blob_reader_constructor_template(tmpl);
+  }
+  return tmpl;
+}
+
+BaseObjectPtr<Blob::Reader> Blob::Reader::Create(Environment* env,
+                                                 Blob* blob) {
+  Local<Object> obj;
+  if (!GetConstructorTemplate(env)->InstanceTemplate()
+          ->NewInstance(env->context()).ToLocal(&obj)) {
+    return BaseObjectPtr<Reader>();
+  }
+  return MakeBaseObject<Reader>(env, obj, blob->entries());
+}
+
+Blob::Reader::Reader(
+    Environment* env,
+    Local<Object> obj,
+    const std::vector<BlobEntry>& entries)
+    : AsyncWrap(env, obj, AsyncWrap::PROVIDER_BLOBREADER),
+      ThreadPoolWork(env),
+      source_(entries) {
+  MakeWeak();
+}
+
+// reader.pull(callback) calls callback(status, chunk) with the next chunk
+// as an Uint8Array, or with bob::STATUS_END or a negative libuv error code
+// and no chunk. Chunks from memory are handed out before pull() returns.
+void Blob::Reader::Pull(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Reader* reader;
+  ASSIGN_OR_RETURN_UNWRAP(&reader, args.Holder());
+  CHECK(args[0]->IsFunction());
+  CHECK(!reader->self_ && "pull while a read is pending");
+
+  reader->callback_.Reset(env->isolate(), args[0].As<Function>());
+  const size_t size = reader->source_.NextChunkSize(kChunkSize);
+  reader->chunk_.reset();
+  if (size > 0)
+    reader->chunk_ = ArrayBuffer::NewBackingStore(env->isolate(), size);
+
+  if (reader->source_.NextNeedsFile()) {
+    reader->self_ = BaseObjectPtr<Reader>(reader);
+    return reader->ScheduleWork();
+  }
+  reader->PullChunk();
+  reader->Deliver();
+}
+
+void Blob::Reader::PullChunk() {
+  chunk_length_ = 0;
+  status_ = source_.Pull(
+      [&](int status, const char* data, size_t count, bob::Done done) {
+        chunk_length_ = count;
+      },
+      bob::OPTIONS_SYNC,
+      chunk_ ? static_cast<char*>(chunk_->Data()) : nullptr,
+      chunk_ ? chunk_->ByteLength() : 0);
+}
+
+void Blob::Reader::DoThreadPoolWork() {
+  PullChunk();
+}
+
+void Blob::Reader::AfterThreadPoolWork(int status) {
+  BaseObjectPtr<Reader> self = std::move(self_);
+  if (status == UV_ECANCELED)
+    return;
+  CHECK_EQ(status, 0);
+
+  Environment* env = AsyncWrap::env();
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+  Deliver();
+}
+
+void Blob::Reader::Deliver() {
+  Isolate* isolate = AsyncWrap::env()->isolate();
+  Local<Value> argv[] = {
+    Integer::New(isolate, status_),
+    Undefined(isolate)
+  };
+  if (status_ == bob::STATUS_CONTINUE) {
+    Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(chunk_));
+    argv[1] = Uint8Array::New(ab, 0, chunk_length_);
+  }
+  chunk_.reset();
+
+  Local<Function> callback = callback_.Get(isolate);
+  callback_.Reset();
+  MakeCallback(callback, arraysize(argv), argv);
+}
+
+void Blob::Reader::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("chunk", chunk_ ? chunk_->ByteLength() : 0);
+}
+
 BaseObjectPtr<BaseObject>
 Blob::BlobTransferData::Deserialize(
     Environment* env,
@@ -328,8 +690,9 @@ void FixedSizeBlobCopyJob::AfterThreadPoolWork(int status) {
   Context::Scope context_scope(env->context());
   Local<Value> args[2];
 
-  if (status == UV_ECANCELED) {
-    args[0] = Number::New(env->isolate(), status),
+  if (status == UV_ECANCELED || status_ < 0) {
+    args[0] = Number::New(env->isolate(),
+                          status == UV_ECANCELED ? status : status_),
     args[1] = Undefined(env->isolate());
   } else {
     args[0] = Undefined(env->isolate());
@@ -340,18 +703,8 @@ void FixedSizeBlobCopyJob::AfterThreadPoolWork(int status) {
 }
 
 void FixedSizeBlobCopyJob::DoThreadPoolWork() {
-  unsigned char* dest = static_cast<unsigned char*>(destination_->Data());
-  if (length_ > 0) {
-    size_t total = 0;
-    for (const auto& entry : source_) {
-      unsigned char* src = static_cast<unsigned char*>(entry.store->Data());
-      src += entry.offset;
-      memcpy(dest, src, entry.length);
-      dest += entry.length;
-      total += entry.length;
-      CHECK_LE(total, length_);
-    }
-  }
+  status_ = ReadEntries(
+      source_, static_cast<char*>(destination_->Data()), length_);
 }
 
 void FixedSizeBlobCopyJob::MemoryInfo(MemoryTracker* tracker) const {
@@ -384,10 +737,11 @@ void FixedSizeBlobCopyJob::New(const FunctionCallbackInfo<Value>& args) {
 
   // This is a fairly arbitrary heuristic. We want to avoid deferring to
   // the threadpool if the amount of data being copied is small and there
-  // aren't that many entries to copy.
+  // aren't that many entries to copy. Files are never read synchronously.
   FixedSizeBlobCopyJob::Mode mode =
       (blob->length() < kMaxSyncLength &&
-       blob->entries().size() < kMaxEntryCount) ?
+       blob->entries().size() < kMaxEntryCount &&
+       !blob->HasFileEntries()) ?
           FixedSizeBlobCopyJob::Mode::SYNC :
           FixedSizeBlobCopyJob::Mode::ASYNC;
 
@@ -486,8 +840,13 @@ constexpr FastStringKey BlobBindingData::type_name;
 
 void Blob::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Blob::New);
+  registry->Register(Blob::CreateMappedBlob);
+  registry->Register(Blob::CreateFileBlob);
   registry->Register(Blob::ToArrayBuffer);
   registry->Register(Blob::ToSlice);
+  registry->Register(Blob::ToString);
+  registry->Register(Blob::GetReader);
+  registry->Register(Blob::Reader::Pull);
   registry->Register(Blob::StoreDataObject);
   registry->Register(Blob::GetDataObject);
   registry->Register(Blob::RevokeDataObject);
@@ -7,21 +7,77 @@
 #include "base_object.h"
 #include "env.h"
 #include "memory_tracker.h"
+#include "node_bob.h"
 #include "node_internals.h"
 #include "node_snapshotable.h"
 #include "node_worker.h"
+#include "uv.h"
 #include "v8.h"
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace node {
 
+// An open file that Blob entries read their data from only when it is
+// needed. It can be shared between threads.
+class BlobFile final {
+ public:
+  // Returns 0 or a negative libuv error code.
+  static int Open(const char* path,
+                  std::shared_ptr<BlobFile>* file,
+                  uint64_t* size);
+  ~BlobFile();
+
+  // Returns the number of bytes read or a negative libuv error code.
+  int Read(char* data, size_t length, int64_t offset) const;
+
+  BlobFile(const BlobFile&) = delete;
+  BlobFile& operator=(const BlobFile&) = delete;
+
+ private:
+  explicit BlobFile(uv_file fd) : fd_(fd) {}
+
+  uv_file fd_;
+};
+
 struct BlobEntry {
   std::shared_ptr<v8::BackingStore> store;
   size_t length;
   size_t offset;
+  // If set, `store` is empty and the data is read from the file, starting
+  // at `offset`.
+  std::shared_ptr<BlobFile> file;
+  // Whether `store` maps a file, whose contents may still change.
+  bool mapped = false;
+};
+
+// Reads the data of a list of Blob entries in order, into the buffer that
+// the consumer passes to Pull(). Pulls are always answered synchronously,
+// so file entries should be pulled from the threadpool.
+class BlobSource final : public bob::SourceImpl<char> {
+ public:
+  explicit BlobSource(const std::vector<BlobEntry>& entries)
+      : entries_(entries) {}
+
+  // The size of the next pull, up to `max`, and whether it reads a file.
+  size_t NextChunkSize(size_t max) const;
+  bool NextNeedsFile() const;
+
+ protected:
+  int DoPull(
+      bob::Next<char> next,
+      int options,
+      char* data,
+      size_t count,
+      size_t max_count_hint) override;
+
+ private:
+  std::vector<BlobEntry> entries_;
+  size_t index_ = 0;
+  size_t position_ = 0;  // Within entries_[index_].
 };
 
 class Blob : public BaseObject {
@@ -36,8 +92,13 @@ class Blob : public BaseObject {
       void* priv);
 
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void CreateMappedBlob(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void CreateFileBlob(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void ToArrayBuffer(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void ToSlice(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void ToString(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetReader(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void StoreDataObject(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void GetDataObject(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void RevokeDataObject(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -67,6 +128,45 @@ class Blob : public BaseObject {
 
   inline size_t length() const { return length_; }
 
+  bool HasFileEntries() const;
+
+  // Hands out the data of a Blob chunk by chunk, so that it can be streamed
+  // without copying all of it at once. Chunks of files are read on the
+  // threadpool.
+  class Reader final : public AsyncWrap, public ThreadPoolWork {
+   public:
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    static v8::Local<v8::FunctionTemplate> GetConstructorTemplate(
+        Environment* env);
+    static BaseObjectPtr<Reader> Create(Environment* env, Blob* blob);
+
+    static void Pull(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+    void DoThreadPoolWork() override;
+    void AfterThreadPoolWork(int status) override;
+
+    void MemoryInfo(MemoryTracker* tracker) const override;
+    SET_MEMORY_INFO_NAME(Blob::Reader)
+    SET_SELF_SIZE(Reader)
+
+    Reader(Environment* env,
+           v8::Local<v8::Object> obj,
+           const std::vector<BlobEntry>& entries);
+
+   private:
+    // Pulls one chunk into chunk_ and sets status_ and chunk_length_.
+    void PullChunk();
+    void Deliver();
+
+    BlobSource source_;
+    std::shared_ptr<v8::BackingStore> chunk_;
+    size_t chunk_length_ = 0;
+    int status_ = bob::STATUS_CONTINUE;
+    v8::Global<v8::Function> callback_;
+    BaseObjectPtr<Reader> self_;  // Set while a read is on the threadpool.
+  };
+
   class BlobTransferData : public worker::TransferData {
    public:
     explicit BlobTransferData(
@@ -140,6 +240,7 @@ class FixedSizeBlobCopyJob : public AsyncWrap, public ThreadPoolWork {
   std::vector<BlobEntry> source_;
   std::shared_ptr<v8::BackingStore> destination_;
   size_t length_ = 0;
+  int status_ = 0;
 };
 
 class BlobBindingData : public SnapshotableObject {
@@ -21,6 +21,10 @@
 
 #include "node_buffer.h"
 #include "allocated_buffer-inl.h"
+#include "base_object-inl.h"
+#include "chunk_list.h"
+#include "memory_tracker-inl.h"
+#include "multi_string_search.h"
 #include "node.h"
 #include "node_blob.h"
 #include "node_errors.h"
@@ -28,13 +32,17 @@
 #include "node_internals.h"
 
 #include "env-inl.h"
+#include "stream_base-inl.h"
 #include "string_bytes.h"
 #include "string_search.h"
 #include "util-inl.h"
 #include "v8.h"
 
+#include <algorithm>
 #include <cstring>
 #include <climits>
+#include <string>
+#include <vector>
 
 #define THROW_AND_RETURN_UNLESS_BUFFER(env, obj)                            \
   THROW_AND_RETURN_IF_NOT_BUFFER(env, obj, "argument")                      \
@@ -49,12 +57,15 @@
 namespace node {
 namespace Buffer {
 
+using v8::Array;
 using v8::ArrayBuffer;
 using v8::ArrayBufferView;
 using v8::BackingStore;
 using v8::Context;
 using v8::EscapableHandleScope;
+using v8::Float64Array;
 using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
 using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
@@ -1119,11 +1130,11 @@ static void EncodeUtf8String(const FunctionCallbackInfo<Value>& args) {
 
     CHECK(bs);
 
-    str->WriteUtf8(isolate,
-                   static_cast<char*>(bs->Data()),
-                   -1,  // We are certain that `data` is sufficiently large
-                   nullptr,
-                   String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+    StringBytes::Write(isolate,
+                       static_cast<char*>(bs->Data()),
+                       length,
+                       str,
+                       UTF8);
 
     ab = ArrayBuffer::New(isolate, std::move(bs));
   }
@@ -1156,12 +1167,8 @@ static void EncodeInto(const FunctionCallbackInfo<Value>& args) {
       result_arr->ByteOffset());
 
   int nchars;
-  int written = source->WriteUtf8(
-      isolate,
-      write_result,
-      dest_length,
-      &nchars,
-      String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+  size_t written = StringBytes::Write(
+      isolate, write_result, dest_length, source, UTF8, &nchars);
   results[0] = nchars;
   results[1] = written;
 }
@@ -1258,6 +1265,383 @@ void CopyArrayBuffer(const FunctionCallbackInfo<Value>& args) {
   memcpy(dest, src, bytes_to_copy);
 }
 
+// A set of patterns that is compiled once and can then be searched for in
+// any number of buffers, finding all of them in a single pass.
+class MultiSearch : public BaseObject {
+ public:
+  static void Initialize(Environment* env, Local<Object> target);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void Search(const FunctionCallbackInfo<Value>& args);
+
+  MultiSearch(Environment* env,
+              Local<Object> object,
+              const std::vector<std::string>& patterns,
+              bool prefilter)
+      : BaseObject(env, object), search_(patterns, prefilter) {
+    MakeWeak();
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("automaton", search_.memory_size());
+  }
+  SET_MEMORY_INFO_NAME(MultiSearch)
+  SET_SELF_SIZE(MultiSearch)
+
+ private:
+  const stringsearch::MultiStringSearch search_;
+};
+
+void MultiSearch::Initialize(Environment* env, Local<Object> target) {
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(BaseObject::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      BaseObject::kInternalFieldCount);
+  env->SetProtoMethodNoSideEffect(t, "search", Search);
+  env->SetConstructorFunction(target, "MultiSearch", t);
+}
+
+void MultiSearch::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Search);
+}
+
+// new MultiSearch(patterns, prefilter), where the patterns are an array of
+// ArrayBufferViews and strings, the latter taken as UTF-8.
+void MultiSearch::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsArray());
+  CHECK(args[1]->IsBoolean());
+
+  Local<Array> list = args[0].As<Array>();
+  std::vector<std::string> patterns;
+  patterns.reserve(list->Length());
+  for (uint32_t i = 0; i < list->Length(); i++) {
+    Local<Value> value;
+    if (!list->Get(env->context(), i).ToLocal(&value))
+      return;
+    if (value->IsArrayBufferView()) {
+      ArrayBufferViewContents<char> pattern(value);
+      patterns.emplace_back(pattern.data(), pattern.length());
+    } else {
+      CHECK(value->IsString());
+      Utf8Value pattern(env->isolate(), value);
+      patterns.emplace_back(*pattern, pattern.length());
+    }
+    CHECK(!patterns.back().empty());
+  }
+
+  new MultiSearch(env, args.This(), patterns, args[1]->IsTrue());
+}
+
+// search(buffer, offset, limit) returns a Float64Array with the offset and
+// the pattern index of each match from `offset` on, in pairs, ordered by
+// where the matches end. A `limit` other than 0 caps the number of matches.
+void MultiSearch::Search(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  MultiSearch* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+  CHECK(args[1]->IsNumber());
+  CHECK(args[2]->IsUint32());
+
+  ArrayBufferViewContents<uint8_t> subject(args[0]);
+  const int64_t offset_i64 = args[1].As<Integer>()->Value();
+  const size_t limit = args[2].As<Uint32>()->Value();
+  const size_t offset = static_cast<size_t>(
+      std::min<int64_t>(std::max<int64_t>(offset_i64, 0), subject.length()));
+
+  std::vector<double> matches;
+  wrap->search_.Search(
+      subject.data() + offset,
+      subject.length() - offset,
+      [&](size_t index, uint32_t pattern) {
+        matches.push_back(static_cast<double>(offset + index));
+        matches.push_back(pattern);
+        return limit == 0 || matches.size() < 2 * limit;
+      });
+
+  Local<ArrayBuffer> ab =
+      ArrayBuffer::New(env->isolate(), matches.size() * sizeof(double));
+  if (!matches.empty()) {
+    memcpy(ab->GetBackingStore()->Data(),
+           matches.data(),
+           matches.size() * sizeof(double));
+  }
+  args.GetReturnValue().Set(Float64Array::New(ab, 0, matches.size()));
+}
+
+// A list of slices of other buffers, which are shared rather than copied,
+// for accumulating data from a stream until it is parsed or written out.
+// See ChunkList. The slices take a reference to the memory of the buffers
+// they are taken from, so unlike with Buffer.concat(), changes to that
+// memory show through.
+class BufferList : public BaseObject {
+ public:
+  static void Initialize(Environment* env, Local<Object> target);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void Push(const FunctionCallbackInfo<Value>& args);
+  static void Length(const FunctionCallbackInfo<Value>& args);
+  static void IndexOf(const FunctionCallbackInfo<Value>& args);
+  static void Peek(const FunctionCallbackInfo<Value>& args);
+  static void Read(const FunctionCallbackInfo<Value>& args);
+  static void Consume(const FunctionCallbackInfo<Value>& args);
+  static void ToBuffer(const FunctionCallbackInfo<Value>& args);
+  static void WriteTo(const FunctionCallbackInfo<Value>& args);
+
+  BufferList(Environment* env, Local<Object> object)
+      : BaseObject(env, object) {
+    MakeWeak();
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    // The memory of the slices belongs to the buffers they were taken from.
+    tracker->TrackFieldWithSize("chunks",
+                                list_.chunk_count() * sizeof(Chunk));
+  }
+  SET_MEMORY_INFO_NAME(BufferList)
+  SET_SELF_SIZE(BufferList)
+
+ private:
+  using Chunk = ChunkList<std::shared_ptr<BackingStore>>::Chunk;
+
+  // Returns the first `length` bytes as a Buffer, which shares the memory of
+  // a slice if they are all in one slice and copies them otherwise.
+  MaybeLocal<Uint8Array> Slice(size_t length);
+  size_t LengthArgument(Local<Value> value) const;
+
+  ChunkList<std::shared_ptr<BackingStore>> list_;
+};
+
+void BufferList::Initialize(Environment* env, Local<Object> target) {
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(BaseObject::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      BaseObject::kInternalFieldCount);
+  env->SetProtoMethod(t, "push", Push);
+  env->SetProtoMethodNoSideEffect(t, "length", Length);
+  env->SetProtoMethodNoSideEffect(t, "indexOf", IndexOf);
+  env->SetProtoMethodNoSideEffect(t, "peek", Peek);
+  env->SetProtoMethod(t, "read", Read);
+  env->SetProtoMethod(t, "consume", Consume);
+  env->SetProtoMethod(t, "toBuffer", ToBuffer);
+  env->SetProtoMethod(t, "writeTo", WriteTo);
+  env->SetConstructorFunction(target, "BufferList", t);
+}
+
+void BufferList::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Push);
+  registry->Register(Length);
+  registry->Register(IndexOf);
+  registry->Register(Peek);
+  registry->Register(Read);
+  registry->Register(Consume);
+  registry->Register(ToBuffer);
+  registry->Register(WriteTo);
+}
+
+MaybeLocal<Uint8Array> BufferList::Slice(size_t length) {
+  Isolate* isolate = env()->isolate();
+  size_t chunk_offset;
+  const Chunk* chunk = list_.FindContiguous(0, length, &chunk_offset);
+  // The memory of a SharedArrayBuffer can not back an ArrayBuffer.
+  if (chunk != nullptr && !chunk->owner->IsShared()) {
+    const size_t offset =
+        chunk->data - static_cast<const char*>(chunk->owner->Data());
+    return Buffer::New(isolate,
+                       ArrayBuffer::New(isolate, chunk->owner),
+                       offset + chunk_offset,
+                       length);
+  }
+
+  std::shared_ptr<BackingStore> store;
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+    store = ArrayBuffer::NewBackingStore(isolate, length);
+  }
+  list_.CopyOut(0, static_cast<char*>(store->Data()), length);
+  return Buffer::New(isolate, ArrayBuffer::New(isolate, store), 0, length);
+}
+
+// Lengths are clamped to what the list holds.
+size_t BufferList::LengthArgument(Local<Value> value) const {
+  CHECK(value->IsNumber());
+  const int64_t length = value.As<Integer>()->Value();
+  return static_cast<size_t>(std::min<int64_t>(
+      std::max<int64_t>(length, 0), list_.length()));
+}
+
+void BufferList::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  new BufferList(env, args.This());
+}
+
+// push(view) appends the contents of an ArrayBufferView without copying
+// them, and returns the new length.
+void BufferList::Push(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+
+  Local<ArrayBufferView> view = args[0].As<ArrayBufferView>();
+  const size_t length = view->ByteLength();
+  if (length > 0) {
+    std::shared_ptr<BackingStore> store = view->Buffer()->GetBackingStore();
+    const char* data =
+        static_cast<const char*>(store->Data()) + view->ByteOffset();
+    wrap->list_.Push(std::move(store), data, length);
+  }
+  args.GetReturnValue().Set(static_cast<double>(wrap->list_.length()));
+}
+
+void BufferList::Length(const FunctionCallbackInfo<Value>& args) {
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  args.GetReturnValue().Set(static_cast<double>(wrap->list_.length()));
+}
+
+// indexOf(value, from) finds a byte, given as a number, a string, taken as
+// UTF-8, or the contents of an ArrayBufferView, across the boundaries of
+// the slices. Returns -1 if there is no match from `from` on. A negative
+// `from` counts as 0.
+void BufferList::IndexOf(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  const size_t from = wrap->LengthArgument(args[1]);
+
+  int64_t result;
+  if (args[0]->IsUint32()) {
+    const char byte = static_cast<char>(args[0].As<Uint32>()->Value());
+    result = wrap->list_.IndexOf(&byte, 1, from);
+  } else if (args[0]->IsString()) {
+    Utf8Value needle(env->isolate(), args[0]);
+    result = wrap->list_.IndexOf(*needle, needle.length(), from);
+  } else {
+    THROW_AND_RETURN_UNLESS_BUFFER(env, args[0]);
+    ArrayBufferViewContents<char> needle(args[0]);
+    result = wrap->list_.IndexOf(needle.data(), needle.length(), from);
+  }
+  args.GetReturnValue().Set(static_cast<double>(result));
+}
+
+// peek(n) returns the first n bytes as a Buffer, without removing them.
+// The Buffer shares memory with the list if they are all in one slice.
+void BufferList::Peek(const FunctionCallbackInfo<Value>& args) {
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  Local<Uint8Array> result;
+  if (wrap->Slice(wrap->LengthArgument(args[0])).ToLocal(&result))
+    args.GetReturnValue().Set(result);
+}
+
+// read(n) is peek(n) followed by consume(n).
+void BufferList::Read(const FunctionCallbackInfo<Value>& args) {
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  const size_t length = wrap->LengthArgument(args[0]);
+  Local<Uint8Array> result;
+  if (wrap->Slice(length).ToLocal(&result)) {
+    wrap->list_.Consume(length);
+    args.GetReturnValue().Set(result);
+  }
+}
+
+// consume(n) removes the first n bytes without copying anything, and
+// returns the new length.
+void BufferList::Consume(const FunctionCallbackInfo<Value>& args) {
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  wrap->list_.Consume(wrap->LengthArgument(args[0]));
+  args.GetReturnValue().Set(static_cast<double>(wrap->list_.length()));
+}
+
+// toBuffer() returns all of the contents as a single Buffer. If they are
+// spread over several slices, they are copied into one first, which then
+// replaces them in the list, so that the copy is made only once.
+void BufferList::ToBuffer(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  ChunkList<std::shared_ptr<BackingStore>>& list = wrap->list_;
+
+  if (list.chunk_count() > 1) {
+    const size_t length = list.length();
+    std::shared_ptr<BackingStore> store;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+      store = ArrayBuffer::NewBackingStore(env->isolate(), length);
+    }
+    char* data = static_cast<char*>(store->Data());
+    list.CopyOut(0, data, length);
+    list.Clear();
+    list.Push(std::move(store), data, length);
+  }
+
+  Local<Uint8Array> result;
+  if (wrap->Slice(list.length()).ToLocal(&result))
+    args.GetReturnValue().Set(result);
+}
+
+// writeTo(stream, req) writes all of the contents to a StreamBase with a
+// single write, with one uv_buf_t for each slice, and empties the list.
+// Returns an error code, the same way as stream.writev() does.
+void BufferList::WriteTo(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  BufferList* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsObject());
+  StreamBase* stream = StreamBase::FromObject(args[0].As<Object>());
+  if (stream == nullptr || !stream->IsAlive())
+    return args.GetReturnValue().Set(UV_EINVAL);
+  Local<Object> req_wrap_obj = args[1].As<Object>();
+  ChunkList<std::shared_ptr<BackingStore>>& list = wrap->list_;
+
+  const size_t count = list.chunk_count();
+  MaybeStackBuffer<uv_buf_t, 16> bufs(count);
+  for (size_t i = 0; i < count; i++) {
+    const Chunk& chunk = list.chunk(i);
+    bufs[i] = uv_buf_init(const_cast<char*>(chunk.data), chunk.length);
+  }
+
+  StreamWriteResult res = stream->Write(*bufs, count, nullptr, req_wrap_obj);
+  stream->SetWriteResult(res);
+  if (res.wrap != nullptr) {
+    // The slices are still being written from, so the request keeps their
+    // memory alive, once for each run of slices of the same buffer.
+    std::vector<Local<Value>> buffers;
+    for (size_t i = 0; i < count; i++) {
+      const Chunk& chunk = list.chunk(i);
+      if (i > 0 && chunk.owner == list.chunk(i - 1).owner) continue;
+      if (chunk.owner->IsShared()) {
+        buffers.push_back(SharedArrayBuffer::New(isolate, chunk.owner));
+      } else {
+        buffers.push_back(ArrayBuffer::New(isolate, chunk.owner));
+      }
+    }
+    list.Clear();
+    Local<Array> array = Array::New(isolate, buffers.data(), buffers.size());
+    if (req_wrap_obj->Set(env->context(), env->buffer_string(), array)
+            .IsNothing()) {
+      return;
+    }
+  } else {
+    list.Clear();
+  }
+  args.GetReturnValue().Set(res.err);
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -1311,6 +1695,9 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "utf8Write", StringWrite<UTF8>);
 
   env->SetMethod(target, "getZeroFillToggle", GetZeroFillToggle);
+
+  MultiSearch::Initialize(env, target);
+  BufferList::Initialize(env, target);
 }
 
 }  // anonymous namespace
@@ -1354,6 +1741,9 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
 
   registry->Register(DetachArrayBuffer);
   registry->Register(CopyArrayBuffer);
+
+  MultiSearch::RegisterExternalReferences(registry);
+  BufferList::RegisterExternalReferences(registry);
 }
 
 }  // namespace Buffer
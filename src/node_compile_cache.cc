@@ -0,0 +1,317 @@
+#include "node_compile_cache.h"
+#include "debug_utils-inl.h"
+#include "node_file.h"
+#include "node_internals.h"
+#include "node_options.h"
+#include "node_version.h"
+#include "util-inl.h"
+
+#include <cinttypes>
+#include <cstring>
+
+namespace node {
+
+using v8::ArrayBuffer;
+using v8::ArrayBufferView;
+using v8::BackingStore;
+using v8::CompiledWasmModule;
+using v8::Exception;
+using v8::FunctionCallbackInfo;
+using v8::Isolate;
+using v8::Local;
+using v8::OwnedBuffer;
+using v8::ScriptCompiler;
+using v8::String;
+using v8::Value;
+using v8::WasmStreaming;
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4e434301;  // "NCC" and a format version.
+
+// What comes in front of the code in each entry, in host byte order.
+struct EntryHeader {
+  uint32_t magic;
+  uint32_t version_tag;
+  uint32_t type;
+  uint32_t source_length;
+  uint64_t source_hash;
+  uint32_t data_length;
+  uint32_t padding;
+};
+
+// 64-bit FNV-1a, which is fast enough to be small next to compiling.
+uint64_t Hash(const void* data, size_t length, uint64_t hash = 0) {
+  if (hash == 0) hash = 0xcbf29ce484222325;
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+bool IsCacheableFileName(const std::string& filename) {
+  if (filename.compare(0, 7, "file://") == 0) return true;
+#ifdef _WIN32
+  return filename.size() > 2 && filename[1] == ':' &&
+         (filename[2] == '\\' || filename[2] == '/');
+#else
+  return !filename.empty() && filename[0] == '/';
+#endif
+}
+
+}  // anonymous namespace
+
+CompileCache* CompileCache::Create() {
+  const std::string& dir = per_process::cli_options->compile_cache_dir;
+  if (dir.empty()) return nullptr;
+  fs::FSReqWrapSync req_wrap;
+  int err = fs::MKDirpSync(nullptr, &req_wrap.req, dir, 0777);
+  if (err < 0 && err != UV_EEXIST) {
+    per_process::Debug(DebugCategory::COMPILE_CACHE,
+                       "Cannot create %s: %s\n", dir, uv_strerror(err));
+    return nullptr;
+  }
+  return new CompileCache(dir);
+}
+
+CompileCache* CompileCache::Get() {
+  // Leaked, like other per-process state, as the writer thread may be busy
+  // until the process exits.
+  static CompileCache* const cache = Create();
+  return cache;
+}
+
+CompileCache::CompileCache(const std::string& dir)
+    : dir_(dir),
+      version_tag_(static_cast<uint32_t>(
+          Hash(NODE_VERSION, sizeof(NODE_VERSION) - 1,
+               ScriptCompiler::CachedDataVersionTag()))) {
+  CHECK_EQ(uv_thread_create(&writer_, WriterMain, this), 0);
+}
+
+bool CompileCache::LookupData(Isolate* isolate,
+                              Local<String> filename,
+                              Local<String> source,
+                              CachedCodeType type,
+                              Entry* entry,
+                              std::string* data) {
+  Utf8Value filename_utf8(isolate, filename);
+  std::string name = filename_utf8.ToString();
+  if (!IsCacheableFileName(name)) return false;
+
+  uint8_t type_byte = static_cast<uint8_t>(type);
+  uint64_t name_hash =
+      Hash(&type_byte, 1, Hash(name.data(), name.size()));
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016" PRIx64, name_hash);
+  entry->path = dir_ + kPathSeparator + hex;
+  entry->type = type;
+
+  String::Value source_value(isolate, source);
+  entry->source_length = source_value.length();
+  entry->source_hash = Hash(*source_value,
+                            source_value.length() * sizeof(uint16_t));
+  return ReadEntry(name, entry, data);
+}
+
+bool CompileCache::LookupWasm(const uint8_t* wire_bytes,
+                              size_t length,
+                              Entry* entry,
+                              std::string* data) {
+  if (length > UINT32_MAX) return false;
+  uint64_t source_hash = Hash(wire_bytes, length);
+  uint8_t type_byte = static_cast<uint8_t>(CachedCodeType::kWasm);
+  uint64_t name_hash =
+      Hash(&type_byte, 1, Hash(&source_hash, sizeof(source_hash)));
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016" PRIx64, name_hash);
+  entry->path = dir_ + kPathSeparator + hex;
+  entry->type = CachedCodeType::kWasm;
+  entry->source_length = static_cast<uint32_t>(length);
+  entry->source_hash = source_hash;
+  return ReadEntry(hex, entry, data);
+}
+
+bool CompileCache::ReadEntry(const std::string& name,
+                             Entry* entry,
+                             std::string* data) {
+  std::string contents;
+  if (ReadFileSync(&contents, entry->path.c_str()) != 0 ||
+      contents.size() < sizeof(EntryHeader)) {
+    return false;
+  }
+  EntryHeader header;
+  memcpy(&header, contents.data(), sizeof(header));
+  if (header.magic != kMagic ||
+      header.version_tag != version_tag_ ||
+      header.type != static_cast<uint32_t>(entry->type) ||
+      header.source_length != entry->source_length ||
+      header.source_hash != entry->source_hash ||
+      header.data_length != contents.size() - sizeof(header)) {
+    per_process::Debug(DebugCategory::COMPILE_CACHE,
+                       "Stale entry for %s\n", name);
+    return false;
+  }
+
+  data->assign(contents, sizeof(header), header.data_length);
+  entry->loaded = true;
+  return true;
+}
+
+ScriptCompiler::CachedData* CompileCache::Lookup(Isolate* isolate,
+                                                 Local<String> filename,
+                                                 Local<String> source,
+                                                 CachedCodeType type,
+                                                 Entry* entry) {
+  std::string contents;
+  if (!LookupData(isolate, filename, source, type, entry, &contents))
+    return nullptr;
+  uint8_t* data = new uint8_t[contents.size()];
+  memcpy(data, contents.data(), contents.size());
+  return new ScriptCompiler::CachedData(
+      data, contents.size(), ScriptCompiler::CachedData::BufferOwned);
+}
+
+void CompileCache::Save(Entry&& entry,
+                        std::unique_ptr<ScriptCompiler::CachedData> data) {
+  if (!data || data->length <= 0)
+    return;
+  SaveData(std::move(entry), reinterpret_cast<const char*>(data->data),
+           data->length);
+}
+
+void CompileCache::SaveData(Entry&& entry, const char* data, size_t length) {
+  if (!entry.IsValid() || length == 0)
+    return;
+
+  EntryHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kMagic;
+  header.version_tag = version_tag_;
+  header.type = static_cast<uint32_t>(entry.type);
+  header.source_length = entry.source_length;
+  header.source_hash = entry.source_hash;
+  header.data_length = length;
+
+  Write write;
+  write.path = std::move(entry.path);
+  write.contents.reserve(sizeof(header) + length);
+  write.contents.append(reinterpret_cast<const char*>(&header),
+                        sizeof(header));
+  write.contents.append(data, length);
+
+  Mutex::ScopedLock lock(mutex_);
+  writes_.emplace_back(std::move(write));
+  wakeup_.Signal(lock);
+}
+
+void CompileCache::WriterMain(void* data) {
+  CompileCache* cache = static_cast<CompileCache*>(data);
+  while (true) {
+    Write write;
+    {
+      Mutex::ScopedLock lock(cache->mutex_);
+      while (cache->writes_.empty()) cache->wakeup_.Wait(lock);
+      write = std::move(cache->writes_.front());
+      cache->writes_.pop_front();
+    }
+    WriteEntry(write);
+  }
+}
+
+void CompileCache::WriteEntry(const Write& write) {
+  // Write to a file of our own and rename it, so that other processes that
+  // share the directory never see a partial entry.
+  std::string temp_path =
+      write.path + "." + std::to_string(uv_os_getpid()) + ".tmp";
+  uv_buf_t buf = uv_buf_init(const_cast<char*>(write.contents.data()),
+                             write.contents.size());
+  int err = WriteFileSync(temp_path.c_str(), buf);
+  uv_fs_t req;
+  if (err == 0) {
+    err = uv_fs_rename(
+        nullptr, &req, temp_path.c_str(), write.path.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+  if (err < 0) {
+    uv_fs_unlink(nullptr, &req, temp_path.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+    per_process::Debug(DebugCategory::COMPILE_CACHE,
+                       "Cannot write %s: %s\n", write.path, uv_strerror(err));
+  }
+}
+
+namespace {
+
+// Called by V8 when compilation has finished, possibly more than once and
+// from any thread. Later entries, with more code compiled by the top tier,
+// replace earlier ones.
+class WasmCacheClient final : public WasmStreaming::Client {
+ public:
+  explicit WasmCacheClient(CompileCache::Entry&& entry)
+      : entry_(std::move(entry)) {}
+
+  void OnModuleCompiled(CompiledWasmModule compiled_module) override {
+    OwnedBuffer serialized = compiled_module.Serialize();
+    CompileCache::Entry entry = entry_;
+    CompileCache::Get()->SaveData(
+        std::move(entry),
+        reinterpret_cast<const char*>(serialized.buffer.get()),
+        serialized.size);
+  }
+
+ private:
+  const CompileCache::Entry entry_;
+};
+
+}  // anonymous namespace
+
+void WasmStreamingCallback(const FunctionCallbackInfo<Value>& info) {
+  Isolate* isolate = info.GetIsolate();
+  std::shared_ptr<WasmStreaming> streaming =
+      WasmStreaming::Unpack(isolate, info.Data());
+
+  std::shared_ptr<BackingStore> store;
+  size_t offset = 0;
+  size_t length = 0;
+  if (info[0]->IsArrayBuffer()) {
+    store = info[0].As<ArrayBuffer>()->GetBackingStore();
+    length = store->ByteLength();
+  } else if (info[0]->IsArrayBufferView()) {
+    Local<ArrayBufferView> view = info[0].As<ArrayBufferView>();
+    store = view->Buffer()->GetBackingStore();
+    offset = view->ByteOffset();
+    length = view->ByteLength();
+  } else {
+    streaming->Abort(Exception::TypeError(FIXED_ONE_BYTE_STRING(
+        isolate, "The source must be an ArrayBuffer or an ArrayBufferView")));
+    return;
+  }
+  const uint8_t* wire_bytes = static_cast<const uint8_t*>(store->Data()) +
+                              offset;
+
+  // Has to stay alive until Finish() has returned.
+  std::string compiled;
+  CompileCache* compile_cache = CompileCache::Get();
+  if (compile_cache != nullptr) {
+    CompileCache::Entry entry;
+    if (compile_cache->LookupWasm(wire_bytes, length, &entry, &compiled) &&
+        !streaming->SetCompiledModuleBytes(
+            reinterpret_cast<const uint8_t*>(compiled.data()),
+            compiled.size())) {
+      per_process::Debug(DebugCategory::COMPILE_CACHE,
+                         "Cannot use cached WebAssembly module %s\n",
+                         entry.path);
+    }
+    // If V8 ends up compiling after all, the entry is replaced.
+    if (entry.IsValid())
+      streaming->SetClient(std::make_shared<WasmCacheClient>(std::move(entry)));
+  }
+
+  streaming->OnBytesReceived(wire_bytes, length);
+  streaming->Finish();
+}
+
+}  // namespace node
@@ -0,0 +1,122 @@
+#ifndef SRC_NODE_COMPILE_CACHE_H_
+#define SRC_NODE_COMPILE_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_mutex.h"
+#include "uv.h"
+#include "v8.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace node {
+
+enum class CachedCodeType : uint8_t {
+  kClassic = 0,
+  kFunction,
+  kESM,
+  // Not code: the names that cjs-module-lexer finds in a CommonJS module.
+  kCJSExports,
+  // Serialized, compiled WebAssembly modules.
+  kWasm,
+};
+
+// A V8 code cache for user scripts and modules, kept in the directory given
+// by --compile-cache-dir, which lasts across runs. There is one entry per
+// file name and kind of code, which holds a hash of the source that it was
+// produced from, so an entry is only used for the exact same source and is
+// replaced when the file changes. Entries are read synchronously when code
+// is compiled, and written by a background thread, so that producing them
+// does not hold up the thread that compiles.
+class CompileCache {
+ public:
+  // Where to write a new cache entry for a compilation, filled in by
+  // Lookup(). It is left invalid for code that is not cached.
+  struct Entry {
+    std::string path;
+    uint64_t source_hash = 0;
+    uint32_t source_length = 0;
+    CachedCodeType type = CachedCodeType::kClassic;
+    bool loaded = false;  // Whether Lookup() found the code in the cache.
+
+    bool IsValid() const { return !path.empty(); }
+  };
+
+  // Returns nullptr if there is no --compile-cache-dir, or it cannot be
+  // created. The cache is shared by all threads.
+  static CompileCache* Get();
+
+  // Returns the cached code for `source`, or nullptr if there is none. Only
+  // code from files, i.e. with an absolute path or a file: URL as
+  // `filename`, is cached.
+  v8::ScriptCompiler::CachedData* Lookup(v8::Isolate* isolate,
+                                         v8::Local<v8::String> filename,
+                                         v8::Local<v8::String> source,
+                                         CachedCodeType type,
+                                         Entry* entry);
+
+  // Writes `data` to the entry in the background. Callers do this when the
+  // entry was not found, or V8 rejected it. Does nothing if either is empty.
+  void Save(Entry&& entry,
+            std::unique_ptr<v8::ScriptCompiler::CachedData> data);
+
+  // Like Lookup() and Save(), for other data that is derived from the
+  // source alone. LookupData() returns false if there is none.
+  bool LookupData(v8::Isolate* isolate,
+                  v8::Local<v8::String> filename,
+                  v8::Local<v8::String> source,
+                  CachedCodeType type,
+                  Entry* entry,
+                  std::string* data);
+  void SaveData(Entry&& entry, const char* data, size_t length);
+
+  // Like LookupData(), for compiled WebAssembly modules. These are keyed by
+  // a hash of the wire bytes alone, as they often do not come from a file.
+  bool LookupWasm(const uint8_t* wire_bytes,
+                  size_t length,
+                  Entry* entry,
+                  std::string* data);
+
+  CompileCache(const CompileCache&) = delete;
+  CompileCache& operator=(const CompileCache&) = delete;
+
+ private:
+  struct Write {
+    std::string path;
+    std::string contents;
+  };
+
+  explicit CompileCache(const std::string& dir);
+  static CompileCache* Create();
+
+  // Reads the entry at `entry->path` and checks it against the rest of
+  // `entry`, which Lookup*() fill in first.
+  bool ReadEntry(const std::string& name, Entry* entry, std::string* data);
+
+  static void WriterMain(void* data);
+  static void WriteEntry(const Write& write);
+
+  const std::string dir_;
+  const uint32_t version_tag_;
+
+  uv_thread_t writer_;
+  Mutex mutex_;
+  ConditionVariable wakeup_;
+  std::deque<Write> writes_;  // Protected by mutex_.
+};
+
+// Installed as the isolate's WasmStreamingCallback when there is a
+// --compile-cache-dir. It accepts ArrayBuffers and ArrayBufferViews as the
+// source of WebAssembly.compileStreaming() and instantiateStreaming(), and
+// serves them from the cache, or adds them to the cache once V8 has
+// finished compiling them with the top tier.
+void WasmStreamingCallback(const v8::FunctionCallbackInfo<v8::Value>& info);
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_COMPILE_CACHE_H_
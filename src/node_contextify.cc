@@ -24,10 +24,13 @@
 #include "base_object-inl.h"
 #include "memory_tracker-inl.h"
 #include "module_wrap.h"
+#include "node_compile_cache.h"
 #include "node_context_data.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_internals.h"
+#include "node_main_instance.h"
+#include "node_startup_profile.h"
 #include "node_watchdog.h"
 #include "util-inl.h"
 
@@ -142,40 +145,13 @@ void ContextifyContext::CleanupHook(void* arg) {
 }
 
 
-// This is an object that just keeps an internal pointer to this
-// ContextifyContext.  It's passed to the NamedPropertyHandler.  If we
-// pass the main JavaScript context object we're embedded in, then the
-// NamedPropertyHandler will store a reference to it forever and keep it
-// from getting gc'd.
-MaybeLocal<Object> ContextifyContext::CreateDataWrapper(Environment* env) {
-  Local<Object> wrapper;
-  if (!env->script_data_constructor_function()
-           ->NewInstance(env->context())
-           .ToLocal(&wrapper)) {
-    return MaybeLocal<Object>();
-  }
-
-  wrapper->SetAlignedPointerInInternalField(ContextifyContext::kSlot, this);
-  return wrapper;
-}
-
-MaybeLocal<Context> ContextifyContext::CreateV8Context(
-    Environment* env,
-    Local<Object> sandbox_obj,
-    const ContextOptions& options) {
-  EscapableHandleScope scope(env->isolate());
-  Local<FunctionTemplate> function_template =
-      FunctionTemplate::New(env->isolate());
-
-  function_template->SetClassName(sandbox_obj->GetConstructorName());
-
+// static
+Local<ObjectTemplate> ContextifyContext::CreateGlobalTemplate(
+    Isolate* isolate) {
+  Local<FunctionTemplate> function_template = FunctionTemplate::New(isolate);
   Local<ObjectTemplate> object_template =
       function_template->InstanceTemplate();
 
-  Local<Object> data_wrapper;
-  if (!CreateDataWrapper(env).ToLocal(&data_wrapper))
-    return MaybeLocal<Context>();
-
   NamedPropertyHandlerConfiguration config(
       PropertyGetterCallback,
       PropertySetterCallback,
@@ -183,7 +159,7 @@ MaybeLocal<Context> ContextifyContext::CreateV8Context(
       PropertyDeleterCallback,
       PropertyEnumeratorCallback,
       PropertyDefinerCallback,
-      data_wrapper,
+      {},
       PropertyHandlerFlags::kHasNoSideEffect);
 
   IndexedPropertyHandlerConfiguration indexed_config(
@@ -193,21 +169,52 @@ MaybeLocal<Context> ContextifyContext::CreateV8Context(
       IndexedPropertyDeleterCallback,
       PropertyEnumeratorCallback,
       IndexedPropertyDefinerCallback,
-      data_wrapper,
+      {},
       PropertyHandlerFlags::kHasNoSideEffect);
 
   object_template->SetHandler(config);
   object_template->SetHandler(indexed_config);
-  Local<Context> ctx = Context::New(
-      env->isolate(),
-      nullptr,  // extensions
-      object_template,
-      {},       // global object
-      {},       // deserialization callback
+  return object_template;
+}
+
+MaybeLocal<Context> ContextifyContext::CreateV8Context(
+    Environment* env,
+    Local<Object> sandbox_obj,
+    const ContextOptions& options) {
+  EscapableHandleScope scope(env->isolate());
+  MicrotaskQueue* queue =
       microtask_queue() ?
           microtask_queue().get() :
-          env->isolate()->GetCurrentContext()->GetMicrotaskQueue());
+          env->isolate()->GetCurrentContext()->GetMicrotaskQueue();
+
+  Local<Context> ctx;
+  if (env->isolate_data()->created_from_snapshot()) {
+    if (!Context::FromSnapshot(env->isolate(),
+                               NodeMainInstance::kNodeVMContextIndex,
+                               {},       // deserialization callback
+                               nullptr,  // extensions
+                               {},       // global object
+                               queue)
+             .ToLocal(&ctx)) {
+      return MaybeLocal<Context>();
+    }
+  } else {
+    if (env->contextify_global_template().IsEmpty()) {
+      env->set_contextify_global_template(
+          CreateGlobalTemplate(env->isolate()));
+    }
+    ctx = Context::New(
+        env->isolate(),
+        nullptr,  // extensions
+        env->contextify_global_template(),
+        {},       // global object
+        {},       // deserialization callback
+        queue);
+  }
   if (ctx.IsEmpty()) return MaybeLocal<Context>();
+  // The interceptors of the global object find this through the context.
+  ctx->SetAlignedPointerInEmbedderData(ContextEmbedderIndex::kContextifyContext,
+                                       this);
   // Only partially initialize the context - the primordials are left out
   // and only initialized when necessary.
   if (InitializeContextRuntime(ctx).IsNothing()) {
@@ -251,13 +258,6 @@ MaybeLocal<Context> ContextifyContext::CreateV8Context(
 
 
 void ContextifyContext::Init(Environment* env, Local<Object> target) {
-  Local<FunctionTemplate> function_template =
-      FunctionTemplate::New(env->isolate());
-  function_template->InstanceTemplate()->SetInternalFieldCount(
-      ContextifyContext::kInternalFieldCount);
-  env->set_script_data_constructor_function(
-      function_template->GetFunction(env->context()).ToLocalChecked());
-
   env->SetMethod(target, "makeContext", MakeContext);
   env->SetMethod(target, "isContext", IsContext);
   env->SetMethod(target, "compileFunction", CompileFunction);
@@ -268,6 +268,17 @@ void ContextifyContext::RegisterExternalReferences(
   registry->Register(MakeContext);
   registry->Register(IsContext);
   registry->Register(CompileFunction);
+  registry->Register(PropertyGetterCallback);
+  registry->Register(PropertySetterCallback);
+  registry->Register(PropertyDescriptorCallback);
+  registry->Register(PropertyDeleterCallback);
+  registry->Register(PropertyEnumeratorCallback);
+  registry->Register(PropertyDefinerCallback);
+  registry->Register(IndexedPropertyGetterCallback);
+  registry->Register(IndexedPropertySetterCallback);
+  registry->Register(IndexedPropertyDescriptorCallback);
+  registry->Register(IndexedPropertyDeleterCallback);
+  registry->Register(IndexedPropertyDefinerCallback);
 }
 
 // makeContext(sandbox, name, origin, strings, wasm);
@@ -365,10 +376,15 @@ ContextifyContext* ContextifyContext::ContextFromContextifiedSandbox(
 // static
 template <typename T>
 ContextifyContext* ContextifyContext::Get(const PropertyCallbackInfo<T>& args) {
-  Local<Value> data = args.Data();
+  Local<Context> context;
+  if (!args.Holder()->GetCreationContext().ToLocal(&context) ||
+      context->GetNumberOfEmbedderDataFields() <=
+          ContextEmbedderIndex::kContextifyContext) {
+    return nullptr;
+  }
   return static_cast<ContextifyContext*>(
-      data.As<Object>()->GetAlignedPointerFromInternalField(
-          ContextifyContext::kSlot));
+      context->GetAlignedPointerFromEmbedderData(
+          ContextEmbedderIndex::kContextifyContext));
 }
 
 // static
@@ -378,7 +394,7 @@ void ContextifyContext::PropertyGetterCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Local<Context> context = ctx->context();
@@ -407,7 +423,7 @@ void ContextifyContext::PropertySetterCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Local<Context> context = ctx->context();
@@ -468,7 +484,7 @@ void ContextifyContext::PropertyDescriptorCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Local<Context> context = ctx->context();
@@ -491,7 +507,7 @@ void ContextifyContext::PropertyDefinerCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Local<Context> context = ctx->context();
@@ -552,7 +568,7 @@ void ContextifyContext::PropertyDeleterCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Maybe<bool> success = ctx->sandbox()->Delete(ctx->context(), property);
@@ -571,7 +587,7 @@ void ContextifyContext::PropertyEnumeratorCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Local<Array> properties;
@@ -589,7 +605,7 @@ void ContextifyContext::IndexedPropertyGetterCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   ContextifyContext::PropertyGetterCallback(
@@ -604,7 +620,7 @@ void ContextifyContext::IndexedPropertySetterCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   ContextifyContext::PropertySetterCallback(
@@ -618,7 +634,7 @@ void ContextifyContext::IndexedPropertyDescriptorCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   ContextifyContext::PropertyDescriptorCallback(
@@ -633,7 +649,7 @@ void ContextifyContext::IndexedPropertyDefinerCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   ContextifyContext::PropertyDefinerCallback(
@@ -647,7 +663,7 @@ void ContextifyContext::IndexedPropertyDeleterCallback(
   ContextifyContext* ctx = ContextifyContext::Get(args);
 
   // Still initializing
-  if (ctx->context_.IsEmpty())
+  if (ctx == nullptr || ctx->context_.IsEmpty())
     return;
 
   Maybe<bool> success = ctx->sandbox()->Delete(ctx->context(), index);
@@ -755,6 +771,14 @@ void ContextifyScript::New(const FunctionCallbackInfo<Value>& args) {
         data + cached_data_buf->ByteOffset(), cached_data_buf->ByteLength());
   }
 
+  CompileCache* compile_cache = nullptr;
+  CompileCache::Entry cache_entry;
+  if (cached_data_buf.IsEmpty() &&
+      (compile_cache = CompileCache::Get()) != nullptr) {
+    cached_data = compile_cache->Lookup(
+        isolate, filename, code, CachedCodeType::kClassic, &cache_entry);
+  }
+
   Local<PrimitiveArray> host_defined_options =
       PrimitiveArray::New(isolate, loader::HostDefinedOptions::kLength);
   host_defined_options->Set(isolate, loader::HostDefinedOptions::kType,
@@ -802,8 +826,19 @@ void ContextifyScript::New(const FunctionCallbackInfo<Value>& args) {
   }
   contextify_script->script_.Reset(isolate, v8_script.ToLocalChecked());
 
+  if (cache_entry.IsValid()) {
+    if (StartupProfile* profile = StartupProfile::GetRecording(isolate))
+      profile->AddScript(cache_entry, v8_script.ToLocalChecked());
+    if (!cache_entry.loaded || source.GetCachedData()->rejected) {
+      compile_cache->Save(std::move(cache_entry),
+                          std::unique_ptr<ScriptCompiler::CachedData>(
+                              ScriptCompiler::CreateCodeCache(
+                                  v8_script.ToLocalChecked())));
+    }
+  }
+
   Local<Context> env_context = env->context();
-  if (compile_options == ScriptCompiler::kConsumeCodeCache) {
+  if (!cached_data_buf.IsEmpty()) {
     args.This()->Set(
         env_context,
         env->cached_data_rejected_string(),
@@ -1141,14 +1176,6 @@ void ContextifyContext::CompileFunction(
                       false,             // is ES Module
                       host_defined_options);
 
-  ScriptCompiler::Source source(code, origin, cached_data);
-  ScriptCompiler::CompileOptions options;
-  if (source.GetCachedData() == nullptr) {
-    options = ScriptCompiler::kNoCompileOptions;
-  } else {
-    options = ScriptCompiler::kConsumeCodeCache;
-  }
-
   TryCatchScope try_catch(env);
   Context::Scope scope(parsing_context);
 
@@ -1174,6 +1201,35 @@ void ContextifyContext::CompileFunction(
     }
   }
 
+  // Without cached data from the caller, read it from the compile cache, if
+  // there is one. The parameters are part of what is compiled, so they are
+  // hashed in too.
+  CompileCache* compile_cache = nullptr;
+  CompileCache::Entry cache_entry;
+  if (cached_data_buf.IsEmpty() &&
+      (compile_cache = CompileCache::Get()) != nullptr) {
+    Local<String> cache_source = code;
+    for (auto it = params.rbegin(); it != params.rend(); ++it) {
+      cache_source = String::Concat(
+          isolate,
+          String::Concat(isolate, *it, FIXED_ONE_BYTE_STRING(isolate, ",")),
+          cache_source);
+    }
+    cached_data = compile_cache->Lookup(isolate,
+                                        filename,
+                                        cache_source,
+                                        CachedCodeType::kFunction,
+                                        &cache_entry);
+  }
+
+  ScriptCompiler::Source source(code, origin, cached_data);
+  ScriptCompiler::CompileOptions options;
+  if (source.GetCachedData() == nullptr) {
+    options = ScriptCompiler::kNoCompileOptions;
+  } else {
+    options = ScriptCompiler::kConsumeCodeCache;
+  }
+
   Local<ScriptOrModule> script;
   MaybeLocal<Function> maybe_fn = ScriptCompiler::CompileFunctionInContext(
       parsing_context, &source, params.size(), params.data(),
@@ -1189,6 +1245,16 @@ void ContextifyContext::CompileFunction(
     return;
   }
 
+  if (cache_entry.IsValid()) {
+    if (StartupProfile* profile = StartupProfile::GetRecording(isolate))
+      profile->AddFunction(cache_entry, fn);
+    if (!cache_entry.loaded || source.GetCachedData()->rejected) {
+      compile_cache->Save(std::move(cache_entry),
+                          std::unique_ptr<ScriptCompiler::CachedData>(
+                              ScriptCompiler::CreateCodeCacheForFunction(fn)));
+    }
+  }
+
   Local<Object> cache_key;
   if (!env->compiled_fn_entry_template()->NewInstance(
            context).ToLocal(&cache_key)) {
@@ -43,14 +43,18 @@ struct ContextOptions {
 
 class ContextifyContext {
  public:
-  enum InternalFields { kSlot, kInternalFieldCount };
   ContextifyContext(Environment* env,
                     v8::Local<v8::Object> sandbox_obj,
                     const ContextOptions& options);
   ~ContextifyContext();
   static void CleanupHook(void* arg);
 
-  v8::MaybeLocal<v8::Object> CreateDataWrapper(Environment* env);
+  // The template for the global objects of contextified contexts. Their
+  // interceptors find the ContextifyContext through the embedder data of
+  // the context, so that one template, or a context in the snapshot, can
+  // serve all of them.
+  static v8::Local<v8::ObjectTemplate> CreateGlobalTemplate(
+      v8::Isolate* isolate);
   v8::MaybeLocal<v8::Context> CreateV8Context(Environment* env,
                                               v8::Local<v8::Object> sandbox_obj,
                                               const ContextOptions& options);
@@ -0,0 +1,204 @@
+#include "node_continuous_profiler.h"
+#include "debug_utils-inl.h"
+#include "diagnosticfilename-inl.h"
+#include "env-inl.h"
+#include "node_file.h"
+#include "node_internals.h"
+#include "node_options.h"
+#include "node_pprof.h"
+#include "util-inl.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace node {
+namespace profiler {
+
+using v8::CpuProfile;
+using v8::CpuProfileNode;
+using v8::CpuProfiler;
+using v8::CpuProfilingOptions;
+using v8::HandleScope;
+using v8::Local;
+using v8::String;
+
+namespace {
+
+// Adds the hits of a V8 call tree to `builder`.
+void AddTree(PprofBuilder* builder,
+             const CpuProfileNode* root,
+             uint64_t interval_ns) {
+  auto function = [&](const CpuProfileNode* node) {
+    return builder->Function(node->GetFunctionNameStr(),
+                             node->GetScriptResourceNameStr(),
+                             node->GetScriptId(),
+                             node->GetLineNumber(),
+                             node->GetColumnNumber());
+  };
+  // The locations of the callers, outermost first.
+  std::vector<uint64_t> callers;
+  auto add_sample = [&](uint64_t leaf, uint64_t count) {
+    std::vector<uint64_t> stack = {leaf};
+    stack.insert(stack.end(), callers.rbegin(), callers.rend());
+    builder->AddSample(stack, {count, count * interval_ns});
+  };
+
+  // Walked iteratively, since JavaScript stacks can be very deep.
+  std::vector<std::pair<const CpuProfileNode*, int>> path = {{root, 0}};
+  while (!path.empty()) {
+    const CpuProfileNode* node = path.back().first;
+    if (path.back().second == node->GetChildrenCount()) {
+      path.pop_back();
+      if (!callers.empty()) callers.pop_back();
+      continue;
+    }
+    const CpuProfileNode* child = node->GetChild(path.back().second++);
+    uint64_t function_id = function(child);
+
+    // With kLeafNodeLineNumbers, the hits of a node are split by the line
+    // that was running, so each of these becomes a sample of its own.
+    uint64_t hits = child->GetHitCount();
+    unsigned int line_count = hits > 0 ? child->GetHitLineCount() : 0;
+    std::vector<CpuProfileNode::LineTick> ticks(line_count);
+    if (line_count > 0 && child->GetLineTicks(ticks.data(), line_count)) {
+      for (const CpuProfileNode::LineTick& tick : ticks) {
+        uint64_t count = std::min<uint64_t>(tick.hit_count, hits);
+        if (count == 0) continue;
+        add_sample(builder->Location(function_id, tick.line), count);
+        hits -= count;
+      }
+    }
+    if (hits > 0)
+      add_sample(builder->Location(function_id, child->GetLineNumber()), hits);
+
+    callers.push_back(builder->Location(function_id, child->GetLineNumber()));
+    path.emplace_back(child, 0);
+  }
+}
+
+std::string GetDirectory(Environment* env) {
+  const EnvironmentOptions* options = env->options().get();
+  if (!options->cpu_prof_continuous_dir.empty())
+    return options->cpu_prof_continuous_dir;
+  if (!options->diagnostic_dir.empty()) return options->diagnostic_dir;
+  return env->GetCwd();
+}
+
+}  // anonymous namespace
+
+ContinuousCpuProfiler::ContinuousCpuProfiler(Environment* env)
+    : env_(env),
+      profiler_(CpuProfiler::New(env->isolate())),
+      directory_(GetDirectory(env)),
+      interval_us_(env->options()->cpu_prof_continuous_interval) {
+  profiler_->SetSamplingInterval(static_cast<int>(interval_us_));
+  CHECK_EQ(uv_timer_init(env->event_loop(), &timer_), 0);
+  uv_unref(reinterpret_cast<uv_handle_t*>(&timer_));
+}
+
+ContinuousCpuProfiler::~ContinuousCpuProfiler() {
+  profiler_->Dispose();
+}
+
+void ContinuousCpuProfiler::Start(Environment* env) {
+  ContinuousCpuProfiler* profiler = new ContinuousCpuProfiler(env);
+  // process.exit() only runs the AtExit hooks, so the last window is
+  // written from there.
+  AtExit(env, [](void* data) {
+    static_cast<ContinuousCpuProfiler*>(data)->EndWindow(false);
+  }, profiler);
+  env->AddCleanupHook([](void* data) {
+    ContinuousCpuProfiler* profiler = static_cast<ContinuousCpuProfiler*>(data);
+    profiler->EndWindow(false);
+    profiler->env_->CloseHandle(&profiler->timer_, [](uv_timer_t* timer) {
+      ContinuousCpuProfiler* profiler =
+          ContainerOf(&ContinuousCpuProfiler::timer_, timer);
+      delete profiler;
+    });
+  }, profiler);
+  profiler->StartWindow();
+}
+
+static Local<String> WindowTitle(v8::Isolate* isolate, uint64_t window) {
+  std::string title = "node:continuous:" + std::to_string(window);
+  return OneByteString(isolate, title.c_str(), title.size());
+}
+
+void ContinuousCpuProfiler::StartWindow() {
+  HandleScope handle_scope(env_->isolate());
+  // No individual samples, only the hit counts in the tree.
+  profiler_->StartProfiling(
+      WindowTitle(env_->isolate(), window_),
+      CpuProfilingOptions(v8::kLeafNodeLineNumbers, 0));
+  window_start_ns_ =
+      static_cast<uint64_t>(GetCurrentTimeInMicroseconds() * 1000);
+  uint64_t window_ms = env_->options()->cpu_prof_continuous_window * 1000;
+  uv_timer_start(&timer_, OnWindowEnd, window_ms, 0);
+}
+
+void ContinuousCpuProfiler::EndWindow(bool start_next) {
+  if (stopped_) return;
+  HandleScope handle_scope(env_->isolate());
+  Local<String> title = WindowTitle(env_->isolate(), window_);
+  uint64_t start_time_ns = window_start_ns_;
+  if (start_next) {
+    window_++;
+    StartWindow();
+  } else {
+    stopped_ = true;
+    uv_timer_stop(&timer_);
+  }
+  CpuProfile* profile = profiler_->StopProfiling(title);
+  if (profile == nullptr) return;
+  WriteProfile(profile, start_time_ns);
+  profile->Delete();
+}
+
+// static
+void ContinuousCpuProfiler::OnWindowEnd(uv_timer_t* timer) {
+  ContinuousCpuProfiler* profiler =
+      ContainerOf(&ContinuousCpuProfiler::timer_, timer);
+  profiler->EndWindow(true);
+}
+
+void ContinuousCpuProfiler::WriteProfile(CpuProfile* profile,
+                                         uint64_t start_time_ns) {
+  uint64_t interval_ns = interval_us_ * 1000;
+  PprofBuilder builder;
+  builder.AddSampleType("samples", "count");
+  builder.AddSampleType("cpu", "nanoseconds");
+  builder.SetPeriod("cpu", "nanoseconds", interval_ns);
+  AddTree(&builder, profile->GetTopDownRoot(), interval_ns);
+  uint64_t duration_us = profile->GetEndTime() - profile->GetStartTime();
+  std::string out = builder.Finish(start_time_ns, duration_us * 1000);
+  if (out.empty()) {
+    fprintf(stderr, "Failed to compress CPU profile\n");
+    return;
+  }
+
+  fs::FSReqWrapSync req_wrap_sync;
+  int ret = fs::MKDirpSync(nullptr, &req_wrap_sync.req, directory_, 0777,
+                           nullptr);
+  if (ret < 0 && ret != UV_EEXIST) {
+    char err_buf[128];
+    uv_err_name_r(ret, err_buf, sizeof(err_buf));
+    fprintf(stderr, "%s: Failed to create CPU profile directory %s\n",
+            err_buf, directory_.c_str());
+    return;
+  }
+
+  DiagnosticFilename filename(env_, "CPU", "pb.gz");
+  std::string path = directory_ + kPathSeparator + *filename;
+  ret = WriteFileSync(path.c_str(), uv_buf_init(&out[0], out.size()));
+  if (ret != 0) {
+    char err_buf[128];
+    uv_err_name_r(ret, err_buf, sizeof(err_buf));
+    fprintf(stderr, "%s: Failed to write file %s\n", err_buf, path.c_str());
+    return;
+  }
+  Debug(env_, DebugCategory::INSPECTOR_PROFILER,
+        "Written CPU profile to %s\n", path);
+}
+
+}  // namespace profiler
+}  // namespace node
@@ -0,0 +1,62 @@
+#ifndef SRC_NODE_CONTINUOUS_PROFILER_H_
+#define SRC_NODE_CONTINUOUS_PROFILER_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "uv.h"
+#include "v8-profiler.h"
+
+#include <string>
+
+namespace node {
+
+class Environment;
+
+namespace profiler {
+
+// Always-on CPU profiling, with --cpu-prof-continuous.
+//
+// Unlike --cpu-prof, which goes through the inspector protocol and writes
+// one .cpuprofile JSON file at exit, this drives v8::CpuProfiler directly
+// and cuts the run into windows of --cpu-prof-continuous-window seconds.
+// At the end of each window, and at exit, the window's profile is written
+// in pprof's protobuf format to --cpu-prof-continuous-dir, where a
+// continuous-profiling agent can pick it up. The next window is started
+// before the last one is stopped, so no samples fall between them.
+//
+// Only the aggregated call tree is kept, not the individual samples, and
+// the default sampling interval is 10ms, so that running this all the time
+// stays cheap.
+class ContinuousCpuProfiler {
+ public:
+  static void Start(Environment* env);
+
+  ContinuousCpuProfiler(const ContinuousCpuProfiler&) = delete;
+  ContinuousCpuProfiler& operator=(const ContinuousCpuProfiler&) = delete;
+
+ private:
+  explicit ContinuousCpuProfiler(Environment* env);
+  ~ContinuousCpuProfiler();
+
+  void StartWindow();
+  void EndWindow(bool start_next);
+  void WriteProfile(v8::CpuProfile* profile, uint64_t start_time_ns);
+
+  static void OnWindowEnd(uv_timer_t* timer);
+
+  Environment* const env_;
+  v8::CpuProfiler* const profiler_;
+  const std::string directory_;
+  const uint64_t interval_us_;
+  uv_timer_t timer_;
+  uint64_t window_ = 0;
+  uint64_t window_start_ns_ = 0;
+  bool stopped_ = false;
+};
+
+}  // namespace profiler
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_CONTINUOUS_PROFILER_H_
@@ -5,22 +5,47 @@
 
 #include "node_file.h"
 
+#include <deque>
+#include <string>
+#include <vector>
+
 namespace node {
 
 namespace fs_dir {
 
+// A batch of entries as returned by DirHandle::ReadPacked(): the names,
+// each terminated by a NUL byte, in one buffer and their uv_dirent_type_t
+// in a parallel array.
+struct PackedDirents {
+  std::string names;
+  std::vector<uint8_t> types;
+};
+
 // Needed to propagate `uv_dir_t`.
 class DirHandle : public AsyncWrap {
  public:
-  static DirHandle* New(Environment* env, uv_dir_t* dir);
+  static DirHandle* New(Environment* env, uv_dir_t* dir, std::string&& path);
   ~DirHandle() override;
 
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Read(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Reads up to `bufferSize` entries into a PackedDirents, without creating
+  // a JS value per entry. With `recursive`, subdirectories are walked as
+  // well, breadth first, and names are relative to the opened directory.
+  // A handle must be read either through read() or through readPacked().
+  static void ReadPacked(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Close(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   inline uv_dir_t* dir() { return dir_; }
 
+  // Fills `out` with up to `limit` entries. Returns 0 or a libuv error code,
+  // in which case `*syscall` names the operation that failed. Runs on the
+  // threadpool for async reads.
+  int ReadPackedBatch(size_t limit,
+                      bool recursive,
+                      PackedDirents* out,
+                      const char** syscall);
+
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(DirHandle)
   SET_SELF_SIZE(DirHandle)
@@ -31,16 +56,59 @@ class DirHandle : public AsyncWrap {
   DirHandle& operator=(const DirHandle&&) = delete;
 
  private:
-  DirHandle(Environment* env, v8::Local<v8::Object> obj, uv_dir_t* dir);
+  DirHandle(Environment* env,
+            v8::Local<v8::Object> obj,
+            uv_dir_t* dir,
+            std::string&& path);
 
   // Synchronous close that emits a warning
   void GCClose();
+  // Closes the subdirectory a recursive readPacked() is in, if any.
+  void CloseWalk();
+
+  // Reads the next entries of `dir` into `out`, returning how many were
+  // read or a libuv error code.
+  int ReadEntries(uv_dir_t* dir,
+                  const std::string& prefix,
+                  size_t limit,
+                  bool recursive,
+                  PackedDirents* out);
 
   uv_dir_t* dir_;
   // Multiple entries are read through a single libuv call.
   std::vector<uv_dirent_t> dirents_;
   bool closing_ = false;
   bool closed_ = false;
+
+  // State of a recursive readPacked(). The root directory is read first,
+  // then the subdirectories in `pending_dirs_`, one at a time.
+  std::string path_;
+  bool root_done_ = false;
+  uv_dir_t* walk_dir_ = nullptr;
+  std::string walk_prefix_;
+  std::deque<std::string> pending_dirs_;
+};
+
+// Runs DirHandle::ReadPackedBatch() on the threadpool and completes
+// `req_wrap` with the result.
+class DirReadPackedWork final : public ThreadPoolWork {
+ public:
+  DirReadPackedWork(fs::FSReqBase* req_wrap,
+                    DirHandle* handle,
+                    size_t limit,
+                    bool recursive);
+
+  void DoThreadPoolWork() override;
+  void AfterThreadPoolWork(int status) override;
+
+ private:
+  BaseObjectPtr<fs::FSReqBase> req_wrap_;
+  BaseObjectPtr<DirHandle> handle_;
+  size_t limit_;
+  bool recursive_;
+  PackedDirents result_;
+  int error_ = 0;
+  const char* syscall_ = nullptr;
 };
 
 }  // namespace fs_dir
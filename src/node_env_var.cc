@@ -7,6 +7,9 @@
 
 #include <time.h>  // tzset(), _tzset()
 
+#include <atomic>
+#include <string_view>
+
 namespace node {
 using v8::Array;
 using v8::Boolean;
@@ -64,6 +67,41 @@ class MapKVStore final : public KVStore {
   std::unordered_map<std::string, std::string> map_;
 };
 
+class SnapshotEnvStore final : public KVStore {
+ public:
+  SnapshotEnvStore();
+
+  MaybeLocal<String> Get(Isolate* isolate, Local<String> key) const override;
+  Maybe<std::string> Get(const char* key) const override;
+  void Set(Isolate* isolate, Local<String> key, Local<String> value) override;
+  int32_t Query(Isolate* isolate, Local<String> key) const override;
+  int32_t Query(const char* key) const override;
+  void Delete(Isolate* isolate, Local<String> key) override;
+  Local<Array> Enumerate(Isolate* isolate) const override;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string value;
+    uint64_t id;
+    // Changes with every write, so that cached values can be told apart.
+    uint64_t version;
+    bool present;
+  };
+
+  // Both run without `lock_`.
+  const Entry* Find(std::string_view key) const;
+  Entry* FindOrInsert(std::string_view key);
+  static uint64_t NextVersion();
+
+  mutable RwLock lock_;
+  // Entries are never removed, only marked as absent, so pointers to them
+  // stay valid. The keys point into the entries.
+  std::unordered_map<std::string_view, std::unique_ptr<Entry>> entries_;
+  // In order of insertion, for Enumerate().
+  std::vector<Entry*> order_;
+};
+
 namespace per_process {
 Mutex env_var_mutex;
 std::shared_ptr<KVStore> system_environment = std::make_shared<RealEnvStore>();
@@ -289,6 +327,168 @@ std::shared_ptr<KVStore> KVStore::CreateMapKVStore() {
   return std::make_shared<MapKVStore>();
 }
 
+SnapshotEnvStore::SnapshotEnvStore() {
+  Mutex::ScopedLock lock(per_process::env_var_mutex);
+  uv_env_item_t* items;
+  int count;
+  CHECK_EQ(uv_os_environ(&items, &count), 0);
+  auto cleanup = OnScopeLeave([&]() { uv_os_free_environ(items, count); });
+  entries_.reserve(count);
+  for (int i = 0; i < count; i++) {
+    Entry* entry = FindOrInsert(items[i].name);
+    entry->value = items[i].value;
+    entry->present = true;
+  }
+}
+
+uint64_t SnapshotEnvStore::NextVersion() {
+  // Unique across all stores, as Environments key their caches by id.
+  static std::atomic<uint64_t> next_version{1};
+  return next_version++;
+}
+
+const SnapshotEnvStore::Entry* SnapshotEnvStore::Find(
+    std::string_view key) const {
+  auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : it->second.get();
+}
+
+SnapshotEnvStore::Entry* SnapshotEnvStore::FindOrInsert(std::string_view key) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) return it->second.get();
+  auto entry = std::make_unique<Entry>();
+  entry->key = std::string(key);
+  entry->id = NextVersion();
+  entry->version = NextVersion();
+  entry->present = false;
+  Entry* result = entry.get();
+  entries_.emplace(std::string_view(result->key), std::move(entry));
+  order_.push_back(result);
+  return result;
+}
+
+Maybe<std::string> SnapshotEnvStore::Get(const char* key) const {
+  RwLock::ScopedReadLock lock(lock_);
+  const Entry* entry = Find(key);
+  if (entry == nullptr || !entry->present) return Nothing<std::string>();
+  return Just(entry->value);
+}
+
+MaybeLocal<String> SnapshotEnvStore::Get(Isolate* isolate,
+                                         Local<String> property) const {
+  node::Utf8Value key(isolate, property);
+  Environment* env = Environment::GetCurrent(isolate);
+  RwLock::ScopedReadLock lock(lock_);
+  const Entry* entry = Find(std::string_view(*key, key.length()));
+  if (entry == nullptr || !entry->present) return MaybeLocal<String>();
+
+  Environment::EnvVarCacheEntry* cached = nullptr;
+  if (env != nullptr) {
+    cached = &(*env->env_var_cache())[entry->id];
+    if (!cached->value.IsEmpty() && cached->version == entry->version)
+      return PersistentToLocal::Strong(cached->value);
+  }
+  Local<String> value;
+  if (!String::NewFromUtf8(isolate,
+                           entry->value.data(),
+                           NewStringType::kNormal,
+                           entry->value.size()).ToLocal(&value)) {
+    return MaybeLocal<String>();
+  }
+  if (cached != nullptr) {
+    cached->version = entry->version;
+    cached->value.Reset(isolate, value);
+  }
+  return value;
+}
+
+void SnapshotEnvStore::Set(Isolate* isolate,
+                           Local<String> property,
+                           Local<String> value) {
+  node::Utf8Value key(isolate, property);
+  node::Utf8Value val(isolate, value);
+
+#ifdef _WIN32
+  if (key.length() > 0 && key[0] == '=') return;
+#endif
+  {
+    RwLock::ScopedWriteLock lock(lock_);
+    Entry* entry = FindOrInsert(std::string_view(*key, key.length()));
+    entry->value = std::string(*val, val.length());
+    entry->present = true;
+    entry->version = NextVersion();
+  }
+  // Child processes and native code should see the change as well.
+  Mutex::ScopedLock lock(per_process::env_var_mutex);
+  uv_os_setenv(*key, *val);
+  DateTimeConfigurationChangeNotification(isolate, key, *val);
+}
+
+int32_t SnapshotEnvStore::Query(const char* key) const {
+  {
+    RwLock::ScopedReadLock lock(lock_);
+    const Entry* entry = Find(key);
+    if (entry == nullptr || !entry->present) return -1;
+  }
+
+#ifdef _WIN32
+  if (key[0] == '=') {
+    return static_cast<int32_t>(ReadOnly) |
+           static_cast<int32_t>(DontDelete) |
+           static_cast<int32_t>(DontEnum);
+  }
+#endif
+
+  return 0;
+}
+
+int32_t SnapshotEnvStore::Query(Isolate* isolate,
+                                Local<String> property) const {
+  node::Utf8Value key(isolate, property);
+  return Query(*key);
+}
+
+void SnapshotEnvStore::Delete(Isolate* isolate, Local<String> property) {
+  node::Utf8Value key(isolate, property);
+  {
+    RwLock::ScopedWriteLock lock(lock_);
+    auto it = entries_.find(std::string_view(*key, key.length()));
+    if (it != entries_.end()) {
+      it->second->present = false;
+      it->second->value.clear();
+      it->second->version = NextVersion();
+    }
+  }
+  Mutex::ScopedLock lock(per_process::env_var_mutex);
+  uv_os_unsetenv(*key);
+  DateTimeConfigurationChangeNotification(isolate, key);
+}
+
+Local<Array> SnapshotEnvStore::Enumerate(Isolate* isolate) const {
+  RwLock::ScopedReadLock lock(lock_);
+  std::vector<Local<Value>> values;
+  values.reserve(order_.size());
+  for (const Entry* entry : order_) {
+    if (!entry->present) continue;
+#ifdef _WIN32
+    // If the key starts with '=' it is a hidden environment variable.
+    if (entry->key[0] == '=') continue;
+#endif
+    MaybeLocal<String> str = String::NewFromUtf8(
+        isolate, entry->key.data(), NewStringType::kNormal, entry->key.size());
+    if (str.IsEmpty()) {
+      isolate->ThrowException(ERR_STRING_TOO_LONG(isolate));
+      return Local<Array>();
+    }
+    values.push_back(str.ToLocalChecked());
+  }
+  return Array::New(isolate, values.data(), values.size());
+}
+
+std::shared_ptr<KVStore> KVStore::CreateSnapshotKVStore() {
+  return std::make_shared<SnapshotEnvStore>();
+}
+
 Maybe<bool> KVStore::AssignFromObject(Local<Context> context,
                                       Local<Object> entries) {
   Isolate* isolate = context->GetIsolate();
@@ -5,9 +5,11 @@
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_internals.h"
+#include "node_log_sink.h"
 #include "node_process-inl.h"
 #include "node_report.h"
 #include "node_v8_platform-inl.h"
+#include "stream_wrap.h"
 #include "util-inl.h"
 
 namespace node {
@@ -428,17 +430,22 @@ static void ReportFatalException(Environment* env,
 }
 
 void OnFatalError(const char* location, const char* message) {
-  if (location) {
-    FPrintF(stderr, "FATAL ERROR: %s %s\n", location, message);
-  } else {
-    FPrintF(stderr, "FATAL ERROR: %s\n", message);
-  }
-
   Isolate* isolate = Isolate::TryGetCurrent();
   Environment* env = nullptr;
   if (isolate != nullptr) {
     env = Environment::GetCurrent(isolate);
   }
+  // Output that was logged before the crash should precede its report.
+  if (env != nullptr)
+    LibuvStreamWrap::FlushCoalescedWritesSync(env);
+  // The process may be in no state to wait for long.
+  log_sink::LogWriter::FlushAll(1000);
+
+  if (location) {
+    FPrintF(stderr, "FATAL ERROR: %s %s\n", location, message);
+  } else {
+    FPrintF(stderr, "FATAL ERROR: %s\n", message);
+  }
   bool report_on_fatalerror;
   {
     Mutex::ScopedLock lock(node::per_process::cli_options_mutex);
@@ -84,6 +84,7 @@ void OnFatalError(const char* location, const char* message);
   V(ERR_VM_MODULE_LINK_FAILURE, Error)                                         \
   V(ERR_WASI_NOT_STARTED, Error)                                               \
   V(ERR_WORKER_INIT_FAILED, Error)                                             \
+  V(ERR_ZLIB_INITIALIZATION_FAILED, Error)                                     \
   V(ERR_PROTO_ACCESS, Error)
 
 #define V(code, type)                                                          \
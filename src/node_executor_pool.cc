@@ -0,0 +1,174 @@
+#include "node_executor_pool.h"
+#include "util-inl.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace node {
+
+namespace {
+
+// The pools of the process by name. They are never destroyed, because
+// pools may still be released during process teardown.
+Mutex* pools_mutex = new Mutex();
+auto* pools =
+    new std::unordered_map<std::string, std::weak_ptr<ExecutorPool>>();
+
+void SetCurrentThreadPriority(ExecutorPool::Priority priority) {
+#ifdef __linux__
+  int nice = 0;
+  switch (priority) {
+    case ExecutorPool::Priority::kNormal: return;
+    case ExecutorPool::Priority::kLow: nice = 10; break;
+    case ExecutorPool::Priority::kBackground: nice = 19; break;
+    case ExecutorPool::Priority::kHigh: nice = -5; break;
+  }
+  // On Linux, the nice value belongs to the thread rather than the process.
+  USE(setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice));
+#endif
+}
+
+}  // anonymous namespace
+
+std::shared_ptr<ExecutorPool> ExecutorPool::GetOrCreate(
+    const std::string& name, size_t threads, Priority priority) {
+  Mutex::ScopedLock lock(*pools_mutex);
+  auto it = pools->find(name);
+  if (it != pools->end()) {
+    if (std::shared_ptr<ExecutorPool> pool = it->second.lock())
+      return pool;
+  }
+
+  std::shared_ptr<ExecutorPool> pool(new ExecutorPool(name, priority));
+  if (!pool->Start(std::min(std::max<size_t>(threads, 1), kMaxThreads))) {
+    // The destructor takes the lock, too.
+    Mutex::ScopedUnlock unlock(lock);
+    pool.reset();
+    return nullptr;
+  }
+  (*pools)[name] = pool;
+  return pool;
+}
+
+void ExecutorPool::ForEach(
+    const std::function<void(const ExecutorPool&)>& callback) {
+  std::vector<std::shared_ptr<ExecutorPool>> list;
+  {
+    Mutex::ScopedLock lock(*pools_mutex);
+    for (const auto& entry : *pools) {
+      if (std::shared_ptr<ExecutorPool> pool = entry.second.lock())
+        list.push_back(std::move(pool));
+    }
+  }
+  for (const std::shared_ptr<ExecutorPool>& pool : list)
+    callback(*pool);
+}
+
+ExecutorPool::ExecutorPool(const std::string& name, Priority priority)
+    : name_(name), priority_(priority) {}
+
+ExecutorPool::~ExecutorPool() {
+  {
+    Mutex::ScopedLock lock(mutex_);
+    stopping_ = true;
+    cond_.Broadcast(lock);
+  }
+  for (uv_thread_t& thread : threads_)
+    CHECK_EQ(uv_thread_join(&thread), 0);
+
+  Mutex::ScopedLock lock(*pools_mutex);
+  auto it = pools->find(name_);
+  // A pool of the same name may have been started in the meantime.
+  if (it != pools->end() && it->second.expired())
+    pools->erase(it);
+}
+
+bool ExecutorPool::Start(size_t threads) {
+  threads_.reserve(threads);
+  for (size_t i = 0; i < threads; i++) {
+    uv_thread_t thread;
+    auto run = [](void* data) { static_cast<ExecutorPool*>(data)->Run(); };
+    if (uv_thread_create(&thread, run, this) != 0) return false;
+    threads_.push_back(thread);
+  }
+  return true;
+}
+
+void ExecutorPool::Run() {
+  SetCurrentThreadPriority(priority_);
+  Mutex::ScopedLock lock(mutex_);
+  for (;;) {
+    while (queue_.empty() && !stopping_)
+      cond_.Wait(lock);
+    if (queue_.empty()) return;
+
+    Task* task = queue_.front();
+    queue_.pop_front();
+    const uint64_t wait = uv_hrtime() - task->queued_at_;
+    total_queue_wait_ += wait;
+    max_queue_wait_ = std::max(max_queue_wait_, wait);
+    running_++;
+    {
+      Mutex::ScopedUnlock unlock(lock);
+      task->Run();
+    }
+    running_--;
+    completed_++;
+    // The task may be gone as soon as this returns.
+    task->status_ = 0;
+    CHECK_EQ(uv_async_send(&task->async_), 0);
+  }
+}
+
+void ExecutorPool::Schedule(uv_loop_t* loop, Task* task) {
+  CHECK(!task->pool_);
+  task->pool_ = shared_from_this();
+  CHECK_EQ(uv_async_init(loop, &task->async_, [](uv_async_t* handle) {
+    uv_close(reinterpret_cast<uv_handle_t*>(handle), [](uv_handle_t* handle) {
+      Task* task = ContainerOf(&Task::async_,
+                               reinterpret_cast<uv_async_t*>(handle));
+      // Keep the pool around until the task is done with it.
+      std::shared_ptr<ExecutorPool> pool = std::move(task->pool_);
+      task->Done(task->status_);
+    });
+  }), 0);
+  task->queued_at_ = uv_hrtime();
+
+  Mutex::ScopedLock lock(mutex_);
+  queue_.push_back(task);
+  cond_.Signal(lock);
+}
+
+int ExecutorPool::Cancel(Task* task) {
+  {
+    Mutex::ScopedLock lock(mutex_);
+    auto it = std::find(queue_.begin(), queue_.end(), task);
+    if (it == queue_.end()) return UV_EBUSY;
+    queue_.erase(it);
+    cancelled_++;
+  }
+  task->status_ = UV_ECANCELED;
+  CHECK_EQ(uv_async_send(&task->async_), 0);
+  return 0;
+}
+
+ExecutorPool::Metrics ExecutorPool::GetMetrics() const {
+  Mutex::ScopedLock lock(mutex_);
+  return Metrics {
+    threads_.size(),
+    queue_.size(),
+    running_,
+    completed_,
+    cancelled_,
+    total_queue_wait_,
+    max_queue_wait_
+  };
+}
+
+}  // namespace node
@@ -0,0 +1,116 @@
+#ifndef SRC_NODE_EXECUTOR_POOL_H_
+#define SRC_NODE_EXECUTOR_POOL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "node_mutex.h"
+#include "uv.h"
+
+namespace node {
+
+// A named pool of threads of its own, for work that should not compete with
+// fs, dns, crypto and zlib for the threads of the libuv threadpool, such as
+// the CPU-heavy work of an addon. Pools are shared by name within the
+// process, and keep running for as long as something refers to them.
+//
+// Tasks are scheduled from the thread of an event loop and complete there,
+// very much like with uv_queue_work(), and keep that loop alive while they
+// are pending.
+class ExecutorPool : public std::enable_shared_from_this<ExecutorPool> {
+ public:
+  // Only has an effect on Linux, where it sets the nice value of the
+  // threads. Raising the priority takes privileges, and is silently
+  // skipped without them.
+  enum class Priority { kNormal, kLow, kBackground, kHigh };
+
+  static constexpr size_t kMaxThreads = 128;
+
+  class Task {
+   public:
+    virtual ~Task() = default;
+
+    // Runs on a thread of the pool.
+    virtual void Run() = 0;
+    // Runs on the thread of the loop that the task was scheduled on, with
+    // 0, or UV_ECANCELED if it was cancelled before it started. The task
+    // may be deleted from here.
+    virtual void Done(int status) = 0;
+
+   private:
+    friend class ExecutorPool;
+
+    std::shared_ptr<ExecutorPool> pool_;
+    uv_async_t async_;
+    uint64_t queued_at_ = 0;
+    int status_ = 0;
+  };
+
+  struct Metrics {
+    size_t threads;
+    size_t queued;   // Tasks that wait for a thread.
+    size_t running;  // Tasks that run now.
+    uint64_t completed;
+    uint64_t cancelled;
+    uint64_t total_queue_wait;  // In nanoseconds, over all completed tasks.
+    uint64_t max_queue_wait;
+  };
+
+  // Returns the pool called `name`, and starts it with `threads` threads
+  // if there is none. The arguments of the first call win. Returns nullptr
+  // if the threads could not be started.
+  static std::shared_ptr<ExecutorPool> GetOrCreate(const std::string& name,
+                                                   size_t threads,
+                                                   Priority priority);
+  // Calls `callback` for each pool of the process, for diagnostic reports.
+  static void ForEach(
+      const std::function<void(const ExecutorPool&)>& callback);
+
+  ExecutorPool(const ExecutorPool&) = delete;
+  ExecutorPool& operator=(const ExecutorPool&) = delete;
+  // Waits for the threads to finish, after the queue has run empty.
+  ~ExecutorPool();
+
+  void Schedule(uv_loop_t* loop, Task* task);
+  // Returns 0 if the task had not started yet. It then completes with
+  // UV_ECANCELED. Returns UV_EBUSY otherwise.
+  int Cancel(Task* task);
+
+  Metrics GetMetrics() const;
+  const std::string& name() const { return name_; }
+  Priority priority() const { return priority_; }
+
+ private:
+  ExecutorPool(const std::string& name, Priority priority);
+
+  bool Start(size_t threads);
+  void Run();
+  static void Complete(Task* task, int status);
+
+  const std::string name_;
+  const Priority priority_;
+  std::vector<uv_thread_t> threads_;
+
+  mutable Mutex mutex_;
+  ConditionVariable cond_;
+  std::deque<Task*> queue_;
+  bool stopping_ = false;
+  size_t running_ = 0;
+  uint64_t completed_ = 0;
+  uint64_t cancelled_ = 0;
+  uint64_t total_queue_wait_ = 0;
+  uint64_t max_queue_wait_ = 0;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_EXECUTOR_POOL_H_
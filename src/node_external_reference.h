@@ -30,7 +30,11 @@ class ExternalReferenceRegistry {
   V(v8::GenericNamedPropertyDeleterCallback)                                   \
   V(v8::GenericNamedPropertyEnumeratorCallback)                                \
   V(v8::GenericNamedPropertyQueryCallback)                                     \
-  V(v8::GenericNamedPropertySetterCallback)
+  V(v8::GenericNamedPropertySetterCallback)                                    \
+  V(v8::IndexedPropertyGetterCallback)                                         \
+  V(v8::IndexedPropertySetterCallback)                                         \
+  V(v8::IndexedPropertyDefinerCallback)                                        \
+  V(v8::IndexedPropertyDeleterCallback)
 
 #define V(ExternalReferenceType)                                               \
   void Register(ExternalReferenceType addr) { RegisterT(addr); }
@@ -65,6 +69,7 @@ class ExternalReferenceRegistry {
   V(fs_event_wrap)                                                             \
   V(handle_wrap)                                                               \
   V(heap_utils)                                                                \
+  V(log_sink)                                                                  \
   V(messaging)                                                                 \
   V(native_module)                                                             \
   V(os)                                                                        \
@@ -80,8 +85,11 @@ class ExternalReferenceRegistry {
   V(pipe_wrap)                                                                 \
   V(serdes)                                                                    \
   V(string_decoder)                                                            \
+  V(stream_ipc_channel)                                                        \
+  V(stream_line_splitter)                                                      \
   V(stream_wrap)                                                               \
   V(signal_wrap)                                                               \
+  V(socket_pool)                                                               \
   V(trace_events)                                                              \
   V(timers)                                                                    \
   V(types)                                                                     \
@@ -4,6 +4,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "node_file.h"
+#include "node_usdt.h"
 #include "req_wrap-inl.h"
 
 namespace node {
@@ -256,6 +257,8 @@ FSReqBase* AsyncDestCall(Environment* env, FSReqBase* req_wrap,
     after(uv_req);  // after may delete req_wrap if there is an error
     req_wrap = nullptr;
   } else {
+    NODE_USDT_PROBE2(fs__start, NODE_USDT_PTR(req_wrap),
+                     NODE_USDT_PTR(syscall));
     req_wrap->SetReturnValue(args);
   }
 
@@ -25,6 +25,7 @@
 #include "node_buffer.h"
 #include "node_external_reference.h"
 #include "node_process-inl.h"
+#include "node_resolve_cache.h"
 #include "node_stat_watcher.h"
 #include "util-inl.h"
 
@@ -32,7 +33,9 @@
 
 #include "req_wrap-inl.h"
 #include "stream_base-inl.h"
+#include "stream_wrap.h"
 #include "string_bytes.h"
+#include "threadpoolwork-inl.h"
 
 #include <fcntl.h>
 #include <sys/types.h>
@@ -45,6 +48,18 @@
 # include <io.h>
 #endif
 
+#ifdef __POSIX__
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#if defined(__linux__)
+# include <sys/vfs.h>
+#elif defined(__APPLE__)
+# include <sys/mount.h>
+#endif
+
+#include <algorithm>
 #include <memory>
 
 namespace node {
@@ -52,6 +67,8 @@ namespace node {
 namespace fs {
 
 using v8::Array;
+using v8::ArrayBuffer;
+using v8::BackingStore;
 using v8::BigInt;
 using v8::Boolean;
 using v8::Context;
@@ -59,8 +76,10 @@ using v8::EscapableHandleScope;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
+using v8::Int32Array;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
@@ -71,6 +90,7 @@ using v8::ObjectTemplate;
 using v8::Promise;
 using v8::String;
 using v8::Symbol;
+using v8::Uint32;
 using v8::Undefined;
 using v8::Value;
 
@@ -196,6 +216,7 @@ int FileHandle::DoWrite(WriteWrap* w,
 
 void FileHandle::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("current_read", current_read_);
+  tracker->TrackFieldWithSize("write_buffer", write_buffer_.capacity());
 }
 
 FileHandle::TransferMode FileHandle::GetTransferMode() const {
@@ -241,6 +262,18 @@ inline void FileHandle::Close() {
   if (closed_ || closing_) return;
   uv_fs_t req;
   CHECK_NE(fd_, -1);
+  // Buffered appends are written before the fd goes away.
+  for (size_t written = 0; written < write_buffer_.size();) {
+    uv_buf_t buf = uv_buf_init(write_buffer_.data() + written,
+                               write_buffer_.size() - written);
+    const int nwritten =
+        uv_fs_write(env()->event_loop(), &req, fd_, &buf, 1, -1, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (nwritten < 0)
+      break;
+    written += nwritten;
+  }
+  write_buffer_.clear();
   int ret = uv_fs_close(env()->event_loop(), &req, fd_, nullptr);
   uv_fs_req_cleanup(&req);
 
@@ -373,6 +406,19 @@ MaybeLocal<Promise> FileHandle::ClosePromise() {
   object()->SetInternalField(FileHandle::kClosingPromiseSlot, promise);
 
   CloseReq* req = new CloseReq(env(), close_req_obj, promise, object());
+  // Buffered appends are written before the fd goes away.
+  if (flushing_ || !write_buffer_.empty()) {
+    pending_close_ = req;
+    if (!flushing_)
+      StartFlush();
+  } else {
+    DispatchClose(req);
+  }
+
+  return scope.Escape(promise);
+}
+
+void FileHandle::DispatchClose(CloseReq* req) {
   auto AfterClose = uv_fs_callback_t{[](uv_fs_t* req) {
     std::unique_ptr<CloseReq> close(CloseReq::from_req(req));
     CHECK_NOT_NULL(close);
@@ -389,11 +435,9 @@ MaybeLocal<Promise> FileHandle::ClosePromise() {
   CHECK_NE(fd_, -1);
   int ret = req->Dispatch(uv_fs_close, fd_, AfterClose);
   if (ret < 0) {
-    req->Reject(UVException(isolate, ret, "close"));
+    req->Reject(UVException(env()->isolate(), ret, "close"));
     delete req;
   }
-
-  return scope.Escape(promise);
 }
 
 void FileHandle::Close(const FunctionCallbackInfo<Value>& args) {
@@ -405,6 +449,248 @@ void FileHandle::Close(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+void FileHandle::SendTo(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  FileHandle* fd;
+  ASSIGN_OR_RETURN_UNWRAP(&fd, args.Holder());
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsObject());
+  CHECK(IsSafeJsInt(args[2]));
+  CHECK(IsSafeJsInt(args[3]));
+
+  FileHandleSendWrap* req_wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&req_wrap, args[0].As<Object>());
+  Local<Object> sink_obj = args[1].As<Object>();
+
+  int err = UV_EINVAL;
+  if (env->libuv_stream_wrap_ctor_template()->HasInstance(sink_obj)) {
+    LibuvStreamWrap* sink = LibuvStreamWrap::From(env, sink_obj);
+    // sendfile() writes to the descriptor directly and would overtake
+    // anything still queued on the stream.
+    if (sink->IsAlive() && sink->write_queue_size() != 0)
+      return args.GetReturnValue().Set(UV_EBUSY);
+    err = req_wrap->Start(fd,
+                          sink,
+                          sink->GetFD(),
+                          args[2].As<Integer>()->Value(),
+                          args[3].As<Integer>()->Value());
+  }
+  args.GetReturnValue().Set(err);
+}
+
+// Writes the contents of the write buffer with as few write() calls as the
+// kernel allows, then runs fdatasync() if a flush(true) is waiting on it.
+class FileHandle::FlushWork final : public ThreadPoolWork {
+ public:
+  FlushWork(FileHandle* handle,
+            std::vector<char>&& data,
+            bool sync,
+            std::vector<Global<Promise::Resolver>>&& waiters)
+      : ThreadPoolWork(handle->env()),
+        handle_(handle),
+        fd_(handle->fd_),
+        data_(std::move(data)),
+        sync_(sync),
+        waiters_(std::move(waiters)) {}
+
+  void DoThreadPoolWork() override {
+    uv_loop_t* loop = env()->event_loop();
+    uv_fs_t req;
+    for (size_t written = 0; written < data_.size();) {
+      uv_buf_t buf =
+          uv_buf_init(data_.data() + written, data_.size() - written);
+      const int nwritten = uv_fs_write(loop, &req, fd_, &buf, 1, -1, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (nwritten < 0) {
+        error_ = nwritten;
+        syscall_ = "write";
+        return;
+      }
+      written += nwritten;
+    }
+    if (sync_) {
+      error_ = uv_fs_fdatasync(loop, &req, fd_, nullptr);
+      uv_fs_req_cleanup(&req);
+      syscall_ = "fdatasync";
+    }
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<FlushWork> self(this);
+    if (status == UV_ECANCELED) {
+      error_ = status;
+      syscall_ = "write";
+    }
+    handle_->OnFlushDone(error_, syscall_, &waiters_);
+  }
+
+ private:
+  BaseObjectPtr<FileHandle> handle_;
+  const int fd_;
+  std::vector<char> data_;
+  const bool sync_;
+  std::vector<Global<Promise::Resolver>> waiters_;
+  int error_ = 0;
+  const char* syscall_ = nullptr;
+};
+
+void FileHandle::StartFlush() {
+  CHECK(!flushing_);
+  if (write_buffer_timer_ != nullptr)
+    uv_timer_stop(write_buffer_timer_);
+  flushing_ = true;
+  FlushWork* work = new FlushWork(this,
+                                  std::move(write_buffer_),
+                                  flush_sync_,
+                                  std::move(flush_waiters_));
+  write_buffer_.clear();
+  flush_waiters_.clear();
+  flush_sync_ = false;
+  work->ScheduleWork();
+}
+
+void FileHandle::OnFlushDone(int err,
+                             const char* syscall,
+                             std::vector<Global<Promise::Resolver>>* waiters) {
+  flushing_ = false;
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Local<Context> context = env()->context();
+  Context::Scope context_scope(context);
+
+  // Report failures of flushes that nobody waits for from the next append.
+  if (err < 0 && waiters->empty())
+    write_buffer_error_ = err;
+  if (!waiters->empty()) {
+    InternalCallbackScope callback_scope(this);
+    for (Global<Promise::Resolver>& waiter : *waiters) {
+      Local<Promise::Resolver> resolver = waiter.Get(isolate);
+      if (err < 0)
+        USE(resolver->Reject(context, UVException(isolate, err, syscall)));
+      else
+        USE(resolver->Resolve(context, Undefined(isolate)));
+    }
+  }
+
+  if (closed_)
+    return;
+  if (!flush_waiters_.empty() || !write_buffer_.empty()) {
+    if (pending_close_ != nullptr ||
+        !flush_waiters_.empty() ||
+        write_buffer_.size() >= write_buffer_limit_) {
+      return StartFlush();
+    }
+    if (write_buffer_timer_ != nullptr)
+      uv_timer_start(write_buffer_timer_, OnWriteBufferTimer,
+                     write_buffer_interval_, 0);
+    return;
+  }
+  if (pending_close_ != nullptr) {
+    CloseReq* req = pending_close_;
+    pending_close_ = nullptr;
+    DispatchClose(req);
+  }
+}
+
+void FileHandle::OnWriteBufferTimer(uv_timer_t* timer) {
+  FileHandle* handle = static_cast<FileHandle*>(timer->data);
+  if (!handle->flushing_ && !handle->write_buffer_.empty())
+    handle->StartFlush();
+}
+
+// setWriteBuffer(limit, interval) turns on buffered appends, which are
+// written once `limit` bytes are buffered or `interval` ms after the first
+// of them, if `interval` is not 0. A limit of 0 turns them off again after
+// writing what is buffered.
+void FileHandle::SetWriteBuffer(const FunctionCallbackInfo<Value>& args) {
+  FileHandle* fd;
+  ASSIGN_OR_RETURN_UNWRAP(&fd, args.Holder());
+  CHECK(args[0]->IsUint32());
+  CHECK(args[1]->IsUint32());
+  if (fd->closed_ || fd->closing_)
+    return args.GetReturnValue().Set(UV_EBADF);
+
+  fd->write_buffer_limit_ = args[0].As<Uint32>()->Value();
+  fd->write_buffer_interval_ = args[1].As<Uint32>()->Value();
+  if (fd->write_buffer_interval_ > 0 && fd->write_buffer_timer_ == nullptr) {
+    fd->write_buffer_timer_ = new uv_timer_t;
+    CHECK_EQ(0, uv_timer_init(fd->env()->event_loop(),
+                              fd->write_buffer_timer_));
+    fd->write_buffer_timer_->data = fd;
+    // Like an idle logger, the timer does not keep the process running.
+    // Whatever is buffered at exit is written when the fd is closed.
+    uv_unref(reinterpret_cast<uv_handle_t*>(fd->write_buffer_timer_));
+  }
+  if (!fd->flushing_ && !fd->write_buffer_.empty() &&
+      fd->write_buffer_.size() >= fd->write_buffer_limit_) {
+    fd->StartFlush();
+  }
+  args.GetReturnValue().Set(0);
+}
+
+// appendBuffered(data) copies a string or ArrayBufferView into the write
+// buffer. Returns 0, or the error of an earlier flush that nobody waited for.
+void FileHandle::AppendBuffered(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  FileHandle* fd;
+  ASSIGN_OR_RETURN_UNWRAP(&fd, args.Holder());
+  if (fd->closed_ || fd->closing_)
+    return args.GetReturnValue().Set(UV_EBADF);
+  if (fd->write_buffer_limit_ == 0)
+    return args.GetReturnValue().Set(UV_EINVAL);
+  if (fd->write_buffer_error_ != 0) {
+    args.GetReturnValue().Set(fd->write_buffer_error_);
+    fd->write_buffer_error_ = 0;
+    return;
+  }
+
+  std::vector<char>& buffer = fd->write_buffer_;
+  const bool was_empty = buffer.empty();
+  if (args[0]->IsString()) {
+    Utf8Value value(env->isolate(), args[0]);
+    buffer.insert(buffer.end(), *value, *value + value.length());
+  } else {
+    CHECK(args[0]->IsArrayBufferView());
+    ArrayBufferViewContents<char> value(args[0]);
+    buffer.insert(buffer.end(), value.data(), value.data() + value.length());
+  }
+
+  if (fd->flushing_) {
+    // OnFlushDone() takes care of it.
+  } else if (buffer.size() >= fd->write_buffer_limit_) {
+    fd->StartFlush();
+  } else if (was_empty && fd->write_buffer_timer_ != nullptr &&
+             fd->write_buffer_interval_ > 0) {
+    uv_timer_start(fd->write_buffer_timer_, OnWriteBufferTimer,
+                   fd->write_buffer_interval_, 0);
+  }
+  args.GetReturnValue().Set(0);
+}
+
+// flush(sync) returns a Promise that settles once everything appended so far
+// has been written, and with `sync`, also passed to fdatasync().
+void FileHandle::Flush(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  FileHandle* fd;
+  ASSIGN_OR_RETURN_UNWRAP(&fd, args.Holder());
+
+  Local<Promise::Resolver> resolver;
+  if (!Promise::Resolver::New(env->context()).ToLocal(&resolver))
+    return;
+  args.GetReturnValue().Set(resolver->GetPromise());
+  if (fd->closed_ || fd->closing_) {
+    USE(resolver->Reject(env->context(),
+                         UVException(env->isolate(), UV_EBADF, "write")));
+    return;
+  }
+
+  fd->flush_waiters_.emplace_back(env->isolate(), resolver);
+  if (args[0]->IsTrue())
+    fd->flush_sync_ = true;
+  if (!fd->flushing_)
+    fd->StartFlush();
+}
+
 void FileHandle::ReleaseFD(const FunctionCallbackInfo<Value>& args) {
   FileHandle* fd;
   ASSIGN_OR_RETURN_UNWRAP(&fd, args.Holder());
@@ -417,6 +703,11 @@ void FileHandle::AfterClose() {
   closing_ = false;
   closed_ = true;
   fd_ = -1;
+  if (write_buffer_timer_ != nullptr) {
+    env()->CloseHandle(write_buffer_timer_,
+                       [](uv_timer_t* handle) { delete handle; });
+    write_buffer_timer_ = nullptr;
+  }
   if (reading_ && !persistent().IsEmpty())
     EmitRead(UV_EOF);
 }
@@ -475,7 +766,7 @@ int FileHandle::ReadStart() {
       read_wrap = MakeDetachedBaseObject<FileHandleReadWrap>(this, wrap_obj);
     }
   }
-  int64_t recommended_read = 65536;
+  int64_t recommended_read = read_chunk_size_;
   if (read_length_ >= 0 && read_length_ <= recommended_read)
     recommended_read = read_length_;
 
@@ -538,9 +829,15 @@ int FileHandle::ReadStart() {
 
     handle->EmitRead(result, buffer);
 
-    // Start over, if EmitRead() didn’t tell us to stop.
-    if (handle->reading_)
+    // Start over, if EmitRead() didn’t tell us to stop. The consumer kept
+    // up with this chunk, so the next one can be larger.
+    if (handle->reading_) {
+      if (result > 0 && static_cast<size_t>(result) == buffer.len) {
+        handle->read_chunk_size_ =
+            std::min(handle->read_chunk_size_ * 2, kMaxReadChunkSize);
+      }
       handle->ReadStart();
+    }
   }});
 
   return 0;
@@ -548,6 +845,7 @@ int FileHandle::ReadStart() {
 
 int FileHandle::ReadStop() {
   reading_ = false;
+  read_chunk_size_ = kMinReadChunkSize;
   return 0;
 }
 
@@ -579,6 +877,246 @@ int FileHandle::DoShutdown(ShutdownWrap* req_wrap) {
   return 0;
 }
 
+FileHandleSendWrap::FileHandleSendWrap(Environment* env, Local<Object> obj)
+    : ReqWrap(env, obj, AsyncWrap::PROVIDER_FILEHANDLESENDWRAP) {}
+
+FileHandleSendWrap::~FileHandleSendWrap() {
+  if (stream() != nullptr)
+    stream()->RemoveStreamListener(this);
+  CloseFD();
+}
+
+void FileHandleSendWrap::CloseFD() {
+  if (out_fd_ == -1)
+    return;
+  uv_fs_t req;
+  uv_fs_close(nullptr, &req, out_fd_, nullptr);
+  uv_fs_req_cleanup(&req);
+  out_fd_ = -1;
+}
+
+void FileHandleSendWrap::New(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args.IsConstructCall());
+  Environment* env = Environment::GetCurrent(args);
+  new FileHandleSendWrap(env, args.This());
+}
+
+void FileHandleSendWrap::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("file_handle", file_handle_);
+  tracker->TrackFieldWithSize("chunk", chunk_ ? chunk_->ByteLength() : 0);
+}
+
+int FileHandleSendWrap::Start(FileHandle* file_handle,
+                              StreamBase* sink,
+                              int sink_fd,
+                              int64_t position,
+                              int64_t length) {
+  if (file_handle_)
+    return UV_EBUSY;
+  if (position < 0 || length < -1 || length == 0)
+    return UV_EINVAL;
+  if (!file_handle->IsAlive() || file_handle->IsClosing() ||
+      !sink->IsAlive() || sink->IsClosing() || sink_fd < 0) {
+    return UV_EBADF;
+  }
+#ifdef _WIN32
+  // libuv emulates uv_fs_sendfile() with reads and writes on CRT file
+  // descriptors, which sockets are not.
+  return UV_ENOTSUP;
+#else
+  // The stream may be closed while a chunk is being sent on the threadpool,
+  // so use a descriptor of our own that cannot be reused in the meantime.
+  out_fd_ = fcntl(sink_fd, F_DUPFD_CLOEXEC, 0);
+  if (out_fd_ == -1)
+    return uv_translate_sys_error(errno);
+
+  file_handle_.reset(file_handle);
+  sink_ = sink;
+  position_ = position;
+  remaining_ = length;
+  sink->PushStreamListener(this);
+
+  int err = SendChunk();
+  if (err != 0) {
+    sink->RemoveStreamListener(this);
+    sink_ = nullptr;
+    file_handle_.reset();
+    CloseFD();
+  }
+  return err;
+#endif
+}
+
+int FileHandleSendWrap::SendChunk() {
+  size_t length = kSendChunkSize;
+  if (remaining_ >= 0 && static_cast<uint64_t>(remaining_) < length)
+    length = remaining_;
+
+  Reset();
+  return Dispatch(uv_fs_sendfile,
+                  out_fd_,
+                  file_handle_->GetFD(),
+                  position_,
+                  length,
+                  uv_fs_callback_t{AfterSend});
+}
+
+// Used when the stream is full. The write queue of the stream tells us when
+// it can take more data, at which point sendfile() takes over again.
+int FileHandleSendWrap::ReadChunk() {
+  size_t length = kWriteChunkSize;
+  if (remaining_ >= 0 && static_cast<uint64_t>(remaining_) < length)
+    length = remaining_;
+
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+    chunk_ = ArrayBuffer::NewBackingStore(env()->isolate(), length);
+  }
+  uv_buf_t buf = uv_buf_init(static_cast<char*>(chunk_->Data()), length);
+
+  Reset();
+  return Dispatch(uv_fs_read,
+                  file_handle_->GetFD(),
+                  &buf,
+                  1,
+                  position_,
+                  uv_fs_callback_t{AfterRead});
+}
+
+void FileHandleSendWrap::AfterSend(uv_fs_t* req) {
+  FileHandleSendWrap* wrap = from_req(req);
+  ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+
+  if (wrap->Aborted())
+    return wrap->Finish(UV_ECANCELED);
+
+  if (result == UV_EAGAIN) {
+    int err = wrap->ReadChunk();
+    if (err != 0)
+      wrap->Finish(err);
+    return;
+  }
+  if (result <= 0)
+    return wrap->Finish(static_cast<int>(result));
+
+  wrap->sink_->AddBytesWritten(result);
+  wrap->Advance(result);
+  wrap->Continue();
+}
+
+void FileHandleSendWrap::AfterRead(uv_fs_t* req) {
+  FileHandleSendWrap* wrap = from_req(req);
+  ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+  std::unique_ptr<BackingStore> chunk = std::move(wrap->chunk_);
+
+  if (wrap->Aborted())
+    return wrap->Finish(UV_ECANCELED);
+  if (result <= 0)
+    return wrap->Finish(static_cast<int>(result));
+
+  Environment* env = wrap->env();
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+  AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(wrap);
+
+  uv_buf_t buf = uv_buf_init(static_cast<char*>(chunk->Data()), result);
+  StreamWriteResult res = wrap->sink_->Write(&buf, 1);
+  if (res.err != 0)
+    return wrap->Finish(res.err);
+  if (res.async) {
+    res.wrap->SetBackingStore(std::move(chunk));
+    wrap->pending_write_ = res.wrap;
+  }
+  wrap->Advance(result);
+  if (!res.async)
+    wrap->Continue();
+}
+
+bool FileHandleSendWrap::Aborted() {
+  return sink_ == nullptr || !sink_->IsAlive() || sink_->IsClosing() ||
+         !file_handle_->IsAlive() || file_handle_->IsClosing() ||
+         !env()->can_call_into_js();
+}
+
+void FileHandleSendWrap::Advance(size_t bytes) {
+  bytes_sent_ += bytes;
+  position_ += bytes;
+  if (remaining_ > 0)
+    remaining_ -= bytes;
+
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+  Local<Value> arg = Number::New(isolate, static_cast<double>(bytes_sent_));
+  MakeCallback(env()->onprogress_string(), 1, &arg);
+}
+
+void FileHandleSendWrap::Continue() {
+  if (remaining_ == 0)
+    return Finish(0);
+  if (Aborted())
+    return Finish(UV_ECANCELED);
+  int err = SendChunk();
+  if (err != 0)
+    Finish(err);
+}
+
+void FileHandleSendWrap::Finish(int status) {
+  std::unique_ptr<FileHandleSendWrap> delete_on_return(this);
+
+  if (stream() != nullptr)
+    stream()->RemoveStreamListener(this);
+  sink_ = nullptr;
+  file_handle_.reset();
+  CloseFD();
+
+  if (!env()->can_call_into_js())
+    return;
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+  Local<Value> argv[] = {
+    Integer::New(isolate, status),
+    Number::New(isolate, static_cast<double>(bytes_sent_))
+  };
+  MakeCallback(env()->oncomplete_string(), arraysize(argv), argv);
+}
+
+uv_buf_t FileHandleSendWrap::OnStreamAlloc(size_t suggested_size) {
+  CHECK_NOT_NULL(previous_listener_);
+  return previous_listener_->OnStreamAlloc(suggested_size);
+}
+
+void FileHandleSendWrap::OnStreamRead(ssize_t nread, const uv_buf_t& buf) {
+  CHECK_NOT_NULL(previous_listener_);
+  previous_listener_->OnStreamRead(nread, buf);
+}
+
+void FileHandleSendWrap::OnStreamAfterWrite(WriteWrap* w, int status) {
+  if (w != pending_write_)
+    return StreamListener::OnStreamAfterWrite(w, status);
+
+  pending_write_ = nullptr;
+  if (status != 0)
+    return Finish(status);
+  Continue();
+}
+
+void FileHandleSendWrap::OnStreamDestroy() {
+  bool waiting_for_write = pending_write_ != nullptr;
+  stream()->RemoveStreamListener(this);
+  sink_ = nullptr;
+  pending_write_ = nullptr;
+  // Otherwise a threadpool request is in flight and notices this once done.
+  if (waiting_for_write) {
+    env()->SetImmediate([this](Environment* env) {
+      Finish(UV_ECANCELED);
+    });
+  }
+}
+
 
 void FSReqCallback::Reject(Local<Value> reject) {
   MakeCallback(env()->oncomplete_string(), 1, &reject);
@@ -614,6 +1152,7 @@ FSReqAfterScope::FSReqAfterScope(FSReqBase* wrap, uv_fs_t* req)
       handle_scope_(wrap->env()->isolate()),
       context_scope_(wrap->env()->context()) {
   CHECK_EQ(wrap_->req(), req);
+  NODE_USDT_PROBE3(fs__done, NODE_USDT_PTR(wrap), req->fs_type, req->result);
 }
 
 FSReqAfterScope::~FSReqAfterScope() {
@@ -879,8 +1418,220 @@ void Access(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+bool IsLocalFilesystem(const char* dir, bool* pseudo) {
+  if (pseudo != nullptr)
+    *pseudo = false;
+#if defined(__linux__)
+  struct statfs buf;
+  if (statfs(dir, &buf) != 0)
+    return false;
+  switch (static_cast<uint32_t>(buf.f_type)) {
+    case 0x6969:      // NFS
+    case 0x517b:      // SMB
+    case 0xfe534d42:  // SMB2
+    case 0xff534d42:  // CIFS
+    case 0x65735546:  // FUSE
+    case 0x73757245:  // Coda
+    case 0x5346414f:  // AFS
+    case 0x01021997:  // 9P
+    case 0x00c36400:  // Ceph
+      return false;
+    case 0x9fa0:      // procfs
+    case 0x62656572:  // sysfs
+      if (pseudo != nullptr)
+        *pseudo = true;
+      return true;
+    default:
+      return true;
+  }
+#elif defined(__APPLE__)
+  struct statfs buf;
+  return statfs(dir, &buf) == 0 && (buf.f_flags & MNT_LOCAL) != 0;
+#else
+  return false;
+#endif
+}
+
+namespace {
+
+// Returns the directory part of an absolute path, or an empty string if the
+// path is not absolute.
+std::string AbsoluteDirectoryOf(const char* path) {
+  const std::string str(path);
+#ifdef _WIN32
+  const bool absolute =
+      (str.size() >= 3 && str[1] == ':' &&
+       (str[2] == '\\' || str[2] == '/')) ||
+      str.compare(0, 2, "\\\\") == 0;
+  const size_t slash = str.find_last_of("\\/");
+#else
+  const bool absolute = !str.empty() && str[0] == '/';
+  const size_t slash = str.rfind('/');
+#endif
+  if (!absolute || slash == std::string::npos)
+    return std::string();
+  return str.substr(0, slash == 0 ? 1 : slash);
+}
+
+// Finds out on the threadpool which device a directory is on, and whether
+// that is a local one.
+class InlineFsProbe final : public ThreadPoolWork {
+ public:
+  InlineFsProbe(BindingData* binding_data, std::string dir)
+      : ThreadPoolWork(binding_data->env()),
+        binding_data_(binding_data),
+        dir_(std::move(dir)) {}
+
+  void DoThreadPoolWork() override {
+    uv_fs_t req;
+    err_ = uv_fs_stat(nullptr, &req, dir_.c_str(), nullptr);
+    device_ = req.statbuf.st_dev;
+    uv_fs_req_cleanup(&req);
+    if (err_ == 0)
+      local_ = IsLocalFilesystem(dir_.c_str());
+  }
+
+  void AfterThreadPoolWork(int status) override {
+    std::unique_ptr<InlineFsProbe> self(this);
+    if (status == 0 && err_ == 0)
+      binding_data_->inline_fs.OnProbeDone(dir_, device_, local_);
+    else
+      binding_data_->inline_fs.OnProbeFailed(dir_);
+  }
+
+ private:
+  BaseObjectPtr<BindingData> binding_data_;
+  std::string dir_;
+  int err_ = 0;
+  uint64_t device_ = 0;
+  bool local_ = false;
+};
+
+// Run in place of uv_fs_open() and uv_fs_close() for async requests. They
+// make the call synchronously and then defer only the callback, so that it
+// still runs after the binding has returned, like that of a threadpool
+// call.
+void DeferInlineFsCallback(uv_fs_t* req, uv_fs_cb cb) {
+  // Nothing is left for ReqWrap::Cancel() to cancel.
+  req->data = nullptr;
+  FSReqBase::from_req(req)->env()->SetImmediate([req, cb](Environment*) {
+    cb(req);
+  });
+}
+
+int InlineFsOpen(uv_loop_t* loop,
+                 uv_fs_t* req,
+                 const char* path,
+                 int flags,
+                 int mode,
+                 uint64_t device,
+                 uv_fs_cb cb) {
+  const uint64_t start = uv_hrtime();
+  const int result = uv_fs_open(loop, req, path, flags, mode, nullptr);
+  FSReqBase::from_req(req)->binding_data()->inline_fs.OnInlineOpen(
+      device, result, uv_hrtime() - start);
+  DeferInlineFsCallback(req, cb);
+  return 0;
+}
+
+int InlineFsClose(uv_loop_t* loop,
+                  uv_fs_t* req,
+                  uv_file fd,
+                  uint64_t device,
+                  uv_fs_cb cb) {
+  const uint64_t start = uv_hrtime();
+  uv_fs_close(loop, req, fd, nullptr);
+  FSReqBase::from_req(req)->binding_data()->inline_fs.OnInlineClose(
+      device, uv_hrtime() - start);
+  DeferInlineFsCallback(req, cb);
+  return 0;
+}
+
+}  // anonymous namespace
+
+bool InlineFsPolicy::CanOpenInline(BindingData* binding_data,
+                                   const char* path,
+                                   uint64_t* device) {
+  if (budget_ns_ == 0)
+    return false;
+  std::string dir = AbsoluteDirectoryOf(path);
+  if (dir.empty())
+    return false;
+
+  auto it = directories_.find(dir);
+  if (it == directories_.end()) {
+    if (probing_.size() < kMaxProbes && probing_.insert(dir).second)
+      (new InlineFsProbe(binding_data, std::move(dir)))->ScheduleWork();
+    return false;
+  }
+  *device = it->second;
+  return IsFast(*device);
+}
+
+bool InlineFsPolicy::CanCloseInline(int fd, uint64_t* device) {
+  auto it = fds_.find(fd);
+  if (it == fds_.end())
+    return false;
+  *device = it->second;
+  fds_.erase(it);
+  return budget_ns_ != 0 && IsFast(*device);
+}
+
+void InlineFsPolicy::OnInlineOpen(uint64_t device,
+                                  int fd,
+                                  uint64_t duration_ns) {
+  Record(device, duration_ns);
+  if (fd >= 0)
+    fds_[fd] = device;
+}
+
+void InlineFsPolicy::OnInlineClose(uint64_t device, uint64_t duration_ns) {
+  Record(device, duration_ns);
+}
+
+void InlineFsPolicy::OnProbeDone(const std::string& dir,
+                                 uint64_t device,
+                                 bool local) {
+  probing_.erase(dir);
+  if (directories_.size() >= kMaxDirectories)
+    directories_.clear();
+  directories_[dir] = device;
+  devices_[device].local = local;
+}
+
+bool InlineFsPolicy::IsFast(uint64_t device) {
+  auto it = devices_.find(device);
+  if (it == devices_.end() || !it->second.local)
+    return false;
+  Device& state = it->second;
+  if (state.slow_until != 0) {
+    if (uv_hrtime() < state.slow_until)
+      return false;
+    // Give the device another chance.
+    state.slow_until = 0;
+    state.average_ns = 0;
+  }
+  return true;
+}
+
+void InlineFsPolicy::Record(uint64_t device, uint64_t duration_ns) {
+  Device& state = devices_[device];
+  state.average_ns = state.average_ns == 0 ?
+      duration_ns : (state.average_ns * 3 + duration_ns) / 4;
+  if (state.average_ns > budget_ns_)
+    state.slow_until = uv_hrtime() + kRetryIntervalNs;
+}
+
+static void SetInlineFsBudget(const FunctionCallbackInfo<Value>& args) {
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  CHECK(args[0]->IsUint32());
+  binding_data->inline_fs.set_budget_ns(
+      static_cast<uint64_t>(args[0].As<Uint32>()->Value()) * 1000);
+}
+
 void Close(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
 
   const int argc = args.Length();
   CHECK_GE(argc, 2);
@@ -890,11 +1641,17 @@ void Close(const FunctionCallbackInfo<Value>& args) {
   env->RemoveUnmanagedFd(fd);
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 1);
-  if (req_wrap_async != nullptr) {  // close(fd, req)
+  uint64_t device;
+  if (req_wrap_async != nullptr &&
+      binding_data->inline_fs.CanCloseInline(fd, &device)) {
+    AsyncCall(env, req_wrap_async, args, "close", UTF8, AfterNoArgs,
+              InlineFsClose, fd, device);
+  } else if (req_wrap_async != nullptr) {  // close(fd, req)
     AsyncCall(env, req_wrap_async, args, "close", UTF8, AfterNoArgs,
               uv_fs_close, fd);
   } else {  // close(fd, undefined, ctx)
     CHECK_EQ(argc, 3);
+    binding_data->inline_fs.ForgetFd(fd);
     FSReqWrapSync req_wrap_sync;
     FS_SYNC_TRACE_BEGIN(close);
     SyncCall(env, args[2], &req_wrap_sync, "close", uv_fs_close, fd);
@@ -904,25 +1661,19 @@ void Close(const FunctionCallbackInfo<Value>& args) {
 
 
 // Used to speed up module loading. Returns an array [string, boolean]
-static void InternalModuleReadJSON(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
-  Isolate* isolate = env->isolate();
-  uv_loop_t* loop = env->event_loop();
-
-  CHECK(args[0]->IsString());
-  node::Utf8Value path(isolate, args[0]);
-
-  if (strlen(*path) != path.length()) {
-    args.GetReturnValue().Set(Array::New(isolate));
-    return;  // Contains a nul byte.
-  }
+// Reads a package.json file, and tells whether it may contain any of the
+// keys that the module loader is interested in. Returns false if the file
+// cannot be read.
+static bool ReadPackageJSON(uv_loop_t* loop,
+                            const char* path,
+                            std::string* contents,
+                            bool* contains_keys) {
   uv_fs_t open_req;
-  const int fd = uv_fs_open(loop, &open_req, *path, O_RDONLY, 0, nullptr);
+  const int fd = uv_fs_open(loop, &open_req, path, O_RDONLY, 0, nullptr);
   uv_fs_req_cleanup(&open_req);
 
   if (fd < 0) {
-    args.GetReturnValue().Set(Array::New(isolate));
-    return;
+    return false;
   }
 
   auto defer_close = OnScopeLeave([fd, loop]() {
@@ -948,8 +1699,7 @@ static void InternalModuleReadJSON(const FunctionCallbackInfo<Value>& args) {
     uv_fs_req_cleanup(&read_req);
 
     if (numchars < 0) {
-      args.GetReturnValue().Set(Array::New(isolate));
-      return;
+      return false;
     }
     offset += numchars;
   } while (static_cast<size_t>(numchars) == kBlockSize);
@@ -977,77 +1727,517 @@ static void InternalModuleReadJSON(const FunctionCallbackInfo<Value>& args) {
     char* se = &pos[1][-1];  // Exclude quote.
     size_t n = se - s;
 
-    if (n == 4) {
-      if (0 == memcmp(s, "main", 4)) break;
-      if (0 == memcmp(s, "name", 4)) break;
-      if (0 == memcmp(s, "type", 4)) break;
-    } else if (n == 7) {
-      if (0 == memcmp(s, "exports", 7)) break;
-      if (0 == memcmp(s, "imports", 7)) break;
+    if (n == 4) {
+      if (0 == memcmp(s, "main", 4)) break;
+      if (0 == memcmp(s, "name", 4)) break;
+      if (0 == memcmp(s, "type", 4)) break;
+    } else if (n == 7) {
+      if (0 == memcmp(s, "exports", 7)) break;
+      if (0 == memcmp(s, "imports", 7)) break;
+    }
+  }
+
+  contents->assign(&chars[start], size);
+  *contains_keys = p < pe;
+  return true;
+}
+
+static void InternalModuleReadJSON(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  CHECK(args[0]->IsString());
+  node::Utf8Value path(isolate, args[0]);
+
+  if (strlen(*path) != path.length()) {
+    args.GetReturnValue().Set(Array::New(isolate));
+    return;  // Contains a nul byte.
+  }
+
+  bool found;
+  std::string contents;
+  bool contains_keys = false;
+  ResolveCache* resolve_cache = ResolveCache::Get();
+  if (resolve_cache == nullptr ||
+      !resolve_cache->GetPackageJSON(
+          *path, &found, &contents, &contains_keys)) {
+    found = ReadPackageJSON(
+        env->event_loop(), *path, &contents, &contains_keys);
+    if (resolve_cache != nullptr)
+      resolve_cache->SetPackageJSON(*path, found, contents, contains_keys);
+  }
+
+  if (!found) {
+    args.GetReturnValue().Set(Array::New(isolate));
+    return;
+  }
+
+  Local<Value> return_value[] = {
+    String::NewFromUtf8(isolate,
+                        contents.data(),
+                        v8::NewStringType::kNormal,
+                        contents.size()).ToLocalChecked(),
+    Boolean::New(isolate, contains_keys)
+  };
+  args.GetReturnValue().Set(
+    Array::New(isolate, return_value, arraysize(return_value)));
+}
+
+// Used to speed up module loading.  Returns 0 if the path refers to
+// a file, 1 when it's a directory or < 0 on error (usually -ENOENT.)
+// The speedup comes from not creating thousands of Stat and Error objects.
+static void InternalModuleStat(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  CHECK(args[0]->IsString());
+  node::Utf8Value path(env->isolate(), args[0]);
+
+  ResolveCache* resolve_cache = ResolveCache::Get();
+  if (resolve_cache != nullptr && strlen(*path) == path.length()) {
+    args.GetReturnValue().Set(resolve_cache->Stat(*path));
+    return;
+  }
+
+  uv_fs_t req;
+  int rc = uv_fs_stat(env->event_loop(), &req, *path, nullptr);
+  if (rc == 0) {
+    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
+    rc = !!(s->st_mode & S_IFDIR);
+  }
+  uv_fs_req_cleanup(&req);
+
+  args.GetReturnValue().Set(rc);
+}
+
+static void Stat(const FunctionCallbackInfo<Value>& args) {
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  Environment* env = binding_data->env();
+
+  const int argc = args.Length();
+  CHECK_GE(argc, 2);
+
+  BufferValue path(env->isolate(), args[0]);
+  CHECK_NOT_NULL(*path);
+
+  bool use_bigint = args[1]->IsTrue();
+  FSReqBase* req_wrap_async = GetReqWrap(args, 2, use_bigint);
+  if (req_wrap_async != nullptr) {  // stat(path, use_bigint, req)
+    AsyncCall(env, req_wrap_async, args, "stat", UTF8, AfterStat,
+              uv_fs_stat, *path);
+  } else {  // stat(path, use_bigint, undefined, ctx)
+    CHECK_EQ(argc, 4);
+    FSReqWrapSync req_wrap_sync;
+    FS_SYNC_TRACE_BEGIN(stat);
+    int err = SyncCall(env, args[3], &req_wrap_sync, "stat", uv_fs_stat, *path);
+    FS_SYNC_TRACE_END(stat);
+    if (err != 0) {
+      return;  // error info is in ctx
+    }
+
+    Local<Value> arr = FillGlobalStatsArray(binding_data, use_bigint,
+        static_cast<const uv_stat_t*>(req_wrap_sync.req.ptr));
+    args.GetReturnValue().Set(arr);
+  }
+}
+
+namespace {
+void StatPaths(uv_loop_t* loop,
+               const std::vector<std::string>& paths,
+               std::vector<uv_stat_t>* stats,
+               std::vector<int32_t>* errors) {
+  stats->resize(paths.size());
+  errors->resize(paths.size());
+  for (size_t i = 0; i < paths.size(); i++) {
+    uv_fs_t req;
+    (*errors)[i] = uv_fs_stat(loop, &req, paths[i].c_str(), nullptr);
+    if ((*errors)[i] == 0)
+      (*stats)[i] = req.statbuf;
+    uv_fs_req_cleanup(&req);
+  }
+}
+
+// Returns [statValues, errors], where statValues holds kFsStatsFieldsNumber
+// fields for each path, laid out as in the per-call stats arrays, and
+// errors is an Int32Array with 0 or the libuv error code for each path.
+Local<Value> StatManyResult(Environment* env,
+                            bool use_bigint,
+                            const std::vector<uv_stat_t>& stats,
+                            const std::vector<int32_t>& errors) {
+  Isolate* isolate = env->isolate();
+  const size_t fields =
+      static_cast<size_t>(FsStatsOffset::kFsStatsFieldsNumber);
+
+  Local<Value> values;
+  if (use_bigint) {
+    AliasedBigUint64Array arr(isolate, stats.size() * fields);
+    for (size_t i = 0; i < stats.size(); i++) {
+      if (errors[i] == 0)
+        FillStatsArray(&arr, &stats[i], i * fields);
+    }
+    values = arr.GetJSArray();
+  } else {
+    AliasedFloat64Array arr(isolate, stats.size() * fields);
+    for (size_t i = 0; i < stats.size(); i++) {
+      if (errors[i] == 0)
+        FillStatsArray(&arr, &stats[i], i * fields);
+    }
+    values = arr.GetJSArray();
+  }
+
+  std::unique_ptr<BackingStore> store =
+      ArrayBuffer::NewBackingStore(isolate, errors.size() * sizeof(int32_t));
+  if (!errors.empty())
+    memcpy(store->Data(), errors.data(), store->ByteLength());
+  Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(store));
+
+  Local<Value> result[] = {
+    values,
+    Int32Array::New(ab, 0, errors.size())
+  };
+  return Array::New(isolate, result, arraysize(result));
+}
+}  // namespace
+
+StatManyWork::StatManyWork(FSReqBase* req_wrap,
+                           std::vector<std::string>&& paths)
+    : ThreadPoolWork(req_wrap->env()),
+      req_wrap_(req_wrap),
+      paths_(std::move(paths)) {}
+
+void StatManyWork::DoThreadPoolWork() {
+  StatPaths(env()->event_loop(), paths_, &stats_, &errors_);
+}
+
+void StatManyWork::AfterThreadPoolWork(int status) {
+  std::unique_ptr<StatManyWork> self(this);
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(req_wrap_);
+  req_wrap->Detach();
+
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+
+  if (status == UV_ECANCELED) {
+    req_wrap->Reject(UVException(isolate, status, "stat"));
+    return;
+  }
+  req_wrap->Resolve(
+      StatManyResult(env(), req_wrap->use_bigint(), stats_, errors_));
+}
+
+// statMany(paths, use_bigint, req) or statMany(paths, use_bigint)
+// Failures are reported per path in the result rather than thrown.
+static void StatMany(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  CHECK_GE(args.Length(), 2);
+  CHECK(args[0]->IsArray());
+  Local<Array> list = args[0].As<Array>();
+
+  std::vector<std::string> paths;
+  paths.reserve(list->Length());
+  for (uint32_t i = 0; i < list->Length(); i++) {
+    Local<Value> value;
+    if (!list->Get(env->context(), i).ToLocal(&value))
+      return;
+    BufferValue path(isolate, value);
+    CHECK_NOT_NULL(*path);
+    paths.emplace_back(path.ToString());
+  }
+
+  bool use_bigint = args[1]->IsTrue();
+  FSReqBase* req_wrap_async = GetReqWrap(args, 2, use_bigint);
+  if (req_wrap_async != nullptr) {  // statMany(paths, use_bigint, req)
+    StatManyWork* work = new StatManyWork(req_wrap_async, std::move(paths));
+    work->ScheduleWork();
+    req_wrap_async->SetReturnValue(args);
+  } else {  // statMany(paths, use_bigint)
+    std::vector<uv_stat_t> stats;
+    std::vector<int32_t> errors;
+    env->PrintSyncTrace();
+    FS_SYNC_TRACE_BEGIN(statMany);
+    StatPaths(env->event_loop(), paths, &stats, &errors);
+    FS_SYNC_TRACE_END(statMany);
+    args.GetReturnValue().Set(
+        StatManyResult(env, use_bigint, stats, errors));
+  }
+}
+
+CopyTreeJob::CopyTreeJob(FSReqBase* req_wrap,
+                         Local<Value> onprogress,
+                         std::string&& src,
+                         std::string&& dest,
+                         int mode,
+                         int concurrency)
+    : req_wrap_(req_wrap),
+      loop_(req_wrap->env()->event_loop()),
+      src_(std::move(src)),
+      dest_(std::move(dest)),
+      // Try to clone every file, unless cloning is required anyway.
+      flags_(mode & UV_FS_COPYFILE_FICLONE_FORCE ?
+                 mode : mode | UV_FS_COPYFILE_FICLONE),
+      concurrency_(concurrency) {
+  if (onprogress->IsFunction())
+    onprogress_.Reset(req_wrap->env()->isolate(), onprogress.As<Function>());
+}
+
+void CopyTreeJob::Start() {
+  queue_.push_back(Entry { src_, dest_ });
+  // Copying a directory into itself would never end.
+  if (dest_ == src_ ||
+      (dest_.compare(0, src_.size(), src_) == 0 &&
+       dest_[src_.size()] == '/')) {
+    error_ = UV_EINVAL;
+    syscall_ = "cp";
+    error_path_ = src_;
+  }
+  running_++;
+  (new Task(this))->ScheduleWork();
+}
+
+void CopyTreeJob::RunTask() {
+  if (applying_modes_)
+    return ApplyDirectoryModes();
+
+  for (;;) {
+    Entry entry;
+    {
+      Mutex::ScopedLock lock(mutex_);
+      if (error_ != 0 || queue_.empty())
+        return;
+      entry = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    size_t queued = 0;
+    const char* syscall = nullptr;
+    const int err = CopyEntry(entry, &queued, &syscall);
+    if (err < 0) {
+      Mutex::ScopedLock lock(mutex_);
+      if (error_ == 0) {
+        error_ = err;
+        syscall_ = syscall;
+        error_path_ = std::move(entry.src);
+      }
+      return;
+    }
+    if (queued > 0)
+      return;
+  }
+}
+
+int CopyTreeJob::CopyEntry(const Entry& entry,
+                           size_t* queued,
+                           const char** syscall) {
+  const char* src = entry.src.c_str();
+  const char* dest = entry.dest.c_str();
+  uv_fs_t req;
+
+  *syscall = "lstat";
+  int err = uv_fs_lstat(loop_, &req, src, nullptr);
+  const uv_stat_t stat = req.statbuf;
+  uv_fs_req_cleanup(&req);
+  if (err < 0)
+    return err;
+
+  switch (stat.st_mode & S_IFMT) {
+    case S_IFDIR: {
+      *syscall = "mkdir";
+      err = uv_fs_mkdir(loop_, &req, dest, 0777, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (err == UV_EEXIST) {
+        err = uv_fs_stat(loop_, &req, dest, nullptr);
+        const bool is_dir = err == 0 && S_ISDIR(req.statbuf.st_mode);
+        uv_fs_req_cleanup(&req);
+        err = is_dir ? 0 : UV_EEXIST;
+      }
+      if (err < 0)
+        return err;
+
+      *syscall = "scandir";
+      err = uv_fs_scandir(loop_, &req, src, 0, nullptr);
+      if (err < 0) {
+        uv_fs_req_cleanup(&req);
+        return err;
+      }
+      std::vector<Entry> children;
+      uv_dirent_t ent;
+      while (uv_fs_scandir_next(&req, &ent) != UV_EOF)
+        children.push_back(Entry { entry.src + '/' + ent.name,
+                                   entry.dest + '/' + ent.name });
+      uv_fs_req_cleanup(&req);
+
+      Mutex::ScopedLock lock(mutex_);
+      dir_modes_.emplace_back(entry.dest, stat.st_mode & 07777);
+      for (Entry& child : children)
+        queue_.push_back(std::move(child));
+      *queued = children.size();
+      return 0;
+    }
+    case S_IFREG:
+      *syscall = "copyfile";
+      err = uv_fs_copyfile(loop_, &req, src, dest, flags_, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (err < 0)
+        return err;
+      files_++;
+      bytes_ += stat.st_size;
+      return 0;
+    case S_IFLNK: {
+      *syscall = "readlink";
+      err = uv_fs_readlink(loop_, &req, src, nullptr);
+      if (err < 0) {
+        uv_fs_req_cleanup(&req);
+        return err;
+      }
+      std::string target(static_cast<const char*>(req.ptr));
+      uv_fs_req_cleanup(&req);
+
+      *syscall = "symlink";
+      err = uv_fs_symlink(loop_, &req, target.c_str(), dest, 0, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (err == UV_EEXIST && !(flags_ & UV_FS_COPYFILE_EXCL)) {
+        *syscall = "unlink";
+        err = uv_fs_unlink(loop_, &req, dest, nullptr);
+        uv_fs_req_cleanup(&req);
+        if (err < 0)
+          return err;
+        *syscall = "symlink";
+        err = uv_fs_symlink(loop_, &req, target.c_str(), dest, 0, nullptr);
+        uv_fs_req_cleanup(&req);
+      }
+      return err;
+    }
+    default:
+      // Sockets, FIFOs and devices cannot be copied.
+      *syscall = "copyfile";
+      return UV_EINVAL;
+  }
+}
+
+void CopyTreeJob::ApplyDirectoryModes() {
+  // Children first, so that no directory is made read-only before the ones
+  // inside it are done.
+  for (auto it = dir_modes_.rbegin(); it != dir_modes_.rend(); ++it) {
+    uv_fs_t req;
+    const int err =
+        uv_fs_chmod(loop_, &req, it->first.c_str(), it->second, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (err < 0) {
+      Mutex::ScopedLock lock(mutex_);
+      error_ = err;
+      syscall_ = "chmod";
+      error_path_ = it->first;
+      return;
     }
   }
+}
 
+void CopyTreeJob::StartTasks() {
+  size_t queued;
+  {
+    Mutex::ScopedLock lock(mutex_);
+    if (error_ != 0)
+      return;
+    queued = queue_.size();
+  }
+  for (; running_ < concurrency_ && queued > 0; queued--) {
+    running_++;
+    (new Task(this))->ScheduleWork();
+  }
+}
 
-  Local<Value> return_value[] = {
-    String::NewFromUtf8(isolate,
-                        &chars[start],
-                        v8::NewStringType::kNormal,
-                        size).ToLocalChecked(),
-    Boolean::New(isolate, p < pe ? true : false)
-  };
-  args.GetReturnValue().Set(
-    Array::New(isolate, return_value, arraysize(return_value)));
+void CopyTreeJob::Task::AfterThreadPoolWork(int status) {
+  std::unique_ptr<Task> self(this);
+  job_->OnTaskDone(status);
 }
 
-// Used to speed up module loading.  Returns 0 if the path refers to
-// a file, 1 when it's a directory or < 0 on error (usually -ENOENT.)
-// The speedup comes from not creating thousands of Stat and Error objects.
-static void InternalModuleStat(const FunctionCallbackInfo<Value>& args) {
-  Environment* env = Environment::GetCurrent(args);
+void CopyTreeJob::OnTaskDone(int status) {
+  running_--;
+  if (status == UV_ECANCELED) {
+    Mutex::ScopedLock lock(mutex_);
+    if (error_ == 0) {
+      error_ = status;
+      syscall_ = "cp";
+      error_path_ = src_;
+    }
+  }
 
-  CHECK(args[0]->IsString());
-  node::Utf8Value path(env->isolate(), args[0]);
+  Environment* env = req_wrap_->env();
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env->context());
+
+  if (!onprogress_.IsEmpty() && env->can_call_into_js()) {
+    Local<Value> argv[] = {
+      Number::New(isolate, static_cast<double>(files_)),
+      Number::New(isolate, static_cast<double>(bytes_)),
+    };
+    req_wrap_->MakeCallback(
+        onprogress_.Get(isolate), arraysize(argv), argv);
+  }
 
-  uv_fs_t req;
-  int rc = uv_fs_stat(env->event_loop(), &req, *path, nullptr);
-  if (rc == 0) {
-    const uv_stat_t* const s = static_cast<const uv_stat_t*>(req.ptr);
-    rc = !!(s->st_mode & S_IFDIR);
+  StartTasks();
+  if (running_ == 0)
+    Finish();
+}
+
+void CopyTreeJob::Finish() {
+  int error;
+  {
+    Mutex::ScopedLock lock(mutex_);
+    error = error_;
+  }
+  if (error == 0 && !applying_modes_ && !dir_modes_.empty()) {
+    applying_modes_ = true;
+    running_++;
+    (new Task(this))->ScheduleWork();
+    return;
   }
-  uv_fs_req_cleanup(&req);
 
-  args.GetReturnValue().Set(rc);
+  std::unique_ptr<CopyTreeJob> self(this);
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(req_wrap_);
+  req_wrap->Detach();
+  Isolate* isolate = req_wrap->env()->isolate();
+  if (error < 0) {
+    req_wrap->Reject(UVException(
+        isolate, error, syscall_, nullptr, error_path_.c_str()));
+  } else {
+    req_wrap->Resolve(Undefined(isolate));
+  }
 }
 
-static void Stat(const FunctionCallbackInfo<Value>& args) {
-  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
-  Environment* env = binding_data->env();
+// cpTree(src, dest, mode, concurrency, onprogress, req)
+// `mode` takes the same flags as copyFile(). `onprogress(files, bytes)`, if
+// it is a function, is called with running totals as tasks finish.
+static void CpTree(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
 
-  const int argc = args.Length();
-  CHECK_GE(argc, 2);
+  CHECK_EQ(args.Length(), 6);
 
-  BufferValue path(env->isolate(), args[0]);
-  CHECK_NOT_NULL(*path);
+  BufferValue src(isolate, args[0]);
+  CHECK_NOT_NULL(*src);
+  BufferValue dest(isolate, args[1]);
+  CHECK_NOT_NULL(*dest);
 
-  bool use_bigint = args[1]->IsTrue();
-  FSReqBase* req_wrap_async = GetReqWrap(args, 2, use_bigint);
-  if (req_wrap_async != nullptr) {  // stat(path, use_bigint, req)
-    AsyncCall(env, req_wrap_async, args, "stat", UTF8, AfterStat,
-              uv_fs_stat, *path);
-  } else {  // stat(path, use_bigint, undefined, ctx)
-    CHECK_EQ(argc, 4);
-    FSReqWrapSync req_wrap_sync;
-    FS_SYNC_TRACE_BEGIN(stat);
-    int err = SyncCall(env, args[3], &req_wrap_sync, "stat", uv_fs_stat, *path);
-    FS_SYNC_TRACE_END(stat);
-    if (err != 0) {
-      return;  // error info is in ctx
-    }
+  CHECK(args[2]->IsInt32());
+  const int mode = args[2].As<Int32>()->Value();
+  CHECK(args[3]->IsInt32());
+  const int concurrency = args[3].As<Int32>()->Value();
+  CHECK_GT(concurrency, 0);
 
-    Local<Value> arr = FillGlobalStatsArray(binding_data, use_bigint,
-        static_cast<const uv_stat_t*>(req_wrap_sync.req.ptr));
-    args.GetReturnValue().Set(arr);
-  }
+  FSReqBase* req_wrap_async = GetReqWrap(args, 5);
+  CHECK_NOT_NULL(req_wrap_async);
+  CopyTreeJob* job = new CopyTreeJob(req_wrap_async,
+                                     args[4],
+                                     src.ToString(),
+                                     dest.ToString(),
+                                     mode,
+                                     concurrency);
+  job->Start();
+  req_wrap_async->SetReturnValue(args);
 }
 
 static void LStat(const FunctionCallbackInfo<Value>& args) {
@@ -1113,6 +2303,14 @@ static void FStat(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// For renames, removals and new links, which may make what the realpath
+// cache knows about `path` go stale.
+static void InvalidateRealpathCache(const FunctionCallbackInfo<Value>& args,
+                                    const BufferValue& path) {
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  binding_data->realpath_cache.Invalidate(std::string(*path, path.length()));
+}
+
 static void Symlink(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Isolate* isolate = env->isolate();
@@ -1127,6 +2325,7 @@ static void Symlink(const FunctionCallbackInfo<Value>& args) {
 
   CHECK(args[2]->IsInt32());
   int flags = args[2].As<Int32>()->Value();
+  InvalidateRealpathCache(args, path);
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 3);
   if (req_wrap_async != nullptr) {  // symlink(target, path, flags, req)
@@ -1223,6 +2422,8 @@ static void Rename(const FunctionCallbackInfo<Value>& args) {
   CHECK_NOT_NULL(*old_path);
   BufferValue new_path(isolate, args[1]);
   CHECK_NOT_NULL(*new_path);
+  InvalidateRealpathCache(args, old_path);
+  InvalidateRealpathCache(args, new_path);
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 2);
   if (req_wrap_async != nullptr) {
@@ -1317,6 +2518,7 @@ static void Unlink(const FunctionCallbackInfo<Value>& args) {
 
   BufferValue path(env->isolate(), args[0]);
   CHECK_NOT_NULL(*path);
+  InvalidateRealpathCache(args, path);
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 1);
   if (req_wrap_async != nullptr) {
@@ -1339,6 +2541,7 @@ static void RMDir(const FunctionCallbackInfo<Value>& args) {
 
   BufferValue path(env->isolate(), args[0]);
   CHECK_NOT_NULL(*path);
+  InvalidateRealpathCache(args, path);
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 1);  // rmdir(path, req)
   if (req_wrap_async != nullptr) {
@@ -1603,15 +2806,35 @@ static void RealPath(const FunctionCallbackInfo<Value>& args) {
   } else {  // realpath(path, encoding, undefined, ctx)
     CHECK_EQ(argc, 4);
     FSReqWrapSync req_wrap_sync;
-    FS_SYNC_TRACE_BEGIN(realpath);
-    int err = SyncCall(env, args[3], &req_wrap_sync, "realpath",
-                       uv_fs_realpath, *path);
-    FS_SYNC_TRACE_END(realpath);
-    if (err < 0) {
-      return;  // syscall failed, no need to continue, error info is in ctx
+    std::string resolved;
+    const char* link_path = nullptr;
+    if (env->options()->realpath_cache) {
+      BindingData* binding_data =
+          Environment::GetBindingData<BindingData>(args);
+      env->PrintSyncTrace();
+      int err = binding_data->realpath_cache.Resolve(
+          std::string(*path, path.length()), &resolved);
+      if (err == 0) {
+        link_path = resolved.c_str();
+      } else if (err != UV_EINVAL) {
+        Local<Object> ctx = args[3].As<Object>();
+        ctx->Set(env->context(), env->errno_string(),
+                 Integer::New(isolate, err)).Check();
+        ctx->Set(env->context(), env->syscall_string(),
+                 OneByteString(isolate, "realpath")).Check();
+        return;
+      }
+    }
+    if (link_path == nullptr) {
+      FS_SYNC_TRACE_BEGIN(realpath);
+      int err = SyncCall(env, args[3], &req_wrap_sync, "realpath",
+                         uv_fs_realpath, *path);
+      FS_SYNC_TRACE_END(realpath);
+      if (err < 0) {
+        return;  // syscall failed, no need to continue, error info is in ctx
+      }
+      link_path = static_cast<const char*>(req_wrap_sync.req.ptr);
     }
-
-    const char* link_path = static_cast<const char*>(req_wrap_sync.req.ptr);
 
     Local<Value> error;
     MaybeLocal<Value> rc = StringBytes::Encode(isolate,
@@ -1628,6 +2851,56 @@ static void RealPath(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// realpathMany(paths, encoding) resolves each of the paths through the
+// realpath cache, and returns an array with the resolved path or the
+// negative error code for each of them.
+static void RealPathMany(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+
+  CHECK(args[0]->IsArray());
+  Local<Array> paths = args[0].As<Array>();
+  const enum encoding encoding = ParseEncoding(isolate, args[1], UTF8);
+
+  env->PrintSyncTrace();
+  const uint32_t length = paths->Length();
+  MaybeStackBuffer<Local<Value>, 64> results(length);
+  std::string resolved;
+  for (uint32_t i = 0; i < length; i++) {
+    Local<Value> value;
+    if (!paths->Get(env->context(), i).ToLocal(&value)) return;
+    BufferValue path(isolate, value);
+    CHECK_NOT_NULL(*path);
+
+    std::string input(*path, path.length());
+    int err = binding_data->realpath_cache.Resolve(input, &resolved);
+    if (err == UV_EINVAL) {
+      uv_fs_t req;
+      err = uv_fs_realpath(nullptr, &req, input.c_str(), nullptr);
+      if (err == 0) resolved = static_cast<const char*>(req.ptr);
+      uv_fs_req_cleanup(&req);
+    }
+    if (err < 0) {
+      results[i] = Integer::New(isolate, err);
+      continue;
+    }
+
+    Local<Value> error;
+    if (!StringBytes::Encode(isolate, resolved.data(), resolved.size(),
+                             encoding, &error).ToLocal(&results[i])) {
+      isolate->ThrowException(error);
+      return;
+    }
+  }
+  args.GetReturnValue().Set(Array::New(isolate, results.out(), length));
+}
+
+static void ClearRealpathCache(const FunctionCallbackInfo<Value>& args) {
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  binding_data->realpath_cache.Clear();
+}
+
 static void ReadDir(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   Isolate* isolate = env->isolate();
@@ -1731,10 +3004,17 @@ static void Open(const FunctionCallbackInfo<Value>& args) {
   const int mode = args[2].As<Int32>()->Value();
 
   FSReqBase* req_wrap_async = GetReqWrap(args, 3);
+  uint64_t device;
   if (req_wrap_async != nullptr) {  // open(path, flags, mode, req)
     req_wrap_async->set_is_plain_open(true);
-    AsyncCall(env, req_wrap_async, args, "open", UTF8, AfterInteger,
-              uv_fs_open, *path, flags, mode);
+    BindingData* binding_data = req_wrap_async->binding_data();
+    if (binding_data->inline_fs.CanOpenInline(binding_data, *path, &device)) {
+      AsyncCall(env, req_wrap_async, args, "open", UTF8, AfterInteger,
+                InlineFsOpen, *path, flags, mode, device);
+    } else {
+      AsyncCall(env, req_wrap_async, args, "open", UTF8, AfterInteger,
+                uv_fs_open, *path, flags, mode);
+    }
   } else {  // open(path, flags, mode, undefined, ctx)
     CHECK_EQ(argc, 5);
     FSReqWrapSync req_wrap_sync;
@@ -2121,6 +3401,431 @@ static void ReadBuffers(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+namespace {
+// Same as kIoMaxLength in lib/internal/fs/utils.js.
+constexpr size_t kReadFileMaxSize = INT32_MAX;
+// Initial buffer size for files that do not report a size, e.g. in /proc.
+constexpr size_t kReadFileChunkSize = 64 * 1024;
+
+// Decodes UTF-8 into UTF-16 the way String::NewFromUtf8() does, replacing
+// each maximal invalid subsequence with U+FFFD. `out` needs room for
+// `length` code units, and the number of units written is returned.
+size_t DecodeUtf8(const uint8_t* in, size_t length, uint16_t* out) {
+  size_t written = 0;
+  size_t i = 0;
+  while (i < length) {
+    uint8_t lead = in[i++];
+    if (lead < 0x80) {
+      out[written++] = lead;
+      continue;
+    }
+
+    uint8_t lower = 0x80;
+    uint8_t upper = 0xBF;
+    int needed;
+    uint32_t code_point;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      needed = 1;
+      code_point = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      if (lead == 0xE0) lower = 0xA0;
+      if (lead == 0xED) upper = 0x9F;  // No surrogates.
+      needed = 2;
+      code_point = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      if (lead == 0xF0) lower = 0x90;
+      if (lead == 0xF4) upper = 0x8F;  // Nothing above U+10FFFF.
+      needed = 3;
+      code_point = lead & 0x07;
+    } else {
+      out[written++] = 0xFFFD;
+      continue;
+    }
+
+    // A byte that does not continue the sequence is not consumed, it may
+    // start the next one.
+    for (; needed > 0; needed--) {
+      if (i == length || in[i] < lower || in[i] > upper) break;
+      code_point = (code_point << 6) | (in[i++] & 0x3F);
+      lower = 0x80;
+      upper = 0xBF;
+    }
+
+    if (needed > 0) {
+      out[written++] = 0xFFFD;
+    } else if (code_point >= 0x10000) {
+      code_point -= 0x10000;
+      out[written++] = 0xD800 | (code_point >> 10);
+      out[written++] = 0xDC00 | (code_point & 0x3FF);
+    } else {
+      out[written++] = code_point;
+    }
+  }
+  return written;
+}
+}  // namespace
+
+FileContents::~FileContents() {
+  free(one_byte);
+  free(two_byte);
+}
+
+void ReadFileContents(uv_loop_t* loop,
+                      const char* path,
+                      int flags,
+                      enum encoding encoding,
+                      FileContents* contents) {
+  auto fail = [contents](int error, const char* syscall) {
+    contents->error = error;
+    contents->syscall = syscall;
+  };
+
+  uv_fs_t req;
+  const int fd = uv_fs_open(loop, &req, path, flags, 0666, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (fd < 0)
+    return fail(fd, "open");
+
+  auto close_fd = OnScopeLeave([&]() {
+    uv_fs_t close_req;
+    int err = uv_fs_close(loop, &close_req, fd, nullptr);
+    uv_fs_req_cleanup(&close_req);
+    if (err < 0 && contents->error == 0)
+      fail(err, "close");
+  });
+
+  int err = uv_fs_fstat(loop, &req, fd, nullptr);
+  const bool is_regular = (req.statbuf.st_mode & S_IFMT) == S_IFREG;
+  const uint64_t size = is_regular ? req.statbuf.st_size : 0;
+  uv_fs_req_cleanup(&req);
+  if (err < 0)
+    return fail(err, "fstat");
+  if (size > kReadFileMaxSize)
+    return fail(UV_EFBIG, "read");
+
+  size_t capacity = size > 0 ? size : kReadFileChunkSize;
+  char* data = UncheckedMalloc<char>(capacity);
+  if (data == nullptr)
+    return fail(UV_ENOMEM, "read");
+  contents->one_byte = data;
+
+  size_t length = 0;
+  for (;;) {
+    if (length == capacity) {
+      // Like fs.readFile(), stop at the size that fstat() reported.
+      if (size > 0)
+        break;
+      if (capacity == kReadFileMaxSize)
+        return fail(UV_EFBIG, "read");
+      capacity = std::min(capacity * 2, kReadFileMaxSize);
+      data = UncheckedRealloc<char>(data, capacity);
+      if (data == nullptr)
+        return fail(UV_ENOMEM, "read");
+      contents->one_byte = data;
+    }
+
+    uv_buf_t buf = uv_buf_init(data + length, capacity - length);
+    const int nread = uv_fs_read(loop, &req, fd, &buf, 1, -1, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (nread < 0)
+      return fail(nread, "read");
+    if (nread == 0)
+      break;
+    length += nread;
+  }
+  contents->length = length;
+
+  if (encoding != UTF8)
+    return;
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  if (std::all_of(bytes, bytes + length, [](uint8_t c) { return c < 0x80; }))
+    return;  // Pure ASCII is already valid one-byte string data.
+
+  uint16_t* decoded = UncheckedMalloc<uint16_t>(length);
+  if (decoded == nullptr)
+    return fail(UV_ENOMEM, "read");
+  contents->length = DecodeUtf8(bytes, length, decoded);
+  contents->two_byte = decoded;
+  free(contents->one_byte);
+  contents->one_byte = nullptr;
+}
+
+MaybeLocal<Value> FileContents::ToValue(Environment* env,
+                                        enum encoding encoding,
+                                        Local<Value>* error) {
+  Isolate* isolate = env->isolate();
+  if (two_byte != nullptr) {
+    uint16_t* data = two_byte;
+    two_byte = nullptr;
+    return StringBytes::NewExternalTwoByte(isolate, data, length, error);
+  }
+
+  char* data = one_byte;
+  one_byte = nullptr;
+  switch (encoding) {
+    case BUFFER: {
+      std::unique_ptr<BackingStore> store = ArrayBuffer::NewBackingStore(
+          data,
+          length,
+          [](void* data, size_t length, void* deleter_data) { free(data); },
+          nullptr);
+      Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(store));
+      Local<Object> buffer;
+      if (!Buffer::New(env, ab, 0, length).ToLocal(&buffer))
+        return MaybeLocal<Value>();
+      return buffer;
+    }
+    case UTF8:  // ReadFileContents() has only left ASCII here.
+    case LATIN1:
+      return StringBytes::NewExternalOneByte(isolate, data, length, error);
+    default: {
+      MaybeLocal<Value> value =
+          StringBytes::Encode(isolate, data, length, encoding, error);
+      free(data);
+      return value;
+    }
+  }
+}
+
+ReadFileWork::ReadFileWork(FSReqBase* req_wrap,
+                           std::string&& path,
+                           int flags,
+                           enum encoding encoding)
+    : ThreadPoolWork(req_wrap->env()),
+      req_wrap_(req_wrap),
+      path_(std::move(path)),
+      flags_(flags),
+      encoding_(encoding) {}
+
+void ReadFileWork::DoThreadPoolWork() {
+  ReadFileContents(
+      env()->event_loop(), path_.c_str(), flags_, encoding_, &contents_);
+}
+
+void ReadFileWork::AfterThreadPoolWork(int status) {
+  std::unique_ptr<ReadFileWork> self(this);
+  BaseObjectPtr<FSReqBase> req_wrap = std::move(req_wrap_);
+  req_wrap->Detach();
+
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+
+  if (status == UV_ECANCELED) {
+    contents_.error = UV_ECANCELED;
+    contents_.syscall = "open";
+  }
+  if (contents_.error < 0) {
+    req_wrap->Reject(UVException(isolate,
+                                 contents_.error,
+                                 contents_.syscall,
+                                 nullptr,
+                                 path_.c_str()));
+    return;
+  }
+
+  Local<Value> error;
+  Local<Value> value;
+  if (contents_.ToValue(env(), encoding_, &error).ToLocal(&value))
+    req_wrap->Resolve(value);
+  else if (!error.IsEmpty())
+    req_wrap->Reject(error);
+}
+
+// Reads a whole file in one go. With a request, all of the syscalls run as
+// one threadpool task rather than as separate round trips.
+static void ReadFile(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  const int argc = args.Length();
+  CHECK_GE(argc, 4);
+
+  BufferValue path(isolate, args[0]);
+  CHECK_NOT_NULL(*path);
+
+  CHECK(args[1]->IsInt32());
+  const int flags = args[1].As<Int32>()->Value();
+
+  const enum encoding encoding = ParseEncoding(isolate, args[2], BUFFER);
+
+  FSReqBase* req_wrap_async = GetReqWrap(args, 3);
+  if (req_wrap_async != nullptr) {  // readFile(path, flags, encoding, req)
+    ReadFileWork* work =
+        new ReadFileWork(req_wrap_async, path.ToString(), flags, encoding);
+    work->ScheduleWork();
+    req_wrap_async->SetReturnValue(args);
+  } else {  // readFile(path, flags, encoding, undefined, ctx)
+    CHECK_EQ(argc, 5);
+    Local<Object> ctx = args[4].As<Object>();
+    FileContents contents;
+    env->PrintSyncTrace();
+    FS_SYNC_TRACE_BEGIN(readFile);
+    ReadFileContents(env->event_loop(), *path, flags, encoding, &contents);
+    FS_SYNC_TRACE_END(readFile);
+    if (contents.error < 0) {
+      ctx->Set(env->context(), env->errno_string(),
+               Integer::New(isolate, contents.error)).Check();
+      ctx->Set(env->context(), env->syscall_string(),
+               OneByteString(isolate, contents.syscall)).Check();
+      return;
+    }
+
+    Local<Value> error;
+    Local<Value> value;
+    if (!contents.ToValue(env, encoding, &error).ToLocal(&value)) {
+      if (!error.IsEmpty())
+        ctx->Set(env->context(), env->error_string(), error).Check();
+      return;
+    }
+    args.GetReturnValue().Set(value);
+  }
+}
+
+namespace {
+
+struct FileMapping {
+  void* base;
+  size_t size;
+};
+
+void UnmapFile(void* data, size_t length, void* deleter_data) {
+  std::unique_ptr<FileMapping> mapping(static_cast<FileMapping*>(deleter_data));
+#ifdef _WIN32
+  UnmapViewOfFile(mapping->base);
+#else
+  munmap(mapping->base, mapping->size);
+#endif
+}
+
+}  // namespace
+
+int MapFileToBackingStore(uv_loop_t* loop,
+                          Isolate* isolate,
+                          const char* path,
+                          int64_t offset,
+                          int64_t length,
+                          std::shared_ptr<BackingStore>* store,
+                          const char** syscall) {
+  uv_fs_t req;
+  const int fd = uv_fs_open(loop, &req, path, O_RDONLY, 0, nullptr);
+  uv_fs_req_cleanup(&req);
+  if (fd < 0) {
+    *syscall = "open";
+    return fd;
+  }
+
+  // The mapping stays valid after the file is closed.
+  auto close_fd = OnScopeLeave([&]() {
+    uv_fs_t close_req;
+    uv_fs_close(loop, &close_req, fd, nullptr);
+    uv_fs_req_cleanup(&close_req);
+  });
+
+  *syscall = "fstat";
+  int err = uv_fs_fstat(loop, &req, fd, nullptr);
+  const bool is_regular = (req.statbuf.st_mode & S_IFMT) == S_IFREG;
+  const uint64_t size = req.statbuf.st_size;
+  uv_fs_req_cleanup(&req);
+  if (err < 0)
+    return err;
+
+  *syscall = "mmap";
+  if (!is_regular)
+    return UV_ENODEV;
+  if (offset < 0 || static_cast<uint64_t>(offset) > size)
+    return UV_EINVAL;
+  const uint64_t available = size - offset;
+  const uint64_t map_length =
+      length < 0 ? available : std::min<uint64_t>(length, available);
+  if (map_length > v8::TypedArray::kMaxLength)
+    return UV_EFBIG;
+  if (map_length == 0) {
+    *store = ArrayBuffer::NewBackingStore(isolate, 0);
+    return 0;
+  }
+
+  // Mappings have to start at a multiple of the page size (the allocation
+  // granularity on Windows).
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  const uint64_t granularity = info.dwAllocationGranularity;
+#else
+  const uint64_t granularity = sysconf(_SC_PAGESIZE);
+#endif
+  const uint64_t aligned_offset = offset - offset % granularity;
+  const size_t delta = offset - aligned_offset;
+  const size_t mapped_size = map_length + delta;
+
+#ifdef _WIN32
+  HANDLE file = reinterpret_cast<HANDLE>(uv_get_osfhandle(fd));
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  if (mapping == nullptr)
+    return uv_translate_sys_error(GetLastError());
+  void* base = MapViewOfFile(mapping,
+                             FILE_MAP_COPY,
+                             static_cast<DWORD>(aligned_offset >> 32),
+                             static_cast<DWORD>(aligned_offset),
+                             mapped_size);
+  const DWORD error = GetLastError();
+  CloseHandle(mapping);
+  if (base == nullptr)
+    return uv_translate_sys_error(error);
+#else
+  void* base = mmap(nullptr,
+                    mapped_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE,
+                    fd,
+                    aligned_offset);
+  if (base == MAP_FAILED)
+    return -errno;
+#endif
+
+  *store = ArrayBuffer::NewBackingStore(static_cast<char*>(base) + delta,
+                                        map_length,
+                                        UnmapFile,
+                                        new FileMapping { base, mapped_size });
+  return 0;
+}
+
+// mapFile(path, offset, length, ctx) returns an ArrayBuffer that is backed by
+// a copy-on-write mapping of the file. A length of -1 maps up to the end of
+// the file.
+static void MapFile(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+
+  CHECK_EQ(args.Length(), 4);
+
+  BufferValue path(isolate, args[0]);
+  CHECK_NOT_NULL(*path);
+
+  CHECK(IsSafeJsInt(args[1]));
+  const int64_t offset = args[1].As<Integer>()->Value();
+  CHECK(IsSafeJsInt(args[2]));
+  const int64_t length = args[2].As<Integer>()->Value();
+
+  Local<Object> ctx = args[3].As<Object>();
+  std::shared_ptr<BackingStore> store;
+  const char* syscall = nullptr;
+  env->PrintSyncTrace();
+  FS_SYNC_TRACE_BEGIN(mapFile);
+  const int err = MapFileToBackingStore(
+      env->event_loop(), isolate, *path, offset, length, &store, &syscall);
+  FS_SYNC_TRACE_END(mapFile);
+  if (err < 0) {
+    ctx->Set(env->context(), env->errno_string(),
+             Integer::New(isolate, err)).Check();
+    ctx->Set(env->context(), env->syscall_string(),
+             OneByteString(isolate, syscall)).Check();
+    return;
+  }
+  args.GetReturnValue().Set(ArrayBuffer::New(isolate, std::move(store)));
+}
+
 /* fs.chmod(path, mode);
  * Wrapper for chmod(1) / EIO_CHMOD
  */
@@ -2464,10 +4169,13 @@ void Initialize(Local<Object> target,
 
   env->SetMethod(target, "access", Access);
   env->SetMethod(target, "close", Close);
+  env->SetMethod(target, "setInlineFsBudget", SetInlineFsBudget);
   env->SetMethod(target, "open", Open);
   env->SetMethod(target, "openFileHandle", OpenFileHandle);
   env->SetMethod(target, "read", Read);
   env->SetMethod(target, "readBuffers", ReadBuffers);
+  env->SetMethod(target, "readFile", ReadFile);
+  env->SetMethod(target, "mapFile", MapFile);
   env->SetMethod(target, "fdatasync", Fdatasync);
   env->SetMethod(target, "fsync", Fsync);
   env->SetMethod(target, "rename", Rename);
@@ -2478,6 +4186,8 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "internalModuleReadJSON", InternalModuleReadJSON);
   env->SetMethod(target, "internalModuleStat", InternalModuleStat);
   env->SetMethod(target, "stat", Stat);
+  env->SetMethod(target, "statMany", StatMany);
+  env->SetMethod(target, "cpTree", CpTree);
   env->SetMethod(target, "lstat", LStat);
   env->SetMethod(target, "fstat", FStat);
   env->SetMethod(target, "link", Link);
@@ -2488,6 +4198,8 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "writeBuffers", WriteBuffers);
   env->SetMethod(target, "writeString", WriteString);
   env->SetMethod(target, "realpath", RealPath);
+  env->SetMethod(target, "realpathMany", RealPathMany);
+  env->SetMethod(target, "clearRealpathCache", ClearRealpathCache);
   env->SetMethod(target, "copyFile", CopyFile);
 
   env->SetMethod(target, "chmod", Chmod);
@@ -2547,12 +4259,24 @@ void Initialize(Local<Object> target,
   fd->Inherit(AsyncWrap::GetConstructorTemplate(env));
   env->SetProtoMethod(fd, "close", FileHandle::Close);
   env->SetProtoMethod(fd, "releaseFD", FileHandle::ReleaseFD);
+  env->SetProtoMethod(fd, "sendTo", FileHandle::SendTo);
+  env->SetProtoMethod(fd, "setWriteBuffer", FileHandle::SetWriteBuffer);
+  env->SetProtoMethod(fd, "appendBuffered", FileHandle::AppendBuffered);
+  env->SetProtoMethod(fd, "flush", FileHandle::Flush);
   Local<ObjectTemplate> fdt = fd->InstanceTemplate();
   fdt->SetInternalFieldCount(FileHandle::kInternalFieldCount);
   StreamBase::AddMethods(env, fd);
   env->SetConstructorFunction(target, "FileHandle", fd);
   env->set_fd_constructor_template(fdt);
 
+  // Create FunctionTemplate for FileHandleSendWrap
+  Local<FunctionTemplate> fsw =
+      env->NewFunctionTemplate(FileHandleSendWrap::New);
+  fsw->InstanceTemplate()->SetInternalFieldCount(
+      FileHandleSendWrap::kInternalFieldCount);
+  fsw->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  env->SetConstructorFunction(target, "FileHandleSendWrap", fsw);
+
   // Create FunctionTemplate for FileHandle::CloseReq
   Local<FunctionTemplate> fdclose = FunctionTemplate::New(isolate);
   fdclose->SetClassName(FIXED_ONE_BYTE_STRING(isolate,
@@ -2580,10 +4304,13 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   StatWatcher::RegisterExternalReferences(registry);
 
   registry->Register(Close);
+  registry->Register(SetInlineFsBudget);
   registry->Register(Open);
   registry->Register(OpenFileHandle);
   registry->Register(Read);
   registry->Register(ReadBuffers);
+  registry->Register(ReadFile);
+  registry->Register(MapFile);
   registry->Register(Fdatasync);
   registry->Register(Fsync);
   registry->Register(Rename);
@@ -2594,6 +4321,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(InternalModuleReadJSON);
   registry->Register(InternalModuleStat);
   registry->Register(Stat);
+  registry->Register(StatMany);
+  registry->Register(CpTree);
   registry->Register(LStat);
   registry->Register(FStat);
   registry->Register(Link);
@@ -2604,6 +4333,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(WriteBuffers);
   registry->Register(WriteString);
   registry->Register(RealPath);
+  registry->Register(RealPathMany);
+  registry->Register(ClearRealpathCache);
   registry->Register(CopyFile);
 
   registry->Register(Chmod);
@@ -2623,6 +4354,11 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(FileHandle::New);
   registry->Register(FileHandle::Close);
   registry->Register(FileHandle::ReleaseFD);
+  registry->Register(FileHandle::SendTo);
+  registry->Register(FileHandle::SetWriteBuffer);
+  registry->Register(FileHandle::AppendBuffered);
+  registry->Register(FileHandle::Flush);
+  registry->Register(FileHandleSendWrap::New);
   StreamBase::RegisterExternalReferences(registry);
 }
 
@@ -4,14 +4,78 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "aliased_buffer.h"
+#include "node_internals.h"
 #include "node_messaging.h"
+#include "node_mutex.h"
+#include "node_realpath_cache.h"
 #include "node_snapshotable.h"
 #include "stream_base.h"
 
+#include <atomic>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace node {
 namespace fs {
 
 class FileHandleReadWrap;
+class BindingData;
+
+// Whether `dir` is on a filesystem of this machine, rather than a network
+// or FUSE filesystem. `pseudo`, if given, is set for filesystems such as
+// procfs that are not backed by storage. Returns false if it can not tell.
+bool IsLocalFilesystem(const char* dir, bool* pseudo = nullptr);
+
+// Decides whether async open() and close() calls run right away on the loop
+// thread, which saves two threadpool round trips, instead of on the
+// threadpool. That only happens for absolute paths on local filesystems,
+// and only as long as the calls made on the loop thread for the device
+// stay within a latency budget. A device that turns out slower goes back
+// to the threadpool for a while.
+class InlineFsPolicy final {
+ public:
+  static constexpr uint64_t kDefaultBudgetNs = 100 * 1000;
+  static constexpr uint64_t kRetryIntervalNs = 10ull * 1000 * 1000 * 1000;
+
+  // Returns true and sets `device` if `path` can be opened inline. If the
+  // directory of `path` is unknown, a probe of it is started on the
+  // threadpool and false is returned.
+  bool CanOpenInline(BindingData* binding_data,
+                     const char* path,
+                     uint64_t* device);
+  // Only fds opened inline are closed inline.
+  bool CanCloseInline(int fd, uint64_t* device);
+
+  void OnInlineOpen(uint64_t device, int fd, uint64_t duration_ns);
+  void OnInlineClose(uint64_t device, uint64_t duration_ns);
+  void OnProbeDone(const std::string& dir, uint64_t device, bool local);
+  void OnProbeFailed(const std::string& dir) { probing_.erase(dir); }
+  void ForgetFd(int fd) { fds_.erase(fd); }
+
+  // A budget of 0 turns inline calls off.
+  void set_budget_ns(uint64_t budget_ns) { budget_ns_ = budget_ns; }
+
+ private:
+  static constexpr size_t kMaxDirectories = 4096;
+  static constexpr size_t kMaxProbes = 16;
+
+  struct Device {
+    bool local = false;
+    uint64_t average_ns = 0;
+    uint64_t slow_until = 0;  // uv_hrtime() until which it is not used.
+  };
+
+  bool IsFast(uint64_t device);
+  void Record(uint64_t device, uint64_t duration_ns);
+
+  std::unordered_map<std::string, uint64_t> directories_;
+  std::unordered_set<std::string> probing_;
+  std::unordered_map<uint64_t, Device> devices_;
+  std::unordered_map<int, uint64_t> fds_;
+  uint64_t budget_ns_ = kDefaultBudgetNs;
+};
 
 class BindingData : public SnapshotableObject {
  public:
@@ -23,6 +87,9 @@ class BindingData : public SnapshotableObject {
   std::vector<BaseObjectPtr<FileHandleReadWrap>>
       file_handle_read_wrap_freelist;
 
+  InlineFsPolicy inline_fs;
+  RealpathCache realpath_cache;
+
   SERIALIZABLE_OBJECT_METHODS()
   static constexpr FastStringKey type_name{"node::fs::BindingData"};
   static constexpr EmbedderObjectType type_int =
@@ -256,6 +323,18 @@ class FileHandle final : public AsyncWrap, public StreamBase {
   // Releases ownership of the FD.
   static void ReleaseFD(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  // Starts sending a range of the file to a libuv stream, see
+  // FileHandleSendWrap below.
+  static void SendTo(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // Buffered appends, for writers of many small chunks such as loggers. The
+  // data is collected in memory and written from the threadpool in one go
+  // when enough has accumulated, when a timer fires, or when flush() is
+  // called. close() writes what is left first.
+  static void SetWriteBuffer(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void AppendBuffered(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Flush(const v8::FunctionCallbackInfo<v8::Value>& args);
+
   // StreamBase interface:
   int ReadStart() override;
   int ReadStop() override;
@@ -346,6 +425,14 @@ class FileHandle final : public AsyncWrap, public StreamBase {
 
   // Asynchronous close
   v8::MaybeLocal<v8::Promise> ClosePromise();
+  void DispatchClose(CloseReq* req);
+
+  class FlushWork;
+  void StartFlush();
+  void OnFlushDone(int err,
+                   const char* syscall,
+                   std::vector<v8::Global<v8::Promise::Resolver>>* waiters);
+  static void OnWriteBufferTimer(uv_timer_t* timer);
 
   int fd_;
   bool closing_ = false;
@@ -353,12 +440,245 @@ class FileHandle final : public AsyncWrap, public StreamBase {
   bool reading_ = false;
   int64_t read_offset_ = -1;
   int64_t read_length_ = -1;
+  // Stream reads start at kMinReadChunkSize and double up to
+  // kMaxReadChunkSize for as long as the consumer asks for the next chunk
+  // right away, so that a fast sequential reader needs fewer round trips
+  // through the threadpool and fewer, larger buffers.
+  static constexpr size_t kMinReadChunkSize = 64 * 1024;
+  static constexpr size_t kMaxReadChunkSize = 1024 * 1024;
+  size_t read_chunk_size_ = kMinReadChunkSize;
+
+  std::vector<char> write_buffer_;
+  size_t write_buffer_limit_ = 0;
+  uint64_t write_buffer_interval_ = 0;
+  uv_timer_t* write_buffer_timer_ = nullptr;
+  std::vector<v8::Global<v8::Promise::Resolver>> flush_waiters_;
+  bool flush_sync_ = false;
+  bool flushing_ = false;
+  int write_buffer_error_ = 0;
+  CloseReq* pending_close_ = nullptr;
 
   BaseObjectPtr<FileHandleReadWrap> current_read_;
 
   BaseObjectPtr<BindingData> binding_data_;
 };
 
+// Sends a range of a FileHandle to a LibuvStreamWrap using uv_fs_sendfile(),
+// so that the data does not pass through userland buffers. When the stream
+// cannot take more data, one chunk is read and written through the stream's
+// regular write queue instead, and the transfer resumes once that write has
+// finished. While active, this sits in the stream's listener chain and the
+// stream must not be written to from elsewhere.
+// Calls `.onprogress(bytesSent)` after every chunk and
+// `.oncomplete(status, bytesSent)` once the transfer is over.
+class FileHandleSendWrap final : public ReqWrap<uv_fs_t>,
+                                 public StreamListener {
+ public:
+  FileHandleSendWrap(Environment* env, v8::Local<v8::Object> obj);
+  ~FileHandleSendWrap() override;
+
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // `length` may be -1 to send everything up to the end of the file.
+  // Returns 0 or a libuv error code, in which case no callback is made.
+  int Start(FileHandle* file_handle,
+            StreamBase* sink,
+            int sink_fd,
+            int64_t position,
+            int64_t length);
+
+  // StreamListener interface. Reads are not ours to handle, so they are
+  // passed on to the previous listener.
+  uv_buf_t OnStreamAlloc(size_t suggested_size) override;
+  void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
+  void OnStreamAfterWrite(WriteWrap* w, int status) override;
+  void OnStreamDestroy() override;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(FileHandleSendWrap)
+  SET_SELF_SIZE(FileHandleSendWrap)
+
+ private:
+  static constexpr size_t kSendChunkSize = 1024 * 1024;
+  static constexpr size_t kWriteChunkSize = 64 * 1024;
+
+  static inline FileHandleSendWrap* from_req(uv_fs_t* req) {
+    return static_cast<FileHandleSendWrap*>(ReqWrap::from_req(req));
+  }
+
+  int SendChunk();
+  int ReadChunk();
+  static void AfterSend(uv_fs_t* req);
+  static void AfterRead(uv_fs_t* req);
+  bool Aborted();
+  void Advance(size_t bytes);
+  void Continue();
+  void Finish(int status);
+  void CloseFD();
+
+  BaseObjectPtr<FileHandle> file_handle_;
+  StreamBase* sink_ = nullptr;
+  int out_fd_ = -1;
+  int64_t position_ = 0;
+  int64_t remaining_ = -1;
+  uint64_t bytes_sent_ = 0;
+  std::unique_ptr<v8::BackingStore> chunk_;
+  WriteWrap* pending_write_ = nullptr;
+};
+
+// The contents of a whole file, as read by ReadFileContents(). On failure,
+// `error` is a libuv error code and `syscall` names the step that failed.
+struct FileContents {
+  FileContents() = default;
+  ~FileContents();
+
+  // Consumes the data, returning a Buffer for BUFFER and a string otherwise.
+  v8::MaybeLocal<v8::Value> ToValue(Environment* env,
+                                    enum encoding encoding,
+                                    v8::Local<v8::Value>* error);
+
+  int error = 0;
+  const char* syscall = nullptr;
+  // Allocated with malloc(). Holds the raw bytes, unless UTF-8 decoding
+  // found non-ASCII characters, in which case `two_byte` holds UTF-16.
+  char* one_byte = nullptr;
+  uint16_t* two_byte = nullptr;
+  size_t length = 0;
+
+  FileContents(const FileContents&) = delete;
+  FileContents& operator=(const FileContents&) = delete;
+};
+
+// Opens, stats, reads and closes `path` with synchronous libuv calls. For
+// UTF8, the contents are also decoded, so that no work is left for the
+// thread that turns them into a string.
+void ReadFileContents(uv_loop_t* loop,
+                      const char* path,
+                      int flags,
+                      enum encoding encoding,
+                      FileContents* contents);
+
+// Runs ReadFileContents() as a single threadpool task and completes
+// `req_wrap` with the result, instead of one request per syscall.
+class ReadFileWork final : public ThreadPoolWork {
+ public:
+  ReadFileWork(FSReqBase* req_wrap,
+               std::string&& path,
+               int flags,
+               enum encoding encoding);
+
+  void DoThreadPoolWork() override;
+  void AfterThreadPoolWork(int status) override;
+
+ private:
+  BaseObjectPtr<FSReqBase> req_wrap_;
+  std::string path_;
+  int flags_;
+  enum encoding encoding_;
+  FileContents contents_;
+};
+
+// Maps `length` bytes of the file at `path`, starting at `offset`, into
+// memory copy-on-write: the pages are shared with the page cache, and with
+// every other mapping of the file, until they are written to. A negative
+// `length` maps up to the end of the file. The mapping is released together
+// with `store`. Returns 0 or a libuv error code, with `syscall` naming the
+// step that failed.
+//
+// As with any file mapping, touching pages past the end of the file after it
+// has been truncated raises SIGBUS.
+int MapFileToBackingStore(uv_loop_t* loop,
+                          v8::Isolate* isolate,
+                          const char* path,
+                          int64_t offset,
+                          int64_t length,
+                          std::shared_ptr<v8::BackingStore>* store,
+                          const char** syscall);
+
+// Runs stat() on each of `paths` as a single threadpool task, instead of one
+// request per path, and completes `req_wrap` with the same result as the
+// synchronous form of statMany().
+class StatManyWork final : public ThreadPoolWork {
+ public:
+  StatManyWork(FSReqBase* req_wrap, std::vector<std::string>&& paths);
+
+  void DoThreadPoolWork() override;
+  void AfterThreadPoolWork(int status) override;
+
+ private:
+  BaseObjectPtr<FSReqBase> req_wrap_;
+  std::vector<std::string> paths_;
+  std::vector<uv_stat_t> stats_;
+  std::vector<int32_t> errors_;
+};
+
+// Copies the tree at `src` to `dest` with up to `concurrency` threadpool
+// tasks at a time, which share one queue of entries. A directory is created
+// and its children are queued, a file is copied with uv_fs_copyfile(), which
+// clones it with FICLONE or copies it in the kernel with copy_file_range()
+// where it can, and a symlink is created again with the same target. Existing
+// directories in `dest` are merged into. Directory modes are applied last, so
+// that read-only directories can still be filled.
+class CopyTreeJob final {
+ public:
+  CopyTreeJob(FSReqBase* req_wrap,
+              v8::Local<v8::Value> onprogress,
+              std::string&& src,
+              std::string&& dest,
+              int mode,
+              int concurrency);
+
+  void Start();
+
+ private:
+  class Task final : public ThreadPoolWork {
+   public:
+    explicit Task(CopyTreeJob* job)
+        : ThreadPoolWork(job->req_wrap_->env()), job_(job) {}
+
+    void DoThreadPoolWork() override { job_->RunTask(); }
+    void AfterThreadPoolWork(int status) override;
+
+   private:
+    CopyTreeJob* job_;
+  };
+
+  struct Entry {
+    std::string src;
+    std::string dest;
+  };
+
+  // Copies queued entries until there are none left, or until a directory
+  // has queued new ones that more tasks should be started for.
+  void RunTask();
+  int CopyEntry(const Entry& entry, size_t* queued, const char** syscall);
+  void ApplyDirectoryModes();
+  void StartTasks();
+  void OnTaskDone(int status);
+  void Finish();
+
+  BaseObjectPtr<FSReqBase> req_wrap_;
+  v8::Global<v8::Function> onprogress_;
+  uv_loop_t* const loop_;
+  const std::string src_;
+  const std::string dest_;
+  const int flags_;
+  const int concurrency_;
+  // Only used on the loop thread.
+  int running_ = 0;
+  bool applying_modes_ = false;
+
+  Mutex mutex_;
+  std::deque<Entry> queue_;
+  std::vector<std::pair<std::string, int>> dir_modes_;
+  int error_ = 0;
+  const char* syscall_ = nullptr;
+  std::string error_path_;
+
+  std::atomic<uint64_t> files_{0};
+  std::atomic<uint64_t> bytes_{0};
+};
+
 int MKDirpSync(uv_loop_t* loop,
                uv_fs_t* req,
                const std::string& path,
@@ -11,6 +11,7 @@
 #include "node_mem-inl.h"
 #include "node_perf.h"
 #include "node_revert.h"
+#include "server_counters.h"
 #include "stream_base-inl.h"
 #include "util-inl.h"
 
@@ -30,6 +31,7 @@ using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
+using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
@@ -40,6 +42,7 @@ using v8::Object;
 using v8::ObjectTemplate;
 using v8::String;
 using v8::True;
+using v8::Uint32;
 using v8::Uint8Array;
 using v8::Undefined;
 using v8::Value;
@@ -50,6 +53,9 @@ namespace {
 
 const char zero_bytes_256[256] = {};
 
+// The payload of the PINGs that measure the bandwidth-delay product.
+const uint8_t kBdpPingPayload[8] = { 'n', 'o', 'd', 'e', 'b', 'd', 'p', 0 };
+
 bool HasHttp2Observer(Environment* env) {
   AliasedUint32Array& observers = env->performance_state()->observers;
   return observers[performance::NODE_PERFORMANCE_ENTRY_TYPE_HTTP2] != 0;
@@ -204,6 +210,21 @@ Http2Options::Http2Options(Http2State* http2_state, SessionType type) {
         option,
         static_cast<size_t>(buffer[IDX_OPTIONS_MAX_SETTINGS]));
   }
+
+  // Small DATA payloads are copied so that they go out in one contiguous
+  // buffer together with the frames around them. 0 turns this off.
+  if (flags & (1 << IDX_OPTIONS_MAX_COALESCED_WRITE_SIZE)) {
+    set_max_coalesced_write_size(
+        buffer[IDX_OPTIONS_MAX_COALESCED_WRITE_SIZE]);
+  }
+
+  // Grow the flow control windows automatically, up to this size.
+  // 0 (the default) keeps them at the configured sizes.
+  if (flags & (1 << IDX_OPTIONS_MAX_AUTO_WINDOW_SIZE)) {
+    set_max_auto_window_size(
+        std::min<uint32_t>(buffer[IDX_OPTIONS_MAX_AUTO_WINDOW_SIZE],
+                           NGHTTP2_MAX_WINDOW_SIZE));
+  }
 }
 
 #define GRABSETTING(entries, count, name)                                      \
@@ -462,10 +483,12 @@ void Http2Session::CheckAllocatedSize(size_t previous_size) const {
 
 void Http2Session::IncreaseAllocatedSize(size_t size) {
   current_nghttp2_memory_ += size;
+  native_memory::Track(native_memory::kHttp2, size);
 }
 
 void Http2Session::DecreaseAllocatedSize(size_t size) {
   current_nghttp2_memory_ -= size;
+  native_memory::Track(native_memory::kHttp2, -static_cast<int64_t>(size));
 }
 
 Http2Session::Http2Session(Http2State* http2_state,
@@ -492,6 +515,8 @@ Http2Session::Http2Session(Http2State* http2_state,
 
   max_outstanding_pings_ = opts.max_outstanding_pings();
   max_outstanding_settings_ = opts.max_outstanding_settings();
+  max_coalesced_write_size_ = opts.max_coalesced_write_size();
+  max_auto_window_size_ = opts.max_auto_window_size();
 
   padding_strategy_ = opts.padding_strategy();
 
@@ -533,6 +558,7 @@ Http2Session::~Http2Session() {
   // current_nghttp2_memory_ check passes.
   session_.reset();
   CHECK_EQ(current_nghttp2_memory_, 0);
+  stream_pool_->Close();
 }
 
 void Http2Session::MemoryInfo(MemoryTracker* tracker) const {
@@ -545,6 +571,7 @@ void Http2Session::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackFieldWithSize("pending_rst_streams",
                               pending_rst_streams_.size() * sizeof(int32_t));
   tracker->TrackFieldWithSize("nghttp2_memory", current_nghttp2_memory_);
+  tracker->TrackFieldWithSize("stream_pool", stream_pool_->cached_bytes());
 }
 
 std::string Http2Session::diagnostic_name() const {
@@ -697,6 +724,7 @@ void Http2Session::Close(uint32_t code, bool socket_closed) {
   }
 
   set_destroyed();
+  stream_pool_->Close();
 
   // If we are writing we will get to make the callback in OnStreamAfterWrite.
   if (!is_write_in_progress()) {
@@ -902,6 +930,11 @@ int Http2Session::OnBeginHeadersCallback(nghttp2_session* handle,
     }
 
     session->rejected_stream_count_ = 0;
+    if (session->type() == NGHTTP2_SESSION_SERVER &&
+        session->stream_ != nullptr) {
+      if (ServerCounters* counters = session->stream_->server_counters())
+        counters->requests++;
+    }
   } else if (!stream->is_destroyed()) {
     stream->StartHeaders(frame->headers.cat);
   }
@@ -1149,12 +1182,17 @@ int Http2Session::OnDataChunkReceived(nghttp2_session* handle,
   // so that it can send a WINDOW_UPDATE frame. This is a critical part of
   // the flow control process in http2
   CHECK_EQ(nghttp2_session_consume_connection(handle, len), 0);
+  if (session->max_auto_window_size_ > 0)
+    session->UpdateBdpEstimate(len);
   BaseObjectPtr<Http2Stream> stream = session->FindStream(id);
 
   // If the stream has been destroyed, ignore this chunk
   if (!stream || stream->is_destroyed())
     return 0;
 
+  if (session->auto_window_size_ > 0)
+    session->UpdateStreamWindow(stream.get());
+
   stream->statistics_.received_bytes += len;
 
   // Repeatedly ask the stream's owner for memory, and copy the read data
@@ -1488,6 +1526,12 @@ void Http2Session::HandlePingFrame(const nghttp2_frame* frame) {
   Local<Value> arg;
   bool ack = frame->hd.flags & NGHTTP2_FLAG_ACK;
   if (ack) {
+    if (bdp_probe_start_ != 0 &&
+        memcmp(frame->ping.opaque_data, kBdpPingPayload, 8) == 0) {
+      OnBdpPingAck();
+      return;
+    }
+
     BaseObjectPtr<Http2Ping> ping = PopPing();
 
     if (!ping) {
@@ -1514,6 +1558,68 @@ void Http2Session::HandlePingFrame(const nghttp2_frame* frame) {
   MakeCallback(env()->http2session_on_ping_function(), 1, &arg);
 }
 
+// Counts received DATA towards the current bandwidth-delay product estimate,
+// and starts a new estimate with a PING if none is in progress.
+void Http2Session::UpdateBdpEstimate(size_t length) {
+  bdp_bytes_ += length;
+  if (bdp_probe_start_ != 0)
+    return;
+
+  if (auto_window_size_ == 0) {
+    auto_window_size_ = std::max<uint32_t>(
+        nghttp2_session_get_local_settings(
+            session_.get(), NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE),
+        nghttp2_session_get_effective_local_window_size(session_.get()));
+  }
+  if (auto_window_size_ >= max_auto_window_size_)
+    return;
+
+  uint64_t now = uv_hrtime();
+  if (now - bdp_last_probe_ < kMinBdpProbeIntervalNs)
+    return;
+  bdp_probe_start_ = bdp_last_probe_ = now;
+  bdp_bytes_ = length;
+  CHECK_EQ(nghttp2_submit_ping(session_.get(),
+                               NGHTTP2_FLAG_NONE,
+                               kBdpPingPayload), 0);
+}
+
+// The estimate is complete once the PING is acknowledged. If the peer sent
+// close to a full window in that time, the window is what limits it, so the
+// windows are doubled, up to max_auto_window_size_.
+void Http2Session::OnBdpPingAck() {
+  uint64_t rtt = uv_hrtime() - bdp_probe_start_;
+  bdp_probe_start_ = 0;
+  statistics_.ping_rtt = rtt;
+  Debug(this, "received %d bytes within a round trip of %d ns",
+        bdp_bytes_, rtt);
+
+  if (bdp_bytes_ * 3 < static_cast<uint64_t>(auto_window_size_) * 2)
+    return;
+  uint32_t window_size = static_cast<uint32_t>(
+      std::min<uint64_t>(bdp_bytes_ * 2, max_auto_window_size_));
+  if (window_size <= auto_window_size_)
+    return;
+
+  Debug(this, "growing flow control windows to %d", window_size);
+  auto_window_size_ = window_size;
+  CHECK_EQ(nghttp2_session_set_local_window_size(
+      session_.get(), NGHTTP2_FLAG_NONE, 0, window_size), 0);
+  for (const auto& kv : streams_)
+    UpdateStreamWindow(kv.second.get());
+}
+
+void Http2Session::UpdateStreamWindow(Http2Stream* stream) {
+  int32_t window_size = nghttp2_session_get_stream_effective_local_window_size(
+      session_.get(), stream->id());
+  if (window_size < 0 || static_cast<uint32_t>(window_size) >=
+                             auto_window_size_) {
+    return;
+  }
+  nghttp2_session_set_local_window_size(
+      session_.get(), NGHTTP2_FLAG_NONE, stream->id(), auto_window_size_);
+}
+
 // Called by OnFrameReceived when a complete SETTINGS frame has been received.
 void Http2Session::HandleSettingsFrame(const nghttp2_frame* frame) {
   bool ack = frame->hd.flags & NGHTTP2_FLAG_ACK;
@@ -1678,6 +1784,15 @@ void Http2Session::CopyDataIntoOutgoing(const uint8_t* src, size_t src_length) {
   outgoing_storage_.resize(offset + src_length);
   memcpy(&outgoing_storage_[offset], src, src_length);
 
+  // Copies are laid out in outgoing_storage_ in the order they are queued,
+  // so one that directly follows another extends its buffer.
+  if (!outgoing_buffers_.empty() &&
+      outgoing_buffers_.back().buf.base == nullptr) {
+    outgoing_buffers_.back().buf.len += src_length;
+    outgoing_length_ += src_length;
+    return;
+  }
+
   // Store with a base of `nullptr` initially, since future resizes
   // of the outgoing_buffers_ vector may invalidate the pointer.
   // The correct base pointers will be set later, before writing to the
@@ -1732,7 +1847,11 @@ uint8_t Http2Session::SendPendingData() {
 
   // Part Two: Pass Data to the underlying stream
 
-  size_t count = outgoing_buffers_.size();
+  size_t count = 0;
+  for (const NgHttp2StreamWrite& write : outgoing_buffers_) {
+    if (write.buf.len > 0)
+      count++;
+  }
   if (count == 0) {
     ClearOutgoing(0);
     return 0;
@@ -1747,6 +1866,9 @@ uint8_t Http2Session::SendPendingData() {
   size_t i = 0;
   for (const NgHttp2StreamWrite& write : outgoing_buffers_) {
     statistics_.data_sent += write.buf.len;
+    // Writes whose data was copied only stay around for their req_wrap.
+    if (write.buf.len == 0)
+      continue;
     if (write.buf.base == nullptr) {
       bufs[i++] = uv_buf_init(
           reinterpret_cast<char*>(outgoing_storage_.data() + offset),
@@ -1797,6 +1919,11 @@ int Http2Session::OnSendData(
   }
 
   Debug(session, "nghttp2 has %d bytes to send directly", length);
+  if (stream->file_source_) {
+    session->CopyDataIntoOutgoing(stream->file_source_->data(), length);
+    stream->file_source_->Consume(length);
+    length = 0;
+  }
   while (length > 0) {
     // nghttp2 thinks that there is data available (length > 0), which means
     // we told it so, which means that we *should* have data available.
@@ -1806,15 +1933,31 @@ int Http2Session::OnSendData(
     if (write.buf.len <= length) {
       // This write does not suffice by itself, so we can consume it completely.
       length -= write.buf.len;
-      session->PushOutgoingBuffer(std::move(write));
+      if (write.buf.len <= session->max_coalesced_write_size_) {
+        session->CopyDataIntoOutgoing(
+            reinterpret_cast<const uint8_t*>(write.buf.base), write.buf.len);
+        // The write is only done once the copy has been written, too.
+        if (write.req_wrap) {
+          session->PushOutgoingBuffer(NgHttp2StreamWrite {
+            std::move(write.req_wrap), uv_buf_init(nullptr, 0)
+          });
+        }
+      } else {
+        session->PushOutgoingBuffer(std::move(write));
+      }
       stream->queue_.pop();
       continue;
     }
 
     // Slice off `length` bytes of the first write in the queue.
-    session->PushOutgoingBuffer(NgHttp2StreamWrite {
-      uv_buf_init(write.buf.base, length)
-    });
+    if (length <= session->max_coalesced_write_size_) {
+      session->CopyDataIntoOutgoing(
+          reinterpret_cast<const uint8_t*>(write.buf.base), length);
+    } else {
+      session->PushOutgoingBuffer(NgHttp2StreamWrite {
+        uv_buf_init(write.buf.base, length)
+      });
+    }
     write.buf.base += length;
     write.buf.len -= length;
     break;
@@ -1822,9 +1965,15 @@ int Http2Session::OnSendData(
 
   if (frame->data.padlen > 0) {
     // Send padding if that was requested.
-    session->PushOutgoingBuffer(NgHttp2StreamWrite {
-      uv_buf_init(const_cast<char*>(zero_bytes_256), frame->data.padlen - 1)
-    });
+    if (session->max_coalesced_write_size_ > 0) {
+      session->CopyDataIntoOutgoing(
+          reinterpret_cast<const uint8_t*>(zero_bytes_256),
+          frame->data.padlen - 1);
+    } else {
+      session->PushOutgoingBuffer(NgHttp2StreamWrite {
+        uv_buf_init(const_cast<char*>(zero_bytes_256), frame->data.padlen - 1)
+      });
+    }
   }
 
   return 0;
@@ -1864,7 +2013,8 @@ void Http2Session::OnStreamRead(ssize_t nread, const uv_buf_t& buf_) {
   Http2Scope h2scope(this);
   CHECK_NOT_NULL(stream_);
   Debug(this, "receiving %d bytes, offset %d", nread, stream_buf_offset_);
-  std::unique_ptr<BackingStore> bs = env()->release_managed_buffer(buf_);
+  std::unique_ptr<BackingStore> bs =
+      env()->release_managed_buffer(buf_, nread > 0 ? nread : 0);
 
   // Only pass data on if nread > 0
   if (nread <= 0) {
@@ -1874,14 +2024,10 @@ void Http2Session::OnStreamRead(ssize_t nread, const uv_buf_t& buf_) {
     return;
   }
 
-  CHECK_LE(static_cast<size_t>(nread), bs->ByteLength());
-
   statistics_.data_received += nread;
 
-  if (LIKELY(stream_buf_offset_ == 0)) {
-    // Shrink to the actual amount of used data.
-    bs = BackingStore::Reallocate(env()->isolate(), std::move(bs), nread);
-  } else {
+  // `bs` already holds exactly the data that was read.
+  if (UNLIKELY(stream_buf_offset_ != 0)) {
     // This is a very unlikely case, and should only happen if the ReadStart()
     // call in OnStreamAfterWrite() immediately provides data. If that does
     // happen, we concatenate the data we received with the already-stored
@@ -1972,6 +2118,79 @@ void Http2Session::Receive(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+struct alignas(alignof(std::max_align_t)) Http2StreamPool::BlockHeader {
+  std::shared_ptr<Http2StreamPool> pool;
+};
+
+void* Http2StreamPool::Allocate(size_t size) {
+  CHECK_EQ(size, sizeof(Http2Stream));
+  void* block;
+  if (!free_blocks_.empty()) {
+    block = free_blocks_.back();
+    free_blocks_.pop_back();
+    cached_bytes_ -= sizeof(BlockHeader) + size;
+  } else {
+    block = ::operator new(sizeof(BlockHeader) + size);
+  }
+  BlockHeader* header = new (block) BlockHeader { shared_from_this() };
+  return header + 1;
+}
+
+void Http2StreamPool::Free(void* ptr) {
+  BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+  // This may be the last reference to the pool.
+  std::shared_ptr<Http2StreamPool> pool = std::move(header->pool);
+  header->~BlockHeader();
+  if (pool->closed_ || pool->free_blocks_.size() >= kMaxCachedStreams) {
+    ::operator delete(header);
+    return;
+  }
+  pool->free_blocks_.push_back(header);
+  pool->cached_bytes_ += sizeof(BlockHeader) + sizeof(Http2Stream);
+}
+
+std::vector<Http2Header> Http2StreamPool::TakeHeaderList() {
+  if (free_header_lists_.empty())
+    return std::vector<Http2Header>();
+  std::vector<Http2Header> list = std::move(free_header_lists_.back());
+  free_header_lists_.pop_back();
+  cached_bytes_ -= list.capacity() * sizeof(Http2Header);
+  return list;
+}
+
+void Http2StreamPool::ReturnHeaderList(std::vector<Http2Header>&& list) {
+  list.clear();
+  if (closed_ || list.capacity() == 0 ||
+      free_header_lists_.size() >= kMaxCachedStreams) {
+    return;
+  }
+  cached_bytes_ += list.capacity() * sizeof(Http2Header);
+  free_header_lists_.emplace_back(std::move(list));
+}
+
+// Called when the session closes. Streams that are still alive are freed
+// normally when they go away.
+void Http2StreamPool::Close() {
+  closed_ = true;
+  for (void* block : free_blocks_)
+    ::operator delete(block);
+  free_blocks_.clear();
+  free_header_lists_.clear();
+  cached_bytes_ = 0;
+}
+
+void* Http2Stream::operator new(size_t size, Http2Session* session) {
+  return session->stream_pool()->Allocate(size);
+}
+
+void Http2Stream::operator delete(void* ptr) {
+  Http2StreamPool::Free(ptr);
+}
+
+void Http2Stream::operator delete(void* ptr, Http2Session*) {
+  Http2StreamPool::Free(ptr);
+}
+
 Http2Stream* Http2Stream::New(Http2Session* session,
                               int32_t id,
                               nghttp2_headers_category category,
@@ -1983,7 +2202,7 @@ Http2Stream* Http2Stream::New(Http2Session* session,
            .ToLocal(&obj)) {
     return nullptr;
   }
-  return new Http2Stream(session, obj, id, category, options);
+  return new (session) Http2Stream(session, obj, id, category, options);
 }
 
 Http2Stream::Http2Stream(Http2Session* session,
@@ -2006,6 +2225,7 @@ Http2Stream::Http2Stream(Http2Session* session,
   if (max_header_pairs_ == 0) {
     max_header_pairs_ = DEFAULT_MAX_HEADER_LIST_PAIRS;
   }
+  current_headers_ = session->stream_pool()->TakeHeaderList();
   current_headers_.reserve(std::min(max_header_pairs_, 12u));
 
   // Limit the number of header octets
@@ -2028,11 +2248,14 @@ Http2Stream::Http2Stream(Http2Session* session,
 
 Http2Stream::~Http2Stream() {
   Debug(this, "tearing down stream");
+  if (session_)
+    session_->stream_pool()->ReturnHeaderList(std::move(current_headers_));
 }
 
 void Http2Stream::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("current_headers", current_headers_);
   tracker->TrackField("queue", queue_);
+  tracker->TrackField("file_source", file_source_);
 }
 
 std::string Http2Stream::diagnostic_name() const {
@@ -2157,6 +2380,36 @@ int Http2Stream::SubmitResponse(const Http2Headers& headers, int options) {
   return ret;
 }
 
+int Http2Stream::SubmitFileResponse(const Http2Headers& headers,
+                                    int options,
+                                    uv_file fd,
+                                    int64_t offset,
+                                    int64_t length) {
+  CHECK(!this->is_destroyed());
+  CHECK(is_writable());
+  CHECK(queue_.empty());
+  CHECK_NULL(file_source_);
+  Http2Scope h2scope(this);
+  Debug(this, "submitting file response");
+  if (options & STREAM_OPTION_GET_TRAILERS)
+    set_has_trailers();
+
+  file_source_ = std::make_unique<FileSource>(this, fd, offset, length);
+  Http2Stream::Provider::FD prov(this, options & ~STREAM_OPTION_EMPTY_PAYLOAD);
+  int ret = nghttp2_submit_response(
+      session_->session(),
+      id_,
+      headers.data(),
+      headers.length(),
+      *prov);
+  CHECK_NE(ret, NGHTTP2_ERR_NOMEM);
+  if (ret == 0)
+    file_source_->ReadMore();
+  else
+    file_source_.reset();
+  return ret;
+}
+
 
 // Submit informational headers for a stream.
 int Http2Stream::SubmitInfo(const Http2Headers& headers) {
@@ -2350,7 +2603,7 @@ int Http2Stream::DoWrite(WriteWrap* req_wrap,
                          uv_stream_t* send_handle) {
   CHECK_NULL(send_handle);
   Http2Scope h2scope(this);
-  if (!is_writable() || is_destroyed()) {
+  if (!is_writable() || is_destroyed() || file_source_) {
     req_wrap->Done(UV_EOF);
     return 0;
   }
@@ -2497,6 +2750,139 @@ ssize_t Http2Stream::Provider::Stream::OnRead(nghttp2_session* handle,
   return amount;
 }
 
+Http2Stream::Provider::FD::FD(Http2Stream* stream, int options)
+    : Http2Stream::Provider(stream, options) {
+  provider_.read_callback = Http2Stream::Provider::FD::OnRead;
+}
+
+ssize_t Http2Stream::Provider::FD::OnRead(nghttp2_session* handle,
+                                          int32_t id,
+                                          uint8_t* buf,
+                                          size_t length,
+                                          uint32_t* flags,
+                                          nghttp2_data_source* source,
+                                          void* user_data) {
+  Http2Session* session = static_cast<Http2Session*>(user_data);
+  Debug(session, "reading outbound file data for stream %d", id);
+  BaseObjectPtr<Http2Stream> stream = session->FindStream(id);
+  if (!stream) return 0;
+  if (stream->statistics_.first_byte_sent == 0)
+    stream->statistics_.first_byte_sent = uv_hrtime();
+  CHECK_EQ(id, stream->id());
+
+  FileSource* file = stream->file_source_.get();
+  CHECK_NOT_NULL(file);
+  if (file->error() != 0) {
+    Debug(session, "reading file for stream %d failed: %d", id, file->error());
+    return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+  }
+
+  size_t amount = std::min(file->unreserved(), length);
+  if (amount == 0 && !file->finished()) {
+    Debug(session, "deferring stream %d until file data is read", id);
+    file->ReadMore();
+    return NGHTTP2_ERR_DEFERRED;
+  }
+
+  if (amount > 0) {
+    *flags |= NGHTTP2_DATA_FLAG_NO_COPY;
+    file->Reserve(amount);
+  }
+
+  if (file->finished() && file->unreserved() == 0) {
+    Debug(session, "no more file data for stream %d", id);
+    *flags |= NGHTTP2_DATA_FLAG_EOF;
+    if (stream->has_trailers()) {
+      *flags |= NGHTTP2_DATA_FLAG_NO_END_STREAM;
+      stream->OnTrailers();
+    }
+  }
+
+  stream->statistics_.sent_bytes += amount;
+  return amount;
+}
+
+Http2Stream::FileSource::FileSource(Http2Stream* stream,
+                                    uv_file fd,
+                                    int64_t offset,
+                                    int64_t length)
+    : stream_(stream),
+      fd_(fd),
+      position_(offset),
+      remaining_(length),
+      buffer_(new char[kChunkSize]) {}
+
+Http2Stream::FileSource::~FileSource() {
+  CHECK(!reading_);
+}
+
+void Http2Stream::FileSource::ReadMore() {
+  if (reading_ || remaining_ == 0 || error_ != 0 || start_ != end_)
+    return;
+  size_t size = kChunkSize;
+  if (remaining_ > 0 && static_cast<uint64_t>(remaining_) < size)
+    size = static_cast<size_t>(remaining_);
+  start_ = end_ = reserved_ = 0;
+  uv_buf_t buf = uv_buf_init(buffer_.get(), size);
+  int err = uv_fs_read(stream_->env()->event_loop(),
+                       &req_,
+                       fd_,
+                       &buf,
+                       1,
+                       position_,
+                       OnReadDone);
+  if (err < 0) {
+    error_ = err;
+    return;
+  }
+  reading_ = true;
+  strong_ref_.reset(stream_);
+}
+
+void Http2Stream::FileSource::OnReadDone(uv_fs_t* req) {
+  FileSource* source = ContainerOf(&FileSource::req_, req);
+  // This may be the last reference to the stream, and to the source.
+  BaseObjectPtr<Http2Stream> stream = std::move(source->strong_ref_);
+  ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+  source->reading_ = false;
+
+  if (result < 0) {
+    source->error_ = static_cast<int>(result);
+  } else if (result == 0) {
+    source->remaining_ = 0;  // The file is shorter than expected.
+  } else {
+    source->end_ = static_cast<size_t>(result);
+    source->position_ += result;
+    if (source->remaining_ > 0)
+      source->remaining_ -= result;
+  }
+
+  Http2Session* session = stream->session();
+  if (stream->is_destroyed() || session == nullptr || session->is_destroyed())
+    return;
+  Http2Scope h2scope(stream.get());
+  CHECK_NE(nghttp2_session_resume_data(session->session(), stream->id()),
+           NGHTTP2_ERR_NOMEM);
+}
+
+void Http2Stream::FileSource::Reserve(size_t amount) {
+  CHECK_LE(amount, unreserved());
+  reserved_ += amount;
+}
+
+void Http2Stream::FileSource::Consume(size_t amount) {
+  CHECK_LE(amount, reserved_);
+  start_ += amount;
+  reserved_ -= amount;
+  // The data has been copied, so the buffer can be reused right away.
+  ReadMore();
+}
+
+void Http2Stream::FileSource::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("buffer", kChunkSize);
+}
+
 void Http2Stream::IncrementAvailableOutboundLength(size_t amount) {
   available_outbound_length_ += amount;
   session_->IncrementCurrentSessionMemory(amount);
@@ -2538,6 +2924,50 @@ void RefreshDefaultSettings(const FunctionCallbackInfo<Value>& args) {
   Http2Settings::RefreshDefaults(state);
 }
 
+Http2HeaderSet::Http2HeaderSet(Environment* env, Local<Array> headers)
+    : headers_(env, headers) {
+  nghttp2_nv* nva = headers_.data();
+  for (size_t n = 0; n < headers_.length(); n++)
+    nva[n].flags |=
+        NGHTTP2_NV_FLAG_NO_COPY_NAME | NGHTTP2_NV_FLAG_NO_COPY_VALUE;
+}
+
+void Http2HeaderSet::MemoryInfo(MemoryTracker* tracker) const {
+  size_t size = 0;
+  const nghttp2_nv* nva = headers_.data();
+  for (size_t n = 0; n < headers_.length(); n++)
+    size += sizeof(nva[n]) + nva[n].namelen + nva[n].valuelen;
+  tracker->TrackFieldWithSize("headers", size);
+}
+
+// Header lists are passed from JS either as a [string, count] array, or as
+// the index that compileHeaders() returned for them. Returns nullptr in the
+// first case.
+const Http2HeaderSet* GetHeaderSet(const FunctionCallbackInfo<Value>& args,
+                                   Local<Value> headers) {
+  if (!headers->IsUint32())
+    return nullptr;
+  Http2State* state = Environment::GetBindingData<Http2State>(args);
+  uint32_t index = headers.As<Uint32>()->Value();
+  CHECK_LT(index, state->header_sets.size());
+  return state->header_sets[index].get();
+}
+
+// compileHeaders(headers) builds a header list that can be passed to
+// respond() and trailers() in place of the array, and returns its index, or
+// -1 if too many header lists have been compiled already.
+void CompileHeaders(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Http2State* state = Environment::GetBindingData<Http2State>(args);
+  CHECK(args[0]->IsArray());
+  if (state->header_sets.size() >= Http2State::kMaxHeaderSets)
+    return args.GetReturnValue().Set(-1);
+  state->header_sets.emplace_back(
+      std::make_unique<Http2HeaderSet>(env, args[0].As<Array>()));
+  args.GetReturnValue().Set(
+      static_cast<uint32_t>(state->header_sets.size() - 1));
+}
+
 // Sets the next stream ID the Http2Session. If successful, returns true.
 void Http2Session::SetNextStreamID(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
@@ -2755,14 +3185,46 @@ void Http2Stream::Respond(const FunctionCallbackInfo<Value>& args) {
   Http2Stream* stream;
   ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
 
+  int32_t options = args[1]->Int32Value(env->context()).ToChecked();
+
+  if (const Http2HeaderSet* set = GetHeaderSet(args, args[0])) {
+    args.GetReturnValue().Set(
+        stream->SubmitResponse(set->headers(), static_cast<int>(options)));
+  } else {
+    Local<Array> headers = args[0].As<Array>();
+    args.GetReturnValue().Set(
+        stream->SubmitResponse(
+            Http2Headers(env, headers),
+            static_cast<int>(options)));
+  }
+  Debug(stream, "response submitted");
+}
+
+// respondWithFD(headers, options, fd, offset, length) sends a response whose
+// payload is read from the file by the stream itself.
+void Http2Stream::RespondWithFD(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Http2Stream* stream;
+  ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
+
   Local<Array> headers = args[0].As<Array>();
   int32_t options = args[1]->Int32Value(env->context()).ToChecked();
+  CHECK(args[2]->IsInt32());
+  uv_file fd = args[2].As<Int32>()->Value();
+  CHECK(args[3]->IsNumber());
+  int64_t offset = args[3]->IntegerValue(env->context()).ToChecked();
+  CHECK_GE(offset, 0);
+  CHECK(args[4]->IsNumber());
+  int64_t length = args[4]->IntegerValue(env->context()).ToChecked();
 
   args.GetReturnValue().Set(
-      stream->SubmitResponse(
+      stream->SubmitFileResponse(
           Http2Headers(env, headers),
-          static_cast<int>(options)));
-  Debug(stream, "response submitted");
+          static_cast<int>(options),
+          fd,
+          offset,
+          length));
+  Debug(stream, "file response submitted");
 }
 
 
@@ -2783,6 +3245,11 @@ void Http2Stream::Trailers(const FunctionCallbackInfo<Value>& args) {
   Http2Stream* stream;
   ASSIGN_OR_RETURN_UNWRAP(&stream, args.Holder());
 
+  if (const Http2HeaderSet* set = GetHeaderSet(args, args[0])) {
+    args.GetReturnValue().Set(stream->SubmitTrailers(set->headers()));
+    return;
+  }
+
   Local<Array> headers = args[0].As<Array>();
 
   args.GetReturnValue().Set(
@@ -3131,8 +3598,11 @@ void SetCallbackFunctions(const FunctionCallbackInfo<Value>& args) {
 #undef SET_FUNCTION
 }
 
+Http2State::~Http2State() = default;
+
 void Http2State::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("root_buffer", root_buffer);
+  tracker->TrackField("header_sets", header_sets);
 }
 
 // TODO(addaleax): Remove once we're on C++17.
@@ -3187,6 +3657,7 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "nghttp2ErrorString", HttpErrorString);
   env->SetMethod(target, "refreshDefaultSettings", RefreshDefaultSettings);
   env->SetMethod(target, "packSettings", PackSettings);
+  env->SetMethod(target, "compileHeaders", CompileHeaders);
   env->SetMethod(target, "setCallbackFunctions", SetCallbackFunctions);
 
   Local<FunctionTemplate> ping = FunctionTemplate::New(env->isolate());
@@ -3210,6 +3681,7 @@ void Initialize(Local<Object> target,
   env->SetProtoMethod(stream, "info", Http2Stream::Info);
   env->SetProtoMethod(stream, "trailers", Http2Stream::Trailers);
   env->SetProtoMethod(stream, "respond", Http2Stream::Respond);
+  env->SetProtoMethod(stream, "respondWithFD", Http2Stream::RespondWithFD);
   env->SetProtoMethod(stream, "rstStream", Http2Stream::RstStream);
   env->SetProtoMethod(stream, "refreshState", Http2Stream::RefreshState);
   stream->Inherit(AsyncWrap::GetConstructorTemplate(env));
@@ -17,6 +17,7 @@
 #include "string_bytes.h"
 
 #include <algorithm>
+#include <memory>
 #include <queue>
 
 namespace node {
@@ -38,6 +39,16 @@ constexpr size_t kDefaultMaxSettings = 10;
 // Default maximum total memory cap for Http2Session.
 constexpr uint64_t kDefaultMaxSessionMemory = 10000000;
 
+// DATA payloads up to this size are copied into the session's outgoing
+// storage next to the frame headers, instead of being written as buffers of
+// their own.
+constexpr size_t kDefaultMaxCoalescedWriteSize = 4096;
+
+// The shortest time between two PINGs that estimate the bandwidth-delay
+// product of a session when its flow control windows are tuned
+// automatically.
+constexpr uint64_t kMinBdpProbeIntervalNs = 100 * 1000 * 1000;
+
 // These are the standard HTTP/2 defaults as specified by the RFC
 constexpr uint32_t DEFAULT_SETTINGS_HEADER_TABLE_SIZE = 4096;
 constexpr uint32_t DEFAULT_SETTINGS_ENABLE_PUSH = 1;
@@ -143,6 +154,24 @@ struct Http2RcBufferPointerTraits {
 using Http2Headers = NgHeaders<Http2HeadersTraits>;
 using Http2RcBufferPointer = NgRcBufPointer<Http2RcBufferPointerTraits>;
 
+// A header list that is built once by compileHeaders() and can then be
+// submitted on any number of streams, instead of being rebuilt from a JS
+// string every time. It lives as long as the Http2State, so nghttp2 is told
+// not to copy its names and values.
+class Http2HeaderSet final : public MemoryRetainer {
+ public:
+  Http2HeaderSet(Environment* env, v8::Local<v8::Array> headers);
+
+  const Http2Headers& headers() const { return headers_; }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(Http2HeaderSet)
+  SET_SELF_SIZE(Http2HeaderSet)
+
+ private:
+  Http2Headers headers_;
+};
+
 struct NgHttp2StreamWrite : public MemoryRetainer {
   BaseObjectPtr<AsyncWrap> req_wrap;
   uv_buf_t buf;
@@ -233,9 +262,27 @@ class Http2Options {
     return max_session_memory_;
   }
 
+  void set_max_coalesced_write_size(size_t max) {
+    max_coalesced_write_size_ = max;
+  }
+
+  size_t max_coalesced_write_size() const {
+    return max_coalesced_write_size_;
+  }
+
+  void set_max_auto_window_size(uint32_t max) {
+    max_auto_window_size_ = max;
+  }
+
+  uint32_t max_auto_window_size() const {
+    return max_auto_window_size_;
+  }
+
  private:
   Nghttp2OptionPointer options_;
   uint64_t max_session_memory_ = kDefaultMaxSessionMemory;
+  size_t max_coalesced_write_size_ = kDefaultMaxCoalescedWriteSize;
+  uint32_t max_auto_window_size_ = 0;
   uint32_t max_header_pairs_ = DEFAULT_MAX_HEADER_LIST_PAIRS;
   PaddingStrategy padding_strategy_ = PADDING_STRATEGY_NONE;
   size_t max_outstanding_pings_ = kDefaultMaxPings;
@@ -266,6 +313,41 @@ struct Http2HeaderTraits {
 
 using Http2Header = NgHeader<Http2HeaderTraits>;
 
+// Keeps the memory of a session's destroyed Http2Streams, and the header
+// lists they received into, for the next streams of the same session. A
+// stream may outlive its session, so every block holds on to its pool, and
+// once the session has closed the pool stops caching and releases whatever
+// it still holds.
+class Http2StreamPool final
+    : public std::enable_shared_from_this<Http2StreamPool> {
+ public:
+  static constexpr size_t kMaxCachedStreams = 64;
+
+  Http2StreamPool() = default;
+  ~Http2StreamPool() { Close(); }
+  Http2StreamPool(const Http2StreamPool&) = delete;
+  Http2StreamPool& operator=(const Http2StreamPool&) = delete;
+
+  void* Allocate(size_t size);
+  static void Free(void* ptr);
+
+  std::vector<Http2Header> TakeHeaderList();
+  void ReturnHeaderList(std::vector<Http2Header>&& list);
+
+  void Close();
+
+  // The memory held for reuse, which counts against the session's limit.
+  size_t cached_bytes() const { return cached_bytes_; }
+
+ private:
+  struct BlockHeader;
+
+  bool closed_ = false;
+  size_t cached_bytes_ = 0;
+  std::vector<void*> free_blocks_;
+  std::vector<std::vector<Http2Header>> free_header_lists_;
+};
+
 class Http2Stream : public AsyncWrap,
                     public StreamBase {
  public:
@@ -276,6 +358,11 @@ class Http2Stream : public AsyncWrap,
       int options = 0);
   ~Http2Stream() override;
 
+  // Streams are allocated from the Http2StreamPool of their session.
+  static void* operator new(size_t size, Http2Session* session);
+  static void operator delete(void* ptr);
+  static void operator delete(void* ptr, Http2Session* session);
+
   nghttp2_stream* operator*() const;
 
   nghttp2_stream* stream() const;
@@ -298,6 +385,15 @@ class Http2Stream : public AsyncWrap,
   // Initiate a response on this stream.
   int SubmitResponse(const Http2Headers& headers, int options);
 
+  // Initiate a response on this stream whose payload is read from `fd`,
+  // starting at `offset`, for `length` bytes or up to the end of the file
+  // if `length` is negative. The file descriptor is not closed.
+  int SubmitFileResponse(const Http2Headers& headers,
+                         int options,
+                         uv_file fd,
+                         int64_t offset,
+                         int64_t length);
+
   // Submit informational headers for this stream
   int SubmitInfo(const Http2Headers& headers);
 
@@ -448,8 +544,10 @@ class Http2Stream : public AsyncWrap,
   static void Info(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Trailers(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Respond(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void RespondWithFD(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void RstStream(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  class FileSource;
   class Provider;
 
   struct Statistics {
@@ -500,6 +598,10 @@ class Http2Stream : public AsyncWrap,
   std::queue<NgHttp2StreamWrite> queue_;
   size_t available_outbound_length_ = 0;
 
+  // Set instead of the queue above for responses sent with
+  // SubmitFileResponse().
+  std::unique_ptr<FileSource> file_source_;
+
   Http2StreamListener stream_listener_;
 
   friend class Http2Session;
@@ -538,6 +640,74 @@ class Http2Stream::Provider::Stream : public Http2Stream::Provider {
                         void* user_data);
 };
 
+// The FD Provider hands out the file data buffered by the stream's
+// FileSource. Like the Stream Provider, it only tells nghttp2 how much data
+// there is, and Http2Session::OnSendData copies it into the outgoing
+// buffers.
+class Http2Stream::Provider::FD : public Http2Stream::Provider {
+ public:
+  FD(Http2Stream* stream, int options);
+
+  static ssize_t OnRead(nghttp2_session* session,
+                        int32_t id,
+                        uint8_t* buf,
+                        size_t length,
+                        uint32_t* flags,
+                        nghttp2_data_source* source,
+                        void* user_data);
+};
+
+// Reads the payload of a file response on the threadpool, one chunk at a
+// time. The next chunk is read once the current one has been sent.
+class Http2Stream::FileSource final : public MemoryRetainer {
+ public:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  FileSource(Http2Stream* stream, uv_file fd, int64_t offset, int64_t length);
+  ~FileSource() override;
+
+  FileSource(const FileSource&) = delete;
+  FileSource& operator=(const FileSource&) = delete;
+
+  // Starts reading the next chunk, unless one is still being read or sent.
+  void ReadMore();
+
+  // Bytes that have been read but not handed to nghttp2 yet.
+  size_t unreserved() const { return end_ - start_ - reserved_; }
+  void Reserve(size_t amount);
+  // The reserved data, which is released again by Consume() once it has
+  // been copied into the session's outgoing buffers.
+  const uint8_t* data() const {
+    return reinterpret_cast<const uint8_t*>(buffer_.get() + start_);
+  }
+  void Consume(size_t amount);
+
+  // True once everything up to the end of the file or range has been read.
+  bool finished() const { return remaining_ == 0 && !reading_; }
+  int error() const { return error_; }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(Http2StreamFileSource)
+  SET_SELF_SIZE(FileSource)
+
+ private:
+  static void OnReadDone(uv_fs_t* req);
+
+  Http2Stream* stream_;
+  // Keeps the stream alive while a read is in progress.
+  BaseObjectPtr<Http2Stream> strong_ref_;
+  uv_fs_t req_;
+  uv_file fd_;
+  int64_t position_;
+  int64_t remaining_;  // Negative if reading up to the end of the file.
+  std::unique_ptr<char[]> buffer_;
+  size_t start_ = 0;
+  size_t end_ = 0;
+  size_t reserved_ = 0;
+  bool reading_ = false;
+  int error_ = 0;
+};
+
 struct SessionJSFields {
   uint8_t bitfield;
   uint8_t priority_listener_count;
@@ -615,6 +785,7 @@ class Http2Session : public AsyncWrap,
   nghttp2_session* operator*() { return session_.get(); }
 
   uint32_t max_header_pairs() const { return max_header_pairs_; }
+  Http2StreamPool* stream_pool() const { return stream_pool_.get(); }
 
   const char* TypeName() const;
 
@@ -748,6 +919,7 @@ class Http2Session : public AsyncWrap,
     uint64_t total = current_session_memory_ + sizeof(Http2Session);
     total += current_nghttp2_memory_;
     total += outgoing_storage_.size();
+    total += stream_pool_->cached_bytes();
     return total;
   }
 
@@ -788,6 +960,11 @@ class Http2Session : public AsyncWrap,
   void HandlePriorityFrame(const nghttp2_frame* frame);
   void HandleSettingsFrame(const nghttp2_frame* frame);
   void HandlePingFrame(const nghttp2_frame* frame);
+
+  // Flow control window auto-tuning
+  void UpdateBdpEstimate(size_t length);
+  void OnBdpPingAck();
+  void UpdateStreamWindow(Http2Stream* stream);
   void HandleAltSvcFrame(const nghttp2_frame* frame);
   void HandleOriginFrame(const nghttp2_frame* frame);
 
@@ -887,6 +1064,9 @@ class Http2Session : public AsyncWrap,
   // The amount of memory allocated by nghttp2 internals
   uint64_t current_nghttp2_memory_ = 0;
 
+  // Declared before streams_, which may free streams when it goes away.
+  std::shared_ptr<Http2StreamPool> stream_pool_ =
+      std::make_shared<Http2StreamPool>();
   // The collection of active Http2Streams associated with this session
   std::unordered_map<int32_t, BaseObjectPtr<Http2Stream>> streams_;
 
@@ -917,7 +1097,17 @@ class Http2Session : public AsyncWrap,
   std::vector<NgHttp2StreamWrite> outgoing_buffers_;
   std::vector<uint8_t> outgoing_storage_;
   size_t outgoing_length_ = 0;
+  size_t max_coalesced_write_size_ = kDefaultMaxCoalescedWriteSize;
   std::vector<int32_t> pending_rst_streams_;
+
+  // When max_auto_window_size_ is set, the connection and stream windows
+  // grow towards twice the bandwidth-delay product, which is estimated by
+  // counting the DATA received during the round trip of a PING.
+  uint32_t max_auto_window_size_ = 0;
+  uint32_t auto_window_size_ = 0;
+  uint64_t bdp_probe_start_ = 0;  // 0 if no PING is outstanding
+  uint64_t bdp_last_probe_ = 0;
+  uint64_t bdp_bytes_ = 0;
   // Count streams that have been rejected while being opened. Exceeding a fixed
   // limit will result in the session being destroyed, as an indication of a
   // misbehaving peer. This counter is reset once new streams are being
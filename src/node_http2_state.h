@@ -5,11 +5,16 @@
 
 #include "aliased_buffer.h"
 
+#include <memory>
+#include <vector>
+
 struct nghttp2_rcbuf;
 
 namespace node {
 namespace http2 {
 
+class Http2HeaderSet;
+
   enum Http2SettingsIndex {
     IDX_SETTINGS_HEADER_TABLE_SIZE,
     IDX_SETTINGS_ENABLE_PUSH,
@@ -55,6 +60,8 @@ namespace http2 {
     IDX_OPTIONS_MAX_OUTSTANDING_SETTINGS,
     IDX_OPTIONS_MAX_SESSION_MEMORY,
     IDX_OPTIONS_MAX_SETTINGS,
+    IDX_OPTIONS_MAX_COALESCED_WRITE_SIZE,
+    IDX_OPTIONS_MAX_AUTO_WINDOW_SIZE,
     IDX_OPTIONS_FLAGS
   };
 
@@ -114,6 +121,7 @@ class Http2State : public BaseObject {
                         offsetof(http2_state_internal, settings_buffer),
                         IDX_SETTINGS_COUNT + 1,
                         root_buffer) {}
+  ~Http2State() override;
 
   AliasedUint8Array root_buffer;
   AliasedFloat64Array session_state_buffer;
@@ -123,6 +131,11 @@ class Http2State : public BaseObject {
   AliasedUint32Array options_buffer;
   AliasedUint32Array settings_buffer;
 
+  // Header lists registered with compileHeaders(). They are kept for as long
+  // as the binding is, because frames may still point into them.
+  static constexpr size_t kMaxHeaderSets = 1024;
+  std::vector<std::unique_ptr<Http2HeaderSet>> header_sets;
+
   void MemoryInfo(MemoryTracker* tracker) const override;
   SET_SELF_SIZE(Http2State)
   SET_MEMORY_INFO_NAME(Http2State)
@@ -261,6 +261,10 @@ class NgHeaders {
     return reinterpret_cast<const nv_t*>(*buf_);
   }
 
+  nv_t* data() {
+    return reinterpret_cast<nv_t*>(*buf_);
+  }
+
   size_t length() const {
     return count_;
   }
@@ -26,12 +26,21 @@
 #include "async_wrap-inl.h"
 #include "env-inl.h"
 #include "memory_tracker-inl.h"
+#include "memory_budget.h"
+#include "node_errors.h"
+#include "node_http_common.h"
+#include "server_counters.h"
+#include "node_usdt.h"
 #include "stream_base-inl.h"
+#include "string_bytes.h"
 #include "v8.h"
 #include "llhttp.h"
 
 #include <cstdlib>  // free()
 #include <cstring>  // strdup(), strchr()
+#include <memory>
+#include <string>
+#include <vector>
 
 
 // This is a binding to llhttp (https://github.com/nodejs/llhttp)
@@ -50,21 +59,29 @@ namespace node {
 namespace {  // NOLINT(build/namespaces)
 
 using v8::Array;
+using v8::ArrayBuffer;
+using v8::BackingStore;
 using v8::Boolean;
 using v8::Context;
+using v8::Eternal;
 using v8::EscapableHandleScope;
 using v8::Exception;
+using v8::False;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
 using v8::Integer;
+using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
+using v8::NewStringType;
 using v8::Number;
 using v8::Object;
 using v8::String;
+using v8::True;
 using v8::Uint32;
 using v8::Undefined;
 using v8::Value;
@@ -76,8 +93,10 @@ const uint32_t kOnBody = 3;
 const uint32_t kOnMessageComplete = 4;
 const uint32_t kOnExecute = 5;
 const uint32_t kOnTimeout = 6;
-// Any more fields than this will be flushed into JS
-const size_t kMaxHeaderFieldsCount = 32;
+const uint32_t kOnMessages = 7;
+// Header fields that a parser has room for up front. The storage grows as
+// needed, so that all headers of a message reach JS in one go.
+const size_t kInitialHeaderFieldsCount = 32;
 
 const uint32_t kLenientNone = 0;
 const uint32_t kLenientHeaders = 1 << 0;
@@ -100,8 +119,22 @@ class BindingData : public BaseObject {
   std::vector<char> parser_buffer;
   bool parser_buffer_in_use = false;
 
+  // Parsers that JS has released, to be handed out again by
+  // getPooledParser(). Holding on to their objects keeps them alive.
+  static constexpr size_t kMaxPooledParsers = 1000;
+  std::vector<Global<Object>> parser_pool;
+
+  // What writeResponseHead() serializes into. Once a write of it does not
+  // complete right away, it belongs to the write, and a new one is made.
+  static constexpr size_t kHeadSlabSize = 16 * 1024;
+  std::unique_ptr<BackingStore> head_slab;
+
   void MemoryInfo(MemoryTracker* tracker) const override {
     tracker->TrackField("parser_buffer", parser_buffer);
+    tracker->TrackFieldWithSize("parser_pool",
+                                parser_pool.size() * sizeof(Global<Object>));
+    if (head_slab)
+      tracker->TrackFieldWithSize("head_slab", head_slab->ByteLength());
   }
   SET_SELF_SIZE(BindingData)
   SET_MEMORY_INFO_NAME(BindingData)
@@ -109,6 +142,78 @@ class BindingData : public BaseObject {
 
 // TODO(addaleax): Remove once we're on C++17.
 constexpr FastStringKey BindingData::type_name;
+constexpr size_t BindingData::kMaxPooledParsers;
+constexpr size_t BindingData::kHeadSlabSize;
+
+// HTTP/1 header names are case-insensitive, but the parser passes them on as
+// they appear on the wire. The two common spellings of the well-known names
+// from node_http_common.h, lower case and Title-Case, are recognized here so
+// that the parser can hand out one internalized string per isolate for them
+// instead of allocating a new string for every header of every message.
+class WellKnownHeaders {
+ public:
+  static const WellKnownHeaders& Get() {
+    // Intentionally leaked, parsers in worker threads may still use it
+    // during exit.
+    static const WellKnownHeaders* headers = new WellKnownHeaders();
+    return *headers;
+  }
+
+  // Returns the key of the name in IsolateData::static_str_map, or nullptr
+  // if `str` is not a well-known header name in one of the two spellings.
+  const char* Find(const char* str, size_t size) const {
+    if (size == 0 || size > kMaxLength)
+      return nullptr;
+    for (const std::string* name : by_length_[size]) {
+      if (memcmp(name->data(), str, size) == 0)
+        return name->c_str();
+    }
+    return nullptr;
+  }
+
+  size_t size() const { return kCount; }
+  // The Title-Case spelling of the name with the given index, in the order
+  // of HTTP_REGULAR_HEADERS and HTTP_ADDITIONAL_HEADERS.
+  const std::string& TitleCase(size_t index) const {
+    return names_[index * 2 + 1];
+  }
+
+ private:
+  static constexpr size_t kCount = 0
+#define V(name, value) + 1
+      HTTP_REGULAR_HEADERS(V)
+      HTTP_ADDITIONAL_HEADERS(V);
+#undef V
+  static constexpr size_t kMaxLength = 32;
+
+  WellKnownHeaders() {
+    static const char* const lower[] = {
+#define V(name, value) value,
+      HTTP_REGULAR_HEADERS(V)
+      HTTP_ADDITIONAL_HEADERS(V)
+#undef V
+    };
+    static_assert(arraysize(lower) == kCount, "header count mismatch");
+
+    for (size_t i = 0; i < kCount; i++) {
+      std::string title = lower[i];
+      for (size_t j = 0; j < title.size(); j++) {
+        if (j == 0 || title[j - 1] == '-')
+          title[j] = ToUpper(title[j]);
+      }
+      names_[i * 2] = lower[i];
+      names_[i * 2 + 1] = std::move(title);
+    }
+
+    for (const std::string& name : names_) {
+      CHECK_LE(name.size(), kMaxLength);
+      by_length_[name.size()].push_back(&name);
+    }
+  }
+
+  std::string names_[kCount * 2];
+  std::vector<const std::string*> by_length_[kMaxLength + 1];
+};
 
 // helper class for the Parser
 struct StringPtr {
@@ -117,6 +222,15 @@ struct StringPtr {
     Reset();
   }
 
+  StringPtr(StringPtr&& other) noexcept
+      : str_(other.str_), on_heap_(other.on_heap_), size_(other.size_) {
+    other.on_heap_ = false;
+    other.Reset();
+  }
+
+  StringPtr(const StringPtr&) = delete;
+  StringPtr& operator=(const StringPtr&) = delete;
+
 
   ~StringPtr() {
     Reset();
@@ -136,6 +250,12 @@ struct StringPtr {
   }
 
 
+  // The bytes that Save() or Update() copied, if any.
+  size_t heap_size() const {
+    return on_heap_ ? size_ : 0;
+  }
+
+
   void Reset() {
     if (on_heap_) {
       delete[] str_;
@@ -197,25 +317,45 @@ class Parser : public AsyncWrap, public StreamListener {
         current_buffer_len_(0),
         current_buffer_data_(nullptr),
         binding_data_(binding_data) {
+    fields_.reserve(kInitialHeaderFieldsCount);
+    values_.reserve(kInitialHeaderFieldsCount);
+  }
+
+  ~Parser() override {
+    if (charged_budget_ != nullptr)
+      charged_budget_->Release(charged_bytes_);
   }
 
 
   void MemoryInfo(MemoryTracker* tracker) const override {
     tracker->TrackField("current_buffer", current_buffer_);
+    tracker->TrackFieldWithSize(
+        "headers",
+        (fields_.capacity() + values_.capacity()) * sizeof(StringPtr));
+    tracker->TrackFieldWithSize("read_slab",
+                                read_slab_ ? read_slab_->ByteLength() : 0);
   }
 
   SET_MEMORY_INFO_NAME(Parser)
   SET_SELF_SIZE(Parser)
 
   int on_message_begin() {
+    NODE_USDT_PROBE1(http__parser__message__begin, NODE_USDT_PTR(this));
     num_fields_ = num_values_ = 0;
     url_.Reset();
     status_message_.Reset();
     header_parsing_start_time_ = uv_hrtime();
+    if (parser_.type == HTTP_REQUEST && stream_ != nullptr) {
+      if (ServerCounters* counters = stream_->server_counters())
+        counters->requests++;
+    }
 
     Local<Value> cb = object()->Get(env()->context(), kOnMessageBegin)
                               .ToLocalChecked();
     if (cb->IsFunction()) {
+      if (DispatchMessages() != 0)
+        return -1;
+
       InternalCallbackScope callback_scope(
         this, InternalCallbackScope::kSkipTaskQueues);
 
@@ -260,16 +400,16 @@ class Parser : public AsyncWrap, public StreamListener {
     if (num_fields_ == num_values_) {
       // start of new field name
       num_fields_++;
-      if (num_fields_ == kMaxHeaderFieldsCount) {
-        // ran out of space - flush to javascript land
-        Flush();
-        num_fields_ = 1;
-        num_values_ = 0;
+      if (num_fields_ > fields_.size()) {
+        // The space is kept for later messages, so this only happens until
+        // the parser has seen its largest header set.
+        fields_.emplace_back();
+        values_.emplace_back();
       }
       fields_[num_fields_ - 1].Reset();
     }
 
-    CHECK_LT(num_fields_, kMaxHeaderFieldsCount);
+    CHECK_LE(num_fields_, fields_.size());
     CHECK_EQ(num_fields_, num_values_ + 1);
 
     fields_[num_fields_ - 1].Update(at, length);
@@ -290,7 +430,7 @@ class Parser : public AsyncWrap, public StreamListener {
       values_[num_values_ - 1].Reset();
     }
 
-    CHECK_LT(num_values_, arraysize(values_));
+    CHECK_LE(num_values_, values_.size());
     CHECK_EQ(num_values_, num_fields_);
 
     values_[num_values_ - 1].Update(at, length);
@@ -369,6 +509,34 @@ class Parser : public AsyncWrap, public StreamListener {
 
     argv[A_UPGRADE] = Boolean::New(env()->isolate(), parser_.upgrade);
 
+    // Requests that are not upgraded, and whose headers have not been
+    // partially flushed already, can be passed on to JS later together with
+    // the other messages parsed by this execute(). JS does not get to tell
+    // the parser to skip the body of a request, so its return value is not
+    // needed here.
+    if (batch_messages_ && parser_.type == HTTP_REQUEST &&
+        !parser_.upgrade && !have_flushed_) {
+      Local<Value> messages_cb =
+          obj->Get(env()->context(), kOnMessages).ToLocalChecked();
+      if (messages_cb->IsFunction()) {
+        if (pending_messages_.IsEmpty())
+          pending_messages_ = Array::New(env()->isolate());
+        for (size_t i = 0; i < arraysize(argv); i++) {
+          pending_messages_->Set(env()->context(),
+                                 pending_messages_length_++,
+                                 argv[i]).Check();
+        }
+        pending_messages_->Set(env()->context(),
+                               pending_messages_length_++,
+                               False(env()->isolate())).Check();
+        message_is_pending_ = true;
+        return 0;
+      }
+    }
+
+    if (DispatchMessages() != 0)
+      return -1;
+
     MaybeLocal<Value> head_response;
     {
       InternalCallbackScope callback_scope(
@@ -392,6 +560,28 @@ class Parser : public AsyncWrap, public StreamListener {
 
 
   int on_body(const char* at, size_t length) {
+    if (DispatchMessages() != 0)
+      return HPE_USER;
+
+    if (zero_copy_body_) {
+      bool contiguous = !pending_body_.empty() &&
+          pending_body_.back().data + pending_body_.back().length == at;
+      // Only a single fragment is passed on without copying, so limit how
+      // much is gathered up once there is more than one.
+      if ((!contiguous || pending_body_.size() > 1) &&
+          pending_body_length_ + length > kMaxCoalescedBodySize) {
+        if (FlushBody() != 0)
+          return HPE_USER;
+        contiguous = false;
+      }
+      if (contiguous)
+        pending_body_.back().length += length;
+      else
+        pending_body_.push_back({ at, length });
+      pending_body_length_ += length;
+      return 0;
+    }
+
     EscapableHandleScope scope(env()->isolate());
 
     Local<Object> obj = object();
@@ -429,12 +619,145 @@ class Parser : public AsyncWrap, public StreamListener {
   }
 
 
+  // Passes the requests that on_headers_complete() held back in batch mode
+  // to JS in a single onMessages callback. For every request, the array
+  // holds the onHeadersComplete arguments, followed by whether the request
+  // is complete already, in which case there is no onMessageComplete call
+  // for it.
+  int DispatchMessages() {
+    if (pending_messages_.IsEmpty())
+      return 0;
+
+    HandleScope scope(env()->isolate());
+    Local<Value> argv[] = { pending_messages_ };
+    pending_messages_.Clear();
+    pending_messages_length_ = 0;
+    message_is_pending_ = false;
+
+    Local<Value> cb =
+        object()->Get(env()->context(), kOnMessages).ToLocalChecked();
+    CHECK(cb->IsFunction());
+
+    MaybeLocal<Value> r;
+    {
+      InternalCallbackScope callback_scope(
+          this, InternalCallbackScope::kSkipTaskQueues);
+      r = cb.As<Function>()->Call(
+          env()->context(), object(), arraysize(argv), argv);
+      if (r.IsEmpty()) callback_scope.MarkAsFailed();
+    }
+
+    if (r.IsEmpty()) {
+      got_exception_ = true;
+      llhttp_set_error_reason(&parser_, "HPE_JS_EXCEPTION:JS Exception");
+      return -1;
+    }
+
+    return 0;
+  }
+
+
+  // Passes the body fragments that on_body() gathered in zero-copy mode to
+  // JS in a single callback. One fragment is passed as a slice of the data
+  // being parsed, several are copied into a new buffer together.
+  int FlushBody() {
+    if (pending_body_.empty())
+      return 0;
+
+    EscapableHandleScope scope(env()->isolate());
+    Isolate* isolate = env()->isolate();
+    size_t length = pending_body_length_;
+
+    Local<Value> cb =
+        object()->Get(env()->context(), kOnBody).ToLocalChecked();
+    if (!cb->IsFunction()) {
+      pending_body_.clear();
+      pending_body_length_ = 0;
+      return 0;
+    }
+
+    Local<Object> buffer;
+    size_t offset = 0;
+    // A small fragment is not worth handing the whole read slab over to JS,
+    // which would then have to allocate a new one for the next read.
+    if (pending_body_.size() == 1 &&
+        (length >= kMinSlicedBodySize || !IsReadSlab(current_buffer_data_))) {
+      if (current_buffer_.IsEmpty())
+        current_buffer_ = scope.Escape(BufferFromRead());
+      buffer = current_buffer_;
+      offset = pending_body_[0].data - current_buffer_data_;
+    } else {
+      buffer = Buffer::New(isolate, length).ToLocalChecked();
+      char* dest = Buffer::Data(buffer);
+      for (const BodyFragment& fragment : pending_body_) {
+        memcpy(dest, fragment.data, fragment.length);
+        dest += fragment.length;
+      }
+    }
+    pending_body_.clear();
+    pending_body_length_ = 0;
+
+    Local<Value> argv[3] = {
+        buffer,
+        Integer::NewFromUnsigned(isolate, static_cast<uint32_t>(offset)),
+        Integer::NewFromUnsigned(isolate, static_cast<uint32_t>(length))};
+
+    MaybeLocal<Value> r = MakeCallback(cb.As<Function>(),
+                                       arraysize(argv),
+                                       argv);
+
+    if (r.IsEmpty()) {
+      got_exception_ = true;
+      llhttp_set_error_reason(&parser_, "HPE_JS_EXCEPTION:JS Exception");
+      return -1;
+    }
+
+    return 0;
+  }
+
+
+  // Wraps the data of the current read from the consumed stream in a Buffer.
+  // Data in the read slab is passed on as it is, anything else is copied.
+  Local<Object> BufferFromRead() {
+    Isolate* isolate = env()->isolate();
+    if (IsReadSlab(current_buffer_data_)) {
+      // The slab now belongs to JS, the next read will allocate a new one.
+      Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(read_slab_));
+      return Buffer::New(isolate, ab, 0, current_buffer_len_).ToLocalChecked();
+    }
+    return Buffer::Copy(isolate, current_buffer_data_, current_buffer_len_)
+        .ToLocalChecked();
+  }
+
+
+  bool IsReadSlab(const char* data) const {
+    return read_slab_ && data == read_slab_->Data();
+  }
+
+
   int on_message_complete() {
+    NODE_USDT_PROBE1(http__parser__message__complete, NODE_USDT_PTR(this));
     HandleScope scope(env()->isolate());
 
+    if (FlushBody() != 0)
+      return HPE_USER;
+
+    // The whole message has been parsed before its headers were passed on,
+    // so JS is told that it is complete along with them.
+    if (message_is_pending_ && num_fields_ == 0) {
+      pending_messages_->Set(env()->context(),
+                             pending_messages_length_ - 1,
+                             True(env()->isolate())).Check();
+      message_is_pending_ = false;
+      return 0;
+    }
+
     if (num_fields_)
       Flush();  // Flush trailing HTTP headers.
 
+    if (DispatchMessages() != 0)
+      return -1;
+
     Local<Object> obj = object();
     Local<Value> cb = obj->Get(env()->context(),
                                kOnMessageComplete).ToLocalChecked();
@@ -485,6 +808,34 @@ class Parser : public AsyncWrap, public StreamListener {
   }
 
 
+  // parser.release()
+  // Resets the parser and keeps it for getPooledParser(), unless the pool
+  // is full. Returns whether the parser was pooled.
+  static void Release(const FunctionCallbackInfo<Value>& args) {
+    Parser* parser;
+    ASSIGN_OR_RETURN_UNWRAP(&parser, args.Holder());
+    CHECK_EQ(parser->execute_depth_, 0);
+
+    std::vector<Global<Object>>& pool = parser->binding_data_->parser_pool;
+    if (pool.size() >= BindingData::kMaxPooledParsers)
+      return args.GetReturnValue().Set(false);
+
+    if (parser->stream_ != nullptr)
+      parser->stream_->RemoveStreamListener(parser);
+    parser->Reset();
+
+    // Same as free(). Nothing is emitted if there are no destroy hooks and
+    // async_hooks tracing is off.
+    if (parser->get_async_id() != kInvalidAsyncId) {
+      parser->EmitTraceEventDestroy();
+      parser->EmitDestroy();
+    }
+
+    pool.emplace_back(parser->env()->isolate(), parser->object());
+    args.GetReturnValue().Set(true);
+  }
+
+
   static void Free(const FunctionCallbackInfo<Value>& args) {
     Parser* parser;
     ASSIGN_OR_RETURN_UNWRAP(&parser, args.Holder());
@@ -496,6 +847,39 @@ class Parser : public AsyncWrap, public StreamListener {
   }
 
 
+  // Charges the header data that is kept across reads to the budget of the
+  // stream, if it has one, see LibuvStreamWrap::SetMemoryBudget().
+  void UpdateMemoryCharge() {
+    MemoryBudget* budget =
+        stream_ != nullptr ? stream_->memory_budget() : nullptr;
+    if (budget != charged_budget_) {
+      if (charged_budget_ != nullptr)
+        charged_budget_->Release(charged_bytes_);
+      charged_budget_ = budget;
+      charged_bytes_ = 0;
+    }
+    if (budget == nullptr) return;
+
+    size_t saved = url_.heap_size() + status_message_.heap_size();
+    for (size_t i = 0; i < num_fields_; i++)
+      saved += fields_[i].heap_size();
+    for (size_t i = 0; i < num_values_; i++)
+      saved += values_[i].heap_size();
+    if (saved > charged_bytes_)
+      budget->Charge(saved - charged_bytes_);
+    else
+      budget->Release(charged_bytes_ - saved);
+    charged_bytes_ = saved;
+  }
+
+
+  void OnStreamDestroy() override {
+    // The budget went away along with the stream.
+    charged_budget_ = nullptr;
+    charged_bytes_ = 0;
+  }
+
+
   void Save() {
     url_.Save();
     status_message_.Save();
@@ -631,10 +1015,43 @@ class Parser : public AsyncWrap, public StreamListener {
     if (parser->stream_ == nullptr)
       return;
 
+    if (parser->charged_budget_ != nullptr) {
+      parser->charged_budget_->Release(parser->charged_bytes_);
+      parser->charged_budget_ = nullptr;
+      parser->charged_bytes_ = 0;
+    }
     parser->stream_->RemoveStreamListener(parser);
   }
 
 
+  // parser.setBatchMessages(enable)
+  // In batch mode, requests that one execute() parses are passed to JS in
+  // a single onMessages callback, instead of an onHeadersComplete and an
+  // onMessageComplete callback each.
+  static void SetBatchMessages(const FunctionCallbackInfo<Value>& args) {
+    Parser* parser;
+    ASSIGN_OR_RETURN_UNWRAP(&parser, args.Holder());
+    CHECK(args[0]->IsBoolean());
+    CHECK_EQ(parser->execute_depth_, 0);
+    parser->batch_messages_ = args[0]->IsTrue();
+  }
+
+
+  // parser.setZeroCopyBody(enable)
+  // In zero-copy mode, data read from a consumed stream is passed to onBody
+  // without being copied, and the body fragments parsed by one execute() are
+  // passed on in a single onBody callback.
+  static void SetZeroCopyBody(const FunctionCallbackInfo<Value>& args) {
+    Parser* parser;
+    ASSIGN_OR_RETURN_UNWRAP(&parser, args.Holder());
+    CHECK(args[0]->IsBoolean());
+    CHECK_EQ(parser->execute_depth_, 0);
+    parser->zero_copy_body_ = args[0]->IsTrue();
+    if (!parser->zero_copy_body_ && !parser->read_slab_in_use_)
+      parser->read_slab_.reset();
+  }
+
+
   static void GetCurrentBuffer(const FunctionCallbackInfo<Value>& args) {
     Parser* parser;
     ASSIGN_OR_RETURN_UNWRAP(&parser, args.Holder());
@@ -649,8 +1066,30 @@ class Parser : public AsyncWrap, public StreamListener {
 
  protected:
   static const size_t kAllocBufferSize = 64 * 1024;
+  // Body fragments shorter than this are copied rather than sliced out of
+  // the read slab.
+  static const size_t kMinSlicedBodySize = 4 * 1024;
+  static const size_t kMaxCoalescedBodySize = 64 * 1024;
+
+  struct BodyFragment {
+    const char* data;
+    size_t length;
+  };
 
   uv_buf_t OnStreamAlloc(size_t suggested_size) override {
+    // In zero-copy mode, body data is passed to JS straight out of the memory
+    // it was read into, so read into memory that can back an ArrayBuffer.
+    if (zero_copy_body_ && !read_slab_in_use_) {
+      if (!read_slab_) {
+        NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+        read_slab_ =
+            ArrayBuffer::NewBackingStore(env()->isolate(), kAllocBufferSize);
+      }
+      read_slab_in_use_ = true;
+      return uv_buf_init(static_cast<char*>(read_slab_->Data()),
+                         kAllocBufferSize);
+    }
+
     // For most types of streams, OnStreamRead will be immediately after
     // OnStreamAlloc, and will consume all data, so using a static buffer for
     // reading is more efficient. For other streams, just use Malloc() directly.
@@ -670,8 +1109,11 @@ class Parser : public AsyncWrap, public StreamListener {
     // Once we’re done here, either indicate that the HTTP parser buffer
     // is free for re-use, or free() the data if it didn’t come from there
     // in the first place.
+    const bool from_read_slab = IsReadSlab(buf.base);
     auto on_scope_leave = OnScopeLeave([&]() {
-      if (buf.base == binding_data_->parser_buffer.data())
+      if (from_read_slab)
+        read_slab_in_use_ = false;
+      else if (buf.base == binding_data_->parser_buffer.data())
         binding_data_->parser_buffer_in_use = false;
       else
         free(buf.base);
@@ -688,6 +1130,7 @@ class Parser : public AsyncWrap, public StreamListener {
 
     current_buffer_.Clear();
     Local<Value> ret = Execute(buf.base, nread);
+    UpdateMemoryCharge();
 
     // Exception
     if (ret.IsEmpty())
@@ -745,6 +1188,8 @@ class Parser : public AsyncWrap, public StreamListener {
       err = llhttp_finish(&parser_);
     } else {
       err = llhttp_execute(&parser_, data, len);
+      if (!got_exception_ && DispatchMessages() == 0)
+        FlushBody();
       Save();
     }
     execute_depth_--;
@@ -767,6 +1212,13 @@ class Parser : public AsyncWrap, public StreamListener {
       llhttp_pause(&parser_);
     }
 
+    // Drop whatever an exception kept from being passed on
+    pending_messages_.Clear();
+    pending_messages_length_ = 0;
+    message_is_pending_ = false;
+    pending_body_.clear();
+    pending_body_length_ = 0;
+
     // Unassign the 'buffer_' variable
     current_buffer_.Clear();
     current_buffer_len_ = 0;
@@ -815,16 +1267,34 @@ class Parser : public AsyncWrap, public StreamListener {
     return scope.Escape(nread_obj);
   }
 
+  Local<String> HeaderName(const StringPtr& field) {
+    const char* name = WellKnownHeaders::Get().Find(field.str_, field.size_);
+    if (name == nullptr)
+      return field.ToString(env());
+
+    Isolate* isolate = env()->isolate();
+    Eternal<String>& eternal = env()->isolate_data()->static_str_map[name];
+    if (eternal.IsEmpty()) {
+      eternal.Set(isolate,
+                  String::NewFromOneByte(
+                      isolate,
+                      reinterpret_cast<const uint8_t*>(name),
+                      NewStringType::kInternalized,
+                      field.size_).ToLocalChecked());
+    }
+    return eternal.Get(isolate);
+  }
+
   Local<Array> CreateHeaders() {
-    // There could be extra entries but the max size should be fixed
-    Local<Value> headers_v[kMaxHeaderFieldsCount * 2];
+    MaybeStackBuffer<Local<Value>, kInitialHeaderFieldsCount * 2> headers_v(
+        num_values_ * 2);
 
     for (size_t i = 0; i < num_values_; ++i) {
-      headers_v[i * 2] = fields_[i].ToString(env());
+      headers_v[i * 2] = HeaderName(fields_[i]);
       headers_v[i * 2 + 1] = values_[i].ToTrimmedString(env());
     }
 
-    return Array::New(env()->isolate(), headers_v, num_values_ * 2);
+    return Array::New(env()->isolate(), headers_v.out(), num_values_ * 2);
   }
 
 
@@ -832,6 +1302,10 @@ class Parser : public AsyncWrap, public StreamListener {
   void Flush() {
     HandleScope scope(env()->isolate());
 
+    // Trailers come after the body, and headers after earlier messages.
+    if (FlushBody() != 0 || DispatchMessages() != 0)
+      return;
+
     Local<Object> obj = object();
     Local<Value> cb = obj->Get(env()->context(), kOnHeaders).ToLocalChecked();
 
@@ -855,6 +1329,28 @@ class Parser : public AsyncWrap, public StreamListener {
   }
 
 
+  // Drops everything that a pooled parser does not need to keep until it is
+  // initialized again.
+  void Reset() {
+    url_.Reset();
+    status_message_.Reset();
+    for (size_t i = 0; i < fields_.size(); i++) {
+      fields_[i].Reset();
+      values_[i].Reset();
+    }
+    num_fields_ = 0;
+    num_values_ = 0;
+    have_flushed_ = false;
+    pending_pause_ = false;
+    header_nread_ = 0;
+    header_parsing_start_time_ = 0;
+    batch_messages_ = false;
+    zero_copy_body_ = false;
+    if (!read_slab_in_use_)
+      read_slab_.reset();
+  }
+
+
   void Init(llhttp_type_t type, uint64_t max_http_header_size,
             uint32_t lenient_flags, uint64_t headers_timeout) {
     llhttp_init(&parser_, type, &settings);
@@ -914,8 +1410,8 @@ class Parser : public AsyncWrap, public StreamListener {
 
 
   llhttp_t parser_;
-  StringPtr fields_[kMaxHeaderFieldsCount];  // header fields
-  StringPtr values_[kMaxHeaderFieldsCount];  // header values
+  std::vector<StringPtr> fields_;  // header fields
+  std::vector<StringPtr> values_;  // header values
   StringPtr url_;
   StringPtr status_message_;
   size_t num_fields_;
@@ -932,8 +1428,26 @@ class Parser : public AsyncWrap, public StreamListener {
   uint64_t headers_timeout_;
   uint64_t header_parsing_start_time_ = 0;
 
+  // Batched request dispatch, see setBatchMessages().
+  bool batch_messages_ = false;
+  Local<Array> pending_messages_;
+  uint32_t pending_messages_length_ = 0;
+  // Whether the last of pending_messages_ is still being parsed.
+  bool message_is_pending_ = false;
+
+  // Zero-copy body delivery, see setZeroCopyBody().
+  bool zero_copy_body_ = false;
+  std::vector<BodyFragment> pending_body_;
+  size_t pending_body_length_ = 0;
+  std::unique_ptr<BackingStore> read_slab_;
+  bool read_slab_in_use_ = false;
+
   BaseObjectPtr<BindingData> binding_data_;
 
+  // What UpdateMemoryCharge() charged, and to which budget.
+  MemoryBudget* charged_budget_ = nullptr;
+  size_t charged_bytes_ = 0;
+
   // These are helper functions for filling `http_parser_settings`, which turn
   // a member function of Parser into a C-style HTTP parser callback.
   template <typename Parser, Parser> struct Proxy;
@@ -978,6 +1492,167 @@ const llhttp_settings_t Parser::settings = {
 };
 
 
+// writeResponseHead(stream, req, statusCode, reason, headers, body,
+// encoding) writes an HTTP/1.1 status line and headers, followed by the
+// first chunk of the body if there is one, to a StreamBase with a single
+// write. `headers` is a flat array of names and values. A name may also be
+// given as the index of a well-known header name in wellKnownHeaderNames,
+// which is then copied from there rather than from a string. Names, values
+// and the reason are written as latin1, like the JS side does, and `body`
+// is a string in `encoding` or an ArrayBufferView. Returns an error code,
+// the same way as stream.writev() does.
+void WriteResponseHead(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  const WellKnownHeaders& well_known = WellKnownHeaders::Get();
+
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsObject());
+  CHECK(args[2]->IsUint32());
+  CHECK(args[3]->IsString());
+  CHECK(args[4]->IsArray());
+  StreamBase* stream = StreamBase::FromObject(args[0].As<Object>());
+  if (stream == nullptr || !stream->IsAlive())
+    return args.GetReturnValue().Set(UV_EINVAL);
+  Local<Object> req_wrap_obj = args[1].As<Object>();
+  const uint32_t status = args[2].As<Uint32>()->Value();
+  if (status < 100 || status > 999) {
+    return THROW_ERR_OUT_OF_RANGE(env,
+        "The status code must be a three-digit number");
+  }
+  Local<String> reason = args[3].As<String>();
+  Local<Array> headers = args[4].As<Array>();
+  const uint32_t count = headers->Length() & ~1;
+
+  // First, find out how large the head is.
+  MaybeStackBuffer<Local<Value>, 64> fields(count);
+  size_t size = sizeof("HTTP/1.1 000 \r\n") - 1 + reason->Length() + 2;
+  for (uint32_t i = 0; i < count; i++) {
+    if (!headers->Get(context, i).ToLocal(&fields[i])) return;
+    if (i % 2 == 0 && fields[i]->IsUint32()) {
+      const uint32_t index = fields[i].As<Uint32>()->Value();
+      CHECK_LT(index, well_known.size());
+      size += well_known.TitleCase(index).size();
+    } else {
+      Local<String> string;
+      if (!fields[i]->ToString(context).ToLocal(&string)) return;
+      fields[i] = string;
+      size += string->Length();
+    }
+    size += 2;  // ": " or "\r\n"
+  }
+
+  Local<Value> body = args[5];
+  enum encoding encoding = UTF8;
+  size_t body_size = 0;
+  if (body->IsString()) {
+    encoding = ParseEncoding(isolate, args[6], UTF8);
+    if (!StringBytes::StorageSize(isolate, body, encoding).To(&body_size))
+      return;
+  } else if (!body->IsUndefined()) {
+    CHECK(body->IsArrayBufferView());
+  }
+
+  std::unique_ptr<BackingStore> slab = std::move(binding_data->head_slab);
+  if (size + body_size > BindingData::kHeadSlabSize) {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    slab = ArrayBuffer::NewBackingStore(isolate, size + body_size);
+  } else if (!slab) {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    slab = ArrayBuffer::NewBackingStore(isolate, BindingData::kHeadSlabSize);
+  }
+  char* const head = static_cast<char*>(slab->Data());
+  char* out = head;
+
+  // CR and LF would let a name, value or reason make up headers of its own.
+  bool invalid = false;
+  auto write_string = [&](Local<String> string) {
+    const int length = string->WriteOneByte(
+        isolate, reinterpret_cast<uint8_t*>(out), 0, -1,
+        String::NO_NULL_TERMINATION);
+    invalid = invalid || memchr(out, '\r', length) != nullptr ||
+              memchr(out, '\n', length) != nullptr;
+    out += length;
+  };
+  auto write_literal = [&](const char* literal, size_t length) {
+    memcpy(out, literal, length);
+    out += length;
+  };
+
+  write_literal("HTTP/1.1 ", 9);
+  *out++ = '0' + status / 100;
+  *out++ = '0' + status / 10 % 10;
+  *out++ = '0' + status % 10;
+  *out++ = ' ';
+  write_string(reason);
+  write_literal("\r\n", 2);
+  for (uint32_t i = 0; i < count; i += 2) {
+    if (fields[i]->IsUint32()) {
+      const std::string& name =
+          well_known.TitleCase(fields[i].As<Uint32>()->Value());
+      write_literal(name.data(), name.size());
+    } else {
+      write_string(fields[i].As<String>());
+    }
+    write_literal(": ", 2);
+    write_string(fields[i + 1].As<String>());
+    write_literal("\r\n", 2);
+  }
+  write_literal("\r\n", 2);
+  CHECK_EQ(static_cast<size_t>(out - head), size);
+  // Only slabs of the usual size are kept for the next response.
+  auto recycle = [&]() {
+    if (slab->ByteLength() == BindingData::kHeadSlabSize)
+      binding_data->head_slab = std::move(slab);
+  };
+  if (invalid) {
+    recycle();
+    return THROW_ERR_INVALID_ARG_VALUE(env,
+        "The response head must not contain CR or LF characters");
+  }
+
+  uv_buf_t bufs[2];
+  size_t nbufs = 1;
+  if (body->IsString()) {
+    out += StringBytes::Write(isolate, out, body_size, body, encoding);
+  } else if (!body->IsUndefined()) {
+    ArrayBufferViewContents<char> contents(body);
+    if (contents.length() > 0) {
+      bufs[nbufs++] = uv_buf_init(const_cast<char*>(contents.data()),
+                                  contents.length());
+    }
+  }
+  bufs[0] = uv_buf_init(head, out - head);
+
+  StreamWriteResult res = stream->Write(bufs, nbufs, nullptr, req_wrap_obj);
+  stream->SetWriteResult(res);
+  if (res.wrap != nullptr) {
+    res.wrap->SetBackingStore(std::move(slab));
+    // The body is still being written from as well.
+    if (nbufs > 1 &&
+        req_wrap_obj->Set(context, env->buffer_string(), body).IsNothing()) {
+      return;
+    }
+  } else {
+    recycle();
+  }
+  args.GetReturnValue().Set(res.err);
+}
+
+// Returns a parser released with parser.release(), or undefined if there is
+// none. It has to be initialized before use, like a new one.
+void GetPooledParser(const FunctionCallbackInfo<Value>& args) {
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  std::vector<Global<Object>>& pool = binding_data->parser_pool;
+  if (pool.empty())
+    return;
+  args.GetReturnValue().Set(pool.back().Get(args.GetIsolate()));
+  pool.pop_back();
+}
+
+
 void InitializeHttpParser(Local<Object> target,
                           Local<Value> unused,
                           Local<Context> context,
@@ -1008,6 +1683,8 @@ void InitializeHttpParser(Local<Object> target,
          Integer::NewFromUnsigned(env->isolate(), kOnExecute));
   t->Set(FIXED_ONE_BYTE_STRING(env->isolate(), "kOnTimeout"),
          Integer::NewFromUnsigned(env->isolate(), kOnTimeout));
+  t->Set(FIXED_ONE_BYTE_STRING(env->isolate(), "kOnMessages"),
+         Integer::NewFromUnsigned(env->isolate(), kOnMessages));
 
   t->Set(FIXED_ONE_BYTE_STRING(env->isolate(), "kLenientNone"),
          Integer::NewFromUnsigned(env->isolate(), kLenientNone));
@@ -1033,6 +1710,7 @@ void InitializeHttpParser(Local<Object> target,
   t->Inherit(AsyncWrap::GetConstructorTemplate(env));
   env->SetProtoMethod(t, "close", Parser::Close);
   env->SetProtoMethod(t, "free", Parser::Free);
+  env->SetProtoMethod(t, "release", Parser::Release);
   env->SetProtoMethod(t, "execute", Parser::Execute);
   env->SetProtoMethod(t, "finish", Parser::Finish);
   env->SetProtoMethod(t, "initialize", Parser::Initialize);
@@ -1041,8 +1719,24 @@ void InitializeHttpParser(Local<Object> target,
   env->SetProtoMethod(t, "consume", Parser::Consume);
   env->SetProtoMethod(t, "unconsume", Parser::Unconsume);
   env->SetProtoMethod(t, "getCurrentBuffer", Parser::GetCurrentBuffer);
+  env->SetProtoMethod(t, "setBatchMessages", Parser::SetBatchMessages);
+  env->SetProtoMethod(t, "setZeroCopyBody", Parser::SetZeroCopyBody);
 
   env->SetConstructorFunction(target, "HTTPParser", t);
+  env->SetMethod(target, "getPooledParser", GetPooledParser);
+
+  const WellKnownHeaders& well_known = WellKnownHeaders::Get();
+  Local<Array> header_names = Array::New(env->isolate(), well_known.size());
+  for (size_t i = 0; i < well_known.size(); i++) {
+    const std::string& name = well_known.TitleCase(i);
+    header_names->Set(env->context(), i,
+                      OneByteString(env->isolate(), name.data(), name.size()))
+        .Check();
+  }
+  target->Set(env->context(),
+              FIXED_ONE_BYTE_STRING(env->isolate(), "wellKnownHeaderNames"),
+              header_names).Check();
+  env->SetMethod(target, "writeResponseHead", WriteResponseHead);
 }
 
 }  // anonymous namespace
@@ -50,6 +50,8 @@
 #include "node_buffer.h"
 #include "node_errors.h"
 #include "node_internals.h"
+#include "node_mutex.h"
+#include "utf8.h"
 #include "util-inl.h"
 #include "v8.h"
 
@@ -68,6 +70,12 @@
 #include <unicode/uversion.h>
 #include <unicode/ustring.h>
 
+#include <algorithm>
+#include <list>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 #ifdef NODE_HAVE_SMALL_ICU
 /* if this is defined, we have a 'secondary' entry point.
    compare following to utypes.h defs for U_ICUDATA_ENTRY_POINT */
@@ -352,6 +360,52 @@ void ICUErrorName(const FunctionCallbackInfo<Value>& args) {
                           u_errorName(status)).ToLocalChecked());
 }
 
+// Opening a converter has ICU look up the encoding and set up its state
+// from scratch, which is a large part of decoding short inputs. Converters
+// that are done are therefore reset and kept for the next TextDecoder with
+// the same label and fatal flag, for all threads.
+class ConverterPool {
+ public:
+  static constexpr size_t kMaxPerKey = 8;
+
+  static ConverterPool* Get() {
+    // Never destroyed, so that it outlives the converters that are still in
+    // use when the process exits.
+    static ConverterPool* const pool = new ConverterPool();
+    return pool;
+  }
+
+  static std::string Key(const char* label, bool fatal) {
+    std::string key(label);
+    key += fatal ? '\1' : '\0';
+    return key;
+  }
+
+  // Returns a pooled converter for `key`, or nullptr.
+  UConverter* Acquire(const std::string& key) {
+    Mutex::ScopedLock lock(mutex_);
+    auto it = converters_.find(key);
+    if (it == converters_.end() || it->second.empty())
+      return nullptr;
+    UConverter* converter = it->second.back().release();
+    it->second.pop_back();
+    return converter;
+  }
+
+  void Release(const std::string& key, UConverter* converter) {
+    ConverterPointer pointer(converter);
+    ucnv_reset(converter);
+    Mutex::ScopedLock lock(mutex_);
+    std::vector<ConverterPointer>& pooled = converters_[key];
+    if (pooled.size() < kMaxPerKey)
+      pooled.push_back(std::move(pointer));
+  }
+
+ private:
+  Mutex mutex_;
+  std::unordered_map<std::string, std::vector<ConverterPointer>> converters_;
+};
+
 }  // anonymous namespace
 
 Converter::Converter(const char* name, const char* sub) {
@@ -396,8 +450,14 @@ void ConverterObject::Has(const FunctionCallbackInfo<Value>& args) {
   CHECK_GE(args.Length(), 1);
   Utf8Value label(env->isolate(), args[0]);
 
+  ConverterPool* pool = ConverterPool::Get();
+  std::string key = ConverterPool::Key(*label, false);
+  UConverter* conv = pool->Acquire(key);
   UErrorCode status = U_ZERO_ERROR;
-  ConverterPointer conv(ucnv_open(*label, &status));
+  if (conv == nullptr)
+    conv = ucnv_open(*label, &status);
+  if (U_SUCCESS(status))
+    pool->Release(key, conv);
   args.GetReturnValue().Set(!!U_SUCCESS(status));
 }
 
@@ -414,18 +474,22 @@ void ConverterObject::Create(const FunctionCallbackInfo<Value>& args) {
   bool fatal =
       (flags & CONVERTER_FLAGS_FATAL) == CONVERTER_FLAGS_FATAL;
 
-  UErrorCode status = U_ZERO_ERROR;
-  UConverter* conv = ucnv_open(*label, &status);
-  if (U_FAILURE(status))
-    return;
-
-  if (fatal) {
-    status = U_ZERO_ERROR;
-    ucnv_setToUCallBack(conv, UCNV_TO_U_CALLBACK_STOP,
-                        nullptr, nullptr, nullptr, &status);
+  std::string key = ConverterPool::Key(*label, fatal);
+  UConverter* conv = ConverterPool::Get()->Acquire(key);
+  if (conv == nullptr) {
+    UErrorCode status = U_ZERO_ERROR;
+    conv = ucnv_open(*label, &status);
+    if (U_FAILURE(status))
+      return;
+
+    if (fatal) {
+      status = U_ZERO_ERROR;
+      ucnv_setToUCallBack(conv, UCNV_TO_U_CALLBACK_STOP,
+                          nullptr, nullptr, nullptr, &status);
+    }
   }
 
-  new ConverterObject(env, obj, conv, flags);
+  new ConverterObject(env, obj, conv, std::move(key), flags);
   args.GetReturnValue().Set(obj);
 }
 
@@ -520,10 +584,12 @@ ConverterObject::ConverterObject(
     Environment* env,
     Local<Object> wrap,
     UConverter* converter,
+    std::string&& pool_key,
     int flags,
     const char* sub)
     : BaseObject(env, wrap),
       Converter(converter, sub),
+      pool_key_(std::move(pool_key)),
       flags_(flags) {
   MakeWeak();
 
@@ -539,6 +605,117 @@ ConverterObject::ConverterObject(
   }
 }
 
+ConverterObject::~ConverterObject() {
+  ConverterPool::Get()->Release(pool_key_, release());
+}
+
+void ConverterObject::DecodeToString(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  CHECK_GE(args.Length(), 3);  // Converter, Buffer, Flags
+
+  ConverterObject* converter;
+  ASSIGN_OR_RETURN_UNWRAP(&converter, args[0].As<Object>());
+  ArrayBufferViewContents<char> input(args[1]);
+  int flags = args[2]->Uint32Value(env->context()).ToChecked();
+  UBool flush = (flags & CONVERTER_FLAGS_FLUSH) == CONVERTER_FLAGS_FLUSH;
+
+  auto cleanup = OnScopeLeave([&]() {
+    if (flush) {
+      // Reset the converter state.
+      converter->set_bom_seen(false);
+      converter->reset();
+    }
+  });
+
+  // ICU writes UTF-16 into a small buffer on the stack, and the output is
+  // narrowed into `latin1` as long as it fits. Only the first character
+  // above U+00FF makes it switch to `utf16`, which gets a copy of what
+  // `latin1` has so far.
+  static constexpr size_t kChunkSize = 4096;
+  UChar chunk[kChunkSize];
+  MaybeStackBuffer<uint8_t> latin1;
+  MaybeStackBuffer<uint16_t> utf16;
+  size_t length = 0;
+  bool is_latin1 = true;
+  latin1.AllocateSufficientStorage(input.length() /
+                                   converter->min_char_size());
+  latin1.SetLength(0);
+
+  const char* source = input.data();
+  const char* source_end = source + input.length();
+  UErrorCode status;
+  do {
+    UChar* target = chunk;
+    status = U_ZERO_ERROR;
+    ucnv_toUnicode(converter->conv(),
+                   &target,
+                   chunk + kChunkSize,
+                   &source,
+                   source_end,
+                   nullptr,
+                   flush,
+                   &status);
+    if (U_FAILURE(status) && status != U_BUFFER_OVERFLOW_ERROR) {
+      args.GetReturnValue().Set(status);
+      return;
+    }
+
+    const UChar* begin = chunk;
+    if (target > begin &&
+        converter->unicode() &&
+        !converter->ignore_bom() &&
+        !converter->bom_seen()) {
+      // If the very first result in the stream is a BOM, and we are not
+      // explicitly told to ignore it, then we discard it.
+      if (*begin == 0xFEFF)
+        begin++;
+      converter->set_bom_seen(true);
+    }
+    const size_t count = target - begin;
+
+    if (is_latin1) {
+      UChar all = 0;
+      for (size_t i = 0; i < count; i++)
+        all |= begin[i];
+      if (all > 0xFF) {
+        is_latin1 = false;
+        utf16.AllocateSufficientStorage(length + count);
+        std::copy_n(latin1.out(), length, utf16.out());
+      }
+    }
+    // The buffers keep their contents up to length() when they grow.
+    if (is_latin1) {
+      if (length + count > latin1.capacity())
+        latin1.AllocateSufficientStorage(std::max(length + count,
+                                                  2 * latin1.capacity()));
+      std::copy_n(begin, count, latin1.out() + length);
+      latin1.SetLength(length + count);
+    } else {
+      if (length + count > utf16.capacity())
+        utf16.AllocateSufficientStorage(std::max(length + count,
+                                                 2 * utf16.capacity()));
+      memcpy(utf16.out() + length, begin, count * sizeof(UChar));
+      utf16.SetLength(length + count);
+    }
+    length += count;
+  } while (status == U_BUFFER_OVERFLOW_ERROR);
+
+  Isolate* isolate = env->isolate();
+  MaybeLocal<String> ret =
+      is_latin1 ?
+          String::NewFromOneByte(isolate, *latin1, NewStringType::kNormal,
+                                 length) :
+          String::NewFromTwoByte(isolate, *utf16, NewStringType::kNormal,
+                                 length);
+  Local<String> str;
+  if (!ret.ToLocal(&str)) {
+    isolate->ThrowException(ERR_STRING_TOO_LONG(isolate));
+    return;
+  }
+  args.GetReturnValue().Set(str);
+}
+
 
 bool InitializeICUDirectory(const std::string& path) {
   UErrorCode status = U_ZERO_ERROR;
@@ -609,10 +786,12 @@ int32_t ToUnicode(MaybeStackBuffer<char>* buf,
   return len;
 }
 
-int32_t ToASCII(MaybeStackBuffer<char>* buf,
-                const char* input,
-                size_t length,
-                enum idna_mode mode) {
+namespace {
+
+int32_t ToASCIIWithICU(MaybeStackBuffer<char>* buf,
+                       const char* input,
+                       size_t length,
+                       enum idna_mode mode) {
   UErrorCode status = U_ZERO_ERROR;
   uint32_t options =                  // CheckHyphens = false; handled later
     UIDNA_CHECK_BIDI |                // CheckBidi = true
@@ -684,6 +863,113 @@ int32_t ToASCII(MaybeStackBuffer<char>* buf,
   return len;
 }
 
+// ToLower() goes through std::locale, which is too slow for every host.
+inline char ASCIILowercase(char ch) {
+  return (ch >= 'A' && ch <= 'Z') ? (ch | 0x20) : ch;
+}
+
+// For ASCII input, UTS #46 ToASCII only lowercases letters and decodes
+// labels that start with "xn--", as long as no STD3 rules apply. Returns
+// false if `input` is not such an ASCII domain, without using `buf`.
+bool ToASCIIWithoutICU(MaybeStackBuffer<char>* buf,
+                       const char* input,
+                       size_t length,
+                       enum idna_mode mode) {
+  if (mode == IDNA_STRICT || ascii_prefix_length(input, length) != length)
+    return false;
+  for (size_t label = 0; label + 4 <= length;) {
+    if (ASCIILowercase(input[label]) == 'x' &&
+        ASCIILowercase(input[label + 1]) == 'n' &&
+        input[label + 2] == '-' &&
+        input[label + 3] == '-') {
+      return false;
+    }
+    const void* dot = memchr(input + label, '.', length - label);
+    if (dot == nullptr)
+      break;
+    label = static_cast<const char*>(dot) - input + 1;
+  }
+  buf->AllocateSufficientStorage(length);
+  char* out = buf->out();
+  for (size_t i = 0; i < length; i++)
+    out[i] = ASCIILowercase(input[i]);
+  buf->SetLength(length);
+  return true;
+}
+
+// Remembers the results of the last ToASCII() calls that needed ICU, so
+// that pages full of links to the same internationalized hosts do not
+// convert them over and over again. Every thread has its own.
+class ToASCIICache {
+ public:
+  static constexpr size_t kMaxEntries = 256;
+  // Longer inputs are converted every time.
+  static constexpr size_t kMaxInputLength = 255;
+
+  static ToASCIICache* GetForCurrentThread() {
+    thread_local ToASCIICache cache;
+    return &cache;
+  }
+
+  // Returns false on a miss, and stores the result in `buf` on a hit.
+  bool Get(const std::string& key, MaybeStackBuffer<char>* buf,
+           int32_t* len) {
+    auto it = index_.find(key);
+    if (it == index_.end())
+      return false;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    const std::string& result = it->second->result;
+    *len = it->second->len;
+    buf->AllocateSufficientStorage(result.size());
+    memcpy(buf->out(), result.data(), result.size());
+    buf->SetLength(result.size());
+    return true;
+  }
+
+  void Put(std::string&& key, const MaybeStackBuffer<char>& buf,
+           int32_t len) {
+    lru_.push_front({std::move(key), std::string(*buf, buf.length()), len});
+    index_[lru_.front().key] = lru_.begin();
+    if (lru_.size() > kMaxEntries) {
+      index_.erase(lru_.back().key);
+      lru_.pop_back();
+    }
+  }
+
+ private:
+  struct Entry {
+    std::string key;  // The mode, followed by the input.
+    std::string result;
+    int32_t len;
+  };
+
+  std::list<Entry> lru_;  // Most recently used first.
+  // The keys point into the entries in lru_.
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+};
+
+}  // anonymous namespace
+
+int32_t ToASCII(MaybeStackBuffer<char>* buf,
+                const char* input,
+                size_t length,
+                enum idna_mode mode) {
+  if (ToASCIIWithoutICU(buf, input, length, mode))
+    return static_cast<int32_t>(length);
+  if (length > ToASCIICache::kMaxInputLength)
+    return ToASCIIWithICU(buf, input, length, mode);
+
+  ToASCIICache* cache = ToASCIICache::GetForCurrentThread();
+  std::string key(1, static_cast<char>(mode));
+  key.append(input, length);
+  int32_t len;
+  if (cache->Get(key, buf, &len))
+    return len;
+  len = ToASCIIWithICU(buf, input, length, mode);
+  cache->Put(std::move(key), *buf, len);
+  return len;
+}
+
 static void ToUnicode(const FunctionCallbackInfo<Value>& args) {
   Environment* env = Environment::GetCurrent(args);
   CHECK_GE(args.Length(), 1);
@@ -856,6 +1142,7 @@ void Initialize(Local<Object> target,
 
   env->SetMethod(target, "getConverter", ConverterObject::Create);
   env->SetMethod(target, "decode", ConverterObject::Decode);
+  env->SetMethod(target, "decodeToString", ConverterObject::DecodeToString);
   env->SetMethod(target, "hasConverter", ConverterObject::Has);
 }
 
@@ -867,6 +1154,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Transcode);
   registry->Register(ConverterObject::Create);
   registry->Register(ConverterObject::Decode);
+  registry->Register(ConverterObject::DecodeToString);
   registry->Register(ConverterObject::Has);
 }
 
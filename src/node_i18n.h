@@ -77,6 +77,8 @@ class Converter {
   explicit Converter(UConverter* converter, const char* sub = nullptr);
 
   UConverter* conv() const { return conv_.get(); }
+  // Gives up ownership of the UConverter.
+  UConverter* release() { return conv_.release(); }
 
   size_t max_char_size() const;
   size_t min_char_size() const;
@@ -99,8 +101,13 @@ class ConverterObject : public BaseObject, Converter {
 
   static void Create(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Decode(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Like Decode(), but returns a string, which is one-byte if all of the
+  // output fits Latin1.
+  static void DecodeToString(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Has(const v8::FunctionCallbackInfo<v8::Value>& args);
 
+  ~ConverterObject() override;
+
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(ConverterObject)
   SET_SELF_SIZE(ConverterObject)
@@ -109,6 +116,7 @@ class ConverterObject : public BaseObject, Converter {
   ConverterObject(Environment* env,
                   v8::Local<v8::Object> wrap,
                   UConverter* converter,
+                  std::string&& pool_key,
                   int flags,
                   const char* sub = nullptr);
 
@@ -132,6 +140,8 @@ class ConverterObject : public BaseObject, Converter {
   }
 
  private:
+  // The converter goes back to the pool under this key when it is done.
+  std::string pool_key_;
   int flags_ = 0;
 };
 
@@ -25,6 +25,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "env.h"
+#include "memory_tracker.h"
 #include "node.h"
 #include "node_binding.h"
 #include "node_mutex.h"
@@ -85,6 +86,9 @@ void PrintCaughtException(v8::Isolate* isolate,
                           const v8::TryCatch& try_catch);
 
 void ResetStdio();  // Safe to call more than once and from signal handlers.
+// Implements --fast-exit for the main thread: flushes outputs, runs the
+// critical exit hooks of `env` and exits, without tearing anything down.
+[[noreturn]] void FastExit(Environment* env, int exit_code);
 #ifdef __POSIX__
 void SignalExit(int signal, siginfo_t* info, void* ucontext);
 #endif
@@ -104,10 +108,10 @@ class NodeArrayBufferAllocator : public ArrayBufferAllocator {
   void Free(void* data, size_t size) override;
   void* Reallocate(void* data, size_t old_size, size_t size) override;
   virtual void RegisterPointer(void* data, size_t size) {
-    total_mem_usage_.fetch_add(size, std::memory_order_relaxed);
+    AddMemUsage(static_cast<int64_t>(size));
   }
   virtual void UnregisterPointer(void* data, size_t size) {
-    total_mem_usage_.fetch_sub(size, std::memory_order_relaxed);
+    AddMemUsage(-static_cast<int64_t>(size));
   }
 
   NodeArrayBufferAllocator* GetImpl() final { return this; }
@@ -116,6 +120,12 @@ class NodeArrayBufferAllocator : public ArrayBufferAllocator {
   }
 
  private:
+  // Counts towards the process-wide native_memory::kArrayBuffers as well.
+  inline void AddMemUsage(int64_t delta) {
+    total_mem_usage_.fetch_add(delta, std::memory_order_relaxed);
+    native_memory::Track(native_memory::kArrayBuffers, delta);
+  }
+
   uint32_t zero_fill_field_ = 1;  // Boolean but exposed as uint32 to JS land.
   std::atomic<size_t> total_mem_usage_ {0};
 };
@@ -137,6 +147,16 @@ class DebuggingArrayBufferAllocator final : public NodeArrayBufferAllocator {
   std::unordered_map<void*, size_t> allocations_;
 };
 
+// Serves small allocations from the process-wide array_buffer_pool, and
+// everything else like NodeArrayBufferAllocator.
+class PooledArrayBufferAllocator final : public NodeArrayBufferAllocator {
+ public:
+  void* Allocate(size_t size) override;
+  void* AllocateUninitialized(size_t size) override;
+  void Free(void* data, size_t size) override;
+  void* Reallocate(void* data, size_t old_size, size_t size) override;
+};
+
 namespace Buffer {
 v8::MaybeLocal<v8::Object> Copy(Environment* env, const char* data, size_t len);
 v8::MaybeLocal<v8::Object> New(Environment* env, size_t size);
@@ -234,6 +254,8 @@ class InternalCallbackScope {
   bool failed_ = false;
   bool pushed_ids_ = false;
   bool closed_ = false;
+  bool entered_context_frame_ = false;
+  v8::Global<v8::Value> prior_context_frame_;
 };
 
 class DebugSealHandleScope {
@@ -268,6 +290,8 @@ class ThreadPoolWork {
  private:
   Environment* env_;
   uv_work_t work_req_;
+  uint64_t queued_at_ = 0;
+  uint64_t started_at_ = 0;
 };
 
 #define TRACING_CATEGORY_NODE "node"
@@ -379,7 +403,10 @@ class DiagnosticFilename {
 };
 
 namespace heap {
+// Snapshots are gzipped when `filename` ends in .gz.
 bool WriteSnapshot(Environment* env, const char* filename);
+// The extension of generated snapshot file names, with --heapsnapshot-gzip.
+const char* SnapshotExtension(Environment* env);
 }
 
 class TraceEventScope {
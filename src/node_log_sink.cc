@@ -0,0 +1,350 @@
+#include "node_log_sink.h"
+#include "async_wrap-inl.h"
+#include "base_object-inl.h"
+#include "env-inl.h"
+#include "memory_tracker-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "util-inl.h"
+
+#include <cstring>
+#include <unordered_set>
+
+namespace node {
+
+using v8::ArrayBuffer;
+using v8::Context;
+using v8::Float64Array;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Int32;
+using v8::Integer;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::Value;
+
+namespace log_sink {
+
+namespace {
+
+constexpr size_t kMinCapacity = 4 * 1024;
+constexpr size_t kMaxCapacity = 1 << 30;
+
+// All LogWriters of the process, for FlushAll().
+Mutex writers_mutex;
+std::unordered_set<LogWriter*> writers;
+
+}  // anonymous namespace
+
+std::unique_ptr<LogWriter> LogWriter::Create(uv_file fd,
+                                             size_t capacity,
+                                             Policy policy,
+                                             int64_t position) {
+  capacity = std::min(std::max(capacity, kMinCapacity), kMaxCapacity);
+  size_t size = kMinCapacity;
+  while (size < capacity) size <<= 1;
+  char* data = static_cast<char*>(UncheckedMalloc(size));
+  if (data == nullptr) return {};
+  std::unique_ptr<LogWriter> writer(new LogWriter(
+      fd, std::make_unique<worker::RingBuffer>(data, size), policy, position));
+  // Read() takes whole records only. A batch the size of the ring takes
+  // even the largest one.
+  writer->batch_.reset(UncheckedMalloc<char>(size));
+  if (!writer->batch_) return {};
+
+  auto run = [](void* data) { static_cast<LogWriter*>(data)->Run(); };
+  if (uv_thread_create(&writer->thread_, run, writer.get()) != 0) return {};
+  writer->running_ = true;
+  Mutex::ScopedLock lock(writers_mutex);
+  writers.insert(writer.get());
+  return writer;
+}
+
+LogWriter::LogWriter(uv_file fd,
+                     std::unique_ptr<worker::RingBuffer> ring,
+                     Policy policy,
+                     int64_t position)
+    : fd_(fd), ring_(std::move(ring)), policy_(policy), position_(position) {}
+
+LogWriter::~LogWriter() {
+  Stop();
+}
+
+void LogWriter::SetDrainCallback(DrainCallback callback, void* data) {
+  drain_callback_ = callback;
+  drain_data_ = data;
+}
+
+bool LogWriter::Write(const char* data, size_t length) {
+  if (!ring_->Write(data, length)) {
+    if (policy_ == Policy::kDrop) {
+      dropped_++;
+      return false;
+    }
+    drain_requested_.store(true);
+    // The writer thread may have emptied the ring just before it could see
+    // the request, and would then not answer it, so try once more.
+    if (!ring_->Write(data, length)) return false;
+    drain_requested_.store(false);
+  }
+  accepted_++;
+  WakeUp();
+  return true;
+}
+
+bool LogWriter::Flush(uint64_t timeout_ms) {
+  const uint64_t target = accepted_.load();
+  const uint64_t start = uv_hrtime();
+  while (completed_.load() < target) {
+    if (exited_.load()) return false;
+    if (timeout_ms != 0 && uv_hrtime() - start >= timeout_ms * 1000000)
+      return false;
+    WakeUp();
+    uv_sleep(1);
+  }
+  return true;
+}
+
+void LogWriter::Stop() {
+  if (!running_) return;
+  {
+    Mutex::ScopedLock lock(writers_mutex);
+    writers.erase(this);
+  }
+  // The writer thread only returns once it finds the ring empty.
+  stopping_.store(true);
+  {
+    Mutex::ScopedLock lock(mutex_);
+    wakeup_.Signal(lock);
+  }
+  CHECK_EQ(uv_thread_join(&thread_), 0);
+  running_ = false;
+}
+
+void LogWriter::FlushAll(uint64_t timeout_ms) {
+  Mutex::ScopedLock lock(writers_mutex);
+  for (LogWriter* writer : writers)
+    writer->Flush(timeout_ms);
+}
+
+void LogWriter::WakeUp() {
+  // This pairs with the fence in WaitForRecords(), so that either this sees
+  // that the writer thread waits, or it sees the new record.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!waiting_.load()) return;
+  Mutex::ScopedLock lock(mutex_);
+  wakeup_.Signal(lock);
+}
+
+void LogWriter::WaitForRecords() {
+  Mutex::ScopedLock lock(mutex_);
+  waiting_.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring_->IsEmpty() && !stopping_.load())
+    wakeup_.Wait(lock);
+  waiting_.store(false);
+}
+
+void LogWriter::Run() {
+  const size_t capacity = ring_->capacity();
+  for (;;) {
+    size_t needed = 0;
+    size_t length = ring_->Read(batch_.get(), capacity, &needed);
+    CHECK_EQ(needed, 0);
+    if (length == 0) {
+      if (stopping_.load() && ring_->IsEmpty()) break;
+      WaitForRecords();
+      continue;
+    }
+    WriteBatch(batch_.get(), length);
+    if (drain_requested_.exchange(false) && drain_callback_ != nullptr)
+      drain_callback_(drain_data_);
+  }
+  exited_.store(true);
+}
+
+void LogWriter::WriteBatch(const char* batch, size_t length) {
+  bufs_.clear();
+  uint64_t records = 0;
+  for (size_t offset = 0; offset < length; records++) {
+    uint32_t record_length;
+    memcpy(&record_length, batch + offset, sizeof(record_length));
+    offset += sizeof(record_length);
+    if (record_length != 0) {
+      bufs_.push_back(uv_buf_init(const_cast<char*>(batch + offset),
+                                  record_length));
+    }
+    offset += record_length;
+  }
+
+  size_t i = 0;
+  while (i < bufs_.size()) {
+    uv_fs_t req;
+    int err = uv_fs_write(nullptr, &req, fd_, &bufs_[i], bufs_.size() - i,
+                          position_, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (err == UV_EAGAIN) {
+      // A non-blocking pipe that is full. Nothing tells this thread when
+      // it is writable again, short of a loop of its own.
+      uv_sleep(1);
+      continue;
+    }
+    if (err < 0) {
+      error_.store(err);
+      failed_ += records;
+      completed_ += records;
+      return;
+    }
+    bytes_ += err;
+    if (position_ >= 0) position_ += err;
+    size_t written = err;
+    while (i < bufs_.size() && written >= bufs_[i].len) {
+      written -= bufs_[i].len;
+      i++;
+    }
+    if (written != 0) {
+      bufs_[i].base += written;
+      bufs_[i].len -= written;
+    }
+  }
+  written_ += records;
+  completed_ += records;
+}
+
+LogSink::LogSink(Environment* env,
+                 Local<Object> wrap,
+                 std::unique_ptr<LogWriter> writer)
+    : HandleWrap(env,
+                 wrap,
+                 reinterpret_cast<uv_handle_t*>(&async_),
+                 AsyncWrap::PROVIDER_LOGSINK),
+      writer_(std::move(writer)) {
+  auto ondrain = [](uv_async_t* handle) {
+    LogSink* sink = ContainerOf(&LogSink::async_, handle);
+    sink->OnDrain();
+  };
+  CHECK_EQ(uv_async_init(env->event_loop(), &async_, ondrain), 0);
+  writer_->SetDrainCallback([](void* data) {
+    CHECK_EQ(uv_async_send(&static_cast<LogSink*>(data)->async_), 0);
+  }, this);
+}
+
+void LogSink::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsInt32());
+  CHECK(args[1]->IsNumber());
+  CHECK(args[2]->IsNumber());
+  const int fd = args[0].As<Int32>()->Value();
+  const double capacity = args[1].As<Number>()->Value();
+  const int64_t position = args[2].As<Integer>()->Value();
+  const LogWriter::Policy policy = args[3]->IsTrue() ?
+      LogWriter::Policy::kDrop : LogWriter::Policy::kReject;
+
+  std::unique_ptr<LogWriter> writer = LogWriter::Create(
+      fd, static_cast<size_t>(std::max(capacity, 0.0)), policy, position);
+  if (!writer)
+    return THROW_ERR_MEMORY_ALLOCATION_FAILED(env);
+  new LogSink(env, args.This(), std::move(writer));
+}
+
+// write(data) copies a string, as UTF-8, or the bytes of a view into the
+// ring as one record.
+void LogSink::Write(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LogSink* sink;
+  ASSIGN_OR_RETURN_UNWRAP(&sink, args.Holder());
+  if (!sink->writer_)
+    return args.GetReturnValue().Set(false);
+
+  auto write = [&](const char* data, size_t length) {
+    if (length > sink->writer_->max_record_size()) {
+      return THROW_ERR_OUT_OF_RANGE(
+          env, "The record is larger than half of the log sink");
+    }
+    args.GetReturnValue().Set(sink->writer_->Write(data, length));
+  };
+  if (args[0]->IsString()) {
+    Utf8Value data(env->isolate(), args[0]);
+    write(*data, data.length());
+  } else {
+    CHECK(args[0]->IsArrayBufferView());
+    ArrayBufferViewContents<char> data(args[0]);
+    write(data.data(), data.length());
+  }
+}
+
+void LogSink::Flush(const FunctionCallbackInfo<Value>& args) {
+  LogSink* sink;
+  ASSIGN_OR_RETURN_UNWRAP(&sink, args.Holder());
+  args.GetReturnValue().Set(!sink->writer_ || sink->writer_->Flush());
+}
+
+// Returns the numbers of records written, dropped and failed, the number
+// of bytes written, and the last write error.
+void LogSink::GetStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  LogSink* sink;
+  ASSIGN_OR_RETURN_UNWRAP(&sink, args.Holder());
+  Local<ArrayBuffer> ab = ArrayBuffer::New(env->isolate(), 5 * sizeof(double));
+  double* fields = static_cast<double*>(ab->GetBackingStore()->Data());
+  LogWriter* writer = sink->writer_.get();
+  fields[0] = writer ? writer->written() : 0;
+  fields[1] = writer ? writer->dropped() : 0;
+  fields[2] = writer ? writer->failed() : 0;
+  fields[3] = writer ? writer->bytes() : 0;
+  fields[4] = writer ? writer->error() : 0;
+  args.GetReturnValue().Set(Float64Array::New(ab, 0, 5));
+}
+
+void LogSink::Close(Local<Value> close_callback) {
+  // This flushes, and the writer thread does not touch the handle after.
+  writer_.reset();
+  HandleWrap::Close(close_callback);
+}
+
+void LogSink::OnDrain() {
+  if (!writer_ || IsHandleClosing()) return;
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+  MakeCallback(env()->ondrain_string(), 0, nullptr);
+}
+
+void LogSink::MemoryInfo(MemoryTracker* tracker) const {
+  // The ring, and the buffer that the writer thread reads batches into.
+  if (writer_)
+    tracker->TrackFieldWithSize("ring", 2 * writer_->capacity());
+}
+
+void LogSink::Initialize(Local<Object> target,
+                         Local<Value> unused,
+                         Local<Context> context,
+                         void* priv) {
+  Environment* env = Environment::GetCurrent(context);
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(HandleWrap::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      LogSink::kInternalFieldCount);
+  env->SetProtoMethod(t, "write", Write);
+  env->SetProtoMethod(t, "flush", Flush);
+  env->SetProtoMethod(t, "getStats", GetStats);
+  env->SetConstructorFunction(target, "LogSink", t);
+}
+
+void LogSink::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Write);
+  registry->Register(Flush);
+  registry->Register(GetStats);
+}
+
+}  // namespace log_sink
+}  // namespace node
+
+NODE_MODULE_CONTEXT_AWARE_INTERNAL(log_sink,
+                                   node::log_sink::LogSink::Initialize)
+NODE_MODULE_EXTERNAL_REFERENCE(
+    log_sink, node::log_sink::LogSink::RegisterExternalReferences)
@@ -0,0 +1,155 @@
+#ifndef SRC_NODE_LOG_SINK_H_
+#define SRC_NODE_LOG_SINK_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "handle_wrap.h"
+#include "node_mutex.h"
+#include "node_ring_channel.h"
+#include "uv.h"
+#include "v8.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace node {
+
+class ExternalReferenceRegistry;
+
+namespace log_sink {
+
+// Writes log records to a file descriptor from a thread of its own, so that
+// the thread that logs only copies each record into a ring buffer. The
+// writer thread takes all records that are there at once and writes them
+// with a single writev(), or pwritev() for files with a position.
+//
+// Write() may only be called from one thread at a time. What happens when
+// the ring is full depends on the policy: kReject refuses the record and
+// calls the drain callback on the writer thread once there is room again,
+// while kDrop drops and counts it.
+class LogWriter final {
+ public:
+  enum class Policy { kReject, kDrop };
+  using DrainCallback = void (*)(void* data);
+
+  // `capacity` is rounded up to a power of two. A `position` of -1 writes at
+  // the current position of `fd`. Returns nullptr if the memory cannot be
+  // allocated or the thread cannot be started.
+  static std::unique_ptr<LogWriter> Create(uv_file fd,
+                                           size_t capacity,
+                                           Policy policy,
+                                           int64_t position = -1);
+  ~LogWriter();
+
+  LogWriter(const LogWriter&) = delete;
+  LogWriter& operator=(const LogWriter&) = delete;
+
+  size_t capacity() const { return ring_->capacity(); }
+  size_t max_record_size() const { return ring_->max_record_size(); }
+
+  // `length` must be at most max_record_size().
+  bool Write(const char* data, size_t length);
+  // Waits until every record accepted so far has been written, or has
+  // failed to be, and returns false if it gives up after `timeout_ms`
+  // milliseconds first. A `timeout_ms` of 0 waits for as long as it takes.
+  bool Flush(uint64_t timeout_ms = 0);
+  // Flushes and stops the writer thread.
+  void Stop();
+
+  // Flushes every LogWriter of the process, e.g. before it exits.
+  static void FlushAll(uint64_t timeout_ms = 0);
+
+  // Called on the writer thread. Set it before the first Write().
+  void SetDrainCallback(DrainCallback callback, void* data);
+
+  uint64_t written() const { return written_.load(); }
+  uint64_t dropped() const { return dropped_.load(); }
+  uint64_t failed() const { return failed_.load(); }
+  uint64_t bytes() const { return bytes_.load(); }
+  // The last error that a write failed with, or 0.
+  int error() const { return error_.load(); }
+
+ private:
+  LogWriter(uv_file fd,
+            std::unique_ptr<worker::RingBuffer> ring,
+            Policy policy,
+            int64_t position);
+
+  void Run();
+  void WriteBatch(const char* batch, size_t length);
+  void WaitForRecords();
+  void WakeUp();
+
+  const uv_file fd_;
+  const std::unique_ptr<worker::RingBuffer> ring_;
+  const Policy policy_;
+  int64_t position_;
+  std::unique_ptr<char[]> batch_;
+  std::vector<uv_buf_t> bufs_;
+
+  uv_thread_t thread_;
+  bool running_ = false;
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> exited_{false};
+  std::atomic<bool> waiting_{false};
+  std::atomic<bool> drain_requested_{false};
+  Mutex mutex_;  // Protects the wait for records.
+  ConditionVariable wakeup_;
+  DrainCallback drain_callback_ = nullptr;
+  void* drain_data_ = nullptr;
+
+  std::atomic<uint64_t> accepted_{0};
+  std::atomic<uint64_t> completed_{0};  // Written or failed.
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> failed_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<int> error_{0};
+};
+
+// A LogWriter for JS, created with new LogSink(fd, capacity, position,
+// dropWhenFull). write(data) takes a string or an ArrayBufferView as one
+// record and returns false if it is not accepted. Without dropWhenFull,
+// `ondrain()` is then called once there is room again. The records are
+// flushed when the sink is closed, which includes Environment cleanup,
+// and on process.exit() and fatal errors.
+class LogSink : public HandleWrap {
+ public:
+  static void Initialize(v8::Local<v8::Object> target,
+                         v8::Local<v8::Value> unused,
+                         v8::Local<v8::Context> context,
+                         void* priv);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Write(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Flush(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetStats(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  void Close(
+      v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(LogSink)
+  SET_SELF_SIZE(LogSink)
+
+ private:
+  LogSink(Environment* env,
+          v8::Local<v8::Object> wrap,
+          std::unique_ptr<LogWriter> writer);
+
+  void OnDrain();
+
+  std::unique_ptr<LogWriter> writer_;
+  uv_async_t async_;
+};
+
+}  // namespace log_sink
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_LOG_SINK_H_
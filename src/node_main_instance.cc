@@ -5,6 +5,7 @@
 #include "node_internals.h"
 #include "node_options-inl.h"
 #include "node_snapshotable.h"
+#include "node_startup_profile.h"
 #include "node_v8_platform-inl.h"
 #include "util-inl.h"
 #if defined(LEAK_SANITIZER)
@@ -25,6 +26,7 @@ using v8::Locker;
 
 std::unique_ptr<ExternalReferenceRegistry> NodeMainInstance::registry_ =
     nullptr;
+v8::StartupData* NodeMainInstance::main_snapshot_blob_ = nullptr;
 NodeMainInstance::NodeMainInstance(Isolate* isolate,
                                    uv_loop_t* event_loop,
                                    MultiIsolatePlatform* platform,
@@ -51,6 +53,12 @@ const std::vector<intptr_t>& NodeMainInstance::CollectExternalReferences() {
   return registry_->external_references();
 }
 
+void NodeMainInstance::UseMainSnapshot(Isolate::CreateParams* params) {
+  if (main_snapshot_blob_ == nullptr) return;
+  params->snapshot_blob = main_snapshot_blob_;
+  params->external_references = registry_->external_references().data();
+}
+
 std::unique_ptr<NodeMainInstance> NodeMainInstance::Create(
     Isolate* isolate,
     uv_loop_t* event_loop,
@@ -83,6 +91,7 @@ NodeMainInstance::NodeMainInstance(
     const std::vector<intptr_t>& external_references =
         CollectExternalReferences();
     params->external_references = external_references.data();
+    main_snapshot_blob_ = params->snapshot_blob;
   }
 
   isolate_ = Isolate::Allocate();
@@ -114,12 +123,17 @@ NodeMainInstance::NodeMainInstance(
 void NodeMainInstance::Dispose() {
   CHECK(!owns_isolate_);
   platform_->DrainTasks(isolate_);
+  // The owner of the isolate disposes of it later, and the IsolateData has
+  // to be gone before that.
+  isolate_data_.reset();
 }
 
 NodeMainInstance::~NodeMainInstance() {
   if (!owns_isolate_) {
     return;
   }
+  main_snapshot_blob_ = nullptr;
+  isolate_data_.reset();
   platform_->UnregisterIsolate(isolate_);
   isolate_->Dispose();
 }
@@ -129,6 +143,8 @@ int NodeMainInstance::Run(const EnvSerializeInfo* env_info) {
   Isolate::Scope isolate_scope(isolate_);
   HandleScope handle_scope(isolate_);
 
+  StartupProfile::Initialize(isolate_);
+
   int exit_code = 0;
   DeleteFnPtr<Environment, FreeEnvironment> env =
       CreateMainEnvironment(&exit_code, env_info);
@@ -142,11 +158,14 @@ int NodeMainInstance::Run(const EnvSerializeInfo* env_info) {
 void NodeMainInstance::Run(int* exit_code, Environment* env) {
   if (*exit_code == 0) {
     LoadEnvironment(env, StartExecutionCallback{});
+    StartupProfile::OnEnvironmentLoaded(env);
 
     *exit_code = SpinEventLoop(env).FromMaybe(1);
   }
 
   ResetStdio();
+  if (per_process::cli_options->fast_exit)
+    FastExit(env, *exit_code);
 
   // TODO(addaleax): Neither NODE_SHARED_MODE nor HAVE_INSPECTOR really
   // make sense here.
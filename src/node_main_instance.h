@@ -72,8 +72,14 @@ class NodeMainInstance {
   static v8::StartupData* GetEmbeddedSnapshotBlob();
   static const EnvSerializeInfo* GetEnvSerializeInfo();
   static const std::vector<intptr_t>& CollectExternalReferences();
+  // Makes `params` use the snapshot that the main isolate was deserialized
+  // from, if there is one. V8 only shares the read-only heap between
+  // isolates that come from the same snapshot, so Workers use it too.
+  static void UseMainSnapshot(v8::Isolate::CreateParams* params);
 
   static const size_t kNodeContextIndex = 0;
+  // The context that vm.createContext() starts from.
+  static const size_t kNodeVMContextIndex = 1;
   NodeMainInstance(const NodeMainInstance&) = delete;
   NodeMainInstance& operator=(const NodeMainInstance&) = delete;
   NodeMainInstance(NodeMainInstance&&) = delete;
@@ -87,6 +93,7 @@ class NodeMainInstance {
                    const std::vector<std::string>& exec_args);
 
   static std::unique_ptr<ExternalReferenceRegistry> registry_;
+  static v8::StartupData* main_snapshot_blob_;
   std::vector<std::string> args_;
   std::vector<std::string> exec_args_;
   std::unique_ptr<ArrayBufferAllocator> array_buffer_allocator_;
@@ -7,13 +7,16 @@
 #include "node_contextify.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_messaging_codec.h"
 #include "node_process-inl.h"
+#include "node_ring_channel.h"
 #include "util-inl.h"
 
 using node::contextify::ContextifyContext;
 using node::errors::TryCatchScope;
 using v8::Array;
 using v8::ArrayBuffer;
+using v8::ArrayBufferView;
 using v8::BackingStore;
 using v8::CompiledWasmModule;
 using v8::Context;
@@ -79,6 +82,33 @@ bool Message::IsCloseMessage() const {
 
 namespace {
 
+// Host object IDs are indices into the message's list of BaseObjects,
+// except for this one, which is followed by an ArrayBufferViewType and the
+// index of the viewed range.
+constexpr uint32_t kArrayBufferViewHostObject = 0xffffffff;
+constexpr uint32_t kSharedViewHostObject = 0xfffffffe;
+
+#define ARRAY_BUFFER_VIEW_TYPES(V)                                             \
+  V(Int8Array, 1)                                                              \
+  V(Uint8Array, 1)                                                             \
+  V(Uint8ClampedArray, 1)                                                      \
+  V(Int16Array, 2)                                                             \
+  V(Uint16Array, 2)                                                            \
+  V(Int32Array, 4)                                                             \
+  V(Uint32Array, 4)                                                            \
+  V(Float32Array, 4)                                                           \
+  V(Float64Array, 8)                                                           \
+  V(BigInt64Array, 8)                                                          \
+  V(BigUint64Array, 8)                                                         \
+  V(DataView, 1)
+
+enum class ArrayBufferViewType : uint32_t {
+#define V(Type, size) k##Type,
+  ARRAY_BUFFER_VIEW_TYPES(V)
+#undef V
+  kBuffer,  // A Uint8Array with the Buffer prototype.
+};
+
 // This is used to tell V8 how to read transferred host objects, like other
 // `MessagePort`s and `SharedArrayBuffer`s, and make new JS objects out of them.
 class DeserializerDelegate : public ValueDeserializer::Delegate {
@@ -88,16 +118,25 @@ class DeserializerDelegate : public ValueDeserializer::Delegate {
       Environment* env,
       const std::vector<BaseObjectPtr<BaseObject>>& host_objects,
       const std::vector<Local<SharedArrayBuffer>>& shared_array_buffers,
-      const std::vector<CompiledWasmModule>& wasm_modules)
-      : host_objects_(host_objects),
+      const std::vector<CompiledWasmModule>& wasm_modules,
+      const std::vector<Local<ArrayBuffer>>& array_buffer_ranges,
+      const std::vector<Local<SharedArrayBuffer>>& shared_views)
+      : env_(env),
+        host_objects_(host_objects),
         shared_array_buffers_(shared_array_buffers),
-        wasm_modules_(wasm_modules) {}
+        wasm_modules_(wasm_modules),
+        array_buffer_ranges_(array_buffer_ranges),
+        shared_views_(shared_views) {}
 
   MaybeLocal<Object> ReadHostObject(Isolate* isolate) override {
     // Identifying the index in the message's BaseObject array is sufficient.
     uint32_t id;
     if (!deserializer->ReadUint32(&id))
       return MaybeLocal<Object>();
+    if (id == kArrayBufferViewHostObject)
+      return ReadArrayBufferView(isolate);
+    if (id == kSharedViewHostObject)
+      return ReadSharedView(isolate);
     CHECK_LT(id, host_objects_.size());
     return host_objects_[id]->object(isolate);
   }
@@ -118,9 +157,61 @@ class DeserializerDelegate : public ValueDeserializer::Delegate {
   ValueDeserializer* deserializer = nullptr;
 
  private:
+  MaybeLocal<Object> ReadArrayBufferView(Isolate* isolate) {
+    uint32_t type, index;
+    if (!deserializer->ReadUint32(&type) || !deserializer->ReadUint32(&index))
+      return MaybeLocal<Object>();
+    CHECK_LT(index, array_buffer_ranges_.size());
+    Local<ArrayBuffer> ab = array_buffer_ranges_[index];
+    size_t length = ab->ByteLength();
+    switch (static_cast<ArrayBufferViewType>(type)) {
+#define V(Type, size)                                                          \
+      case ArrayBufferViewType::k##Type:                                       \
+        return v8::Type::New(ab, 0, length / size);
+      ARRAY_BUFFER_VIEW_TYPES(V)
+#undef V
+      case ArrayBufferViewType::kBuffer: {
+        Local<v8::Uint8Array> buffer;
+        if (!Buffer::New(env_, ab, 0, length).ToLocal(&buffer))
+          return MaybeLocal<Object>();
+        return buffer;
+      }
+    }
+    UNREACHABLE();
+  }
+
+  MaybeLocal<Object> ReadSharedView(Isolate* isolate) {
+    uint32_t type, index;
+    if (!deserializer->ReadUint32(&type) || !deserializer->ReadUint32(&index))
+      return MaybeLocal<Object>();
+    CHECK_LT(index, shared_views_.size());
+    Local<SharedArrayBuffer> sab = shared_views_[index];
+    size_t length = sab->ByteLength();
+    switch (static_cast<ArrayBufferViewType>(type)) {
+#define V(Type, size)                                                          \
+      case ArrayBufferViewType::k##Type:                                       \
+        return v8::Type::New(sab, 0, length / size);
+      ARRAY_BUFFER_VIEW_TYPES(V)
+#undef V
+      case ArrayBufferViewType::kBuffer: {
+        Local<v8::Uint8Array> buffer = v8::Uint8Array::New(sab, 0, length);
+        if (buffer->SetPrototype(env_->context(),
+                                 env_->buffer_prototype_object())
+                .IsNothing()) {
+          return MaybeLocal<Object>();
+        }
+        return buffer;
+      }
+    }
+    UNREACHABLE();
+  }
+
+  Environment* env_;
   const std::vector<BaseObjectPtr<BaseObject>>& host_objects_;
   const std::vector<Local<SharedArrayBuffer>>& shared_array_buffers_;
   const std::vector<CompiledWasmModule>& wasm_modules_;
+  const std::vector<Local<ArrayBuffer>>& array_buffer_ranges_;
+  const std::vector<Local<SharedArrayBuffer>>& shared_views_;
 };
 
 }  // anonymous namespace
@@ -131,6 +222,12 @@ MaybeLocal<Value> Message::Deserialize(Environment* env,
   Context::Scope context_scope(context);
 
   CHECK(!IsCloseMessage());
+  if (codec::IsEncoded(main_message_buf_.data, main_message_buf_.size)) {
+    // These messages never carry any transferables.
+    return codec::Deserialize(
+        context, main_message_buf_.data, main_message_buf_.size);
+  }
+
   if (port_list != nullptr && !transferables_.empty()) {
     // Need to create this outside of the EscapableHandleScope, but inside
     // the Context::Scope.
@@ -185,8 +282,38 @@ MaybeLocal<Value> Message::Deserialize(Environment* env,
     shared_array_buffers.push_back(sab);
   }
 
-  DeserializerDelegate delegate(
-      this, env, host_objects, shared_array_buffers, wasm_modules_);
+  // Views of ranges get ArrayBuffers of their own, which keep the memory
+  // that they came from alive.
+  std::vector<Local<ArrayBuffer>> array_buffer_ranges;
+  for (ArrayBufferRange& range : array_buffer_ranges_) {
+    std::shared_ptr<BackingStore> store = std::move(range.store);
+    if (range.offset != 0 || range.length != store->ByteLength()) {
+      char* data = static_cast<char*>(store->Data()) + range.offset;
+      store = ArrayBuffer::NewBackingStore(
+          data,
+          range.length,
+          [](void* data, size_t length, void* deleter_data) {
+            delete static_cast<std::shared_ptr<BackingStore>*>(deleter_data);
+          },
+          new std::shared_ptr<BackingStore>(std::move(store)));
+    }
+    array_buffer_ranges.push_back(
+        ArrayBuffer::New(env->isolate(), std::move(store)));
+  }
+  array_buffer_ranges_.clear();
+
+  // Shared views are left in place for the other receivers.
+  std::vector<Local<SharedArrayBuffer>> shared_views;
+  for (const std::shared_ptr<BackingStore>& store : shared_views_)
+    shared_views.push_back(SharedArrayBuffer::New(env->isolate(), store));
+
+  DeserializerDelegate delegate(this,
+                                env,
+                                host_objects,
+                                shared_array_buffers,
+                                wasm_modules_,
+                                array_buffer_ranges,
+                                shared_views);
   ValueDeserializer deserializer(
       env->isolate(),
       reinterpret_cast<const uint8_t*>(main_message_buf_.data),
@@ -230,6 +357,18 @@ uint32_t Message::AddWASMModule(CompiledWasmModule&& mod) {
   return wasm_modules_.size() - 1;
 }
 
+uint32_t Message::AddArrayBufferRange(std::shared_ptr<BackingStore> store,
+                                      size_t offset,
+                                      size_t length) {
+  array_buffer_ranges_.push_back({std::move(store), offset, length});
+  return array_buffer_ranges_.size() - 1;
+}
+
+uint32_t Message::AddSharedView(std::shared_ptr<BackingStore> store) {
+  shared_views_.emplace_back(std::move(store));
+  return shared_views_.size() - 1;
+}
+
 namespace {
 
 MaybeLocal<Function> GetEmitMessageFunction(Local<Context> context) {
@@ -288,6 +427,8 @@ class SerializerDelegate : public ValueSerializer::Delegate {
   }
 
   Maybe<bool> WriteHostObject(Isolate* isolate, Local<Object> object) override {
+    if (object->IsArrayBufferView())
+      return WriteArrayBufferView(object.As<ArrayBufferView>());
     if (env_->base_object_ctor_template()->HasInstance(object)) {
       return WriteHostObject(
           BaseObjectPtr<BaseObject> { Unwrap<BaseObject>(object) });
@@ -360,9 +501,76 @@ class SerializerDelegate : public ValueSerializer::Delegate {
     return Just(true);
   }
 
+  // Views in the transfer list share their range of the buffer with the
+  // receiving side. Other views are copied, but again only their range.
+  inline void AddSharedView(Local<ArrayBufferView> view) {
+    shared_views_.emplace_back(env_->isolate(), view);
+  }
+  bool has_shared_views() const { return !shared_views_.empty(); }
+
   ValueSerializer* serializer = nullptr;
 
  private:
+  Maybe<bool> WriteArrayBufferView(Local<ArrayBufferView> view) {
+    ArrayBufferViewType type;
+    if (view->IsUint8Array() &&
+        view->GetPrototype() == env_->buffer_prototype_object()) {
+      type = ArrayBufferViewType::kBuffer;
+#define V(Type, size)                                                          \
+    } else if (view->Is##Type()) {                                             \
+      type = ArrayBufferViewType::k##Type;
+    ARRAY_BUFFER_VIEW_TYPES(V)
+#undef V
+    } else {
+      UNREACHABLE();
+    }
+
+    const bool shared =
+        msg_->shared_payload() &&
+        std::find(shared_views_.begin(), shared_views_.end(), view) ==
+            shared_views_.end();
+    uint32_t index;
+    auto seen = std::find(seen_views_.begin(), seen_views_.end(), view);
+    if (seen != seen_views_.end()) {
+      index = seen_view_indices_[seen - seen_views_.begin()];
+    } else if (shared) {
+      // Copied once, into memory that every receiver maps.
+      const size_t length = view->ByteLength();
+      std::shared_ptr<BackingStore> copy =
+          SharedArrayBuffer::NewBackingStore(env_->isolate(), length);
+      if (length > 0)
+        view->CopyContents(copy->Data(), length);
+      index = msg_->AddSharedView(std::move(copy));
+      seen_views_.emplace_back(env_->isolate(), view);
+      seen_view_indices_.push_back(index);
+    } else {
+      size_t offset = view->ByteOffset();
+      size_t length = view->ByteLength();
+      std::shared_ptr<BackingStore> store = view->Buffer()->GetBackingStore();
+      if (std::find(shared_views_.begin(), shared_views_.end(), view) ==
+          shared_views_.end()) {
+        std::unique_ptr<BackingStore> copy =
+            ArrayBuffer::NewBackingStore(env_->isolate(), length);
+        if (length > 0) {
+          memcpy(copy->Data(),
+                 static_cast<char*>(store->Data()) + offset,
+                 length);
+        }
+        store = std::move(copy);
+        offset = 0;
+      }
+      index = msg_->AddArrayBufferRange(std::move(store), offset, length);
+      seen_views_.emplace_back(env_->isolate(), view);
+      seen_view_indices_.push_back(index);
+    }
+
+    serializer->WriteUint32(shared ? kSharedViewHostObject
+                                   : kArrayBufferViewHostObject);
+    serializer->WriteUint32(static_cast<uint32_t>(type));
+    serializer->WriteUint32(index);
+    return Just(true);
+  }
+
   Maybe<bool> WriteHostObject(BaseObjectPtr<BaseObject> host_object) {
     BaseObject::TransferMode mode = host_object->GetTransferMode();
     if (mode == BaseObject::TransferMode::kUntransferable) {
@@ -395,6 +603,9 @@ class SerializerDelegate : public ValueSerializer::Delegate {
   Local<Context> context_;
   Message* msg_;
   std::vector<Global<SharedArrayBuffer>> seen_shared_array_buffers_;
+  std::vector<Global<ArrayBufferView>> shared_views_;
+  std::vector<Global<ArrayBufferView>> seen_views_;
+  std::vector<uint32_t> seen_view_indices_;
   std::vector<BaseObjectPtr<BaseObject>> host_objects_;
   size_t first_cloned_object_index_ = SIZE_MAX;
 
@@ -414,6 +625,15 @@ Maybe<bool> Message::Serialize(Environment* env,
   // Verify that we're not silently overwriting an existing message.
   CHECK(main_message_buf_.is_empty());
 
+  // Plain data is written in a simpler format if nothing is transferred.
+  if (transfer_list_v.length() == 0 && !shared_payload_) {
+    bool encoded;
+    if (!codec::Serialize(context, input, &main_message_buf_).To(&encoded))
+      return Nothing<bool>();
+    if (encoded)
+      return Just(true);
+  }
+
   SerializerDelegate delegate(env, context, this);
   ValueSerializer serializer(env->isolate(), &delegate);
   delegate.serializer = &serializer;
@@ -434,9 +654,15 @@ Maybe<bool> Message::Serialize(Environment* env,
       if (untransferable) continue;
     }
 
-    // Currently, we support ArrayBuffers and BaseObjects for which
-    // GetTransferMode() does not return kUntransferable.
-    if (entry->IsArrayBuffer()) {
+    // Currently, we support ArrayBuffers, ArrayBufferViews and BaseObjects
+    // for which GetTransferMode() does not return kUntransferable.
+    if (entry->IsArrayBufferView()) {
+      // The view's range of its buffer is shared with the receiving side,
+      // rather than the whole buffer being transferred or copied. This
+      // lets e.g. slices of pooled Buffers be passed on without a copy.
+      delegate.AddSharedView(entry.As<ArrayBufferView>());
+      continue;
+    } else if (entry->IsArrayBuffer()) {
       Local<ArrayBuffer> ab = entry.As<ArrayBuffer>();
       // If we cannot render the ArrayBuffer unusable in this Isolate,
       // copying the buffer will have to do.
@@ -508,6 +734,8 @@ Maybe<bool> Message::Serialize(Environment* env,
   if (delegate.AddNestedHostObjects().IsNothing())
     return Nothing<bool>();
 
+  if (delegate.has_shared_views() || shared_payload_)
+    serializer.SetTreatArrayBufferViewsAsHostObjects(true);
   serializer.WriteHeader();
   if (serializer.WriteValue(context, input).IsNothing()) {
     return Nothing<bool>();
@@ -536,6 +764,9 @@ void Message::MemoryInfo(MemoryTracker* tracker) const {
   tracker->TrackField("array_buffers_", array_buffers_);
   tracker->TrackField("shared_array_buffers", shared_array_buffers_);
   tracker->TrackField("transferables", transferables_);
+  for (const ArrayBufferRange& range : array_buffer_ranges_)
+    tracker->TrackFieldWithSize("array_buffer_range", range.length);
+  tracker->TrackField("shared_views", shared_views_);
 }
 
 MessagePortData::MessagePortData(MessagePort* owner)
@@ -739,6 +970,18 @@ void MessagePort::OnMessage(MessageProcessingMode mode) {
     processing_limit = std::numeric_limits<size_t>::max();
   }
 
+  if (mode == MessageProcessingMode::kNormalOperation) {
+    Local<Value> emit_batch;
+    if (!object()->Get(context, env()->onmessagebatch_string())
+             .ToLocal(&emit_batch)) {
+      return;
+    }
+    if (emit_batch->IsFunction()) {
+      OnMessageBatch(context, emit_batch.As<Function>(), processing_limit);
+      return;
+    }
+  }
+
   // data_ can only ever be modified by the owner thread, so no need to lock.
   // However, the message port may be transferred while it is processing
   // messages, so we need to check that this handle still owns its `data_` field
@@ -804,6 +1047,83 @@ void MessagePort::OnMessage(MessageProcessingMode mode) {
   }
 }
 
+// Calls `.onmessagebatch(payloads, portLists)` with all messages that are
+// queued, up to `processing_limit` of them, instead of emitting them one by
+// one. A message that cannot be deserialized ends the batch, and is emitted
+// as a 'messageerror' event after it.
+void MessagePort::OnMessageBatch(Local<Context> context,
+                                 Local<Function> emit_batch,
+                                 size_t processing_limit) {
+  Isolate* isolate = env()->isolate();
+  while (data_) {
+    HandleScope handle_scope(isolate);
+    Context::Scope context_scope(context);
+    std::vector<Local<Value>> payloads;
+    std::vector<Local<Value>> port_lists;
+    Local<Value> message_error;
+    bool failed = false;
+    bool drained = false;
+
+    while (data_ && payloads.size() < processing_limit) {
+      if (!payloads.empty()) {
+        // Deliver the batch before the port is closed.
+        Mutex::ScopedLock lock(data_->mutex_);
+        if (!data_->incoming_messages_.empty() &&
+            data_->incoming_messages_.front()->IsCloseMessage()) {
+          break;
+        }
+      }
+      Local<Value> payload;
+      Local<Value> port_list = Undefined(isolate);
+      TryCatchScope try_catch(env());
+      if (!ReceiveMessage(context, MessageProcessingMode::kNormalOperation,
+                          &port_list).ToLocal(&payload)) {
+        if (try_catch.HasCaught() && !try_catch.HasTerminated())
+          message_error = try_catch.Exception();
+        failed = true;
+        break;
+      }
+      if (payload == env()->no_message_symbol()) {
+        drained = true;
+        break;
+      }
+      payloads.push_back(payload);
+      port_lists.push_back(port_list);
+    }
+    processing_limit -= payloads.size();
+
+    if (!payloads.empty() && env()->can_call_into_js()) {
+      Local<Value> argv[] = {
+          Array::New(isolate, payloads.data(), payloads.size()),
+          Array::New(isolate, port_lists.data(), port_lists.size())};
+      if (MakeCallback(emit_batch, arraysize(argv), argv).IsEmpty())
+        failed = true;
+    }
+
+    if (failed) {
+      if (!message_error.IsEmpty() && env()->can_call_into_js()) {
+        Local<Value> argv[] = {message_error,
+                               Undefined(isolate),
+                               env()->messageerror_string()};
+        USE(MakeCallback(PersistentToLocal::Strong(emit_message_fn_),
+                         arraysize(argv),
+                         argv));
+      }
+      // Re-schedule OnMessage() execution in case of failure.
+      if (data_)
+        TriggerAsync();
+      return;
+    }
+    if (drained)
+      return;
+    if (processing_limit == 0) {
+      // See OnMessage() for why the rest waits for the next iteration.
+      TriggerAsync();
+      return;
+    }
+  }
+}
+
 void MessagePort::OnClose() {
   Debug(this, "MessagePort::OnClose()");
   if (data_) {
@@ -842,11 +1162,13 @@ BaseObjectPtr<BaseObject> MessagePortData::Deserialize(
 Maybe<bool> MessagePort::PostMessage(Environment* env,
                                      Local<Context> context,
                                      Local<Value> message_v,
-                                     const TransferList& transfer_v) {
+                                     const TransferList& transfer_v,
+                                     bool shared_payload) {
   Isolate* isolate = env->isolate();
   Local<Object> obj = object(isolate);
 
   std::shared_ptr<Message> msg = std::make_shared<Message>();
+  msg->set_shared_payload(shared_payload);
 
   // Per spec, we need to both check if transfer list has the source port, and
   // serialize the input message, even if the MessagePort is closed or detached.
@@ -957,11 +1279,17 @@ void MessagePort::PostMessage(const FunctionCallbackInfo<Value>& args) {
   }
 
   TransferList transfer_list;
+  bool shared_payload = false;
   if (args[1]->IsObject()) {
     bool was_iterable;
     if (!ReadIterable(env, context, transfer_list, args[1]).To(&was_iterable))
       return;
     if (!was_iterable) {
+      // A Node.js extension, see Message::set_shared_payload().
+      Local<Value> shared_option;
+      if (!args[1].As<Object>()->Get(context, env->shared_string())
+          .ToLocal(&shared_option)) return;
+      shared_payload = shared_option->IsTrue();
       Local<Value> transfer_option;
       if (!args[1].As<Object>()->Get(context, env->transfer_string())
           .ToLocal(&transfer_option)) return;
@@ -986,7 +1314,8 @@ void MessagePort::PostMessage(const FunctionCallbackInfo<Value>& args) {
     return;
   }
 
-  Maybe<bool> res = port->PostMessage(env, context, args[0], transfer_list);
+  Maybe<bool> res = port->PostMessage(
+      env, context, args[0], transfer_list, shared_payload);
   if (res.IsJust())
     args.GetReturnValue().Set(res.FromJust());
 }
@@ -1483,6 +1812,7 @@ static void InitMessaging(Local<Object> target,
   env->SetMethod(target, "setDeserializerCreateObjectFunction",
                  SetDeserializerCreateObjectFunction);
   env->SetMethod(target, "broadcastChannel", BroadcastChannel);
+  RingChannel::Initialize(env, target);
 
   {
     Local<Function> domexception = GetDOMException(context).ToLocalChecked();
@@ -1507,6 +1837,7 @@ static void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(MessagePort::ReceiveMessage);
   registry->Register(MessagePort::MoveToContext);
   registry->Register(SetDeserializerCreateObjectFunction);
+  RingChannel::RegisterExternalReferences(registry);
 }
 
 }  // anonymous namespace
@@ -46,8 +46,9 @@ class TransferData : public MemoryRetainer {
 class Message : public MemoryRetainer {
  public:
   // Create a Message with a specific underlying payload, in the format of the
-  // V8 ValueSerializer API. If `payload` is empty, this message indicates
-  // that the receiving message port should close itself.
+  // V8 ValueSerializer API or of codec::Serialize(). If `payload` is empty,
+  // this message indicates that the receiving message port should close
+  // itself.
   explicit Message(MallocedBuffer<char>&& payload = MallocedBuffer<char>());
   ~Message() = default;
 
@@ -88,6 +89,23 @@ class Message : public MemoryRetainer {
   // Internal method of Message that is called when a new WebAssembly.Module
   // object is encountered in the incoming value's structure.
   uint32_t AddWASMModule(v8::CompiledWasmModule&& mod);
+  // Internal method of Message that is called for ArrayBufferViews when the
+  // transfer list contains any. Only the viewed range is passed on, either
+  // sharing the memory of the original buffer, or as a copy.
+  uint32_t AddArrayBufferRange(std::shared_ptr<v8::BackingStore> store,
+                               size_t offset,
+                               size_t length);
+
+  // With a shared payload, the ArrayBufferViews of the message are copied
+  // once into memory that all receivers share, and are received as views
+  // of SharedArrayBuffers. This avoids a copy for each receiver of a
+  // BroadcastChannel message. The memory is meant to be read-only, which
+  // is up to the receivers. Must be set before Serialize().
+  void set_shared_payload(bool shared_payload) {
+    shared_payload_ = shared_payload;
+  }
+  bool shared_payload() const { return shared_payload_; }
+  uint32_t AddSharedView(std::shared_ptr<v8::BackingStore> store);
 
   // The host objects that will be transferred, as recorded by Serialize()
   // (e.g. MessagePorts).
@@ -97,7 +115,8 @@ class Message : public MemoryRetainer {
     return transferables_;
   }
   bool has_transferables() const {
-    return !transferables_.empty() || !array_buffers_.empty();
+    return !transferables_.empty() || !array_buffers_.empty() ||
+           !array_buffer_ranges_.empty();
   }
 
   void MemoryInfo(MemoryTracker* tracker) const override;
@@ -114,6 +133,15 @@ class Message : public MemoryRetainer {
   std::vector<std::shared_ptr<v8::BackingStore>> shared_array_buffers_;
   std::vector<std::unique_ptr<TransferData>> transferables_;
   std::vector<v8::CompiledWasmModule> wasm_modules_;
+  struct ArrayBufferRange {
+    std::shared_ptr<v8::BackingStore> store;
+    size_t offset;
+    size_t length;
+  };
+  std::vector<ArrayBufferRange> array_buffer_ranges_;
+  // Unlike the above, these are read by every receiver of the message.
+  std::vector<std::shared_ptr<v8::BackingStore>> shared_views_;
+  bool shared_payload_ = false;
 
   friend class MessagePort;
 };
@@ -241,10 +269,12 @@ class MessagePort : public HandleWrap {
   // Send a message, i.e. deliver it into the sibling's incoming queue.
   // If this port is closed, or if there is no sibling, this message is
   // serialized with transfers, then silently discarded.
+  // See Message::set_shared_payload() for `shared_payload`.
   v8::Maybe<bool> PostMessage(Environment* env,
                               v8::Local<v8::Context> context,
                               v8::Local<v8::Value> message,
-                              const TransferList& transfer);
+                              const TransferList& transfer,
+                              bool shared_payload = false);
 
   // Start processing messages on this port as a receiving end.
   void Start();
@@ -301,6 +331,9 @@ class MessagePort : public HandleWrap {
 
   void OnClose() override;
   void OnMessage(MessageProcessingMode mode);
+  void OnMessageBatch(v8::Local<v8::Context> context,
+                      v8::Local<v8::Function> emit_batch,
+                      size_t processing_limit);
   void TriggerAsync();
   v8::MaybeLocal<v8::Value> ReceiveMessage(
       v8::Local<v8::Context> context,
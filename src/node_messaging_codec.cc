@@ -0,0 +1,712 @@
+#include "node_messaging_codec.h"
+
+#include "node_mutex.h"
+#include "util-inl.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node {
+namespace worker {
+namespace codec {
+
+using v8::Array;
+using v8::ArrayBuffer;
+using v8::BackingStore;
+using v8::Boolean;
+using v8::Context;
+using v8::EscapableHandleScope;
+using v8::IndexFilter;
+using v8::Integer;
+using v8::Isolate;
+using v8::Just;
+using v8::KeyCollectionMode;
+using v8::KeyConversionMode;
+using v8::Local;
+using v8::Maybe;
+using v8::MaybeLocal;
+using v8::NewStringType;
+using v8::Nothing;
+using v8::Null;
+using v8::Number;
+using v8::Object;
+using v8::PropertyFilter;
+using v8::String;
+using v8::TypedArray;
+using v8::Undefined;
+using v8::Value;
+
+namespace {
+
+// v8::ValueSerializer output starts with its version tag, 0xff.
+constexpr uint8_t kMagic = 0x01;
+
+enum Tag : uint8_t {
+  kUndefined,
+  kNull,
+  kTrue,
+  kFalse,
+  kInt32,
+  kDouble,
+  kOneByteString,
+  kTwoByteString,
+  kArray,
+  // An object whose layout is in the shared table.
+  kObject,
+  // An object whose layout is written in the message itself.
+  kObjectWithKeys,
+  kTypedArray,
+};
+
+enum TypedArrayType : uint8_t {
+  kInt8Array,
+  kUint8Array,
+  kUint8ClampedArray,
+  kInt16Array,
+  kUint16Array,
+  kInt32Array,
+  kUint32Array,
+  kFloat32Array,
+  kFloat64Array,
+  kBigInt64Array,
+  kBigUint64Array,
+};
+
+// Anything deeper, longer or larger than this is left to ValueSerializer.
+constexpr int kMaxDepth = 64;
+constexpr uint32_t kMaxArrayLength = 4096;
+constexpr uint32_t kMaxObjectKeys = 256;
+// Only small layouts are shared, so that the table stays small too.
+constexpr size_t kMaxLayoutSize = 1024;
+constexpr size_t kMaxLayouts = 8192;
+
+// The keys of an object layout, in the same encoding as strings in a
+// message, but without any alignment. Layouts are never removed, so that
+// an index stays valid for as long as the process runs.
+class LayoutTable {
+ public:
+  // Returns false if the table is full.
+  bool Add(const std::string& keys, uint32_t* index) {
+    Mutex::ScopedLock lock(mutex_);
+    auto it = indices_.find(keys);
+    if (it != indices_.end()) {
+      *index = it->second;
+      return true;
+    }
+    if (layouts_.size() >= kMaxLayouts)
+      return false;
+    *index = layouts_.size();
+    layouts_.push_back(keys);
+    indices_.emplace(keys, *index);
+    return true;
+  }
+
+  const std::string* Get(uint32_t index) {
+    Mutex::ScopedLock lock(mutex_);
+    CHECK_LT(index, layouts_.size());
+    return &layouts_[index];
+  }
+
+ private:
+  Mutex mutex_;
+  std::unordered_map<std::string, uint32_t> indices_;
+  std::deque<std::string> layouts_;
+};
+
+LayoutTable* layout_table() {
+  // Never destroyed, as threads may still use it while the process exits.
+  static LayoutTable* const table = new LayoutTable();
+  return table;
+}
+
+// Per-thread copies of the table, so that lookups do not take the lock.
+thread_local std::unordered_map<std::string, uint32_t> layout_indices;
+thread_local std::vector<const std::string*> layouts;
+
+bool FindLayout(const std::string& keys, uint32_t* index) {
+  auto it = layout_indices.find(keys);
+  if (it != layout_indices.end()) {
+    *index = it->second;
+    return true;
+  }
+  if (keys.size() > kMaxLayoutSize || !layout_table()->Add(keys, index))
+    return false;
+  layout_indices.emplace(keys, *index);
+  return true;
+}
+
+const std::string& GetLayout(uint32_t index) {
+  if (index >= layouts.size())
+    layouts.resize(index + 1);
+  if (layouts[index] == nullptr)
+    layouts[index] = layout_table()->Get(index);
+  return *layouts[index];
+}
+
+// A growable malloc()ed buffer, as Message owns its payload that way. It
+// also has the parts of the std::string interface that the helpers below
+// use, so that they can write layouts into a std::string.
+class Writer {
+ public:
+  Writer() = default;
+  ~Writer() { free(data_); }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  size_t size() const { return size_; }
+
+  void push_back(char c) { *Append(1) = c; }
+  void append(const char* data, size_t length) {
+    if (length > 0)
+      memcpy(Append(length), data, length);
+  }
+
+  // Returns space for `length` more bytes at the end.
+  char* Append(size_t length) {
+    if (size_ + length > capacity_) {
+      capacity_ = std::max({capacity_ * 2, size_ + length, size_t{256}});
+      data_ = Realloc(data_, capacity_);
+    }
+    char* result = data_ + size_;
+    size_ += length;
+    return result;
+  }
+
+  MallocedBuffer<char> Release() {
+    MallocedBuffer<char> result(data_, size_);
+    data_ = nullptr;
+    size_ = capacity_ = 0;
+    return result;
+  }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+char* Append(Writer* out, size_t length) {
+  return out->Append(length);
+}
+
+char* Append(std::string* out, size_t length) {
+  size_t size = out->size();
+  out->resize(size + length);
+  return &(*out)[size];
+}
+
+template <typename Out>
+void WriteVarint(Out* out, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0)
+      byte |= 0x80;
+    out->push_back(static_cast<char>(byte));
+  } while (value != 0);
+}
+
+// Two-byte strings are aligned to two bytes in messages, so that they can
+// be read in place, but not in layouts.
+template <typename Out>
+void WriteString(Isolate* isolate, Local<String> string, Out* out,
+                 bool align) {
+  const int length = string->Length();
+  if (string->IsOneByte()) {
+    out->push_back(kOneByteString);
+    WriteVarint(out, length);
+    string->WriteOneByte(isolate,
+                         reinterpret_cast<uint8_t*>(Append(out, length)),
+                         0,
+                         length,
+                         String::NO_NULL_TERMINATION);
+    return;
+  }
+  out->push_back(kTwoByteString);
+  WriteVarint(out, length);
+  if (align) {
+    while (out->size() % sizeof(uint16_t) != 0)
+      out->push_back(0);
+  }
+  char* data = Append(out, length * sizeof(uint16_t));
+  if (align) {
+    string->Write(isolate, reinterpret_cast<uint16_t*>(data), 0, length,
+                  String::NO_NULL_TERMINATION);
+  } else {
+    MaybeStackBuffer<uint16_t> buffer(length);
+    string->Write(isolate, buffer.out(), 0, length,
+                  String::NO_NULL_TERMINATION);
+    memcpy(data, buffer.out(), length * sizeof(uint16_t));
+  }
+}
+
+class Serializer {
+ public:
+  explicit Serializer(Local<Context> context)
+      : context_(context),
+        isolate_(context->GetIsolate()),
+        object_prototype_(Object::New(isolate_)->GetPrototype()) {
+    writer_.push_back(kMagic);
+  }
+
+  // Returns Just(false) if the value needs ValueSerializer.
+  Maybe<bool> WriteValue(Local<Value> value, int depth);
+
+  MallocedBuffer<char> Release() { return writer_.Release(); }
+
+ private:
+  Maybe<bool> WriteArray(Local<Array> array, int depth);
+  Maybe<bool> WriteObject(Local<Object> object, int depth);
+  bool WriteTypedArray(Local<TypedArray> view);
+  bool IsPlainObject(Local<Object> object) const;
+  // Returns false if `object` was seen before, as only ValueSerializer
+  // keeps track of objects that occur more than once.
+  bool AddObject(Local<Object> object);
+
+  Local<Context> context_;
+  Isolate* isolate_;
+  Local<Value> object_prototype_;
+  Writer writer_;
+  std::unordered_multimap<int, Local<Object>> objects_;
+  std::string keys_;
+};
+
+Maybe<bool> Serializer::WriteValue(Local<Value> value, int depth) {
+  if (depth > kMaxDepth)
+    return Just(false);
+
+  if (value->IsUndefined()) {
+    writer_.push_back(kUndefined);
+  } else if (value->IsNull()) {
+    writer_.push_back(kNull);
+  } else if (value->IsTrue()) {
+    writer_.push_back(kTrue);
+  } else if (value->IsFalse()) {
+    writer_.push_back(kFalse);
+  } else if (value->IsInt32()) {
+    const int32_t number = value.As<Integer>()->Value();
+    writer_.push_back(kInt32);
+    // Zigzag encoding keeps small negative numbers short.
+    WriteVarint(&writer_, (static_cast<uint32_t>(number) << 1) ^
+                          static_cast<uint32_t>(number >> 31));
+  } else if (value->IsNumber()) {
+    const double number = value.As<Number>()->Value();
+    writer_.push_back(kDouble);
+    writer_.append(reinterpret_cast<const char*>(&number), sizeof(number));
+  } else if (value->IsString()) {
+    WriteString(isolate_, value.As<String>(), &writer_, true);
+  } else if (value->IsObject()) {
+    Local<Object> object = value.As<Object>();
+    if (object->IsProxy() || object->InternalFieldCount() != 0 ||
+        !AddObject(object)) {
+      return Just(false);
+    }
+    if (object->IsArray())
+      return WriteArray(object.As<Array>(), depth);
+    if (object->IsTypedArray())
+      return Just(WriteTypedArray(object.As<TypedArray>()));
+    if (!IsPlainObject(object))
+      return Just(false);
+    return WriteObject(object, depth);
+  } else {
+    // Symbols cannot be cloned, and BigInts are rare enough.
+    return Just(false);
+  }
+  return Just(true);
+}
+
+Maybe<bool> Serializer::WriteArray(Local<Array> array, int depth) {
+  const uint32_t length = array->Length();
+  if (length > kMaxArrayLength)
+    return Just(false);
+  // Other properties of arrays are cloned as well.
+  Local<Array> names;
+  if (!array->GetPropertyNames(context_,
+                               KeyCollectionMode::kOwnOnly,
+                               static_cast<PropertyFilter>(
+                                   v8::ONLY_ENUMERABLE | v8::SKIP_SYMBOLS),
+                               IndexFilter::kSkipIndices)
+           .ToLocal(&names)) {
+    return Nothing<bool>();
+  }
+  if (names->Length() != 0)
+    return Just(false);
+
+  writer_.push_back(kArray);
+  WriteVarint(&writer_, length);
+  for (uint32_t i = 0; i < length; i++) {
+    Local<Value> element;
+    if (!array->Get(context_, i).ToLocal(&element))
+      return Nothing<bool>();
+    if (element->IsUndefined()) {
+      // Holes are preserved by ValueSerializer.
+      bool has_element;
+      if (!array->HasRealIndexedProperty(context_, i).To(&has_element))
+        return Nothing<bool>();
+      if (!has_element)
+        return Just(false);
+    }
+    bool written;
+    if (!WriteValue(element, depth + 1).To(&written))
+      return Nothing<bool>();
+    if (!written)
+      return Just(false);
+  }
+  return Just(true);
+}
+
+Maybe<bool> Serializer::WriteObject(Local<Object> object, int depth) {
+  Local<Array> names;
+  if (!object->GetOwnPropertyNames(context_,
+                                   static_cast<PropertyFilter>(
+                                       v8::ONLY_ENUMERABLE | v8::SKIP_SYMBOLS),
+                                   KeyConversionMode::kConvertToString)
+           .ToLocal(&names)) {
+    return Nothing<bool>();
+  }
+  const uint32_t count = names->Length();
+  if (count > kMaxObjectKeys)
+    return Just(false);
+
+  keys_.clear();
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> name;
+    if (!names->Get(context_, i).ToLocal(&name))
+      return Nothing<bool>();
+    CHECK(name->IsString());
+    // Falling back after running a getter would run it a second time.
+    bool is_accessor;
+    if (!object->HasRealNamedCallbackProperty(context_, name.As<String>())
+             .To(&is_accessor)) {
+      return Nothing<bool>();
+    }
+    if (is_accessor)
+      return Just(false);
+    WriteString(isolate_, name.As<String>(), &keys_, false);
+  }
+
+  uint32_t layout;
+  if (FindLayout(keys_, &layout)) {
+    writer_.push_back(kObject);
+    WriteVarint(&writer_, layout);
+  } else {
+    writer_.push_back(kObjectWithKeys);
+    WriteVarint(&writer_, keys_.size());
+    writer_.append(keys_.data(), keys_.size());
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> name;
+    Local<Value> value;
+    if (!names->Get(context_, i).ToLocal(&name) ||
+        !object->Get(context_, name).ToLocal(&value)) {
+      return Nothing<bool>();
+    }
+    bool written;
+    if (!WriteValue(value, depth + 1).To(&written))
+      return Nothing<bool>();
+    if (!written)
+      return Just(false);
+  }
+  return Just(true);
+}
+
+bool Serializer::WriteTypedArray(Local<TypedArray> view) {
+  TypedArrayType type;
+  if (view->IsInt8Array()) {
+    type = kInt8Array;
+  } else if (view->IsUint8Array()) {
+    type = kUint8Array;
+  } else if (view->IsUint8ClampedArray()) {
+    type = kUint8ClampedArray;
+  } else if (view->IsInt16Array()) {
+    type = kInt16Array;
+  } else if (view->IsUint16Array()) {
+    type = kUint16Array;
+  } else if (view->IsInt32Array()) {
+    type = kInt32Array;
+  } else if (view->IsUint32Array()) {
+    type = kUint32Array;
+  } else if (view->IsFloat32Array()) {
+    type = kFloat32Array;
+  } else if (view->IsFloat64Array()) {
+    type = kFloat64Array;
+  } else if (view->IsBigInt64Array()) {
+    type = kBigInt64Array;
+  } else {
+    CHECK(view->IsBigUint64Array());
+    type = kBigUint64Array;
+  }
+
+  // Like ValueSerializer, copy the whole ArrayBuffer, so that the copy has
+  // the same byteOffset and buffer.byteLength. Detached and shared buffers,
+  // and buffers that occur more than once, are left to ValueSerializer.
+  Local<ArrayBuffer> buffer = view->Buffer();
+  if (buffer->IsSharedArrayBuffer() || buffer->ByteLength() == 0 ||
+      !AddObject(buffer)) {
+    return false;
+  }
+  std::shared_ptr<BackingStore> store = buffer->GetBackingStore();
+  writer_.push_back(kTypedArray);
+  writer_.push_back(type);
+  WriteVarint(&writer_, store->ByteLength());
+  WriteVarint(&writer_, view->ByteOffset());
+  WriteVarint(&writer_, view->Length());
+  writer_.append(static_cast<const char*>(store->Data()), store->ByteLength());
+  return true;
+}
+
+bool Serializer::IsPlainObject(Local<Object> object) const {
+  // Most other objects have a different prototype, but that can be changed.
+  if (object->IsFunction() || object->IsArgumentsObject() ||
+      object->IsDate() || object->IsRegExp() || object->IsNativeError() ||
+      object->IsMap() || object->IsSet() || object->IsWeakMap() ||
+      object->IsWeakSet() || object->IsMapIterator() ||
+      object->IsSetIterator() || object->IsGeneratorObject() ||
+      object->IsPromise() || object->IsBooleanObject() ||
+      object->IsNumberObject() || object->IsStringObject() ||
+      object->IsSymbolObject() || object->IsBigIntObject() ||
+      object->IsArrayBuffer() || object->IsSharedArrayBuffer() ||
+      object->IsArrayBufferView() || object->IsWasmMemoryObject() ||
+      object->IsWasmModuleObject() || object->IsModuleNamespaceObject()) {
+    return false;
+  }
+  Local<Value> prototype = object->GetPrototype();
+  return prototype == object_prototype_ || prototype->IsNull();
+}
+
+bool Serializer::AddObject(Local<Object> object) {
+  const int hash = object->GetIdentityHash();
+  auto range = objects_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == object)
+      return false;
+  }
+  objects_.emplace(hash, object);
+  return true;
+}
+
+class Deserializer {
+ public:
+  Deserializer(Local<Context> context, const char* data, size_t length)
+      : context_(context),
+        isolate_(context->GetIsolate()),
+        data_(data),
+        end_(data + length),
+        position_(data + 1) {}
+
+  MaybeLocal<Value> ReadValue();
+  bool IsAtEnd() const { return position_ == end_; }
+
+ private:
+  uint8_t ReadByte() {
+    CHECK_LT(position_, end_);
+    return static_cast<uint8_t>(*position_++);
+  }
+
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      CHECK_LT(shift, 64);
+      const uint8_t byte = ReadByte();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        return value;
+    }
+  }
+
+  const char* ReadBytes(size_t length) {
+    CHECK_LE(length, static_cast<size_t>(end_ - position_));
+    const char* result = position_;
+    position_ += length;
+    return result;
+  }
+
+  MaybeLocal<String> ReadString(uint8_t tag);
+  MaybeLocal<Value> ReadObject(const std::string& keys);
+  MaybeLocal<Value> ReadTypedArray();
+
+  Local<Context> context_;
+  Isolate* isolate_;
+  const char* const data_;
+  const char* const end_;
+  const char* position_;
+};
+
+MaybeLocal<Value> Deserializer::ReadValue() {
+  const uint8_t tag = ReadByte();
+  switch (tag) {
+    case kUndefined:
+      return Undefined(isolate_);
+    case kNull:
+      return Null(isolate_);
+    case kTrue:
+    case kFalse:
+      return Boolean::New(isolate_, tag == kTrue);
+    case kInt32: {
+      const uint32_t value = static_cast<uint32_t>(ReadVarint());
+      return Integer::New(isolate_, static_cast<int32_t>(
+                                        (value >> 1) ^ (0U - (value & 1))));
+    }
+    case kDouble: {
+      double value;
+      memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+      return Number::New(isolate_, value);
+    }
+    case kOneByteString:
+    case kTwoByteString: {
+      Local<String> string;
+      if (!ReadString(tag).ToLocal(&string))
+        return {};
+      return string;
+    }
+    case kArray: {
+      const size_t length = ReadVarint();
+      CHECK_LE(length, kMaxArrayLength);
+      std::vector<Local<Value>> elements(length);
+      for (size_t i = 0; i < length; i++) {
+        if (!ReadValue().ToLocal(&elements[i]))
+          return {};
+      }
+      return Array::New(isolate_, elements.data(), length);
+    }
+    case kObject:
+      return ReadObject(GetLayout(static_cast<uint32_t>(ReadVarint())));
+    case kObjectWithKeys: {
+      const size_t size = ReadVarint();
+      return ReadObject(std::string(ReadBytes(size), size));
+    }
+    case kTypedArray:
+      return ReadTypedArray();
+  }
+  UNREACHABLE();
+}
+
+MaybeLocal<String> Deserializer::ReadString(uint8_t tag) {
+  const size_t length = ReadVarint();
+  if (tag == kOneByteString) {
+    return String::NewFromOneByte(
+        isolate_,
+        reinterpret_cast<const uint8_t*>(ReadBytes(length)),
+        NewStringType::kNormal,
+        length);
+  }
+  CHECK_EQ(tag, kTwoByteString);
+  while ((position_ - data_) % sizeof(uint16_t) != 0)
+    ReadByte();
+  return String::NewFromTwoByte(
+      isolate_,
+      reinterpret_cast<const uint16_t*>(ReadBytes(length * sizeof(uint16_t))),
+      NewStringType::kNormal,
+      length);
+}
+
+MaybeLocal<Value> Deserializer::ReadObject(const std::string& keys) {
+  Local<Object> object = Object::New(isolate_);
+  const char* position = keys.data();
+  const char* const end = position + keys.size();
+  while (position < end) {
+    // Layouts are written by WriteString() without alignment, always in
+    // this process, so only their total size is checked.
+    const uint8_t tag = static_cast<uint8_t>(*position++);
+    size_t length = 0;
+    for (int shift = 0;; shift += 7) {
+      const uint8_t byte = static_cast<uint8_t>(*position++);
+      length |= static_cast<size_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        break;
+    }
+    MaybeLocal<String> maybe_name;
+    if (tag == kOneByteString) {
+      maybe_name = String::NewFromOneByte(
+          isolate_,
+          reinterpret_cast<const uint8_t*>(position),
+          NewStringType::kInternalized,
+          length);
+      position += length;
+    } else {
+      CHECK_EQ(tag, kTwoByteString);
+      MaybeStackBuffer<uint16_t> buffer(length);
+      memcpy(buffer.out(), position, length * sizeof(uint16_t));
+      maybe_name = String::NewFromTwoByte(
+          isolate_, buffer.out(), NewStringType::kInternalized, length);
+      position += length * sizeof(uint16_t);
+    }
+    Local<String> name;
+    Local<Value> value;
+    if (!maybe_name.ToLocal(&name) || !ReadValue().ToLocal(&value) ||
+        object->CreateDataProperty(context_, name, value).IsNothing()) {
+      return {};
+    }
+  }
+  CHECK_EQ(position, end);
+  return object;
+}
+
+MaybeLocal<Value> Deserializer::ReadTypedArray() {
+  const uint8_t type = ReadByte();
+  const size_t byte_length = ReadVarint();
+  const size_t byte_offset = ReadVarint();
+  const size_t length = ReadVarint();
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate_, byte_length);
+  memcpy(buffer->GetBackingStore()->Data(), ReadBytes(byte_length),
+         byte_length);
+  switch (type) {
+#define V(Type)                                                               \
+    case k##Type:                                                             \
+      return v8::Type::New(buffer, byte_offset, length);
+    V(Int8Array)
+    V(Uint8Array)
+    V(Uint8ClampedArray)
+    V(Int16Array)
+    V(Uint16Array)
+    V(Int32Array)
+    V(Uint32Array)
+    V(Float32Array)
+    V(Float64Array)
+    V(BigInt64Array)
+    V(BigUint64Array)
+#undef V
+  }
+  UNREACHABLE();
+}
+
+}  // anonymous namespace
+
+Maybe<bool> Serialize(Local<Context> context,
+                      Local<Value> value,
+                      MallocedBuffer<char>* out) {
+  Serializer serializer(context);
+  bool written;
+  if (!serializer.WriteValue(value, 0).To(&written))
+    return Nothing<bool>();
+  if (written)
+    *out = serializer.Release();
+  return Just(written);
+}
+
+bool IsEncoded(const char* data, size_t length) {
+  return length > 0 && static_cast<uint8_t>(data[0]) == kMagic;
+}
+
+MaybeLocal<Value> Deserialize(Local<Context> context,
+                              const char* data,
+                              size_t length) {
+  CHECK(IsEncoded(data, length));
+  EscapableHandleScope handle_scope(context->GetIsolate());
+  Deserializer deserializer(context, data, length);
+  Local<Value> value;
+  if (!deserializer.ReadValue().ToLocal(&value))
+    return {};
+  CHECK(deserializer.IsAtEnd());
+  return handle_scope.Escape(value);
+}
+
+}  // namespace codec
+}  // namespace worker
+}  // namespace node
@@ -0,0 +1,44 @@
+#ifndef SRC_NODE_MESSAGING_CODEC_H_
+#define SRC_NODE_MESSAGING_CODEC_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "util.h"
+#include "v8.h"
+
+#include <cstddef>
+
+namespace node {
+namespace worker {
+
+// A compact encoding for the common case of messages that are plain data:
+// primitives, strings, dense arrays, ordinary objects and typed arrays.
+// It produces the same values as structured cloning through
+// v8::ValueSerializer does, but skips the generic machinery, and it writes
+// the keys of each object layout only once per process. Layouts are
+// registered in a table that all threads share, and both ends of a channel
+// look them up by index.
+namespace codec {
+
+// Returns Just(false) without touching `out` if `value` contains anything
+// that needs the full structured clone algorithm, and Nothing() if reading
+// `value` threw an exception.
+v8::Maybe<bool> Serialize(v8::Local<v8::Context> context,
+                          v8::Local<v8::Value> value,
+                          MallocedBuffer<char>* out);
+
+// Whether `data` was written by Serialize(), rather than by
+// v8::ValueSerializer, whose output always starts with a different byte.
+bool IsEncoded(const char* data, size_t length);
+
+v8::MaybeLocal<v8::Value> Deserialize(v8::Local<v8::Context> context,
+                                      const char* data,
+                                      size_t length);
+
+}  // namespace codec
+}  // namespace worker
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_MESSAGING_CODEC_H_
@@ -51,6 +51,18 @@ std::string GetOpenSSLVersion() {
   snprintf(buf, sizeof(buf), "%.*s", len, &OPENSSL_VERSION_TEXT[start]);
   return std::string(buf);
 }
+
+void Metadata::Versions::InitializeOpenSSLVersions() {
+#if OPENSSL_VERSION_MAJOR >= 3
+  // Something like "OPENSSL_ia32cap=0x7ffaf3bfffebffff:0x40069c219c97a9",
+  // which can be fed back through the environment to reproduce a run with
+  // the same set of accelerated code paths. Empty when OpenSSL was built
+  // without assembly support.
+  const char* cpu_settings = OPENSSL_info(OPENSSL_INFO_CPU_SETTINGS);
+  if (cpu_settings != nullptr)
+    openssl_cpu = cpu_settings;
+#endif  // OPENSSL_VERSION_MAJOR >= 3
+}
 #endif  // HAVE_OPENSSL
 
 #ifdef NODE_HAVE_I18N_SUPPORT
@@ -40,7 +40,9 @@ namespace node {
   V(llhttp)                                                                    \
 
 #if HAVE_OPENSSL
-#define NODE_VERSIONS_KEY_CRYPTO(V) V(openssl)
+#define NODE_VERSIONS_KEY_CRYPTO(V)                                            \
+  V(openssl)                                                                   \
+  V(openssl_cpu)
 #else
 #define NODE_VERSIONS_KEY_CRYPTO(V)
 #endif
@@ -86,6 +88,12 @@ class Metadata {
     void InitializeIntlVersions();
 #endif  // NODE_HAVE_I18N_SUPPORT
 
+#if HAVE_OPENSSL
+    // Must be called after OpenSSL has been initialized, the CPU capability
+    // vector it reports is only final once its configuration is loaded.
+    void InitializeOpenSSLVersions();
+#endif  // HAVE_OPENSSL
+
 #define V(key) std::string key;
     NODE_VERSIONS_KEYS(V)
 #undef V
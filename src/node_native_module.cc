@@ -1,6 +1,8 @@
 #include "node_native_module.h"
+#include "node_startup_profile.h"
 #include "util-inl.h"
 #include "debug_utils-inl.h"
+#include "zlib.h"
 
 namespace node {
 namespace native_module {
@@ -27,7 +29,8 @@ NativeModuleLoader* NativeModuleLoader::GetInstance() {
 }
 
 bool NativeModuleLoader::Exists(const char* id) {
-  return source_.find(id) != source_.end();
+  return source_.find(id) != source_.end() ||
+         compressed_source_.find(id) != compressed_source_.end();
 }
 
 bool NativeModuleLoader::Add(const char* id, const UnionBytes& source) {
@@ -38,12 +41,63 @@ bool NativeModuleLoader::Add(const char* id, const UnionBytes& source) {
   return true;
 }
 
+bool NativeModuleLoader::AddCompressed(const char* id,
+                                       const uint8_t* data,
+                                       size_t compressed_length,
+                                       size_t length,
+                                       bool is_one_byte) {
+  if (Exists(id)) {
+    return false;
+  }
+  compressed_source_.emplace(
+      id,
+      CompressedNativeModuleSource{
+          data, compressed_length, length, is_one_byte, nullptr});
+  return true;
+}
+
+UnionBytes NativeModuleLoader::GetSource(const char* id) {
+  const auto source_it = source_.find(id);
+  if (source_it != source_.end()) {
+    return source_it->second;
+  }
+  const auto compressed_it = compressed_source_.find(id);
+  if (UNLIKELY(compressed_it == compressed_source_.end())) {
+    fprintf(stderr, "Cannot find native builtin: \"%s\".\n", id);
+    ABORT();
+  }
+
+  CompressedNativeModuleSource* compressed = &compressed_it->second;
+  const size_t size =
+      compressed->length * (compressed->is_one_byte ? 1 : sizeof(uint16_t));
+  Mutex::ScopedLock lock(source_mutex_);
+  if (!compressed->inflated) {
+    per_process::Debug(DebugCategory::CODE_CACHE, "Inflating %s\n", id);
+    std::unique_ptr<uint8_t[]> inflated(new uint8_t[size]);
+    uLongf inflated_size = size;
+    CHECK_EQ(uncompress(inflated.get(),
+                        &inflated_size,
+                        compressed->data,
+                        compressed->compressed_length),
+             Z_OK);
+    CHECK_EQ(inflated_size, size);
+    compressed->inflated = std::move(inflated);
+  }
+  if (compressed->is_one_byte) {
+    return UnionBytes(compressed->inflated.get(), compressed->length);
+  }
+  return UnionBytes(reinterpret_cast<const uint16_t*>(
+                        compressed->inflated.get()),
+                    compressed->length);
+}
+
 Local<Object> NativeModuleLoader::GetSourceObject(Local<Context> context) {
   Isolate* isolate = context->GetIsolate();
   Local<Object> out = Object::New(isolate);
-  for (auto const& x : source_) {
-    Local<String> key = OneByteString(isolate, x.first.c_str(), x.first.size());
-    out->Set(context, key, x.second.ToStringChecked(isolate)).FromJust();
+  for (auto const& id : GetModuleIds()) {
+    Local<String> key = OneByteString(isolate, id.c_str(), id.size());
+    out->Set(context, key, GetSource(id.c_str()).ToStringChecked(isolate))
+        .FromJust();
   }
   return out;
 }
@@ -54,10 +108,13 @@ Local<String> NativeModuleLoader::GetConfigString(Isolate* isolate) {
 
 std::vector<std::string> NativeModuleLoader::GetModuleIds() {
   std::vector<std::string> ids;
-  ids.reserve(source_.size());
+  ids.reserve(source_.size() + compressed_source_.size());
   for (auto const& x : source_) {
     ids.emplace_back(x.first);
   }
+  for (auto const& x : compressed_source_) {
+    ids.emplace_back(x.first);
+  }
   return ids;
 }
 
@@ -116,8 +173,8 @@ void NativeModuleLoader::InitializeModuleCategories() {
       "internal/v8_prof_processor",
   };
 
-  for (auto const& x : source_) {
-    const std::string& id = x.first;
+  const std::vector<std::string> ids = GetModuleIds();
+  for (const std::string& id : ids) {
     for (auto const& prefix : prefixes) {
       if (prefix.length() > id.length()) {
         continue;
@@ -129,8 +186,7 @@ void NativeModuleLoader::InitializeModuleCategories() {
     }
   }
 
-  for (auto const& x : source_) {
-    const std::string& id = x.first;
+  for (const std::string& id : ids) {
     if (0 == module_categories_.cannot_be_required.count(id)) {
       module_categories_.can_be_required.emplace(id);
     }
@@ -209,12 +265,7 @@ MaybeLocal<String> NativeModuleLoader::LoadBuiltinModuleSource(Isolate* isolate,
 #ifdef NODE_BUILTIN_MODULES_PATH
   if (strncmp(id, "embedder_main_", strlen("embedder_main_")) == 0) {
 #endif  // NODE_BUILTIN_MODULES_PATH
-    const auto source_it = source_.find(id);
-    if (UNLIKELY(source_it == source_.end())) {
-      fprintf(stderr, "Cannot find native builtin: \"%s\".\n", id);
-      ABORT();
-    }
-    return source_it->second.ToStringChecked(isolate);
+    return GetSource(id).ToStringChecked(isolate);
 #ifdef NODE_BUILTIN_MODULES_PATH
   }
   std::string filename = OnDiskFileName(id);
@@ -317,6 +368,9 @@ MaybeLocal<Function> NativeModuleLoader::LookupAndCompile(
     code_cache_.emplace(id, std::move(new_cached_data));
   }
 
+  if (StartupProfile* profile = StartupProfile::GetRecording(isolate))
+    profile->AddBuiltin(id, fun);
+
   return scope.Escape(fun);
 }
 
@@ -15,9 +15,24 @@
 class PerProcessTest;
 
 namespace node {
+
+class StartupProfile;
+
 namespace native_module {
 
 using NativeModuleRecordMap = std::map<std::string, UnionBytes>;
+// Source text that is stored deflated in the binary, and only inflated the
+// first time that it is needed. The inflated text is kept for the lifetime
+// of the process, as external strings point into it.
+struct CompressedNativeModuleSource {
+  const uint8_t* data;
+  size_t compressed_length;
+  size_t length;  // In characters.
+  bool is_one_byte;
+  std::unique_ptr<uint8_t[]> inflated;  // Protected by source_mutex_.
+};
+using NativeModuleCompressedRecordMap =
+    std::map<std::string, CompressedNativeModuleSource>;
 using NativeModuleCacheMap =
     std::unordered_map<std::string,
                        std::unique_ptr<v8::ScriptCompiler::CachedData>>;
@@ -38,6 +53,7 @@ class NativeModuleLoader {
   // Only allow access from friends.
   friend class NativeModuleEnv;
   friend class CodeCacheBuilder;
+  friend class ::node::StartupProfile;
 
   NativeModuleLoader();
   static NativeModuleLoader* GetInstance();
@@ -48,6 +64,16 @@ class NativeModuleLoader {
 
   bool Exists(const char* id);
   bool Add(const char* id, const UnionBytes& source);
+  // Adds a source that zlib compressed, as one-byte or UTF-16 text of
+  // `length` characters. tools/js2c.py emits these calls for compressed
+  // builds.
+  bool AddCompressed(const char* id,
+                     const uint8_t* data,
+                     size_t compressed_length,
+                     size_t length,
+                     bool is_one_byte);
+  // Returns the source of a module, inflating it if necessary.
+  UnionBytes GetSource(const char* id);
 
   v8::Local<v8::Object> GetSourceObject(v8::Local<v8::Context> context);
   v8::Local<v8::String> GetConfigString(v8::Isolate* isolate);
@@ -84,6 +110,9 @@ class NativeModuleLoader {
   static NativeModuleLoader instance_;
   ModuleCategories module_categories_;
   NativeModuleRecordMap source_;
+  NativeModuleCompressedRecordMap compressed_source_;
+  // Used to synchronize inflating compressed sources
+  Mutex source_mutex_;
   NativeModuleCacheMap code_cache_;
   UnionBytes config_;
 
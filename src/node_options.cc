@@ -85,11 +85,45 @@ void PerProcessOptions::CheckOptions(std::vector<std::string>* errors) {
   }
 #endif  // HAVE_OPENSSL
 
+  if (loop_busy_poll < 0 ||
+      loop_busy_poll > std::numeric_limits<unsigned int>::max()) {
+    errors->push_back("--loop-busy-poll must be a non-negative number of "
+                      "microseconds");
+  }
+
+  if (thread_affinity != "none" &&
+      thread_affinity != "compact" &&
+      thread_affinity != "numa") {
+    errors->push_back("invalid value for --thread-affinity");
+  }
+
+  if (trace_event_format != "json" && trace_event_format != "proto") {
+    errors->push_back("invalid value for --trace-event-format");
+  }
+
   if (use_largepages != "off" &&
       use_largepages != "on" &&
       use_largepages != "silent") {
     errors->push_back("invalid value for --use-largepages");
   }
+
+  if (huge_pages != "off" &&
+      huge_pages != "madvise" &&
+      huge_pages != "explicit") {
+    errors->push_back("invalid value for --huge-pages");
+  }
+
+  if (huge_pages_threshold <= 0) {
+    errors->push_back("--huge-pages-threshold must be positive");
+  }
+
+  if (url_parse_cache_size < 0) {
+    errors->push_back("--url-parse-cache-size must not be negative");
+  }
+
+  if (worker_isolate_pool_size < 0) {
+    errors->push_back("--worker-isolate-pool-size must not be negative");
+  }
   per_isolate->CheckOptions(errors);
 }
 
@@ -142,6 +176,18 @@ void EnvironmentOptions::CheckOptions(std::vector<std::string>* errors) {
     errors->push_back("--heap-snapshot-near-heap-limit must not be negative");
   }
 
+  if (cpu_prof_continuous_interval == 0 ||
+      cpu_prof_continuous_interval > std::numeric_limits<int>::max()) {
+    errors->push_back("--cpu-prof-continuous-interval must be a positive "
+                      "number of microseconds");
+  }
+
+  if (cpu_prof_continuous_window == 0 ||
+      cpu_prof_continuous_window > std::numeric_limits<uint32_t>::max()) {
+    errors->push_back("--cpu-prof-continuous-window must be a positive "
+                      "number of seconds");
+  }
+
 #if HAVE_INSPECTOR
   if (!cpu_prof) {
     if (!cpu_prof_name.empty()) {
@@ -374,6 +420,11 @@ EnvironmentOptionsParser::EnvironmentOptionsParser() {
             "Generate heap snapshot on specified signal",
             &EnvironmentOptions::heap_snapshot_signal,
             kAllowedInEnvironment);
+  AddOption("--heapsnapshot-gzip",
+            "gzip the heap snapshots that are written to generated file "
+            "names, e.g. by --heapsnapshot-near-heap-limit",
+            &EnvironmentOptions::heap_snapshot_gzip,
+            kAllowedInEnvironment);
   AddOption("--heapsnapshot-near-heap-limit",
             "Generate heap snapshots whenever V8 is approaching "
             "the heap limit. No more than the specified number of "
@@ -445,6 +496,29 @@ EnvironmentOptionsParser::EnvironmentOptionsParser() {
             &EnvironmentOptions::prof_process);
   // Options after --prof-process are passed through to the prof processor.
   AddAlias("--prof-process", { "--prof-process", "--" });
+  AddOption("--cpu-prof-continuous",
+            "Profile the CPU all the time, and write a pprof profile for "
+            "each window of --cpu-prof-continuous-window seconds",
+            &EnvironmentOptions::cpu_prof_continuous);
+  AddOption("--cpu-prof-continuous-dir",
+            "Directory where the profiles of --cpu-prof-continuous are "
+            "written (default: --diagnostic-dir, or the current working "
+            "directory)",
+            &EnvironmentOptions::cpu_prof_continuous_dir);
+  AddOption("--cpu-prof-continuous-interval",
+            "sampling interval in microseconds for --cpu-prof-continuous "
+            "(default: 10000)",
+            &EnvironmentOptions::cpu_prof_continuous_interval);
+  AddOption("--cpu-prof-continuous-window",
+            "length in seconds of each profile written by "
+            "--cpu-prof-continuous (default: 60)",
+            &EnvironmentOptions::cpu_prof_continuous_window);
+  AddOption("--event-loop-stall-threshold",
+            "print the JavaScript and native stacks to stderr when the event "
+            "loop has not made progress for this many milliseconds "
+            "(default: 0, disabled)",
+            &EnvironmentOptions::event_loop_stall_threshold,
+            kAllowedInEnvironment);
 #if HAVE_INSPECTOR
   AddOption("--cpu-prof",
             "Start the V8 CPU profiler on start up, and write the CPU profile "
@@ -486,10 +560,32 @@ EnvironmentOptionsParser::EnvironmentOptionsParser() {
             "set the maximum size of HTTP headers (default: 16384 (16KB))",
             &EnvironmentOptions::max_http_header_size,
             kAllowedInEnvironment);
+  AddOption("--microtask-count-budget",
+            "once this many microtasks have run in a loop iteration, leave "
+            "the microtask and nextTick queues to the check phase rather "
+            "than draining them after each callback (default: 0, disabled)",
+            &EnvironmentOptions::microtask_count_budget,
+            kAllowedInEnvironment);
+  AddOption("--microtask-time-budget",
+            "as --microtask-count-budget, but for the milliseconds spent "
+            "draining the queues in a loop iteration (default: 0, disabled)",
+            &EnvironmentOptions::microtask_time_budget,
+            kAllowedInEnvironment);
+  AddOption("--realpath-cache",
+            "cache what fs.realpathSync() resolves each path and its "
+            "prefixes to, until they are renamed or removed",
+            &EnvironmentOptions::realpath_cache,
+            kAllowedInEnvironment);
   AddOption("--redirect-warnings",
             "write warnings to file instead of stderr",
             &EnvironmentOptions::redirect_warnings,
             kAllowedInEnvironment);
+  AddOption("--stream-write-coalescing",
+            "buffer stream writes smaller than this many bytes and send "
+            "them together once per event loop iteration (default: 0, "
+            "disabled)",
+            &EnvironmentOptions::stream_write_coalescing,
+            kAllowedInEnvironment);
   AddOption("--test-udp-no-try-send", "",  // For testing only.
             &EnvironmentOptions::test_udp_no_try_send);
   AddOption("--throw-deprecation",
@@ -698,12 +794,55 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "data, it supports ${rotation} and ${pid}.",
             &PerProcessOptions::trace_event_file_pattern,
             kAllowedInEnvironment);
+  AddOption("--trace-event-format",
+            "format of the trace-events data, json (default) or proto "
+            "for a Perfetto protobuf trace",
+            &PerProcessOptions::trace_event_format,
+            kAllowedInEnvironment);
+  AddOption("--trace-event-gzip",
+            "gzip-compress the trace-events data as it is written",
+            &PerProcessOptions::trace_event_gzip,
+            kAllowedInEnvironment);
   AddAlias("--trace-events-enabled", {
     "--trace-event-categories", "v8,node,node.async_hooks" });
   AddOption("--v8-pool-size",
-            "set V8's thread pool size",
+            "set V8's thread pool size (default: 4, or the number of CPUs "
+            "available to the process if lower)",
             &PerProcessOptions::v8_thread_pool_size,
             kAllowedInEnvironment);
+  AddOption("--loop-busy-poll",
+            "busy-poll the event loop for this many microseconds before it "
+            "blocks waiting for I/O (Linux only)",
+            &PerProcessOptions::loop_busy_poll,
+            kAllowedInEnvironment);
+  AddOption("--fast-exit",
+            "exit without tearing down the main environment, after "
+            "flushing stdio, traces and profiles and running the critical "
+            "exit hooks",
+            &PerProcessOptions::fast_exit,
+            kAllowedInEnvironment);
+  AddOption("--loop-epoll-exclusive",
+            "wake up only one of the processes that share a listening "
+            "socket for each new connection (Linux only)",
+            &PerProcessOptions::loop_epoll_exclusive,
+            kAllowedInEnvironment);
+  AddOption("--thread-affinity",
+            "pin platform, threadpool and worker threads to CPUs: "
+            "'none' (default), 'compact' (one CPU per thread) or "
+            "'numa' (one NUMA node per thread)",
+            &PerProcessOptions::thread_affinity,
+            kAllowedInEnvironment);
+  AddOption("--env-var-snapshot",
+            "read the environment once at startup and serve process.env "
+            "from that copy; changes made outside of process.env are not "
+            "seen",
+            &PerProcessOptions::env_var_snapshot,
+            kAllowedInEnvironment);
+  AddOption("--spawn-server",
+            "run the children of spawnSync() and execSync() from a helper "
+            "process forked at startup, which stays small (POSIX only)",
+            &PerProcessOptions::spawn_server,
+            kAllowedInEnvironment);
   AddOption("--zero-fill-buffers",
             "automatically zero-fill all newly allocated Buffer and "
             "SlowBuffer instances",
@@ -713,6 +852,46 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "", /* undocumented, only for debugging */
             &PerProcessOptions::debug_arraybuffer_allocations,
             kAllowedInEnvironment);
+  AddOption("--arraybuffer-pool",
+            "allocate small ArrayBuffers from a per-process pool of "
+            "size classes",
+            &PerProcessOptions::arraybuffer_pool,
+            kAllowedInEnvironment);
+  AddOption("--url-parse-cache-size",
+            "number of parsed URLs that each thread keeps for reuse "
+            "(default: 0, off)",
+            &PerProcessOptions::url_parse_cache_size,
+            kAllowedInEnvironment);
+  AddOption("--worker-isolate-pool-size",
+            "number of isolates that the main thread sets up ahead of time "
+            "for new Workers (default: 0, off)",
+            &PerProcessOptions::worker_isolate_pool_size,
+            kAllowedInEnvironment);
+  AddOption("--build-snapshot",
+            "run the entry point script and write a snapshot of the "
+            "resulting heap to the --snapshot-blob file, then exit",
+            &PerProcessOptions::build_snapshot);
+  AddOption("--snapshot-blob",
+            "the snapshot blob that --build-snapshot writes, or that "
+            "Node.js starts from instead of its built-in snapshot "
+            "(default for --build-snapshot: snapshot.blob)",
+            &PerProcessOptions::snapshot_blob);
+  AddOption("--compile-cache-dir",
+            "directory in which the code caches of user modules, and "
+            "compiled WebAssembly modules passed to "
+            "WebAssembly.compileStreaming(), are kept across runs",
+            &PerProcessOptions::compile_cache_dir,
+            kAllowedInEnvironment);
+  AddOption("--resolve-cache",
+            "cache directory listings and package.json files for module "
+            "resolution, also across runs with --compile-cache-dir",
+            &PerProcessOptions::resolve_cache,
+            kAllowedInEnvironment);
+  AddOption("--startup-profile",
+            "file with code caches for what startup runs, which is "
+            "recorded if it does not exist yet",
+            &PerProcessOptions::startup_profile,
+            kAllowedInEnvironment);
   AddOption("--disable-proto",
             "disable Object.prototype.__proto__",
             &PerProcessOptions::disable_proto,
@@ -740,6 +919,12 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "output compact single-line JSON",
             &PerProcessOptions::report_compact,
             kAllowedInEnvironment);
+  AddOption("--report-time-budget",
+            "skip the slow sections of automatic reports, such as the libuv "
+            "handles, worker subreports and native stacks, once this many "
+            "milliseconds have passed (default: 0, no limit)",
+            &PerProcessOptions::report_time_budget,
+            kAllowedInEnvironment);
   AddOption("--report-dir",
             "define custom report pathname."
             " (default: current working directory)",
@@ -832,6 +1017,18 @@ PerProcessOptionsParser::PerProcessOptionsParser(
             "or 'silent' (map and silently ignore failure)",
             &PerProcessOptions::use_largepages,
             kAllowedInEnvironment);
+  AddOption("--huge-pages",
+            "Back the V8 heap and large ArrayBuffers with huge pages. "
+            "Options are 'off' (the default value), 'madvise' (ask for "
+            "transparent huge pages) or 'explicit' (map ArrayBuffers from "
+            "the hugetlbfs pool, falling back to transparent huge pages)",
+            &PerProcessOptions::huge_pages,
+            kAllowedInEnvironment);
+  AddOption("--huge-pages-threshold",
+            "the size from which ArrayBuffers are backed by huge pages, "
+            "rounded up to the huge page size (default: 2097152)",
+            &PerProcessOptions::huge_pages_threshold,
+            kAllowedInEnvironment);
 
   AddOption("--trace-sigint",
             "enable printing JavaScript stacktrace on SIGINT",
@@ -122,6 +122,7 @@ class EnvironmentOptions : public Options {
   bool frozen_intrinsics = false;
   int64_t heap_snapshot_near_heap_limit = 0;
   std::string heap_snapshot_signal;
+  bool heap_snapshot_gzip = false;
   uint64_t max_http_header_size = 16 * 1024;
   bool deprecation = true;
   bool force_async_hooks_checks = true;
@@ -133,6 +134,11 @@ class EnvironmentOptions : public Options {
   bool preserve_symlinks = false;
   bool preserve_symlinks_main = false;
   bool prof_process = false;
+  bool cpu_prof_continuous = false;
+  std::string cpu_prof_continuous_dir;
+  uint64_t cpu_prof_continuous_interval = 10000;
+  uint64_t cpu_prof_continuous_window = 60;
+  uint64_t event_loop_stall_threshold = 0;
 #if HAVE_INSPECTOR
   std::string cpu_prof_dir;
   static const uint64_t kDefaultCpuProfInterval = 1000;
@@ -145,8 +151,12 @@ class EnvironmentOptions : public Options {
   uint64_t heap_prof_interval = kDefaultHeapProfInterval;
   bool heap_prof = false;
 #endif  // HAVE_INSPECTOR
+  bool realpath_cache = false;
   std::string redirect_warnings;
   std::string diagnostic_dir;
+  uint64_t microtask_count_budget = 0;
+  uint64_t microtask_time_budget = 0;
+  uint64_t stream_write_coalescing = 0;
   bool test_udp_no_try_send = false;
   bool throw_deprecation = false;
   bool trace_atomics_wait = false;
@@ -224,9 +234,26 @@ class PerProcessOptions : public Options {
   std::string title;
   std::string trace_event_categories;
   std::string trace_event_file_pattern = "node_trace.${rotation}.log";
-  int64_t v8_thread_pool_size = 4;
+  std::string trace_event_format = "json";
+  bool trace_event_gzip = false;
+  // Below 0 for the lesser of 4 and uv_available_parallelism().
+  int64_t v8_thread_pool_size = -1;
+  int64_t loop_busy_poll = 0;
+  bool loop_epoll_exclusive = false;
+  bool fast_exit = false;
+  std::string thread_affinity = "none";
+  bool spawn_server = false;
+  bool env_var_snapshot = false;
   bool zero_fill_all_buffers = false;
   bool debug_arraybuffer_allocations = false;
+  bool arraybuffer_pool = false;
+  int64_t url_parse_cache_size = 0;
+  int64_t worker_isolate_pool_size = 0;
+  bool build_snapshot = false;
+  std::string snapshot_blob;
+  std::string compile_cache_dir;
+  bool resolve_cache = false;
+  std::string startup_profile;
   std::string disable_proto;
 
   std::vector<std::string> security_reverts;
@@ -263,11 +290,14 @@ class PerProcessOptions : public Options {
   // Per-process because reports can be triggered outside a known V8 context.
   bool report_on_fatalerror = false;
   bool report_compact = false;
+  uint64_t report_time_budget = 0;
   std::string report_directory;
   std::string report_filename;
 
   // TODO(addaleax): Some of these could probably be per-Environment.
   std::string use_largepages = "off";
+  std::string huge_pages = "off";
+  int64_t huge_pages_threshold = 2 * 1024 * 1024;
   bool trace_sigint = false;
   std::vector<std::string> cmdline;
 
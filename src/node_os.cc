@@ -148,6 +148,20 @@ static void GetTotalMemory(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+// 0 if the memory of the process is not limited, e.g. by a cgroup.
+static void GetConstrainedMemory(const FunctionCallbackInfo<Value>& args) {
+  double amount = static_cast<double>(uv_get_constrained_memory());
+  args.GetReturnValue().Set(amount);
+}
+
+
+// The CPUs the process may run on, taking CPU affinity and cgroup CPU
+// quotas into account, unlike getCPUs().
+static void GetAvailableParallelism(const FunctionCallbackInfo<Value>& args) {
+  args.GetReturnValue().Set(uv_available_parallelism());
+}
+
+
 static void GetUptime(const FunctionCallbackInfo<Value>& args) {
   double uptime;
   int err = uv_uptime(&uptime);
@@ -387,6 +401,8 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "getUptime", GetUptime);
   env->SetMethod(target, "getTotalMem", GetTotalMemory);
   env->SetMethod(target, "getFreeMem", GetFreeMemory);
+  env->SetMethod(target, "getConstrainedMem", GetConstrainedMemory);
+  env->SetMethod(target, "getAvailableParallelism", GetAvailableParallelism);
   env->SetMethod(target, "getCPUs", GetCPUInfo);
   env->SetMethod(target, "getInterfaceAddresses", GetInterfaceAddresses);
   env->SetMethod(target, "getHomeDirectory", GetHomeDirectory);
@@ -405,6 +421,8 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetUptime);
   registry->Register(GetTotalMemory);
   registry->Register(GetFreeMemory);
+  registry->Register(GetConstrainedMemory);
+  registry->Register(GetAvailableParallelism);
   registry->Register(GetCPUInfo);
   registry->Register(GetInterfaceAddresses);
   registry->Register(GetHomeDirectory);
@@ -14,6 +14,7 @@
 namespace node {
 namespace performance {
 
+using v8::Array;
 using v8::Context;
 using v8::DontDelete;
 using v8::Function;
@@ -21,6 +22,7 @@ using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::GCCallbackFlags;
 using v8::GCType;
+using v8::HeapSpaceStatistics;
 using v8::Int32;
 using v8::Integer;
 using v8::Isolate;
@@ -62,6 +64,8 @@ PerformanceState::PerformanceState(Isolate* isolate,
   }
 }
 
+PerformanceState::~PerformanceState() = default;
+
 PerformanceState::SerializeInfo PerformanceState::Serialize(
     v8::Local<v8::Context> context, v8::SnapshotCreator* creator) {
   SerializeInfo info{root.Serialize(context, creator),
@@ -201,6 +205,123 @@ static void RemoveGarbageCollectionTracking(
   GarbageCollectionCleanupHook(env);
 }
 
+GCStats::GCStats(Environment* env)
+    : env_(env),
+      space_count_(env->isolate()->NumberOfHeapSpaces()),
+      fields_(env->isolate(),
+              space_count_ * kSpaceFieldCount + kTriggerCount),
+      promoted_(std::make_shared<Histogram>(Histogram::Options {})) {
+  for (auto& histogram : duration_)
+    histogram = std::make_shared<Histogram>(Histogram::Options {});
+  HeapSpaceStatistics stats;
+  for (size_t i = 0; i < space_count_; i++) {
+    if (env->isolate()->GetHeapSpaceStatistics(&stats, i) &&
+        strcmp(stats.space_name(), "old_space") == 0) {
+      old_space_ = i;
+    }
+  }
+  env->isolate()->AddGCPrologueCallback(OnPrologue, this);
+  env->isolate()->AddGCEpilogueCallback(OnEpilogue, this);
+}
+
+GCStats::~GCStats() {
+  env_->isolate()->RemoveGCPrologueCallback(OnPrologue, this);
+  env_->isolate()->RemoveGCEpilogueCallback(OnEpilogue, this);
+}
+
+void GCStats::OnPrologue(Isolate* isolate,
+                         GCType type,
+                         GCCallbackFlags flags,
+                         void* data) {
+  GCStats* stats = static_cast<GCStats*>(data);
+  HeapSpaceStatistics space;
+  for (size_t i = 0; i < stats->space_count_; i++) {
+    if (!isolate->GetHeapSpaceStatistics(&space, i)) continue;
+    size_t offset = i * kSpaceFieldCount;
+    stats->fields_[offset + kSpaceUsedBefore] = space.space_used_size();
+    stats->fields_[offset + kSpaceSizeBefore] = space.space_size();
+    if (i == stats->old_space_)
+      stats->old_space_used_before_ = space.space_used_size();
+  }
+  stats->start_ = PERFORMANCE_NOW();
+}
+
+void GCStats::OnEpilogue(Isolate* isolate,
+                         GCType type,
+                         GCCallbackFlags flags,
+                         void* data) {
+  GCStats* stats = static_cast<GCStats*>(data);
+  uint64_t duration = PERFORMANCE_NOW() - stats->start_;
+
+  Kind kind;
+  switch (type) {
+    case GCType::kGCTypeScavenge:
+      kind = kKindScavenge;
+      break;
+    case GCType::kGCTypeIncrementalMarking:
+      kind = kKindIncrementalMarking;
+      break;
+    case GCType::kGCTypeProcessWeakCallbacks:
+      kind = kKindProcessWeakCallbacks;
+      break;
+    default:
+      kind = kKindMarkSweepCompact;
+  }
+  stats->duration_[kind]->Record(duration);
+
+  Trigger trigger = kTriggerAllocation;
+  if (flags & GCCallbackFlags::kGCCallbackFlagForced)
+    trigger = kTriggerForced;
+  else if (flags & GCCallbackFlags::kGCCallbackScheduleIdleGarbageCollection)
+    trigger = kTriggerIdle;
+  stats->fields_[stats->space_count_ * kSpaceFieldCount + trigger] +=
+      duration;
+
+  HeapSpaceStatistics space;
+  for (size_t i = 0; i < stats->space_count_; i++) {
+    if (!isolate->GetHeapSpaceStatistics(&space, i)) continue;
+    size_t offset = i * kSpaceFieldCount;
+    stats->fields_[offset + kSpaceUsedAfter] = space.space_used_size();
+    stats->fields_[offset + kSpaceSizeAfter] = space.space_size();
+    if (kind == kKindScavenge && i == stats->old_space_) {
+      size_t before = stats->old_space_used_before_;
+      size_t after = space.space_used_size();
+      stats->promoted_->Record(after > before ? after - before : 0);
+    }
+  }
+}
+
+// Starts recording GC statistics and returns the GCStats fields, the names
+// of the heap spaces in the order of the fields, and the duration and
+// promotion histograms.
+void GetGCStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  PerformanceState* state = env->performance_state();
+  if (!state->gc_stats) state->gc_stats = std::make_unique<GCStats>(env);
+  GCStats* stats = state->gc_stats.get();
+
+  std::vector<Local<Value>> names;
+  HeapSpaceStatistics space;
+  for (size_t i = 0; i < stats->space_count(); i++) {
+    const char* name = isolate->GetHeapSpaceStatistics(&space, i)
+        ? space.space_name() : "";
+    names.push_back(OneByteString(isolate, name));
+  }
+  Local<Value> durations[GCStats::kKindCount];
+  for (int i = 0; i < GCStats::kKindCount; i++) {
+    durations[i] = HistogramBase::Create(
+        env, stats->duration(static_cast<GCStats::Kind>(i)))->object();
+  }
+  Local<Value> result[] = {
+    stats->fields().GetJSArray(),
+    Array::New(isolate, names.data(), names.size()),
+    Array::New(isolate, durations, arraysize(durations)),
+    HistogramBase::Create(env, stats->promoted())->object()
+  };
+  args.GetReturnValue().Set(Array::New(isolate, result, arraysize(result)));
+}
+
 // Gets the name of a function
 inline Local<Value> GetName(Local<Function> fn) {
   Local<Value> val = fn->GetDebugName();
@@ -255,6 +376,56 @@ void CreateELDHistogram(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(histogram->object());
 }
 
+// Starts recording queue statistics for threadpool work and returns
+// histograms of the queue wait time (in nanoseconds) and the queue depth
+// seen by each new request.
+void GetThreadPoolHistograms(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->EnableThreadPoolHistograms();
+  Local<Value> histograms[] = {
+    HistogramBase::Create(env, env->threadpool_queue_wait_histogram())
+        ->object(),
+    HistogramBase::Create(env, env->threadpool_queue_depth_histogram())
+        ->object()
+  };
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), histograms, arraysize(histograms)));
+}
+
+// Starts recording event loop phase statistics and returns histograms for
+// the timers, poll wait, poll, check and other phases (in nanoseconds), and
+// for the number of callbacks into JS per loop iteration.
+void GetLoopPhaseHistograms(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->EnableLoopPhaseHistograms();
+  Local<Value> histograms[Environment::kLoopPhaseMetricCount];
+  for (int i = 0; i < Environment::kLoopPhaseMetricCount; i++) {
+    histograms[i] = HistogramBase::Create(
+        env,
+        env->loop_phase_histogram(
+            static_cast<Environment::LoopPhaseMetric>(i)))->object();
+  }
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), histograms, arraysize(histograms)));
+}
+
+// Starts recording the microtask and nextTick queue drains and returns
+// histograms for the number of microtasks per drain and for the duration of
+// the drains (in nanoseconds).
+void GetTaskQueueDrainHistograms(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  env->EnableTaskQueueDrainHistograms();
+  Local<Value> histograms[Environment::kTaskQueueDrainMetricCount];
+  for (int i = 0; i < Environment::kTaskQueueDrainMetricCount; i++) {
+    histograms[i] = HistogramBase::Create(
+        env,
+        env->task_queue_drain_histogram(
+            static_cast<Environment::TaskQueueDrainMetric>(i)))->object();
+  }
+  args.GetReturnValue().Set(
+      Array::New(env->isolate(), histograms, arraysize(histograms)));
+}
+
 void GetTimeOrigin(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(Number::New(args.GetIsolate(), timeOrigin / 1e6));
 }
@@ -301,6 +472,12 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "getTimeOrigin", GetTimeOrigin);
   env->SetMethod(target, "getTimeOriginTimestamp", GetTimeOriginTimeStamp);
   env->SetMethod(target, "createELDHistogram", CreateELDHistogram);
+  env->SetMethod(target, "getThreadPoolHistograms", GetThreadPoolHistograms);
+  env->SetMethod(target, "getLoopPhaseHistograms", GetLoopPhaseHistograms);
+  env->SetMethod(target,
+                 "getTaskQueueDrainHistograms",
+                 GetTaskQueueDrainHistograms);
+  env->SetMethod(target, "getGCStats", GetGCStats);
 
   Local<Object> constants = Object::New(isolate);
 
@@ -355,6 +532,10 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetTimeOrigin);
   registry->Register(GetTimeOriginTimeStamp);
   registry->Register(CreateELDHistogram);
+  registry->Register(GetThreadPoolHistograms);
+  registry->Register(GetLoopPhaseHistograms);
+  registry->Register(GetTaskQueueDrainHistograms);
+  registry->Register(GetGCStats);
   HistogramBase::RegisterExternalReferences(registry);
   IntervalHistogram::RegisterExternalReferences(registry);
 }
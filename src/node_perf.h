@@ -160,6 +160,77 @@ struct GCPerformanceEntryTraits {
 
 using GCPerformanceEntry = PerformanceEntry<GCPerformanceEntryTraits>;
 
+// Aggregated GC statistics, for tuning the heap limits without creating a
+// performance entry per GC. Once enabled, the GC callbacks record:
+//
+// - the duration of each GC, in a histogram per kind. V8 does not report
+//   its internal phases, but the kinds separate the scavenges, the
+//   incremental marking steps, the final mark-sweep-compact pause and the
+//   weak callback processing;
+// - the bytes promoted to the old space by each scavenge;
+// - the used and committed size of every heap space before and after the
+//   last GC, and the total GC time by what triggered the GC, in `fields`,
+//   which is shared with JS.
+class GCStats {
+ public:
+  enum Kind {
+    kKindScavenge,
+    kKindMarkSweepCompact,
+    kKindIncrementalMarking,
+    kKindProcessWeakCallbacks,
+    kKindCount
+  };
+
+  enum Trigger {
+    kTriggerAllocation,
+    kTriggerIdle,
+    kTriggerForced,
+    kTriggerCount
+  };
+
+  // The layout of `fields`: kSpaceFieldCount values per heap space,
+  // followed by the total GC time in nanoseconds for each Trigger.
+  enum SpaceField {
+    kSpaceUsedBefore,
+    kSpaceUsedAfter,
+    kSpaceSizeBefore,
+    kSpaceSizeAfter,
+    kSpaceFieldCount
+  };
+
+  explicit GCStats(Environment* env);
+  ~GCStats();
+
+  GCStats(const GCStats&) = delete;
+  GCStats& operator=(const GCStats&) = delete;
+
+  const std::shared_ptr<Histogram>& duration(Kind kind) const {
+    return duration_[kind];
+  }
+  const std::shared_ptr<Histogram>& promoted() const { return promoted_; }
+  AliasedFloat64Array& fields() { return fields_; }
+  size_t space_count() const { return space_count_; }
+
+ private:
+  static void OnPrologue(v8::Isolate* isolate,
+                         v8::GCType type,
+                         v8::GCCallbackFlags flags,
+                         void* data);
+  static void OnEpilogue(v8::Isolate* isolate,
+                         v8::GCType type,
+                         v8::GCCallbackFlags flags,
+                         void* data);
+
+  Environment* env_;
+  const size_t space_count_;
+  size_t old_space_ = SIZE_MAX;
+  AliasedFloat64Array fields_;
+  std::shared_ptr<Histogram> duration_[kKindCount];
+  std::shared_ptr<Histogram> promoted_;
+  uint64_t start_ = 0;
+  size_t old_space_used_before_ = 0;
+};
+
 }  // namespace performance
 }  // namespace node
 
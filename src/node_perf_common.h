@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 
 namespace node {
@@ -36,6 +37,8 @@ extern uint64_t performance_v8_start;
   V(HTTP, "http")                                                             \
   V(HTTP2, "http2")
 
+class GCStats;
+
 enum PerformanceMilestone {
 #define V(name, _) NODE_PERFORMANCE_MILESTONE_##name,
   NODE_PERFORMANCE_MILESTONES(V)
@@ -59,6 +62,7 @@ class PerformanceState {
   };
 
   explicit PerformanceState(v8::Isolate* isolate, const SerializeInfo* info);
+  ~PerformanceState();
   SerializeInfo Serialize(v8::Local<v8::Context> context,
                           v8::SnapshotCreator* creator);
   void Deserialize(v8::Local<v8::Context> context);
@@ -69,6 +73,8 @@ class PerformanceState {
   AliasedUint32Array observers;
 
   uint64_t performance_last_gc_start_mark = 0;
+  // Created by the first getGCStats() call.
+  std::unique_ptr<GCStats> gc_stats;
 
   void Mark(enum PerformanceMilestone milestone,
             uint64_t ts = PERFORMANCE_NOW());
@@ -3,6 +3,7 @@
 
 #include "env-inl.h"
 #include "debug_utils-inl.h"
+#include "node_thread_affinity.h"
 #include <algorithm>  // find_if(), find(), move()
 #include <cmath>  // llround()
 #include <memory>  // unique_ptr(), shared_ptr(), make_shared()
@@ -16,22 +17,38 @@ using v8::Task;
 
 namespace {
 
+// Upper bound for a single idle period, so that idle tasks never hold up the
+// loop for long even when no timer is due.
+constexpr double kMaxIdlePeriodInSeconds = 0.05;
+
 struct PlatformWorkerData {
-  TaskQueue<Task>* task_queue;
+  WorkerThreadsTaskRunner* task_runner;
   Mutex* platform_workers_mutex;
   ConditionVariable* platform_workers_ready;
   int* pending_platform_workers;
   int id;
 };
 
-static void PlatformWorkerThread(void* data) {
+// Set on platform worker threads so that tasks they post, e.g. by V8 jobs
+// spawning more workers, go to their own queue.
+thread_local WorkerThreadsTaskRunner* current_task_runner = nullptr;
+thread_local size_t current_queue = 0;
+
+}  // namespace
+
+void WorkerThreadsTaskRunner::PlatformWorkerThread(void* data) {
   std::unique_ptr<PlatformWorkerData>
       worker_data(static_cast<PlatformWorkerData*>(data));
 
-  TaskQueue<Task>* pending_worker_tasks = worker_data->task_queue;
+  WorkerThreadsTaskRunner* task_runner = worker_data->task_runner;
+  size_t index = worker_data->id % task_runner->queues_.size();
   TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
                         "PlatformWorkerThread");
 
+  current_task_runner = task_runner;
+  current_queue = index;
+  thread_affinity::PinCurrentThread("platform", worker_data->id);
+
   // Notify the main thread that the platform worker is ready.
   {
     Mutex::ScopedLock lock(*worker_data->platform_workers_mutex);
@@ -39,18 +56,20 @@ static void PlatformWorkerThread(void* data) {
     worker_data->platform_workers_ready->Signal(lock);
   }
 
-  while (std::unique_ptr<Task> task = pending_worker_tasks->BlockingPop()) {
+  while (std::unique_ptr<Task> task = task_runner->BlockingPop(index)) {
     task->Run();
-    pending_worker_tasks->NotifyOfCompletion();
+    task_runner->NotifyOfCompletion();
   }
 }
 
-}  // namespace
-
+// Keeps all pending delayed tasks in a single deadline heap on its own
+// thread and loop, with one timer armed for the earliest deadline. Posting
+// threads only append to a locked list and wake the loop when that list was
+// empty, so bursts of delayed tasks are moved into the heap in one go.
 class WorkerThreadsTaskRunner::DelayedTaskScheduler {
  public:
-  explicit DelayedTaskScheduler(TaskQueue<Task>* tasks)
-    : pending_worker_tasks_(tasks) {}
+  explicit DelayedTaskScheduler(WorkerThreadsTaskRunner* task_runner)
+    : task_runner_(task_runner) {}
 
   std::unique_ptr<uv_thread_t> Start() {
     auto start_thread = [](void* data) {
@@ -65,17 +84,44 @@ class WorkerThreadsTaskRunner::DelayedTaskScheduler {
   }
 
   void PostDelayedTask(std::unique_ptr<Task> task, double delay_in_seconds) {
-    tasks_.Push(std::make_unique<ScheduleTask>(this, std::move(task),
-                                               delay_in_seconds));
-    uv_async_send(&flush_tasks_);
+    // The deadline is taken on the posting thread, so that the time it takes
+    // for the scheduler thread to pick the task up does not add to it.
+    uint64_t deadline =
+        uv_hrtime() + static_cast<uint64_t>(
+            std::max(llround(delay_in_seconds * 1e9), 0LL));
+    bool was_empty;
+    {
+      Mutex::ScopedLock lock(lock_);
+      if (stopped_) return;
+      was_empty = incoming_.empty();
+      incoming_.push_back(ScheduledTask { deadline, 0, std::move(task) });
+    }
+    if (was_empty)
+      uv_async_send(&flush_tasks_);
   }
 
   void Stop() {
-    tasks_.Push(std::make_unique<StopTask>(this));
+    {
+      Mutex::ScopedLock lock(lock_);
+      stopped_ = true;
+    }
     uv_async_send(&flush_tasks_);
   }
 
  private:
+  struct ScheduledTask {
+    uint64_t deadline;
+    uint64_t sequence;  // Keeps tasks with equal deadlines in posting order.
+    std::unique_ptr<Task> task;
+  };
+
+  // Orders the heap so that the earliest deadline is at the front.
+  static bool Later(const ScheduledTask& a, const ScheduledTask& b) {
+    if (a.deadline != b.deadline)
+      return a.deadline > b.deadline;
+    return a.sequence > b.sequence;
+  }
+
   void Run() {
     TRACE_EVENT_METADATA1("__metadata", "thread_name", "name",
                           "WorkerThreadsTaskRunner::DelayedTaskScheduler");
@@ -83,6 +129,7 @@ class WorkerThreadsTaskRunner::DelayedTaskScheduler {
     CHECK_EQ(0, uv_loop_init(&loop_));
     flush_tasks_.data = this;
     CHECK_EQ(0, uv_async_init(&loop_, &flush_tasks_, FlushTasks));
+    CHECK_EQ(0, uv_timer_init(&loop_, &timer_));
     uv_sem_post(&ready_);
 
     uv_run(&loop_, UV_RUN_DEFAULT);
@@ -92,75 +139,70 @@ class WorkerThreadsTaskRunner::DelayedTaskScheduler {
   static void FlushTasks(uv_async_t* flush_tasks) {
     DelayedTaskScheduler* scheduler =
         ContainerOf(&DelayedTaskScheduler::loop_, flush_tasks->loop);
-    while (std::unique_ptr<Task> task = scheduler->tasks_.Pop())
-      task->Run();
-  }
-
-  class StopTask : public Task {
-   public:
-    explicit StopTask(DelayedTaskScheduler* scheduler): scheduler_(scheduler) {}
-
-    void Run() override {
-      std::vector<uv_timer_t*> timers;
-      for (uv_timer_t* timer : scheduler_->timers_)
-        timers.push_back(timer);
-      for (uv_timer_t* timer : timers)
-        scheduler_->TakeTimerTask(timer);
-      uv_close(reinterpret_cast<uv_handle_t*>(&scheduler_->flush_tasks_),
-               [](uv_handle_t* handle) {});
+    std::vector<ScheduledTask> incoming;
+    bool stopped;
+    {
+      Mutex::ScopedLock lock(scheduler->lock_);
+      incoming.swap(scheduler->incoming_);
+      stopped = scheduler->stopped_;
     }
 
-   private:
-     DelayedTaskScheduler* scheduler_;
-  };
-
-  class ScheduleTask : public Task {
-   public:
-    ScheduleTask(DelayedTaskScheduler* scheduler,
-                 std::unique_ptr<Task> task,
-                 double delay_in_seconds)
-      : scheduler_(scheduler),
-        task_(std::move(task)),
-        delay_in_seconds_(delay_in_seconds) {}
-
-    void Run() override {
-      uint64_t delay_millis = llround(delay_in_seconds_ * 1000);
-      std::unique_ptr<uv_timer_t> timer(new uv_timer_t());
-      CHECK_EQ(0, uv_timer_init(&scheduler_->loop_, timer.get()));
-      timer->data = task_.release();
-      CHECK_EQ(0, uv_timer_start(timer.get(), RunTask, delay_millis, 0));
-      scheduler_->timers_.insert(timer.release());
+    if (stopped) {
+      // Pending delayed tasks are dropped, the task runner is shutting down.
+      scheduler->heap_.clear();
+      uv_close(reinterpret_cast<uv_handle_t*>(&scheduler->timer_), nullptr);
+      uv_close(reinterpret_cast<uv_handle_t*>(&scheduler->flush_tasks_),
+               nullptr);
+      return;
     }
 
-   private:
-    DelayedTaskScheduler* scheduler_;
-    std::unique_ptr<Task> task_;
-    double delay_in_seconds_;
-  };
+    for (ScheduledTask& scheduled : incoming) {
+      scheduled.sequence = scheduler->next_sequence_++;
+      scheduler->heap_.push_back(std::move(scheduled));
+      std::push_heap(scheduler->heap_.begin(), scheduler->heap_.end(), Later);
+    }
+    scheduler->RunDueTasks();
+  }
 
-  static void RunTask(uv_timer_t* timer) {
+  static void OnTimer(uv_timer_t* timer) {
     DelayedTaskScheduler* scheduler =
-        ContainerOf(&DelayedTaskScheduler::loop_, timer->loop);
-    scheduler->pending_worker_tasks_->Push(scheduler->TakeTimerTask(timer));
+        ContainerOf(&DelayedTaskScheduler::timer_, timer);
+    scheduler->RunDueTasks();
   }
 
-  std::unique_ptr<Task> TakeTimerTask(uv_timer_t* timer) {
-    std::unique_ptr<Task> task(static_cast<Task*>(timer->data));
-    uv_timer_stop(timer);
-    uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
-      delete reinterpret_cast<uv_timer_t*>(handle);
-    });
-    timers_.erase(timer);
-    return task;
+  // Posts every task whose deadline has passed, then re-arms the timer for
+  // the earliest remaining one.
+  void RunDueTasks() {
+    uint64_t now = uv_hrtime();
+    while (!heap_.empty() && heap_.front().deadline <= now) {
+      std::pop_heap(heap_.begin(), heap_.end(), Later);
+      task_runner_->PostTask(std::move(heap_.back().task));
+      heap_.pop_back();
+    }
+
+    if (heap_.empty()) {
+      uv_timer_stop(&timer_);
+      return;
+    }
+    // Round up, so that the timer never fires before the deadline.
+    uint64_t delay_millis = (heap_.front().deadline - now + 999999) / 1000000;
+    uv_update_time(&loop_);
+    CHECK_EQ(0, uv_timer_start(&timer_, OnTimer, delay_millis, 0));
   }
 
   uv_sem_t ready_;
-  TaskQueue<Task>* pending_worker_tasks_;
+  WorkerThreadsTaskRunner* task_runner_;
 
-  TaskQueue<Task> tasks_;
+  Mutex lock_;
+  std::vector<ScheduledTask> incoming_;  // Guarded by lock_.
+  bool stopped_ = false;  // Guarded by lock_.
+
+  // These are only accessed from the scheduler thread.
   uv_loop_t loop_;
   uv_async_t flush_tasks_;
-  std::unordered_set<uv_timer_t*> timers_;
+  uv_timer_t timer_;
+  std::vector<ScheduledTask> heap_;
+  uint64_t next_sequence_ = 0;
 };
 
 WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
@@ -170,13 +212,17 @@ WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
   Mutex::ScopedLock lock(platform_workers_mutex);
   int pending_platform_workers = thread_pool_size;
 
-  delayed_task_scheduler_ = std::make_unique<DelayedTaskScheduler>(
-      &pending_worker_tasks_);
+  // Keep at least one queue around so that posting tasks doesn't need to
+  // special-case an empty pool.
+  for (int i = 0; i < std::max(thread_pool_size, 1); i++)
+    queues_.emplace_back(std::make_unique<WorkerQueue>());
+
+  delayed_task_scheduler_ = std::make_unique<DelayedTaskScheduler>(this);
   threads_.push_back(delayed_task_scheduler_->Start());
 
   for (int i = 0; i < thread_pool_size; i++) {
     PlatformWorkerData* worker_data = new PlatformWorkerData{
-      &pending_worker_tasks_, &platform_workers_mutex,
+      this, &platform_workers_mutex,
       &platform_workers_ready, &pending_platform_workers, i
     };
     std::unique_ptr<uv_thread_t> t { new uv_thread_t() };
@@ -194,8 +240,28 @@ WorkerThreadsTaskRunner::WorkerThreadsTaskRunner(int thread_pool_size) {
   }
 }
 
-void WorkerThreadsTaskRunner::PostTask(std::unique_ptr<Task> task) {
-  pending_worker_tasks_.Push(std::move(task));
+void WorkerThreadsTaskRunner::PostTask(std::unique_ptr<Task> task,
+                                       v8::TaskPriority priority) {
+  size_t p = static_cast<size_t>(priority);
+  CHECK_LT(p, kNumPriorities);
+
+  size_t index = current_task_runner == this ?
+      current_queue : next_queue_++ % queues_.size();
+  WorkerQueue* queue = queues_[index].get();
+
+  outstanding_tasks_++;
+  {
+    Mutex::ScopedLock lock(queue->mutex);
+    queue->tasks[p].push_back(std::move(task));
+    queued_tasks_[p]++;
+  }
+
+  // Workers announce themselves as idle before they take a last look at the
+  // queues, so either they see this task or we see them.
+  if (idle_workers_ > 0) {
+    Mutex::ScopedLock lock(lock_);
+    tasks_available_.Signal(lock);
+  }
 }
 
 void WorkerThreadsTaskRunner::PostDelayedTask(std::unique_ptr<Task> task,
@@ -203,12 +269,68 @@ void WorkerThreadsTaskRunner::PostDelayedTask(std::unique_ptr<Task> task,
   delayed_task_scheduler_->PostDelayedTask(std::move(task), delay_in_seconds);
 }
 
+bool WorkerThreadsTaskRunner::HasQueuedTasks() const {
+  for (const std::atomic<int>& count : queued_tasks_) {
+    if (count > 0) return true;
+  }
+  return false;
+}
+
+// Looks at the queue of the calling worker first and then at everyone
+// else's, most urgent priority first.
+std::unique_ptr<Task> WorkerThreadsTaskRunner::TryPop(size_t index) {
+  for (size_t p = kNumPriorities; p-- > 0;) {
+    if (queued_tasks_[p] == 0) continue;
+
+    for (size_t i = 0; i < queues_.size(); i++) {
+      WorkerQueue* queue = queues_[(index + i) % queues_.size()].get();
+      Mutex::ScopedLock lock(queue->mutex);
+      std::deque<std::unique_ptr<Task>>& tasks = queue->tasks[p];
+      if (tasks.empty()) continue;
+      std::unique_ptr<Task> task = std::move(tasks.front());
+      tasks.pop_front();
+      queued_tasks_[p]--;
+      return task;
+    }
+  }
+  return std::unique_ptr<Task>(nullptr);
+}
+
+std::unique_ptr<Task> WorkerThreadsTaskRunner::BlockingPop(size_t index) {
+  while (!stopped_) {
+    if (std::unique_ptr<Task> task = TryPop(index))
+      return task;
+
+    Mutex::ScopedLock lock(lock_);
+    idle_workers_++;
+    while (!stopped_ && !HasQueuedTasks()) {
+      tasks_available_.Wait(lock);
+    }
+    idle_workers_--;
+  }
+  return std::unique_ptr<Task>(nullptr);
+}
+
+void WorkerThreadsTaskRunner::NotifyOfCompletion() {
+  if (--outstanding_tasks_ == 0) {
+    Mutex::ScopedLock lock(lock_);
+    tasks_drained_.Broadcast(lock);
+  }
+}
+
 void WorkerThreadsTaskRunner::BlockingDrain() {
-  pending_worker_tasks_.BlockingDrain();
+  Mutex::ScopedLock lock(lock_);
+  while (outstanding_tasks_ > 0) {
+    tasks_drained_.Wait(lock);
+  }
 }
 
 void WorkerThreadsTaskRunner::Shutdown() {
-  pending_worker_tasks_.Stop();
+  {
+    Mutex::ScopedLock lock(lock_);
+    stopped_ = true;
+    tasks_available_.Broadcast(lock);
+  }
   delayed_task_scheduler_->Stop();
   for (size_t i = 0; i < threads_.size(); i++) {
     CHECK_EQ(0, uv_thread_join(threads_[i].get()));
@@ -226,6 +348,10 @@ PerIsolatePlatformData::PerIsolatePlatformData(
   CHECK_EQ(0, uv_async_init(loop, flush_tasks_, FlushTasks));
   flush_tasks_->data = static_cast<void*>(this);
   uv_unref(reinterpret_cast<uv_handle_t*>(flush_tasks_));
+  idle_tasks_prepare_ = new uv_prepare_t();
+  CHECK_EQ(0, uv_prepare_init(loop, idle_tasks_prepare_));
+  idle_tasks_prepare_->data = static_cast<void*>(this);
+  uv_unref(reinterpret_cast<uv_handle_t*>(idle_tasks_prepare_));
 }
 
 std::shared_ptr<v8::TaskRunner>
@@ -239,16 +365,30 @@ void PerIsolatePlatformData::FlushTasks(uv_async_t* handle) {
 }
 
 void PerIsolatePlatformData::PostIdleTask(std::unique_ptr<v8::IdleTask> task) {
-  UNREACHABLE();
+  if (flush_tasks_ == nullptr) {
+    // V8 may post tasks during Isolate disposal. In that case, the only
+    // sensible path forward is to discard the task.
+    return;
+  }
+  // The prepare handle is started from the loop thread, when flushing.
+  foreground_idle_tasks_.Push(std::move(task));
+  uv_async_send(flush_tasks_);
 }
 
 void PerIsolatePlatformData::PostTask(std::unique_ptr<Task> task) {
+  PostTaskWithPriority(std::move(task), v8::TaskPriority::kUserVisible);
+}
+
+void PerIsolatePlatformData::PostTaskWithPriority(
+    std::unique_ptr<Task> task, v8::TaskPriority priority) {
   if (flush_tasks_ == nullptr) {
     // V8 may post tasks during Isolate disposal. In that case, the only
     // sensible path forward is to discard the task.
     return;
   }
-  foreground_tasks_.Push(std::move(task));
+  size_t p = static_cast<size_t>(priority);
+  CHECK_LT(p, kNumTaskPriorities);
+  foreground_tasks_[p].Push(std::move(task));
   uv_async_send(flush_tasks_);
 }
 
@@ -295,7 +435,9 @@ void PerIsolatePlatformData::Shutdown() {
   // lying around. We clear these queues and ignore the return value,
   // effectively deleting the tasks instead of running them.
   foreground_delayed_tasks_.PopAll();
-  foreground_tasks_.PopAll();
+  for (TaskQueue<Task>& tasks : foreground_tasks_)
+    tasks.PopAll();
+  foreground_idle_tasks_.PopAll();
   scheduled_delayed_tasks_.clear();
 
   // Both destroying the scheduled_delayed_tasks_ lists and closing
@@ -313,6 +455,16 @@ void PerIsolatePlatformData::Shutdown() {
     platform_data->self_reference_.reset();
   });
   flush_tasks_ = nullptr;
+
+  uv_close(reinterpret_cast<uv_handle_t*>(idle_tasks_prepare_),
+           [](uv_handle_t* handle) {
+    std::unique_ptr<uv_prepare_t> idle_tasks_prepare {
+        reinterpret_cast<uv_prepare_t*>(handle) };
+    PerIsolatePlatformData* platform_data =
+        static_cast<PerIsolatePlatformData*>(idle_tasks_prepare->data);
+    platform_data->DecreaseHandleCount();
+  });
+  idle_tasks_prepare_ = nullptr;
 }
 
 void PerIsolatePlatformData::DecreaseHandleCount() {
@@ -421,6 +573,53 @@ void PerIsolatePlatformData::RunForegroundTask(std::unique_ptr<Task> task) {
   }
 }
 
+void PerIsolatePlatformData::RunIdleTasks(uv_prepare_t* handle) {
+  auto platform_data = static_cast<PerIsolatePlatformData*>(handle->data);
+  platform_data->RunIdleTasksInternal();
+}
+
+void PerIsolatePlatformData::RunIdleTasksInternal() {
+  // The prepare phase runs right before polling for I/O, so the backend
+  // timeout is the time the loop would otherwise spend blocked. A zero
+  // timeout means there are pending callbacks or the loop is about to exit.
+  int timeout = uv_backend_timeout(loop_);
+  if (timeout == 0)
+    return;
+
+  double idle_period = kMaxIdlePeriodInSeconds;
+  if (timeout > 0)
+    idle_period = std::min(idle_period, timeout / 1e3);
+  double deadline = uv_hrtime() / 1e9 + idle_period;
+
+  std::queue<std::unique_ptr<v8::IdleTask>> tasks =
+      foreground_idle_tasks_.PopAll();
+  while (!tasks.empty() && uv_hrtime() / 1e9 < deadline) {
+    std::unique_ptr<v8::IdleTask> task = std::move(tasks.front());
+    tasks.pop();
+    DebugSealHandleScope scope(isolate_);
+    Environment* env = Environment::GetCurrent(isolate_);
+    if (env != nullptr) {
+      v8::HandleScope scope(isolate_);
+      InternalCallbackScope cb_scope(env, Object::New(isolate_), { 0, 0 },
+                                     InternalCallbackScope::kNoFlags);
+      task->Run(deadline);
+    } else {
+      task->Run(deadline);
+    }
+  }
+  // Whatever did not fit into this idle period waits for the next one.
+  while (!tasks.empty()) {
+    foreground_idle_tasks_.Push(std::move(tasks.front()));
+    tasks.pop();
+  }
+  if (idle_tasks_prepare_ != nullptr && foreground_idle_tasks_.IsEmpty())
+    uv_prepare_stop(idle_tasks_prepare_);
+
+  // Timers are due relative to the loop time, which would otherwise not
+  // include the time spent running idle tasks.
+  uv_update_time(loop_);
+}
+
 void PerIsolatePlatformData::DeleteFromScheduledTasks(DelayedTask* task) {
   auto it = std::find_if(scheduled_delayed_tasks_.begin(),
                          scheduled_delayed_tasks_.end(),
@@ -473,16 +672,23 @@ bool PerIsolatePlatformData::FlushForegroundTasksInternal() {
       });
     });
   }
-  // Move all foreground tasks into a separate queue and flush that queue.
+  // Move all foreground tasks into separate queues and flush those queues.
   // This way tasks that are posted while flushing the queue will be run on the
   // next call of FlushForegroundTasksInternal.
-  std::queue<std::unique_ptr<Task>> tasks = foreground_tasks_.PopAll();
-  while (!tasks.empty()) {
-    std::unique_ptr<Task> task = std::move(tasks.front());
-    tasks.pop();
-    did_work = true;
-    RunForegroundTask(std::move(task));
+  std::queue<std::unique_ptr<Task>> tasks[kNumTaskPriorities];
+  for (size_t p = 0; p < kNumTaskPriorities; p++)
+    tasks[p] = foreground_tasks_[p].PopAll();
+  for (size_t p = kNumTaskPriorities; p-- > 0;) {
+    while (!tasks[p].empty()) {
+      std::unique_ptr<Task> task = std::move(tasks[p].front());
+      tasks[p].pop();
+      did_work = true;
+      RunForegroundTask(std::move(task));
+    }
   }
+
+  if (idle_tasks_prepare_ != nullptr && !foreground_idle_tasks_.IsEmpty())
+    uv_prepare_start(idle_tasks_prepare_, RunIdleTasks);
   return did_work;
 }
 
@@ -490,6 +696,17 @@ void NodePlatform::CallOnWorkerThread(std::unique_ptr<Task> task) {
   worker_thread_task_runner_->PostTask(std::move(task));
 }
 
+void NodePlatform::CallBlockingTaskOnWorkerThread(std::unique_ptr<Task> task) {
+  worker_thread_task_runner_->PostTask(std::move(task),
+                                       v8::TaskPriority::kUserBlocking);
+}
+
+void NodePlatform::CallLowPriorityTaskOnWorkerThread(
+    std::unique_ptr<Task> task) {
+  worker_thread_task_runner_->PostTask(std::move(task),
+                                       v8::TaskPriority::kBestEffort);
+}
+
 void NodePlatform::CallDelayedOnWorkerThread(std::unique_ptr<Task> task,
                                              double delay_in_seconds) {
   worker_thread_task_runner_->PostDelayedTask(std::move(task),
@@ -620,6 +837,12 @@ void TaskQueue<T>::Stop() {
   tasks_available_.Broadcast(scoped_lock);
 }
 
+template <class T>
+bool TaskQueue<T>::IsEmpty() {
+  Mutex::ScopedLock scoped_lock(lock_);
+  return task_queue_.empty();
+}
+
 template <class T>
 std::queue<std::unique_ptr<T>> TaskQueue<T>::PopAll() {
   Mutex::ScopedLock scoped_lock(lock_);
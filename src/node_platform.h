@@ -3,6 +3,8 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <atomic>
+#include <deque>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +21,10 @@ class NodePlatform;
 class IsolateData;
 class PerIsolatePlatformData;
 
+// Number of v8::TaskPriority values; task queues keep one lane per priority.
+constexpr size_t kNumTaskPriorities =
+    static_cast<size_t>(v8::TaskPriority::kUserBlocking) + 1;
+
 template <class T>
 class TaskQueue {
  public:
@@ -29,6 +35,7 @@ class TaskQueue {
   std::unique_ptr<T> Pop();
   std::unique_ptr<T> BlockingPop();
   std::queue<std::unique_ptr<T>> PopAll();
+  bool IsEmpty();
   void NotifyOfCompletion();
   void BlockingDrain();
   void Stop();
@@ -60,10 +67,17 @@ class PerIsolatePlatformData :
 
   std::shared_ptr<v8::TaskRunner> GetForegroundTaskRunner() override;
   void PostTask(std::unique_ptr<v8::Task> task) override;
+  // V8's foreground TaskRunner interface has no notion of priority, so tasks
+  // posted through it go to the kUserVisible lane. Node.js-internal callers
+  // can use this to run ahead of, or behind, V8's tasks.
+  void PostTaskWithPriority(std::unique_ptr<v8::Task> task,
+                            v8::TaskPriority priority);
+  // Idle tasks run from a prepare handle, right before the event loop would
+  // block for I/O, and only use up the time until the next timer is due.
   void PostIdleTask(std::unique_ptr<v8::IdleTask> task) override;
   void PostDelayedTask(std::unique_ptr<v8::Task> task,
                        double delay_in_seconds) override;
-  bool IdleTasksEnabled() override { return false; }
+  bool IdleTasksEnabled() override { return true; }
 
   // Non-nestable tasks are treated like regular tasks.
   bool NonNestableTasksEnabled() const override { return true; }
@@ -77,7 +91,8 @@ class PerIsolatePlatformData :
 
   // Returns true if work was dispatched or executed. New tasks that are
   // posted during flushing of the queue are postponed until the next
-  // flushing.
+  // flushing. Higher-priority lanes are flushed first; idle tasks are not
+  // run here.
   bool FlushForegroundTasksInternal();
 
   const uv_loop_t* event_loop() const { return loop_; }
@@ -89,6 +104,8 @@ class PerIsolatePlatformData :
   static void FlushTasks(uv_async_t* handle);
   void RunForegroundTask(std::unique_ptr<v8::Task> task);
   static void RunForegroundTask(uv_timer_t* timer);
+  static void RunIdleTasks(uv_prepare_t* handle);
+  void RunIdleTasksInternal();
 
   struct ShutdownCallback {
     void (*cb)(void*);
@@ -98,13 +115,15 @@ class PerIsolatePlatformData :
   ShutdownCbList shutdown_callbacks_;
   // shared_ptr to self to keep this object alive during shutdown.
   std::shared_ptr<PerIsolatePlatformData> self_reference_;
-  uint32_t uv_handle_count_ = 1;  // 1 = flush_tasks_
+  uint32_t uv_handle_count_ = 2;  // 2 = flush_tasks_ + idle_tasks_prepare_
 
   v8::Isolate* const isolate_;
   uv_loop_t* const loop_;
   uv_async_t* flush_tasks_ = nullptr;
-  TaskQueue<v8::Task> foreground_tasks_;
+  uv_prepare_t* idle_tasks_prepare_ = nullptr;
+  TaskQueue<v8::Task> foreground_tasks_[kNumTaskPriorities];
   TaskQueue<DelayedTask> foreground_delayed_tasks_;
+  TaskQueue<v8::IdleTask> foreground_idle_tasks_;
 
   // Use a custom deleter because libuv needs to close the handle first.
   typedef std::unique_ptr<DelayedTask, void(*)(DelayedTask*)>
@@ -113,11 +132,16 @@ class PerIsolatePlatformData :
 };
 
 // This acts as the single worker thread task runner for all Isolates.
+// Every platform worker owns a set of queues, one per v8::TaskPriority, so
+// that posting a task usually only contends with the thread that is going to
+// run it. Workers always run the most urgent task they can find and steal
+// from the other workers before going to sleep.
 class WorkerThreadsTaskRunner {
  public:
   explicit WorkerThreadsTaskRunner(int thread_pool_size);
 
-  void PostTask(std::unique_ptr<v8::Task> task);
+  void PostTask(std::unique_ptr<v8::Task> task,
+                v8::TaskPriority priority = v8::TaskPriority::kUserVisible);
   void PostDelayedTask(std::unique_ptr<v8::Task> task,
                        double delay_in_seconds);
 
@@ -127,7 +151,34 @@ class WorkerThreadsTaskRunner {
   int NumberOfWorkerThreads() const;
 
  private:
-  TaskQueue<v8::Task> pending_worker_tasks_;
+  static constexpr size_t kNumPriorities = kNumTaskPriorities;
+
+  struct WorkerQueue {
+    Mutex mutex;
+    std::deque<std::unique_ptr<v8::Task>> tasks[kNumPriorities];
+  };
+
+  static void PlatformWorkerThread(void* data);
+  std::unique_ptr<v8::Task> TryPop(size_t index);
+  std::unique_ptr<v8::Task> BlockingPop(size_t index);
+  void NotifyOfCompletion();
+  bool HasQueuedTasks() const;
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::atomic<size_t> next_queue_ {0};
+  // Number of tasks sitting in the queues, per priority. Lets workers skip
+  // priorities without having to lock every queue.
+  std::atomic<int> queued_tasks_[kNumPriorities] {};
+  // Queued plus running tasks, for BlockingDrain().
+  std::atomic<int> outstanding_tasks_ {0};
+  std::atomic<int> idle_workers_ {0};
+  std::atomic<bool> stopped_ {false};
+
+  // Only used by workers that go to sleep and by BlockingDrain(). Posting a
+  // task takes it only when there are idle workers to wake up.
+  Mutex lock_;
+  ConditionVariable tasks_available_;
+  ConditionVariable tasks_drained_;
 
   class DelayedTaskScheduler;
   std::unique_ptr<DelayedTaskScheduler> delayed_task_scheduler_;
@@ -148,6 +199,9 @@ class NodePlatform : public MultiIsolatePlatform {
   // v8::Platform implementation.
   int NumberOfWorkerThreads() override;
   void CallOnWorkerThread(std::unique_ptr<v8::Task> task) override;
+  void CallBlockingTaskOnWorkerThread(std::unique_ptr<v8::Task> task) override;
+  void CallLowPriorityTaskOnWorkerThread(
+      std::unique_ptr<v8::Task> task) override;
   void CallDelayedOnWorkerThread(std::unique_ptr<v8::Task> task,
                                  double delay_in_seconds) override;
   bool IdleTasksEnabled(v8::Isolate* isolate) override;
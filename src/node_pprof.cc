@@ -0,0 +1,140 @@
+#include "node_pprof.h"
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace node {
+namespace profiler {
+
+namespace {
+
+// Field numbers from pprof's profile.proto.
+enum ProfileField {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileLocation = 4,
+  kProfileFunction = 5,
+  kProfileStringTable = 6,
+  kProfileTimeNanos = 9,
+  kProfileDurationNanos = 10,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+};
+
+enum ValueTypeField { kValueType = 1, kValueUnit = 2 };
+enum SampleField { kSampleLocationId = 1, kSampleValue = 2 };
+enum LocationField { kLocationId = 1, kLocationLine = 4 };
+enum LineField { kLineFunctionId = 1, kLineLine = 2 };
+
+enum FunctionField {
+  kFunctionId = 1,
+  kFunctionName = 2,
+  kFunctionSystemName = 3,
+  kFunctionFilename = 4,
+  kFunctionStartLine = 5,
+};
+
+bool Gzip(const std::string& in, std::string* out) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // A window size of 15 plus 16 selects the gzip format.
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&stream, in.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  stream.avail_in = in.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  stream.avail_out = out->size();
+  int err = deflate(&stream, Z_FINISH);
+  out->resize(out->size() - stream.avail_out);
+  deflateEnd(&stream);
+  return err == Z_STREAM_END;
+}
+
+}  // anonymous namespace
+
+// Repeated fields keep their order when they are interleaved, so strings,
+// functions and locations are appended to the message as soon as they are
+// first seen.
+PprofBuilder::PprofBuilder() {
+  Str("");  // The string table starts with the empty string.
+}
+
+uint64_t PprofBuilder::Str(const std::string& value) {
+  auto it = strings_.emplace(value, strings_.size());
+  if (it.second) profile_.String(kProfileStringTable, value);
+  return it.first->second;
+}
+
+void PprofBuilder::AddSampleType(const char* type, const char* unit) {
+  ProtobufWriter value_type;
+  value_type.VarInt(kValueType, Str(type)).VarInt(kValueUnit, Str(unit));
+  profile_.Message(kProfileSampleType, value_type);
+}
+
+void PprofBuilder::SetPeriod(const char* type,
+                             const char* unit,
+                             uint64_t period) {
+  ProtobufWriter value_type;
+  value_type.VarInt(kValueType, Str(type)).VarInt(kValueUnit, Str(unit));
+  profile_.Message(kProfilePeriodType, value_type)
+      .VarInt(kProfilePeriod, period);
+}
+
+uint64_t PprofBuilder::Function(const std::string& name,
+                                const std::string& filename,
+                                int script_id,
+                                int line,
+                                int column) {
+  const std::string& function_name = name.empty() ? "(anonymous)" : name;
+  std::string key = std::to_string(script_id) + ":" + std::to_string(line) +
+                    ":" + std::to_string(column) + ":" + function_name;
+  auto it = functions_.emplace(key, functions_.size() + 1);
+  if (it.second) {
+    uint64_t name_index = Str(function_name);
+    ProtobufWriter function;
+    function.VarInt(kFunctionId, it.first->second)
+        .VarInt(kFunctionName, name_index)
+        .VarInt(kFunctionSystemName, name_index)
+        .VarInt(kFunctionFilename, Str(filename))
+        .VarInt(kFunctionStartLine, std::max(line, 0));
+    profile_.Message(kProfileFunction, function);
+  }
+  return it.first->second;
+}
+
+uint64_t PprofBuilder::Location(uint64_t function_id, int line) {
+  line = std::max(line, 0);
+  uint64_t key = (function_id << 32) | static_cast<uint32_t>(line);
+  auto it = locations_.emplace(key, locations_.size() + 1);
+  if (it.second) {
+    ProtobufWriter line_message, location;
+    line_message.VarInt(kLineFunctionId, function_id).VarInt(kLineLine, line);
+    location.VarInt(kLocationId, it.first->second)
+        .Message(kLocationLine, line_message);
+    profile_.Message(kProfileLocation, location);
+  }
+  return it.first->second;
+}
+
+void PprofBuilder::AddSample(const std::vector<uint64_t>& stack,
+                             const std::vector<uint64_t>& values) {
+  ProtobufWriter sample;
+  sample.PackedVarInt(kSampleLocationId, stack)
+      .PackedVarInt(kSampleValue, values);
+  profile_.Message(kProfileSample, sample);
+}
+
+std::string PprofBuilder::Finish(uint64_t time_ns, uint64_t duration_ns) {
+  profile_.VarInt(kProfileTimeNanos, time_ns);
+  if (duration_ns != 0) profile_.VarInt(kProfileDurationNanos, duration_ns);
+  std::string out;
+  if (!Gzip(profile_.data(), &out)) out.clear();
+  return out;
+}
+
+}  // namespace profiler
+}  // namespace node
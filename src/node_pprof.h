@@ -0,0 +1,56 @@
+#ifndef SRC_NODE_PPROF_H_
+#define SRC_NODE_PPROF_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_protobuf.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node {
+namespace profiler {
+
+// Builds a profile in pprof's protobuf format (profile.proto), which the
+// pprof tool and continuous-profiling backends read. Functions and
+// locations are interned, so each sample is just a list of location ids
+// and one value per sample type.
+class PprofBuilder {
+ public:
+  PprofBuilder();
+
+  // Adds one of the values that every sample carries, in order.
+  void AddSampleType(const char* type, const char* unit);
+  void SetPeriod(const char* type, const char* unit, uint64_t period);
+
+  uint64_t Function(const std::string& name,
+                    const std::string& filename,
+                    int script_id,
+                    int line,
+                    int column);
+  uint64_t Location(uint64_t function_id, int line);
+  // `stack` has the leaf first.
+  void AddSample(const std::vector<uint64_t>& stack,
+                 const std::vector<uint64_t>& values);
+
+  // Returns the gzipped profile, as pprof files usually are, or an empty
+  // string if compression failed.
+  std::string Finish(uint64_t time_ns, uint64_t duration_ns);
+
+ private:
+  uint64_t Str(const std::string& value);
+
+  ProtobufWriter profile_;
+  std::unordered_map<std::string, uint64_t> strings_;
+  std::unordered_map<std::string, uint64_t> functions_;
+  std::unordered_map<uint64_t, uint64_t> locations_;
+};
+
+}  // namespace profiler
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_PPROF_H_
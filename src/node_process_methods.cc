@@ -1,3 +1,4 @@
+#include "array_buffer_pool.h"
 #include "async_wrap-inl.h"
 #include "base_object-inl.h"
 #include "debug_utils-inl.h"
@@ -188,7 +189,8 @@ static void MemoryUsage(const FunctionCallbackInfo<Value>& args) {
       env->isolate_data()->node_allocator();
 
   // Get the double array pointer from the Float64Array argument.
-  Local<ArrayBuffer> ab = get_fields_array_buffer(args, 0, 5);
+  Local<ArrayBuffer> ab =
+      get_fields_array_buffer(args, 0, 7 + native_memory::kCategoryCount);
   double* fields = static_cast<double*>(ab->GetBackingStore()->Data());
 
   size_t rss;
@@ -204,6 +206,15 @@ static void MemoryUsage(const FunctionCallbackInfo<Value>& args) {
       array_buffer_allocator == nullptr
           ? 0
           : static_cast<double>(array_buffer_allocator->total_mem_usage());
+  // Pooled ArrayBuffer memory, which is all zero without --arraybuffer-pool.
+  array_buffer_pool::Statistics pool_stats = array_buffer_pool::GetStatistics();
+  fields[5] = static_cast<double>(pool_stats.committed);
+  fields[6] = static_cast<double>(pool_stats.used);
+  // Process-wide native memory, in the order of nativeMemoryCategories.
+  for (int i = 0; i < native_memory::kCategoryCount; i++) {
+    fields[7 + i] = static_cast<double>(
+        native_memory::Get(static_cast<native_memory::Category>(i)));
+  }
 }
 
 void RawDebug(const FunctionCallbackInfo<Value>& args) {
@@ -572,6 +583,16 @@ static void Initialize(Local<Object> target,
   env->SetMethod(target, "umask", Umask);
   env->SetMethod(target, "_rawDebug", RawDebug);
   env->SetMethod(target, "memoryUsage", MemoryUsage);
+  Local<Value> native_memory_categories[] = {
+#define V(id, name) FIXED_ONE_BYTE_STRING(env->isolate(), #name),
+    NODE_NATIVE_MEMORY_CATEGORIES(V)
+#undef V
+  };
+  target->Set(context,
+              FIXED_ONE_BYTE_STRING(env->isolate(), "nativeMemoryCategories"),
+              Array::New(env->isolate(),
+                         native_memory_categories,
+                         arraysize(native_memory_categories))).Check();
   env->SetMethod(target, "rss", Rss);
   env->SetMethod(target, "cpuUsage", CPUUsage);
   env->SetMethod(target, "resourceUsage", ResourceUsage);
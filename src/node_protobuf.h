@@ -0,0 +1,82 @@
+#ifndef SRC_NODE_PROTOBUF_H_
+#define SRC_NODE_PROTOBUF_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace node {
+
+// Just enough of a protobuf encoder for the trace and profile formats that
+// Node.js writes, so that they do not need libprotobuf. Nested messages are
+// built separately and then added as a field of their parent.
+class ProtobufWriter {
+ public:
+  ProtobufWriter& VarInt(uint32_t field, uint64_t value) {
+    Tag(field, 0);
+    Raw(value);
+    return *this;
+  }
+
+  ProtobufWriter& PackedVarInt(uint32_t field,
+                               const std::vector<uint64_t>& values) {
+    ProtobufWriter packed;
+    for (uint64_t value : values) packed.Raw(value);
+    return Message(field, packed);
+  }
+
+  ProtobufWriter& Double(uint32_t field, double value) {
+    Tag(field, 1);
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++)
+      data_.push_back(static_cast<char>(bits >> (i * 8)));
+    return *this;
+  }
+
+  ProtobufWriter& Bytes(uint32_t field, const char* data, size_t length) {
+    Tag(field, 2);
+    Raw(length);
+    data_.append(data, length);
+    return *this;
+  }
+
+  ProtobufWriter& String(uint32_t field, const char* value) {
+    return Bytes(field, value, strlen(value));
+  }
+
+  ProtobufWriter& String(uint32_t field, const std::string& value) {
+    return Bytes(field, value.data(), value.size());
+  }
+
+  ProtobufWriter& Message(uint32_t field, const ProtobufWriter& message) {
+    return Bytes(field, message.data_.data(), message.data_.size());
+  }
+
+  bool empty() const { return data_.empty(); }
+  const std::string& data() const { return data_; }
+
+ private:
+  void Tag(uint32_t field, uint32_t wire_type) {
+    Raw((static_cast<uint64_t>(field) << 3) | wire_type);
+  }
+
+  void Raw(uint64_t value) {
+    while (value >= 0x80) {
+      data_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+  }
+
+  std::string data_;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_PROTOBUF_H_
@@ -0,0 +1,181 @@
+#include "node_realpath_cache.h"
+#include "uv.h"
+
+#include <sys/stat.h>
+
+namespace node {
+namespace fs {
+
+namespace {
+
+#ifdef _WIN32
+constexpr char kSeparators[] = "\\/";
+
+bool IsSeparator(char c) { return c == '/' || c == '\\'; }
+
+bool IsAbsolute(const std::string& path) {
+  return (path.size() >= 3 && path[1] == ':' && IsSeparator(path[2])) ||
+         (path.size() >= 2 && IsSeparator(path[0]) && IsSeparator(path[1]));
+}
+#else
+constexpr char kSeparators[] = "/";
+
+bool IsSeparator(char c) { return c == '/'; }
+
+bool IsAbsolute(const std::string& path) {
+  return !path.empty() && path[0] == '/';
+}
+#endif
+
+// Whether `path` is `prefix` or lies below it.
+bool IsWithin(const std::string& path, const std::string& prefix) {
+  if (path.compare(0, prefix.size(), prefix) != 0) return false;
+  return path.size() == prefix.size() || IsSeparator(path[prefix.size()]);
+}
+
+}  // anonymous namespace
+
+int RealpathCache::Resolve(const std::string& path, std::string* resolved) {
+  Entry entry;
+  int symlinks = 0;
+  int err = Resolve(path, &entry, &symlinks);
+  if (err == 0)
+    *resolved = entry.resolved.empty() ? "/" : entry.resolved;
+  return err;
+}
+
+void RealpathCache::Insert(const std::string& path, const Entry& entry) {
+  if (entries_.size() >= kMaxEntries)
+    entries_.clear();
+  entries_[path] = entry;
+}
+
+#ifdef _WIN32
+int RealpathCache::Resolve(const std::string& path,
+                           Entry* entry,
+                           int* symlinks) {
+  if (!IsAbsolute(path)) return UV_EINVAL;
+  auto it = entries_.find(path);
+  if (it != entries_.end()) {
+    hits_++;
+    *entry = it->second;
+    return 0;
+  }
+  misses_++;
+  uv_fs_t req;
+  int err = uv_fs_realpath(nullptr, &req, path.c_str(), nullptr);
+  if (err == 0) {
+    entry->resolved = static_cast<const char*>(req.ptr);
+    entry->directory = false;  // Not needed for whole paths.
+    Insert(path, *entry);
+  }
+  uv_fs_req_cleanup(&req);
+  return err;
+}
+#else
+int RealpathCache::Resolve(const std::string& path,
+                           Entry* entry,
+                           int* symlinks) {
+  if (!IsAbsolute(path)) return UV_EINVAL;
+  auto it = entries_.find(path);
+  if (it != entries_.end()) {
+    hits_++;
+    *entry = it->second;
+    return 0;
+  }
+  misses_++;
+
+  // `current` is what the components so far resolved to, and each prefix
+  // of `path` is looked up before any system call is made for it.
+  Entry current{"", true};
+  size_t end = 0;
+  for (;;) {
+    size_t start = path.find_first_not_of('/', end);
+    if (start == std::string::npos) break;
+    end = std::min(path.find('/', start), path.size());
+    if (!current.directory) return UV_ENOTDIR;
+
+    const size_t length = end - start;
+    if (length == 1 && path[start] == '.') continue;
+    if (length == 2 && path[start] == '.' && path[start + 1] == '.') {
+      // `current` contains no symbolic links, so this is just its parent.
+      const size_t slash = current.resolved.rfind('/');
+      current.resolved.resize(slash == std::string::npos ? 0 : slash);
+      continue;
+    }
+
+    const std::string prefix = path.substr(0, end);
+    auto cached = entries_.find(prefix);
+    if (cached != entries_.end()) {
+      current = cached->second;
+      continue;
+    }
+
+    std::string candidate = current.resolved;
+    candidate += '/';
+    candidate.append(path, start, length);
+    uv_fs_t req;
+    int err = uv_fs_lstat(nullptr, &req, candidate.c_str(), nullptr);
+    const uint64_t mode = req.statbuf.st_mode;
+    uv_fs_req_cleanup(&req);
+    if (err < 0) return err;
+
+    if (S_ISLNK(mode)) {
+      if (++*symlinks > kMaxSymlinks) return UV_ELOOP;
+      err = uv_fs_readlink(nullptr, &req, candidate.c_str(), nullptr);
+      if (err < 0) {
+        uv_fs_req_cleanup(&req);
+        return err;
+      }
+      std::string target = static_cast<const char*>(req.ptr);
+      uv_fs_req_cleanup(&req);
+      if (!IsAbsolute(target))
+        target = current.resolved + '/' + target;
+      err = Resolve(target, &current, symlinks);
+      if (err < 0) return err;
+    } else {
+      current.resolved = std::move(candidate);
+      current.directory = S_ISDIR(mode);
+    }
+    Insert(prefix, current);
+  }
+
+  if (IsSeparator(path.back()) && !current.directory) return UV_ENOTDIR;
+  if (path.size() != end) Insert(path, current);
+  *entry = std::move(current);
+  return 0;
+}
+#endif  // _WIN32
+
+void RealpathCache::Invalidate(const std::string& path) {
+  if (entries_.empty()) return;
+  if (!IsAbsolute(path)) return Clear();
+
+  std::string prefix = path;
+  while (!prefix.empty() && IsSeparator(prefix.back()))
+    prefix.pop_back();
+  if (prefix.empty()) return Clear();  // The root directory.
+  // Also look for entries that go through what the parent directory of
+  // `path` resolved to, in case it contains symbolic links.
+  std::string alias;
+  const size_t slash = prefix.find_last_of(kSeparators);
+  if (slash != std::string::npos && slash != 0) {
+    auto parent = entries_.find(prefix.substr(0, slash));
+    if (parent != entries_.end())
+      alias = parent->second.resolved + prefix.substr(slash);
+  }
+
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    const std::string& resolved = it->second.resolved;
+    if (IsWithin(it->first, prefix) || IsWithin(resolved, prefix) ||
+        (!alias.empty() &&
+         (IsWithin(it->first, alias) || IsWithin(resolved, alias)))) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace fs
+}  // namespace node
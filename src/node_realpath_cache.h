@@ -0,0 +1,63 @@
+#ifndef SRC_NODE_REALPATH_CACHE_H_
+#define SRC_NODE_REALPATH_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace node {
+namespace fs {
+
+// Resolves absolute paths like realpath(), but one component at a time,
+// and remembers what each prefix resolved to, much like the dentry cache
+// of a kernel. Paths that share a prefix with one resolved before then
+// only cost an lstat() for each component that is new, and paths that were
+// resolved before cost no system calls at all. Failures are not cached.
+//
+// The cache only notices changes to the file system that it is told about
+// through Invalidate(), e.g. by fs.rename() and friends or by fs watchers,
+// and Clear(). It is used for fs.realpathSync() with --realpath-cache, and
+// always for realpathMany(). On Windows, only whole paths are cached.
+class RealpathCache {
+ public:
+  static constexpr size_t kMaxEntries = 64 * 1024;
+
+  // Returns 0 and sets `resolved`, or returns a negative error code.
+  // UV_EINVAL is returned for relative paths, which should be resolved with
+  // uv_fs_realpath() instead.
+  int Resolve(const std::string& path, std::string* resolved);
+
+  // Forgets each prefix that is `path` or lies below it, and each one that
+  // resolved to such a path. A relative `path` clears the cache.
+  void Invalidate(const std::string& path);
+  void Clear() { entries_.clear(); }
+
+  size_t size() const { return entries_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  static constexpr int kMaxSymlinks = 40;
+
+  struct Entry {
+    std::string resolved;  // Empty for the root directory.
+    bool directory;
+  };
+
+  int Resolve(const std::string& path, Entry* entry, int* symlinks);
+  void Insert(const std::string& path, const Entry& entry);
+
+  std::unordered_map<std::string, Entry> entries_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+}  // namespace fs
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_REALPATH_CACHE_H_
@@ -1,11 +1,14 @@
+#include "array_buffer_pool.h"
 #include "env-inl.h"
 #include "json_utils.h"
 #include "node_report.h"
 #include "debug_utils-inl.h"
 #include "diagnosticfilename-inl.h"
+#include "node_executor_pool.h"
 #include "node_internals.h"
 #include "node_metadata.h"
 #include "node_mutex.h"
+#include "node_thread_affinity.h"
 #include "node_worker.h"
 #include "util.h"
 
@@ -21,7 +24,7 @@
 #include <cstring>
 #include <ctime>
 #include <cwctype>
-#include <fstream>
+#include <memory>
 
 constexpr int NODE_REPORT_VERSION = 2;
 constexpr int NANOS_PER_SEC = 1000 * 1000 * 1000;
@@ -32,6 +35,8 @@ using node::arraysize;
 using node::ConditionVariable;
 using node::DiagnosticFilename;
 using node::Environment;
+using node::ExecutorPool;
+using node::FdOutputStream;
 using node::JSONWriter;
 using node::Mutex;
 using node::NativeSymbolDebuggingContext;
@@ -54,7 +59,32 @@ using v8::TryCatch;
 using v8::V8;
 using v8::Value;
 
+namespace array_buffer_pool = node::array_buffer_pool;
 namespace per_process = node::per_process;
+namespace thread_affinity = node::thread_affinity;
+
+// With --report-time-budget, the sections that can take long in a loaded
+// process are cut short once the budget is spent. They are then listed in
+// "truncatedSections" at the end of the report.
+class ReportBudget {
+ public:
+  explicit ReportBudget(uint64_t budget_ms)
+      : deadline_(budget_ms == 0 ? 0 : uv_hrtime() + budget_ms * 1000000) {}
+
+  bool Expired() const { return deadline_ != 0 && uv_hrtime() >= deadline_; }
+  // The time left in nanoseconds, or 0 if there is no limit.
+  uint64_t Remaining() const {
+    if (deadline_ == 0) return 0;
+    uint64_t now = uv_hrtime();
+    return now < deadline_ ? deadline_ - now : 1;
+  }
+  void Truncate(const char* section) { truncated_.push_back(section); }
+  const std::vector<const char*>& truncated() const { return truncated_; }
+
+ private:
+  const uint64_t deadline_;
+  std::vector<const char*> truncated_;
+};
 
 // Internal/static function declarations
 static void WriteNodeReport(Isolate* isolate,
@@ -64,7 +94,8 @@ static void WriteNodeReport(Isolate* isolate,
                             const std::string& filename,
                             std::ostream& out,
                             Local<Value> error,
-                            bool compact);
+                            bool compact,
+                            uint64_t time_budget_ms);
 static void PrintVersionInformation(JSONWriter* writer);
 static void PrintJavaScriptErrorStack(JSONWriter* writer,
                                       Isolate* isolate,
@@ -73,15 +104,22 @@ static void PrintJavaScriptErrorStack(JSONWriter* writer,
 static void PrintJavaScriptErrorProperties(JSONWriter* writer,
                                            Isolate* isolate,
                                            Local<Value> error);
-static void PrintNativeStack(JSONWriter* writer);
+static void PrintNativeStack(JSONWriter* writer, ReportBudget* budget);
 static void PrintResourceUsage(JSONWriter* writer);
 static void PrintGCStatistics(JSONWriter* writer, Isolate* isolate);
-static void PrintSystemInformation(JSONWriter* writer);
+static void PrintArrayBufferPool(JSONWriter* writer);
+static void PrintSystemInformation(JSONWriter* writer,
+                                   ReportBudget* budget);
 static void PrintLoadedLibraries(JSONWriter* writer);
 static void PrintComponentVersions(JSONWriter* writer);
 static void PrintRelease(JSONWriter* writer);
 static void PrintCpuInfo(JSONWriter* writer);
+#if HAVE_OPENSSL
+static void PrintCryptoAcceleration(JSONWriter* writer);
+#endif  // HAVE_OPENSSL
 static void PrintNetworkInterfaceInfo(JSONWriter* writer);
+static void PrintThreadAffinity(JSONWriter* writer);
+static void PrintExecutorPools(JSONWriter* writer);
 
 // External function to trigger a report, writing to file.
 std::string TriggerNodeReport(Isolate* isolate,
@@ -114,7 +152,8 @@ std::string TriggerNodeReport(Isolate* isolate,
 
   // Open the report file stream for writing. Supports stdout/err,
   // user-specified or (default) generated name
-  std::ofstream outfile;
+  uv_file fd = -1;
+  std::unique_ptr<FdOutputStream> outfile;
   std::ostream* outstream;
   if (filename == "stdout") {
     outstream = &std::cout;
@@ -127,39 +166,48 @@ std::string TriggerNodeReport(Isolate* isolate,
       report_directory = per_process::cli_options->report_directory;
     }
     // Regular file. Append filename to directory path if one was specified
+    std::string pathname = filename;
     if (report_directory.length() > 0) {
-      std::string pathname = report_directory;
+      pathname = report_directory;
       pathname += node::kPathSeparator;
       pathname += filename;
-      outfile.open(pathname, std::ios::out | std::ios::binary);
-    } else {
-      outfile.open(filename, std::ios::out | std::ios::binary);
     }
+    uv_fs_t req;
+    fd = uv_fs_open(nullptr, &req, pathname.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC, 0666, nullptr);
+    uv_fs_req_cleanup(&req);
     // Check for errors on the file open
-    if (!outfile.is_open()) {
+    if (fd < 0) {
       std::cerr << "\nFailed to open Node.js report file: " << filename;
 
       if (report_directory.length() > 0)
         std::cerr << " directory: " << report_directory;
 
-      std::cerr << " (errno: " << errno << ")" << std::endl;
+      std::cerr << " (errno: " << -fd << ")" << std::endl;
       return "";
     }
-    outstream = &outfile;
+    // The report is written straight to the file through a large buffer.
+    outfile = std::make_unique<FdOutputStream>(fd);
+    outstream = outfile.get();
     std::cerr << "\nWriting Node.js report to file: " << filename;
   }
 
   bool compact;
+  uint64_t time_budget_ms;
   {
     Mutex::ScopedLock lock(per_process::cli_options_mutex);
     compact = per_process::cli_options->report_compact;
+    time_budget_ms = per_process::cli_options->report_time_budget;
   }
   WriteNodeReport(isolate, env, message, trigger, filename, *outstream,
-                  error, compact);
+                  error, compact, time_budget_ms);
 
   // Do not close stdout/stderr, only close files we opened.
-  if (outfile.is_open()) {
-    outfile.close();
+  if (outfile) {
+    outfile.reset();
+    uv_fs_t req;
+    uv_fs_close(nullptr, &req, fd, nullptr);
+    uv_fs_req_cleanup(&req);
   }
 
   // Do not mix JSON and free-form text on stderr.
@@ -176,7 +224,7 @@ void GetNodeReport(Isolate* isolate,
                    const char* trigger,
                    Local<Value> error,
                    std::ostream& out) {
-  WriteNodeReport(isolate, env, message, trigger, "", out, error, false);
+  WriteNodeReport(isolate, env, message, trigger, "", out, error, false, 0);
 }
 
 // Internal function to coordinate and write the various
@@ -188,7 +236,10 @@ static void WriteNodeReport(Isolate* isolate,
                             const std::string& filename,
                             std::ostream& out,
                             Local<Value> error,
-                            bool compact) {
+                            bool compact,
+                            uint64_t time_budget_ms) {
+  ReportBudget budget(time_budget_ms);
+
   // Obtain the current time and the pid.
   TIME_TYPE tm_struct;
   DiagnosticFilename::LocalTime(&tm_struct);
@@ -285,15 +336,32 @@ static void WriteNodeReport(Isolate* isolate,
     PrintGCStatistics(&writer, isolate);
   }
 
+  if (per_process::cli_options->arraybuffer_pool)
+    PrintArrayBufferPool(&writer);
+
   // Report native stack backtrace
-  PrintNativeStack(&writer);
+  PrintNativeStack(&writer, &budget);
 
   // Report OS and current thread resource usage
   PrintResourceUsage(&writer);
 
   writer.json_arraystart("libuv");
   if (env != nullptr) {
-    uv_walk(env->event_loop(), WalkHandle, static_cast<void*>(&writer));
+    struct WalkState {
+      JSONWriter* writer;
+      ReportBudget* budget;
+      bool truncated;
+    } walk_state = { &writer, &budget, false };
+    uv_walk(env->event_loop(), [](uv_handle_t* h, void* arg) {
+      WalkState* state = static_cast<WalkState*>(arg);
+      if (state->truncated) return;
+      if (state->budget->Expired()) {
+        state->truncated = true;
+        state->budget->Truncate("libuv");
+        return;
+      }
+      WalkHandle(h, state->writer);
+    }, &walk_state);
 
     writer.json_start();
     writer.json_keyvalue("type", "loop");
@@ -312,39 +380,69 @@ static void WriteNodeReport(Isolate* isolate,
 
   writer.json_arraystart("workers");
   if (env != nullptr) {
-    Mutex workers_mutex;
-    ConditionVariable notify;
-    std::vector<std::string> worker_infos;
+    // The workers write their subreports in parallel. With a time budget,
+    // the ones that are not done in time are left out, so the state is
+    // shared with the interrupts, which may still run after this returns.
+    struct WorkerReports {
+      Mutex mutex;
+      ConditionVariable notify;
+      std::vector<std::string> infos;
+    };
+    auto reports = std::make_shared<WorkerReports>();
     size_t expected_results = 0;
+    uint64_t worker_budget_ms = budget.Remaining() / 1000000;
+    if (time_budget_ms != 0 && worker_budget_ms == 0) worker_budget_ms = 1;
+    std::string worker_trigger = trigger;
 
     env->ForEachWorker([&](Worker* w) {
-      expected_results += w->RequestInterrupt([&](Environment* env) {
+      expected_results += w->RequestInterrupt(
+          [reports, worker_trigger, worker_budget_ms](Environment* env) {
         std::ostringstream os;
 
-        GetNodeReport(env->isolate(),
-                      env,
-                      "Worker thread subreport",
-                      trigger,
-                      Local<Object>(),
-                      os);
-
-        Mutex::ScopedLock lock(workers_mutex);
-        worker_infos.emplace_back(os.str());
-        notify.Signal(lock);
+        WriteNodeReport(env->isolate(),
+                        env,
+                        "Worker thread subreport",
+                        worker_trigger.c_str(),
+                        "",
+                        os,
+                        Local<Object>(),
+                        false,
+                        worker_budget_ms);
+
+        Mutex::ScopedLock lock(reports->mutex);
+        reports->infos.emplace_back(os.str());
+        reports->notify.Signal(lock);
       });
     });
 
-    Mutex::ScopedLock lock(workers_mutex);
-    worker_infos.reserve(expected_results);
-    while (worker_infos.size() < expected_results)
-      notify.Wait(lock);
-    for (const std::string& worker_info : worker_infos)
+    Mutex::ScopedLock lock(reports->mutex);
+    reports->infos.reserve(expected_results);
+    while (reports->infos.size() < expected_results) {
+      if (time_budget_ms == 0) {
+        reports->notify.Wait(lock);
+      } else if (budget.Expired() ||
+                 !reports->notify.TimedWait(lock, budget.Remaining())) {
+        budget.Truncate("workers");
+        break;
+      }
+    }
+    for (const std::string& worker_info : reports->infos)
       writer.json_element(JSONWriter::ForeignJSON { worker_info });
   }
   writer.json_arrayend();
 
+  PrintThreadAffinity(&writer);
+  PrintExecutorPools(&writer);
+
   // Report operating system information
-  PrintSystemInformation(&writer);
+  PrintSystemInformation(&writer, &budget);
+
+  if (!budget.truncated().empty()) {
+    writer.json_arraystart("truncatedSections");
+    for (const char* section : budget.truncated())
+      writer.json_element(section);
+    writer.json_arrayend();
+  }
 
   writer.json_objectend();
 
@@ -397,6 +495,9 @@ static void PrintVersionInformation(JSONWriter* writer) {
   }
 
   PrintCpuInfo(writer);
+#if HAVE_OPENSSL
+  PrintCryptoAcceleration(writer);
+#endif  // HAVE_OPENSSL
   PrintNetworkInterfaceInfo(writer);
 
   char host[UV_MAXHOSTNAMESIZE];
@@ -428,6 +529,93 @@ static void PrintCpuInfo(JSONWriter* writer) {
   }
 }
 
+#if HAVE_OPENSSL
+// Report which of the instruction set extensions that OpenSSL selects its
+// accelerated code paths by are in use, decoded from the capability vector
+// in process.versions.openssl_cpu. Extensions masked off through the
+// OPENSSL_ia32cap environment variable are reported as unavailable.
+static void PrintCryptoAcceleration(JSONWriter* writer) {
+  const std::string& settings =
+      node::per_process::metadata.versions.openssl_cpu;
+  unsigned long long caps[2] = {0, 0};  // NOLINT(runtime/int)
+  if (sscanf(settings.c_str(),
+             "OPENSSL_ia32cap=0x%llx:0x%llx",
+             &caps[0],
+             &caps[1]) < 1) {
+    return;
+  }
+
+  // Bit positions as laid out by OPENSSL_cpuid_setup(): the first word holds
+  // CPUID.1:EDX and CPUID.1:ECX, the second one CPUID.7:EBX and CPUID.7:ECX.
+  static const struct {
+    const char* name;
+    int word;
+    int bit;
+  } features[] = {
+    { "ssse3", 0, 41 },
+    { "aesni", 0, 57 },
+    { "pclmulqdq", 0, 33 },
+    { "avx", 0, 60 },
+    { "bmi2", 1, 8 },
+    { "adx", 1, 19 },
+    { "avx2", 1, 5 },
+    { "sha", 1, 29 },
+    { "avx512f", 1, 16 },
+    { "vaes", 1, 41 },
+    { "vpclmulqdq", 1, 42 },
+  };
+
+  writer->json_objectstart("cryptoAcceleration");
+  writer->json_keyvalue("openssl", settings);
+  for (const auto& feature : features) {
+    bool enabled = (caps[feature.word] >> feature.bit) & 1;
+    writer->json_keyvalue(feature.name, enabled);
+  }
+  writer->json_objectend();
+}
+#endif  // HAVE_OPENSSL
+
+static void PrintThreadAffinity(JSONWriter* writer) {
+  writer->json_objectstart("threadAffinity");
+  writer->json_keyvalue("policy", thread_affinity::PolicyName());
+  writer->json_keyvalue("libuvThreadpool",
+                        thread_affinity::ThreadpoolGroups());
+  writer->json_arraystart("threads");
+  for (const thread_affinity::Placement& placement :
+       thread_affinity::GetPlacements()) {
+    writer->json_start();
+    writer->json_keyvalue("kind", placement.kind);
+    writer->json_keyvalue("index", placement.index);
+    writer->json_keyvalue("cpus", placement.cpus);
+    writer->json_end();
+  }
+  writer->json_arrayend();
+  writer->json_objectend();
+}
+
+static void PrintExecutorPools(JSONWriter* writer) {
+  static const char* const priorities[] = {
+    "normal", "low", "background", "high"
+  };
+  writer->json_arraystart("executorPools");
+  ExecutorPool::ForEach([&](const ExecutorPool& pool) {
+    const ExecutorPool::Metrics metrics = pool.GetMetrics();
+    writer->json_start();
+    writer->json_keyvalue("name", pool.name());
+    writer->json_keyvalue("priority",
+                          priorities[static_cast<int>(pool.priority())]);
+    writer->json_keyvalue("threads", metrics.threads);
+    writer->json_keyvalue("queued", metrics.queued);
+    writer->json_keyvalue("running", metrics.running);
+    writer->json_keyvalue("completed", metrics.completed);
+    writer->json_keyvalue("cancelled", metrics.cancelled);
+    writer->json_keyvalue("totalQueueWaitNs", metrics.total_queue_wait);
+    writer->json_keyvalue("maxQueueWaitNs", metrics.max_queue_wait);
+    writer->json_end();
+  });
+  writer->json_arrayend();
+}
+
 static void PrintNetworkInterfaceInfo(JSONWriter* writer) {
   uv_interface_address_t* interfaces;
   char ip[INET6_ADDRSTRLEN];
@@ -580,13 +768,18 @@ static void PrintJavaScriptErrorStack(JSONWriter* writer,
 }
 
 // Report a native stack backtrace
-static void PrintNativeStack(JSONWriter* writer) {
+static void PrintNativeStack(JSONWriter* writer, ReportBudget* budget) {
   auto sym_ctx = NativeSymbolDebuggingContext::New();
   void* frames[256];
   const int size = sym_ctx->GetStackTrace(frames, arraysize(frames));
   writer->json_arraystart("nativeStack");
   int i;
   for (i = 1; i < size; i++) {
+    // Symbolizing the frames is the slow part.
+    if (budget->Expired()) {
+      budget->Truncate("nativeStack");
+      break;
+    }
     void* frame = frames[i];
     writer->json_start();
     writer->json_keyvalue("pc",
@@ -638,6 +831,15 @@ static void PrintGCStatistics(JSONWriter* writer, Isolate* isolate) {
   writer->json_objectend();
 }
 
+static void PrintArrayBufferPool(JSONWriter* writer) {
+  array_buffer_pool::Statistics stats = array_buffer_pool::GetStatistics();
+  writer->json_objectstart("arrayBufferPool");
+  writer->json_keyvalue("committedMemory", stats.committed);
+  writer->json_keyvalue("usedMemory", stats.used);
+  writer->json_keyvalue("returnedMemory", stats.returned);
+  writer->json_objectend();
+}
+
 static void PrintResourceUsage(JSONWriter* writer) {
   // Get process uptime in seconds
   uint64_t uptime =
@@ -691,7 +893,8 @@ static void PrintResourceUsage(JSONWriter* writer) {
 }
 
 // Report operating system information.
-static void PrintSystemInformation(JSONWriter* writer) {
+static void PrintSystemInformation(JSONWriter* writer,
+                                   ReportBudget* budget) {
   uv_env_item_t* envitems;
   int envcount;
   int r;
@@ -761,7 +964,10 @@ static void PrintSystemInformation(JSONWriter* writer) {
   writer->json_objectend();
 #endif  // _WIN32
 
-  PrintLoadedLibraries(writer);
+  if (budget->Expired())
+    budget->Truncate("sharedObjects");
+  else
+    PrintLoadedLibraries(writer);
 }
 
 // Report a list of loaded native libraries.
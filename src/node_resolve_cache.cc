@@ -0,0 +1,337 @@
+#include "node_resolve_cache.h"
+#include "debug_utils-inl.h"
+#include "node_compile_cache.h"
+#include "node_internals.h"
+#include "node_options.h"
+#include "util-inl.h"
+
+#include <sys/stat.h>
+#include <cstring>
+
+namespace node {
+
+namespace {
+
+constexpr char kMagic[] = "node resolve cache 1\n";
+constexpr char kFileName[] = "resolve-cache";
+
+#ifdef _WIN32
+constexpr char kSeparators[] = "\\/";
+#else
+constexpr char kSeparators[] = "/";
+#endif
+
+int StatPath(const char* path, uv_timespec_t* mtime, uint64_t* size) {
+  uv_fs_t req;
+  int rc = uv_fs_stat(nullptr, &req, path, nullptr);
+  if (rc == 0) {
+    const uv_stat_t* s = static_cast<const uv_stat_t*>(req.ptr);
+    rc = !!(s->st_mode & S_IFDIR);
+    if (mtime != nullptr) *mtime = s->st_mtim;
+    if (size != nullptr) *size = s->st_size;
+  }
+  uv_fs_req_cleanup(&req);
+  return rc;
+}
+
+bool SameTime(const uv_timespec_t& a, const uv_timespec_t& b) {
+  return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+class Writer {
+ public:
+  void U64(uint64_t value) {
+    out_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  void Str(const std::string& value) {
+    U64(value.size());
+    out_.append(value);
+  }
+  void Time(const uv_timespec_t& value) {
+    U64(static_cast<uint64_t>(value.tv_sec));
+    U64(static_cast<uint64_t>(value.tv_nsec));
+  }
+  const std::string& out() const { return out_; }
+
+ private:
+  std::string out_;
+};
+
+class Reader {
+ public:
+  explicit Reader(const std::string& in) : in_(in) {}
+
+  bool U64(uint64_t* value) {
+    if (in_.size() - pos_ < sizeof(*value)) return false;
+    memcpy(value, in_.data() + pos_, sizeof(*value));
+    pos_ += sizeof(*value);
+    return true;
+  }
+  bool Str(std::string* value) {
+    uint64_t size;
+    if (!U64(&size) || in_.size() - pos_ < size) return false;
+    value->assign(in_, pos_, size);
+    pos_ += size;
+    return true;
+  }
+  bool Time(uv_timespec_t* value) {
+    uint64_t sec, nsec;
+    if (!U64(&sec) || !U64(&nsec)) return false;
+    value->tv_sec = static_cast<decltype(value->tv_sec)>(sec);
+    value->tv_nsec = static_cast<decltype(value->tv_nsec)>(nsec);
+    return true;
+  }
+  bool Skip(size_t size) {
+    if (in_.size() - pos_ < size) return false;
+    pos_ += size;
+    return true;
+  }
+
+ private:
+  const std::string& in_;
+  size_t pos_ = 0;
+};
+
+std::string CacheFilePath() {
+  const std::string& dir = per_process::cli_options->compile_cache_dir;
+  if (dir.empty()) return std::string();
+  return dir + kPathSeparator + kFileName;
+}
+
+}  // anonymous namespace
+
+ResolveCache* ResolveCache::Create() {
+  if (!per_process::cli_options->resolve_cache) return nullptr;
+  ResolveCache* cache = new ResolveCache();
+  std::string path = CacheFilePath();
+  if (!path.empty()) cache->Load(path);
+  return cache;
+}
+
+ResolveCache* ResolveCache::Get() {
+  static ResolveCache* const cache = Create();
+  return cache;
+}
+
+ResolveCache::Listing* ResolveCache::GetListing(const std::string& dir) {
+  auto it = listings_.find(dir);
+  if (it != listings_.end()) {
+    Listing* listing = &it->second;
+    if (listing->validated) return listing;
+    uv_timespec_t mtime;
+    if (StatPath(dir.c_str(), &mtime, nullptr) == 1 &&
+        SameTime(mtime, listing->mtime)) {
+      listing->validated = true;
+      return listing;
+    }
+    listings_.erase(it);
+  }
+
+  Listing* listing = &listings_[dir];
+  dirty_ = true;
+  int rc = StatPath(dir.c_str(), &listing->mtime, nullptr);
+  if (rc != 1) {
+    listing->error = rc < 0 ? rc : UV_ENOTDIR;
+    return listing;
+  }
+  uv_fs_t req;
+  rc = uv_fs_scandir(nullptr, &req, dir.c_str(), 0, nullptr);
+  if (rc < 0) {
+    listing->error = rc;
+  } else {
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+      uint8_t type = ent.type == UV_DIRENT_FILE ? kFile :
+                     ent.type == UV_DIRENT_DIR ? kDirectory : kOther;
+      listing->entries.emplace(ent.name, type);
+    }
+  }
+  uv_fs_req_cleanup(&req);
+  return listing;
+}
+
+int ResolveCache::Stat(const std::string& path) {
+  size_t pos = path.find_last_of(kSeparators);
+  if (pos == std::string::npos || pos + 1 == path.size())
+    return StatPath(path.c_str(), nullptr, nullptr);
+  std::string name = path.substr(pos + 1);
+  if (name == "." || name == "..")
+    return StatPath(path.c_str(), nullptr, nullptr);
+  // Keep the separator for roots, like / or C:\.
+  std::string dir =
+      path.substr(0, pos == 0 || path[pos - 1] == ':' ? pos + 1 : pos);
+
+  Mutex::ScopedLock lock(mutex_);
+  Listing* listing = GetListing(dir);
+  if (listing->error != 0) return listing->error;
+  auto entry = listing->entries.find(name);
+  if (entry == listing->entries.end()) {
+#if defined(_WIN32) || defined(__APPLE__)
+    // The file system may not be case-sensitive.
+    return StatPath(path.c_str(), nullptr, nullptr);
+#else
+    return UV_ENOENT;
+#endif
+  }
+  if (entry->second != kOther) return entry->second;
+  auto stat = listing->stats.find(name);
+  if (stat == listing->stats.end()) {
+    stat = listing->stats.emplace(
+        name, StatPath(path.c_str(), nullptr, nullptr)).first;
+  }
+  return stat->second;
+}
+
+bool ResolveCache::GetPackageJSON(const std::string& path,
+                                  bool* found,
+                                  std::string* contents,
+                                  bool* contains_keys) {
+  Mutex::ScopedLock lock(mutex_);
+  auto it = package_jsons_.find(path);
+  if (it == package_jsons_.end()) return false;
+  PackageJSON* entry = &it->second;
+  if (!entry->validated) {
+    uv_timespec_t mtime = {0, 0};
+    uint64_t size = 0;
+    int rc = StatPath(path.c_str(), &mtime, &size);
+    if (entry->found ? rc != 0 || !SameTime(mtime, entry->mtime) ||
+                           size != entry->size
+                     : rc >= 0) {
+      package_jsons_.erase(it);
+      return false;
+    }
+    entry->validated = true;
+  }
+  *found = entry->found;
+  *contents = entry->contents;
+  *contains_keys = entry->contains_keys;
+  return true;
+}
+
+void ResolveCache::SetPackageJSON(const std::string& path,
+                                  bool found,
+                                  const std::string& contents,
+                                  bool contains_keys) {
+  PackageJSON entry;
+  entry.found = found;
+  entry.contents = contents;
+  entry.contains_keys = contains_keys;
+  // The file may change between reading and this, in which case the entry
+  // is only thrown away at the next start.
+  if (found && !per_process::cli_options->compile_cache_dir.empty())
+    StatPath(path.c_str(), &entry.mtime, &entry.size);
+
+  Mutex::ScopedLock lock(mutex_);
+  package_jsons_[path] = std::move(entry);
+  dirty_ = true;
+}
+
+void ResolveCache::Persist() {
+  ResolveCache* cache = Get();
+  if (cache == nullptr) return;
+  // This also creates the directory, if that has not happened yet.
+  if (CompileCache::Get() == nullptr) return;
+  std::string path = CacheFilePath();
+  Mutex::ScopedLock lock(cache->mutex_);
+  if (cache->dirty_) cache->Save(path);
+}
+
+void ResolveCache::Load(const std::string& path) {
+  std::string in;
+  if (ReadFileSync(&in, path.c_str()) != 0) return;
+  Reader reader(in);
+  if (in.compare(0, sizeof(kMagic) - 1, kMagic) != 0 ||
+      !reader.Skip(sizeof(kMagic) - 1)) {
+    return;
+  }
+
+  uint64_t count;
+  if (!reader.U64(&count)) return;
+  for (uint64_t i = 0; i < count; i++) {
+    std::string dir;
+    Listing listing;
+    uint64_t entries;
+    if (!reader.Str(&dir) || !reader.Time(&listing.mtime) ||
+        !reader.U64(&entries)) {
+      return;
+    }
+    listing.validated = false;
+    for (uint64_t j = 0; j < entries; j++) {
+      std::string name;
+      uint64_t type;
+      if (!reader.Str(&name) || !reader.U64(&type) || type > kOther) return;
+      listing.entries.emplace(std::move(name), static_cast<uint8_t>(type));
+    }
+    listings_.emplace(std::move(dir), std::move(listing));
+  }
+
+  if (!reader.U64(&count)) return;
+  for (uint64_t i = 0; i < count; i++) {
+    std::string file;
+    PackageJSON entry;
+    uint64_t flags;
+    if (!reader.Str(&file) || !reader.U64(&flags) ||
+        !reader.Time(&entry.mtime) || !reader.U64(&entry.size) ||
+        !reader.Str(&entry.contents)) {
+      return;
+    }
+    entry.found = flags & 1;
+    entry.contains_keys = flags & 2;
+    entry.validated = false;
+    package_jsons_.emplace(std::move(file), std::move(entry));
+  }
+  per_process::Debug(DebugCategory::COMPILE_CACHE,
+                     "Read %d directories and %d package.json files "
+                     "from %s\n", listings_.size(), package_jsons_.size(),
+                     path);
+}
+
+void ResolveCache::Save(const std::string& path) {
+  Writer writer;
+  // Directories that could not be listed are not worth a stat() to check.
+  uint64_t count = 0;
+  for (const auto& it : listings_)
+    if (it.second.error == 0) count++;
+  writer.U64(count);
+  for (const auto& it : listings_) {
+    const Listing& listing = it.second;
+    if (listing.error != 0) continue;
+    writer.Str(it.first);
+    writer.Time(listing.mtime);
+    writer.U64(listing.entries.size());
+    for (const auto& entry : listing.entries) {
+      writer.Str(entry.first);
+      writer.U64(entry.second);
+    }
+  }
+  writer.U64(package_jsons_.size());
+  for (const auto& it : package_jsons_) {
+    const PackageJSON& entry = it.second;
+    writer.Str(it.first);
+    writer.U64((entry.found ? 1 : 0) | (entry.contains_keys ? 2 : 0));
+    writer.Time(entry.mtime);
+    writer.U64(entry.size);
+    writer.Str(entry.contents);
+  }
+
+  std::string out = kMagic + writer.out();
+  std::string temp_path =
+      path + "." + std::to_string(uv_os_getpid()) + ".tmp";
+  int err = WriteFileSync(temp_path.c_str(),
+                          uv_buf_init(&out[0], out.size()));
+  uv_fs_t req;
+  if (err == 0) {
+    err = uv_fs_rename(nullptr, &req, temp_path.c_str(), path.c_str(),
+                       nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+  if (err < 0) {
+    uv_fs_unlink(nullptr, &req, temp_path.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+    per_process::Debug(DebugCategory::COMPILE_CACHE,
+                       "Cannot write %s: %s\n", path, uv_strerror(err));
+  }
+  dirty_ = false;
+}
+
+}  // namespace node
@@ -0,0 +1,93 @@
+#ifndef SRC_NODE_RESOLVE_CACHE_H_
+#define SRC_NODE_RESOLVE_CACHE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_mutex.h"
+#include "uv.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace node {
+
+// Caches what module resolution finds out about the file system, when
+// --resolve-cache is given. Instead of a stat() for each candidate path,
+// each directory is listed once, and the types of its entries are looked
+// up in the listing. The contents of package.json files are kept as well.
+// Like the caches of the module loader itself, nothing is invalidated while
+// the process runs.
+//
+// With --compile-cache-dir, the cache is also written to that directory
+// when the process exits, and read back when it starts. Directory listings
+// and package.json files from there are checked against the modification
+// time of the directory or file before their first use.
+class ResolveCache {
+ public:
+  // Returns nullptr without --resolve-cache. The cache is shared by all
+  // threads.
+  static ResolveCache* Get();
+
+  // Like internalModuleStat(): returns 0 for a file, 1 for a directory,
+  // and a negative error code otherwise.
+  int Stat(const std::string& path);
+
+  // Returns false if there is nothing cached for `path`. Otherwise,
+  // `found` tells whether the file could be read.
+  bool GetPackageJSON(const std::string& path,
+                      bool* found,
+                      std::string* contents,
+                      bool* contains_keys);
+  void SetPackageJSON(const std::string& path,
+                      bool found,
+                      const std::string& contents,
+                      bool contains_keys);
+
+  // Writes the cache to the compile cache directory, if there is one and
+  // something changed.
+  static void Persist();
+
+  ResolveCache(const ResolveCache&) = delete;
+  ResolveCache& operator=(const ResolveCache&) = delete;
+
+ private:
+  enum EntryType : uint8_t { kFile = 0, kDirectory = 1, kOther = 2 };
+
+  struct Listing {
+    int error = 0;  // From listing the directory.
+    uv_timespec_t mtime = {0, 0};
+    bool validated = true;  // False for listings read from disk until used.
+    std::unordered_map<std::string, uint8_t> entries;
+    // Results of stat() for entries of kOther, e.g. symbolic links, which
+    // are not written to disk.
+    std::unordered_map<std::string, int> stats;
+  };
+
+  struct PackageJSON {
+    bool found = false;
+    bool contains_keys = false;
+    bool validated = true;
+    std::string contents;
+    uv_timespec_t mtime = {0, 0};
+    uint64_t size = 0;
+  };
+
+  ResolveCache() = default;
+  static ResolveCache* Create();
+
+  Listing* GetListing(const std::string& dir);  // Called with mutex_ held.
+  void Load(const std::string& path);
+  void Save(const std::string& path);
+
+  Mutex mutex_;
+  std::unordered_map<std::string, Listing> listings_;
+  std::unordered_map<std::string, PackageJSON> package_jsons_;
+  bool dirty_ = false;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_RESOLVE_CACHE_H_
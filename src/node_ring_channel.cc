@@ -0,0 +1,389 @@
+#include "node_ring_channel.h"
+#include "async_wrap-inl.h"
+#include "base_object-inl.h"
+#include "env-inl.h"
+#include "memory_tracker-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "util-inl.h"
+
+#include <cstring>
+
+namespace node {
+
+using v8::Array;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::Uint32;
+using v8::Value;
+
+namespace worker {
+
+namespace {
+
+constexpr size_t kMinCapacity = 4 * 1024;
+constexpr size_t kMaxCapacity = 1 << 30;
+
+inline size_t RecordSize(size_t length) {
+  return RoundUp(RingBuffer::kLengthSize + length, RingBuffer::kLengthSize);
+}
+
+}  // anonymous namespace
+
+RingBuffer::RingBuffer(char* data, size_t capacity)
+    : data_(data), capacity_(capacity) {
+  CHECK_EQ(capacity & (capacity - 1), 0);
+  CHECK_LE(capacity, kMaxCapacity);
+}
+
+RingBuffer::~RingBuffer() {
+  free(data_);
+}
+
+bool RingBuffer::Write(const char* data, size_t length) {
+  CHECK_LE(length, max_record_size());
+  const uint32_t write_index = write_index_.load(std::memory_order_relaxed);
+  const uint32_t read_index = read_index_.load(std::memory_order_acquire);
+  const size_t position = write_index & (capacity_ - 1);
+  const size_t record_size = RecordSize(length);
+  // The rest of the buffer is skipped if the record does not fit there.
+  const size_t skipped =
+      record_size > capacity_ - position ? capacity_ - position : 0;
+  if (static_cast<uint32_t>(write_index - read_index) + skipped +
+          record_size > capacity_) {
+    return false;
+  }
+
+  char* record = data_ + position;
+  if (skipped != 0) {
+    memcpy(record, &kWrapMarker, kLengthSize);
+    record = data_;
+  }
+  const uint32_t record_length = static_cast<uint32_t>(length);
+  memcpy(record, &record_length, kLengthSize);
+  memcpy(record + kLengthSize, data, length);
+  // This pairs with the reader's check for records after it has said that
+  // it waits for them.
+  write_index_.store(
+      static_cast<uint32_t>(write_index + skipped + record_size),
+      std::memory_order_seq_cst);
+  return true;
+}
+
+size_t RingBuffer::Read(char* dest, size_t length, size_t* needed) {
+  uint32_t read_index = read_index_.load(std::memory_order_relaxed);
+  const uint32_t write_index = write_index_.load(std::memory_order_acquire);
+  size_t copied = 0;
+  while (read_index != write_index) {
+    const size_t position = read_index & (capacity_ - 1);
+    uint32_t record_length;
+    memcpy(&record_length, data_ + position, kLengthSize);
+    if (record_length == kWrapMarker) {
+      read_index += static_cast<uint32_t>(capacity_ - position);
+      continue;
+    }
+    const size_t framed_length = kLengthSize + record_length;
+    if (framed_length > length - copied) {
+      if (copied == 0)
+        *needed = framed_length;
+      break;
+    }
+    memcpy(dest + copied, data_ + position, framed_length);
+    copied += framed_length;
+    read_index += static_cast<uint32_t>(RecordSize(record_length));
+  }
+  read_index_.store(read_index, std::memory_order_release);
+  return copied;
+}
+
+bool RingBuffer::IsEmpty() const {
+  return read_index_.load(std::memory_order_relaxed) ==
+         write_index_.load(std::memory_order_seq_cst);
+}
+
+std::shared_ptr<RingChannelState> RingChannelState::Create(size_t capacity) {
+  char* data = UncheckedMalloc(capacity);
+  if (data == nullptr)
+    return nullptr;
+  return std::shared_ptr<RingChannelState>(
+      new RingChannelState(data, capacity));
+}
+
+void RingChannelState::NotifyReader() {
+  // Only the first write after the reader started to wait wakes it up.
+  if (!reader_waiting_.load() || !reader_waiting_.exchange(false))
+    return;
+  Mutex::ScopedLock lock(mutex_);
+  if (reader_ != nullptr)
+    reader_->TriggerAsync();
+}
+
+void RingChannelState::WaitForWrites() {
+  reader_waiting_.store(true);
+  // Records may have been written before the flag was set.
+  if (!ring_.IsEmpty() || IsWriterClosed())
+    NotifyReader();
+}
+
+void RingChannelState::SetReader(RingChannel* reader) {
+  Mutex::ScopedLock lock(mutex_);
+  reader_ = reader;
+}
+
+void RingChannelState::CloseWriter() {
+  writer_closed_.store(true);
+  NotifyReader();
+}
+
+RingChannel::RingChannel(Environment* env,
+                         Local<Object> wrap,
+                         std::shared_ptr<RingChannelState> state,
+                         Role role)
+    : HandleWrap(env,
+                 wrap,
+                 reinterpret_cast<uv_handle_t*>(&async_),
+                 AsyncWrap::PROVIDER_RINGCHANNEL),
+      state_(std::move(state)),
+      role_(role) {
+  auto onreadable = [](uv_async_t* handle) {
+    RingChannel* channel = ContainerOf(&RingChannel::async_, handle);
+    channel->OnReadable();
+  };
+  CHECK_EQ(uv_async_init(env->event_loop(), &async_, onreadable), 0);
+}
+
+RingChannel* RingChannel::New(Environment* env,
+                              Local<Context> context,
+                              std::shared_ptr<RingChannelState> state,
+                              Role role) {
+  Context::Scope context_scope(context);
+  Local<Object> instance;
+  if (!GetConstructorTemplate(env)->InstanceTemplate()
+           ->NewInstance(context).ToLocal(&instance)) {
+    return nullptr;
+  }
+  return new RingChannel(env, instance, std::move(state), role);
+}
+
+void RingChannel::New(const FunctionCallbackInfo<Value>& args) {
+  // Ends are only created in pairs by createRingChannel().
+  THROW_ERR_CONSTRUCT_CALL_INVALID(Environment::GetCurrent(args));
+}
+
+// createRingChannel(capacity) returns [writer, reader]. The capacity is
+// rounded up to a power of two.
+void RingChannel::CreateRingChannel(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args[0]->IsUint32());
+  size_t capacity = kMinCapacity;
+  const size_t requested = args[0].As<Uint32>()->Value();
+  if (requested > kMaxCapacity)
+    return THROW_ERR_OUT_OF_RANGE(env, "The ring channel is too large");
+  while (capacity < requested)
+    capacity *= 2;
+
+  std::shared_ptr<RingChannelState> state = RingChannelState::Create(capacity);
+  if (!state)
+    return THROW_ERR_MEMORY_ALLOCATION_FAILED(env);
+  RingChannel* writer = New(env, env->context(), state, Role::kWriter);
+  if (writer == nullptr)
+    return;
+  RingChannel* reader = New(env, env->context(), state, Role::kReader);
+  if (reader == nullptr)
+    return;
+  Local<Value> ends[] = { writer->object(), reader->object() };
+  args.GetReturnValue().Set(Array::New(env->isolate(), ends, arraysize(ends)));
+}
+
+// write(view) copies the bytes of `view` into the ring as one record.
+// Returns false if the ring is too full for it.
+void RingChannel::Write(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  RingChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  CHECK_EQ(channel->role_, Role::kWriter);
+  if (!channel->state_)
+    return args.GetReturnValue().Set(false);
+  CHECK(args[0]->IsArrayBufferView());
+  ArrayBufferViewContents<char> data(args[0]);
+
+  RingBuffer* ring = channel->state_->ring();
+  if (data.length() > ring->max_record_size()) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The record is larger than half of the ring channel");
+  }
+  const bool written = ring->Write(data.data(), data.length());
+  if (written)
+    channel->state_->NotifyReader();
+  args.GetReturnValue().Set(written);
+}
+
+// read(view) copies as many whole records as fit into `view`, each
+// preceded by its length as a uint32 in host byte order, and returns the
+// number of bytes copied, or 0 if there are no records. If the next record
+// does not fit, returns minus the number of bytes that it needs.
+void RingChannel::Read(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  RingChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  CHECK_EQ(channel->role_, Role::kReader);
+  if (!channel->state_)
+    return args.GetReturnValue().Set(0);
+  SPREAD_BUFFER_ARG(args[0], target);
+
+  size_t needed = 0;
+  const size_t copied =
+      channel->state_->ring()->Read(target_data, target_length, &needed);
+  if (copied == 0 && needed != 0) {
+    return args.GetReturnValue().Set(
+        Number::New(env->isolate(), -static_cast<double>(needed)));
+  }
+  args.GetReturnValue().Set(Number::New(env->isolate(), copied));
+}
+
+void RingChannel::Start(const FunctionCallbackInfo<Value>& args) {
+  RingChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  CHECK_EQ(channel->role_, Role::kReader);
+  if (!channel->state_ || channel->reading_)
+    return;
+  channel->reading_ = true;
+  channel->state_->SetReader(channel);
+  channel->state_->WaitForWrites();
+}
+
+void RingChannel::Stop(const FunctionCallbackInfo<Value>& args) {
+  RingChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  CHECK_EQ(channel->role_, Role::kReader);
+  channel->reading_ = false;
+  if (channel->state_)
+    channel->state_->SetReader(nullptr);
+}
+
+void RingChannel::IsWriterClosed(const FunctionCallbackInfo<Value>& args) {
+  RingChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  args.GetReturnValue().Set(
+      !channel->state_ || channel->state_->IsWriterClosed());
+}
+
+void RingChannel::TriggerAsync() {
+  if (IsHandleClosing()) return;
+  CHECK_EQ(uv_async_send(&async_), 0);
+}
+
+void RingChannel::OnReadable() {
+  if (!reading_ || !state_)
+    return;
+  {
+    HandleScope handle_scope(env()->isolate());
+    Context::Scope context_scope(env()->context());
+    if (MakeCallback(env()->onreadable_string(), 0, nullptr).IsEmpty())
+      return;
+  }
+  // Wait for the next batch of records, unless the callback has stopped
+  // reading or closed this end.
+  if (reading_ && state_)
+    state_->WaitForWrites();
+}
+
+void RingChannel::Close(Local<Value> close_callback) {
+  // After this, the writer no longer wakes up this end, so that it does not
+  // touch the handle while it is being closed.
+  if (state_ && role_ == Role::kReader)
+    state_->SetReader(nullptr);
+  HandleWrap::Close(close_callback);
+}
+
+void RingChannel::OnClose() {
+  if (!state_)
+    return;
+  if (role_ == Role::kWriter)
+    state_->CloseWriter();
+  state_.reset();
+}
+
+std::shared_ptr<RingChannelState> RingChannel::Detach() {
+  reading_ = false;
+  if (state_ && role_ == Role::kReader)
+    state_->SetReader(nullptr);
+  return std::move(state_);
+}
+
+BaseObject::TransferMode RingChannel::GetTransferMode() const {
+  if (!state_ || IsHandleClosing())
+    return BaseObject::TransferMode::kUntransferable;
+  return BaseObject::TransferMode::kTransferable;
+}
+
+std::unique_ptr<TransferData> RingChannel::TransferForMessaging() {
+  std::unique_ptr<TransferData> data =
+      std::make_unique<Data>(Detach(), role_);
+  Close();
+  return data;
+}
+
+void RingChannel::MemoryInfo(MemoryTracker* tracker) const {
+  // The ring is only attributed to the reading end.
+  if (state_ && role_ == Role::kReader)
+    tracker->TrackFieldWithSize("ring", state_->ring()->capacity());
+}
+
+RingChannel::Data::~Data() {
+  // If the transfer never arrives, the reader does not wait forever.
+  if (state_ && role_ == Role::kWriter)
+    state_->CloseWriter();
+}
+
+BaseObjectPtr<BaseObject> RingChannel::Data::Deserialize(
+    Environment* env,
+    Local<Context> context,
+    std::unique_ptr<TransferData> self) {
+  return BaseObjectPtr<RingChannel> {
+      RingChannel::New(env, context, std::move(state_), role_) };
+}
+
+Local<FunctionTemplate> RingChannel::GetConstructorTemplate(
+    Environment* env) {
+  Local<FunctionTemplate> tmpl = env->ring_channel_constructor_template();
+  if (tmpl.IsEmpty()) {
+    tmpl = env->NewFunctionTemplate(RingChannel::New);
+    tmpl->SetClassName(FIXED_ONE_BYTE_STRING(env->isolate(), "RingChannel"));
+    tmpl->InstanceTemplate()->SetInternalFieldCount(
+        RingChannel::kInternalFieldCount);
+    tmpl->Inherit(HandleWrap::GetConstructorTemplate(env));
+    env->SetProtoMethod(tmpl, "write", Write);
+    env->SetProtoMethod(tmpl, "read", Read);
+    env->SetProtoMethod(tmpl, "start", Start);
+    env->SetProtoMethod(tmpl, "stop", Stop);
+    env->SetProtoMethodNoSideEffect(tmpl, "isWriterClosed", IsWriterClosed);
+    env->set_ring_channel_constructor_template(tmpl);
+  }
+  return tmpl;
+}
+
+void RingChannel::Initialize(Environment* env, Local<Object> target) {
+  env->SetConstructorFunction(target, "RingChannel",
+                              GetConstructorTemplate(env));
+  env->SetMethod(target, "createRingChannel", CreateRingChannel);
+}
+
+void RingChannel::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(CreateRingChannel);
+  registry->Register(Write);
+  registry->Register(Read);
+  registry->Register(Start);
+  registry->Register(Stop);
+  registry->Register(IsWriterClosed);
+}
+
+}  // namespace worker
+}  // namespace node
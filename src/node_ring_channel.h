@@ -0,0 +1,185 @@
+#ifndef SRC_NODE_RING_CHANNEL_H_
+#define SRC_NODE_RING_CHANNEL_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "handle_wrap.h"
+#include "node_messaging.h"
+#include "node_mutex.h"
+#include "uv.h"
+#include "v8.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace node {
+
+class ExternalReferenceRegistry;
+
+namespace worker {
+
+class RingChannel;
+
+// A ring buffer of variable-length byte records, with a single writer and
+// a single reader that may be on different threads. Records are stored
+// with their length in front, padded to four bytes. A record that does not
+// fit before the end of the buffer is written at the start, after a marker
+// that tells the reader to skip the rest.
+class RingBuffer final {
+ public:
+  // `data` must hold `capacity` bytes, a power of two, and is freed by the
+  // RingBuffer.
+  RingBuffer(char* data, size_t capacity);
+  ~RingBuffer();
+
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
+
+  size_t capacity() const { return capacity_; }
+  size_t max_record_size() const { return capacity_ / 2 - kLengthSize; }
+
+  // Returns false if there is no room for the record right now. `length`
+  // must be at most max_record_size().
+  bool Write(const char* data, size_t length);
+  // Copies as many whole records as fit into `dest`, each preceded by its
+  // length as a uint32_t in host byte order, and returns the number of
+  // bytes copied. If not even the first record fits, returns 0 and sets
+  // `*needed` to the space that it takes.
+  size_t Read(char* dest, size_t length, size_t* needed);
+  bool IsEmpty() const;
+
+  static constexpr size_t kLengthSize = sizeof(uint32_t);
+
+ private:
+  static constexpr uint32_t kWrapMarker = 0xffffffff;
+
+  // Both indices run freely and wrap around, and are masked to find
+  // positions in the buffer. They are on their own cache lines, as each
+  // is written by one thread and read by the other.
+  alignas(64) std::atomic<uint32_t> write_index_{0};
+  alignas(64) std::atomic<uint32_t> read_index_{0};
+  alignas(64) char* const data_;
+  const size_t capacity_;
+};
+
+// The part of a ring channel that both of its ends share, on any threads.
+// Besides the ring buffer itself, this wakes up the reader when there are
+// new records, at most once every time that it has read all of them.
+class RingChannelState final {
+ public:
+  // Returns nullptr if the memory cannot be allocated.
+  static std::shared_ptr<RingChannelState> Create(size_t capacity);
+
+  RingBuffer* ring() { return &ring_; }
+
+  // Called by the writer after each write.
+  void NotifyReader();
+  // The reader calls this when it wants to be woken up for new records.
+  void WaitForWrites();
+  // `reader` is the end that is woken up, or nullptr.
+  void SetReader(RingChannel* reader);
+
+  void CloseWriter();
+  bool IsWriterClosed() const { return writer_closed_.load(); }
+
+ private:
+  RingChannelState(char* data, size_t capacity) : ring_(data, capacity) {}
+
+  RingBuffer ring_;
+  std::atomic<bool> reader_waiting_{false};
+  std::atomic<bool> writer_closed_{false};
+  Mutex mutex_;  // Protects reader_.
+  RingChannel* reader_ = nullptr;
+};
+
+// One end of a ring channel, created in pairs by createRingChannel(). The
+// writing end copies byte records into the ring with write(view), and the
+// reading end copies them out with read(view), and calls `onreadable()`
+// after start() when there are records to read. Both ends can be
+// transferred to other threads through a MessagePort. Like MessagePorts,
+// the ends keep the event loop alive until they are closed or unref()'d.
+class RingChannel : public HandleWrap {
+ public:
+  enum class Role { kWriter, kReader };
+
+  static RingChannel* New(Environment* env,
+                          v8::Local<v8::Context> context,
+                          std::shared_ptr<RingChannelState> state,
+                          Role role);
+
+  static void Initialize(Environment* env, v8::Local<v8::Object> target);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  /* constructor */
+  static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
+  /* static */
+  static void CreateRingChannel(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  /* prototype methods */
+  static void Write(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Read(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Start(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Stop(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void IsWriterClosed(const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  // Wakes up the reading end. This is called with the state's mutex held.
+  void TriggerAsync();
+
+  void Close(
+      v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
+
+  TransferMode GetTransferMode() const override;
+  std::unique_ptr<TransferData> TransferForMessaging() override;
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(RingChannel)
+  SET_SELF_SIZE(RingChannel)
+
+ private:
+  class Data : public TransferData {
+   public:
+    Data(std::shared_ptr<RingChannelState> state, Role role)
+        : state_(std::move(state)), role_(role) {}
+    ~Data() override;
+
+    BaseObjectPtr<BaseObject> Deserialize(
+        Environment* env,
+        v8::Local<v8::Context> context,
+        std::unique_ptr<TransferData> self) override;
+
+    SET_NO_MEMORY_INFO()
+    SET_MEMORY_INFO_NAME(RingChannelTransferData)
+    SET_SELF_SIZE(Data)
+
+   private:
+    std::shared_ptr<RingChannelState> state_;
+    Role role_;
+  };
+
+  RingChannel(Environment* env,
+              v8::Local<v8::Object> wrap,
+              std::shared_ptr<RingChannelState> state,
+              Role role);
+
+  static v8::Local<v8::FunctionTemplate> GetConstructorTemplate(
+      Environment* env);
+
+  void OnClose() override;
+  void OnReadable();
+  // Lets go of the state, as the end is closed or transferred.
+  std::shared_ptr<RingChannelState> Detach();
+
+  std::shared_ptr<RingChannelState> state_;
+  const Role role_;
+  bool reading_ = false;
+  uv_async_t async_;
+};
+
+}  // namespace worker
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_RING_CHANNEL_H_
@@ -5,10 +5,14 @@
 #include "node_internals.h"
 #include "util-inl.h"
 
+#include <memory>
+
 namespace node {
 
 using v8::Array;
 using v8::ArrayBuffer;
+using v8::ArrayBufferView;
+using v8::BackingStore;
 using v8::Context;
 using v8::Function;
 using v8::FunctionCallbackInfo;
@@ -83,6 +87,7 @@ class DeserializerContext : public BaseObject,
   static void ReadUint64(const FunctionCallbackInfo<Value>& args);
   static void ReadDouble(const FunctionCallbackInfo<Value>& args);
   static void ReadRawBytes(const FunctionCallbackInfo<Value>& args);
+  static void ReadRawArrayBuffer(const FunctionCallbackInfo<Value>& args);
 
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(DeserializerContext)
@@ -91,6 +96,8 @@ class DeserializerContext : public BaseObject,
  private:
   const uint8_t* data_;
   const size_t length_;
+  // The memory of the input buffer, once an ArrayBuffer refers to it.
+  std::shared_ptr<BackingStore> backing_store_;
 
   ValueDeserializer deserializer_;
 };
@@ -450,6 +457,57 @@ void DeserializerContext::ReadRawBytes(
   args.GetReturnValue().Set(offset);
 }
 
+// Like ReadRawBytes(), but returns the bytes as an ArrayBuffer that refers
+// to the memory of the input buffer and keeps it alive, so that large
+// typed arrays are not copied. Writes to either buffer are visible in the
+// other. The bytes are only copied when they are not aligned for every
+// kind of typed array, as views must be.
+void DeserializerContext::ReadRawArrayBuffer(
+    const FunctionCallbackInfo<Value>& args) {
+  DeserializerContext* ctx;
+  ASSIGN_OR_RETURN_UNWRAP(&ctx, args.Holder());
+  Environment* env = ctx->env();
+
+  Maybe<int64_t> length_arg = args[0]->IntegerValue(env->context());
+  if (length_arg.IsNothing()) return;
+  size_t length = length_arg.FromJust();
+
+  const void* data;
+  bool ok = ctx->deserializer_.ReadRawBytes(length, &data);
+  if (!ok) return env->ThrowError("ReadRawBytes() failed");
+
+  const uint8_t* position = reinterpret_cast<const uint8_t*>(data);
+  CHECK_GE(position, ctx->data_);
+  CHECK_LE(position + length, ctx->data_ + ctx->length_);
+
+  if (reinterpret_cast<uintptr_t>(position) % sizeof(double) != 0) {
+    Local<ArrayBuffer> copy = ArrayBuffer::New(env->isolate(), length);
+    memcpy(copy->GetBackingStore()->Data(), position, length);
+    return args.GetReturnValue().Set(copy);
+  }
+
+  if (!ctx->backing_store_) {
+    Local<Value> buffer;
+    if (!ctx->object()->Get(env->context(), env->buffer_string())
+             .ToLocal(&buffer)) {
+      return;
+    }
+    CHECK(buffer->IsArrayBufferView());
+    ctx->backing_store_ =
+        buffer.As<ArrayBufferView>()->Buffer()->GetBackingStore();
+  }
+
+  std::unique_ptr<BackingStore> store = ArrayBuffer::NewBackingStore(
+      const_cast<uint8_t*>(position),
+      length,
+      [](void* data, size_t length, void* deleter_data) {
+        delete static_cast<std::shared_ptr<BackingStore>*>(deleter_data);
+      },
+      new std::shared_ptr<BackingStore>(ctx->backing_store_));
+  args.GetReturnValue().Set(
+      ArrayBuffer::New(env->isolate(), std::move(store)));
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -498,6 +556,9 @@ void Initialize(Local<Object> target,
   env->SetProtoMethod(des, "readUint64", DeserializerContext::ReadUint64);
   env->SetProtoMethod(des, "readDouble", DeserializerContext::ReadDouble);
   env->SetProtoMethod(des, "_readRawBytes", DeserializerContext::ReadRawBytes);
+  env->SetProtoMethod(des,
+                      "_readRawArrayBuffer",
+                      DeserializerContext::ReadRawArrayBuffer);
 
   des->SetLength(1);
   des->ReadOnlyPrototype();
@@ -526,6 +587,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(DeserializerContext::ReadUint64);
   registry->Register(DeserializerContext::ReadDouble);
   registry->Register(DeserializerContext::ReadRawBytes);
+  registry->Register(DeserializerContext::ReadRawArrayBuffer);
 }
 
 }  // namespace serdes
@@ -1,11 +1,13 @@
 
 #include "node_snapshotable.h"
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include "base_object-inl.h"
 #include "debug_utils-inl.h"
 #include "env-inl.h"
 #include "node_blob.h"
+#include "node_contextify.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_file.h"
@@ -14,6 +16,7 @@
 #include "node_process.h"
 #include "node_v8.h"
 #include "node_v8_platform-inl.h"
+#include "node_version.h"
 
 namespace node {
 
@@ -21,9 +24,14 @@ using v8::Context;
 using v8::HandleScope;
 using v8::Isolate;
 using v8::Local;
+using v8::NewStringType;
 using v8::Object;
+using v8::Script;
+using v8::ScriptCompiler;
+using v8::ScriptOrigin;
 using v8::SnapshotCreator;
 using v8::StartupData;
+using v8::String;
 using v8::TryCatch;
 using v8::Value;
 
@@ -84,9 +92,57 @@ const EnvSerializeInfo* NodeMainInstance::GetEnvSerializeInfo() {
   return ss.str();
 }
 
+// Runs the entry script of --build-snapshot in the main context. Errors
+// end the process, like errors during bootstrapping do.
+static void RunSnapshotEntry(Environment* env, const std::string& filename) {
+  std::string source;
+  if (ReadFileSync(&source, filename.c_str()) != 0) {
+    FPrintF(stderr, "Cannot read the snapshot entry script %s\n", filename);
+    exit(1);
+  }
+
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  TryCatch try_catch(isolate);
+  Local<String> source_string;
+  Local<String> filename_string;
+  Local<Script> script;
+  if (!String::NewFromUtf8(isolate,
+                           source.data(),
+                           NewStringType::kNormal,
+                           source.size()).ToLocal(&source_string) ||
+      !String::NewFromUtf8(isolate,
+                           filename.data(),
+                           NewStringType::kNormal,
+                           filename.size()).ToLocal(&filename_string)) {
+    FPrintF(stderr, "The snapshot entry script %s is too long\n", filename);
+    exit(1);
+  }
+  ScriptOrigin origin(isolate, filename_string);
+  ScriptCompiler::Source script_source(source_string, origin);
+  if (!ScriptCompiler::Compile(context, &script_source).ToLocal(&script) ||
+      script->Run(context).IsEmpty()) {
+    PrintCaughtException(isolate, context, try_catch);
+    exit(1);
+  }
+  isolate->PerformMicrotaskCheckpoint();
+
+  // Unlike Node.js' own bootstrapping, user code can leave things behind
+  // that cannot be part of a snapshot.
+  if (!env->req_wrap_queue()->IsEmpty() ||
+      !env->handle_wrap_queue()->IsEmpty()) {
+    FPrintF(stderr,
+            "The snapshot entry script %s left handles or requests open\n",
+            filename);
+    PrintLibuvHandleInformation(env->event_loop(), stderr);
+    exit(1);
+  }
+}
+
 void SnapshotBuilder::Generate(SnapshotData* out,
                                const std::vector<std::string> args,
-                               const std::vector<std::string> exec_args) {
+                               const std::vector<std::string> exec_args,
+                               const std::string& entry_file) {
   Isolate* isolate = Isolate::Allocate();
   isolate->SetCaptureStackTraceForUncaughtExceptions(
       true, 10, v8::StackTrace::StackTraceOptions::kDetailed);
@@ -143,6 +199,9 @@ void SnapshotBuilder::Generate(SnapshotData* out,
         result.ToLocalChecked();
       }
 
+      if (!entry_file.empty())
+        RunSnapshotEntry(env, entry_file);
+
       if (per_process::enabled_debug_list.enabled(DebugCategory::MKSNAPSHOT)) {
         env->PrintAllBaseObjects();
         printf("Environment = %p\n", env);
@@ -154,6 +213,14 @@ void SnapshotBuilder::Generate(SnapshotData* out,
       size_t index = creator.AddContext(
           context, {SerializeNodeContextInternalFields, env});
       CHECK_EQ(index, NodeMainInstance::kNodeContextIndex);
+
+      // The context that contextified contexts are deserialized from.
+      Local<Context> vm_context = Context::New(
+          isolate,
+          nullptr,
+          contextify::ContextifyContext::CreateGlobalTemplate(isolate));
+      index = creator.AddContext(vm_context);
+      CHECK_EQ(index, NodeMainInstance::kNodeVMContextIndex);
     }
 
     // Must be out of HandleScope
@@ -194,6 +261,181 @@ std::string SnapshotBuilder::Generate(
   return result;
 }
 
+namespace {
+
+// Identifies snapshot blob files, and the binary that wrote them, so that
+// a blob from another version is rejected instead of crashing V8.
+constexpr char kBlobMagic[] = "node snapshot blob\n";
+
+std::string BlobVersion() {
+  return std::string(NODE_VERSION) + " " + v8::V8::GetVersion();
+}
+
+class BlobWriter {
+ public:
+  explicit BlobWriter(std::ostream* out) : out_(out) {}
+
+  void Write(size_t value) {
+    out_->write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void Write(const std::string& value) {
+    Write(value.size());
+    out_->write(value.data(), value.size());
+  }
+
+  void Write(const PropInfo& value) {
+    Write(value.name);
+    Write(value.id);
+    Write(value.index);
+  }
+
+  template <typename T>
+  void Write(const std::vector<T>& values) {
+    Write(values.size());
+    for (const T& value : values)
+      Write(value);
+  }
+
+ private:
+  std::ostream* out_;
+};
+
+// Reading stops at the first error, and leaves ok() false.
+class BlobReader {
+ public:
+  explicit BlobReader(const std::string& data) : data_(data) {}
+
+  bool ok() const { return ok_; }
+  bool at_end() const { return position_ == data_.size(); }
+
+  void Read(size_t* value) {
+    if (!Consume(sizeof(*value)))
+      return;
+    memcpy(value, data_.data() + position_ - sizeof(*value), sizeof(*value));
+  }
+
+  void Read(std::string* value) {
+    size_t size = 0;
+    Read(&size);
+    if (!Consume(size))
+      return;
+    value->assign(data_, position_ - size, size);
+  }
+
+  void Read(PropInfo* value) {
+    Read(&value->name);
+    Read(&value->id);
+    Read(&value->index);
+  }
+
+  template <typename T>
+  void Read(std::vector<T>* values) {
+    size_t size = 0;
+    Read(&size);
+    // Each element takes at least one byte.
+    if (ok_ && size > data_.size() - position_)
+      ok_ = false;
+    values->resize(ok_ ? size : 0);
+    for (T& value : *values)
+      Read(&value);
+  }
+
+ private:
+  bool Consume(size_t size) {
+    if (!ok_ || size > data_.size() - position_) {
+      ok_ = false;
+      return false;
+    }
+    position_ += size;
+    return true;
+  }
+
+  const std::string& data_;
+  size_t position_ = 0;
+  bool ok_ = true;
+};
+
+}  // anonymous namespace
+
+bool WriteSnapshotBlob(const SnapshotData& data, const std::string& path) {
+  std::ofstream out(path, std::ios::out | std::ios::binary);
+  if (!out.is_open())
+    return false;
+  BlobWriter writer(&out);
+  const EnvSerializeInfo& info = data.env_info;
+  out << kBlobMagic;
+  writer.Write(BlobVersion());
+  writer.Write(std::string(data.blob.data, data.blob.raw_size));
+  writer.Write(data.isolate_data_indices);
+  writer.Write(info.bindings);
+  writer.Write(info.native_modules);
+  writer.Write(info.async_hooks.async_ids_stack);
+  writer.Write(info.async_hooks.fields);
+  writer.Write(info.async_hooks.async_id_fields);
+  writer.Write(info.async_hooks.js_execution_async_resources);
+  writer.Write(info.async_hooks.native_execution_async_resources);
+  writer.Write(info.tick_info.fields);
+  writer.Write(info.immediate_info.fields);
+  writer.Write(info.performance_state.root);
+  writer.Write(info.performance_state.milestones);
+  writer.Write(info.performance_state.observers);
+  writer.Write(info.stream_base_state);
+  writer.Write(info.should_abort_on_uncaught_toggle);
+  writer.Write(info.persistent_templates);
+  writer.Write(info.persistent_values);
+  writer.Write(info.context);
+  out.close();
+  return !out.fail();
+}
+
+bool ReadSnapshotBlob(SnapshotData* data, const std::string& path) {
+  std::string contents;
+  if (ReadFileSync(&contents, path.c_str()) != 0)
+    return false;
+  const size_t magic_size = sizeof(kBlobMagic) - 1;
+  if (contents.compare(0, magic_size, kBlobMagic) != 0)
+    return false;
+  contents.erase(0, magic_size);
+
+  BlobReader reader(contents);
+  std::string version;
+  reader.Read(&version);
+  if (!reader.ok() || version != BlobVersion())
+    return false;
+  std::string blob;
+  reader.Read(&blob);
+  EnvSerializeInfo& info = data->env_info;
+  reader.Read(&data->isolate_data_indices);
+  reader.Read(&info.bindings);
+  reader.Read(&info.native_modules);
+  reader.Read(&info.async_hooks.async_ids_stack);
+  reader.Read(&info.async_hooks.fields);
+  reader.Read(&info.async_hooks.async_id_fields);
+  reader.Read(&info.async_hooks.js_execution_async_resources);
+  reader.Read(&info.async_hooks.native_execution_async_resources);
+  reader.Read(&info.tick_info.fields);
+  reader.Read(&info.immediate_info.fields);
+  reader.Read(&info.performance_state.root);
+  reader.Read(&info.performance_state.milestones);
+  reader.Read(&info.performance_state.observers);
+  reader.Read(&info.stream_base_state);
+  reader.Read(&info.should_abort_on_uncaught_toggle);
+  reader.Read(&info.persistent_templates);
+  reader.Read(&info.persistent_values);
+  reader.Read(&info.context);
+  if (!reader.ok() || !reader.at_end() ||
+      blob.size() > static_cast<size_t>(INT_MAX)) {
+    return false;
+  }
+
+  char* blob_data = new char[blob.size()];
+  memcpy(blob_data, blob.data(), blob.size());
+  data->blob.data = blob_data;
+  data->blob.raw_size = static_cast<int>(blob.size());
+  return true;
+}
+
 SnapshotableObject::SnapshotableObject(Environment* env,
                                        Local<Object> wrap,
                                        EmbedderObjectType type)
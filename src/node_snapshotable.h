@@ -7,6 +7,9 @@
 #include "base_object.h"
 #include "util.h"
 
+#include <string>
+#include <vector>
+
 namespace node {
 
 class Environment;
@@ -127,10 +130,20 @@ class SnapshotBuilder {
  public:
   static std::string Generate(const std::vector<std::string> args,
                               const std::vector<std::string> exec_args);
+  // If `entry_file` is not empty, it is run as a script once Node.js is
+  // bootstrapped, and whatever it leaves in the heap becomes part of the
+  // snapshot.
   static void Generate(SnapshotData* out,
                        const std::vector<std::string> args,
-                       const std::vector<std::string> exec_args);
+                       const std::vector<std::string> exec_args,
+                       const std::string& entry_file = std::string());
 };
+
+// Snapshot blob files for --build-snapshot and --snapshot-blob. A blob can
+// only be loaded by the binary that wrote it. ReadSnapshotBlob() allocates
+// `data->blob.data` with new[].
+bool WriteSnapshotBlob(const SnapshotData& data, const std::string& path);
+bool ReadSnapshotBlob(SnapshotData* data, const std::string& path);
 }  // namespace node
 
 #endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
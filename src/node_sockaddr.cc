@@ -6,6 +6,8 @@
 #include "node_errors.h"
 #include "uv.h"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -389,6 +391,255 @@ bool SocketAddress::is_in_network(
   return false;
 }
 
+namespace {
+using Key = SocketAddressBlockList::PrefixTrie::Key;
+
+constexpr uint64_t kAllOnes = ~uint64_t{0};
+// The IPv4-mapped IPv6 addresses, ::ffff:0.0.0.0 to ::ffff:255.255.255.255.
+constexpr Key kMappedFirst = {0, uint64_t{0xffff} << 32};
+constexpr Key kMappedLast = {0, (uint64_t{0xffff} << 32) | 0xffffffff};
+
+int CountLeadingZeros(uint64_t x) {
+  CHECK_NE(x, 0);
+  int n = 0;
+  for (int shift = 32; shift > 0; shift >>= 1) {
+    if ((x >> (64 - shift)) == 0) {
+      n += shift;
+      x <<= shift;
+    }
+  }
+  return n;
+}
+
+int CountTrailingZeros(const Key& key) {
+  if (key.lo != 0) return 63 - CountLeadingZeros(key.lo & (~key.lo + 1));
+  if (key.hi != 0) return 127 - CountLeadingZeros(key.hi & (~key.hi + 1));
+  return 128;
+}
+
+// Keeps the first `prefix` bits of `key`.
+Key MaskKey(const Key& key, int prefix) {
+  if (prefix == 0) return {0, 0};
+  if (prefix < 64) return {key.hi & (kAllOnes << (64 - prefix)), 0};
+  if (prefix == 64) return {key.hi, 0};
+  if (prefix < 128) return {key.hi, key.lo & (kAllOnes << (128 - prefix))};
+  return key;
+}
+
+// The last `bits` bits set.
+Key LowBits(int bits) {
+  if (bits == 0) return {0, 0};
+  if (bits < 64) return {0, (uint64_t{1} << bits) - 1};
+  if (bits == 64) return {0, kAllOnes};
+  if (bits < 128) return {(uint64_t{1} << (bits - 64)) - 1, kAllOnes};
+  return {kAllOnes, kAllOnes};
+}
+
+// Bit 0 is the most significant one.
+int KeyBit(const Key& key, int index) {
+  return index < 64 ? (key.hi >> (63 - index)) & 1
+                    : (key.lo >> (127 - index)) & 1;
+}
+
+int CommonPrefix(const Key& a, const Key& b) {
+  if (a.hi != b.hi) return CountLeadingZeros(a.hi ^ b.hi);
+  if (a.lo != b.lo) return 64 + CountLeadingZeros(a.lo ^ b.lo);
+  return 128;
+}
+
+bool IsMapped(const Key& key) {
+  return !(key < kMappedFirst) && !(kMappedLast < key);
+}
+}  // namespace
+
+SocketAddressBlockList::PrefixTrie::PrefixTrie() {
+  nodes_.push_back(Node{{0, 0}, {kNone, kNone}, {0, 0}, 0});
+}
+
+SocketAddressBlockList::PrefixTrie::Key
+SocketAddressBlockList::PrefixTrie::ToKey(const SocketAddress& address) {
+  if (address.family() == AF_INET) {
+    const sockaddr_in* in =
+        reinterpret_cast<const sockaddr_in*>(address.data());
+    return {0, kMappedFirst.lo | ntohl(in->sin_addr.s_addr)};
+  }
+  const uint8_t* p =
+      reinterpret_cast<const sockaddr_in6*>(address.data())->sin6_addr.s6_addr;
+  return {(uint64_t{ReadUint32BE(p)} << 32) | ReadUint32BE(p + 4),
+          (uint64_t{ReadUint32BE(p + 8)} << 32) | ReadUint32BE(p + 12)};
+}
+
+int SocketAddressBlockList::PrefixTrie::ToFamily(
+    const SocketAddress& address) {
+  return address.family() == AF_INET ? kIPv4 : kIPv6;
+}
+
+uint32_t SocketAddressBlockList::PrefixTrie::NewNode(const Key& key,
+                                                     int prefix) {
+  CHECK_LT(nodes_.size(), UINT32_MAX);
+  nodes_.push_back(Node{MaskKey(key, prefix), {kNone, kNone}, {0, 0}, prefix});
+  return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+// Returns the node of the prefix, or kNone when it has none and `create` is
+// false. Nodes are only ever added, so that indices stay valid.
+uint32_t SocketAddressBlockList::PrefixTrie::Find(const Key& unmasked,
+                                                  int prefix,
+                                                  bool create) {
+  CHECK(prefix >= 0 && prefix <= 128);
+  const Key key = MaskKey(unmasked, prefix);
+  uint32_t index = 0;
+  for (;;) {
+    const int depth = nodes_[index].prefix;
+    if (depth == prefix) return index;
+
+    const int bit = KeyBit(key, depth);
+    const uint32_t child = nodes_[index].child[bit];
+    if (child == kNone) {
+      if (!create) return kNone;
+      const uint32_t leaf = NewNode(key, prefix);
+      nodes_[index].child[bit] = leaf;
+      return leaf;
+    }
+
+    const int child_prefix = nodes_[child].prefix;
+    const int common = std::min({CommonPrefix(key, nodes_[child].key),
+                                 child_prefix,
+                                 prefix});
+    if (common == child_prefix) {
+      index = child;
+      continue;
+    }
+    if (!create) return kNone;
+
+    // Split the edge to `child` where the keys part.
+    const uint32_t middle = NewNode(key, common);
+    nodes_[middle].child[KeyBit(nodes_[child].key, common)] = child;
+    nodes_[index].child[bit] = middle;
+    if (common == prefix) return middle;
+    const uint32_t leaf = NewNode(key, prefix);
+    nodes_[middle].child[KeyBit(key, common)] = leaf;
+    return leaf;
+  }
+}
+
+void SocketAddressBlockList::PrefixTrie::Add(const Key& key,
+                                             int prefix,
+                                             int families) {
+  Node& node = nodes_[Find(key, prefix, true)];
+  if (families & kIPv4) node.count[0]++;
+  if (families & kIPv6) node.count[1]++;
+}
+
+void SocketAddressBlockList::PrefixTrie::Remove(const Key& key,
+                                                int prefix,
+                                                int families) {
+  const uint32_t index = Find(key, prefix, false);
+  CHECK_NE(index, kNone);
+  Node& node = nodes_[index];
+  if (families & kIPv4) {
+    CHECK_GT(node.count[0], 0);
+    node.count[0]--;
+  }
+  if (families & kIPv6) {
+    CHECK_GT(node.count[1], 0);
+    node.count[1]--;
+  }
+}
+
+void SocketAddressBlockList::PrefixTrie::AddRange(Key start,
+                                                  const Key& end,
+                                                  int families) {
+  while (!(end < start)) {
+    // The largest aligned block from `start` that ends within the range.
+    int bits = CountTrailingZeros(start);
+    Key last;
+    for (;; bits--) {
+      const Key low = LowBits(bits);
+      last = {start.hi | low.hi, start.lo | low.lo};
+      if (!(end < last)) break;
+    }
+    Add(start, 128 - bits, families);
+
+    if (last.hi == kAllOnes && last.lo == kAllOnes) break;
+    start = {last.hi + (last.lo == kAllOnes), last.lo + 1};
+  }
+}
+
+bool SocketAddressBlockList::PrefixTrie::Lookup(const Key& key,
+                                                int family) const {
+  const int slot = family == kIPv4 ? 0 : 1;
+  uint32_t index = 0;
+  for (;;) {
+    const Node& node = nodes_[index];
+    if (node.count[slot] > 0) return true;
+    if (node.prefix == 128) return false;
+    index = node.child[KeyBit(key, node.prefix)];
+    if (index == kNone) return false;
+    const Node& child = nodes_[index];
+    if (!(MaskKey(key, child.prefix) == child.key)) return false;
+  }
+}
+
+SocketAddressRateLimiter::SocketAddressRateLimiter(double rate,
+                                                   double burst,
+                                                   size_t max_addresses)
+    : rate_(rate), burst_(burst), buckets_(max_addresses) {}
+
+bool SocketAddressRateLimiter::BucketTraits::CheckExpired(
+    const SocketAddress& address,
+    const Type& type) {
+  return type.full_at <= uv_hrtime();
+}
+
+void SocketAddressRateLimiter::BucketTraits::Touch(
+    const SocketAddress& address,
+    Type* type) {
+  // Admit() sets the real time once it has taken its token.
+  type->full_at = std::numeric_limits<uint64_t>::max();
+}
+
+bool SocketAddressRateLimiter::Admit(const SocketAddress& address) {
+  // The buckets are keyed by the host alone.
+  sockaddr_storage storage = {};
+  if (address.family() == AF_INET) {
+    sockaddr_in* host = reinterpret_cast<sockaddr_in*>(&storage);
+    host->sin_family = AF_INET;
+    host->sin_addr =
+        reinterpret_cast<const sockaddr_in*>(address.data())->sin_addr;
+  } else {
+    sockaddr_in6* host = reinterpret_cast<sockaddr_in6*>(&storage);
+    host->sin6_family = AF_INET6;
+    host->sin6_addr =
+        reinterpret_cast<const sockaddr_in6*>(address.data())->sin6_addr;
+  }
+
+  uint64_t now = uv_hrtime();
+  Bucket* bucket =
+      buckets_.Upsert(SocketAddress(reinterpret_cast<sockaddr*>(&storage)));
+  if (bucket->updated == 0) {
+    bucket->tokens = burst_;
+  } else {
+    bucket->tokens = std::min(
+        burst_, bucket->tokens + (now - bucket->updated) * rate_ / 1e9);
+  }
+  bucket->updated = now;
+
+  bool admitted = bucket->tokens >= 1;
+  if (admitted) bucket->tokens -= 1;
+  uint64_t forever = std::numeric_limits<uint64_t>::max();
+  double refill = rate_ > 0 ? (burst_ - bucket->tokens) / rate_ * 1e9 : 0;
+  if (rate_ <= 0 || refill >= static_cast<double>(forever - now))
+    bucket->full_at = forever;
+  else
+    bucket->full_at = now + static_cast<uint64_t>(refill);
+  return admitted;
+}
+
+void SocketAddressRateLimiter::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackField("buckets", buckets_);
+}
+
 SocketAddressBlockList::SocketAddressBlockList(
     std::shared_ptr<SocketAddressBlockList> parent)
     : parent_(parent) {}
@@ -400,6 +651,7 @@ void SocketAddressBlockList::AddSocketAddress(
       std::make_unique<SocketAddressRule>(address);
   rules_.emplace_front(std::move(rule));
   address_rules_[*address.get()] = rules_.begin();
+  trie_.Add(PrefixTrie::ToKey(*address), 128, PrefixTrie::kBoth);
 }
 
 void SocketAddressBlockList::RemoveSocketAddress(
@@ -409,6 +661,7 @@ void SocketAddressBlockList::RemoveSocketAddress(
   if (it != std::end(address_rules_)) {
     rules_.erase(it->second);
     address_rules_.erase(it);
+    trie_.Remove(PrefixTrie::ToKey(*address), 128, PrefixTrie::kBoth);
   }
 }
 
@@ -419,6 +672,19 @@ void SocketAddressBlockList::AddSocketAddressRange(
   std::unique_ptr<Rule> rule =
       std::make_unique<SocketAddressRangeRule>(start, end);
   rules_.emplace_front(std::move(rule));
+
+  Key start_key = PrefixTrie::ToKey(*start);
+  Key end_key = PrefixTrie::ToKey(*end);
+  if (IsMapped(start_key) && IsMapped(end_key)) {
+    trie_.AddRange(start_key, end_key, PrefixTrie::kBoth);
+    return;
+  }
+  // An IPv4 address is only comparable to an IPv6 one that is IPv4-mapped,
+  // so IPv4 addresses can not be in the range, and IPv6 addresses only where
+  // an IPv4 end is comparable to them.
+  if (start->family() == AF_INET) end_key = std::min(end_key, kMappedLast);
+  if (end->family() == AF_INET) start_key = std::max(start_key, kMappedFirst);
+  trie_.AddRange(start_key, end_key, PrefixTrie::kIPv6);
 }
 
 void SocketAddressBlockList::AddSocketAddressMask(
@@ -428,14 +694,17 @@ void SocketAddressBlockList::AddSocketAddressMask(
   std::unique_ptr<Rule> rule =
       std::make_unique<SocketAddressMaskRule>(network, prefix);
   rules_.emplace_front(std::move(rule));
+  trie_.Add(PrefixTrie::ToKey(*network),
+            network->family() == AF_INET ? 96 + prefix : prefix,
+            PrefixTrie::kBoth);
 }
 
 bool SocketAddressBlockList::Apply(
     const std::shared_ptr<SocketAddress>& address) {
   Mutex::ScopedLock lock(mutex_);
-  for (const auto& rule : rules_) {
-    if (rule->Apply(address))
-      return true;
+  if (trie_.Lookup(PrefixTrie::ToKey(*address),
+                   PrefixTrie::ToFamily(*address))) {
+    return true;
   }
   return parent_ ? parent_->Apply(address) : false;
 }
@@ -523,6 +792,7 @@ bool SocketAddressBlockList::ListRules(
 
 void SocketAddressBlockList::MemoryInfo(node::MemoryTracker* tracker) const {
   tracker->TrackField("rules", rules_);
+  tracker->TrackFieldWithSize("trie", trie_.memory_size());
 }
 
 void SocketAddressBlockList::SocketAddressRule::MemoryInfo(
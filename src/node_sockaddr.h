@@ -15,6 +15,7 @@
 #include <string>
 #include <list>
 #include <unordered_map>
+#include <vector>
 
 namespace node {
 
@@ -241,9 +242,51 @@ class SocketAddressLRU : public MemoryRetainer {
   size_t max_size_;
 };
 
+// A token bucket per host, used to turn away the connections or datagrams
+// of abusive peers before any JavaScript object is created for them. Each
+// host is admitted up to `burst` times at once, and `rate` times per second
+// after that; ports are ignored. At most `max_addresses` hosts are tracked,
+// and those seen least recently are forgotten first, as are those whose
+// bucket has filled up again.
+class SocketAddressRateLimiter : public MemoryRetainer {
+ public:
+  SocketAddressRateLimiter(double rate, double burst, size_t max_addresses);
+
+  // Takes a token from the bucket of the address' host. Returns false if
+  // there was none left.
+  bool Admit(const SocketAddress& address);
+
+  size_t size() const { return buckets_.size(); }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(SocketAddressRateLimiter)
+  SET_SELF_SIZE(SocketAddressRateLimiter)
+
+ private:
+  struct Bucket {
+    double tokens;
+    uint64_t updated;  // In uv_hrtime() nanoseconds, 0 for a new bucket.
+    uint64_t full_at;  // When `tokens` reaches `burst` again.
+  };
+
+  struct BucketTraits {
+    using Type = Bucket;
+    static bool CheckExpired(const SocketAddress& address, const Type& type);
+    static void Touch(const SocketAddress& address, Type* type);
+  };
+
+  double rate_;
+  double burst_;
+  SocketAddressLRU<BucketTraits> buckets_;
+};
+
 // A BlockList is used to evaluate whether a given
 // SocketAddress should be accepted for inbound or
 // outbound network activity.
+//
+// Besides the list of rules, which is kept for ListRules(), the
+// rules are compiled into a PrefixTrie as they are added, so that
+// Apply() does not depend on the number of rules.
 class SocketAddressBlockList : public MemoryRetainer {
  public:
   explicit SocketAddressBlockList(
@@ -319,6 +362,63 @@ class SocketAddressBlockList : public MemoryRetainer {
     SET_SELF_SIZE(SocketAddressMaskRule)
   };
 
+  // A path-compressed binary trie of address prefixes. Keys are 128 bits,
+  // and IPv4 addresses are keyed as IPv4-mapped IPv6 addresses, which the
+  // comparisons of SocketAddress treat as equal to them. Ranges are split
+  // into the prefixes that cover them. Each prefix counts the rules that
+  // cover it for IPv4 and for IPv6 addresses separately, as a range only
+  // matches the addresses that are comparable to both of its ends.
+  class PrefixTrie {
+   public:
+    enum Families : int {
+      kIPv4 = 1 << 0,
+      kIPv6 = 1 << 1,
+      kBoth = kIPv4 | kIPv6
+    };
+
+    struct Key {
+      uint64_t hi;
+      uint64_t lo;
+
+      bool operator==(const Key& other) const {
+        return hi == other.hi && lo == other.lo;
+      }
+      bool operator<(const Key& other) const {
+        return hi < other.hi || (hi == other.hi && lo < other.lo);
+      }
+    };
+
+    PrefixTrie();
+
+    static Key ToKey(const SocketAddress& address);
+    static int ToFamily(const SocketAddress& address);
+
+    void Add(const Key& key, int prefix, int families);
+    // Undoes an Add() of the same prefix.
+    void Remove(const Key& key, int prefix, int families);
+    // Adds the prefixes that cover [start, end].
+    void AddRange(Key start, const Key& end, int families);
+    // Whether a prefix of `key` has been added for `family`.
+    bool Lookup(const Key& key, int family) const;
+
+    size_t memory_size() const { return nodes_.capacity() * sizeof(Node); }
+
+   private:
+    static constexpr uint32_t kNone = 0;  // The root is no node's child.
+
+    struct Node {
+      Key key;
+      uint32_t child[2];
+      uint32_t count[2];  // For kIPv4 and kIPv6 addresses.
+      int prefix;
+    };
+
+    uint32_t NewNode(const Key& key, int prefix);
+    uint32_t Find(const Key& key, int prefix, bool create);
+
+    std::vector<Node> nodes_;
+  };
+
   void MemoryInfo(node::MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(SocketAddressBlockList)
   SET_SELF_SIZE(SocketAddressBlockList)
@@ -331,6 +431,7 @@ class SocketAddressBlockList : public MemoryRetainer {
   std::shared_ptr<SocketAddressBlockList> parent_;
   std::list<std::unique_ptr<Rule>> rules_;
   SocketAddress::Map<std::list<std::unique_ptr<Rule>>::iterator> address_rules_;
+  PrefixTrie trie_;
 
   Mutex mutex_;
 };
@@ -0,0 +1,140 @@
+#include "node_stall_detector.h"
+#include "debug_utils-inl.h"
+#include "env-inl.h"
+#include "node_internals.h"
+#include "node_options.h"
+#include "util-inl.h"
+
+#include <cinttypes>
+
+namespace node {
+
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::StackFrame;
+using v8::StackTrace;
+
+StallDetector::StallDetector(Environment* env)
+    : env_(env),
+      threshold_ns_(env->options()->event_loop_stall_threshold * 1000000),
+      reports_(std::make_shared<Reports>()),
+      last_tick_(uv_hrtime()) {
+  CHECK_EQ(uv_prepare_init(env->event_loop(), &prepare_), 0);
+  CHECK_EQ(uv_check_init(env->event_loop(), &check_), 0);
+  CHECK_EQ(uv_prepare_start(&prepare_, OnPrepare), 0);
+  CHECK_EQ(uv_check_start(&check_, OnCheck), 0);
+  uv_unref(reinterpret_cast<uv_handle_t*>(&prepare_));
+  uv_unref(reinterpret_cast<uv_handle_t*>(&check_));
+  CHECK_EQ(uv_thread_create(&thread_, [](void* data) {
+    static_cast<StallDetector*>(data)->Watch();
+  }, this), 0);
+}
+
+void StallDetector::Start(Environment* env) {
+  StallDetector* detector = new StallDetector(env);
+  env->AddCleanupHook([](void* data) {
+    static_cast<StallDetector*>(data)->Stop();
+  }, detector);
+}
+
+void StallDetector::Stop() {
+  {
+    Mutex::ScopedLock lock(reports_->mutex);
+    reports_->stopping = true;
+    reports_->cond.Signal(lock);
+  }
+  CHECK_EQ(uv_thread_join(&thread_), 0);
+
+  auto on_close = [](StallDetector* detector) {
+    if (--detector->open_handles_ == 0) delete detector;
+  };
+  env_->CloseHandle(&prepare_, [on_close](uv_prepare_t* handle) {
+    on_close(ContainerOf(&StallDetector::prepare_, handle));
+  });
+  env_->CloseHandle(&check_, [on_close](uv_check_t* handle) {
+    on_close(ContainerOf(&StallDetector::check_, handle));
+  });
+}
+
+// The loop is only idle between these two, while it waits for I/O.
+void StallDetector::OnPrepare(uv_prepare_t* handle) {
+  StallDetector* detector = ContainerOf(&StallDetector::prepare_, handle);
+  detector->last_tick_ = uv_hrtime();
+  detector->ticks_++;
+  detector->polling_ = true;
+}
+
+void StallDetector::OnCheck(uv_check_t* handle) {
+  StallDetector* detector = ContainerOf(&StallDetector::check_, handle);
+  detector->polling_ = false;
+  detector->last_tick_ = uv_hrtime();
+  detector->ticks_++;
+}
+
+void StallDetector::Watch() {
+  std::shared_ptr<Reports> reports = reports_;
+  // The stall that was reported last, so that each is reported once.
+  uint64_t reported_ticks = UINT64_MAX;
+
+  Mutex::ScopedLock lock(reports->mutex);
+  while (!reports->stopping) {
+    while (!reports->pending.empty()) {
+      std::string report = std::move(reports->pending.front());
+      reports->pending.pop_front();
+      Mutex::ScopedUnlock unlock(lock);
+      FPrintF(stderr, "%s", report);
+    }
+
+    reports->cond.TimedWait(lock, threshold_ns_ / 2);
+    if (reports->stopping || polling_) continue;
+    uint64_t ticks = ticks_;
+    uint64_t last_tick = last_tick_;
+    if (ticks == reported_ticks || uv_hrtime() - last_tick < threshold_ns_)
+      continue;
+    reported_ticks = ticks;
+
+    env_->RequestInterrupt([reports, last_tick](Environment* env) {
+      std::string report = Capture(env, uv_hrtime() - last_tick);
+      Mutex::ScopedLock lock(reports->mutex);
+      reports->pending.emplace_back(std::move(report));
+      reports->cond.Signal(lock);
+    });
+  }
+}
+
+std::string StallDetector::Capture(Environment* env, uint64_t stalled_ns) {
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  std::string out = SPrintF("(node:%d) Event loop stalled for %dms",
+                            uv_os_getpid(), stalled_ns / 1000000);
+  if (!env->is_main_thread())
+    out += SPrintF(" in thread %d", env->thread_id());
+  out += "\n";
+
+  Local<StackTrace> stack = StackTrace::CurrentStackTrace(isolate, 16);
+  for (int i = 0; i < stack->GetFrameCount(); i++) {
+    Local<StackFrame> frame = stack->GetFrame(isolate, i);
+    Utf8Value function_name(isolate, frame->GetFunctionName());
+    Utf8Value script_name(isolate, frame->GetScriptName());
+    out += SPrintF("    at %s (%s:%d:%d)\n",
+                   function_name.length() > 0 ? *function_name
+                                              : "<anonymous>",
+                   *script_name,
+                   frame->GetLineNumber(),
+                   frame->GetColumn());
+  }
+
+  auto sym_ctx = NativeSymbolDebuggingContext::New();
+  void* frames[32];
+  int count = sym_ctx->GetStackTrace(frames, arraysize(frames));
+  // Skip this function.
+  for (int i = 1; i < count; i++) {
+    out += SPrintF("    %p %s\n",
+                   frames[i],
+                   sym_ctx->LookupSymbol(frames[i]).Display());
+  }
+  return out;
+}
+
+}  // namespace node
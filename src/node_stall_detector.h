@@ -0,0 +1,71 @@
+#ifndef SRC_NODE_STALL_DETECTOR_H_
+#define SRC_NODE_STALL_DETECTOR_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_mutex.h"
+#include "uv.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace node {
+
+class Environment;
+
+// Watches for event loop stalls, with --event-loop-stall-threshold.
+//
+// The loop marks its progress in prepare and check handles, and a watchdog
+// thread checks that it has not been stuck outside of the poll phase for
+// longer than the threshold. When it has, the watchdog interrupts the
+// isolate, and the interrupt, which runs on the loop's thread as soon as
+// JavaScript code is running, captures the JavaScript and native stacks of
+// whatever is holding the loop up. The watchdog thread then prints them to
+// stderr, so that the loop does not pay for the I/O.
+//
+// Work that stays in native code for the whole stall only gets to run the
+// interrupt afterwards; the stacks then show what ran next.
+class StallDetector {
+ public:
+  static void Start(Environment* env);
+
+  StallDetector(const StallDetector&) = delete;
+  StallDetector& operator=(const StallDetector&) = delete;
+
+ private:
+  // Shared with the interrupts, which may outlive the detector.
+  struct Reports {
+    Mutex mutex;
+    ConditionVariable cond;
+    std::deque<std::string> pending;
+    bool stopping = false;
+  };
+
+  explicit StallDetector(Environment* env);
+
+  void Stop();
+  void Watch();
+  static std::string Capture(Environment* env, uint64_t stalled_ns);
+
+  static void OnPrepare(uv_prepare_t* handle);
+  static void OnCheck(uv_check_t* handle);
+
+  Environment* const env_;
+  const uint64_t threshold_ns_;
+  std::shared_ptr<Reports> reports_;
+  uv_prepare_t prepare_;
+  uv_check_t check_;
+  uv_thread_t thread_;
+  std::atomic<uint64_t> last_tick_;
+  std::atomic<uint64_t> ticks_ {0};
+  std::atomic<bool> polling_ {false};
+  int open_handles_ = 2;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_STALL_DETECTOR_H_
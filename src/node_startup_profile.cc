@@ -0,0 +1,192 @@
+#include "node_startup_profile.h"
+#include "debug_utils-inl.h"
+#include "env-inl.h"
+#include "node_internals.h"
+#include "node_native_module.h"
+#include "node_options.h"
+#include "node_version.h"
+#include "util-inl.h"
+
+#include <cstring>
+#include <set>
+
+namespace node {
+
+using native_module::NativeModuleLoader;
+using v8::Function;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::ScriptCompiler;
+using v8::UnboundModuleScript;
+using v8::UnboundScript;
+
+namespace {
+
+constexpr char kMagic[] = "node startup profile 1\n";
+
+void AppendU32(std::string* out, uint32_t value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool ReadU32(const std::string& in, size_t* pos, uint32_t* value) {
+  if (in.size() - *pos < sizeof(*value)) return false;
+  memcpy(value, in.data() + *pos, sizeof(*value));
+  *pos += sizeof(*value);
+  return true;
+}
+
+bool ReadBytes(const std::string& in, size_t* pos, std::string* value) {
+  uint32_t size;
+  if (!ReadU32(in, pos, &size) || in.size() - *pos < size) return false;
+  value->assign(in, *pos, size);
+  *pos += size;
+  return true;
+}
+
+std::string VersionString() {
+  return std::string(NODE_VERSION) + " " +
+         std::to_string(ScriptCompiler::CachedDataVersionTag());
+}
+
+}  // anonymous namespace
+
+std::atomic<StartupProfile*> StartupProfile::recording_{nullptr};
+
+void StartupProfile::Initialize(Isolate* isolate) {
+  const std::string& path = per_process::cli_options->startup_profile;
+  if (path.empty()) return;
+  StartupProfile* profile = new StartupProfile(isolate, path);
+  if (profile->Load()) {
+    delete profile;
+    return;
+  }
+  per_process::Debug(DebugCategory::COMPILE_CACHE,
+                     "Recording a startup profile for %s\n", path);
+  recording_.store(profile);
+}
+
+void StartupProfile::OnEnvironmentLoaded(Environment* env) {
+  StartupProfile* profile = GetRecording(env->isolate());
+  if (profile == nullptr) return;
+  env->SetImmediate([profile](Environment* env) {
+    recording_.store(nullptr);
+    profile->Write();
+    delete profile;
+  });
+}
+
+StartupProfile* StartupProfile::GetRecording(Isolate* isolate) {
+  StartupProfile* profile = recording_.load(std::memory_order_relaxed);
+  return profile != nullptr && profile->isolate_ == isolate ? profile
+                                                             : nullptr;
+}
+
+void StartupProfile::AddBuiltin(const char* id, Local<Function> fn) {
+  builtins_.emplace_back(id, v8::Global<Function>(isolate_, fn));
+}
+
+void StartupProfile::AddFunction(CompileCache::Entry entry,
+                                 Local<Function> fn) {
+  functions_.emplace_back(std::move(entry),
+                          v8::Global<Function>(isolate_, fn));
+}
+
+void StartupProfile::AddScript(CompileCache::Entry entry,
+                               Local<UnboundScript> script) {
+  scripts_.emplace_back(std::move(entry),
+                        v8::Global<UnboundScript>(isolate_, script));
+}
+
+void StartupProfile::AddModule(CompileCache::Entry entry,
+                               Local<UnboundModuleScript> module) {
+  modules_.emplace_back(std::move(entry),
+                        v8::Global<UnboundModuleScript>(isolate_, module));
+}
+
+bool StartupProfile::Load() {
+  std::string in;
+  if (ReadFileSync(&in, path_.c_str()) != 0) return false;
+  size_t pos = sizeof(kMagic) - 1;
+  std::string version;
+  uint32_t count;
+  if (in.compare(0, pos, kMagic) != 0 ||
+      !ReadBytes(in, &pos, &version) || version != VersionString() ||
+      !ReadU32(in, &pos, &count)) {
+    return false;
+  }
+
+  std::vector<std::pair<std::string, std::string>> caches(count);
+  for (auto& cache : caches) {
+    if (!ReadBytes(in, &pos, &cache.first) ||
+        !ReadBytes(in, &pos, &cache.second)) {
+      return false;
+    }
+  }
+
+  NativeModuleLoader* loader = NativeModuleLoader::GetInstance();
+  Mutex::ScopedLock lock(loader->code_cache_mutex_);
+  for (const auto& cache : caches) {
+    uint8_t* data = new uint8_t[cache.second.size()];
+    memcpy(data, cache.second.data(), cache.second.size());
+    (*loader->code_cache())[cache.first] =
+        std::make_unique<ScriptCompiler::CachedData>(
+            data, cache.second.size(),
+            ScriptCompiler::CachedData::BufferOwned);
+  }
+  per_process::Debug(DebugCategory::COMPILE_CACHE,
+                     "Read %d code caches from %s\n", count, path_);
+  return true;
+}
+
+void StartupProfile::Write() {
+  HandleScope handle_scope(isolate_);
+
+  std::string out = kMagic;
+  std::string version = VersionString();
+  AppendU32(&out, version.size());
+  out += version;
+
+  std::set<std::string> written;
+  std::string caches;
+  for (const auto& builtin : builtins_) {
+    if (!written.insert(builtin.first).second) continue;
+    std::unique_ptr<ScriptCompiler::CachedData> data(
+        ScriptCompiler::CreateCodeCacheForFunction(
+            builtin.second.Get(isolate_)));
+    if (!data) continue;
+    AppendU32(&caches, builtin.first.size());
+    caches += builtin.first;
+    AppendU32(&caches, data->length);
+    caches.append(reinterpret_cast<const char*>(data->data), data->length);
+  }
+  AppendU32(&out, written.size());
+  out += caches;
+
+  int err = WriteFileSync(path_.c_str(), uv_buf_init(&out[0], out.size()));
+  if (err < 0) {
+    per_process::Debug(DebugCategory::COMPILE_CACHE,
+                       "Cannot write %s: %s\n", path_, uv_strerror(err));
+  }
+
+  CompileCache* compile_cache = CompileCache::Get();
+  if (compile_cache == nullptr) return;
+  using CachedData = std::unique_ptr<ScriptCompiler::CachedData>;
+  for (auto& function : functions_) {
+    compile_cache->Save(std::move(function.first),
+                        CachedData(ScriptCompiler::CreateCodeCacheForFunction(
+                            function.second.Get(isolate_))));
+  }
+  for (auto& script : scripts_) {
+    compile_cache->Save(std::move(script.first),
+                        CachedData(ScriptCompiler::CreateCodeCache(
+                            script.second.Get(isolate_))));
+  }
+  for (auto& module : modules_) {
+    compile_cache->Save(std::move(module.first),
+                        CachedData(ScriptCompiler::CreateCodeCache(
+                            module.second.Get(isolate_))));
+  }
+}
+
+}  // namespace node
@@ -0,0 +1,79 @@
+#ifndef SRC_NODE_STARTUP_PROFILE_H_
+#define SRC_NODE_STARTUP_PROFILE_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "node_compile_cache.h"
+#include "v8.h"
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace node {
+
+class Environment;
+
+// Profile-guided code caching for startup, with --startup-profile=file.
+//
+// V8 compiles most functions lazily, when they are first called, and a
+// code cache only holds the functions that were compiled when it was made.
+// The caches that are built into the binary, or that --compile-cache-dir
+// writes right after compiling, hardly match what an application runs.
+//
+// When the file does not exist yet, the main thread records the internal
+// modules that it compiles, and the user code that goes through the
+// compile cache. After the main script has run, in the first turn of the
+// event loop, it makes code caches for all of these, which now also cover
+// the functions that have been called. Those of internal modules are
+// written to the file, and those of user code to the compile cache. On
+// later runs, the internal modules are compiled from the caches in the
+// file, and user code finds its caches in the compile cache, so the
+// functions that startup needs are deserialized instead of compiled.
+class StartupProfile {
+ public:
+  // Loads the profile, or starts recording on the main thread's isolate.
+  static void Initialize(v8::Isolate* isolate);
+  // Called once the main script has been run.
+  static void OnEnvironmentLoaded(Environment* env);
+
+  // Returns nullptr unless `isolate` is recording a profile.
+  static StartupProfile* GetRecording(v8::Isolate* isolate);
+
+  void AddBuiltin(const char* id, v8::Local<v8::Function> fn);
+  void AddFunction(CompileCache::Entry entry, v8::Local<v8::Function> fn);
+  void AddScript(CompileCache::Entry entry,
+                 v8::Local<v8::UnboundScript> script);
+  void AddModule(CompileCache::Entry entry,
+                 v8::Local<v8::UnboundModuleScript> module);
+
+  StartupProfile(const StartupProfile&) = delete;
+  StartupProfile& operator=(const StartupProfile&) = delete;
+
+ private:
+  StartupProfile(v8::Isolate* isolate, const std::string& path)
+      : isolate_(isolate), path_(path) {}
+
+  bool Load();
+  void Write();
+
+  static std::atomic<StartupProfile*> recording_;
+
+  v8::Isolate* const isolate_;
+  const std::string path_;
+  std::vector<std::pair<std::string, v8::Global<v8::Function>>> builtins_;
+  std::vector<std::pair<CompileCache::Entry, v8::Global<v8::Function>>>
+      functions_;
+  std::vector<std::pair<CompileCache::Entry, v8::Global<v8::UnboundScript>>>
+      scripts_;
+  std::vector<
+      std::pair<CompileCache::Entry, v8::Global<v8::UnboundModuleScript>>>
+      modules_;
+};
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_STARTUP_PROFILE_H_
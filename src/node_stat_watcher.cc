@@ -42,6 +42,36 @@ using v8::Object;
 using v8::Uint32;
 using v8::Value;
 
+namespace {
+
+// Whether the OS reliably reports changes to the files in `dir`. inotify and
+// FSEvents do not see changes made by other hosts on network filesystems, and
+// pseudo filesystems never generate events at all.
+bool HasReliableNotifications(const char* dir) {
+  bool pseudo;
+  return fs::IsLocalFilesystem(dir, &pseudo) && !pseudo;
+}
+
+// Same fields as the comparison in uv_fs_poll.
+bool StatEqual(const uv_stat_t& a, const uv_stat_t& b) {
+  return a.st_ctim.tv_nsec == b.st_ctim.tv_nsec &&
+         a.st_mtim.tv_nsec == b.st_mtim.tv_nsec &&
+         a.st_birthtim.tv_nsec == b.st_birthtim.tv_nsec &&
+         a.st_ctim.tv_sec == b.st_ctim.tv_sec &&
+         a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+         a.st_birthtim.tv_sec == b.st_birthtim.tv_sec &&
+         a.st_size == b.st_size &&
+         a.st_mode == b.st_mode &&
+         a.st_uid == b.st_uid &&
+         a.st_gid == b.st_gid &&
+         a.st_ino == b.st_ino &&
+         a.st_dev == b.st_dev &&
+         a.st_flags == b.st_flags &&
+         a.st_gen == b.st_gen;
+}
+
+}  // anonymous namespace
+
 
 void StatWatcher::Initialize(Environment* env, Local<Object> target) {
   HandleScope scope(env->isolate());
@@ -52,6 +82,8 @@ void StatWatcher::Initialize(Environment* env, Local<Object> target) {
   t->Inherit(HandleWrap::GetConstructorTemplate(env));
 
   env->SetProtoMethod(t, "start", StatWatcher::Start);
+  env->SetProtoMethod(t, "ref", StatWatcher::Ref);
+  env->SetProtoMethod(t, "unref", StatWatcher::Unref);
 
   env->SetConstructorFunction(target, "StatWatcher", t);
 }
@@ -60,6 +92,8 @@ void StatWatcher::RegisterExternalReferences(
     ExternalReferenceRegistry* registry) {
   registry->Register(StatWatcher::New);
   registry->Register(StatWatcher::Start);
+  registry->Register(StatWatcher::Ref);
+  registry->Register(StatWatcher::Unref);
 }
 
 StatWatcher::StatWatcher(fs::BindingData* binding_data,
@@ -80,17 +114,184 @@ void StatWatcher::Callback(uv_fs_poll_t* handle,
                            const uv_stat_t* prev,
                            const uv_stat_t* curr) {
   StatWatcher* wrap = ContainerOf(&StatWatcher::watcher_, handle);
-  Environment* env = wrap->env();
+  wrap->OnChange(status, prev, curr);
+}
+
+
+void StatWatcher::OnChange(int status,
+                           const uv_stat_t* prev,
+                           const uv_stat_t* curr) {
+  Environment* env = this->env();
   HandleScope handle_scope(env->isolate());
   Context::Scope context_scope(env->context());
 
   Local<Value> arr = fs::FillGlobalStatsArray(
-      wrap->binding_data_.get(), wrap->use_bigint_, curr);
-  USE(fs::FillGlobalStatsArray(
-      wrap->binding_data_.get(), wrap->use_bigint_, prev, true));
+      binding_data_.get(), use_bigint_, curr);
+  USE(fs::FillGlobalStatsArray(binding_data_.get(), use_bigint_, prev, true));
 
   Local<Value> argv[2] = { Integer::New(env->isolate(), status), arr };
-  wrap->MakeCallback(env->onchange_string(), arraysize(argv), argv);
+  MakeCallback(env->onchange_string(), arraysize(argv), argv);
+}
+
+
+void StatWatcher::OnEvent(uv_fs_event_t* handle,
+                          const char* filename,
+                          int events,
+                          int status) {
+  StatWatcher* wrap = static_cast<StatWatcher*>(handle->data);
+  if (status != 0) {
+    wrap->Check();
+    if (!wrap->IsHandleClosing())
+      wrap->FallBackToPolling();
+    return;
+  }
+  // A rename may also be the directory itself going away, in which case the
+  // watch is dead and only polling can tell when the path comes back.
+  if (events & UV_RENAME)
+    wrap->verify_dir_ = true;
+  else if (filename != nullptr && wrap->basename_ != filename)
+    return;
+  wrap->ScheduleCheck();
+}
+
+
+int StatWatcher::StartEventWatcher(const char* path) {
+  std::string filename(path);
+  const size_t slash = filename.rfind('/');
+  if (slash == std::string::npos) {
+    dir_ = ".";
+    basename_ = filename;
+  } else {
+    dir_ = filename.substr(0, slash == 0 ? 1 : slash);
+    basename_ = filename.substr(slash + 1);
+  }
+  if (basename_.empty() || basename_ == "." || basename_ == "..")
+    return UV_EINVAL;
+  if (!HasReliableNotifications(dir_.c_str()))
+    return UV_ENOTSUP;
+
+  uv_fs_t req;
+  int err = uv_fs_stat(env()->event_loop(), &req, dir_.c_str(), nullptr);
+  if (err == 0) {
+    dir_dev_ = req.statbuf.st_dev;
+    dir_ino_ = req.statbuf.st_ino;
+  }
+  uv_fs_req_cleanup(&req);
+  if (err != 0)
+    return err;
+
+  event_watcher_ = new uv_fs_event_t;
+  CHECK_EQ(0, uv_fs_event_init(env()->event_loop(), event_watcher_));
+  event_watcher_->data = this;
+  err = uv_fs_event_start(event_watcher_, OnEvent, dir_.c_str(), 0);
+  if (err != 0) {
+    StopEventWatcher();
+    return err;
+  }
+  if (!uv_has_ref(GetHandle()))
+    uv_unref(reinterpret_cast<uv_handle_t*>(event_watcher_));
+
+  path_ = std::move(filename);
+  ScheduleCheck();
+  return 0;
+}
+
+
+void StatWatcher::StopEventWatcher() {
+  if (event_watcher_ == nullptr)
+    return;
+  env()->CloseHandle(event_watcher_,
+                     [](uv_fs_event_t* handle) { delete handle; });
+  event_watcher_ = nullptr;
+}
+
+
+void StatWatcher::FallBackToPolling() {
+  StopEventWatcher();
+  CHECK_EQ(0, uv_fs_poll_start(&watcher_, Callback, path_.c_str(), interval_));
+}
+
+
+bool StatWatcher::IsDirectoryIntact() {
+  uv_fs_t req;
+  const int err =
+      uv_fs_stat(env()->event_loop(), &req, dir_.c_str(), nullptr);
+  const bool intact = err == 0 &&
+                      req.statbuf.st_dev == dir_dev_ &&
+                      req.statbuf.st_ino == dir_ino_;
+  uv_fs_req_cleanup(&req);
+  return intact;
+}
+
+
+void StatWatcher::ScheduleCheck() {
+  if (check_pending_)
+    return;
+  check_pending_ = true;
+  env()->SetImmediate([self = BaseObjectPtr<StatWatcher>(this)](
+      Environment* env) {
+    self->RunScheduledCheck();
+  });
+}
+
+
+void StatWatcher::RunScheduledCheck() {
+  check_pending_ = false;
+  if (event_watcher_ == nullptr)
+    return;
+  Check();
+  if (IsHandleClosing() || event_watcher_ == nullptr)
+    return;
+  if (verify_dir_ && !IsDirectoryIntact())
+    FallBackToPolling();
+  verify_dir_ = false;
+}
+
+
+void StatWatcher::Check() {
+  uv_fs_t req;
+  const int err =
+      uv_fs_stat(env()->event_loop(), &req, path_.c_str(), nullptr);
+  if (err != 0) {
+    if (last_status_ != err) {
+      uv_stat_t zero_statbuf {};
+      last_status_ = err;
+      OnChange(err, &statbuf_, &zero_statbuf);
+    }
+  } else {
+    const uv_stat_t prev = statbuf_;
+    const bool changed = last_status_ < 0 ||
+        (last_status_ != 0 && !StatEqual(prev, req.statbuf));
+    statbuf_ = req.statbuf;
+    last_status_ = 1;
+    if (changed)
+      OnChange(0, &prev, &statbuf_);
+  }
+  uv_fs_req_cleanup(&req);
+}
+
+
+void StatWatcher::Close(Local<Value> close_callback) {
+  StopEventWatcher();
+  HandleWrap::Close(close_callback);
+}
+
+
+void StatWatcher::Ref(const FunctionCallbackInfo<Value>& args) {
+  HandleWrap::Ref(args);
+  StatWatcher* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  if (wrap->event_watcher_ != nullptr)
+    uv_ref(reinterpret_cast<uv_handle_t*>(wrap->event_watcher_));
+}
+
+
+void StatWatcher::Unref(const FunctionCallbackInfo<Value>& args) {
+  HandleWrap::Unref(args);
+  StatWatcher* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  if (wrap->event_watcher_ != nullptr)
+    uv_unref(reinterpret_cast<uv_handle_t*>(wrap->event_watcher_));
 }
 
 
@@ -108,12 +309,18 @@ void StatWatcher::Start(const FunctionCallbackInfo<Value>& args) {
   StatWatcher* wrap;
   ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
   CHECK(!uv_is_active(wrap->GetHandle()));
+  CHECK_NULL(wrap->event_watcher_);
 
   node::Utf8Value path(args.GetIsolate(), args[0]);
   CHECK_NOT_NULL(*path);
 
   CHECK(args[1]->IsUint32());
   const uint32_t interval = args[1].As<Uint32>()->Value();
+  wrap->interval_ = interval;
+
+  // Only poll if the path cannot be watched for changes.
+  if (wrap->StartEventWatcher(*path) == 0)
+    return;
 
   // Note that uv_fs_poll_start does not return ENOENT, we are handling
   // mostly memory errors here.
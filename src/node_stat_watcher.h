@@ -29,6 +29,8 @@
 #include "uv.h"
 #include "v8.h"
 
+#include <string>
+
 namespace node {
 namespace fs {
 class BindingData;
@@ -37,11 +39,20 @@ class BindingData;
 class Environment;
 class ExternalReferenceRegistry;
 
+// Reports changes to the stat() result of a path. Where the OS has a file
+// notification API and the path is on a local filesystem, the parent
+// directory is watched with a uv_fs_event_t and the path is only stat'ed
+// when something in that directory changes. Otherwise, and whenever the
+// parent directory itself goes away, `watcher_` polls the path at the given
+// interval.
 class StatWatcher : public HandleWrap {
  public:
   static void Initialize(Environment* env, v8::Local<v8::Object> target);
   static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
 
+  void Close(
+      v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
+
  protected:
   StatWatcher(fs::BindingData* binding_data,
               v8::Local<v8::Object> wrap,
@@ -49,6 +60,10 @@ class StatWatcher : public HandleWrap {
 
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Start(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Shadow HandleWrap::Ref() and HandleWrap::Unref() so that the event
+  // watcher follows the ref state of `watcher_`.
+  static void Ref(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void Unref(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   SET_NO_MEMORY_INFO()
   SET_MEMORY_INFO_NAME(StatWatcher)
@@ -59,8 +74,35 @@ class StatWatcher : public HandleWrap {
                        int status,
                        const uv_stat_t* prev,
                        const uv_stat_t* curr);
+  static void OnEvent(uv_fs_event_t* handle,
+                      const char* filename,
+                      int events,
+                      int status);
+
+  void OnChange(int status, const uv_stat_t* prev, const uv_stat_t* curr);
+  int StartEventWatcher(const char* path);
+  void StopEventWatcher();
+  void FallBackToPolling();
+  bool IsDirectoryIntact();
+  // Coalesces the events of one loop iteration into a single Check().
+  void ScheduleCheck();
+  void RunScheduledCheck();
+  // Stats the path and reports a change the same way uv_fs_poll does.
+  void Check();
 
   uv_fs_poll_t watcher_;
+  uv_fs_event_t* event_watcher_ = nullptr;
+  std::string path_;
+  std::string dir_;
+  std::string basename_;
+  uint64_t dir_dev_ = 0;
+  uint64_t dir_ino_ = 0;
+  uv_stat_t statbuf_ {};
+  // 0 until the first stat, then 1 or the last error, as in uv_fs_poll.
+  int last_status_ = 0;
+  uint32_t interval_ = 0;
+  bool check_pending_ = false;
+  bool verify_dir_ = false;
   const bool use_bigint_;
   BaseObjectPtr<fs::BindingData> binding_data_;
 };
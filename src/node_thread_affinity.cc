@@ -0,0 +1,193 @@
+#include "node_thread_affinity.h"
+#include "node_mutex.h"
+#include "util.h"
+#include "uv.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace node {
+namespace thread_affinity {
+
+namespace {
+
+Mutex placements_mutex;
+Policy current_policy = Policy::kNone;
+std::vector<std::vector<char>> groups;  // One CPU mask per group.
+std::vector<Placement> placements;
+
+std::string FormatCpuList(const std::vector<char>& mask) {
+  std::string out;
+  size_t i = 0;
+  while (i < mask.size()) {
+    if (!mask[i]) {
+      i++;
+      continue;
+    }
+    size_t first = i;
+    while (i + 1 < mask.size() && mask[i + 1]) i++;
+    if (!out.empty()) out += ',';
+    out += std::to_string(first);
+    if (i > first) out += '-' + std::to_string(i);
+    i++;
+  }
+  return out;
+}
+
+// Marks the CPUs of a cpulist such as "0-3,8" that are also set in `allowed`.
+std::vector<char> ParseCpuList(const char* list,
+                               const std::vector<char>& allowed) {
+  std::vector<char> mask(allowed.size(), 0);
+  const char* p = list;
+  while (*p != '\0') {
+    char* end;
+    long first = strtol(p, &end, 10);  // NOLINT(runtime/int)
+    if (end == p) break;
+    long last = first;  // NOLINT(runtime/int)
+    if (*end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+      if (end == p) break;
+    }
+    for (; first <= last; first++) {
+      if (first >= 0 && static_cast<size_t>(first) < mask.size())
+        mask[first] = allowed[first];
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+  return mask;
+}
+
+bool IsEmpty(const std::vector<char>& mask) {
+  for (char cpu : mask) {
+    if (cpu) return false;
+  }
+  return true;
+}
+
+std::vector<std::vector<char>> NumaGroups(const std::vector<char>& allowed) {
+  std::vector<std::vector<char>> result;
+#ifdef __linux__
+  // Nodes can be numbered sparsely, so look at what actually exists.
+  static const char kNodeDir[] = "/sys/devices/system/node";
+  uv_fs_t req;
+  if (uv_fs_scandir(nullptr, &req, kNodeDir, 0, nullptr) >= 0) {
+    std::vector<int> nodes;
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+      int node;
+      char extra;
+      if (sscanf(ent.name, "node%d%c", &node, &extra) == 1)
+        nodes.push_back(node);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    for (int node : nodes) {
+      std::string cpulist;
+      std::string path = std::string(kNodeDir) + "/node" +
+                         std::to_string(node) + "/cpulist";
+      if (ReadFileSync(&cpulist, path.c_str()) != 0) continue;
+      std::vector<char> mask = ParseCpuList(cpulist.c_str(), allowed);
+      if (!IsEmpty(mask)) result.push_back(std::move(mask));
+    }
+  }
+  uv_fs_req_cleanup(&req);
+#endif  // __linux__
+  if (result.empty()) result.push_back(allowed);
+  return result;
+}
+
+}  // anonymous namespace
+
+bool ParsePolicy(const std::string& name, Policy* policy) {
+  if (name == "none") {
+    *policy = Policy::kNone;
+  } else if (name == "compact") {
+    *policy = Policy::kCompact;
+  } else if (name == "numa") {
+    *policy = Policy::kNuma;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Initialize(Policy policy) {
+  Mutex::ScopedLock lock(placements_mutex);
+  current_policy = Policy::kNone;
+  groups.clear();
+  if (policy == Policy::kNone) return;
+
+  int size = uv_cpumask_size();
+  if (size <= 0) return;  // Not supported on this platform.
+  std::vector<char> allowed(size);
+  uv_thread_t self = uv_thread_self();
+  if (uv_thread_getaffinity(&self, allowed.data(), allowed.size()) != 0)
+    return;
+
+  if (policy == Policy::kCompact) {
+    for (int i = 0; i < size; i++) {
+      if (!allowed[i]) continue;
+      std::vector<char> mask(size, 0);
+      mask[i] = 1;
+      groups.push_back(std::move(mask));
+    }
+  } else {
+    groups = NumaGroups(allowed);
+  }
+  if (groups.empty()) return;
+  current_policy = policy;
+
+  std::string threadpool;
+  for (const std::vector<char>& mask : groups) {
+    if (!threadpool.empty()) threadpool += ';';
+    threadpool += FormatCpuList(mask);
+  }
+  // An explicit UV_THREADPOOL_AFFINITY from the environment wins.
+  if (getenv("UV_THREADPOOL_AFFINITY") == nullptr)
+    uv_os_setenv("UV_THREADPOOL_AFFINITY", threadpool.c_str());
+}
+
+void PinCurrentThread(const char* kind, size_t index) {
+  Mutex::ScopedLock lock(placements_mutex);
+  if (current_policy == Policy::kNone) return;
+  std::vector<char>& mask = groups[index % groups.size()];
+  uv_thread_t self = uv_thread_self();
+  if (uv_thread_setaffinity(&self, mask.data(), nullptr, mask.size()) != 0)
+    return;
+  placements.push_back(Placement { kind, index, FormatCpuList(mask) });
+}
+
+void ForgetThread(const char* kind, size_t index) {
+  Mutex::ScopedLock lock(placements_mutex);
+  for (auto it = placements.begin(); it != placements.end(); ++it) {
+    if (it->kind == kind && it->index == index) {
+      placements.erase(it);
+      return;
+    }
+  }
+}
+
+const char* PolicyName() {
+  Mutex::ScopedLock lock(placements_mutex);
+  switch (current_policy) {
+    case Policy::kNone: return "none";
+    case Policy::kCompact: return "compact";
+    case Policy::kNuma: return "numa";
+  }
+  UNREACHABLE();
+}
+
+std::string ThreadpoolGroups() {
+  const char* groups = getenv("UV_THREADPOOL_AFFINITY");
+  return groups != nullptr ? groups : "";
+}
+
+std::vector<Placement> GetPlacements() {
+  Mutex::ScopedLock lock(placements_mutex);
+  return placements;
+}
+
+}  // namespace thread_affinity
+}  // namespace node
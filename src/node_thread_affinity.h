@@ -0,0 +1,49 @@
+#ifndef SRC_NODE_THREAD_AFFINITY_H_
+#define SRC_NODE_THREAD_AFFINITY_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <string>
+#include <vector>
+
+namespace node {
+namespace thread_affinity {
+
+// Opt-in CPU placement for the threads Node.js starts itself: platform
+// workers, libuv threadpool threads and Worker threads. Every policy splits
+// the CPUs the process may run on into groups, and thread N of a kind is
+// pinned to group N modulo the number of groups.
+enum class Policy {
+  kNone,     // Leave placement to the OS.
+  kCompact,  // One CPU per group.
+  kNuma,     // One group per NUMA node (Linux only; one group elsewhere).
+};
+
+bool ParsePolicy(const std::string& name, Policy* policy);
+
+// Computes the CPU groups for `policy` and passes them on to libuv through
+// UV_THREADPOOL_AFFINITY, unless that is already set. Must run before the
+// platform and the threadpool start their threads.
+void Initialize(Policy policy);
+
+// Pins the calling thread and records its placement for diagnostic reports.
+// Does nothing when no policy is active.
+void PinCurrentThread(const char* kind, size_t index);
+void ForgetThread(const char* kind, size_t index);
+
+struct Placement {
+  std::string kind;
+  size_t index;
+  std::string cpus;  // cpulist syntax, e.g. "0-3,8".
+};
+
+const char* PolicyName();
+std::string ThreadpoolGroups();
+std::vector<Placement> GetPlacements();
+
+}  // namespace thread_affinity
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_THREAD_AFFINITY_H_
@@ -3,13 +3,27 @@
 #include "node_errors.h"
 #include "node_external_reference.h"
 #include "node_i18n.h"
+#include "node_options.h"
 #include "util-inl.h"
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <list>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>  // SSE2, which is part of the x86-64 baseline.
+#define NODE_URL_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_URL_NEON 1
+#endif
+
 namespace node {
 
 using errors::TryCatchScope;
@@ -810,15 +824,252 @@ void ShortenUrlPath(struct url_data* url) {
   url->path.pop_back();
 }
 
-}  // anonymous namespace
+// Whether ParseSpecialFast() can handle the input at all, and whether it
+// needs to percent-encode anything.
+enum ScanResult : uint8_t {
+  kScanPlain = 0,
+  kScanNeedsEscape = 1,
+  kScanUnsupported = 2,
+};
 
-void URL::Parse(const char* input,
-                size_t len,
-                enum url_parse_state state_override,
-                struct url_data* url,
-                bool has_url,
-                const struct url_data* base,
-                bool has_base) {
+// Tabs, newlines, spaces and other controls, non-ASCII bytes, and the
+// backslash, which special URLs treat like a slash.
+inline bool IsUnsupportedInFastPath(unsigned char ch) {
+  return ch <= ' ' || ch >= 0x7f || ch == '\\';
+}
+
+// The printable ASCII characters in any of PATH_ENCODE_SET,
+// QUERY_ENCODE_SET_SPECIAL and FRAGMENT_ENCODE_SET, apart from '#' and '?',
+// which end those components instead.
+inline bool IsEscapedInFastPath(unsigned char ch) {
+  switch (ch) {
+    case '"': case '\'': case '<': case '>': case '`': case '{': case '}':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Classifies all of the input 16 bytes at a time.
+ScanResult ScanForFastPath(const char* input, size_t len) {
+  size_t i = 0;
+  bool needs_escape = false;
+#if defined(NODE_URL_SSE2)
+  const __m128i min_printable = _mm_set1_epi8(0x21);
+  __m128i escaped = _mm_setzero_si128();
+  for (; i + 16 <= len; i += 16) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    // Bytes of 0x80 and above are negative, so the signed comparison with
+    // 0x21 catches both them and the controls.
+    const __m128i unsupported = _mm_or_si128(
+        _mm_cmplt_epi8(block, min_printable),
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(0x7f)),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))));
+    if (_mm_movemask_epi8(unsupported) != 0)
+      return kScanUnsupported;
+    escaped = _mm_or_si128(escaped, _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8('\''))),
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('`')),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8('{')))));
+    escaped = _mm_or_si128(escaped, _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('<')),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8('>'))),
+        _mm_cmpeq_epi8(block, _mm_set1_epi8('}'))));
+  }
+  needs_escape = _mm_movemask_epi8(escaped) != 0;
+#elif defined(NODE_URL_NEON)
+  uint8x16_t escaped = vdupq_n_u8(0);
+  for (; i + 16 <= len; i += 16) {
+    const uint8x16_t block =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(input + i));
+    const uint8x16_t unsupported = vorrq_u8(
+        vorrq_u8(vcltq_u8(block, vdupq_n_u8(0x21)),
+                 vcgeq_u8(block, vdupq_n_u8(0x7f))),
+        vceqq_u8(block, vdupq_n_u8('\\')));
+    if (vmaxvq_u8(unsupported) != 0)
+      return kScanUnsupported;
+    escaped = vorrq_u8(escaped, vorrq_u8(
+        vorrq_u8(vceqq_u8(block, vdupq_n_u8('"')),
+                 vceqq_u8(block, vdupq_n_u8('\''))),
+        vorrq_u8(vceqq_u8(block, vdupq_n_u8('`')),
+                 vceqq_u8(block, vdupq_n_u8('{')))));
+    escaped = vorrq_u8(escaped, vorrq_u8(
+        vorrq_u8(vceqq_u8(block, vdupq_n_u8('<')),
+                 vceqq_u8(block, vdupq_n_u8('>'))),
+        vceqq_u8(block, vdupq_n_u8('}'))));
+  }
+  needs_escape = vmaxvq_u8(escaped) != 0;
+#endif
+  for (; i < len; i++) {
+    const unsigned char ch = input[i];
+    if (IsUnsupportedInFastPath(ch))
+      return kScanUnsupported;
+    needs_escape |= IsEscapedInFastPath(ch);
+  }
+  return needs_escape ? kScanNeedsEscape : kScanPlain;
+}
+
+void AppendComponent(std::string* str,
+                     const char* begin,
+                     const char* end,
+                     const uint8_t encode_set[],
+                     bool needs_escape) {
+  if (!needs_escape) {
+    str->append(begin, end);
+    return;
+  }
+  for (const char* ptr = begin; ptr < end; ptr++)
+    AppendOrEscape(str, *ptr, encode_set);
+}
+
+// Parses absolute URLs with a special scheme other than file: in one pass
+// over the input, for the common case of printable ASCII without
+// credentials, IPv6 hosts, dot segments or backslashes. The components are
+// first located as offsets into the input, and then copied out, usually
+// without percent-encoding anything. Returns false without modifying `url`
+// for all other inputs, which the state machine in URL::Parse() handles.
+bool ParseSpecialFast(const char* input, size_t len, struct url_data* url) {
+  if (len == 0 || !IsASCIIAlpha(input[0]))
+    return false;
+  const ScanResult scan = ScanForFastPath(input, len);
+  if (scan == kScanUnsupported)
+    return false;
+  const bool needs_escape = scan == kScanNeedsEscape;
+
+  size_t scheme_end = 1;
+  while (scheme_end < len && (IsASCIIAlphanumeric(input[scheme_end]) ||
+                              input[scheme_end] == '+' ||
+                              input[scheme_end] == '-' ||
+                              input[scheme_end] == '.')) {
+    scheme_end++;
+  }
+  // The scheme must be followed by exactly two slashes and a host.
+  const size_t host_begin = scheme_end + 3;
+  if (host_begin >= len ||
+      input[scheme_end] != ':' ||
+      input[scheme_end + 1] != '/' ||
+      input[scheme_end + 2] != '/' ||
+      input[host_begin] == '/') {
+    return false;
+  }
+  std::string scheme;
+  scheme.reserve(scheme_end + 1);
+  for (size_t i = 0; i < scheme_end; i++)
+    scheme += ASCIILowercase(input[i]);
+  scheme += ':';
+  if (!IsSpecial(scheme) || scheme == "file:")
+    return false;
+
+  const char* hash = static_cast<const char*>(
+      memchr(input + host_begin, '#', len - host_begin));
+  const size_t fragment_begin = hash != nullptr ? hash - input : len;
+  const char* question = static_cast<const char*>(
+      memchr(input + host_begin, '?', fragment_begin - host_begin));
+  const size_t query_begin =
+      question != nullptr ? question - input : fragment_begin;
+
+  size_t path_begin = host_begin;
+  size_t host_end = 0;
+  for (; path_begin < query_begin; path_begin++) {
+    const char ch = input[path_begin];
+    if (ch == '/')
+      break;
+    if (ch == '@' || ch == '[')
+      return false;
+    if (ch == ':' && host_end == 0)
+      host_end = path_begin;
+  }
+  const bool has_port = host_end != 0;
+  if (!has_port)
+    host_end = path_begin;
+  if (host_end == host_begin)
+    return false;
+
+  unsigned port = 0;
+  if (has_port) {
+    for (size_t i = host_end + 1; i < path_begin; i++) {
+      if (!IsASCIIDigit(input[i]))
+        return false;
+      port = port * 10 + input[i] - '0';
+      if (port > 0xffff)
+        return false;
+    }
+  }
+
+  std::string host;
+  if (!ParseHost(std::string(input + host_begin, host_end - host_begin),
+                 &host,
+                 true)) {
+    return false;
+  }
+
+  // Every slash that follows the authority starts a segment, and a URL
+  // without any still has a single empty one.
+  std::vector<std::string> path;
+  size_t segment_begin = path_begin < query_begin ? path_begin + 1 :
+                                                    path_begin;
+  while (true) {
+    const char* slash = static_cast<const char*>(
+        memchr(input + segment_begin, '/', query_begin - segment_begin));
+    const size_t segment_end = slash != nullptr ? slash - input : query_begin;
+    const size_t segment_len = segment_end - segment_begin;
+    if (segment_len > 0 && segment_len <= 6 &&
+        (input[segment_begin] == '.' || input[segment_begin] == '%')) {
+      const std::string segment(input + segment_begin, segment_len);
+      if (IsSingleDotSegment(segment) || IsDoubleDotSegment(segment))
+        return false;
+    }
+    path.emplace_back();
+    AppendComponent(&path.back(),
+                    input + segment_begin,
+                    input + segment_end,
+                    PATH_ENCODE_SET,
+                    needs_escape);
+    if (slash == nullptr)
+      break;
+    segment_begin = segment_end + 1;
+  }
+
+  url->scheme = std::move(scheme);
+  url->flags |= URL_FLAGS_SPECIAL | URL_FLAGS_HAS_HOST | URL_FLAGS_HAS_PATH;
+  url->host = std::move(host);
+  url->path = std::move(path);
+  url->port = -1;
+  if (has_port && path_begin > host_end + 1) {
+    url->port = NormalizePort(url->scheme, static_cast<int>(port));
+    if (url->port == -1)
+      url->flags |= URL_FLAGS_IS_DEFAULT_SCHEME_PORT;
+  }
+  if (question != nullptr) {
+    url->flags |= URL_FLAGS_HAS_QUERY;
+    url->query.clear();
+    AppendComponent(&url->query,
+                    input + query_begin + 1,
+                    input + fragment_begin,
+                    QUERY_ENCODE_SET_SPECIAL,
+                    needs_escape);
+  }
+  if (hash != nullptr) {
+    url->flags |= URL_FLAGS_HAS_FRAGMENT;
+    url->fragment.clear();
+    AppendComponent(&url->fragment,
+                    input + fragment_begin + 1,
+                    input + len,
+                    FRAGMENT_ENCODE_SET,
+                    needs_escape);
+  }
+  return true;
+}
+
+void ParseUncached(const char* input,
+                   size_t len,
+                   enum url_parse_state state_override,
+                   struct url_data* url,
+                   bool has_url,
+                   const struct url_data* base,
+                   bool has_base) {
   const char* p = input;
   const char* end = input + len;
 
@@ -837,6 +1088,9 @@ void URL::Parse(const char* input,
     }
     input = p;
     len = end - p;
+
+    if (state_override == kUnknownState && ParseSpecialFast(input, len, url))
+      return;
   }
 
   // The spec says we should strip out any ASCII tabs or newlines.
@@ -1544,6 +1798,117 @@ void URL::Parse(const char* input,
   }
 }  // NOLINT(readability/fn_size)
 
+// Remembers the results of parsing inputs without a state override, keyed
+// by the input and the base URL, for --url-parse-cache-size. The results do
+// not reference the isolate, but every thread, and so every isolate, keeps
+// its own cache so that no locking is needed.
+class ParseCache {
+ public:
+  // Longer inputs are parsed every time, to bound the memory per entry.
+  static constexpr size_t kMaxInputLength = 2048;
+
+  explicit ParseCache(size_t max_entries) : max_entries_(max_entries) {}
+
+  // Returns nullptr if the cache is off.
+  static ParseCache* GetForCurrentThread() {
+    thread_local std::unique_ptr<ParseCache> cache;
+    thread_local bool initialized = false;
+    if (!initialized) {
+      initialized = true;
+      const int64_t max_entries =
+          per_process::cli_options->url_parse_cache_size;
+      if (max_entries > 0)
+        cache = std::make_unique<ParseCache>(static_cast<size_t>(max_entries));
+    }
+    return cache.get();
+  }
+
+  bool Get(const std::string& key, struct url_data* url) {
+    auto it = index_.find(key);
+    if (it == index_.end())
+      return false;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    *url = it->second->url;
+    return true;
+  }
+
+  void Put(std::string&& key, const struct url_data& url) {
+    lru_.push_front({std::move(key), url});
+    index_[lru_.front().key] = lru_.begin();
+    if (lru_.size() > max_entries_) {
+      index_.erase(lru_.back().key);
+      lru_.pop_back();
+    }
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    struct url_data url;
+  };
+
+  const size_t max_entries_;
+  std::list<Entry> lru_;  // Most recently used first.
+  // The keys point into the entries in lru_.
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+};
+
+void AppendKeyField(std::string* key, const std::string& field) {
+  *key += std::to_string(field.size());
+  *key += ':';
+  *key += field;
+}
+
+// The input, followed by every field of the base URL, if there is one.
+std::string MakeParseCacheKey(const char* input,
+                              size_t len,
+                              const struct url_data* base,
+                              bool has_base) {
+  std::string key(input, len);
+  if (!has_base)
+    return key;
+  key += '\0';
+  key += std::to_string(base->flags);
+  key += ':';
+  key += std::to_string(base->port);
+  key += ':';
+  AppendKeyField(&key, base->scheme);
+  AppendKeyField(&key, base->username);
+  AppendKeyField(&key, base->password);
+  AppendKeyField(&key, base->host);
+  AppendKeyField(&key, base->query);
+  AppendKeyField(&key, base->fragment);
+  for (const std::string& segment : base->path)
+    AppendKeyField(&key, segment);
+  return key;
+}
+
+}  // anonymous namespace
+
+void URL::Parse(const char* input,
+                size_t len,
+                enum url_parse_state state_override,
+                struct url_data* url,
+                bool has_url,
+                const struct url_data* base,
+                bool has_base) {
+  ParseCache* cache = nullptr;
+  if (!has_url &&
+      state_override == kUnknownState &&
+      len <= ParseCache::kMaxInputLength) {
+    cache = ParseCache::GetForCurrentThread();
+  }
+  if (cache == nullptr)
+    return ParseUncached(input, len, state_override, url, has_url, base,
+                         has_base);
+
+  std::string key = MakeParseCacheKey(input, len, base, has_base);
+  if (cache->Get(key, url))
+    return;
+  ParseUncached(input, len, state_override, url, has_url, base, has_base);
+  cache->Put(std::move(key), *url);
+}
+
 // https://url.spec.whatwg.org/#url-serializing
 std::string URL::SerializeURL(const struct url_data* url,
                               bool exclude = false) {
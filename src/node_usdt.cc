@@ -0,0 +1,47 @@
+#include "node_usdt.h"
+#include "env-inl.h"
+
+namespace node {
+
+#ifdef NODE_HAVE_USDT
+
+// The tracer looks for the semaphores in the .probes section.
+extern "C" {
+#define V(name)                                                               \
+  __attribute__((section(".probes")))                                         \
+  volatile uint16_t node_usdt_##name##_semaphore = 0;
+NODE_USDT_PROBES(V)
+#undef V
+}
+
+static void OnGCPrologue(v8::Isolate* isolate,
+                         v8::GCType type,
+                         v8::GCCallbackFlags flags,
+                         void* data) {
+  NODE_USDT_PROBE2(gc__phase__start, type, flags);
+}
+
+static void OnGCEpilogue(v8::Isolate* isolate,
+                         v8::GCType type,
+                         v8::GCCallbackFlags flags,
+                         void* data) {
+  NODE_USDT_PROBE2(gc__phase__done, type, flags);
+}
+
+void InitUSDT(Environment* env) {
+  env->isolate()->AddGCPrologueCallback(OnGCPrologue, env);
+  env->isolate()->AddGCEpilogueCallback(OnGCEpilogue, env);
+  env->AddCleanupHook([](void* data) {
+    Environment* env = static_cast<Environment*>(data);
+    env->isolate()->RemoveGCPrologueCallback(OnGCPrologue, env);
+    env->isolate()->RemoveGCEpilogueCallback(OnGCEpilogue, env);
+  }, env);
+}
+
+#else  // !NODE_HAVE_USDT
+
+void InitUSDT(Environment* env) {}
+
+#endif  // NODE_HAVE_USDT
+
+}  // namespace node
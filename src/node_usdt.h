@@ -0,0 +1,129 @@
+#ifndef SRC_NODE_USDT_H_
+#define SRC_NODE_USDT_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstdint>
+
+// Statically defined tracing probes for the hot paths, in the format of
+// SystemTap's <sys/sdt.h>, which bpftrace, bcc and perf read from the ELF
+// notes of stock binaries, e.g.:
+//
+//   bpftrace -e 'usdt:./node:node:fs__done { @[arg1] = count(); }'
+//
+// Unlike the probes of node_provider.d, they do not need --with-dtrace or
+// the dtrace tool at build time. A probe site is a single nop behind a test
+// of the probe's semaphore, which the tracer increments while attached, so
+// the arguments are not even computed when nobody listens. Every argument
+// is passed as a 64-bit integer; strings are passed as pointers.
+//
+// Probe (arguments):
+#define NODE_USDT_PROBES(V)                                                   \
+  V(net__connect)                      /* (tcp_wrap, ip)                   */ \
+  V(net__accept)                       /* (server_wrap, client_wrap)       */ \
+  V(stream__read)                      /* (stream, nread)                  */ \
+  V(stream__write)                     /* (stream, bytes)                  */ \
+  V(http__parser__message__begin)      /* (parser)                         */ \
+  V(http__parser__message__complete)   /* (parser)                         */ \
+  V(fs__start)                         /* (req, syscall)                   */ \
+  V(fs__done)                          /* (req, uv_fs_type, result)        */ \
+  V(threadpool__queue)                 /* (work)                           */ \
+  V(threadpool__start)                 /* (work)                           */ \
+  V(threadpool__done)                  /* (work, status)                   */ \
+  V(gc__phase__start)                  /* (v8::GCType, flags)              */ \
+  V(gc__phase__done)                   /* (v8::GCType, flags)              */
+
+#if !defined(NODE_DISABLE_USDT) && defined(__linux__) &&                      \
+    (defined(__x86_64__) || defined(__aarch64__)) && defined(__GNUC__)
+#define NODE_HAVE_USDT 1
+#endif
+
+#ifdef NODE_HAVE_USDT
+
+extern "C" {
+#define V(name) extern volatile uint16_t node_usdt_##name##_semaphore;
+NODE_USDT_PROBES(V)
+#undef V
+}
+
+#define NODE_USDT_ENABLED(name)                                               \
+  (__builtin_expect(node_usdt_##name##_semaphore != 0, 0))
+
+// The probe's note, as <sys/sdt.h> lays it out for 64-bit targets.
+#define NODE_USDT_ASM(name, args)                                             \
+  "990: nop\n"                                                                \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                               \
+  ".balign 4\n"                                                               \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                          \
+  "991: .asciz \"stapsdt\"\n"                                                 \
+  "992: .balign 4\n"                                                          \
+  "993: .8byte 990b\n"                                                        \
+  ".8byte _.stapsdt.base\n"                                                   \
+  ".8byte node_usdt_" #name "_semaphore\n"                                    \
+  ".asciz \"node\"\n"                                                         \
+  ".asciz \"" #name "\"\n"                                                    \
+  ".asciz \"" args "\"\n"                                                     \
+  "994: .balign 4\n"                                                          \
+  ".popsection\n"                                                             \
+  ".ifndef _.stapsdt.base\n"                                                  \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"     \
+  ".weak _.stapsdt.base\n"                                                    \
+  ".hidden _.stapsdt.base\n"                                                  \
+  "_.stapsdt.base: .space 1\n"                                                \
+  ".size _.stapsdt.base, 1\n"                                                 \
+  ".popsection\n"                                                             \
+  ".endif\n"
+
+#define NODE_USDT_ARG(x) "nor" (static_cast<uint64_t>(x))
+
+#define NODE_USDT_PROBE1(name, a1)                                            \
+  do {                                                                        \
+    if (NODE_USDT_ENABLED(name)) {                                            \
+      __asm__ __volatile__(NODE_USDT_ASM(name, "8@%[u1]")                     \
+                           :: [u1] NODE_USDT_ARG(a1));                        \
+    }                                                                         \
+  } while (0)
+
+#define NODE_USDT_PROBE2(name, a1, a2)                                        \
+  do {                                                                        \
+    if (NODE_USDT_ENABLED(name)) {                                            \
+      __asm__ __volatile__(NODE_USDT_ASM(name, "8@%[u1] 8@%[u2]")             \
+                           :: [u1] NODE_USDT_ARG(a1),                         \
+                              [u2] NODE_USDT_ARG(a2));                        \
+    }                                                                         \
+  } while (0)
+
+#define NODE_USDT_PROBE3(name, a1, a2, a3)                                    \
+  do {                                                                        \
+    if (NODE_USDT_ENABLED(name)) {                                            \
+      __asm__ __volatile__(NODE_USDT_ASM(name, "8@%[u1] 8@%[u2] 8@%[u3]")     \
+                           :: [u1] NODE_USDT_ARG(a1),                         \
+                              [u2] NODE_USDT_ARG(a2),                         \
+                              [u3] NODE_USDT_ARG(a3));                        \
+    }                                                                         \
+  } while (0)
+
+#define NODE_USDT_PTR(p) reinterpret_cast<uintptr_t>(p)
+
+#else  // !NODE_HAVE_USDT
+
+#define NODE_USDT_ENABLED(name) false
+#define NODE_USDT_PROBE1(name, a1) do {} while (0)
+#define NODE_USDT_PROBE2(name, a1, a2) do {} while (0)
+#define NODE_USDT_PROBE3(name, a1, a2, a3) do {} while (0)
+#define NODE_USDT_PTR(p) 0
+
+#endif  // NODE_HAVE_USDT
+
+namespace node {
+
+class Environment;
+
+// Fires the GC probes from GC callbacks of `env`'s isolate.
+void InitUSDT(Environment* env);
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_NODE_USDT_H_
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "env-inl.h"
+#include "large_pages/node_huge_pages.h"
 #include "node.h"
 #include "node_metadata.h"
 #include "node_platform.h"
@@ -100,7 +101,9 @@ struct V8Platform {
       StartTracingAgent();
     }
     // Tracing must be initialized before platform threads are created.
-    platform_ = new NodePlatform(thread_pool_size, controller);
+    platform_ = new NodePlatform(thread_pool_size,
+                                 controller,
+                                 huge_pages::GetPageAllocator());
     v8::V8::InitializePlatform(platform_);
   }
 
@@ -135,7 +138,11 @@ struct V8Platform {
                                 std::make_move_iterator(categories.end())),
           std::unique_ptr<tracing::AsyncTraceWriter>(
               new tracing::NodeTraceWriter(
-                  per_process::cli_options->trace_event_file_pattern)),
+                  per_process::cli_options->trace_event_file_pattern,
+                  per_process::cli_options->trace_event_format == "proto"
+                      ? tracing::NodeTraceWriter::kProto
+                      : tracing::NodeTraceWriter::kJSON,
+                  per_process::cli_options->trace_event_gzip)),
           tracing::Agent::kUseDefaultCategories);
     }
   }
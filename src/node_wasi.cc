@@ -13,6 +13,12 @@
 namespace node {
 namespace wasi {
 
+// The guest's iovecs point into its memory, which is read from and written
+// to directly; only the iovec arrays themselves are translated, on the stack
+// for the vectors that programs commonly pass.
+template <typename T>
+using IovecBuffer = MaybeStackBuffer<T, 16>;
+
 template <typename... Args>
 inline void Debug(WASI* wasi, Args&&... args) {
   Debug(wasi->env(), DebugCategory::WASI, std::forward<Args>(args)...);
@@ -72,6 +78,17 @@ inline void Debug(WASI* wasi, Args&&... args) {
     }                                                                         \
   } while (0)
 
+// Unlike a CHECK_BOUNDS_OR_RETURN() of count * size, this does not let the
+// guest overflow the multiplication.
+#define CHECK_ARRAY_BOUNDS_OR_RETURN(args, mem_size, offset, size, count)     \
+  do {                                                                        \
+    if (!uvwasi_serdes_check_array_bounds(                                    \
+            (offset), (mem_size), (size), (count))) {                         \
+      (args).GetReturnValue().Set(UVWASI_EOVERFLOW);                          \
+      return;                                                                 \
+    }                                                                         \
+  } while (0)
+
 
 using v8::Array;
 using v8::ArrayBuffer;
@@ -665,18 +682,19 @@ void WASI::FdPread(const FunctionCallbackInfo<Value>& args) {
         offset,
         nread_ptr);
   GET_BACKING_STORE_OR_RETURN(wasi, args, &memory, &mem_size);
-  CHECK_BOUNDS_OR_RETURN(args,
-                         mem_size,
-                         iovs_ptr,
-                         iovs_len * UVWASI_SERDES_SIZE_iovec_t);
+  CHECK_ARRAY_BOUNDS_OR_RETURN(args,
+                               mem_size,
+                               iovs_ptr,
+                               UVWASI_SERDES_SIZE_iovec_t,
+                               iovs_len);
   CHECK_BOUNDS_OR_RETURN(args, mem_size, nread_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_iovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_iovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_iovec_t(memory,
                                     mem_size,
                                     iovs_ptr,
-                                    iovs.data(),
+                                    iovs.out(),
                                     iovs_len);
   if (err != UVWASI_ESUCCESS) {
     args.GetReturnValue().Set(err);
@@ -684,7 +702,7 @@ void WASI::FdPread(const FunctionCallbackInfo<Value>& args) {
   }
 
   uvwasi_size_t nread;
-  err = uvwasi_fd_pread(&wasi->uvw_, fd, iovs.data(), iovs_len, offset, &nread);
+  err = uvwasi_fd_pread(&wasi->uvw_, fd, iovs.out(), iovs_len, offset, &nread);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory, nread_ptr, nread);
 
@@ -762,21 +780,22 @@ void WASI::FdPwrite(const FunctionCallbackInfo<Value>& args) {
         offset,
         nwritten_ptr);
   GET_BACKING_STORE_OR_RETURN(wasi, args, &memory, &mem_size);
-  CHECK_BOUNDS_OR_RETURN(args,
-                         mem_size,
-                         iovs_ptr,
-                         iovs_len * UVWASI_SERDES_SIZE_ciovec_t);
+  CHECK_ARRAY_BOUNDS_OR_RETURN(args,
+                               mem_size,
+                               iovs_ptr,
+                               UVWASI_SERDES_SIZE_ciovec_t,
+                               iovs_len);
   CHECK_BOUNDS_OR_RETURN(args,
                          mem_size,
                          nwritten_ptr,
                          UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_ciovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_ciovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_ciovec_t(memory,
                                      mem_size,
                                      iovs_ptr,
-                                     iovs.data(),
+                                     iovs.out(),
                                      iovs_len);
   if (err != UVWASI_ESUCCESS) {
     args.GetReturnValue().Set(err);
@@ -786,7 +805,7 @@ void WASI::FdPwrite(const FunctionCallbackInfo<Value>& args) {
   uvwasi_size_t nwritten;
   err = uvwasi_fd_pwrite(&wasi->uvw_,
                          fd,
-                         iovs.data(),
+                         iovs.out(),
                          iovs_len,
                          offset,
                          &nwritten);
@@ -813,18 +832,19 @@ void WASI::FdRead(const FunctionCallbackInfo<Value>& args) {
   ASSIGN_INITIALIZED_OR_RETURN_UNWRAP(&wasi, args.This());
   Debug(wasi, "fd_read(%d, %d, %d, %d)\n", fd, iovs_ptr, iovs_len, nread_ptr);
   GET_BACKING_STORE_OR_RETURN(wasi, args, &memory, &mem_size);
-  CHECK_BOUNDS_OR_RETURN(args,
-                         mem_size,
-                         iovs_ptr,
-                         iovs_len * UVWASI_SERDES_SIZE_iovec_t);
+  CHECK_ARRAY_BOUNDS_OR_RETURN(args,
+                               mem_size,
+                               iovs_ptr,
+                               UVWASI_SERDES_SIZE_iovec_t,
+                               iovs_len);
   CHECK_BOUNDS_OR_RETURN(args, mem_size, nread_ptr, UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_iovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_iovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_iovec_t(memory,
                                     mem_size,
                                     iovs_ptr,
-                                    iovs.data(),
+                                    iovs.out(),
                                     iovs_len);
   if (err != UVWASI_ESUCCESS) {
     args.GetReturnValue().Set(err);
@@ -832,7 +852,7 @@ void WASI::FdRead(const FunctionCallbackInfo<Value>& args) {
   }
 
   uvwasi_size_t nread;
-  err = uvwasi_fd_read(&wasi->uvw_, fd, iovs.data(), iovs_len, &nread);
+  err = uvwasi_fd_read(&wasi->uvw_, fd, iovs.out(), iovs_len, &nread);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory, nread_ptr, nread);
 
@@ -989,21 +1009,22 @@ void WASI::FdWrite(const FunctionCallbackInfo<Value>& args) {
         iovs_len,
         nwritten_ptr);
   GET_BACKING_STORE_OR_RETURN(wasi, args, &memory, &mem_size);
-  CHECK_BOUNDS_OR_RETURN(args,
-                         mem_size,
-                         iovs_ptr,
-                         iovs_len * UVWASI_SERDES_SIZE_ciovec_t);
+  CHECK_ARRAY_BOUNDS_OR_RETURN(args,
+                               mem_size,
+                               iovs_ptr,
+                               UVWASI_SERDES_SIZE_ciovec_t,
+                               iovs_len);
   CHECK_BOUNDS_OR_RETURN(args,
                          mem_size,
                          nwritten_ptr,
                          UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_ciovec_t> iovs(iovs_len);
+  IovecBuffer<uvwasi_ciovec_t> iovs(iovs_len);
   uvwasi_errno_t err;
 
   err = uvwasi_serdes_readv_ciovec_t(memory,
                                      mem_size,
                                      iovs_ptr,
-                                     iovs.data(),
+                                     iovs.out(),
                                      iovs_len);
   if (err != UVWASI_ESUCCESS) {
     args.GetReturnValue().Set(err);
@@ -1011,7 +1032,7 @@ void WASI::FdWrite(const FunctionCallbackInfo<Value>& args) {
   }
 
   uvwasi_size_t nwritten;
-  err = uvwasi_fd_write(&wasi->uvw_, fd, iovs.data(), iovs_len, &nwritten);
+  err = uvwasi_fd_write(&wasi->uvw_, fd, iovs.out(), iovs_len, &nwritten);
   if (err == UVWASI_ESUCCESS)
     uvwasi_serdes_write_size_t(memory, nwritten_ptr, nwritten);
 
@@ -1536,17 +1557,18 @@ void WASI::SockRecv(const FunctionCallbackInfo<Value>& args) {
         ro_datalen_ptr,
         ro_flags_ptr);
   GET_BACKING_STORE_OR_RETURN(wasi, args, &memory, &mem_size);
-  CHECK_BOUNDS_OR_RETURN(args,
-                         mem_size,
-                         ri_data_ptr,
-                         ri_data_len * UVWASI_SERDES_SIZE_iovec_t);
+  CHECK_ARRAY_BOUNDS_OR_RETURN(args,
+                               mem_size,
+                               ri_data_ptr,
+                               UVWASI_SERDES_SIZE_iovec_t,
+                               ri_data_len);
   CHECK_BOUNDS_OR_RETURN(args, mem_size, ro_datalen_ptr, 4);
   CHECK_BOUNDS_OR_RETURN(args, mem_size, ro_flags_ptr, 4);
-  std::vector<uvwasi_iovec_t> ri_data(ri_data_len);
+  IovecBuffer<uvwasi_iovec_t> ri_data(ri_data_len);
   uvwasi_errno_t err = uvwasi_serdes_readv_iovec_t(memory,
                                                    mem_size,
                                                    ri_data_ptr,
-                                                   ri_data.data(),
+                                                   ri_data.out(),
                                                    ri_data_len);
   if (err != UVWASI_ESUCCESS) {
     args.GetReturnValue().Set(err);
@@ -1557,7 +1579,7 @@ void WASI::SockRecv(const FunctionCallbackInfo<Value>& args) {
   uvwasi_roflags_t ro_flags;
   err = uvwasi_sock_recv(&wasi->uvw_,
                          sock,
-                         ri_data.data(),
+                         ri_data.out(),
                          ri_data_len,
                          ri_flags,
                          &ro_datalen,
@@ -1595,19 +1617,20 @@ void WASI::SockSend(const FunctionCallbackInfo<Value>& args) {
         si_flags,
         so_datalen_ptr);
   GET_BACKING_STORE_OR_RETURN(wasi, args, &memory, &mem_size);
-  CHECK_BOUNDS_OR_RETURN(args,
-                         mem_size,
-                         si_data_ptr,
-                         si_data_len * UVWASI_SERDES_SIZE_ciovec_t);
+  CHECK_ARRAY_BOUNDS_OR_RETURN(args,
+                               mem_size,
+                               si_data_ptr,
+                               UVWASI_SERDES_SIZE_ciovec_t,
+                               si_data_len);
   CHECK_BOUNDS_OR_RETURN(args,
                          mem_size,
                          so_datalen_ptr,
                          UVWASI_SERDES_SIZE_size_t);
-  std::vector<uvwasi_ciovec_t> si_data(si_data_len);
+  IovecBuffer<uvwasi_ciovec_t> si_data(si_data_len);
   uvwasi_errno_t err = uvwasi_serdes_readv_ciovec_t(memory,
                                                     mem_size,
                                                     si_data_ptr,
-                                                    si_data.data(),
+                                                    si_data.out(),
                                                     si_data_len);
   if (err != UVWASI_ESUCCESS) {
     args.GetReturnValue().Set(err);
@@ -1617,7 +1640,7 @@ void WASI::SockSend(const FunctionCallbackInfo<Value>& args) {
   uvwasi_size_t so_datalen;
   err = uvwasi_sock_send(&wasi->uvw_,
                          sock,
-                         si_data.data(),
+                         si_data.out(),
                          si_data_len,
                          si_flags,
                          &so_datalen);
@@ -4,12 +4,15 @@
 #include "memory_tracker-inl.h"
 #include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_main_instance.h"
 #include "node_buffer.h"
 #include "node_options-inl.h"
 #include "node_perf.h"
+#include "node_thread_affinity.h"
 #include "util-inl.h"
 #include "async_wrap-inl.h"
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -18,12 +21,15 @@ using node::kAllowedInEnvironment;
 using node::kDisallowedInEnvironment;
 using v8::Array;
 using v8::ArrayBuffer;
+using v8::BackingStore;
 using v8::Boolean;
 using v8::Context;
 using v8::Float64Array;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
+using v8::HeapSpaceStatistics;
+using v8::HeapStatistics;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
@@ -35,6 +41,7 @@ using v8::Number;
 using v8::Object;
 using v8::ResourceConstraints;
 using v8::SealHandleScope;
+using v8::SharedArrayBuffer;
 using v8::String;
 using v8::TryCatch;
 using v8::Value;
@@ -81,6 +88,13 @@ Worker::Worker(Environment* env,
   inspector_parent_handle_ = GetInspectorParentHandle(
       env, thread_id_, url.c_str());
 
+  static_assert(sizeof(std::atomic<double>) == sizeof(double),
+                "loop metrics must be readable as a Float64Array");
+  loop_metrics_store_ = SharedArrayBuffer::NewBackingStore(
+      env->isolate(), kLoopMetricsFieldCount * sizeof(double));
+  loop_metrics_ = new (loop_metrics_store_->Data())
+      std::atomic<double>[kLoopMetricsFieldCount]();
+
   argv_ = std::vector<std::string>{env->argv()[0]};
   // Mark this Worker object as weak until we actually start the thread.
   MakeWeak();
@@ -123,6 +137,38 @@ void Worker::UpdateResourceConstraints(ResourceConstraints* constraints) {
   }
 }
 
+namespace {
+
+// Disposes of an isolate that was registered with `platform` for `loop`.
+void DisposeIsolate(MultiIsolatePlatform* platform,
+                    Isolate* isolate,
+                    uv_loop_t* loop) {
+  bool platform_finished = false;
+
+  platform->AddIsolateFinishedCallback(isolate, [](void* data) {
+    *static_cast<bool*>(data) = true;
+  }, &platform_finished);
+
+  // The order of these calls is important; if the Isolate is first disposed
+  // and then unregistered, there is a race condition window in which no
+  // new Isolate at the same address can successfully be registered with
+  // the platform.
+  // (Refs: https://github.com/nodejs/node/issues/30846)
+  platform->UnregisterIsolate(isolate);
+  isolate->Dispose();
+
+  // Wait until the platform has cleaned up all relevant resources.
+  while (!platform_finished) {
+    uv_run(loop, UV_RUN_ONCE);
+  }
+}
+
+// The pool of the main thread's Environment, if there is one. Only the main
+// thread accesses this.
+IsolatePool* isolate_pool = nullptr;
+
+}  // anonymous namespace
+
 // This class contains data that is only relevant to the child thread itself,
 // and only while it is running.
 // (Eventually, the Environment instance should probably also be moved here.)
@@ -130,6 +176,11 @@ class WorkerThreadData {
  public:
   explicit WorkerThreadData(Worker* w)
     : w_(w) {
+    if (w->pooled_isolate_) {
+      AdoptPooledIsolate();
+      return;
+    }
+
     int ret = uv_loop_init(&loop_);
     if (ret != 0) {
       char err_buf[128];
@@ -144,6 +195,7 @@ class WorkerThreadData {
         ArrayBufferAllocator::Create();
     Isolate::CreateParams params;
     SetIsolateCreateParamsForNode(&params);
+    NodeMainInstance::UseMainSnapshot(&params);
     params.array_buffer_allocator_shared = allocator;
 
     w->UpdateResourceConstraints(&params.constraints);
@@ -176,11 +228,7 @@ class WorkerThreadData {
                                             w_->platform_,
                                             allocator.get()));
       CHECK(isolate_data_);
-      if (w_->per_isolate_opts_)
-        isolate_data_->set_options(std::move(w_->per_isolate_opts_));
-      isolate_data_->set_worker_context(w_);
-      isolate_data_->max_young_gen_size =
-          params.constraints.max_young_generation_size_in_bytes();
+      SetUpIsolateData(params);
     }
 
     Mutex::ScopedLock lock(w_->mutex_);
@@ -198,28 +246,19 @@ class WorkerThreadData {
 
     if (isolate != nullptr) {
       CHECK(!loop_init_failed_);
-      bool platform_finished = false;
-
-      isolate_data_.reset();
-
-      w_->platform_->AddIsolateFinishedCallback(isolate, [](void* data) {
-        *static_cast<bool*>(data) = true;
-      }, &platform_finished);
-
-      // The order of these calls is important; if the Isolate is first disposed
-      // and then unregistered, there is a race condition window in which no
-      // new Isolate at the same address can successfully be registered with
-      // the platform.
-      // (Refs: https://github.com/nodejs/node/issues/30846)
-      w_->platform_->UnregisterIsolate(isolate);
-      isolate->Dispose();
-
-      // Wait until the platform has cleaned up all relevant resources.
-      while (!platform_finished) {
-        uv_run(&loop_, UV_RUN_ONCE);
+      if (!context_.IsEmpty()) {
+        // The Worker stopped before it used the pooled context.
+        Locker locker(isolate);
+        Isolate::Scope isolate_scope(isolate);
+        context_.Reset();
       }
+      isolate_data_.reset();
+      DisposeIsolate(w_->platform_, isolate, loop());
     }
-    if (!loop_init_failed_) {
+    if (pooled_) {
+      // The loop is closed along with the rest of the pooled isolate.
+      pooled_->isolate = nullptr;
+    } else if (!loop_init_failed_) {
       CheckedUvLoopClose(&loop_);
     }
   }
@@ -227,14 +266,249 @@ class WorkerThreadData {
   bool loop_is_usable() const { return !loop_init_failed_; }
 
  private:
+  // Takes over an isolate that the IsolatePool set up on another thread.
+  void AdoptPooledIsolate() {
+    pooled_ = std::move(w_->pooled_isolate_);
+    loop_init_failed_ = false;
+    Isolate* isolate = pooled_->isolate;
+
+    // The pool uses the default constraints, which are reported like this.
+    Isolate::CreateParams params;
+    SetIsolateCreateParamsForNode(&params);
+    w_->UpdateResourceConstraints(&params.constraints);
+
+    {
+      Locker locker(isolate);
+      Isolate::Scope isolate_scope(isolate);
+      isolate->SetStackLimit(w_->stack_base_);
+      isolate->AddNearHeapLimitCallback(Worker::NearHeapLimit, w_);
+
+      HandleScope handle_scope(isolate);
+      isolate_data_ = std::move(pooled_->isolate_data);
+      SetUpIsolateData(params);
+      context_ = std::move(pooled_->context);
+    }
+
+    Mutex::ScopedLock lock(w_->mutex_);
+    w_->isolate_ = isolate;
+  }
+
+  void SetUpIsolateData(const Isolate::CreateParams& params) {
+    if (w_->per_isolate_opts_)
+      isolate_data_->set_options(std::move(w_->per_isolate_opts_));
+    isolate_data_->set_worker_context(w_);
+    isolate_data_->max_young_gen_size =
+        params.constraints.max_young_generation_size_in_bytes();
+  }
+
+  uv_loop_t* loop() { return pooled_ ? &pooled_->loop : &loop_; }
+
   Worker* const w_;
   uv_loop_t loop_;
   bool loop_init_failed_ = true;
   DeleteFnPtr<IsolateData, FreeIsolateData> isolate_data_;
+  std::unique_ptr<PooledIsolate> pooled_;
+  // A context that was created ahead of time, if any.
+  v8::Global<Context> context_;
 
   friend class Worker;
 };
 
+PooledIsolate::~PooledIsolate() {
+  if (isolate != nullptr) {
+    {
+      Locker locker(isolate);
+      Isolate::Scope isolate_scope(isolate);
+      context.Reset();
+    }
+    isolate_data.reset();
+    DisposeIsolate(platform, isolate, &loop);
+  }
+  if (loop_initialized)
+    CheckedUvLoopClose(&loop);
+}
+
+bool PooledIsolate::Initialize(uintptr_t stack_limit) {
+  if (uv_loop_init(&loop) != 0)
+    return false;
+  loop_initialized = true;
+  uv_loop_configure(&loop, UV_METRICS_IDLE_TIME);
+
+  std::shared_ptr<ArrayBufferAllocator> allocator =
+      ArrayBufferAllocator::Create();
+  Isolate::CreateParams params;
+  SetIsolateCreateParamsForNode(&params);
+  NodeMainInstance::UseMainSnapshot(&params);
+  params.array_buffer_allocator_shared = allocator;
+  params.constraints.set_stack_limit(reinterpret_cast<uint32_t*>(stack_limit));
+
+  isolate = Isolate::Allocate();
+  if (isolate == nullptr)
+    return false;
+  platform->RegisterIsolate(isolate, &loop);
+  Isolate::Initialize(isolate, params);
+  SetIsolateUpForNode(isolate);
+
+  Locker locker(isolate);
+  Isolate::Scope isolate_scope(isolate);
+  isolate->SetStackLimit(stack_limit);
+  HandleScope handle_scope(isolate);
+  isolate_data.reset(
+      CreateIsolateData(isolate, &loop, platform, allocator.get()));
+  CHECK(isolate_data);
+  Local<Context> new_context = NewContext(isolate);
+  if (new_context.IsEmpty())
+    return false;
+  context.Reset(isolate, new_context);
+  return true;
+}
+
+IsolatePool::IsolatePool(Environment* env, size_t size)
+    : env_(env),
+      platform_(env->isolate_data()->platform()),
+      size_(size) {
+  uv_thread_options_t thread_options;
+  thread_options.flags = UV_THREAD_HAS_STACK_SIZE;
+  thread_options.stack_size = kStackSize;
+  uv_thread_t* tid = &thread_.emplace();
+  int ret = uv_thread_create_ex(tid, &thread_options, [](void* arg) {
+    const uintptr_t stack_top = reinterpret_cast<uintptr_t>(&arg);
+    static_cast<IsolatePool*>(arg)->Fill(
+        stack_top - (kStackSize - kStackBufferSize));
+  }, static_cast<void*>(this));
+  // Without the thread, there are no isolates to take.
+  if (ret != 0)
+    thread_.reset();
+}
+
+IsolatePool::~IsolatePool() {
+  {
+    Mutex::ScopedLock lock(mutex_);
+    stopping_ = true;
+    wakeup_.Signal(lock);
+  }
+  if (thread_.has_value())
+    CHECK_EQ(uv_thread_join(&thread_.value()), 0);
+  isolates_.clear();
+}
+
+std::unique_ptr<PooledIsolate> IsolatePool::Take() {
+  Mutex::ScopedLock lock(mutex_);
+  if (isolates_.empty())
+    return {};
+  std::unique_ptr<PooledIsolate> result = std::move(isolates_.front());
+  isolates_.pop_front();
+  wakeup_.Signal(lock);
+  return result;
+}
+
+void IsolatePool::Fill(uintptr_t stack_limit) {
+  for (;;) {
+    {
+      Mutex::ScopedLock lock(mutex_);
+      while (!stopping_ && isolates_.size() >= size_)
+        wakeup_.Wait(lock);
+      if (stopping_)
+        return;
+    }
+    auto isolate = std::make_unique<PooledIsolate>(platform_);
+    // If this fails once, it is likely to fail again, so stop trying and
+    // let Workers create their own isolates.
+    if (!isolate->Initialize(stack_limit))
+      return;
+    Mutex::ScopedLock lock(mutex_);
+    isolates_.push_back(std::move(isolate));
+  }
+}
+
+ResourceGovernor* ResourceGovernor::Get() {
+  static ResourceGovernor governor;
+  return &governor;
+}
+
+void ResourceGovernor::SetLimits(double memory, double cpu) {
+  Mutex::ScopedLock lock(mutex_);
+  memory_limit_ = memory;
+  cpu_limit_ = cpu;
+}
+
+ResourceGovernor::Decision ResourceGovernor::Report(const Worker* worker,
+                                                    double memory,
+                                                    double cpu) {
+  // Below the limit, but close enough to it that V8 should start to favour
+  // a small heap over throughput.
+  constexpr double kModerateMemoryFraction = 0.8;
+
+  Mutex::ScopedLock lock(mutex_);
+  Usage* usage = &usage_[worker];
+  total_memory_ += memory - usage->memory;
+  total_cpu_ += cpu - usage->cpu;
+  usage->memory = memory;
+  usage->cpu = cpu;
+
+  Decision decision;
+  if (memory_limit_ > 0) {
+    if (total_memory_ >= memory_limit_) {
+      decision.memory_pressure = v8::MemoryPressureLevel::kCritical;
+    } else if (total_memory_ >= kModerateMemoryFraction * memory_limit_) {
+      decision.memory_pressure = v8::MemoryPressureLevel::kModerate;
+    }
+  }
+  if (cpu_limit_ > 0 && total_cpu_ > cpu_limit_) {
+    // Pausing for this fraction of the interval brings the Worker down to
+    // its share, as long as it keeps busy.
+    double share = cpu_limit_ / usage_.size();
+    if (cpu > share) {
+      decision.pause_ms =
+          static_cast<uint64_t>(kIntervalMs * (1 - share / cpu));
+    }
+  }
+  return decision;
+}
+
+void ResourceGovernor::Remove(const Worker* worker) {
+  Mutex::ScopedLock lock(mutex_);
+  auto it = usage_.find(worker);
+  if (it == usage_.end()) return;
+  total_memory_ -= it->second.memory;
+  total_cpu_ -= it->second.cpu;
+  usage_.erase(it);
+  // Do not let rounding errors add up.
+  if (usage_.empty()) total_memory_ = total_cpu_ = 0;
+}
+
+void ResourceGovernor::GetUsage(double* memory, double* cpu, size_t* workers) {
+  Mutex::ScopedLock lock(mutex_);
+  *memory = total_memory_;
+  *cpu = total_cpu_;
+  *workers = usage_.size();
+}
+
+namespace {
+
+// In nanoseconds, or 0 where the platform does not tell.
+uint64_t GetThreadCpuTime() {
+#ifdef __POSIX__
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#elif defined(_WIN32)
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    return 0;
+  ULARGE_INTEGER k, u;
+  k.LowPart = kernel.dwLowDateTime;
+  k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;
+  u.HighPart = user.dwHighDateTime;
+  return (k.QuadPart + u.QuadPart) * 100;
+#else
+  return 0;
+#endif
+}
+
+}  // anonymous namespace
+
 size_t Worker::NearHeapLimit(void* data, size_t current_heap_limit,
                              size_t initial_heap_limit) {
   Worker* worker = static_cast<Worker*>(data);
@@ -294,7 +568,12 @@ void Worker::Run() {
         // resource constraints, we need something in place to handle it,
         // though.
         TryCatch try_catch(isolate_);
-        context = NewContext(isolate_);
+        if (!data.context_.IsEmpty()) {
+          context = data.context_.Get(isolate_);
+          data.context_.Reset();
+        } else {
+          context = NewContext(isolate_);
+        }
         if (context.IsEmpty()) {
           Exit(1, "ERR_WORKER_INIT_FAILED", "Failed to create new Context");
           return;
@@ -341,7 +620,9 @@ void Worker::Run() {
     }
 
     {
+      StartLoopMetrics(env_.get());
       Maybe<int> exit_code = SpinEventLoop(env_.get());
+      ResourceGovernor::Get()->Remove(this);
       Mutex::ScopedLock lock(mutex_);
       if (exit_code_ == 0 && exit_code.IsJust()) {
         exit_code_ = exit_code.FromJust();
@@ -355,6 +636,129 @@ void Worker::Run() {
   Debug(this, "Worker %llu thread stops", thread_id_.id);
 }
 
+void Worker::StartLoopMetrics(Environment* env) {
+  loop_delay_ = std::make_unique<Histogram>(Histogram::Options {});
+  // RecordDelta() records the time since its previous call, so the first
+  // call only establishes the starting point.
+  loop_delay_->RecordDelta();
+
+  auto close_handle = [](Environment* env, uv_handle_t* handle, void* arg) {
+    env->CloseHandle(handle, [](uv_handle_t* handle) {});
+  };
+
+  CHECK_EQ(uv_check_init(env->event_loop(), &loop_metrics_check_), 0);
+  loop_metrics_check_.data = this;
+  uv_unref(reinterpret_cast<uv_handle_t*>(&loop_metrics_check_));
+  uv_check_start(&loop_metrics_check_, [](uv_check_t* handle) {
+    Worker* w = static_cast<Worker*>(handle->data);
+    w->loop_iterations_++;
+    w->PublishLoopMetrics(false);
+  });
+  env->RegisterHandleCleanup(
+      reinterpret_cast<uv_handle_t*>(&loop_metrics_check_),
+      close_handle,
+      nullptr);
+
+  governor_report_time_ = uv_hrtime();
+  governor_cpu_time_ = GetThreadCpuTime();
+
+  CHECK_EQ(uv_timer_init(env->event_loop(), &loop_delay_timer_), 0);
+  loop_delay_timer_.data = this;
+  uv_unref(reinterpret_cast<uv_handle_t*>(&loop_delay_timer_));
+  uv_timer_start(&loop_delay_timer_, [](uv_timer_t* handle) {
+    Worker* w = static_cast<Worker*>(handle->data);
+    w->loop_delay_->RecordDelta();
+    w->PublishLoopMetrics(true);
+    if (uv_hrtime() - w->governor_report_time_ >=
+        ResourceGovernor::kIntervalMs * 1000000) {
+      w->ReportToGovernor();
+    }
+  }, kLoopDelayResolutionMs, kLoopDelayResolutionMs);
+  env->RegisterHandleCleanup(
+      reinterpret_cast<uv_handle_t*>(&loop_delay_timer_),
+      close_handle,
+      nullptr);
+}
+
+// Only the worker thread writes the block, so a plain sequence counter is
+// enough to let readers detect torn snapshots.
+void Worker::PublishLoopMetrics(bool with_delay) {
+  std::atomic<double>* m = loop_metrics_;
+  double sequence = m[kLoopMetricsSequence].load(std::memory_order_relaxed);
+  m[kLoopMetricsSequence].store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  m[kLoopMetricsIdleTime].store(
+      uv_metrics_idle_time(loop_metrics_check_.loop) / 1e6,
+      std::memory_order_relaxed);
+  m[kLoopMetricsIterations].store(loop_iterations_,
+                                  std::memory_order_relaxed);
+  if (with_delay) {
+    Histogram* h = loop_delay_.get();
+    m[kLoopMetricsDelayMin].store(h->Min(), std::memory_order_relaxed);
+    m[kLoopMetricsDelayMax].store(h->Max(), std::memory_order_relaxed);
+    m[kLoopMetricsDelayMean].store(h->Mean(), std::memory_order_relaxed);
+    m[kLoopMetricsDelayStddev].store(h->Stddev(), std::memory_order_relaxed);
+    m[kLoopMetricsDelayP50].store(h->Percentile(50),
+                                  std::memory_order_relaxed);
+    m[kLoopMetricsDelayP90].store(h->Percentile(90),
+                                  std::memory_order_relaxed);
+    m[kLoopMetricsDelayP99].store(h->Percentile(99),
+                                  std::memory_order_relaxed);
+    m[kLoopMetricsDelayCount].store(h->Count(), std::memory_order_relaxed);
+
+    HeapStatistics heap;
+    isolate_->GetHeapStatistics(&heap);
+    m[kLoopMetricsHeapTotal].store(heap.total_heap_size(),
+                                   std::memory_order_relaxed);
+    m[kLoopMetricsHeapUsed].store(heap.used_heap_size(),
+                                  std::memory_order_relaxed);
+    m[kLoopMetricsExternalMemory].store(heap.external_memory(),
+                                        std::memory_order_relaxed);
+    m[kLoopMetricsMallocedMemory].store(heap.malloced_memory(),
+                                        std::memory_order_relaxed);
+    for (size_t i = 0; i < isolate_->NumberOfHeapSpaces(); i++) {
+      HeapSpaceStatistics space;
+      isolate_->GetHeapSpaceStatistics(&space, i);
+      if (strcmp(space.space_name(), "read_only_space") == 0) {
+        m[kLoopMetricsReadOnlySpace].store(space.space_size(),
+                                           std::memory_order_relaxed);
+      } else if (strcmp(space.space_name(), "code_space") == 0) {
+        m[kLoopMetricsCodeSpace].store(space.space_size(),
+                                       std::memory_order_relaxed);
+      }
+    }
+  }
+
+  m[kLoopMetricsSequence].store(sequence + 2, std::memory_order_release);
+}
+
+void Worker::ReportToGovernor() {
+  uint64_t now = uv_hrtime();
+  uint64_t cpu_time = GetThreadCpuTime();
+  double cpu = static_cast<double>(cpu_time - governor_cpu_time_) /
+               (now - governor_report_time_);
+  governor_report_time_ = now;
+  governor_cpu_time_ = cpu_time;
+
+  // The memory was sampled by PublishLoopMetrics(true) just before.
+  double memory =
+      loop_metrics_[kLoopMetricsHeapTotal].load(std::memory_order_relaxed) +
+      loop_metrics_[kLoopMetricsExternalMemory].load(
+          std::memory_order_relaxed);
+  ResourceGovernor::Decision decision =
+      ResourceGovernor::Get()->Report(this, memory, cpu);
+
+  if (decision.memory_pressure != memory_pressure_) {
+    memory_pressure_ = decision.memory_pressure;
+    isolate_->MemoryPressureNotification(memory_pressure_);
+  }
+  // The pause counts towards the next interval, so the CPU use measured
+  // then already reflects it.
+  if (decision.pause_ms != 0)
+    uv_sleep(static_cast<unsigned int>(decision.pause_ms));
+}
+
 bool Worker::CreateEnvMessagePort(Environment* env) {
   HandleScope handle_scope(isolate_);
   std::unique_ptr<MessagePortData> data;
@@ -597,6 +1001,14 @@ void Worker::StartThread(const FunctionCallbackInfo<Value>& args) {
     w->resource_limits_[kStackSizeMb] = w->stack_size_ / kMB;
   }
 
+  // Pooled isolates have the default heap limits.
+  if (isolate_pool != nullptr && isolate_pool->env() == w->env() &&
+      w->resource_limits_[kMaxYoungGenerationSizeMb] <= 0 &&
+      w->resource_limits_[kMaxOldGenerationSizeMb] <= 0 &&
+      w->resource_limits_[kCodeRangeSizeMb] <= 0) {
+    w->pooled_isolate_ = isolate_pool->Take();
+  }
+
   uv_thread_options_t thread_options;
   thread_options.flags = UV_THREAD_HAS_STACK_SIZE;
   thread_options.stack_size = w->stack_size_;
@@ -613,7 +1025,10 @@ void Worker::StartThread(const FunctionCallbackInfo<Value>& args) {
     // some space to do work in C++ land.
     w->stack_base_ = stack_top - (w->stack_size_ - kStackBufferSize);
 
+    const uint64_t thread_id = w->thread_id_.id;
+    thread_affinity::PinCurrentThread("worker", thread_id);
     w->Run();
+    thread_affinity::ForgetThread("worker", thread_id);
 
     Mutex::ScopedLock lock(w->mutex_);
     w->env()->SetImmediateThreadsafe(
@@ -779,6 +1194,17 @@ void Worker::LoopIdleTime(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(1.0 * idle_time / 1e6);
 }
 
+void Worker::GetLoopMetrics(const FunctionCallbackInfo<Value>& args) {
+  Worker* w;
+  ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
+  // The block is owned by the parent, so this also works before the thread
+  // starts and after it stops, returning the last published values.
+  Local<SharedArrayBuffer> sab =
+      SharedArrayBuffer::New(args.GetIsolate(), w->loop_metrics_store_);
+  args.GetReturnValue().Set(
+      Float64Array::New(sab, 0, kLoopMetricsFieldCount));
+}
+
 void Worker::LoopStartTime(const FunctionCallbackInfo<Value>& args) {
   Worker* w;
   ASSIGN_OR_RETURN_UNWRAP(&w, args.This());
@@ -812,6 +1238,29 @@ void GetEnvMessagePort(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// Sets the limits of the ResourceGovernor, for all Workers of the process.
+void SetResourceGovernorLimits(const FunctionCallbackInfo<Value>& args) {
+  CHECK(args[0]->IsNumber());
+  CHECK(args[1]->IsNumber());
+  ResourceGovernor::Get()->SetLimits(args[0].As<Number>()->Value(),
+                                     args[1].As<Number>()->Value());
+}
+
+// Returns the memory (in bytes) and CPU (in cores) that the Workers use in
+// total, as last reported, and the number of Workers.
+void GetResourceGovernorUsage(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  double memory, cpu;
+  size_t workers;
+  ResourceGovernor::Get()->GetUsage(&memory, &cpu, &workers);
+  Local<ArrayBuffer> ab = ArrayBuffer::New(env->isolate(), 3 * sizeof(double));
+  double* fields = static_cast<double*>(ab->GetBackingStore()->Data());
+  fields[0] = memory;
+  fields[1] = cpu;
+  fields[2] = static_cast<double>(workers);
+  args.GetReturnValue().Set(Float64Array::New(ab, 0, 3));
+}
+
 void InitWorker(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -833,6 +1282,7 @@ void InitWorker(Local<Object> target,
     env->SetProtoMethod(w, "takeHeapSnapshot", Worker::TakeHeapSnapshot);
     env->SetProtoMethod(w, "loopIdleTime", Worker::LoopIdleTime);
     env->SetProtoMethod(w, "loopStartTime", Worker::LoopStartTime);
+    env->SetProtoMethod(w, "getLoopMetrics", Worker::GetLoopMetrics);
 
     env->SetConstructorFunction(target, "Worker", w);
   }
@@ -851,6 +1301,20 @@ void InitWorker(Local<Object> target,
   }
 
   env->SetMethod(target, "getEnvMessagePort", GetEnvMessagePort);
+  env->SetMethod(
+      target, "setResourceGovernorLimits", SetResourceGovernorLimits);
+  env->SetMethod(target, "getResourceGovernorUsage", GetResourceGovernorUsage);
+
+  const int64_t pool_size = per_process::cli_options->worker_isolate_pool_size;
+  if (pool_size > 0 && env->is_main_thread() && isolate_pool == nullptr &&
+      env->isolate_data()->platform() != nullptr) {
+    isolate_pool = new IsolatePool(env, static_cast<size_t>(pool_size));
+    env->AddCleanupHook([](void* data) {
+      CHECK_EQ(isolate_pool, static_cast<IsolatePool*>(data));
+      delete isolate_pool;
+      isolate_pool = nullptr;
+    }, isolate_pool);
+  }
 
   target
       ->Set(env->context(),
@@ -883,10 +1347,25 @@ void InitWorker(Local<Object> target,
   NODE_DEFINE_CONSTANT(target, kCodeRangeSizeMb);
   NODE_DEFINE_CONSTANT(target, kStackSizeMb);
   NODE_DEFINE_CONSTANT(target, kTotalResourceLimitCount);
+
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsSequence);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsIdleTime);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsIterations);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayMin);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayMax);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayMean);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayStddev);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayP50);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayP90);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayP99);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsDelayCount);
+  NODE_DEFINE_CONSTANT(target, kLoopMetricsFieldCount);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(GetEnvMessagePort);
+  registry->Register(SetResourceGovernorLimits);
+  registry->Register(GetResourceGovernorUsage);
   registry->Register(Worker::New);
   registry->Register(Worker::StartThread);
   registry->Register(Worker::StopThread);
@@ -896,6 +1375,7 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Worker::TakeHeapSnapshot);
   registry->Register(Worker::LoopIdleTime);
   registry->Register(Worker::LoopStartTime);
+  registry->Register(Worker::GetLoopMetrics);
 }
 
 }  // anonymous namespace
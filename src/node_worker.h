@@ -3,8 +3,12 @@
 
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <unordered_map>
+#include "histogram.h"
 #include "node_messaging.h"
 #include "uv.h"
 
@@ -21,6 +25,138 @@ enum ResourceLimits {
   kTotalResourceLimitCount
 };
 
+// Fields of the shared loop metrics block of a Worker, each one a double.
+// The Worker thread publishes into the block once per loop iteration and
+// once per delay sample; the parent reads it through a Float64Array over a
+// SharedArrayBuffer without locking or messaging. kLoopMetricsSequence is
+// odd while an update is in progress, so readers that need a consistent
+// snapshot re-read until it is even and unchanged across the read.
+enum LoopMetricsFields {
+  kLoopMetricsSequence,
+  kLoopMetricsIdleTime,    // Milliseconds, as in loopIdleTime().
+  kLoopMetricsIterations,
+  // Event loop delay, sampled every kLoopDelayResolutionMs, in nanoseconds.
+  kLoopMetricsDelayMin,
+  kLoopMetricsDelayMax,
+  kLoopMetricsDelayMean,
+  kLoopMetricsDelayStddev,
+  kLoopMetricsDelayP50,
+  kLoopMetricsDelayP90,
+  kLoopMetricsDelayP99,
+  kLoopMetricsDelayCount,
+  // Memory of the Worker's isolate in bytes, sampled with the delay. The
+  // read-only space is counted for every isolate, even when it is shared.
+  kLoopMetricsHeapTotal,
+  kLoopMetricsHeapUsed,
+  kLoopMetricsReadOnlySpace,
+  kLoopMetricsCodeSpace,
+  kLoopMetricsExternalMemory,
+  kLoopMetricsMallocedMemory,
+  kLoopMetricsFieldCount
+};
+
+// An isolate with its event loop and a fresh context, set up ahead of time
+// for a Worker that is started later. Everything is disposed of when this
+// is destroyed, unless a Worker has taken over the isolate.
+struct PooledIsolate {
+  explicit PooledIsolate(MultiIsolatePlatform* platform)
+      : platform(platform) {}
+  ~PooledIsolate();
+
+  PooledIsolate(const PooledIsolate&) = delete;
+  PooledIsolate& operator=(const PooledIsolate&) = delete;
+
+  // Sets up the isolate on the calling thread, which must not use more
+  // stack than `stack_limit` allows. Returns false on failure.
+  bool Initialize(uintptr_t stack_limit);
+
+  MultiIsolatePlatform* const platform;
+  uv_loop_t loop;
+  bool loop_initialized = false;
+  v8::Isolate* isolate = nullptr;
+  DeleteFnPtr<IsolateData, FreeIsolateData> isolate_data;
+  v8::Global<v8::Context> context;
+};
+
+// Prepares isolates for the Workers of an Environment on a thread of its
+// own, see --worker-isolate-pool-size, so that starting a Worker does not
+// wait for V8 to create an isolate and a context. V8 cannot reset an
+// isolate that has run code, so each one is used only once, and the pool
+// prepares another one whenever one is taken.
+class IsolatePool {
+ public:
+  IsolatePool(Environment* env, size_t size);
+  ~IsolatePool();
+
+  IsolatePool(const IsolatePool&) = delete;
+  IsolatePool& operator=(const IsolatePool&) = delete;
+
+  Environment* env() const { return env_; }
+
+  // Returns nullptr if no isolate is ready.
+  std::unique_ptr<PooledIsolate> Take();
+
+ private:
+  static constexpr size_t kStackSize = 4 * 1024 * 1024;
+  static constexpr size_t kStackBufferSize = 192 * 1024;
+
+  void Fill(uintptr_t stack_limit);
+
+  Environment* const env_;
+  MultiIsolatePlatform* const platform_;
+  const size_t size_;
+  std::optional<uv_thread_t> thread_;
+
+  Mutex mutex_;  // Protects the fields below.
+  ConditionVariable wakeup_;
+  std::deque<std::unique_ptr<PooledIsolate>> isolates_;
+  bool stopping_ = false;
+};
+
+class Worker;
+
+// Holds the memory and CPU use of all Workers in the process to limits for
+// them as a whole, so that no single Worker has to be given a worst-case
+// share up front. Each Worker reports the heap and external memory of its
+// isolate and the CPU time of its thread every kIntervalMs. The answer
+// tells it which memory pressure level to pass to its isolate, and how
+// long to pause its event loop for if the Workers use more CPU than the
+// limit allows, in which case the Workers above an equal share of the
+// limit are paused in proportion to their excess.
+class ResourceGovernor {
+ public:
+  static constexpr uint64_t kIntervalMs = 100;
+
+  struct Decision {
+    v8::MemoryPressureLevel memory_pressure = v8::MemoryPressureLevel::kNone;
+    uint64_t pause_ms = 0;
+  };
+
+  static ResourceGovernor* Get();
+
+  // `memory` is in bytes, `cpu` in cores. 0 disables a limit.
+  void SetLimits(double memory, double cpu);
+  // `memory` is in bytes, `cpu` in cores over the last interval.
+  Decision Report(const Worker* worker, double memory, double cpu);
+  void Remove(const Worker* worker);
+
+  // The sums over all Workers, and the number of Workers.
+  void GetUsage(double* memory, double* cpu, size_t* workers);
+
+ private:
+  struct Usage {
+    double memory = 0;
+    double cpu = 0;
+  };
+
+  Mutex mutex_;
+  double memory_limit_ = 0;
+  double cpu_limit_ = 0;
+  double total_memory_ = 0;
+  double total_cpu_ = 0;
+  std::unordered_map<const Worker*, Usage> usage_;
+};
+
 // A worker thread, as represented in its parent thread.
 class Worker : public AsyncWrap {
  public:
@@ -69,12 +205,17 @@ class Worker : public AsyncWrap {
   static void TakeHeapSnapshot(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void LoopIdleTime(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void LoopStartTime(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetLoopMetrics(const v8::FunctionCallbackInfo<v8::Value>& args);
 
  private:
   bool CreateEnvMessagePort(Environment* env);
   static size_t NearHeapLimit(void* data, size_t current_heap_limit,
                               size_t initial_heap_limit);
 
+  // These are only used on the worker thread, once its Environment exists.
+  void StartLoopMetrics(Environment* env);
+  void PublishLoopMetrics(bool with_delay);
+
   std::shared_ptr<PerIsolateOptions> per_isolate_opts_;
   std::vector<std::string> exec_argv_;
   std::vector<std::string> argv_;
@@ -105,6 +246,23 @@ class Worker : public AsyncWrap {
 
   std::unique_ptr<MessagePortData> child_port_data_;
   std::shared_ptr<KVStore> env_vars_;
+  // Taken from the IsolatePool when the thread is started, if possible.
+  std::unique_ptr<PooledIsolate> pooled_isolate_;
+
+  // Shared loop metrics block, see LoopMetricsFields.
+  static constexpr uint64_t kLoopDelayResolutionMs = 10;
+  std::shared_ptr<v8::BackingStore> loop_metrics_store_;
+  std::atomic<double>* loop_metrics_ = nullptr;
+  uv_check_t loop_metrics_check_;
+  uv_timer_t loop_delay_timer_;
+  std::unique_ptr<Histogram> loop_delay_;
+  double loop_iterations_ = 0;
+
+  // Only used on the worker thread, see ResourceGovernor.
+  void ReportToGovernor();
+  uint64_t governor_report_time_ = 0;
+  uint64_t governor_cpu_time_ = 0;
+  v8::MemoryPressureLevel memory_pressure_ = v8::MemoryPressureLevel::kNone;
 
   // This is always kept alive because the JS object associated with the Worker
   // instance refers to it via its [kPort] property.
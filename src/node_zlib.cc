@@ -24,8 +24,12 @@
 #include "node_buffer.h"
 
 #include "async_wrap-inl.h"
+#include "base_object-inl.h"
 #include "env-inl.h"
+#include "node_errors.h"
 #include "node_external_reference.h"
+#include "node_messaging.h"
+#include "stream_base-inl.h"
 #include "threadpoolwork-inl.h"
 #include "util-inl.h"
 
@@ -40,11 +44,17 @@
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace node {
 
 using v8::ArrayBuffer;
+using v8::ArrayBufferView;
+using v8::BackingStore;
 using v8::Context;
 using v8::Function;
 using v8::FunctionCallbackInfo;
@@ -53,8 +63,10 @@ using v8::Global;
 using v8::HandleScope;
 using v8::Int32;
 using v8::Integer;
+using v8::Isolate;
 using v8::Local;
 using v8::Object;
+using v8::Uint32;
 using v8::Uint32Array;
 using v8::Value;
 
@@ -127,6 +139,255 @@ struct CompressionError {
   inline bool IsError() const { return code != nullptr; }
 };
 
+class BindingData : public BaseObject {
+ public:
+  BindingData(Environment* env, Local<Object> obj)
+      : BaseObject(env, obj) {}
+
+  static constexpr FastStringKey type_name { "zlib" };
+
+  // Streams that JS has released, by the parameters their state was set up
+  // with, to be handed out again by getPooledStream(). Holding on to their
+  // objects keeps them alive.
+  static constexpr size_t kMaxPooledStreams = 64;
+  static constexpr size_t kMaxPooledStreamsPerKey = 8;
+  std::unordered_map<uint32_t, std::vector<Global<Object>>> stream_pool;
+  size_t pooled_streams = 0;
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("stream_pool",
+                                pooled_streams * sizeof(Global<Object>));
+  }
+  SET_SELF_SIZE(BindingData)
+  SET_MEMORY_INFO_NAME(BindingData)
+};
+
+// TODO(addaleax): Remove once we're on C++17.
+constexpr FastStringKey BindingData::type_name;
+constexpr size_t BindingData::kMaxPooledStreams;
+constexpr size_t BindingData::kMaxPooledStreamsPerKey;
+
+// An immutable zlib dictionary that any number of streams, in any thread,
+// can use without a copy of their own. For deflate, it also keeps a stream
+// that has already been fed the dictionary for each set of parameters it is
+// used with. New streams are copied from that with deflateCopy(), which is
+// much cheaper than running deflateSetDictionary() on 32 KiB of data again.
+class SharedZlibDictionary final {
+ public:
+  SharedZlibDictionary(const unsigned char* data,
+                       size_t length,
+                       bool keep_primed_streams)
+      : data_(data, data + length),
+        keep_primed_streams_(keep_primed_streams) {}
+
+  ~SharedZlibDictionary() {
+    for (const std::unique_ptr<PrimedStream>& primed : primed_)
+      deflateEnd(&primed->strm);
+  }
+
+  const std::vector<unsigned char>& data() const { return data_; }
+  bool keeps_primed_streams() const { return keep_primed_streams_; }
+
+  // Sets up `strm` like deflateInit2() followed by deflateSetDictionary().
+  // All memory is allocated with the allocation functions of `strm`.
+  int InitDeflate(z_stream* strm,
+                  int level,
+                  int window_bits,
+                  int mem_level,
+                  int strategy) {
+    PrimedStream* primed =
+        keep_primed_streams_ && strm->zalloc != Z_NULL ?
+            GetPrimedStream(level, window_bits, mem_level, strategy) :
+            nullptr;
+    if (primed == nullptr) {
+      int err = deflateInit2(
+          strm, level, Z_DEFLATED, window_bits, mem_level, strategy);
+      if (err != Z_OK)
+        return err;
+      err = deflateSetDictionary(strm, data_.data(), data_.size());
+      if (err != Z_OK)
+        deflateEnd(strm);
+      return err;
+    }
+
+    // deflateCopy() allocates with the functions of the source stream, so
+    // lend it those of `strm` while copying.
+    Mutex::ScopedLock lock(mutex_);
+    z_stream* source = &primed->strm;
+    const alloc_func zalloc = source->zalloc;
+    const free_func zfree = source->zfree;
+    voidpf opaque = source->opaque;
+    source->zalloc = strm->zalloc;
+    source->zfree = strm->zfree;
+    source->opaque = strm->opaque;
+    const int err = deflateCopy(strm, source);
+    source->zalloc = zalloc;
+    source->zfree = zfree;
+    source->opaque = opaque;
+    return err;
+  }
+
+  size_t SelfSize() const {
+    return sizeof(*this) + data_.size();
+  }
+
+ private:
+  // Enough for a few compression levels per dictionary.
+  static constexpr size_t kMaxPrimedStreams = 8;
+
+  struct PrimedStream {
+    int level;
+    int window_bits;
+    int mem_level;
+    int strategy;
+    z_stream strm;
+  };
+
+  PrimedStream* GetPrimedStream(int level,
+                                int window_bits,
+                                int mem_level,
+                                int strategy) {
+    Mutex::ScopedLock lock(mutex_);
+    for (const std::unique_ptr<PrimedStream>& primed : primed_) {
+      if (primed->level == level &&
+          primed->window_bits == window_bits &&
+          primed->mem_level == mem_level &&
+          primed->strategy == strategy) {
+        return primed.get();
+      }
+    }
+    if (primed_.size() >= kMaxPrimedStreams)
+      return nullptr;
+
+    auto primed = std::make_unique<PrimedStream>();
+    primed->level = level;
+    primed->window_bits = window_bits;
+    primed->mem_level = mem_level;
+    primed->strategy = strategy;
+    memset(&primed->strm, 0, sizeof(primed->strm));
+    if (deflateInit2(&primed->strm, level, Z_DEFLATED, window_bits,
+                     mem_level, strategy) != Z_OK) {
+      return nullptr;
+    }
+    if (deflateSetDictionary(&primed->strm, data_.data(), data_.size()) !=
+        Z_OK) {
+      deflateEnd(&primed->strm);
+      return nullptr;
+    }
+    primed_.emplace_back(std::move(primed));
+    return primed_.back().get();
+  }
+
+  const std::vector<unsigned char> data_;
+  const bool keep_primed_streams_;
+  Mutex mutex_;  // Protects primed_.
+  std::vector<std::unique_ptr<PrimedStream>> primed_;
+};
+
+// The JS handle for a SharedZlibDictionary. It can be passed to init() in
+// place of a Buffer, and posted to other threads without copying the data.
+class ZlibDictionary final : public BaseObject {
+ public:
+  ZlibDictionary(Environment* env,
+                 Local<Object> object,
+                 std::shared_ptr<SharedZlibDictionary> dictionary)
+      : BaseObject(env, object), dictionary_(std::move(dictionary)) {
+    MakeWeak();
+  }
+
+  static Local<FunctionTemplate> GetConstructorTemplate(Environment* env) {
+    Local<FunctionTemplate> tmpl =
+        env->zlib_dictionary_constructor_template();
+    if (tmpl.IsEmpty()) {
+      tmpl = FunctionTemplate::New(env->isolate());
+      tmpl->InstanceTemplate()->SetInternalFieldCount(
+          BaseObject::kInternalFieldCount);
+      tmpl->Inherit(BaseObject::GetConstructorTemplate(env));
+      tmpl->SetClassName(
+          FIXED_ONE_BYTE_STRING(env->isolate(), "ZlibDictionary"));
+      env->set_zlib_dictionary_constructor_template(tmpl);
+    }
+    return tmpl;
+  }
+
+  static bool HasInstance(Environment* env, Local<Value> value) {
+    return GetConstructorTemplate(env)->HasInstance(value);
+  }
+
+  static BaseObjectPtr<ZlibDictionary> Create(
+      Environment* env, std::shared_ptr<SharedZlibDictionary> dictionary) {
+    Local<Function> ctor;
+    Local<Object> obj;
+    if (!GetConstructorTemplate(env)->GetFunction(env->context())
+             .ToLocal(&ctor) ||
+        !ctor->NewInstance(env->context()).ToLocal(&obj)) {
+      return BaseObjectPtr<ZlibDictionary>();
+    }
+    return MakeBaseObject<ZlibDictionary>(env, obj, std::move(dictionary));
+  }
+
+  // createDictionary(buffer) copies the data once into a ZlibDictionary.
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args[0]->IsArrayBufferView());
+    ArrayBufferViewContents<unsigned char> data(args[0]);
+    CHECK_GT(data.length(), 0);
+    BaseObjectPtr<ZlibDictionary> dictionary = Create(
+        env,
+        std::make_shared<SharedZlibDictionary>(
+            data.data(), data.length(), true));
+    if (dictionary)
+      args.GetReturnValue().Set(dictionary->object());
+  }
+
+  const std::shared_ptr<SharedZlibDictionary>& dictionary() const {
+    return dictionary_;
+  }
+
+  class DictionaryTransferData : public worker::TransferData {
+   public:
+    explicit DictionaryTransferData(
+        std::shared_ptr<SharedZlibDictionary> dictionary)
+        : dictionary_(std::move(dictionary)) {}
+
+    BaseObjectPtr<BaseObject> Deserialize(
+        Environment* env,
+        Local<Context> context,
+        std::unique_ptr<worker::TransferData> self) override {
+      if (context != env->context()) {
+        THROW_ERR_MESSAGE_TARGET_CONTEXT_UNAVAILABLE(env);
+        return {};
+      }
+      return ZlibDictionary::Create(env, dictionary_);
+    }
+
+    SET_NO_MEMORY_INFO()
+    SET_MEMORY_INFO_NAME(DictionaryTransferData)
+    SET_SELF_SIZE(DictionaryTransferData)
+
+   private:
+    std::shared_ptr<SharedZlibDictionary> dictionary_;
+  };
+
+  TransferMode GetTransferMode() const override {
+    return TransferMode::kCloneable;
+  }
+
+  std::unique_ptr<worker::TransferData> CloneForMessaging() const override {
+    return std::make_unique<DictionaryTransferData>(dictionary_);
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("dictionary", dictionary_->SelfSize());
+  }
+
+  SET_MEMORY_INFO_NAME(ZlibDictionary)
+  SET_SELF_SIZE(ZlibDictionary)
+
+ private:
+  std::shared_ptr<SharedZlibDictionary> dictionary_;
+};
+
 class ZlibContext : public MemoryRetainer {
  public:
   ZlibContext() = default;
@@ -143,15 +404,23 @@ class ZlibContext : public MemoryRetainer {
 
   // Zlib-specific:
   void Init(int level, int window_bits, int mem_level, int strategy,
-            std::vector<unsigned char>&& dictionary);
+            std::shared_ptr<SharedZlibDictionary> dictionary);
   void SetAllocationFunctions(alloc_func alloc, free_func free, void* opaque);
   CompressionError SetParams(int level, int strategy);
 
+  // Streams whose state was set up with the same key can take each other's
+  // place after a reset. Returns false if the stream can not be pooled.
+  bool GetPoolKey(uint32_t* key) const;
+  static uint32_t PoolKey(node_zlib_mode mode, int level, int window_bits,
+                          int mem_level, int strategy);
+  static int AdjustWindowBits(node_zlib_mode mode, int window_bits);
+
   SET_MEMORY_INFO_NAME(ZlibContext)
   SET_SELF_SIZE(ZlibContext)
 
   void MemoryInfo(MemoryTracker* tracker) const override {
-    tracker->TrackField("dictionary", dictionary_);
+    if (dictionary_)
+      tracker->TrackFieldWithSize("dictionary", dictionary_->SelfSize());
   }
 
   ZlibContext(const ZlibContext&) = delete;
@@ -161,6 +430,7 @@ class ZlibContext : public MemoryRetainer {
   CompressionError ErrorForMessage(const char* message) const;
   CompressionError SetDictionary();
   bool InitZlib();
+  int InitDeflate();
 
   Mutex mutex_;  // Protects zlib_init_done_.
   bool zlib_init_done_ = false;
@@ -172,7 +442,7 @@ class ZlibContext : public MemoryRetainer {
   int strategy_ = 0;
   int window_bits_ = 0;
   unsigned int gzip_id_bytes_read_ = 0;
-  std::vector<unsigned char> dictionary_;
+  std::shared_ptr<SharedZlibDictionary> dictionary_;
 
   z_stream strm_;
 };
@@ -187,6 +457,9 @@ class BrotliContext : public MemoryRetainer {
   void SetFlush(int flush);
   void GetAfterWriteOffsets(uint32_t* avail_in, uint32_t* avail_out) const;
   inline void SetMode(node_zlib_mode mode) { mode_ = mode; }
+  // Brotli instances can not be reset in place, so there is nothing to gain
+  // from pooling them.
+  bool GetPoolKey(uint32_t* key) const { return false; }
 
   BrotliContext(const BrotliContext&) = delete;
   BrotliContext& operator=(const BrotliContext&) = delete;
@@ -286,6 +559,48 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
     ctx->Close();
   }
 
+  // stream.release()
+  // Resets the stream and keeps it for getPooledStream(), so that one-shot
+  // and short-lived streams don't have to set up their state from scratch.
+  // Returns whether the stream was pooled.
+  static void Release(const FunctionCallbackInfo<Value>& args) {
+    CompressionStream* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+    args.GetReturnValue().Set(false);
+
+    uint32_t key;
+    if (!wrap->init_done_ || wrap->closed_ || wrap->write_in_progress_ ||
+        wrap->released_ || !wrap->ctx_.GetPoolKey(&key)) {
+      return;
+    }
+    if (binding_data->pooled_streams >= BindingData::kMaxPooledStreams)
+      return;
+    std::vector<Global<Object>>& pool = binding_data->stream_pool[key];
+    if (pool.size() >= BindingData::kMaxPooledStreamsPerKey)
+      return;
+
+    {
+      AllocScope alloc_scope(wrap);
+      if (wrap->ctx_.ResetStream().IsError())
+        return;
+    }
+    wrap->released_ = true;
+    wrap->write_result_ = nullptr;
+    wrap->write_js_callback_.Reset();
+
+    // Same as close(). Nothing is emitted if there are no destroy hooks and
+    // async_hooks tracing is off.
+    if (wrap->get_async_id() != kInvalidAsyncId) {
+      wrap->EmitTraceEventDestroy();
+      wrap->EmitDestroy();
+    }
+
+    pool.emplace_back(args.GetIsolate(), wrap->object());
+    binding_data->pooled_streams++;
+    args.GetReturnValue().Set(true);
+  }
+
 
   // write(flush, in, in_off, in_len, out, out_off, out_len)
   template <bool async>
@@ -346,6 +661,7 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
 
     CHECK(init_done_ && "write before init");
     CHECK(!closed_ && "already finalized");
+    CHECK(!released_ && "write after release");
 
     CHECK_EQ(false, write_in_progress_);
     CHECK_EQ(false, pending_close_);
@@ -368,9 +684,31 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
     }
 
     // async version
+    // Small chunks are compressed right away, because sending them to the
+    // threadpool costs more than the work itself. The callback is still
+    // deferred, so that it runs after write() returns, as it would for a
+    // threadpool write.
+    if (in_len <= inline_write_threshold_) {
+      DoThreadPoolWork();
+      AsyncWrap::env()->SetImmediate(
+          [self = BaseObjectPtr<CompressionStream>(this)](Environment*) {
+            self->AfterThreadPoolWork(0);
+          });
+      return;
+    }
     ScheduleWork();
   }
 
+  // setInlineWriteThreshold(bytes)
+  // Sets the size up to which async writes do their work on the loop thread.
+  static void SetInlineWriteThreshold(
+      const FunctionCallbackInfo<Value>& args) {
+    CompressionStream* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    CHECK(args[0]->IsUint32());
+    wrap->inline_write_threshold_ = args[0].As<Uint32>()->Value();
+  }
+
   void UpdateWriteResult() {
     ctx_.GetAfterWriteOffsets(&write_result_[1], &write_result_[0]);
   }
@@ -463,7 +801,12 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
  protected:
   CompressionContext* context() { return &ctx_; }
 
+  bool released() const { return released_; }
+
+  static constexpr uint32_t kDefaultInlineWriteThreshold = 1024;
+
   void InitStream(uint32_t* write_result, Local<Function> write_js_callback) {
+    released_ = false;
     write_result_ = write_result;
     write_js_callback_.Reset(AsyncWrap::env()->isolate(), write_js_callback);
     init_done_ = true;
@@ -511,6 +854,7 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
     if (report == 0) return;
     CHECK_IMPLIES(report < 0, zlib_memory_ >= static_cast<size_t>(-report));
     zlib_memory_ += report;
+    native_memory::Track(native_memory::kZlib, report);
     AsyncWrap::env()->isolate()->AdjustAmountOfExternalAllocatedMemory(report);
   }
 
@@ -538,6 +882,8 @@ class CompressionStream : public AsyncWrap, public ThreadPoolWork {
   bool write_in_progress_ = false;
   bool pending_close_ = false;
   bool closed_ = false;
+  bool released_ = false;
+  uint32_t inline_write_threshold_ = kDefaultInlineWriteThreshold;
   unsigned int refs_ = 0;
   uint32_t* write_result_ = nullptr;
   Global<Function> write_js_callback_;
@@ -607,13 +953,29 @@ class ZlibStream : public CompressionStream<ZlibContext> {
     CHECK(args[5]->IsFunction());
     Local<Function> write_js_callback = args[5].As<Function>();
 
-    std::vector<unsigned char> dictionary;
-    if (Buffer::HasInstance(args[6])) {
-      unsigned char* data =
-          reinterpret_cast<unsigned char*>(Buffer::Data(args[6]));
-      dictionary = std::vector<unsigned char>(
-          data,
-          data + Buffer::Length(args[6]));
+    // A ZlibDictionary is shared, a Buffer gets a private copy.
+    std::shared_ptr<SharedZlibDictionary> dictionary;
+    Environment* env = Environment::GetCurrent(args);
+    if (ZlibDictionary::HasInstance(env, args[6])) {
+      ZlibDictionary* shared;
+      ASSIGN_OR_RETURN_UNWRAP(&shared, args[6]);
+      dictionary = shared->dictionary();
+    } else if (Buffer::HasInstance(args[6]) && Buffer::Length(args[6]) > 0) {
+      dictionary = std::make_shared<SharedZlibDictionary>(
+          reinterpret_cast<unsigned char*>(Buffer::Data(args[6])),
+          Buffer::Length(args[6]),
+          false);
+    }
+
+    // A pooled stream keeps its zlib state, which getPooledStream() has
+    // picked to match these parameters. It gets a new async id, like a
+    // new stream.
+    uint32_t pool_key = 0;
+    const bool reused = wrap->released();
+    if (reused) {
+      CHECK(!dictionary);
+      CHECK(wrap->context()->GetPoolKey(&pool_key));
+      wrap->AsyncReset(args.Holder());
     }
 
     wrap->InitStream(write_result, write_js_callback);
@@ -623,6 +985,12 @@ class ZlibStream : public CompressionStream<ZlibContext> {
         AllocForZlib, FreeForZlib, static_cast<CompressionStream*>(wrap));
     wrap->context()->Init(level, window_bits, mem_level, strategy,
                           std::move(dictionary));
+
+    uint32_t new_pool_key;
+    if (reused) {
+      CHECK(wrap->context()->GetPoolKey(&new_pool_key));
+      CHECK_EQ(pool_key, new_pool_key);
+    }
   }
 
   static void Params(const FunctionCallbackInfo<Value>& args) {
@@ -728,7 +1096,7 @@ void ZlibContext::Close() {
   {
     Mutex::ScopedLock lock(mutex_);
     if (!zlib_init_done_) {
-      dictionary_.clear();
+      dictionary_.reset();
       mode_ = NONE;
       return;
     }
@@ -747,7 +1115,7 @@ void ZlibContext::Close() {
   CHECK(status == Z_OK || status == Z_DATA_ERROR);
   mode_ = NONE;
 
-  dictionary_.clear();
+  dictionary_.reset();
 }
 
 
@@ -822,11 +1190,11 @@ void ZlibContext::DoThreadPoolWork() {
       // SetDictionary, don't repeat that here)
       if (mode_ != INFLATERAW &&
           err_ == Z_NEED_DICT &&
-          !dictionary_.empty()) {
+          dictionary_) {
         // Load it
         err_ = inflateSetDictionary(&strm_,
-                                    dictionary_.data(),
-                                    dictionary_.size());
+                                    dictionary_->data().data(),
+                                    dictionary_->data().size());
         if (err_ == Z_OK) {
           // And try to decode again
           err_ = inflate(&strm_, flush_);
@@ -898,7 +1266,7 @@ CompressionError ZlibContext::GetErrorInfo() const {
     // normal statuses, not fatal
     break;
   case Z_NEED_DICT:
-    if (dictionary_.empty())
+    if (!dictionary_)
       return ErrorForMessage("Missing dictionary");
     else
       return ErrorForMessage("Bad dictionary");
@@ -922,6 +1290,19 @@ CompressionError ZlibContext::ResetStream() {
   switch (mode_) {
     case DEFLATE:
     case DEFLATERAW:
+      // Copying a primed stream again is cheaper than setting the
+      // dictionary again.
+      if (dictionary_ && dictionary_->keeps_primed_streams()) {
+        deflateEnd(&strm_);
+        err_ = InitDeflate();
+        if (err_ != Z_OK) {
+          mode_ = NONE;
+          return ErrorForMessage("Failed to reset stream");
+        }
+        return CompressionError {};
+      }
+      err_ = deflateReset(&strm_);
+      break;
     case GZIP:
       err_ = deflateReset(&strm_);
       break;
@@ -952,7 +1333,7 @@ void ZlibContext::SetAllocationFunctions(alloc_func alloc,
 
 void ZlibContext::Init(
     int level, int window_bits, int mem_level, int strategy,
-    std::vector<unsigned char>&& dictionary) {
+    std::shared_ptr<SharedZlibDictionary> dictionary) {
   if (!((window_bits == 0) &&
         (mode_ == INFLATE ||
          mode_ == GUNZIP ||
@@ -982,19 +1363,46 @@ void ZlibContext::Init(
 
   err_ = Z_OK;
 
-  if (mode_ == GZIP || mode_ == GUNZIP) {
-    window_bits_ += 16;
+  window_bits_ = AdjustWindowBits(mode_, window_bits);
+
+  dictionary_ = std::move(dictionary);
+}
+
+int ZlibContext::AdjustWindowBits(node_zlib_mode mode, int window_bits) {
+  if (mode == GZIP || mode == GUNZIP) {
+    window_bits += 16;
   }
 
-  if (mode_ == UNZIP) {
-    window_bits_ += 32;
+  if (mode == UNZIP) {
+    window_bits += 32;
   }
 
-  if (mode_ == DEFLATERAW || mode_ == INFLATERAW) {
-    window_bits_ *= -1;
+  if (mode == DEFLATERAW || mode == INFLATERAW) {
+    window_bits *= -1;
   }
 
-  dictionary_ = std::move(dictionary);
+  return window_bits;
+}
+
+bool ZlibContext::GetPoolKey(uint32_t* key) const {
+  // Streams with a dictionary would need it to be set again, and
+  // ResetStream() does not bring UNZIP back to header detection.
+  if (dictionary_ || mode_ == NONE || mode_ == UNZIP || mode_ > UNZIP)
+    return false;
+  *key = PoolKey(mode_, level_, window_bits_, mem_level_, strategy_);
+  return true;
+}
+
+uint32_t ZlibContext::PoolKey(node_zlib_mode mode, int level, int window_bits,
+                              int mem_level, int strategy) {
+  // Inflate state does not depend on the deflate parameters.
+  if (mode == INFLATE || mode == GUNZIP || mode == INFLATERAW)
+    level = mem_level = strategy = 0;
+  return static_cast<uint32_t>(mode) |
+         static_cast<uint32_t>(window_bits + 64) << 4 |
+         static_cast<uint32_t>(level + 1) << 11 |
+         static_cast<uint32_t>(mem_level) << 15 |
+         static_cast<uint32_t>(strategy) << 19;
 }
 
 bool ZlibContext::InitZlib() {
@@ -1007,12 +1415,7 @@ bool ZlibContext::InitZlib() {
     case DEFLATE:
     case GZIP:
     case DEFLATERAW:
-      err_ = deflateInit2(&strm_,
-                          level_,
-                          Z_DEFLATED,
-                          window_bits_,
-                          mem_level_,
-                          strategy_);
+      err_ = InitDeflate();
       break;
     case INFLATE:
     case GUNZIP:
@@ -1025,19 +1428,31 @@ bool ZlibContext::InitZlib() {
   }
 
   if (err_ != Z_OK) {
-    dictionary_.clear();
+    dictionary_.reset();
     mode_ = NONE;
     return true;
   }
 
-  SetDictionary();
+  // InitDeflate() has taken care of the dictionary for deflate streams.
+  if (mode_ != DEFLATE && mode_ != DEFLATERAW)
+    SetDictionary();
   zlib_init_done_ = true;
   return true;
 }
 
 
+int ZlibContext::InitDeflate() {
+  if (dictionary_ && (mode_ == DEFLATE || mode_ == DEFLATERAW)) {
+    return dictionary_->InitDeflate(
+        &strm_, level_, window_bits_, mem_level_, strategy_);
+  }
+  return deflateInit2(
+      &strm_, level_, Z_DEFLATED, window_bits_, mem_level_, strategy_);
+}
+
+
 CompressionError ZlibContext::SetDictionary() {
-  if (dictionary_.empty())
+  if (!dictionary_)
     return CompressionError {};
 
   err_ = Z_OK;
@@ -1046,15 +1461,15 @@ CompressionError ZlibContext::SetDictionary() {
     case DEFLATE:
     case DEFLATERAW:
       err_ = deflateSetDictionary(&strm_,
-                                  dictionary_.data(),
-                                  dictionary_.size());
+                                  dictionary_->data().data(),
+                                  dictionary_->data().size());
       break;
     case INFLATERAW:
       // The other inflate cases will have the dictionary set when inflate()
       // returns Z_NEED_DICT in Process()
       err_ = inflateSetDictionary(&strm_,
-                                  dictionary_.data(),
-                                  dictionary_.size());
+                                  dictionary_->data().data(),
+                                  dictionary_->data().size());
       break;
     default:
       break;
@@ -1080,6 +1495,11 @@ CompressionError ZlibContext::SetParams(int level, int strategy) {
     case DEFLATE:
     case DEFLATERAW:
       err_ = deflateParams(&strm_, level, strategy);
+      // Streams that are reset by copying a primed one need to know.
+      if (err_ == Z_OK || err_ == Z_BUF_ERROR) {
+        level_ = level;
+        strategy_ = strategy;
+      }
       break;
     default:
       break;
@@ -1248,6 +1668,636 @@ CompressionError BrotliDecoderContext::GetErrorInfo() const {
 }
 
 
+// Compresses a whole buffer into a single gzip member, the way pigz does:
+// the input is cut into blocks that are deflated on several threadpool
+// threads at once. Each block is primed with the 32 KiB of input before it,
+// so the result compresses almost as well as a single stream. Every block
+// but the last ends with a sync flush, which aligns it to a byte boundary,
+// so the raw deflate output of the blocks can simply be concatenated. The
+// CRC-32 of the input is combined from those of the blocks.
+class ParallelGzip final : public AsyncWrap {
+ public:
+  ParallelGzip(Environment* env, Local<Object> wrap)
+      : AsyncWrap(env, wrap, AsyncWrap::PROVIDER_ZLIB) {
+    MakeWeak();
+  }
+
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args.IsConstructCall());
+    new ParallelGzip(env, args.This());
+  }
+
+  // run(input, level, memLevel, strategy, blockSize, concurrency) calls
+  // ondone(err, buffer) with a zlib error code and the gzip data.
+  static void Run(const FunctionCallbackInfo<Value>& args) {
+    ParallelGzip* job;
+    ASSIGN_OR_RETURN_UNWRAP(&job, args.Holder());
+    CHECK_EQ(args.Length(), 6);
+    CHECK(!job->self_);
+
+    CHECK(args[0]->IsArrayBufferView());
+    Local<ArrayBufferView> input = args[0].As<ArrayBufferView>();
+    CHECK(args[1]->IsInt32());
+    CHECK(args[2]->IsInt32());
+    CHECK(args[3]->IsInt32());
+    CHECK(args[4]->IsUint32());
+    CHECK(args[5]->IsUint32());
+
+    job->level_ = args[1].As<Int32>()->Value();
+    job->mem_level_ = args[2].As<Int32>()->Value();
+    job->strategy_ = args[3].As<Int32>()->Value();
+    job->block_size_ = args[4].As<Uint32>()->Value();
+    const uint32_t concurrency = args[5].As<Uint32>()->Value();
+    CHECK(job->level_ >= Z_MIN_LEVEL && job->level_ <= Z_MAX_LEVEL);
+    CHECK(job->mem_level_ >= Z_MIN_MEMLEVEL &&
+          job->mem_level_ <= Z_MAX_MEMLEVEL);
+    CHECK(job->block_size_ >= kWindowSize && job->block_size_ <= (1 << 30));
+    CHECK_GT(concurrency, 0);
+
+    // The input is used in place, like the chunks passed to write().
+    job->store_ = input->Buffer()->GetBackingStore();
+    job->data_ = static_cast<const unsigned char*>(job->store_->Data()) +
+                 input->ByteOffset();
+    job->length_ = input->ByteLength();
+    const size_t block_count =
+        std::max<size_t>(1, (job->length_ + job->block_size_ - 1) /
+                                job->block_size_);
+    job->blocks_.clear();
+    job->blocks_.resize(block_count);
+    job->next_block_ = 0;
+    job->error_ = Z_OK;
+
+    job->self_ = BaseObjectPtr<ParallelGzip>(job);
+    job->running_ = std::min<size_t>(concurrency, block_count);
+    for (int i = 0; i < job->running_; i++)
+      (new Task(job))->ScheduleWork();
+  }
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(ParallelGzip)
+  SET_SELF_SIZE(ParallelGzip)
+
+ private:
+  static constexpr size_t kWindowSize = 32 * 1024;
+
+  class Task final : public ThreadPoolWork {
+   public:
+    explicit Task(ParallelGzip* job)
+        : ThreadPoolWork(job->env()), job_(job) {}
+
+    void DoThreadPoolWork() override { job_->CompressBlocks(); }
+    void AfterThreadPoolWork(int status) override {
+      std::unique_ptr<Task> self(this);
+      job_->OnTaskDone(status);
+    }
+
+   private:
+    ParallelGzip* job_;
+  };
+
+  struct Block {
+    std::vector<unsigned char> out;
+    uLong crc = 0;
+  };
+
+  void Fail(int err) {
+    int expected = Z_OK;
+    error_.compare_exchange_strong(expected, err);
+  }
+
+  // Runs on the threadpool, taking blocks until none are left.
+  void CompressBlocks() {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    int err = deflateInit2(
+        &strm, level_, Z_DEFLATED, -Z_MAX_WINDOWBITS, mem_level_, strategy_);
+    if (err != Z_OK)
+      return Fail(err);
+
+    for (;;) {
+      const size_t index = next_block_++;
+      if (index >= blocks_.size() || error_ != Z_OK)
+        break;
+      const size_t start = index * block_size_;
+      const size_t length = std::min(block_size_, length_ - start);
+      const bool last = index == blocks_.size() - 1;
+      Block* block = &blocks_[index];
+      block->crc = crc32(0, data_ + start, length);
+
+      deflateReset(&strm);
+      if (start > 0) {
+        const size_t dict_length = std::min(kWindowSize, start);
+        deflateSetDictionary(&strm, data_ + start - dict_length, dict_length);
+      }
+      strm.next_in = const_cast<Bytef*>(data_ + start);
+      strm.avail_in = length;
+
+      // Room for a sync flush marker on top of the worst case.
+      block->out.resize(deflateBound(&strm, length) + 16);
+      size_t written = 0;
+      for (;;) {
+        strm.next_out = block->out.data() + written;
+        strm.avail_out = block->out.size() - written;
+        err = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+        written = block->out.size() - strm.avail_out;
+        if (last ? err == Z_STREAM_END : err == Z_OK && strm.avail_out != 0)
+          break;
+        if ((err != Z_OK && err != Z_BUF_ERROR) || strm.avail_out != 0) {
+          deflateEnd(&strm);
+          return Fail(err == Z_OK ? Z_BUF_ERROR : err);
+        }
+        block->out.resize(block->out.size() * 2);
+      }
+      block->out.resize(written);
+    }
+    deflateEnd(&strm);
+  }
+
+  void OnTaskDone(int status) {
+    if (status == UV_ECANCELED)
+      Fail(Z_STREAM_ERROR);
+    if (--running_ > 0)
+      return;
+
+    BaseObjectPtr<ParallelGzip> self = std::move(self_);
+    store_.reset();
+    Environment* env = this->env();
+    Isolate* isolate = env->isolate();
+    HandleScope handle_scope(isolate);
+    Context::Scope context_scope(env->context());
+
+    Local<Value> argv[] = {
+      Integer::New(isolate, error_),
+      v8::Undefined(isolate),
+    };
+    if (error_ == Z_OK && !Assemble().ToLocal(&argv[1]))
+      return;
+    blocks_.clear();
+    if (status != UV_ECANCELED)
+      MakeCallback(env->ondone_string(), arraysize(argv), argv);
+  }
+
+  // Puts the blocks together between a gzip header and trailer.
+  v8::MaybeLocal<Value> Assemble() {
+    static constexpr size_t kHeaderSize = 10;
+    static constexpr size_t kTrailerSize = 8;
+    size_t total = kHeaderSize + kTrailerSize;
+    for (const Block& block : blocks_)
+      total += block.out.size();
+
+    Isolate* isolate = env()->isolate();
+    std::shared_ptr<BackingStore> store =
+        ArrayBuffer::NewBackingStore(isolate, total);
+    unsigned char* out = static_cast<unsigned char*>(store->Data());
+    const unsigned char xfl = level_ == 9 ? 2 : level_ == 1 ? 4 : 0;
+#ifdef _WIN32
+    const unsigned char os = 10;
+#else
+    const unsigned char os = 3;
+#endif
+    const unsigned char header[kHeaderSize] = {
+      GZIP_HEADER_ID1, GZIP_HEADER_ID2, Z_DEFLATED, 0, 0, 0, 0, 0, xfl, os
+    };
+    memcpy(out, header, kHeaderSize);
+    out += kHeaderSize;
+
+    uLong crc = crc32(0, Z_NULL, 0);
+    for (size_t i = 0; i < blocks_.size(); i++) {
+      const Block& block = blocks_[i];
+      memcpy(out, block.out.data(), block.out.size());
+      out += block.out.size();
+      const size_t start = i * block_size_;
+      crc = crc32_combine(
+          crc, block.crc, std::min(block_size_, length_ - start));
+    }
+
+    const uint32_t trailer[] = {
+      static_cast<uint32_t>(crc), static_cast<uint32_t>(length_)
+    };
+    for (uint32_t value : trailer) {
+      for (int i = 0; i < 4; i++)
+        *out++ = (value >> (8 * i)) & 0xff;
+    }
+
+    Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(store));
+    Local<v8::Uint8Array> buffer;
+    if (!Buffer::New(isolate, ab, 0, total).ToLocal(&buffer))
+      return v8::MaybeLocal<Value>();
+    return buffer;
+  }
+
+  std::shared_ptr<BackingStore> store_;
+  const unsigned char* data_ = nullptr;
+  size_t length_ = 0;
+  int level_ = Z_DEFAULT_LEVEL;
+  int mem_level_ = Z_DEFAULT_MEMLEVEL;
+  int strategy_ = Z_DEFAULT_STRATEGY;
+  size_t block_size_ = 0;
+  std::vector<Block> blocks_;
+  std::atomic<size_t> next_block_{0};
+  std::atomic<int> error_{Z_OK};
+  int running_ = 0;
+  BaseObjectPtr<ParallelGzip> self_;
+};
+
+// The flush values that StreamCompressor uses for flush() and finish().
+template <typename CompressionContext>
+struct CompressorFlushes;
+
+template <>
+struct CompressorFlushes<ZlibContext> {
+  static constexpr int kFlush = Z_SYNC_FLUSH;
+  static constexpr int kFinish = Z_FINISH;
+};
+
+template <>
+struct CompressorFlushes<BrotliEncoderContext> {
+  static constexpr int kFlush = BROTLI_OPERATION_FLUSH;
+  static constexpr int kFinish = BROTLI_OPERATION_FINISH;
+};
+
+// A stream that compresses what is written to it on the spot and writes
+// the result to another StreamBase, e.g. a TCPWrap, without going through
+// JS or the threadpool for each chunk. Like TLSWrap and StreamPipe, it
+// sits in the listener chain of that stream, and passes on its reads and
+// the completion of writes that it did not make.
+//
+// The flush mode given to the constructor ends every write, e.g. Z_NO_FLUSH
+// to let the compressor fill whole blocks, or Z_SYNC_FLUSH to send each write
+// right away. flush(req) and finish(req) write what the compressor holds
+// back, and finish() also ends the compressed data and resets the
+// compressor for the next message. Those writes are made on the underlying
+// stream, and `req` completes there. With `chunked`, the output is framed
+// as HTTP/1.1 chunks, and finish() writes the last chunk.
+template <typename CompressionContext>
+class StreamCompressor final : public AsyncWrap,
+                               public StreamBase,
+                               public StreamListener {
+ public:
+  using Flushes = CompressorFlushes<CompressionContext>;
+
+  StreamCompressor(Environment* env,
+                   Local<Object> wrap,
+                   StreamBase* underlying,
+                   int flush,
+                   bool chunked)
+      : AsyncWrap(env, wrap, AsyncWrap::PROVIDER_STREAMCOMPRESSOR),
+        StreamBase(env),
+        flush_(flush),
+        chunked_(chunked) {
+    MakeWeak();
+    StreamBase::AttachToObject(wrap);
+    underlying->PushStreamListener(this);
+  }
+
+  ~StreamCompressor() override {
+    if (stream_ != nullptr)
+      stream_->RemoveStreamListener(this);
+    ctx_.Close();
+  }
+
+  // new ZlibStreamCompressor(stream, flush, chunked, mode, level,
+  //                          windowBits, memLevel, strategy)
+  // new BrotliStreamCompressor(stream, flush, chunked, params)
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args.IsConstructCall());
+    CHECK(args[0]->IsObject());
+    CHECK(args[1]->IsInt32());
+    StreamBase* underlying = StreamBase::FromObject(args[0].As<Object>());
+    CHECK_NOT_NULL(underlying);
+    StreamCompressor* wrap = new StreamCompressor(
+        env, args.This(), underlying, args[1].As<Int32>()->Value(),
+        args[2]->IsTrue());
+    const CompressionError err = wrap->InitContext(args);
+    if (err.IsError()) {
+      THROW_ERR_ZLIB_INITIALIZATION_FAILED(env, "%s", err.message);
+      wrap->Detach();
+    }
+  }
+
+  static void Flush(const FunctionCallbackInfo<Value>& args) {
+    WriteOut(args, Flushes::kFlush);
+  }
+
+  static void Finish(const FunctionCallbackInfo<Value>& args) {
+    WriteOut(args, Flushes::kFinish);
+  }
+
+  // Leaves the listener chain of the underlying stream, which is then as
+  // before. Returns UV_EBUSY while writes are pending.
+  static void Detach(const FunctionCallbackInfo<Value>& args) {
+    StreamCompressor* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    if (!wrap->writes_.empty())
+      return args.GetReturnValue().Set(UV_EBUSY);
+    wrap->Detach();
+    args.GetReturnValue().Set(0);
+  }
+
+  bool IsAlive() override {
+    return stream_ != nullptr && underlying()->IsAlive();
+  }
+  bool IsClosing() override {
+    return stream_ == nullptr || underlying()->IsClosing();
+  }
+  // Data read from the underlying stream still reaches its own listener.
+  int ReadStart() override { return UV_ENOTSUP; }
+  int ReadStop() override { return UV_ENOTSUP; }
+
+  // Ends the compressed data, but leaves the underlying stream open.
+  int DoShutdown(ShutdownWrap* req_wrap) override {
+    if (stream_ == nullptr) return UV_EPIPE;
+    out_.clear();
+    int err = Compress(nullptr, 0, Flushes::kFinish);
+    if (err == 0) err = Write(Local<Object>(), true).err;
+    return err == 0 ? 1 : err;
+  }
+
+  int DoWrite(WriteWrap* w,
+              uv_buf_t* bufs,
+              size_t count,
+              uv_stream_t* send_handle) override {
+    CHECK_NULL(send_handle);
+    if (stream_ == nullptr) return UV_EPIPE;
+    out_.clear();
+    for (size_t i = 0; i < count; i++) {
+      const int flush = i + 1 == count ? flush_ : 0;
+      int err = Compress(bufs[i].base, bufs[i].len, flush);
+      if (err != 0) return err;
+    }
+
+    StreamWriteResult res = Write(Local<Object>(), false);
+    if (res.err != 0) return res.err;
+    if (res.async) {
+      writes_[res.wrap] = w;
+      return 0;
+    }
+    // Nothing is left to wait for, but Done() may only be called once
+    // DoWrite() has returned.
+    BaseObjectPtr<AsyncWrap> strong_ref{w->GetAsyncWrap()};
+    env()->SetImmediate([w, strong_ref](Environment* env) { w->Done(0); });
+    return 0;
+  }
+
+  const char* Error() const override { return error_; }
+  void ClearError() override { error_ = nullptr; }
+
+  uv_buf_t OnStreamAlloc(size_t suggested_size) override {
+    CHECK_NOT_NULL(previous_listener_);
+    return previous_listener_->OnStreamAlloc(suggested_size);
+  }
+
+  void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override {
+    CHECK_NOT_NULL(previous_listener_);
+    previous_listener_->OnStreamRead(nread, buf);
+  }
+
+  void OnStreamAfterWrite(WriteWrap* w, int status) override {
+    auto it = writes_.find(w);
+    if (it == writes_.end())
+      return StreamListener::OnStreamAfterWrite(w, status);
+    WriteWrap* own = it->second;
+    writes_.erase(it);
+    if (own != nullptr) own->Done(status);
+  }
+
+  void OnStreamDestroy() override {
+    // The writes that are still pending on the underlying stream are not
+    // going to complete.
+    for (const auto& write : writes_) {
+      WriteWrap* own = write.second;
+      if (own == nullptr) continue;
+      BaseObjectPtr<AsyncWrap> strong_ref{own->GetAsyncWrap()};
+      env()->SetImmediate([own, strong_ref](Environment* env) {
+        own->Done(UV_ECANCELED);
+      });
+    }
+    writes_.clear();
+  }
+
+  AsyncWrap* GetAsyncWrap() override { return this; }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackField("compression context", ctx_);
+    tracker->TrackFieldWithSize("output", out_.capacity());
+  }
+  SET_MEMORY_INFO_NAME(StreamCompressor)
+  SET_SELF_SIZE(StreamCompressor)
+
+ private:
+  // Room for the size line of a chunk, "ffffffff\r\n" at most, in front of
+  // the output.
+  static constexpr size_t kChunkHeaderSize = 10;
+  static constexpr size_t kOutputStep = 16 * 1024;
+  static constexpr size_t kMaxInputStep = 1 << 30;
+
+  StreamBase* underlying() const { return static_cast<StreamBase*>(stream_); }
+
+  CompressionError InitContext(const FunctionCallbackInfo<Value>& args);
+
+  void Detach() {
+    if (stream_ != nullptr)
+      stream_->RemoveStreamListener(this);
+  }
+
+  // Compresses `length` bytes into out_, ending with `flush`.
+  int Compress(char* data, size_t length, int flush) {
+    if (out_.empty()) out_.resize(kChunkHeaderSize);
+    for (;;) {
+      const size_t step = std::min(length, kMaxInputStep);
+      const int step_flush = step == length ? flush : 0;
+      uint32_t avail_in = step;
+      uint32_t avail_out;
+      do {
+        const size_t used = out_.size();
+        out_.resize(used + kOutputStep);
+        ctx_.SetBuffers(data, avail_in, out_.data() + used, kOutputStep);
+        ctx_.SetFlush(step_flush);
+        ctx_.DoThreadPoolWork();
+        const CompressionError err = ctx_.GetErrorInfo();
+        if (err.IsError()) {
+          error_ = err.message;
+          return UV_EPROTO;
+        }
+        uint32_t remaining;
+        ctx_.GetAfterWriteOffsets(&remaining, &avail_out);
+        out_.resize(used + kOutputStep - avail_out);
+        data += avail_in - remaining;
+        length -= avail_in - remaining;
+        avail_in = remaining;
+      } while (avail_out == 0);
+      if (length == 0) return 0;
+    }
+  }
+
+  // Writes out_ to the underlying stream, as a chunk with `chunked_`.
+  StreamWriteResult Write(Local<Object> req_wrap_obj, bool finishing) {
+    const size_t payload = out_.size() - kChunkHeaderSize;
+    size_t start = kChunkHeaderSize;
+    if (chunked_ && payload > 0) {
+      char header[kChunkHeaderSize + 1];
+      const int length =
+          snprintf(header, sizeof(header), "%zx\r\n", payload);
+      CHECK_LE(static_cast<size_t>(length), kChunkHeaderSize);
+      start -= length;
+      memcpy(out_.data() + start, header, length);
+      out_.insert(out_.end(), {'\r', '\n'});
+    }
+    if (chunked_ && finishing) {
+      static const char kLastChunk[] = "0\r\n\r\n";
+      out_.insert(out_.end(), kLastChunk, kLastChunk + sizeof(kLastChunk) - 1);
+    }
+    if (finishing) {
+      const CompressionError err = ctx_.ResetStream();
+      if (err.IsError()) {
+        error_ = err.message;
+        return StreamWriteResult { false, UV_EPROTO, nullptr, 0, {} };
+      }
+    }
+    if (out_.size() == start)
+      return StreamWriteResult { false, 0, nullptr, 0, {} };
+
+    // The write may outlive out_, which is reused right away.
+    const size_t size = out_.size() - start;
+    std::unique_ptr<BackingStore> bs;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+      bs = ArrayBuffer::NewBackingStore(env()->isolate(), size);
+    }
+    memcpy(bs->Data(), out_.data() + start, size);
+    uv_buf_t buf = uv_buf_init(static_cast<char*>(bs->Data()), size);
+    StreamWriteResult res =
+        underlying()->Write(&buf, 1, nullptr, req_wrap_obj);
+    if (res.wrap != nullptr) {
+      res.wrap->SetBackingStore(std::move(bs));
+      // Writes for JS complete as writes of the underlying stream.
+      if (req_wrap_obj.IsEmpty()) writes_[res.wrap] = nullptr;
+    }
+    return res;
+  }
+
+  // flush(req) and finish(req) return an error code, like stream.writev().
+  static void WriteOut(const FunctionCallbackInfo<Value>& args, int flush) {
+    StreamCompressor* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    CHECK(args[0]->IsObject());
+    if (wrap->stream_ == nullptr)
+      return args.GetReturnValue().Set(UV_EPIPE);
+    wrap->out_.clear();
+    int err = wrap->Compress(nullptr, 0, flush);
+    if (err == 0) {
+      StreamWriteResult res = wrap->Write(args[0].As<Object>(),
+                                          flush == Flushes::kFinish);
+      wrap->underlying()->SetWriteResult(res);
+      err = res.err;
+    }
+    args.GetReturnValue().Set(err);
+  }
+
+  CompressionContext ctx_;
+  const int flush_;
+  const bool chunked_;
+  std::vector<char> out_;
+  // The pending writes on the underlying stream, and the writes to this
+  // stream that they complete, or nullptr.
+  std::unordered_map<WriteWrap*, WriteWrap*> writes_;
+  const char* error_ = nullptr;
+};
+
+template <>
+CompressionError StreamCompressor<ZlibContext>::InitContext(
+    const FunctionCallbackInfo<Value>& args) {
+  for (int i = 3; i < 8; i++) CHECK(args[i]->IsInt32());
+  const node_zlib_mode mode =
+      static_cast<node_zlib_mode>(args[3].As<Int32>()->Value());
+  CHECK(mode == DEFLATE || mode == GZIP || mode == DEFLATERAW);
+  ctx_.SetMode(mode);
+  ctx_.SetAllocationFunctions(nullptr, nullptr, nullptr);
+  ctx_.Init(args[4].As<Int32>()->Value(),
+            args[5].As<Int32>()->Value(),
+            args[6].As<Int32>()->Value(),
+            args[7].As<Int32>()->Value(),
+            nullptr);
+  // zlib initializes lazily, which ResetStream() forces.
+  return ctx_.ResetStream();
+}
+
+template <>
+CompressionError StreamCompressor<BrotliEncoderContext>::InitContext(
+    const FunctionCallbackInfo<Value>& args) {
+  ctx_.SetMode(BROTLI_ENCODE);
+  CompressionError err = ctx_.Init(nullptr, nullptr, nullptr);
+  if (err.IsError()) return err;
+  CHECK(args[3]->IsUint32Array());
+  Local<Uint32Array> params = args[3].As<Uint32Array>();
+  const uint32_t* data = reinterpret_cast<uint32_t*>(Buffer::Data(args[3]));
+  for (size_t i = 0; i < params->Length(); i++) {
+    if (data[i] == static_cast<uint32_t>(-1))
+      continue;
+    err = ctx_.SetParams(i, data[i]);
+    if (err.IsError()) return err;
+  }
+  return CompressionError {};
+}
+
+template <typename CompressionContext>
+void MakeStreamCompressorClass(Environment* env,
+                               Local<Object> target,
+                               const char* name) {
+  using Compressor = StreamCompressor<CompressionContext>;
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(Compressor::New);
+  t->InstanceTemplate()->SetInternalFieldCount(
+      StreamBase::kInternalFieldCount);
+  t->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  StreamBase::AddMethods(env, t);
+  env->SetProtoMethod(t, "flush", Compressor::Flush);
+  env->SetProtoMethod(t, "finish", Compressor::Finish);
+  env->SetProtoMethod(t, "detach", Compressor::Detach);
+  env->SetConstructorFunction(target, name, t);
+}
+
+template <typename CompressionContext>
+void RegisterStreamCompressorClass(ExternalReferenceRegistry* registry) {
+  using Compressor = StreamCompressor<CompressionContext>;
+  registry->Register(Compressor::New);
+  registry->Register(Compressor::Flush);
+  registry->Register(Compressor::Finish);
+  registry->Register(Compressor::Detach);
+}
+
+// getPooledStream(mode, windowBits, level, memLevel, strategy)
+// Returns a zlib stream released with stream.release() whose state matches
+// the parameters, or undefined if there is none. It has to be initialized
+// with the same parameters and no dictionary before use.
+void GetPooledStream(const FunctionCallbackInfo<Value>& args) {
+  BindingData* binding_data = Environment::GetBindingData<BindingData>(args);
+  CHECK(args[0]->IsInt32());
+  CHECK(args[1]->IsInt32());
+  CHECK(args[2]->IsInt32());
+  CHECK(args[3]->IsInt32());
+  CHECK(args[4]->IsInt32());
+  const node_zlib_mode mode =
+      static_cast<node_zlib_mode>(args[0].As<Int32>()->Value());
+  const uint32_t key = ZlibContext::PoolKey(
+      mode,
+      args[2].As<Int32>()->Value(),
+      ZlibContext::AdjustWindowBits(mode, args[1].As<Int32>()->Value()),
+      args[3].As<Int32>()->Value(),
+      args[4].As<Int32>()->Value());
+
+  auto it = binding_data->stream_pool.find(key);
+  if (it == binding_data->stream_pool.end())
+    return;
+  std::vector<Global<Object>>& pool = it->second;
+  args.GetReturnValue().Set(pool.back().Get(args.GetIsolate()));
+  pool.pop_back();
+  if (pool.empty())
+    binding_data->stream_pool.erase(it);
+  binding_data->pooled_streams--;
+}
+
 template <typename Stream>
 struct MakeClass {
   static void Make(Environment* env, Local<Object> target, const char* name) {
@@ -1260,10 +2310,14 @@ struct MakeClass {
     env->SetProtoMethod(z, "write", Stream::template Write<true>);
     env->SetProtoMethod(z, "writeSync", Stream::template Write<false>);
     env->SetProtoMethod(z, "close", Stream::Close);
+    env->SetProtoMethod(z, "release", Stream::Release);
 
     env->SetProtoMethod(z, "init", Stream::Init);
     env->SetProtoMethod(z, "params", Stream::Params);
     env->SetProtoMethod(z, "reset", Stream::Reset);
+    env->SetProtoMethod(z,
+                        "setInlineWriteThreshold",
+                        Stream::SetInlineWriteThreshold);
 
     env->SetConstructorFunction(target, name, z);
   }
@@ -1273,9 +2327,11 @@ struct MakeClass {
     registry->Register(Stream::template Write<true>);
     registry->Register(Stream::template Write<false>);
     registry->Register(Stream::Close);
+    registry->Register(Stream::Release);
     registry->Register(Stream::Init);
     registry->Register(Stream::Params);
     registry->Register(Stream::Reset);
+    registry->Register(Stream::SetInlineWriteThreshold);
   }
 };
 
@@ -1284,11 +2340,29 @@ void Initialize(Local<Object> target,
                 Local<Context> context,
                 void* priv) {
   Environment* env = Environment::GetCurrent(context);
+  BindingData* const binding_data =
+      env->AddBindingData<BindingData>(context, target);
+  if (binding_data == nullptr) return;
 
   MakeClass<ZlibStream>::Make(env, target, "Zlib");
   MakeClass<BrotliEncoderStream>::Make(env, target, "BrotliEncoder");
   MakeClass<BrotliDecoderStream>::Make(env, target, "BrotliDecoder");
 
+  env->SetMethod(target, "createDictionary", ZlibDictionary::New);
+  env->SetMethod(target, "getPooledStream", GetPooledStream);
+
+  Local<FunctionTemplate> parallel_gzip =
+      env->NewFunctionTemplate(ParallelGzip::New);
+  parallel_gzip->InstanceTemplate()->SetInternalFieldCount(
+      ParallelGzip::kInternalFieldCount);
+  parallel_gzip->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  env->SetProtoMethod(parallel_gzip, "run", ParallelGzip::Run);
+  env->SetConstructorFunction(target, "ParallelGzip", parallel_gzip);
+
+  MakeStreamCompressorClass<ZlibContext>(env, target, "ZlibStreamCompressor");
+  MakeStreamCompressorClass<BrotliEncoderContext>(
+      env, target, "BrotliStreamCompressor");
+
   target->Set(env->context(),
               FIXED_ONE_BYTE_STRING(env->isolate(), "ZLIB_VERSION"),
               FIXED_ONE_BYTE_STRING(env->isolate(), ZLIB_VERSION)).Check();
@@ -1298,6 +2372,12 @@ void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   MakeClass<ZlibStream>::Make(registry);
   MakeClass<BrotliEncoderStream>::Make(registry);
   MakeClass<BrotliDecoderStream>::Make(registry);
+  registry->Register(ZlibDictionary::New);
+  registry->Register(GetPooledStream);
+  registry->Register(ParallelGzip::New);
+  registry->Register(ParallelGzip::Run);
+  RegisterStreamCompressorClass<ZlibContext>(registry);
+  RegisterStreamCompressorClass<BrotliEncoderContext>(registry);
 }
 
 }  // anonymous namespace
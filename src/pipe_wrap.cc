@@ -76,6 +76,10 @@ void PipeWrap::Initialize(Local<Object> target,
 
   env->SetProtoMethod(t, "bind", Bind);
   env->SetProtoMethod(t, "listen", Listen);
+  env->SetProtoMethod(t, "setAcceptBatchSize", SetAcceptBatchSize);
+  env->SetProtoMethod(
+      t, "setConnectionMemoryBudget", SetConnectionMemoryBudget);
+  env->SetProtoMethod(t, "getServerCounters", GetServerCounters);
   env->SetProtoMethod(t, "connect", Connect);
   env->SetProtoMethod(t, "open", Open);
 
@@ -109,6 +113,9 @@ void PipeWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(New);
   registry->Register(Bind);
   registry->Register(Listen);
+  registry->Register(SetAcceptBatchSize);
+  registry->Register(SetConnectionMemoryBudget);
+  registry->Register(GetServerCounters);
   registry->Register(Connect);
   registry->Register(Open);
 #ifdef _WIN32
@@ -0,0 +1,42 @@
+#ifndef SRC_SERVER_COUNTERS_H_
+#define SRC_SERVER_COUNTERS_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "aliased_struct.h"
+
+#include <memory>
+
+namespace node {
+
+// Counters that a server and the connections it accepted keep up to date
+// from C++, and that JS reads as a Float64Array, indexed by
+// ServerCounterFields, without calling into C++. The connections keep the
+// counters alive, so that they still count once the server is closed.
+struct ServerCounters {
+  double connections;         // Accepted so far.
+  double active_connections;  // Accepted, and not closed yet.
+  double requests;            // As seen by HTTP/1 parsers and HTTP/2 sessions.
+  double bytes_read;
+  double bytes_written;
+};
+
+enum ServerCounterFields {
+  kServerConnections,
+  kServerActiveConnections,
+  kServerRequests,
+  kServerBytesRead,
+  kServerBytesWritten,
+  kServerCounterCount
+};
+
+static_assert(sizeof(ServerCounters) == kServerCounterCount * sizeof(double),
+              "ServerCounters must be laid out like a Float64Array");
+
+using SharedServerCounters = std::shared_ptr<AliasedStruct<ServerCounters>>;
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_SERVER_COUNTERS_H_
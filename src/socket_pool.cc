@@ -0,0 +1,296 @@
+#include "async_wrap-inl.h"
+#include "env-inl.h"
+#include "handle_wrap.h"
+#include "idle_connection_pool.h"
+#include "memory_tracker-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "timer_wrap-inl.h"
+#include "util-inl.h"
+
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+namespace node {
+
+using v8::Array;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::Global;
+using v8::HandleScope;
+using v8::Integer;
+using v8::Isolate;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::Value;
+
+namespace {
+
+#if defined(__linux__)
+constexpr short kPollReadHangUp = POLLRDHUP;  // NOLINT(runtime/int)
+#elif !defined(_WIN32)
+constexpr short kPollReadHangUp = 0;  // NOLINT(runtime/int)
+#endif
+
+// new SocketPool(maxIdlePerOrigin, idleTimeout) keeps idle keep-alive
+// sockets of an outbound agent, by origin, in C++.
+//
+// release(origin, socket, handle) adds `socket`, which is handed back as
+// is, and returns false if the origin has no room for it. `handle` is the
+// TCP or pipe handle underneath it, which for a TLS socket is the one that
+// the TLSWrap is stacked on, and is what health checks look at.
+//
+// acquire(origin) synchronously returns the socket of `origin` that was
+// released last, or undefined. Sockets that the peer has closed, that were
+// closed locally, or that are past the idle timeout are skipped, and,
+// like sockets that expire on the timer, handed to `onevict(sockets)` for
+// JS to destroy. clear() evicts all sockets, and getStats() returns
+// [idle, hits, misses, expired, closed].
+class SocketPool final : public AsyncWrap {
+ public:
+  static void Initialize(Local<Object> target,
+                         Local<Value> unused,
+                         Local<Context> context,
+                         void* priv);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void Release(const FunctionCallbackInfo<Value>& args);
+  static void Acquire(const FunctionCallbackInfo<Value>& args);
+  static void Clear(const FunctionCallbackInfo<Value>& args);
+  static void GetStats(const FunctionCallbackInfo<Value>& args);
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackField("timer", timer_);
+    tracker->TrackFieldWithSize(
+        "sockets", pool_.size() * sizeof(PooledSocket));
+  }
+  SET_MEMORY_INFO_NAME(SocketPool)
+  SET_SELF_SIZE(SocketPool)
+
+ private:
+  struct PooledSocket {
+    Global<Object> socket;
+    Global<Object> handle;
+  };
+
+  SocketPool(Environment* env,
+             Local<Object> object,
+             size_t max_idle_per_origin,
+             uint64_t idle_timeout)
+      : AsyncWrap(env, object, PROVIDER_SOCKETPOOL),
+        pool_(max_idle_per_origin, idle_timeout),
+        timer_(env, [this]() { OnTimeout(); }) {
+    MakeWeak();
+    // Idle sockets do not keep the process alive, and neither does this.
+    timer_.Unref();
+  }
+
+  bool IsUsable(const PooledSocket& entry) const;
+  void OnTimeout();
+  // Restarts the timer for the next expiry, if there is one.
+  void ScheduleExpiry();
+  // Calls `onevict` with the sockets in evicted_, if there are any.
+  void EmitEvicted();
+  void Evict(PooledSocket* entry) {
+    evicted_.push_back(std::move(entry->socket));
+    entry->handle.Reset();
+  }
+
+  IdleConnectionPool<PooledSocket> pool_;
+  TimerWrapHandle timer_;
+  uint64_t timer_due_ = 0;  // 0 if the timer is not running.
+  std::vector<Global<Object>> evicted_;
+};
+
+void SocketPool::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsNumber());
+  CHECK(args[1]->IsNumber());
+  const int64_t max_idle = args[0].As<Integer>()->Value();
+  const int64_t idle_timeout = args[1].As<Integer>()->Value();
+  if (max_idle < 0 || idle_timeout <= 0) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The pool size must be >= 0, and the idle timeout > 0");
+  }
+  new SocketPool(env, args.This(), max_idle, idle_timeout);
+}
+
+// The peer closing the connection shows up as POLLRDHUP on Linux, and as
+// a read of 0 bytes everywhere. Data that is waiting is left alone, as TLS
+// may legitimately send records, such as session tickets, while a socket
+// is idle.
+bool SocketPool::IsUsable(const PooledSocket& entry) const {
+  HandleWrap* wrap = Unwrap<HandleWrap>(entry.handle.Get(env()->isolate()));
+  if (!HandleWrap::IsAlive(wrap) || uv_is_closing(wrap->GetHandle()))
+    return false;
+#ifndef _WIN32
+  uv_os_fd_t fd;
+  if (uv_fileno(wrap->GetHandle(), &fd) != 0) return false;
+  pollfd poll_fd;
+  poll_fd.fd = fd;
+  poll_fd.events = POLLIN | kPollReadHangUp;
+  poll_fd.revents = 0;
+  int r;
+  do {
+    r = poll(&poll_fd, 1, 0);
+  } while (r == -1 && errno == EINTR);
+  if (r < 0) return false;
+  if (poll_fd.revents & (POLLERR | POLLHUP | POLLNVAL | kPollReadHangUp))
+    return false;
+  if (poll_fd.revents & POLLIN) {
+    char c;
+    ssize_t n;
+    do {
+      n = recv(fd, &c, 1, MSG_PEEK);
+    } while (n == -1 && errno == EINTR);
+    if (n == 0) return false;
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+  }
+#endif
+  return true;
+}
+
+void SocketPool::Release(const FunctionCallbackInfo<Value>& args) {
+  SocketPool* pool;
+  ASSIGN_OR_RETURN_UNWRAP(&pool, args.Holder());
+  Isolate* isolate = pool->env()->isolate();
+  CHECK(args[0]->IsString());
+  CHECK(args[1]->IsObject());
+  CHECK(args[2]->IsObject());
+  Utf8Value origin(isolate, args[0]);
+  PooledSocket entry {
+    Global<Object>(isolate, args[1].As<Object>()),
+    Global<Object>(isolate, args[2].As<Object>())
+  };
+  if (!pool->IsUsable(entry)) return args.GetReturnValue().Set(false);
+
+  const bool pooled = pool->pool_.Release(
+      origin.ToString(), &entry, uv_now(pool->env()->event_loop()));
+  if (pooled) pool->ScheduleExpiry();
+  args.GetReturnValue().Set(pooled);
+}
+
+void SocketPool::Acquire(const FunctionCallbackInfo<Value>& args) {
+  SocketPool* pool;
+  ASSIGN_OR_RETURN_UNWRAP(&pool, args.Holder());
+  CHECK(args[0]->IsString());
+  Utf8Value origin(pool->env()->isolate(), args[0]);
+  PooledSocket entry;
+  const bool found = pool->pool_.Acquire(
+      origin.ToString(),
+      uv_now(pool->env()->event_loop()),
+      &entry,
+      [&](const PooledSocket& entry) { return pool->IsUsable(entry); },
+      [&](PooledSocket* entry) { pool->Evict(entry); });
+  if (found)
+    args.GetReturnValue().Set(entry.socket.Get(pool->env()->isolate()));
+  pool->EmitEvicted();
+}
+
+void SocketPool::Clear(const FunctionCallbackInfo<Value>& args) {
+  SocketPool* pool;
+  ASSIGN_OR_RETURN_UNWRAP(&pool, args.Holder());
+  pool->pool_.Clear([&](PooledSocket* entry) { pool->Evict(entry); });
+  pool->ScheduleExpiry();
+  pool->EmitEvicted();
+}
+
+void SocketPool::GetStats(const FunctionCallbackInfo<Value>& args) {
+  SocketPool* pool;
+  ASSIGN_OR_RETURN_UNWRAP(&pool, args.Holder());
+  Isolate* isolate = pool->env()->isolate();
+  const IdleConnectionPool<PooledSocket>::Stats& stats = pool->pool_.stats();
+  Local<Value> values[] = {
+    Number::New(isolate, static_cast<double>(pool->pool_.size())),
+    Number::New(isolate, static_cast<double>(stats.hits)),
+    Number::New(isolate, static_cast<double>(stats.misses)),
+    Number::New(isolate, static_cast<double>(stats.expired)),
+    Number::New(isolate, static_cast<double>(stats.closed))
+  };
+  args.GetReturnValue().Set(Array::New(isolate, values, arraysize(values)));
+}
+
+void SocketPool::OnTimeout() {
+  HandleScope handle_scope(env()->isolate());
+  timer_due_ = 0;
+  auto on_evict = [&](PooledSocket* entry) { Evict(entry); };
+  pool_.Expire(uv_now(env()->event_loop()), on_evict);
+  // Catch sockets that the peer closed while they were idle, too, rather
+  // than only when they are acquired.
+  pool_.EvictIf(
+      [&](const PooledSocket& entry) { return !IsUsable(entry); }, on_evict);
+  ScheduleExpiry();
+  EmitEvicted();
+}
+
+void SocketPool::ScheduleExpiry() {
+  uint64_t when;
+  if (!pool_.NextExpiry(&when)) {
+    timer_.Stop();
+    timer_due_ = 0;
+    return;
+  }
+  if (timer_due_ != 0 && timer_due_ <= when) return;
+  const uint64_t now = uv_now(env()->event_loop());
+  timer_.Update(when > now ? when - now : 0);
+  timer_due_ = when;
+}
+
+void SocketPool::EmitEvicted() {
+  if (evicted_.empty()) return;
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+  std::vector<Local<Value>> sockets;
+  sockets.reserve(evicted_.size());
+  for (const Global<Object>& socket : evicted_)
+    sockets.push_back(socket.Get(isolate));
+  evicted_.clear();
+  Local<Value> argv[] = {
+    Array::New(isolate, sockets.data(), sockets.size())
+  };
+  MakeCallback(env()->onevict_string(), arraysize(argv), argv);
+}
+
+void SocketPool::Initialize(Local<Object> target,
+                            Local<Value> unused,
+                            Local<Context> context,
+                            void* priv) {
+  Environment* env = Environment::GetCurrent(context);
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      SocketPool::kInternalFieldCount);
+  env->SetProtoMethod(t, "release", Release);
+  env->SetProtoMethod(t, "acquire", Acquire);
+  env->SetProtoMethod(t, "clear", Clear);
+  env->SetProtoMethodNoSideEffect(t, "getStats", GetStats);
+  env->SetConstructorFunction(target, "SocketPool", t);
+}
+
+void SocketPool::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Release);
+  registry->Register(Acquire);
+  registry->Register(Clear);
+  registry->Register(GetStats);
+}
+
+}  // anonymous namespace
+
+}  // namespace node
+
+NODE_MODULE_CONTEXT_AWARE_INTERNAL(socket_pool,
+                                   node::SocketPool::Initialize)
+NODE_MODULE_EXTERNAL_REFERENCE(socket_pool,
+                               node::SocketPool::RegisterExternalReferences)
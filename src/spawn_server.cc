@@ -0,0 +1,696 @@
+#include "spawn_server.h"
+#include "util-inl.h"
+
+#ifdef __POSIX__
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif  // __POSIX__
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node {
+namespace spawn_server {
+
+#ifdef __POSIX__
+
+namespace {
+
+// More stdio than this goes through uv_spawn().
+constexpr int kMaxFds = 64;
+
+// Sent on the socket of a spawn, with the stdio fds attached. It is followed
+// by `size` bytes: one int32_t per child fd, which is the index of the fd
+// among those attached or -1 to ignore the child fd, and then the file, the
+// cwd, the arguments and the environment, as NUL-terminated strings.
+struct RequestHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t uid;
+  uint32_t gid;
+  uint32_t stdio_count;
+  uint32_t argc;
+  int32_t envc;  // -1 keeps the environment of the helper.
+  uint32_t has_cwd;
+};
+
+struct Reply {
+  int32_t error;
+  int32_t pid;
+};
+
+struct ExitMessage {
+  int64_t exit_status;
+  int64_t term_signal;
+};
+
+struct Request {
+  RequestHeader header;
+  std::vector<char> payload;
+  std::vector<int> fds;
+  const int32_t* stdio;
+  const char* file;
+  const char* cwd;
+  std::vector<char*> args;
+  std::vector<char*> env;
+};
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// The parent's end of the socket to the helper.
+int server_fd = -1;
+pid_t server_pid = -1;
+std::atomic<bool> running {false};
+
+// The helper's self-pipe for SIGCHLD.
+int sigchld_pipe[2] = {-1, -1};
+
+void CloseFd(int fd) {
+  // As uv__close(): retrying after EINTR could close another thread's fd.
+  USE(close(fd));
+}
+
+void SetCloexec(int fd) {
+  CHECK_NE(fcntl(fd, F_SETFD, FD_CLOEXEC), -1);
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t n = send(fd, p, size, kSendFlags);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, void* data, size_t size) {
+  char* p = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Sends `size` bytes, at most, with `fds` attached.
+ssize_t SendFds(int fd, const void* data, size_t size,
+                const int* fds, size_t fd_count) {
+  CHECK_LE(fd_count, static_cast<size_t>(kMaxFds));
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+  struct iovec iov;
+  iov.iov_base = const_cast<void*>(data);
+  iov.iov_len = size;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (fd_count > 0) {
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+  }
+  ssize_t n;
+  do {
+    n = sendmsg(fd, &msg, kSendFlags);
+  } while (n == -1 && errno == EINTR);
+  return n;
+}
+
+// Receives `size` bytes, at most, and the fds attached to them, which are
+// close-on-exec.
+ssize_t RecvFds(int fd, void* data, size_t size, std::vector<int>* fds) {
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = size;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+#ifdef MSG_CMSG_CLOEXEC
+  const int flags = MSG_CMSG_CLOEXEC;
+#else
+  const int flags = 0;
+#endif
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, flags);
+  } while (n == -1 && errno == EINTR);
+  if (n == -1) return n;
+
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+       cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const char* p = reinterpret_cast<const char*>(CMSG_DATA(cmsg));
+    for (size_t i = 0; i < count; i++) {
+      int received;
+      memcpy(&received, p + i * sizeof(int), sizeof(int));
+#ifndef MSG_CMSG_CLOEXEC
+      // The helper has no other thread that could exec in between.
+      SetCloexec(received);
+#endif
+      fds->push_back(received);
+    }
+  }
+
+  if (msg.msg_flags & MSG_CTRUNC) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  return n;
+}
+
+// Reads `count` strings from `payload`, starting at `*offset`.
+bool ParseStrings(std::vector<char>* payload,
+                  size_t* offset,
+                  size_t count,
+                  std::vector<char*>* strings) {
+  for (size_t i = 0; i < count; i++) {
+    if (*offset >= payload->size()) return false;
+    char* string = payload->data() + *offset;
+    char* end = static_cast<char*>(
+        memchr(string, '\0', payload->size() - *offset));
+    if (end == nullptr) return false;
+    strings->push_back(string);
+    *offset = end + 1 - payload->data();
+  }
+  return true;
+}
+
+bool ReadRequest(int fd, Request* request) {
+  RequestHeader& header = request->header;
+  ssize_t n = RecvFds(fd, &header, sizeof(header), &request->fds);
+  if (n <= 0) return false;
+  if (static_cast<size_t>(n) < sizeof(header) &&
+      !ReadAll(fd, reinterpret_cast<char*>(&header) + n,
+               sizeof(header) - n)) {
+    return false;
+  }
+
+  const size_t stdio_size = header.stdio_count * sizeof(int32_t);
+  if (header.stdio_count > static_cast<uint32_t>(kMaxFds) ||
+      header.size < stdio_size || header.has_cwd > 1) {
+    return false;
+  }
+  request->payload.resize(header.size);
+  if (!ReadAll(fd, request->payload.data(), header.size)) return false;
+
+  request->stdio = reinterpret_cast<const int32_t*>(request->payload.data());
+  for (uint32_t i = 0; i < header.stdio_count; i++) {
+    if (request->stdio[i] >= static_cast<int32_t>(request->fds.size()))
+      return false;
+  }
+
+  std::vector<char*> strings;
+  size_t offset = stdio_size;
+  if (!ParseStrings(&request->payload, &offset, 1 + header.has_cwd, &strings))
+    return false;
+  request->file = strings[0];
+  request->cwd = header.has_cwd ? strings[1] : nullptr;
+  if (!ParseStrings(&request->payload, &offset, header.argc, &request->args))
+    return false;
+  request->args.push_back(nullptr);
+  if (header.envc >= 0) {
+    if (!ParseStrings(&request->payload, &offset, header.envc, &request->env))
+      return false;
+    request->env.push_back(nullptr);
+  }
+  return true;
+}
+
+[[noreturn]] void FailChild(int error_fd) {
+  int32_t error = uv_translate_sys_error(errno);
+  USE(write(error_fd, &error, sizeof(error)));
+  _exit(127);
+}
+
+// Runs in the child, as uv__process_child_init() would.
+[[noreturn]] void ExecChild(Request* request, int error_fd) {
+  const RequestHeader& header = request->header;
+  const int stdio_count = static_cast<int>(header.stdio_count);
+
+  // Move the fds that are in the way of the dup2() calls below out of it.
+  if (error_fd < stdio_count) {
+    error_fd = fcntl(error_fd, F_DUPFD_CLOEXEC, stdio_count);
+    if (error_fd == -1) _exit(127);
+  }
+  for (int& fd : request->fds) {
+    if (fd < stdio_count) {
+      fd = fcntl(fd, F_DUPFD_CLOEXEC, stdio_count);
+      if (fd == -1) FailChild(error_fd);
+    }
+  }
+
+  if ((header.flags & UV_PROCESS_DETACHED) && setsid() == -1)
+    FailChild(error_fd);
+
+  for (int fd = 0; fd < stdio_count; fd++) {
+    int use_fd;
+    if (request->stdio[fd] < 0) {
+      // As with uv_spawn(), ignored fds from 3 on are left as they are.
+      if (fd >= 3) continue;
+      use_fd = open("/dev/null", (fd == 0 ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+      if (use_fd == -1) FailChild(error_fd);
+    } else {
+      use_fd = request->fds[request->stdio[fd]];
+    }
+
+    if (use_fd == fd) {
+      if (fcntl(fd, F_SETFD, 0) == -1) FailChild(error_fd);
+    } else if (dup2(use_fd, fd) == -1) {
+      FailChild(error_fd);
+    }
+    if (fd <= 2) {
+      int flags = fcntl(fd, F_GETFL);
+      if (flags != -1 && (flags & O_NONBLOCK))
+        USE(fcntl(fd, F_SETFL, flags & ~O_NONBLOCK));
+    }
+  }
+
+  if (request->cwd != nullptr && chdir(request->cwd) == -1)
+    FailChild(error_fd);
+
+  if (header.flags & (UV_PROCESS_SETUID | UV_PROCESS_SETGID)) {
+    // Drop the supplementary groups, which may fail without privileges.
+    int saved_errno = errno;
+    USE(setgroups(0, nullptr));
+    errno = saved_errno;
+  }
+  if ((header.flags & UV_PROCESS_SETGID) && setgid(header.gid) == -1)
+    FailChild(error_fd);
+  if ((header.flags & UV_PROCESS_SETUID) && setuid(header.uid) == -1)
+    FailChild(error_fd);
+
+  if (header.envc >= 0) environ = request->env.data();
+
+  for (int signum = 1; signum < NSIG; signum++) {
+    if (signum == SIGKILL || signum == SIGSTOP) continue;
+    USE(signal(signum, SIG_DFL));
+  }
+  sigset_t set;
+  sigemptyset(&set);
+  CHECK_EQ(sigprocmask(SIG_SETMASK, &set, nullptr), 0);
+
+  execvp(request->file, request->args.data());
+  FailChild(error_fd);
+}
+
+// Returns the pid of the child, or -1 with `*error` set.
+pid_t SpawnChild(Request* request, int32_t* error) {
+  int error_pipe[2];
+  if (pipe(error_pipe) == -1) {
+    *error = uv_translate_sys_error(errno);
+    return -1;
+  }
+  SetCloexec(error_pipe[0]);
+  SetCloexec(error_pipe[1]);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    CloseFd(error_pipe[0]);
+    ExecChild(request, error_pipe[1]);
+  }
+  if (pid == -1) *error = uv_translate_sys_error(errno);
+  CloseFd(error_pipe[1]);
+
+  if (pid != -1) {
+    // Closed by the exec, or written to when the child could not get there.
+    ssize_t n;
+    do {
+      n = read(error_pipe[0], error, sizeof(*error));
+    } while (n == -1 && errno == EINTR);
+    if (n == sizeof(*error)) {
+      while (waitpid(pid, nullptr, 0) == -1 && errno == EINTR) {}
+      pid = -1;
+    } else {
+      *error = 0;
+    }
+  }
+  CloseFd(error_pipe[0]);
+  return pid;
+}
+
+void HandleRequest(int control, std::unordered_map<pid_t, int>* children) {
+  Request request;
+  Reply reply = {UV_EINVAL, 0};
+  pid_t pid = -1;
+  if (ReadRequest(control, &request)) pid = SpawnChild(&request, &reply.error);
+  for (int fd : request.fds) CloseFd(fd);
+
+  if (pid == -1) {
+    // The parent has gone away when the request is incomplete.
+    USE(WriteAll(control, &reply, sizeof(reply)));
+    CloseFd(control);
+    return;
+  }
+
+  reply.pid = pid;
+  USE(WriteAll(control, &reply, sizeof(reply)));
+  // Reaped children report their exit on `control`, whether or not the
+  // parent still listens.
+  (*children)[pid] = control;
+}
+
+void ReapChildren(std::unordered_map<pid_t, int>* children) {
+  for (;;) {
+    int status;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid == -1 && errno == EINTR) continue;
+    if (pid <= 0) break;
+
+    auto it = children->find(pid);
+    if (it == children->end()) continue;
+    ExitMessage message = {0, 0};
+    if (WIFEXITED(status)) message.exit_status = WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) message.term_signal = WTERMSIG(status);
+    USE(WriteAll(it->second, &message, sizeof(message)));
+    CloseFd(it->second);
+    children->erase(it);
+  }
+}
+
+void OnSigchld(int signum) {
+  int saved_errno = errno;
+  char c = 0;
+  USE(write(sigchld_pipe[1], &c, 1));
+  errno = saved_errno;
+}
+
+[[noreturn]] void Serve(int fd) {
+  // The helper stays in the foreground process group of the parent, as its
+  // children must: the terminal's signals are for them and the parent.
+  USE(signal(SIGPIPE, SIG_IGN));
+  USE(signal(SIGINT, SIG_IGN));
+  USE(signal(SIGQUIT, SIG_IGN));
+
+  CHECK_EQ(pipe(sigchld_pipe), 0);
+  for (int end : sigchld_pipe) {
+    SetCloexec(end);
+    CHECK_NE(fcntl(end, F_SETFL, O_NONBLOCK), -1);
+  }
+  struct sigaction act;
+  memset(&act, 0, sizeof(act));
+  act.sa_handler = OnSigchld;
+  act.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  CHECK_EQ(sigaction(SIGCHLD, &act, nullptr), 0);
+  sigset_t set;
+  sigemptyset(&set);
+  CHECK_EQ(sigprocmask(SIG_SETMASK, &set, nullptr), 0);
+
+  std::unordered_map<pid_t, int> children;
+  for (;;) {
+    struct pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = sigchld_pipe[0];
+    fds[1].events = POLLIN;
+    if (poll(fds, arraysize(fds), -1) == -1) {
+      if (errno == EINTR) continue;
+      _exit(1);
+    }
+
+    if (fds[1].revents != 0) {
+      char buf[64];
+      while (read(sigchld_pipe[0], buf, sizeof(buf)) > 0) {}
+      ReapChildren(&children);
+    }
+
+    if (fds[0].revents != 0) {
+      // One byte per spawn, with the spawn's socket attached.
+      char c;
+      std::vector<int> controls;
+      if (RecvFds(fd, &c, 1, &controls) <= 0) {
+        // The parent has exited. Its children keep running, as they would
+        // without the helper.
+        _exit(0);
+      }
+      for (int control : controls) HandleRequest(control, &children);
+    }
+  }
+}
+
+// The helper has gone away; spawns go through uv_spawn() from now on.
+void Lost() {
+  if (!running.exchange(false)) return;
+  // The socket stays open, as other threads may still be using its number.
+  USE(waitpid(server_pid, nullptr, WNOHANG));
+}
+
+}  // anonymous namespace
+
+bool Start() {
+  CHECK(!running);
+  uv_os_sock_t fds[2];
+  if (uv_socketpair(SOCK_STREAM, 0, fds, 0, 0) != 0) return false;
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    CloseFd(fds[0]);
+    Serve(fds[1]);
+  }
+  CloseFd(fds[1]);
+  if (pid == -1) {
+    CloseFd(fds[0]);
+    return false;
+  }
+
+  server_fd = fds[0];
+  server_pid = pid;
+  running = true;
+  return true;
+}
+
+bool IsRunning() {
+  return running;
+}
+
+int Process::Spawn(uv_loop_t* loop,
+                   const uv_process_options_t* options,
+                   ExitCallback exit_cb) {
+  CHECK(!open_);
+  if (!running || options->stdio_count > kMaxFds) return UV_ENOSYS;
+
+  uv_os_sock_t control[2];
+  int err = uv_socketpair(SOCK_STREAM, 0, control, 0, 0);
+  if (err != 0) return err;
+
+  char c = 0;
+  if (SendFds(server_fd, &c, 1, &control[1], 1) != 1) {
+    CloseFd(control[0]);
+    CloseFd(control[1]);
+    Lost();
+    return UV_ENOSYS;
+  }
+  CloseFd(control[1]);
+
+  // From here on, closing `control` early cancels the spawn.
+  std::vector<int32_t> stdio(options->stdio_count, -1);
+  std::vector<int> fds;
+  std::vector<int> child_ends;
+  auto fail = [&](int error) {
+    for (int fd : child_ends) CloseFd(fd);
+    CloseFd(control[0]);
+    return error;
+  };
+
+  for (int i = 0; i < options->stdio_count; i++) {
+    const uv_stdio_container_t& container = options->stdio[i];
+    int fd = -1;
+    switch (container.flags & (UV_IGNORE | UV_CREATE_PIPE | UV_INHERIT_FD |
+                               UV_INHERIT_STREAM)) {
+      case UV_CREATE_PIPE: {
+        uv_os_sock_t pair[2];
+        err = uv_socketpair(SOCK_STREAM, 0, pair, 0, 0);
+        if (err != 0) return fail(err);
+        err = uv_pipe_open(reinterpret_cast<uv_pipe_t*>(container.data.stream),
+                           pair[0]);
+        if (err != 0) {
+          CloseFd(pair[0]);
+          CloseFd(pair[1]);
+          return fail(err);
+        }
+        fd = pair[1];
+        child_ends.push_back(fd);
+        break;
+      }
+      case UV_INHERIT_FD:
+        fd = container.data.fd;
+        break;
+      case UV_INHERIT_STREAM: {
+        uv_os_fd_t stream_fd;
+        err = uv_fileno(reinterpret_cast<uv_handle_t*>(container.data.stream),
+                        &stream_fd);
+        if (err != 0) return fail(err);
+        fd = stream_fd;
+        break;
+      }
+      default:
+        break;
+    }
+    if (fd != -1) {
+      stdio[i] = static_cast<int32_t>(fds.size());
+      fds.push_back(fd);
+    }
+  }
+
+  RequestHeader header;
+  header.flags = options->flags;
+  header.uid = options->uid;
+  header.gid = options->gid;
+  header.stdio_count = options->stdio_count;
+  header.argc = 0;
+  header.envc = -1;
+  header.has_cwd = options->cwd != nullptr;
+
+  std::string payload(reinterpret_cast<const char*>(stdio.data()),
+                      stdio.size() * sizeof(stdio[0]));
+  auto append = [&](const char* string) {
+    payload.append(string, strlen(string) + 1);
+  };
+  append(options->file);
+  if (options->cwd != nullptr) append(options->cwd);
+  for (char** arg = options->args; *arg != nullptr; arg++, header.argc++)
+    append(*arg);
+  if (options->env != nullptr) {
+    header.envc = 0;
+    for (char** var = options->env; *var != nullptr; var++, header.envc++)
+      append(*var);
+  }
+  header.size = payload.size();
+
+  if (SendFds(control[0], &header, sizeof(header), fds.data(), fds.size()) !=
+          sizeof(header) ||
+      !WriteAll(control[0], payload.data(), payload.size())) {
+    return fail(UV_EPIPE);
+  }
+  for (int fd : child_ends) CloseFd(fd);
+  child_ends.clear();
+
+  Reply reply;
+  if (!ReadAll(control[0], &reply, sizeof(reply))) return fail(UV_EPIPE);
+  if (reply.error != 0) return fail(reply.error);
+
+  CHECK_EQ(uv_pipe_init(loop, &pipe_, 0), 0);
+  pipe_.data = this;
+  open_ = true;
+  exited_ = false;
+  received_ = 0;
+  pid_ = reply.pid;
+  exit_cb_ = exit_cb;
+
+  err = uv_pipe_open(&pipe_, control[0]);
+  if (err == 0)
+    err = uv_read_start(reinterpret_cast<uv_stream_t*>(&pipe_),
+                        OnAlloc, OnRead);
+  if (err != 0) {
+    // Nothing could report the child's exit.
+    USE(uv_kill(pid_, SIGKILL));
+    exited_ = true;
+    Close();
+    return err;
+  }
+  return 0;
+}
+
+int Process::Kill(int signum) {
+  // The pid may have been reused once the helper reaped the child.
+  if (!open_ || exited_) return UV_ESRCH;
+  return uv_kill(pid_, signum);
+}
+
+void Process::Close() {
+  if (!open_) return;
+  open_ = false;
+  uv_close(reinterpret_cast<uv_handle_t*>(&pipe_), nullptr);
+}
+
+void Process::OnAlloc(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  Process* process = static_cast<Process*>(handle->data);
+  *buf = uv_buf_init(process->message_ + process->received_,
+                     sizeof(process->message_) - process->received_);
+}
+
+void Process::OnRead(uv_stream_t* stream,
+                     ssize_t nread,
+                     const uv_buf_t* buf) {
+  Process* process = static_cast<Process*>(stream->data);
+  if (nread == 0) return;
+
+  if (nread < 0) {
+    // The helper has gone away, and the exit status with it.
+    USE(uv_read_stop(stream));
+    USE(process->Kill(SIGKILL));
+    return process->OnExit(UV_EPIPE, 0);
+  }
+
+  static_assert(sizeof(ExitMessage) == sizeof(process->message_),
+                "The exit message must fill the buffer");
+  process->received_ += nread;
+  if (process->received_ < sizeof(ExitMessage)) return;
+  USE(uv_read_stop(stream));
+  ExitMessage message;
+  memcpy(&message, process->message_, sizeof(message));
+  process->OnExit(message.exit_status, static_cast<int>(message.term_signal));
+}
+
+void Process::OnExit(int64_t exit_status, int term_signal) {
+  exited_ = true;
+  exit_cb_(this, exit_status, term_signal);
+}
+
+#else  // !__POSIX__
+
+bool Start() {
+  return false;
+}
+
+bool IsRunning() {
+  return false;
+}
+
+int Process::Spawn(uv_loop_t* loop,
+                   const uv_process_options_t* options,
+                   ExitCallback exit_cb) {
+  return UV_ENOSYS;
+}
+
+int Process::Kill(int signum) {
+  return UV_ESRCH;
+}
+
+void Process::Close() {}
+
+#endif  // __POSIX__
+
+}  // namespace spawn_server
+}  // namespace node
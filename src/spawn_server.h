@@ -0,0 +1,74 @@
+#ifndef SRC_SPAWN_SERVER_H_
+#define SRC_SPAWN_SERVER_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "uv.h"
+
+#include <cstdint>
+
+namespace node {
+namespace spawn_server {
+
+// With --spawn-server, the children of child_process.spawnSync() and
+// execSync() are forked from a helper process instead of from Node.js
+// itself. The helper is forked at startup, before V8 has a heap and before
+// any thread runs, so the cost of its fork() stays small however large the
+// Node.js process grows, and forking it is always safe.
+//
+// Each spawn sends the helper a socket of its own, followed by the options
+// and the child's stdio fds. The helper answers with the child's pid or the
+// error that kept it from running, and later with its exit status, so that
+// the caller only ever waits on sockets of its own loop.
+
+// Forks the helper. Must be called before any thread is started.
+bool Start();
+bool IsRunning();
+
+// A child of the helper, with an interface close to uv_process_t.
+class Process {
+ public:
+  using ExitCallback = void (*)(Process* process,
+                                int64_t exit_status,
+                                int term_signal);
+
+  Process() = default;
+  Process(const Process&) = delete;
+  Process& operator=(const Process&) = delete;
+
+  // As uv_spawn(). Returns UV_ENOSYS, having touched none of `options`'
+  // stdio, when the helper can not run the child, so that the caller can
+  // call uv_spawn() instead. If the helper goes away before the child exits,
+  // `exit_cb` is called with UV_EPIPE and the child is killed.
+  int Spawn(uv_loop_t* loop,
+            const uv_process_options_t* options,
+            ExitCallback exit_cb);
+  int Kill(int signum);
+  // As with uv_close(), the loop must run for the close to complete.
+  void Close();
+
+  bool is_open() const { return open_; }
+  int pid() const { return pid_; }
+
+  void* data = nullptr;
+
+ private:
+  static void OnAlloc(uv_handle_t* handle, size_t size, uv_buf_t* buf);
+  static void OnRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf);
+  void OnExit(int64_t exit_status, int term_signal);
+
+  uv_pipe_t pipe_;
+  ExitCallback exit_cb_ = nullptr;
+  int pid_ = 0;
+  bool open_ = false;
+  bool exited_ = false;
+  char message_[16];
+  size_t received_ = 0;
+};
+
+}  // namespace spawn_server
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_SPAWN_SERVER_H_
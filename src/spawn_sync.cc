@@ -396,6 +396,7 @@ SyncProcessRunner::SyncProcessRunner(Environment* env)
       cwd_buffer_(nullptr),
 
       uv_process_(),
+      use_spawn_server_(false),
       killed_(false),
 
       buffered_output_size_(0),
@@ -496,8 +497,13 @@ Maybe<bool> SyncProcessRunner::TryInitializeAndRunLoop(Local<Value> options) {
     }
   }
 
-  uv_process_options_.exit_cb = ExitCallback;
-  r = uv_spawn(uv_loop_, &uv_process_, &uv_process_options_);
+  server_process_.data = this;
+  r = server_process_.Spawn(uv_loop_, &uv_process_options_, ServerExitCallback);
+  use_spawn_server_ = r != UV_ENOSYS;
+  if (!use_spawn_server_) {
+    uv_process_options_.exit_cb = ExitCallback;
+    r = uv_spawn(uv_loop_, &uv_process_, &uv_process_options_);
+  }
   if (r < 0) {
     SetError(r);
     return Just(false);
@@ -519,8 +525,9 @@ Maybe<bool> SyncProcessRunner::TryInitializeAndRunLoop(Local<Value> options) {
     // We can't handle uv_run failure.
     ABORT();
 
-  // If we get here the process should have exited.
-  CHECK_GE(exit_status_, 0);
+  // If we get here the process should have exited, unless the spawn server
+  // went away and took its exit status along.
+  CHECK(exit_status_ >= 0 || (use_spawn_server_ && error_ != 0));
   return Just(true);
 }
 
@@ -541,6 +548,7 @@ void SyncProcessRunner::CloseHandlesAndDeleteLoop() {
     if (uv_process_handle->type == UV_PROCESS &&
         !uv_is_closing(uv_process_handle))
       uv_close(uv_process_handle, nullptr);
+    server_process_.Close();
 
     // Give closing watchers a chance to finish closing and get their close
     // callbacks called.
@@ -607,7 +615,7 @@ void SyncProcessRunner::Kill() {
   // a signal to the process, however we will still close our end of the stdio
   // pipes so this situation won't make us hang.
   if (exit_status_ < 0) {
-    int r = uv_process_kill(&uv_process_, kill_signal_);
+    int r = KillProcess(kill_signal_);
 
     // If uv_kill failed with an error that isn't ESRCH, the user probably
     // specified an invalid or unsupported signal. Signal this to the user as
@@ -617,7 +625,7 @@ void SyncProcessRunner::Kill() {
 
       // Deliberately ignore the return value, we might not have
       // sufficient privileges to signal the child process.
-      USE(uv_process_kill(&uv_process_, SIGKILL));
+      USE(KillProcess(SIGKILL));
     }
   }
 
@@ -629,6 +637,13 @@ void SyncProcessRunner::Kill() {
 }
 
 
+int SyncProcessRunner::KillProcess(int signal) {
+  if (use_spawn_server_)
+    return server_process_.Kill(signal);
+  return uv_process_kill(&uv_process_, signal);
+}
+
+
 void SyncProcessRunner::IncrementBufferSizeAndCheckOverflow(ssize_t length) {
   buffered_output_size_ += length;
 
@@ -717,8 +732,10 @@ Local<Object> SyncProcessRunner::BuildResultObject() {
     js_result->Set(context, env()->output_string(),
                    Null(env()->isolate())).Check();
 
+  const int pid =
+      use_spawn_server_ ? server_process_.pid() : uv_process_.pid;
   js_result->Set(context, env()->pid_string(),
-                 Number::New(env()->isolate(), uv_process_.pid)).Check();
+                 Number::New(env()->isolate(), pid)).Check();
 
   return scope.Escape(js_result);
 }
@@ -1090,6 +1107,15 @@ void SyncProcessRunner::ExitCallback(uv_process_t* handle,
 }
 
 
+void SyncProcessRunner::ServerExitCallback(spawn_server::Process* process,
+                                           int64_t exit_status,
+                                           int term_signal) {
+  SyncProcessRunner* self = static_cast<SyncProcessRunner*>(process->data);
+  process->Close();
+  self->OnExit(exit_status, term_signal);
+}
+
+
 void SyncProcessRunner::KillTimerCallback(uv_timer_t* handle) {
   SyncProcessRunner* self = reinterpret_cast<SyncProcessRunner*>(handle->data);
   self->OnKillTimerTimeout();
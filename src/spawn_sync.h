@@ -25,6 +25,7 @@
 #if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
 
 #include "node_buffer.h"
+#include "spawn_server.h"
 #include "uv.h"
 #include "v8.h"
 
@@ -162,6 +163,7 @@ class SyncProcessRunner {
   void CloseKillTimer();
 
   void Kill();
+  int KillProcess(int signal);
   void IncrementBufferSizeAndCheckOverflow(ssize_t length);
 
   void OnExit(int64_t exit_status, int term_signal);
@@ -194,6 +196,9 @@ class SyncProcessRunner {
   static void ExitCallback(uv_process_t* handle,
                            int64_t exit_status,
                            int term_signal);
+  static void ServerExitCallback(spawn_server::Process* process,
+                                 int64_t exit_status,
+                                 int term_signal);
   static void KillTimerCallback(uv_timer_t* handle);
   static void KillTimerCloseCallback(uv_handle_t* handle);
 
@@ -215,6 +220,9 @@ class SyncProcessRunner {
   const char* cwd_buffer_;
 
   uv_process_t uv_process_;
+  // Used instead of uv_process_ for children of the spawn server.
+  spawn_server::Process server_process_;
+  bool use_spawn_server_;
   bool killed_;
 
   size_t buffered_output_size_;
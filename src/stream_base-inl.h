@@ -6,6 +6,7 @@
 #include "async_wrap-inl.h"
 #include "base_object-inl.h"
 #include "node.h"
+#include "node_usdt.h"
 #include "stream_base.h"
 #include "v8.h"
 
@@ -172,6 +173,7 @@ StreamWriteResult StreamBase::Write(
   for (size_t i = 0; i < count; ++i)
     total_bytes += bufs[i].len;
   bytes_written_ += total_bytes;
+  NODE_USDT_PROBE2(stream__write, NODE_USDT_PTR(this), total_bytes);
 
   if (send_handle == nullptr) {
     err = DoTryWrite(&bufs, &count);
@@ -352,6 +352,7 @@ MaybeLocal<Value> StreamBase::CallJSOnreadMethod(ssize_t nread,
                                                  size_t offset,
                                                  StreamBaseJSChecks checks) {
   Environment* env = env_;
+  NODE_USDT_PROBE2(stream__read, NODE_USDT_PTR(this), nread);
 
   DCHECK_EQ(static_cast<int32_t>(nread), nread);
   DCHECK_LE(offset, INT32_MAX);
@@ -548,7 +549,8 @@ void EmitToJSStreamListener::OnStreamRead(ssize_t nread, const uv_buf_t& buf_) {
   Isolate* isolate = env->isolate();
   HandleScope handle_scope(isolate);
   Context::Scope context_scope(env->context());
-  std::unique_ptr<BackingStore> bs = env->release_managed_buffer(buf_);
+  std::unique_ptr<BackingStore> bs =
+      env->release_managed_buffer(buf_, nread > 0 ? nread : 0);
 
   if (nread <= 0)  {
     if (nread < 0)
@@ -556,9 +558,6 @@ void EmitToJSStreamListener::OnStreamRead(ssize_t nread, const uv_buf_t& buf_) {
     return;
   }
 
-  CHECK_LE(static_cast<size_t>(nread), bs->ByteLength());
-  bs = BackingStore::Reallocate(isolate, std::move(bs), nread);
-
   stream->CallJSOnreadMethod(nread, ArrayBuffer::New(isolate, std::move(bs)));
 }
 
@@ -14,6 +14,8 @@ namespace node {
 
 // Forward declarations
 class Environment;
+class MemoryBudget;
+struct ServerCounters;
 class ShutdownWrap;
 class WriteWrap;
 class StreamBase;
@@ -273,6 +275,18 @@ class StreamResource {
   // transfer ownership back to the previous listener.
   inline void RemoveStreamListener(StreamListener* listener);
 
+  // Account for data that bypassed EmitRead() and DoWrite(), for example
+  // because StreamPipe spliced it between file descriptors.
+  void AddBytesRead(uint64_t bytes) { bytes_read_ += bytes; }
+  void AddBytesWritten(uint64_t bytes) { bytes_written_ += bytes; }
+
+  // The budget that listeners charge their own buffers of this stream's
+  // data to, such as a parser does, if the stream has one.
+  virtual MemoryBudget* memory_budget() { return nullptr; }
+  // The counters of the server that accepted this stream, if it keeps them,
+  // for listeners that count requests.
+  virtual ServerCounters* server_counters() { return nullptr; }
+
  protected:
   // Call the current listener's OnStreamAlloc() method.
   inline uv_buf_t EmitAlloc(size_t suggested_size);
@@ -351,6 +365,10 @@ class StreamBase : public StreamResource {
       uv_stream_t* send_handle = nullptr,
       v8::Local<v8::Object> req_wrap_obj = v8::Local<v8::Object>());
 
+  // Stores the outcome of a write made on behalf of JS where the JS side of
+  // the stream looks for it, as the write methods of streams do.
+  void SetWriteResult(const StreamWriteResult& res);
+
   // These can be overridden by subclasses to get more specific wrap instances.
   // For example, a subclass Foo could create a FooWriteWrap or FooShutdownWrap
   // (inheriting from ShutdownWrap/WriteWrap) that has extra fields, like
@@ -364,6 +382,12 @@ class StreamBase : public StreamResource {
 
   static inline StreamBase* FromObject(v8::Local<v8::Object> obj);
 
+  // Whether `listener` is the listener that reports to JS which every
+  // stream starts out with.
+  bool IsDefaultListener(const StreamListener* listener) const {
+    return listener == &default_listener_;
+  }
+
  protected:
   inline explicit StreamBase(Environment* env);
 
@@ -400,7 +424,6 @@ class StreamBase : public StreamResource {
   Environment* env_;
   EmitToJSStreamListener default_listener_;
 
-  void SetWriteResult(const StreamWriteResult& res);
   static void AddMethod(Environment* env,
                         v8::Local<v8::Signature> sig,
                         enum v8::PropertyAttribute attributes,
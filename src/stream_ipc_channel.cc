@@ -0,0 +1,384 @@
+#include "async_wrap-inl.h"
+#include "env-inl.h"
+#include "handle_wrap.h"
+#include "ipc_frame.h"
+#include "memory_tracker-inl.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "stream_base-inl.h"
+#include "util-inl.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace node {
+
+using errors::TryCatchScope;
+using v8::Array;
+using v8::ArrayBuffer;
+using v8::BackingStore;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::Global;
+using v8::HandleScope;
+using v8::Integer;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Undefined;
+using v8::Value;
+using v8::ValueDeserializer;
+using v8::ValueSerializer;
+
+namespace {
+
+// new IPCChannel(pipe, maxFrameLength) replaces the newline-delimited JSON
+// of an IPC pipe with length-prefixed frames of values written by the V8
+// serializer, see ipc_frame.h. Both ends must use it.
+//
+// writeMessages(req, messages, handle) serializes all of `messages` into a
+// single write, so that callers can batch what they send in a tick. It
+// returns and reports its result like writeBuffer(). `handle` is optional,
+// and goes with the first of the messages.
+//
+// Reads are decoded in C++, and everything that a read completes is passed
+// to `onmessagebatch(messages, handles)` at once. `handles` is undefined,
+// or an array of [index, handle] pairs for the messages that came with a
+// handle. A frame that is longer than `maxFrameLength` or does not
+// deserialize ends the stream with UV_EPROTO. As with StreamLineSplitter,
+// the handle is still started and stopped with readStart() and readStop(),
+// and EOF and errors go on to the listener before it.
+class IPCChannel final : public AsyncWrap, public StreamListener {
+ public:
+  static void Initialize(Local<Object> target,
+                         Local<Value> unused,
+                         Local<Context> context,
+                         void* priv);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void WriteMessages(const FunctionCallbackInfo<Value>& args);
+  static void Detach(const FunctionCallbackInfo<Value>& args);
+
+  uv_buf_t OnStreamAlloc(size_t suggested_size) override;
+  void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("buffer", capacity_);
+  }
+  SET_MEMORY_INFO_NAME(IPCChannel)
+  SET_SELF_SIZE(IPCChannel)
+
+ private:
+  struct PendingHandle {
+    Global<Object> handle;
+    // Where the read that the handle came with starts in buffer_. The
+    // handle belongs to the first frame that starts there or later.
+    size_t offset;
+  };
+
+  IPCChannel(Environment* env, Local<Object> object, size_t max_frame_length)
+      : AsyncWrap(env, object, PROVIDER_IPCCHANNEL),
+        max_frame_length_(max_frame_length) {
+    MakeWeak();
+  }
+
+  StreamBase* stream_base() { return static_cast<StreamBase*>(stream()); }
+  // Takes over the handle that LibuvStreamWrap accepted for this read.
+  void TakePendingHandle(size_t offset);
+  void Emit(const std::vector<Local<Value>>& messages,
+            const std::vector<Local<Value>>& handles);
+  // Removes the channel and passes `status` on, like EOF.
+  void Finish(ssize_t status);
+
+  const size_t max_frame_length_;
+  // The bytes of incomplete frames. Messages are deserialized before JS is
+  // called, so nothing refers to these afterwards.
+  std::unique_ptr<char[]> buffer_;
+  size_t capacity_ = 0;
+  size_t begin_ = 0;  // Where the first incomplete frame starts.
+  size_t end_ = 0;
+  std::vector<PendingHandle> pending_handles_;
+};
+
+void IPCChannel::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsNumber());
+  StreamBase* stream = StreamBase::FromObject(args[0].As<Object>());
+  CHECK_NOT_NULL(stream);
+
+  const int64_t max_frame_length = args[1].As<Integer>()->Value();
+  if (max_frame_length <= 0 ||
+      max_frame_length > std::numeric_limits<uint32_t>::max()) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The maximum frame length must be between 1 and 2^32 - 1");
+  }
+
+  IPCChannel* channel = new IPCChannel(
+      env, args.This(), static_cast<size_t>(max_frame_length));
+  stream->PushStreamListener(channel);
+
+  // Keep the channel alive for as long as the stream is, like a StreamPipe.
+  if (channel->object()->Set(env->context(),
+                             env->source_string(),
+                             stream->GetObject()).IsNothing()) {
+    return;
+  }
+  USE(stream->GetObject()->Set(
+      env->context(), env->pipe_target_string(), channel->object()));
+}
+
+void IPCChannel::WriteMessages(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  IPCChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsArray());
+  if (channel->stream() == nullptr)
+    return args.GetReturnValue().Set(UV_EINVAL);
+  StreamBase* stream = channel->stream_base();
+  Local<Object> req_wrap_obj = args[0].As<Object>();
+  Local<Array> messages = args[1].As<Array>();
+
+  std::vector<std::pair<uint8_t*, size_t>> payloads;
+  auto free_payloads = OnScopeLeave([&]() {
+    for (const auto& payload : payloads) free(payload.first);
+  });
+  size_t total = 0;
+  const uint32_t count = messages->Length();
+  payloads.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Local<Value> message;
+    if (!messages->Get(context, i).ToLocal(&message)) return;
+    ValueSerializer serializer(isolate);
+    serializer.WriteHeader();
+    if (serializer.WriteValue(context, message).IsNothing()) return;
+    payloads.push_back(serializer.Release());
+    if (payloads.back().second > channel->max_frame_length_) {
+      return THROW_ERR_OUT_OF_RANGE(
+          env, "A message is longer than the maximum frame length");
+    }
+    total += ipc_frame::kHeaderSize + payloads.back().second;
+  }
+
+  std::shared_ptr<BackingStore> store;
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    store = ArrayBuffer::NewBackingStore(isolate, total);
+  }
+  char* out = static_cast<char*>(store->Data());
+  for (const auto& payload : payloads) {
+    ipc_frame::WriteHeader(out, static_cast<uint32_t>(payload.second));
+    out += ipc_frame::kHeaderSize;
+    memcpy(out, payload.first, payload.second);
+    out += payload.second;
+  }
+
+  uv_stream_t* send_handle = nullptr;
+  if (args[2]->IsObject() && stream->IsIPCPipe()) {
+    Local<Object> send_handle_obj = args[2].As<Object>();
+    HandleWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, send_handle_obj);
+    send_handle = reinterpret_cast<uv_stream_t*>(wrap->GetHandle());
+    // Keep the handle alive until the write is done, like writeBuffer().
+    if (req_wrap_obj->Set(context, env->handle_string(), send_handle_obj)
+            .IsNothing()) {
+      return;
+    }
+  }
+
+  uv_buf_t buf = uv_buf_init(static_cast<char*>(store->Data()), total);
+  StreamWriteResult res = stream->Write(&buf, 1, send_handle, req_wrap_obj);
+  stream->SetWriteResult(res);
+  if (res.wrap != nullptr &&
+      req_wrap_obj->Set(context,
+                        env->buffer_string(),
+                        ArrayBuffer::New(isolate, std::move(store)))
+          .IsNothing()) {
+    return;
+  }
+  args.GetReturnValue().Set(res.err);
+}
+
+void IPCChannel::Detach(const FunctionCallbackInfo<Value>& args) {
+  IPCChannel* channel;
+  ASSIGN_OR_RETURN_UNWRAP(&channel, args.Holder());
+  if (channel->stream() != nullptr)
+    channel->stream()->RemoveStreamListener(channel);
+}
+
+uv_buf_t IPCChannel::OnStreamAlloc(size_t suggested_size) {
+  const size_t rest = end_ - begin_;
+  // Make room for all of the frame that is being read, if it is longer.
+  size_t want = suggested_size;
+  size_t payload_length;
+  if (rest >= ipc_frame::kHeaderSize &&
+      ipc_frame::Parse(buffer_.get() + begin_,
+                       rest,
+                       max_frame_length_,
+                       &payload_length) ==
+          ipc_frame::ParseResult::kIncomplete) {
+    want = std::max(want, ipc_frame::kHeaderSize + payload_length - rest);
+  }
+  if (capacity_ - end_ >= want)
+    return uv_buf_init(buffer_.get() + end_, capacity_ - end_);
+
+  // Move the rest to the front, and into a new buffer if this one is too
+  // small, or much larger than needed after a long frame.
+  if (capacity_ - rest >= want && capacity_ <= 4 * (rest + want)) {
+    memmove(buffer_.get(), buffer_.get() + begin_, rest);
+  } else {
+    std::unique_ptr<char[]> buffer(new char[rest + want]);
+    if (rest > 0) memcpy(buffer.get(), buffer_.get() + begin_, rest);
+    buffer_ = std::move(buffer);
+    capacity_ = rest + want;
+  }
+  for (PendingHandle& pending : pending_handles_)
+    pending.offset = pending.offset > begin_ ? pending.offset - begin_ : 0;
+  begin_ = 0;
+  end_ = rest;
+  return uv_buf_init(buffer_.get() + end_, capacity_ - end_);
+}
+
+void IPCChannel::TakePendingHandle(size_t offset) {
+  Local<Object> stream_obj = stream_base()->GetObject();
+  Local<Value> handle;
+  if (!stream_obj->Get(env()->context(), env()->pending_handle_string())
+           .ToLocal(&handle) ||
+      !handle->IsObject()) {
+    return;
+  }
+  if (stream_obj->Set(env()->context(),
+                      env()->pending_handle_string(),
+                      Undefined(env()->isolate())).IsNothing()) {
+    return;
+  }
+  pending_handles_.push_back(
+      PendingHandle { Global<Object>(env()->isolate(), handle.As<Object>()),
+                      offset });
+}
+
+void IPCChannel::OnStreamRead(ssize_t nread, const uv_buf_t& buf) {
+  if (nread < 0) return Finish(nread);
+  if (nread == 0) return;
+
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Local<Context> context = env()->context();
+  Context::Scope context_scope(context);
+
+  CHECK_EQ(buf.base, buffer_.get() + end_);
+  TakePendingHandle(end_);
+  end_ += nread;
+
+  std::vector<Local<Value>> messages;
+  std::vector<Local<Value>> handles;
+  ssize_t status = 0;
+  for (;;) {
+    size_t payload_length;
+    const ipc_frame::ParseResult result =
+        ipc_frame::Parse(buffer_.get() + begin_,
+                         end_ - begin_,
+                         max_frame_length_,
+                         &payload_length);
+    if (result == ipc_frame::ParseResult::kIncomplete) break;
+    if (result == ipc_frame::ParseResult::kTooLong) {
+      status = UV_EPROTO;
+      break;
+    }
+
+    const size_t frame_start = begin_;
+    begin_ += ipc_frame::kHeaderSize + payload_length;
+    Local<Value> message;
+    {
+      TryCatchScope try_catch(env());
+      ValueDeserializer deserializer(
+          isolate,
+          reinterpret_cast<const uint8_t*>(buffer_.get() + frame_start) +
+              ipc_frame::kHeaderSize,
+          payload_length);
+      if (deserializer.ReadHeader(context).IsNothing() ||
+          !deserializer.ReadValue(context).ToLocal(&message)) {
+        if (try_catch.HasTerminated()) return;
+        status = UV_EPROTO;
+        break;
+      }
+    }
+    if (!pending_handles_.empty() &&
+        frame_start >= pending_handles_.front().offset) {
+      handles.push_back(Integer::New(isolate, messages.size()));
+      handles.push_back(pending_handles_.front().handle.Get(isolate));
+      pending_handles_.erase(pending_handles_.begin());
+    }
+    messages.push_back(message);
+  }
+
+  if (status != 0) {
+    BaseObjectPtr<IPCChannel> strong_ref{this};
+    if (!messages.empty()) Emit(messages, handles);
+    if (stream() != nullptr) Finish(status);
+    return;
+  }
+  if (!messages.empty()) Emit(messages, handles);
+}
+
+void IPCChannel::Emit(const std::vector<Local<Value>>& messages,
+                      const std::vector<Local<Value>>& handles) {
+  Isolate* isolate = env()->isolate();
+  Local<Value> argv[] = {
+    Array::New(isolate, const_cast<Local<Value>*>(messages.data()),
+               messages.size()),
+    handles.empty()
+        ? Undefined(isolate).As<Value>()
+        : Array::New(isolate, const_cast<Local<Value>*>(handles.data()),
+                     handles.size()).As<Value>()
+  };
+  MakeCallback(env()->onmessagebatch_string(), arraysize(argv), argv);
+}
+
+void IPCChannel::Finish(ssize_t status) {
+  BaseObjectPtr<IPCChannel> strong_ref{this};
+  StreamListener* previous = previous_listener_;
+  stream()->RemoveStreamListener(this);
+  previous->OnStreamRead(status, uv_buf_init(nullptr, 0));
+}
+
+void IPCChannel::Initialize(Local<Object> target,
+                            Local<Value> unused,
+                            Local<Context> context,
+                            void* priv) {
+  Environment* env = Environment::GetCurrent(context);
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      IPCChannel::kInternalFieldCount);
+  env->SetProtoMethod(t, "writeMessages", WriteMessages);
+  env->SetProtoMethod(t, "detach", Detach);
+  env->SetConstructorFunction(target, "IPCChannel", t);
+}
+
+void IPCChannel::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(WriteMessages);
+  registry->Register(Detach);
+}
+
+}  // anonymous namespace
+
+}  // namespace node
+
+NODE_MODULE_CONTEXT_AWARE_INTERNAL(stream_ipc_channel,
+                                   node::IPCChannel::Initialize)
+NODE_MODULE_EXTERNAL_REFERENCE(stream_ipc_channel,
+                               node::IPCChannel::RegisterExternalReferences)
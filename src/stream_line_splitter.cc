@@ -0,0 +1,252 @@
+#include "async_wrap-inl.h"
+#include "env-inl.h"
+#include "line_splitter.h"
+#include "memory_tracker-inl.h"
+#include "node_buffer.h"
+#include "node_errors.h"
+#include "node_external_reference.h"
+#include "stream_base-inl.h"
+#include "util-inl.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace node {
+
+using v8::ArrayBuffer;
+using v8::BackingStore;
+using v8::Context;
+using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Integer;
+using v8::Isolate;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::Uint32;
+using v8::Uint32Array;
+using v8::Value;
+
+namespace {
+
+// new StreamLineSplitter(stream, delimiter, maxLineLength) takes over the
+// reads of a StreamBase and splits them into lines in C++. For each read
+// that completes lines, it calls `onlines(buffer, lines, dropped)` on
+// itself. `lines` is a Uint32Array with the start and end offset of each
+// line in `buffer`, without the delimiter. `dropped` counts the lines that
+// were longer than `maxLineLength` and were skipped. A line that spans
+// reads is moved to the front of the next one, so that it is contiguous.
+//
+// The handle is still started and stopped with readStart() and readStop().
+// On EOF or an error, the unterminated rest is reported as a last line, the
+// splitter detaches, and the status goes on to the listener before it, so
+// that the stream ends as usual. detach() returns the unterminated rest, if
+// there is one, and gives the reads back to JS.
+class StreamLineSplitter final : public AsyncWrap, public StreamListener {
+ public:
+  static void Initialize(Local<Object> target,
+                         Local<Value> unused,
+                         Local<Context> context,
+                         void* priv);
+  static void RegisterExternalReferences(ExternalReferenceRegistry* registry);
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+  static void Detach(const FunctionCallbackInfo<Value>& args);
+
+  uv_buf_t OnStreamAlloc(size_t suggested_size) override;
+  void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("buffer",
+                                store_ ? store_->ByteLength() : 0);
+    tracker->TrackField("lines", lines_);
+  }
+  SET_MEMORY_INFO_NAME(StreamLineSplitter)
+  SET_SELF_SIZE(StreamLineSplitter)
+
+ private:
+  StreamLineSplitter(Environment* env,
+                     Local<Object> object,
+                     char delimiter,
+                     size_t max_line_length)
+      : AsyncWrap(env, object, PROVIDER_LINESPLITTER),
+        splitter_(delimiter, max_line_length) {
+    MakeWeak();
+  }
+
+  // Calls `onlines` with `length` bytes from `start` in store_.
+  void Emit(size_t start, size_t length, size_t dropped);
+
+  LineSplitter splitter_;
+  // What has been read. The part before begin_ may be in use by JS, so only
+  // the part after end_ is read into again.
+  std::shared_ptr<BackingStore> store_;
+  size_t begin_ = 0;  // Where the unterminated rest starts.
+  size_t end_ = 0;
+  std::vector<uint32_t> lines_;
+};
+
+void StreamLineSplitter::New(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  CHECK(args.IsConstructCall());
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsUint32());
+  CHECK(args[2]->IsNumber());
+  StreamBase* stream = StreamBase::FromObject(args[0].As<Object>());
+  CHECK_NOT_NULL(stream);
+
+  const uint32_t delimiter = args[1].As<Uint32>()->Value();
+  CHECK_LE(delimiter, 0xff);
+  const int64_t max_line_length = args[2].As<Integer>()->Value();
+  if (max_line_length <= 0 ||
+      max_line_length >= std::numeric_limits<uint32_t>::max()) {
+    return THROW_ERR_OUT_OF_RANGE(
+        env, "The maximum line length must be between 1 and 2^32 - 2");
+  }
+
+  StreamLineSplitter* splitter =
+      new StreamLineSplitter(env,
+                             args.This(),
+                             static_cast<char>(delimiter),
+                             static_cast<size_t>(max_line_length));
+  stream->PushStreamListener(splitter);
+
+  // Keep the splitter alive for as long as the stream is, like a StreamPipe.
+  if (splitter->object()->Set(env->context(),
+                              env->source_string(),
+                              stream->GetObject()).IsNothing()) {
+    return;
+  }
+  USE(stream->GetObject()->Set(
+      env->context(), env->pipe_target_string(), splitter->object()));
+}
+
+void StreamLineSplitter::Detach(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  StreamLineSplitter* splitter;
+  ASSIGN_OR_RETURN_UNWRAP(&splitter, args.Holder());
+  if (splitter->stream() != nullptr)
+    splitter->stream()->RemoveStreamListener(splitter);
+
+  const size_t rest = splitter->end_ - splitter->begin_;
+  if (rest == 0) return;
+  Local<Object> buffer;
+  if (!Buffer::Copy(env,
+                    static_cast<char*>(splitter->store_->Data()) +
+                        splitter->begin_,
+                    rest).ToLocal(&buffer)) {
+    return;
+  }
+  splitter->begin_ = splitter->end_;
+  args.GetReturnValue().Set(buffer);
+}
+
+uv_buf_t StreamLineSplitter::OnStreamAlloc(size_t suggested_size) {
+  const size_t rest = end_ - begin_;
+  if (!store_ || store_->ByteLength() - end_ < suggested_size / 2) {
+    // Leave at least as much room as the rest takes up, so that a long line
+    // is moved only O(log n) times.
+    const size_t size = rest + std::max(suggested_size, rest);
+    std::shared_ptr<BackingStore> store;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+      store = ArrayBuffer::NewBackingStore(env()->isolate(), size);
+    }
+    if (rest > 0) {
+      memcpy(store->Data(),
+             static_cast<char*>(store_->Data()) + begin_,
+             rest);
+    }
+    store_ = std::move(store);
+    begin_ = 0;
+    end_ = rest;
+  }
+  return uv_buf_init(static_cast<char*>(store_->Data()) + end_,
+                     store_->ByteLength() - end_);
+}
+
+void StreamLineSplitter::OnStreamRead(ssize_t nread, const uv_buf_t& buf) {
+  const size_t carried = end_ - begin_;
+  if (nread < 0) {
+    BaseObjectPtr<StreamLineSplitter> strong_ref{this};
+    StreamResource* stream = this->stream();
+    StreamListener* previous = previous_listener_;
+    stream->RemoveStreamListener(this);
+    if (carried > 0 && !splitter_.dropping()) {
+      lines_.assign({0, static_cast<uint32_t>(carried)});
+      begin_ = end_;
+      Emit(end_ - carried, carried, splitter_.TakeDropped());
+    }
+    previous->OnStreamRead(nread, uv_buf_init(nullptr, 0));
+    return;
+  }
+  if (nread == 0) return;
+
+  CHECK_EQ(buf.base, static_cast<char*>(store_->Data()) + end_);
+  end_ += nread;
+  const size_t start = begin_;
+  lines_.clear();
+  begin_ += splitter_.Split(static_cast<char*>(store_->Data()) + start,
+                            end_ - start,
+                            carried,
+                            &lines_);
+  const size_t dropped = splitter_.TakeDropped();
+  if (!lines_.empty() || dropped > 0)
+    Emit(start, lines_.empty() ? 0 : lines_.back(), dropped);
+}
+
+void StreamLineSplitter::Emit(size_t start, size_t length, size_t dropped) {
+  Isolate* isolate = env()->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env()->context());
+
+  Local<Object> buffer;
+  if (!Buffer::New(isolate, ArrayBuffer::New(isolate, store_), start, length)
+           .ToLocal(&buffer)) {
+    return;
+  }
+  Local<ArrayBuffer> ab =
+      ArrayBuffer::New(isolate, lines_.size() * sizeof(uint32_t));
+  if (!lines_.empty()) {
+    memcpy(ab->GetBackingStore()->Data(),
+           lines_.data(),
+           lines_.size() * sizeof(uint32_t));
+  }
+  Local<Value> argv[] = {
+    buffer,
+    Uint32Array::New(ab, 0, lines_.size()),
+    Number::New(isolate, static_cast<double>(dropped))
+  };
+  MakeCallback(env()->onlines_string(), arraysize(argv), argv);
+}
+
+void StreamLineSplitter::Initialize(Local<Object> target,
+                                    Local<Value> unused,
+                                    Local<Context> context,
+                                    void* priv) {
+  Environment* env = Environment::GetCurrent(context);
+  Local<FunctionTemplate> t = env->NewFunctionTemplate(New);
+  t->Inherit(AsyncWrap::GetConstructorTemplate(env));
+  t->InstanceTemplate()->SetInternalFieldCount(
+      StreamLineSplitter::kInternalFieldCount);
+  env->SetProtoMethod(t, "detach", Detach);
+  env->SetConstructorFunction(target, "StreamLineSplitter", t);
+}
+
+void StreamLineSplitter::RegisterExternalReferences(
+    ExternalReferenceRegistry* registry) {
+  registry->Register(New);
+  registry->Register(Detach);
+}
+
+}  // anonymous namespace
+
+}  // namespace node
+
+NODE_MODULE_CONTEXT_AWARE_INTERNAL(stream_line_splitter,
+                                   node::StreamLineSplitter::Initialize)
+NODE_MODULE_EXTERNAL_REFERENCE(
+    stream_line_splitter,
+    node::StreamLineSplitter::RegisterExternalReferences)
@@ -1,10 +1,18 @@
 #include "stream_pipe.h"
 #include "stream_base-inl.h"
+#include "stream_wrap.h"
 #include "node_buffer.h"
 #include "util-inl.h"
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace node {
 
+using v8::ArrayBuffer;
+using v8::ArrayBufferView;
 using v8::BackingStore;
 using v8::Context;
 using v8::Function;
@@ -67,6 +75,206 @@ StreamBase* StreamPipe::sink() {
   return static_cast<StreamBase*>(writable_listener_.stream());
 }
 
+#ifdef __linux__
+class StreamPipe::Splicer {
+ public:
+  // Takes ownership of `source_fd` and `sink_fd`, which have to be dup()s of
+  // the streams' own descriptors so that they can be polled separately.
+  Splicer(StreamPipe* pipe, int source_fd, int sink_fd)
+      : pipe_(pipe), source_fd_(source_fd), sink_fd_(sink_fd) {}
+
+  // Returns false if splicing is not possible, in which case the caller has
+  // to delete the Splicer again.
+  bool Start(uv_loop_t* loop) {
+    if (pipe2(pipe_fds_, O_CLOEXEC | O_NONBLOCK) != 0) return false;
+    if (uv_poll_init(loop, &source_poll_, source_fd_) != 0) return false;
+    source_poll_.data = this;
+    open_handles_++;
+    if (uv_poll_init(loop, &sink_poll_, sink_fd_) != 0) return false;
+    sink_poll_.data = this;
+    open_handles_++;
+    return uv_poll_start(&source_poll_, UV_READABLE, OnReadable) == 0;
+  }
+
+  // Writes whatever is still buffered in the kernel pipe to `sink` through
+  // the regular StreamBase write path, then deletes the Splicer once libuv
+  // has let go of its handles. `sink` may be nullptr if it is gone already.
+  void Close(StreamBase* sink) {
+    pipe_ = nullptr;
+    if (buffered_ > 0 && sink != nullptr) FlushToStream(sink);
+
+    if (open_handles_ == 0) return delete this;
+    auto on_close = [](uv_handle_t* handle) {
+      Splicer* splicer = static_cast<Splicer*>(handle->data);
+      if (--splicer->open_handles_ == 0) delete splicer;
+    };
+    // uv_poll_init() failures leave the handle unregistered.
+    uv_close(reinterpret_cast<uv_handle_t*>(&source_poll_), on_close);
+    if (open_handles_ == 2)
+      uv_close(reinterpret_cast<uv_handle_t*>(&sink_poll_), on_close);
+  }
+
+  ~Splicer() {
+    for (int fd : { source_fd_, sink_fd_, pipe_fds_[0], pipe_fds_[1] }) {
+      if (fd != -1) close(fd);
+    }
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 64 * 1024;
+  static constexpr unsigned int kFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+  static void OnReadable(uv_poll_t* handle, int status, int events) {
+    Splicer* splicer = static_cast<Splicer*>(handle->data);
+    if (status != 0) return splicer->Done(status);
+
+    ssize_t n;
+    do {
+      n = splice(splicer->source_fd_, nullptr, splicer->pipe_fds_[1], nullptr,
+                 kChunkSize, kFlags);
+    } while (n == -1 && errno == EINTR);
+
+    if (n == 0) return splicer->Done(UV_EOF);
+    if (n == -1) {
+      if (errno == EAGAIN) return;
+      return splicer->Done(-errno);
+    }
+
+    splicer->buffered_ += n;
+    splicer->pipe_->source()->AddBytesRead(n);
+    splicer->Drain();
+  }
+
+  static void OnWritable(uv_poll_t* handle, int status, int events) {
+    Splicer* splicer = static_cast<Splicer*>(handle->data);
+    if (status != 0) return splicer->Done(status);
+    splicer->Drain();
+  }
+
+  // Moves data from the kernel pipe to the sink. When the sink cannot take
+  // all of it, waits for it to become writable instead of reading more.
+  void Drain() {
+    while (buffered_ > 0) {
+      ssize_t n = splice(pipe_fds_[0], nullptr, sink_fd_, nullptr,
+                         buffered_, kFlags);
+      if (n == -1 && errno == EINTR) continue;
+      if (n == -1 && errno == EAGAIN) {
+        uv_poll_stop(&source_poll_);
+        uv_poll_start(&sink_poll_, UV_WRITABLE, OnWritable);
+        return;
+      }
+      // Write errors end the pipe, like a destroyed sink does. The sink
+      // reports the error on its own the next time it is used.
+      if (n <= 0) return Done(0);
+      buffered_ -= n;
+      pipe_->sink()->AddBytesWritten(n);
+    }
+    uv_poll_stop(&sink_poll_);
+    uv_poll_start(&source_poll_, UV_READABLE, OnReadable);
+  }
+
+  void FlushToStream(StreamBase* sink) {
+    std::unique_ptr<BackingStore> bs;
+    {
+      NoArrayBufferZeroFillScope no_zero_fill_scope(
+          sink->stream_env()->isolate_data());
+      bs = ArrayBuffer::NewBackingStore(sink->stream_env()->isolate(),
+                                        buffered_);
+    }
+    ssize_t n;
+    do {
+      n = read(pipe_fds_[0], bs->Data(), buffered_);
+    } while (n == -1 && errno == EINTR);
+    buffered_ = 0;
+    if (n <= 0) return;
+
+    uv_buf_t buf = uv_buf_init(static_cast<char*>(bs->Data()), n);
+    StreamWriteResult res = sink->Write(&buf, 1);
+    if (res.async) res.wrap->SetBackingStore(std::move(bs));
+  }
+
+  void Done(int status) {
+    uv_poll_stop(&source_poll_);
+    uv_poll_stop(&sink_poll_);
+    if (pipe_ != nullptr) pipe_->OnSpliceDone(status);
+  }
+
+  StreamPipe* pipe_;
+  int source_fd_;
+  int sink_fd_;
+  int pipe_fds_[2] = { -1, -1 };
+  size_t buffered_ = 0;  // Bytes in the kernel pipe.
+  uv_poll_t source_poll_;
+  uv_poll_t sink_poll_;
+  int open_handles_ = 0;
+};
+
+// Splicing bypasses the listeners of both streams, so it is only used when
+// nobody but the JS layer is attached to either of them (i.e. no TLS, HTTP/2
+// or other native consumer), and when the sink has no writes queued that
+// spliced data could overtake.
+bool StreamPipe::StartSplicing() {
+  Local<FunctionTemplate> libuv_stream =
+      env()->libuv_stream_wrap_ctor_template();
+  if (libuv_stream.IsEmpty() ||
+      !libuv_stream->HasInstance(source()->GetObject()) ||
+      !libuv_stream->HasInstance(sink()->GetObject()) ||
+      !source()->IsDefaultListener(readable_listener_.previous_listener()) ||
+      !sink()->IsDefaultListener(writable_listener_.previous_listener())) {
+    return false;
+  }
+
+  LibuvStreamWrap* source_wrap =
+      LibuvStreamWrap::From(env(), source()->GetObject());
+  LibuvStreamWrap* sink_wrap =
+      LibuvStreamWrap::From(env(), sink()->GetObject());
+  for (LibuvStreamWrap* wrap : { source_wrap, sink_wrap }) {
+    if (!wrap->IsAlive() || wrap->IsClosing() || wrap->is_named_pipe_ipc() ||
+        !(wrap->is_tcp() || wrap->is_named_pipe())) {
+      return false;
+    }
+  }
+  if (sink_wrap->write_queue_size() != 0)
+    return false;
+
+  int source_fd = source_wrap->GetFD();
+  int sink_fd = sink_wrap->GetFD();
+  if (source_fd < 0 || sink_fd < 0) return false;
+  source_fd = fcntl(source_fd, F_DUPFD_CLOEXEC, 0);
+  sink_fd = source_fd < 0 ? -1 : fcntl(sink_fd, F_DUPFD_CLOEXEC, 0);
+  if (sink_fd < 0) {
+    if (source_fd >= 0) close(source_fd);
+    return false;
+  }
+
+  Splicer* splicer = new Splicer(this, source_fd, sink_fd);
+  if (!splicer->Start(env()->event_loop())) {
+    splicer->Close(nullptr);
+    return false;
+  }
+  splicer_ = splicer;
+  is_reading_ = true;
+  return true;
+}
+
+void StreamPipe::OnSpliceDone(int status) {
+  HandleScope handle_scope(env()->isolate());
+  Context::Scope context_scope(env()->context());
+  InternalCallbackScope callback_scope(this,
+      InternalCallbackScope::kSkipTaskQueues);
+  if (status == 0) {
+    Unpipe();
+  } else {
+    // This takes care of shutting down the sink and calling Unpipe().
+    readable_listener_.OnStreamRead(status, uv_buf_init(nullptr, 0));
+  }
+}
+#else
+bool StreamPipe::StartSplicing() {
+  return false;
+}
+#endif  // __linux__
+
 void StreamPipe::Unpipe(bool is_in_deletion) {
   if (is_closed_)
     return;
@@ -79,9 +287,17 @@ void StreamPipe::Unpipe(bool is_in_deletion) {
 
   is_closed_ = true;
   is_reading_ = false;
+  StreamBase* sink = this->sink();
   source()->RemoveStreamListener(&readable_listener_);
   if (pending_writes_ == 0)
-    sink()->RemoveStreamListener(&writable_listener_);
+    sink->RemoveStreamListener(&writable_listener_);
+
+#ifdef __linux__
+  if (splicer_ != nullptr) {
+    splicer_->Close(sink_destroyed_ || is_in_deletion ? nullptr : sink);
+    splicer_ = nullptr;
+  }
+#endif
 
   if (is_in_deletion) return;
 
@@ -136,7 +352,8 @@ uv_buf_t StreamPipe::ReadableListener::OnStreamAlloc(size_t suggested_size) {
 void StreamPipe::ReadableListener::OnStreamRead(ssize_t nread,
                                                 const uv_buf_t& buf_) {
   StreamPipe* pipe = ContainerOf(&StreamPipe::readable_listener_, this);
-  std::unique_ptr<BackingStore> bs = pipe->env()->release_managed_buffer(buf_);
+  std::unique_ptr<BackingStore> bs =
+      pipe->env()->release_managed_buffer(buf_, nread > 0 ? nread : 0);
   if (nread < 0) {
     // EOF or error; stop reading and pass the error to the previous listener
     // (which might end up in JS).
@@ -268,13 +485,34 @@ void StreamPipe::New(const FunctionCallbackInfo<Value>& args) {
   StreamBase* source = StreamBase::FromObject(args[0].As<Object>());
   StreamBase* sink = StreamBase::FromObject(args[1].As<Object>());
 
-  new StreamPipe(source, sink, args.This());
+  StreamPipe* pipe = new StreamPipe(source, sink, args.This());
+  if (args[2]->IsArrayBufferView()) {
+    // Data that was read from the source before piping started, e.g. by
+    // TCPWrap::PeekClientHello(), and that is written to the sink first.
+    Local<ArrayBufferView> prefix = args[2].As<ArrayBufferView>();
+    size_t length = prefix->ByteLength();
+    if (length > 0) {
+      pipe->prefix_ =
+          ArrayBuffer::NewBackingStore(pipe->env()->isolate(), length);
+      prefix->CopyContents(pipe->prefix_->Data(), length);
+    }
+  }
 }
 
 void StreamPipe::Start(const FunctionCallbackInfo<Value>& args) {
   StreamPipe* pipe;
   ASSIGN_OR_RETURN_UNWRAP(&pipe, args.Holder());
   pipe->is_closed_ = false;
+  if (pipe->prefix_) {
+    // Reading is held off until the prefix has been written. If that happens
+    // asynchronously, OnStreamAfterWrite() takes it from there.
+    size_t length = pipe->prefix_->ByteLength();
+    pipe->is_reading_ = true;
+    pipe->ProcessData(length, std::move(pipe->prefix_));
+    if (pipe->pending_writes_ > 0 || pipe->is_closed_) return;
+    pipe->is_reading_ = false;
+  }
+  if (pipe->StartSplicing()) return;
   pipe->writable_listener_.OnStreamWantsWrite(65536);
 }
 
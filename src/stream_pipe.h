@@ -47,17 +47,31 @@ class StreamPipe : public AsyncWrap {
   // `OnStreamWantsWrite()` support.
   size_t wanted_data_ = 0;
 
+  // Written to the sink before anything is read from the source.
+  std::unique_ptr<v8::BackingStore> prefix_;
+
   void ProcessData(size_t nread, std::unique_ptr<v8::BackingStore> bs);
 
+  // Moves data through a kernel pipe with splice(2) instead of reading it
+  // into memory, when both ends are plain libuv streams. Only on Linux.
+  class Splicer;
+  bool StartSplicing();
+  void OnSpliceDone(int status);
+  Splicer* splicer_ = nullptr;
+
   class ReadableListener : public StreamListener {
    public:
     uv_buf_t OnStreamAlloc(size_t suggested_size) override;
     void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
     void OnStreamDestroy() override;
+
+    StreamListener* previous_listener() const { return previous_listener_; }
   };
 
   class WritableListener : public StreamListener {
    public:
+    StreamListener* previous_listener() const { return previous_listener_; }
+
     uv_buf_t OnStreamAlloc(size_t suggested_size) override;
     void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override;
     void OnStreamAfterWrite(WriteWrap* w, int status) override;
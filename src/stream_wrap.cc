@@ -29,27 +29,32 @@
 #include "pipe_wrap.h"
 #include "req_wrap-inl.h"
 #include "tcp_wrap.h"
+#include "timer_wrap-inl.h"
 #include "udp_wrap.h"
 #include "util-inl.h"
 
 #include <cstring>  // memcpy()
 #include <climits>  // INT_MAX
+#include <limits>
 
 
 namespace node {
 
+using v8::ArrayBuffer;
 using v8::Context;
 using v8::DontDelete;
 using v8::EscapableHandleScope;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
+using v8::Integer;
 using v8::Local;
 using v8::MaybeLocal;
 using v8::Object;
 using v8::PropertyAttribute;
 using v8::ReadOnly;
 using v8::Signature;
+using v8::Uint32;
 using v8::Value;
 
 void IsConstructCallCallback(const FunctionCallbackInfo<Value>& args) {
@@ -108,6 +113,9 @@ void LibuvStreamWrap::RegisterExternalReferences(
   registry->Register(IsConstructCallCallback);
   registry->Register(GetWriteQueueSize);
   registry->Register(SetBlocking);
+  registry->Register(SetWriteCoalescing);
+  registry->Register(SetMemoryBudget);
+  registry->Register(GetMemoryBudgetUsage);
   // TODO(joyee): StreamBase::RegisterExternalReferences() is called somewhere
   // else but we may want to do it here too and guard it with a static flag.
 }
@@ -121,7 +129,8 @@ LibuvStreamWrap::LibuvStreamWrap(Environment* env,
                  reinterpret_cast<uv_handle_t*>(stream),
                  provider),
       StreamBase(env),
-      stream_(stream) {
+      stream_(stream),
+      coalesce_limit_(env->options()->stream_write_coalescing) {
   StreamBase::AttachToObject(object);
 }
 
@@ -147,6 +156,10 @@ Local<FunctionTemplate> LibuvStreamWrap::GetConstructorTemplate(
         Local<FunctionTemplate>(),
         static_cast<PropertyAttribute>(ReadOnly | DontDelete));
     env->SetProtoMethod(tmpl, "setBlocking", SetBlocking);
+    env->SetProtoMethod(tmpl, "setWriteCoalescing", SetWriteCoalescing);
+    env->SetProtoMethod(tmpl, "setMemoryBudget", SetMemoryBudget);
+    env->SetProtoMethodNoSideEffect(
+        tmpl, "getMemoryBudgetUsage", GetMemoryBudgetUsage);
     StreamBase::AddMethods(env, tmpl);
     env->set_libuv_stream_wrap_ctor_template(tmpl);
   }
@@ -194,6 +207,14 @@ bool LibuvStreamWrap::IsIPCPipe() {
 
 
 int LibuvStreamWrap::ReadStart() {
+  wants_read_ = true;
+  if (memory_budget_ && memory_budget_->exceeded())
+    return 0;
+  return StartReading();
+}
+
+
+int LibuvStreamWrap::StartReading() {
   return uv_read_start(stream(), [](uv_handle_t* handle,
                                     size_t suggested_size,
                                     uv_buf_t* buf) {
@@ -205,6 +226,7 @@ int LibuvStreamWrap::ReadStart() {
 
 
 int LibuvStreamWrap::ReadStop() {
+  wants_read_ = false;
   return uv_read_stop(stream());
 }
 
@@ -258,6 +280,9 @@ void LibuvStreamWrap::OnUvRead(ssize_t nread, const uv_buf_t* buf) {
   if (nread > 0) {
     MaybeLocal<Object> pending_obj;
 
+    if (server_counters_)
+      (*server_counters_)->bytes_read += nread;
+
     if (type == UV_TCP) {
       pending_obj = AcceptHandle<TCPWrap>(env(), this);
     } else if (type == UV_NAMED_PIPE) {
@@ -291,11 +316,16 @@ void LibuvStreamWrap::GetWriteQueueSize(
     return;
   }
 
-  uint32_t write_queue_size = wrap->stream()->write_queue_size;
+  uint32_t write_queue_size = wrap->write_queue_size();
   info.GetReturnValue().Set(write_queue_size);
 }
 
 
+size_t LibuvStreamWrap::write_queue_size() const {
+  return stream()->write_queue_size + coalesced_bytes_;
+}
+
+
 void LibuvStreamWrap::SetBlocking(const FunctionCallbackInfo<Value>& args) {
   LibuvStreamWrap* wrap;
   ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
@@ -308,6 +338,139 @@ void LibuvStreamWrap::SetBlocking(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(uv_stream_set_blocking(wrap->stream(), enable));
 }
 
+
+void LibuvStreamWrap::SetWriteCoalescing(
+    const FunctionCallbackInfo<Value>& args) {
+  LibuvStreamWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+
+  // setWriteCoalescing(bytes[, delayMs[, lineBuffered]])
+  CHECK(args[0]->IsUint32());
+  // The buffer is sized for the old limit, so send off what it holds.
+  wrap->FlushCoalescedWrites();
+  wrap->coalesce_store_.reset();
+  wrap->coalesce_limit_ = args[0].As<Uint32>()->Value();
+  wrap->coalesce_delay_ =
+      args[1]->IsUint32() ? args[1].As<Uint32>()->Value() : 0;
+  wrap->coalesce_lines_ = args[2]->IsTrue();
+
+  if (wrap->coalesce_delay_ > 0 && !wrap->coalesce_timer_) {
+    wrap->coalesce_timer_ = std::make_unique<TimerWrapHandle>(
+        wrap->env(), [wrap]() {
+          HandleScope scope(wrap->env()->isolate());
+          Context::Scope context_scope(wrap->env()->context());
+          wrap->coalesce_timer_armed_ = false;
+          wrap->FlushCoalescedWrites();
+        });
+    // Pending data is written out when the stream closes, so it does not
+    // need to keep the loop alive.
+    wrap->coalesce_timer_->Unref();
+  }
+}
+
+
+void LibuvStreamWrap::SetMemoryBudget(size_t high_watermark,
+                                      size_t low_watermark,
+                                      std::shared_ptr<MemoryBudget> parent) {
+  // A high watermark of 0 turns the limit off. The budget itself stays, as
+  // listeners may have charged it.
+  if (high_watermark == 0)
+    high_watermark = low_watermark = std::numeric_limits<size_t>::max();
+  if (memory_budget_) {
+    CHECK(!parent || parent == memory_budget_->parent());
+    memory_budget_->SetWatermarks(high_watermark, low_watermark);
+    return;
+  }
+  memory_budget_ = std::make_unique<MemoryBudget>(
+      high_watermark, low_watermark, std::move(parent), [this](bool exceeded) {
+        OnMemoryBudgetChange(exceeded);
+      });
+  UpdateWriteCharge();
+  // The budget may start out exceeded, because of its parent.
+  if (memory_budget_->exceeded())
+    OnMemoryBudgetChange(true);
+}
+
+
+void LibuvStreamWrap::UpdateWriteCharge() {
+  if (!memory_budget_) return;
+  const size_t queued = write_queue_size();
+  if (queued > charged_writes_)
+    memory_budget_->Charge(queued - charged_writes_);
+  else
+    memory_budget_->Release(charged_writes_ - queued);
+  charged_writes_ = queued;
+}
+
+
+void LibuvStreamWrap::OnMemoryBudgetChange(bool exceeded) {
+  if (!wants_read_ || !IsAlive() || IsClosing()) return;
+  if (exceeded) {
+    uv_read_stop(stream());
+  } else {
+    // There is no one to report a failure to here. It shows up again on the
+    // next ReadStart().
+    USE(StartReading());
+  }
+}
+
+
+// setMemoryBudget(highWatermark, lowWatermark)
+void LibuvStreamWrap::SetMemoryBudget(const FunctionCallbackInfo<Value>& args) {
+  LibuvStreamWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  CHECK(args[0]->IsNumber());
+  CHECK(args[1]->IsNumber());
+  const int64_t high = args[0].As<Integer>()->Value();
+  const int64_t low = args[1].As<Integer>()->Value();
+  CHECK_GE(high, 0);
+  CHECK_GE(low, 0);
+  wrap->SetMemoryBudget(high, low);
+}
+
+
+// getMemoryBudgetUsage() returns the bytes charged to the budget, or -1
+// without one.
+void LibuvStreamWrap::GetMemoryBudgetUsage(
+    const FunctionCallbackInfo<Value>& args) {
+  LibuvStreamWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  if (!wrap->memory_budget_) return args.GetReturnValue().Set(-1);
+  args.GetReturnValue().Set(
+      static_cast<double>(wrap->memory_budget_->used()));
+}
+
+
+void LibuvStreamWrap::SetServerCounters(SharedServerCounters counters) {
+  CHECK(!server_counters_);
+  (*counters)->connections++;
+  (*counters)->active_connections++;
+  server_counters_ = std::move(counters);
+}
+
+
+void LibuvStreamWrap::FlushCoalescedWritesSync(Environment* env) {
+  for (HandleWrap* handle : *env->handle_wrap_queue()) {
+    if (!HandleWrap::IsAlive(handle))
+      continue;
+    // The handles of these types all belong to LibuvStreamWraps.
+    uv_handle_type type = handle->GetHandle()->type;
+    if (type == UV_TCP || type == UV_NAMED_PIPE || type == UV_TTY)
+      static_cast<LibuvStreamWrap*>(handle)->WriteCoalescedSync();
+  }
+}
+
+
+void LibuvStreamWrap::Close(Local<Value> close_callback) {
+  // Coalesced writes would otherwise be cancelled along with the handle.
+  WriteCoalescedSync();
+  if (server_counters_) {
+    (*server_counters_)->active_connections--;
+    server_counters_.reset();
+  }
+  HandleWrap::Close(close_callback);
+}
+
 typedef SimpleShutdownWrap<ReqWrap<uv_shutdown_t>> LibuvShutdownWrap;
 typedef SimpleWriteWrap<ReqWrap<uv_write_t>> LibuvWriteWrap;
 
@@ -322,6 +485,7 @@ WriteWrap* LibuvStreamWrap::CreateWriteWrap(Local<Object> object) {
 
 int LibuvStreamWrap::DoShutdown(ShutdownWrap* req_wrap_) {
   LibuvShutdownWrap* req_wrap = static_cast<LibuvShutdownWrap*>(req_wrap_);
+  FlushCoalescedWrites();
   return req_wrap->Dispatch(uv_shutdown, stream(), AfterUvShutdown);
 }
 
@@ -346,6 +510,10 @@ int LibuvStreamWrap::DoTryWrite(uv_buf_t** bufs, size_t* count) {
   uv_buf_t* vbufs = *bufs;
   size_t vcount = *count;
 
+  // Leave small writes, and anything that would overtake them, to DoWrite().
+  if (coalesced_bytes_ > 0 || ShouldCoalesce(vbufs, vcount))
+    return 0;
+
   err = uv_try_write(stream(), vbufs, vcount);
   if (err == UV_ENOSYS || err == UV_EAGAIN)
     return 0;
@@ -355,6 +523,8 @@ int LibuvStreamWrap::DoTryWrite(uv_buf_t** bufs, size_t* count) {
   // Slice off the buffers: skip all written buffers and slice the one that
   // was partially written.
   written = err;
+  if (server_counters_)
+    (*server_counters_)->bytes_written += written;
   for (; vcount > 0; vbufs++, vcount--) {
     // Slice
     if (vbufs[0].len > written) {
@@ -381,12 +551,173 @@ int LibuvStreamWrap::DoWrite(WriteWrap* req_wrap,
                              size_t count,
                              uv_stream_t* send_handle) {
   LibuvWriteWrap* w = static_cast<LibuvWriteWrap*>(req_wrap);
-  return w->Dispatch(uv_write2,
-                     stream(),
-                     bufs,
-                     count,
-                     send_handle,
-                     AfterUvWrite);
+  if (server_counters_) {
+    // What is left after DoTryWrite(), and will be written unless the
+    // connection fails.
+    for (size_t i = 0; i < count; i++)
+      (*server_counters_)->bytes_written += bufs[i].len;
+  }
+  if (send_handle == nullptr && ShouldCoalesce(bufs, count)) {
+    CoalesceWrite(w, bufs, count);
+    return 0;
+  }
+
+  FlushCoalescedWrites();
+  int err = w->Dispatch(uv_write2,
+                        stream(),
+                        bufs,
+                        count,
+                        send_handle,
+                        AfterUvWrite);
+  UpdateWriteCharge();
+  return err;
+}
+
+
+bool LibuvStreamWrap::ShouldCoalesce(const uv_buf_t* bufs, size_t count) {
+  // Closed streams take the regular path, which reports errors right away.
+  if (coalesce_limit_ == 0 || !IsAlive() || IsClosing() || is_named_pipe_ipc())
+    return false;
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++)
+    total += bufs[i].len;
+  return total < coalesce_limit_;
+}
+
+
+void LibuvStreamWrap::CoalesceWrite(WriteWrap* w,
+                                    const uv_buf_t* bufs,
+                                    size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++)
+    total += bufs[i].len;
+  if (coalesced_bytes_ + total > coalesce_limit_)
+    FlushCoalescedWrites();
+
+  if (!coalesce_store_) {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env()->isolate_data());
+    coalesce_store_ =
+        ArrayBuffer::NewBackingStore(env()->isolate(), coalesce_limit_);
+  }
+  char* data = static_cast<char*>(coalesce_store_->Data());
+  for (size_t i = 0; i < count; i++) {
+    memcpy(data + coalesced_bytes_, bufs[i].base, bufs[i].len);
+    coalesced_bytes_ += bufs[i].len;
+  }
+  coalesced_writes_.push_back(w);
+  UpdateWriteCharge();
+
+  ScheduleCoalescedFlush(coalesce_delay_ == 0 ||
+                         (coalesce_lines_ && coalesced_bytes_ > 0 &&
+                          data[coalesced_bytes_ - 1] == '\n'));
+}
+
+
+void LibuvStreamWrap::ScheduleCoalescedFlush(bool at_end_of_iteration) {
+  if (!at_end_of_iteration) {
+    if (!coalesce_timer_armed_) {
+      coalesce_timer_armed_ = true;
+      coalesce_timer_->Update(coalesce_delay_);
+    }
+    return;
+  }
+
+  if (coalesce_flush_scheduled_)
+    return;
+  coalesce_flush_scheduled_ = true;
+  env()->SetImmediate([self = BaseObjectPtr<LibuvStreamWrap>(this)](
+      Environment* env) {
+    self->coalesce_flush_scheduled_ = false;
+    self->FlushCoalescedWrites();
+  });
+}
+
+
+void LibuvStreamWrap::FlushCoalescedWrites() {
+  if (coalesced_writes_.empty())
+    return;
+  if (coalesce_timer_armed_) {
+    coalesce_timer_armed_ = false;
+    coalesce_timer_->Stop();
+  }
+
+  std::vector<WriteWrap*> writes;
+  writes.swap(coalesced_writes_);
+  LibuvWriteWrap* carrier = static_cast<LibuvWriteWrap*>(writes.back());
+  writes.pop_back();
+
+  uv_buf_t buf = uv_buf_init(static_cast<char*>(coalesce_store_->Data()),
+                             coalesced_bytes_);
+  carrier->SetBackingStore(std::move(coalesce_store_));
+  coalesced_bytes_ = 0;
+
+  int err = UV_ECANCELED;
+  if (IsAlive() && !IsClosing()) {
+    err = carrier->Dispatch(uv_write2,
+                            stream(),
+                            &buf,
+                            1,
+                            nullptr,
+                            AfterUvWrite);
+  }
+  if (err == 0) {
+    coalesced_batches_.push_back(CoalescedBatch { carrier, std::move(writes) });
+    return;
+  }
+
+  writes.push_back(carrier);
+  UpdateWriteCharge();
+  CompleteWritesLater(std::move(writes), err);
+}
+
+
+// Writes the buffer with uv_try_write(), unless libuv still has writes of
+// its own queued that this would overtake. What does not go out at once,
+// e.g. because a pipe is full, is sent with uv_write() as usual.
+void LibuvStreamWrap::WriteCoalescedSync() {
+  if (coalesced_writes_.empty() || !IsAlive() || IsClosing() ||
+      stream()->write_queue_size > 0) {
+    return;
+  }
+
+  char* data = static_cast<char*>(coalesce_store_->Data());
+  size_t written = 0;
+  while (written < coalesced_bytes_) {
+    uv_buf_t buf = uv_buf_init(data + written, coalesced_bytes_ - written);
+    int err = uv_try_write(stream(), &buf, 1);
+    if (err <= 0)
+      break;
+    written += err;
+  }
+
+  if (written < coalesced_bytes_) {
+    memmove(data, data + written, coalesced_bytes_ - written);
+    coalesced_bytes_ -= written;
+    return FlushCoalescedWrites();
+  }
+
+  if (coalesce_timer_armed_) {
+    coalesce_timer_armed_ = false;
+    coalesce_timer_->Stop();
+  }
+  coalesced_bytes_ = 0;
+  UpdateWriteCharge();
+  std::vector<WriteWrap*> writes;
+  writes.swap(coalesced_writes_);
+  CompleteWritesLater(std::move(writes), 0);
+}
+
+
+// This may run from within a write call, where callers do not expect
+// completion callbacks yet.
+void LibuvStreamWrap::CompleteWritesLater(std::vector<WriteWrap*>&& writes,
+                                          int status) {
+  env()->SetImmediate([writes = std::move(writes), status](Environment* env) {
+    HandleScope scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    for (WriteWrap* w : writes)
+      w->Done(status);
+  });
 }
 
 
@@ -397,6 +728,17 @@ void LibuvStreamWrap::AfterUvWrite(uv_write_t* req, int status) {
   CHECK_NOT_NULL(req_wrap);
   HandleScope scope(req_wrap->env()->isolate());
   Context::Scope context_scope(req_wrap->env()->context());
+
+  // Complete the writes whose data went out along with this one first.
+  LibuvStreamWrap* wrap = static_cast<LibuvStreamWrap*>(req_wrap->stream());
+  wrap->UpdateWriteCharge();
+  std::deque<CoalescedBatch>& batches = wrap->coalesced_batches_;
+  if (!batches.empty() && batches.front().carrier == req_wrap) {
+    std::vector<WriteWrap*> writes = std::move(batches.front().writes);
+    batches.pop_front();
+    for (WriteWrap* w : writes)
+      w->Done(status);
+  }
   req_wrap->Done(status);
 }
 
@@ -26,8 +26,15 @@
 
 #include "stream_base.h"
 #include "handle_wrap.h"
+#include "memory_budget.h"
+#include "server_counters.h"
+#include "timer_wrap.h"
 #include "v8.h"
 
+#include <deque>
+#include <memory>
+#include <vector>
+
 namespace node {
 
 class Environment;
@@ -74,6 +81,31 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
     return stream()->type == UV_TCP;
   }
 
+  // Bytes queued in libuv plus those waiting to be coalesced.
+  size_t write_queue_size() const;
+
+  MemoryBudget* memory_budget() override { return memory_budget_.get(); }
+  // The queued writes are charged to `budget`, as is what listeners charge
+  // to memory_budget(). While the budget is exceeded, the stream stops
+  // reading, and ReadStart() only takes note that it should read again.
+  void SetMemoryBudget(size_t high_watermark,
+                       size_t low_watermark,
+                       std::shared_ptr<MemoryBudget> parent = nullptr);
+
+  ServerCounters* server_counters() override {
+    return server_counters_ ? server_counters_->Data() : nullptr;
+  }
+  // Counts this stream as a connection of the server that owns `counters`,
+  // and its bytes as the server's, until it is closed.
+  void SetServerCounters(SharedServerCounters counters);
+
+  // Synchronously writes out what the streams of `env` have coalesced, for
+  // when the process exits or crashes before they would be flushed.
+  static void FlushCoalescedWritesSync(Environment* env);
+
+  void Close(
+      v8::Local<v8::Value> close_callback = v8::Local<v8::Value>()) override;
+
   ShutdownWrap* CreateShutdownWrap(v8::Local<v8::Object> object) override;
   WriteWrap* CreateWriteWrap(v8::Local<v8::Object> object) override;
 
@@ -102,6 +134,24 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
   static void GetWriteQueueSize(
       const v8::FunctionCallbackInfo<v8::Value>& info);
   static void SetBlocking(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetWriteCoalescing(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetMemoryBudget(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void GetMemoryBudgetUsage(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+
+  int StartReading();
+  // Brings what is charged for queued writes in line with
+  // write_queue_size().
+  void UpdateWriteCharge();
+  void OnMemoryBudgetChange(bool exceeded);
+
+  bool ShouldCoalesce(const uv_buf_t* bufs, size_t count);
+  void CoalesceWrite(WriteWrap* w, const uv_buf_t* bufs, size_t count);
+  void ScheduleCoalescedFlush(bool at_end_of_iteration);
+  void FlushCoalescedWrites();
+  void WriteCoalescedSync();
+  void CompleteWritesLater(std::vector<WriteWrap*>&& writes, int status);
 
   // Callbacks for libuv
   void OnUvAlloc(size_t suggested_size, uv_buf_t* buf);
@@ -114,6 +164,33 @@ class LibuvStreamWrap : public HandleWrap, public StreamBase {
 
   uv_stream_t* const stream_;
 
+  std::unique_ptr<MemoryBudget> memory_budget_;
+  size_t charged_writes_ = 0;
+  SharedServerCounters server_counters_;
+  bool wants_read_ = false;  // Whether ReadStart() was called last.
+
+  // Writes smaller than `coalesce_limit_` bytes are copied into
+  // `coalesce_store_` and sent with a single uv_write() at the end of the
+  // current event loop iteration, or once the buffer would overflow.
+  struct CoalescedBatch {
+    WriteWrap* carrier;  // The request that performs the uv_write().
+    std::vector<WriteWrap*> writes;  // Completed along with `carrier`.
+  };
+  size_t coalesce_limit_ = 0;
+  size_t coalesced_bytes_ = 0;
+  std::unique_ptr<v8::BackingStore> coalesce_store_;
+  std::vector<WriteWrap*> coalesced_writes_;
+  std::deque<CoalescedBatch> coalesced_batches_;
+  bool coalesce_flush_scheduled_ = false;
+  // With a delay, the buffer is flushed `coalesce_delay_` ms after its first
+  // write instead, e.g. for high-rate logging to stdout. Line-buffered
+  // streams still flush at the end of an iteration that leaves the buffer
+  // ending with a complete line.
+  uint64_t coalesce_delay_ = 0;
+  bool coalesce_lines_ = false;
+  bool coalesce_timer_armed_ = false;
+  std::unique_ptr<TimerWrapHandle> coalesce_timer_;
+
 #ifdef _WIN32
   // We don't always have an FD that we could look up on the stream_
   // object itself on Windows. However, for some cases, we open handles
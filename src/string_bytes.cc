@@ -25,6 +25,7 @@
 #include "env-inl.h"
 #include "node_buffer.h"
 #include "node_errors.h"
+#include "utf8.h"
 #include "util.h"
 
 #include <climits>
@@ -32,6 +33,14 @@
 
 #include <algorithm>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>  // SSE2, which is part of the x86-64 baseline.
+#define NODE_HEX_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_HEX_NEON 1
+#endif
+
 // When creating strings >= this length v8's gc spins up and consumes
 // most of the execution time. For these cases it's more performant to
 // use external string resources.
@@ -197,6 +206,64 @@ MaybeLocal<Value> ExternTwoByteString::NewSimpleFromCopy(Isolate* isolate,
   return str.ToLocalChecked();
 }
 
+// Below this many bytes, copying data into the V8 heap is cheaper than
+// creating an external string that shares it.
+constexpr size_t kMinSharedBytes = 64 * 1024;
+
+// An external string that uses the memory of a BackingStore that is never
+// written to again, and keeps it alive. The memory is already accounted for
+// by whoever owns the store.
+template <typename ResourceType, typename TypeName>
+class SharedExternString : public ResourceType {
+ public:
+  SharedExternString(std::shared_ptr<v8::BackingStore> store,
+                     const TypeName* data,
+                     size_t length)
+    : store_(std::move(store)), data_(data), length_(length) {}
+
+  const TypeName* data() const override { return data_; }
+  size_t length() const override { return length_; }
+
+ private:
+  std::shared_ptr<v8::BackingStore> store_;
+  const TypeName* data_;
+  size_t length_;
+};
+
+MaybeLocal<Value> NewSharedOneByte(Isolate* isolate,
+                                   std::shared_ptr<v8::BackingStore> store,
+                                   const char* data,
+                                   size_t length,
+                                   Local<Value>* error) {
+  auto* resource =
+      new SharedExternString<String::ExternalOneByteStringResource, char>(
+          std::move(store), data, length);
+  Local<String> str;
+  if (!String::NewExternalOneByte(isolate, resource).ToLocal(&str)) {
+    delete resource;
+    *error = node::ERR_STRING_TOO_LONG(isolate);
+    return MaybeLocal<Value>();
+  }
+  return str;
+}
+
+MaybeLocal<Value> NewSharedTwoByte(Isolate* isolate,
+                                   std::shared_ptr<v8::BackingStore> store,
+                                   const uint16_t* data,
+                                   size_t length,
+                                   Local<Value>* error) {
+  auto* resource =
+      new SharedExternString<String::ExternalStringResource, uint16_t>(
+          std::move(store), data, length);
+  Local<String> str;
+  if (!String::NewExternalTwoByte(isolate, resource).ToLocal(&str)) {
+    delete resource;
+    *error = node::ERR_STRING_TOO_LONG(isolate);
+    return MaybeLocal<Value>();
+  }
+  return str;
+}
+
 }  // anonymous namespace
 
 // supports regular and URL-safe base64
@@ -243,13 +310,174 @@ static inline unsigned unhex(uint8_t x) {
   return unhex_table[x];
 }
 
+// The vectorized hex kernels convert 16 bytes at a time, and leave the
+// rest to the scalar loops. Decoding stops at the first block with a
+// character that is not a hex digit, and the scalar loop then finds out
+// exactly where to stop.
+#if defined(NODE_HEX_SSE2)
+
+static inline __m128i hex_digits(__m128i nibbles) {
+  // '0' + n for 0-9, 'a' + n - 10 for 10-15.
+  const __m128i is_letter = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+  const __m128i letter =
+      _mm_and_si128(is_letter, _mm_set1_epi8('a' - '0' - 10));
+  return _mm_add_epi8(nibbles, _mm_add_epi8(letter, _mm_set1_epi8('0')));
+}
+
+static size_t hex_encode_blocks(const char* src, size_t slen, char* dst) {
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= slen; i += 16) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+    const __m128i lo = _mm_and_si128(in, mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2),
+                     hex_digits(_mm_unpacklo_epi8(hi, lo)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 16),
+                     hex_digits(_mm_unpackhi_epi8(hi, lo)));
+  }
+  return i;
+}
+
+// Turns 8 pairs of hex digits into 8 bytes in the low halves of 16-bit
+// lanes, and clears `*valid` if any of them is not a hex digit.
+static inline __m128i unhex_pairs(__m128i chars, bool* valid) {
+  const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  const __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  const __m128i letter = _mm_sub_epi8(
+      _mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  const __m128i is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+  if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xffff)
+    *valid = false;
+  const __m128i nibbles = _mm_or_si128(
+      _mm_and_si128(is_digit, digit),
+      _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+  // The first digit of each pair is the high nibble.
+  return _mm_or_si128(
+      _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x0f)), 4),
+      _mm_srli_epi16(nibbles, 8));
+}
+
+static inline __m128i load_hex_chars(const char* src) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+}
+
+static inline __m128i load_hex_chars(const uint16_t* src) {
+  // Characters above 0xff saturate to 0xff, which is not a hex digit.
+  return _mm_packus_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8)));
+}
+
+template <typename TypeName>
+static size_t hex_decode_blocks(char* buf,
+                                size_t len,
+                                const TypeName* src,
+                                size_t srcLen) {
+  size_t i = 0;
+  for (; i + 16 <= len && (i + 16) * 2 <= srcLen; i += 16) {
+    bool valid = true;
+    const __m128i a = unhex_pairs(load_hex_chars(src + i * 2), &valid);
+    const __m128i b = unhex_pairs(load_hex_chars(src + i * 2 + 16), &valid);
+    if (!valid)
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(buf + i),
+                     _mm_packus_epi16(a, b));
+  }
+  return i;
+}
+
+#elif defined(NODE_HEX_NEON)
+
+static size_t hex_encode_blocks(const char* src, size_t slen, char* dst) {
+  const uint8x16_t table = vld1q_u8(
+      reinterpret_cast<const uint8_t*>("0123456789abcdef"));
+  size_t i = 0;
+  for (; i + 16 <= slen; i += 16) {
+    const uint8x16_t in = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+    uint8x16x2_t out;
+    out.val[0] = vqtbl1q_u8(table, vshrq_n_u8(in, 4));
+    out.val[1] = vqtbl1q_u8(table, vandq_u8(in, vdupq_n_u8(0x0f)));
+    vst2q_u8(reinterpret_cast<uint8_t*>(dst + i * 2), out);
+  }
+  return i;
+}
+
+// Turns hex digits into their values, and clears `*valid` if any of them
+// is not a hex digit.
+static inline uint8x16_t unhex_digits(uint8x16_t chars, bool* valid) {
+  const uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+  const uint8x16_t is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+  const uint8x16_t letter =
+      vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  const uint8x16_t is_letter = vcleq_u8(letter, vdupq_n_u8(5));
+  if (vminvq_u8(vorrq_u8(is_digit, is_letter)) != 0xff)
+    *valid = false;
+  return vorrq_u8(vandq_u8(is_digit, digit),
+                  vandq_u8(is_letter, vaddq_u8(letter, vdupq_n_u8(10))));
+}
+
+static inline uint8x16x2_t load_hex_chars(const char* src) {
+  return vld2q_u8(reinterpret_cast<const uint8_t*>(src));
+}
+
+static inline uint8x16x2_t load_hex_chars(const uint16_t* src) {
+  // Characters above 0xff saturate to 0xff, which is not a hex digit.
+  const uint16x8x2_t a = vld2q_u16(src);
+  const uint16x8x2_t b = vld2q_u16(src + 16);
+  uint8x16x2_t chars;
+  chars.val[0] = vcombine_u8(vqmovn_u16(a.val[0]), vqmovn_u16(b.val[0]));
+  chars.val[1] = vcombine_u8(vqmovn_u16(a.val[1]), vqmovn_u16(b.val[1]));
+  return chars;
+}
+
+template <typename TypeName>
+static size_t hex_decode_blocks(char* buf,
+                                size_t len,
+                                const TypeName* src,
+                                size_t srcLen) {
+  size_t i = 0;
+  for (; i + 16 <= len && (i + 16) * 2 <= srcLen; i += 16) {
+    const uint8x16x2_t chars = load_hex_chars(src + i * 2);
+    bool valid = true;
+    const uint8x16_t hi = unhex_digits(chars.val[0], &valid);
+    const uint8x16_t lo = unhex_digits(chars.val[1], &valid);
+    if (!valid)
+      break;
+    vst1q_u8(reinterpret_cast<uint8_t*>(buf + i),
+             vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+  return i;
+}
+
+#else
+
+static size_t hex_encode_blocks(const char* src, size_t slen, char* dst) {
+  return 0;
+}
+
+template <typename TypeName>
+static size_t hex_decode_blocks(char* buf,
+                                size_t len,
+                                const TypeName* src,
+                                size_t srcLen) {
+  return 0;
+}
+
+#endif
+
 template <typename TypeName>
 static size_t hex_decode(char* buf,
                          size_t len,
                          const TypeName* src,
                          const size_t srcLen) {
   size_t i;
-  for (i = 0; i < len && i * 2 + 1 < srcLen; ++i) {
+  for (i = hex_decode_blocks(buf, len, src, srcLen);
+       i < len && i * 2 + 1 < srcLen;
+       ++i) {
     unsigned a = unhex(static_cast<uint8_t>(src[i * 2 + 0]));
     unsigned b = unhex(static_cast<uint8_t>(src[i * 2 + 1]));
     if (!~a || !~b)
@@ -302,6 +530,49 @@ size_t StringBytes::WriteUCS2(Isolate* isolate,
   return nchars * sizeof(*dst);
 }
 
+// ASCII reads the same in Latin1 and UTF-8, so one-byte strings are copied
+// as they are, and only the part from the first non-ASCII character on is
+// encoded.
+size_t StringBytes::WriteOneByteUtf8(Isolate* isolate,
+                                     char* buf,
+                                     size_t buflen,
+                                     Local<String> str,
+                                     int flags,
+                                     int* chars_written) {
+  size_t ascii;
+  const char* rest;  // The Latin1 characters after the ASCII prefix.
+  size_t rest_length;
+  MaybeStackBuffer<char> storage;
+  if (str->IsExternalOneByte()) {
+    auto ext = str->GetExternalOneByteStringResource();
+    ascii = ascii_prefix_length(ext->data(), std::min(buflen, ext->length()));
+    memcpy(buf, ext->data(), ascii);
+    rest = ext->data() + ascii;
+    rest_length = ext->length() - ascii;
+  } else {
+    uint8_t* const dst = reinterpret_cast<uint8_t*>(buf);
+    const size_t length = str->WriteOneByte(isolate, dst, 0, buflen, flags);
+    ascii = ascii_prefix_length(buf, length);
+    // Characters that did not fit as Latin1 do not fit as UTF-8 either
+    // once there is a non-ASCII character.
+    rest_length = length - ascii;
+    storage.AllocateSufficientStorage(rest_length);
+    memcpy(storage.out(), buf + ascii, rest_length);
+    rest = storage.out();
+  }
+
+  size_t nchars = ascii;
+  size_t nbytes = ascii;
+  if (rest_length > 0 && ascii < buflen) {
+    size_t read;
+    nbytes += latin1_to_utf8(
+        rest, rest_length, buf + ascii, buflen - ascii, &read);
+    nchars += read;
+  }
+  *chars_written = static_cast<int>(nchars);
+  return nbytes;
+}
+
 
 size_t StringBytes::Write(Isolate* isolate,
                           char* buf,
@@ -339,7 +610,12 @@ size_t StringBytes::Write(Isolate* isolate,
 
     case BUFFER:
     case UTF8:
-      nbytes = str->WriteUtf8(isolate, buf, buflen, chars_written, flags);
+      if (str->IsOneByte()) {
+        nbytes =
+            WriteOneByteUtf8(isolate, buf, buflen, str, flags, chars_written);
+      } else {
+        nbytes = str->WriteUtf8(isolate, buf, buflen, chars_written, flags);
+      }
       break;
 
     case UCS2: {
@@ -485,111 +761,6 @@ Maybe<size_t> StringBytes::Size(Isolate* isolate,
 }
 
 
-
-
-static bool contains_non_ascii_slow(const char* buf, size_t len) {
-  for (size_t i = 0; i < len; ++i) {
-    if (buf[i] & 0x80)
-      return true;
-  }
-  return false;
-}
-
-
-static bool contains_non_ascii(const char* src, size_t len) {
-  if (len < 16) {
-    return contains_non_ascii_slow(src, len);
-  }
-
-  const unsigned bytes_per_word = sizeof(uintptr_t);
-  const unsigned align_mask = bytes_per_word - 1;
-  const unsigned unaligned = reinterpret_cast<uintptr_t>(src) & align_mask;
-
-  if (unaligned > 0) {
-    const unsigned n = bytes_per_word - unaligned;
-    if (contains_non_ascii_slow(src, n))
-      return true;
-    src += n;
-    len -= n;
-  }
-
-
-#if defined(_WIN64) || defined(_LP64)
-  const uintptr_t mask = 0x8080808080808080ll;
-#else
-  const uintptr_t mask = 0x80808080l;
-#endif
-
-  const uintptr_t* srcw = reinterpret_cast<const uintptr_t*>(src);
-
-  for (size_t i = 0, n = len / bytes_per_word; i < n; ++i) {
-    if (srcw[i] & mask)
-      return true;
-  }
-
-  const unsigned remainder = len & align_mask;
-  if (remainder > 0) {
-    const size_t offset = len - remainder;
-    if (contains_non_ascii_slow(src + offset, remainder))
-      return true;
-  }
-
-  return false;
-}
-
-
-static void force_ascii_slow(const char* src, char* dst, size_t len) {
-  for (size_t i = 0; i < len; ++i) {
-    dst[i] = src[i] & 0x7f;
-  }
-}
-
-
-static void force_ascii(const char* src, char* dst, size_t len) {
-  if (len < 16) {
-    force_ascii_slow(src, dst, len);
-    return;
-  }
-
-  const unsigned bytes_per_word = sizeof(uintptr_t);
-  const unsigned align_mask = bytes_per_word - 1;
-  const unsigned src_unalign = reinterpret_cast<uintptr_t>(src) & align_mask;
-  const unsigned dst_unalign = reinterpret_cast<uintptr_t>(dst) & align_mask;
-
-  if (src_unalign > 0) {
-    if (src_unalign == dst_unalign) {
-      const unsigned unalign = bytes_per_word - src_unalign;
-      force_ascii_slow(src, dst, unalign);
-      src += unalign;
-      dst += unalign;
-      len -= src_unalign;
-    } else {
-      force_ascii_slow(src, dst, len);
-      return;
-    }
-  }
-
-#if defined(_WIN64) || defined(_LP64)
-  const uintptr_t mask = ~0x8080808080808080ll;
-#else
-  const uintptr_t mask = ~0x80808080l;
-#endif
-
-  const uintptr_t* srcw = reinterpret_cast<const uintptr_t*>(src);
-  uintptr_t* dstw = reinterpret_cast<uintptr_t*>(dst);
-
-  for (size_t i = 0, n = len / bytes_per_word; i < n; ++i) {
-    dstw[i] = srcw[i] & mask;
-  }
-
-  const unsigned remainder = len & align_mask;
-  if (remainder > 0) {
-    const size_t offset = len - remainder;
-    force_ascii_slow(src + offset, dst + offset, remainder);
-  }
-}
-
-
 size_t StringBytes::hex_encode(
     const char* src,
     size_t slen,
@@ -600,7 +771,8 @@ size_t StringBytes::hex_encode(
       "not enough space provided for hex encode");
 
   dlen = slen * 2;
-  for (uint32_t i = 0, k = 0; k < dlen; i += 1, k += 2) {
+  const size_t encoded = hex_encode_blocks(src, slen, dst);
+  for (size_t i = encoded, k = encoded * 2; k < dlen; i += 1, k += 2) {
     static const char hex[] = "0123456789abcdef";
     uint8_t val = static_cast<uint8_t>(src[i]);
     dst[k + 0] = hex[val >> 4];
@@ -655,13 +827,15 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
       }
 
     case ASCII:
-      if (contains_non_ascii(buf, buflen)) {
+      // Long strings get copied anyway, so check and copy in one pass.
+      if (buflen >= EXTERN_APEX ||
+          ascii_prefix_length(buf, buflen) != buflen) {
         char* out = node::UncheckedMalloc(buflen);
         if (out == nullptr) {
           *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
           return MaybeLocal<Value>();
         }
-        force_ascii(buf, out, buflen);
+        copy_force_ascii(buf, out, buflen);
         return ExternOneByteString::New(isolate, out, buflen, error);
       } else {
         return ExternOneByteString::NewFromCopy(isolate, buf, buflen, error);
@@ -669,6 +843,33 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
 
     case UTF8:
       {
+        size_t length;
+        switch (utf8_classify(buf, buflen, &length)) {
+          case Utf8Content::ASCII:
+            return ExternOneByteString::NewFromCopy(
+                isolate, buf, buflen, error);
+          case Utf8Content::LATIN1: {
+            char* out = node::UncheckedMalloc(length);
+            if (out == nullptr) {
+              *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
+              return MaybeLocal<Value>();
+            }
+            utf8_to_latin1(buf, buflen, out);
+            return ExternOneByteString::New(isolate, out, length, error);
+          }
+          case Utf8Content::TWO_BYTE: {
+            uint16_t* out = node::UncheckedMalloc<uint16_t>(length);
+            if (out == nullptr) {
+              *error = node::ERR_MEMORY_ALLOCATION_FAILED(isolate);
+              return MaybeLocal<Value>();
+            }
+            utf8_to_utf16(buf, buflen, out);
+            return ExternTwoByteString::New(isolate, out, length, error);
+          }
+          case Utf8Content::INVALID:
+            // Leave replacing invalid sequences with U+FFFD to V8.
+            break;
+        }
         val = String::NewFromUtf8(isolate,
                                   buf,
                                   v8::NewStringType::kNormal,
@@ -797,4 +998,64 @@ MaybeLocal<Value> StringBytes::Encode(Isolate* isolate,
   return Encode(isolate, buf, len, encoding, error);
 }
 
+MaybeLocal<Value> StringBytes::NewExternalOneByte(Isolate* isolate,
+                                                  char* data,
+                                                  size_t length,
+                                                  Local<Value>* error) {
+  if (length == 0) {
+    free(data);
+    return String::Empty(isolate);
+  }
+  return ExternOneByteString::New(isolate, data, length, error);
+}
+
+MaybeLocal<Value> StringBytes::NewExternalTwoByte(Isolate* isolate,
+                                                  uint16_t* data,
+                                                  size_t length,
+                                                  Local<Value>* error) {
+  if (length == 0) {
+    free(data);
+    return String::Empty(isolate);
+  }
+  return ExternTwoByteString::New(isolate, data, length, error);
+}
+
+MaybeLocal<Value> StringBytes::EncodeShared(
+    Isolate* isolate,
+    std::shared_ptr<v8::BackingStore> store,
+    size_t offset,
+    size_t length,
+    enum encoding encoding,
+    Local<Value>* error) {
+  CHECK_LE(offset, store->ByteLength());
+  CHECK_LE(length, store->ByteLength() - offset);
+  const char* data = static_cast<const char*>(store->Data()) + offset;
+  // Do not keep a large store alive for a small part of it.
+  if (length < kMinSharedBytes || length < store->ByteLength() / 2)
+    return Encode(isolate, data, length, encoding, error);
+  CHECK_BUFLEN_IN_RANGE(length);
+
+  switch (encoding) {
+    case ASCII:
+    case UTF8:
+      // Anything but ASCII needs to be converted.
+      if (ascii_prefix_length(data, length) != length)
+        break;
+      return NewSharedOneByte(isolate, std::move(store), data, length, error);
+    case LATIN1:
+      return NewSharedOneByte(isolate, std::move(store), data, length, error);
+    case UCS2:
+      if (IsBigEndian() || reinterpret_cast<uintptr_t>(data) % 2 != 0)
+        break;
+      return NewSharedTwoByte(isolate,
+                              std::move(store),
+                              reinterpret_cast<const uint16_t*>(data),
+                              length / 2,
+                              error);
+    default:
+      break;
+  }
+  return Encode(isolate, data, length, encoding, error);
+}
+
 }  // namespace node
@@ -29,6 +29,7 @@
 #include "v8.h"
 #include "env-inl.h"
 
+#include <memory>
 #include <string>
 
 namespace node {
@@ -99,6 +100,34 @@ class StringBytes {
                                           enum encoding encoding,
                                           v8::Local<v8::Value>* error);
 
+  // Take ownership of `data`, which must have been allocated with malloc(),
+  // and turn it into a String. Long strings are backed by `data` directly,
+  // shorter ones are copied. One-byte data is interpreted as Latin-1.
+  static v8::MaybeLocal<v8::Value> NewExternalOneByte(
+      v8::Isolate* isolate,
+      char* data,
+      size_t length,
+      v8::Local<v8::Value>* error);
+  static v8::MaybeLocal<v8::Value> NewExternalTwoByte(
+      v8::Isolate* isolate,
+      uint16_t* data,
+      size_t length,
+      v8::Local<v8::Value>* error);
+
+  // Turn `length` bytes at `offset` in `store` into a String, like Encode().
+  // `store` must never be written to again, like the stores of Blob entries.
+  // Long strings that need no conversion, which are Latin-1 data and ASCII
+  // or UTF-8 data that is all ASCII, as well as aligned UCS-2 data on
+  // little-endian platforms, use the memory of `store` and keep it alive
+  // instead of making a copy.
+  static v8::MaybeLocal<v8::Value> EncodeShared(
+      v8::Isolate* isolate,
+      std::shared_ptr<v8::BackingStore> store,
+      size_t offset,
+      size_t length,
+      enum encoding encoding,
+      v8::Local<v8::Value>* error);
+
   static size_t hex_encode(const char* src,
                            size_t slen,
                            char* dst,
@@ -113,6 +142,12 @@ class StringBytes {
                           v8::Local<v8::String> str,
                           int flags,
                           size_t* chars_written);
+  static size_t WriteOneByteUtf8(v8::Isolate* isolate,
+                                 char* buf,
+                                 size_t buflen,
+                                 v8::Local<v8::String> str,
+                                 int flags,
+                                 int* chars_written);
 };
 
 }  // namespace node
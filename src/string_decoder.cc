@@ -24,32 +24,20 @@ namespace node {
 
 namespace {
 
+// UTF-8 goes through StringBytes::Encode() as well, which validates and
+// transcodes it in one vectorized pass, and which creates external strings
+// for long chunks. Only invalid UTF-8 is left to V8's decoder.
 MaybeLocal<String> MakeString(Isolate* isolate,
                               const char* data,
                               size_t length,
                               enum encoding encoding) {
   Local<Value> error;
-  MaybeLocal<Value> ret;
-  if (encoding == UTF8) {
-    MaybeLocal<String> utf8_string = String::NewFromUtf8(
-        isolate,
-        data,
-        v8::NewStringType::kNormal,
-        length);
-    if (utf8_string.IsEmpty()) {
-      isolate->ThrowException(node::ERR_STRING_TOO_LONG(isolate));
-      return MaybeLocal<String>();
-    } else {
-      return utf8_string;
-    }
-  } else {
-    ret = StringBytes::Encode(
-        isolate,
-        data,
-        length,
-        encoding,
-        &error);
-  }
+  MaybeLocal<Value> ret = StringBytes::Encode(
+      isolate,
+      data,
+      length,
+      encoding,
+      &error);
 
   if (ret.IsEmpty()) {
     CHECK(!error.IsEmpty());
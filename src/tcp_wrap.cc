@@ -28,21 +28,46 @@
 #include "node_buffer.h"
 #include "node_external_reference.h"
 #include "node_internals.h"
+#include "node_usdt.h"
 #include "stream_base-inl.h"
 #include "stream_wrap.h"
 #include "util-inl.h"
 
+#if HAVE_OPENSSL
+#include "crypto/crypto_clienthello-inl.h"
+#endif
+
 #include <cstdlib>
+#include <memory>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && !defined(TCP_FASTOPEN_CONNECT)
+#define TCP_FASTOPEN_CONNECT 30
+#endif
 
 
 namespace node {
 
+using v8::Array;
 using v8::Boolean;
 using v8::Context;
 using v8::EscapableHandleScope;
 using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
+using v8::HandleScope;
 using v8::Int32;
 using v8::Integer;
 using v8::Local;
@@ -50,8 +75,12 @@ using v8::MaybeLocal;
 using v8::Object;
 using v8::String;
 using v8::Uint32;
+using v8::Undefined;
 using v8::Value;
 
+// The default Connection Attempt Delay of RFC 8305.
+constexpr uint64_t kDefaultConnectAttemptDelay = 250;
+
 MaybeLocal<Object> TCPWrap::Instantiate(Environment* env,
                                         AsyncWrap* parent,
                                         TCPWrap::SocketType type) {
@@ -88,15 +117,25 @@ void TCPWrap::Initialize(Local<Object> target,
   env->SetProtoMethod(t, "open", Open);
   env->SetProtoMethod(t, "bind", Bind);
   env->SetProtoMethod(t, "listen", Listen);
+  env->SetProtoMethod(t, "setAcceptBatchSize", SetAcceptBatchSize);
+  env->SetProtoMethod(t, "setRateLimit", SetRateLimit);
+  env->SetProtoMethod(
+      t, "setConnectionMemoryBudget", SetConnectionMemoryBudget);
+  env->SetProtoMethod(t, "getServerCounters", GetServerCounters);
   env->SetProtoMethod(t, "connect", Connect);
   env->SetProtoMethod(t, "bind6", Bind6);
   env->SetProtoMethod(t, "connect6", Connect6);
+  env->SetProtoMethod(t, "connectMany", ConnectMany);
+  env->SetProtoMethod(t, "peekClientHello", PeekClientHello);
   env->SetProtoMethod(t, "getsockname",
                       GetSockOrPeerName<TCPWrap, uv_tcp_getsockname>);
   env->SetProtoMethod(t, "getpeername",
                       GetSockOrPeerName<TCPWrap, uv_tcp_getpeername>);
   env->SetProtoMethod(t, "setNoDelay", SetNoDelay);
   env->SetProtoMethod(t, "setKeepAlive", SetKeepAlive);
+  env->SetProtoMethod(t, "setReusePortCPUAffinity", SetReusePortCPUAffinity);
+  env->SetProtoMethod(t, "setFastOpen", SetFastOpen);
+  env->SetProtoMethod(t, "setDeferAccept", SetDeferAccept);
 
 #ifdef _WIN32
   env->SetProtoMethod(t, "setSimultaneousAccepts", SetSimultaneousAccepts);
@@ -116,6 +155,12 @@ void TCPWrap::Initialize(Local<Object> target,
   NODE_DEFINE_CONSTANT(constants, SOCKET);
   NODE_DEFINE_CONSTANT(constants, SERVER);
   NODE_DEFINE_CONSTANT(constants, UV_TCP_IPV6ONLY);
+  NODE_DEFINE_CONSTANT(constants, UV_TCP_REUSEPORT);
+  NODE_DEFINE_CONSTANT(constants, kServerConnections);
+  NODE_DEFINE_CONSTANT(constants, kServerActiveConnections);
+  NODE_DEFINE_CONSTANT(constants, kServerRequests);
+  NODE_DEFINE_CONSTANT(constants, kServerBytesRead);
+  NODE_DEFINE_CONSTANT(constants, kServerBytesWritten);
   target->Set(context,
               env->constants_string(),
               constants).Check();
@@ -126,14 +171,23 @@ void TCPWrap::RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(Open);
   registry->Register(Bind);
   registry->Register(Listen);
+  registry->Register(SetAcceptBatchSize);
+  registry->Register(SetRateLimit);
+  registry->Register(SetConnectionMemoryBudget);
+  registry->Register(GetServerCounters);
   registry->Register(Connect);
   registry->Register(Bind6);
   registry->Register(Connect6);
+  registry->Register(ConnectMany);
+  registry->Register(PeekClientHello);
 
   registry->Register(GetSockOrPeerName<TCPWrap, uv_tcp_getsockname>);
   registry->Register(GetSockOrPeerName<TCPWrap, uv_tcp_getpeername>);
   registry->Register(SetNoDelay);
   registry->Register(SetKeepAlive);
+  registry->Register(SetReusePortCPUAffinity);
+  registry->Register(SetFastOpen);
+  registry->Register(SetDeferAccept);
 #ifdef _WIN32
   registry->Register(SetSimultaneousAccepts);
 #endif
@@ -173,6 +227,9 @@ TCPWrap::TCPWrap(Environment* env, Local<Object> object, ProviderType provider)
                    // Suggestion: uv_tcp_init() returns void.
 }
 
+// Out of line, so that ClientHelloPeek is complete here.
+TCPWrap::~TCPWrap() = default;
+
 
 void TCPWrap::SetNoDelay(const FunctionCallbackInfo<Value>& args) {
   TCPWrap* wrap;
@@ -212,6 +269,112 @@ void TCPWrap::SetSimultaneousAccepts(const FunctionCallbackInfo<Value>& args) {
 #endif
 
 
+// Makes the kernel hand each new connection of a SO_REUSEPORT group to the
+// socket whose index in the group (i.e. bind order) equals the CPU that
+// received it. Combined with threads pinned to the matching CPUs, every core
+// then accepts from its own queue. Connections arriving on CPUs without a
+// corresponding socket are distributed by hash, as without the program.
+// The program applies to the whole group, so one socket has to set it.
+void TCPWrap::SetReusePortCPUAffinity(
+    const FunctionCallbackInfo<Value>& args) {
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd);
+  if (err == 0) {
+    sock_filter code[] = {
+      { BPF_LD | BPF_W | BPF_ABS, 0, 0,
+        static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+      { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    sock_fprog prog = { arraysize(code), code };
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &prog, sizeof(prog)) != 0) {
+      err = uv_translate_sys_error(errno);
+    }
+  }
+  args.GetReturnValue().Set(err);
+#else
+  args.GetReturnValue().Set(UV_ENOTSUP);
+#endif
+}
+
+
+// Accepts TCP Fast Open connections, whose first data arrives with the SYN,
+// with up to `qlen` of them waiting for the handshake to complete at any
+// time. Must be called between bind() and listen().
+void TCPWrap::SetFastOpen(const FunctionCallbackInfo<Value>& args) {
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+#if !defined(_WIN32) && defined(TCP_FASTOPEN)
+  CHECK(args[0]->IsUint32());
+  int qlen = static_cast<int>(args[0].As<Uint32>()->Value());
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd);
+  if (err == 0 &&
+      setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)) != 0) {
+    err = uv_translate_sys_error(errno);
+  }
+  args.GetReturnValue().Set(err);
+#else
+  args.GetReturnValue().Set(UV_ENOTSUP);
+#endif
+}
+
+
+// Makes a listening socket only report connections once their first data
+// has arrived, or after `seconds` without data.
+void TCPWrap::SetDeferAccept(const FunctionCallbackInfo<Value>& args) {
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+#ifdef TCP_DEFER_ACCEPT
+  CHECK(args[0]->IsUint32());
+  int seconds = static_cast<int>(args[0].As<Uint32>()->Value());
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd);
+  if (err == 0 &&
+      setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                 &seconds, sizeof(seconds)) != 0) {
+    err = uv_translate_sys_error(errno);
+  }
+  args.GetReturnValue().Set(err);
+#else
+  args.GetReturnValue().Set(UV_ENOTSUP);
+#endif
+}
+
+
+// With TCP_FASTOPEN_CONNECT, connect() completes right away and the SYN is
+// sent along with the first write, carrying its data if the server has
+// handed out a Fast Open cookie before. The kernel falls back to a regular
+// handshake otherwise. The socket has to exist before uv_tcp_connect() to
+// set the option, so it is created here if needed.
+void TCPWrap::EnableFastOpenConnect(int family) {
+#ifdef __linux__
+  uv_os_fd_t fd;
+  if (uv_fileno(reinterpret_cast<uv_handle_t*>(&handle_), &fd) != 0) {
+    fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+      return;
+    if (uv_tcp_open(&handle_, fd) != 0) {
+      close(fd);
+      return;
+    }
+    set_fd(fd);
+  }
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on));
+#endif
+}
+
+
 void TCPWrap::Open(const FunctionCallbackInfo<Value>& args) {
   TCPWrap* wrap;
   ASSIGN_OR_RETURN_UNWRAP(&wrap,
@@ -243,7 +406,8 @@ void TCPWrap::Bind(
   int port;
   unsigned int flags = 0;
   if (!args[1]->Int32Value(env->context()).To(&port)) return;
-  if (family == AF_INET6 &&
+  // IPv4 binds only take flags such as UV_TCP_REUSEPORT if given any.
+  if ((family == AF_INET6 || !args[2]->IsUndefined()) &&
       !args[2]->Uint32Value(env->context()).To(&flags)) {
     return;
   }
@@ -326,6 +490,12 @@ void TCPWrap::Connect(const FunctionCallbackInfo<Value>& args,
   int err = uv_ip_addr(*ip_address, &addr);
 
   if (err == 0) {
+    // connect(req, address, port, fastOpen)
+    if (args[3]->IsTrue()) {
+      wrap->EnableFastOpenConnect(
+          reinterpret_cast<const sockaddr*>(&addr)->sa_family);
+    }
+
     AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(wrap);
     ConnectWrap* req_wrap =
         new ConnectWrap(env, req_wrap_obj, AsyncWrap::PROVIDER_TCPCONNECTWRAP);
@@ -335,9 +505,423 @@ void TCPWrap::Connect(const FunctionCallbackInfo<Value>& args,
                              AfterConnect);
     if (err)
       delete req_wrap;
+    else
+      NODE_USDT_PROBE2(net__connect, NODE_USDT_PTR(wrap),
+                       NODE_USDT_PTR(*ip_address));
+  }
+
+  args.GetReturnValue().Set(err);
+}
+
+
+// Connects a TCPWrap to the first of several addresses that answers, the way
+// RFC 8305 (Happy Eyeballs v2) describes. Each attempt uses a socket of its
+// own. A new attempt starts when the previous one fails, or after the
+// attempt delay if it is still pending. The socket of the first attempt that
+// succeeds is handed over to the TCPWrap, and the others are closed.
+class TCPWrap::ConnectRace final : public AsyncWrap {
+ public:
+  struct Address {
+    sockaddr_storage storage;
+    uint32_t index;  // In the list that was passed in.
+  };
+
+  ConnectRace(TCPWrap* wrap,
+              Local<Object> req_wrap_obj,
+              std::vector<Address>&& addresses,
+              uint64_t attempt_delay);
+  ~ConnectRace() override;
+
+  // Returns an error if no attempt could be started. The result is reported
+  // to JS otherwise.
+  int Start();
+
+  SET_NO_MEMORY_INFO()
+  SET_MEMORY_INFO_NAME(TCPConnectRace)
+  SET_SELF_SIZE(ConnectRace)
+
+ private:
+  struct Attempt {
+    ConnectRace* race;
+    uint32_t index;
+    bool closing = false;
+    uv_tcp_t handle;
+    uv_connect_t req;
+  };
+
+  void StartNextAttempt();
+  void Finish(int status, Attempt* winner);
+  int Adopt(Attempt* winner);
+  void CloseAttempt(Attempt* attempt);
+  void CloseAll();
+  void OnHandleClosed();
+
+  static void OnConnect(uv_connect_t* req, int status);
+  static void OnTimer(uv_timer_t* timer);
+  static void Cleanup(void* arg);
+
+  BaseObjectPtr<TCPWrap> wrap_;
+  std::vector<Address> addresses_;
+  std::vector<std::unique_ptr<Attempt>> attempts_;
+  uv_timer_t timer_;
+  uint64_t attempt_delay_;
+  size_t pending_ = 0;
+  size_t open_handles_ = 0;
+  int last_error_ = UV_ECONNREFUSED;
+  bool finished_ = false;
+  bool report_ = true;
+};
+
+TCPWrap::ConnectRace::ConnectRace(TCPWrap* wrap,
+                                  Local<Object> req_wrap_obj,
+                                  std::vector<Address>&& addresses,
+                                  uint64_t attempt_delay)
+    : AsyncWrap(wrap->env(), req_wrap_obj, PROVIDER_TCPCONNECTWRAP),
+      wrap_(wrap),
+      addresses_(std::move(addresses)),
+      attempt_delay_(attempt_delay) {
+  CHECK_EQ(uv_timer_init(env()->event_loop(), &timer_), 0);
+  open_handles_++;
+  env()->AddCleanupHook(Cleanup, this);
+}
+
+TCPWrap::ConnectRace::~ConnectRace() {
+  env()->RemoveCleanupHook(Cleanup, this);
+}
+
+int TCPWrap::ConnectRace::Start() {
+  // If every attempt fails synchronously, the caller reports the error.
+  report_ = false;
+  StartNextAttempt();
+  if (pending_ == 0)
+    return last_error_;
+  report_ = true;
+  return 0;
+}
+
+void TCPWrap::ConnectRace::StartNextAttempt() {
+  while (attempts_.size() < addresses_.size()) {
+    const Address& address = addresses_[attempts_.size()];
+    attempts_.emplace_back(new Attempt());
+    Attempt* attempt = attempts_.back().get();
+    attempt->race = this;
+    attempt->index = address.index;
+    int err = uv_tcp_init(env()->event_loop(), &attempt->handle);
+    if (err != 0) {
+      attempt->closing = true;
+      last_error_ = err;
+      continue;
+    }
+    open_handles_++;
+    err = uv_tcp_connect(&attempt->req,
+                         &attempt->handle,
+                         reinterpret_cast<const sockaddr*>(&address.storage),
+                         OnConnect);
+    if (err != 0) {
+      last_error_ = err;
+      CloseAttempt(attempt);
+      continue;
+    }
+    pending_++;
+    break;
   }
 
+  if (attempts_.size() < addresses_.size()) {
+    uv_timer_start(&timer_, OnTimer, attempt_delay_, 0);
+  } else if (pending_ == 0) {
+    Finish(last_error_, nullptr);
+  }
+}
+
+void TCPWrap::ConnectRace::OnTimer(uv_timer_t* timer) {
+  ConnectRace* race = ContainerOf(&ConnectRace::timer_, timer);
+  race->StartNextAttempt();
+}
+
+void TCPWrap::ConnectRace::OnConnect(uv_connect_t* req, int status) {
+  Attempt* attempt = ContainerOf(&Attempt::req, req);
+  ConnectRace* race = attempt->race;
+  race->pending_--;
+  if (race->finished_)
+    return;
+
+  if (status == 0)
+    return race->Finish(0, attempt);
+
+  race->last_error_ = status;
+  race->CloseAttempt(attempt);
+  // Don't wait for the attempt delay after a failure.
+  uv_timer_stop(&race->timer_);
+  race->StartNextAttempt();
+}
+
+void TCPWrap::ConnectRace::Finish(int status, Attempt* winner) {
+  if (finished_)
+    return;
+  finished_ = true;
+
+  if (winner != nullptr)
+    status = Adopt(winner);
+  CloseAll();
+
+  if (!report_)
+    return;
+
+  Environment* env = this->env();
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+  const bool connected = status == 0;
+  Local<Value> argv[] = {
+    Integer::New(env->isolate(), status),
+    wrap_->object(),
+    object(),
+    Boolean::New(env->isolate(), connected),
+    Boolean::New(env->isolate(), connected),
+    Integer::New(env->isolate(),
+                 connected ? static_cast<int32_t>(winner->index) : -1)
+  };
+  MakeCallback(env->oncomplete_string(), arraysize(argv), argv);
+}
+
+// Moves the connected socket of `winner` into the TCPWrap's handle.
+int TCPWrap::ConnectRace::Adopt(Attempt* winner) {
+  if (uv_is_closing(reinterpret_cast<uv_handle_t*>(&wrap_->handle_)))
+    return UV_ECANCELED;
+#ifdef _WIN32
+  return UV_ENOSYS;
+#else
+  uv_os_fd_t fd;
+  int err = uv_fileno(reinterpret_cast<uv_handle_t*>(&winner->handle), &fd);
+  if (err != 0)
+    return err;
+  int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (dup_fd < 0)
+    return -errno;
+  err = uv_tcp_open(&wrap_->handle_, dup_fd);
+  if (err != 0)
+    close(dup_fd);
+  return err;
+#endif
+}
+
+void TCPWrap::ConnectRace::CloseAttempt(Attempt* attempt) {
+  if (attempt->closing)
+    return;
+  attempt->closing = true;
+  env()->CloseHandle(&attempt->handle, [](uv_tcp_t* handle) {
+    Attempt* attempt = ContainerOf(&Attempt::handle, handle);
+    attempt->race->OnHandleClosed();
+  });
+}
+
+void TCPWrap::ConnectRace::CloseAll() {
+  for (const std::unique_ptr<Attempt>& attempt : attempts_)
+    CloseAttempt(attempt.get());
+  if (uv_is_closing(reinterpret_cast<uv_handle_t*>(&timer_)))
+    return;
+  env()->CloseHandle(&timer_, [](uv_timer_t* timer) {
+    ConnectRace* race = ContainerOf(&ConnectRace::timer_, timer);
+    race->OnHandleClosed();
+  });
+}
+
+void TCPWrap::ConnectRace::OnHandleClosed() {
+  CHECK_GT(open_handles_, 0);
+  if (--open_handles_ == 0)
+    delete this;
+}
+
+void TCPWrap::ConnectRace::Cleanup(void* arg) {
+  ConnectRace* race = static_cast<ConnectRace*>(arg);
+  race->report_ = false;
+  race->finished_ = true;
+  race->CloseAll();
+}
+
+// connectMany(req, addresses, port[, attemptDelay]) connects to the first of
+// `addresses` that accepts, and completes `req` like connect() does, with the
+// index of that address as an extra argument. Addresses of the two families
+// are tried in turn, starting with the family of the first one.
+void TCPWrap::ConnectMany(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsArray());
+  CHECK(args[2]->IsUint32());
+  Local<Object> req_wrap_obj = args[0].As<Object>();
+  Local<Array> list = args[1].As<Array>();
+  int port = static_cast<int>(args[2].As<Uint32>()->Value());
+  uint64_t attempt_delay = kDefaultConnectAttemptDelay;
+  if (args[3]->IsUint32())
+    attempt_delay = args[3].As<Uint32>()->Value();
+
+  // The socket of the winning attempt is moved into the handle, so the
+  // handle must not have one yet, e.g. from bind().
+  uv_os_fd_t fd;
+  if (uv_fileno(reinterpret_cast<uv_handle_t*>(&wrap->handle_), &fd) == 0)
+    return args.GetReturnValue().Set(UV_EINVAL);
+
+  std::vector<ConnectRace::Address> first_family;
+  std::vector<ConnectRace::Address> second_family;
+  for (uint32_t i = 0; i < list->Length(); i++) {
+    Local<Value> value;
+    if (!list->Get(env->context(), i).ToLocal(&value))
+      return;
+    CHECK(value->IsString());
+    node::Utf8Value ip_address(env->isolate(), value);
+    ConnectRace::Address address;
+    address.index = i;
+    if (uv_ip4_addr(*ip_address, port,
+            reinterpret_cast<sockaddr_in*>(&address.storage)) != 0 &&
+        uv_ip6_addr(*ip_address, port,
+            reinterpret_cast<sockaddr_in6*>(&address.storage)) != 0) {
+      return args.GetReturnValue().Set(UV_EINVAL);
+    }
+    if (first_family.empty() ||
+        first_family[0].storage.ss_family == address.storage.ss_family) {
+      first_family.push_back(address);
+    } else {
+      second_family.push_back(address);
+    }
+  }
+  if (first_family.empty())
+    return args.GetReturnValue().Set(UV_EINVAL);
+
+  std::vector<ConnectRace::Address> addresses;
+  addresses.reserve(first_family.size() + second_family.size());
+  for (size_t i = 0; i < std::max(first_family.size(), second_family.size());
+       i++) {
+    if (i < first_family.size())
+      addresses.push_back(first_family[i]);
+    if (i < second_family.size())
+      addresses.push_back(second_family[i]);
+  }
+
+  AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(wrap);
+  ConnectRace* race =
+      new ConnectRace(wrap, req_wrap_obj, std::move(addresses), attempt_delay);
+  args.GetReturnValue().Set(race->Start());
+}
+
+#if HAVE_OPENSSL
+// Reads from the socket until the first TLS record is complete and parses it
+// as a ClientHello, without terminating TLS. The bytes that were read are
+// handed to JS along with the server name and ALPN protocol list, so that the
+// connection can be routed, e.g. with a StreamPipe that writes them out
+// before anything else.
+class TCPWrap::ClientHelloPeek final : public StreamListener {
+ public:
+  explicit ClientHelloPeek(TCPWrap* wrap) : wrap_(wrap) {
+    parser_.Start(OnHello, OnEnd, this);
+  }
+
+  uv_buf_t OnStreamAlloc(size_t suggested_size) override {
+    return uv_buf_init(reinterpret_cast<char*>(buffer_ + used_),
+                       sizeof(buffer_) - used_);
+  }
+
+  void OnStreamRead(ssize_t nread, const uv_buf_t& buf) override {
+    if (nread < 0) {
+      std::unique_ptr<ClientHelloPeek> self = std::move(wrap_->hello_peek_);
+      StreamListener* previous = previous_listener_;
+      stream()->RemoveStreamListener(this);
+      previous->OnStreamRead(nread, uv_buf_init(nullptr, 0));
+      return;
+    }
+    used_ += nread;
+    parser_.Parse(buffer_, used_);
+    // A record that does not fit cannot be a ClientHello the parser accepts.
+    if (done_ || used_ == sizeof(buffer_)) Finish();
+  }
+
+ private:
+  static void OnHello(void* arg,
+                      const crypto::ClientHelloParser::ClientHello& hello) {
+    ClientHelloPeek* peek = static_cast<ClientHelloPeek*>(arg);
+    peek->servername_ = hello.servername();
+    peek->servername_size_ = hello.servername_size();
+    peek->alpn_ = hello.alpn();
+    peek->alpn_size_ = hello.alpn_size();
+    peek->done_ = true;
+  }
+
+  static void OnEnd(void* arg) {
+    static_cast<ClientHelloPeek*>(arg)->done_ = true;
+  }
+
+  // Calls `onclienthello(servername, alpn, peeked)` on the handle, with
+  // `undefined` for what the ClientHello did not contain or if it could not
+  // be parsed. The socket is not read from until JS decides what to do.
+  void Finish() {
+    std::unique_ptr<ClientHelloPeek> self = std::move(wrap_->hello_peek_);
+    TCPWrap* wrap = wrap_;
+    Environment* env = wrap->env();
+    wrap->ReadStop();
+    wrap->RemoveStreamListener(this);
+
+    HandleScope handle_scope(env->isolate());
+    Context::Scope context_scope(env->context());
+    Local<Value> argv[] = {
+      Undefined(env->isolate()),
+      Undefined(env->isolate()),
+      Undefined(env->isolate())
+    };
+    if (servername_ != nullptr) {
+      argv[0] = OneByteString(env->isolate(), servername_, servername_size_);
+    }
+    if (alpn_ != nullptr) {
+      Local<Object> alpn;
+      if (!Buffer::Copy(env, reinterpret_cast<const char*>(alpn_), alpn_size_)
+              .ToLocal(&alpn)) {
+        return;
+      }
+      argv[1] = alpn;
+    }
+    Local<Object> peeked;
+    if (!Buffer::Copy(env, reinterpret_cast<const char*>(buffer_), used_)
+            .ToLocal(&peeked)) {
+      return;
+    }
+    argv[2] = peeked;
+    wrap->MakeCallback(env->onclienthello_string(), arraysize(argv), argv);
+  }
+
+  TCPWrap* wrap_;
+  crypto::ClientHelloParser parser_;
+  bool done_ = false;
+  const uint8_t* servername_ = nullptr;
+  uint8_t servername_size_ = 0;
+  const uint8_t* alpn_ = nullptr;
+  uint16_t alpn_size_ = 0;
+  size_t used_ = 0;
+  // A TLS record header and the largest record that the parser accepts.
+  uint8_t buffer_[5 + 16 * 1024 + 5];
+};
+#endif  // HAVE_OPENSSL
+
+void TCPWrap::PeekClientHello(const FunctionCallbackInfo<Value>& args) {
+  TCPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+#if HAVE_OPENSSL
+  if (wrap->hello_peek_) return args.GetReturnValue().Set(UV_EBUSY);
+  wrap->hello_peek_ = std::make_unique<ClientHelloPeek>(wrap);
+  wrap->PushStreamListener(wrap->hello_peek_.get());
+  int err = wrap->ReadStart();
+  if (err != 0) {
+    wrap->RemoveStreamListener(wrap->hello_peek_.get());
+    wrap->hello_peek_.reset();
+  }
   args.GetReturnValue().Set(err);
+#else
+  args.GetReturnValue().Set(UV_ENOSYS);
+#endif  // HAVE_OPENSSL
 }
 
 
@@ -27,6 +27,8 @@
 #include "async_wrap.h"
 #include "connection_wrap.h"
 
+#include <memory>
+
 namespace node {
 
 class ExternalReferenceRegistry;
@@ -70,10 +72,15 @@ class TCPWrap : public ConnectionWrap<TCPWrap, uv_tcp_t> {
 
   TCPWrap(Environment* env, v8::Local<v8::Object> object,
           ProviderType provider);
+  ~TCPWrap() override;
 
   static void New(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetNoDelay(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetKeepAlive(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetReusePortCPUAffinity(
+      const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetFastOpen(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SetDeferAccept(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Bind(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Bind6(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Listen(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -82,13 +89,26 @@ class TCPWrap : public ConnectionWrap<TCPWrap, uv_tcp_t> {
   template <typename T>
   static void Connect(const v8::FunctionCallbackInfo<v8::Value>& args,
       std::function<int(const char* ip_address, T* addr)> uv_ip_addr);
+  static void ConnectMany(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Open(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Reads and parses the first ClientHello, and then calls
+  // `onclienthello(servername, alpn, peeked)` on the handle.
+  static void PeekClientHello(const v8::FunctionCallbackInfo<v8::Value>& args);
   template <typename T>
   static void Bind(
       const v8::FunctionCallbackInfo<v8::Value>& args,
       int family,
       std::function<int(const char* ip_address, int port, T* addr)> uv_ip_addr);
 
+  // Best effort, the connection is made without TCP Fast Open if this fails.
+  void EnableFastOpenConnect(int family);
+
+  class ConnectRace;
+#if HAVE_OPENSSL
+  class ClientHelloPeek;
+  std::unique_ptr<ClientHelloPeek> hello_peek_;
+#endif
+
 #ifdef _WIN32
   static void SetSimultaneousAccepts(
       const v8::FunctionCallbackInfo<v8::Value>& args);
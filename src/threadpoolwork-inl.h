@@ -26,21 +26,31 @@
 
 #include "util-inl.h"
 #include "node_internals.h"
+#include "node_usdt.h"
 
 namespace node {
 
 void ThreadPoolWork::ScheduleWork() {
   env_->IncreaseWaitingRequestCounter();
+  env_->ThreadPoolWorkQueued();
+  queued_at_ = uv_hrtime();
+  NODE_USDT_PROBE1(threadpool__queue, NODE_USDT_PTR(this));
   int status = uv_queue_work(
       env_->event_loop(),
       &work_req_,
       [](uv_work_t* req) {
         ThreadPoolWork* self = ContainerOf(&ThreadPoolWork::work_req_, req);
+        self->started_at_ = uv_hrtime();
+        self->env_->ThreadPoolWorkStarted();
+        NODE_USDT_PROBE1(threadpool__start, NODE_USDT_PTR(self));
         self->DoThreadPoolWork();
       },
       [](uv_work_t* req, int status) {
         ThreadPoolWork* self = ContainerOf(&ThreadPoolWork::work_req_, req);
         self->env_->DecreaseWaitingRequestCounter();
+        NODE_USDT_PROBE2(threadpool__done, NODE_USDT_PTR(self), status);
+        self->env_->ThreadPoolWorkDone(status,
+                                       self->started_at_ - self->queued_at_);
         self->AfterThreadPoolWork(status);
       });
   CHECK_EQ(status, 0);
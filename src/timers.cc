@@ -1,20 +1,271 @@
+#include "timers.h"
+#include "base_object-inl.h"
 #include "env-inl.h"
+#include "memory_tracker-inl.h"
 #include "node_external_reference.h"
+#include "timer_wrap-inl.h"
 #include "util-inl.h"
 #include "v8.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 
 namespace node {
-namespace {
 
+using v8::ArrayBuffer;
 using v8::Context;
 using v8::Function;
 using v8::FunctionCallbackInfo;
+using v8::FunctionTemplate;
+using v8::Global;
+using v8::HandleScope;
 using v8::Local;
 using v8::Object;
+using v8::Uint32;
+using v8::Uint32Array;
 using v8::Value;
 
+namespace timers {
+
+TimerWheel::TimerWheel(uint64_t granularity, size_t slot_count)
+    : granularity_(std::max<uint64_t>(granularity, 1)) {
+  size_t slots = 1;
+  while (slots < slot_count) slots <<= 1;
+  slots_.resize(slots, kInvalidId);
+}
+
+TimerWheel::Id TimerWheel::Add(uint64_t now, uint64_t timeout) {
+  Id id = free_;
+  if (id != kInvalidId) {
+    free_ = timers_[id].next;
+  } else {
+    CHECK_LT(timers_.size(), kInvalidId);
+    id = static_cast<Id>(timers_.size());
+    timers_.emplace_back();
+  }
+  timers_[id].timeout = timeout;
+  timers_[id].active = true;
+  // Nothing is left to expire before `now`, so the wheel can skip ahead.
+  if (size_ == 0) next_tick_ = std::max(next_tick_, now / granularity_);
+  size_++;
+  Link(id, now);
+  return id;
+}
+
+bool TimerWheel::Refresh(Id id, uint64_t now) {
+  if (!IsActive(id)) return false;
+  Unlink(id);
+  Link(id, now);
+  return true;
+}
+
+bool TimerWheel::Remove(Id id) {
+  if (!IsActive(id)) return false;
+  Unlink(id);
+  timers_[id].active = false;
+  timers_[id].next = free_;
+  free_ = id;
+  size_--;
+  return true;
+}
+
+bool TimerWheel::IsActive(Id id) const {
+  return id < timers_.size() && timers_[id].active;
+}
+
+void TimerWheel::Expire(uint64_t now, std::vector<Id>* expired) {
+  uint64_t tick = now / granularity_;
+  if (tick < next_tick_) return;
+  // Past one turn of the wheel, every slot has been visited.
+  uint64_t count = std::min<uint64_t>(tick - next_tick_ + 1, slots_.size());
+  for (uint64_t i = 0; i < count && size_ != 0; i++) {
+    Id id = slots_[(next_tick_ + i) & (slots_.size() - 1)];
+    while (id != kInvalidId) {
+      Id next = timers_[id].next;
+      if (timers_[id].tick <= tick) {
+        Remove(id);
+        expired->push_back(id);
+      }
+      id = next;
+    }
+  }
+  next_tick_ = tick + 1;
+}
+
+bool TimerWheel::NextExpiry(uint64_t* when) const {
+  if (size_ == 0) return false;
+  for (uint64_t i = 0; i < slots_.size(); i++) {
+    if (slots_[(next_tick_ + i) & (slots_.size() - 1)] != kInvalidId) {
+      *when = (next_tick_ + i) * granularity_;
+      return true;
+    }
+  }
+  UNREACHABLE();
+}
+
+void TimerWheel::Link(Id id, uint64_t now) {
+  Timer* timer = &timers_[id];
+  uint64_t deadline = now + timer->timeout;
+  timer->tick = std::max(
+      (deadline + granularity_ - 1) / granularity_, next_tick_);
+  Id* head = &slots_[timer->tick & (slots_.size() - 1)];
+  timer->prev = kInvalidId;
+  timer->next = *head;
+  if (*head != kInvalidId) timers_[*head].prev = id;
+  *head = id;
+}
+
+void TimerWheel::Unlink(Id id) {
+  Timer* timer = &timers_[id];
+  if (timer->prev != kInvalidId)
+    timers_[timer->prev].next = timer->next;
+  else
+    slots_[timer->tick & (slots_.size() - 1)] = timer->next;
+  if (timer->next != kInvalidId)
+    timers_[timer->next].prev = timer->prev;
+}
+
+void TimerWheel::MemoryInfo(MemoryTracker* tracker) const {
+  tracker->TrackFieldWithSize("slots", slots_.capacity() * sizeof(Id));
+  tracker->TrackFieldWithSize("timers", timers_.capacity() * sizeof(Timer));
+}
+
+}  // namespace timers
+
+namespace {
+
+// A TimerWheel for JS, e.g. for socket idle timeouts. The wheel runs a uv
+// timer of its own, which is only re-armed when a timer is added that is
+// due earlier than the one it is armed for. The timers that expire together
+// are passed to `onexpire` at once, as a Uint32Array of their ids.
+class TimerWheelWrap final : public BaseObject {
+ public:
+  TimerWheelWrap(Environment* env,
+                 Local<Object> object,
+                 Local<Function> onexpire,
+                 uint64_t granularity)
+      : BaseObject(env, object),
+        wheel_(granularity),
+        timer_(env, [this]() { OnTimeout(); }),
+        onexpire_(env->isolate(), onexpire) {
+    MakeWeak();
+  }
+
+  static void New(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args.IsConstructCall());
+    CHECK(args[0]->IsFunction());
+    CHECK(args[1]->IsUint32());
+    new TimerWheelWrap(env,
+                       args.This(),
+                       args[0].As<Function>(),
+                       args[1].As<Uint32>()->Value());
+  }
+
+  // add(timeout) returns the id of the new timer.
+  static void Add(const FunctionCallbackInfo<Value>& args) {
+    TimerWheelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    CHECK(args[0]->IsUint32());
+    timers::TimerWheel::Id id =
+        wrap->wheel_.Add(wrap->Now(), args[0].As<Uint32>()->Value());
+    wrap->Arm();
+    args.GetReturnValue().Set(id);
+  }
+
+  static void Refresh(const FunctionCallbackInfo<Value>& args) {
+    TimerWheelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    CHECK(args[0]->IsUint32());
+    bool active =
+        wrap->wheel_.Refresh(args[0].As<Uint32>()->Value(), wrap->Now());
+    // A later deadline never needs the uv timer to be re-armed.
+    args.GetReturnValue().Set(active);
+  }
+
+  static void Remove(const FunctionCallbackInfo<Value>& args) {
+    TimerWheelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    CHECK(args[0]->IsUint32());
+    bool active = wrap->wheel_.Remove(args[0].As<Uint32>()->Value());
+    // An empty wheel should not keep the loop alive.
+    if (wrap->wheel_.size() == 0) wrap->Disarm();
+    args.GetReturnValue().Set(active);
+  }
+
+  static void Ref(const FunctionCallbackInfo<Value>& args) {
+    TimerWheelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    wrap->timer_.Ref();
+  }
+
+  static void Unref(const FunctionCallbackInfo<Value>& args) {
+    TimerWheelWrap* wrap;
+    ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+    wrap->timer_.Unref();
+  }
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackField("wheel", wheel_);
+    tracker->TrackField("timer", timer_);
+    tracker->TrackFieldWithSize(
+        "expired", expired_.capacity() * sizeof(timers::TimerWheel::Id));
+  }
+
+  SET_MEMORY_INFO_NAME(TimerWheelWrap)
+  SET_SELF_SIZE(TimerWheelWrap)
+
+ private:
+  uint64_t Now() const { return uv_now(env()->event_loop()); }
+
+  void Arm() {
+    uint64_t when;
+    if (!wheel_.NextExpiry(&when)) return;
+    if (armed_ && armed_at_ <= when) return;
+    uint64_t now = Now();
+    armed_ = true;
+    armed_at_ = when;
+    timer_.Update(when > now ? when - now : 0);
+  }
+
+  void Disarm() {
+    if (!armed_) return;
+    armed_ = false;
+    timer_.Stop();
+  }
+
+  void OnTimeout() {
+    armed_ = false;
+    expired_.clear();
+    wheel_.Expire(Now(), &expired_);
+    Arm();
+    if (expired_.empty() || !env()->can_call_into_js()) return;
+
+    HandleScope handle_scope(env()->isolate());
+    Context::Scope context_scope(env()->context());
+    size_t length = expired_.size() * sizeof(expired_[0]);
+    Local<ArrayBuffer> buffer = ArrayBuffer::New(env()->isolate(), length);
+    memcpy(buffer->GetBackingStore()->Data(), expired_.data(), length);
+    Local<Value> argv[] = {
+      Uint32Array::New(buffer, 0, expired_.size())
+    };
+    MakeCallback(env()->isolate(),
+                 object(),
+                 PersistentToLocal::Strong(onexpire_),
+                 arraysize(argv),
+                 argv,
+                 {0, 0});
+  }
+
+  timers::TimerWheel wheel_;
+  TimerWrapHandle timer_;
+  Global<Function> onexpire_;
+  std::vector<timers::TimerWheel::Id> expired_;
+  uint64_t armed_at_ = 0;
+  bool armed_ = false;
+};
+
 void SetupTimers(const FunctionCallbackInfo<Value>& args) {
   CHECK(args[0]->IsFunction());
   CHECK(args[1]->IsFunction());
@@ -54,6 +305,17 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "toggleTimerRef", ToggleTimerRef);
   env->SetMethod(target, "toggleImmediateRef", ToggleImmediateRef);
 
+  Local<FunctionTemplate> wheel = env->NewFunctionTemplate(TimerWheelWrap::New);
+  wheel->Inherit(BaseObject::GetConstructorTemplate(env));
+  wheel->InstanceTemplate()->SetInternalFieldCount(
+      TimerWheelWrap::kInternalFieldCount);
+  env->SetProtoMethod(wheel, "add", TimerWheelWrap::Add);
+  env->SetProtoMethod(wheel, "refresh", TimerWheelWrap::Refresh);
+  env->SetProtoMethod(wheel, "remove", TimerWheelWrap::Remove);
+  env->SetProtoMethod(wheel, "ref", TimerWheelWrap::Ref);
+  env->SetProtoMethod(wheel, "unref", TimerWheelWrap::Unref);
+  env->SetConstructorFunction(target, "TimerWheel", wheel);
+
   target->Set(env->context(),
               FIXED_ONE_BYTE_STRING(env->isolate(), "immediateInfo"),
               env->immediate_info()->fields().GetJSArray()).Check();
@@ -65,6 +327,12 @@ void RegisterTimerExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(ScheduleTimer);
   registry->Register(ToggleTimerRef);
   registry->Register(ToggleImmediateRef);
+  registry->Register(TimerWheelWrap::New);
+  registry->Register(TimerWheelWrap::Add);
+  registry->Register(TimerWheelWrap::Refresh);
+  registry->Register(TimerWheelWrap::Remove);
+  registry->Register(TimerWheelWrap::Ref);
+  registry->Register(TimerWheelWrap::Unref);
 }
 
 }  // namespace node
@@ -0,0 +1,83 @@
+#ifndef SRC_TIMERS_H_
+#define SRC_TIMERS_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include "memory_tracker.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace node {
+namespace timers {
+
+// A hashed timing wheel for large numbers of coarse timeouts, such as the
+// idle timeouts of sockets, that are mostly refreshed or cancelled long
+// before they expire. Times are in milliseconds. A timer is due once the
+// first tick of `granularity` milliseconds at or after its deadline has
+// passed, so it expires up to `granularity` milliseconds late, but adding,
+// refreshing and removing timers are O(1) and do not allocate once the
+// wheel has grown to its working size.
+//
+// Ids are reused once their timer has expired or has been removed.
+class TimerWheel final : public MemoryRetainer {
+ public:
+  using Id = uint32_t;
+  static constexpr Id kInvalidId = std::numeric_limits<Id>::max();
+
+  // `slot_count` is rounded up to a power of two.
+  explicit TimerWheel(uint64_t granularity = 100, size_t slot_count = 512);
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  Id Add(uint64_t now, uint64_t timeout);
+  // Restarts the timer with its original timeout. Returns false if `id` is
+  // not an active timer.
+  bool Refresh(Id id, uint64_t now);
+  bool Remove(Id id);
+  bool IsActive(Id id) const;
+
+  // Removes the timers that are due at `now` and appends their ids to
+  // `expired`.
+  void Expire(uint64_t now, std::vector<Id>* expired);
+  // Sets `when` to the time of the next tick that may have timers due and
+  // returns true, or returns false if the wheel is empty. Timers that are
+  // more than one turn of the wheel away can make that tick a spurious one.
+  bool NextExpiry(uint64_t* when) const;
+
+  uint64_t granularity() const { return granularity_; }
+  size_t size() const { return size_; }
+
+  void MemoryInfo(MemoryTracker* tracker) const override;
+  SET_MEMORY_INFO_NAME(TimerWheel)
+  SET_SELF_SIZE(TimerWheel)
+
+ private:
+  struct Timer {
+    uint64_t timeout;
+    uint64_t tick;  // The tick after which the timer is due.
+    Id prev;
+    Id next;  // Of the same slot, or of the free list.
+    bool active;
+  };
+
+  void Link(Id id, uint64_t now);
+  void Unlink(Id id);
+
+  const uint64_t granularity_;
+  std::vector<Id> slots_;  // The first timer of each slot.
+  std::vector<Timer> timers_;
+  uint64_t next_tick_ = 0;  // The first tick not yet expired.
+  Id free_ = kInvalidId;
+  size_t size_ = 0;
+};
+
+}  // namespace timers
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_TIMERS_H_
@@ -1,107 +1,35 @@
 #include "tracing/node_trace_buffer.h"
 
+#include <algorithm>
 #include <memory>
 #include "util-inl.h"
 
 namespace node {
 namespace tracing {
 
-InternalTraceBuffer::InternalTraceBuffer(size_t max_chunks, uint32_t id,
-                                         Agent* agent)
-    : flushing_(false), max_chunks_(max_chunks),
-      agent_(agent), id_(id) {
-  chunks_.resize(max_chunks);
-}
+namespace {
 
-TraceObject* InternalTraceBuffer::AddTraceEvent(uint64_t* handle) {
-  Mutex::ScopedLock scoped_lock(mutex_);
-  // Create new chunk if last chunk is full or there is no chunk.
-  if (total_chunks_ == 0 || chunks_[total_chunks_ - 1]->IsFull()) {
-    auto& chunk = chunks_[total_chunks_++];
-    if (chunk) {
-      chunk->Reset(current_chunk_seq_++);
-    } else {
-      chunk = std::make_unique<TraceBufferChunk>(current_chunk_seq_++);
-    }
-  }
-  auto& chunk = chunks_[total_chunks_ - 1];
-  size_t event_index;
-  TraceObject* trace_object = chunk->AddTraceEvent(&event_index);
-  *handle = MakeHandle(total_chunks_ - 1, chunk->seq(), event_index);
-  return trace_object;
-}
+std::atomic<uint64_t> next_buffer_id{1};
 
-TraceObject* InternalTraceBuffer::GetEventByHandle(uint64_t handle) {
-  Mutex::ScopedLock scoped_lock(mutex_);
-  if (handle == 0) {
-    // A handle value of zero never has a trace event associated with it.
-    return nullptr;
-  }
-  size_t chunk_index, event_index;
-  uint32_t buffer_id, chunk_seq;
-  ExtractHandle(handle, &buffer_id, &chunk_index, &chunk_seq, &event_index);
-  if (buffer_id != id_ || chunk_index >= total_chunks_) {
-    // Either the chunk belongs to the other buffer, or is outside the current
-    // range of chunks loaded in memory (the latter being true suggests that
-    // the chunk has already been flushed and is no longer in memory.)
-    return nullptr;
-  }
-  auto& chunk = chunks_[chunk_index];
-  if (chunk->seq() != chunk_seq) {
-    // Chunk is no longer in memory.
-    return nullptr;
-  }
-  return chunk->GetEventAt(event_index);
-}
-
-void InternalTraceBuffer::Flush(bool blocking) {
-  {
-    Mutex::ScopedLock scoped_lock(mutex_);
-    if (total_chunks_ > 0) {
-      flushing_ = true;
-      for (size_t i = 0; i < total_chunks_; ++i) {
-        auto& chunk = chunks_[i];
-        for (size_t j = 0; j < chunk->size(); ++j) {
-          TraceObject* trace_event = chunk->GetEventAt(j);
-          // Another thread may have added a trace that is yet to be
-          // initialized. Skip such traces.
-          // https://github.com/nodejs/node/issues/21038.
-          if (trace_event->name()) {
-            agent_->AppendTraceEvent(trace_event);
-          }
-        }
-      }
-      total_chunks_ = 0;
-      flushing_ = false;
-    }
-  }
-  agent_->Flush(blocking);
-}
+// The chunk that the current thread records into.
+struct ThreadChunk {
+  uint64_t buffer_id = 0;
+  size_t index = SIZE_MAX;
+};
 
-uint64_t InternalTraceBuffer::MakeHandle(
-    size_t chunk_index, uint32_t chunk_seq, size_t event_index) const {
-  return ((static_cast<uint64_t>(chunk_seq) * Capacity() +
-          chunk_index * TraceBufferChunk::kChunkSize + event_index) << 1) + id_;
-}
+thread_local ThreadChunk thread_chunk;
 
-void InternalTraceBuffer::ExtractHandle(
-    uint64_t handle, uint32_t* buffer_id, size_t* chunk_index,
-    uint32_t* chunk_seq, size_t* event_index) const {
-  *buffer_id = static_cast<uint32_t>(handle & 0x1);
-  handle >>= 1;
-  *chunk_seq = static_cast<uint32_t>(handle / Capacity());
-  size_t indices = handle % Capacity();
-  *chunk_index = indices / TraceBufferChunk::kChunkSize;
-  *event_index = indices % TraceBufferChunk::kChunkSize;
-}
+}  // anonymous namespace
 
 NodeTraceBuffer::NodeTraceBuffer(size_t max_chunks,
     Agent* agent, uv_loop_t* tracing_loop)
-    : tracing_loop_(tracing_loop),
-      buffer1_(max_chunks, 0, agent),
-      buffer2_(max_chunks, 1, agent) {
-  current_buf_.store(&buffer1_);
-
+    : id_(next_buffer_id++),
+      max_chunks_(max_chunks),
+      agent_(agent),
+      chunks_(new std::atomic<TraceBufferChunk*>[max_chunks]()),
+      chunk_seqs_(new std::atomic<uint32_t>[max_chunks]()),
+      written_events_(max_chunks),
+      tracing_loop_(tracing_loop) {
   flush_signal_.data = this;
   int err = uv_async_init(tracing_loop_, &flush_signal_,
                           NonBlockingFlushSignalCb);
@@ -114,61 +42,173 @@ NodeTraceBuffer::NodeTraceBuffer(size_t max_chunks,
 
 NodeTraceBuffer::~NodeTraceBuffer() {
   uv_async_send(&exit_signal_);
-  Mutex::ScopedLock scoped_lock(exit_mutex_);
-  while (!exited_) {
-    exit_cond_.Wait(scoped_lock);
+  {
+    Mutex::ScopedLock scoped_lock(exit_mutex_);
+    while (!exited_) {
+      exit_cond_.Wait(scoped_lock);
+    }
   }
+  for (size_t i = 0; i < created_chunks_; ++i)
+    delete chunks_[i].load();
 }
 
 TraceObject* NodeTraceBuffer::AddTraceEvent(uint64_t* handle) {
-  // If the buffer is full, attempt to perform a flush.
-  if (!TryLoadAvailableBuffer()) {
-    // Assign a value of zero as the trace event handle.
-    // This is equivalent to calling InternalTraceBuffer::MakeHandle(0, 0, 0),
-    // and will cause GetEventByHandle to return NULL if passed as an argument.
-    *handle = 0;
-    return nullptr;
+  ThreadChunk* current = &thread_chunk;
+  if (current->buffer_id != id_) {
+    current->buffer_id = id_;
+    current->index = SIZE_MAX;
   }
-  return current_buf_.load()->AddTraceEvent(handle);
+  TraceBufferChunk* chunk = nullptr;
+  if (current->index != SIZE_MAX)
+    chunk = chunks_[current->index].load(std::memory_order_relaxed);
+  if (chunk == nullptr || chunk->IsFull()) {
+    current->index = TakeChunk(current->index);
+    if (current->index == SIZE_MAX) {
+      // Assign a value of zero as the trace event handle.
+      // This will cause GetEventByHandle to return NULL if passed as an
+      // argument.
+      *handle = 0;
+      return nullptr;
+    }
+    chunk = chunks_[current->index].load(std::memory_order_relaxed);
+  }
+  size_t event_index;
+  TraceObject* trace_object = chunk->AddTraceEvent(&event_index);
+  *handle = MakeHandle(current->index, chunk->seq(), event_index);
+  return trace_object;
+}
+
+size_t NodeTraceBuffer::TakeChunk(size_t full_chunk) {
+  Mutex::ScopedLock scoped_lock(mutex_);
+  if (full_chunk != SIZE_MAX) {
+    active_chunks_.erase(
+        std::find(active_chunks_.begin(), active_chunks_.end(), full_chunk));
+    full_chunks_.push_back(full_chunk);
+    if (full_chunks_.size() >= kFlushBatchChunks && !flush_pending_) {
+      flush_pending_ = true;
+      uv_async_send(&flush_signal_);  // trigger flush on a separate thread
+    }
+  }
+
+  size_t index;
+  uint32_t seq = current_chunk_seq_;
+  if (!free_chunks_.empty()) {
+    index = free_chunks_.back();
+    free_chunks_.pop_back();
+    // Update the sequence number first, so that handles of the events that
+    // were in the chunk no longer find it.
+    chunk_seqs_[index].store(seq, std::memory_order_release);
+    chunks_[index].load(std::memory_order_relaxed)->Reset(seq);
+  } else if (created_chunks_ < max_chunks_) {
+    index = created_chunks_++;
+    chunk_seqs_[index].store(seq, std::memory_order_release);
+    chunks_[index].store(new TraceBufferChunk(seq),
+                         std::memory_order_release);
+  } else {
+    // Every chunk is either in use or waiting to be written.
+    if (!flush_pending_ && !full_chunks_.empty()) {
+      flush_pending_ = true;
+      uv_async_send(&flush_signal_);
+    }
+    return SIZE_MAX;
+  }
+  current_chunk_seq_++;
+  written_events_[index] = 0;
+  active_chunks_.push_back(index);
+  return index;
 }
 
 TraceObject* NodeTraceBuffer::GetEventByHandle(uint64_t handle) {
-  return current_buf_.load()->GetEventByHandle(handle);
+  if (handle == 0) {
+    // A handle value of zero never has a trace event associated with it.
+    return nullptr;
+  }
+  size_t chunk_index, event_index;
+  uint32_t chunk_seq;
+  ExtractHandle(handle, &chunk_index, &chunk_seq, &event_index);
+  if (chunk_index >= max_chunks_ ||
+      chunk_seqs_[chunk_index].load(std::memory_order_acquire) != chunk_seq) {
+    // The chunk has been written and reused since.
+    return nullptr;
+  }
+  return chunks_[chunk_index].load(std::memory_order_acquire)
+      ->GetEventAt(event_index);
 }
 
 bool NodeTraceBuffer::Flush() {
-  buffer1_.Flush(true);
-  buffer2_.Flush(true);
+  FlushChunks(true);
   return true;
 }
 
-// Attempts to set current_buf_ such that it references a buffer that can
-// write at least one trace event. If both buffers are unavailable this
-// method returns false; otherwise it returns true.
-bool NodeTraceBuffer::TryLoadAvailableBuffer() {
-  InternalTraceBuffer* prev_buf = current_buf_.load();
-  if (prev_buf->IsFull()) {
-    uv_async_send(&flush_signal_);  // trigger flush on a separate thread
-    InternalTraceBuffer* other_buf = prev_buf == &buffer1_ ?
-      &buffer2_ : &buffer1_;
-    if (!other_buf->IsFull()) {
-      current_buf_.store(other_buf);
-    } else {
-      return false;
+// Writes the full chunks and, when blocking, also what the threads have
+// recorded into their current chunks so far. The events are appended to
+// the agent without holding mutex_, so recording goes on meanwhile.
+void NodeTraceBuffer::FlushChunks(bool blocking) {
+  Mutex::ScopedLock flush_lock(flush_mutex_);
+  struct Range {
+    size_t index;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<size_t> full;
+  std::vector<Range> ranges;
+  {
+    Mutex::ScopedLock scoped_lock(mutex_);
+    flush_pending_ = false;
+    full.swap(full_chunks_);
+    auto add_range = [&](size_t index) {
+      size_t size = chunks_[index].load(std::memory_order_relaxed)->size();
+      ranges.push_back({index, written_events_[index], size});
+      written_events_[index] = size;
+    };
+    for (size_t index : full)
+      add_range(index);
+    if (blocking) {
+      for (size_t index : active_chunks_)
+        add_range(index);
     }
   }
-  return true;
+
+  for (const Range& range : ranges) {
+    TraceBufferChunk* chunk =
+        chunks_[range.index].load(std::memory_order_relaxed);
+    for (size_t i = range.begin; i < range.end; ++i) {
+      TraceObject* trace_event = chunk->GetEventAt(i);
+      // Another thread may have added a trace that is yet to be
+      // initialized. Skip such traces.
+      // https://github.com/nodejs/node/issues/21038.
+      if (trace_event->name()) {
+        agent_->AppendTraceEvent(trace_event);
+      }
+    }
+  }
+
+  {
+    Mutex::ScopedLock scoped_lock(mutex_);
+    free_chunks_.insert(free_chunks_.end(), full.begin(), full.end());
+  }
+  agent_->Flush(blocking);
+}
+
+uint64_t NodeTraceBuffer::MakeHandle(
+    size_t chunk_index, uint32_t chunk_seq, size_t event_index) const {
+  return static_cast<uint64_t>(chunk_seq) * Capacity() +
+         chunk_index * TraceBufferChunk::kChunkSize + event_index;
+}
+
+void NodeTraceBuffer::ExtractHandle(
+    uint64_t handle, size_t* chunk_index,
+    uint32_t* chunk_seq, size_t* event_index) const {
+  *chunk_seq = static_cast<uint32_t>(handle / Capacity());
+  size_t indices = handle % Capacity();
+  *chunk_index = indices / TraceBufferChunk::kChunkSize;
+  *event_index = indices % TraceBufferChunk::kChunkSize;
 }
 
 // static
 void NodeTraceBuffer::NonBlockingFlushSignalCb(uv_async_t* signal) {
   NodeTraceBuffer* buffer = static_cast<NodeTraceBuffer*>(signal->data);
-  if (buffer->buffer1_.IsFull() && !buffer->buffer1_.IsFlushing()) {
-    buffer->buffer1_.Flush(false);
-  }
-  if (buffer->buffer2_.IsFull() && !buffer->buffer2_.IsFlushing()) {
-    buffer->buffer2_.Flush(false);
-  }
+  buffer->FlushChunks(false);
 }
 
 // static
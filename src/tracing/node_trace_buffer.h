@@ -6,6 +6,8 @@
 #include "libplatform/v8-tracing.h"
 
 #include <atomic>
+#include <memory>
+#include <vector>
 
 namespace node {
 namespace tracing {
@@ -14,40 +16,11 @@ using v8::platform::tracing::TraceBuffer;
 using v8::platform::tracing::TraceBufferChunk;
 using v8::platform::tracing::TraceObject;
 
-// forward declaration
-class NodeTraceBuffer;
-
-class InternalTraceBuffer {
- public:
-  InternalTraceBuffer(size_t max_chunks, uint32_t id, Agent* agent);
-
-  TraceObject* AddTraceEvent(uint64_t* handle);
-  TraceObject* GetEventByHandle(uint64_t handle);
-  void Flush(bool blocking);
-  bool IsFull() const {
-    return total_chunks_ == max_chunks_ && chunks_[total_chunks_ - 1]->IsFull();
-  }
-  bool IsFlushing() const {
-    return flushing_;
-  }
-
- private:
-  uint64_t MakeHandle(size_t chunk_index, uint32_t chunk_seq,
-                      size_t event_index) const;
-  void ExtractHandle(uint64_t handle, uint32_t* buffer_id, size_t* chunk_index,
-                     uint32_t* chunk_seq, size_t* event_index) const;
-  size_t Capacity() const { return max_chunks_ * TraceBufferChunk::kChunkSize; }
-
-  Mutex mutex_;
-  bool flushing_;
-  size_t max_chunks_;
-  Agent* agent_;
-  std::vector<std::unique_ptr<TraceBufferChunk>> chunks_;
-  size_t total_chunks_ = 0;
-  uint32_t current_chunk_seq_ = 1;
-  uint32_t id_;
-};
-
+// Each thread that records trace events gets a chunk of its own from a
+// shared pool, and adds events to it without locking. The mutex is only
+// taken once per chunk, when a full chunk is handed back and a new one is
+// taken. Full chunks are written to the agent in batches on the tracing
+// loop, after which their slots are reused.
 class NodeTraceBuffer : public TraceBuffer {
  public:
   NodeTraceBuffer(size_t max_chunks, Agent* agent, uv_loop_t* tracing_loop);
@@ -57,13 +30,49 @@ class NodeTraceBuffer : public TraceBuffer {
   TraceObject* GetEventByHandle(uint64_t handle) override;
   bool Flush() override;
 
-  static const size_t kBufferChunks = 1024;
+  static const size_t kBufferChunks = 2048;
+  // How many full chunks are collected before they are written.
+  static const size_t kFlushBatchChunks = 64;
 
  private:
-  bool TryLoadAvailableBuffer();
+  // Hands back the thread's full chunk, if any, and returns the index of
+  // a new one, or SIZE_MAX if the pool is exhausted.
+  size_t TakeChunk(size_t full_chunk);
+  void FlushChunks(bool blocking);
+  uint64_t MakeHandle(size_t chunk_index, uint32_t chunk_seq,
+                      size_t event_index) const;
+  void ExtractHandle(uint64_t handle, size_t* chunk_index,
+                     uint32_t* chunk_seq, size_t* event_index) const;
+  size_t Capacity() const { return max_chunks_ * TraceBufferChunk::kChunkSize; }
+
   static void NonBlockingFlushSignalCb(uv_async_t* signal);
   static void ExitSignalCb(uv_async_t* signal);
 
+  // Tells the chunks of threads apart from those of an earlier buffer at
+  // the same address.
+  const uint64_t id_;
+  const size_t max_chunks_;
+  Agent* agent_;
+
+  // The chunks are created on first use and never freed before the buffer,
+  // so that GetEventByHandle() can look them up without locking. The
+  // sequence number of a slot changes whenever it is reused.
+  std::unique_ptr<std::atomic<TraceBufferChunk*>[]> chunks_;
+  std::unique_ptr<std::atomic<uint32_t>[]> chunk_seqs_;
+
+  Mutex mutex_;
+  // All of these are protected by mutex_.
+  size_t created_chunks_ = 0;
+  uint32_t current_chunk_seq_ = 1;
+  std::vector<size_t> free_chunks_;
+  std::vector<size_t> full_chunks_;
+  std::vector<size_t> active_chunks_;  // Owned by recording threads.
+  std::vector<size_t> written_events_;  // Per chunk, by earlier flushes.
+  bool flush_pending_ = false;
+
+  // Makes flushes run one at a time.
+  Mutex flush_mutex_;
+
   uv_loop_t* tracing_loop_;
   uv_async_t flush_signal_;
   uv_async_t exit_signal_;
@@ -72,9 +81,6 @@ class NodeTraceBuffer : public TraceBuffer {
   Mutex exit_mutex_;
   // Used to wait until async handles have been closed.
   ConditionVariable exit_cond_;
-  std::atomic<InternalTraceBuffer*> current_buf_;
-  InternalTraceBuffer buffer1_;
-  InternalTraceBuffer buffer2_;
 };
 
 }  // namespace tracing
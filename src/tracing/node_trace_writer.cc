@@ -1,5 +1,6 @@
 #include "tracing/node_trace_writer.h"
 
+#include "tracing/proto_trace_writer.h"
 #include "util-inl.h"
 
 #include <fcntl.h>
@@ -8,8 +9,18 @@
 namespace node {
 namespace tracing {
 
-NodeTraceWriter::NodeTraceWriter(const std::string& log_file_pattern)
-    : log_file_pattern_(log_file_pattern) {}
+NodeTraceWriter::NodeTraceWriter(const std::string& log_file_pattern,
+                                 Format format,
+                                 bool gzip)
+    : log_file_pattern_(log_file_pattern), format_(format), gzip_(gzip) {
+  if (gzip_) {
+    memset(&gzip_stream_, 0, sizeof(gzip_stream_));
+    // A window size of 15 plus 16 selects the gzip format.
+    int err = deflateInit2(&gzip_stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                           15 + 16, 8, Z_DEFAULT_STRATEGY);
+    CHECK_EQ(err, Z_OK);
+  }
+}
 
 void NodeTraceWriter::InitializeOnThread(uv_loop_t* loop) {
   CHECK_NULL(tracing_loop_);
@@ -58,6 +69,7 @@ NodeTraceWriter::~NodeTraceWriter() {
   while (!exited_) {
     exit_cond_.Wait(scoped_lock);
   }
+  if (gzip_) deflateEnd(&gzip_stream_);
 }
 
 void replace_substring(std::string* target,
@@ -105,30 +117,38 @@ void NodeTraceWriter::AppendTraceEvent(TraceObject* trace_event) {
     // to stream_.
     // In other words, the constructor initializes the serialization stream
     // to a state where we can start writing trace events to it.
-    // Repeatedly constructing and destroying json_trace_writer_ allows
+    // Repeatedly constructing and destroying trace_writer_ allows
     // us to use V8's JSON writer instead of implementing our own.
-    json_trace_writer_.reset(TraceWriter::CreateJSONTraceWriter(stream_));
+    // A ProtoTraceWriter starts every file with fresh interning state.
+    if (format_ == kProto)
+      trace_writer_.reset(new ProtoTraceWriter(stream_));
+    else
+      trace_writer_.reset(TraceWriter::CreateJSONTraceWriter(stream_));
   }
   ++total_traces_;
-  json_trace_writer_->AppendTraceEvent(trace_event);
+  trace_writer_->AppendTraceEvent(trace_event);
 }
 
 void NodeTraceWriter::FlushPrivate() {
   std::string str;
   int highest_request_id;
+  bool end_of_file = false;
   {
     Mutex::ScopedLock stream_scoped_lock(stream_mutex_);
     if (total_traces_ >= kTracesPerFile) {
       total_traces_ = 0;
       // Destroying the member JSONTraceWriter object appends "]}" to
       // stream_ - in other words, ending a JSON file.
-      json_trace_writer_.reset();
+      trace_writer_.reset();
+      end_of_file = true;
     }
     // str() makes a copy of the contents of the stream.
     str = stream_.str();
     stream_.str("");
     stream_.clear();
   }
+  if (gzip_ && (end_of_file || !str.empty()))
+    str = Compress(str, end_of_file);
   {
     Mutex::ScopedLock request_scoped_lock(request_mutex_);
     highest_request_id = num_write_requests_;
@@ -136,14 +156,34 @@ void NodeTraceWriter::FlushPrivate() {
   WriteToFile(std::move(str), highest_request_id);
 }
 
+// Each flush ends in a sync point, so a file that is cut short, e.g. by a
+// crash, still decompresses up to the last flush.
+std::string NodeTraceWriter::Compress(const std::string& data,
+                                      bool end_of_file) {
+  std::string out;
+  char buf[16 * 1024];
+  gzip_stream_.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  gzip_stream_.avail_in = data.size();
+  do {
+    gzip_stream_.next_out = reinterpret_cast<Bytef*>(buf);
+    gzip_stream_.avail_out = sizeof(buf);
+    int err = deflate(&gzip_stream_, end_of_file ? Z_FINISH : Z_SYNC_FLUSH);
+    CHECK_NE(err, Z_STREAM_ERROR);
+    out.append(buf, sizeof(buf) - gzip_stream_.avail_out);
+  } while (gzip_stream_.avail_out == 0);
+  if (end_of_file) deflateReset(&gzip_stream_);
+  return out;
+}
+
 void NodeTraceWriter::Flush(bool blocking) {
   Mutex::ScopedLock scoped_lock(request_mutex_);
   {
     // We need to lock the mutexes here in a nested fashion; stream_mutex_
-    // protects json_trace_writer_, and without request_mutex_ there might be
+    // protects trace_writer_, and without request_mutex_ there might be
     // a time window in which the stream state changes?
     Mutex::ScopedLock stream_mutex_lock(stream_mutex_);
-    if (!json_trace_writer_)
+    if (!trace_writer_)
       return;
   }
   int request_id = ++num_write_requests_;
@@ -7,6 +7,7 @@
 #include "libplatform/v8-tracing.h"
 #include "tracing/agent.h"
 #include "uv.h"
+#include "zlib.h"
 
 namespace node {
 namespace tracing {
@@ -16,7 +17,11 @@ using v8::platform::tracing::TraceWriter;
 
 class NodeTraceWriter : public AsyncTraceWriter {
  public:
-  explicit NodeTraceWriter(const std::string& log_file_pattern);
+  enum Format { kJSON, kProto };
+
+  explicit NodeTraceWriter(const std::string& log_file_pattern,
+                           Format format = kJSON,
+                           bool gzip = false);
   ~NodeTraceWriter() override;
 
   void InitializeOnThread(uv_loop_t* loop) override;
@@ -37,6 +42,7 @@ class NodeTraceWriter : public AsyncTraceWriter {
   void WriteToFile(std::string&& str, int highest_request_id);
   void WriteSuffix();
   void FlushPrivate();
+  std::string Compress(const std::string& data, bool end_of_file);
   static void ExitSignalCb(uv_async_t* signal);
 
   uv_loop_t* tracing_loop_ = nullptr;
@@ -46,7 +52,7 @@ class NodeTraceWriter : public AsyncTraceWriter {
   uv_async_t exit_signal_;
   // Prevents concurrent R/W on state related to serialized trace data
   // before it's written to disk, namely stream_ and total_traces_
-  // as well as json_trace_writer_.
+  // as well as trace_writer_.
   Mutex stream_mutex_;
   // Prevents concurrent R/W on state related to write requests.
   // If both mutexes are locked, request_mutex_ has to be locked first.
@@ -65,7 +71,11 @@ class NodeTraceWriter : public AsyncTraceWriter {
   int file_num_ = 0;
   std::string log_file_pattern_;
   std::ostringstream stream_;
-  std::unique_ptr<TraceWriter> json_trace_writer_;
+  const Format format_;
+  std::unique_ptr<TraceWriter> trace_writer_;
+  // Only used on the tracing thread, by FlushPrivate().
+  bool gzip_;
+  z_stream gzip_stream_;
   bool exited_ = false;
 };
 
@@ -0,0 +1,279 @@
+#include "tracing/proto_trace_writer.h"
+
+#include "node_protobuf.h"
+#include "tracing/trace_event_common.h"
+
+#include <cstring>
+
+namespace node {
+namespace tracing {
+
+using v8::platform::tracing::TracingController;
+
+namespace {
+
+using Proto = ProtobufWriter;
+
+// Field numbers from Perfetto's protos/perfetto/trace, for the parts used.
+enum TraceField { kTracePacket = 1 };
+
+enum TracePacketField {
+  kPacketClockSnapshot = 6,
+  kPacketTimestamp = 8,
+  kPacketSequenceId = 10,
+  kPacketTrackEvent = 11,
+  kPacketInternedData = 12,
+  kPacketSequenceFlags = 13,
+  kPacketTimestampClockId = 58,
+  kPacketDefaults = 59,
+  kPacketTrackDescriptor = 60,
+};
+
+enum SequenceFlags {
+  kIncrementalStateCleared = 1,
+  kNeedsIncrementalState = 2,
+};
+
+enum ClockField {
+  kClockId = 1,
+  kClockTimestamp = 2,
+  kClockIsIncremental = 3,
+  kClockUnitMultiplierNs = 4,
+};
+
+enum TrackDescriptorField { kTrackUuid = 1, kTrackThread = 4 };
+enum ThreadDescriptorField { kThreadPid = 1, kThreadTid = 2, kThreadName = 5 };
+
+enum TrackEventField {
+  kEventCategoryIids = 3,
+  kEventDebugAnnotations = 4,
+  kEventLegacyEvent = 6,
+  kEventNameIid = 10,
+  kEventTrackUuid = 11,
+};
+
+enum LegacyEventField {
+  kLegacyPhase = 2,
+  kLegacyDurationUs = 3,
+  kLegacyThreadDurationUs = 4,
+  kLegacyUnscopedId = 6,
+  kLegacyIdScope = 7,
+  kLegacyBindId = 8,
+  kLegacyUseAsyncTts = 9,
+  kLegacyLocalId = 10,
+  kLegacyGlobalId = 11,
+  kLegacyBindToEnclosing = 12,
+  kLegacyFlowDirection = 13,
+};
+
+enum InternedDataField {
+  kInternedCategories = 1,
+  kInternedNames = 2,
+  kInternedArgNames = 3,
+};
+
+enum DebugAnnotationField {
+  kArgNameIid = 1,
+  kArgBool = 2,
+  kArgUint = 3,
+  kArgInt = 4,
+  kArgDouble = 5,
+  kArgString = 6,
+  kArgPointer = 7,
+  kArgJson = 9,
+};
+
+// Perfetto's built-in CLOCK_MONOTONIC, which uv_hrtime() is based on, and
+// a clock of our own, valid for this sequence, that counts microseconds in
+// deltas from the previous packet.
+constexpr uint64_t kMonotonicClock = 3;
+constexpr uint64_t kIncrementalClock = 64;
+constexpr uint64_t kSequenceId = 1;
+
+Proto InternedEntry(uint64_t iid, const char* name) {
+  Proto entry;
+  entry.VarInt(1, iid).String(2, name);
+  return entry;
+}
+
+}  // anonymous namespace
+
+ProtoTraceWriter::ProtoTraceWriter(std::ostream& stream) : stream_(stream) {}
+
+uint64_t ProtoTraceWriter::Intern(
+    std::unordered_map<std::string, uint64_t>* table,
+    const char* value,
+    bool* added) {
+  auto it = table->emplace(value, table->size() + 1);
+  *added = it.second;
+  return it.first->second;
+}
+
+void ProtoTraceWriter::WritePacket(const std::string& packet) {
+  Proto framing;
+  framing.Bytes(kTracePacket, packet.data(), packet.size());
+  stream_.write(framing.data().data(), framing.data().size());
+}
+
+void ProtoTraceWriter::WriteHeader(int64_t ts) {
+  Proto monotonic, incremental, snapshot, defaults, packet;
+  monotonic.VarInt(kClockId, kMonotonicClock)
+      .VarInt(kClockTimestamp, ts * 1000);
+  incremental.VarInt(kClockId, kIncrementalClock)
+      .VarInt(kClockTimestamp, ts)
+      .VarInt(kClockIsIncremental, 1)
+      .VarInt(kClockUnitMultiplierNs, 1000);
+  snapshot.Message(1, monotonic).Message(1, incremental);
+  defaults.VarInt(kPacketTimestampClockId, kIncrementalClock);
+  packet.VarInt(kPacketTimestamp, ts * 1000)
+      .VarInt(kPacketTimestampClockId, kMonotonicClock)
+      .VarInt(kPacketSequenceId, kSequenceId)
+      .VarInt(kPacketSequenceFlags, kIncrementalStateCleared)
+      .Message(kPacketDefaults, defaults)
+      .Message(kPacketClockSnapshot, snapshot);
+  WritePacket(packet.data());
+  last_ts_ = ts;
+  wrote_header_ = true;
+}
+
+uint64_t ProtoTraceWriter::GetTrack(int pid, int tid,
+                                    const char* thread_name) {
+  uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pid)) << 32) |
+                 static_cast<uint32_t>(tid);
+  auto it = tracks_.emplace(key, key + 1);
+  if (it.second || thread_name != nullptr) {
+    Proto thread, descriptor, packet;
+    thread.VarInt(kThreadPid, pid).VarInt(kThreadTid, tid);
+    if (thread_name != nullptr) thread.String(kThreadName, thread_name);
+    descriptor.VarInt(kTrackUuid, it.first->second)
+        .Message(kTrackThread, thread);
+    packet.VarInt(kPacketSequenceId, kSequenceId)
+        .Message(kPacketTrackDescriptor, descriptor);
+    WritePacket(packet.data());
+  }
+  return it.first->second;
+}
+
+void ProtoTraceWriter::AppendTraceEvent(TraceObject* trace_event) {
+  if (!wrote_header_) WriteHeader(trace_event->ts());
+
+  // The thread_name metadata event names the thread's track instead.
+  const char* thread_name = nullptr;
+  if (trace_event->phase() == TRACE_EVENT_PHASE_METADATA &&
+      strcmp(trace_event->name(), "thread_name") == 0 &&
+      trace_event->num_args() > 0 &&
+      (trace_event->arg_types()[0] == TRACE_VALUE_TYPE_STRING ||
+       trace_event->arg_types()[0] == TRACE_VALUE_TYPE_COPY_STRING)) {
+    thread_name = trace_event->arg_values()[0].as_string;
+  }
+  uint64_t track =
+      GetTrack(trace_event->pid(), trace_event->tid(), thread_name);
+  if (thread_name != nullptr) return;
+
+  Proto interned, event, legacy, packet;
+  bool added;
+  const char* category = TracingController::GetCategoryGroupName(
+      trace_event->category_enabled_flag());
+  uint64_t category_iid = Intern(&categories_, category, &added);
+  if (added) {
+    interned.Message(kInternedCategories,
+                     InternedEntry(category_iid, category));
+  }
+  uint64_t name_iid = Intern(&names_, trace_event->name(), &added);
+  if (added) {
+    interned.Message(kInternedNames,
+                     InternedEntry(name_iid, trace_event->name()));
+  }
+  event.VarInt(kEventCategoryIids, category_iid)
+      .VarInt(kEventNameIid, name_iid)
+      .VarInt(kEventTrackUuid, track);
+
+  for (int i = 0; i < trace_event->num_args(); i++) {
+    const char* arg_name = trace_event->arg_names()[i];
+    uint64_t arg_name_iid = Intern(&arg_names_, arg_name, &added);
+    if (added) {
+      interned.Message(kInternedArgNames,
+                       InternedEntry(arg_name_iid, arg_name));
+    }
+    Proto arg;
+    arg.VarInt(kArgNameIid, arg_name_iid);
+    const TraceObject::ArgValue& value = trace_event->arg_values()[i];
+    switch (trace_event->arg_types()[i]) {
+      case TRACE_VALUE_TYPE_BOOL:
+        arg.VarInt(kArgBool, value.as_uint ? 1 : 0);
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+        arg.VarInt(kArgUint, value.as_uint);
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        arg.VarInt(kArgInt, static_cast<uint64_t>(value.as_int));
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE:
+        arg.Double(kArgDouble, value.as_double);
+        break;
+      case TRACE_VALUE_TYPE_POINTER:
+        arg.VarInt(kArgPointer, reinterpret_cast<uintptr_t>(value.as_pointer));
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        arg.String(kArgString,
+                   value.as_string != nullptr ? value.as_string : "NULL");
+        break;
+      case TRACE_VALUE_TYPE_CONVERTABLE: {
+        std::string json;
+        trace_event->arg_convertables()[i]->AppendAsTraceFormat(&json);
+        arg.Bytes(kArgJson, json.data(), json.size());
+        break;
+      }
+    }
+    event.Message(kEventDebugAnnotations, arg);
+  }
+
+  unsigned int flags = trace_event->flags();
+  legacy.VarInt(kLegacyPhase, trace_event->phase());
+  if (trace_event->phase() == TRACE_EVENT_PHASE_COMPLETE) {
+    legacy.VarInt(kLegacyDurationUs, trace_event->duration())
+        .VarInt(kLegacyThreadDurationUs, trace_event->cpu_duration());
+  }
+  if (flags & TRACE_EVENT_FLAG_HAS_ID) {
+    if (trace_event->scope() != nullptr)
+      legacy.String(kLegacyIdScope, trace_event->scope());
+    legacy.VarInt(kLegacyUnscopedId, trace_event->id());
+  } else if (flags & TRACE_EVENT_FLAG_HAS_LOCAL_ID) {
+    legacy.VarInt(kLegacyLocalId, trace_event->id());
+  } else if (flags & TRACE_EVENT_FLAG_HAS_GLOBAL_ID) {
+    legacy.VarInt(kLegacyGlobalId, trace_event->id());
+  }
+  if (flags & (TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT)) {
+    legacy.VarInt(kLegacyBindId, trace_event->bind_id())
+        .VarInt(kLegacyFlowDirection,
+                ((flags & TRACE_EVENT_FLAG_FLOW_IN) ? 1 : 0) |
+                ((flags & TRACE_EVENT_FLAG_FLOW_OUT) ? 2 : 0));
+  }
+  if (flags & TRACE_EVENT_FLAG_BIND_TO_ENCLOSING)
+    legacy.VarInt(kLegacyBindToEnclosing, 1);
+  if (flags & TRACE_EVENT_FLAG_ASYNC_TTS)
+    legacy.VarInt(kLegacyUseAsyncTts, 1);
+  event.Message(kEventLegacyEvent, legacy);
+
+  // Events from different threads, and complete events, which carry their
+  // start time, are not strictly ordered. Those that would go backwards are
+  // written with an absolute timestamp, which leaves the incremental clock
+  // alone.
+  int64_t ts = trace_event->ts();
+  if (ts >= last_ts_) {
+    packet.VarInt(kPacketTimestamp, ts - last_ts_);
+    last_ts_ = ts;
+  } else {
+    packet.VarInt(kPacketTimestamp, ts * 1000)
+        .VarInt(kPacketTimestampClockId, kMonotonicClock);
+  }
+  packet.VarInt(kPacketSequenceId, kSequenceId)
+      .VarInt(kPacketSequenceFlags, kNeedsIncrementalState);
+  if (!interned.empty()) packet.Message(kPacketInternedData, interned);
+  packet.Message(kPacketTrackEvent, event);
+  WritePacket(packet.data());
+}
+
+}  // namespace tracing
+}  // namespace node
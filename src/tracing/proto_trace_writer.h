@@ -0,0 +1,50 @@
+#ifndef SRC_TRACING_PROTO_TRACE_WRITER_H_
+#define SRC_TRACING_PROTO_TRACE_WRITER_H_
+
+#include "libplatform/v8-tracing.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace node {
+namespace tracing {
+
+using v8::platform::tracing::TraceObject;
+using v8::platform::tracing::TraceWriter;
+
+// Writes trace events as a Perfetto trace, i.e. a sequence of protobuf
+// TracePackets with TrackEvents, which the Perfetto UI and trace processor
+// read directly. Compared to JSON, names, categories and argument names are
+// interned once per file, and timestamps are written as deltas on an
+// incremental clock whenever they do not go backwards. Events keep their
+// Chrome trace phase, ids and flow bindings as LegacyEvents.
+class ProtoTraceWriter : public TraceWriter {
+ public:
+  explicit ProtoTraceWriter(std::ostream& stream);
+
+  void AppendTraceEvent(TraceObject* trace_event) override;
+  void Flush() override {}
+
+ private:
+  uint64_t Intern(std::unordered_map<std::string, uint64_t>* table,
+                  const char* value,
+                  bool* added);
+  uint64_t GetTrack(int pid, int tid, const char* thread_name);
+  void WriteHeader(int64_t ts);
+  void WritePacket(const std::string& packet);
+
+  std::ostream& stream_;
+  bool wrote_header_ = false;
+  int64_t last_ts_ = 0;
+  std::unordered_map<std::string, uint64_t> categories_;
+  std::unordered_map<std::string, uint64_t> names_;
+  std::unordered_map<std::string, uint64_t> arg_names_;
+  std::unordered_map<uint64_t, uint64_t> tracks_;  // (pid, tid) to uuid.
+};
+
+}  // namespace tracing
+}  // namespace node
+
+#endif  // SRC_TRACING_PROTO_TRACE_WRITER_H_
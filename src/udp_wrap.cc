@@ -27,6 +27,17 @@
 #include "req_wrap-inl.h"
 #include "util-inl.h"
 
+#include <algorithm>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#if defined(__linux__) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+
 namespace node {
 
 using v8::Array;
@@ -35,6 +46,7 @@ using v8::BackingStore;
 using v8::Boolean;
 using v8::Context;
 using v8::DontDelete;
+using v8::Function;
 using v8::FunctionCallbackInfo;
 using v8::FunctionTemplate;
 using v8::HandleScope;
@@ -42,11 +54,13 @@ using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::MaybeLocal;
+using v8::Number;
 using v8::Object;
 using v8::PropertyAttribute;
 using v8::ReadOnly;
 using v8::Signature;
 using v8::Uint32;
+using v8::Uint32Array;
 using v8::Undefined;
 using v8::Value;
 
@@ -77,6 +91,88 @@ bool SendWrap::have_callback() const {
   return have_callback_;
 }
 
+
+// One JS request object for a whole sendBatch() call. The first datagram
+// uses the uv_udp_send_t embedded in ReqWrap, the others `extra_reqs_`.
+class SendBatchWrap : public ReqWrap<uv_udp_send_t> {
+ public:
+  SendBatchWrap(Environment* env,
+                Local<Object> req_wrap_obj,
+                size_t count,
+                bool have_callback);
+
+  uv_udp_send_t* req_at(size_t index);
+  // Returns true once the last outstanding send has completed.
+  bool OnSendDone(int status);
+  inline void set_status(int status);
+  void Done();
+
+  size_t msg_size = 0;
+  size_t pending = 0;
+
+  void MemoryInfo(MemoryTracker* tracker) const override {
+    tracker->TrackFieldWithSize("extra_reqs",
+                                extra_count_ * sizeof(uv_udp_send_t));
+  }
+  SET_MEMORY_INFO_NAME(SendBatchWrap)
+  SET_SELF_SIZE(SendBatchWrap)
+
+ private:
+  const bool have_callback_;
+  const size_t extra_count_;
+  std::unique_ptr<uv_udp_send_t[]> extra_reqs_;
+  int status_ = 0;
+};
+
+
+SendBatchWrap::SendBatchWrap(Environment* env,
+                             Local<Object> req_wrap_obj,
+                             size_t count,
+                             bool have_callback)
+    : ReqWrap(env, req_wrap_obj, AsyncWrap::PROVIDER_UDPSENDWRAP),
+      have_callback_(have_callback),
+      extra_count_(count - 1),
+      extra_reqs_(count > 1 ? new uv_udp_send_t[count - 1] : nullptr) {
+  CHECK_GT(count, 0);
+}
+
+
+uv_udp_send_t* SendBatchWrap::req_at(size_t index) {
+  if (index == 0)
+    return req();
+  CHECK_LE(index, extra_count_);
+  return &extra_reqs_[index - 1];
+}
+
+
+bool SendBatchWrap::OnSendDone(int status) {
+  CHECK_GT(pending, 0);
+  set_status(status);
+  return --pending == 0;
+}
+
+
+// Keeps the first error, which is what the JS callback receives.
+void SendBatchWrap::set_status(int status) {
+  if (status < 0 && status_ == 0)
+    status_ = status;
+}
+
+
+void SendBatchWrap::Done() {
+  std::unique_ptr<SendBatchWrap> self{this};
+  if (!have_callback_)
+    return;
+  Environment* env = this->env();
+  HandleScope handle_scope(env->isolate());
+  Context::Scope context_scope(env->context());
+  Local<Value> arg[] = {
+    Integer::New(env->isolate(), status_),
+    Integer::New(env->isolate(), msg_size),
+  };
+  MakeCallback(env->oncomplete_string(), arraysize(arg), arg);
+}
+
 UDPListener::~UDPListener() {
   if (wrap_ != nullptr)
     wrap_->set_listener(nullptr);
@@ -112,16 +208,25 @@ void UDPWrapBase::AddMethods(Environment* env, Local<FunctionTemplate> t) {
   env->SetProtoMethod(t, "recvStop", RecvStop);
 }
 
-UDPWrap::UDPWrap(Environment* env, Local<Object> object)
+UDPWrap::UDPWrap(Environment* env,
+                 Local<Object> object,
+                 uint32_t recv_batch_size)
     : HandleWrap(env,
                  object,
                  reinterpret_cast<uv_handle_t*>(&handle_),
-                 AsyncWrap::PROVIDER_UDPWRAP) {
+                 AsyncWrap::PROVIDER_UDPWRAP),
+      recv_batch_size_(std::min(recv_batch_size, kMaxRecvBatchSize)) {
   object->SetAlignedPointerInInternalField(
       UDPWrapBase::kUDPWrapBaseField, static_cast<UDPWrapBase*>(this));
 
-  int r = uv_udp_init(env->event_loop(), &handle_);
+  unsigned int flags = AF_UNSPEC;
+  if (recv_batch_size_ > 1)
+    flags |= UV_UDP_RECVMMSG;
+  int r = uv_udp_init_ex(env->event_loop(), &handle_, flags);
   CHECK_EQ(r, 0);  // can't fail anyway
+  // Platforms without recvmmsg() silently ignore the flag.
+  if (!uv_udp_using_recvmmsg(&handle_))
+    recv_batch_size_ = 0;
 
   set_listener(this);
 }
@@ -161,6 +266,8 @@ void UDPWrap::Initialize(Local<Object> target,
   env->SetProtoMethod(t, "bind6", Bind6);
   env->SetProtoMethod(t, "connect6", Connect6);
   env->SetProtoMethod(t, "send6", Send6);
+  env->SetProtoMethod(t, "sendBatch", SendBatch);
+  env->SetProtoMethod(t, "sendBatch6", SendBatch6);
   env->SetProtoMethod(t, "disconnect", Disconnect);
   env->SetProtoMethod(t, "getpeername",
                       GetSockOrPeerName<UDPWrap, uv_udp_getpeername>);
@@ -178,6 +285,7 @@ void UDPWrap::Initialize(Local<Object> target,
   env->SetProtoMethod(t, "setBroadcast", SetBroadcast);
   env->SetProtoMethod(t, "setTTL", SetTTL);
   env->SetProtoMethod(t, "bufferSize", BufferSize);
+  env->SetProtoMethod(t, "setRateLimit", SetRateLimit);
 
   t->Inherit(HandleWrap::GetConstructorTemplate(env));
 
@@ -203,7 +311,20 @@ void UDPWrap::Initialize(Local<Object> target,
 void UDPWrap::New(const FunctionCallbackInfo<Value>& args) {
   CHECK(args.IsConstructCall());
   Environment* env = Environment::GetCurrent(args);
-  new UDPWrap(env, args.This());
+  // The optional argument is the number of datagrams to receive at once.
+  uint32_t recv_batch_size =
+      args[0]->IsUint32() ? args[0].As<Uint32>()->Value() : 0;
+  new UDPWrap(env, args.This(), recv_batch_size);
+}
+
+
+void UDPWrap::MemoryInfo(MemoryTracker* tracker) const {
+  if (recv_slab_)
+    tracker->TrackFieldWithSize("recv_slab",
+                                recv_batch_size_ * kRecvSlotSize);
+  tracker->TrackFieldWithSize("recv_chunks",
+                              recv_chunks_.capacity() * sizeof(RecvChunk));
+  tracker->TrackField("rate_limiter", rate_limiter_);
 }
 
 
@@ -344,6 +465,23 @@ void UDPWrap::BufferSize(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+void UDPWrap::SetRateLimit(const FunctionCallbackInfo<Value>& args) {
+  UDPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap, args.Holder());
+  CHECK(args[0]->IsNumber());
+  CHECK(args[1]->IsNumber());
+  CHECK(args[2]->IsUint32());
+  double rate = args[0].As<Number>()->Value();
+  double burst = args[1].As<Number>()->Value();
+  if (rate <= 0 && burst <= 0) {
+    wrap->rate_limiter_.reset();
+    return;
+  }
+  wrap->rate_limiter_ = std::make_unique<SocketAddressRateLimiter>(
+      rate, burst, args[2].As<Uint32>()->Value());
+}
+
+
 void UDPWrap::Connect(const FunctionCallbackInfo<Value>& args) {
   DoConnect(args, AF_INET);
 }
@@ -624,6 +762,221 @@ void UDPWrap::Send6(const FunctionCallbackInfo<Value>& args) {
 }
 
 
+void UDPWrap::SendBatch(const FunctionCallbackInfo<Value>& args) {
+  DoSendBatch(args, AF_INET);
+}
+
+
+void UDPWrap::SendBatch6(const FunctionCallbackInfo<Value>& args) {
+  DoSendBatch(args, AF_INET6);
+}
+
+
+// Unlike send(), every buffer is a datagram of its own.
+void UDPWrap::DoSendBatch(const FunctionCallbackInfo<Value>& args,
+                          int family) {
+  Environment* env = Environment::GetCurrent(args);
+
+  UDPWrap* wrap;
+  ASSIGN_OR_RETURN_UNWRAP(&wrap,
+                          args.Holder(),
+                          args.GetReturnValue().Set(UV_EBADF));
+
+  CHECK(args.Length() == 4 || args.Length() == 6);
+  CHECK(args[0]->IsObject());
+  CHECK(args[1]->IsArray());
+  CHECK(args[2]->IsUint32());
+
+  bool sendto = args.Length() == 6;
+  if (sendto) {
+    // sendBatch(req, list, list.length, ports, addresses, hasCallback)
+    CHECK(args[3]->IsArray());
+    CHECK(args[4]->IsArray());
+    CHECK(args[5]->IsBoolean());
+  } else {
+    // sendBatch(req, list, list.length, hasCallback)
+    CHECK(args[3]->IsBoolean());
+  }
+
+  Local<Array> chunks = args[1].As<Array>();
+  size_t count = args[2].As<Uint32>()->Value();
+  if (count == 0)
+    return args.GetReturnValue().Set(UV_EINVAL);
+
+  MaybeStackBuffer<uv_buf_t, 16> bufs(count);
+  for (size_t i = 0; i < count; i++) {
+    Local<Value> chunk;
+    if (!chunks->Get(env->context(), i).ToLocal(&chunk)) return;
+    bufs[i] = uv_buf_init(Buffer::Data(chunk), Buffer::Length(chunk));
+  }
+
+  int err = 0;
+  std::vector<sockaddr_storage> addrs;
+  if (sendto) {
+    Local<Array> ports = args[3].As<Array>();
+    Local<Array> addresses = args[4].As<Array>();
+    addrs.resize(count);
+    for (size_t i = 0; i < count && err == 0; i++) {
+      Local<Value> port;
+      Local<Value> address;
+      if (!ports->Get(env->context(), i).ToLocal(&port) ||
+          !addresses->Get(env->context(), i).ToLocal(&address)) {
+        return;
+      }
+      CHECK(port->IsUint32());
+      CHECK(address->IsString());
+      node::Utf8Value address_str(env->isolate(), address);
+      err = sockaddr_for_family(family,
+                                address_str.out(),
+                                port.As<Uint32>()->Value(),
+                                &addrs[i]);
+    }
+  }
+
+  if (err == 0) {
+    wrap->current_send_req_wrap_ = args[0].As<Object>();
+    wrap->current_send_has_callback_ =
+        sendto ? args[5]->IsTrue() : args[3]->IsTrue();
+
+    err = static_cast<int>(
+        wrap->SendBatch(*bufs, count, sendto ? addrs.data() : nullptr));
+
+    wrap->current_send_req_wrap_.Clear();
+    wrap->current_send_has_callback_ = false;
+  }
+
+  args.GetReturnValue().Set(err);
+}
+
+
+ssize_t UDPWrap::SendBatch(uv_buf_t* bufs,
+                           size_t count,
+                           const sockaddr_storage* addrs) {
+  if (IsHandleClosing()) return UV_EBADF;
+
+  size_t msg_size = 0;
+  for (size_t i = 0; i < count; i++)
+    msg_size += bufs[i].len;
+
+  // Datagrams that all go to the same peer can leave as a single GSO send.
+  bool same_peer = true;
+  for (size_t i = 1; addrs != nullptr && i < count && same_peer; i++)
+    same_peer = memcmp(&addrs[0], &addrs[i], sizeof(addrs[0])) == 0;
+  if (same_peer && !UNLIKELY(env()->options()->test_udp_no_try_send)) {
+    const sockaddr* addr =
+        addrs != nullptr ? reinterpret_cast<const sockaddr*>(addrs) : nullptr;
+    ssize_t err = TrySendSegmented(bufs, count, addr);
+    if (err != UV_EAGAIN)
+      return err < 0 ? err : msg_size + 1;
+  }
+
+  // Only the first datagram is written right away if the send queue is
+  // empty. The ones queued behind it are flushed together, using
+  // sendmmsg() where libuv supports it.
+  AsyncHooks::DefaultTriggerAsyncIdScope trigger_scope(this);
+  SendBatchWrap* req_wrap = new SendBatchWrap(env(),
+                                              current_send_req_wrap_,
+                                              count,
+                                              current_send_has_callback_);
+  req_wrap->msg_size = msg_size;
+
+  int err = 0;
+  for (size_t i = 0; i < count; i++) {
+    uv_udp_send_t* req = req_wrap->req_at(i);
+    req->data = req_wrap;
+    const sockaddr* addr = addrs != nullptr
+        ? reinterpret_cast<const sockaddr*>(&addrs[i]) : nullptr;
+    err = uv_udp_send(req,
+                      &handle_,
+                      &bufs[i],
+                      1,
+                      addr,
+                      [](uv_udp_send_t* req, int status) {
+      SendBatchWrap* req_wrap = static_cast<SendBatchWrap*>(req->data);
+      if (req_wrap->OnSendDone(status))
+        req_wrap->Done();
+    });
+    if (err != 0)
+      break;
+    req_wrap->pending++;
+  }
+
+  if (req_wrap->pending == 0) {
+    delete req_wrap;
+    return err;
+  }
+  req_wrap->Dispatched();
+  // Datagrams that could not be queued are reported through the callback.
+  req_wrap->set_status(err);
+  return 0;
+}
+
+
+// Linux can split one buffer into equally sized datagrams in the kernel
+// (UDP_SEGMENT). That needs all but the last datagram to have the same
+// size, and nothing else in flight that could be overtaken. Returns
+// UV_EAGAIN when the datagrams need to go through the regular send path.
+ssize_t UDPWrap::TrySendSegmented(uv_buf_t* bufs,
+                                  size_t count,
+                                  const sockaddr* addr) {
+#if defined(__linux__)
+  // The kernel refuses more segments than this per send.
+  static constexpr size_t kMaxSegments = 64;
+  if (segmented_send_disabled_ || count < 2 || count > kMaxSegments)
+    return UV_EAGAIN;
+  if (uv_udp_get_send_queue_count(&handle_) != 0)
+    return UV_EAGAIN;
+
+  size_t segment_size = bufs[0].len;
+  if (segment_size == 0 || bufs[count - 1].len > segment_size)
+    return UV_EAGAIN;
+  for (size_t i = 1; i < count - 1; i++) {
+    if (bufs[i].len != segment_size)
+      return UV_EAGAIN;
+  }
+
+  uv_os_fd_t fd;
+  if (uv_fileno(reinterpret_cast<uv_handle_t*>(&handle_), &fd) != 0)
+    return UV_EAGAIN;  // Not bound yet, libuv binds it on the first send.
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+  msghdr msg = {};
+  if (addr != nullptr) {
+    msg.msg_name = const_cast<sockaddr*>(addr);
+    msg.msg_namelen = addr->sa_family == AF_INET6 ? sizeof(sockaddr_in6)
+                                                    : sizeof(sockaddr_in);
+  }
+  // uv_buf_t is layout-compatible with struct iovec on Unix.
+  msg.msg_iov = reinterpret_cast<iovec*>(bufs);
+  msg.msg_iovlen = count;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = IPPROTO_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  uint16_t gso_size = segment_size;
+  memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+  ssize_t r;
+  do
+    r = sendmsg(fd, &msg, 0);
+  while (r == -1 && errno == EINTR);
+  if (r >= 0)
+    return r;
+
+  // EIO means that the device cannot checksum offload, the others that
+  // the kernel does not know UDP_SEGMENT at all.
+  if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT ||
+      errno == EOPNOTSUPP) {
+    segmented_send_disabled_ = true;
+  }
+  // Everything else is left to the regular path to report.
+#endif  // defined(__linux__)
+  return UV_EAGAIN;
+}
+
+
 AsyncWrap* UDPWrap::GetAsyncWrap() {
   return this;
 }
@@ -686,7 +1039,15 @@ void UDPWrap::OnAlloc(uv_handle_t* handle,
 }
 
 uv_buf_t UDPWrap::OnAlloc(size_t suggested_size) {
-  return env()->allocate_managed_buffer(suggested_size);
+  if (recv_batch_size_ <= 1)
+    return env()->allocate_managed_buffer(suggested_size);
+
+  // libuv reads one datagram per kRecvSlotSize bytes of the buffer.
+  // The slab is reused, because batches are copied out compactly.
+  size_t size = recv_batch_size_ * kRecvSlotSize;
+  if (!recv_slab_)
+    recv_slab_.reset(new char[size]);
+  return uv_buf_init(recv_slab_.get(), size);
 }
 
 void UDPWrap::OnRecv(uv_udp_t* handle,
@@ -702,12 +1063,20 @@ void UDPWrap::OnRecv(ssize_t nread,
                      const uv_buf_t& buf_,
                      const sockaddr* addr,
                      unsigned int flags) {
+  if (recv_batch_size_ > 1)
+    return OnBatchRecv(nread, buf_, addr, flags);
+
   Environment* env = this->env();
   Isolate* isolate = env->isolate();
-  std::unique_ptr<BackingStore> bs = env->release_managed_buffer(buf_);
+  std::unique_ptr<BackingStore> bs =
+      env->release_managed_buffer(buf_, nread > 0 ? nread : 0);
   if (nread == 0 && addr == nullptr) {
     return;
   }
+  if (nread >= 0 && rate_limiter_ &&
+      !rate_limiter_->Admit(SocketAddress(addr))) {
+    return;
+  }
 
   HandleScope handle_scope(isolate);
   Context::Scope context_scope(env->context());
@@ -721,11 +1090,8 @@ void UDPWrap::OnRecv(ssize_t nread,
   if (nread < 0) {
     MakeCallback(env->onmessage_string(), arraysize(argv), argv);
     return;
-  } else if (nread == 0) {
+  } else if (nread == 0 && !bs) {
     bs = ArrayBuffer::NewBackingStore(isolate, 0);
-  } else {
-    CHECK_LE(static_cast<size_t>(nread), bs->ByteLength());
-    bs = BackingStore::Reallocate(isolate, std::move(bs), nread);
   }
 
   Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(bs));
@@ -734,6 +1100,121 @@ void UDPWrap::OnRecv(ssize_t nread,
   MakeCallback(env->onmessage_string(), arraysize(argv), argv);
 }
 
+// libuv calls this once per datagram with UV_UDP_MMSG_CHUNK, and then once
+// more with UV_UDP_MMSG_FREE when the recvmmsg() results are exhausted. The
+// datagrams are collected until then and passed to JS all at once.
+void UDPWrap::OnBatchRecv(ssize_t nread,
+                          const uv_buf_t& buf,
+                          const sockaddr* addr,
+                          unsigned int flags) {
+  if (flags & UV_UDP_MMSG_CHUNK) {
+    CHECK_GE(nread, 0);
+    if (rate_limiter_ && !rate_limiter_->Admit(SocketAddress(addr)))
+      return;
+    RecvChunk chunk;
+    chunk.offset = buf.base - recv_slab_.get();
+    chunk.length = nread;
+    memset(&chunk.addr, 0, sizeof(chunk.addr));
+    memcpy(&chunk.addr,
+           addr,
+           addr->sa_family == AF_INET6 ? sizeof(sockaddr_in6)
+                                       : sizeof(sockaddr_in));
+    recv_chunks_.push_back(chunk);
+    return;
+  }
+
+  if (flags & UV_UDP_MMSG_FREE)
+    return EmitRecvBatch();
+
+  if (nread >= 0)
+    return;  // Nothing to read right now.
+
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env->context());
+  Local<Value> argv[] = {
+      Integer::New(isolate, static_cast<int32_t>(nread)),
+      object(),
+      Undefined(isolate),
+      Undefined(isolate)};
+  MakeCallback(env->onmessage_string(), arraysize(argv), argv);
+}
+
+// Calls `.onmessagebatch(count, handle, buffer, offsets, addresses)`, where
+// datagram `i` is `buffer[offsets[i]..offsets[i + 1]]` sent from
+// `addresses[i]`. Without such a method, `.onmessage()` is called for every
+// datagram instead, with slices of the same buffer.
+void UDPWrap::EmitRecvBatch() {
+  if (recv_chunks_.empty())
+    return;
+
+  Environment* env = this->env();
+  Isolate* isolate = env->isolate();
+  HandleScope handle_scope(isolate);
+  Context::Scope context_scope(env->context());
+
+  std::vector<RecvChunk> chunks;
+  chunks.swap(recv_chunks_);
+  size_t total = 0;
+  for (const RecvChunk& chunk : chunks)
+    total += chunk.length;
+
+  std::unique_ptr<BackingStore> bs;
+  {
+    NoArrayBufferZeroFillScope no_zero_fill_scope(env->isolate_data());
+    bs = ArrayBuffer::NewBackingStore(isolate, total);
+  }
+  std::unique_ptr<BackingStore> offsets_bs =
+      ArrayBuffer::NewBackingStore(isolate,
+                                   (chunks.size() + 1) * sizeof(uint32_t));
+  char* data = static_cast<char*>(bs->Data());
+  uint32_t* offsets = static_cast<uint32_t*>(offsets_bs->Data());
+  std::vector<Local<Value>> addresses(chunks.size());
+  size_t offset = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    memcpy(data + offset, recv_slab_.get() + chunks[i].offset,
+           chunks[i].length);
+    offsets[i] = offset;
+    offset += chunks[i].length;
+    addresses[i] = AddressToJS(
+        env, reinterpret_cast<const sockaddr*>(&chunks[i].addr));
+  }
+  offsets[chunks.size()] = offset;
+
+  Local<ArrayBuffer> ab = ArrayBuffer::New(isolate, std::move(bs));
+  Local<Value> cb;
+  if (!object()->Get(env->context(), env->onmessagebatch_string())
+           .ToLocal(&cb)) {
+    return;
+  }
+
+  if (cb->IsFunction()) {
+    Local<ArrayBuffer> offsets_ab =
+        ArrayBuffer::New(isolate, std::move(offsets_bs));
+    Local<Value> argv[] = {
+        Integer::NewFromUnsigned(isolate, chunks.size()),
+        object(),
+        Buffer::New(env, ab, 0, total).ToLocalChecked(),
+        Uint32Array::New(offsets_ab, 0, chunks.size() + 1),
+        Array::New(isolate, addresses.data(), addresses.size())};
+    MakeCallback(cb.As<Function>(), arraysize(argv), argv);
+    return;
+  }
+
+  for (size_t i = 0; i < chunks.size(); i++) {
+    Local<Value> argv[] = {
+        Integer::New(isolate, static_cast<int32_t>(chunks[i].length)),
+        object(),
+        Buffer::New(env, ab, offsets[i], chunks[i].length).ToLocalChecked(),
+        addresses[i]};
+    if (MakeCallback(env->onmessage_string(), arraysize(argv), argv)
+            .IsEmpty()) {
+      return;
+    }
+  }
+}
+
 MaybeLocal<Object> UDPWrap::Instantiate(Environment* env,
                                         AsyncWrap* parent,
                                         UDPWrap::SocketType type) {
@@ -30,6 +30,9 @@
 #include "uv.h"
 #include "v8.h"
 
+#include <memory>
+#include <vector>
+
 namespace node {
 
 class UDPWrapBase;
@@ -135,6 +138,8 @@ class UDPWrap final : public HandleWrap,
   static void Bind6(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Connect6(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Send6(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SendBatch(const v8::FunctionCallbackInfo<v8::Value>& args);
+  static void SendBatch6(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void Disconnect(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void AddMembership(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void DropMembership(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -150,6 +155,10 @@ class UDPWrap final : public HandleWrap,
   static void SetBroadcast(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void SetTTL(const v8::FunctionCallbackInfo<v8::Value>& args);
   static void BufferSize(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // setRateLimit(rate, burst, maxAddresses) drops the datagrams of senders
+  // that are over the limit of a SocketAddressRateLimiter before they reach
+  // JS. A rate and burst of 0 remove the limit.
+  static void SetRateLimit(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   // UDPListener implementation
   uv_buf_t OnAlloc(size_t suggested_size) override;
@@ -175,18 +184,37 @@ class UDPWrap final : public HandleWrap,
   static v8::MaybeLocal<v8::Object> Instantiate(Environment* env,
                                                 AsyncWrap* parent,
                                                 SocketType type);
-  SET_NO_MEMORY_INFO()
+  void MemoryInfo(MemoryTracker* tracker) const override;
   SET_MEMORY_INFO_NAME(UDPWrap)
   SET_SELF_SIZE(UDPWrap)
 
  private:
   typedef uv_udp_t HandleType;
 
+  // libuv hands recvmmsg() results out in slots of this size.
+  static constexpr size_t kRecvSlotSize = 64 * 1024;
+  // The most datagrams libuv reads with one recvmmsg() call.
+  static constexpr uint32_t kMaxRecvBatchSize = 20;
+
+  struct RecvChunk {
+    size_t offset;  // Into `recv_slab_`.
+    size_t length;
+    sockaddr_storage addr;
+  };
+
   template <typename T,
             int (*F)(const typename T::HandleType*, sockaddr*, int*)>
   friend void GetSockOrPeerName(const v8::FunctionCallbackInfo<v8::Value>&);
 
-  UDPWrap(Environment* env, v8::Local<v8::Object> object);
+  UDPWrap(Environment* env,
+          v8::Local<v8::Object> object,
+          uint32_t recv_batch_size = 0);
+
+  void OnBatchRecv(ssize_t nread,
+                   const uv_buf_t& buf,
+                   const sockaddr* addr,
+                   unsigned int flags);
+  void EmitRecvBatch();
 
   static void DoBind(const v8::FunctionCallbackInfo<v8::Value>& args,
                      int family);
@@ -194,6 +222,16 @@ class UDPWrap final : public HandleWrap,
                      int family);
   static void DoSend(const v8::FunctionCallbackInfo<v8::Value>& args,
                      int family);
+  static void DoSendBatch(const v8::FunctionCallbackInfo<v8::Value>& args,
+                          int family);
+  // Sends one datagram per buffer. Returns the total size + 1 if everything
+  // was sent synchronously, 0 if the sends were queued, or an error code.
+  ssize_t SendBatch(uv_buf_t* bufs,
+                    size_t count,
+                    const sockaddr_storage* addrs);
+  ssize_t TrySendSegmented(uv_buf_t* bufs,
+                           size_t count,
+                           const sockaddr* addr);
   static void SetMembership(const v8::FunctionCallbackInfo<v8::Value>& args,
                             uv_membership membership);
   static void SetSourceMembership(
@@ -211,6 +249,17 @@ class UDPWrap final : public HandleWrap,
 
   uv_udp_t handle_;
 
+  // With a batch size above 1, datagrams are read with recvmmsg() into
+  // `recv_slab_` and handed to JS together, see OnBatchRecv().
+  uint32_t recv_batch_size_ = 0;
+  std::unique_ptr<char[]> recv_slab_;
+  std::vector<RecvChunk> recv_chunks_;
+
+  std::unique_ptr<SocketAddressRateLimiter> rate_limiter_;
+
+  // Set once the kernel has rejected UDP_SEGMENT on this socket.
+  bool segmented_send_disabled_ = false;
+
   bool current_send_has_callback_;
   v8::Local<v8::Object> current_send_req_wrap_;
 };
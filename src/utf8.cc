@@ -0,0 +1,673 @@
+#include "utf8.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+# define NODE_UTF8_X86 1
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  include <immintrin.h>
+#  define NODE_UTF8_TARGET(features)
+# else
+#  include <immintrin.h>
+#  define NODE_UTF8_TARGET(features) __attribute__((target(features)))
+# endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+# define NODE_UTF8_NEON 1
+# include <arm_neon.h>
+#endif
+
+namespace node {
+
+namespace {
+
+inline bool IsAsciiWord(const char* src) {
+  uint64_t word;
+  memcpy(&word, src, sizeof(word));
+  return (word & 0x8080808080808080ULL) == 0;
+}
+
+inline bool IsContinuation(uint8_t c) {
+  return (c & 0xc0) == 0x80;
+}
+
+// Finish what the ASCII kernels below leave over, from `i` on.
+size_t AsciiPrefixTail(const char* src, size_t i, size_t len) {
+  while (i < len && static_cast<uint8_t>(src[i]) < 0x80)
+    i++;
+  return i;
+}
+
+bool CopyForceAsciiTail(const char* src, char* dst, size_t i, size_t len) {
+  uint8_t seen = 0;
+  for (; i < len; i++) {
+    seen |= static_cast<uint8_t>(src[i]);
+    dst[i] = src[i] & 0x7f;
+  }
+  return seen & 0x80;
+}
+
+Utf8Content Classify(size_t chars, uint8_t max, size_t* utf16_length) {
+  *utf16_length = chars;
+  if (max < 0x80)
+    return Utf8Content::ASCII;
+  // Valid UTF-8 only has lead bytes up to 0xc3 for code points below 0x100.
+  if (max < 0xc4)
+    return Utf8Content::LATIN1;
+  return Utf8Content::TWO_BYTE;
+}
+
+Utf8Content ClassifyScalar(const uint8_t* src,
+                           size_t len,
+                           size_t* utf16_length) {
+  size_t chars = 0;
+  uint8_t max = 0;
+  size_t i = 0;
+  while (i < len) {
+    if (i + 8 <= len && IsAsciiWord(reinterpret_cast<const char*>(src + i))) {
+      chars += 8;
+      i += 8;
+      continue;
+    }
+    const uint8_t c = src[i];
+    if (c > max)
+      max = c;
+    if (c < 0x80) {
+      chars += 1;
+      i += 1;
+    } else if (c < 0xc2) {
+      return Utf8Content::INVALID;
+    } else if (c < 0xe0) {
+      if (i + 1 >= len || !IsContinuation(src[i + 1]))
+        return Utf8Content::INVALID;
+      chars += 1;
+      i += 2;
+    } else if (c < 0xf0) {
+      if (i + 2 >= len ||
+          !IsContinuation(src[i + 1]) ||
+          !IsContinuation(src[i + 2]) ||
+          (c == 0xe0 && src[i + 1] < 0xa0) ||   // Overlong.
+          (c == 0xed && src[i + 1] > 0x9f)) {   // Surrogate.
+        return Utf8Content::INVALID;
+      }
+      chars += 1;
+      i += 3;
+    } else if (c < 0xf5) {
+      if (i + 3 >= len ||
+          !IsContinuation(src[i + 1]) ||
+          !IsContinuation(src[i + 2]) ||
+          !IsContinuation(src[i + 3]) ||
+          (c == 0xf0 && src[i + 1] < 0x90) ||   // Overlong.
+          (c == 0xf4 && src[i + 1] > 0x8f)) {   // Above U+10FFFF.
+        return Utf8Content::INVALID;
+      }
+      chars += 2;  // A surrogate pair.
+      i += 4;
+    } else {
+      return Utf8Content::INVALID;
+    }
+  }
+  return Classify(chars, max, utf16_length);
+}
+
+// The vectorized validation follows J. Keiser and D. Lemire, "Validating
+// UTF-8 In Less Than One Instruction Per Byte". Each byte is checked
+// together with the one before it through three 16-entry tables, which
+// flag all errors in two-byte windows; whether continuation bytes are
+// where three- and four-byte sequences need them is checked separately.
+// The last block is padded with zeros, which turns a sequence that is cut
+// off at the end of the input into an error, too.
+
+// Error bits, for (previous byte, current byte).
+constexpr uint8_t kTooShort = 1 << 0;     // 11______ 0_______/11______
+constexpr uint8_t kTooLong = 1 << 1;      // 0_______ 10______
+constexpr uint8_t kOverlong3 = 1 << 2;    // 11100000 100_____
+constexpr uint8_t kTooLarge = 1 << 3;     // 11110100 1001____ and more
+constexpr uint8_t kSurrogate = 1 << 4;    // 11101101 101_____
+constexpr uint8_t kOverlong2 = 1 << 5;    // 1100000_ 10______
+constexpr uint8_t kTooLarge1000 = 1 << 6;  // 11110101+ 1000____
+constexpr uint8_t kOverlong4 = 1 << 6;    // 11110000 1000____
+constexpr uint8_t kTwoConts = 1 << 7;     // 10______ 10______
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+// Indexed by the high nibble of the previous byte.
+constexpr uint8_t kByte1High[16] = {
+  kTooLong, kTooLong, kTooLong, kTooLong,
+  kTooLong, kTooLong, kTooLong, kTooLong,
+  kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+  kTooShort | kOverlong2,
+  kTooShort,
+  kTooShort | kOverlong3 | kSurrogate,
+  kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+};
+
+// Indexed by the low nibble of the previous byte.
+constexpr uint8_t kByte1Low[16] = {
+  kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+  kCarry | kOverlong2,
+  kCarry,
+  kCarry,
+  kCarry | kTooLarge,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+  kCarry | kTooLarge | kTooLarge1000,
+  kCarry | kTooLarge | kTooLarge1000
+};
+
+// Indexed by the high nibble of the current byte.
+constexpr uint8_t kByte2High[16] = {
+  kTooShort, kTooShort, kTooShort, kTooShort,
+  kTooShort, kTooShort, kTooShort, kTooShort,
+  kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+  kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+  kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+  kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+  kTooShort, kTooShort, kTooShort, kTooShort
+};
+
+size_t AsciiPrefixScalar(const char* src, size_t len) {
+  size_t i = 0;
+  while (i + 8 <= len && IsAsciiWord(src + i))
+    i += 8;
+  return AsciiPrefixTail(src, i, len);
+}
+
+bool CopyForceAsciiScalar(const char* src, char* dst, size_t len) {
+  return CopyForceAsciiTail(src, dst, 0, len);
+}
+
+struct Kernels {
+  Utf8Content (*classify)(const uint8_t* src,
+                          size_t len,
+                          size_t* utf16_length) = ClassifyScalar;
+  size_t (*ascii_prefix)(const char* src, size_t len) = AsciiPrefixScalar;
+  bool (*copy_force_ascii)(const char* src, char* dst, size_t len) =
+      CopyForceAsciiScalar;
+};
+
+#ifdef NODE_UTF8_X86
+
+NODE_UTF8_TARGET("avx2")
+inline __m256i Lookup16Avx2(const uint8_t* table, __m256i indices) {
+  const __m256i lookup = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+  return _mm256_shuffle_epi8(lookup, indices);
+}
+
+NODE_UTF8_TARGET("avx2")
+inline size_t CountAvx2(__m256i mask) {
+  return _mm_popcnt_u32(static_cast<uint32_t>(_mm256_movemask_epi8(mask)));
+}
+
+class Utf8CheckerAvx2 {
+ public:
+  NODE_UTF8_TARGET("avx2")
+  Utf8CheckerAvx2()
+      : error_(_mm256_setzero_si256()),
+        max_(_mm256_setzero_si256()),
+        prev_input_(_mm256_setzero_si256()),
+        prev_incomplete_(_mm256_setzero_si256()) {}
+
+  NODE_UTF8_TARGET("avx2")
+  void Check(__m256i input) {
+    max_ = _mm256_max_epu8(max_, input);
+    // Not a continuation byte, and four-byte lead bytes once more.
+    chars_ += CountAvx2(_mm256_cmpgt_epi8(input, _mm256_set1_epi8(-65)));
+    chars_ += CountAvx2(_mm256_cmpeq_epi8(
+        _mm256_max_epu8(input, _mm256_set1_epi8(0xf0)), input));
+
+    if (_mm256_movemask_epi8(input) == 0) {
+      error_ = _mm256_or_si256(error_, prev_incomplete_);
+      prev_input_ = input;
+      return;
+    }
+
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+    const __m256i prev_block =
+        _mm256_permute2x128_si256(prev_input_, input, 0x21);
+    const __m256i prev1 = _mm256_alignr_epi8(input, prev_block, 15);
+    const __m256i prev2 = _mm256_alignr_epi8(input, prev_block, 14);
+    const __m256i prev3 = _mm256_alignr_epi8(input, prev_block, 13);
+
+    const __m256i byte_1_high = Lookup16Avx2(
+        kByte1High,
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask));
+    const __m256i byte_1_low =
+        Lookup16Avx2(kByte1Low, _mm256_and_si256(prev1, nibble_mask));
+    const __m256i byte_2_high = Lookup16Avx2(
+        kByte2High,
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask));
+    const __m256i special = _mm256_and_si256(
+        _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    const __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0x60));
+    const __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0x70));
+    const __m256i must_be_continuation = _mm256_and_si256(
+        _mm256_or_si256(third, fourth), _mm256_set1_epi8(0x80));
+    error_ = _mm256_or_si256(error_,
+                             _mm256_xor_si256(must_be_continuation, special));
+
+    // Lead bytes at the end of the block that still need more bytes.
+    const __m256i max_value = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        0xf0 - 1, 0xe0 - 1, 0xc0 - 1);
+    prev_incomplete_ = _mm256_subs_epu8(input, max_value);
+    prev_input_ = input;
+  }
+
+  NODE_UTF8_TARGET("avx2")
+  Utf8Content Finish(size_t padding, size_t* utf16_length) {
+    if (!_mm256_testz_si256(error_, error_))
+      return Utf8Content::INVALID;
+    alignas(32) uint8_t max[32];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(max), max_);
+    uint8_t result = 0;
+    for (uint8_t value : max)
+      result = value > result ? value : result;
+    return Classify(chars_ - padding, result, utf16_length);
+  }
+
+ private:
+  __m256i error_;
+  __m256i max_;
+  __m256i prev_input_;
+  __m256i prev_incomplete_;
+  size_t chars_ = 0;
+};
+
+NODE_UTF8_TARGET("avx2")
+Utf8Content ClassifyAvx2(const uint8_t* src,
+                         size_t len,
+                         size_t* utf16_length) {
+  Utf8CheckerAvx2 checker;
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    checker.Check(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+  }
+
+  // Always checks a padded block, even if it holds no input at all.
+  alignas(32) uint8_t tail[32] = {};
+  memcpy(tail, src + i, len - i);
+  checker.Check(_mm256_load_si256(reinterpret_cast<const __m256i*>(tail)));
+  return checker.Finish(32 - (len - i), utf16_length);
+}
+
+inline size_t FirstSetBit(uint64_t mask) {
+#ifdef _MSC_VER
+  unsigned long index;  // NOLINT(runtime/int)
+  _BitScanForward64(&index, mask);
+  return index;
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
+
+// SSE2 is part of the x86-64 baseline.
+size_t AsciiPrefixSse2(const char* src, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    if (mask != 0)
+      return i + FirstSetBit(mask);
+  }
+  return AsciiPrefixTail(src, i, len);
+}
+
+bool CopyForceAsciiSse2(const char* src, char* dst, size_t len) {
+  const __m128i mask = _mm_set1_epi8(0x7f);
+  __m128i seen = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    seen = _mm_or_si128(seen, v);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_and_si128(v, mask));
+  }
+  const bool tail = CopyForceAsciiTail(src, dst, i, len);
+  return tail || _mm_movemask_epi8(seen) != 0;
+}
+
+NODE_UTF8_TARGET("avx2")
+size_t AsciiPrefixAvx2(const char* src, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const uint32_t mask = _mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+    if (mask != 0)
+      return i + FirstSetBit(mask);
+  }
+  return AsciiPrefixTail(src, i, len);
+}
+
+NODE_UTF8_TARGET("avx2")
+bool CopyForceAsciiAvx2(const char* src, char* dst, size_t len) {
+  const __m256i mask = _mm256_set1_epi8(0x7f);
+  __m256i seen = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    seen = _mm256_or_si256(seen, v);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_and_si256(v, mask));
+  }
+  const bool tail = CopyForceAsciiTail(src, dst, i, len);
+  return tail || _mm256_movemask_epi8(seen) != 0;
+}
+
+// With AVX-512 the tail is handled with masked loads and stores, which do
+// not touch the bytes that are masked out.
+NODE_UTF8_TARGET("avx512f,avx512bw")
+size_t AsciiPrefixAvx512(const char* src, size_t len) {
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    const uint64_t mask = _mm512_movepi8_mask(_mm512_loadu_si512(src + i));
+    if (mask != 0)
+      return i + FirstSetBit(mask);
+  }
+  if (i == len)
+    return len;
+  const __mmask64 tail = (uint64_t{1} << (len - i)) - 1;
+  const uint64_t mask =
+      _mm512_movepi8_mask(_mm512_maskz_loadu_epi8(tail, src + i));
+  return mask != 0 ? i + FirstSetBit(mask) : len;
+}
+
+NODE_UTF8_TARGET("avx512f,avx512bw")
+bool CopyForceAsciiAvx512(const char* src, char* dst, size_t len) {
+  const __m512i mask = _mm512_set1_epi8(0x7f);
+  __m512i seen = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    const __m512i v = _mm512_loadu_si512(src + i);
+    seen = _mm512_or_si512(seen, v);
+    _mm512_storeu_si512(dst + i, _mm512_and_si512(v, mask));
+  }
+  if (i < len) {
+    const __mmask64 tail = (uint64_t{1} << (len - i)) - 1;
+    const __m512i v = _mm512_maskz_loadu_epi8(tail, src + i);
+    seen = _mm512_or_si512(seen, v);
+    _mm512_mask_storeu_epi8(dst + i, tail, _mm512_and_si512(v, mask));
+  }
+  return _mm512_movepi8_mask(seen) != 0;
+}
+
+Kernels SelectKernels() {
+  bool avx2;
+  bool avx512;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] >> 27) & 1;
+  const bool popcnt = (info[2] >> 23) & 1;
+  const uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+  __cpuidex(info, 7, 0);
+  avx2 = popcnt && ((info[1] >> 5) & 1) && (xcr0 & 0x6) == 0x6;
+  avx512 = ((info[1] >> 16) & 1) && ((info[1] >> 30) & 1) &&
+           (xcr0 & 0xe6) == 0xe6;
+#else
+  __builtin_cpu_init();
+  avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+  avx512 = __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw");
+#endif
+
+  Kernels kernels;
+  kernels.ascii_prefix = AsciiPrefixSse2;
+  kernels.copy_force_ascii = CopyForceAsciiSse2;
+  if (avx2) {
+    kernels.classify = ClassifyAvx2;
+    kernels.ascii_prefix = AsciiPrefixAvx2;
+    kernels.copy_force_ascii = CopyForceAsciiAvx2;
+  }
+  if (avx512) {
+    kernels.ascii_prefix = AsciiPrefixAvx512;
+    kernels.copy_force_ascii = CopyForceAsciiAvx512;
+  }
+  return kernels;
+}
+
+#elif defined(NODE_UTF8_NEON)
+
+inline uint8x16_t Lookup16Neon(const uint8_t* table, uint8x16_t indices) {
+  return vqtbl1q_u8(vld1q_u8(table), indices);
+}
+
+inline size_t CountNeon(uint8x16_t mask) {
+  return vaddvq_u8(vshrq_n_u8(mask, 7));
+}
+
+class Utf8CheckerNeon {
+ public:
+  void Check(uint8x16_t input) {
+    max_ = vmaxq_u8(max_, input);
+    chars_ += CountNeon(
+        vcgtq_s8(vreinterpretq_s8_u8(input), vdupq_n_s8(-65)));
+    chars_ += CountNeon(vcgeq_u8(input, vdupq_n_u8(0xf0)));
+
+    if (vmaxvq_u8(input) < 0x80) {
+      error_ = vorrq_u8(error_, prev_incomplete_);
+      prev_input_ = input;
+      return;
+    }
+
+    const uint8x16_t nibble_mask = vdupq_n_u8(0x0f);
+    const uint8x16_t prev1 = vextq_u8(prev_input_, input, 15);
+    const uint8x16_t prev2 = vextq_u8(prev_input_, input, 14);
+    const uint8x16_t prev3 = vextq_u8(prev_input_, input, 13);
+
+    const uint8x16_t byte_1_high =
+        Lookup16Neon(kByte1High, vshrq_n_u8(prev1, 4));
+    const uint8x16_t byte_1_low =
+        Lookup16Neon(kByte1Low, vandq_u8(prev1, nibble_mask));
+    const uint8x16_t byte_2_high =
+        Lookup16Neon(kByte2High, vshrq_n_u8(input, 4));
+    const uint8x16_t special =
+        vandq_u8(vandq_u8(byte_1_high, byte_1_low), byte_2_high);
+
+    const uint8x16_t third = vqsubq_u8(prev2, vdupq_n_u8(0x60));
+    const uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0x70));
+    const uint8x16_t must_be_continuation =
+        vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+    error_ = vorrq_u8(error_, veorq_u8(must_be_continuation, special));
+
+    static const uint8_t max_value[16] = {
+      255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+      0xf0 - 1, 0xe0 - 1, 0xc0 - 1
+    };
+    prev_incomplete_ = vqsubq_u8(input, vld1q_u8(max_value));
+    prev_input_ = input;
+  }
+
+  Utf8Content Finish(size_t padding, size_t* utf16_length) {
+    if (vmaxvq_u8(error_) != 0)
+      return Utf8Content::INVALID;
+    return Classify(chars_ - padding, vmaxvq_u8(max_), utf16_length);
+  }
+
+ private:
+  uint8x16_t error_ = vdupq_n_u8(0);
+  uint8x16_t max_ = vdupq_n_u8(0);
+  uint8x16_t prev_input_ = vdupq_n_u8(0);
+  uint8x16_t prev_incomplete_ = vdupq_n_u8(0);
+  size_t chars_ = 0;
+};
+
+Utf8Content ClassifyNeon(const uint8_t* src,
+                         size_t len,
+                         size_t* utf16_length) {
+  Utf8CheckerNeon checker;
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16)
+    checker.Check(vld1q_u8(src + i));
+
+  // Always checks a padded block, even if it holds no input at all.
+  uint8_t tail[16] = {};
+  memcpy(tail, src + i, len - i);
+  checker.Check(vld1q_u8(tail));
+  return checker.Finish(16 - (len - i), utf16_length);
+}
+
+size_t AsciiPrefixNeon(const char* src, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    if (vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(src + i))) >= 0x80)
+      break;
+  }
+  return AsciiPrefixTail(src, i, len);
+}
+
+bool CopyForceAsciiNeon(const char* src, char* dst, size_t len) {
+  const uint8x16_t mask = vdupq_n_u8(0x7f);
+  uint8x16_t seen = vdupq_n_u8(0);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+    seen = vorrq_u8(seen, v);
+    vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), vandq_u8(v, mask));
+  }
+  const bool tail = CopyForceAsciiTail(src, dst, i, len);
+  return tail || vmaxvq_u8(seen) >= 0x80;
+}
+
+Kernels SelectKernels() {
+  // NEON is part of the baseline of arm64.
+  Kernels kernels;
+  kernels.classify = ClassifyNeon;
+  kernels.ascii_prefix = AsciiPrefixNeon;
+  kernels.copy_force_ascii = CopyForceAsciiNeon;
+  return kernels;
+}
+
+#else
+
+Kernels SelectKernels() {
+  return Kernels();
+}
+
+#endif
+
+const Kernels& GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+}  // anonymous namespace
+
+Utf8Content utf8_classify(const char* src, size_t len, size_t* utf16_length) {
+  return GetKernels().classify(
+      reinterpret_cast<const uint8_t*>(src), len, utf16_length);
+}
+
+size_t utf8_to_latin1(const char* src, size_t len, char* dst) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src);
+  size_t i = 0;
+  size_t k = 0;
+  while (i < len) {
+    if (i + 8 <= len && IsAsciiWord(src + i)) {
+      memcpy(dst + k, src + i, 8);
+      i += 8;
+      k += 8;
+      continue;
+    }
+    const uint8_t c = bytes[i];
+    if (c < 0x80) {
+      dst[k++] = c;
+      i += 1;
+    } else {
+      dst[k++] = static_cast<char>(((c & 0x1f) << 6) | (bytes[i + 1] & 0x3f));
+      i += 2;
+    }
+  }
+  return k;
+}
+
+size_t utf8_to_utf16(const char* src, size_t len, uint16_t* dst) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src);
+  size_t i = 0;
+  size_t k = 0;
+  while (i < len) {
+    if (i + 8 <= len && IsAsciiWord(src + i)) {
+      for (size_t j = 0; j < 8; j++)
+        dst[k + j] = bytes[i + j];
+      i += 8;
+      k += 8;
+      continue;
+    }
+    const uint32_t c = bytes[i];
+    if (c < 0x80) {
+      dst[k++] = c;
+      i += 1;
+    } else if (c < 0xe0) {
+      dst[k++] = ((c & 0x1f) << 6) | (bytes[i + 1] & 0x3f);
+      i += 2;
+    } else if (c < 0xf0) {
+      dst[k++] = ((c & 0x0f) << 12) |
+                 ((bytes[i + 1] & 0x3f) << 6) |
+                 (bytes[i + 2] & 0x3f);
+      i += 3;
+    } else {
+      const uint32_t code_point = ((c & 0x07) << 18) |
+                                  ((bytes[i + 1] & 0x3f) << 12) |
+                                  ((bytes[i + 2] & 0x3f) << 6) |
+                                  (bytes[i + 3] & 0x3f);
+      dst[k++] = 0xd800 + ((code_point - 0x10000) >> 10);
+      dst[k++] = 0xdc00 + (code_point & 0x3ff);
+      i += 4;
+    }
+  }
+  return k;
+}
+
+size_t latin1_to_utf8(const char* src,
+                      size_t len,
+                      char* dst,
+                      size_t dstlen,
+                      size_t* chars_read) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src);
+  size_t i = 0;
+  size_t k = 0;
+  while (i < len) {
+    if (i + 8 <= len && k + 8 <= dstlen && IsAsciiWord(src + i)) {
+      memcpy(dst + k, src + i, 8);
+      i += 8;
+      k += 8;
+      continue;
+    }
+    const uint8_t c = bytes[i];
+    if (c < 0x80) {
+      if (k + 1 > dstlen)
+        break;
+      dst[k++] = c;
+    } else {
+      if (k + 2 > dstlen)
+        break;
+      dst[k++] = static_cast<char>(0xc0 | (c >> 6));
+      dst[k++] = static_cast<char>(0x80 | (c & 0x3f));
+    }
+    i += 1;
+  }
+  *chars_read = i;
+  return k;
+}
+
+size_t ascii_prefix_length(const char* src, size_t len) {
+  return GetKernels().ascii_prefix(src, len);
+}
+
+bool copy_force_ascii(const char* src, char* dst, size_t len) {
+  return GetKernels().copy_force_ascii(src, dst, len);
+}
+
+}  // namespace node
@@ -0,0 +1,52 @@
+#ifndef SRC_UTF8_H_
+#define SRC_UTF8_H_
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace node {
+//// UTF-8 ////
+
+// What a buffer of UTF-8 decodes to. Only strict UTF-8 counts as valid,
+// that is, without overlong forms, surrogates or code points above
+// U+10FFFF, so that valid input decodes the same way everywhere.
+enum class Utf8Content {
+  ASCII,     // Nothing but ASCII, so the bytes can be used as they are.
+  LATIN1,    // All code points are below U+0100.
+  TWO_BYTE,  // Needs UTF-16.
+  INVALID
+};
+
+// Validates and classifies `src` in a single pass, and if it is valid,
+// stores the number of UTF-16 code units that it decodes to in
+// `*utf16_length`. Uses vector instructions where the CPU has them.
+Utf8Content utf8_classify(const char* src, size_t len, size_t* utf16_length);
+
+// Decode valid UTF-8 that has been classified as LATIN1, or as LATIN1 or
+// TWO_BYTE respectively. Return the number of characters written.
+size_t utf8_to_latin1(const char* src, size_t len, char* dst);
+size_t utf8_to_utf16(const char* src, size_t len, uint16_t* dst);
+
+// Encodes Latin1 as UTF-8, writing whole characters only. Returns the number
+// of bytes written to `dst`, and stores the number of characters that they
+// encode in `*chars_read`.
+size_t latin1_to_utf8(const char* src,
+                      size_t len,
+                      char* dst,
+                      size_t dstlen,
+                      size_t* chars_read);
+
+// Returns the length of the longest prefix of `src` that is pure ASCII.
+size_t ascii_prefix_length(const char* src, size_t len);
+
+// Copies `src` to `dst` with the high bit of every byte cleared, and
+// returns whether any byte had it set.
+bool copy_force_ascii(const char* src, char* dst, size_t len);
+
+}  // namespace node
+
+#endif  // defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+#endif  // SRC_UTF8_H_
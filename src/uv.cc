@@ -53,6 +53,7 @@ using v8::Integer;
 using v8::Isolate;
 using v8::Local;
 using v8::Map;
+using v8::Number;
 using v8::Object;
 using v8::PropertyAttribute;
 using v8::ReadOnly;
@@ -103,6 +104,54 @@ void GetErrMap(const FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(err_map);
 }
 
+// Returns a snapshot of uv_metrics_info() for the current thread's loop.
+// Times are converted to milliseconds to match loop idle time elsewhere.
+void GetLoopMetrics(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+
+  uv_metrics_t metrics;
+  CHECK_EQ(uv_metrics_info(env->event_loop(), &metrics), 0);
+
+  Local<Object> handles = Object::New(isolate);
+  for (int type = UV_UNKNOWN_HANDLE + 1; type < UV_HANDLE_TYPE_MAX; type++) {
+    const char* name =
+        uv_handle_type_name(static_cast<uv_handle_type>(type));
+    if (name == nullptr) continue;
+    if (handles->Set(context,
+                     OneByteString(isolate, name),
+                     Number::New(isolate, static_cast<double>(
+                         metrics.active_handles[type]))).IsNothing()) {
+      return;
+    }
+  }
+
+  const std::pair<const char*, double> fields[] = {
+    {"loopCount", static_cast<double>(metrics.loop_count)},
+    {"events", static_cast<double>(metrics.events)},
+    {"pollCount", static_cast<double>(metrics.poll_count)},
+    {"idleTime", metrics.idle_time / 1e6},
+    {"pollCallbackTime", metrics.poll_callback_time / 1e6},
+    {"threadpoolPending", static_cast<double>(metrics.threadpool_pending)},
+  };
+  Local<Object> result = Object::New(isolate);
+  for (const auto& field : fields) {
+    if (result->Set(context,
+                    OneByteString(isolate, field.first),
+                    Number::New(isolate, field.second)).IsNothing()) {
+      return;
+    }
+  }
+  if (result->Set(context,
+                  OneByteString(isolate, "activeHandles"),
+                  handles).IsNothing()) {
+    return;
+  }
+
+  args.GetReturnValue().Set(result);
+}
+
 void Initialize(Local<Object> target,
                 Local<Value> unused,
                 Local<Context> context,
@@ -129,11 +178,13 @@ void Initialize(Local<Object> target,
   }
 
   env->SetMethod(target, "getErrorMap", GetErrMap);
+  env->SetMethod(target, "getLoopMetrics", GetLoopMetrics);
 }
 
 void RegisterExternalReferences(ExternalReferenceRegistry* registry) {
   registry->Register(ErrName);
   registry->Register(GetErrMap);
+  registry->Register(GetLoopMetrics);
 }
 }  // namespace uv
 }  // namespace node
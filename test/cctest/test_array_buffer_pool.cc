@@ -0,0 +1,50 @@
+#include "array_buffer_pool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace array_buffer_pool = node::array_buffer_pool;
+
+TEST(ArrayBufferPoolTest, BlockSize) {
+  EXPECT_FALSE(array_buffer_pool::Serves(0));
+  EXPECT_FALSE(array_buffer_pool::Serves(array_buffer_pool::kMaxBlockSize + 1));
+  EXPECT_EQ(16u, array_buffer_pool::BlockSize(1));
+  EXPECT_EQ(128u, array_buffer_pool::BlockSize(128));
+  EXPECT_EQ(160u, array_buffer_pool::BlockSize(129));
+  for (size_t size = 1; size <= array_buffer_pool::kMaxBlockSize; size++) {
+    const size_t block_size = array_buffer_pool::BlockSize(size);
+    ASSERT_GE(block_size, size);
+    ASSERT_LE(block_size, size + size / 4 + 16);
+    ASSERT_EQ(0u, block_size % 16);
+  }
+}
+
+TEST(ArrayBufferPoolTest, AllocateAndFree) {
+  std::vector<std::pair<uint8_t*, size_t>> blocks;
+  for (size_t i = 0; i < 4096; i++) {
+    const size_t size = 1 + (i * 37) % array_buffer_pool::kMaxBlockSize;
+    uint8_t* data = static_cast<uint8_t*>(array_buffer_pool::Allocate(size));
+    ASSERT_NE(nullptr, data);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(data) % 16);
+    memset(data, static_cast<int>(i), size);
+    blocks.emplace_back(data, size);
+  }
+  EXPECT_GT(array_buffer_pool::GetStatistics().used, 0u);
+
+  // Free half of them on another thread.
+  std::thread([&]() {
+    for (size_t i = 0; i < blocks.size(); i += 2)
+      array_buffer_pool::Free(blocks[i].first, blocks[i].second);
+  }).join();
+  for (size_t i = 1; i < blocks.size(); i += 2) {
+    uint8_t* data = blocks[i].first;
+    const size_t size = blocks[i].second;
+    EXPECT_EQ(static_cast<uint8_t>(i), data[0]);
+    EXPECT_EQ(static_cast<uint8_t>(i), data[size - 1]);
+    array_buffer_pool::Free(data, size);
+  }
+}
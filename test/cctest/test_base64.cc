@@ -2,6 +2,8 @@
 
 #include <cstddef>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -140,3 +142,43 @@ TEST(Base64Test, Decode) {
        "dCBjdXBpZGF0YXQgbm9uIHByb2lkZW50LCBzdW50IGluIGN1bHBhIHF1aSBvZmZpY2lh\n"
        "IGRlc2VydW50IG1vbGxpdCBhbmltIGlkIGVzdCBsYWJvcnVtLg", text);
 }
+
+TEST(Base64Test, LongInput) {
+  // Long enough to go through the vectorized kernels, if there are any.
+  std::string data;
+  for (int i = 0; i < 1000; i++)
+    data += static_cast<char>(i * 7 + (i >> 3));
+
+  for (node::Base64Mode mode : { node::Base64Mode::NORMAL,
+                                 node::Base64Mode::URL }) {
+    for (size_t len = 60; len < data.size(); len += 37) {
+      std::string encoded(node::base64_encoded_size(len, mode), '\0');
+      base64_encode(data.data(), len, &encoded[0], encoded.size(), mode);
+
+      std::string decoded(len, '\0');
+      EXPECT_EQ(len, base64_decode(&decoded[0], decoded.size(),
+                                   encoded.data(), encoded.size()));
+      EXPECT_EQ(data.substr(0, len), decoded);
+
+      std::vector<uint16_t> wide(encoded.begin(), encoded.end());
+      std::string decoded_wide(len, '\0');
+      EXPECT_EQ(len, base64_decode(&decoded_wide[0], decoded_wide.size(),
+                                   wide.data(), wide.size()));
+      EXPECT_EQ(data.substr(0, len), decoded_wide);
+    }
+  }
+
+  // Whitespace, other junk and padding in the middle of long input.
+  std::string encoded(node::base64_encoded_size(data.size()), '\0');
+  base64_encode(data.data(), data.size(), &encoded[0], encoded.size());
+  std::string spaced = encoded.substr(0, 400) + " \n*" + encoded.substr(400);
+  std::string decoded(data.size(), '\0');
+  EXPECT_EQ(data.size(), base64_decode(&decoded[0], decoded.size(),
+                                       spaced.data(), spaced.size()));
+  EXPECT_EQ(data, decoded);
+
+  std::string padded = encoded.substr(0, 400) + "=" + encoded.substr(400);
+  EXPECT_EQ(300u, base64_decode(&decoded[0], decoded.size(),
+                                padded.data(), padded.size()));
+  EXPECT_EQ(data.substr(0, 300), decoded.substr(0, 300));
+}
@@ -0,0 +1,77 @@
+#include "callback_queue-inl.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace CallbackFlags = node::CallbackFlags;
+using node::CallbackQueue;
+using node::ThreadsafeCallbackQueue;
+
+TEST(CallbackQueueTest, ThreadsafePushPopAll) {
+  ThreadsafeCallbackQueue<void, std::vector<int>*> queue;
+  EXPECT_TRUE(queue.empty());
+
+  for (int i = 0; i < 3; i++) {
+    bool was_empty = queue.Push(queue.CreateCallback(
+        [i](std::vector<int>* out) { out->push_back(i); },
+        CallbackFlags::kRefed));
+    EXPECT_EQ(was_empty, i == 0);
+  }
+  EXPECT_FALSE(queue.empty());
+
+  CallbackQueue<void, std::vector<int>*> drained;
+  queue.PopAll(&drained);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(drained.size(), 3u);
+
+  std::vector<int> out;
+  while (auto head = drained.Shift())
+    head->Call(&out);
+  EXPECT_EQ(out, (std::vector<int> { 0, 1, 2 }));
+
+  // The next push after draining reports an empty queue again.
+  EXPECT_TRUE(queue.Push(queue.CreateCallback(
+      [](std::vector<int>* out) {}, CallbackFlags::kUnrefed)));
+}
+
+TEST(CallbackQueueTest, ThreadsafeConcurrentPush) {
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 1000;
+  ThreadsafeCallbackQueue<void, std::vector<int>*> queue;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&queue, t]() {
+      for (int i = 0; i < kPerThread; i++) {
+        queue.Push(queue.CreateCallback(
+            [t, i](std::vector<int>* out) {
+              out->push_back(t * kPerThread + i);
+            }, CallbackFlags::kRefed));
+      }
+    });
+  }
+
+  std::vector<int> out;
+  CallbackQueue<void, std::vector<int>*> drained;
+  auto drain = [&]() {
+    queue.PopAll(&drained);
+    while (auto head = drained.Shift())
+      head->Call(&out);
+  };
+  while (out.size() < kThreads * kPerThread / 2)
+    drain();
+  for (std::thread& thread : threads)
+    thread.join();
+  drain();
+
+  ASSERT_EQ(out.size(), static_cast<size_t>(kThreads * kPerThread));
+  // Entries from a single producer stay in the order they were pushed.
+  std::vector<int> last(kThreads, -1);
+  for (int value : out) {
+    int t = value / kPerThread;
+    EXPECT_LT(last[t], value);
+    last[t] = value;
+  }
+}
@@ -0,0 +1,111 @@
+#include "chunk_list.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+using node::ChunkList;
+
+namespace {
+
+using Owner = std::shared_ptr<std::string>;
+
+void Push(ChunkList<Owner>* list, const char* data) {
+  Owner owner = std::make_shared<std::string>(data);
+  const char* start = owner->data();
+  list->Push(owner, start, owner->size());
+}
+
+std::string Contents(const ChunkList<Owner>& list) {
+  std::string contents(list.length(), '\0');
+  list.CopyOut(0, &contents[0], list.length());
+  return contents;
+}
+
+}  // anonymous namespace
+
+TEST(ChunkListTest, PushAndConsume) {
+  ChunkList<Owner> list;
+  Push(&list, "abc");
+  Push(&list, "");
+  Push(&list, "defg");
+  Push(&list, "h");
+  EXPECT_EQ(list.length(), 8u);
+  EXPECT_EQ(list.chunk_count(), 3u);
+  EXPECT_EQ(Contents(list), "abcdefgh");
+
+  // Within a slice, the slice is trimmed in place.
+  const char* data = list.chunk(1).data;
+  list.Consume(1);
+  EXPECT_EQ(Contents(list), "bcdefgh");
+  list.Consume(4);
+  EXPECT_EQ(list.chunk_count(), 2u);
+  EXPECT_EQ(list.chunk(0).data, data + 2);
+  EXPECT_EQ(Contents(list), "fgh");
+
+  list.Consume(100);
+  EXPECT_EQ(list.length(), 0u);
+  EXPECT_EQ(list.chunk_count(), 0u);
+}
+
+TEST(ChunkListTest, OwnersAreKept) {
+  ChunkList<Owner> list;
+  Owner owner = std::make_shared<std::string>("abcdef");
+  list.Push(owner, owner->data(), 3);
+  list.Push(owner, owner->data() + 3, 3);
+  EXPECT_EQ(owner.use_count(), 3);
+  list.Consume(4);
+  EXPECT_EQ(owner.use_count(), 2);
+  list.Clear();
+  EXPECT_EQ(owner.use_count(), 1);
+}
+
+TEST(ChunkListTest, IndexOf) {
+  ChunkList<Owner> list;
+  Push(&list, "GET / HTTP/1.1\r");
+  Push(&list, "\nHost: a\r\n");
+  Push(&list, "\r");
+  Push(&list, "\n");
+
+  EXPECT_EQ(list.IndexOf("\r\n", 2, 0), 14);
+  EXPECT_EQ(list.IndexOf("\r\n", 2, 15), 23);
+  EXPECT_EQ(list.IndexOf("\r\n\r\n", 4, 0), 23);
+  EXPECT_EQ(list.IndexOf("Host", 4, 0), 16);
+  EXPECT_EQ(list.IndexOf("Host", 4, 17), -1);
+  EXPECT_EQ(list.IndexOf("\n", 1, 27), -1);
+  EXPECT_EQ(list.IndexOf("\n", 1, 25), 26);
+  EXPECT_EQ(list.IndexOf("\r\n\r\n\r", 5, 0), -1);
+  EXPECT_EQ(list.IndexOf("", 0, 3), 3);
+  EXPECT_EQ(list.IndexOf("", 0, 100), 27);
+
+  // Offsets are relative to what is left.
+  list.Consume(16);
+  EXPECT_EQ(list.IndexOf("Host", 4, 0), 0);
+  EXPECT_EQ(list.IndexOf("\r\n\r\n", 4, 0), 7);
+}
+
+TEST(ChunkListTest, FindContiguous) {
+  ChunkList<Owner> list;
+  Push(&list, "abc");
+  Push(&list, "def");
+
+  size_t chunk_offset;
+  const ChunkList<Owner>::Chunk* chunk =
+      list.FindContiguous(1, 2, &chunk_offset);
+  ASSERT_NE(chunk, nullptr);
+  EXPECT_EQ(chunk, &list.chunk(0));
+  EXPECT_EQ(chunk_offset, 1u);
+
+  chunk = list.FindContiguous(3, 3, &chunk_offset);
+  ASSERT_NE(chunk, nullptr);
+  EXPECT_EQ(chunk, &list.chunk(1));
+  EXPECT_EQ(chunk_offset, 0u);
+
+  EXPECT_EQ(list.FindContiguous(2, 2, &chunk_offset), nullptr);
+  EXPECT_EQ(list.FindContiguous(6, 0, &chunk_offset), nullptr);
+
+  char out[4] = {};
+  list.CopyOut(2, out, 3);
+  EXPECT_STREQ(out, "cde");
+}
@@ -0,0 +1,136 @@
+#include "cppgc_helpers-inl.h"
+#include "gtest/gtest.h"
+#include "node.h"
+#include "node_test_fixture.h"
+
+#include "cppgc/allocation.h"
+#include "cppgc/persistent.h"
+#include "cppgc/testing.h"
+
+using node::CppgcMixin;
+using node::Environment;
+using v8::FunctionTemplate;
+using v8::HandleScope;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+
+class CppgcTest : public EnvironmentTestFixture {
+ protected:
+  // Without the override, pointers left on the stack could keep objects
+  // alive.
+  void CollectGarbage() {
+    cppgc::testing::OverrideEmbedderStackStateScope scope(
+        isolate_->GetCppHeap()->GetHeapHandle(),
+        cppgc::EmbedderStackState::kNoHeapPointers);
+    isolate_->RequestGarbageCollectionForTesting(
+        Isolate::kFullGarbageCollection);
+  }
+};
+
+static int destroyed = 0;
+
+class DummyCppgcObject final : public cppgc::GarbageCollected<DummyCppgcObject>,
+                               public CppgcMixin {
+ public:
+  DummyCppgcObject(Environment* env, Local<Object> object) {
+    CppgcMixin::Wrap(this, env, object);
+  }
+  ~DummyCppgcObject() { destroyed++; }
+
+  static DummyCppgcObject* New(Environment* env) {
+    Local<FunctionTemplate> t = FunctionTemplate::New(env->isolate());
+    t->InstanceTemplate()->SetInternalFieldCount(
+        CppgcMixin::kInternalFieldCount);
+    Local<Object> object = t->GetFunction(env->context())
+                               .ToLocalChecked()
+                               ->NewInstance(env->context())
+                               .ToLocalChecked();
+    return cppgc::MakeGarbageCollected<DummyCppgcObject>(
+        CppgcMixin::GetAllocationHandle(env), env, object);
+  }
+
+  void Trace(cppgc::Visitor* visitor) const final {
+    CppgcMixin::Trace(visitor);
+  }
+};
+
+TEST_F(CppgcTest, CollectedWithWrapper) {
+  const HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env_{handle_scope, argv};
+  Environment* env = *env_;
+  v8::V8::SetFlagsFromString("--expose-gc");
+
+  destroyed = 0;
+  v8::Global<Object> global;
+  {
+    const HandleScope handle_scope(isolate_);
+    DummyCppgcObject* ptr = DummyCppgcObject::New(env);
+    Local<Object> object = ptr->object();
+    EXPECT_EQ(CppgcMixin::Unwrap<DummyCppgcObject>(object), ptr);
+    EXPECT_EQ(ptr->env(), env);
+    global.Reset(isolate_, object);
+  }
+
+  // The JS object keeps the C++ object alive.
+  CollectGarbage();
+  EXPECT_EQ(destroyed, 0);
+  {
+    const HandleScope handle_scope(isolate_);
+    EXPECT_NE(CppgcMixin::Unwrap<DummyCppgcObject>(global.Get(isolate_)),
+              nullptr);
+  }
+
+  global.Reset();
+  CollectGarbage();
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST_F(CppgcTest, PersistentKeepsWrapperAlive) {
+  const HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env_{handle_scope, argv};
+  Environment* env = *env_;
+  v8::V8::SetFlagsFromString("--expose-gc");
+
+  destroyed = 0;
+  cppgc::Persistent<DummyCppgcObject> persistent;
+  {
+    const HandleScope handle_scope(isolate_);
+    persistent = DummyCppgcObject::New(env);
+  }
+
+  // The C++ object keeps the JS object alive, too.
+  CollectGarbage();
+  EXPECT_EQ(destroyed, 0);
+  {
+    const HandleScope handle_scope(isolate_);
+    EXPECT_EQ(CppgcMixin::Unwrap<DummyCppgcObject>(persistent->object()),
+              persistent.Get());
+  }
+
+  persistent.Clear();
+  CollectGarbage();
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST_F(CppgcTest, UnwrapOtherObjects) {
+  const HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env_{handle_scope, argv};
+  Environment* env = *env_;
+
+  Local<Object> plain = Object::New(isolate_);
+  EXPECT_EQ(CppgcMixin::Unwrap<DummyCppgcObject>(plain), nullptr);
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(isolate_);
+  t->InstanceTemplate()->SetInternalFieldCount(
+      CppgcMixin::kInternalFieldCount);
+  Local<Object> object =
+      t->GetFunction(env->context()).ToLocalChecked()
+          ->NewInstance(env->context()).ToLocalChecked();
+  object->SetAlignedPointerInInternalField(CppgcMixin::kSlot, nullptr);
+  object->SetAlignedPointerInInternalField(CppgcMixin::kEmbedderType, nullptr);
+  EXPECT_EQ(CppgcMixin::Unwrap<DummyCppgcObject>(object), nullptr);
+}
@@ -365,6 +365,41 @@ TEST_F(EnvironmentTest, SetImmediateCleanup) {
   EXPECT_EQ(called_unref, 0);
 }
 
+TEST_F(EnvironmentTest, SnapshotKVStore) {
+  const char* name = "NODE_TEST_SNAPSHOT_KV_STORE";
+  ASSERT_EQ(uv_os_setenv(name, "before"), 0);
+  std::shared_ptr<node::KVStore> store =
+      node::KVStore::CreateSnapshotKVStore();
+  // Changes made behind the store's back are not seen.
+  ASSERT_EQ(uv_os_setenv(name, "after"), 0);
+  EXPECT_EQ(store->Get(name).FromJust(), "before");
+
+  const v8::HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env {handle_scope, argv};
+
+  v8::Local<v8::String> key = node::OneByteString(isolate_, name);
+  v8::Local<v8::String> first = store->Get(isolate_, key).ToLocalChecked();
+  v8::Local<v8::String> second = store->Get(isolate_, key).ToLocalChecked();
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(*v8::String::Utf8Value(isolate_, first), std::string("before"));
+
+  store->Set(isolate_, key, node::OneByteString(isolate_, "set"));
+  v8::Local<v8::String> third = store->Get(isolate_, key).ToLocalChecked();
+  EXPECT_NE(first, third);
+  EXPECT_EQ(*v8::String::Utf8Value(isolate_, third), std::string("set"));
+  char value[16];
+  size_t size = sizeof(value);
+  ASSERT_EQ(uv_os_getenv(name, value, &size), 0);
+  EXPECT_EQ(std::string(value, size), "set");
+
+  store->Delete(isolate_, key);
+  EXPECT_EQ(store->Query(name), -1);
+  EXPECT_TRUE(store->Get(isolate_, key).IsEmpty());
+  size = sizeof(value);
+  EXPECT_EQ(uv_os_getenv(name, value, &size), UV_ENOENT);
+}
+
 static char hello[] = "hello";
 
 TEST_F(EnvironmentTest, BufferWithFreeCallbackIsDetached) {
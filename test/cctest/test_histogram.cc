@@ -0,0 +1,66 @@
+#include "histogram-inl.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::Histogram;
+
+TEST(HistogramTest, Record) {
+  Histogram histogram(Histogram::Options {});
+  EXPECT_TRUE(histogram.Record(10));
+  EXPECT_TRUE(histogram.Record(20));
+  EXPECT_FALSE(histogram.Record(0));
+  EXPECT_EQ(histogram.Count(), 2u);
+  EXPECT_EQ(histogram.Exceeds(), 1u);
+  EXPECT_EQ(histogram.Min(), 10);
+  EXPECT_EQ(histogram.Max(), 20);
+  EXPECT_EQ(histogram.Mean(), 15);
+}
+
+TEST(HistogramTest, ConcurrentRecord) {
+  Histogram::Options options;
+  options.concurrent = true;
+  Histogram histogram(options);
+
+  constexpr int kThreads = 8;
+  constexpr int kValuesPerThread = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&histogram, i]() {
+      for (int j = 1; j <= kValuesPerThread; j++)
+        histogram.Record(j);
+      histogram.Record(0);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  EXPECT_EQ(histogram.Count(),
+            static_cast<size_t>(kThreads * kValuesPerThread));
+  EXPECT_EQ(histogram.Exceeds(), static_cast<size_t>(kThreads));
+  EXPECT_EQ(histogram.Min(), 1);
+  EXPECT_EQ(histogram.Max(), kValuesPerThread);
+
+  histogram.Reset();
+  EXPECT_EQ(histogram.Count(), 0u);
+  EXPECT_EQ(histogram.Exceeds(), 0u);
+}
+
+TEST(HistogramTest, AddConcurrent) {
+  Histogram::Options options;
+  options.concurrent = true;
+  Histogram concurrent(options);
+  Histogram plain(Histogram::Options {});
+  concurrent.Record(5);
+  plain.Record(7);
+  plain.Record(9);
+
+  EXPECT_EQ(concurrent.Add(plain), 0);
+  EXPECT_EQ(concurrent.Count(), 3u);
+  EXPECT_EQ(concurrent.Max(), 9);
+
+  EXPECT_EQ(plain.Add(concurrent), 0);
+  EXPECT_EQ(plain.Count(), 5u);
+  EXPECT_EQ(plain.Min(), 5);
+}
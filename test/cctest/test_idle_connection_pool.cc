@@ -0,0 +1,121 @@
+#include "idle_connection_pool.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::IdleConnectionPool;
+
+namespace {
+
+auto Alive = [](const int&) { return true; };
+
+}  // anonymous namespace
+
+TEST(IdleConnectionPoolTest, LastInFirstOut) {
+  IdleConnectionPool<int> pool(4, 1000);
+  for (int i = 1; i <= 3; i++) EXPECT_TRUE(pool.Release("a", &i, i));
+  int other = 10;
+  EXPECT_TRUE(pool.Release("b", &other, 4));
+  EXPECT_EQ(pool.size(), 4u);
+  EXPECT_EQ(pool.size("a"), 3u);
+
+  std::vector<int> evicted;
+  auto on_evict = [&](int* connection) { evicted.push_back(*connection); };
+  int out = 0;
+  EXPECT_TRUE(pool.Acquire("a", 5, &out, Alive, on_evict));
+  EXPECT_EQ(out, 3);
+  EXPECT_TRUE(pool.Acquire("a", 5, &out, Alive, on_evict));
+  EXPECT_EQ(out, 2);
+  EXPECT_TRUE(pool.Acquire("b", 5, &out, Alive, on_evict));
+  EXPECT_EQ(out, 10);
+  EXPECT_FALSE(pool.Acquire("b", 5, &out, Alive, on_evict));
+  EXPECT_FALSE(pool.Acquire("c", 5, &out, Alive, on_evict));
+  EXPECT_TRUE(evicted.empty());
+  EXPECT_EQ(pool.stats().hits, 3u);
+  EXPECT_EQ(pool.stats().misses, 2u);
+}
+
+TEST(IdleConnectionPoolTest, MaxIdlePerOrigin) {
+  IdleConnectionPool<int> pool(2, 1000);
+  int connection = 1;
+  EXPECT_TRUE(pool.Release("a", &connection, 0));
+  EXPECT_TRUE(pool.Release("a", &connection, 0));
+  EXPECT_FALSE(pool.Release("a", &connection, 0));
+  EXPECT_TRUE(pool.Release("b", &connection, 0));
+  EXPECT_EQ(pool.size(), 3u);
+
+  IdleConnectionPool<int> none(0, 1000);
+  EXPECT_FALSE(none.Release("a", &connection, 0));
+}
+
+TEST(IdleConnectionPoolTest, SkipsClosedAndExpired) {
+  IdleConnectionPool<int> pool(8, 100);
+  for (int i = 1; i <= 4; i++) EXPECT_TRUE(pool.Release("a", &i, i * 10));
+
+  std::vector<int> evicted;
+  auto on_evict = [&](int* connection) { evicted.push_back(*connection); };
+  auto odd_is_alive = [](const int& connection) { return connection % 2; };
+  int out = 0;
+  EXPECT_TRUE(pool.Acquire("a", 50, &out, odd_is_alive, on_evict));
+  EXPECT_EQ(out, 3);
+  EXPECT_EQ(evicted, std::vector<int>({4}));
+
+  // 2 is closed, and 1 is too old at 110.
+  evicted.clear();
+  EXPECT_FALSE(pool.Acquire("a", 110, &out, odd_is_alive, on_evict));
+  EXPECT_EQ(evicted, std::vector<int>({2, 1}));
+  EXPECT_EQ(pool.size(), 0u);
+  EXPECT_EQ(pool.stats().closed, 2u);
+  EXPECT_EQ(pool.stats().expired, 1u);
+}
+
+TEST(IdleConnectionPoolTest, Expire) {
+  IdleConnectionPool<int> pool(8, 100, 10);
+  int connection = 1;
+  EXPECT_TRUE(pool.Release("a", &connection, 0));
+  connection = 2;
+  EXPECT_TRUE(pool.Release("b", &connection, 10));
+  connection = 3;
+  EXPECT_TRUE(pool.Release("a", &connection, 20));
+
+  uint64_t when;
+  EXPECT_TRUE(pool.NextExpiry(&when));
+  EXPECT_EQ(when, 100u);
+
+  std::vector<int> evicted;
+  auto on_evict = [&](int* connection) { evicted.push_back(*connection); };
+  pool.Expire(110, on_evict);
+  EXPECT_EQ(evicted, std::vector<int>({1, 2}));
+  EXPECT_EQ(pool.size("a"), 1u);
+  EXPECT_EQ(pool.size("b"), 0u);
+  EXPECT_TRUE(pool.NextExpiry(&when));
+  EXPECT_EQ(when, 120u);
+  EXPECT_EQ(pool.stats().expired, 2u);
+
+  pool.Expire(120, on_evict);
+  EXPECT_EQ(pool.size(), 0u);
+  EXPECT_FALSE(pool.NextExpiry(&when));
+}
+
+TEST(IdleConnectionPoolTest, EvictIfAndClear) {
+  IdleConnectionPool<int> pool(8, 100);
+  for (int i = 1; i <= 4; i++) EXPECT_TRUE(pool.Release("a", &i, 0));
+
+  std::vector<int> evicted;
+  auto on_evict = [&](int* connection) { evicted.push_back(*connection); };
+  pool.EvictIf([](const int& connection) { return connection == 2; },
+               on_evict);
+  EXPECT_EQ(evicted, std::vector<int>({2}));
+  EXPECT_EQ(pool.stats().closed, 1u);
+
+  int out = 0;
+  EXPECT_TRUE(pool.Acquire("a", 0, &out, Alive, on_evict));
+  EXPECT_EQ(out, 4);
+
+  evicted.clear();
+  pool.Clear(on_evict);
+  EXPECT_EQ(evicted, std::vector<int>({1, 3}));
+  EXPECT_EQ(pool.size(), 0u);
+}
@@ -133,6 +133,10 @@ class TestInspectorDelegate : public InspectorSocket::Delegate {
     socket_->Write(buf, len);
   }
 
+  void Write(std::string data, bool binary) {
+    socket_->Write(std::move(data), binary);
+  }
+
   void ExpectReadError() {
     SPIN_WHILE(frames.empty() || !frames.back().empty());
   }
@@ -409,6 +413,33 @@ TEST_F(InspectorSocketTest, ReadsAndWritesInspectorMessage) {
                          reinterpret_cast<uv_handle_t*>(&client_socket)));
 }
 
+TEST_F(InspectorSocketTest, ReadsAndWritesBinaryMessage) {
+  ASSERT_TRUE(connected);
+  ASSERT_FALSE(delegate->inspector_ready);
+  do_write(const_cast<char*>(HANDSHAKE_REQ), sizeof(HANDSHAKE_REQ) - 1);
+  SPIN_WHILE(!delegate->inspector_ready);
+  expect_handshake();
+
+  // The start of a CBOR envelope.
+  const char MESSAGE[] = {'\xD8', '\x5A'};
+  const char CLIENT_FRAME[] = {'\x82', '\x02', '\xD8', '\x5A'};
+  delegate->Write(std::string(MESSAGE, sizeof(MESSAGE)), true);
+  expect_on_client(CLIENT_FRAME, sizeof(CLIENT_FRAME));
+
+  const char SERVER_FRAME[] = {'\x82', '\x82', '\x7F', '\xC2', '\x66',
+                               '\x31', '\xA7', '\x98'};
+  do_write(SERVER_FRAME, sizeof(SERVER_FRAME));
+  delegate->ExpectData(MESSAGE, sizeof(MESSAGE));
+
+  const char CLIENT_CLOSE_FRAME[] = {'\x88', '\x80', '\x2D',
+                                     '\x0E', '\x1E', '\xFA'};
+  const char SERVER_CLOSE_FRAME[] = {'\x88', '\x00'};
+  do_write(CLIENT_CLOSE_FRAME, sizeof(CLIENT_CLOSE_FRAME));
+  expect_on_client(SERVER_CLOSE_FRAME, sizeof(SERVER_CLOSE_FRAME));
+  GTEST_ASSERT_EQ(0, uv_is_active(
+                         reinterpret_cast<uv_handle_t*>(&client_socket)));
+}
+
 TEST_F(InspectorSocketTest, BufferEdgeCases) {
   do_write(const_cast<char*>(HANDSHAKE_REQ), sizeof(HANDSHAKE_REQ) - 1);
   expect_handshake();
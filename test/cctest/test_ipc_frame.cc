@@ -0,0 +1,67 @@
+#include "ipc_frame.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace ipc_frame = node::ipc_frame;
+using ipc_frame::ParseResult;
+
+namespace {
+
+std::string Frame(const std::string& payload) {
+  std::string frame(ipc_frame::kHeaderSize, '\0');
+  ipc_frame::WriteHeader(&frame[0], static_cast<uint32_t>(payload.size()));
+  return frame + payload;
+}
+
+}  // anonymous namespace
+
+TEST(IPCFrameTest, HeaderRoundTrip) {
+  for (uint32_t length : {0u, 1u, 0x7fu, 0x80u, 0x1234u, 0xfffffffeu}) {
+    char header[ipc_frame::kHeaderSize];
+    ipc_frame::WriteHeader(header, length);
+    EXPECT_EQ(ipc_frame::ReadHeader(header), length);
+  }
+  char header[ipc_frame::kHeaderSize];
+  ipc_frame::WriteHeader(header, 0x04030201);
+  EXPECT_EQ(std::string(header, sizeof(header)), "\x01\x02\x03\x04");
+}
+
+TEST(IPCFrameTest, Parse) {
+  const std::string frame = Frame("hello");
+  size_t payload_length = 0;
+  for (size_t length = 0; length < ipc_frame::kHeaderSize; length++) {
+    EXPECT_EQ(ipc_frame::Parse(frame.data(), length, 100, &payload_length),
+              ParseResult::kIncomplete);
+  }
+  EXPECT_EQ(ipc_frame::Parse(frame.data(), frame.size() - 1, 100,
+                             &payload_length),
+            ParseResult::kIncomplete);
+  // The length is known as soon as the header is there.
+  EXPECT_EQ(payload_length, 5u);
+  EXPECT_EQ(ipc_frame::Parse(frame.data(), frame.size(), 100,
+                             &payload_length),
+            ParseResult::kComplete);
+
+  const std::string two = frame + Frame("");
+  EXPECT_EQ(ipc_frame::Parse(two.data(), two.size(), 100, &payload_length),
+            ParseResult::kComplete);
+  EXPECT_EQ(payload_length, 5u);
+  const size_t next = ipc_frame::kHeaderSize + payload_length;
+  EXPECT_EQ(ipc_frame::Parse(two.data() + next, two.size() - next, 100,
+                             &payload_length),
+            ParseResult::kComplete);
+  EXPECT_EQ(payload_length, 0u);
+}
+
+TEST(IPCFrameTest, TooLong) {
+  const std::string frame = Frame("hello");
+  size_t payload_length = 0;
+  EXPECT_EQ(ipc_frame::Parse(frame.data(), frame.size(), 5, &payload_length),
+            ParseResult::kComplete);
+  // Known from the header alone.
+  EXPECT_EQ(ipc_frame::Parse(frame.data(), ipc_frame::kHeaderSize, 4,
+                             &payload_length),
+            ParseResult::kTooLong);
+}
@@ -99,4 +99,65 @@ TEST_F(JsNativeApiV8Test, Reference) {
   // After Environment Teardown
   EXPECT_EQ(finalizer_call_count, uint32_t(1));
 }
+
+TEST_F(JsNativeApiV8Test, FinalizersAreBatched) {
+  const v8::HandleScope handle_scope(isolate_);
+  Argv argv;
+
+  constexpr size_t kCount = 100;
+  void* embedder_fields[v8::kEmbedderFieldsInWeakCallback] = {nullptr, nullptr};
+  v8::WeakCallbackInfo<Reference::SecondPassCallParameterRef>::Callback
+      callback;
+
+  {
+    Env test_env{handle_scope, argv};
+
+    node::Environment* env = *test_env;
+    node::LoadEnvironment(env, "");
+
+    napi_addon_register_func init = [](napi_env env, napi_value exports) {
+      addon_env = env;
+      return exports;
+    };
+    Local<Object> module_obj = Object::New(isolate_);
+    Local<Object> exports_obj = Object::New(isolate_);
+    napi_module_register_by_symbol(
+        exports_obj, module_obj, env->context(), init);
+    ASSERT_NE(addon_env, nullptr);
+
+    Reference::SecondPassCallParameterRef* parameters[kCount];
+    for (size_t i = 0; i < kCount; i++) {
+      const v8::HandleScope handle_scope(isolate_);
+      napi_value value;
+      napi_ref ref;
+      napi_create_object(addon_env, &value);
+      napi_add_finalizer(
+          addon_env,
+          value,
+          nullptr,
+          [](napi_env env, void* finalize_data, void* finalize_hint) {
+            finalizer_call_count++;
+          },
+          nullptr,
+          &ref);
+      parameters[i] = reinterpret_cast<Reference*>(ref)->_secondPassParameter;
+    }
+
+    // As if GC collected all of the objects at once.
+    for (Reference::SecondPassCallParameterRef* parameter : parameters) {
+      v8::WeakCallbackInfo<Reference::SecondPassCallParameterRef> data(
+          reinterpret_cast<v8::Isolate*>(isolate_),
+          parameter,
+          embedder_fields,
+          &callback);
+      Reference::FinalizeCallback(data);
+      Reference::SecondPassCallback(data);
+    }
+
+    // The finalizers wait for the loop, and then all of them run.
+    EXPECT_EQ(finalizer_call_count, uint32_t(0));
+    uv_run(&current_loop, UV_RUN_DEFAULT);
+    EXPECT_EQ(finalizer_call_count, uint32_t(kCount));
+  }
+}
 }  // namespace v8impl
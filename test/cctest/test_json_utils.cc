@@ -1,5 +1,7 @@
 #include "json_utils.h"
 
+#include <sstream>
+
 #include "gtest/gtest.h"
 
 TEST(JSONUtilsTest, EscapeJsonChars) {
@@ -24,3 +26,71 @@ TEST(JSONUtilsTest, EscapeJsonChars) {
     EXPECT_EQ("a" + expected[i], EscapeJsonChars("a" + input));
   }
 }
+
+TEST(JSONUtilsTest, EscapeJsonCharsLong) {
+  using node::EscapeJsonChars;
+  // Escapes on either side of the 16-byte blocks, and bytes of 0x80 and
+  // above, which are left alone.
+  std::string input(64, 'x');
+  std::string expected = input;
+  for (size_t pos : {0, 15, 16, 31, 63}) {
+    input[pos] = '"';
+    std::string escaped = EscapeJsonChars(input);
+    EXPECT_EQ(escaped.size(), input.size() + 1);
+    EXPECT_EQ(escaped.substr(pos, 2), "\\\"");
+    input[pos] = 'x';
+  }
+  input.replace(20, 4, "\xc3\xa9\x7f\xff");
+  expected.replace(20, 4, "\xc3\xa9\x7f\xff");
+  EXPECT_EQ(expected, EscapeJsonChars(input));
+  input[40] = '\x1f';
+  expected.replace(40, 1, "\\u001f");
+  EXPECT_EQ(expected, EscapeJsonChars(input));
+}
+
+TEST(JSONUtilsTest, FdOutputStream) {
+  char tmpdir[1024];
+  size_t tmpdir_size = sizeof(tmpdir);
+  ASSERT_EQ(uv_os_tmpdir(tmpdir, &tmpdir_size), 0);
+  std::string path_template = std::string(tmpdir) + "/json-utils-XXXXXX";
+  uv_fs_t req;
+  const int fd =
+      uv_fs_mkstemp(nullptr, &req, path_template.c_str(), nullptr);
+  ASSERT_GE(fd, 0);
+  const std::string path = req.path;
+  uv_fs_req_cleanup(&req);
+
+  // More than the size of the buffer, written in pieces of all sizes.
+  auto write = [](std::ostream& out) {
+    node::JSONWriter writer(out, true);
+    writer.json_start();
+    writer.json_arraystart("values");
+    for (int i = 0; i < 20000; i++) {
+      writer.json_element(std::string(i % 7, 'a') + "\n");
+      writer.json_element(i);
+    }
+    writer.json_arrayend();
+    writer.json_end();
+  };
+  std::ostringstream expected;
+  write(expected);
+  {
+    node::FdOutputStream out(fd);
+    write(out);
+    out.flush();
+    EXPECT_EQ(out.error(), 0);
+  }
+
+  std::string contents(expected.str().size() + 1, '\0');
+  uv_buf_t buf = uv_buf_init(&contents[0], contents.size());
+  const int read = uv_fs_read(nullptr, &req, fd, &buf, 1, 0, nullptr);
+  uv_fs_req_cleanup(&req);
+  ASSERT_GE(read, 0);
+  contents.resize(read);
+  EXPECT_EQ(contents, expected.str());
+
+  uv_fs_close(nullptr, &req, fd, nullptr);
+  uv_fs_req_cleanup(&req);
+  uv_fs_unlink(nullptr, &req, path.c_str(), nullptr);
+  uv_fs_req_cleanup(&req);
+}
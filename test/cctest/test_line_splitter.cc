@@ -0,0 +1,85 @@
+#include "line_splitter.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::LineSplitter;
+
+namespace {
+
+// Feeds `chunks` to `splitter` the way a stream listener does, carrying
+// the unterminated rest over, and returns the lines.
+std::vector<std::string> Split(LineSplitter* splitter,
+                               const std::vector<std::string>& chunks,
+                               std::string* rest) {
+  std::vector<std::string> result;
+  std::string data;
+  for (const std::string& chunk : chunks) {
+    const size_t carried = data.size();
+    data += chunk;
+    std::vector<uint32_t> lines;
+    const size_t end =
+        splitter->Split(data.data(), data.size(), carried, &lines);
+    EXPECT_EQ(lines.size() % 2, 0u);
+    for (size_t i = 0; i < lines.size(); i += 2)
+      result.emplace_back(data, lines[i], lines[i + 1] - lines[i]);
+    data.erase(0, end);
+  }
+  *rest = data;
+  return result;
+}
+
+}  // anonymous namespace
+
+TEST(LineSplitterTest, Lines) {
+  LineSplitter splitter('\n', 1024);
+  std::string rest;
+  const std::vector<std::string> lines = Split(
+      &splitter,
+      {"{\"a\":1}\n{\"b\"", ":2}\n\n", "{\"c\":3}"},
+      &rest);
+  ASSERT_EQ(lines.size(), 3u);
+  EXPECT_EQ(lines[0], "{\"a\":1}");
+  EXPECT_EQ(lines[1], "{\"b\":2}");
+  EXPECT_EQ(lines[2], "");
+  EXPECT_EQ(rest, "{\"c\":3}");
+  EXPECT_EQ(splitter.TakeDropped(), 0u);
+}
+
+TEST(LineSplitterTest, Blocks) {
+  // Delimiters at every position of a 16-byte block, and in the tail.
+  for (size_t length = 1; length < 40; length++) {
+    std::string data;
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 5; i++) {
+      expected.emplace_back(length, static_cast<char>('a' + i));
+      data += expected.back() + ";";
+    }
+    LineSplitter splitter(';', 1024);
+    std::string rest;
+    EXPECT_EQ(Split(&splitter, {data}, &rest), expected);
+    EXPECT_EQ(rest, "");
+  }
+}
+
+TEST(LineSplitterTest, MaxLineLength) {
+  LineSplitter splitter('\n', 4);
+  std::string rest;
+  const std::vector<std::string> lines = Split(
+      &splitter,
+      {"abcd\nabcde\nab", "cdefgh", "ij\nxy\n", "12345"},
+      &rest);
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0], "abcd");
+  EXPECT_EQ(lines[1], "xy");
+  EXPECT_EQ(rest, "");
+  EXPECT_EQ(splitter.TakeDropped(), 3u);
+  EXPECT_EQ(splitter.TakeDropped(), 0u);
+  EXPECT_TRUE(splitter.dropping());
+
+  EXPECT_EQ(Split(&splitter, {"678\nok\n"}, &rest),
+            std::vector<std::string>{"ok"});
+  EXPECT_FALSE(splitter.dropping());
+}
@@ -0,0 +1,105 @@
+#include "node_log_sink.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+
+using node::log_sink::LogWriter;
+
+namespace {
+
+class LogWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    file_ = tmpfile();
+    ASSERT_NE(file_, nullptr);
+  }
+
+  void TearDown() override {
+    fclose(file_);
+  }
+
+  std::string Contents() {
+    std::string contents;
+    char buffer[4096];
+    rewind(file_);
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file_)) > 0)
+      contents.append(buffer, n);
+    return contents;
+  }
+
+  int fd() { return fileno(file_); }
+
+  FILE* file_ = nullptr;
+};
+
+}  // anonymous namespace
+
+TEST_F(LogWriterTest, WritesRecordsInOrder) {
+  std::unique_ptr<LogWriter> writer =
+      LogWriter::Create(fd(), 4096, LogWriter::Policy::kReject);
+  ASSERT_TRUE(writer);
+
+  std::string expected;
+  for (int i = 0; i < 1000; i++) {
+    std::string line = "{\"msg\":" + std::to_string(i) + "}\n";
+    while (!writer->Write(line.data(), line.size())) {}
+    expected += line;
+  }
+  EXPECT_TRUE(writer->Flush());
+  EXPECT_EQ(writer->written(), 1000u);
+  EXPECT_EQ(writer->bytes(), expected.size());
+  EXPECT_EQ(writer->error(), 0);
+  writer->Stop();
+  EXPECT_EQ(Contents(), expected);
+}
+
+TEST_F(LogWriterTest, Position) {
+  std::unique_ptr<LogWriter> writer =
+      LogWriter::Create(fd(), 4096, LogWriter::Policy::kReject, 4);
+  ASSERT_TRUE(writer);
+  EXPECT_TRUE(writer->Write("abc", 3));
+  EXPECT_TRUE(writer->Write("def", 3));
+  writer.reset();
+  EXPECT_EQ(Contents(), std::string("\0\0\0\0abcdef", 10));
+}
+
+TEST_F(LogWriterTest, DropAndDrain) {
+  static std::atomic<int> drains{0};
+  std::unique_ptr<LogWriter> writer =
+      LogWriter::Create(fd(), 4096, LogWriter::Policy::kReject);
+  ASSERT_TRUE(writer);
+  writer->SetDrainCallback([](void*) { drains++; }, nullptr);
+
+  std::string record(writer->max_record_size(), 'x');
+  // Sooner or later, the writer thread falls behind.
+  while (writer->Write(record.data(), record.size())) {}
+  EXPECT_TRUE(writer->Flush());
+  writer->Stop();
+  EXPECT_GE(drains.load(), 1);
+  EXPECT_EQ(writer->dropped(), 0u);
+
+  writer = LogWriter::Create(fd(), 4096, LogWriter::Policy::kDrop);
+  ASSERT_TRUE(writer);
+  while (writer->Write(record.data(), record.size())) {}
+  writer->Stop();
+  EXPECT_EQ(writer->dropped(), 1u);
+}
+
+TEST_F(LogWriterTest, WriteError) {
+  // Writing to a read-only descriptor fails.
+  FILE* readonly = fopen("/dev/null", "r");
+  ASSERT_NE(readonly, nullptr);
+  std::unique_ptr<LogWriter> writer =
+      LogWriter::Create(fileno(readonly), 4096, LogWriter::Policy::kReject);
+  ASSERT_TRUE(writer);
+  EXPECT_TRUE(writer->Write("abc\n", 4));
+  EXPECT_TRUE(writer->Flush());
+  EXPECT_EQ(writer->failed(), 1u);
+  EXPECT_NE(writer->error(), 0);
+  writer.reset();
+  fclose(readonly);
+}
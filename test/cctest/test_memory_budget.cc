@@ -0,0 +1,79 @@
+#include "memory_budget.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::MemoryBudget;
+
+TEST(MemoryBudgetTest, Watermarks) {
+  std::vector<bool> changes;
+  MemoryBudget budget(100, 50, nullptr, [&](bool exceeded) {
+    changes.push_back(exceeded);
+  });
+  budget.Charge(100);
+  EXPECT_FALSE(budget.exceeded());
+  budget.Charge(1);
+  EXPECT_TRUE(budget.exceeded());
+  budget.Charge(1000);
+  budget.Release(1000);
+  // Still above the low watermark.
+  budget.Release(50);
+  EXPECT_TRUE(budget.exceeded());
+  budget.Release(1);
+  EXPECT_FALSE(budget.exceeded());
+  EXPECT_EQ(budget.used(), 50u);
+  EXPECT_EQ(changes, (std::vector<bool> { true, false }));
+}
+
+TEST(MemoryBudgetTest, Parent) {
+  auto server = std::make_shared<MemoryBudget>(100, 50);
+  std::vector<bool> a_changes, b_changes;
+  auto a = std::make_unique<MemoryBudget>(80, 40, server, [&](bool exceeded) {
+    a_changes.push_back(exceeded);
+  });
+  MemoryBudget b(80, 40, server, [&](bool exceeded) {
+    b_changes.push_back(exceeded);
+  });
+
+  a->Charge(60);
+  b.Charge(30);
+  EXPECT_EQ(server->used(), 90u);
+  EXPECT_FALSE(a->exceeded());
+  // Puts the server over its budget, which stops both connections.
+  b.Charge(20);
+  EXPECT_TRUE(server->exceeded());
+  EXPECT_TRUE(a->exceeded());
+  EXPECT_TRUE(b.exceeded());
+  EXPECT_EQ(a_changes, (std::vector<bool> { true }));
+  EXPECT_EQ(b_changes, (std::vector<bool> { true }));
+
+  // Going away releases what the connection held.
+  a.reset();
+  EXPECT_EQ(server->used(), 50u);
+  EXPECT_FALSE(b.exceeded());
+  EXPECT_EQ(b_changes, (std::vector<bool> { true, false }));
+
+  // Over its own budget, while the server is not.
+  b.Charge(40);
+  EXPECT_TRUE(b.exceeded());
+  EXPECT_FALSE(server->exceeded());
+  b.Release(90);
+  EXPECT_EQ(server->used(), 0u);
+  EXPECT_EQ(b_changes, (std::vector<bool> { true, false, true, false }));
+}
+
+TEST(MemoryBudgetTest, SetWatermarks) {
+  std::vector<bool> changes;
+  MemoryBudget budget(100, 50, nullptr, [&](bool exceeded) {
+    changes.push_back(exceeded);
+  });
+  budget.Charge(80);
+  budget.SetWatermarks(60, 30);
+  EXPECT_TRUE(budget.exceeded());
+  budget.SetWatermarks(1000, 500);
+  EXPECT_FALSE(budget.exceeded());
+  EXPECT_EQ(budget.used(), 80u);
+  EXPECT_EQ(changes, (std::vector<bool> { true, false }));
+}
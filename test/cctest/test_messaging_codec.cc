@@ -0,0 +1,71 @@
+#include "node_messaging_codec.h"
+#include "node_test_fixture.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#include <string>
+
+namespace codec = node::worker::codec;
+using node::MallocedBuffer;
+using v8::Context;
+using v8::HandleScope;
+using v8::Local;
+using v8::Script;
+using v8::String;
+using v8::Value;
+
+class MessagingCodecTest : public NodeTestFixture {};
+
+TEST_F(MessagingCodecTest, RoundTrip) {
+  HandleScope handle_scope(isolate_);
+  Local<Context> context = Context::New(isolate_);
+  Context::Scope context_scope(context);
+
+  auto run = [&](const char* source) {
+    return Script::Compile(context,
+                           String::NewFromUtf8(isolate_, source)
+                               .ToLocalChecked())
+        .ToLocalChecked()
+        ->Run(context)
+        .ToLocalChecked();
+  };
+  auto round_trip = [&](Local<Value> value) {
+    MallocedBuffer<char> data;
+    if (!codec::Serialize(context, value, &data).FromJust())
+      return Local<Value>();
+    EXPECT_TRUE(codec::IsEncoded(data.data, data.size));
+    return codec::Deserialize(context, data.data, data.size)
+        .ToLocalChecked();
+  };
+  auto to_json = [&](Local<Value> value) {
+    return std::string(*String::Utf8Value(
+        isolate_, v8::JSON::Stringify(context, value).ToLocalChecked()));
+  };
+
+  const char* source =
+      "({ a: 1, b: -2.5, c: 'x', d: '\\u20ac', e: [true, null, -0],"
+      "   f: { 1: 'one', g: [] } })";
+  Local<Value> copy = round_trip(run(source));
+  ASSERT_FALSE(copy.IsEmpty());
+  EXPECT_EQ(to_json(copy), to_json(run(source)));
+
+  // The layout is only written once, and then shared.
+  for (int i = 0; i < 2; i++) {
+    copy = round_trip(run("({ x: 1, y: 'y' })"));
+    ASSERT_FALSE(copy.IsEmpty());
+    EXPECT_EQ(to_json(copy), "{\"x\":1,\"y\":\"y\"}");
+  }
+
+  copy = round_trip(run("new Uint16Array([1, 2, 3, 4]).subarray(1, 3)"));
+  ASSERT_TRUE(copy->IsUint16Array());
+  EXPECT_EQ(copy.As<v8::Uint16Array>()->ByteOffset(), 2u);
+  EXPECT_EQ(copy.As<v8::Uint16Array>()->Length(), 2u);
+  EXPECT_EQ(to_json(copy), "{\"0\":2,\"1\":3}");
+
+  // Everything else is left to ValueSerializer.
+  EXPECT_TRUE(round_trip(run("new Map()")).IsEmpty());
+  EXPECT_TRUE(round_trip(run("[1, , 3]")).IsEmpty());
+  EXPECT_TRUE(round_trip(run("({ get a() { return 1; } })")).IsEmpty());
+  EXPECT_TRUE(round_trip(run("const o = {}; [o, o]")).IsEmpty());
+  EXPECT_TRUE(round_trip(run("Object.create({})")).IsEmpty());
+}
@@ -0,0 +1,87 @@
+#include "multi_string_search.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::stringsearch::MultiStringSearch;
+
+namespace {
+
+using Matches = std::vector<std::pair<size_t, uint32_t>>;
+
+Matches FindAll(const std::vector<std::string>& patterns,
+                const std::string& subject,
+                bool prefilter,
+                size_t limit = 0) {
+  MultiStringSearch search(patterns, prefilter);
+  Matches matches;
+  search.Search(reinterpret_cast<const uint8_t*>(subject.data()),
+                subject.size(),
+                [&](size_t offset, uint32_t pattern) {
+                  matches.emplace_back(offset, pattern);
+                  return limit == 0 || matches.size() < limit;
+                });
+  return matches;
+}
+
+}  // anonymous namespace
+
+TEST(MultiStringSearchTest, FindsOverlappingMatches) {
+  const std::vector<std::string> patterns = {"he", "she", "his", "hers"};
+  const Matches expected = {{1, 1}, {2, 0}, {2, 3}};
+  for (bool prefilter : {false, true}) {
+    EXPECT_EQ(expected, FindAll(patterns, "ushers", prefilter));
+    EXPECT_EQ(Matches({{0, 2}}), FindAll(patterns, "his", prefilter));
+    EXPECT_EQ(Matches(), FindAll(patterns, "hhhh", prefilter));
+  }
+}
+
+TEST(MultiStringSearchTest, NestedAndDuplicatePatterns) {
+  const std::vector<std::string> patterns = {"a", "aa", "aaa", "aa"};
+  const Matches expected = {
+    {0, 0}, {0, 1}, {0, 3}, {1, 0}, {0, 2}, {1, 1}, {1, 3}, {2, 0}
+  };
+  for (bool prefilter : {false, true})
+    EXPECT_EQ(expected, FindAll(patterns, "aaa", prefilter));
+}
+
+TEST(MultiStringSearchTest, Limit) {
+  const std::vector<std::string> patterns = {"ab", "b"};
+  EXPECT_EQ(Matches({{0, 0}, {1, 1}}), FindAll(patterns, "abab", false, 2));
+  EXPECT_EQ(Matches({{0, 0}}), FindAll(patterns, "abab", true, 1));
+}
+
+TEST(MultiStringSearchTest, Prefilter) {
+  std::string subject(1000, 'x');
+  subject.replace(17, 5, "GET /");
+  subject.replace(900, 8, "HTTP/1.1");
+  subject += "GE";
+
+  const std::vector<std::string> few = {"GET /", "HTTP/1.1", "Host:"};
+  EXPECT_TRUE(MultiStringSearch(few, true).prefiltered());
+  EXPECT_FALSE(MultiStringSearch(few, false).prefiltered());
+  for (bool prefilter : {false, true})
+    EXPECT_EQ(Matches({{17, 0}, {900, 1}}), FindAll(few, subject, prefilter));
+
+  std::vector<std::string> many;
+  for (char c = 'a'; c < 'a' + MultiStringSearch::kMaxPrefilterBytes + 1; c++)
+    many.emplace_back(1, c);
+  EXPECT_FALSE(MultiStringSearch(many, true).prefiltered());
+}
+
+TEST(MultiStringSearchTest, AllBytes) {
+  std::vector<std::string> patterns;
+  std::string subject;
+  for (int c = 0; c < 256; c++) {
+    patterns.emplace_back(2, static_cast<char>(c));
+    subject += static_cast<char>(c);
+    subject += static_cast<char>(c);
+  }
+  const Matches matches = FindAll(patterns, subject, false);
+  ASSERT_EQ(256u, matches.size());
+  for (uint32_t c = 0; c < 256; c++)
+    EXPECT_EQ(std::make_pair(size_t{2} * c, c), matches[c]);
+}
@@ -2,11 +2,19 @@
 // and setting it to a file that does not exist.
 #define NODE_OPENSSL_SYSTEM_CERT_PATH "/missing/ca.pem"
 
+#include "crypto/crypto_clienthello-inl.h"
 #include "crypto/crypto_context.h"
+#include "crypto/crypto_pem_cache.h"
+#include "crypto/crypto_session_cache.h"
+#include "crypto/crypto_tls.h"
 #include "node_options.h"
 #include "openssl/err.h"
+#include "openssl/pem.h"
 #include "gtest/gtest.h"
 
+#include <string>
+#include <vector>
+
 /*
  * This test verifies that a call to NewRootCertDir with the build time
  * configuration option --openssl-system-ca-path set to an missing file, will
@@ -21,3 +29,231 @@ TEST(NodeCrypto, NewRootCertStore) {
                                       "any errors on the OpenSSL error stack\n";
   X509_STORE_free(store);
 }
+
+// Built-in root certificates are only parsed once they are looked up.
+TEST(NodeCrypto, NewRootCertStoreIsLazy) {
+  node::per_process::cli_options->ssl_openssl_cert_store = false;
+  X509_STORE* store = node::crypto::NewRootCertStore();
+  ASSERT_TRUE(store);
+  EXPECT_EQ(sk_X509_OBJECT_num(X509_STORE_get0_objects(store)), 0);
+
+  node::crypto::X509NamePointer name(X509_NAME_new());
+  X509_NAME_add_entry_by_txt(name.get(), "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("none"),
+                             -1, -1, 0);
+  X509_STORE_CTX* ctx = X509_STORE_CTX_new();
+  ASSERT_TRUE(X509_STORE_CTX_init(ctx, store, nullptr, nullptr));
+  X509_OBJECT* obj = X509_OBJECT_new();
+  EXPECT_EQ(X509_STORE_CTX_get_by_subject(ctx, X509_LU_X509,
+                                          name.get(), obj), 0);
+  X509_OBJECT_free(obj);
+  X509_STORE_CTX_free(ctx);
+  X509_STORE_free(store);
+  EXPECT_EQ(ERR_peek_error(), 0UL);
+}
+
+static node::crypto::SSLSessionPointer NewTestSession(unsigned int n) {
+  node::crypto::SSLSessionPointer session(SSL_SESSION_new());
+  unsigned char id[32] = {};
+  memcpy(id, &n, sizeof(n));
+  SSL_SESSION_set1_id(session.get(), id, sizeof(id));
+  SSL_SESSION_set_protocol_version(session.get(), TLS1_2_VERSION);
+  return session;
+}
+
+TEST(NodeCrypto, SharedSessionCacheEvictsLeastRecentlyUsed) {
+  constexpr size_t kMaxBytes = 64 * 1024;
+  node::crypto::SharedSessionCache cache(kMaxBytes);
+
+  constexpr unsigned int kSessions = 2000;
+  for (unsigned int i = 0; i < kSessions; i++)
+    ASSERT_TRUE(cache.Put(NewTestSession(i).get()));
+
+  node::crypto::SharedSessionCache::Stats stats = cache.GetStats();
+  EXPECT_LE(stats.bytes, kMaxBytes);
+  EXPECT_GT(stats.evictions, 0u);
+  EXPECT_EQ(stats.entries + stats.evictions, kSessions);
+
+  unsigned int id_length;
+  node::crypto::SSLSessionPointer first = NewTestSession(0);
+  const unsigned char* id = SSL_SESSION_get_id(first.get(), &id_length);
+  EXPECT_EQ(cache.Get(id, id_length), nullptr);
+
+  node::crypto::SSLSessionPointer last = NewTestSession(kSessions - 1);
+  id = SSL_SESSION_get_id(last.get(), &id_length);
+  node::crypto::SSLSessionPointer found = cache.Get(id, id_length);
+  ASSERT_NE(found, nullptr);
+  unsigned int found_length;
+  const unsigned char* found_id = SSL_SESSION_get_id(found.get(),
+                                                     &found_length);
+  ASSERT_EQ(found_length, id_length);
+  EXPECT_EQ(memcmp(found_id, id, id_length), 0);
+
+  cache.Remove(id, id_length);
+  EXPECT_EQ(cache.Get(id, id_length), nullptr);
+  stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+}
+
+TEST(NodeCrypto, SharedSessionCacheRotatesTicketKeys) {
+  using TicketKeys = node::crypto::SharedSessionCache::TicketKeys;
+  node::crypto::SharedSessionCache cache;
+  TicketKeys initial = cache.GetTicketKeys();
+
+  TicketKeys next;
+  memset(&next, 0x42, sizeof(next));
+  cache.RotateTicketKeys(next);
+  EXPECT_EQ(memcmp(cache.GetTicketKeys().name, next.name, 16), 0);
+
+  TicketKeys found;
+  bool current;
+  ASSERT_TRUE(cache.FindTicketKeys(next.name, &found, &current));
+  EXPECT_TRUE(current);
+  ASSERT_TRUE(cache.FindTicketKeys(initial.name, &found, &current));
+  EXPECT_FALSE(current);
+  EXPECT_EQ(memcmp(found.aes, initial.aes, 16), 0);
+
+  // Only one generation of old keys is kept.
+  TicketKeys last;
+  memset(&last, 0x43, sizeof(last));
+  cache.RotateTicketKeys(last);
+  EXPECT_FALSE(cache.FindTicketKeys(initial.name, &found, &current));
+  ASSERT_TRUE(cache.FindTicketKeys(next.name, &found, &current));
+  EXPECT_FALSE(current);
+}
+
+static bool SignsLike(EVP_PKEY* key, EVP_PKEY* verify_key) {
+  static const unsigned char data[] = "async private key";
+  unsigned char sig[512];
+  size_t sig_len = sizeof(sig);
+  node::crypto::EVPMDPointer sign_ctx(EVP_MD_CTX_new());
+  node::crypto::EVPMDPointer verify_ctx(EVP_MD_CTX_new());
+  return EVP_DigestSignInit(sign_ctx.get(), nullptr, EVP_sha256(),
+                            nullptr, key) == 1 &&
+         EVP_DigestSign(sign_ctx.get(), sig, &sig_len,
+                        data, sizeof(data)) == 1 &&
+         EVP_DigestVerifyInit(verify_ctx.get(), nullptr, EVP_sha256(),
+                              nullptr, verify_key) == 1 &&
+         EVP_DigestVerify(verify_ctx.get(), sig, sig_len,
+                          data, sizeof(data)) == 1;
+}
+
+// Outside of a TLSWrap the wrapped keys sign inline, with the same key.
+TEST(NodeCrypto, AsyncPrivateKeySignsInline) {
+  node::crypto::EVPKeyPointer rsa(EVP_RSA_gen(2048));
+  node::crypto::EVPKeyPointer ec(EVP_EC_gen("P-256"));
+  node::crypto::EVPKeyPointer ed(
+      EVP_PKEY_Q_keygen(nullptr, nullptr, "ED25519"));
+  ASSERT_TRUE(rsa && ec && ed);
+
+  node::crypto::EVPKeyPointer async_rsa =
+      node::crypto::TLSWrap::NewAsyncPrivateKey(rsa.get());
+  ASSERT_TRUE(async_rsa);
+  EXPECT_TRUE(SignsLike(async_rsa.get(), rsa.get()));
+
+  node::crypto::EVPKeyPointer async_ec =
+      node::crypto::TLSWrap::NewAsyncPrivateKey(ec.get());
+  ASSERT_TRUE(async_ec);
+  EXPECT_TRUE(SignsLike(async_ec.get(), ec.get()));
+
+  EXPECT_FALSE(node::crypto::TLSWrap::NewAsyncPrivateKey(ed.get()));
+  EXPECT_EQ(ERR_peek_error(), 0UL);
+}
+
+static std::string NewTestCertificatePEM(EVP_PKEY* pkey) {
+  node::crypto::X509Pointer x509(X509_new());
+  X509_set_version(x509.get(), 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(x509.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(x509.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(x509.get()), 3600);
+  X509_set_pubkey(x509.get(), pkey);
+  X509_sign(x509.get(), pkey, EVP_sha256());
+  node::crypto::BIOPointer bio(BIO_new(BIO_s_mem()));
+  PEM_write_bio_X509(bio.get(), x509.get());
+  char* data;
+  long size = BIO_get_mem_data(bio.get(), &data);  // NOLINT(runtime/int)
+  return std::string(data, size);
+}
+
+TEST(NodeCrypto, PEMCacheSharesParsedCertificates) {
+  node::crypto::PEMCache* cache = node::crypto::PEMCache::GetInstance();
+  node::crypto::EVPKeyPointer pkey(EVP_EC_gen("P-256"));
+  ASSERT_TRUE(pkey);
+  const std::string pem = NewTestCertificatePEM(pkey.get());
+  const std::string bundle = pem + pem;
+
+  auto chain = cache->GetCertChain(pem.data(), pem.size());
+  ASSERT_TRUE(chain);
+  EXPECT_EQ(sk_X509_num(chain->extra_certs.get()), 0);
+  EXPECT_EQ(cache->GetCertChain(pem.data(), pem.size()), chain);
+
+  auto list = cache->GetCertList(bundle.data(), bundle.size());
+  ASSERT_TRUE(list);
+  EXPECT_EQ(list->certs.size(), 2u);
+  EXPECT_EQ(cache->GetCertList(bundle.data(), bundle.size()), list);
+  EXPECT_NE(cache->GetCertList(pem.data(), pem.size()), list);
+
+  const char garbage[] = "not a certificate";
+  EXPECT_FALSE(cache->GetCertChain(garbage, sizeof(garbage)));
+  ERR_clear_error();
+
+  int builds = 0;
+  auto build = [&]() {
+    builds++;
+    return node::crypto::X509StorePointer(X509_STORE_new());
+  };
+  node::crypto::PEMCache::Key key =
+      node::crypto::PEMCache::NextCertStoreKey("", *list);
+  auto store = cache->GetCertStore(key, build);
+  ASSERT_TRUE(store);
+  EXPECT_EQ(cache->GetCertStore(key, build), store);
+  EXPECT_EQ(builds, 1);
+  EXPECT_NE(node::crypto::PEMCache::NextCertStoreKey("root", *list), key);
+}
+
+TEST(NodeCrypto, ClientHelloServernameAndALPN) {
+  const uint8_t sni[] = { 0x00, 0x00, 0x00, 0x10, 0x00, 0x0e, 0x00, 0x00,
+                          0x0b, 'e', 'x', 'a', 'm', 'p', 'l', 'e', '.',
+                          'c', 'o', 'm' };
+  const uint8_t alpn[] = { 0x00, 0x10, 0x00, 0x0e, 0x00, 0x0c, 0x02, 'h',
+                           '2', 0x08, 'h', 't', 't', 'p', '/', '1', '.',
+                           '1' };
+  std::vector<uint8_t> body = { 0x03, 0x03 };
+  body.resize(body.size() + 32);  // Random.
+  body.insert(body.end(), { 0x00, 0x00, 0x02, 0x13, 0x01, 0x01, 0x00,
+                            0x00, sizeof(sni) + sizeof(alpn) });
+  body.insert(body.end(), sni, sni + sizeof(sni));
+  body.insert(body.end(), alpn, alpn + sizeof(alpn));
+  std::vector<uint8_t> record = {
+    22, 0x03, 0x01, 0x00, static_cast<uint8_t>(body.size() + 4),
+    1, 0x00, 0x00, static_cast<uint8_t>(body.size())
+  };
+  record.insert(record.end(), body.begin(), body.end());
+
+  struct Result {
+    std::string servername;
+    std::string alpn;
+    bool ended = false;
+  } result;
+  node::crypto::ClientHelloParser parser;
+  parser.Start(
+      [](void* arg, const node::crypto::ClientHelloParser::ClientHello& h) {
+        Result* result = static_cast<Result*>(arg);
+        result->servername.assign(
+            reinterpret_cast<const char*>(h.servername()), h.servername_size());
+        result->alpn.assign(
+            reinterpret_cast<const char*>(h.alpn()), h.alpn_size());
+      },
+      [](void* arg) { static_cast<Result*>(arg)->ended = true; },
+      &result);
+
+  // Nothing happens until the whole record is there.
+  parser.Parse(record.data(), record.size() - 1);
+  EXPECT_FALSE(parser.IsPaused());
+  parser.Parse(record.data(), record.size());
+  EXPECT_TRUE(parser.IsPaused());
+  EXPECT_FALSE(result.ended);
+  EXPECT_EQ(result.servername, "example.com");
+  EXPECT_EQ(result.alpn, std::string("\x02h2\x08http/1.1"));
+}
@@ -1,7 +1,9 @@
 #include "node_internals.h"
 #include "libplatform/libplatform.h"
 
+#include <atomic>
 #include <string>
+#include <vector>
 #include "gtest/gtest.h"
 #include "node_test_fixture.h"
 
@@ -123,3 +125,121 @@ TEST_F(PlatformTest, TracingControllerNullptr) {
   node::SetTracingController(orig_controller);
   EXPECT_EQ(node::GetTracingController(), orig_controller);
 }
+
+// This task increments the given counter and, while the spawn count allows,
+// posts more tasks of its own from the worker thread it runs on.
+class SpawningWorkerTask : public v8::Task {
+ public:
+  SpawningWorkerTask(int spawn_count,
+                     std::atomic<int>* run_count,
+                     node::NodePlatform* platform)
+      : spawn_count_(spawn_count),
+        run_count_(run_count),
+        platform_(platform) {}
+
+  // v8::Task implementation
+  void Run() final {
+    ++*run_count_;
+    if (spawn_count_ > 0) {
+      platform_->CallOnWorkerThread(std::make_unique<SpawningWorkerTask>(
+          spawn_count_ - 1, run_count_, platform_));
+      platform_->CallBlockingTaskOnWorkerThread(
+          std::make_unique<SpawningWorkerTask>(0, run_count_, platform_));
+    }
+  }
+
+ private:
+  int spawn_count_;
+  std::atomic<int>* run_count_;
+  node::NodePlatform* platform_;
+};
+
+TEST_F(PlatformTest, DrainTasksWaitsForAllWorkerTasks) {
+  v8::Isolate::Scope isolate_scope(isolate_);
+  const v8::HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env {handle_scope, argv};
+  std::atomic<int> run_count {0};
+  for (int i = 0; i < 8; i++) {
+    platform->CallOnWorkerThread(
+        std::make_unique<SpawningWorkerTask>(4, &run_count, platform.get()));
+    platform->CallLowPriorityTaskOnWorkerThread(
+        std::make_unique<SpawningWorkerTask>(0, &run_count, platform.get()));
+  }
+  platform->DrainTasks(isolate_);
+  // Every spawning task runs itself plus one pair of tasks per level.
+  EXPECT_EQ(8 * (1 + 4 * 2) + 8, run_count);
+}
+
+// This task appends its id to the given list when it runs.
+class RecordingTask : public v8::Task {
+ public:
+  RecordingTask(int id, std::vector<int>* order) : id_(id), order_(order) {}
+
+  // v8::Task implementation
+  void Run() final { order_->push_back(id_); }
+
+ private:
+  int id_;
+  std::vector<int>* order_;
+};
+
+TEST_F(PlatformTest, FlushForegroundTasksByPriority) {
+  v8::Isolate::Scope isolate_scope(isolate_);
+  const v8::HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env {handle_scope, argv};
+  std::vector<int> order;
+  auto task_runner = std::static_pointer_cast<node::PerIsolatePlatformData>(
+      platform->GetForegroundTaskRunner(isolate_));
+  task_runner->PostTaskWithPriority(
+      std::make_unique<RecordingTask>(0, &order),
+      v8::TaskPriority::kBestEffort);
+  task_runner->PostTask(std::make_unique<RecordingTask>(1, &order));
+  task_runner->PostTaskWithPriority(
+      std::make_unique<RecordingTask>(2, &order),
+      v8::TaskPriority::kUserBlocking);
+  EXPECT_TRUE(platform->FlushForegroundTasks(isolate_));
+  EXPECT_EQ(order, (std::vector<int> { 2, 1, 0 }));
+}
+
+// This idle task records the deadline it was given.
+class RecordingIdleTask : public v8::IdleTask {
+ public:
+  explicit RecordingIdleTask(double* deadline) : deadline_(deadline) {}
+
+  // v8::IdleTask implementation
+  void Run(double deadline_in_seconds) final {
+    *deadline_ = deadline_in_seconds;
+  }
+
+ private:
+  double* deadline_;
+};
+
+TEST_F(PlatformTest, IdleTasksRunBeforeLoopBlocks) {
+  v8::Isolate::Scope isolate_scope(isolate_);
+  const v8::HandleScope handle_scope(isolate_);
+  const Argv argv;
+  Env env {handle_scope, argv};
+  std::shared_ptr<v8::TaskRunner> task_runner =
+      platform->GetForegroundTaskRunner(isolate_);
+  EXPECT_TRUE(task_runner->IdleTasksEnabled());
+
+  double deadline = 0;
+  task_runner->PostIdleTask(std::make_unique<RecordingIdleTask>(&deadline));
+  // Idle tasks are not run as part of flushing the regular queues.
+  platform->FlushForegroundTasks(isolate_);
+  EXPECT_EQ(deadline, 0);
+
+  // Give the loop a timer to wait for, so that it has time to spare.
+  uv_timer_t timer;
+  uv_timer_init(&current_loop, &timer);
+  uv_timer_start(&timer, [](uv_timer_t*) {}, 20, 0);
+  double start = platform->MonotonicallyIncreasingTime();
+  uv_run(&current_loop, UV_RUN_ONCE);
+  EXPECT_GT(deadline, start);
+
+  uv_close(reinterpret_cast<uv_handle_t*>(&timer), nullptr);
+  uv_run(&current_loop, UV_RUN_NOWAIT);
+}
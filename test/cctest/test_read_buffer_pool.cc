@@ -0,0 +1,54 @@
+#include "env-inl.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::ReadBufferPool;
+
+TEST(ReadBufferPoolTest, RecyclesSlabsPerSizeClass) {
+  ReadBufferPool pool;
+
+  char* small = pool.Acquire(100);
+  ASSERT_NE(small, nullptr);
+  EXPECT_TRUE(pool.Owns(small));
+  pool.Release(small);
+  EXPECT_FALSE(pool.Owns(small));
+
+  // Anything up to 4 KiB reuses the same slab, larger sizes don't.
+  EXPECT_EQ(pool.Acquire(ReadBufferPool::kMinSlabSize), small);
+  char* large = pool.Acquire(ReadBufferPool::kMaxSlabSize);
+  ASSERT_NE(large, nullptr);
+  EXPECT_NE(large, small);
+  pool.Release(large);
+  EXPECT_EQ(pool.Acquire(ReadBufferPool::kMinSlabSize * 4 + 1), large);
+  pool.Release(large);
+  pool.Release(small);
+}
+
+TEST(ReadBufferPoolTest, RejectsOversizedRequests) {
+  ReadBufferPool pool;
+  EXPECT_EQ(pool.Acquire(ReadBufferPool::kMaxSlabSize + 1), nullptr);
+}
+
+TEST(ReadBufferPoolTest, BoundsFreeSlabs) {
+  ReadBufferPool pool;
+  std::vector<char*> slabs;
+  for (size_t i = 0; i < ReadBufferPool::kMaxFreeSlabs + 4; i++)
+    slabs.push_back(pool.Acquire(1));
+  for (char* slab : slabs)
+    pool.Release(slab);
+
+  // Only kMaxFreeSlabs of them were kept for reuse.
+  size_t reused = 0;
+  std::vector<char*> again;
+  for (size_t i = 0; i < slabs.size(); i++) {
+    again.push_back(pool.Acquire(1));
+    if (std::find(slabs.begin(), slabs.end(), again.back()) != slabs.end())
+      reused++;
+  }
+  EXPECT_GE(reused, ReadBufferPool::kMaxFreeSlabs);
+  for (char* slab : again)
+    pool.Release(slab);
+}
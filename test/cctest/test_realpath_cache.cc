@@ -0,0 +1,101 @@
+#include "node_realpath_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "uv.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+
+using node::fs::RealpathCache;
+
+namespace {
+
+class RealpathCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char tmpl[] = "/tmp/realpath-cache-XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    char real[4096];
+    ASSERT_NE(realpath(tmpl, real), nullptr);
+    dir_ = real;
+    ASSERT_EQ(mkdir((dir_ + "/a").c_str(), 0700), 0);
+    ASSERT_EQ(mkdir((dir_ + "/a/b").c_str(), 0700), 0);
+    FILE* file = fopen((dir_ + "/a/b/file").c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    fclose(file);
+    ASSERT_EQ(symlink("a/b", (dir_ + "/link").c_str()), 0);
+  }
+
+  void TearDown() override {
+    unlink((dir_ + "/link").c_str());
+    unlink((dir_ + "/a/b/file").c_str());
+    rmdir((dir_ + "/a/b").c_str());
+    rmdir((dir_ + "/a").c_str());
+    rmdir(dir_.c_str());
+  }
+
+  std::string dir_;
+};
+
+}  // anonymous namespace
+
+TEST_F(RealpathCacheTest, Resolve) {
+  RealpathCache cache;
+  std::string resolved;
+  EXPECT_EQ(cache.Resolve(dir_ + "/link/file", &resolved), 0);
+  EXPECT_EQ(resolved, dir_ + "/a/b/file");
+  EXPECT_EQ(cache.hits(), 0u);
+
+  // The prefixes are known now.
+  EXPECT_EQ(cache.Resolve(dir_ + "/link", &resolved), 0);
+  EXPECT_EQ(resolved, dir_ + "/a/b");
+  EXPECT_EQ(cache.hits(), 1u);
+  EXPECT_EQ(cache.Resolve(dir_ + "/./link/../b/file", &resolved), 0);
+  EXPECT_EQ(resolved, dir_ + "/a/b/file");
+  EXPECT_EQ(cache.Resolve("/", &resolved), 0);
+  EXPECT_EQ(resolved, "/");
+
+  EXPECT_EQ(cache.Resolve(dir_ + "/link/missing", &resolved), UV_ENOENT);
+  EXPECT_EQ(cache.Resolve(dir_ + "/link/file/", &resolved), UV_ENOTDIR);
+  EXPECT_EQ(cache.Resolve(dir_ + "/link/file/x", &resolved), UV_ENOTDIR);
+  EXPECT_EQ(cache.Resolve("relative", &resolved), UV_EINVAL);
+}
+
+TEST_F(RealpathCacheTest, Loop) {
+  RealpathCache cache;
+  std::string resolved;
+  const std::string loop = dir_ + "/loop";
+  ASSERT_EQ(symlink("loop", loop.c_str()), 0);
+  EXPECT_EQ(cache.Resolve(loop, &resolved), UV_ELOOP);
+  unlink(loop.c_str());
+}
+
+TEST_F(RealpathCacheTest, Invalidate) {
+  RealpathCache cache;
+  std::string resolved;
+  EXPECT_EQ(cache.Resolve(dir_ + "/link/file", &resolved), 0);
+  EXPECT_EQ(cache.Resolve(dir_ + "/a/b/file", &resolved), 0);
+
+  // Removing the file through the link forgets it under both names.
+  ASSERT_EQ(unlink((dir_ + "/a/b/file").c_str()), 0);
+  cache.Invalidate(dir_ + "/link/file");
+  EXPECT_EQ(cache.Resolve(dir_ + "/link/file", &resolved), UV_ENOENT);
+  EXPECT_EQ(cache.Resolve(dir_ + "/a/b/file", &resolved), UV_ENOENT);
+
+  // Pointing the link elsewhere.
+  EXPECT_EQ(cache.Resolve(dir_ + "/link", &resolved), 0);
+  ASSERT_EQ(unlink((dir_ + "/link").c_str()), 0);
+  ASSERT_EQ(symlink("a", (dir_ + "/link").c_str()), 0);
+  EXPECT_EQ(cache.Resolve(dir_ + "/link", &resolved), 0);
+  EXPECT_EQ(resolved, dir_ + "/a/b");  // Stale, until told.
+  cache.Invalidate(dir_ + "/link/");
+  EXPECT_EQ(cache.Resolve(dir_ + "/link", &resolved), 0);
+  EXPECT_EQ(resolved, dir_ + "/a");
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+#endif  // _WIN32
@@ -0,0 +1,104 @@
+#include "node_ring_channel.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::worker::RingBuffer;
+using node::worker::RingChannelState;
+
+namespace {
+
+// Splits the output of RingBuffer::Read() into its records.
+std::vector<std::string> SplitRecords(const char* data, size_t length) {
+  std::vector<std::string> records;
+  size_t position = 0;
+  while (position < length) {
+    uint32_t record_length;
+    memcpy(&record_length, data + position, sizeof(record_length));
+    position += sizeof(record_length);
+    records.emplace_back(data + position, record_length);
+    position += record_length;
+  }
+  EXPECT_EQ(position, length);
+  return records;
+}
+
+}  // anonymous namespace
+
+TEST(RingChannelTest, ReadWrite) {
+  std::shared_ptr<RingChannelState> state = RingChannelState::Create(64);
+  ASSERT_TRUE(state);
+  RingBuffer* ring = state->ring();
+  EXPECT_EQ(ring->max_record_size(), 28u);
+  EXPECT_TRUE(ring->IsEmpty());
+
+  char buffer[64];
+  size_t needed = 0;
+  EXPECT_EQ(ring->Read(buffer, sizeof(buffer), &needed), 0u);
+  EXPECT_EQ(needed, 0u);
+
+  // These take 8, 4 and 28 bytes, so there is no room for another 28 in
+  // the 24 bytes that are left.
+  const std::string long_record = "0123456789abcdef0123456";
+  EXPECT_TRUE(ring->Write("abc", 3));
+  EXPECT_TRUE(ring->Write("", 0));
+  EXPECT_TRUE(ring->Write(long_record.data(), long_record.size()));
+  EXPECT_FALSE(ring->Write(long_record.data(), long_record.size()));
+  EXPECT_FALSE(ring->IsEmpty());
+
+  // Too small for the first record.
+  EXPECT_EQ(ring->Read(buffer, 6, &needed), 0u);
+  EXPECT_EQ(needed, 7u);
+  // Only room for the first two.
+  size_t read = ring->Read(buffer, 12, &needed);
+  EXPECT_EQ(SplitRecords(buffer, read),
+            (std::vector<std::string>{"abc", ""}));
+  read = ring->Read(buffer, sizeof(buffer), &needed);
+  EXPECT_EQ(SplitRecords(buffer, read),
+            (std::vector<std::string>{long_record}));
+  EXPECT_TRUE(ring->IsEmpty());
+
+  // This one does not fit into the last 24 bytes, and wraps around to the
+  // start of the buffer.
+  EXPECT_TRUE(ring->Write(long_record.data(), long_record.size()));
+  EXPECT_TRUE(ring->Write("xyz", 3));
+  read = ring->Read(buffer, sizeof(buffer), &needed);
+  EXPECT_EQ(SplitRecords(buffer, read),
+            (std::vector<std::string>{long_record, "xyz"}));
+  EXPECT_TRUE(ring->IsEmpty());
+}
+
+TEST(RingChannelTest, Threads) {
+  constexpr int kRecords = 100000;
+  std::shared_ptr<RingChannelState> state = RingChannelState::Create(4096);
+  ASSERT_TRUE(state);
+  RingBuffer* ring = state->ring();
+
+  std::thread writer([&]() {
+    for (int i = 0; i < kRecords; i++) {
+      const std::string record = std::to_string(i) + std::string(i % 64, '.');
+      while (!ring->Write(record.data(), record.size()))
+        std::this_thread::yield();
+    }
+  });
+
+  std::vector<char> buffer(1024);
+  int next = 0;
+  while (next < kRecords) {
+    size_t needed = 0;
+    const size_t read = ring->Read(buffer.data(), buffer.size(), &needed);
+    ASSERT_EQ(needed, 0u);
+    if (read == 0)
+      std::this_thread::yield();
+    for (const std::string& record : SplitRecords(buffer.data(), read)) {
+      ASSERT_EQ(record, std::to_string(next) + std::string(next % 64, '.'));
+      next++;
+    }
+  }
+  writer.join();
+  EXPECT_TRUE(ring->IsEmpty());
+}
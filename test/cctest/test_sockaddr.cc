@@ -4,6 +4,7 @@
 using node::SocketAddress;
 using node::SocketAddressBlockList;
 using node::SocketAddressLRU;
+using node::SocketAddressRateLimiter;
 
 TEST(SocketAddress, SocketAddress) {
   CHECK(SocketAddress::is_numeric_host("123.123.123.123"));
@@ -215,3 +216,117 @@ TEST(SocketAddressBlockList, Simple) {
   CHECK(!bl.Apply(addr1));
   CHECK(bl.Apply(addr2));
 }
+
+namespace {
+std::shared_ptr<SocketAddress> MakeAddress(int family, const char* host) {
+  sockaddr_storage storage;
+  CHECK(SocketAddress::ToSockAddr(family, host, 0, &storage));
+  return std::make_shared<SocketAddress>(
+      reinterpret_cast<const sockaddr*>(&storage));
+}
+}  // namespace
+
+TEST(SocketAddressBlockList, RangesAndSubnets) {
+  SocketAddressBlockList bl;
+  bl.AddSocketAddressRange(MakeAddress(AF_INET, "10.0.0.5"),
+                           MakeAddress(AF_INET, "10.0.1.3"));
+  bl.AddSocketAddressMask(MakeAddress(AF_INET, "192.168.0.0"), 16);
+  bl.AddSocketAddressMask(MakeAddress(AF_INET6, "2001:db8::"), 32);
+
+  CHECK(!bl.Apply(MakeAddress(AF_INET, "10.0.0.4")));
+  CHECK(bl.Apply(MakeAddress(AF_INET, "10.0.0.5")));
+  CHECK(bl.Apply(MakeAddress(AF_INET, "10.0.0.255")));
+  CHECK(bl.Apply(MakeAddress(AF_INET, "10.0.1.3")));
+  CHECK(!bl.Apply(MakeAddress(AF_INET, "10.0.1.4")));
+
+  CHECK(bl.Apply(MakeAddress(AF_INET, "192.168.255.1")));
+  CHECK(!bl.Apply(MakeAddress(AF_INET, "192.169.0.1")));
+  CHECK(bl.Apply(MakeAddress(AF_INET6, "2001:db8:ffff::1")));
+  CHECK(!bl.Apply(MakeAddress(AF_INET6, "2001:db9::1")));
+
+  // IPv4-mapped IPv6 addresses are the IPv4 addresses they map.
+  CHECK(bl.Apply(MakeAddress(AF_INET6, "::ffff:10.0.0.7")));
+  CHECK(bl.Apply(MakeAddress(AF_INET6, "::ffff:192.168.1.1")));
+  CHECK(!bl.Apply(MakeAddress(AF_INET6, "::ffff:10.0.1.4")));
+}
+
+TEST(SocketAddressBlockList, MixedFamilyRange) {
+  // An IPv4 address is not comparable to an IPv6 address that is not
+  // IPv4-mapped, so it is in no range that has such an end.
+  SocketAddressBlockList bl;
+  bl.AddSocketAddressRange(MakeAddress(AF_INET6, "::"),
+                           MakeAddress(AF_INET6, "ffff::"));
+  CHECK(bl.Apply(MakeAddress(AF_INET6, "2001:db8::1")));
+  CHECK(bl.Apply(MakeAddress(AF_INET6, "::ffff:10.0.0.1")));
+  CHECK(!bl.Apply(MakeAddress(AF_INET, "10.0.0.1")));
+
+  SocketAddressBlockList mixed;
+  mixed.AddSocketAddressRange(MakeAddress(AF_INET, "10.0.0.0"),
+                              MakeAddress(AF_INET6, "ffff::"));
+  CHECK(!mixed.Apply(MakeAddress(AF_INET, "10.0.0.1")));
+  CHECK(mixed.Apply(MakeAddress(AF_INET6, "::ffff:10.0.0.1")));
+  CHECK(!mixed.Apply(MakeAddress(AF_INET6, "2001:db8::1")));
+}
+
+TEST(SocketAddressBlockList, RemoveDuplicate) {
+  SocketAddressBlockList bl;
+  std::shared_ptr<SocketAddress> addr = MakeAddress(AF_INET, "10.0.0.1");
+  bl.AddSocketAddress(addr);
+  bl.AddSocketAddress(addr);
+  bl.AddSocketAddressMask(MakeAddress(AF_INET, "10.0.0.0"), 31);
+
+  bl.RemoveSocketAddress(addr);
+  CHECK_EQ(bl.size(), 2u);
+  CHECK(bl.Apply(addr));
+}
+
+TEST(SocketAddressBlockList, Parent) {
+  auto parent = std::make_shared<SocketAddressBlockList>();
+  parent->AddSocketAddressMask(MakeAddress(AF_INET, "10.0.0.0"), 8);
+  SocketAddressBlockList bl(parent);
+  bl.AddSocketAddress(MakeAddress(AF_INET, "192.168.0.1"));
+
+  CHECK(bl.Apply(MakeAddress(AF_INET, "10.1.2.3")));
+  CHECK(bl.Apply(MakeAddress(AF_INET, "192.168.0.1")));
+  CHECK(!bl.Apply(MakeAddress(AF_INET, "192.168.0.2")));
+}
+
+TEST(SocketAddressRateLimiter, Burst) {
+  // Slow enough that no token comes back while the test runs.
+  SocketAddressRateLimiter limiter(1e-6, 2, 16);
+  sockaddr_storage storage;
+  SocketAddress::ToSockAddr(AF_INET, "10.0.0.1", 1000, &storage);
+  SocketAddress first(reinterpret_cast<const sockaddr*>(&storage));
+  SocketAddress::ToSockAddr(AF_INET, "10.0.0.1", 2000, &storage);
+  SocketAddress second(reinterpret_cast<const sockaddr*>(&storage));
+
+  CHECK(limiter.Admit(first));
+  // The port does not matter.
+  CHECK(limiter.Admit(second));
+  CHECK(!limiter.Admit(first));
+  CHECK(!limiter.Admit(second));
+  CHECK(limiter.Admit(*MakeAddress(AF_INET, "10.0.0.2")));
+  CHECK(limiter.Admit(*MakeAddress(AF_INET6, "::1")));
+  CHECK_EQ(limiter.size(), 3u);
+}
+
+TEST(SocketAddressRateLimiter, MaxAddresses) {
+  SocketAddressRateLimiter limiter(0, 1, 2);
+  CHECK(limiter.Admit(*MakeAddress(AF_INET, "10.0.0.1")));
+  CHECK(!limiter.Admit(*MakeAddress(AF_INET, "10.0.0.1")));
+  CHECK(limiter.Admit(*MakeAddress(AF_INET, "10.0.0.2")));
+  CHECK(limiter.Admit(*MakeAddress(AF_INET, "10.0.0.3")));
+  CHECK_EQ(limiter.size(), 2u);
+  // 10.0.0.1 was seen least recently and has been forgotten.
+  CHECK(limiter.Admit(*MakeAddress(AF_INET, "10.0.0.1")));
+  CHECK(!limiter.Admit(*MakeAddress(AF_INET, "10.0.0.3")));
+}
+
+TEST(SocketAddressRateLimiter, Refill) {
+  SocketAddressRateLimiter limiter(1e6, 1, 16);
+  std::shared_ptr<SocketAddress> address = MakeAddress(AF_INET, "10.0.0.1");
+  CHECK(limiter.Admit(*address));
+  uint64_t start = uv_hrtime();
+  while (uv_hrtime() - start < 10000) {}
+  CHECK(limiter.Admit(*address));
+}
@@ -0,0 +1,126 @@
+#include "spawn_server.h"
+
+#include <csignal>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#ifdef __POSIX__
+
+using node::spawn_server::Process;
+
+namespace {
+
+struct Result {
+  int error = 0;
+  int64_t exit_status = -1;
+  int term_signal = -1;
+  std::string output;
+};
+
+// Runs `command` with /bin/sh on a loop of its own, with stdout in a pipe.
+Result RunShell(const char* command,
+                char** env = nullptr,
+                const char* cwd = nullptr,
+                int kill_signal = 0) {
+  // cctest has started its platform threads by now. The helper only needs
+  // malloc() to work after fork(), which glibc and the BSDs make sure of.
+  if (!node::spawn_server::IsRunning()) {
+    EXPECT_TRUE(node::spawn_server::Start());
+  }
+
+  Result result;
+  uv_loop_t loop;
+  EXPECT_EQ(uv_loop_init(&loop), 0);
+  uv_pipe_t out;
+  EXPECT_EQ(uv_pipe_init(&loop, &out, 0), 0);
+  out.data = &result;
+
+  char* args[] = {const_cast<char*>("/bin/sh"),
+                  const_cast<char*>("-c"),
+                  const_cast<char*>(command),
+                  nullptr};
+  uv_stdio_container_t stdio[3];
+  stdio[0].flags = UV_IGNORE;
+  stdio[1].flags =
+      static_cast<uv_stdio_flags>(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
+  stdio[1].data.stream = reinterpret_cast<uv_stream_t*>(&out);
+  stdio[2].flags = UV_INHERIT_FD;
+  stdio[2].data.fd = 2;
+
+  uv_process_options_t options = {};
+  options.file = args[0];
+  options.args = args;
+  options.env = env;
+  options.cwd = cwd;
+  options.stdio = stdio;
+  options.stdio_count = 3;
+
+  Process process;
+  process.data = &result;
+  result.error = process.Spawn(
+      &loop, &options, [](Process* process, int64_t status, int signal) {
+        Result* result = static_cast<Result*>(process->data);
+        result->exit_status = status;
+        result->term_signal = signal;
+        process->Close();
+      });
+
+  if (result.error == 0) {
+    EXPECT_GT(process.pid(), 0);
+    if (kill_signal != 0) {
+      EXPECT_EQ(process.Kill(kill_signal), 0);
+    }
+    EXPECT_EQ(uv_read_start(
+        reinterpret_cast<uv_stream_t*>(&out),
+        [](uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+          static char storage[1024];
+          *buf = uv_buf_init(storage, sizeof(storage));
+        },
+        [](uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+          Result* result = static_cast<Result*>(stream->data);
+          if (nread > 0) result->output.append(buf->base, nread);
+          if (nread < 0)
+            uv_close(reinterpret_cast<uv_handle_t*>(stream), nullptr);
+        }), 0);
+  } else {
+    uv_close(reinterpret_cast<uv_handle_t*>(&out), nullptr);
+  }
+
+  EXPECT_EQ(uv_run(&loop, UV_RUN_DEFAULT), 0);
+  EXPECT_FALSE(process.is_open());
+  EXPECT_EQ(uv_loop_close(&loop), 0);
+  return result;
+}
+
+}  // anonymous namespace
+
+TEST(SpawnServerTest, ExitStatusAndOutput) {
+  Result result = RunShell("echo hello; exit 3");
+  EXPECT_EQ(result.error, 0);
+  EXPECT_EQ(result.output, "hello\n");
+  EXPECT_EQ(result.exit_status, 3);
+  EXPECT_EQ(result.term_signal, 0);
+}
+
+TEST(SpawnServerTest, EnvAndCwd) {
+  char* env[] = {const_cast<char*>("SPAWN_SERVER_TEST=ok"), nullptr};
+  Result result = RunShell("echo $SPAWN_SERVER_TEST; pwd", env, "/");
+  EXPECT_EQ(result.error, 0);
+  EXPECT_EQ(result.output, "ok\n/\n");
+  EXPECT_EQ(result.exit_status, 0);
+}
+
+TEST(SpawnServerTest, Kill) {
+  Result result = RunShell("sleep 10", nullptr, nullptr, SIGTERM);
+  EXPECT_EQ(result.error, 0);
+  EXPECT_EQ(result.term_signal, SIGTERM);
+}
+
+TEST(SpawnServerTest, SpawnError) {
+  Result result = RunShell("exit 0", nullptr, "/nonexistent/directory");
+  EXPECT_EQ(result.error, UV_ENOENT);
+  EXPECT_EQ(result.exit_status, -1);
+}
+
+#endif  // __POSIX__
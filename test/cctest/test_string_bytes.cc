@@ -0,0 +1,63 @@
+#include "node_test_fixture.h"
+#include "string_bytes.h"
+#include "util-inl.h"
+#include "v8.h"
+
+#include <cstring>
+
+using node::StringBytes;
+using v8::ArrayBuffer;
+using v8::BackingStore;
+using v8::HandleScope;
+using v8::Local;
+using v8::String;
+using v8::Value;
+
+class StringBytesTest : public NodeTestFixture {};
+
+TEST_F(StringBytesTest, EncodeShared) {
+  HandleScope handle_scope(isolate_);
+  Local<v8::Context> context = v8::Context::New(isolate_);
+  v8::Context::Scope context_scope(context);
+
+  constexpr size_t kLength = 256 * 1024;
+  std::shared_ptr<BackingStore> store =
+      ArrayBuffer::NewBackingStore(isolate_, kLength);
+  char* data = static_cast<char*>(store->Data());
+  memset(data, 'a', kLength);
+
+  auto encode = [&](size_t offset, size_t length, node::encoding encoding) {
+    Local<Value> error;
+    Local<Value> value =
+        StringBytes::EncodeShared(
+            isolate_, store, offset, length, encoding, &error)
+            .ToLocalChecked();
+    EXPECT_TRUE(error.IsEmpty());
+    return value.As<String>();
+  };
+
+  // Long ASCII data is shared, and keeps the store alive.
+  Local<String> shared = encode(16, kLength - 16, node::UTF8);
+  ASSERT_TRUE(shared->IsExternalOneByte());
+  EXPECT_EQ(shared->GetExternalOneByteStringResource()->data(), data + 16);
+  EXPECT_EQ(shared->Length(), static_cast<int>(kLength - 16));
+  EXPECT_GT(store.use_count(), 1);
+
+  shared = encode(0, kLength, node::UCS2);
+  ASSERT_TRUE(shared->IsExternalTwoByte());
+  EXPECT_EQ(shared->Length(), static_cast<int>(kLength / 2));
+
+  // Small parts are copied.
+  EXPECT_FALSE(encode(0, 1024, node::LATIN1)->IsExternalOneByte());
+
+  // So is data that needs to be converted.
+  data[kLength - 1] = '\xe9';
+  Local<String> copied = encode(0, kLength, node::ASCII);
+  EXPECT_EQ(copied->Length(), static_cast<int>(kLength));
+  if (copied->IsExternalOneByte()) {
+    EXPECT_NE(copied->GetExternalOneByteStringResource()->data(), data);
+  }
+  shared = encode(0, kLength, node::LATIN1);
+  ASSERT_TRUE(shared->IsExternalOneByte());
+  EXPECT_EQ(shared->GetExternalOneByteStringResource()->data(), data);
+}
@@ -0,0 +1,77 @@
+#include "timers.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::timers::TimerWheel;
+
+TEST(TimerWheelTest, Expire) {
+  TimerWheel wheel(10, 16);
+  TimerWheel::Id a = wheel.Add(1000, 25);
+  TimerWheel::Id b = wheel.Add(1000, 50);
+  EXPECT_EQ(wheel.size(), 2u);
+
+  uint64_t when;
+  ASSERT_TRUE(wheel.NextExpiry(&when));
+  EXPECT_EQ(when, 1030u);
+
+  std::vector<TimerWheel::Id> expired;
+  wheel.Expire(1024, &expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.Expire(1030, &expired);
+  EXPECT_EQ(expired, std::vector<TimerWheel::Id>({a}));
+  EXPECT_FALSE(wheel.IsActive(a));
+  EXPECT_TRUE(wheel.IsActive(b));
+
+  expired.clear();
+  wheel.Expire(2000, &expired);
+  EXPECT_EQ(expired, std::vector<TimerWheel::Id>({b}));
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_FALSE(wheel.NextExpiry(&when));
+}
+
+TEST(TimerWheelTest, RefreshAndRemove) {
+  TimerWheel wheel(10, 16);
+  TimerWheel::Id a = wheel.Add(0, 100);
+  TimerWheel::Id b = wheel.Add(0, 100);
+
+  std::vector<TimerWheel::Id> expired;
+  wheel.Expire(90, &expired);
+  EXPECT_TRUE(wheel.Refresh(a, 90));
+  EXPECT_TRUE(wheel.Remove(b));
+  EXPECT_FALSE(wheel.Remove(b));
+  EXPECT_FALSE(wheel.Refresh(b, 90));
+
+  wheel.Expire(150, &expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.Expire(190, &expired);
+  EXPECT_EQ(expired, std::vector<TimerWheel::Id>({a}));
+
+  // Ids are reused.
+  EXPECT_EQ(wheel.Add(200, 10), a);
+}
+
+TEST(TimerWheelTest, MoreThanOneTurn) {
+  TimerWheel wheel(10, 16);
+  // 16 slots of 10 ms make for a turn of 160 ms.
+  TimerWheel::Id a = wheel.Add(0, 10);
+  TimerWheel::Id b = wheel.Add(0, 170);
+
+  std::vector<TimerWheel::Id> expired;
+  wheel.Expire(10, &expired);
+  EXPECT_EQ(expired, std::vector<TimerWheel::Id>({a}));
+
+  expired.clear();
+  wheel.Expire(160, &expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.Expire(170, &expired);
+  EXPECT_EQ(expired, std::vector<TimerWheel::Id>({b}));
+
+  // A late call still expires everything that is due.
+  for (int i = 0; i < 100; i++) wheel.Add(200, i * 10);
+  expired.clear();
+  wheel.Expire(5000, &expired);
+  EXPECT_EQ(expired.size(), 100u);
+  EXPECT_EQ(wheel.size(), 0u);
+}
@@ -0,0 +1,114 @@
+#include "utf8.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using node::Utf8Content;
+using node::utf8_classify;
+
+namespace {
+
+Utf8Content Classify(const std::string& input, size_t* length = nullptr) {
+  size_t utf16_length;
+  Utf8Content content =
+      utf8_classify(input.data(), input.size(), &utf16_length);
+  if (length != nullptr)
+    *length = utf16_length;
+  return content;
+}
+
+}  // anonymous namespace
+
+TEST(Utf8Test, Classify) {
+  size_t length;
+  EXPECT_EQ(Utf8Content::ASCII, Classify("", &length));
+  EXPECT_EQ(0u, length);
+  EXPECT_EQ(Utf8Content::ASCII, Classify("hello", &length));
+  EXPECT_EQ(5u, length);
+  EXPECT_EQ(Utf8Content::LATIN1, Classify("caf\xc3\xa9", &length));
+  EXPECT_EQ(4u, length);
+  EXPECT_EQ(Utf8Content::TWO_BYTE, Classify("\xe2\x82\xac", &length));
+  EXPECT_EQ(1u, length);
+  EXPECT_EQ(Utf8Content::TWO_BYTE, Classify("\xf0\x9f\x98\x80", &length));
+  EXPECT_EQ(2u, length);
+
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\x80"));
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xc3"));
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xc0\x80"));          // Overlong.
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xe0\x80\x80"));      // Overlong.
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xed\xa0\x80"));      // Surrogate.
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xf4\x90\x80\x80"));  // Too large.
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xf0\x9f\x98"));
+  EXPECT_EQ(Utf8Content::INVALID, Classify("\xff"));
+}
+
+TEST(Utf8Test, ClassifyLongInput) {
+  // Errors and multi-byte characters at every position of inputs long
+  // enough to go through the vectorized code, if there is any.
+  const std::string ascii(100, 'x');
+  for (size_t i = 0; i <= ascii.size(); i++) {
+    const std::string head = ascii.substr(0, i);
+    const std::string tail = ascii.substr(i);
+    size_t length;
+    EXPECT_EQ(Utf8Content::LATIN1,
+              Classify(head + "\xc3\xa9" + tail, &length));
+    EXPECT_EQ(101u, length);
+    EXPECT_EQ(Utf8Content::TWO_BYTE,
+              Classify(head + "\xf0\x9f\x98\x80" + tail, &length));
+    EXPECT_EQ(102u, length);
+    EXPECT_EQ(Utf8Content::INVALID, Classify(head + "\xa9" + tail));
+    EXPECT_EQ(Utf8Content::INVALID, Classify(head + "\xe2\x82" + tail));
+    EXPECT_EQ(Utf8Content::INVALID, Classify(head + "\xed\xbf\xbf" + tail));
+  }
+}
+
+TEST(Utf8Test, Decode) {
+  const std::string input =
+      std::string(40, 'a') + "caf\xc3\xa9 \xf0\x9f\x98\x80";
+  size_t length;
+  ASSERT_EQ(Utf8Content::TWO_BYTE, Classify(input, &length));
+  std::vector<uint16_t> utf16(length);
+  EXPECT_EQ(length, node::utf8_to_utf16(input.data(), input.size(),
+                                        utf16.data()));
+  std::vector<uint16_t> expected(40, 'a');
+  for (uint16_t c : { 0x63, 0x61, 0x66, 0xe9, 0x20, 0xd83d, 0xde00 })
+    expected.push_back(c);
+  EXPECT_EQ(expected, utf16);
+
+  const std::string latin1_input =
+      std::string(40, 'a') + "caf\xc3\xa9\xc2\xa0";
+  ASSERT_EQ(Utf8Content::LATIN1, Classify(latin1_input, &length));
+  std::string latin1(length, '\0');
+  EXPECT_EQ(length, node::utf8_to_latin1(latin1_input.data(),
+                                         latin1_input.size(),
+                                         &latin1[0]));
+  EXPECT_EQ(std::string(40, 'a') + "caf\xe9\xa0", latin1);
+}
+
+TEST(Utf8Test, EncodeLatin1) {
+  const std::string latin1 = std::string(20, 'a') + "\xe9" "b";
+  char buffer[32];
+  size_t read;
+  EXPECT_EQ(23u, node::latin1_to_utf8(latin1.data(), latin1.size(),
+                                      buffer, sizeof(buffer), &read));
+  EXPECT_EQ(22u, read);
+  EXPECT_EQ(std::string(20, 'a') + "\xc3\xa9" "b", std::string(buffer, 23));
+
+  // Only whole characters are written.
+  EXPECT_EQ(20u, node::latin1_to_utf8(latin1.data(), latin1.size(),
+                                      buffer, 21, &read));
+  EXPECT_EQ(20u, read);
+}
+
+TEST(Utf8Test, AsciiPrefixLength) {
+  std::string input(100, 'x');
+  EXPECT_EQ(100u, node::ascii_prefix_length(input.data(), input.size()));
+  for (size_t i = 0; i < input.size(); i++) {
+    std::string copy = input;
+    copy[i] = '\xe9';
+    EXPECT_EQ(i, node::ascii_prefix_length(copy.data(), copy.size()));
+  }
+}
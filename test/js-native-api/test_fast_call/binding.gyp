@@ -0,0 +1,11 @@
+{
+  "targets": [
+    {
+      "target_name": "test_fast_call",
+      "sources": [
+        "../entry_point.c",
+        "test_fast_call.c"
+      ]
+    }
+  ]
+}
@@ -0,0 +1,52 @@
+'use strict';
+// Flags: --allow-natives-syntax --turbo-fast-api-calls
+
+const common = require('../../common');
+const assert = require('assert');
+
+const binding = require(`./build/${common.buildType}/test_fast_call`);
+
+assert.deepStrictEqual(binding.testInvalidSignatures(), {
+  int64Return: 'Invalid argument',
+  voidArgument: 'Invalid argument',
+  argTypesIsNull: 'Invalid argument',
+  fastCbIsNull: 'Invalid argument',
+});
+
+// The slow path alone, before any of the calls are optimized.
+assert.strictEqual(binding.add(2, 3), 5);
+assert.strictEqual(binding.sum(new Float64Array([1.5, 2.5])), 4);
+assert.strictEqual(binding.checkedSqrt(17), 4);
+assert.throws(() => binding.checkedSqrt(-1), RangeError);
+assert.strictEqual(binding.getFastCalls(), 0);
+
+function add(a, b) { return binding.add(a, b); }
+function sum(array) { return binding.sum(array); }
+function checkedSqrt(value) { return binding.checkedSqrt(value); }
+
+const array = new Float64Array([0.25, 0.5, 1]);
+eval('%PrepareFunctionForOptimization(add)');
+eval('%PrepareFunctionForOptimization(sum)');
+eval('%PrepareFunctionForOptimization(checkedSqrt)');
+assert.strictEqual(add(1, 2), 3);
+assert.strictEqual(sum(array), 1.75);
+assert.strictEqual(checkedSqrt(16), 4);
+eval('%OptimizeFunctionOnNextCall(add)');
+eval('%OptimizeFunctionOnNextCall(sum)');
+eval('%OptimizeFunctionOnNextCall(checkedSqrt)');
+
+// Both paths give the same results, whichever is taken.
+assert.strictEqual(add(40, 2), 42);
+assert.strictEqual(sum(array), 1.75);
+assert.strictEqual(checkedSqrt(81), 9);
+// Mismatched arguments go through the slow path.
+assert.strictEqual(add('40', 2), 42);
+assert.strictEqual(sum(new Float64Array(0)), 0);
+// The fast callback falls back for the slow path to throw.
+assert.throws(() => checkedSqrt(-4), RangeError);
+
+// At least add() has taken the fast path, as it has no floating point
+// arguments, which some platforms do not pass to fast calls.
+if (process.arch === 'x64' || process.arch === 'arm64') {
+  assert(binding.getFastCalls() > 0);
+}
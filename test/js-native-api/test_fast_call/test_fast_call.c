@@ -0,0 +1,189 @@
+#define NAPI_EXPERIMENTAL
+#include <js_native_api.h>
+#include <string.h>
+#include "../common.h"
+
+static uint32_t fast_calls = 0;
+
+static int32_t FastAdd(napi_value receiver,
+                       int32_t a,
+                       int32_t b,
+                       node_api_fast_callback_options* options) {
+  fast_calls++;
+  return a + b;
+}
+
+static napi_value Add(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value args[2];
+  NODE_API_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  int32_t a, b;
+  NODE_API_CALL(env, napi_get_value_int32(env, args[0], &a));
+  NODE_API_CALL(env, napi_get_value_int32(env, args[1], &b));
+
+  napi_value result;
+  NODE_API_CALL(env, napi_create_int32(env, a + b, &result));
+  return result;
+}
+
+static double FastSum(napi_value receiver,
+                      const node_api_fast_typed_array* array,
+                      node_api_fast_callback_options* options) {
+  fast_calls++;
+  double sum = 0;
+  for (size_t i = 0; i < array->length; i++) {
+    double value;
+    memcpy(&value, (const double*)array->data + i, sizeof(value));
+    sum += value;
+  }
+  return sum;
+}
+
+static napi_value Sum(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NODE_API_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  napi_typedarray_type type;
+  size_t length;
+  void* data;
+  NODE_API_CALL(env, napi_get_typedarray_info(
+      env, args[0], &type, &length, &data, NULL, NULL));
+  NODE_API_ASSERT(env, type == napi_float64_array,
+      "Wrong type of arguments. Expects a Float64Array.");
+
+  double sum = 0;
+  for (size_t i = 0; i < length; i++) sum += ((double*)data)[i];
+
+  napi_value result;
+  NODE_API_CALL(env, napi_create_double(env, sum, &result));
+  return result;
+}
+
+// Falls back to the slow path, which throws, for negative arguments.
+static uint32_t FastCheckedSqrt(napi_value receiver,
+                                int32_t value,
+                                node_api_fast_callback_options* options) {
+  if (value < 0) {
+    options->fallback = true;
+    return 0;
+  }
+  fast_calls++;
+  uint32_t root = 0;
+  while ((root + 1) * (root + 1) <= (uint32_t)value) root++;
+  return root;
+}
+
+static napi_value CheckedSqrt(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NODE_API_CALL(env, napi_get_cb_info(env, info, &argc, args, NULL, NULL));
+
+  int32_t value;
+  NODE_API_CALL(env, napi_get_value_int32(env, args[0], &value));
+  if (value < 0) {
+    napi_throw_range_error(env, NULL, "Expects a non-negative number.");
+    return NULL;
+  }
+
+  uint32_t root = 0;
+  while ((root + 1) * (root + 1) <= (uint32_t)value) root++;
+
+  napi_value result;
+  NODE_API_CALL(env, napi_create_uint32(env, root, &result));
+  return result;
+}
+
+static napi_value GetFastCalls(napi_env env, napi_callback_info info) {
+  napi_value result;
+  NODE_API_CALL(env, napi_create_uint32(env, fast_calls, &result));
+  return result;
+}
+
+static napi_value TestInvalidSignatures(napi_env env,
+                                        napi_callback_info info) {
+  napi_value return_value, result;
+  NODE_API_CALL(env, napi_create_object(env, &return_value));
+
+  // V8 does not return 64-bit integers from fast calls.
+  node_api_fast_signature signature = {
+    (node_api_fast_callback)FastAdd, node_api_fast_int64, NULL, 0
+  };
+  node_api_create_function_with_fast_path(
+      env, "f", NAPI_AUTO_LENGTH, Add, NULL, &signature, &result);
+  add_last_status(env, "int64Return", return_value);
+
+  // void is only a return type.
+  node_api_fast_type void_arg[] = { node_api_fast_void };
+  signature.return_type = node_api_fast_int32;
+  signature.arg_types = void_arg;
+  signature.arg_count = 1;
+  node_api_create_function_with_fast_path(
+      env, "f", NAPI_AUTO_LENGTH, Add, NULL, &signature, &result);
+  add_last_status(env, "voidArgument", return_value);
+
+  signature.arg_types = NULL;
+  node_api_create_function_with_fast_path(
+      env, "f", NAPI_AUTO_LENGTH, Add, NULL, &signature, &result);
+  add_last_status(env, "argTypesIsNull", return_value);
+
+  signature.fast_cb = NULL;
+  signature.arg_count = 0;
+  node_api_create_function_with_fast_path(
+      env, "f", NAPI_AUTO_LENGTH, Add, NULL, &signature, &result);
+  add_last_status(env, "fastCbIsNull", return_value);
+
+  return return_value;
+}
+
+static napi_status DefineFastFunction(napi_env env,
+                                      napi_value exports,
+                                      const char* name,
+                                      napi_callback cb,
+                                      node_api_fast_callback fast_cb,
+                                      node_api_fast_type return_type,
+                                      const node_api_fast_type* arg_types,
+                                      size_t arg_count) {
+  node_api_fast_signature signature = {
+    fast_cb, return_type, arg_types, arg_count
+  };
+  napi_value fn;
+  napi_status status = node_api_create_function_with_fast_path(
+      env, name, NAPI_AUTO_LENGTH, cb, NULL, &signature, &fn);
+  if (status != napi_ok) return status;
+  return napi_set_named_property(env, exports, name, fn);
+}
+
+EXTERN_C_START
+napi_value Init(napi_env env, napi_value exports) {
+  static const node_api_fast_type add_args[] = {
+    node_api_fast_int32, node_api_fast_int32
+  };
+  static const node_api_fast_type sum_args[] = {
+    node_api_fast_float64_array
+  };
+  static const node_api_fast_type sqrt_args[] = { node_api_fast_int32 };
+
+  NODE_API_CALL(env, DefineFastFunction(
+      env, exports, "add", Add, (node_api_fast_callback)FastAdd,
+      node_api_fast_int32, add_args, 2));
+  NODE_API_CALL(env, DefineFastFunction(
+      env, exports, "sum", Sum, (node_api_fast_callback)FastSum,
+      node_api_fast_float64, sum_args, 1));
+  NODE_API_CALL(env, DefineFastFunction(
+      env, exports, "checkedSqrt", CheckedSqrt,
+      (node_api_fast_callback)FastCheckedSqrt,
+      node_api_fast_uint32, sqrt_args, 1));
+
+  napi_property_descriptor properties[] = {
+    DECLARE_NODE_API_PROPERTY("getFastCalls", GetFastCalls),
+    DECLARE_NODE_API_PROPERTY("testInvalidSignatures", TestInvalidSignatures),
+  };
+
+  NODE_API_CALL(env, napi_define_properties(
+      env, exports, sizeof(properties) / sizeof(*properties), properties));
+
+  return exports;
+}
+EXTERN_C_END
@@ -0,0 +1,146 @@
+#define NAPI_EXPERIMENTAL
+#include <stdint.h>
+#include <stdlib.h>
+#include <uv.h>
+#include <node_api.h>
+#include "../../js-native-api/common.h"
+
+#define EXECUTOR_NAME "test_async_executor"
+#define THREAD_COUNT 2
+
+static node_api_executor executor;
+
+typedef struct {
+  napi_async_work work;
+  napi_ref callback;
+  uint32_t delay_ms;
+} work_data;
+
+static void Execute(napi_env env, void* data) {
+  work_data* w = data;
+  uv_sleep(w->delay_ms);
+}
+
+static void Complete(napi_env env, napi_status status, void* data) {
+  work_data* w = data;
+  napi_value callback, undefined, cancelled;
+
+  NODE_API_CALL_RETURN_VOID(env,
+      napi_get_reference_value(env, w->callback, &callback));
+  NODE_API_CALL_RETURN_VOID(env, napi_get_undefined(env, &undefined));
+  NODE_API_CALL_RETURN_VOID(env,
+      napi_get_boolean(env, status == napi_cancelled, &cancelled));
+  NODE_API_CALL_RETURN_VOID(env, napi_delete_reference(env, w->callback));
+  NODE_API_CALL_RETURN_VOID(env, napi_delete_async_work(env, w->work));
+  free(w);
+  NODE_API_CALL_RETURN_VOID(env,
+      napi_call_function(env, undefined, callback, 1, &cancelled, NULL));
+}
+
+static work_data* Queue(napi_env env, napi_value delay, napi_value callback) {
+  napi_value resource_name;
+  work_data* w = malloc(sizeof(*w));
+
+  NODE_API_CALL(env, napi_get_value_uint32(env, delay, &w->delay_ms));
+  NODE_API_CALL(env, napi_create_reference(env, callback, 1, &w->callback));
+  NODE_API_CALL(env, napi_create_string_utf8(env,
+      "TestExecutorWork", NAPI_AUTO_LENGTH, &resource_name));
+  NODE_API_CALL(env, napi_create_async_work(env, NULL, resource_name,
+      Execute, Complete, w, &w->work));
+  NODE_API_CALL(env,
+      node_api_queue_async_work_on_executor(env, w->work, executor));
+  return w;
+}
+
+// Run(delayMs, callback) calls callback(cancelled) once the work is done.
+static napi_value Run(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+
+  NODE_API_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  Queue(env, argv[0], argv[1]);
+  return NULL;
+}
+
+// Like Run(), but cancels the work right away. Returns whether that worked.
+static napi_value RunAndCancel(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2], result;
+  work_data* w;
+
+  NODE_API_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  w = Queue(env, argv[0], argv[1]);
+  NODE_API_CALL(env, napi_get_boolean(env,
+      napi_cancel_async_work(env, w->work) == napi_ok, &result));
+  return result;
+}
+
+static napi_status SetUint64(napi_env env,
+                             napi_value object,
+                             const char* name,
+                             uint64_t value) {
+  napi_value number;
+  napi_status status = napi_create_double(env, (double)value, &number);
+  if (status != napi_ok) return status;
+  return napi_set_named_property(env, object, name, number);
+}
+
+static napi_value GetMetrics(napi_env env, napi_callback_info info) {
+  node_api_executor_metrics metrics;
+  napi_value result;
+
+  NODE_API_CALL(env, node_api_get_executor_metrics(env, executor, &metrics));
+  NODE_API_CALL(env, napi_create_object(env, &result));
+  NODE_API_CALL(env, SetUint64(env, result, "threads", metrics.thread_count));
+  NODE_API_CALL(env, SetUint64(env, result, "queued", metrics.queued));
+  NODE_API_CALL(env, SetUint64(env, result, "running", metrics.running));
+  NODE_API_CALL(env, SetUint64(env, result, "completed", metrics.completed));
+  NODE_API_CALL(env, SetUint64(env, result, "cancelled", metrics.cancelled));
+  return result;
+}
+
+// Creating the executor again returns the same one, thread count and all.
+static napi_value IsShared(napi_env env, napi_callback_info info) {
+  node_api_executor other;
+  node_api_executor_metrics metrics;
+  napi_value result;
+
+  NODE_API_CALL(env, node_api_create_executor(env, EXECUTOR_NAME,
+      NAPI_AUTO_LENGTH, THREAD_COUNT * 2, node_api_executor_priority_normal,
+      &other));
+  NODE_API_CALL(env, node_api_get_executor_metrics(env, other, &metrics));
+  NODE_API_CALL(env, node_api_release_executor(env, other));
+  NODE_API_CALL(env,
+      napi_get_boolean(env, metrics.thread_count == THREAD_COUNT, &result));
+  return result;
+}
+
+static void ReleaseExecutor(void* data) {
+  node_api_release_executor((napi_env)data, executor);
+}
+
+// Initialize and expose the bindings.
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_value thread_count;
+  NODE_API_CALL(env, node_api_create_executor(env, EXECUTOR_NAME,
+      NAPI_AUTO_LENGTH, THREAD_COUNT, node_api_executor_priority_low,
+      &executor));
+  NODE_API_CALL(env, napi_add_env_cleanup_hook(env, ReleaseExecutor, env));
+  NODE_API_CALL(env, napi_create_uint32(env, THREAD_COUNT, &thread_count));
+
+  napi_property_descriptor properties[] = {
+    { "THREAD_COUNT", NULL, NULL, NULL, NULL, thread_count,
+        napi_enumerable, NULL },
+    DECLARE_NODE_API_PROPERTY("Run", Run),
+    DECLARE_NODE_API_PROPERTY("RunAndCancel", RunAndCancel),
+    DECLARE_NODE_API_PROPERTY("GetMetrics", GetMetrics),
+    DECLARE_NODE_API_PROPERTY("IsShared", IsShared),
+  };
+
+  NODE_API_CALL(env, napi_define_properties(env, exports,
+    sizeof(properties)/sizeof(properties[0]), properties));
+
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,32 @@
+'use strict';
+
+const common = require('../../common');
+const assert = require('assert');
+const binding = require(`./build/${common.buildType}/binding`);
+
+assert.strictEqual(binding.IsShared(), true);
+assert.strictEqual(binding.GetMetrics().threads, binding.THREAD_COUNT);
+
+const total = binding.THREAD_COUNT + 1;
+let done = 0;
+const onDone = common.mustCall((cancelled) => {
+  assert.strictEqual(cancelled, false);
+  if (++done < total) return;
+  const metrics = binding.GetMetrics();
+  assert.strictEqual(metrics.completed, total);
+  assert.strictEqual(metrics.cancelled, 1);
+  assert.strictEqual(metrics.queued, 0);
+  assert.strictEqual(metrics.running, 0);
+}, total);
+
+// Keep all threads busy, so that the next work waits in the queue.
+for (let i = 0; i < binding.THREAD_COUNT; i++)
+  binding.Run(100, onDone);
+
+assert.strictEqual(binding.RunAndCancel(0, common.mustCall((cancelled) => {
+  assert.strictEqual(cancelled, true);
+  // Cancelled work completes without waiting for a thread.
+  assert.strictEqual(done, 0);
+})), true);
+
+binding.Run(0, onDone);
@@ -0,0 +1,29 @@
+#define NAPI_EXPERIMENTAL
+#include <stdio.h>
+#include <node_api.h>
+#include "../../js-native-api/common.h"
+
+static void cleanup(void* arg) {
+  printf("cleanup(%d)\n", *(int*)(arg));
+}
+
+static void critical(void* arg) {
+  printf("critical(%d)\n", *(int*)(arg));
+}
+
+static int secret = 42;
+static int other_secret = 17;
+static int wrong_secret = 4;
+
+static napi_value Init(napi_env env, napi_value exports) {
+  NODE_API_CALL(env, napi_add_env_cleanup_hook(env, cleanup, &other_secret));
+  NODE_API_CALL(env,
+      node_api_add_critical_env_cleanup_hook(env, critical, &secret));
+  NODE_API_CALL(env,
+      node_api_add_critical_env_cleanup_hook(env, critical, &wrong_secret));
+  NODE_API_CALL(env,
+      napi_remove_env_cleanup_hook(env, critical, &wrong_secret));
+  return NULL;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
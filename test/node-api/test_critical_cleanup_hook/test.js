@@ -0,0 +1,30 @@
+'use strict';
+const common = require('../../common');
+const assert = require('assert');
+const child_process = require('child_process');
+
+if (process.argv[2] === 'child') {
+  require(`./build/${common.buildType}/binding`);
+  if (process.argv[3] === 'exit')
+    process.exit(3);
+} else {
+  function run(execArgv, args) {
+    return child_process.spawnSync(
+      process.execPath, [...execArgv, __filename, 'child', ...args]);
+  }
+
+  // Without --fast-exit, every hook runs, newest first.
+  let child = run([], []);
+  assert.strictEqual(child.status, 0);
+  assert.strictEqual(child.stdout.toString(), 'critical(42)\ncleanup(17)\n');
+
+  // With it, only the critical ones do, whether the loop runs out or
+  // process.exit() is called.
+  child = run(['--fast-exit'], []);
+  assert.strictEqual(child.status, 0);
+  assert.strictEqual(child.stdout.toString(), 'critical(42)\n');
+
+  child = run(['--fast-exit'], ['exit']);
+  assert.strictEqual(child.status, 3);
+  assert.strictEqual(child.stdout.toString(), 'critical(42)\n');
+}
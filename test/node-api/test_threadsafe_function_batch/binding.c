@@ -0,0 +1,169 @@
+#define NAPI_EXPERIMENTAL
+#include <stdint.h>
+#include <uv.h>
+#include <node_api.h>
+#include "../../js-native-api/common.h"
+
+#define THREAD_COUNT 4
+#define ITEMS_PER_THREAD 10000
+#define MAX_QUEUE_SIZE 64
+
+static uv_thread_t uv_threads[THREAD_COUNT];
+static napi_threadsafe_function ts_fn;
+static napi_ref js_finalize_cb;
+
+typedef struct {
+  int thread_index;
+  napi_threadsafe_function_call_mode mode;
+} thread_info;
+
+static thread_info thread_infos[THREAD_COUNT];
+
+static void data_source_thread(void* data) {
+  thread_info* info = data;
+  int index;
+
+  for (index = 0; index < ITEMS_PER_THREAD; index++) {
+    intptr_t value = info->thread_index * ITEMS_PER_THREAD + index;
+    napi_status status =
+        napi_call_threadsafe_function(ts_fn, (void*)value, info->mode);
+    if (status == napi_queue_full) {
+      // Retry nonblocking pushes until the main thread has caught up.
+      index--;
+      uv_sleep(1);
+    } else if (status != napi_ok) {
+      napi_fatal_error("data_source_thread", NAPI_AUTO_LENGTH,
+          "napi_call_threadsafe_function failed", NAPI_AUTO_LENGTH);
+    }
+  }
+
+  if (napi_release_threadsafe_function(ts_fn, napi_tsfn_release) != napi_ok) {
+    napi_fatal_error("data_source_thread", NAPI_AUTO_LENGTH,
+        "napi_release_threadsafe_function failed", NAPI_AUTO_LENGTH);
+  }
+}
+
+// Convert the whole batch into a single JS array.
+static void call_js_batch(napi_env env,
+                          napi_value cb,
+                          void* context,
+                          void** data,
+                          size_t count) {
+  napi_value argv[1], undefined;
+  size_t index;
+
+  if (env == NULL || cb == NULL) {
+    return;
+  }
+
+  NODE_API_ASSERT_RETURN_VOID(env,
+      count > 0 && count <= MAX_QUEUE_SIZE, "Batch size out of range");
+  NODE_API_CALL_RETURN_VOID(env, napi_create_array_with_length(env,
+                                                               count,
+                                                               &argv[0]));
+  for (index = 0; index < count; index++) {
+    napi_value value;
+    NODE_API_CALL_RETURN_VOID(env,
+        napi_create_int32(env, (int32_t)(intptr_t)data[index], &value));
+    NODE_API_CALL_RETURN_VOID(env,
+        napi_set_element(env, argv[0], (uint32_t)index, value));
+  }
+  NODE_API_CALL_RETURN_VOID(env, napi_get_undefined(env, &undefined));
+  NODE_API_CALL_RETURN_VOID(env,
+      napi_call_function(env, undefined, cb, 1, argv, NULL));
+}
+
+// Join the threads and inform JS that we're done.
+static void join_the_threads(napi_env env, void* data, void* hint) {
+  napi_value js_cb, undefined;
+  int index;
+
+  for (index = 0; index < THREAD_COUNT; index++) {
+    uv_thread_join(&uv_threads[index]);
+  }
+  ts_fn = NULL;
+
+  NODE_API_CALL_RETURN_VOID(env,
+      napi_get_reference_value(env, js_finalize_cb, &js_cb));
+  NODE_API_CALL_RETURN_VOID(env, napi_get_undefined(env, &undefined));
+  NODE_API_CALL_RETURN_VOID(env,
+      napi_call_function(env, undefined, js_cb, 0, NULL, NULL));
+  NODE_API_CALL_RETURN_VOID(env, napi_delete_reference(env, js_finalize_cb));
+}
+
+// StartThreads(batchCallback, finalizeCallback, blocking)
+static napi_value StartThreads(napi_env env, napi_callback_info info) {
+  size_t argc = 3;
+  napi_value argv[3], async_name;
+  bool blocking;
+  int index;
+
+  NODE_API_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NODE_API_ASSERT(env, (ts_fn == NULL), "Existing thread-safe function");
+  NODE_API_CALL(env, napi_get_value_bool(env, argv[2], &blocking));
+  NODE_API_CALL(env, napi_create_reference(env, argv[1], 1, &js_finalize_cb));
+  NODE_API_CALL(env, napi_create_string_utf8(env,
+      "N-API Batched Thread-safe Function Test", NAPI_AUTO_LENGTH,
+      &async_name));
+  NODE_API_CALL(env, node_api_create_threadsafe_function_batched(
+      env, argv[0], NULL, async_name, MAX_QUEUE_SIZE, THREAD_COUNT, NULL,
+      join_the_threads, NULL, call_js_batch, &ts_fn));
+
+  for (index = 0; index < THREAD_COUNT; index++) {
+    thread_infos[index].thread_index = index;
+    thread_infos[index].mode =
+        blocking ? napi_tsfn_blocking : napi_tsfn_nonblocking;
+    NODE_API_ASSERT(env,
+        (uv_thread_create(&uv_threads[index],
+                          data_source_thread,
+                          &thread_infos[index]) == 0),
+        "Thread creation");
+  }
+
+  return NULL;
+}
+
+// A batched thread-safe function requires a bounded queue.
+static napi_value CreateUnbounded(napi_env env, napi_callback_info info) {
+  napi_value async_name, result;
+  napi_threadsafe_function unused;
+  napi_status status;
+
+  NODE_API_CALL(env, napi_create_string_utf8(env,
+      "N-API Batched Thread-safe Function Test", NAPI_AUTO_LENGTH,
+      &async_name));
+  status = node_api_create_threadsafe_function_batched(
+      env, NULL, NULL, async_name, 0, 1, NULL, NULL, NULL, call_js_batch,
+      &unused);
+  NODE_API_CALL(env, napi_get_boolean(env, status == napi_invalid_arg,
+                                      &result));
+  return result;
+}
+
+// Initialize and expose the bindings.
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_value thread_count, items_per_thread, max_queue_size;
+  NODE_API_CALL(env,
+      napi_create_uint32(env, THREAD_COUNT, &thread_count));
+  NODE_API_CALL(env,
+      napi_create_uint32(env, ITEMS_PER_THREAD, &items_per_thread));
+  NODE_API_CALL(env,
+      napi_create_uint32(env, MAX_QUEUE_SIZE, &max_queue_size));
+  napi_property_descriptor properties[] = {
+    { "THREAD_COUNT", NULL, NULL, NULL, NULL, thread_count,
+        napi_enumerable, NULL },
+    { "ITEMS_PER_THREAD", NULL, NULL, NULL, NULL, items_per_thread,
+        napi_enumerable, NULL },
+    { "MAX_QUEUE_SIZE", NULL, NULL, NULL, NULL, max_queue_size,
+        napi_enumerable, NULL },
+    DECLARE_NODE_API_PROPERTY("StartThreads", StartThreads),
+    DECLARE_NODE_API_PROPERTY("CreateUnbounded", CreateUnbounded),
+  };
+
+  NODE_API_CALL(env, napi_define_properties(env, exports,
+    sizeof(properties)/sizeof(properties[0]), properties));
+
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
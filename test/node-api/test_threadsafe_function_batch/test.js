@@ -0,0 +1,33 @@
+'use strict';
+
+const common = require('../../common');
+const assert = require('assert');
+const binding = require(`./build/${common.buildType}/binding`);
+
+const total = binding.THREAD_COUNT * binding.ITEMS_PER_THREAD;
+
+assert.strictEqual(binding.CreateUnbounded(), true);
+
+function runThreads(blocking) {
+  return new Promise((resolve) => {
+    const received = [];
+    binding.StartThreads(common.mustCallAtLeast((batch) => {
+      assert(Array.isArray(batch));
+      assert(batch.length > 0);
+      assert(batch.length <= binding.MAX_QUEUE_SIZE);
+      received.push(...batch);
+    }), common.mustCall(() => resolve(received)), blocking);
+  }).then((received) => {
+    assert.strictEqual(received.length, total);
+
+    // Items from a single thread arrive in the order they were pushed.
+    const last = new Array(binding.THREAD_COUNT).fill(-1);
+    for (const value of received) {
+      const thread = Math.floor(value / binding.ITEMS_PER_THREAD);
+      assert(value > last[thread]);
+      last[thread] = value;
+    }
+  });
+}
+
+runThreads(true).then(() => runThreads(false)).then(common.mustCall());